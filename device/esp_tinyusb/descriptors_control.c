@@ -32,10 +32,11 @@ typedef struct {
 #if (TUD_OPT_HIGH_SPEED)
     const uint8_t *hs_cfg;              /*!< Pointer to HighSpeed configuration descriptor */
     const tusb_desc_device_qualifier_t *qualifier;            /*!< Pointer to Qualifier descriptor */
-    uint8_t *other_speed;               /*!< Pointer for other speed configuration descriptor */
+    uint8_t *other_speed;               /*!< Other speed configuration descriptors: FullSpeed one followed by HighSpeed one */
 #endif // TUD_OPT_HIGH_SPEED
     const char *str[USB_STRING_DESCRIPTOR_ARRAY_SIZE];  /*!< Pointer to array of UTF-8 strings */
     int str_count;                      /*!< Number of descriptors in str */
+    uint16_t str_desc[USB_STRING_DESCRIPTOR_ARRAY_SIZE][MAX_DESC_BUF_SIZE]; /*!< UTF-16 string descriptors, built from str once */
 } tinyusb_descriptor_config_t;
 
 static tinyusb_descriptor_config_t s_desc_cfg;
@@ -100,17 +101,10 @@ uint8_t const *tud_descriptor_device_qualifier_cb(void)
 uint8_t const *tud_descriptor_other_speed_configuration_cb(uint8_t index)
 {
     assert(s_desc_cfg.other_speed);
-
-    const uint8_t *other_speed = (TUSB_SPEED_HIGH == tud_speed_get())
-                                 ? s_desc_cfg.fs_cfg
-                                 : s_desc_cfg.hs_cfg;
-
-    memcpy(s_desc_cfg.other_speed,
-           other_speed,
-           ((tusb_desc_configuration_t *)other_speed)->wTotalLength);
-
-    ((tusb_desc_configuration_t *)s_desc_cfg.other_speed)->bDescriptorType = TUSB_DESC_OTHER_SPEED_CONFIG;
-    return s_desc_cfg.other_speed;
+    const uint16_t total_len = ((tusb_desc_configuration_t *)s_desc_cfg.hs_cfg)->wTotalLength;
+    return (TUSB_SPEED_HIGH == tud_speed_get())
+           ? s_desc_cfg.other_speed
+           : s_desc_cfg.other_speed + total_len;
 }
 #endif // TUD_OPT_HIGH_SPEED
 
@@ -124,37 +118,52 @@ uint8_t const *tud_descriptor_other_speed_configuration_cb(uint8_t index)
 uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 {
     (void) langid; // Unused, this driver supports only one language in string descriptors
-    assert(s_desc_cfg.str);
-    uint8_t chr_count;
-    static uint16_t _desc_str[MAX_DESC_BUF_SIZE];
+    if (index >= USB_STRING_DESCRIPTOR_ARRAY_SIZE) {
+        ESP_LOGW(TAG, "String index (%u) is out of bounds, check your string descriptor", index);
+        return NULL;
+    }
 
-    if (index == 0) {
-        memcpy(&_desc_str[1], s_desc_cfg.str[0], 2);
-        chr_count = 1;
-    } else {
-        if (index >= USB_STRING_DESCRIPTOR_ARRAY_SIZE) {
-            ESP_LOGW(TAG, "String index (%u) is out of bounds, check your string descriptor", index);
-            return NULL;
-        }
+    if (s_desc_cfg.str[index] == NULL) {
+        ESP_LOGW(TAG, "String index (%u) points to NULL, check your string descriptor", index);
+        return NULL;
+    }
 
-        if (s_desc_cfg.str[index] == NULL) {
-            ESP_LOGW(TAG, "String index (%u) points to NULL, check your string descriptor", index);
-            return NULL;
-        }
+    return s_desc_cfg.str_desc[index];
+}
 
-        const char *str = s_desc_cfg.str[index];
-        chr_count = strnlen(str, MAX_DESC_BUF_SIZE - 1); // Buffer len - header
+// =============================================================================
+// PRIVATE FUNCTIONS
+// =============================================================================
 
+/**
+ * @brief Build UTF-16 string descriptor from the string, so the requests are served without conversion
+ *
+ * @param[in] str_idx Index of the string descriptor
+ */
+static void str_desc_build(int str_idx)
+{
+    const char *str = s_desc_cfg.str[str_idx];
+    uint16_t *desc = s_desc_cfg.str_desc[str_idx];
+    uint8_t chr_count = 0;
+
+    if (str == NULL) {
+        desc[0] = 0;
+        return;
+    }
+    if (str_idx == 0) {
+        // LANGID array, not a string
+        memcpy(&desc[1], str, 2);
+        chr_count = 1;
+    } else {
+        chr_count = strnlen(str, MAX_DESC_BUF_SIZE - 1); // Buffer len - header
         // Convert ASCII string into UTF-16
         for (uint8_t i = 0; i < chr_count; i++) {
-            _desc_str[1 + i] = str[i];
+            desc[1 + i] = str[i];
         }
     }
 
     // First byte is length in bytes (including header), second byte is descriptor type (TUSB_DESC_STRING)
-    _desc_str[0] = (TUSB_DESC_STRING << 8 ) | (2 * chr_count + 2);
-
-    return _desc_str;
+    desc[0] = (TUSB_DESC_STRING << 8 ) | (2 * chr_count + 2);
 }
 
 // =============================================================================
@@ -218,9 +227,14 @@ esp_err_t tinyusb_set_descriptors(const tinyusb_config_t *config)
         s_desc_cfg.qualifier = config->qualifier_descriptor;
     }
 
-    // Other Speed buffer allocate
-    s_desc_cfg.other_speed = calloc(1, ((tusb_desc_configuration_t *)s_desc_cfg.hs_cfg)->wTotalLength);
+    // Other Speed descriptors are prepared for both speeds, the request only selects one
+    const uint16_t total_len = ((tusb_desc_configuration_t *)s_desc_cfg.hs_cfg)->wTotalLength;
+    s_desc_cfg.other_speed = calloc(2, total_len);
     ESP_GOTO_ON_FALSE(s_desc_cfg.other_speed, ESP_ERR_NO_MEM, fail, TAG, "Other speed memory allocation error");
+    memcpy(s_desc_cfg.other_speed, s_desc_cfg.fs_cfg, total_len);
+    memcpy(s_desc_cfg.other_speed + total_len, s_desc_cfg.hs_cfg, total_len);
+    ((tusb_desc_configuration_t *)s_desc_cfg.other_speed)->bDescriptorType = TUSB_DESC_OTHER_SPEED_CONFIG;
+    ((tusb_desc_configuration_t *)(s_desc_cfg.other_speed + total_len))->bDescriptorType = TUSB_DESC_OTHER_SPEED_CONFIG;
 #endif // TUD_OPT_HIGH_SPEED
 
     // Select String Descriptors and count them
@@ -237,6 +251,9 @@ esp_err_t tinyusb_set_descriptors(const tinyusb_config_t *config)
 
     ESP_GOTO_ON_FALSE(s_desc_cfg.str_count <= USB_STRING_DESCRIPTOR_ARRAY_SIZE, ESP_ERR_NOT_SUPPORTED, fail, TAG, "String descriptors exceed limit");
     memcpy(s_desc_cfg.str, pstr_desc, s_desc_cfg.str_count * sizeof(pstr_desc[0]));
+    for (int i = 0; i < s_desc_cfg.str_count; i++) {
+        str_desc_build(i);
+    }
 
     ESP_LOGI(TAG, "\n"
              "┌─────────────────────────────────┐\n"
@@ -283,6 +300,7 @@ void tinyusb_set_str_descriptor(const char *str, int str_idx)
 {
     assert(str_idx < USB_STRING_DESCRIPTOR_ARRAY_SIZE);
     s_desc_cfg.str[str_idx] = str;
+    str_desc_build(str_idx);
 }
 
 void tinyusb_free_descriptors(void)
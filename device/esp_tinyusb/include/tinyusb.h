@@ -68,6 +68,38 @@ typedef struct {
  */
 esp_err_t tinyusb_driver_install(const tinyusb_config_t *config);
 
+/**
+ * @brief Callback of asynchronous driver install
+ *
+ * Called from TinyUSB task after the driver is installed, before the task starts handling USB events.
+ *
+ * @param result ESP_OK if the driver is installed, error of the failed step otherwise
+ * @param arg    User argument passed to tinyusb_driver_install_async()
+ */
+typedef void (*tinyusb_ready_cb_t)(esp_err_t result, void *arg);
+
+/**
+ * @brief Install the driver in TinyUSB task, without waiting for it
+ *
+ * Same steps as tinyusb_driver_install(), but USB PHY setup, descriptors preparation and TinyUSB stack initialization
+ * run in the TinyUSB task, in parallel with the rest of the application startup, so the device attaches sooner.
+ * The configuration structure is copied, the descriptors it points to must stay valid as with tinyusb_driver_install().
+ * Call tinyusb_driver_uninstall() only after the ready callback.
+ *
+ * @note Needs the default TinyUSB task, not available with CONFIG_TINYUSB_NO_DEFAULT_TASK
+ *
+ * @param config   tinyusb stack specific configuration
+ * @param ready_cb Called when the install finished, can be NULL
+ * @param arg      User argument passed to ready_cb
+ * @retval ESP_OK TinyUSB task is created, the result of the install is passed to ready_cb
+ * @retval ESP_ERR_INVALID_ARG config is NULL
+ * @retval ESP_ERR_INVALID_STATE TinyUSB task is already running
+ * @retval ESP_ERR_NO_MEM Not enough memory
+ * @retval ESP_ERR_NOT_SUPPORTED CONFIG_TINYUSB_NO_DEFAULT_TASK is enabled
+ * @retval ESP_FAIL TinyUSB task could not be created
+ */
+esp_err_t tinyusb_driver_install_async(const tinyusb_config_t *config, tinyusb_ready_cb_t ready_cb, void *arg);
+
 esp_err_t tinyusb_driver_uninstall(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#if (CONFIG_TINYUSB_DFU_OTA_ENABLED != 1)
+#error "TinyUSB DFU to OTA driver must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief Firmware update finished callback
+ *
+ * Called from the DFU task after the Host finished the download and the image was verified.
+ * The application usually restarts to boot the new firmware, after the Host read the final status.
+ *
+ * @param[in] result ESP_OK if the new image is set as boot partition, error code of the failed OTA operation otherwise
+ * @param[in] ctx    User context
+ */
+typedef void (*tinyusb_dfu_complete_cb_t)(esp_err_t result, void *ctx);
+
+/**
+ * @brief Configuration structure for DFU to OTA driver
+ */
+typedef struct {
+    const esp_partition_t *partition;               /*!< OTA partition to write, NULL for the next update partition */
+    tinyusb_dfu_complete_cb_t complete_callback;    /*!< Firmware update finished callback, can be NULL */
+    void *user_context;                             /*!< User context passed to the callback */
+} tinyusb_config_dfu_t;
+
+/**
+ * @brief Initialize DFU to OTA driver
+ *
+ * Blocks downloaded by the Host are copied into one of CONFIG_TINYUSB_DFU_OTA_BUFFERS buffers and acknowledged
+ * right away, a dedicated task writes them to the OTA partition meanwhile. The task erases the partition
+ * ahead of the written data while it waits for the next block, so the Host rarely waits for flash.
+ * Write errors are reported to the Host on the next block. After the download, the image is verified
+ * and set as boot partition during manifestation.
+ *
+ * The application provides the DFU interface in its configuration descriptor, with transfer size CONFIG_TINYUSB_DFU_BUFSIZE.
+ *
+ * @param[in] cfg Configuration structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if configuration is NULL or the partition is not an app partition
+ *      - ESP_ERR_INVALID_STATE if the driver is already initialized
+ *      - ESP_ERR_NOT_FOUND if there is no OTA partition to update
+ *      - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t tinyusb_dfu_init(const tinyusb_config_dfu_t *cfg);
+
+/**
+ * @brief De-initialize DFU to OTA driver
+ *
+ * Must be called after tinyusb_driver_uninstall(). An unfinished update is aborted.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ */
+esp_err_t tinyusb_dfu_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
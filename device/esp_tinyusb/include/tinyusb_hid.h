@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#if (CONFIG_TINYUSB_HID_DRIVER != 1)
+#error "esp_tinyusb HID driver must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief HID interfaces available to setup
+ *
+ * Index of the interface among the HID interfaces of the configuration descriptor
+ */
+typedef enum {
+    TINYUSB_HID_0 = 0x0,
+    TINYUSB_HID_1,
+    TINYUSB_HID_2,
+    TINYUSB_HID_3,
+    TINYUSB_HID_MAX
+} tinyusb_hid_itf_t;
+
+/**
+ * @brief Report sent callback
+ *
+ * Called from TinyUSB task when the Host read a queued report
+ *
+ * @param[in] itf       HID interface
+ * @param[in] report_id Report ID passed to tinyusb_hid_report_queue()
+ * @param[in] ctx       User context
+ */
+typedef void (*tinyusb_hid_report_sent_cb_t)(tinyusb_hid_itf_t itf, uint8_t report_id, void *ctx);
+
+/**
+ * @brief Configuration structure for HID interface
+ */
+typedef struct {
+    tinyusb_hid_itf_t itf;                              /*!< HID interface */
+    uint8_t queue_size;                                 /*!< Number of queued reports. Default 8 if 0 */
+    uint16_t report_size_max;                           /*!< Maximum report length without Report ID. Default CFG_TUD_HID_EP_BUFSIZE - 1 if 0 */
+    tinyusb_hid_report_sent_cb_t report_sent_callback;  /*!< Report sent callback, can be NULL */
+    void *user_context;                                 /*!< User context passed to the callback */
+} tinyusb_config_hid_t;
+
+/**
+ * @brief Initialize HID report queue of the interface
+ *
+ * Reports are sent from TinyUSB task one after another, the next report is submitted as soon as the Host read the previous one.
+ * The driver implements tud_hid_report_complete_cb(), so the application can't define it itself.
+ * The application still provides the report descriptor and GET_REPORT / SET_REPORT callbacks.
+ *
+ * @param[in] cfg Configuration structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the interface is already initialized
+ *      - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t tinyusb_hid_init(const tinyusb_config_hid_t *cfg);
+
+/**
+ * @brief De-initialize HID report queue of the interface
+ *
+ * Must be called after tinyusb_driver_uninstall(). Queued reports are discarded.
+ *
+ * @param[in] itf HID interface
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the interface is not initialized
+ */
+esp_err_t tinyusb_hid_deinit(tinyusb_hid_itf_t itf);
+
+/**
+ * @brief Queue an input report
+ *
+ * The report is copied, so the buffer can be reused right after the call.
+ *
+ * @param[in] itf       HID interface
+ * @param[in] report_id Report ID, 0 if the report descriptor doesn't use Report IDs
+ * @param[in] report    Report data without Report ID
+ * @param[in] len       Length of the report data
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the interface is not initialized or the report is too long
+ *      - ESP_ERR_INVALID_STATE if the Host has not configured the device
+ *      - ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t tinyusb_hid_report_queue(tinyusb_hid_itf_t itf, uint8_t report_id, const void *report, uint16_t len);
+
+/**
+ * @brief Get number of reports waiting in the queue
+ *
+ * @param[in] itf HID interface
+ * @return Number of queued reports, 0 if the interface is not initialized
+ */
+size_t tinyusb_hid_report_queued(tinyusb_hid_itf_t itf);
+
+#ifdef __cplusplus
+}
+#endif
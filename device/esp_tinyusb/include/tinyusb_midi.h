@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#if (CONFIG_TINYUSB_MIDI_DRIVER != 1)
+#error "esp_tinyusb MIDI driver must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief MIDI interfaces available to setup
+ *
+ * Index of the MIDI Streaming interface among the MIDI interfaces of the configuration descriptor
+ */
+typedef enum {
+    TINYUSB_MIDI_0 = 0x0,
+    TINYUSB_MIDI_1,
+    TINYUSB_MIDI_MAX
+} tinyusb_midi_itf_t;
+
+/**
+ * @brief USB MIDI 1.0 Event Packet
+ */
+typedef struct {
+    uint8_t header;         /*!< Cable Number in the high nibble, Code Index Number in the low nibble */
+    uint8_t midi[3];        /*!< MIDI message, padded with zeros */
+} tinyusb_midi_packet_t;
+
+/**
+ * @brief Data received callback
+ *
+ * Called from TinyUSB task when the Host sent packets. Use tinyusb_midi_read_packets() to get them.
+ *
+ * @param[in] itf MIDI interface
+ * @param[in] ctx User context
+ */
+typedef void (*tinyusb_midi_rx_cb_t)(tinyusb_midi_itf_t itf, void *ctx);
+
+/**
+ * @brief Transmission complete callback
+ *
+ * Called from TinyUSB task when all packets written with tinyusb_midi_write_packets() were sent to the Host.
+ *
+ * @param[in] itf   MIDI interface
+ * @param[in] count Number of packets sent since the previous call
+ * @param[in] ctx   User context
+ */
+typedef void (*tinyusb_midi_tx_done_cb_t)(tinyusb_midi_itf_t itf, size_t count, void *ctx);
+
+/**
+ * @brief Configuration structure for MIDI driver
+ */
+typedef struct {
+    tinyusb_midi_rx_cb_t rx_callback;           /*!< Data received callback, can be NULL */
+    tinyusb_midi_tx_done_cb_t tx_done_callback; /*!< Transmission complete callback, can be NULL */
+    void *user_context;                         /*!< User context passed to the callbacks */
+} tinyusb_config_midi_t;
+
+/**
+ * @brief Initialize MIDI driver for all MIDI interfaces
+ *
+ * The driver implements tud_midi_rx_cb(), so the application can't define it itself.
+ * Packets written by other means than tinyusb_midi_write_packets() are not reported by `tx_done_callback`.
+ *
+ * @param[in] cfg Configuration structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if configuration is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is already initialized
+ *      - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t tinyusb_midi_init(const tinyusb_config_midi_t *cfg);
+
+/**
+ * @brief De-initialize MIDI driver
+ *
+ * Must be called after tinyusb_driver_uninstall().
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ */
+esp_err_t tinyusb_midi_deinit(void);
+
+/**
+ * @brief Read received packets
+ *
+ * Copies up to `max_count` packets from the RX FIFO in one call.
+ *
+ * @param[in]  itf       MIDI interface
+ * @param[out] packets   Buffer for at least `max_count` packets
+ * @param[in]  max_count Size of the buffer in packets
+ * @param[out] count     Number of read packets, 0 if there are none
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the interface is not enabled or a parameter is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ */
+esp_err_t tinyusb_midi_read_packets(tinyusb_midi_itf_t itf, tinyusb_midi_packet_t *packets, size_t max_count, size_t *count);
+
+/**
+ * @brief Write packets to the Host
+ *
+ * Packets are copied to the TX FIFO and sent in transfers of up to CONFIG_TINYUSB_MIDI_EP_BUFSIZE bytes.
+ * When the FIFO is full, the function waits until it is sent, at most `timeout_ticks`.
+ *
+ * @param[in]  itf           MIDI interface
+ * @param[in]  packets       Packets to send
+ * @param[in]  count         Number of packets
+ * @param[out] written       Number of packets copied to the TX FIFO, can be NULL
+ * @param[in]  timeout_ticks Timeout to wait for the FIFO space. Set to zero for non-blocking mode
+ * @return
+ *      - ESP_OK if all packets were written
+ *      - ESP_ERR_INVALID_ARG if the interface is not enabled or `packets` is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized or the Host has not configured the interface
+ *      - ESP_ERR_TIMEOUT if only `written` packets fit into the FIFO before the timeout
+ */
+esp_err_t tinyusb_midi_write_packets(tinyusb_midi_itf_t itf, const tinyusb_midi_packet_t *packets, size_t count, size_t *written,
+                                     uint32_t timeout_ticks);
+
+#ifdef __cplusplus
+}
+#endif
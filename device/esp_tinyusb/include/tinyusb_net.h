@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "tinyusb_types.h"
 #include "esp_err.h"
@@ -27,6 +28,16 @@ typedef esp_err_t (*tusb_net_rx_cb_t)(void *buffer, uint16_t len, void *ctx);
  */
 typedef void (*tusb_net_free_tx_cb_t)(void *buffer, void *ctx);
 
+/**
+ * @brief Copy Tx buffer callback type
+ *
+ * @param[out] dst    Destination in the USB frame
+ * @param[in]  buffer Buffer passed to tinyusb_net_send...()
+ * @param[in]  len    Length passed to tinyusb_net_send...()
+ * @param[in]  ctx    User context
+ */
+typedef void (*tusb_net_tx_copy_cb_t)(void *dst, void *buffer, uint16_t len, void *ctx);
+
 /**
  * @brief On init callback type
  */
@@ -46,7 +57,20 @@ typedef struct {
                                                *        - in async mode means that the packet was queued to be processed in TinyUSB task
                                                */
     tusb_net_init_cb_t on_init_callback;      /*!< TinyUSB init network callback */
+    tusb_net_tx_copy_cb_t copy_tx_buffer;     /*!< User function for copying the Tx buffer to the USB frame.
+                                               *    - could be NULL, the buffer is then a contiguous block of `len` bytes
+                                               *    - allows to send non-contiguous buffers (e.g. lwIP pbuf chain with `pbuf_copy_partial()`)
+                                               *      with a single copy, called from TinyUSB task
+                                               */
     void *user_context;                       /*!< User context to be passed to any of the callback */
+    bool hold_rx_buffer;                      /*!< Receive buffer ownership mode.
+                                               *    - false: buffer is valid only during on_recv_callback(), the data must be copied
+                                               *    - true: buffer stays valid after on_recv_callback() returns, release it with
+                                               *      tinyusb_net_recv_renew(). No more data are received until then.
+                                               */
+    uint16_t tx_queue_size;                   /*!< Number of packets that can be pending in sync and async send mode,
+                                               *    including those waiting for a busy endpoint.
+                                               *    Preallocated at init, 0 for the default of 16 */
 } tinyusb_net_config_t;
 
 /**
@@ -62,16 +86,18 @@ esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t
  * @brief TinyUSB NET driver send data synchronously
  *
  * @note It is possible to use sync and async send interchangeably.
- * This function needs some synchronization primitives, so using sync mode (even once) uses more heap
+ * Several tasks can send synchronously at the same time, the packet is queued in order
+ * with other packets and the call returns once TinyUSB accepted it.
  *
  * @param[in] buffer            USB send data
  * @param[in] len               Send data len
  * @param[in] buff_free_arg     Pointer to be passed to the free_tx_buffer() callback
- * @param[in] timeout           Send data len
+ * @param[in] timeout           Maximum time to wait for TinyUSB to accept the packet
  * @return  ESP_OK on success == packet has been consumed by tusb and would be eventually freed
  *                              by free_tx_buffer() callback (if non null)
  *          ESP_ERR_TIMEOUT on timeout
- *          ESP_ERR_INVALID_STATE if tusb not initialized, ESP_ERR_NO_MEM on alloc failure
+ *          ESP_ERR_INVALID_STATE if tusb not initialized or the device was disconnected
+ *          ESP_ERR_NO_MEM if `tx_queue_size` packets are already pending
  */
 esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg, TickType_t  timeout);
 
@@ -80,8 +106,8 @@ esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg,
  *
  * @note If using asynchronous sends, you must free the buffer using free_tx_buffer() callback.
  * @note It is possible to use sync and async send interchangeably.
- * @note Async flavor of the send is useful when the USB stack runs faster than the caller,
- * since we have no control over the transmitted packets, if they get accepted or discarded.
+ * @note Async flavor of the send is useful when the USB stack runs faster than the caller.
+ * Packets are queued in order while the endpoint is busy, up to `tx_queue_size` packets.
  *
  * @param[in] buffer            USB send data
  * @param[in] len               Send data len
@@ -89,9 +115,21 @@ esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg,
  * @return  ESP_OK on success == packet has been consumed by tusb and will be freed
  *                              by free_tx_buffer() callback (if non null)
  *          ESP_ERR_INVALID_STATE if tusb not initialized
+ *          ESP_ERR_NO_MEM if `tx_queue_size` packets are already pending, the buffer is not consumed
  */
 esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg);
 
+/**
+ * @brief Release the receive buffer held by the application
+ *
+ * Only for `hold_rx_buffer` mode. Call once for each on_recv_callback(), when the buffer is no longer used.
+ * Can be called from any task, the next packet is then delivered from TinyUSB task.
+ *
+ * @return  ESP_OK on success
+ *          ESP_ERR_INVALID_STATE if `hold_rx_buffer` mode is not used
+ */
+esp_err_t tinyusb_net_recv_renew(void);
+
 #endif // (CONFIG_TINYUSB_NET_MODE_NONE != 1)
 
 #ifdef __cplusplus
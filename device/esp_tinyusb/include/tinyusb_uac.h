@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#if (CONFIG_TINYUSB_UAC_ENABLED != 1)
+#error "TinyUSB Audio class driver must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief Audio streams
+ */
+typedef enum {
+    TINYUSB_UAC_STREAM_SPEAKER = 0,     /*!< Host to device */
+    TINYUSB_UAC_STREAM_MIC,             /*!< Device to Host */
+} tinyusb_uac_stream_t;
+
+/**
+ * @brief Sample rate changed callback
+ *
+ * Called from TinyUSB task when the Host selects a sample rate. The application shall set the I2S clock accordingly.
+ *
+ * @param[in] sample_rate New sample rate in Hz
+ * @param[in] ctx         User context
+ */
+typedef void (*tinyusb_uac_rate_cb_t)(uint32_t sample_rate, void *ctx);
+
+/**
+ * @brief Stream started or stopped callback
+ *
+ * Called from TinyUSB task when the Host selects or deselects the streaming interface
+ *
+ * @param[in] stream Audio stream
+ * @param[in] active true if the Host started streaming
+ * @param[in] ctx    User context
+ */
+typedef void (*tinyusb_uac_stream_cb_t)(tinyusb_uac_stream_t stream, bool active, void *ctx);
+
+/**
+ * @brief Configuration structure for Audio class
+ */
+typedef struct {
+    tinyusb_uac_rate_cb_t rate_callback;        /*!< Sample rate changed callback, can be NULL */
+    tinyusb_uac_stream_cb_t stream_callback;    /*!< Stream started or stopped callback, can be NULL */
+    void *user_context;                         /*!< User context passed to the callbacks */
+} tinyusb_config_uac_t;
+
+/**
+ * @brief Audio class statistics
+ */
+typedef struct {
+    uint32_t sample_rate;           /*!< Sample rate selected by the Host in Hz */
+    uint32_t speaker_underruns;     /*!< Speaker reads padded with silence because the Host sent less samples */
+    uint32_t mic_overruns;          /*!< Microphone writes truncated because the Host took less samples */
+    int32_t feedback_ppm;           /*!< Speaker rate correction requested from the Host by the feedback endpoint */
+} tinyusb_uac_stats_t;
+
+/**
+ * @brief Initialize Audio class driver
+ *
+ * Streams use the sample resolution and channels selected in menuconfig, the Host selects 48 or 96 kHz sample rate.
+ * Samples are interleaved little endian, 24 bit samples are in the upper bytes of 32 bit containers.
+ *
+ * @param[in] cfg Configuration structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if configuration is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is already initialized
+ *      - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t tinyusb_uac_init(const tinyusb_config_uac_t *cfg);
+
+/**
+ * @brief De-initialize Audio class driver
+ *
+ * Must be called after tinyusb_driver_uninstall()
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ */
+esp_err_t tinyusb_uac_deinit(void);
+
+/**
+ * @brief Read speaker samples
+ *
+ * Call it from the task writing to I2S, right before i2s_channel_write() of the same buffer.
+ * Samples are copied from the endpoint FIFO, which the USB controller fills directly.
+ * The speaker buffer is kept half full: after the Host starts streaming, silence is returned until the buffer fills up,
+ * and the feedback endpoint asks the Host for more or less samples, so the Host follows the rate of these calls.
+ * Missing samples are replaced by silence, so the whole buffer is always filled.
+ *
+ * @param[out] buf Buffer for the samples
+ * @param[in]  len Number of bytes to read, multiple of the size of one sample of all channels
+ * @return
+ *      - ESP_OK on success, silence if the Host is not streaming
+ *      - ESP_ERR_INVALID_ARG if a parameter is invalid
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ *      - ESP_ERR_NOT_SUPPORTED if the speaker stream is disabled in menuconfig
+ */
+esp_err_t tinyusb_uac_speaker_read(void *buf, size_t len);
+
+/**
+ * @brief Write microphone samples
+ *
+ * Call it from the task reading from I2S, right after i2s_channel_read() of the same buffer.
+ * Samples are copied into the endpoint FIFO, from which the USB controller sends them in the next (micro)frames.
+ *
+ * @param[in] buf Samples
+ * @param[in] len Number of bytes to write, multiple of the size of one sample of all channels
+ * @return
+ *      - ESP_OK on success, samples that didn't fit into the buffer are dropped
+ *      - ESP_ERR_INVALID_ARG if a parameter is invalid
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized or the Host is not streaming
+ *      - ESP_ERR_NOT_SUPPORTED if the microphone stream is disabled in menuconfig
+ */
+esp_err_t tinyusb_uac_mic_write(const void *buf, size_t len);
+
+/**
+ * @brief Get sample rate selected by the Host
+ *
+ * @return Sample rate in Hz
+ */
+uint32_t tinyusb_uac_get_sample_rate(void);
+
+/**
+ * @brief Get Audio class statistics
+ *
+ * @param[out] stats Statistics
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if stats is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ */
+esp_err_t tinyusb_uac_get_stats(tinyusb_uac_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
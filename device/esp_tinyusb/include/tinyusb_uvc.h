@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#if (CONFIG_TINYUSB_UVC_ENABLED != 1)
+#error "TinyUSB Video class driver must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief Frame done callback
+ *
+ * Called when the driver doesn't use the frame passed to tinyusb_uvc_submit_frame() anymore,
+ * so the application can return it to its source, e.g. with esp_camera_fb_return().
+ * Called from TinyUSB task for sent frames and from the task calling tinyusb_uvc_submit_frame()
+ * or tinyusb_uvc_deinit() for frames that were not sent.
+ *
+ * @param[in] buf       Frame buffer passed to tinyusb_uvc_submit_frame()
+ * @param[in] frame_ctx Frame context passed to tinyusb_uvc_submit_frame()
+ * @param[in] sent      true if the frame was sent to the Host, false if it was replaced by a newer frame or streaming stopped
+ * @param[in] ctx       User context
+ */
+typedef void (*tinyusb_uvc_frame_done_cb_t)(const uint8_t *buf, void *frame_ctx, bool sent, void *ctx);
+
+/**
+ * @brief Streaming start callback
+ *
+ * Called from TinyUSB task when the Host commits the streaming parameters before it starts streaming
+ *
+ * @param[in] ctx User context
+ */
+typedef void (*tinyusb_uvc_start_cb_t)(void *ctx);
+
+/**
+ * @brief Configuration structure for Video class
+ */
+typedef struct {
+    tinyusb_uvc_frame_done_cb_t frame_done_callback; /*!< Frame done callback, can be NULL */
+    tinyusb_uvc_start_cb_t start_callback;           /*!< Streaming start callback, can be NULL */
+    void *user_context;                              /*!< User context passed to the callbacks */
+} tinyusb_config_uvc_t;
+
+/**
+ * @brief Initialize Video class driver
+ *
+ * Frames are streamed in the format and resolution selected in menuconfig, with bulk or isochronous endpoint.
+ *
+ * @param[in] cfg Configuration structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if configuration is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is already initialized
+ *      - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t tinyusb_uvc_init(const tinyusb_config_uvc_t *cfg);
+
+/**
+ * @brief De-initialize Video class driver
+ *
+ * Must be called after tinyusb_driver_uninstall(). Frames held by the driver are returned with `frame_done_callback`.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ */
+esp_err_t tinyusb_uvc_deinit(void);
+
+/**
+ * @brief Submit a frame for streaming without frame copy
+ *
+ * The driver holds two frames: the one being sent and the next one.
+ * If a frame is already waiting, it is replaced by this one and returned with `frame_done_callback` as not sent,
+ * so the Host always gets the latest frame and the source can reuse the dropped buffer immediately.
+ * The frame must stay valid and unmodified until the `frame_done_callback` is called for it.
+ * TinyUSB copies each payload into its endpoint buffer, so the frame can be in any memory accessible by the CPU, including PSRAM.
+ *
+ * @param[in] buf       Complete frame in the format selected in menuconfig
+ * @param[in] len       Frame length in bytes
+ * @param[in] frame_ctx Frame context passed to `frame_done_callback`, e.g. camera_fb_t pointer
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if a parameter is invalid
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized or the Host is not streaming.
+ *        Frames held since the Host stopped streaming are returned with `frame_done_callback`.
+ */
+esp_err_t tinyusb_uvc_submit_frame(const uint8_t *buf, size_t len, void *frame_ctx);
+
+/**
+ * @brief Check whether the Host is streaming
+ *
+ * @return true if the Host selected the streaming interface and frames can be submitted
+ */
+bool tinyusb_uvc_streaming(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#if (CONFIG_TINYUSB_VENDOR_DRIVER != 1)
+#error "esp_tinyusb Vendor specific driver must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief Vendor specific interfaces available to setup
+ *
+ * Index of the interface among the Vendor specific interfaces of the configuration descriptor
+ */
+typedef enum {
+    TINYUSB_VENDOR_0 = 0x0,
+    TINYUSB_VENDOR_1,
+    TINYUSB_VENDOR_MAX
+} tinyusb_vendor_itf_t;
+
+/**
+ * @brief Data received callback
+ *
+ * Called from TinyUSB task when a chunk of the RX ring buffer was filled by the Host.
+ * Use tinyusb_vendor_rx_peek() and tinyusb_vendor_rx_consume() to process the data.
+ *
+ * @param[in] itf Vendor specific interface
+ * @param[in] ctx User context
+ */
+typedef void (*tinyusb_vendor_rx_cb_t)(tinyusb_vendor_itf_t itf, void *ctx);
+
+/**
+ * @brief Transmission complete callback
+ *
+ * Called from TinyUSB task when the buffer passed to tinyusb_vendor_tx_submit() is not used by the driver anymore
+ *
+ * @param[in] itf  Vendor specific interface
+ * @param[in] buf  Buffer passed to tinyusb_vendor_tx_submit()
+ * @param[in] sent Number of bytes sent to the Host, less than the submitted length when the transfer was aborted by bus reset
+ * @param[in] ctx  User context
+ */
+typedef void (*tinyusb_vendor_tx_done_cb_t)(tinyusb_vendor_itf_t itf, const uint8_t *buf, size_t sent, void *ctx);
+
+/**
+ * @brief Configuration structure for Vendor specific interface
+ */
+typedef struct {
+    tinyusb_vendor_itf_t itf;                   /*!< Vendor specific interface */
+    size_t rx_chunk_size;                       /*!< Size of one OUT transfer, multiple of 512. Default 2048 B if 0 */
+    uint8_t rx_chunk_count;                     /*!< Number of chunks in the RX ring buffer, at least 2. Default 2 if 0 */
+    uint8_t tx_queue_size;                      /*!< Number of buffers submitted for transmission at the same time. Default 4 if 0 */
+    tinyusb_vendor_rx_cb_t rx_callback;         /*!< Data received callback, can be NULL */
+    tinyusb_vendor_tx_done_cb_t tx_done_callback; /*!< Transmission complete callback, can be NULL */
+    void *user_context;                         /*!< User context passed to the callbacks */
+} tinyusb_config_vendor_t;
+
+/**
+ * @brief Initialize Vendor specific interface
+ *
+ * The interface is served by this driver instead of TinyUSB Vendor class, so tud_vendor_* API must not be used for it.
+ * Received data are written by the USB controller directly into a ring buffer of `rx_chunk_count` chunks.
+ * While the application processes one chunk, the next one is being filled by the Host.
+ * Must be called before tinyusb_driver_install().
+ *
+ * @param[in] cfg Configuration structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the interface is already initialized
+ *      - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t tinyusb_vendor_init(const tinyusb_config_vendor_t *cfg);
+
+/**
+ * @brief De-initialize Vendor specific interface
+ *
+ * Must be called after tinyusb_driver_uninstall(). Submitted TX buffers are returned with `tx_done_callback`.
+ *
+ * @param[in] itf Vendor specific interface
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the interface is not initialized
+ */
+esp_err_t tinyusb_vendor_deinit(tinyusb_vendor_itf_t itf);
+
+/**
+ * @brief Get received data without copy
+ *
+ * Data stay in the RX ring buffer until released with tinyusb_vendor_rx_consume().
+ * Only contiguous data of the oldest chunk are returned, call again after consume to get the next chunk.
+ *
+ * @param[in]  itf  Vendor specific interface
+ * @param[out] data Pointer to the received data
+ * @param[out] len  Number of bytes available at `data`, 0 if there are no data
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the interface is not initialized or a parameter is NULL
+ */
+esp_err_t tinyusb_vendor_rx_peek(tinyusb_vendor_itf_t itf, const uint8_t **data, size_t *len);
+
+/**
+ * @brief Release data returned by tinyusb_vendor_rx_peek()
+ *
+ * A fully consumed chunk is returned to the USB controller for the next OUT transfer.
+ *
+ * @param[in] itf Vendor specific interface
+ * @param[in] len Number of bytes to release, at most `len` returned by tinyusb_vendor_rx_peek()
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the interface is not initialized or `len` is too big
+ */
+esp_err_t tinyusb_vendor_rx_consume(tinyusb_vendor_itf_t itf, size_t len);
+
+/**
+ * @brief Submit a buffer for transmission without copy
+ *
+ * The buffer is sent to the Host as one transfer, terminated with a zero length packet if needed.
+ * It must stay valid and unmodified until the `tx_done_callback` is called for it.
+ * In DMA mode the buffer must be DMA capable and, on targets with cache, aligned to the cache line.
+ *
+ * @param[in] itf Vendor specific interface
+ * @param[in] buf Buffer to send
+ * @param[in] len Number of bytes to send
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the interface is not initialized or a parameter is invalid
+ *      - ESP_ERR_INVALID_STATE if the Host has not configured the interface
+ *      - ESP_ERR_NO_MEM if `tx_queue_size` buffers are already submitted
+ */
+esp_err_t tinyusb_vendor_tx_submit(tinyusb_vendor_itf_t itf, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Check whether the Host has configured the interface
+ *
+ * @param[in] itf Vendor specific interface
+ * @return true if the endpoints are opened
+ */
+bool tinyusb_vendor_connected(tinyusb_vendor_itf_t itf);
+
+#ifdef __cplusplus
+}
+#endif
@@ -83,6 +83,20 @@ typedef struct {
  */
 typedef void(*tusb_cdcacm_callback_t)(int itf, cdcacm_event_t *event);
 
+/**
+ * @brief Delivery policy of the CDC_EVENT_RX event
+ *
+ * The event is delivered once enough data are collected or once the Host stops sending for a while,
+ * instead of after every received packet. Bulk uploads then wake the application once per threshold,
+ * while interactive input is delivered after the idle timeout.
+ */
+typedef struct {
+    size_t threshold;           /*!< Deliver the event when at least this many bytes are available.
+                                     0 delivers it when the RX FIFO cannot take another packet */
+    uint32_t idle_timeout_us;   /*!< Deliver the event when bytes below the threshold are available and nothing was
+                                     received for this time. 0 keeps them until more data arrive */
+} tinyusb_cdcacm_rx_notify_config_t;
+
 /*********************************************************************** Callbacks and events*/
 /* Other structs
    ********************************************************************* */
@@ -142,6 +156,22 @@ esp_err_t tinyusb_cdcacm_register_callback(tinyusb_cdcacm_itf_t itf,
  */
 esp_err_t tinyusb_cdcacm_unregister_callback(tinyusb_cdcacm_itf_t itf, cdcacm_event_type_t event_type);
 
+/**
+ * @brief Set delivery policy of the CDC_EVENT_RX event
+ *
+ * The event is delivered from TinyUSB task, also when the idle timeout expires.
+ * The internal notification of VFS is not affected.
+ *
+ * @param[in] itf    Index of CDC interface
+ * @param[in] config Delivery policy, NULL to deliver the event after every received packet (default)
+ * @return esp_err_t
+ *         - ESP_OK                 Policy set
+ *         - ESP_ERR_INVALID_ARG    Threshold exceeds CONFIG_TINYUSB_CDC_RX_BUFSIZE less one packet
+ *         - ESP_ERR_INVALID_STATE  Interface is not initialized
+ *         - ESP_ERR_NO_MEM         Idle timer could not be created
+ */
+esp_err_t tinyusb_cdcacm_set_rx_notify(tinyusb_cdcacm_itf_t itf, const tinyusb_cdcacm_rx_notify_config_t *config);
+
 /**
  * @brief Sent one character to a write buffer
  *
@@ -190,6 +220,32 @@ esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf, uint32_t timeout_
  */
 esp_err_t tinyusb_cdcacm_read(tinyusb_cdcacm_itf_t itf, uint8_t *out_buf, size_t out_buf_sz, size_t *rx_data_size);
 
+/**
+ * @brief Get received data of CDC interface for processing in place
+ *
+ * Received data are kept in a linear buffer of CONFIG_TINYUSB_CDC_RX_BUFSIZE bytes owned by the driver.
+ * The data stay available until released with `tinyusb_cdcacm_read_consume`. Calling this function again
+ * appends newly received data after the ones not consumed yet, so a message split between transfers
+ * can be parsed contiguously.
+ *
+ * @note The pointer is valid until the next call of this function or `tinyusb_cdcacm_read`
+ *
+ * @param[in]  itf       Index of CDC interface
+ * @param[out] data      Pointer to the received data
+ * @param[out] data_size Number of bytes available at `data`, 0 if nothing was received
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_read_peek(tinyusb_cdcacm_itf_t itf, const uint8_t **data, size_t *data_size);
+
+/**
+ * @brief Release data obtained with `tinyusb_cdcacm_read_peek`
+ *
+ * @param[in] itf  Index of CDC interface
+ * @param[in] size Number of bytes processed, counted from the beginning of the peeked data
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_read_consume(tinyusb_cdcacm_itf_t itf, size_t size);
+
 /**
  * @brief Check if the CDC interface is initialized
  *
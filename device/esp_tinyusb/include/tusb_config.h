@@ -80,6 +80,28 @@ extern "C" {
 #   define CONFIG_TINYUSB_BTH_ISO_ALT_COUNT 0
 #endif
 
+#ifndef CONFIG_TINYUSB_UVC_ENABLED
+#   define CONFIG_TINYUSB_UVC_ENABLED 0
+#endif
+
+#ifndef CONFIG_TINYUSB_UAC_ENABLED
+#   define CONFIG_TINYUSB_UAC_ENABLED 0
+#endif
+
+#ifndef CONFIG_TINYUSB_UAC_SPEAKER
+#   define CONFIG_TINYUSB_UAC_SPEAKER 0
+#   define CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS 0
+#endif
+
+#ifndef CONFIG_TINYUSB_UAC_MIC
+#   define CONFIG_TINYUSB_UAC_MIC 0
+#   define CONFIG_TINYUSB_UAC_MIC_CHANNELS 0
+#endif
+
+#if CONFIG_TINYUSB_UAC_ENABLED && !CONFIG_TINYUSB_UAC_SPEAKER && !CONFIG_TINYUSB_UAC_MIC
+#error "Enable at least one of UAC speaker and microphone streams in menuconfig"
+#endif
+
 #ifndef CONFIG_TINYUSB_DEBUG_LEVEL
 #   define CONFIG_TINYUSB_DEBUG_LEVEL 0
 #endif
@@ -114,6 +136,17 @@ extern "C" {
 #endif // CONFIG_CACHE_L1_CACHE_LINE_SIZE
 #endif // CONFIG_TINYUSB_MODE_DMA
 
+#if CONFIG_TINYUSB_BUFFERS_IN_PSRAM
+#include "esp_attr.h"
+// Accessed only by the CPU in Slave/IRQ mode
+#   define CFG_TUSB_MEM_SECTION         EXT_RAM_BSS_ATTR
+#endif // CONFIG_TINYUSB_BUFFERS_IN_PSRAM
+
+#if CONFIG_TINYUSB_MSC_ENABLED && CONFIG_CACHE_L1_CACHE_LINE_SIZE
+// MSC buffer is passed to the SDMMC DMA directly, which requires cache line alignment
+#   define CFG_TUSB_MEM_ALIGN       __attribute__((aligned(CONFIG_CACHE_L1_CACHE_LINE_SIZE)))
+#endif
+
 #define CFG_TUSB_OS                 OPT_OS_FREERTOS
 
 /* USB DMA on some MCUs can only access a specific SRAM region with restriction on alignment.
@@ -145,15 +178,95 @@ extern "C" {
 // MSC Buffer size of Device Mass storage
 #define CFG_TUD_MSC_BUFSIZE         CONFIG_TINYUSB_MSC_BUFSIZE
 
-// MIDI macros
+// NCM transfer block size and aggregation
+#if CONFIG_TINYUSB_NET_MODE_NCM
+#define CFG_TUD_NCM_IN_NTB_MAX_SIZE             CONFIG_TINYUSB_NET_NCM_NTB_MAX_SIZE
+#define CFG_TUD_NCM_OUT_NTB_MAX_SIZE            CONFIG_TINYUSB_NET_NCM_NTB_MAX_SIZE
+#define CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB       CONFIG_TINYUSB_NET_NCM_MAX_DATAGRAMS_PER_NTB
+#define CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB    CONFIG_TINYUSB_NET_NCM_MAX_DATAGRAMS_PER_NTB
+#define CFG_TUD_NCM_OUT_MAX_DATAGRAMS_PER_NTB   CONFIG_TINYUSB_NET_NCM_MAX_DATAGRAMS_PER_NTB
+#endif
+
+// MIDI transfer and FIFO sizes
+#if CONFIG_TINYUSB_MIDI_COUNT
+#define CFG_TUD_MIDI_EP_BUFSIZE     CONFIG_TINYUSB_MIDI_EP_BUFSIZE
+#define CFG_TUD_MIDI_RX_BUFSIZE     CONFIG_TINYUSB_MIDI_RX_BUFSIZE
+#define CFG_TUD_MIDI_TX_BUFSIZE     CONFIG_TINYUSB_MIDI_TX_BUFSIZE
+#else
 #define CFG_TUD_MIDI_EP_BUFSIZE     64
-#define CFG_TUD_MIDI_EPSIZE         CFG_TUD_MIDI_EP_BUFSIZE
 #define CFG_TUD_MIDI_RX_BUFSIZE     64
 #define CFG_TUD_MIDI_TX_BUFSIZE     64
+#endif // CONFIG_TINYUSB_MIDI_COUNT
+#define CFG_TUD_MIDI_EPSIZE         64      // Full-speed max packet size, used in descriptors of applications
 
 // Vendor FIFO size of TX and RX
+#if CONFIG_TINYUSB_VENDOR_COUNT
+#define CFG_TUD_VENDOR_RX_BUFSIZE   CONFIG_TINYUSB_VENDOR_RX_BUFSIZE
+#define CFG_TUD_VENDOR_TX_BUFSIZE   CONFIG_TINYUSB_VENDOR_TX_BUFSIZE
+#else
 #define CFG_TUD_VENDOR_RX_BUFSIZE (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #define CFG_TUD_VENDOR_TX_BUFSIZE (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif // CONFIG_TINYUSB_VENDOR_COUNT
+
+// Video streaming endpoint buffer, one payload with header
+#if CONFIG_TINYUSB_UVC_BULK
+#define CFG_TUD_VIDEO_STREAMING_BULK        1
+#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#else
+#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  (TUD_OPT_HIGH_SPEED ? 1024 : 512)
+#endif
+
+// Audio class 2.0 function with asynchronous speaker and microphone streams
+#if CONFIG_TINYUSB_UAC_ENABLED
+#if CONFIG_TINYUSB_UAC_96K
+#define TUSB_UAC_SAMPLE_RATE_MAX    96000
+#else
+#define TUSB_UAC_SAMPLE_RATE_MAX    48000
+#endif
+#if CONFIG_TINYUSB_UAC_RESOLUTION_24
+#define TUSB_UAC_BYTES_PER_SAMPLE   4
+#define TUSB_UAC_BITS_PER_SAMPLE    24
+#else
+#define TUSB_UAC_BYTES_PER_SAMPLE   2
+#define TUSB_UAC_BITS_PER_SAMPLE    16
+#endif
+// Packet of one (micro)frame with one extra sample for asynchronous rate adaptation
+#define TUSB_UAC_EP_SIZE(_frames_per_s, _nch)   ((TUSB_UAC_SAMPLE_RATE_MAX / (_frames_per_s) + 1) * TUSB_UAC_BYTES_PER_SAMPLE * (_nch))
+#define TUSB_UAC_BUF_SIZE(_nch)     (TUSB_UAC_SAMPLE_RATE_MAX / 1000 * CONFIG_TINYUSB_UAC_BUFFER_MS * TUSB_UAC_BYTES_PER_SAMPLE * (_nch))
+
+// Lengths of TinyUSB descriptor templates are expanded where usbd.h is included
+#define TUSB_UAC_SPK_AC_DESC_LEN    (CONFIG_TINYUSB_UAC_SPEAKER * (TUD_AUDIO_DESC_INPUT_TERM_LEN + TUD_AUDIO_DESC_OUTPUT_TERM_LEN))
+#define TUSB_UAC_MIC_AC_DESC_LEN    (CONFIG_TINYUSB_UAC_MIC * (TUD_AUDIO_DESC_INPUT_TERM_LEN + TUD_AUDIO_DESC_OUTPUT_TERM_LEN))
+#define TUSB_UAC_AS_DESC_LEN        (2 * TUD_AUDIO_DESC_STD_AS_INT_LEN + TUD_AUDIO_DESC_CS_AS_INT_LEN + TUD_AUDIO_DESC_TYPE_I_FORMAT_LEN + \
+                                     TUD_AUDIO_DESC_STD_AS_ISO_EP_LEN + TUD_AUDIO_DESC_CS_AS_ISO_EP_LEN)
+#define TUSB_UAC_FB_EP_DESC_LEN     7
+#define TUSB_UAC_DESC_LEN           (TUD_AUDIO_DESC_IAD_LEN + TUD_AUDIO_DESC_STD_AC_LEN + TUD_AUDIO_DESC_CS_AC_LEN + \
+                                     TUD_AUDIO_DESC_CLK_SRC_LEN + TUSB_UAC_SPK_AC_DESC_LEN + TUSB_UAC_MIC_AC_DESC_LEN + \
+                                     CONFIG_TINYUSB_UAC_SPEAKER * (TUSB_UAC_AS_DESC_LEN + TUSB_UAC_FB_EP_DESC_LEN) + \
+                                     CONFIG_TINYUSB_UAC_MIC * TUSB_UAC_AS_DESC_LEN)
+
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN               TUSB_UAC_DESC_LEN
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT               (CONFIG_TINYUSB_UAC_SPEAKER + CONFIG_TINYUSB_UAC_MIC)
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ            64
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+#define CFG_TUD_AUDIO_ENABLE_EP_OUT                 1
+#define CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP            1
+#define CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_RX  TUSB_UAC_BYTES_PER_SAMPLE
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX          CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX          TUSB_UAC_EP_SIZE(1000, CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS)
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ       TUSB_UAC_BUF_SIZE(CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS)
+#endif // CONFIG_TINYUSB_UAC_SPEAKER
+
+#if CONFIG_TINYUSB_UAC_MIC
+#define CFG_TUD_AUDIO_ENABLE_EP_IN                  1
+#define CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX  TUSB_UAC_BYTES_PER_SAMPLE
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX          CONFIG_TINYUSB_UAC_MIC_CHANNELS
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX           TUSB_UAC_EP_SIZE(1000, CONFIG_TINYUSB_UAC_MIC_CHANNELS)
+#define CFG_TUD_AUDIO_EP_SZ_IN                      CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ        TUSB_UAC_BUF_SIZE(CONFIG_TINYUSB_UAC_MIC_CHANNELS)
+#endif // CONFIG_TINYUSB_UAC_MIC
+#endif // CONFIG_TINYUSB_UAC_ENABLED
 
 // DFU macros
 #define CFG_TUD_DFU_XFER_BUFSIZE    CONFIG_TINYUSB_DFU_BUFSIZE
@@ -172,6 +285,9 @@ extern "C" {
 #define CFG_TUD_DFU                 CONFIG_TINYUSB_DFU_MODE_DFU
 #define CFG_TUD_DFU_RUNTIME         CONFIG_TINYUSB_DFU_MODE_DFU_RUNTIME
 #define CFG_TUD_BTH                 CONFIG_TINYUSB_BTH_ENABLED
+#define CFG_TUD_VIDEO               CONFIG_TINYUSB_UVC_ENABLED
+#define CFG_TUD_VIDEO_STREAMING     CONFIG_TINYUSB_UVC_ENABLED
+#define CFG_TUD_AUDIO               CONFIG_TINYUSB_UAC_ENABLED
 
 #ifdef __cplusplus
 }
@@ -10,6 +10,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include "esp_err.h"
 
 /**
@@ -20,6 +21,28 @@ extern "C" {
  */
 esp_err_t esp_tusb_init_console(int cdc_intf);
 
+/**
+ * @brief Redirect output to the USB serial through a log ring
+ *
+ * stdout and stderr are written into a ring of CONFIG_TINYUSB_CONSOLE_RING_SIZE bytes without locking,
+ * a low priority task drains the ring into CDC. Writes never block: output is dropped while the Host
+ * is not connected (DTR not set) or when the ring is full, see esp_tusb_console_get_dropped().
+ * stdin is read directly from CDC as with esp_tusb_init_console().
+ * Call esp_tusb_deinit_console() to switch back.
+ *
+ * @param cdc_intf - interface number of TinyUSB's CDC
+ *
+ * @return esp_err_t - ESP_OK, ESP_ERR_INVALID_STATE if already initialized, ESP_ERR_NO_MEM, ESP_FAIL or an error code
+ */
+esp_err_t esp_tusb_init_console_ring(int cdc_intf);
+
+/**
+ * @brief Get number of bytes dropped by the log ring
+ *
+ * @return Bytes written while the Host was not connected or the ring was full, 0 if the log ring is not used
+ */
+uint32_t esp_tusb_console_get_dropped(void);
+
 /**
  * @brief Switch log to the default output
  * @param cdc_intf - interface number of TinyUSB's CDC
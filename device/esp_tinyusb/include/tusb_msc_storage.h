@@ -14,6 +14,7 @@ extern "C" {
 #include "esp_err.h"
 #include "wear_levelling.h"
 #include "esp_vfs_fat.h"
+#include "esp_partition.h"
 #if SOC_SDMMC_HOST_SUPPORTED
 #include "driver/sdmmc_host.h"
 #endif
@@ -23,6 +24,7 @@ extern "C" {
  */
 typedef struct {
     bool is_mounted;                        /*!< Flag if storage is mounted or not */
+    uint8_t lun;                            /*!< Logical unit of the storage */
 } tinyusb_msc_event_mount_changed_data_t;
 
 /**
@@ -76,35 +78,80 @@ typedef struct {
     const esp_vfs_fat_mount_config_t mount_config; /*!< FATFS mount config */
 } tinyusb_msc_spiflash_config_t;
 
+/**
+ * @brief Configuration structure for RAM disk initialization
+ *
+ * User configurable parameters that are used while
+ * initializing the RAM disk media.
+ */
+typedef struct {
+    uint8_t *buffer;                                /*!< Storage memory of sector_count * sector_size bytes. NULL to allocate it, from PSRAM if available */
+    uint32_t sector_count;                          /*!< Number of sectors */
+    uint32_t sector_size;                           /*!< Sector size in bytes, 512 if 0 */
+    const esp_partition_t *persist_partition;       /*!< Partition the storage is loaded from on init and saved to in background on eject. NULL for volatile storage */
+    tusb_msc_callback_t callback_mount_changed;     /*!< Pointer to the function callback that will be delivered AFTER mount/unmount operation is successfully finished */
+    tusb_msc_callback_t callback_premount_changed;  /*!< Pointer to the function callback that will be delivered BEFORE mount/unmount operation is started */
+    const esp_vfs_fat_mount_config_t mount_config; /*!< FATFS mount config */
+} tinyusb_msc_ramdisk_config_t;
+
 /**
  * @brief Register storage type spiflash with tinyusb driver
  *
+ * Every registered storage is exposed as a separate logical unit (LUN) of the MSC interface.
+ * LUNs are numbered in the order of registration, starting from 0.
+ *
  * @param config pointer to the spiflash configuration
  * @return esp_err_t
  *       - ESP_OK, if success;
  *       - ESP_ERR_NO_MEM, if there was no memory to allocate storage components;
+ *       - ESP_ERR_INVALID_STATE, if CONFIG_TINYUSB_MSC_LUN_MAX storages are already registered
  */
 esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t *config);
 
+/**
+ * @brief Register storage type RAM disk with tinyusb driver
+ *
+ * READ10 and WRITE10 data are copied between the TinyUSB buffer and the memory directly from the TinyUSB callbacks,
+ * so the Host transfers data at full USB speed.
+ * With persist_partition, the storage is loaded from the partition here and written back to it by a background task
+ * when the Host ejects the storage or the device is disconnected, and on deinit. Only sectors that differ from
+ * the partition are erased and programmed.
+ *
+ * Every registered storage is exposed as a separate logical unit (LUN) of the MSC interface.
+ * LUNs are numbered in the order of registration, starting from 0.
+ *
+ * @param config pointer to the RAM disk configuration
+ * @return esp_err_t
+ *       - ESP_OK, if success;
+ *       - ESP_ERR_INVALID_ARG, if sector_count is 0 or the storage does not fit into persist_partition;
+ *       - ESP_ERR_NO_MEM, if there was no memory to allocate storage components;
+ *       - ESP_ERR_INVALID_STATE, if CONFIG_TINYUSB_MSC_LUN_MAX storages are already registered
+ */
+esp_err_t tinyusb_msc_storage_init_ramdisk(const tinyusb_msc_ramdisk_config_t *config);
+
 #if SOC_SDMMC_HOST_SUPPORTED
 /**
  * @brief Register storage type sd-card with tinyusb driver
  *
+ * Every registered storage is exposed as a separate logical unit (LUN) of the MSC interface.
+ * LUNs are numbered in the order of registration, starting from 0.
+ *
  * @param config pointer to the sd card configuration
  * @return esp_err_t
  *       - ESP_OK, if success;
  *       - ESP_ERR_NO_MEM, if there was no memory to allocate storage components;
+ *       - ESP_ERR_INVALID_STATE, if CONFIG_TINYUSB_MSC_LUN_MAX storages are already registered
  */
 esp_err_t tinyusb_msc_storage_init_sdmmc(const tinyusb_msc_sdmmc_config_t *config);
 #endif
 /**
- * @brief Deregister storage with tinyusb driver and frees the memory
+ * @brief Deregister all storages with tinyusb driver and frees the memory
  *
  */
 void tinyusb_msc_storage_deinit(void);
 
 /**
- * @brief Register a callback invoking on MSC event. If the callback had been
+ * @brief Register a callback invoking on MSC event of any LUN. If the callback had been
  *        already registered, it will be overwritten
  *
  * @param event_type - type of registered event for a callback
@@ -143,6 +190,22 @@ esp_err_t tinyusb_msc_unregister_callback(tinyusb_msc_event_type_t event_type);
  */
 esp_err_t tinyusb_msc_storage_mount(const char *base_path);
 
+/**
+ * @brief Mount the storage of a LUN locally on the firmware application.
+ *
+ * Same as tinyusb_msc_storage_mount() for any LUN.
+ * If base_path is NULL, CONFIG_TINYUSB_MSC_MOUNT_PATH is used for LUN 0
+ * and CONFIG_TINYUSB_MSC_MOUNT_PATH followed by the LUN number for the others.
+ *
+ * @param lun        logical unit number
+ * @param base_path  path prefix where FATFS should be registered
+ * @return esp_err_t
+ *       - ESP_OK, if success;
+ *       - ESP_ERR_NOT_FOUND if the maximum count of volumes is already mounted
+ *       - ESP_ERR_NO_MEM if not enough memory or too many VFSes already registered;
+ */
+esp_err_t tinyusb_msc_storage_mount_lun(uint8_t lun, const char *base_path);
+
 /**
  * @brief Unmount the storage partition from the firmware application.
  *
@@ -160,6 +223,19 @@ esp_err_t tinyusb_msc_storage_mount(const char *base_path);
  */
 esp_err_t tinyusb_msc_storage_unmount(void);
 
+/**
+ * @brief Unmount the storage of a LUN from the firmware application.
+ *
+ * Same as tinyusb_msc_storage_unmount() for any LUN.
+ *
+ * @param lun logical unit number
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if FATFS is not registered in VFS
+ *      - ESP_FAIL if there is no storage for the LUN
+ */
+esp_err_t tinyusb_msc_storage_unmount_lun(uint8_t lun);
+
 /**
  * @brief Get number of sectors in storage media
  *
@@ -167,6 +243,14 @@ esp_err_t tinyusb_msc_storage_unmount(void);
  */
 uint32_t tinyusb_msc_storage_get_sector_count(void);
 
+/**
+ * @brief Get number of sectors in storage media of a LUN
+ *
+ * @param lun logical unit number
+ * @return sector count
+ */
+uint32_t tinyusb_msc_storage_get_sector_count_lun(uint8_t lun);
+
 /**
  * @brief Get sector size of storage media
  *
@@ -174,6 +258,21 @@ uint32_t tinyusb_msc_storage_get_sector_count(void);
  */
 uint32_t tinyusb_msc_storage_get_sector_size(void);
 
+/**
+ * @brief Get sector size of storage media of a LUN
+ *
+ * @param lun logical unit number
+ * @return sector size, in bytes
+ */
+uint32_t tinyusb_msc_storage_get_sector_size_lun(uint8_t lun);
+
+/**
+ * @brief Get number of registered storages (LUNs)
+ *
+ * @return LUN count
+ */
+uint8_t tinyusb_msc_storage_get_lun_count(void);
+
 /**
  * @brief Get status if storage media is exposed over USB to Host
  *
@@ -183,6 +282,16 @@ uint32_t tinyusb_msc_storage_get_sector_size(void);
  */
 bool tinyusb_msc_storage_in_use_by_usb_host(void);
 
+/**
+ * @brief Get status if storage media of a LUN is exposed over USB to Host
+ *
+ * @param lun logical unit number
+ * @return bool
+ *      - true, if the storage media is exposed to Host
+ *      - false, if the storage media is mounted on application (not exposed to Host)
+ */
+bool tinyusb_msc_storage_in_use_by_usb_host_lun(uint8_t lun);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,29 @@ extern "C" {
  */
 esp_err_t tusb_run_task(void);
 
+/**
+ * @brief Initialization run by the TinyUSB main task before it starts handling USB events
+ *
+ * @param arg Argument passed to `tusb_run_task_async()`
+ * @return ESP_OK to continue with `tud_task()`, any other value deletes the task
+ */
+typedef esp_err_t (*tusb_task_init_cb_t)(void *arg);
+
+/**
+ * @brief Create and start the task which wraps `tud_task()`, without waiting for its initialization
+ *
+ * The task calls `init_cb` first, which shall initialize the TinyUSB stack. Unlike `tusb_run_task()`,
+ * this function returns right after the task is created, regardless of CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK.
+ *
+ * @param init_cb Initialization called in the task
+ * @param arg     Argument of `init_cb`
+ * @retval ESP_OK the task is created
+ * @retval ESP_ERR_INVALID_ARG init_cb is NULL
+ * @retval ESP_ERR_INVALID_STATE tinyusb main task has been created before
+ * @retval ESP_FAIL the task could not be created
+ */
+esp_err_t tusb_run_task_async(tusb_task_init_cb_t init_cb, void *arg);
+
 /**
  * @brief This helper function stops and destroys the task created by `tusb_run_task()`
  *
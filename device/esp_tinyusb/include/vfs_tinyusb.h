@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <stdint.h>
 #include "esp_err.h"
 #include "esp_vfs_common.h" // For esp_line_endings_t definitions
 
@@ -22,9 +23,12 @@ extern "C" {
  * Know limitation:
  * In case there are multiple CDC interfaces in the system, only one of them can be registered to VFS.
  *
+ * The file is opened in non-blocking mode. Clear O_NONBLOCK with fcntl() to make reads wait for data,
+ * see `esp_vfs_tusb_cdc_set_rx_timeout`. select() is supported if enabled with CONFIG_VFS_SUPPORT_SELECT.
+ *
  * @param[in] cdc_intf Interface number of TinyUSB's CDC
  * @param[in] path     Path where the CDC will be registered, `/dev/tusb_cdc` will be used if left NULL.
- * @return esp_err_t ESP_OK or ESP_FAIL
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM or ESP_FAIL
  */
 esp_err_t esp_vfs_tusb_cdc_register(int cdc_intf, char const *path);
 
@@ -64,6 +68,16 @@ void esp_vfs_tusb_cdc_set_tx_line_endings(esp_line_endings_t mode);
  */
 void esp_vfs_tusb_cdc_set_rx_line_endings(esp_line_endings_t mode);
 
+/**
+ * @brief Set timeout of blocking reads
+ *
+ * Applies only when O_NONBLOCK is cleared. A read waits until at least one byte is received
+ * or the timeout expires, then it fails with EWOULDBLOCK.
+ *
+ * @param[in] timeout_ticks Timeout in FreeRTOS ticks, portMAX_DELAY (default) to wait forever
+ */
+void esp_vfs_tusb_cdc_set_rx_timeout(uint32_t timeout_ticks);
+
 #ifdef __cplusplus
 }
 #endif
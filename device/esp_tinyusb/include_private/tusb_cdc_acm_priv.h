@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "tusb_cdc_acm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Internal notification of CDC-ACM data events, invoked from the TinyUSB task
+ */
+typedef void (*tusb_cdcacm_notify_t)(int itf);
+
+/**
+ * @brief Set internal notifications of CDC-ACM interface
+ *
+ * Used by the VFS driver to wake up blocked readers and select() calls.
+ * Independent of the callbacks registered by the user with `tinyusb_cdcacm_register_callback`.
+ *
+ * @param[in] itf       Index of CDC interface
+ * @param[in] notify_rx Invoked when data are received from the Host, can be NULL
+ * @param[in] notify_tx Invoked when a transfer to the Host is completed, can be NULL
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_set_notify(tinyusb_cdcacm_itf_t itf, tusb_cdcacm_notify_t notify_rx, tusb_cdcacm_notify_t notify_tx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -57,6 +57,16 @@ extern const uint8_t descriptor_hs_cfg_default[];
 
 uint8_t tusb_get_mac_string_id(void);
 
+#if CFG_TUD_AUDIO
+/**
+ * @brief Interface numbers of Audio streaming interfaces in the configuration descriptor generated from Kconfig
+ *
+ * @return Interface number, 0xFF if the stream is disabled in menuconfig
+ */
+uint8_t tusb_get_uac_speaker_itf(void);
+uint8_t tusb_get_uac_mic_itf(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
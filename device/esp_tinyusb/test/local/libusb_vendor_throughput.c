@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Bulk throughput of the first Vendor specific interface of esp_tinyusb device
+// Device side: test_apps/vendor, test case "tinyusb_vendor_throughput"
+//
+// Usage: libusb_vendor_throughput [PID] [seconds]
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <libusb-1.0/libusb.h>
+
+#define TINYUSB_VENDOR                  0x303A
+#define TINYUSB_PRODUCT                 0x4040  // 2 Vendor specific interfaces, see test_apps/vendor
+
+#define XFER_SIZE                       (64 * 1024)
+#define XFER_IN_FLIGHT                  4       // Transfers queued per direction, the Host controller never waits for us
+
+typedef struct {
+    unsigned long long bytes;
+    int running;
+} direction_t;
+
+static direction_t s_out;
+static direction_t s_in;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void LIBUSB_CALL xfer_cb(struct libusb_transfer *xfer)
+{
+    direction_t *dir = xfer->user_data;
+    if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        fprintf(stderr, "Transfer on EP 0x%02x failed: %d\n", xfer->endpoint, xfer->status);
+        dir->running--;
+        return;
+    }
+    dir->bytes += xfer->actual_length;
+    if (libusb_submit_transfer(xfer) != 0) {
+        dir->running--;
+    }
+}
+
+static int find_bulk_endpoints(libusb_device_handle *dev_handle, int *itf, unsigned char *ep_in, unsigned char *ep_out)
+{
+    struct libusb_config_descriptor *config;
+    if (libusb_get_active_config_descriptor(libusb_get_device(dev_handle), &config) != 0) {
+        return -1;
+    }
+    int rc = -1;
+    for (int i = 0; i < config->bNumInterfaces && rc != 0; i++) {
+        const struct libusb_interface_descriptor *alt = &config->interface[i].altsetting[0];
+        if (alt->bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC || alt->bNumEndpoints != 2) {
+            continue;
+        }
+        *itf = alt->bInterfaceNumber;
+        for (int e = 0; e < 2; e++) {
+            const unsigned char addr = alt->endpoint[e].bEndpointAddress;
+            if (addr & LIBUSB_ENDPOINT_IN) {
+                *ep_in = addr;
+            } else {
+                *ep_out = addr;
+            }
+        }
+        rc = 0;
+    }
+    libusb_free_config_descriptor(config);
+    return rc;
+}
+
+//
+// MAIN
+//
+int main(int argc, char **argv)
+{
+    const int pid = (argc > 1) ? (int)strtol(argv[1], NULL, 0) : TINYUSB_PRODUCT;
+    const int seconds = (argc > 2) ? atoi(argv[2]) : 10;
+    libusb_context *context = NULL;
+    int rc = 0;
+
+    rc = libusb_init(&context);
+    assert(rc == 0);
+    libusb_device_handle *dev_handle = libusb_open_device_with_vid_pid(context, TINYUSB_VENDOR, pid);
+    if (dev_handle == NULL) {
+        printf("TinyUSB Device has not been found\n");
+        libusb_exit(context);
+        return 1;
+    }
+    printf("TinyUSB Device has been found\n");
+
+    int itf = 0;
+    unsigned char ep_in = 0, ep_out = 0;
+    rc = find_bulk_endpoints(dev_handle, &itf, &ep_in, &ep_out);
+    assert(rc == 0);
+    libusb_set_auto_detach_kernel_driver(dev_handle, 1);
+    rc = libusb_claim_interface(dev_handle, itf);
+    assert(rc == 0);
+    printf("Interface %d, IN 0x%02x, OUT 0x%02x, %d s\n", itf, ep_in, ep_out, seconds);
+
+    struct libusb_transfer *xfers[2 * XFER_IN_FLIGHT];
+    for (int i = 0; i < 2 * XFER_IN_FLIGHT; i++) {
+        const int is_in = i < XFER_IN_FLIGHT;
+        unsigned char *buf = calloc(1, XFER_SIZE);
+        assert(buf);
+        xfers[i] = libusb_alloc_transfer(0);
+        assert(xfers[i]);
+        libusb_fill_bulk_transfer(xfers[i], dev_handle, is_in ? ep_in : ep_out, buf, XFER_SIZE,
+                                  xfer_cb, is_in ? &s_in : &s_out, 1000);
+        rc = libusb_submit_transfer(xfers[i]);
+        assert(rc == 0);
+        (is_in ? &s_in : &s_out)->running++;
+    }
+
+    const double start = now_s();
+    double last = start;
+    unsigned long long last_in = 0, last_out = 0;
+    while (now_s() - start < seconds && (s_in.running || s_out.running)) {
+        struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+        libusb_handle_events_timeout(context, &tv);
+        const double t = now_s();
+        if (t - last >= 1.0) {
+            printf("OUT %.2f MB/s, IN %.2f MB/s\n", (s_out.bytes - last_out) / (t - last) / 1e6,
+                   (s_in.bytes - last_in) / (t - last) / 1e6);
+            last = t;
+            last_in = s_in.bytes;
+            last_out = s_out.bytes;
+        }
+    }
+    const double elapsed = now_s() - start;
+
+    // Cancel what is in flight and let the callbacks run
+    for (int i = 0; i < 2 * XFER_IN_FLIGHT; i++) {
+        libusb_cancel_transfer(xfers[i]);
+    }
+    while (s_in.running || s_out.running) {
+        libusb_handle_events(context);
+    }
+    printf("Total: OUT %.2f MB/s, IN %.2f MB/s\n", s_out.bytes / elapsed / 1e6, s_in.bytes / elapsed / 1e6);
+
+    for (int i = 0; i < 2 * XFER_IN_FLIGHT; i++) {
+        free(xfers[i]->buffer);
+        libusb_free_transfer(xfers[i]);
+    }
+    libusb_release_interface(dev_handle, itf);
+    libusb_close(dev_handle);
+    libusb_exit(context);
+    return 0;
+}
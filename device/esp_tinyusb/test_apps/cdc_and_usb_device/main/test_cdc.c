@@ -149,4 +149,79 @@ TEST_CASE("tinyusb_cdc", "[esp_tinyusb][cdc]")
     }
 }
 
+#define RX_NOTIFY_THRESHOLD     128
+#define RX_NOTIFY_IDLE_TIMEOUT  (50 * 1000)
+
+static void tinyusb_cdc_rx_notify_callback(int itf, cdcacm_event_t *event)
+{
+    static uint8_t buf[CONFIG_TINYUSB_CDC_RX_BUFSIZE];
+    size_t rx_size = 0;
+    ESP_ERROR_CHECK(tinyusb_cdcacm_read(itf, buf, sizeof(buf), &rx_size));
+    printf("Intf %d, RX event %d bytes\n", itf, rx_size);
+}
+
+/**
+ * @brief TinyUSB CDC RX notify testcase
+ *
+ * This testcase never exits, the host (test runner) sends data and checks the printed events.
+ *
+ * - Init TinyUSB with standard CDC device and configuration descriptors
+ * - Init 2 CDC-ACM interfaces, both deliver CDC_EVENT_RX per RX_NOTIFY_THRESHOLD bytes or after RX_NOTIFY_IDLE_TIMEOUT
+ * - The RX callback reads all available data and prints their size
+ *
+ * Note: Only Full-speed targets can run this testcase. The RX FIFO of default size cannot hold a High-speed packet
+ * above the threshold.
+ */
+TEST_CASE("tinyusb_cdc_rx_notify", "[esp_tinyusb][cdc_rx_notify]")
+{
+    // Install TinyUSB driver
+    const tinyusb_config_t tusb_cfg = {
+        .device_descriptor = &cdc_device_descriptor,
+        .string_descriptor = NULL,
+        .string_descriptor_count = 0,
+        .external_phy = false,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = cdc_desc_configuration,
+        .hs_configuration_descriptor = cdc_desc_configuration,
+        .qualifier_descriptor = &device_qualifier,
+#else
+        .configuration_descriptor = cdc_desc_configuration,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+
+    tinyusb_config_cdcacm_t acm_cfg = {
+        .usb_dev = TINYUSB_USBDEV_0,
+        .cdc_port = TINYUSB_CDC_ACM_0,
+        .callback_rx = &tinyusb_cdc_rx_notify_callback,
+        .callback_rx_wanted_char = NULL,
+        .callback_line_state_changed = NULL,
+        .callback_line_coding_changed = NULL
+    };
+    const tinyusb_cdcacm_rx_notify_config_t rx_notify = {
+        .threshold = RX_NOTIFY_THRESHOLD,
+        .idle_timeout_us = RX_NOTIFY_IDLE_TIMEOUT,
+    };
+
+    // Policy cannot be set before the interface is initialized
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_cdcacm_set_rx_notify(TINYUSB_CDC_ACM_0, &rx_notify));
+
+    for (int itf = TINYUSB_CDC_ACM_0; itf <= TINYUSB_CDC_ACM_1; itf++) {
+        acm_cfg.cdc_port = itf;
+        TEST_ASSERT_EQUAL(ESP_OK, tusb_cdc_acm_init(&acm_cfg));
+        TEST_ASSERT_EQUAL(ESP_OK, tinyusb_cdcacm_set_rx_notify(itf, &rx_notify));
+    }
+
+    // Threshold must leave space for one packet in RX FIFO
+    const tinyusb_cdcacm_rx_notify_config_t too_high = {
+        .threshold = CONFIG_TINYUSB_CDC_RX_BUFSIZE,
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, tinyusb_cdcacm_set_rx_notify(TINYUSB_CDC_ACM_0, &too_high));
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
 #endif
@@ -255,4 +255,34 @@ TEST_CASE("descriptors_config_all_configured", "[esp_tinyusb][usb_device]")
 }
 #endif // TUD_OPT_HIGH_SPEED
 
+static void __test_ready_cb(esp_err_t result, void *arg)
+{
+    *(esp_err_t *)arg = result;
+}
+
+TEST_CASE("descriptors_config_async_install", "[esp_tinyusb][usb_device]")
+{
+    TEST_ASSERT_EQUAL(true, __test_prep());
+    // Install TinyUSB driver
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+        .device_descriptor = NULL,
+        .configuration_descriptor = NULL,
+#if (TUD_OPT_HIGH_SPEED)
+        .hs_configuration_descriptor = NULL,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    volatile esp_err_t ready = ESP_ERR_TIMEOUT;
+    // Install, returns before the driver is ready
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install_async(&tusb_cfg, __test_ready_cb, (void *)&ready));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_driver_install_async(&tusb_cfg, NULL, NULL));
+    // Wait for mounted callback, ready callback is called before
+    TEST_ASSERT_EQUAL(ESP_OK, __test_wait_conn());
+    TEST_ASSERT_EQUAL(ESP_OK, ready);
+    // Cleanup
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tusb_stop_task());
+    __test_free();
+}
+
 #endif // SOC_USB_OTG_SUPPORTED
@@ -1,6 +1,7 @@
 # SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Apache-2.0
 
+import pexpect
 import pytest
 from pytest_embedded_idf.dut import IdfDut
 from time import sleep
@@ -82,3 +83,74 @@ def test_usb_device_cdc(dut) -> None:
     except Exception as e:
         print(f"An unexpected error occurred: {e}")
         raise
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.usb_device
+def test_usb_device_cdc_rx_notify(dut) -> None:
+    '''
+    Running the test locally:
+    1. Build the testa app for your DUT (ESP32-S2 or S3)
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `pytest --target esp32s3 -k rx_notify`
+
+    Test procedure:
+    1. Run the test on the DUT, CDC_EVENT_RX is delivered per 128 bytes or after 50 ms without data
+    2. Expect 2 Virtual COM Ports in the system
+    3. Send data above the threshold, expect one event per threshold
+    4. Send data below the threshold, expect one event after the idle timeout
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[cdc_rx_notify]')
+    dut.expect_exact('TinyUSB: TinyUSB Driver installed')
+    sleep(2)  # Some time for the OS to enumerate our USB device
+
+    # Find devices with Espressif TinyUSB VID/PID
+    s = []
+    ports = comports()
+
+    for port, _, hwid in ports:
+        if '303A:4002' in hwid:
+            s.append(port)
+
+    if len(s) != 2:
+        raise Exception('TinyUSB COM port not found')
+
+    def expect_event(itf: int = None) -> tuple:
+        res = dut.expect(r'Intf (\d+), RX event (\d+) bytes')
+        event_itf = int(res[1].decode())
+        if itf is not None:
+            assert event_itf == itf
+        return event_itf, int(res[2].decode())
+
+    def expect_no_event() -> None:
+        with pytest.raises(pexpect.TIMEOUT):
+            dut.expect(r'RX event', timeout=0.5)
+
+    try:
+        with Serial(s[0]) as cdc:
+            # 8 Full-speed packets, one event per 2 packets
+            cdc.write(bytes(512))
+            itf, size = expect_event()
+            assert size == 128
+            for _ in range(3):
+                assert expect_event(itf) == (itf, 128)
+            expect_no_event()  # Nothing is left for the idle timeout
+
+            # Below the threshold: every packet restarts the idle period, all data are delivered in one event
+            cdc.write(bytes(100))
+            assert expect_event(itf) == (itf, 100)
+            expect_no_event()
+
+            cdc.write(bytes(10))
+            assert expect_event(itf) == (itf, 10)
+            return
+
+    except SerialException as e:
+        print(f"SerialException occurred: {e}")
+        raise
+
+    except Exception as e:
+        print(f"An unexpected error occurred: {e}")
+        raise
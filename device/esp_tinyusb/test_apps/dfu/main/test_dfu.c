@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_ota_ops.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_dfu.h"
+
+static const char *TAG = "dfu_test";
+
+#define DFU_TEST_TIMEOUT_S      60      // The Host shall download the firmware within this time
+
+static const tusb_desc_device_t dfu_device_descriptor = {
+    .bLength = sizeof(dfu_device_descriptor),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USB_ESPRESSIF_VID,
+    .idProduct = 0x4003,
+    .bcdDevice = 0x0100,
+    .iManufacturer = 0x01,
+    .iProduct = 0x02,
+    .iSerialNumber = 0x03,
+    .bNumConfigurations = 0x01
+};
+
+static const uint16_t dfu_desc_config_len = TUD_CONFIG_DESC_LEN + TUD_DFU_DESC_LEN(1);
+static const uint8_t dfu_desc_configuration[] = {
+    TUD_CONFIG_DESCRIPTOR(1, 1, 0, dfu_desc_config_len, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+    TUD_DFU_DESCRIPTOR(0, 1, 0, DFU_ATTR_CAN_DOWNLOAD | DFU_ATTR_MANIFESTATION_TOLERANT, 1000, CFG_TUD_DFU_XFER_BUFSIZE),
+};
+
+#if (TUD_OPT_HIGH_SPEED)
+static const tusb_desc_device_qualifier_t device_qualifier = {
+    .bLength = sizeof(tusb_desc_device_qualifier_t),
+    .bDescriptorType = TUSB_DESC_DEVICE_QUALIFIER,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .bNumConfigurations = 0x01,
+    .bReserved = 0
+};
+#endif // TUD_OPT_HIGH_SPEED
+
+static esp_err_t s_result = ESP_FAIL;
+
+static void dfu_complete(esp_err_t result, void *ctx)
+{
+    s_result = result;
+    xSemaphoreGive((SemaphoreHandle_t)ctx);
+}
+
+/**
+ * @brief TinyUSB DFU to OTA partition
+ *
+ * Host downloads the test app itself with dfu-util, the driver writes it to the next OTA partition.
+ * The boot partition is set back to the running one afterwards, so the test app stays unchanged.
+ */
+TEST_CASE("tinyusb_dfu", "[esp_tinyusb][dfu]")
+{
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(done);
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(update);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, tinyusb_dfu_init(NULL));
+    const tinyusb_config_dfu_t dfu_cfg = {
+        .partition = NULL,
+        .complete_callback = dfu_complete,
+        .user_context = done,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_dfu_init(&dfu_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_dfu_init(&dfu_cfg));
+
+    const tinyusb_config_t tusb_cfg = {
+        .device_descriptor = &dfu_device_descriptor,
+        .string_descriptor = NULL,
+        .string_descriptor_count = 0,
+        .external_phy = false,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = dfu_desc_configuration,
+        .hs_configuration_descriptor = dfu_desc_configuration,
+        .qualifier_descriptor = &device_qualifier,
+#else
+        .configuration_descriptor = dfu_desc_configuration,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+    ESP_LOGI(TAG, "DFU ready");
+
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(DFU_TEST_TIMEOUT_S * 1000)));
+    TEST_ASSERT_EQUAL(ESP_OK, s_result);
+    TEST_ASSERT_EQUAL_PTR(update, esp_ota_get_boot_partition());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ota_set_boot_partition(esp_ota_get_running_partition()));
+    ESP_LOGI(TAG, "DFU done");
+
+    vTaskDelay(pdMS_TO_TICKS(100)); // Let the Host read the final status
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_dfu_deinit());
+    vSemaphoreDelete(done);
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,35 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import os
+import subprocess
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_dfu(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `pytest --target esp32s3`
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Download the test app binary with dfu-util (needs dfu-util)
+    3. Expect the image to be written, verified and set as boot partition
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[dfu]')
+    dut.expect_exact('dfu_test: DFU ready')
+    sleep(2)  # Wait until the device is enumerated
+
+    binary = os.path.join(dut.app.binary_path, 'test_app_dfu.bin')
+    subprocess.run(['dfu-util', '-d', '303a:4003', '-a', '0', '-D', binary], check=True, timeout=60)
+    dut.expect_exact('dfu_test: DFU done', timeout=30)
+    dut.expect_unity_test_output()
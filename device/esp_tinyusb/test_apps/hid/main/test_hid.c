@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_hid.h"
+
+static const char *TAG = "hid_test";
+
+#define HID_TEST_REPORTS        2000
+#define HID_TEST_TIMEOUT_S      30      // The Host shall configure the device within this time
+
+static const uint8_t hid_report_descriptor[] = {
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+static const tusb_desc_device_t hid_device_descriptor = {
+    .bLength = sizeof(hid_device_descriptor),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USB_ESPRESSIF_VID,
+    .idProduct = 0x4009,
+    .bcdDevice = 0x0100,
+    .iManufacturer = 0x01,
+    .iProduct = 0x02,
+    .iSerialNumber = 0x03,
+    .bNumConfigurations = 0x01
+};
+
+// Polled every (micro)frame
+static const uint16_t hid_desc_config_len = TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN;
+static const uint8_t hid_desc_configuration[] = {
+    TUD_CONFIG_DESCRIPTOR(1, 1, 0, hid_desc_config_len, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+    TUD_HID_DESCRIPTOR(0, 0, HID_ITF_PROTOCOL_MOUSE, sizeof(hid_report_descriptor), 0x81, 16, 1),
+};
+
+#if (TUD_OPT_HIGH_SPEED)
+static const tusb_desc_device_qualifier_t device_qualifier = {
+    .bLength = sizeof(tusb_desc_device_qualifier_t),
+    .bDescriptorType = TUSB_DESC_DEVICE_QUALIFIER,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .bNumConfigurations = 0x01,
+    .bReserved = 0
+};
+#endif // TUD_OPT_HIGH_SPEED
+
+/********* TinyUSB HID callbacks ***************/
+uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
+{
+    return hid_report_descriptor;
+}
+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen)
+{
+    return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
+{
+}
+
+static TaskHandle_t s_test_task;
+static volatile size_t s_sent;
+
+static void hid_report_sent(tinyusb_hid_itf_t itf, uint8_t report_id, void *ctx)
+{
+    s_sent++;
+    xTaskNotifyGive(s_test_task);
+}
+
+/**
+ * @brief TinyUSB HID report queue
+ *
+ * Reports without movement are queued as fast as possible, the Host shall read one report per (micro)frame.
+ */
+TEST_CASE("tinyusb_hid", "[esp_tinyusb][hid]")
+{
+    const hid_mouse_report_t report = { 0 };
+    s_test_task = xTaskGetCurrentTaskHandle();
+    s_sent = 0;
+
+    const tinyusb_config_hid_t hid_cfg = {
+        .itf = TINYUSB_HID_0,
+        .queue_size = 16,
+        .report_sent_callback = hid_report_sent,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_hid_init(&hid_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_hid_init(&hid_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_hid_report_queue(TINYUSB_HID_0, 0, &report, sizeof(report)));
+
+    const tinyusb_config_t tusb_cfg = {
+        .device_descriptor = &hid_device_descriptor,
+        .string_descriptor = NULL,
+        .string_descriptor_count = 0,
+        .external_phy = false,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = hid_desc_configuration,
+        .hs_configuration_descriptor = hid_desc_configuration,
+        .qualifier_descriptor = &device_qualifier,
+#else
+        .configuration_descriptor = hid_desc_configuration,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+    ESP_LOGI(TAG, "HID ready");
+
+    int waited_ms = 0;
+    while (!tud_mounted()) {
+        TEST_ASSERT_LESS_THAN(HID_TEST_TIMEOUT_S * 1000, waited_ms);
+        vTaskDelay(pdMS_TO_TICKS(100));
+        waited_ms += 100;
+    }
+
+    const int64_t start_us = esp_timer_get_time();
+    size_t queued = 0;
+    while (s_sent < HID_TEST_REPORTS) {
+        if (queued < HID_TEST_REPORTS && tinyusb_hid_report_queue(TINYUSB_HID_0, 0, &report, sizeof(report)) == ESP_OK) {
+            queued++;
+            continue;
+        }
+        TEST_ASSERT_NOT_EQUAL(0, ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)));
+    }
+    const int64_t elapsed_us = esp_timer_get_time() - start_us;
+    const int64_t interval_us = (tud_speed_get() == TUSB_SPEED_HIGH) ? 125 : 1000;
+    ESP_LOGI(TAG, "Sent %d reports in %lld us, %lld us per report", HID_TEST_REPORTS, elapsed_us, elapsed_us / HID_TEST_REPORTS);
+    // One report per poll, with some margin for the start and missed polls
+    TEST_ASSERT_LESS_THAN(HID_TEST_REPORTS * interval_us * 3 / 2, elapsed_us);
+    TEST_ASSERT_EQUAL(0, tinyusb_hid_report_queued(TINYUSB_HID_0));
+    ESP_LOGI(TAG, "HID done");
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_hid_deinit(TINYUSB_HID_0));
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,28 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_hid(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `pytest --target esp32s3`
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Expect the Host to bind its HID mouse driver, which polls the device every (micro)frame
+    3. Expect all queued reports to be read at the polling rate
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[hid]')
+    dut.expect_exact('hid_test: HID ready')
+    dut.expect_exact('hid_test: HID done', timeout=60)
+    dut.expect_unity_test_output()
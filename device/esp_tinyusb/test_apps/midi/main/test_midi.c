@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_midi.h"
+
+static const char *TAG = "midi_test";
+
+#define MIDI_TEST_PACKETS       4096    // Packets echoed back to the Host, same as in pytest_midi.py
+#define MIDI_TEST_BATCH         64
+#define MIDI_TEST_TIMEOUT_S     30      // The Host shall send all packets within this time
+
+static const tusb_desc_device_t midi_device_descriptor = {
+    .bLength = sizeof(midi_device_descriptor),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USB_ESPRESSIF_VID,
+    .idProduct = 0x4008,
+    .bcdDevice = 0x0100,
+    .iManufacturer = 0x01,
+    .iProduct = 0x02,
+    .iSerialNumber = 0x03,
+    .bNumConfigurations = 0x01
+};
+
+static const uint16_t midi_desc_config_len = TUD_CONFIG_DESC_LEN + TUD_MIDI_DESC_LEN;
+static const uint8_t midi_fs_desc_configuration[] = {
+    TUD_CONFIG_DESCRIPTOR(1, 2, 0, midi_desc_config_len, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+    TUD_MIDI_DESCRIPTOR(0, 0, 0x01, 0x81, 64),
+};
+
+#if (TUD_OPT_HIGH_SPEED)
+static const uint8_t midi_hs_desc_configuration[] = {
+    TUD_CONFIG_DESCRIPTOR(1, 2, 0, midi_desc_config_len, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+    TUD_MIDI_DESCRIPTOR(0, 0, 0x01, 0x81, 512),
+};
+
+static const tusb_desc_device_qualifier_t device_qualifier = {
+    .bLength = sizeof(tusb_desc_device_qualifier_t),
+    .bDescriptorType = TUSB_DESC_DEVICE_QUALIFIER,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .bNumConfigurations = 0x01,
+    .bReserved = 0
+};
+#endif // TUD_OPT_HIGH_SPEED
+
+static TaskHandle_t s_test_task;
+static volatile size_t s_tx_done;
+
+static void midi_rx(tinyusb_midi_itf_t itf, void *ctx)
+{
+    xTaskNotifyGive(s_test_task);
+}
+
+static void midi_tx_done(tinyusb_midi_itf_t itf, size_t count, void *ctx)
+{
+    s_tx_done += count;
+    xTaskNotifyGive(s_test_task);
+}
+
+/**
+ * @brief TinyUSB MIDI echo
+ *
+ * Host sends a stream of SysEx packets, they are echoed back in batches.
+ * All echoed packets must be reported by the transmission complete callback.
+ */
+TEST_CASE("tinyusb_midi", "[esp_tinyusb][midi]")
+{
+    static tinyusb_midi_packet_t packets[MIDI_TEST_BATCH];
+    size_t count;
+    s_test_task = xTaskGetCurrentTaskHandle();
+    s_tx_done = 0;
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_midi_read_packets(TINYUSB_MIDI_0, packets, MIDI_TEST_BATCH, &count));
+    const tinyusb_config_midi_t midi_cfg = {
+        .rx_callback = midi_rx,
+        .tx_done_callback = midi_tx_done,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_midi_init(&midi_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_midi_init(&midi_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_midi_write_packets(TINYUSB_MIDI_0, packets, 1, NULL, 0));
+
+    const tinyusb_config_t tusb_cfg = {
+        .device_descriptor = &midi_device_descriptor,
+        .string_descriptor = NULL,
+        .string_descriptor_count = 0,
+        .external_phy = false,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = midi_fs_desc_configuration,
+        .hs_configuration_descriptor = midi_hs_desc_configuration,
+        .qualifier_descriptor = &device_qualifier,
+#else
+        .configuration_descriptor = midi_fs_desc_configuration,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+    ESP_LOGI(TAG, "MIDI ready");
+
+    size_t echoed = 0;
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(MIDI_TEST_TIMEOUT_S * 1000);
+    while (echoed < MIDI_TEST_PACKETS) {
+        TEST_ASSERT_LESS_THAN(deadline, xTaskGetTickCount());
+        TEST_ASSERT_EQUAL(ESP_OK, tinyusb_midi_read_packets(TINYUSB_MIDI_0, packets, MIDI_TEST_BATCH, &count));
+        if (count == 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+        size_t written;
+        TEST_ASSERT_EQUAL(ESP_OK, tinyusb_midi_write_packets(TINYUSB_MIDI_0, packets, count, &written, pdMS_TO_TICKS(1000)));
+        TEST_ASSERT_EQUAL(count, written);
+        echoed += count;
+    }
+    while (s_tx_done < echoed) {
+        TEST_ASSERT_LESS_THAN(deadline, xTaskGetTickCount());
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    }
+    ESP_LOGI(TAG, "Echoed %zu packets, %zu reported sent", echoed, s_tx_done);
+    ESP_LOGI(TAG, "MIDI done");
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_midi_deinit());
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,64 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+import usb.core
+import usb.util
+from time import sleep
+
+MIDI_TEST_PACKETS = 4096  # Same as in test_midi.c
+MIDI_STREAMING_ITF = 1
+
+
+def sysex_packets(count):
+    '''
+    USB MIDI packets of SysEx messages, each packet carries 3 data bytes of one message
+    '''
+    packets = bytearray()
+    for i in range(count):
+        packets += bytes([0x04, 0xF0, (i >> 7) & 0x7F, i & 0x7F])
+    return packets
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_midi(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `pytest --target esp32s3`
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Detach the MIDI Streaming interface from the kernel driver (Linux only)
+    3. Send a stream of SysEx packets and expect them echoed back in the same order
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[midi]')
+    dut.expect_exact('midi_test: MIDI ready')
+    sleep(2)  # Wait until the device is enumerated
+
+    dev = usb.core.find(idVendor=0x303A, idProduct=0x4008)
+    assert dev is not None, 'Device not found'
+    if dev.is_kernel_driver_active(MIDI_STREAMING_ITF):
+        dev.detach_kernel_driver(MIDI_STREAMING_ITF)
+    intf = dev.get_active_configuration()[(MIDI_STREAMING_ITF, 0)]
+    ep_in = usb.util.find_descriptor(intf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_IN)
+    ep_out = usb.util.find_descriptor(intf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_OUT)
+
+    sent = sysex_packets(MIDI_TEST_PACKETS)
+    received = bytearray()
+    chunk = 1024
+    for offset in range(0, len(sent), chunk):
+        ep_out.write(sent[offset:offset + chunk], 1000)
+        while len(received) < offset + chunk:
+            received += ep_in.read(ep_in.wMaxPacketSize * 8, 1000)
+    assert received == sent, 'Echoed packets differ'
+
+    dut.expect_exact(f'midi_test: Echoed {MIDI_TEST_PACKETS} packets, {MIDI_TEST_PACKETS} reported sent', timeout=30)
+    dut.expect_exact('midi_test: MIDI done')
+    dut.expect_unity_test_output()
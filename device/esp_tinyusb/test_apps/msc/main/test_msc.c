@@ -0,0 +1,283 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "spi_flash_mmap.h"
+#include "wear_levelling.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tusb_msc_storage.h"
+#if SOC_SDMMC_HOST_SUPPORTED
+#include "driver/sdmmc_host.h"
+#include "sdmmc_cmd.h"
+#endif
+
+static const char *TAG = "msc_test";
+
+/* Statistics collected by wrapping the flash and the MSC callbacks (see main/CMakeLists.txt)
+   ********************************************************************* */
+static volatile uint32_t s_flash_erased_sectors;
+static volatile uint64_t s_flash_written_bytes;
+static volatile uint64_t s_host_read_bytes;
+static volatile uint64_t s_host_written_bytes;
+
+esp_err_t __real_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+esp_err_t __real_esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+int32_t __real_tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize);
+int32_t __real_tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize);
+
+esp_err_t __wrap_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    s_flash_erased_sectors += size / SPI_FLASH_SEC_SIZE;
+    return __real_esp_partition_erase_range(partition, offset, size);
+}
+
+esp_err_t __wrap_esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    s_flash_written_bytes += size;
+    return __real_esp_partition_write(partition, dst_offset, src, size);
+}
+
+int32_t __wrap_tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize)
+{
+    int32_t ret = __real_tud_msc_read10_cb(lun, lba, offset, buffer, bufsize);
+    if (ret > 0) {
+        s_host_read_bytes += ret;
+    }
+    return ret;
+}
+
+int32_t __wrap_tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize)
+{
+    int32_t ret = __real_tud_msc_write10_cb(lun, lba, offset, buffer, bufsize);
+    if (ret > 0) {
+        s_host_written_bytes += ret;
+    }
+    return ret;
+}
+/*********************************************************************** Statistics*/
+
+static void msc_install_driver(void)
+{
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+        .device_descriptor = NULL,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = NULL,
+        .hs_configuration_descriptor = NULL,
+        .qualifier_descriptor = NULL,
+#else
+        .configuration_descriptor = NULL,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+}
+
+/**
+ * @brief Report statistics while the Host runs the benchmark
+ *
+ * Returns when the Host ejects the storage, which mounts it back to the application.
+ */
+static void msc_run_benchmark(void)
+{
+    uint64_t last_read = 0;
+    uint64_t last_written = 0;
+    bool exposed = false;
+
+    ESP_LOGI(TAG, "MSC benchmark ready");
+    while (!exposed || tinyusb_msc_storage_in_use_by_usb_host()) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        exposed |= tinyusb_msc_storage_in_use_by_usb_host();
+        if (s_host_read_bytes == last_read && s_host_written_bytes == last_written) {
+            continue;
+        }
+        last_read = s_host_read_bytes;
+        last_written = s_host_written_bytes;
+        ESP_LOGI(TAG, "host read %llu B, host written %llu B, flash written %llu B, flash erased %lu sectors",
+                 last_read, last_written, (uint64_t)s_flash_written_bytes, (uint32_t)s_flash_erased_sectors);
+    }
+
+    const uint64_t written_kb = s_host_written_bytes / 1024;
+    ESP_LOGI(TAG, "Erased sectors per MB written: %llu",
+             written_kb ? ((uint64_t)s_flash_erased_sectors * 1024) / written_kb : 0);
+    ESP_LOGI(TAG, "MSC benchmark done");
+}
+
+static void msc_reset_statistics(void)
+{
+    s_flash_erased_sectors = 0;
+    s_flash_written_bytes = 0;
+    s_host_read_bytes = 0;
+    s_host_written_bytes = 0;
+}
+
+/**
+ * @brief TinyUSB MSC throughput on SPI Flash with wear levelling
+ *
+ * Host runs the I/O pattern (see pytest_msc.py) and ejects the storage when done
+ */
+TEST_CASE("tinyusb_msc_spiflash_benchmark", "[esp_tinyusb][msc]")
+{
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    const esp_partition_t *data_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+    TEST_ASSERT_NOT_NULL(data_partition);
+    TEST_ASSERT_EQUAL(ESP_OK, wl_mount(data_partition, &wl_handle));
+
+    const tinyusb_msc_spiflash_config_t config_spi = {
+        .wl_handle = wl_handle,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_spiflash(&config_spi));
+    msc_reset_statistics();
+    msc_install_driver();
+
+    msc_run_benchmark();
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_unmount());
+    tinyusb_msc_storage_deinit();
+    TEST_ASSERT_EQUAL(ESP_OK, wl_unmount(wl_handle));
+}
+
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+/**
+ * @brief TinyUSB MSC UNMAP of SPI Flash storage
+ *
+ * Block unmapped by the Host is erased in background, writing it afterwards programs the flash without erasing.
+ * SCSI commands are passed to the MSC callbacks directly, so no Host is needed.
+ */
+TEST_CASE("tinyusb_msc_spiflash_unmap", "[esp_tinyusb][msc]")
+{
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    const esp_partition_t *data_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+    TEST_ASSERT_NOT_NULL(data_partition);
+    TEST_ASSERT_EQUAL(ESP_OK, wl_mount(data_partition, &wl_handle));
+    const tinyusb_msc_spiflash_config_t config_spi = {
+        .wl_handle = wl_handle,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_spiflash(&config_spi));
+
+    const uint32_t sector_size = tinyusb_msc_storage_get_sector_size();
+    const uint32_t block_sectors = sector_size < SPI_FLASH_SEC_SIZE ? SPI_FLASH_SEC_SIZE / sector_size : 1;
+    const uint32_t lba = 8 * block_sectors;
+    uint8_t *buf = calloc(1, block_sectors * sector_size);
+    TEST_ASSERT_NOT_NULL(buf);
+
+    // READ CAPACITY (16) reports Logical Block Provisioning Management
+    const uint8_t read_capacity_16[16] = { 0x9E, 0x10, [13] = 32 };
+    TEST_ASSERT_EQUAL(32, tud_msc_scsi_cb(0, read_capacity_16, buf, 32));
+    TEST_ASSERT_EQUAL_HEX8(0x80, buf[14] & 0x80);
+
+    // UNMAP parameter list with one block descriptor
+    const uint8_t unmap[16] = { 0x42, [8] = 24 };
+    uint8_t param[24] = { 0, 22, 0, 16 };
+    param[8 + 4] = lba >> 24;
+    param[8 + 5] = lba >> 16;
+    param[8 + 6] = lba >> 8;
+    param[8 + 7] = lba;
+    param[8 + 11] = block_sectors;
+    TEST_ASSERT_EQUAL(sizeof(param), tud_msc_scsi_cb(0, unmap, param, sizeof(param)));
+    vTaskDelay(pdMS_TO_TICKS(100)); // Let the background erase finish
+
+    msc_reset_statistics();
+    memset(buf, 0x5A, block_sectors * sector_size);
+    TEST_ASSERT_EQUAL(block_sectors * sector_size, tud_msc_write10_cb(0, lba, 0, buf, block_sectors * sector_size));
+    const uint8_t synchronize_cache[16] = { 0x35 };
+    TEST_ASSERT_EQUAL(0, tud_msc_scsi_cb(0, synchronize_cache, NULL, 0));
+    TEST_ASSERT_EQUAL(0, s_flash_erased_sectors);
+
+    free(buf);
+    tinyusb_msc_storage_deinit();
+    TEST_ASSERT_EQUAL(ESP_OK, wl_unmount(wl_handle));
+}
+#endif // CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+
+/**
+ * @brief TinyUSB MSC RAM disk saved to flash
+ *
+ * File written by the application is saved to the partition on deinit and loaded back on next init,
+ * without the Host. Only changed flash sectors are programmed.
+ */
+TEST_CASE("tinyusb_msc_ramdisk_persistence", "[esp_tinyusb][msc_ramdisk]")
+{
+    const esp_partition_t *data_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+    TEST_ASSERT_NOT_NULL(data_partition);
+    const tinyusb_msc_ramdisk_config_t config_ram = {
+        .sector_count = 128,
+        .persist_partition = data_partition,
+    };
+    char line[32] = {0};
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_ramdisk(&config_ram));
+    TEST_ASSERT_EQUAL(512, tinyusb_msc_storage_get_sector_size());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_mount(NULL));
+    FILE *f = fopen(CONFIG_TINYUSB_MSC_MOUNT_PATH "/ram.txt", "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("persisted", f);
+    fclose(f);
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_unmount());
+    tinyusb_msc_storage_deinit();
+
+    msc_reset_statistics();
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_ramdisk(&config_ram));
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_mount(NULL));
+    f = fopen(CONFIG_TINYUSB_MSC_MOUNT_PATH "/ram.txt", "r");
+    TEST_ASSERT_NOT_NULL(f);
+    fgets(line, sizeof(line), f);
+    fclose(f);
+    TEST_ASSERT_EQUAL_STRING("persisted", line);
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_unmount());
+    tinyusb_msc_storage_deinit();
+    // Nothing was written, nothing is saved
+    TEST_ASSERT_EQUAL(0, s_flash_erased_sectors);
+}
+
+#if SOC_SDMMC_HOST_SUPPORTED
+/**
+ * @brief TinyUSB MSC throughput on SD card
+ *
+ * Needs an SD card in the default slot of the SDMMC host, not run in CI
+ */
+TEST_CASE("tinyusb_msc_sdmmc_benchmark", "[esp_tinyusb][msc_sdmmc]")
+{
+    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+    sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+    sdmmc_card_t *card = calloc(1, sizeof(sdmmc_card_t));
+    TEST_ASSERT_NOT_NULL(card);
+    TEST_ASSERT_EQUAL(ESP_OK, (*host.init)());
+    TEST_ASSERT_EQUAL(ESP_OK, sdmmc_host_init_slot(host.slot, &slot_config));
+    TEST_ASSERT_EQUAL(ESP_OK, sdmmc_card_init(&host, card));
+    sdmmc_card_print_info(stdout, card);
+
+    const tinyusb_msc_sdmmc_config_t config_sdmmc = {
+        .card = card,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_sdmmc(&config_sdmmc));
+    msc_reset_statistics();
+    msc_install_driver();
+
+    msc_run_benchmark();
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_unmount());
+    tinyusb_msc_storage_deinit();
+    TEST_ASSERT_EQUAL(ESP_OK, (*host.deinit)());
+    free(card);
+}
+#endif // SOC_SDMMC_HOST_SUPPORTED
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,100 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import glob
+import mmap
+import os
+import random
+import subprocess
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep, perf_counter
+
+
+def find_msc_block_device():
+    '''
+    Find the block device of the TinyUSB MSC storage (Linux only)
+    '''
+    for _ in range(10):
+        devices = glob.glob('/dev/disk/by-id/usb-TinyUSB_Flash_Storage*')
+        devices = [d for d in devices if '-part' not in d]
+        if devices:
+            return os.path.realpath(devices[0])
+        sleep(1)
+    raise ValueError("MSC block device not found")
+
+
+def run_io(dev, write, offsets, chunk):
+    '''
+    Read or write `chunk` bytes at each offset, bypassing the Host page cache
+    Return throughput in MB/s
+    '''
+    buf = mmap.mmap(-1, chunk)  # O_DIRECT needs page aligned buffer
+    if write:
+        buf.write(os.urandom(chunk))
+    fd = os.open(dev, (os.O_RDWR if write else os.O_RDONLY) | os.O_DIRECT | os.O_SYNC)
+    try:
+        start = perf_counter()
+        for offset in offsets:
+            os.lseek(fd, offset, os.SEEK_SET)
+            if write:
+                os.write(fd, buf)
+            else:
+                os.readv(fd, [buf])
+        elapsed = perf_counter() - start
+    finally:
+        os.close(fd)
+        buf.close()
+    return len(offsets) * chunk / elapsed / 1e6
+
+
+def run_benchmark(dev, size):
+    '''
+    Sequential and random I/O on the raw block device, prints MB/s per direction
+    '''
+    seq_chunk = 64 * 1024
+    rnd_chunk = 4 * 1024
+    seq = list(range(0, size - seq_chunk + 1, seq_chunk))
+    rnd = [random.randrange(0, size // rnd_chunk) * rnd_chunk for _ in range(64)]
+
+    results = {
+        'sequential write': run_io(dev, True, seq, seq_chunk),
+        'sequential read': run_io(dev, False, seq, seq_chunk),
+        'random 4K write': run_io(dev, True, rnd, rnd_chunk),
+        'random 4K read': run_io(dev, False, rnd, rnd_chunk),
+    }
+    for name, mbps in results.items():
+        print(f'{name}: {mbps:.3f} MB/s')
+    return results
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_msc_spiflash(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `sudo pytest --target esp32s3`, raw access to the block device needs root
+
+    Important note: Linux only. Writes the raw block device, the file system on the storage is lost.
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Run sequential and random reads and writes on the MSC block device, print MB/s
+    3. Eject the storage and check erase statistics in the DUT log
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[msc]')
+    dut.expect_exact('msc_test: MSC benchmark ready')
+    sleep(2)  # Some time for the OS to enumerate our USB device
+
+    dev = find_msc_block_device()
+    size = int(subprocess.check_output(['blockdev', '--getsize64', dev]))
+    run_benchmark(dev, size)
+
+    subprocess.check_call(['eject', dev])
+    dut.expect(r'msc_test: Erased sectors per MB written: (\d+)')
+    dut.expect_exact('msc_test: MSC benchmark done')
@@ -0,0 +1,242 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "iperf.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_net.h"
+
+static const char *TAG = "net_test";
+
+#define NET_TEST_IP             "192.168.7.1"
+#define NET_TEST_NETMASK        "255.255.255.0"
+#define NET_TEST_IDLE_TIMEOUT_S 3   // The Host is done when there is no traffic for this time
+#define NET_TEST_IDLE_PACKETS   50  // Fewer packets per second are background traffic of the Host
+
+/* Glue between tinyusb_net and esp_netif
+   ********************************************************************* */
+static esp_netif_t *s_netif;
+static volatile uint32_t s_rx_packets;
+static volatile uint32_t s_rx_dropped;
+static volatile uint32_t s_tx_packets;
+static volatile uint32_t s_tx_dropped;
+
+static esp_err_t usb_net_recv(void *buffer, uint16_t len, void *ctx)
+{
+    // The buffer belongs to TinyUSB, lwIP gets a copy and frees it with driver_free_rx_buffer
+    void *copy = malloc(len);
+    if (copy == NULL) {
+        s_rx_dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, buffer, len);
+    if (esp_netif_receive(s_netif, copy, len, copy) != ESP_OK) {
+        s_rx_dropped++;
+        return ESP_FAIL;
+    }
+    s_rx_packets++;
+    return ESP_OK;
+}
+
+static esp_err_t usb_net_transmit(void *handle, void *buffer, size_t len)
+{
+    (void) handle;
+    if (tinyusb_net_send_sync(buffer, len, NULL, pdMS_TO_TICKS(100)) != ESP_OK) {
+        s_tx_dropped++;
+        return ESP_OK; // Dropped like on a lossy link, TCP retransmits
+    }
+    s_tx_packets++;
+    return ESP_OK;
+}
+
+static void usb_net_free_rx_buffer(void *handle, void *buffer)
+{
+    (void) handle;
+    free(buffer);
+}
+
+static esp_err_t usb_net_post_attach(esp_netif_t *netif, void *args)
+{
+    esp_netif_driver_base_t *driver = args;
+    driver->netif = netif;
+    const esp_netif_driver_ifconfig_t driver_ifconfig = {
+        .handle = driver,
+        .transmit = usb_net_transmit,
+        .driver_free_rx_buffer = usb_net_free_rx_buffer,
+    };
+    return esp_netif_set_driver_config(netif, &driver_ifconfig);
+}
+
+static esp_netif_driver_base_t s_driver = {
+    .post_attach = usb_net_post_attach,
+};
+/*********************************************************************** Glue */
+
+/* Per-core CPU load from the run time of idle tasks
+   ********************************************************************* */
+typedef struct {
+    uint32_t total;
+    uint32_t idle[portNUM_PROCESSORS];
+} cpu_sample_t;
+
+static void cpu_sample(cpu_sample_t *sample)
+{
+    const UBaseType_t max_tasks = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = calloc(max_tasks, sizeof(TaskStatus_t));
+    TEST_ASSERT_NOT_NULL(tasks);
+    const UBaseType_t count = uxTaskGetSystemState(tasks, max_tasks, &sample->total);
+    memset(sample->idle, 0, sizeof(sample->idle));
+    for (UBaseType_t i = 0; i < count; i++) {
+        if (strncmp(tasks[i].pcTaskName, "IDLE", 4) == 0 && tasks[i].xCoreID < portNUM_PROCESSORS) {
+            sample->idle[tasks[i].xCoreID] = tasks[i].ulRunTimeCounter;
+        }
+    }
+    free(tasks);
+}
+
+static void cpu_print_load(const cpu_sample_t *start, const cpu_sample_t *end)
+{
+    const uint32_t total = end->total - start->total;
+    for (int core = 0; core < portNUM_PROCESSORS && total; core++) {
+        const uint32_t idle = end->idle[core] - start->idle[core];
+        ESP_LOGI(TAG, "core%d load %lu%%", core, 100 - MIN(100, (idle * 100ULL) / total));
+    }
+}
+/*********************************************************************** CPU load */
+
+static void net_install(void)
+{
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+        .device_descriptor = NULL,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = NULL,
+        .hs_configuration_descriptor = NULL,
+        .qualifier_descriptor = NULL,
+#else
+        .configuration_descriptor = NULL,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+
+    const tinyusb_net_config_t net_config = {
+        .mac_addr = {0x02, 0x02, 0x11, 0x22, 0x33, 0x01},
+        .on_recv_callback = usb_net_recv,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_net_init(TINYUSB_USBDEV_0, &net_config));
+
+    // The Host gets its address from DHCP server on the device
+    TEST_ASSERT_EQUAL(ESP_OK, esp_netif_init());
+    esp_err_t ret = esp_event_loop_create_default();
+    TEST_ASSERT(ret == ESP_OK || ret == ESP_ERR_INVALID_STATE);
+
+    esp_netif_ip_info_t ip_info = { 0 };
+    ip_info.ip.addr = esp_ip4addr_aton(NET_TEST_IP);
+    ip_info.gw.addr = esp_ip4addr_aton(NET_TEST_IP);
+    ip_info.netmask.addr = esp_ip4addr_aton(NET_TEST_NETMASK);
+    esp_netif_inherent_config_t base_cfg = ESP_NETIF_INHERENT_DEFAULT_WIFI_AP();
+    base_cfg.if_key = "USB_NCM";
+    base_cfg.if_desc = "usb ncm";
+    base_cfg.ip_info = &ip_info;
+    // USB NCM MAC address of the device side, the one in the descriptor belongs to the Host
+    const uint8_t mac[6] = {0x02, 0x02, 0x11, 0x22, 0x33, 0x02};
+    memcpy(base_cfg.mac, mac, sizeof(mac));
+    const esp_netif_config_t cfg = {
+        .base = &base_cfg,
+        .driver = NULL,
+        .stack = ESP_NETIF_NETSTACK_DEFAULT_ETH,
+    };
+    s_netif = esp_netif_new(&cfg);
+    TEST_ASSERT_NOT_NULL(s_netif);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_netif_attach(s_netif, &s_driver));
+    esp_netif_action_start(s_netif, NULL, 0, NULL);
+    esp_netif_action_connected(s_netif, NULL, 0, NULL);
+}
+
+/**
+ * @brief Run iperf server for one protocol, report statistics every second
+ *
+ * Returns when the Host stops sending
+ */
+static void net_run_iperf_server(uint32_t protocol_flag, const char *name)
+{
+    iperf_cfg_t cfg = {
+        .flag = IPERF_FLAG_SERVER | protocol_flag,
+        .type = IPERF_IP_TYPE_IPV4,
+        .source_ip4 = esp_ip4addr_aton(NET_TEST_IP),
+        .sport = IPERF_DEFAULT_PORT,
+        .interval = 1,
+        .time = 3600, // Stopped when the Host is done
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, iperf_start(&cfg));
+    ESP_LOGI(TAG, "iperf %s server ready", name);
+
+    cpu_sample_t start, now;
+    uint32_t last_rx = s_rx_packets;
+    int idle_s = 0;
+    bool started = false;
+    cpu_sample(&now);
+    while (!started || idle_s < NET_TEST_IDLE_TIMEOUT_S) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        const uint32_t rx = s_rx_packets;
+        if (rx - last_rx < NET_TEST_IDLE_PACKETS) {
+            if (!started) {
+                cpu_sample(&now);
+            }
+            last_rx = rx;
+            idle_s++;
+            continue;
+        }
+        if (!started) {
+            start = now; // Measure load of the traffic only
+        }
+        cpu_sample(&now);
+        started = true;
+        idle_s = 0;
+        last_rx = rx;
+        ESP_LOGI(TAG, "rx %lu packets (dropped %lu), tx %lu packets (dropped %lu)",
+                 rx, s_rx_dropped, s_tx_packets, s_tx_dropped);
+    }
+    iperf_stop();
+
+    cpu_print_load(&start, &now);
+    ESP_LOGI(TAG, "Dropped packets: rx %lu, tx %lu", s_rx_dropped, s_tx_dropped);
+    ESP_LOGI(TAG, "iperf %s server done", name);
+}
+
+/**
+ * @brief TinyUSB NCM throughput with lwIP and iperf
+ *
+ * Host runs iperf TCP and then UDP client (see pytest_net.py), the device reports CPU load and dropped packets
+ */
+TEST_CASE("tinyusb_net_iperf_benchmark", "[esp_tinyusb][net]")
+{
+    net_install();
+
+    net_run_iperf_server(IPERF_FLAG_TCP, "TCP");
+    net_run_iperf_server(IPERF_FLAG_UDP, "UDP");
+    ESP_LOGI(TAG, "NET benchmark done");
+
+    // There is no deinit of the network driver, the test must be run in a fresh application
+    esp_netif_action_disconnected(s_netif, NULL, 0, NULL);
+    esp_netif_action_stop(s_netif, NULL, 0, NULL);
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,87 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import glob
+import os
+import re
+import subprocess
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep
+
+DEVICE_IP = '192.168.7.1'
+
+
+def find_ncm_interface():
+    '''
+    Find the network interface of the TinyUSB NCM device (Linux only)
+    '''
+    for _ in range(10):
+        for iface in glob.glob('/sys/class/net/*'):
+            driver = os.path.join(iface, 'device', 'driver')
+            if os.path.islink(driver) and os.path.basename(os.readlink(driver)) == 'cdc_ncm':
+                return os.path.basename(iface)
+        sleep(1)
+    raise ValueError('NCM network interface not found')
+
+
+def wait_for_device(iface):
+    '''
+    Wait until the Host got an address from the DHCP server of the device
+    '''
+    for _ in range(30):
+        if subprocess.call(['ping', '-c', '1', '-W', '1', '-I', iface, DEVICE_IP],
+                           stdout=subprocess.DEVNULL) == 0:
+            return
+        sleep(1)
+    raise ValueError(f'Device {DEVICE_IP} not reachable on {iface}')
+
+
+def run_iperf(args):
+    '''
+    Run iperf2 client against the device, return Mbit/s of the whole run
+    '''
+    out = subprocess.check_output(['iperf', '-c', DEVICE_IP, '-t', '10', '-i', '1', '-f', 'm'] + args, text=True)
+    print(out)
+    rates = re.findall(r'([\d.]+) Mbits/sec', out)
+    if not rates:
+        raise ValueError('iperf result not found')
+    return float(rates[-1])
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_net_iperf(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Install iperf (version 2) on the test runner
+    4. Run `pytest --target esp32s3`
+
+    Important note: Linux only. The Host must configure the NCM interface with DHCP (NetworkManager does by default).
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Run iperf TCP and UDP clients against the iperf server on the DUT, print Mbit/s
+    3. Check CPU load and dropped packets in the DUT log
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[net]')
+    dut.expect_exact('net_test: iperf TCP server ready')
+    sleep(2)  # Some time for the OS to enumerate our USB device
+
+    iface = find_ncm_interface()
+    wait_for_device(iface)
+
+    tcp = run_iperf([])
+    print(f'TCP: {tcp:.2f} Mbit/s')
+    dut.expect(r'net_test: Dropped packets: rx (\d+), tx (\d+)', timeout=30)
+    dut.expect_exact('net_test: iperf UDP server ready')
+
+    udp = run_iperf(['-u', '-b', '200M', '-l', '1460'])
+    print(f'UDP: {udp:.2f} Mbit/s')
+    dut.expect(r'net_test: Dropped packets: rx (\d+), tx (\d+)', timeout=30)
+    dut.expect_exact('net_test: NET benchmark done')
@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_uac.h"
+
+static const char *TAG = "uac_test";
+
+#define UAC_TEST_CHUNK_MS       10      // The test task substitutes I2S, paced by FreeRTOS ticks
+#define UAC_TEST_FRAME_BYTES    (CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS * 2)
+#define UAC_TEST_TIMEOUT_S      30      // The Host shall start streaming within this time
+#define UAC_TEST_STREAM_S       5
+
+static volatile bool s_spk_active;
+
+static void uac_stream_changed(tinyusb_uac_stream_t stream, bool active, void *ctx)
+{
+    ESP_LOGI(TAG, "Stream %d %s", stream, active ? "started" : "stopped");
+    if (stream == TINYUSB_UAC_STREAM_SPEAKER) {
+        s_spk_active = active;
+    }
+}
+
+/**
+ * @brief TinyUSB UAC2 speaker to microphone loopback
+ *
+ * Host plays to the speaker and records from the microphone, e.g. with aplay and arecord.
+ * The speaker samples are written back to the microphone, the feedback endpoint keeps the speaker buffer half full.
+ */
+TEST_CASE("tinyusb_uac", "[esp_tinyusb][uac]")
+{
+    const size_t chunk_size = tinyusb_uac_get_sample_rate() / 1000 * UAC_TEST_CHUNK_MS * UAC_TEST_FRAME_BYTES;
+    uint8_t *buf = malloc(chunk_size);
+    TEST_ASSERT_NOT_NULL(buf);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_uac_speaker_read(buf, chunk_size));
+    const tinyusb_config_uac_t uac_cfg = {
+        .stream_callback = uac_stream_changed,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uac_init(&uac_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_uac_init(&uac_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, tinyusb_uac_speaker_read(buf, UAC_TEST_FRAME_BYTES + 1));
+
+    // Silence before the Host starts streaming
+    memset(buf, 0x55, chunk_size);
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uac_speaker_read(buf, chunk_size));
+    for (int i = 0; i < chunk_size; i++) {
+        TEST_ASSERT_EQUAL(0, buf[i]);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_uac_mic_write(buf, chunk_size));
+
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+        .device_descriptor = NULL,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = NULL,
+        .hs_configuration_descriptor = NULL,
+        .qualifier_descriptor = NULL,
+#else
+        .configuration_descriptor = NULL,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+    ESP_LOGI(TAG, "UAC ready");
+
+    int waited_ms = 0;
+    while (!s_spk_active) {
+        TEST_ASSERT_LESS_THAN(UAC_TEST_TIMEOUT_S * 1000, waited_ms);
+        vTaskDelay(pdMS_TO_TICKS(100));
+        waited_ms += 100;
+    }
+
+    TickType_t wake = xTaskGetTickCount();
+    for (int i = 0; i < UAC_TEST_STREAM_S * 1000 / UAC_TEST_CHUNK_MS && s_spk_active; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uac_speaker_read(buf, chunk_size));
+        tinyusb_uac_mic_write(buf, chunk_size);
+        xTaskDelayUntil(&wake, pdMS_TO_TICKS(UAC_TEST_CHUNK_MS));
+    }
+
+    tinyusb_uac_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uac_get_stats(&stats));
+    ESP_LOGI(TAG, "Sample rate %"PRIu32" Hz, speaker underruns %"PRIu32", mic overruns %"PRIu32", feedback %"PRId32" ppm",
+             stats.sample_rate, stats.speaker_underruns, stats.mic_overruns, stats.feedback_ppm);
+    ESP_LOGI(TAG, "UAC done");
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uac_deinit());
+    free(buf);
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,53 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import re
+import subprocess
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep
+
+
+def find_sound_card():
+    '''
+    Find ALSA card of the DUT
+    '''
+    cards = subprocess.run(['aplay', '-l'], capture_output=True, text=True).stdout
+    for line in cards.splitlines():
+        match = re.match(r'card (\d+): .*Espressif', line)
+        if match:
+            return match.group(1)
+    return None
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_uac(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `pytest --target esp32s3`
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Expect an ALSA sound card in the system (Linux only, needs alsa-utils)
+    3. Play silence to the speaker and record the microphone at the same time
+    4. Expect no speaker underruns after the buffer filled up
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[uac]')
+    dut.expect_exact('uac_test: UAC ready')
+    sleep(2)  # Wait until the device is enumerated
+
+    card = find_sound_card()
+    assert card is not None, 'Sound card not found'
+    device = f'hw:{card},0'
+    record = subprocess.Popen(['arecord', '-D', device, '-f', 'S16_LE', '-c', '2', '-r', '48000', '-d', '6', '/dev/null'])
+    subprocess.run(['aplay', '-D', device, '-f', 'S16_LE', '-c', '2', '-r', '48000', '-d', '6', '/dev/zero'], check=True, timeout=30)
+    record.wait(timeout=30)
+    dut.expect(r'uac_test: Sample rate 48000 Hz, speaker underruns 0,', timeout=30)
+    dut.expect_exact('uac_test: UAC done')
+    dut.expect_unity_test_output()
@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_uvc.h"
+
+static const char *TAG = "uvc_test";
+
+#define UVC_TEST_FRAME_SIZE     (CONFIG_TINYUSB_UVC_WIDTH * CONFIG_TINYUSB_UVC_HEIGHT * 2)
+#define UVC_TEST_FRAME_COUNT    3       // One frame is sent, one waits and one is filled by the application
+#define UVC_TEST_FRAMES         100
+#define UVC_TEST_TIMEOUT_S      30      // The Host shall start streaming within this time
+
+static QueueHandle_t s_free_frames;
+static volatile int s_sent;
+static volatile int s_dropped;
+
+static void uvc_frame_done(const uint8_t *buf, void *frame_ctx, bool sent, void *ctx)
+{
+    if (sent) {
+        s_sent++;
+    } else {
+        s_dropped++;
+    }
+    xQueueSend(s_free_frames, &buf, 0);
+}
+
+/**
+ * @brief Fill YUY2 frame with gray level moving with the frame number
+ */
+static void uvc_fill_frame(uint8_t *buf, int frame_num)
+{
+    for (int i = 0; i < UVC_TEST_FRAME_SIZE; i += 2) {
+        buf[i] = (uint8_t)(frame_num * 4 + i / 64);
+        buf[i + 1] = 0x80;
+    }
+}
+
+/**
+ * @brief TinyUSB UVC streaming
+ *
+ * The device generates frames, Host streams them, e.g. `v4l2-ctl --stream-mmap --stream-count=50`.
+ * Every submitted frame is returned with the frame done callback, either sent or dropped.
+ */
+TEST_CASE("tinyusb_uvc", "[esp_tinyusb][uvc]")
+{
+    s_sent = 0;
+    s_dropped = 0;
+    s_free_frames = xQueueCreate(UVC_TEST_FRAME_COUNT, sizeof(uint8_t *));
+    TEST_ASSERT_NOT_NULL(s_free_frames);
+    for (int i = 0; i < UVC_TEST_FRAME_COUNT; i++) {
+        uint8_t *buf = malloc(UVC_TEST_FRAME_SIZE);
+        TEST_ASSERT_NOT_NULL(buf);
+        xQueueSend(s_free_frames, &buf, 0);
+    }
+
+    const tinyusb_config_uvc_t uvc_cfg = {
+        .frame_done_callback = uvc_frame_done,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uvc_init(&uvc_cfg));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, tinyusb_uvc_init(&uvc_cfg));
+
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+        .device_descriptor = NULL,
+#if (TUD_OPT_HIGH_SPEED)
+        .fs_configuration_descriptor = NULL,
+        .hs_configuration_descriptor = NULL,
+        .qualifier_descriptor = NULL,
+#else
+        .configuration_descriptor = NULL,
+#endif // TUD_OPT_HIGH_SPEED
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+    ESP_LOGI(TAG, "UVC ready");
+
+    int waited_ms = 0;
+    while (!tinyusb_uvc_streaming()) {
+        TEST_ASSERT_LESS_THAN(UVC_TEST_TIMEOUT_S * 1000, waited_ms);
+        vTaskDelay(pdMS_TO_TICKS(100));
+        waited_ms += 100;
+    }
+    ESP_LOGI(TAG, "UVC streaming");
+
+    int submitted = 0;
+    for (int i = 0; i < UVC_TEST_FRAMES && tinyusb_uvc_streaming(); i++) {
+        uint8_t *buf;
+        TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(s_free_frames, &buf, pdMS_TO_TICKS(1000)));
+        uvc_fill_frame(buf, i);
+        if (tinyusb_uvc_submit_frame(buf, UVC_TEST_FRAME_SIZE, NULL) == ESP_OK) {
+            submitted++;
+        } else {
+            xQueueSend(s_free_frames, &buf, 0);
+        }
+        vTaskDelay(pdMS_TO_TICKS(1000 / CONFIG_TINYUSB_UVC_FPS));
+    }
+    ESP_LOGI(TAG, "UVC done");
+
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_uvc_deinit());
+    ESP_LOGI(TAG, "Frames submitted %d, sent %d, dropped %d", submitted, s_sent, s_dropped);
+    TEST_ASSERT_GREATER_THAN(0, s_sent);
+    TEST_ASSERT_EQUAL(submitted, s_sent + s_dropped);
+
+    // All frames are back
+    for (int i = 0; i < UVC_TEST_FRAME_COUNT; i++) {
+        uint8_t *buf;
+        TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(s_free_frames, &buf, 0));
+        free(buf);
+    }
+    vQueueDelete(s_free_frames);
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
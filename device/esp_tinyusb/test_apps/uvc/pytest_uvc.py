@@ -0,0 +1,47 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import glob
+import subprocess
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep
+
+
+def find_video_device():
+    '''
+    Find V4L2 capture device of the DUT
+    '''
+    for dev in sorted(glob.glob('/dev/video*')):
+        info = subprocess.run(['v4l2-ctl', '-d', dev, '--info'], capture_output=True, text=True).stdout
+        if 'Espressif' in info:
+            return dev
+    return None
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+#@pytest.mark.usb_device                        Disable in CI, for now, not possible to run this test in Docker container
+def test_usb_device_uvc(dut: IdfDut) -> None:
+    '''
+    Running the test locally:
+    1. Build the test app for your DUT
+    2. Connect you DUT to your test runner (local machine) with USB port and flashing port
+    3. Run `pytest --target esp32s3`
+
+    Test procedure:
+    1. Run the test on the DUT
+    2. Expect a V4L2 video device in the system (Linux only, needs v4l-utils)
+    3. Stream 50 frames from it
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[uvc]')
+    dut.expect_exact('uvc_test: UVC ready')
+    sleep(2)  # Wait until the device is enumerated
+
+    dev = find_video_device()
+    assert dev is not None, 'Video device not found'
+    subprocess.run(['v4l2-ctl', '-d', dev, '--stream-mmap', '--stream-count=50'], check=True, timeout=30)
+    dut.expect_exact('uvc_test: UVC done', timeout=30)
+    dut.expect_unity_test_output()
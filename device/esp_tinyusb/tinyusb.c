@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>
 #include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_check.h"
@@ -19,10 +20,11 @@
 const static char *TAG = "TinyUSB";
 static usb_phy_handle_t phy_hdl;
 
-esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
+/**
+ * @brief Configure USB PHY of the device
+ */
+static esp_err_t tinyusb_phy_install(const tinyusb_config_t *config)
 {
-    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
-
     // Configure USB PHY
     usb_phy_config_t phy_conf = {
         .controller = USB_PHY_CTRL_OTG,
@@ -50,7 +52,14 @@ esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
     if (config->self_powered) {
         phy_conf.otg_io_conf = &otg_io_conf;
     }
-    ESP_RETURN_ON_ERROR(usb_new_phy(&phy_conf, &phy_hdl), TAG, "Install USB PHY failed");
+    return usb_new_phy(&phy_conf, &phy_hdl);
+}
+
+esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+
+    ESP_RETURN_ON_ERROR(tinyusb_phy_install(config), TAG, "Install USB PHY failed");
 
     // Descriptors config
     ESP_RETURN_ON_ERROR(tinyusb_set_descriptors(config), TAG, "Descriptors config failed");
@@ -66,6 +75,64 @@ esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
     return ESP_OK;
 }
 
+#if !CONFIG_TINYUSB_NO_DEFAULT_TASK
+typedef struct {
+    tinyusb_config_t config;
+    tinyusb_ready_cb_t ready_cb;
+    void *ready_arg;
+} tinyusb_async_install_t;
+
+/**
+ * @brief Install the driver in TinyUSB task, in parallel with the rest of the application startup
+ */
+static esp_err_t tinyusb_async_install(void *arg)
+{
+    tinyusb_async_install_t *install = (tinyusb_async_install_t *)arg;
+    esp_err_t ret = tinyusb_phy_install(&install->config);
+    if (ret == ESP_OK) {
+        ret = tinyusb_set_descriptors(&install->config);
+        if (ret == ESP_OK && !tusb_init()) {
+            tinyusb_free_descriptors();
+            ret = ESP_FAIL;
+        }
+        if (ret != ESP_OK) {
+            usb_del_phy(phy_hdl);
+        }
+    }
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "TinyUSB Driver installed");
+    } else {
+        ESP_LOGE(TAG, "TinyUSB Driver install failed: %s", esp_err_to_name(ret));
+    }
+    if (install->ready_cb) {
+        install->ready_cb(ret, install->ready_arg);
+    }
+    free(install);
+    return ret;
+}
+#endif // !CONFIG_TINYUSB_NO_DEFAULT_TASK
+
+esp_err_t tinyusb_driver_install_async(const tinyusb_config_t *config, tinyusb_ready_cb_t ready_cb, void *arg)
+{
+    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+#if CONFIG_TINYUSB_NO_DEFAULT_TASK
+    ESP_LOGE(TAG, "Asynchronous install needs the default TinyUSB task");
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    tinyusb_async_install_t *install = malloc(sizeof(tinyusb_async_install_t));
+    ESP_RETURN_ON_FALSE(install, ESP_ERR_NO_MEM, TAG, "Failed to allocate install context");
+    install->config = *config;
+    install->ready_cb = ready_cb;
+    install->ready_arg = arg;
+    esp_err_t ret = tusb_run_task_async(tinyusb_async_install, install);
+    if (ret != ESP_OK) {
+        free(install);
+        ESP_LOGE(TAG, "Run TinyUSB task failed");
+    }
+    return ret;
+#endif // CONFIG_TINYUSB_NO_DEFAULT_TASK
+}
+
 esp_err_t tinyusb_driver_uninstall()
 {
     tinyusb_free_descriptors();
@@ -0,0 +1,364 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_ota_ops.h"
+#include "spi_flash_mmap.h"
+#include "tusb.h"
+#include "tinyusb_dfu.h"
+
+static const char *TAG = "tusb_dfu";
+
+#define DFU_BLOCK_SIZE          CFG_TUD_DFU_XFER_BUFSIZE
+#define DFU_BUF_COUNT           CONFIG_TINYUSB_DFU_OTA_BUFFERS
+#define DFU_ERASE_AHEAD         (CONFIG_TINYUSB_DFU_OTA_ERASE_AHEAD_KB * 1024)
+#define DFU_TASK_STACK_SIZE     4096
+#define DFU_POLL_DNBUSY_MS      1       // Blocks are usually acknowledged before the Host polls
+#define DFU_POLL_MANIFEST_MS    100     // Image verification reads the whole partition
+
+typedef enum {
+    DFU_JOB_WRITE,
+    DFU_JOB_MANIFEST,
+    DFU_JOB_ABORT,
+    DFU_JOB_STOP,
+} dfu_job_type_t;
+
+typedef struct {
+    dfu_job_type_t type;
+    uint8_t *buf;
+    uint32_t offset;
+    uint16_t len;
+} dfu_job_t;
+
+typedef struct {
+    const esp_partition_t *partition;
+    tinyusb_dfu_complete_cb_t complete_cb;
+    void *ctx;
+    uint8_t *bufs;                  // DFU_BUF_COUNT blocks
+    QueueHandle_t job_queue;
+    TaskHandle_t task;
+    SemaphoreHandle_t task_exit;    // Given by the DFU task when it exits
+    volatile uint8_t status;        // First DFU_STATUS_ERR_* of the current download, reported with the next block
+    // Protected by s_dfu_lock
+    uint8_t *free_bufs[DFU_BUF_COUNT];
+    int free_count;
+    dfu_job_t deferred;             // Block received while all buffers were busy, len 0 if none
+    // TinyUSB task only
+    uint32_t rx_offset;
+    // DFU task only
+    esp_ota_handle_t ota;
+    bool ota_begun;
+    uint32_t erased;                // Partition is erased up to this offset
+    uint32_t written;
+} dfu_obj_t;
+
+static dfu_obj_t *s_dfu;
+static portMUX_TYPE s_dfu_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void dfu_set_error(dfu_obj_t *obj, uint8_t status)
+{
+    if (obj->status == DFU_STATUS_OK) {
+        obj->status = status;
+    }
+}
+
+static void dfu_queue_job(dfu_obj_t *obj, dfu_job_type_t type, uint8_t *buf, uint32_t offset, uint16_t len)
+{
+    const dfu_job_t job = {
+        .type = type,
+        .buf = buf,
+        .offset = offset,
+        .len = len,
+    };
+    // The queue holds all buffers and the control jobs, it never fills up
+    xQueueSend(obj->job_queue, &job, portMAX_DELAY);
+}
+
+/**
+ * @brief Return the buffer of a written block, or reuse it for the deferred block and acknowledge that one
+ */
+static void dfu_release_buf(dfu_obj_t *obj, uint8_t *buf)
+{
+    portENTER_CRITICAL(&s_dfu_lock);
+    const dfu_job_t deferred = obj->deferred;
+    if (deferred.len) {
+        obj->deferred.len = 0;
+    } else {
+        obj->free_bufs[obj->free_count++] = buf;
+    }
+    portEXIT_CRITICAL(&s_dfu_lock);
+
+    if (deferred.len) {
+        // TinyUSB keeps the data until the block is acknowledged
+        memcpy(buf, deferred.buf, deferred.len);
+        dfu_queue_job(obj, DFU_JOB_WRITE, buf, deferred.offset, deferred.len);
+        tud_dfu_finish_flashing(obj->status);
+    }
+}
+
+static void dfu_ota_abort(dfu_obj_t *obj)
+{
+    if (obj->ota_begun) {
+        esp_ota_abort(obj->ota);
+        obj->ota_begun = false;
+    }
+}
+
+static esp_err_t dfu_ota_begin(dfu_obj_t *obj)
+{
+    dfu_ota_abort(obj);
+    // Sectors are erased by this driver ahead of the writes
+    ESP_RETURN_ON_ERROR(esp_ota_begin(obj->partition, OTA_WITH_SEQUENTIAL_WRITES, &obj->ota), TAG, "Failed to begin OTA");
+    obj->ota_begun = true;
+    obj->erased = 0;
+    obj->written = 0;
+    return ESP_OK;
+}
+
+static esp_err_t dfu_erase_next(dfu_obj_t *obj)
+{
+    esp_err_t ret = esp_partition_erase_range(obj->partition, obj->erased, SPI_FLASH_SEC_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase 0x%"PRIx32, obj->erased);
+        dfu_set_error(obj, DFU_STATUS_ERR_ERASE);
+        return ret;
+    }
+    obj->erased += SPI_FLASH_SEC_SIZE;
+    return ESP_OK;
+}
+
+static void dfu_write(dfu_obj_t *obj, const dfu_job_t *job)
+{
+    if (job->offset == 0 && dfu_ota_begin(obj) != ESP_OK) {
+        dfu_set_error(obj, DFU_STATUS_ERR_WRITE);
+    }
+    if (obj->status != DFU_STATUS_OK || !obj->ota_begun) {
+        return;
+    }
+    if (job->offset + job->len > obj->partition->size) {
+        ESP_LOGE(TAG, "Image is larger than partition %s", obj->partition->label);
+        dfu_set_error(obj, DFU_STATUS_ERR_ADDRESS);
+        return;
+    }
+    while (obj->erased < job->offset + job->len) {
+        if (dfu_erase_next(obj) != ESP_OK) {
+            return;
+        }
+    }
+    if (esp_ota_write_with_offset(obj->ota, job->buf, job->len, job->offset) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write 0x%"PRIx32, job->offset);
+        dfu_set_error(obj, DFU_STATUS_ERR_WRITE);
+        return;
+    }
+    obj->written = job->offset + job->len;
+}
+
+static void dfu_manifest(dfu_obj_t *obj)
+{
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (obj->status == DFU_STATUS_OK && obj->ota_begun) {
+        obj->ota_begun = false;
+        ret = esp_ota_end(obj->ota);
+        if (ret == ESP_OK) {
+            ret = esp_ota_set_boot_partition(obj->partition);
+        }
+    }
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Firmware of %"PRIu32" bytes written to partition %s", obj->written, obj->partition->label);
+    } else {
+        ESP_LOGE(TAG, "Firmware update failed: %s", esp_err_to_name(ret));
+        dfu_set_error(obj, DFU_STATUS_ERR_VERIFY);
+    }
+    dfu_ota_abort(obj);
+    tud_dfu_finish_flashing(obj->status);
+    if (obj->complete_cb) {
+        obj->complete_cb(ret, obj->ctx);
+    }
+}
+
+static bool dfu_can_erase_ahead(const dfu_obj_t *obj)
+{
+    return obj->ota_begun && obj->status == DFU_STATUS_OK &&
+           obj->erased < MIN(obj->written + DFU_ERASE_AHEAD, obj->partition->size);
+}
+
+static void dfu_task(void *arg)
+{
+    dfu_obj_t *obj = (dfu_obj_t *)arg;
+    dfu_job_t job;
+    while (true) {
+        // Erase the next sector whenever there is no block to write
+        if (xQueueReceive(obj->job_queue, &job, dfu_can_erase_ahead(obj) ? 0 : portMAX_DELAY) != pdTRUE) {
+            dfu_erase_next(obj);
+            continue;
+        }
+        if (job.type == DFU_JOB_STOP) {
+            break;
+        }
+        switch (job.type) {
+        case DFU_JOB_WRITE:
+            dfu_write(obj, &job);
+            dfu_release_buf(obj, job.buf);
+            break;
+        case DFU_JOB_MANIFEST:
+            dfu_manifest(obj);
+            break;
+        case DFU_JOB_ABORT:
+            dfu_ota_abort(obj);
+            break;
+        default:
+            break;
+        }
+    }
+    dfu_ota_abort(obj);
+    xSemaphoreGive(obj->task_exit);
+    vTaskDelete(NULL);
+}
+
+/*********************************************************************** TinyUSB DFU callbacks */
+uint32_t tud_dfu_get_timeout_cb(uint8_t alt, uint8_t state)
+{
+    (void) alt;
+    switch (state) {
+    case DFU_DNBUSY:
+        return DFU_POLL_DNBUSY_MS;
+    case DFU_MANIFEST:
+        return DFU_POLL_MANIFEST_MS;
+    default:
+        return 0;
+    }
+}
+
+void tud_dfu_download_cb(uint8_t alt, uint16_t block_num, uint8_t const *data, uint16_t length)
+{
+    (void) alt;
+    dfu_obj_t *obj = s_dfu;
+    if (obj == NULL) {
+        tud_dfu_finish_flashing(DFU_STATUS_ERR_TARGET);
+        return;
+    }
+    if (block_num == 0) {
+        obj->rx_offset = 0;
+        obj->status = DFU_STATUS_OK;
+    }
+    const uint32_t offset = obj->rx_offset;
+    obj->rx_offset += length;
+    if (obj->status != DFU_STATUS_OK) {
+        tud_dfu_finish_flashing(obj->status);
+        return;
+    }
+
+    uint8_t *buf = NULL;
+    portENTER_CRITICAL(&s_dfu_lock);
+    if (obj->free_count) {
+        buf = obj->free_bufs[--obj->free_count];
+    } else {
+        // Acknowledged by the DFU task when a buffer is written
+        obj->deferred.buf = (uint8_t *)data;
+        obj->deferred.offset = offset;
+        obj->deferred.len = length;
+    }
+    portEXIT_CRITICAL(&s_dfu_lock);
+
+    if (buf) {
+        memcpy(buf, data, length);
+        dfu_queue_job(obj, DFU_JOB_WRITE, buf, offset, length);
+        tud_dfu_finish_flashing(obj->status);
+    }
+}
+
+void tud_dfu_manifest_cb(uint8_t alt)
+{
+    (void) alt;
+    dfu_obj_t *obj = s_dfu;
+    if (obj == NULL) {
+        tud_dfu_finish_flashing(DFU_STATUS_ERR_TARGET);
+        return;
+    }
+    // Acknowledged by the DFU task after all blocks are written
+    dfu_queue_job(obj, DFU_JOB_MANIFEST, NULL, 0, 0);
+}
+
+void tud_dfu_abort_cb(uint8_t alt)
+{
+    (void) alt;
+    dfu_obj_t *obj = s_dfu;
+    if (obj) {
+        dfu_queue_job(obj, DFU_JOB_ABORT, NULL, 0, 0);
+    }
+}
+/*********************************************************************** TinyUSB DFU callbacks */
+
+esp_err_t tinyusb_dfu_init(const tinyusb_config_dfu_t *cfg)
+{
+    esp_err_t ret;
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "Invalid configuration");
+    ESP_RETURN_ON_FALSE(s_dfu == NULL, ESP_ERR_INVALID_STATE, TAG, "DFU already initialized");
+    const esp_partition_t *partition = cfg->partition ? cfg->partition : esp_ota_get_next_update_partition(NULL);
+    ESP_RETURN_ON_FALSE(partition, ESP_ERR_NOT_FOUND, TAG, "No OTA partition");
+    ESP_RETURN_ON_FALSE(partition->type == ESP_PARTITION_TYPE_APP, ESP_ERR_INVALID_ARG, TAG, "Not an app partition");
+
+    dfu_obj_t *obj = calloc(1, sizeof(dfu_obj_t));
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_NO_MEM, TAG, "Failed to allocate DFU object");
+    obj->partition = partition;
+    obj->complete_cb = cfg->complete_callback;
+    obj->ctx = cfg->user_context;
+    obj->status = DFU_STATUS_OK;
+    obj->bufs = malloc(DFU_BUF_COUNT * DFU_BLOCK_SIZE);
+    obj->job_queue = xQueueCreate(DFU_BUF_COUNT + 2, sizeof(dfu_job_t));
+    obj->task_exit = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(obj->bufs && obj->job_queue && obj->task_exit, ESP_ERR_NO_MEM, fail, TAG, "Failed to allocate DFU buffers");
+    for (int i = 0; i < DFU_BUF_COUNT; i++) {
+        obj->free_bufs[i] = obj->bufs + i * DFU_BLOCK_SIZE;
+    }
+    obj->free_count = DFU_BUF_COUNT;
+    ESP_GOTO_ON_FALSE(xTaskCreate(dfu_task, "tusb_dfu", DFU_TASK_STACK_SIZE, obj,
+                                  CONFIG_TINYUSB_DFU_OTA_TASK_PRIORITY, &obj->task) == pdPASS,
+                      ESP_ERR_NO_MEM, fail, TAG, "Failed to create DFU task");
+
+    portENTER_CRITICAL(&s_dfu_lock);
+    s_dfu = obj;
+    portEXIT_CRITICAL(&s_dfu_lock);
+    ESP_LOGD(TAG, "Firmware will be written to partition %s", partition->label);
+    return ESP_OK;
+
+fail:
+    if (obj->task_exit) {
+        vSemaphoreDelete(obj->task_exit);
+    }
+    if (obj->job_queue) {
+        vQueueDelete(obj->job_queue);
+    }
+    free(obj->bufs);
+    free(obj);
+    return ret;
+}
+
+esp_err_t tinyusb_dfu_deinit(void)
+{
+    ESP_RETURN_ON_FALSE(s_dfu, ESP_ERR_INVALID_STATE, TAG, "DFU not initialized");
+    portENTER_CRITICAL(&s_dfu_lock);
+    dfu_obj_t *obj = s_dfu;
+    s_dfu = NULL;
+    portEXIT_CRITICAL(&s_dfu_lock);
+
+    dfu_queue_job(obj, DFU_JOB_STOP, NULL, 0, 0);
+    xSemaphoreTake(obj->task_exit, portMAX_DELAY);
+    vSemaphoreDelete(obj->task_exit);
+    vQueueDelete(obj->job_queue);
+    free(obj->bufs);
+    free(obj);
+    return ESP_OK;
+}
@@ -0,0 +1,229 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_hid.h"
+
+static const char *TAG = "tusb_hid";
+
+#define HID_QUEUE_SIZE_DEFAULT      8
+
+_Static_assert(CONFIG_TINYUSB_HID_COUNT <= TINYUSB_HID_MAX, "More HID interfaces than tinyusb_hid_itf_t");
+
+typedef struct {
+    uint8_t report_id;
+    uint16_t len;
+} report_entry_t;
+
+typedef struct {
+    tinyusb_hid_itf_t itf;
+    tinyusb_hid_report_sent_cb_t sent_cb;
+    void *ctx;
+    // Queue of reports, the head is the next one to send
+    report_entry_t *entries;
+    uint8_t *data;              // Report data, report_size_max bytes per entry
+    uint16_t report_size_max;
+    uint8_t queue_size;
+    uint8_t head;
+    uint8_t count;
+    bool busy;                  // Report submitted to TinyUSB, waiting for the Host to read it
+    uint8_t busy_id;            // Report ID of the submitted report
+    bool kick_pending;          // hid_kick() is deferred to TinyUSB task
+} hid_obj_t;
+
+static hid_obj_t *s_hid[TINYUSB_HID_MAX];
+static portMUX_TYPE s_hid_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static hid_obj_t *hid_get(tinyusb_hid_itf_t itf)
+{
+    return (itf < TINYUSB_HID_MAX) ? s_hid[itf] : NULL;
+}
+
+/**
+ * @brief Submit the head of the queue, if no report is in flight. Runs in TinyUSB task
+ *
+ * TinyUSB copies the report to its endpoint buffer, so the entry is released right away.
+ */
+static void hid_send_next(hid_obj_t *obj)
+{
+    portENTER_CRITICAL(&s_hid_lock);
+    if (obj->busy || obj->count == 0) {
+        portEXIT_CRITICAL(&s_hid_lock);
+        return;
+    }
+    const report_entry_t entry = obj->entries[obj->head];
+    const uint8_t *data = obj->data + obj->head * obj->report_size_max;
+    obj->busy = true;
+    obj->busy_id = entry.report_id;
+    portEXIT_CRITICAL(&s_hid_lock);
+
+    const bool submitted = tud_hid_n_report(obj->itf, entry.report_id, data, entry.len);
+
+    portENTER_CRITICAL(&s_hid_lock);
+    if (submitted) {
+        obj->head = (obj->head + 1) % obj->queue_size;
+        obj->count--;
+    } else {
+        // Endpoint not ready, the report is sent by the next hid_kick()
+        obj->busy = false;
+    }
+    portEXIT_CRITICAL(&s_hid_lock);
+}
+
+/**
+ * @brief Start sending after a report was queued. Runs in TinyUSB task
+ */
+static void hid_kick(void *param)
+{
+    portENTER_CRITICAL(&s_hid_lock);
+    hid_obj_t *obj = hid_get((tinyusb_hid_itf_t)(uintptr_t)param);
+    if (obj) {
+        obj->kick_pending = false;
+    }
+    portEXIT_CRITICAL(&s_hid_lock);
+    if (obj == NULL) {
+        return;
+    }
+
+    if (!tud_mounted()) {
+        portENTER_CRITICAL(&s_hid_lock);
+        obj->count = 0;
+        obj->busy = false;
+        portEXIT_CRITICAL(&s_hid_lock);
+        return;
+    }
+    // In TinyUSB task, a free endpoint means the completion was processed already.
+    // If the report is still marked busy, it was lost by bus reset.
+    if (obj->busy && tud_hid_n_ready(obj->itf)) {
+        portENTER_CRITICAL(&s_hid_lock);
+        obj->busy = false;
+        portEXIT_CRITICAL(&s_hid_lock);
+    }
+    hid_send_next(obj);
+}
+
+/*********************************************************************** TinyUSB HID callbacks */
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    (void) report;
+    (void) len;
+    hid_obj_t *obj = hid_get((tinyusb_hid_itf_t)instance);
+    if (obj == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_hid_lock);
+    const bool queued = obj->busy;  // Reports sent with tud_hid_report() are not reported
+    const uint8_t report_id = obj->busy_id;
+    obj->busy = false;
+    portEXIT_CRITICAL(&s_hid_lock);
+    if (!queued) {
+        return;
+    }
+
+    // Submit the next report before the application is notified, so that it is read at the next poll
+    hid_send_next(obj);
+    if (obj->sent_cb) {
+        obj->sent_cb(obj->itf, report_id, obj->ctx);
+    }
+}
+/*********************************************************************** TinyUSB HID callbacks */
+
+static void hid_obj_free(hid_obj_t *obj)
+{
+    free(obj->entries);
+    free(obj->data);
+    free(obj);
+}
+
+esp_err_t tinyusb_hid_init(const tinyusb_config_hid_t *cfg)
+{
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+    ESP_RETURN_ON_FALSE(cfg->itf < CONFIG_TINYUSB_HID_COUNT, ESP_ERR_INVALID_ARG, TAG, "Interface not enabled in menuconfig");
+    ESP_RETURN_ON_FALSE(s_hid[cfg->itf] == NULL, ESP_ERR_INVALID_STATE, TAG, "Interface already initialized");
+
+    const uint8_t queue_size = cfg->queue_size ? cfg->queue_size : HID_QUEUE_SIZE_DEFAULT;
+    const uint16_t report_size_max = cfg->report_size_max ? cfg->report_size_max : CFG_TUD_HID_EP_BUFSIZE - 1;
+    // TinyUSB prepends the Report ID in its endpoint buffer
+    ESP_RETURN_ON_FALSE(report_size_max < CFG_TUD_HID_EP_BUFSIZE, ESP_ERR_INVALID_ARG, TAG,
+                        "Report size must be less than %d", CFG_TUD_HID_EP_BUFSIZE);
+
+    hid_obj_t *obj = calloc(1, sizeof(hid_obj_t));
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_NO_MEM, TAG, "HID object allocation error");
+    obj->entries = calloc(queue_size, sizeof(report_entry_t));
+    obj->data = malloc(queue_size * report_size_max);
+    if (obj->entries == NULL || obj->data == NULL) {
+        hid_obj_free(obj);
+        ESP_LOGE(TAG, "HID queue allocation error");
+        return ESP_ERR_NO_MEM;
+    }
+    obj->itf = cfg->itf;
+    obj->sent_cb = cfg->report_sent_callback;
+    obj->ctx = cfg->user_context;
+    obj->queue_size = queue_size;
+    obj->report_size_max = report_size_max;
+
+    portENTER_CRITICAL(&s_hid_lock);
+    s_hid[cfg->itf] = obj;
+    portEXIT_CRITICAL(&s_hid_lock);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_hid_deinit(tinyusb_hid_itf_t itf)
+{
+    hid_obj_t *obj = hid_get(itf);
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    portENTER_CRITICAL(&s_hid_lock);
+    s_hid[itf] = NULL;
+    portEXIT_CRITICAL(&s_hid_lock);
+    hid_obj_free(obj);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_hid_report_queue(tinyusb_hid_itf_t itf, uint8_t report_id, const void *report, uint16_t len)
+{
+    hid_obj_t *obj = hid_get(itf);
+    ESP_RETURN_ON_FALSE(obj && (report || len == 0), ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(len <= obj->report_size_max, ESP_ERR_INVALID_ARG, TAG, "Report too long");
+    ESP_RETURN_ON_FALSE(tud_mounted(), ESP_ERR_INVALID_STATE, TAG, "Device not configured");
+
+    esp_err_t ret = ESP_OK;
+    bool kick = false;
+    portENTER_CRITICAL(&s_hid_lock);
+    if (obj->count == obj->queue_size) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        const uint8_t idx = (obj->head + obj->count) % obj->queue_size;
+        obj->entries[idx].report_id = report_id;
+        obj->entries[idx].len = len;
+        if (len) {
+            memcpy(obj->data + idx * obj->report_size_max, report, len);
+        }
+        obj->count++;
+        // One deferred call at a time, the rest of the queue is sent from the completion callback
+        kick = !obj->kick_pending;
+        obj->kick_pending = true;
+    }
+    portEXIT_CRITICAL(&s_hid_lock);
+
+    if (kick) {
+        usbd_defer_func(hid_kick, (void *)(uintptr_t)itf, false);
+    }
+    return ret;
+}
+
+size_t tinyusb_hid_report_queued(tinyusb_hid_itf_t itf)
+{
+    hid_obj_t *obj = hid_get(itf);
+    return obj ? obj->count : 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_midi.h"
+
+static const char *TAG = "tusb_midi";
+
+#define MIDI_TX_POLL_PERIOD_US      1000    // One frame, the TX FIFO is checked while there are unconfirmed packets
+
+_Static_assert(sizeof(tinyusb_midi_packet_t) == 4, "USB MIDI Event Packet has 4 bytes");
+_Static_assert(CONFIG_TINYUSB_MIDI_COUNT <= TINYUSB_MIDI_MAX, "More MIDI interfaces than tinyusb_midi_itf_t");
+
+typedef struct {
+    uint8_t ep_in;                  // IN endpoint found in the configuration descriptor, 0 if not known yet
+    size_t tx_pending;              // Packets written to the FIFO and not reported as sent yet
+    SemaphoreHandle_t tx_drained;   // Given when the FIFO was sent, for the writer waiting for space
+} midi_itf_t;
+
+typedef struct {
+    tinyusb_midi_rx_cb_t rx_cb;
+    tinyusb_midi_tx_done_cb_t tx_done_cb;
+    void *ctx;
+    esp_timer_handle_t tx_timer;
+    bool tx_timer_armed;            // The timer is armed or its check is deferred to TinyUSB task
+    midi_itf_t itf[CONFIG_TINYUSB_MIDI_COUNT];
+} midi_obj_t;
+
+static midi_obj_t *s_midi;
+static portMUX_TYPE s_midi_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Find IN endpoint of the n-th MIDI Streaming interface in the configuration descriptor
+ */
+static uint8_t midi_find_ep_in(uint8_t idx)
+{
+    const tusb_desc_configuration_t *desc_cfg = (const tusb_desc_configuration_t *)tud_descriptor_configuration_cb(0);
+    if (desc_cfg == NULL) {
+        return 0;
+    }
+    const uint8_t *p_desc = (const uint8_t *)desc_cfg;
+    const uint8_t *desc_end = p_desc + tu_le16toh(desc_cfg->wTotalLength);
+    int midi_itf = -1;
+    bool in_midi = false;
+    while (p_desc < desc_end) {
+        if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE) {
+            const tusb_desc_interface_t *desc_itf = (const tusb_desc_interface_t *)p_desc;
+            in_midi = desc_itf->bInterfaceClass == TUSB_CLASS_AUDIO &&
+                      desc_itf->bInterfaceSubClass == AUDIO_SUBCLASS_MIDI_STREAMING &&
+                      desc_itf->bAlternateSetting == 0;
+            if (in_midi) {
+                midi_itf++;
+            }
+        } else if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT && in_midi && midi_itf == idx) {
+            const tusb_desc_endpoint_t *desc_ep = (const tusb_desc_endpoint_t *)p_desc;
+            if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+                return desc_ep->bEndpointAddress;
+            }
+        }
+        p_desc = tu_desc_next(p_desc);
+    }
+    return 0;
+}
+
+/**
+ * @brief Check whether the TX FIFO was sent, runs in TinyUSB task
+ *
+ * The FIFO is sent from TinyUSB task when the IN transfer completes, or by the writer when the endpoint is free.
+ * In TinyUSB task, the endpoint can be claimed only when it is not busy and not being started by the writer,
+ * so the packets written before are sent.
+ */
+static void midi_tx_check(void *param)
+{
+    (void) param;
+    size_t done[CONFIG_TINYUSB_MIDI_COUNT] = { 0 };
+
+    for (int i = 0; i < CONFIG_TINYUSB_MIDI_COUNT; i++) {
+        portENTER_CRITICAL(&s_midi_lock);
+        midi_itf_t *itf = s_midi ? &s_midi->itf[i] : NULL;
+        const bool pending = itf && itf->tx_pending;
+        portEXIT_CRITICAL(&s_midi_lock);
+        if (!pending) {
+            continue;
+        }
+        if (itf->ep_in == 0) {
+            itf->ep_in = midi_find_ep_in(i);
+        }
+        bool sent = !tud_midi_n_mounted(i);     // FIFO is cleared on bus reset
+        if (!sent && itf->ep_in && usbd_edpt_claim(TUD_OPT_RHPORT, itf->ep_in)) {
+            usbd_edpt_release(TUD_OPT_RHPORT, itf->ep_in);
+            sent = true;
+        }
+        if (sent) {
+            portENTER_CRITICAL(&s_midi_lock);
+            done[i] = itf->tx_pending;
+            itf->tx_pending = 0;
+            portEXIT_CRITICAL(&s_midi_lock);
+            xSemaphoreGive(itf->tx_drained);
+        }
+    }
+
+    bool rearm = false;
+    portENTER_CRITICAL(&s_midi_lock);
+    if (s_midi) {
+        for (int i = 0; i < CONFIG_TINYUSB_MIDI_COUNT; i++) {
+            rearm |= s_midi->itf[i].tx_pending > 0;
+        }
+        s_midi->tx_timer_armed = rearm;
+    }
+    portEXIT_CRITICAL(&s_midi_lock);
+    if (rearm) {
+        esp_timer_start_once(s_midi->tx_timer, MIDI_TX_POLL_PERIOD_US);
+    }
+
+    for (int i = 0; i < CONFIG_TINYUSB_MIDI_COUNT; i++) {
+        if (done[i] && s_midi->tx_done_cb) {
+            s_midi->tx_done_cb((tinyusb_midi_itf_t)i, done[i], s_midi->ctx);
+        }
+    }
+}
+
+static void midi_tx_timer_cb(void *arg)
+{
+    (void) arg;
+    usbd_defer_func(midi_tx_check, NULL, false);
+}
+
+/*********************************************************************** TinyUSB MIDI callbacks */
+void tud_midi_rx_cb(uint8_t itf)
+{
+    if (s_midi && s_midi->rx_cb) {
+        s_midi->rx_cb((tinyusb_midi_itf_t)itf, s_midi->ctx);
+    }
+}
+/*********************************************************************** TinyUSB MIDI callbacks */
+
+static void midi_obj_free(midi_obj_t *obj)
+{
+    if (obj->tx_timer) {
+        esp_timer_stop(obj->tx_timer);
+        esp_timer_delete(obj->tx_timer);
+    }
+    for (int i = 0; i < CONFIG_TINYUSB_MIDI_COUNT; i++) {
+        if (obj->itf[i].tx_drained) {
+            vSemaphoreDelete(obj->itf[i].tx_drained);
+        }
+    }
+    free(obj);
+}
+
+esp_err_t tinyusb_midi_init(const tinyusb_config_midi_t *cfg)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+    ESP_RETURN_ON_FALSE(s_midi == NULL, ESP_ERR_INVALID_STATE, TAG, "MIDI driver already initialized");
+
+    midi_obj_t *obj = calloc(1, sizeof(midi_obj_t));
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_NO_MEM, TAG, "MIDI object allocation error");
+    for (int i = 0; i < CONFIG_TINYUSB_MIDI_COUNT; i++) {
+        obj->itf[i].tx_drained = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(obj->itf[i].tx_drained, ESP_ERR_NO_MEM, fail, TAG, "Semaphore creation error");
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = midi_tx_timer_cb,
+        .name = "tusb_midi_tx",
+    };
+    ESP_GOTO_ON_ERROR(esp_timer_create(&timer_args, &obj->tx_timer), fail, TAG, "TX timer creation error");
+    obj->rx_cb = cfg->rx_callback;
+    obj->tx_done_cb = cfg->tx_done_callback;
+    obj->ctx = cfg->user_context;
+
+    portENTER_CRITICAL(&s_midi_lock);
+    s_midi = obj;
+    portEXIT_CRITICAL(&s_midi_lock);
+    return ESP_OK;
+
+fail:
+    midi_obj_free(obj);
+    return ret;
+}
+
+esp_err_t tinyusb_midi_deinit(void)
+{
+    ESP_RETURN_ON_FALSE(s_midi, ESP_ERR_INVALID_STATE, TAG, "MIDI driver not initialized");
+
+    portENTER_CRITICAL(&s_midi_lock);
+    midi_obj_t *obj = s_midi;
+    s_midi = NULL;
+    portEXIT_CRITICAL(&s_midi_lock);
+    midi_obj_free(obj);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_midi_read_packets(tinyusb_midi_itf_t itf, tinyusb_midi_packet_t *packets, size_t max_count, size_t *count)
+{
+    ESP_RETURN_ON_FALSE(itf < CONFIG_TINYUSB_MIDI_COUNT && packets && count, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(s_midi, ESP_ERR_INVALID_STATE, TAG, "MIDI driver not initialized");
+
+    size_t n = 0;
+    while (n < max_count && tud_midi_n_packet_read(itf, (uint8_t *)&packets[n])) {
+        n++;
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_midi_write_packets(tinyusb_midi_itf_t itf, const tinyusb_midi_packet_t *packets, size_t count, size_t *written,
+                                     uint32_t timeout_ticks)
+{
+    ESP_RETURN_ON_FALSE(itf < CONFIG_TINYUSB_MIDI_COUNT && packets, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(s_midi, ESP_ERR_INVALID_STATE, TAG, "MIDI driver not initialized");
+    midi_itf_t *midi_itf = &s_midi->itf[itf];
+
+    esp_err_t ret = ESP_OK;
+    size_t n = 0;
+    const TickType_t start_tick = xTaskGetTickCount();
+    while (n < count) {
+        if (!tud_midi_n_mounted(itf)) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        size_t batch = 0;
+        while (n + batch < count && tud_midi_n_packet_write(itf, (const uint8_t *)&packets[n + batch])) {
+            batch++;
+        }
+        n += batch;
+
+        bool arm = false;
+        portENTER_CRITICAL(&s_midi_lock);
+        midi_itf->tx_pending += batch;
+        if (midi_itf->tx_pending && !s_midi->tx_timer_armed) {
+            s_midi->tx_timer_armed = true;
+            arm = true;
+        }
+        portEXIT_CRITICAL(&s_midi_lock);
+        if (arm) {
+            esp_timer_start_once(s_midi->tx_timer, MIDI_TX_POLL_PERIOD_US);
+        }
+
+        if (n == count) {
+            break;
+        }
+        // FIFO is full, wait until it is sent
+        const TickType_t elapsed = xTaskGetTickCount() - start_tick;
+        if (elapsed >= timeout_ticks || !xSemaphoreTake(midi_itf->tx_drained, timeout_ticks - elapsed)) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+    }
+    if (written) {
+        *written = n;
+    }
+    return ret;
+}
@@ -3,8 +3,12 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "tinyusb_net.h"
 #include "descriptors_control.h"
 #include "usb_descriptors.h"
@@ -12,58 +16,175 @@
 #include "esp_check.h"
 
 #define MAC_ADDR_LEN 6
+#define TX_POOL_SIZE_DEFAULT 16
+#define TX_POOL_WORDS(size) (((size) + 31) / 32)
 
 typedef struct packet {
     void *buffer;
     void *buff_free_arg;
     uint16_t len;
     esp_err_t result;
+    SemaphoreHandle_t done;     // Completion of sync send, NULL for async send
+    _Atomic int state;          // Ownership of sync send, see packet_state_t
+    struct packet *next;        // Next packet in the TX queue
 } packet_t;
 
+typedef enum {
+    PACKET_PENDING = 0,         // Queued, the sender waits for completion
+    PACKET_TAKEN,               // TinyUSB task handles it, the sender must wait for completion
+    PACKET_CANCELLED,           // The sender timed out, TinyUSB task releases it
+} packet_state_t;
+
+typedef struct {
+    packet_t *packets;
+    _Atomic uint32_t *used;     // Bitmap of allocated packets, bits beyond size are always set
+    uint16_t size;
+} packet_pool_t;
+
 struct tinyusb_net_handle {
     bool initialized;
-    SemaphoreHandle_t buffer_sema;
-    EventGroupHandle_t  tx_flags;
     tusb_net_rx_cb_t    rx_cb;
     tusb_net_free_tx_cb_t tx_buff_free_cb;
+    tusb_net_tx_copy_cb_t tx_copy_cb;
+    bool rx_hold;               // rx_cb takes ownership of the buffer until tinyusb_net_recv_renew()
     tusb_net_init_cb_t init_cb;
     char mac_str[2 * MAC_ADDR_LEN + 1];
     void *ctx;
-    packet_t *packet_to_send;
+    packet_pool_t tx_pool;      // Packets of sync and async send
+    packet_t *tx_head;          // Packets waiting for the endpoint, accessed only from TinyUSB task
+    packet_t *tx_tail;
+    TimerHandle_t tx_timer;     // Retries the TX queue when no other TinyUSB event does
+#if CONFIG_TINYUSB_NET_RX_TASK
+    QueueHandle_t rx_queue;     // Received packet passed to the RX task, TinyUSB holds it until renewed
+    TaskHandle_t rx_task;
+#endif // CONFIG_TINYUSB_NET_RX_TASK
 };
 
-const static int TX_FINISHED_BIT = BIT0;
+typedef struct {
+    const uint8_t *src;
+    uint16_t size;
+} rx_packet_t;
+
 static struct tinyusb_net_handle s_net_obj = { };
 static const char *TAG = "tusb_net";
 
-static void do_send_sync(void *ctx)
+static esp_err_t packet_pool_init(packet_pool_t *pool, uint16_t size)
 {
-    (void) ctx;
-    if (xSemaphoreTake(s_net_obj.buffer_sema, 0) != pdTRUE || s_net_obj.packet_to_send == NULL) {
-        return;
+    const int words = TX_POOL_WORDS(size);
+    pool->packets = calloc(size, sizeof(packet_t));
+    pool->used = calloc(words, sizeof(uint32_t));
+    if (pool->packets == NULL || pool->used == NULL) {
+        free(pool->packets);
+        free(pool->used);
+        pool->packets = NULL;
+        pool->used = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    if (size % 32) {
+        atomic_init(&pool->used[words - 1], ~((1UL << (size % 32)) - 1));
+    }
+    pool->size = size;
+    return ESP_OK;
+}
+
+/**
+ * @brief Take a free packet from the pool, lock-free and safe to call from any task
+ *
+ * @return packet or NULL if all packets are in use
+ */
+static packet_t *packet_alloc(packet_pool_t *pool)
+{
+    for (int w = 0; w < TX_POOL_WORDS(pool->size); w++) {
+        uint32_t used = atomic_load(&pool->used[w]);
+        while (~used) {
+            const int bit = __builtin_ctz(~used);
+            if (atomic_compare_exchange_weak(&pool->used[w], &used, used | (1UL << bit))) {
+                return &pool->packets[w * 32 + bit];
+            }
+        }
     }
+    return NULL;
+}
 
-    packet_t *packet = s_net_obj.packet_to_send;
-    if (tud_network_can_xmit(packet->len)) {
-        tud_network_xmit(packet, packet->len);
-        packet->result = ESP_OK;
-    } else {
-        packet->result = ESP_FAIL;
+static void packet_free(packet_pool_t *pool, packet_t *packet)
+{
+    const int idx = packet - pool->packets;
+    atomic_fetch_and(&pool->used[idx / 32], ~(1UL << (idx % 32)));
+}
+
+/**
+ * @brief Pass queued packets to TinyUSB while it can accept them
+ *
+ * Called from TinyUSB task on each async send and each received packet, which keeps
+ * the queue moving under bidirectional traffic. The timer covers the rest.
+ */
+static void tx_queue_drain(void)
+{
+    packet_t *packet;
+    while ((packet = s_net_obj.tx_head) != NULL) {
+        const bool ready = tud_ready();
+        if (ready && !tud_network_can_xmit(packet->len)) {
+            break; // Endpoint is busy, keep the order
+        }
+        s_net_obj.tx_head = packet->next;
+
+        if (packet->done) { // Sync send, claim the packet unless the sender gave up
+            int expected = PACKET_PENDING;
+            if (!atomic_compare_exchange_strong(&packet->state, &expected, PACKET_TAKEN)) {
+                packet_free(&s_net_obj.tx_pool, packet);
+                continue;
+            }
+        }
+
+        esp_err_t result = ESP_OK;
+        if (ready) {
+            tud_network_xmit(packet, packet->len);
+        } else {
+            ESP_LOGW(TAG, "USB interface is not ready, dropping queued packet");
+            result = ESP_ERR_INVALID_STATE;
+        }
+
+        if (packet->done) { // The sender releases the packet
+            packet->result = result;
+            xSemaphoreGive(packet->done);
+        } else {
+            if (result != ESP_OK && s_net_obj.tx_buff_free_cb) {
+                s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
+            }
+            packet_free(&s_net_obj.tx_pool, packet);
+        }
+    }
+
+    if (s_net_obj.tx_head == NULL) {
+        s_net_obj.tx_tail = NULL;
+    } else if (xTimerIsTimerActive(s_net_obj.tx_timer) == pdFALSE) {
+        xTimerStart(s_net_obj.tx_timer, 0);
     }
-    xSemaphoreGive(s_net_obj.buffer_sema);
-    xEventGroupSetBits(s_net_obj.tx_flags, TX_FINISHED_BIT);
 }
 
-static void do_send_async(void *ctx)
+static void do_tx_queue_drain(void *ctx)
+{
+    (void) ctx;
+    tx_queue_drain();
+}
+
+static void tx_timer_cb(TimerHandle_t timer)
+{
+    (void) timer;
+    usbd_defer_func(do_tx_queue_drain, NULL, false);
+}
+
+static void do_send(void *ctx)
 {
     packet_t *packet = ctx;
-    if (tud_network_can_xmit(packet->len)) {
-        tud_network_xmit(packet, packet->len);
-    } else if (s_net_obj.tx_buff_free_cb) {
-        ESP_LOGW(TAG, "Packet cannot be accepted on USB interface, dropping");
-        s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
+    packet->next = NULL;
+    if (s_net_obj.tx_tail) {
+        s_net_obj.tx_tail->next = packet;
+    } else {
+        s_net_obj.tx_head = packet;
     }
-    free(packet);
+    s_net_obj.tx_tail = packet;
+    tx_queue_drain();
 }
 
 esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg)
@@ -72,12 +193,15 @@ esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg
         return ESP_ERR_INVALID_STATE;
     }
 
-    packet_t *packet = calloc(1, sizeof(packet_t));
+    packet_t *packet = packet_alloc(&s_net_obj.tx_pool);
+    if (packet == NULL) {
+        return ESP_ERR_NO_MEM; // Back-pressure, all packets are in flight
+    }
     packet->len = len;
     packet->buffer = buffer;
     packet->buff_free_arg = buff_free_arg;
-    ESP_RETURN_ON_FALSE(packet, ESP_ERR_NO_MEM, TAG, "Failed to allocate packet to send");
-    usbd_defer_func(do_send_async, packet, false);
+    packet->done = NULL;
+    usbd_defer_func(do_send, packet, false);
     return ESP_OK;
 }
 
@@ -87,47 +211,84 @@ esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg,
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Lazy init the flags and semaphores, as they might not be needed (if async approach is used)
-    if (!s_net_obj.tx_flags) {
-        s_net_obj.tx_flags = xEventGroupCreate();
-        ESP_RETURN_ON_FALSE(s_net_obj.tx_flags, ESP_ERR_NO_MEM, TAG, "Failed to allocate event flags");
+    packet_t *packet = packet_alloc(&s_net_obj.tx_pool);
+    if (packet == NULL) {
+        return ESP_ERR_NO_MEM;
     }
-    if (!s_net_obj.buffer_sema) {
-        s_net_obj.buffer_sema = xSemaphoreCreateBinary();
-        ESP_RETURN_ON_FALSE(s_net_obj.buffer_sema, ESP_ERR_NO_MEM, TAG, "Failed to allocate buffer semaphore");
+    // Completion object of this call, each sender waits only for its own packet
+    StaticSemaphore_t done_buffer;
+    packet->len = len;
+    packet->buffer = buffer;
+    packet->buff_free_arg = buff_free_arg;
+    packet->done = xSemaphoreCreateBinaryStatic(&done_buffer);
+    atomic_store(&packet->state, PACKET_PENDING);
+
+    // to execute the send function in tinyUSB task context
+    usbd_defer_func(do_send, packet, false);
+
+    if (xSemaphoreTake(packet->done, timeout) != pdTRUE) {
+        int expected = PACKET_PENDING;
+        if (atomic_compare_exchange_strong(&packet->state, &expected, PACKET_CANCELLED)) {
+            return ESP_ERR_TIMEOUT; // TinyUSB task drops the packet and releases it
+        }
+        xSemaphoreTake(packet->done, portMAX_DELAY);   // if tusb sending already started, we have wait before ditching the packet
     }
+    const esp_err_t ret = packet->result;
+    packet_free(&s_net_obj.tx_pool, packet);
+    return ret;
+}
 
-    packet_t packet = {
-        .buffer = buffer,
-        .len = len,
-        .buff_free_arg = buff_free_arg
-    };
-    s_net_obj.packet_to_send = &packet;
-    xSemaphoreGive(s_net_obj.buffer_sema);  // now the packet is ready, let's mark it available to tusb send
+static void do_recv_renew(void *ctx)
+{
+    (void) ctx;
+    tud_network_recv_renew();
+}
 
-    // to execute the send function in tinyUSB task context
-    usbd_defer_func(do_send_sync, NULL, false);  // arg=NULL -> sync send, we keep the packet inside the object
+esp_err_t tinyusb_net_recv_renew(void)
+{
+    ESP_RETURN_ON_FALSE(s_net_obj.rx_hold, ESP_ERR_INVALID_STATE, TAG, "RX buffer is not held by the application");
+    usbd_defer_func(do_recv_renew, NULL, false);
+    return ESP_OK;
+}
 
-    // wait wor completion with defined timeout
-    EventBits_t bits = xEventGroupWaitBits(s_net_obj.tx_flags, TX_FINISHED_BIT, pdTRUE, pdTRUE, timeout);
-    xSemaphoreTake(s_net_obj.buffer_sema, portMAX_DELAY);   // if tusb sending already started, we have wait before ditching the packet
-    s_net_obj.packet_to_send = NULL;        // invalidate the argument
-    if (bits & TX_FINISHED_BIT) {   // If transaction finished, return error code
-        return packet.result;
+#if CONFIG_TINYUSB_NET_RX_TASK
+static void rx_task(void *arg)
+{
+    (void) arg;
+    rx_packet_t packet;
+    while (1) {
+        xQueueReceive(s_net_obj.rx_queue, &packet, portMAX_DELAY);
+        s_net_obj.rx_cb((void *)packet.src, packet.size, s_net_obj.ctx);
+        if (!s_net_obj.rx_hold) {
+            usbd_defer_func(do_recv_renew, NULL, false);
+        }
     }
-    return ESP_ERR_TIMEOUT;
 }
+#endif // CONFIG_TINYUSB_NET_RX_TASK
 
 esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t *cfg)
 {
     (void) usb_dev;
 
     ESP_RETURN_ON_FALSE(s_net_obj.initialized == false, ESP_ERR_INVALID_STATE, TAG, "TinyUSB Net class is already initialized");
+    ESP_RETURN_ON_ERROR(packet_pool_init(&s_net_obj.tx_pool, cfg->tx_queue_size ? cfg->tx_queue_size : TX_POOL_SIZE_DEFAULT),
+                        TAG, "Failed to allocate TX packet pool");
+    s_net_obj.tx_timer = xTimerCreate("tusb_net_tx", 1, pdFALSE, NULL, tx_timer_cb);
+    ESP_RETURN_ON_FALSE(s_net_obj.tx_timer, ESP_ERR_NO_MEM, TAG, "Failed to create TX timer");
+#if CONFIG_TINYUSB_NET_RX_TASK
+    s_net_obj.rx_queue = xQueueCreate(1, sizeof(rx_packet_t));
+    ESP_RETURN_ON_FALSE(s_net_obj.rx_queue, ESP_ERR_NO_MEM, TAG, "Failed to create RX queue");
+    xTaskCreatePinnedToCore(rx_task, "tusb_net_rx", CONFIG_TINYUSB_NET_RX_TASK_STACK_SIZE, NULL,
+                            CONFIG_TINYUSB_NET_RX_TASK_PRIORITY, &s_net_obj.rx_task, CONFIG_TINYUSB_NET_RX_TASK_AFFINITY);
+    ESP_RETURN_ON_FALSE(s_net_obj.rx_task, ESP_ERR_NO_MEM, TAG, "Failed to create RX task");
+#endif // CONFIG_TINYUSB_NET_RX_TASK
 
     // the semaphore and event flags are initialized only if needed
     s_net_obj.rx_cb = cfg->on_recv_callback;
     s_net_obj.init_cb = cfg->on_init_callback;
     s_net_obj.tx_buff_free_cb = cfg->free_tx_buffer;
+    s_net_obj.tx_copy_cb = cfg->copy_tx_buffer;
+    s_net_obj.rx_hold = cfg->hold_rx_buffer;
     s_net_obj.ctx = cfg->user_context;
 
     const uint8_t *mac = &cfg->mac_addr[0];
@@ -148,9 +309,24 @@ esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t
 bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
 {
     if (s_net_obj.rx_cb) {
+#if CONFIG_TINYUSB_NET_RX_TASK
+        // RX task renews the buffer after the callback, the next datagram is delivered after that
+        const rx_packet_t packet = {
+            .src = src,
+            .size = size,
+        };
+        xQueueSend(s_net_obj.rx_queue, &packet, portMAX_DELAY);
+        tx_queue_drain();
+        return true;
+#else
         s_net_obj.rx_cb((void *)src, size, s_net_obj.ctx);
+#endif // CONFIG_TINYUSB_NET_RX_TASK
     }
-    tud_network_recv_renew();
+    // Held buffer is released with tinyusb_net_recv_renew(), the next datagram is delivered after that
+    if (!s_net_obj.rx_hold || !s_net_obj.rx_cb) {
+        tud_network_recv_renew();
+    }
+    tx_queue_drain();
     return true;
 }
 
@@ -159,7 +335,12 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
     packet_t *packet = ref;
     uint16_t len = arg;
 
-    memcpy(dst, packet->buffer, packet->len);
+    // Copy straight into the USB frame, with NCM several packets end up in one transfer
+    if (s_net_obj.tx_copy_cb) {
+        s_net_obj.tx_copy_cb(dst, packet->buffer, packet->len, s_net_obj.ctx);
+    } else {
+        memcpy(dst, packet->buffer, packet->len);
+    }
     if (s_net_obj.tx_buff_free_cb) {
         s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
     }
@@ -0,0 +1,362 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+#include "tinyusb_uac.h"
+
+static const char *TAG = "tusb_uac";
+
+#define UAC_SAMPLE_RATE_DEFAULT     48000
+#define UAC_SPK_FRAME_BYTES         (TUSB_UAC_BYTES_PER_SAMPLE * CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS)
+#define UAC_MIC_FRAME_BYTES         (TUSB_UAC_BYTES_PER_SAMPLE * CONFIG_TINYUSB_UAC_MIC_CHANNELS)
+
+// Feedback PI controller on the speaker buffer level error in ms, independent of the buffer length and sample rate.
+// Settles within about 10 s, well damped. Clock drift of crystals is much less than the limit.
+#define UAC_FB_KP_PPM_PER_MS        250.0f
+#define UAC_FB_KI_PPM_PER_MS_S      25.0f
+#define UAC_FB_PPM_MAX              1000.0f
+#define UAC_FB_LEVEL_FILTER_S       0.25f   // The level jumps by USB packets and application reads
+
+static const uint32_t s_uac_sample_rates[] = {
+    48000,
+#if CONFIG_TINYUSB_UAC_96K
+    96000,
+#endif
+};
+
+typedef struct {
+    tinyusb_uac_rate_cb_t rate_cb;
+    tinyusb_uac_stream_cb_t stream_cb;
+    void *ctx;
+    tinyusb_uac_stats_t stats;
+    bool spk_active;            // The Host selected speaker streaming alternate setting
+    bool spk_primed;            // The buffer reached the target level, playback runs
+    bool mic_active;
+    size_t spk_target;          // Target level of the speaker buffer in bytes
+    float fb_level_ms;          // Filtered level of the speaker buffer
+    float fb_integ_ppm;         // Integral part of the feedback correction
+    int64_t fb_last_us;
+} uac_obj_t;
+
+static uac_obj_t *s_uac;
+static uint32_t s_uac_sample_rate = UAC_SAMPLE_RATE_DEFAULT;   // Answered to the Host also before init
+static portMUX_TYPE s_uac_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+/**
+ * @brief Set feedback value with rate correction
+ *
+ * Feedback is number of samples per (micro)frame in 16.16 format, TinyUSB converts it to 10.14 format at Full-speed
+ */
+static void uac_feedback_set(uint32_t sample_rate, float ppm)
+{
+    const uint32_t frames_per_s = (tud_speed_get() == TUSB_SPEED_HIGH) ? 8000 : 1000;
+    const float samples_per_frame = (float)sample_rate / frames_per_s * (1.0f + ppm * 1e-6f);
+    tud_audio_fb_set((uint32_t)(samples_per_frame * 65536.0f));
+}
+
+/**
+ * @brief Restart speaker buffering and feedback at the nominal rate. Call with the lock taken
+ */
+static void uac_speaker_reset(uac_obj_t *obj)
+{
+    obj->spk_primed = false;
+    obj->spk_target = CONFIG_TINYUSB_UAC_BUFFER_MS * (s_uac_sample_rate / 1000) * UAC_SPK_FRAME_BYTES / 2;
+    obj->fb_level_ms = CONFIG_TINYUSB_UAC_BUFFER_MS / 2.0f;
+    obj->fb_integ_ppm = 0;
+    obj->fb_last_us = 0;
+    obj->stats.feedback_ppm = 0;
+}
+
+/**
+ * @brief Update feedback from the speaker buffer level
+ *
+ * The application reads at the rate of its I2S clock, so the level drifts by the difference between the Host and I2S clocks.
+ * The level is the mean of the levels before and after the read, so the buffer has the same margin for both directions
+ * regardless of the size of the reads.
+ */
+static void uac_feedback_update(uac_obj_t *obj, size_t level)
+{
+    const int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_uac_lock);
+    const float dt = obj->fb_last_us ? MIN((now - obj->fb_last_us) * 1e-6f, 0.1f) : 0;
+    obj->fb_last_us = now;
+    const float bytes_per_ms = (float)(s_uac_sample_rate / 1000) * UAC_SPK_FRAME_BYTES;
+    obj->fb_level_ms += (level / bytes_per_ms - obj->fb_level_ms) * dt / (UAC_FB_LEVEL_FILTER_S + dt);
+    const float err_ms = obj->spk_target / bytes_per_ms - obj->fb_level_ms;  // Positive when the Host shall send more
+    obj->fb_integ_ppm += UAC_FB_KI_PPM_PER_MS_S * err_ms * dt;
+    obj->fb_integ_ppm = MAX(MIN(obj->fb_integ_ppm, UAC_FB_PPM_MAX), -UAC_FB_PPM_MAX);
+    float ppm = UAC_FB_KP_PPM_PER_MS * err_ms + obj->fb_integ_ppm;
+    ppm = MAX(MIN(ppm, UAC_FB_PPM_MAX), -UAC_FB_PPM_MAX);
+    obj->stats.feedback_ppm = (int32_t)ppm;
+    const uint32_t sample_rate = s_uac_sample_rate;
+    portEXIT_CRITICAL(&s_uac_lock);
+
+    uac_feedback_set(sample_rate, ppm);
+}
+#endif // CONFIG_TINYUSB_UAC_SPEAKER
+
+static void uac_stream_changed(uac_obj_t *obj, tinyusb_uac_stream_t stream, bool active)
+{
+    portENTER_CRITICAL(&s_uac_lock);
+    if (stream == TINYUSB_UAC_STREAM_SPEAKER) {
+        obj->spk_active = active;
+#if CONFIG_TINYUSB_UAC_SPEAKER
+        uac_speaker_reset(obj);
+#endif
+    } else {
+        obj->mic_active = active;
+    }
+    portEXIT_CRITICAL(&s_uac_lock);
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    if (stream == TINYUSB_UAC_STREAM_SPEAKER && active) {
+        tud_audio_clear_ep_out_ff();
+        uac_feedback_set(s_uac_sample_rate, 0);
+    }
+#endif
+    if (obj->stream_cb) {
+        obj->stream_cb(stream, active, obj->ctx);
+    }
+}
+
+/**
+ * @brief Map interface number to stream of the configuration descriptor generated from Kconfig
+ */
+static bool uac_stream_from_itf(uint8_t itf, tinyusb_uac_stream_t *stream)
+{
+    if (itf == tusb_get_uac_speaker_itf()) {
+        *stream = TINYUSB_UAC_STREAM_SPEAKER;
+    } else if (itf == tusb_get_uac_mic_itf()) {
+        *stream = TINYUSB_UAC_STREAM_MIC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*********************************************************************** TinyUSB Audio callbacks */
+bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_request)
+{
+    uac_obj_t *obj = s_uac;
+    tinyusb_uac_stream_t stream;
+    if (obj && uac_stream_from_itf(TU_U16_LOW(p_request->wIndex), &stream)) {
+        uac_stream_changed(obj, stream, TU_U16_LOW(p_request->wValue) != 0);
+    }
+    return true;
+}
+
+bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const *p_request)
+{
+    uac_obj_t *obj = s_uac;
+    tinyusb_uac_stream_t stream;
+    if (obj && uac_stream_from_itf(TU_U16_LOW(p_request->wIndex), &stream)) {
+        uac_stream_changed(obj, stream, false);
+    }
+    return true;
+}
+
+bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p_request)
+{
+    const uint8_t ctrl_sel = TU_U16_HIGH(p_request->wValue);
+    // Clock source is the only entity with controls
+    if (ctrl_sel == AUDIO_CS_CTRL_SAM_FREQ && p_request->bRequest == AUDIO_CS_REQ_CUR) {
+        audio_control_cur_4_t cur = { .bCur = tu_htole32(s_uac_sample_rate) };
+        return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &cur, sizeof(cur));
+    }
+    if (ctrl_sel == AUDIO_CS_CTRL_SAM_FREQ && p_request->bRequest == AUDIO_CS_REQ_RANGE) {
+        audio_control_range_4_n_t(TU_ARRAY_SIZE(s_uac_sample_rates)) range = {
+            .wNumSubRanges = tu_htole16(TU_ARRAY_SIZE(s_uac_sample_rates)),
+        };
+        for (int i = 0; i < TU_ARRAY_SIZE(s_uac_sample_rates); i++) {
+            range.subrange[i].bMin = tu_htole32(s_uac_sample_rates[i]);
+            range.subrange[i].bMax = tu_htole32(s_uac_sample_rates[i]);
+            range.subrange[i].bRes = 0;
+        }
+        return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &range, sizeof(range));
+    }
+    if (ctrl_sel == AUDIO_CS_CTRL_CLK_VALID && p_request->bRequest == AUDIO_CS_REQ_CUR) {
+        audio_control_cur_1_t cur = { .bCur = 1 };
+        return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &cur, sizeof(cur));
+    }
+    ESP_LOGD(TAG, "Unsupported GET request, control selector %d", ctrl_sel);
+    return false;
+}
+
+bool tud_audio_set_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p_request, uint8_t *pBuff)
+{
+    const uint8_t ctrl_sel = TU_U16_HIGH(p_request->wValue);
+    if (ctrl_sel != AUDIO_CS_CTRL_SAM_FREQ || p_request->bRequest != AUDIO_CS_REQ_CUR || p_request->wLength != sizeof(audio_control_cur_4_t)) {
+        ESP_LOGD(TAG, "Unsupported SET request, control selector %d", ctrl_sel);
+        return false;
+    }
+
+    const uint32_t sample_rate = tu_le32toh(((audio_control_cur_4_t const *)pBuff)->bCur);
+    bool supported = false;
+    for (int i = 0; i < TU_ARRAY_SIZE(s_uac_sample_rates); i++) {
+        supported |= (sample_rate == s_uac_sample_rates[i]);
+    }
+    if (!supported) {
+        ESP_LOGW(TAG, "Unsupported sample rate %"PRIu32" Hz", sample_rate);
+        return false;
+    }
+
+    uac_obj_t *obj = s_uac;
+    portENTER_CRITICAL(&s_uac_lock);
+    s_uac_sample_rate = sample_rate;
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    if (obj) {
+        uac_speaker_reset(obj);
+    }
+#endif
+    portEXIT_CRITICAL(&s_uac_lock);
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    uac_feedback_set(sample_rate, 0);
+#endif
+    if (obj && obj->rate_cb) {
+        obj->rate_cb(sample_rate, obj->ctx);
+    }
+    return true;
+}
+/*********************************************************************** TinyUSB Audio callbacks */
+
+esp_err_t tinyusb_uac_init(const tinyusb_config_uac_t *cfg)
+{
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+    ESP_RETURN_ON_FALSE(s_uac == NULL, ESP_ERR_INVALID_STATE, TAG, "UAC already initialized");
+
+    uac_obj_t *obj = calloc(1, sizeof(uac_obj_t));
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_NO_MEM, TAG, "UAC object allocation error");
+    obj->rate_cb = cfg->rate_callback;
+    obj->stream_cb = cfg->stream_callback;
+    obj->ctx = cfg->user_context;
+
+    portENTER_CRITICAL(&s_uac_lock);
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    uac_speaker_reset(obj);
+#endif
+    s_uac = obj;
+    portEXIT_CRITICAL(&s_uac_lock);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_uac_deinit(void)
+{
+    uac_obj_t *obj = s_uac;
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "UAC not initialized");
+
+    portENTER_CRITICAL(&s_uac_lock);
+    s_uac = NULL;
+    portEXIT_CRITICAL(&s_uac_lock);
+    free(obj);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_uac_speaker_read(void *buf, size_t len)
+{
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    uac_obj_t *obj = s_uac;
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "UAC not initialized");
+    ESP_RETURN_ON_FALSE(buf && len % UAC_SPK_FRAME_BYTES == 0, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    size_t read = 0;
+    portENTER_CRITICAL(&s_uac_lock);
+    const bool active = obj->spk_active;
+    bool primed = obj->spk_primed;
+    const size_t target = obj->spk_target;
+    portEXIT_CRITICAL(&s_uac_lock);
+
+    if (active) {
+        size_t level = tud_audio_available();
+        const size_t level_before = level;
+        if (!primed && level >= MIN(target + len / 2, CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ)) {
+            primed = true;
+        }
+        if (primed) {
+            while (read < len && level >= UAC_SPK_FRAME_BYTES) {
+                const size_t chunk = MIN(MIN(len - read, level), UINT16_MAX) / UAC_SPK_FRAME_BYTES * UAC_SPK_FRAME_BYTES;
+                read += tud_audio_read((uint8_t *)buf + read, chunk);
+                level = tud_audio_available();
+            }
+        }
+
+        portENTER_CRITICAL(&s_uac_lock);
+        if (obj->spk_active) {
+            // Start over with buffering to avoid repeated underruns
+            obj->spk_primed = primed && read == len;
+            if (primed && read < len) {
+                obj->stats.speaker_underruns++;
+            }
+        }
+        portEXIT_CRITICAL(&s_uac_lock);
+        if (primed) {
+            uac_feedback_update(obj, (level_before + level) / 2);
+        }
+    }
+    memset((uint8_t *)buf + read, 0, len - read);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif // CONFIG_TINYUSB_UAC_SPEAKER
+}
+
+esp_err_t tinyusb_uac_mic_write(const void *buf, size_t len)
+{
+#if CONFIG_TINYUSB_UAC_MIC
+    uac_obj_t *obj = s_uac;
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "UAC not initialized");
+    ESP_RETURN_ON_FALSE(buf && len % UAC_MIC_FRAME_BYTES == 0, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    if (!obj->mic_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t written = 0;
+    while (written < len) {
+        const size_t chunk = MIN(len - written, UINT16_MAX) / UAC_MIC_FRAME_BYTES * UAC_MIC_FRAME_BYTES;
+        const size_t n = tud_audio_write((const uint8_t *)buf + written, chunk);
+        written += n;
+        if (n < chunk) {
+            break;
+        }
+    }
+    if (written < len) {
+        portENTER_CRITICAL(&s_uac_lock);
+        obj->stats.mic_overruns++;
+        portEXIT_CRITICAL(&s_uac_lock);
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif // CONFIG_TINYUSB_UAC_MIC
+}
+
+uint32_t tinyusb_uac_get_sample_rate(void)
+{
+    return s_uac_sample_rate;
+}
+
+esp_err_t tinyusb_uac_get_stats(tinyusb_uac_stats_t *stats)
+{
+    uac_obj_t *obj = s_uac;
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "UAC not initialized");
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Stats can't be NULL");
+
+    portENTER_CRITICAL(&s_uac_lock);
+    *stats = obj->stats;
+    stats->sample_rate = s_uac_sample_rate;
+    portEXIT_CRITICAL(&s_uac_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,189 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "tusb.h"
+#include "tinyusb_uvc.h"
+
+static const char *TAG = "tusb_uvc";
+
+#define UVC_CTL_IDX 0
+#define UVC_STM_IDX 0
+
+typedef struct {
+    const uint8_t *buf;         // NULL if there is no frame
+    size_t len;
+    void *frame_ctx;
+} uvc_frame_t;
+
+typedef struct {
+    tinyusb_uvc_frame_done_cb_t frame_done_cb;
+    tinyusb_uvc_start_cb_t start_cb;
+    void *ctx;
+    // Double buffered frame handoff: TinyUSB sends `sending` while the application fills the next frame
+    uvc_frame_t sending;
+    uvc_frame_t pending;        // Next frame, started when `sending` completes
+} uvc_obj_t;
+
+static uvc_obj_t *s_uvc;
+static portMUX_TYPE s_uvc_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void uvc_frame_done(uvc_obj_t *obj, const uvc_frame_t *frame, bool sent)
+{
+    if (frame->buf && obj->frame_done_cb) {
+        obj->frame_done_cb(frame->buf, frame->frame_ctx, sent, obj->ctx);
+    }
+}
+
+/**
+ * @brief Return held frames as not sent. Only call when TinyUSB doesn't use the `sending` frame
+ */
+static void uvc_reclaim(uvc_obj_t *obj)
+{
+    portENTER_CRITICAL(&s_uvc_lock);
+    const uvc_frame_t sending = obj->sending;
+    const uvc_frame_t pending = obj->pending;
+    memset(&obj->sending, 0, sizeof(uvc_frame_t));
+    memset(&obj->pending, 0, sizeof(uvc_frame_t));
+    portEXIT_CRITICAL(&s_uvc_lock);
+
+    uvc_frame_done(obj, &sending, false);
+    uvc_frame_done(obj, &pending, false);
+}
+
+/**
+ * @brief Start transfer of the `sending` frame
+ *
+ * @return false if streaming stopped in the meantime
+ */
+static bool uvc_start(const uvc_frame_t *frame)
+{
+    if (!tud_video_n_frame_xfer(UVC_CTL_IDX, UVC_STM_IDX, (void *)frame->buf, frame->len)) {
+        ESP_LOGD(TAG, "Frame transfer not started");
+        return false;
+    }
+    return true;
+}
+
+/*********************************************************************** TinyUSB Video callbacks */
+void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
+{
+    uvc_obj_t *obj = s_uvc;
+    if (obj == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_uvc_lock);
+    const uvc_frame_t done = obj->sending;
+    const uvc_frame_t next = obj->pending;
+    obj->sending = next;
+    memset(&obj->pending, 0, sizeof(uvc_frame_t));
+    portEXIT_CRITICAL(&s_uvc_lock);
+
+    // Start the next frame before returning this one, so the Host doesn't wait for the application
+    if (next.buf && !uvc_start(&next)) {
+        uvc_reclaim(obj);
+    }
+    uvc_frame_done(obj, &done, true);
+}
+
+int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, video_probe_and_commit_control_t const *parameters)
+{
+    uvc_obj_t *obj = s_uvc;
+    if (obj == NULL) {
+        return VIDEO_ERROR_NONE;
+    }
+
+    // Frames left from previous streaming, which stopped without transfer completion
+    if (!tud_video_n_streaming(ctl_idx, stm_idx)) {
+        uvc_reclaim(obj);
+    }
+    if (obj->start_cb) {
+        obj->start_cb(obj->ctx);
+    }
+    return VIDEO_ERROR_NONE;
+}
+/*********************************************************************** TinyUSB Video callbacks */
+
+esp_err_t tinyusb_uvc_init(const tinyusb_config_uvc_t *cfg)
+{
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+    ESP_RETURN_ON_FALSE(s_uvc == NULL, ESP_ERR_INVALID_STATE, TAG, "UVC already initialized");
+
+    uvc_obj_t *obj = calloc(1, sizeof(uvc_obj_t));
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_NO_MEM, TAG, "UVC object allocation error");
+    obj->frame_done_cb = cfg->frame_done_callback;
+    obj->start_cb = cfg->start_callback;
+    obj->ctx = cfg->user_context;
+
+    portENTER_CRITICAL(&s_uvc_lock);
+    s_uvc = obj;
+    portEXIT_CRITICAL(&s_uvc_lock);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_uvc_deinit(void)
+{
+    uvc_obj_t *obj = s_uvc;
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "UVC not initialized");
+
+    portENTER_CRITICAL(&s_uvc_lock);
+    s_uvc = NULL;
+    portEXIT_CRITICAL(&s_uvc_lock);
+    uvc_reclaim(obj);
+    free(obj);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_uvc_submit_frame(const uint8_t *buf, size_t len, void *frame_ctx)
+{
+    uvc_obj_t *obj = s_uvc;
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "UVC not initialized");
+    ESP_RETURN_ON_FALSE(buf && len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    if (!tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX)) {
+        // The transfer of the held frame was aborted, TinyUSB doesn't use it anymore
+        uvc_reclaim(obj);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uvc_frame_t frame = {
+        .buf = buf,
+        .len = len,
+        .frame_ctx = frame_ctx,
+    };
+    uvc_frame_t dropped = {0};
+    bool start = false;
+    portENTER_CRITICAL(&s_uvc_lock);
+    if (obj->sending.buf == NULL) {
+        obj->sending = frame;
+        start = true;
+    } else {
+        dropped = obj->pending;
+        obj->pending = frame;
+    }
+    portEXIT_CRITICAL(&s_uvc_lock);
+
+    if (start && !uvc_start(&frame)) {
+        // The frame stays with the caller, return only a frame submitted by another task in the meantime
+        portENTER_CRITICAL(&s_uvc_lock);
+        memset(&obj->sending, 0, sizeof(uvc_frame_t));
+        portEXIT_CRITICAL(&s_uvc_lock);
+        uvc_reclaim(obj);
+        return ESP_ERR_INVALID_STATE;
+    }
+    uvc_frame_done(obj, &dropped, false);
+    return ESP_OK;
+}
+
+bool tinyusb_uvc_streaming(void)
+{
+    return s_uvc && tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX);
+}
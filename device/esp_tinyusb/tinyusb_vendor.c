@@ -0,0 +1,424 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "usb/usb_dma_buf.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_vendor.h"
+
+static const char *TAG = "tusb_vendor";
+
+#define VENDOR_RX_CHUNK_SIZE_DEFAULT    2048
+#define VENDOR_RX_CHUNK_COUNT_DEFAULT   2
+#define VENDOR_TX_QUEUE_SIZE_DEFAULT    4
+#define VENDOR_XFER_MAX                 32768   // Multiple of the HS packet size fitting the 16-bit length of usbd_edpt_xfer()
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+} tx_entry_t;
+
+typedef struct {
+    tinyusb_vendor_itf_t itf;
+    tinyusb_vendor_rx_cb_t rx_cb;
+    tinyusb_vendor_tx_done_cb_t tx_done_cb;
+    void *ctx;
+    bool opened;                // The Host configured the interface, endpoints are opened
+    uint8_t rhport;
+    uint8_t ep_in;
+    uint8_t ep_out;
+    uint16_t ep_in_mps;
+    // RX ring of chunks, full chunks are rx_read .. rx_read + rx_full - 1, the next one is filled by the Host
+    uint8_t *rx_buf;
+    uint32_t *rx_len;           // Received bytes of each full chunk
+    size_t rx_chunk_size;
+    uint8_t rx_chunk_count;
+    uint8_t rx_read;            // Oldest full chunk
+    uint8_t rx_full;            // Number of full chunks
+    size_t rx_pos;              // Consumed bytes of the oldest full chunk
+    bool rx_busy;               // OUT transfer in progress
+    // TX queue of submitted buffers, the head is being sent
+    tx_entry_t *tx_queue;
+    uint8_t tx_queue_size;
+    uint8_t tx_head;
+    uint8_t tx_count;
+    size_t tx_sent;             // Sent bytes of the head buffer
+    bool tx_busy;               // IN transfer in progress
+    bool tx_zlp;                // Zero length packet of the head buffer in progress
+} vendor_obj_t;
+
+static vendor_obj_t *s_vendor[TINYUSB_VENDOR_MAX];
+static uint8_t s_vendor_opened_count;   // Vendor specific interfaces offered to the driver since the last reset
+static portMUX_TYPE s_vendor_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static vendor_obj_t *vendor_get(tinyusb_vendor_itf_t itf)
+{
+    return (itf < TINYUSB_VENDOR_MAX) ? s_vendor[itf] : NULL;
+}
+
+/**
+ * @brief Start OUT transfer into the next chunk of the ring, if it is free and no transfer is in progress
+ */
+static void rx_start(vendor_obj_t *obj)
+{
+    uint8_t *buf = NULL;
+    portENTER_CRITICAL(&s_vendor_lock);
+    if (obj->opened && !obj->rx_busy && obj->rx_full < obj->rx_chunk_count) {
+        const uint8_t idx = (obj->rx_read + obj->rx_full) % obj->rx_chunk_count;
+        buf = obj->rx_buf + idx * obj->rx_chunk_size;
+        obj->rx_busy = true;
+    }
+    portEXIT_CRITICAL(&s_vendor_lock);
+
+    if (buf && !usbd_edpt_xfer(obj->rhport, obj->ep_out, buf, obj->rx_chunk_size)) {
+        ESP_LOGE(TAG, "OUT transfer on itf %d failed", obj->itf);
+        portENTER_CRITICAL(&s_vendor_lock);
+        obj->rx_busy = false;
+        portEXIT_CRITICAL(&s_vendor_lock);
+    }
+}
+
+static void rx_complete(vendor_obj_t *obj, uint32_t xferred_bytes)
+{
+    portENTER_CRITICAL(&s_vendor_lock);
+    obj->rx_busy = false;
+    if (xferred_bytes) {
+        obj->rx_len[(obj->rx_read + obj->rx_full) % obj->rx_chunk_count] = xferred_bytes;
+        obj->rx_full++;
+    }
+    portEXIT_CRITICAL(&s_vendor_lock);
+
+    // Give the next chunk to the Host before the application processes this one
+    rx_start(obj);
+    if (xferred_bytes && obj->rx_cb) {
+        obj->rx_cb(obj->itf, obj->ctx);
+    }
+}
+
+/**
+ * @brief Start IN transfer of the next segment of the head buffer, or its zero length packet
+ */
+static void tx_start(vendor_obj_t *obj)
+{
+    portENTER_CRITICAL(&s_vendor_lock);
+    const tx_entry_t entry = obj->tx_queue[obj->tx_head];
+    const size_t offset = obj->tx_sent;
+    const bool zlp = obj->tx_zlp;
+    portEXIT_CRITICAL(&s_vendor_lock);
+
+    const uint16_t len = zlp ? 0 : MIN(entry.len - offset, VENDOR_XFER_MAX);
+    if (!usbd_edpt_xfer(obj->rhport, obj->ep_in, zlp ? NULL : (uint8_t *)entry.buf + offset, len)) {
+        ESP_LOGE(TAG, "IN transfer on itf %d failed", obj->itf);
+    }
+}
+
+static void tx_complete(vendor_obj_t *obj, uint32_t xferred_bytes)
+{
+    tx_entry_t done = { 0 };
+    size_t done_sent = 0;
+    bool complete = false;
+
+    portENTER_CRITICAL(&s_vendor_lock);
+    const tx_entry_t *head = &obj->tx_queue[obj->tx_head];
+    if (obj->tx_zlp) {
+        obj->tx_zlp = false;
+        complete = true;
+    } else {
+        obj->tx_sent += xferred_bytes;
+        if (obj->tx_sent >= head->len) {
+            // The Host needs a short packet to see the end of a transfer of full packets
+            obj->tx_zlp = (head->len % obj->ep_in_mps) == 0;
+            complete = !obj->tx_zlp;
+        }
+    }
+    if (complete) {
+        done = *head;
+        done_sent = obj->tx_sent;
+        obj->tx_sent = 0;
+        obj->tx_head = (obj->tx_head + 1) % obj->tx_queue_size;
+        obj->tx_count--;
+        obj->tx_busy = obj->tx_count > 0;
+    }
+    const bool next = obj->tx_busy;
+    portEXIT_CRITICAL(&s_vendor_lock);
+
+    if (next) {
+        tx_start(obj);
+    }
+    if (complete && obj->tx_done_cb) {
+        obj->tx_done_cb(obj->itf, done.buf, done_sent, obj->ctx);
+    }
+}
+
+/**
+ * @brief Close the interface, return pending TX buffers to the application
+ */
+static void vendor_close(vendor_obj_t *obj)
+{
+    portENTER_CRITICAL(&s_vendor_lock);
+    obj->opened = false;
+    obj->rx_busy = false;
+    obj->tx_busy = false;
+    obj->tx_zlp = false;
+    portEXIT_CRITICAL(&s_vendor_lock);
+
+    while (obj->tx_count) {
+        const tx_entry_t entry = obj->tx_queue[obj->tx_head];
+        const size_t sent = obj->tx_sent;
+        obj->tx_sent = 0;
+        obj->tx_head = (obj->tx_head + 1) % obj->tx_queue_size;
+        obj->tx_count--;
+        if (obj->tx_done_cb) {
+            obj->tx_done_cb(obj->itf, entry.buf, sent, obj->ctx);
+        }
+    }
+}
+
+/* TinyUSB application class driver
+   ********************************************************************* */
+static void vendor_drv_init(void)
+{
+}
+
+static void vendor_drv_reset(uint8_t rhport)
+{
+    (void) rhport;
+    s_vendor_opened_count = 0;
+    for (int i = 0; i < TINYUSB_VENDOR_MAX; i++) {
+        if (s_vendor[i] && s_vendor[i]->opened) {
+            vendor_close(s_vendor[i]);
+        }
+    }
+}
+
+static uint16_t vendor_drv_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16_t max_len)
+{
+    if (desc_itf->bInterfaceClass != TUSB_CLASS_VENDOR_SPECIFIC) {
+        return 0;
+    }
+    // Interfaces not initialized by the application are left to TinyUSB Vendor class
+    const uint8_t idx = s_vendor_opened_count++;
+    vendor_obj_t *obj = vendor_get(idx);
+    if (obj == NULL || desc_itf->bNumEndpoints != 2) {
+        return 0;
+    }
+
+    uint8_t const *p_desc = tu_desc_next(desc_itf);
+    uint8_t const *desc_end = ((uint8_t const *) desc_itf) + max_len;
+    uint16_t drv_len = sizeof(tusb_desc_interface_t);
+    while (p_desc < desc_end && tu_desc_type(p_desc) != TUSB_DESC_ENDPOINT) {
+        drv_len += tu_desc_len(p_desc);
+        p_desc = tu_desc_next(p_desc);
+    }
+    TU_ASSERT(p_desc < desc_end, 0);
+    TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &obj->ep_out, &obj->ep_in), 0);
+    for (int i = 0; i < 2; i++) {
+        tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+        if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+            obj->ep_in_mps = tu_edpt_packet_size(desc_ep);
+        }
+        drv_len += tu_desc_len(p_desc);
+        p_desc = tu_desc_next(p_desc);
+    }
+
+    obj->rhport = rhport;
+    portENTER_CRITICAL(&s_vendor_lock);
+    obj->opened = true;
+    portEXIT_CRITICAL(&s_vendor_lock);
+    ESP_LOGD(TAG, "itf %d opened, IN 0x%02x, OUT 0x%02x", obj->itf, obj->ep_in, obj->ep_out);
+    rx_start(obj);
+    return drv_len;
+}
+
+static bool vendor_drv_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request)
+{
+    // Vendor requests are passed to tud_vendor_control_xfer_cb() by TinyUSB, other requests are not supported
+    (void) rhport;
+    (void) stage;
+    (void) request;
+    return false;
+}
+
+static bool vendor_drv_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+    (void) rhport;
+    for (int i = 0; i < TINYUSB_VENDOR_MAX; i++) {
+        vendor_obj_t *obj = s_vendor[i];
+        if (obj == NULL || !obj->opened) {
+            continue;
+        }
+        if (ep_addr == obj->ep_out) {
+            rx_complete(obj, result == XFER_RESULT_SUCCESS ? xferred_bytes : 0);
+            return true;
+        }
+        if (ep_addr == obj->ep_in) {
+            tx_complete(obj, xferred_bytes);
+            return true;
+        }
+    }
+    return false;
+}
+
+static const usbd_class_driver_t s_vendor_driver = {
+#if CFG_TUSB_DEBUG >= 2
+    .name = "ESP_VENDOR",
+#endif
+    .init = vendor_drv_init,
+    .reset = vendor_drv_reset,
+    .open = vendor_drv_open,
+    .control_xfer_cb = vendor_drv_control_xfer_cb,
+    .xfer_cb = vendor_drv_xfer_cb,
+    .sof = NULL,
+};
+
+usbd_class_driver_t const *usbd_app_driver_get_cb(uint8_t *driver_count)
+{
+    *driver_count = 1;
+    return &s_vendor_driver;
+}
+/*********************************************************************** TinyUSB application class driver */
+
+static void vendor_obj_free(vendor_obj_t *obj)
+{
+    usb_dma_buf_free(obj->rx_buf);
+    free(obj->rx_len);
+    free(obj->tx_queue);
+    free(obj);
+}
+
+esp_err_t tinyusb_vendor_init(const tinyusb_config_vendor_t *cfg)
+{
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+    ESP_RETURN_ON_FALSE(cfg->itf < CONFIG_TINYUSB_VENDOR_COUNT, ESP_ERR_INVALID_ARG, TAG, "Interface not enabled in menuconfig");
+    ESP_RETURN_ON_FALSE(s_vendor[cfg->itf] == NULL, ESP_ERR_INVALID_STATE, TAG, "Interface already initialized");
+
+    const size_t chunk_size = cfg->rx_chunk_size ? cfg->rx_chunk_size : VENDOR_RX_CHUNK_SIZE_DEFAULT;
+    const uint8_t chunk_count = cfg->rx_chunk_count ? cfg->rx_chunk_count : VENDOR_RX_CHUNK_COUNT_DEFAULT;
+    const uint8_t tx_queue_size = cfg->tx_queue_size ? cfg->tx_queue_size : VENDOR_TX_QUEUE_SIZE_DEFAULT;
+    ESP_RETURN_ON_FALSE(chunk_size % 512 == 0 && chunk_size <= VENDOR_XFER_MAX, ESP_ERR_INVALID_ARG, TAG,
+                        "RX chunk size must be multiple of 512 up to %d", VENDOR_XFER_MAX);
+    ESP_RETURN_ON_FALSE(chunk_count >= 2, ESP_ERR_INVALID_ARG, TAG, "At least 2 RX chunks are needed");
+
+    vendor_obj_t *obj = calloc(1, sizeof(vendor_obj_t));
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_NO_MEM, TAG, "Vendor object allocation error");
+    obj->rx_buf = usb_dma_buf_alloc(chunk_size * chunk_count, 0);
+    obj->rx_len = calloc(chunk_count, sizeof(uint32_t));
+    obj->tx_queue = calloc(tx_queue_size, sizeof(tx_entry_t));
+    if (obj->rx_buf == NULL || obj->rx_len == NULL || obj->tx_queue == NULL) {
+        vendor_obj_free(obj);
+        ESP_LOGE(TAG, "Vendor buffers allocation error");
+        return ESP_ERR_NO_MEM;
+    }
+    obj->itf = cfg->itf;
+    obj->rx_cb = cfg->rx_callback;
+    obj->tx_done_cb = cfg->tx_done_callback;
+    obj->ctx = cfg->user_context;
+    obj->rx_chunk_size = chunk_size;
+    obj->rx_chunk_count = chunk_count;
+    obj->tx_queue_size = tx_queue_size;
+
+    portENTER_CRITICAL(&s_vendor_lock);
+    s_vendor[cfg->itf] = obj;
+    portEXIT_CRITICAL(&s_vendor_lock);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_vendor_deinit(tinyusb_vendor_itf_t itf)
+{
+    vendor_obj_t *obj = vendor_get(itf);
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    vendor_close(obj);
+    portENTER_CRITICAL(&s_vendor_lock);
+    s_vendor[itf] = NULL;
+    portEXIT_CRITICAL(&s_vendor_lock);
+    vendor_obj_free(obj);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_vendor_rx_peek(tinyusb_vendor_itf_t itf, const uint8_t **data, size_t *len)
+{
+    vendor_obj_t *obj = vendor_get(itf);
+    ESP_RETURN_ON_FALSE(obj && data && len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&s_vendor_lock);
+    if (obj->rx_full) {
+        *data = obj->rx_buf + obj->rx_read * obj->rx_chunk_size + obj->rx_pos;
+        *len = obj->rx_len[obj->rx_read] - obj->rx_pos;
+    } else {
+        *data = NULL;
+        *len = 0;
+    }
+    portEXIT_CRITICAL(&s_vendor_lock);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_vendor_rx_consume(tinyusb_vendor_itf_t itf, size_t len)
+{
+    vendor_obj_t *obj = vendor_get(itf);
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_ARG, TAG, "Interface not initialized");
+
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_vendor_lock);
+    if (len == 0) {
+        // Nothing to release
+    } else if (obj->rx_full == 0 || len > obj->rx_len[obj->rx_read] - obj->rx_pos) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else {
+        obj->rx_pos += len;
+        if (obj->rx_pos == obj->rx_len[obj->rx_read]) {
+            obj->rx_pos = 0;
+            obj->rx_read = (obj->rx_read + 1) % obj->rx_chunk_count;
+            obj->rx_full--;
+        }
+    }
+    portEXIT_CRITICAL(&s_vendor_lock);
+    ESP_RETURN_ON_ERROR(ret, TAG, "Consumed more than peeked");
+
+    // Reception stops when all chunks are full, restart it with the released one
+    rx_start(obj);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_vendor_tx_submit(tinyusb_vendor_itf_t itf, const uint8_t *buf, size_t len)
+{
+    vendor_obj_t *obj = vendor_get(itf);
+    ESP_RETURN_ON_FALSE(obj && buf && len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    esp_err_t ret = ESP_OK;
+    bool start = false;
+    portENTER_CRITICAL(&s_vendor_lock);
+    if (!obj->opened) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (obj->tx_count == obj->tx_queue_size) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        tx_entry_t *entry = &obj->tx_queue[(obj->tx_head + obj->tx_count) % obj->tx_queue_size];
+        entry->buf = buf;
+        entry->len = len;
+        obj->tx_count++;
+        start = !obj->tx_busy;
+        obj->tx_busy = true;
+    }
+    portEXIT_CRITICAL(&s_vendor_lock);
+
+    if (start) {
+        tx_start(obj);
+    }
+    return ret;
+}
+
+bool tinyusb_vendor_connected(tinyusb_vendor_itf_t itf)
+{
+    vendor_obj_t *obj = vendor_get(itf);
+    return obj && obj->opened;
+}
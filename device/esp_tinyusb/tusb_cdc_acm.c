@@ -5,14 +5,20 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "esp_check.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "tusb.h"
+#include "device/usbd_pvt.h"
 #include "tusb_cdc_acm.h"
+#include "tusb_cdc_acm_priv.h"
 #include "cdc.h"
+#include "usb/usb_class_stats.h"
 #include "sdkconfig.h"
 
 #ifndef MIN
@@ -24,11 +30,24 @@ static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
 #define CDC_ACM_ENTER_CRITICAL()   portENTER_CRITICAL(&cdc_acm_lock)
 #define CDC_ACM_EXIT_CRITICAL()    portEXIT_CRITICAL(&cdc_acm_lock)
 
+// RX FIFO holding this many bytes cannot take another packet, TinyUSB stops receiving
+#define CDC_ACM_RX_THRESHOLD_MAX   (CFG_TUD_CDC_RX_BUFSIZE - CFG_TUD_CDC_EP_BUFSIZE)
+
 typedef struct {
     tusb_cdcacm_callback_t callback_rx;
     tusb_cdcacm_callback_t callback_rx_wanted_char;
     tusb_cdcacm_callback_t callback_line_state_changed;
     tusb_cdcacm_callback_t callback_line_coding_changed;
+    tusb_cdcacm_notify_t notify_rx;   /*!< Internal notification of received data */
+    tusb_cdcacm_notify_t notify_tx;   /*!< Internal notification of completed transfer */
+    SemaphoreHandle_t tx_done;        /*!< Given on completed transfer, blocking flush waits on it */
+    uint8_t *rx_buf;                  /*!< Linear RX buffer of the peek/consume API, allocated on first use */
+    size_t rx_pos;                    /*!< Offset of the first not consumed byte in rx_buf */
+    size_t rx_len;                    /*!< Number of valid bytes in rx_buf */
+    usb_class_stats_entry_t *stats;   /*!< Entry in usb_class_stats registry, NULL if not counted */
+    size_t rx_threshold;              /*!< CDC_EVENT_RX is delivered when this many bytes are available */
+    uint32_t rx_idle_timeout_us;      /*!< Bytes below the threshold are delivered after this idle time, 0 to wait for more data */
+    esp_timer_handle_t rx_idle_timer; /*!< Created when the idle timeout is set for the first time */
 } esp_tusb_cdcacm_t; /*!< CDC_ACM object */
 
 static const char *TAG = "tusb_cdc_acm";
@@ -46,6 +65,37 @@ static inline esp_tusb_cdcacm_t *get_acm(tinyusb_cdcacm_itf_t itf)
 /* TinyUSB callbacks
    ********************************************************************* */
 
+static void rx_event_deliver(esp_tusb_cdcacm_t *acm, uint8_t itf, tusb_cdcacm_callback_t cb)
+{
+    cdcacm_event_t event = {
+        .type = CDC_EVENT_RX
+    };
+    USB_CLASS_STATS_CB_ENTER(acm->stats);
+    cb(itf, &event);
+    USB_CLASS_STATS_CB_EXIT(acm->stats);
+}
+
+/* Deferred from the idle timer to TinyUSB task, so CDC_EVENT_RX is always delivered from the same task */
+static void rx_idle_deferred(void *arg)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)arg;
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (acm == NULL) {
+        return;
+    }
+    CDC_ACM_ENTER_CRITICAL();
+    tusb_cdcacm_callback_t cb = acm->callback_rx;
+    CDC_ACM_EXIT_CRITICAL();
+    if (cb && tud_cdc_n_available(itf)) {
+        rx_event_deliver(acm, itf, cb);
+    }
+}
+
+static void rx_idle_timer_cb(void *arg)
+{
+    usbd_defer_func(rx_idle_deferred, arg, false);
+}
+
 /* Invoked by cdc interface when line state changed e.g connected/disconnected */
 void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
 {
@@ -88,12 +138,42 @@ void tud_cdc_rx_cb(uint8_t itf)
     if (acm) {
         CDC_ACM_ENTER_CRITICAL();
         tusb_cdcacm_callback_t cb = acm->callback_rx;
+        tusb_cdcacm_notify_t notify = acm->notify_rx;
+        const size_t threshold = acm->rx_threshold;
+        const uint32_t idle_timeout_us = acm->rx_idle_timeout_us;
         CDC_ACM_EXIT_CRITICAL();
+        if (notify) {
+            notify(itf);
+        }
+        const uint32_t available = tud_cdc_n_available(itf);
+        USB_CLASS_STATS_QUEUE(acm->stats, available);
         if (cb) {
-            cdcacm_event_t event = {
-                .type = CDC_EVENT_RX
-            };
-            cb(itf, &event);
+            const bool due = available >= threshold;
+            if (idle_timeout_us) {
+                // Every packet restarts the idle period
+                esp_timer_stop(acm->rx_idle_timer);
+                if (!due) {
+                    esp_timer_start_once(acm->rx_idle_timer, idle_timeout_us);
+                }
+            }
+            if (due) {
+                rx_event_deliver(acm, itf, cb);
+            }
+        }
+    }
+}
+
+/* Invoked when a transfer to the host is completed */
+void tud_cdc_tx_complete_cb(uint8_t itf)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (acm) {
+        xSemaphoreGive(acm->tx_done);
+        CDC_ACM_ENTER_CRITICAL();
+        tusb_cdcacm_notify_t notify = acm->notify_tx;
+        CDC_ACM_EXIT_CRITICAL();
+        if (notify) {
+            notify(itf);
         }
     }
 }
@@ -210,6 +290,44 @@ esp_err_t tinyusb_cdcacm_unregister_callback(tinyusb_cdcacm_itf_t itf,
     }
 }
 
+esp_err_t tinyusb_cdcacm_set_notify(tinyusb_cdcacm_itf_t itf, tusb_cdcacm_notify_t notify_rx, tusb_cdcacm_notify_t notify_tx)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+    CDC_ACM_ENTER_CRITICAL();
+    acm->notify_rx = notify_rx;
+    acm->notify_tx = notify_tx;
+    CDC_ACM_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_set_rx_notify(tinyusb_cdcacm_itf_t itf, const tinyusb_cdcacm_rx_notify_config_t *config)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+    size_t threshold = 1;
+    uint32_t idle_timeout_us = 0;
+    if (config) {
+        ESP_RETURN_ON_FALSE(config->threshold <= CDC_ACM_RX_THRESHOLD_MAX, ESP_ERR_INVALID_ARG, TAG,
+                            "Threshold must leave space for one packet in RX FIFO");
+        threshold = config->threshold ? config->threshold : CDC_ACM_RX_THRESHOLD_MAX;
+        idle_timeout_us = config->idle_timeout_us;
+    }
+    if (idle_timeout_us && acm->rx_idle_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = rx_idle_timer_cb,
+            .arg = (void *)(uintptr_t)itf,
+            .name = "cdc_rx_idle",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &acm->rx_idle_timer), TAG, "RX idle timer creation error");
+    }
+    CDC_ACM_ENTER_CRITICAL();
+    acm->rx_threshold = threshold;
+    acm->rx_idle_timeout_us = idle_timeout_us;
+    CDC_ACM_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
 /*********************************************************************** TinyUSB callbacks*/
 /* CDC-ACM
    ********************************************************************* */
@@ -219,29 +337,85 @@ esp_err_t tinyusb_cdcacm_read(tinyusb_cdcacm_itf_t itf, uint8_t *out_buf, size_t
     esp_tusb_cdcacm_t *acm = get_acm(itf);
     ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
 
-    if (tud_cdc_n_available(itf) == 0) {
-        *rx_data_size = 0;
+    // Data already taken by `tinyusb_cdcacm_read_peek` go first
+    const size_t staged = MIN(acm->rx_len - acm->rx_pos, out_buf_sz);
+    if (staged) {
+        memcpy(out_buf, acm->rx_buf + acm->rx_pos, staged);
+        acm->rx_pos += staged;
+        out_buf += staged;
+        out_buf_sz -= staged;
+    }
+
+    if (tud_cdc_n_available(itf) == 0 || out_buf_sz == 0) {
+        *rx_data_size = staged;
     } else {
-        *rx_data_size = tud_cdc_n_read(itf, out_buf, out_buf_sz);
+        const uint32_t read = tud_cdc_n_read(itf, out_buf, out_buf_sz);
+        USB_CLASS_STATS_XFER(acm->stats, read, true);
+        *rx_data_size = staged + read;
+    }
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_read_peek(tinyusb_cdcacm_itf_t itf, const uint8_t **data, size_t *data_size)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+    ESP_RETURN_ON_FALSE(data && data_size, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+
+    if (acm->rx_buf == NULL) {
+        acm->rx_buf = malloc(CFG_TUD_CDC_RX_BUFSIZE);
+        ESP_RETURN_ON_FALSE(acm->rx_buf, ESP_ERR_NO_MEM, TAG, "Not enough memory for RX buffer");
+        USB_CLASS_STATS_MEM_ALLOC(acm->stats, CFG_TUD_CDC_RX_BUFSIZE, MALLOC_CAP_DEFAULT);
     }
+
+    // Move the not consumed tail to the beginning, so newly received data follow it
+    if (acm->rx_pos) {
+        acm->rx_len -= acm->rx_pos;
+        memmove(acm->rx_buf, acm->rx_buf + acm->rx_pos, acm->rx_len);
+        acm->rx_pos = 0;
+    }
+    if (acm->rx_len < CFG_TUD_CDC_RX_BUFSIZE && tud_cdc_n_available(itf)) {
+        const uint32_t read = tud_cdc_n_read(itf, acm->rx_buf + acm->rx_len, CFG_TUD_CDC_RX_BUFSIZE - acm->rx_len);
+        USB_CLASS_STATS_XFER(acm->stats, read, true);
+        acm->rx_len += read;
+    }
+
+    *data = acm->rx_buf;
+    *data_size = acm->rx_len;
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_read_consume(tinyusb_cdcacm_itf_t itf, size_t size)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+    ESP_RETURN_ON_FALSE(size <= acm->rx_len - acm->rx_pos, ESP_ERR_INVALID_SIZE, TAG, "Consuming more than peeked");
+
+    acm->rx_pos += size;
     return ESP_OK;
 }
 
 size_t tinyusb_cdcacm_write_queue_char(tinyusb_cdcacm_itf_t itf, char ch)
 {
-    if (!get_acm(itf)) { // non-initialized
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (!acm) { // non-initialized
         return 0;
     }
-    return tud_cdc_n_write_char(itf, ch);
+    const size_t written = tud_cdc_n_write_char(itf, ch);
+    USB_CLASS_STATS_XFER(acm->stats, written, true);
+    return written;
 }
 
 size_t tinyusb_cdcacm_write_queue(tinyusb_cdcacm_itf_t itf, const uint8_t *in_buf, size_t in_size)
 {
-    if (!get_acm(itf)) { // non-initialized
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (!acm) { // non-initialized
         return 0;
     }
     const uint32_t size_available = tud_cdc_n_write_available(itf);
-    return tud_cdc_n_write(itf, in_buf, MIN(in_size, size_available));
+    const size_t written = tud_cdc_n_write(itf, in_buf, MIN(in_size, size_available));
+    USB_CLASS_STATS_XFER(acm->stats, written, true);
+    return written;
 }
 
 static uint32_t tud_cdc_n_write_occupied(tinyusb_cdcacm_itf_t itf)
@@ -251,7 +425,8 @@ static uint32_t tud_cdc_n_write_occupied(tinyusb_cdcacm_itf_t itf)
 
 esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf, uint32_t timeout_ticks)
 {
-    if (!get_acm(itf)) { // non-initialized
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (!acm) { // non-initialized
         return ESP_FAIL;
     }
 
@@ -264,19 +439,21 @@ esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf, uint32_t timeout_
             return ESP_ERR_NOT_FINISHED;
         }
     } else { // trying during the timeout
-        uint32_t ticks_start = xTaskGetTickCount();
-        uint32_t ticks_now = ticks_start;
+        TimeOut_t timeout;
+        TickType_t ticks_to_wait = timeout_ticks;
+        vTaskSetTimeOutState(&timeout);
+        xSemaphoreTake(acm->tx_done, 0); // Drop completion of a transfer started before
         while (1) { // loop until success or until the time runs out
-            ticks_now = xTaskGetTickCount();
             tud_cdc_n_write_flush(itf);
             if (tud_cdc_n_write_occupied(itf) == 0) {
                 break; // All data flushed
             }
-            if ( (ticks_now - ticks_start) > timeout_ticks ) { // Time is up
+            if (xTaskCheckForTimeOut(&timeout, &ticks_to_wait)) { // Time is up
                 ESP_LOGW(TAG, "Flush failed");
                 return ESP_ERR_TIMEOUT;
             }
-            vTaskDelay(1);
+            // Endpoint is busy, the next flush can only succeed after the transfer is completed
+            xSemaphoreTake(acm->tx_done, ticks_to_wait);
         }
     }
     return ESP_OK;
@@ -288,10 +465,23 @@ static esp_err_t alloc_obj(tinyusb_cdcacm_itf_t itf)
     if (cdc_inst == NULL) {
         return ESP_FAIL;
     }
-    cdc_inst->subclass_obj = calloc(1, sizeof(esp_tusb_cdcacm_t));
-    if (cdc_inst->subclass_obj == NULL) {
+    esp_tusb_cdcacm_t *acm = calloc(1, sizeof(esp_tusb_cdcacm_t));
+    if (acm == NULL) {
         return ESP_FAIL;
     }
+    acm->tx_done = xSemaphoreCreateBinary();
+    if (acm->tx_done == NULL) {
+        free(acm);
+        return ESP_FAIL;
+    }
+    acm->rx_threshold = 1; // Every packet is delivered by default
+    const usb_class_stats_info_t stats_info = {
+        .driver = "tusb_cdc",
+        .intf_num = itf,
+    };
+    usb_class_stats_register(&stats_info, &acm->stats); // Interface is not counted on failure
+    USB_CLASS_STATS_MEM_ALLOC(acm->stats, sizeof(esp_tusb_cdcacm_t), MALLOC_CAP_DEFAULT); // Released on unregister
+    cdc_inst->subclass_obj = acm;
     return ESP_OK;
 }
 
@@ -301,7 +491,15 @@ static esp_err_t obj_free(tinyusb_cdcacm_itf_t itf)
     if (cdc_inst == NULL || cdc_inst->subclass_obj == NULL) {
         return ESP_FAIL;
     }
-    free(cdc_inst->subclass_obj);
+    esp_tusb_cdcacm_t *acm = cdc_inst->subclass_obj;
+    usb_class_stats_unregister(acm->stats);
+    if (acm->rx_idle_timer) {
+        esp_timer_stop(acm->rx_idle_timer);
+        esp_timer_delete(acm->rx_idle_timer);
+    }
+    vSemaphoreDelete(acm->tx_done);
+    free(acm->rx_buf);
+    free(acm);
     return ESP_OK;
 }
 
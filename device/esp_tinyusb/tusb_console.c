@@ -7,7 +7,17 @@
 
 #include <stdio.h>
 #include <stdio_ext.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/errno.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_vfs.h"
 #include "cdc.h"
 #include "tusb_console.h"
 #include "tinyusb.h"
@@ -27,6 +37,43 @@ typedef struct {
 
 static console_handle_t con;
 
+/*
+ * Log ring
+ *
+ * Writers reserve a record with compare-and-swap on the head, copy the data in and mark the record committed,
+ * so they never wait for each other nor for the drain task. The drain task reads committed records in order,
+ * writes them to the CDC VFS and zeroes the consumed space, so an uncommitted header always reads as zero.
+ * A record that doesn't fit before the end of the ring is preceded by a padding record up to the end.
+ */
+#define LOG_RING_SIZE           CONFIG_TINYUSB_CONSOLE_RING_SIZE
+#define LOG_RING_MASK           (LOG_RING_SIZE - 1)
+#define LOG_RING_PATH           "/dev/tusb_log"
+#define LOG_REC_HDR_SIZE        sizeof(uint32_t)
+#define LOG_REC_MAX_LEN         (LOG_RING_SIZE / 4)     // Longer writes are split into more records
+#define LOG_REC_COMMITTED       (1UL << 31)
+#define LOG_REC_PADDING         (1UL << 30)
+#define LOG_REC_LEN_MASK        0xFFFFUL
+#define LOG_REC_ALIGN(len)      (((len) + 3) & ~3UL)
+#define LOG_TASK_STACK_SIZE     2560
+#define LOG_TASK_RETRY_MS       10                      // CDC TX FIFO full or a record not committed yet
+
+_Static_assert((LOG_RING_SIZE & LOG_RING_MASK) == 0, "Console ring size must be a power of two");
+
+typedef struct {
+    uint8_t *buf;
+    atomic_uint head;                   // Reserved by writers, free running
+    atomic_uint tail;                   // Consumed by the drain task, free running
+    size_t offset;                      // Bytes of the record at tail already written to CDC
+    atomic_uint dropped;                // Bytes dropped while the Host was not connected or the ring was full
+    int cdc_intf;
+    int cdc_fd;                         // CDC VFS opened for writing by the drain task
+    TaskHandle_t task;
+    SemaphoreHandle_t task_exit;        // Given by the drain task when it exits
+    volatile bool stop;                 // Drain task shall exit
+} log_ring_t;
+
+static log_ring_t *s_ring;
+
 
 /**
  * @brief Reopen standard streams using a new path
@@ -99,6 +146,148 @@ static esp_err_t restore_std_streams(FILE **f_in, FILE **f_out, FILE **f_err)
     return ESP_OK;
 }
 
+/**
+ * @brief Copy data into one record of the log ring
+ *
+ * @param ring - log ring
+ * @param data - data to copy
+ * @param len - data length, at most LOG_REC_MAX_LEN
+ * @return true if the record was committed, false if the ring is full
+ */
+static bool log_ring_push(log_ring_t *ring, const uint8_t *data, size_t len)
+{
+    const uint32_t need = LOG_REC_HDR_SIZE + LOG_REC_ALIGN(len);
+    uint32_t head = atomic_load(&ring->head);
+    uint32_t pos;
+    uint32_t pad;
+    do {
+        pos = head & LOG_RING_MASK;
+        pad = (LOG_RING_SIZE - pos < need) ? LOG_RING_SIZE - pos : 0;
+        if (head + pad + need - atomic_load(&ring->tail) > LOG_RING_SIZE) {
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak(&ring->head, &head, head + pad + need));
+
+    if (pad) {
+        atomic_store((atomic_uint *)&ring->buf[pos], LOG_REC_COMMITTED | LOG_REC_PADDING | pad);
+        pos = 0;
+    }
+    memcpy(&ring->buf[pos + LOG_REC_HDR_SIZE], data, len);
+    atomic_store((atomic_uint *)&ring->buf[pos], LOG_REC_COMMITTED | len);
+    return true;
+}
+
+/**
+ * @brief Write committed records to CDC, or drop them if the Host is not connected
+ *
+ * @param ring - log ring
+ * @return true if records are left in the ring
+ */
+static bool log_ring_drain(log_ring_t *ring)
+{
+    const bool connected = tud_cdc_n_connected(ring->cdc_intf);
+    uint32_t tail = atomic_load(&ring->tail);
+    while (tail != atomic_load(&ring->head)) {
+        const uint32_t pos = tail & LOG_RING_MASK;
+        const uint32_t hdr = atomic_load((atomic_uint *)&ring->buf[pos]);
+        if (!(hdr & LOG_REC_COMMITTED)) {
+            return true; // The writer is still copying
+        }
+        uint32_t rec_size = hdr & LOG_REC_LEN_MASK;
+        if (!(hdr & LOG_REC_PADDING)) {
+            const size_t len = rec_size;
+            if (connected) {
+                ssize_t written = write(ring->cdc_fd, &ring->buf[pos + LOG_REC_HDR_SIZE + ring->offset], len - ring->offset);
+                ring->offset += (written > 0) ? written : 0;
+                if (ring->offset < len) {
+                    return true; // CDC TX FIFO is full
+                }
+            } else {
+                atomic_fetch_add(&ring->dropped, len - ring->offset);
+            }
+            ring->offset = 0;
+            rec_size = LOG_REC_HDR_SIZE + LOG_REC_ALIGN(len);
+        }
+        memset(&ring->buf[pos], 0, rec_size);
+        tail += rec_size;
+        atomic_store(&ring->tail, tail);
+    }
+    return false;
+}
+
+static void log_ring_task(void *arg)
+{
+    log_ring_t *ring = (log_ring_t *)arg;
+    bool pending = false;
+    while (!ring->stop) {
+        ulTaskNotifyTake(pdTRUE, pending ? pdMS_TO_TICKS(LOG_TASK_RETRY_MS) : portMAX_DELAY);
+        pending = log_ring_drain(ring);
+    }
+    xSemaphoreGive(ring->task_exit);
+    vTaskDelete(NULL);
+}
+
+static ssize_t log_ring_write(int fd, const void *data, size_t size)
+{
+    (void) fd;
+    log_ring_t *ring = s_ring;
+    if (!tud_cdc_n_connected(ring->cdc_intf)) {
+        // Nobody is reading, don't pay for the copy
+        atomic_fetch_add(&ring->dropped, size);
+        return size;
+    }
+    const uint8_t *data_c = (const uint8_t *)data;
+    for (size_t done = 0; done < size;) {
+        const size_t len = MIN(size - done, LOG_REC_MAX_LEN);
+        if (!log_ring_push(ring, data_c + done, len)) {
+            atomic_fetch_add(&ring->dropped, size - done);
+            break;
+        }
+        done += len;
+    }
+    xTaskNotifyGive(ring->task);
+    return size;
+}
+
+static int log_ring_open(const char *path, int flags, int mode)
+{
+    (void) path;
+    (void) flags;
+    (void) mode;
+    return 0;
+}
+
+static int log_ring_close(int fd)
+{
+    (void) fd;
+    return 0;
+}
+
+static int log_ring_fstat(int fd, struct stat *st)
+{
+    (void) fd;
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFCHR;
+    return 0;
+}
+
+static void log_ring_free(log_ring_t *ring)
+{
+    if (ring->task) {
+        ring->stop = true;
+        xTaskNotifyGive(ring->task);
+        xSemaphoreTake(ring->task_exit, portMAX_DELAY);
+    }
+    if (ring->task_exit) {
+        vSemaphoreDelete(ring->task_exit);
+    }
+    if (ring->cdc_fd >= 0) {
+        close(ring->cdc_fd);
+    }
+    free(ring->buf);
+    free(ring);
+}
+
 esp_err_t esp_tusb_init_console(int cdc_intf)
 {
     /* Registering TUSB at VFS */
@@ -107,9 +296,68 @@ esp_err_t esp_tusb_init_console(int cdc_intf)
     return ESP_OK;
 }
 
+esp_err_t esp_tusb_init_console_ring(int cdc_intf)
+{
+    esp_err_t ret;
+    ESP_RETURN_ON_FALSE(s_ring == NULL, ESP_ERR_INVALID_STATE, TAG, "Console ring already initialized");
+    ESP_RETURN_ON_ERROR(esp_vfs_tusb_cdc_register(cdc_intf, NULL), TAG, "");
+
+    log_ring_t *ring = calloc(1, sizeof(log_ring_t));
+    ESP_GOTO_ON_FALSE(ring, ESP_ERR_NO_MEM, unregister, TAG, "Failed to allocate console ring");
+    ring->cdc_intf = cdc_intf;
+    ring->cdc_fd = -1;
+    ring->buf = calloc(1, LOG_RING_SIZE);
+    ring->task_exit = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(ring->buf && ring->task_exit, ESP_ERR_NO_MEM, fail, TAG, "Failed to allocate console ring");
+    ring->cdc_fd = open(VFS_TUSB_PATH_DEFAULT, O_WRONLY);
+    ESP_GOTO_ON_FALSE(ring->cdc_fd >= 0, ESP_FAIL, fail, TAG, "Failed to open %s", VFS_TUSB_PATH_DEFAULT);
+    ESP_GOTO_ON_FALSE(xTaskCreate(log_ring_task, "tusb_console", LOG_TASK_STACK_SIZE, ring,
+                                  CONFIG_TINYUSB_CONSOLE_TASK_PRIORITY, &ring->task) == pdPASS,
+                      ESP_ERR_NO_MEM, fail, TAG, "Failed to create console task");
+
+    const esp_vfs_t vfs = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .open = &log_ring_open,
+        .close = &log_ring_close,
+        .write = &log_ring_write,
+        .fstat = &log_ring_fstat,
+    };
+    ESP_GOTO_ON_ERROR(esp_vfs_register(LOG_RING_PATH, &vfs, NULL), fail, TAG, "Failed to register %s", LOG_RING_PATH);
+    s_ring = ring;
+
+    // Input is still read directly from CDC
+    ret = redirect_std_streams_to(&con.in, NULL, NULL, VFS_TUSB_PATH_DEFAULT);
+    if (ret == ESP_OK) {
+        ret = redirect_std_streams_to(NULL, &con.out, &con.err, LOG_RING_PATH);
+    }
+    if (ret != ESP_OK) {
+        // Streams redirected so far are restored by esp_tusb_deinit_console()
+        ESP_LOGE(TAG, "Failed to redirect STD streams");
+    }
+    return ret;
+
+fail:
+    log_ring_free(ring);
+unregister:
+    esp_vfs_tusb_cdc_unregister(NULL);
+    return ret;
+}
+
+uint32_t esp_tusb_console_get_dropped(void)
+{
+    return s_ring ? atomic_load(&s_ring->dropped) : 0;
+}
+
 esp_err_t esp_tusb_deinit_console(int cdc_intf)
 {
-    ESP_RETURN_ON_ERROR(restore_std_streams(&con.in, &con.out, &con.err), TAG, "Failed to restore STD streams");
+    ESP_RETURN_ON_ERROR(restore_std_streams(con.in ? &con.in : NULL, con.out ? &con.out : NULL, con.err ? &con.err : NULL),
+                        TAG, "Failed to restore STD streams");
+    memset(&con, 0, sizeof(con));
+    if (s_ring) {
+        esp_vfs_unregister(LOG_RING_PATH);
+        log_ring_free(s_ring);
+        s_ring = NULL;
+    }
     esp_vfs_tusb_cdc_unregister(NULL);
     return ESP_OK;
 }
@@ -4,27 +4,143 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdio.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_check.h"
+#include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 #include "diskio_impl.h"
 #include "diskio_wl.h"
 #include "wear_levelling.h"
 #include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "spi_flash_mmap.h"
 #include "vfs_fat_internal.h"
 #include "tinyusb.h"
 #include "class/msc/msc_device.h"
 #include "tusb_msc_storage.h"
+#include "usb/usb_dma_buf.h"
 #include "esp_vfs_fat.h"
 #if SOC_SDMMC_HOST_SUPPORTED
 #include "diskio_sdmmc.h"
 #endif
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+#include "freertos/timers.h"
+#endif
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+#include "freertos/queue.h"
+#endif
 
 static const char *TAG = "tinyusb_msc_storage";
 
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+#define MSC_CACHE_NO_BLOCK SIZE_MAX
+
+/**
+ * @brief Write-back cache of one flash erase block
+ *
+ * Writes from the host are collected in RAM and the block is erased and programmed
+ * only once, when another block is written, on idle timeout or on explicit sync.
+ * Until the whole block has been written by the host, only bytes [0, fill_end) are valid,
+ * so a block written sequentially from its start is never read back from flash.
+ */
+typedef struct {
+    SemaphoreHandle_t mux;      /*!< Protects the cache against the idle flush timer */
+    TimerHandle_t flush_timer;  /*!< Idle timeout, restarted on every write */
+    uint8_t *buf;               /*!< Cached block data */
+    size_t block_size;          /*!< Erase block size, in bytes */
+    size_t block_addr;          /*!< Partition address of the cached block or MSC_CACHE_NO_BLOCK */
+    size_t block_len;           /*!< Length of the cached block, shorter than block_size at the end of partition */
+    size_t fill_end;            /*!< End of valid data in buf, when the block is not loaded */
+    bool loaded;                /*!< The whole block is valid in buf */
+    bool dirty;                 /*!< buf differs from flash */
+} msc_write_cache_t;
+#endif
+
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+#define MSC_ASYNC_IO_SLOTS 2
+
+typedef enum {
+    MSC_IO_FREE,                /*!< Slot can take a new job */
+    MSC_IO_BUSY,                /*!< Job is queued or running in the storage task */
+    MSC_IO_DONE,                /*!< Job finished, result not collected yet */
+} msc_io_state_t;
+
+/**
+ * @brief One buffer of the double-buffered storage access
+ */
+typedef struct {
+    volatile msc_io_state_t state;
+    bool is_write;
+    uint32_t lba;
+    uint32_t offset;
+    size_t size;
+    esp_err_t err;
+    uint8_t *buf;               /*!< CONFIG_TINYUSB_MSC_BUFSIZE bytes */
+} msc_io_slot_t;
+
+/**
+ * @brief Storage task, which reads or programs one buffer while the other one is transferred over USB
+ */
+typedef struct {
+    TaskHandle_t task;
+    QueueHandle_t queue;        /*!< Indexes of slots to process */
+    SemaphoreHandle_t done;     /*!< Given by the storage task after each job */
+    esp_err_t write_err;        /*!< First failure of a write already acknowledged to the Host */
+    msc_io_slot_t slot[MSC_ASYNC_IO_SLOTS];
+} msc_async_io_t;
+#endif
+
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+#define MSC_UNMAP_TASK_STACK_SIZE 3072
+#define MSC_UNMAP_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+
+/**
+ * @brief Sectors of SPI Flash storage unmapped by the Host
+ *
+ * Unmapped sectors are erased by a low priority task. Erased sectors are remembered until they are written,
+ * so the write programs them without erasing first. Bitmaps are indexed by wear levelling sector.
+ */
+typedef struct {
+    SemaphoreHandle_t mux;      /*!< Serializes wear levelling access of the erase task and the Host */
+    TaskHandle_t task;          /*!< Erases pending sectors when notified */
+    SemaphoreHandle_t exit;     /*!< Given by the erase task when it exits */
+    uint32_t *pending;          /*!< Unmapped sectors waiting for erase */
+    uint32_t *erased;           /*!< Erased sectors not written since */
+    size_t block_size;          /*!< Erase granularity, at least one flash erase block, so wear levelling erases without read-modify-write */
+    size_t block_count;
+    volatile bool stop;         /*!< Erase task shall exit */
+} msc_unmap_t;
+#endif
+
+#define MSC_RAMDISK_PERSIST_TASK_STACK_SIZE 3072
+#define MSC_RAMDISK_PERSIST_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+
+/**
+ * @brief Storage in RAM or PSRAM, optionally saved to a flash partition
+ */
 typedef struct {
+    uint8_t *buf;
+    bool own_buf;                       /*!< buf was allocated by the driver */
+    size_t size;                        /*!< Size of buf, in bytes */
+    uint32_t sector_count;
+    uint32_t sector_size;
+    SemaphoreHandle_t lock;             /*!< Protects buf against the persist task */
+    const esp_partition_t *partition;   /*!< Partition buf is saved to, or NULL */
+    TaskHandle_t persist_task;          /*!< Saves buf to the partition when notified */
+    SemaphoreHandle_t persist_exit;     /*!< Given by the persist task when it exits */
+    volatile bool dirty;                /*!< buf has been written since it was saved */
+    volatile bool stop;                 /*!< Persist task shall exit */
+} msc_ramdisk_t;
+
+typedef struct tinyusb_msc_storage_handle_s tinyusb_msc_storage_handle_s;
+
+struct tinyusb_msc_storage_handle_s {
     bool is_fat_mounted;
     const char *base_path;
     union {
@@ -32,35 +148,61 @@ typedef struct {
 #if SOC_SDMMC_HOST_SUPPORTED
         sdmmc_card_t *card;
 #endif
+        msc_ramdisk_t *ram;
     };
-    esp_err_t (*mount)(BYTE pdrv);
-    esp_err_t (*unmount)(void);
-    uint32_t (*sector_count)(void);
-    uint32_t (*sector_size)(void);
-    esp_err_t (*read)(size_t sector_size, uint32_t lba, uint32_t offset, size_t size, void *dest);
-    esp_err_t (*write)(size_t sector_size, size_t addr, uint32_t lba, uint32_t offset, size_t size, const void *src);
+    bool in_memory;             /*!< Storage is accessed in place from the TinyUSB callbacks, without the storage task */
+#if SOC_SDMMC_HOST_SUPPORTED
+    uint8_t *dma_buf;           /*!< Bounce buffer for USB buffers the SDMMC DMA can't access, allocated on first use */
+#endif
+    esp_err_t (*mount)(tinyusb_msc_storage_handle_s *handle, BYTE pdrv);
+    esp_err_t (*unmount)(tinyusb_msc_storage_handle_s *handle);
+    uint32_t (*sector_count)(tinyusb_msc_storage_handle_s *handle);
+    uint32_t (*sector_size)(tinyusb_msc_storage_handle_s *handle);
+    esp_err_t (*read)(tinyusb_msc_storage_handle_s *handle, size_t sector_size, uint32_t lba, uint32_t offset, size_t size, void *dest);
+    esp_err_t (*write)(tinyusb_msc_storage_handle_s *handle, size_t sector_size, size_t addr, uint32_t lba, uint32_t offset, size_t size, const void *src);
+    esp_err_t (*sync)(tinyusb_msc_storage_handle_s *handle);
+    void (*eject)(tinyusb_msc_storage_handle_s *handle);   /*!< Optional, called when the Host ejects the storage or the bus is unmounted */
+    void (*deinit)(tinyusb_msc_storage_handle_s *handle);  /*!< Optional, frees backend resources */
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+    msc_write_cache_t *cache;
+#endif
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+    msc_async_io_t *async;
+#endif
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    msc_unmap_t *unmap;         /*!< NULL if the storage does not support UNMAP */
+#endif
     tusb_msc_callback_t callback_mount_changed;
     tusb_msc_callback_t callback_premount_changed;
     int max_files;
-} tinyusb_msc_storage_handle_s; /*!< MSC object */
+    uint8_t lun;
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    SemaphoreHandle_t io_lock;  /*!< Serializes storage access of FATFS and the Host */
+    volatile bool media_changed;/*!< Application has written to the storage since the Host checked it */
+#endif
+    BYTE pdrv;                  /*!< FATFS drive, when mounted through the block layer */
+    char default_base_path[ESP_VFS_PATH_MAX + 1];   /*!< Mount path used when none is given */
+}; /*!< MSC object */
 
-/* handle of tinyusb driver connected to application */
-static tinyusb_msc_storage_handle_s *s_storage_handle;
+/* handles of tinyusb driver connected to application, one per LUN */
+static tinyusb_msc_storage_handle_s *s_storage_handle[CONFIG_TINYUSB_MSC_LUN_MAX];
+static uint8_t s_lun_count;
 
-static esp_err_t _mount_spiflash(BYTE pdrv)
+#if !CONFIG_TINYUSB_MSC_SPIFLASH_4K_SECTORS
+static esp_err_t _mount_spiflash(tinyusb_msc_storage_handle_s *handle, BYTE pdrv)
 {
-    return ff_diskio_register_wl_partition(pdrv, s_storage_handle->wl_handle);
+    return ff_diskio_register_wl_partition(pdrv, handle->wl_handle);
 }
 
-static esp_err_t _unmount_spiflash(void)
+static esp_err_t _unmount_spiflash(tinyusb_msc_storage_handle_s *handle)
 {
     BYTE pdrv;
-    pdrv = ff_diskio_get_pdrv_wl(s_storage_handle->wl_handle);
+    pdrv = ff_diskio_get_pdrv_wl(handle->wl_handle);
     if (pdrv == 0xff) {
         ESP_LOGE(TAG, "Invalid state");
         return ESP_ERR_INVALID_STATE;
     }
-    ff_diskio_clear_pdrv_wl(s_storage_handle->wl_handle);
+    ff_diskio_clear_pdrv_wl(handle->wl_handle);
 
     char drv[3] = {(char)('0' + pdrv), ':', 0};
     f_mount(0, drv, 0);
@@ -68,28 +210,312 @@ static esp_err_t _unmount_spiflash(void)
 
     return ESP_OK;
 }
+#endif
 
-static uint32_t _get_sector_count_spiflash(void)
+static uint32_t _get_sector_size_spiflash(tinyusb_msc_storage_handle_s *handle)
+{
+    assert(handle->wl_handle != WL_INVALID_HANDLE);
+#if CONFIG_TINYUSB_MSC_SPIFLASH_4K_SECTORS
+    // One erase block made of several wear levelling sectors
+    return SPI_FLASH_SEC_SIZE;
+#else
+    return (uint32_t)wl_sector_size(handle->wl_handle);
+#endif
+}
+
+static uint32_t _get_sector_count_spiflash(tinyusb_msc_storage_handle_s *handle)
 {
     uint32_t result = 0;
-    assert(s_storage_handle->wl_handle != WL_INVALID_HANDLE);
-    size_t size = wl_sector_size(s_storage_handle->wl_handle);
+    assert(handle->wl_handle != WL_INVALID_HANDLE);
+    size_t size = _get_sector_size_spiflash(handle);
     if (size == 0) {
         ESP_LOGW(TAG, "WL Sector size is zero !!!");
         result = 0;
     } else {
-        result = (uint32_t)(wl_size(s_storage_handle->wl_handle) / size);
+        result = (uint32_t)(wl_size(handle->wl_handle) / size);
     }
     return result;
 }
 
-static uint32_t _get_sector_size_spiflash(void)
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+#define UNMAP_BIT(block)        (1UL << ((block) % 32))
+#define UNMAP_WORDS(blocks)     (((blocks) + 31) / 32)
+
+static void _unmap_lock(tinyusb_msc_storage_handle_s *handle)
+{
+    xSemaphoreTake(handle->unmap->mux, portMAX_DELAY);
+}
+
+static void _unmap_unlock(tinyusb_msc_storage_handle_s *handle)
+{
+    xSemaphoreGive(handle->unmap->mux);
+}
+
+/**
+ * @brief Take the range for a write, blocks it touches are neither pending for erase nor erased afterwards
+ *
+ * Must be called with the unmap lock taken
+ *
+ * @return true if the whole range is erased, so it can be programmed without erase
+ */
+static bool _unmap_claim(tinyusb_msc_storage_handle_s *handle, size_t addr, size_t size)
+{
+    msc_unmap_t *unmap = handle->unmap;
+    bool erased = true;
+    for (size_t block = addr / unmap->block_size; block <= (addr + size - 1) / unmap->block_size; block++) {
+        erased &= (unmap->erased[block / 32] & UNMAP_BIT(block)) != 0;
+        unmap->erased[block / 32] &= ~UNMAP_BIT(block);
+        unmap->pending[block / 32] &= ~UNMAP_BIT(block);
+    }
+    return erased;
+}
+
+/**
+ * @brief Forget all unmapped and erased blocks
+ *
+ * Called before the storage is mounted by the application, which may write it without this layer
+ */
+static void _unmap_reset(tinyusb_msc_storage_handle_s *handle)
+{
+    msc_unmap_t *unmap = handle->unmap;
+    if (unmap == NULL) {
+        return;
+    }
+    _unmap_lock(handle);
+    memset(unmap->pending, 0, UNMAP_WORDS(unmap->block_count) * sizeof(uint32_t));
+    memset(unmap->erased, 0, UNMAP_WORDS(unmap->block_count) * sizeof(uint32_t));
+    _unmap_unlock(handle);
+}
+
+static void _unmap_task(void *arg)
+{
+    tinyusb_msc_storage_handle_s *handle = (tinyusb_msc_storage_handle_s *)arg;
+    msc_unmap_t *unmap = handle->unmap;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (size_t word = 0; word < UNMAP_WORDS(unmap->block_count) && !unmap->stop; word++) {
+            if (__atomic_load_n(&unmap->pending[word], __ATOMIC_RELAXED) == 0) {
+                continue;
+            }
+            // Lock is taken for one block at a time, so the Host waits for one erase at most
+            for (size_t block = word * 32; block < (word + 1) * 32 && block < unmap->block_count; block++) {
+                _unmap_lock(handle);
+                if (unmap->pending[word] & UNMAP_BIT(block)) {
+                    unmap->pending[word] &= ~UNMAP_BIT(block);
+                    if (wl_erase_range(handle->wl_handle, block * unmap->block_size, unmap->block_size) == ESP_OK) {
+                        unmap->erased[word] |= UNMAP_BIT(block);
+                    } else {
+                        ESP_LOGW(TAG, "Failed to erase unmapped block %u", block);
+                    }
+                }
+                _unmap_unlock(handle);
+            }
+        }
+        if (unmap->stop) {
+            break;
+        }
+    }
+    xSemaphoreGive(unmap->exit);
+    vTaskDelete(NULL);
+}
+
+static void _unmap_destroy(msc_unmap_t *unmap)
+{
+    if (unmap->task) {
+        unmap->stop = true;
+        xTaskNotifyGive(unmap->task);
+        xSemaphoreTake(unmap->exit, portMAX_DELAY);
+    }
+    if (unmap->exit) {
+        vSemaphoreDelete(unmap->exit);
+    }
+    if (unmap->mux) {
+        vSemaphoreDelete(unmap->mux);
+    }
+    free(unmap->pending);
+    free(unmap->erased);
+    free(unmap);
+}
+
+static esp_err_t _unmap_create(tinyusb_msc_storage_handle_s *handle)
+{
+    msc_unmap_t *unmap = calloc(1, sizeof(msc_unmap_t));
+    ESP_RETURN_ON_FALSE(unmap, ESP_ERR_NO_MEM, TAG, "could not allocate unmap bitmaps");
+    const size_t wl_sector = wl_sector_size(handle->wl_handle);
+    unmap->block_size = wl_sector > SPI_FLASH_SEC_SIZE ? wl_sector : SPI_FLASH_SEC_SIZE;
+    unmap->block_count = wl_size(handle->wl_handle) / unmap->block_size;
+    unmap->pending = calloc(UNMAP_WORDS(unmap->block_count), sizeof(uint32_t));
+    unmap->erased = calloc(UNMAP_WORDS(unmap->block_count), sizeof(uint32_t));
+    unmap->mux = xSemaphoreCreateMutex();
+    unmap->exit = xSemaphoreCreateBinary();
+    if (!unmap->pending || !unmap->erased || !unmap->mux || !unmap->exit ||
+            xTaskCreate(_unmap_task, "msc_unmap", MSC_UNMAP_TASK_STACK_SIZE, handle,
+                        MSC_UNMAP_TASK_PRIORITY, &unmap->task) != pdPASS) {
+        unmap->task = NULL;
+        _unmap_destroy(unmap);
+        ESP_LOGE(TAG, "could not create unmap task");
+        return ESP_ERR_NO_MEM;
+    }
+    handle->unmap = unmap;
+    return ESP_OK;
+}
+
+/**
+ * @brief Unmap a range of the storage, blocks it covers completely are erased in the background
+ *
+ * @param[in] addr Address in the wear levelling partition
+ * @param[in] size Size in bytes
+ */
+static void _unmap_range(tinyusb_msc_storage_handle_s *handle, size_t addr, size_t size)
+{
+    msc_unmap_t *unmap = handle->unmap;
+    _unmap_lock(handle);
+    for (size_t block = (addr + unmap->block_size - 1) / unmap->block_size; block < (addr + size) / unmap->block_size; block++) {
+        if (!(unmap->erased[block / 32] & UNMAP_BIT(block))) {
+            unmap->pending[block / 32] |= UNMAP_BIT(block);
+        }
+    }
+    _unmap_unlock(handle);
+    xTaskNotifyGive(unmap->task);
+}
+#endif // CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+// Read the part of the cached block not yet written by the host. Cache must be locked.
+static esp_err_t _cache_load(tinyusb_msc_storage_handle_s *handle)
+{
+    msc_write_cache_t *cache = handle->cache;
+    if (cache->loaded) {
+        return ESP_OK;
+    }
+    if (cache->fill_end < cache->block_len) {
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+        _unmap_lock(handle);
+#endif
+        esp_err_t ret = wl_read(handle->wl_handle,
+                                cache->block_addr + cache->fill_end,
+                                cache->buf + cache->fill_end,
+                                cache->block_len - cache->fill_end);
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+        _unmap_unlock(handle);
+#endif
+        ESP_RETURN_ON_ERROR(ret, TAG, "Failed to read block 0x%x", cache->block_addr);
+    }
+    cache->loaded = true;
+    return ESP_OK;
+}
+
+// Write the cached block back to flash with one erase. Cache must be locked.
+static esp_err_t _cache_flush(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle->wl_handle != WL_INVALID_HANDLE);
-    return (uint32_t)wl_sector_size(s_storage_handle->wl_handle);
+    msc_write_cache_t *cache = handle->cache;
+    if (cache->block_addr == MSC_CACHE_NO_BLOCK || !cache->dirty) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(_cache_load(handle), TAG, "Failed to complete block");
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    esp_err_t ret = ESP_OK;
+    _unmap_lock(handle);
+    if (!_unmap_claim(handle, cache->block_addr, cache->block_len)) {
+        ESP_GOTO_ON_ERROR(wl_erase_range(handle->wl_handle, cache->block_addr, cache->block_len),
+                          exit, TAG, "Failed to erase");
+    }
+    ESP_GOTO_ON_ERROR(wl_write(handle->wl_handle, cache->block_addr, cache->buf, cache->block_len),
+                      exit, TAG, "Failed to write");
+    cache->dirty = false;
+exit:
+    _unmap_unlock(handle);
+    return ret;
+#else
+    ESP_RETURN_ON_ERROR(wl_erase_range(handle->wl_handle, cache->block_addr, cache->block_len),
+                        TAG, "Failed to erase");
+    ESP_RETURN_ON_ERROR(wl_write(handle->wl_handle, cache->block_addr, cache->buf, cache->block_len),
+                        TAG, "Failed to write");
+    cache->dirty = false;
+    return ESP_OK;
+#endif
+}
+
+static void _cache_flush_timer_cb(TimerHandle_t timer)
+{
+    tinyusb_msc_storage_handle_s *handle = (tinyusb_msc_storage_handle_s *)pvTimerGetTimerID(timer);
+    msc_write_cache_t *cache = handle->cache;
+    xSemaphoreTake(cache->mux, portMAX_DELAY);
+    esp_err_t ret = _cache_flush(handle);
+    xSemaphoreGive(cache->mux);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Idle flush of write cache failed (0x%x)", ret);
+    }
+}
+
+static void _cache_timer_barrier(void *sem, uint32_t unused)
+{
+    (void) unused;
+    xSemaphoreGive((SemaphoreHandle_t)sem);
 }
 
-static esp_err_t _read_sector_spiflash(size_t sector_size,
+static esp_err_t _cache_create(tinyusb_msc_storage_handle_s *handle)
+{
+    esp_err_t ret = ESP_OK;
+    msc_write_cache_t *cache = calloc(1, sizeof(msc_write_cache_t));
+    ESP_RETURN_ON_FALSE(cache, ESP_ERR_NO_MEM, TAG, "could not allocate write cache");
+    const size_t sector_size = wl_sector_size(handle->wl_handle);
+    cache->block_size = sector_size > SPI_FLASH_SEC_SIZE ? sector_size : SPI_FLASH_SEC_SIZE;
+    cache->block_addr = MSC_CACHE_NO_BLOCK;
+    cache->buf = malloc(cache->block_size);
+    cache->mux = xSemaphoreCreateMutex();
+    cache->flush_timer = xTimerCreate("msc_flush",
+                                      pdMS_TO_TICKS(CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE_TIMEOUT_MS),
+                                      pdFALSE, handle, _cache_flush_timer_cb);
+    ESP_GOTO_ON_FALSE(cache->buf && cache->mux && cache->flush_timer, ESP_ERR_NO_MEM, fail, TAG,
+                      "could not allocate write cache");
+    handle->cache = cache;
+    return ESP_OK;
+
+fail:
+    if (cache->flush_timer) {
+        xTimerDelete(cache->flush_timer, portMAX_DELAY);
+    }
+    if (cache->mux) {
+        vSemaphoreDelete(cache->mux);
+    }
+    free(cache->buf);
+    free(cache);
+    return ret;
+}
+
+static void _cache_destroy(msc_write_cache_t *cache)
+{
+    // The flush timer callback may be running; wait until the timer task has processed the deletion
+    SemaphoreHandle_t barrier = xSemaphoreCreateBinary();
+    xTimerDelete(cache->flush_timer, portMAX_DELAY);
+    if (barrier) {
+        xTimerPendFunctionCall(_cache_timer_barrier, barrier, 0, portMAX_DELAY);
+        xSemaphoreTake(barrier, portMAX_DELAY);
+        vSemaphoreDelete(barrier);
+    }
+    vSemaphoreDelete(cache->mux);
+    free(cache->buf);
+    free(cache);
+}
+
+static esp_err_t _sync_spiflash(tinyusb_msc_storage_handle_s *handle)
+{
+    msc_write_cache_t *cache = handle->cache;
+    xTimerStop(cache->flush_timer, portMAX_DELAY);
+    xSemaphoreTake(cache->mux, portMAX_DELAY);
+    esp_err_t ret = _cache_flush(handle);
+    if (ret == ESP_OK) {
+        // Storage may be changed behind our back (e.g. by FATFS), drop the cached block
+        cache->block_addr = MSC_CACHE_NO_BLOCK;
+    }
+    xSemaphoreGive(cache->mux);
+    return ret;
+}
+#endif // CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+
+static esp_err_t _read_sector_spiflash(tinyusb_msc_storage_handle_s *handle,
+                                       size_t sector_size,
                                        uint32_t lba,
                                        uint32_t offset,
                                        size_t size,
@@ -99,33 +525,115 @@ static esp_err_t _read_sector_spiflash(size_t sector_size,
     size_t addr = 0; // Address of the data to be read, relative to the beginning of the partition.
     ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
     ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
-    return wl_read(s_storage_handle->wl_handle, addr, dest, size);
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+    msc_write_cache_t *cache = handle->cache;
+    xSemaphoreTake(cache->mux, portMAX_DELAY);
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    _unmap_lock(handle);
+#endif
+    esp_err_t ret = wl_read(handle->wl_handle, addr, dest, size);
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    _unmap_unlock(handle);
+#endif
+    if (ret == ESP_OK && cache->block_addr != MSC_CACHE_NO_BLOCK) {
+        // Overlay the data that is only in the cache
+        const size_t valid_end = cache->block_addr + (cache->loaded ? cache->block_len : cache->fill_end);
+        const size_t start = addr > cache->block_addr ? addr : cache->block_addr;
+        const size_t end = (addr + size) < valid_end ? (addr + size) : valid_end;
+        if (start < end) {
+            memcpy((uint8_t *)dest + (start - addr), cache->buf + (start - cache->block_addr), end - start);
+        }
+    }
+    xSemaphoreGive(cache->mux);
+    return ret;
+#elif CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    _unmap_lock(handle);
+    esp_err_t ret = wl_read(handle->wl_handle, addr, dest, size);
+    _unmap_unlock(handle);
+    return ret;
+#else
+    return wl_read(handle->wl_handle, addr, dest, size);
+#endif
 }
 
-static esp_err_t _write_sector_spiflash(size_t sector_size,
+static esp_err_t _write_sector_spiflash(tinyusb_msc_storage_handle_s *handle,
+                                        size_t sector_size,
                                         size_t addr,
                                         uint32_t lba,
                                         uint32_t offset,
                                         size_t size,
                                         const void *src)
 {
-    ESP_RETURN_ON_ERROR(wl_erase_range(s_storage_handle->wl_handle, addr, size),
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+    esp_err_t ret = ESP_OK;
+    msc_write_cache_t *cache = handle->cache;
+    const size_t partition_size = wl_size(handle->wl_handle);
+    const uint8_t *data = (const uint8_t *)src;
+
+    xSemaphoreTake(cache->mux, portMAX_DELAY);
+    while (size > 0) {
+        const size_t block_addr = addr - (addr % cache->block_size);
+        const size_t block_offset = addr - block_addr;
+        const size_t block_len = (partition_size - block_addr) < cache->block_size ? (partition_size - block_addr) : cache->block_size;
+        const size_t len = (block_len - block_offset) < size ? (block_len - block_offset) : size;
+
+        if (block_addr != cache->block_addr) {
+            // Evict the previous block
+            ESP_GOTO_ON_ERROR(_cache_flush(handle), exit, TAG, "Failed to evict block 0x%x", cache->block_addr);
+            cache->block_addr = block_addr;
+            cache->block_len = block_len;
+            cache->fill_end = 0;
+            cache->loaded = false;
+        }
+        if (!cache->loaded && block_offset != cache->fill_end) {
+            // Not a continuation of a sequential write, complete the block from flash first
+            ESP_GOTO_ON_ERROR(_cache_load(handle), exit, TAG, "Failed to load block 0x%x", block_addr);
+        }
+        memcpy(cache->buf + block_offset, data, len);
+        cache->dirty = true;
+        if (!cache->loaded) {
+            cache->fill_end = block_offset + len;
+            cache->loaded = (cache->fill_end == cache->block_len);
+        }
+        addr += len;
+        data += len;
+        size -= len;
+    }
+
+exit:
+    xSemaphoreGive(cache->mux);
+    xTimerReset(cache->flush_timer, 0);
+    return ret;
+#elif CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    esp_err_t ret = ESP_OK;
+    _unmap_lock(handle);
+    if (!_unmap_claim(handle, addr, size)) {
+        ESP_GOTO_ON_ERROR(wl_erase_range(handle->wl_handle, addr, size),
+                          exit, TAG, "Failed to erase");
+    }
+    ret = wl_write(handle->wl_handle, addr, src, size);
+exit:
+    _unmap_unlock(handle);
+    return ret;
+#else
+    ESP_RETURN_ON_ERROR(wl_erase_range(handle->wl_handle, addr, size),
                         TAG, "Failed to erase");
-    return wl_write(s_storage_handle->wl_handle, addr, src, size);
+    return wl_write(handle->wl_handle, addr, src, size);
+#endif
 }
 
 #if SOC_SDMMC_HOST_SUPPORTED
-static esp_err_t _mount_sdmmc(BYTE pdrv)
+static esp_err_t _mount_sdmmc(tinyusb_msc_storage_handle_s *handle, BYTE pdrv)
 {
-    ff_diskio_register_sdmmc(pdrv, s_storage_handle->card);
+    ff_diskio_register_sdmmc(pdrv, handle->card);
     ff_sdmmc_set_disk_status_check(pdrv, false);
     return ESP_OK;
 }
 
-static esp_err_t _unmount_sdmmc(void)
+static esp_err_t _unmount_sdmmc(tinyusb_msc_storage_handle_s *handle)
 {
     BYTE pdrv;
-    pdrv = ff_diskio_get_pdrv_card(s_storage_handle->card);
+    pdrv = ff_diskio_get_pdrv_card(handle->card);
     if (pdrv == 0xff) {
         ESP_LOGE(TAG, "Invalid state");
         return ESP_ERR_INVALID_STATE;
@@ -138,69 +646,535 @@ static esp_err_t _unmount_sdmmc(void)
     return ESP_OK;
 }
 
-static uint32_t _get_sector_count_sdmmc(void)
+static uint32_t _get_sector_count_sdmmc(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle->card);
-    return (uint32_t)s_storage_handle->card->csd.capacity;
+    assert(handle->card);
+    return (uint32_t)handle->card->csd.capacity;
 }
 
-static uint32_t _get_sector_size_sdmmc(void)
+static uint32_t _get_sector_size_sdmmc(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle->card);
-    return (uint32_t)s_storage_handle->card->csd.sector_size;
+    assert(handle->card);
+    return (uint32_t)handle->card->csd.sector_size;
 }
 
-static esp_err_t _read_sector_sdmmc(size_t sector_size,
+static esp_err_t _get_dma_buf(tinyusb_msc_storage_handle_s *handle)
+{
+    if (!handle->dma_buf) {
+        handle->dma_buf = usb_dma_buf_alloc(CONFIG_TINYUSB_MSC_BUFSIZE, 0);
+    }
+    return handle->dma_buf ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t _read_sector_sdmmc(tinyusb_msc_storage_handle_s *handle,
+                                    size_t sector_size,
                                     uint32_t lba,
                                     uint32_t offset,
                                     size_t size,
                                     void *dest)
 {
-    return sdmmc_read_sectors(s_storage_handle->card, dest, lba, size / sector_size);
+    if (size > CONFIG_TINYUSB_MSC_BUFSIZE || usb_dma_buf_is_dma_ready(dest, size)) {
+        // One multi-block command (CMD18) straight to the USB buffer
+        return sdmmc_read_sectors(handle->card, dest, lba, size / sector_size);
+    }
+    // Bounce the whole chunk at once, the driver would otherwise bounce it sector by sector
+    ESP_RETURN_ON_ERROR(_get_dma_buf(handle), TAG, "could not allocate DMA buffer");
+    ESP_RETURN_ON_ERROR(sdmmc_read_sectors(handle->card, handle->dma_buf, lba, size / sector_size),
+                        TAG, "Failed to read");
+    memcpy(dest, handle->dma_buf, size);
+    return ESP_OK;
 }
 
-static esp_err_t _write_sector_sdmmc(size_t sector_size,
+static esp_err_t _write_sector_sdmmc(tinyusb_msc_storage_handle_s *handle,
+                                     size_t sector_size,
                                      size_t addr,
                                      uint32_t lba,
                                      uint32_t offset,
                                      size_t size,
                                      const void *src)
 {
-    return sdmmc_write_sectors(s_storage_handle->card, src, lba, size / sector_size);
+    if (size > CONFIG_TINYUSB_MSC_BUFSIZE || usb_dma_buf_is_dma_ready(src, size)) {
+        // One multi-block command (CMD25) straight from the USB buffer
+        return sdmmc_write_sectors(handle->card, src, lba, size / sector_size);
+    }
+    ESP_RETURN_ON_ERROR(_get_dma_buf(handle), TAG, "could not allocate DMA buffer");
+    memcpy(handle->dma_buf, src, size);
+    return sdmmc_write_sectors(handle->card, handle->dma_buf, lba, size / sector_size);
+}
+#endif
+
+static esp_err_t msc_storage_read_sector(tinyusb_msc_storage_handle_s *handle,
+        uint32_t lba,
+        uint32_t offset,
+        size_t size,
+        void *dest)
+{
+    assert(handle);
+    size_t sector_size = (handle->sector_size)(handle);
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    xSemaphoreTake(handle->io_lock, portMAX_DELAY);
+    esp_err_t ret = (handle->read)(handle, sector_size, lba, offset, size, dest);
+    xSemaphoreGive(handle->io_lock);
+    return ret;
+#else
+    return (handle->read)(handle, sector_size, lba, offset, size, dest);
+#endif
+}
+
+static esp_err_t msc_storage_write_sector(tinyusb_msc_storage_handle_s *handle,
+        uint32_t lba,
+        uint32_t offset,
+        size_t size,
+        const void *src)
+{
+    assert(handle);
+    if (handle->is_fat_mounted) {
+        ESP_LOGE(TAG, "can't write, FAT mounted");
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t sector_size = (handle->sector_size)(handle);
+    size_t temp = 0;
+    size_t addr = 0; // Address of the data to be read, relative to the beginning of the partition.
+    ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
+    ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
+
+    if (addr % sector_size != 0 || size % sector_size != 0) {
+        ESP_LOGE(TAG, "Invalid Argument lba(%lu) offset(%lu) size(%u) sector_size(%u)", lba, offset, size, sector_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return (handle->write)(handle, sector_size, addr, lba, offset, size, src);
+}
+
+/* Block layer shared by FATFS and the Host
+   While the storage is mounted by the application, FATFS goes through the same backend
+   (and write cache) as READ10, so the Host always reads what the application has written.
+   Used by all storages with CONFIG_TINYUSB_MSC_SHARED_ACCESS and by RAM disks.
+   ********************************************************************* */
+static tinyusb_msc_storage_handle_s *s_pdrv_handle[FF_VOLUMES];
+
+static DSTATUS _shared_disk_initialize(BYTE pdrv)
+{
+    return s_pdrv_handle[pdrv] ? 0 : STA_NOINIT;
+}
+
+static DSTATUS _shared_disk_status(BYTE pdrv)
+{
+    return s_pdrv_handle[pdrv] ? 0 : STA_NOINIT;
+}
+
+static DRESULT _shared_disk_read(BYTE pdrv, BYTE *buff, uint32_t sector, UINT count)
+{
+    tinyusb_msc_storage_handle_s *handle = s_pdrv_handle[pdrv];
+    const size_t sector_size = (handle->sector_size)(handle);
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    xSemaphoreTake(handle->io_lock, portMAX_DELAY);
+    esp_err_t err = (handle->read)(handle, sector_size, sector, 0, count * sector_size, buff);
+    xSemaphoreGive(handle->io_lock);
+#else
+    esp_err_t err = (handle->read)(handle, sector_size, sector, 0, count * sector_size, buff);
+#endif
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "disk read failed (0x%x)", err);
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT _shared_disk_write(BYTE pdrv, const BYTE *buff, uint32_t sector, UINT count)
+{
+    tinyusb_msc_storage_handle_s *handle = s_pdrv_handle[pdrv];
+    const size_t sector_size = (handle->sector_size)(handle);
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    xSemaphoreTake(handle->io_lock, portMAX_DELAY);
+    esp_err_t err = (handle->write)(handle, sector_size, (size_t)sector * sector_size, sector, 0, count * sector_size, buff);
+    handle->media_changed = true;
+    xSemaphoreGive(handle->io_lock);
+#else
+    esp_err_t err = (handle->write)(handle, sector_size, (size_t)sector * sector_size, sector, 0, count * sector_size, buff);
+#endif
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "disk write failed (0x%x)", err);
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT _shared_disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    tinyusb_msc_storage_handle_s *handle = s_pdrv_handle[pdrv];
+    switch (cmd) {
+    case CTRL_SYNC:
+        if (handle->sync && (handle->sync)(handle) != ESP_OK) {
+            return RES_ERROR;
+        }
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *((DWORD *) buff) = (handle->sector_count)(handle);
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *((WORD *) buff) = (handle->sector_size)(handle);
+        return RES_OK;
+    default:
+        return RES_ERROR;
+    }
+}
+
+static const ff_diskio_impl_t s_shared_diskio = {
+    .init = &_shared_disk_initialize,
+    .status = &_shared_disk_status,
+    .read = &_shared_disk_read,
+    .write = &_shared_disk_write,
+    .ioctl = &_shared_disk_ioctl
+};
+
+static esp_err_t _mount_shared(tinyusb_msc_storage_handle_s *handle, BYTE pdrv)
+{
+    s_pdrv_handle[pdrv] = handle;
+    handle->pdrv = pdrv;
+    ff_diskio_register(pdrv, &s_shared_diskio);
+    return ESP_OK;
+}
+
+static esp_err_t _unmount_shared(tinyusb_msc_storage_handle_s *handle)
+{
+    char drv[3] = {(char)('0' + handle->pdrv), ':', 0};
+    f_mount(0, drv, 0);
+    ff_diskio_unregister(handle->pdrv);
+    s_pdrv_handle[handle->pdrv] = NULL;
+    return ESP_OK;
+}
+/*********************************************************************** Shared block layer*/
+
+/* RAM disk
+   READ10 and WRITE10 copy straight between the TinyUSB buffer and the memory.
+   The persist task saves the memory to the partition on eject, skipping flash sectors that are already equal.
+   ********************************************************************* */
+static uint32_t _get_sector_count_ramdisk(tinyusb_msc_storage_handle_s *handle)
+{
+    return handle->ram->sector_count;
+}
+
+static uint32_t _get_sector_size_ramdisk(tinyusb_msc_storage_handle_s *handle)
+{
+    return handle->ram->sector_size;
+}
+
+static esp_err_t _read_sector_ramdisk(tinyusb_msc_storage_handle_s *handle,
+                                      size_t sector_size,
+                                      uint32_t lba,
+                                      uint32_t offset,
+                                      size_t size,
+                                      void *dest)
+{
+    msc_ramdisk_t *ram = handle->ram;
+    ESP_RETURN_ON_FALSE(lba < ram->sector_count, ESP_ERR_INVALID_SIZE, TAG, "lba %lu out of RAM disk", lba);
+    const size_t addr = (size_t)lba * sector_size + offset;
+    ESP_RETURN_ON_FALSE(addr <= ram->size && size <= ram->size - addr, ESP_ERR_INVALID_SIZE, TAG, "read out of RAM disk");
+    xSemaphoreTake(ram->lock, portMAX_DELAY);
+    memcpy(dest, ram->buf + addr, size);
+    xSemaphoreGive(ram->lock);
+    return ESP_OK;
+}
+
+static esp_err_t _write_sector_ramdisk(tinyusb_msc_storage_handle_s *handle,
+                                       size_t sector_size,
+                                       size_t addr,
+                                       uint32_t lba,
+                                       uint32_t offset,
+                                       size_t size,
+                                       const void *src)
+{
+    msc_ramdisk_t *ram = handle->ram;
+    ESP_RETURN_ON_FALSE(addr <= ram->size && size <= ram->size - addr, ESP_ERR_INVALID_SIZE, TAG, "write out of RAM disk");
+    xSemaphoreTake(ram->lock, portMAX_DELAY);
+    memcpy(ram->buf + addr, src, size);
+    ram->dirty = true;
+    xSemaphoreGive(ram->lock);
+    return ESP_OK;
+}
+
+// Erase and program the flash sectors that differ from the memory
+static esp_err_t _ramdisk_save(msc_ramdisk_t *ram)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t *block = heap_caps_malloc(SPI_FLASH_SEC_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ESP_RETURN_ON_FALSE(block, ESP_ERR_NO_MEM, TAG, "could not allocate flash sector buffer");
+    ram->dirty = false;
+    for (size_t addr = 0; addr < ram->size; addr += SPI_FLASH_SEC_SIZE) {
+        const size_t len = (ram->size - addr) < SPI_FLASH_SEC_SIZE ? (ram->size - addr) : SPI_FLASH_SEC_SIZE;
+        ESP_GOTO_ON_ERROR(esp_partition_read(ram->partition, addr, block, len), fail, TAG, "Failed to read 0x%x", addr);
+        // Take a copy, the Host or FATFS may write the sector while it is programmed
+        xSemaphoreTake(ram->lock, portMAX_DELAY);
+        const bool changed = memcmp(block, ram->buf + addr, len) != 0;
+        if (changed) {
+            memcpy(block, ram->buf + addr, len);
+        }
+        xSemaphoreGive(ram->lock);
+        if (!changed) {
+            continue;
+        }
+        ESP_GOTO_ON_ERROR(esp_partition_erase_range(ram->partition, addr, SPI_FLASH_SEC_SIZE), fail, TAG, "Failed to erase 0x%x", addr);
+        ESP_GOTO_ON_ERROR(esp_partition_write(ram->partition, addr, block, len), fail, TAG, "Failed to write 0x%x", addr);
+    }
+    free(block);
+    return ESP_OK;
+
+fail:
+    ram->dirty = true; // Saved again on the next eject
+    free(block);
+    return ret;
+}
+
+static void _ramdisk_persist_task(void *arg)
+{
+    msc_ramdisk_t *ram = (msc_ramdisk_t *)arg;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (ram->stop) {
+            break;
+        }
+        if (ram->dirty && _ramdisk_save(ram) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save RAM disk to partition");
+        }
+    }
+    xSemaphoreGive(ram->persist_exit);
+    vTaskDelete(NULL);
+}
+
+static void _eject_ramdisk(tinyusb_msc_storage_handle_s *handle)
+{
+    if (handle->ram->persist_task) {
+        xTaskNotifyGive(handle->ram->persist_task);
+    }
+}
+
+static void _deinit_ramdisk(tinyusb_msc_storage_handle_s *handle)
+{
+    msc_ramdisk_t *ram = handle->ram;
+    if (ram->persist_task) {
+        ram->stop = true;
+        xTaskNotifyGive(ram->persist_task);
+        xSemaphoreTake(ram->persist_exit, portMAX_DELAY);
+    }
+    if (ram->partition && ram->dirty && _ramdisk_save(ram) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save RAM disk on deinit");
+    }
+    if (ram->persist_exit) {
+        vSemaphoreDelete(ram->persist_exit);
+    }
+    if (ram->lock) {
+        vSemaphoreDelete(ram->lock);
+    }
+    if (ram->own_buf) {
+        free(ram->buf);
+    }
+    free(ram);
+}
+/*********************************************************************** RAM disk*/
+
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+static void _async_io_task(void *arg)
+{
+    tinyusb_msc_storage_handle_s *handle = (tinyusb_msc_storage_handle_s *)arg;
+    msc_async_io_t *io = handle->async;
+    uint8_t idx;
+    while (xQueueReceive(io->queue, &idx, portMAX_DELAY) == pdTRUE) {
+        msc_io_slot_t *slot = &io->slot[idx];
+        if (slot->is_write) {
+            slot->err = msc_storage_write_sector(handle, slot->lba, slot->offset, slot->size, slot->buf);
+        } else {
+            slot->err = msc_storage_read_sector(handle, slot->lba, slot->offset, slot->size, slot->buf);
+        }
+        slot->state = MSC_IO_DONE;
+        xSemaphoreGive(io->done);
+    }
+}
+
+static esp_err_t _async_io_create(tinyusb_msc_storage_handle_s *handle)
+{
+    esp_err_t ret = ESP_OK;
+    msc_async_io_t *io = calloc(1, sizeof(msc_async_io_t));
+    ESP_RETURN_ON_FALSE(io, ESP_ERR_NO_MEM, TAG, "could not allocate storage task");
+    for (int i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+#if SOC_SDMMC_HOST_SUPPORTED
+        // Storage DMA works on the slot directly
+        io->slot[i].buf = usb_dma_buf_alloc(CONFIG_TINYUSB_MSC_BUFSIZE, 0);
+#else
+        io->slot[i].buf = malloc(CONFIG_TINYUSB_MSC_BUFSIZE);
+#endif
+        ESP_GOTO_ON_FALSE(io->slot[i].buf, ESP_ERR_NO_MEM, fail, TAG, "could not allocate storage buffer");
+    }
+    io->queue = xQueueCreate(MSC_ASYNC_IO_SLOTS, sizeof(uint8_t));
+    io->done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(io->queue && io->done, ESP_ERR_NO_MEM, fail, TAG, "could not allocate storage task");
+    handle->async = io;
+    xTaskCreatePinnedToCore(_async_io_task, "msc_storage", CONFIG_TINYUSB_MSC_ASYNC_IO_TASK_STACK_SIZE, handle,
+                            CONFIG_TINYUSB_MSC_ASYNC_IO_TASK_PRIORITY, &io->task, CONFIG_TINYUSB_MSC_ASYNC_IO_TASK_AFFINITY);
+    ESP_GOTO_ON_FALSE(io->task, ESP_ERR_NO_MEM, fail, TAG, "create storage task failed");
+    return ESP_OK;
+
+fail:
+    handle->async = NULL;
+    if (io->done) {
+        vSemaphoreDelete(io->done);
+    }
+    if (io->queue) {
+        vQueueDelete(io->queue);
+    }
+    for (int i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+        free(io->slot[i].buf);
+    }
+    free(io);
+    return ret;
+}
+
+// Collect finished writes and drop finished reads. Returns number of free slots.
+static int _async_io_reap(msc_async_io_t *io, bool drop_reads)
+{
+    int free_slots = 0;
+    for (int i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+        msc_io_slot_t *slot = &io->slot[i];
+        if (slot->state == MSC_IO_DONE && (slot->is_write || drop_reads)) {
+            if (slot->is_write && slot->err != ESP_OK && io->write_err == ESP_OK) {
+                io->write_err = slot->err;
+            }
+            slot->state = MSC_IO_FREE;
+        }
+        if (slot->state == MSC_IO_FREE) {
+            free_slots++;
+        }
+    }
+    return free_slots;
+}
+
+static bool _async_io_submit(msc_async_io_t *io, bool is_write, uint32_t lba, uint32_t offset, const void *src, size_t size)
+{
+    for (uint8_t i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+        msc_io_slot_t *slot = &io->slot[i];
+        if (slot->state != MSC_IO_FREE) {
+            continue;
+        }
+        slot->is_write = is_write;
+        slot->lba = lba;
+        slot->offset = offset;
+        slot->size = size;
+        slot->err = ESP_OK;
+        if (is_write) {
+            memcpy(slot->buf, src, size);
+        }
+        slot->state = MSC_IO_BUSY;
+        xQueueSend(io->queue, &i, portMAX_DELAY);
+        return true;
+    }
+    return false;
+}
+
+// Wait for the storage task to finish all jobs
+static esp_err_t _async_io_drain(msc_async_io_t *io)
+{
+    while (_async_io_reap(io, true) != MSC_ASYNC_IO_SLOTS) {
+        xSemaphoreTake(io->done, portMAX_DELAY);
+    }
+    esp_err_t ret = io->write_err;
+    io->write_err = ESP_OK;
+    return ret;
+}
+
+static void _async_io_destroy(msc_async_io_t *io)
+{
+    _async_io_drain(io);
+    vTaskDelete(io->task);
+    vQueueDelete(io->queue);
+    vSemaphoreDelete(io->done);
+    for (int i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+        free(io->slot[i].buf);
+    }
+    free(io);
+}
+
+/**
+ * @brief READ10 through the storage task
+ *
+ * The first chunk of a command is only queued and 0 is returned, so TinyUSB retries later.
+ * Every delivered chunk starts reading of the following one into the other buffer.
+ */
+static int32_t msc_async_read(tinyusb_msc_storage_handle_s *handle, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize)
+{
+    msc_async_io_t *io = handle->async;
+    for (int i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+        msc_io_slot_t *slot = &io->slot[i];
+        if (slot->state == MSC_IO_FREE || slot->is_write ||
+                slot->lba != lba || slot->offset != offset || slot->size < bufsize) {
+            continue;
+        }
+        if (slot->state == MSC_IO_BUSY) {
+            return 0;
+        }
+        esp_err_t err = slot->err;
+        if (err == ESP_OK) {
+            memcpy(buffer, slot->buf, bufsize);
+        }
+        slot->state = MSC_IO_FREE;
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "msc_storage_read_sector failed: 0x%x", err);
+            return -1;
+        }
+        // Prefetch the next chunk of this command
+        const uint32_t sector_size = (handle->sector_size)(handle);
+        const uint32_t next_lba = lba + (offset + bufsize) / sector_size;
+        const uint32_t next_offset = (offset + bufsize) % sector_size;
+        if (next_lba < (handle->sector_count)(handle)) {
+            _async_io_reap(io, false);
+            _async_io_submit(io, false, next_lba, next_offset, NULL, bufsize);
+        }
+        return bufsize;
+    }
+    // Nothing prefetched for this chunk, drop stale data and read it
+    _async_io_reap(io, true);
+    _async_io_submit(io, false, lba, offset, NULL, bufsize);
+    return 0;
 }
-#endif
 
-static esp_err_t msc_storage_read_sector(uint32_t lba,
-        uint32_t offset,
-        size_t size,
-        void *dest)
+/**
+ * @brief WRITE10 through the storage task
+ *
+ * The chunk is copied to a free buffer and acknowledged, while it is programmed by the storage task.
+ * 0 is returned when both buffers are busy, so TinyUSB retries later.
+ */
+static int32_t msc_async_write(tinyusb_msc_storage_handle_s *handle, uint32_t lba, uint32_t offset, const uint8_t *buffer, uint32_t bufsize)
 {
-    assert(s_storage_handle);
-    size_t sector_size = tinyusb_msc_storage_get_sector_size();
-    return (s_storage_handle->read)(sector_size, lba, offset, size, dest);
+    msc_async_io_t *io = handle->async;
+    for (int i = 0; i < MSC_ASYNC_IO_SLOTS; i++) {
+        // Reads queued before this write would deliver stale data
+        if (io->slot[i].state == MSC_IO_BUSY && !io->slot[i].is_write) {
+            return 0;
+        }
+    }
+    _async_io_reap(io, true);
+    if (io->write_err != ESP_OK) {
+        ESP_LOGE(TAG, "msc_storage_write_sector failed: 0x%x", io->write_err);
+        io->write_err = ESP_OK;
+        return -1;
+    }
+    if (!_async_io_submit(io, true, lba, offset, buffer, bufsize)) {
+        return 0;
+    }
+    return bufsize;
 }
+#endif // CONFIG_TINYUSB_MSC_ASYNC_IO
 
-static esp_err_t msc_storage_write_sector(uint32_t lba,
-        uint32_t offset,
-        size_t size,
-        const void *src)
+static esp_err_t msc_storage_sync(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle);
-    if (s_storage_handle->is_fat_mounted) {
-        ESP_LOGE(TAG, "can't write, FAT mounted");
-        return ESP_ERR_INVALID_STATE;
+    assert(handle);
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+    if (handle->async) {
+        ESP_RETURN_ON_ERROR(_async_io_drain(handle->async), TAG, "Failed to write");
     }
-    size_t sector_size = tinyusb_msc_storage_get_sector_size();
-    size_t temp = 0;
-    size_t addr = 0; // Address of the data to be read, relative to the beginning of the partition.
-    ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
-    ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
-
-    if (addr % sector_size != 0 || size % sector_size != 0) {
-        ESP_LOGE(TAG, "Invalid Argument lba(%lu) offset(%lu) size(%u) sector_size(%u)", lba, offset, size, sector_size);
-        return ESP_ERR_INVALID_ARG;
+#endif
+    if (handle->sync) {
+        return (handle->sync)(handle);
     }
-    return (s_storage_handle->write)(sector_size, addr, lba, offset, size, src);
+    return ESP_OK;
 }
 
 static esp_err_t _mount(char *drv, FATFS *fs)
@@ -226,7 +1200,7 @@ static esp_err_t _mount(char *drv, FATFS *fs)
                                      4096);
         ESP_LOGW(TAG, "formatting card, allocation unit size=%d", alloc_unit_size);
         const MKFS_PARM opt = {(BYTE)FM_FAT, 0, 0, 0, alloc_unit_size};
-        fresult = f_mkfs("", &opt, workbuf, workbuf_size); // Use default volume
+        fresult = f_mkfs(drv, &opt, workbuf, workbuf_size);
         if (fresult != FR_OK) {
             ret = ESP_FAIL;
             ESP_LOGE(TAG, "f_mkfs failed (%d)", fresult);
@@ -249,40 +1223,62 @@ fail:
     return ret;
 }
 
-esp_err_t tinyusb_msc_storage_mount(const char *base_path)
+static tinyusb_msc_storage_handle_s *_get_handle(uint8_t lun)
 {
-    esp_err_t ret = ESP_OK;
-    assert(s_storage_handle);
-
-    if (s_storage_handle->is_fat_mounted) {
-        return ESP_OK;
-    }
+    assert(lun < s_lun_count);
+    return s_storage_handle[lun];
+}
 
-    tusb_msc_callback_t cb = s_storage_handle->callback_premount_changed;
+static void _notify(tinyusb_msc_storage_handle_s *handle, tinyusb_msc_event_type_t type)
+{
+    tusb_msc_callback_t cb = (type == TINYUSB_MSC_EVENT_MOUNT_CHANGED) ?
+                             handle->callback_mount_changed : handle->callback_premount_changed;
     if (cb) {
         tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_PREMOUNT_CHANGED,
+            .type = type,
             .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
+                .is_mounted = handle->is_fat_mounted,
+                .lun = handle->lun,
             }
         };
         cb(&event);
     }
+}
+
+static esp_err_t _storage_mount(tinyusb_msc_storage_handle_s *handle, const char *base_path)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (handle->is_fat_mounted) {
+        return ESP_OK;
+    }
+
+    _notify(handle, TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
 
     if (!base_path) {
-        base_path = CONFIG_TINYUSB_MSC_MOUNT_PATH;
+        base_path = handle->default_base_path;
     }
 
+    // FATFS accesses the storage directly, write back everything the host has written
+    ESP_RETURN_ON_ERROR(msc_storage_sync(handle), TAG, "Failed to sync storage");
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    _unmap_reset(handle);
+#endif
+
     // connect driver to FATFS
     BYTE pdrv = 0xFF;
     ESP_RETURN_ON_ERROR(ff_diskio_get_drive(&pdrv), TAG,
                         "The maximum count of volumes is already mounted");
     char drv[3] = {(char)('0' + pdrv), ':', 0};
 
-    ESP_GOTO_ON_ERROR((s_storage_handle->mount)(pdrv), fail, TAG, "Failed pdrv=%d", pdrv);
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    ESP_GOTO_ON_ERROR(_mount_shared(handle, pdrv), fail, TAG, "Failed pdrv=%d", pdrv);
+#else
+    ESP_GOTO_ON_ERROR((handle->mount)(handle, pdrv), fail, TAG, "Failed pdrv=%d", pdrv);
+#endif
 
     FATFS *fs = NULL;
-    ret = esp_vfs_fat_register(base_path, drv, s_storage_handle->max_files, &fs);
+    ret = esp_vfs_fat_register(base_path, drv, handle->max_files, &fs);
     if (ret == ESP_ERR_INVALID_STATE) {
         ESP_LOGD(TAG, "it's okay, already registered with VFS");
     } else if (ret != ESP_OK) {
@@ -292,19 +1288,10 @@ esp_err_t tinyusb_msc_storage_mount(const char *base_path)
 
     ESP_GOTO_ON_ERROR(_mount(drv, fs), fail, TAG, "Failed _mount");
 
-    s_storage_handle->is_fat_mounted = true;
-    s_storage_handle->base_path = base_path;
+    handle->is_fat_mounted = true;
+    handle->base_path = base_path;
 
-    cb = s_storage_handle->callback_mount_changed;
-    if (cb) {
-        tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_MOUNT_CHANGED,
-            .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
-        };
-        cb(&event);
-    }
+    _notify(handle, TINYUSB_MSC_EVENT_MOUNT_CHANGED);
 
     return ret;
 
@@ -313,182 +1300,333 @@ fail:
         esp_vfs_fat_unregister_path(base_path);
     }
     ff_diskio_unregister(pdrv);
-    s_storage_handle->is_fat_mounted = false;
+    s_pdrv_handle[pdrv] = NULL;
+    handle->is_fat_mounted = false;
     ESP_LOGW(TAG, "Failed to mount storage (0x%x)", ret);
     return ret;
 }
 
-esp_err_t tinyusb_msc_storage_unmount(void)
+static esp_err_t _storage_unmount(tinyusb_msc_storage_handle_s *handle)
 {
-    if (!s_storage_handle) {
-        return ESP_FAIL;
-    }
-
-    if (!s_storage_handle->is_fat_mounted) {
+    if (!handle->is_fat_mounted) {
         return ESP_OK;
     }
 
-    tusb_msc_callback_t cb = s_storage_handle->callback_premount_changed;
-    if (cb) {
-        tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_PREMOUNT_CHANGED,
-            .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
-        };
-        cb(&event);
-    }
+    _notify(handle, TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
 
-    esp_err_t err = (s_storage_handle->unmount)();
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    esp_err_t err = _unmount_shared(handle);
+#else
+    esp_err_t err = (handle->unmount)(handle);
+#endif
     if (err) {
         return err;
     }
-    err = esp_vfs_fat_unregister_path(s_storage_handle->base_path);
-    s_storage_handle->base_path = NULL;
-    s_storage_handle->is_fat_mounted = false;
+    err = esp_vfs_fat_unregister_path(handle->base_path);
+    handle->base_path = NULL;
+    handle->is_fat_mounted = false;
 
-    cb = s_storage_handle->callback_mount_changed;
-    if (cb) {
-        tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_MOUNT_CHANGED,
-            .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
-        };
-        cb(&event);
-    }
+    _notify(handle, TINYUSB_MSC_EVENT_MOUNT_CHANGED);
 
     return err;
 }
 
+esp_err_t tinyusb_msc_storage_mount(const char *base_path)
+{
+    return tinyusb_msc_storage_mount_lun(0, base_path);
+}
+
+esp_err_t tinyusb_msc_storage_mount_lun(uint8_t lun, const char *base_path)
+{
+    return _storage_mount(_get_handle(lun), base_path);
+}
+
+esp_err_t tinyusb_msc_storage_unmount(void)
+{
+    return tinyusb_msc_storage_unmount_lun(0);
+}
+
+esp_err_t tinyusb_msc_storage_unmount_lun(uint8_t lun)
+{
+    if (lun >= s_lun_count) {
+        return ESP_FAIL;
+    }
+    return _storage_unmount(s_storage_handle[lun]);
+}
+
 uint32_t tinyusb_msc_storage_get_sector_count(void)
 {
-    assert(s_storage_handle);
-    return (s_storage_handle->sector_count)();
+    return tinyusb_msc_storage_get_sector_count_lun(0);
+}
+
+uint32_t tinyusb_msc_storage_get_sector_count_lun(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    return (handle->sector_count)(handle);
 }
 
 uint32_t tinyusb_msc_storage_get_sector_size(void)
 {
-    assert(s_storage_handle);
-    return (s_storage_handle->sector_size)();
+    return tinyusb_msc_storage_get_sector_size_lun(0);
 }
 
-esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t *config)
+uint32_t tinyusb_msc_storage_get_sector_size_lun(uint8_t lun)
 {
-    assert(!s_storage_handle);
-    s_storage_handle = (tinyusb_msc_storage_handle_s *)malloc(sizeof(tinyusb_msc_storage_handle_s));
-    ESP_RETURN_ON_FALSE(s_storage_handle, ESP_ERR_NO_MEM, TAG, "could not allocate new handle for storage");
-    s_storage_handle->mount = &_mount_spiflash;
-    s_storage_handle->unmount = &_unmount_spiflash;
-    s_storage_handle->sector_count = &_get_sector_count_spiflash;
-    s_storage_handle->sector_size = &_get_sector_size_spiflash;
-    s_storage_handle->read = &_read_sector_spiflash;
-    s_storage_handle->write = &_write_sector_spiflash;
-    s_storage_handle->is_fat_mounted = false;
-    s_storage_handle->base_path = NULL;
-    s_storage_handle->wl_handle = config->wl_handle;
-    // In case the user does not set mount_config.max_files
-    // and for backward compatibility with versions <1.4.2
-    // max_files is set to 2
-    const int max_files = config->mount_config.max_files;
-    s_storage_handle->max_files = max_files > 0 ? max_files : 2;
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    return (handle->sector_size)(handle);
+}
 
-    /* Callbacks setting up*/
-    if (config->callback_mount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED, config->callback_mount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED);
+uint8_t tinyusb_msc_storage_get_lun_count(void)
+{
+    return s_lun_count;
+}
+
+static void _storage_free(tinyusb_msc_storage_handle_s *handle)
+{
+    if (msc_storage_sync(handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to sync storage on deinit");
     }
-    if (config->callback_premount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED, config->callback_premount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
+    if (handle->deinit) {
+        (handle->deinit)(handle);
+    }
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+    if (handle->async) {
+        _async_io_destroy(handle->async);
+    }
+#endif
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+    if (handle->cache) {
+        _cache_destroy(handle->cache);
+    }
+#endif
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    if (handle->unmap) {
+        _unmap_destroy(handle->unmap);
     }
+#endif
+#if SOC_SDMMC_HOST_SUPPORTED
+    free(handle->dma_buf);
+#endif
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    vSemaphoreDelete(handle->io_lock);
+#endif
+    free(handle);
+}
 
-    return ESP_OK;
+static void _set_callbacks(tinyusb_msc_storage_handle_s *handle,
+                           tusb_msc_callback_t callback_mount_changed,
+                           tusb_msc_callback_t callback_premount_changed)
+{
+    handle->callback_mount_changed = callback_mount_changed;
+    handle->callback_premount_changed = callback_premount_changed;
 }
 
-#if SOC_SDMMC_HOST_SUPPORTED
-esp_err_t tinyusb_msc_storage_init_sdmmc(const tinyusb_msc_sdmmc_config_t *config)
+/**
+ * @brief Allocate a storage handle for the next LUN, backend fields are filled by the caller
+ */
+static tinyusb_msc_storage_handle_s *_storage_alloc(int max_files)
 {
-    assert(!s_storage_handle);
-    s_storage_handle = (tinyusb_msc_storage_handle_s *)malloc(sizeof(tinyusb_msc_storage_handle_s));
-    ESP_RETURN_ON_FALSE(s_storage_handle, ESP_ERR_NO_MEM, TAG, "could not allocate new handle for storage");
-    s_storage_handle->mount = &_mount_sdmmc;
-    s_storage_handle->unmount = &_unmount_sdmmc;
-    s_storage_handle->sector_count = &_get_sector_count_sdmmc;
-    s_storage_handle->sector_size = &_get_sector_size_sdmmc;
-    s_storage_handle->read = &_read_sector_sdmmc;
-    s_storage_handle->write = &_write_sector_sdmmc;
-    s_storage_handle->is_fat_mounted = false;
-    s_storage_handle->base_path = NULL;
-    s_storage_handle->card = config->card;
+    tinyusb_msc_storage_handle_s *handle = (tinyusb_msc_storage_handle_s *)calloc(1, sizeof(tinyusb_msc_storage_handle_s));
+    if (!handle) {
+        return NULL;
+    }
+    handle->lun = s_lun_count;
+    if (handle->lun == 0) {
+        strlcpy(handle->default_base_path, CONFIG_TINYUSB_MSC_MOUNT_PATH, sizeof(handle->default_base_path));
+    } else {
+        snprintf(handle->default_base_path, sizeof(handle->default_base_path), "%s%d", CONFIG_TINYUSB_MSC_MOUNT_PATH, handle->lun);
+    }
     // In case the user does not set mount_config.max_files
     // and for backward compatibility with versions <1.4.2
     // max_files is set to 2
-    const int max_files = config->mount_config.max_files;
-    s_storage_handle->max_files = max_files > 0 ? max_files : 2;
+    handle->max_files = max_files > 0 ? max_files : 2;
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    handle->io_lock = xSemaphoreCreateMutex();
+    if (!handle->io_lock) {
+        free(handle);
+        return NULL;
+    }
+#endif
+    return handle;
+}
 
-    /* Callbacks setting up*/
-    if (config->callback_mount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED, config->callback_mount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED);
+// Create the common storage components and make the handle visible to the Host as the next LUN
+static esp_err_t _storage_add(tinyusb_msc_storage_handle_s *handle)
+{
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+    if (!handle->in_memory && _async_io_create(handle) != ESP_OK) {
+        _storage_free(handle);
+        return ESP_ERR_NO_MEM;
     }
-    if (config->callback_premount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED, config->callback_premount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
+#endif
+    s_storage_handle[s_lun_count++] = handle;
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(s_lun_count < CONFIG_TINYUSB_MSC_LUN_MAX, ESP_ERR_INVALID_STATE, TAG,
+                        "maximum count of LUNs (%d) already registered", CONFIG_TINYUSB_MSC_LUN_MAX);
+    tinyusb_msc_storage_handle_s *handle = _storage_alloc(config->mount_config.max_files);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "could not allocate new handle for storage");
+#if CONFIG_TINYUSB_MSC_SPIFLASH_4K_SECTORS
+    // FATFS must use the sectors the Host sees, wear levelling diskio would report its own
+    handle->mount = &_mount_shared;
+    handle->unmount = &_unmount_shared;
+#else
+    handle->mount = &_mount_spiflash;
+    handle->unmount = &_unmount_spiflash;
+#endif
+    handle->sector_count = &_get_sector_count_spiflash;
+    handle->sector_size = &_get_sector_size_spiflash;
+    handle->read = &_read_sector_spiflash;
+    handle->write = &_write_sector_spiflash;
+    handle->is_fat_mounted = false;
+    handle->base_path = NULL;
+    handle->wl_handle = config->wl_handle;
+    _set_callbacks(handle, config->callback_mount_changed, config->callback_premount_changed);
+#if CONFIG_TINYUSB_MSC_SPIFLASH_WRITE_CACHE
+    esp_err_t ret = _cache_create(handle);
+    if (ret != ESP_OK) {
+        _storage_free(handle);
+        return ret;
     }
+    handle->sync = &_sync_spiflash;
+#endif
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    esp_err_t unmap_ret = _unmap_create(handle);
+    if (unmap_ret != ESP_OK) {
+        _storage_free(handle);
+        return unmap_ret;
+    }
+#endif
+    return _storage_add(handle);
+}
 
-    return ESP_OK;
+#if SOC_SDMMC_HOST_SUPPORTED
+esp_err_t tinyusb_msc_storage_init_sdmmc(const tinyusb_msc_sdmmc_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(s_lun_count < CONFIG_TINYUSB_MSC_LUN_MAX, ESP_ERR_INVALID_STATE, TAG,
+                        "maximum count of LUNs (%d) already registered", CONFIG_TINYUSB_MSC_LUN_MAX);
+    tinyusb_msc_storage_handle_s *handle = _storage_alloc(config->mount_config.max_files);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "could not allocate new handle for storage");
+    handle->mount = &_mount_sdmmc;
+    handle->unmount = &_unmount_sdmmc;
+    handle->sector_count = &_get_sector_count_sdmmc;
+    handle->sector_size = &_get_sector_size_sdmmc;
+    handle->read = &_read_sector_sdmmc;
+    handle->write = &_write_sector_sdmmc;
+    handle->is_fat_mounted = false;
+    handle->base_path = NULL;
+    handle->card = config->card;
+    _set_callbacks(handle, config->callback_mount_changed, config->callback_premount_changed);
+    return _storage_add(handle);
 }
 #endif
 
+esp_err_t tinyusb_msc_storage_init_ramdisk(const tinyusb_msc_ramdisk_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(s_lun_count < CONFIG_TINYUSB_MSC_LUN_MAX, ESP_ERR_INVALID_STATE, TAG,
+                        "maximum count of LUNs (%d) already registered", CONFIG_TINYUSB_MSC_LUN_MAX);
+    const uint32_t sector_size = config->sector_size ? config->sector_size : 512;
+    size_t size = 0;
+    ESP_RETURN_ON_FALSE(config->sector_count && !__builtin_umul_overflow(config->sector_count, sector_size, &size),
+                        ESP_ERR_INVALID_ARG, TAG, "invalid RAM disk size");
+    ESP_RETURN_ON_FALSE(!config->persist_partition || config->persist_partition->size >= size, ESP_ERR_INVALID_ARG, TAG,
+                        "RAM disk does not fit into the partition");
+
+    esp_err_t ret = ESP_OK;
+    tinyusb_msc_storage_handle_s *handle = _storage_alloc(config->mount_config.max_files);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "could not allocate new handle for storage");
+    msc_ramdisk_t *ram = calloc(1, sizeof(msc_ramdisk_t));
+    if (!ram) {
+        _storage_free(handle);
+        return ESP_ERR_NO_MEM;
+    }
+    // FATFS goes through the block layer, the memory is its only copy
+    handle->mount = &_mount_shared;
+    handle->unmount = &_unmount_shared;
+    handle->sector_count = &_get_sector_count_ramdisk;
+    handle->sector_size = &_get_sector_size_ramdisk;
+    handle->read = &_read_sector_ramdisk;
+    handle->write = &_write_sector_ramdisk;
+    handle->eject = &_eject_ramdisk;
+    handle->deinit = &_deinit_ramdisk;
+    handle->in_memory = true;
+    handle->is_fat_mounted = false;
+    handle->base_path = NULL;
+    handle->ram = ram;
+    _set_callbacks(handle, config->callback_mount_changed, config->callback_premount_changed);
+
+    ram->size = size;
+    ram->sector_count = config->sector_count;
+    ram->sector_size = sector_size;
+    ram->partition = config->persist_partition;
+    ram->buf = config->buffer;
+    if (!ram->buf) {
+        ram->buf = heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_8BIT);
+        ram->own_buf = true;
+    }
+    ram->lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(ram->buf && ram->lock, ESP_ERR_NO_MEM, fail, TAG, "could not allocate RAM disk");
+
+    if (ram->partition) {
+        ESP_GOTO_ON_ERROR(esp_partition_read(ram->partition, 0, ram->buf, size), fail, TAG, "Failed to load RAM disk");
+        ram->persist_exit = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(ram->persist_exit, ESP_ERR_NO_MEM, fail, TAG, "could not allocate persist task");
+        xTaskCreate(_ramdisk_persist_task, "msc_persist", MSC_RAMDISK_PERSIST_TASK_STACK_SIZE, ram,
+                    MSC_RAMDISK_PERSIST_TASK_PRIORITY, &ram->persist_task);
+        ESP_GOTO_ON_FALSE(ram->persist_task, ESP_ERR_NO_MEM, fail, TAG, "create persist task failed");
+    }
+    return _storage_add(handle);
+
+fail:
+    _storage_free(handle);
+    return ret;
+}
+
 void tinyusb_msc_storage_deinit(void)
 {
-    assert(s_storage_handle);
-    free(s_storage_handle);
-    s_storage_handle = NULL;
+    assert(s_lun_count);
+    while (s_lun_count) {
+        s_lun_count--;
+        _storage_free(s_storage_handle[s_lun_count]);
+        s_storage_handle[s_lun_count] = NULL;
+    }
 }
 
 esp_err_t tinyusb_msc_register_callback(tinyusb_msc_event_type_t event_type,
                                         tusb_msc_callback_t callback)
 {
-    assert(s_storage_handle);
-    switch (event_type) {
-    case TINYUSB_MSC_EVENT_MOUNT_CHANGED:
-        s_storage_handle->callback_mount_changed = callback;
-        return ESP_OK;
-    case TINYUSB_MSC_EVENT_PREMOUNT_CHANGED:
-        s_storage_handle->callback_premount_changed = callback;
-        return ESP_OK;
-    default:
+    assert(s_lun_count);
+    if (event_type != TINYUSB_MSC_EVENT_MOUNT_CHANGED && event_type != TINYUSB_MSC_EVENT_PREMOUNT_CHANGED) {
         ESP_LOGE(TAG, "Wrong event type");
         return ESP_ERR_INVALID_ARG;
     }
+    for (uint8_t lun = 0; lun < s_lun_count; lun++) {
+        tinyusb_msc_storage_handle_s *handle = s_storage_handle[lun];
+        if (event_type == TINYUSB_MSC_EVENT_MOUNT_CHANGED) {
+            handle->callback_mount_changed = callback;
+        } else {
+            handle->callback_premount_changed = callback;
+        }
+    }
+    return ESP_OK;
 }
 
 esp_err_t tinyusb_msc_unregister_callback(tinyusb_msc_event_type_t event_type)
 {
-    assert(s_storage_handle);
-    switch (event_type) {
-    case TINYUSB_MSC_EVENT_MOUNT_CHANGED:
-        s_storage_handle->callback_mount_changed = NULL;
-        return ESP_OK;
-    case TINYUSB_MSC_EVENT_PREMOUNT_CHANGED:
-        s_storage_handle->callback_premount_changed = NULL;
-        return ESP_OK;
-    default:
-        ESP_LOGE(TAG, "Wrong event type");
-        return ESP_ERR_INVALID_ARG;
-    }
+    return tinyusb_msc_register_callback(event_type, NULL);
 }
 
 bool tinyusb_msc_storage_in_use_by_usb_host(void)
 {
-    assert(s_storage_handle);
-    return !s_storage_handle->is_fat_mounted;
+    return tinyusb_msc_storage_in_use_by_usb_host_lun(0);
+}
+
+bool tinyusb_msc_storage_in_use_by_usb_host_lun(uint8_t lun)
+{
+    return !_get_handle(lun)->is_fat_mounted;
 }
 
 
@@ -499,10 +1637,30 @@ bool tinyusb_msc_storage_in_use_by_usb_host(void)
 /** User can add and use more codes as per the need of the application **/
 #define SCSI_CODE_ASC_MEDIUM_NOT_PRESENT 0x3A /** SCSI ASC code for 'MEDIUM NOT PRESENT' **/
 #define SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE 0x20 /** SCSI ASC code for 'INVALID COMMAND OPERATION CODE' **/
+#define SCSI_CODE_ASC_WRITE_ERROR 0x0C /** SCSI ASC code for 'WRITE ERROR' **/
+#define SCSI_CODE_ASC_MEDIUM_MAY_HAVE_CHANGED 0x28 /** SCSI ASC code for 'NOT READY TO READY CHANGE, MEDIUM MAY HAVE CHANGED' **/
+#define SCSI_CODE_ASC_LBA_OUT_OF_RANGE 0x21 /** SCSI ASC code for 'LOGICAL BLOCK ADDRESS OUT OF RANGE' **/
+#define SCSI_CODE_ASC_INVALID_FIELD_IN_CDB 0x24 /** SCSI ASC code for 'INVALID FIELD IN CDB' **/
+#define SCSI_CODE_ASC_WRITE_PROTECTED 0x27 /** SCSI ASC code for 'WRITE PROTECTED' **/
 #define SCSI_CODE_ASCQ 0x00
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10 0x35 /** SCSI SYNCHRONIZE CACHE (10) command **/
+#define SCSI_CMD_UNMAP 0x42 /** SCSI UNMAP command **/
+#define SCSI_CMD_SERVICE_ACTION_IN_16 0x9E /** SCSI SERVICE ACTION IN (16) command **/
+#define SCSI_SA_READ_CAPACITY_16 0x10 /** Service action of SCSI READ CAPACITY (16) command **/
+#define SCSI_VPD_SUPPORTED_PAGES 0x00 /** Supported VPD Pages page **/
+#define SCSI_VPD_BLOCK_LIMITS 0xB0 /** Block Limits VPD page **/
+#define SCSI_VPD_LOGICAL_BLOCK_PROVISIONING 0xB2 /** Logical Block Provisioning VPD page **/
+#define SCSI_UNMAP_DESCRIPTOR_SIZE 16
+#define SCSI_UNMAP_MAX_DESCRIPTORS ((CONFIG_TINYUSB_MSC_BUFSIZE - 8) / SCSI_UNMAP_DESCRIPTOR_SIZE) /** UNMAP parameter list must fit into one buffer **/
 
 // Invoked when received SCSI_CMD_INQUIRY
 // Application fill vendor id, product id and revision with string up to 8, 16, 4 characters respectively
+// Invoked when received GET_MAX_LUN request, return the number of LUNs
+uint8_t tud_msc_get_maxlun_cb(void)
+{
+    return s_lun_count ? s_lun_count : 1;
+}
+
 void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4])
 {
     (void) lun;
@@ -519,14 +1677,26 @@ void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16
 // return true allowing host to read/write this LUN e.g SD card inserted
 bool tud_msc_test_unit_ready_cb(uint8_t lun)
 {
-    (void) lun;
     bool result = false;
-
-    if (s_storage_handle->is_fat_mounted) {
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+
+#if CONFIG_TINYUSB_MSC_SHARED_ACCESS
+    if (handle->media_changed) {
+        // Make the Host drop its cached view of the file system
+        handle->media_changed = false;
+        tud_msc_set_sense(lun, SCSI_SENSE_UNIT_ATTENTION, SCSI_CODE_ASC_MEDIUM_MAY_HAVE_CHANGED, SCSI_CODE_ASCQ);
+        return false;
+    }
+    if (handle->is_fat_mounted) {
+        // Readable by the Host, writes are refused by tud_msc_is_writable_cb()
+        return true;
+    }
+#endif
+    if (handle->is_fat_mounted) {
         tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, SCSI_CODE_ASC_MEDIUM_NOT_PRESENT, SCSI_CODE_ASCQ);
         result = false;
     } else {
-        if (tinyusb_msc_storage_unmount() != ESP_OK) {
+        if (_storage_unmount(handle) != ESP_OK) {
             ESP_LOGW(TAG, "tud_msc_test_unit_ready_cb() unmount Fails");
         }
         result = true;
@@ -534,14 +1704,18 @@ bool tud_msc_test_unit_ready_cb(uint8_t lun)
     return result;
 }
 
+// Invoked to check if the LUN is writable, the storage mounted by the application is read-only for the Host
+bool tud_msc_is_writable_cb(uint8_t lun)
+{
+    return !_get_handle(lun)->is_fat_mounted;
+}
+
 // Invoked when received SCSI_CMD_READ_CAPACITY_10 and SCSI_CMD_READ_FORMAT_CAPACITY to determine the disk size
 // Application update block count and block size
 void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_size)
 {
-    (void) lun;
-
-    uint32_t sec_count = tinyusb_msc_storage_get_sector_count();
-    uint32_t sec_size = tinyusb_msc_storage_get_sector_size();
+    uint32_t sec_count = tinyusb_msc_storage_get_sector_count_lun(lun);
+    uint32_t sec_size = tinyusb_msc_storage_get_sector_size_lun(lun);
     *block_count = sec_count;
     *block_size  = (uint16_t)sec_size;
 }
@@ -551,13 +1725,19 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_siz
 // - Start = 1 : active mode, if load_eject = 1 : load disk storage
 bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject)
 {
-    (void) lun;
     (void) power_condition;
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
 
+    if (!start && msc_storage_sync(handle) != ESP_OK) {
+        ESP_LOGW(TAG, "tud_msc_start_stop_cb() sync Fails");
+    }
     if (load_eject && !start) {
-        if (tinyusb_msc_storage_mount(s_storage_handle->base_path) != ESP_OK) {
+        if (_storage_mount(handle, handle->base_path) != ESP_OK) {
             ESP_LOGW(TAG, "tud_msc_start_stop_cb() mount Fails");
         }
+        if (handle->eject) {
+            (handle->eject)(handle);
+        }
     }
     return true;
 }
@@ -565,12 +1745,19 @@ bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, boo
 // Invoked when received SCSI READ10 command
 // - Address = lba * BLOCK_SIZE + offset
 // - Application fill the buffer (up to bufsize) with address contents and return number of read byte.
+// - Returning 0 makes TinyUSB retry later, negative value fails the command.
 int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize)
 {
-    esp_err_t err = msc_storage_read_sector(lba, offset, bufsize, buffer);
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+    if (handle->async) {
+        return msc_async_read(handle, lba, offset, buffer, bufsize);
+    }
+#endif
+    esp_err_t err = msc_storage_read_sector(handle, lba, offset, bufsize, buffer);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "msc_storage_read_sector failed: 0x%x", err);
-        return 0;
+        return -1;
     }
     return bufsize;
 }
@@ -578,13 +1765,170 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buff
 // Invoked when received SCSI WRITE10 command
 // - Address = lba * BLOCK_SIZE + offset
 // - Application write data from buffer to address contents (up to bufsize) and return number of written byte.
+// - Returning 0 makes TinyUSB retry later, negative value fails the command.
 int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize)
 {
-    esp_err_t err = msc_storage_write_sector(lba, offset, bufsize, buffer);
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+#if CONFIG_TINYUSB_MSC_ASYNC_IO
+    if (handle->async) {
+        return msc_async_write(handle, lba, offset, buffer, bufsize);
+    }
+#endif
+    esp_err_t err = msc_storage_write_sector(handle, lba, offset, bufsize, buffer);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "msc_storage_write_sector failed: 0x%x", err);
-        return 0;
+        return -1;
+    }
+    return bufsize;
+}
+
+static int32_t _scsi_unsupported(uint8_t lun, uint8_t opcode)
+{
+    ESP_LOGW(TAG, "tud_msc_scsi_cb() invoked: %d", opcode);
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE, SCSI_CODE_ASCQ);
+    return -1;
+}
+
+static uint32_t _get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void _put_be32(uint8_t *p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static bool _unmap_supported(tinyusb_msc_storage_handle_s *handle)
+{
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    return handle->unmap != NULL;
+#else
+    (void) handle;
+    return false;
+#endif
+}
+
+/**
+ * @brief Respond to INQUIRY with EVPD bit set
+ *
+ * Block Limits and Logical Block Provisioning pages advertise UNMAP to the Host.
+ * TinyUSB answers the standard INQUIRY itself, so this is called only for requests of VPD pages it leaves to the application.
+ */
+static int32_t _scsi_inquiry_vpd(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t *buffer, uint16_t bufsize)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    const uint16_t alloc_len = ((uint16_t)scsi_cmd[3] << 8) | scsi_cmd[4];
+    uint8_t page[64] = { 0 };
+    uint16_t page_len;
+
+    page[1] = scsi_cmd[2];
+    switch (scsi_cmd[2]) {
+    case SCSI_VPD_SUPPORTED_PAGES:
+        page[4] = SCSI_VPD_SUPPORTED_PAGES;
+        page[5] = SCSI_VPD_BLOCK_LIMITS;
+        page[6] = SCSI_VPD_LOGICAL_BLOCK_PROVISIONING;
+        page_len = 3;
+        break;
+    case SCSI_VPD_BLOCK_LIMITS:
+        page_len = 0x3C;
+        if (_unmap_supported(handle)) {
+            // Unmapped ranges are erased in whole flash erase blocks most efficiently
+            const uint32_t sector_size = tinyusb_msc_storage_get_sector_size_lun(lun);
+            const uint32_t granularity = sector_size < SPI_FLASH_SEC_SIZE ? SPI_FLASH_SEC_SIZE / sector_size : 1;
+            _put_be32(&page[20], tinyusb_msc_storage_get_sector_count_lun(lun));    // MAXIMUM UNMAP LBA COUNT
+            _put_be32(&page[24], SCSI_UNMAP_MAX_DESCRIPTORS);                       // MAXIMUM UNMAP BLOCK DESCRIPTOR COUNT
+            _put_be32(&page[28], granularity);                                      // OPTIMAL UNMAP GRANULARITY
+        }
+        break;
+    case SCSI_VPD_LOGICAL_BLOCK_PROVISIONING:
+        page_len = 4;
+        if (_unmap_supported(handle)) {
+            page[5] = 0x80; // LBPU: UNMAP is supported. Unmapped blocks read as erased flash, not zeros
+            page[6] = 0x02; // Thin provisioned
+        }
+        break;
+    default:
+        tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_INVALID_FIELD_IN_CDB, SCSI_CODE_ASCQ);
+        return -1;
     }
+    page[2] = page_len >> 8;
+    page[3] = page_len & 0xFF;
+    uint16_t len = page_len + 4;
+    len = len < alloc_len ? len : alloc_len;
+    len = len < bufsize ? len : bufsize;
+    memcpy(buffer, page, len);
+    return len;
+}
+
+/**
+ * @brief Respond to READ CAPACITY (16), with Logical Block Provisioning Management enabled if UNMAP is supported
+ */
+static int32_t _scsi_read_capacity_16(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t *buffer, uint16_t bufsize)
+{
+    const uint32_t alloc_len = _get_be32(&scsi_cmd[10]);
+    const uint32_t sector_count = tinyusb_msc_storage_get_sector_count_lun(lun);
+    uint8_t resp[32] = { 0 };
+
+    _put_be32(&resp[4], sector_count ? sector_count - 1 : 0); // Last LBA, upper 32 bits are zero
+    _put_be32(&resp[8], tinyusb_msc_storage_get_sector_size_lun(lun));
+    if (_unmap_supported(_get_handle(lun))) {
+        resp[14] = 0x80; // LBPME
+    }
+    uint32_t len = sizeof(resp);
+    len = len < alloc_len ? len : alloc_len;
+    len = len < bufsize ? len : bufsize;
+    memcpy(buffer, resp, len);
+    return len;
+}
+
+/**
+ * @brief Process UNMAP parameter list received from the Host
+ *
+ * Unmapped sectors are erased in the background, so later writes to them skip the erase.
+ */
+static int32_t _scsi_unmap(uint8_t lun, const uint8_t *param, uint16_t bufsize)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    if (!_unmap_supported(handle)) {
+        tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE, SCSI_CODE_ASCQ);
+        return -1;
+    }
+    if (handle->is_fat_mounted) {
+        tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, SCSI_CODE_ASC_WRITE_PROTECTED, SCSI_CODE_ASCQ);
+        return -1;
+    }
+    if (bufsize < 8) {
+        return bufsize; // No block descriptors
+    }
+    const uint32_t sector_count = tinyusb_msc_storage_get_sector_count_lun(lun);
+    const uint32_t sector_size = tinyusb_msc_storage_get_sector_size_lun(lun);
+    size_t desc_len = ((uint16_t)param[2] << 8) | param[3];
+    desc_len = desc_len < (size_t)(bufsize - 8) ? desc_len : (size_t)(bufsize - 8);
+
+    // Validate all descriptors first, so a failing command does not unmap anything
+    for (size_t i = 0; i + SCSI_UNMAP_DESCRIPTOR_SIZE <= desc_len; i += SCSI_UNMAP_DESCRIPTOR_SIZE) {
+        const uint8_t *desc = &param[8 + i];
+        const uint64_t lba = ((uint64_t)_get_be32(&desc[0]) << 32) | _get_be32(&desc[4]);
+        const uint32_t count = _get_be32(&desc[8]);
+        if (lba + count > sector_count) {
+            tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_LBA_OUT_OF_RANGE, SCSI_CODE_ASCQ);
+            return -1;
+        }
+    }
+#if CONFIG_TINYUSB_MSC_SPIFLASH_UNMAP
+    for (size_t i = 0; i + SCSI_UNMAP_DESCRIPTOR_SIZE <= desc_len; i += SCSI_UNMAP_DESCRIPTOR_SIZE) {
+        const uint8_t *desc = &param[8 + i];
+        const uint32_t lba = _get_be32(&desc[4]);
+        const uint32_t count = _get_be32(&desc[8]);
+        if (count) {
+            _unmap_range(handle, (size_t)lba * sector_size, (size_t)count * sector_size);
+        }
+    }
+#endif
     return bufsize;
 }
 
@@ -615,10 +1959,30 @@ int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer, u
         the storage media/partition. */
         ret = 0;
         break;
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+        if (msc_storage_sync(_get_handle(lun)) != ESP_OK) {
+            tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, SCSI_CODE_ASC_WRITE_ERROR, SCSI_CODE_ASCQ);
+            ret = -1;
+        } else {
+            ret = 0;
+        }
+        break;
+    case SCSI_CMD_UNMAP:
+        ret = _scsi_unmap(lun, buffer, bufsize);
+        break;
+    case SCSI_CMD_INQUIRY:
+        // Standard INQUIRY is answered by TinyUSB, only requests of VPD pages (EVPD bit set) can get here
+        ret = (scsi_cmd[1] & 0x01) ? _scsi_inquiry_vpd(lun, scsi_cmd, buffer, bufsize) : _scsi_unsupported(lun, scsi_cmd[0]);
+        break;
+    case SCSI_CMD_SERVICE_ACTION_IN_16:
+        if ((scsi_cmd[1] & 0x1F) == SCSI_SA_READ_CAPACITY_16) {
+            ret = _scsi_read_capacity_16(lun, scsi_cmd, buffer, bufsize);
+        } else {
+            ret = _scsi_unsupported(lun, scsi_cmd[0]);
+        }
+        break;
     default:
-        ESP_LOGW(TAG, "tud_msc_scsi_cb() invoked: %d", scsi_cmd[0]);
-        tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE, SCSI_CODE_ASCQ);
-        ret = -1;
+        ret = _scsi_unsupported(lun, scsi_cmd[0]);
         break;
     }
     return ret;
@@ -627,14 +1991,23 @@ int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer, u
 // Invoked when device is unmounted
 void tud_umount_cb(void)
 {
-    if (tinyusb_msc_storage_mount(s_storage_handle->base_path) != ESP_OK) {
-        ESP_LOGW(TAG, "tud_umount_cb() mount Fails");
+    for (uint8_t lun = 0; lun < s_lun_count; lun++) {
+        if (_storage_mount(s_storage_handle[lun], s_storage_handle[lun]->base_path) != ESP_OK) {
+            ESP_LOGW(TAG, "tud_umount_cb() mount Fails, lun=%d", lun);
+        }
+        if (s_storage_handle[lun]->eject) {
+            (s_storage_handle[lun]->eject)(s_storage_handle[lun]);
+        }
     }
 }
 
 // Invoked when device is mounted (configured)
 void tud_mount_cb(void)
 {
-    tinyusb_msc_storage_unmount();
+#if !CONFIG_TINYUSB_MSC_SHARED_ACCESS // Otherwise the application keeps the storage mounted
+    for (uint8_t lun = 0; lun < s_lun_count; lun++) {
+        _storage_unmount(s_storage_handle[lun]);
+    }
+#endif
 }
 /*********************************************************************** TinyUSB MSC callbacks*/
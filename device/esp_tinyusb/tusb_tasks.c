@@ -15,6 +15,8 @@
 
 const static char *TAG = "tusb_tsk";
 static TaskHandle_t s_tusb_tskh;
+static tusb_task_init_cb_t s_init_cb;   // Deferred initialization run by the task, NULL if none
+static void *s_init_arg;
 
 #if CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK
 const static int INIT_OK = BIT0;
@@ -27,16 +29,26 @@ const static int INIT_FAILED = BIT1;
 static void tusb_device_task(void *arg)
 {
     ESP_LOGD(TAG, "tinyusb task started");
+    if (s_init_cb) {
+        // Nobody waits for the result, the callback reports it
+        const esp_err_t ret = s_init_cb(s_init_arg);
+        s_init_cb = NULL;
+        if (ret != ESP_OK) {
+            s_tusb_tskh = NULL;
+            vTaskDelete(NULL);
+        }
+    } else {
 #if CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK
-    EventGroupHandle_t *init_flags = arg;
-    if (!tusb_init()) {
-        ESP_LOGI(TAG, "Init TinyUSB stack failed");
-        xEventGroupSetBits(*init_flags, INIT_FAILED);
-        vTaskDelete(NULL);
-    }
-    ESP_LOGD(TAG, "tinyusb task has been initialized");
-    xEventGroupSetBits(*init_flags, INIT_OK);
+        EventGroupHandle_t *init_flags = arg;
+        if (!tusb_init()) {
+            ESP_LOGI(TAG, "Init TinyUSB stack failed");
+            xEventGroupSetBits(*init_flags, INIT_FAILED);
+            vTaskDelete(NULL);
+        }
+        ESP_LOGD(TAG, "tinyusb task has been initialized");
+        xEventGroupSetBits(*init_flags, INIT_OK);
 #endif // CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK
+    }
     while (1) { // RTOS forever loop
         tud_task();
     }
@@ -68,6 +80,22 @@ esp_err_t tusb_run_task(void)
     return ESP_OK;
 }
 
+esp_err_t tusb_run_task_async(tusb_task_init_cb_t init_cb, void *arg)
+{
+    ESP_RETURN_ON_FALSE(init_cb, ESP_ERR_INVALID_ARG, TAG, "Init callback can't be NULL");
+    ESP_RETURN_ON_FALSE(!s_tusb_tskh, ESP_ERR_INVALID_STATE, TAG, "TinyUSB main task already started");
+
+    s_init_cb = init_cb;
+    s_init_arg = arg;
+    xTaskCreatePinnedToCore(tusb_device_task, "TinyUSB", CONFIG_TINYUSB_TASK_STACK_SIZE, NULL, CONFIG_TINYUSB_TASK_PRIORITY, &s_tusb_tskh, CONFIG_TINYUSB_TASK_AFFINITY);
+    if (!s_tusb_tskh) {
+        s_init_cb = NULL;
+        ESP_LOGE(TAG, "create TinyUSB main task failed");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 esp_err_t tusb_stop_task(void)
 {
     ESP_RETURN_ON_FALSE(s_tusb_tskh, ESP_ERR_INVALID_STATE, TAG, "TinyUSB main task not started yet");
@@ -13,11 +13,11 @@
  * Same VID/PID with different interface e.g MSC (first), then CDC (later) will possibly cause system error on PC.
  *
  * Auto ProductID layout's Bitmap:
- *   [MSB]         HID | MSC | CDC          [LSB]
+ *   [MSB]         VIDEO | VENDOR | AUDIO | MIDI | HID | MSC | CDC          [LSB]
  */
 #define _PID_MAP(itf, n) ((CFG_TUD_##itf) << (n))
 #define USB_TUSB_PID (0x4000 | _PID_MAP(CDC, 0) | _PID_MAP(MSC, 1) | _PID_MAP(HID, 2) | \
-    _PID_MAP(MIDI, 3) | _PID_MAP(AUDIO, 4) | _PID_MAP(VENDOR, 5) )
+    _PID_MAP(MIDI, 3) | _PID_MAP(AUDIO, 4) | _PID_MAP(VENDOR, 5) | _PID_MAP(VIDEO, 6) )
 
 /**** Kconfig driven Descriptor ****/
 
@@ -27,8 +27,8 @@ const tusb_desc_device_t descriptor_dev_default = {
     .bDescriptorType = TUSB_DESC_DEVICE,
     .bcdUSB = 0x0200,
 
-#if CFG_TUD_CDC
-    // Use Interface Association Descriptor (IAD) for CDC
+#if CFG_TUD_CDC || CFG_TUD_VIDEO || CFG_TUD_AUDIO
+    // Use Interface Association Descriptor (IAD) for CDC, Video and Audio
     // As required by USB Specs IAD's subclass must be common class (2) and protocol must be IAD (1)
     .bDeviceClass = TUSB_CLASS_MISC,
     .bDeviceSubClass = MISC_SUBCLASS_COMMON,
@@ -68,8 +68,8 @@ const tusb_desc_device_qualifier_t descriptor_qualifier_default = {
     .bDescriptorType = TUSB_DESC_DEVICE_QUALIFIER,
     .bcdUSB = 0x0200,
 
-#if CFG_TUD_CDC
-    // Use Interface Association Descriptor (IAD) for CDC
+#if CFG_TUD_CDC || CFG_TUD_VIDEO || CFG_TUD_AUDIO
+    // Use Interface Association Descriptor (IAD) for CDC, Video and Audio
     // As required by USB Specs IAD's subclass must be common class (2) and protocol must be IAD (1)
     .bDeviceClass = TUSB_CLASS_MISC,
     .bDeviceSubClass = MISC_SUBCLASS_COMMON,
@@ -110,9 +110,156 @@ const char *descriptor_str_default[] = {
 #if CFG_TUD_VENDOR
     "Vendor specific",                       // 8. Vendor specific
 #endif
+
+#if CFG_TUD_VIDEO
+    CONFIG_TINYUSB_DESC_UVC_STRING,          // 9: UVC Interface
+#endif
+
+#if CFG_TUD_AUDIO
+    CONFIG_TINYUSB_DESC_UAC_STRING,          // 10: UAC Interface
+#endif
     NULL                                     // NULL: Must be last. Indicates end of array
 };
 
+//------------- Video Class -------------//
+#if CFG_TUD_VIDEO
+#define UVC_CLOCK_FREQUENCY     27000000
+#define UVC_ENTITY_CAMERA       1
+#define UVC_ENTITY_OUTPUT       2
+#define UVC_FRAME_INTERVAL      (10000000 / CONFIG_TINYUSB_UVC_FPS) // In 100 ns units
+#define UVC_FRAME_BITS          (CONFIG_TINYUSB_UVC_WIDTH * CONFIG_TINYUSB_UVC_HEIGHT * 16)
+
+// One format with one frame size. The Host may select lower frame rate, down to 1 fps
+#if CONFIG_TINYUSB_UVC_FORMAT_MJPEG
+#define UVC_DESC_FORMAT_LEN (TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN + TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN)
+#define UVC_DESC_FORMAT() \
+    TUD_VIDEO_DESC_CS_VS_FMT_MJPEG(1, 1, 0, 1, 0, 0, 0, 0), \
+    TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(1, 0, CONFIG_TINYUSB_UVC_WIDTH, CONFIG_TINYUSB_UVC_HEIGHT, \
+        UVC_FRAME_BITS, UVC_FRAME_BITS * CONFIG_TINYUSB_UVC_FPS, UVC_FRAME_BITS / 8, \
+        UVC_FRAME_INTERVAL, UVC_FRAME_INTERVAL, UVC_FRAME_INTERVAL * CONFIG_TINYUSB_UVC_FPS, UVC_FRAME_INTERVAL)
+#else
+#define UVC_DESC_FORMAT_LEN (TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN)
+#define UVC_DESC_FORMAT() \
+    TUD_VIDEO_DESC_CS_VS_FMT_YUY2(1, 1, 1, 0, 0, 0, 0), \
+    TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(1, 0, CONFIG_TINYUSB_UVC_WIDTH, CONFIG_TINYUSB_UVC_HEIGHT, \
+        UVC_FRAME_BITS, UVC_FRAME_BITS * CONFIG_TINYUSB_UVC_FPS, UVC_FRAME_BITS / 8, \
+        UVC_FRAME_INTERVAL, UVC_FRAME_INTERVAL, UVC_FRAME_INTERVAL * CONFIG_TINYUSB_UVC_FPS, UVC_FRAME_INTERVAL)
+#endif // CONFIG_TINYUSB_UVC_FORMAT_MJPEG
+
+#if CONFIG_TINYUSB_UVC_BULK
+#define UVC_EP_SIZE_FS          64
+#define UVC_EP_SIZE_HS          512
+#define UVC_ALT0_EP_COUNT       1
+#define UVC_DESC_EP_LEN         7
+#define UVC_DESC_EP(_stridx, _epin, _epsize) \
+    TUD_VIDEO_DESC_EP_BULK(_epin, _epsize, 1)
+#else
+// Alternate setting 0 doesn't reserve bandwidth, the Host selects alternate setting 1 to stream
+// Full-speed packet is limited by the FIFO of ESP32-S2/S3 USB OTG
+#define UVC_EP_SIZE_FS          512
+#define UVC_EP_SIZE_HS          1024
+#define UVC_ALT0_EP_COUNT       0
+#define UVC_DESC_EP_LEN         (TUD_VIDEO_DESC_STD_VS_LEN + 7)
+#define UVC_DESC_EP(_stridx, _epin, _epsize) \
+    TUD_VIDEO_DESC_STD_VS(ITF_NUM_VIDEO_STREAMING, 1, 1, _stridx), \
+    TUD_VIDEO_DESC_EP_ISO(_epin, _epsize, 1)
+#endif // CONFIG_TINYUSB_UVC_BULK
+
+#define UVC_DESC_LEN (TUD_VIDEO_DESC_IAD_LEN + TUD_VIDEO_DESC_STD_VC_LEN + (TUD_VIDEO_DESC_CS_VC_LEN + 1) + \
+    TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN + TUD_VIDEO_DESC_STD_VS_LEN + \
+    (TUD_VIDEO_DESC_CS_VS_IN_LEN + 1) + UVC_DESC_FORMAT_LEN + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN + UVC_DESC_EP_LEN)
+
+// Camera terminal connected to streaming interface, string index, EP In address and size
+#define UVC_DESCRIPTOR(_stridx, _epin, _epsize) \
+    TUD_VIDEO_DESC_IAD(ITF_NUM_VIDEO_CONTROL, 2, _stridx), \
+    TUD_VIDEO_DESC_STD_VC(ITF_NUM_VIDEO_CONTROL, 0, _stridx), \
+    TUD_VIDEO_DESC_CS_VC(0x0150, TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN, \
+        UVC_CLOCK_FREQUENCY, ITF_NUM_VIDEO_STREAMING), \
+    TUD_VIDEO_DESC_CAMERA_TERM(UVC_ENTITY_CAMERA, 0, 0, 0, 0, 0, 0), \
+    TUD_VIDEO_DESC_OUTPUT_TERM(UVC_ENTITY_OUTPUT, VIDEO_TT_STREAMING, 0, UVC_ENTITY_CAMERA, 0), \
+    TUD_VIDEO_DESC_STD_VS(ITF_NUM_VIDEO_STREAMING, 0, UVC_ALT0_EP_COUNT, _stridx), \
+    TUD_VIDEO_DESC_CS_VS_INPUT(1, UVC_DESC_FORMAT_LEN + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN, \
+        _epin, 0, UVC_ENTITY_OUTPUT, 0, 0, 0, 0), \
+    UVC_DESC_FORMAT(), \
+    TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M), \
+    UVC_DESC_EP(_stridx, _epin, _epsize)
+#endif // CFG_TUD_VIDEO
+
+//------------- Audio Class -------------//
+#if CFG_TUD_AUDIO
+#define UAC_ENTITY_CLOCK        1
+#define UAC_ENTITY_SPK_INPUT    2
+#define UAC_ENTITY_SPK_OUTPUT   3
+#define UAC_ENTITY_MIC_INPUT    4
+#define UAC_ENTITY_MIC_OUTPUT   5
+#define UAC_ISO_EP_ATTR         (TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS | TUSB_ISO_EP_ATT_DATA)
+#define UAC_DESC_LEN            TUSB_UAC_DESC_LEN
+
+#if CONFIG_TINYUSB_UAC_SPEAKER && CONFIG_TINYUSB_UAC_MIC
+#define UAC_FUNC_CATEGORY       AUDIO_FUNC_HEADSET
+#elif CONFIG_TINYUSB_UAC_SPEAKER
+#define UAC_FUNC_CATEGORY       AUDIO_FUNC_DESKTOP_SPEAKER
+#else
+#define UAC_FUNC_CATEGORY       AUDIO_FUNC_MICROPHONE
+#endif
+
+// Written out, the length argument of TinyUSB feedback endpoint template differs between TinyUSB versions
+#define UAC_DESC_FB_EP(_ep, _interval) \
+    TUSB_UAC_FB_EP_DESC_LEN, TUSB_DESC_ENDPOINT, _ep, (TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_NO_SYNC | TUSB_ISO_EP_ATT_EXPLICIT_FB), \
+    U16_TO_U8S_LE(4), _interval
+
+// Streaming interface with zero bandwidth alternate setting 0 and streaming alternate setting 1
+#define UAC_DESC_AS(_itfnum, _termid, _nch, _nep, _ep, _epsize) \
+    TUD_AUDIO_DESC_STD_AS_INT(_itfnum, 0, 0, 0), \
+    TUD_AUDIO_DESC_STD_AS_INT(_itfnum, 1, _nep, 0), \
+    TUD_AUDIO_DESC_CS_AS_INT(_termid, AUDIO_CTRL_NONE, AUDIO_FORMAT_TYPE_I, AUDIO_DATA_FORMAT_TYPE_I_PCM, _nch, \
+        AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0), \
+    TUD_AUDIO_DESC_TYPE_I_FORMAT(TUSB_UAC_BYTES_PER_SAMPLE, TUSB_UAC_BITS_PER_SAMPLE), \
+    TUD_AUDIO_DESC_STD_AS_ISO_EP(_ep, UAC_ISO_EP_ATTR, _epsize, 1), \
+    TUD_AUDIO_DESC_CS_AS_ISO_EP(AUDIO_CS_AS_ISO_DATA_EP_ATT_NON_MAX_PACKETS_OK, AUDIO_CTRL_NONE, \
+        AUDIO_CS_AS_ISO_DATA_EP_LOCK_DELAY_UNIT_UNDEFINED, 0)
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+#define UAC_DESC_SPK_AC() \
+    TUD_AUDIO_DESC_INPUT_TERM(UAC_ENTITY_SPK_INPUT, AUDIO_TERM_TYPE_USB_STREAMING, 0, UAC_ENTITY_CLOCK, \
+        CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0, 0, 0), \
+    TUD_AUDIO_DESC_OUTPUT_TERM(UAC_ENTITY_SPK_OUTPUT, AUDIO_TERM_TYPE_OUT_GENERIC_SPEAKER, 0, UAC_ENTITY_SPK_INPUT, UAC_ENTITY_CLOCK, 0, 0),
+#define UAC_DESC_SPK_AS(_frames_per_s) \
+    UAC_DESC_AS(ITF_NUM_AUDIO_SPK, UAC_ENTITY_SPK_INPUT, CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS, 2, EPNUM_AUDIO_SPK, \
+        TUSB_UAC_EP_SIZE(_frames_per_s, CONFIG_TINYUSB_UAC_SPEAKER_CHANNELS)), \
+    UAC_DESC_FB_EP(0x80 | EPNUM_AUDIO_SPK, 1),
+#else
+#define UAC_DESC_SPK_AC()
+#define UAC_DESC_SPK_AS(_frames_per_s)
+#endif // CONFIG_TINYUSB_UAC_SPEAKER
+
+#if CONFIG_TINYUSB_UAC_MIC
+#define UAC_DESC_MIC_AC() \
+    TUD_AUDIO_DESC_INPUT_TERM(UAC_ENTITY_MIC_INPUT, AUDIO_TERM_TYPE_IN_GENERIC_MIC, 0, UAC_ENTITY_CLOCK, \
+        CONFIG_TINYUSB_UAC_MIC_CHANNELS, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0, 0, 0), \
+    TUD_AUDIO_DESC_OUTPUT_TERM(UAC_ENTITY_MIC_OUTPUT, AUDIO_TERM_TYPE_USB_STREAMING, 0, UAC_ENTITY_MIC_INPUT, UAC_ENTITY_CLOCK, 0, 0),
+#define UAC_DESC_MIC_AS(_frames_per_s) \
+    UAC_DESC_AS(ITF_NUM_AUDIO_MIC, UAC_ENTITY_MIC_OUTPUT, CONFIG_TINYUSB_UAC_MIC_CHANNELS, 1, 0x80 | EPNUM_AUDIO_MIC, \
+        TUSB_UAC_EP_SIZE(_frames_per_s, CONFIG_TINYUSB_UAC_MIC_CHANNELS)),
+#else
+#define UAC_DESC_MIC_AC()
+#define UAC_DESC_MIC_AS(_frames_per_s)
+#endif // CONFIG_TINYUSB_UAC_MIC
+
+// Internal programmable clock shared by both streams, (micro)frames per second to size the endpoints
+#define UAC_DESCRIPTOR(_stridx, _frames_per_s) \
+    TUD_AUDIO_DESC_IAD(ITF_NUM_AUDIO_CONTROL, CFG_TUD_AUDIO_FUNC_1_N_AS_INT + 1, _stridx), \
+    TUD_AUDIO_DESC_STD_AC(ITF_NUM_AUDIO_CONTROL, 0, _stridx), \
+    TUD_AUDIO_DESC_CS_AC(0x0200, UAC_FUNC_CATEGORY, \
+        TUD_AUDIO_DESC_CLK_SRC_LEN + TUSB_UAC_SPK_AC_DESC_LEN + TUSB_UAC_MIC_AC_DESC_LEN, 0), \
+    TUD_AUDIO_DESC_CLK_SRC(UAC_ENTITY_CLOCK, AUDIO_CLOCK_SOURCE_ATT_INT_PRO_CLK, \
+        (AUDIO_CTRL_RW << AUDIO_CLOCK_SOURCE_CTRL_CLK_FRQ_POS) | (AUDIO_CTRL_R << AUDIO_CLOCK_SOURCE_CTRL_CLK_VAL_POS), 0, 0), \
+    UAC_DESC_SPK_AC() \
+    UAC_DESC_MIC_AC() \
+    UAC_DESC_SPK_AS(_frames_per_s) \
+    UAC_DESC_MIC_AS(_frames_per_s)
+#endif // CFG_TUD_AUDIO
+
 //------------- Interfaces enumeration -------------//
 enum {
 #if CFG_TUD_CDC
@@ -142,6 +289,23 @@ enum {
     ITF_VENDOR1,
 #endif
 
+#if CFG_TUD_VIDEO
+    ITF_NUM_VIDEO_CONTROL,
+    ITF_NUM_VIDEO_STREAMING,
+#endif
+
+#if CFG_TUD_AUDIO
+    ITF_NUM_AUDIO_CONTROL,
+#endif
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    ITF_NUM_AUDIO_SPK,
+#endif
+
+#if CONFIG_TINYUSB_UAC_MIC
+    ITF_NUM_AUDIO_MIC,
+#endif
+
     ITF_NUM_TOTAL
 };
 
@@ -150,7 +314,9 @@ enum {
                           CFG_TUD_CDC * TUD_CDC_DESC_LEN +
                           CFG_TUD_MSC * TUD_MSC_DESC_LEN +
                           CFG_TUD_NCM * TUD_CDC_NCM_DESC_LEN +
-                          CFG_TUD_VENDOR * TUD_VENDOR_DESC_LEN
+                          CFG_TUD_VENDOR * TUD_VENDOR_DESC_LEN +
+                          CFG_TUD_VIDEO * UVC_DESC_LEN +
+                          CFG_TUD_AUDIO * UAC_DESC_LEN
 };
 
 //------------- USB Endpoint numbers -------------//
@@ -181,7 +347,19 @@ enum {
 #endif
 
 #if CFG_TUD_VENDOR > 1
-    EPNUM_1_VENDOR
+    EPNUM_1_VENDOR,
+#endif
+
+#if CFG_TUD_VIDEO
+    EPNUM_VIDEO,
+#endif
+
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    EPNUM_AUDIO_SPK,    // Data OUT and feedback IN
+#endif
+
+#if CONFIG_TINYUSB_UAC_MIC
+    EPNUM_AUDIO_MIC,
 #endif
 };
 
@@ -207,6 +385,14 @@ enum {
 #if CFG_TUD_VENDOR
     STRID_VENDOR_INTERFACE,
 #endif
+
+#if CFG_TUD_VIDEO
+    STRID_UVC_INTERFACE,
+#endif
+
+#if CFG_TUD_AUDIO
+    STRID_UAC_INTERFACE,
+#endif
 };
 
 //------------- Configuration Descriptor -------------//
@@ -243,6 +429,16 @@ uint8_t const descriptor_fs_cfg_default[] = {
     // Interface number, string index, EP Out & IN address, EP size
     TUD_VENDOR_DESCRIPTOR(ITF_VENDOR1, STRID_VENDOR_INTERFACE, EPNUM_1_VENDOR, 0x80 | EPNUM_1_VENDOR, 64),
 #endif
+
+#if CFG_TUD_VIDEO
+    // String index, EP In address, EP size
+    UVC_DESCRIPTOR(STRID_UVC_INTERFACE, 0x80 | EPNUM_VIDEO, UVC_EP_SIZE_FS),
+#endif
+
+#if CFG_TUD_AUDIO
+    // String index, frames per second
+    UAC_DESCRIPTOR(STRID_UAC_INTERFACE, 1000)
+#endif
 };
 
 #if (TUD_OPT_HIGH_SPEED)
@@ -279,6 +475,16 @@ uint8_t const descriptor_hs_cfg_default[] = {
     // Interface number, string index, EP Out & IN address, EP size
     TUD_VENDOR_DESCRIPTOR(ITF_VENDOR1, STRID_VENDOR_INTERFACE, EPNUM_1_VENDOR, 0x80 | EPNUM_1_VENDOR, 512),
 #endif
+
+#if CFG_TUD_VIDEO
+    // String index, EP In address, EP size
+    UVC_DESCRIPTOR(STRID_UVC_INTERFACE, 0x80 | EPNUM_VIDEO, UVC_EP_SIZE_HS),
+#endif
+
+#if CFG_TUD_AUDIO
+    // String index, microframes per second
+    UAC_DESCRIPTOR(STRID_UAC_INTERFACE, 8000)
+#endif
 };
 #endif // TUD_OPT_HIGH_SPEED
 
@@ -288,4 +494,24 @@ uint8_t tusb_get_mac_string_id(void)
     return STRID_MAC;
 }
 #endif
+
+#if CFG_TUD_AUDIO
+uint8_t tusb_get_uac_speaker_itf(void)
+{
+#if CONFIG_TINYUSB_UAC_SPEAKER
+    return ITF_NUM_AUDIO_SPK;
+#else
+    return 0xFF;
+#endif
+}
+
+uint8_t tusb_get_uac_mic_itf(void)
+{
+#if CONFIG_TINYUSB_UAC_MIC
+    return ITF_NUM_AUDIO_MIC;
+#else
+    return 0xFF;
+#endif
+}
+#endif
 /* End of Kconfig driven Descriptor */
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdio_ext.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/errno.h>
 #include <sys/fcntl.h>
@@ -17,8 +18,12 @@
 #include "esp_log.h"
 #include "esp_vfs.h"
 #include "esp_vfs_dev.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "tinyusb.h"
 #include "tusb_cdc_acm.h"
+#include "tusb_cdc_acm_priv.h"
 #include "vfs_tinyusb.h"
 #include "sdkconfig.h"
 
@@ -52,6 +57,17 @@ const static char *TAG = "tusb_vfs";
 #   define DEFAULT_RX_MODE ESP_LINE_ENDINGS_LF
 #endif
 
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+typedef struct tusb_select_args_s {
+    esp_vfs_select_sem_t select_sem;
+    fd_set *readfds;
+    fd_set *writefds;
+    fd_set readfds_orig;
+    fd_set writefds_orig;
+    struct tusb_select_args_s *next;
+} tusb_select_args_t;
+#endif // CONFIG_VFS_SUPPORT_SELECT
+
 typedef struct {
     _lock_t write_lock;
     _lock_t read_lock;
@@ -60,6 +76,12 @@ typedef struct {
     uint32_t flags;
     char vfs_path[VFS_TUSB_MAX_PATH];
     int cdc_intf;
+    SemaphoreHandle_t rx_sem;   // Given on data received, blocking reads wait on it
+    uint32_t rx_timeout_ticks;  // Timeout of blocking reads
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    _lock_t select_lock;
+    tusb_select_args_t *select_list; // Pending select() calls
+#endif // CONFIG_VFS_SUPPORT_SELECT
 } vfs_tinyusb_t;
 
 static vfs_tinyusb_t s_vfstusb;
@@ -93,8 +115,17 @@ static esp_err_t vfstusb_init(int cdc_intf, char const *path)
     s_vfstusb.cdc_intf = cdc_intf;
     s_vfstusb.tx_mode = DEFAULT_TX_MODE;
     s_vfstusb.rx_mode = DEFAULT_RX_MODE;
+    s_vfstusb.rx_timeout_ticks = portMAX_DELAY;
 
-    return apply_path(path);
+    esp_err_t ret = apply_path(path);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s_vfstusb.rx_sem = xSemaphoreCreateBinary();
+    if (s_vfstusb.rx_sem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
 }
 
 /**
@@ -104,14 +135,57 @@ static void vfstusb_deinit(void)
 {
     _lock_close(&(s_vfstusb.write_lock));
     _lock_close(&(s_vfstusb.read_lock));
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    _lock_close(&(s_vfstusb.select_lock));
+#endif // CONFIG_VFS_SUPPORT_SELECT
+    if (s_vfstusb.rx_sem) {
+        vSemaphoreDelete(s_vfstusb.rx_sem);
+    }
     memset(&s_vfstusb, 0, sizeof(s_vfstusb));
 }
 
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+/**
+ * @brief Mark the file as ready in pending select() calls waiting for it
+ *
+ * @param rx - true for readable, false for writable
+ */
+static void select_notify(bool rx)
+{
+    _lock_acquire(&(s_vfstusb.select_lock));
+    for (tusb_select_args_t *args = s_vfstusb.select_list; args != NULL; args = args->next) {
+        if (FD_ISSET(0, rx ? &args->readfds_orig : &args->writefds_orig)) {
+            FD_SET(0, rx ? args->readfds : args->writefds);
+            esp_vfs_select_triggered(args->select_sem);
+        }
+    }
+    _lock_release(&(s_vfstusb.select_lock));
+}
+#endif // CONFIG_VFS_SUPPORT_SELECT
+
+static void vfstusb_notify_rx(int itf)
+{
+    (void) itf;
+    xSemaphoreGive(s_vfstusb.rx_sem);
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    select_notify(true);
+#endif // CONFIG_VFS_SUPPORT_SELECT
+}
+
+static void vfstusb_notify_tx(int itf)
+{
+    (void) itf;
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    select_notify(false);
+#endif // CONFIG_VFS_SUPPORT_SELECT
+}
+
 static int tusb_open(const char *path, int flags, int mode)
 {
     (void) mode;
     (void) path;
-    s_vfstusb.flags = flags | O_NONBLOCK; // for now only non-blocking mode is implemented
+    // Non-blocking by default, clear O_NONBLOCK with fcntl() to get blocking reads
+    s_vfstusb.flags = flags | O_NONBLOCK;
     return 0;
 }
 
@@ -119,31 +193,33 @@ static ssize_t tusb_write(int fd, const void *data, size_t size)
 {
     FD_CHECK(fd, -1);
     size_t written_sz = 0;
-    const char *data_c = (const char *)data;
+    const int itf = s_vfstusb.cdc_intf;
+    const uint8_t *data_c = (const uint8_t *)data;
     _lock_acquire(&(s_vfstusb.write_lock));
-    for (size_t i = 0; i < size; i++) {
-        int c = data_c[i];
-        if (c != '\n') {
-            if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, c)) {
-                break; // can't write anymore
-            }
-        } else {
-            if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF || s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CR) {
-                char cr = '\r';
-                if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, cr)) {
-                    break; // can't write anymore
-                }
+    if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_LF) {
+        // No conversion, queue everything at once
+        written_sz = tinyusb_cdcacm_write_queue(itf, data_c, size);
+    } else {
+        const char *eol = (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF) ? "\r\n" : "\r";
+        const size_t eol_len = strlen(eol);
+        while (written_sz < size) {
+            // Queue the run of characters up to the next newline in one go
+            const uint8_t *nl = memchr(data_c + written_sz, '\n', size - written_sz);
+            const size_t run = (nl ? (size_t)(nl - data_c) : size) - written_sz;
+            const size_t queued = tinyusb_cdcacm_write_queue(itf, data_c + written_sz, run);
+            written_sz += queued;
+            if (queued < run || !nl) {
+                break; // can't write anymore or all written
             }
-            if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF || s_vfstusb.tx_mode == ESP_LINE_ENDINGS_LF) {
-                char lf = '\n';
-                if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, lf)) {
-                    break; // can't write anymore
-                }
+            if (tud_cdc_n_write_available(itf) < eol_len) {
+                break; // can't write anymore
             }
+            tinyusb_cdcacm_write_queue(itf, (const uint8_t *)eol, eol_len);
+            written_sz++;
         }
-        written_sz++;
     }
-    tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
+    // Full packets are sent by TinyUSB while queuing, this only starts the remainder
+    tud_cdc_n_write_flush(itf);
     _lock_release(&(s_vfstusb.write_lock));
     return written_sz;
 }
@@ -159,10 +235,17 @@ static ssize_t tusb_read(int fd, void *data, size_t size)
     FD_CHECK(fd, -1);
     char *data_c = (char *) data;
     size_t received = 0;
+    TimeOut_t timeout;
+    TickType_t ticks_to_wait = s_vfstusb.rx_timeout_ticks;
     _lock_acquire(&(s_vfstusb.read_lock));
 
-    if (tud_cdc_n_available(s_vfstusb.cdc_intf) == 0) {
-        goto finish;
+    vTaskSetTimeOutState(&timeout);
+    while (tud_cdc_n_available(s_vfstusb.cdc_intf) == 0) {
+        if ((s_vfstusb.flags & O_NONBLOCK) || xTaskCheckForTimeOut(&timeout, &ticks_to_wait)) {
+            goto finish;
+        }
+        // Woken up by the RX notification, stale one only causes another check
+        xSemaphoreTake(s_vfstusb.rx_sem, ticks_to_wait);
     }
     while (received < size) {
         int c = tud_cdc_n_read_char(s_vfstusb.cdc_intf);
@@ -229,6 +312,62 @@ static int tusb_fcntl(int fd, int cmd, int arg)
     return result;
 }
 
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+static esp_err_t tusb_start_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+                                   esp_vfs_select_sem_t select_sem, void **end_select_args)
+{
+    (void) nfds;
+    *end_select_args = NULL;
+    tusb_select_args_t *args = calloc(1, sizeof(tusb_select_args_t));
+    if (args == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    args->select_sem = select_sem;
+    args->readfds = readfds;
+    args->writefds = writefds;
+    args->readfds_orig = *readfds;
+    args->writefds_orig = *writefds;
+    FD_ZERO(readfds);
+    FD_ZERO(writefds);
+    FD_ZERO(exceptfds);
+
+    _lock_acquire(&(s_vfstusb.select_lock));
+    args->next = s_vfstusb.select_list;
+    s_vfstusb.select_list = args;
+    // Notifications report only new events, check what is ready already
+    if (FD_ISSET(0, &args->readfds_orig) && tud_cdc_n_available(s_vfstusb.cdc_intf)) {
+        FD_SET(0, readfds);
+        esp_vfs_select_triggered(select_sem);
+    }
+    if (FD_ISSET(0, &args->writefds_orig) && tud_cdc_n_write_available(s_vfstusb.cdc_intf)) {
+        FD_SET(0, writefds);
+        esp_vfs_select_triggered(select_sem);
+    }
+    _lock_release(&(s_vfstusb.select_lock));
+
+    *end_select_args = args;
+    return ESP_OK;
+}
+
+static esp_err_t tusb_end_select(void *end_select_args)
+{
+    tusb_select_args_t *args = end_select_args;
+    if (args == NULL) {
+        return ESP_OK;
+    }
+    _lock_acquire(&(s_vfstusb.select_lock));
+    for (tusb_select_args_t **it = &s_vfstusb.select_list; *it != NULL; it = &(*it)->next) {
+        if (*it == args) {
+            *it = args->next;
+            break;
+        }
+    }
+    _lock_release(&(s_vfstusb.select_lock));
+    free(args);
+    return ESP_OK;
+}
+#endif // CONFIG_VFS_SUPPORT_SELECT
+
 esp_err_t esp_vfs_tusb_cdc_unregister(char const *path)
 {
     ESP_LOGD(TAG, "Unregistering CDC-VFS driver");
@@ -250,6 +389,7 @@ esp_err_t esp_vfs_tusb_cdc_unregister(char const *path)
         ESP_LOGE(TAG, "Can't unregister CDC-VFS driver from '%s' (err: 0x%x)", s_vfstusb.vfs_path, res);
     } else {
         ESP_LOGD(TAG, "Unregistered CDC-VFS driver");
+        tinyusb_cdcacm_set_notify(s_vfstusb.cdc_intf, NULL, NULL);
         vfstusb_deinit();
     }
     return res;
@@ -266,6 +406,7 @@ esp_err_t esp_vfs_tusb_cdc_register(int cdc_intf, char const *path)
 
     res = vfstusb_init(cdc_intf, path);
     if (res != ESP_OK) {
+        vfstusb_deinit();
         return res;
     }
 
@@ -277,12 +418,18 @@ esp_err_t esp_vfs_tusb_cdc_register(int cdc_intf, char const *path)
         .open = &tusb_open,
         .read = &tusb_read,
         .write = &tusb_write,
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+        .start_select = &tusb_start_select,
+        .end_select = &tusb_end_select,
+#endif // CONFIG_VFS_SUPPORT_SELECT
     };
 
     res = esp_vfs_register(s_vfstusb.vfs_path, &vfs, NULL);
     if (res != ESP_OK) {
         ESP_LOGE(TAG, "Can't register CDC-VFS driver (err: %x)", res);
+        vfstusb_deinit();
     } else {
+        tinyusb_cdcacm_set_notify(cdc_intf, vfstusb_notify_rx, vfstusb_notify_tx);
         ESP_LOGD(TAG, "CDC-VFS registered (%s)", s_vfstusb.vfs_path);
     }
     return res;
@@ -295,6 +442,13 @@ void esp_vfs_tusb_cdc_set_rx_line_endings(esp_line_endings_t mode)
     _lock_release(&(s_vfstusb.read_lock));
 }
 
+void esp_vfs_tusb_cdc_set_rx_timeout(uint32_t timeout_ticks)
+{
+    _lock_acquire(&(s_vfstusb.read_lock));
+    s_vfstusb.rx_timeout_ticks = timeout_ticks;
+    _lock_release(&(s_vfstusb.read_lock));
+}
+
 void esp_vfs_tusb_cdc_set_tx_line_endings(esp_line_endings_t mode)
 {
     _lock_acquire(&(s_vfstusb.write_lock));
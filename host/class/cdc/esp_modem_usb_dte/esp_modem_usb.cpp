@@ -4,9 +4,16 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_modem_config.h"
 #include "esp_modem_usb_config.h"
 #include "cxx_include/esp_modem_dte.hpp"
@@ -19,6 +26,11 @@
 
 static const char *TAG = "usb_terminal";
 
+#define USB_TERM_OUT_TRANSFER_COUNT (2)    // Double-buffered OUT: one transfer is filled while the other one is on the bus
+#define USB_TERM_TX_TIMEOUT_MS      (1000) // Time to wait for a free OUT transfer
+#define USB_TERM_DATA_IN_TRANSFER_COUNT (2)  // IN transfers of data terminal in dual-terminal mode, so the modem is polled while PPP frames are processed
+#define USB_TERM_REATTACH_TIMEOUT_MS (1000) // Reattach task checks for terminal destruction at least this often
+
 /**
  * @brief USB Host task
  *
@@ -47,7 +59,11 @@ static void usb_host_task(void *arg)
 namespace esp_modem {
 class UsbTerminal : public Terminal, private CdcAcmDevice {
 public:
-    explicit UsbTerminal(const esp_modem_dte_config *config, int term_idx): buffer_size(config->dte_buffer_size)
+    explicit UsbTerminal(const esp_modem_dte_config *config, int term_idx)
+        : buffer_size(config->dte_buffer_size), chunk_size(tx_chunk_size(config->dte_buffer_size)), tx_failed(false),
+          lent_data(nullptr), lent_len(0),
+          vid(0), pid(0), intf_idx(0), cdc_compliant(false), dev_config{}, attached(false), reattach_task(nullptr), reattach_exit(nullptr), reattach_stop(false),
+          owner(nullptr), idx(term_idx), stats{}, rx_cb_time_us(0), stats_lock(portMUX_INITIALIZER_UNLOCKED)
     {
         const struct esp_modem_usb_term_config *usb_config = (struct esp_modem_usb_term_config *)(config->extension_config);
 
@@ -76,34 +92,95 @@ public:
         cdc_acm_host_install(&esp_modem_cdc_acm_driver_config);
 
         // Open CDC-ACM device
-        const cdc_acm_host_device_config_t esp_modem_cdc_acm_device_config = {
-            .connection_timeout_ms = usb_config->timeout_ms,
-            .out_buffer_size = config->dte_buffer_size,
-            .in_buffer_size = config->dte_buffer_size,
-            .event_cb = handle_notif,
-            .data_cb = handle_rx,
-            .user_arg = this
-        };
+        dev_config.connection_timeout_ms = usb_config->timeout_ms;
+        dev_config.out_buffer_size = config->dte_buffer_size;
+        dev_config.in_buffer_size = config->dte_buffer_size;
+        dev_config.event_cb = handle_notif;
+        dev_config.data_cb = handle_rx;
+        dev_config.user_arg = this;
+        dev_config.out_transfer_count = USB_TERM_OUT_TRANSFER_COUNT;
 
         // Determine Terminal interface index
-        const uint8_t intf_idx = term_idx == 0 ? usb_config->interface_idx : usb_config->secondary_interface_idx;
+        vid = usb_config->vid;
+        pid = usb_config->pid;
+        intf_idx = term_idx == 0 ? usb_config->interface_idx : usb_config->secondary_interface_idx;
+        cdc_compliant = usb_config->cdc_compliant;
 
-        if (usb_config->cdc_compliant) {
-            ESP_MODEM_THROW_IF_ERROR(
-                this->CdcAcmDevice::open(usb_config->vid, usb_config->pid, intf_idx, &esp_modem_cdc_acm_device_config),
-                "USB Device open failed");
-        } else {
-            ESP_MODEM_THROW_IF_ERROR(
-                this->CdcAcmDevice::open_vendor_specific(usb_config->vid, usb_config->pid, intf_idx, &esp_modem_cdc_acm_device_config),
-                "USB Device open failed");
+        // Dual-terminal mode: both interfaces share the cached descriptors of the USB device in CDC-ACM driver.
+        // Each terminal gets its own RX context, so a burst of PPP frames on the data terminal does not delay AT responses
+        if (usb_config->secondary_interface_idx > -1) {
+            const bool at_term = term_idx == 0;
+            if (!at_term) {
+                dev_config.in_transfer_count = USB_TERM_DATA_IN_TRANSFER_COUNT;
+            }
+            if (usb_config->rx_task_stack_size) {
+                dev_config.rx_task.stack_size = usb_config->rx_task_stack_size;
+                dev_config.rx_task.priority = at_term ? config->task_priority + 1 : config->task_priority;
+                dev_config.rx_task.xCoreID = usb_config->xCoreID;
+            }
+        }
+
+        // The opened device is closed by ~CdcAcmDevice() if the constructor throws
+        ESP_MODEM_THROW_IF_ERROR(open_device(), "USB Device open failed");
+        attached = true;
+
+        if (usb_config->auto_reattach) {
+            reattach_exit = xSemaphoreCreateBinary();
+            ESP_MODEM_THROW_IF_FALSE(reattach_exit != nullptr, "USB reattach semaphore failed");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            registry.push_back(this);
+        }
+
+        // Created last, nothing can throw after the task got this terminal
+        if (reattach_exit && pdTRUE != xTaskCreatePinnedToCore(reattach_task_fn, "usb_reattach", 3072, this, config->task_priority, &reattach_task, usb_config->xCoreID)) {
+            registry_remove();
+            vSemaphoreDelete(reattach_exit);
+            ESP_MODEM_THROW_IF_FALSE(false, "USB reattach task failed");
         }
     };
 
     ~UsbTerminal()
     {
+        registry_remove();
+        if (reattach_task) {
+            reattach_stop = true;
+            xTaskNotifyGive(reattach_task);
+            xSemaphoreTake(reattach_exit, portMAX_DELAY);
+            vSemaphoreDelete(reattach_exit);
+        }
+        std::lock_guard<std::mutex> lock(dev_mutex);
+        attached = false;
         this->CdcAcmDevice::close();
     };
 
+    /**
+     * @brief Find terminal of a DTE and copy its statistics
+     */
+    static esp_err_t get_stats(const DTE *dte, int term_idx, esp_modem_usb_term_stats_t *out)
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto *term : registry) {
+            if (term->owner == dte && term->idx == term_idx) {
+                portENTER_CRITICAL(&term->stats_lock);
+                *out = term->stats;
+                portEXIT_CRITICAL(&term->stats_lock);
+                out->rx_fill_avg = out->rx_transfers ? (uint32_t)(out->rx_bytes * 100 / ((uint64_t)out->rx_transfers * term->buffer_size)) : 0;
+                out->rx_cb_latency_avg_us = out->rx_transfers ? (uint32_t)(term->rx_cb_time_us / out->rx_transfers) : 0;
+                return ESP_OK;
+            }
+        }
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    void set_owner(const DTE *dte)
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        owner = dte;
+    }
+
     void start() override
     {
         return;
@@ -117,13 +194,34 @@ public:
     int write(uint8_t *data, size_t len) override
     {
         ESP_LOG_BUFFER_HEXDUMP(TAG, data, len, ESP_LOG_DEBUG);
+        if (tx_failed) {
+            // Report asynchronous failure of previous write
+            tx_failed = false;
+            return -1;
+        }
+        if (!attached) {
+            return -1; // Do not wait for the reattach task, which holds dev_mutex while the modem is away
+        }
+        std::lock_guard<std::mutex> lock(dev_mutex);
+        // Data are copied into a free OUT transfer and submitted, so the next chunk is copied while the previous one is sent.
+        // All chunks but the last one are multiples of MPS, the device thus never sees a short packet in the middle of a write
         uint8_t *ptr = data;
         size_t remain = len;
         while (remain > 0) {
-            int batch = std::min(buffer_size, remain);
-            if (this->CdcAcmDevice::tx_blocking(ptr, batch) != ESP_OK) {
+            const size_t batch = std::min(chunk_size, remain);
+            esp_err_t ret = this->CdcAcmDevice::tx_async(ptr, batch, handle_tx_done, this, 0);
+            if (ret == ESP_ERR_TIMEOUT) {
+                // Both OUT transfers are in flight: the USB bus is the bottleneck
+                stats_add(&esp_modem_usb_term_stats_t::tx_buffer_full, 1);
+                ret = this->CdcAcmDevice::tx_async(ptr, batch, handle_tx_done, this, USB_TERM_TX_TIMEOUT_MS);
+            }
+            if (ret != ESP_OK) {
                 return -1;
             }
+            portENTER_CRITICAL(&stats_lock);
+            stats.tx_bytes += batch;
+            stats.tx_transfers++;
+            portEXIT_CRITICAL(&stats_lock);
             remain -= batch;
             ptr += batch;
         }
@@ -132,9 +230,17 @@ public:
 
     int read(uint8_t *data, size_t len) override
     {
-        // This function should never be called. UsbTerminal provides data through Terminal::on_read callback
-        ESP_LOGW(TAG, "Unexpected call to UsbTerminal::read function");
-        return -1;
+        // UsbTerminal lends the USB IN buffer through Terminal::on_read callback, the data can be parsed in place.
+        // Consumers that read into their own buffer can only do so from on_read, while the buffer is lent
+        if (lent_data == nullptr) {
+            ESP_LOGD(TAG, "No data lent to UsbTerminal::read");
+            return 0;
+        }
+        const size_t read_len = std::min(len, lent_len);
+        memcpy(data, lent_data, read_len);
+        lent_data += read_len;
+        lent_len -= read_len;
+        return read_len;
     }
 
 private:
@@ -145,18 +251,117 @@ private:
     bool operator!= (const UsbTerminal &param) const = delete;
     static TaskHandle_t usb_host_lib_task; // Reused by multiple devices or between reconnections
 
+    void registry_remove()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    }
+
+    /**
+     * @brief Lend received data to the DTE
+     *
+     * The DTE gets a pointer directly into the USB IN buffer, no copy is made here.
+     * If on_read returns false (e.g. incomplete AT response or PPP frame), the CDC-ACM driver keeps the buffer
+     * and lends it again together with the next data. The buffer is released once on_read returns true.
+     */
     static bool handle_rx(const uint8_t *data, size_t data_len, void *user_arg)
     {
         ESP_LOG_BUFFER_HEXDUMP(TAG, data, data_len, ESP_LOG_DEBUG);
         auto *this_terminal = static_cast<UsbTerminal *>(user_arg);
         if (data_len > 0 && this_terminal->on_read) {
-            return this_terminal->on_read((uint8_t *)data, data_len);
+            this_terminal->lent_data = data;
+            this_terminal->lent_len = data_len;
+            const int64_t start = esp_timer_get_time();
+            const bool released = this_terminal->on_read((uint8_t *)data, data_len);
+            const uint32_t latency = (uint32_t)(esp_timer_get_time() - start);
+            this_terminal->lent_data = nullptr;
+            this_terminal->lent_len = 0;
+
+            portENTER_CRITICAL(&this_terminal->stats_lock);
+            esp_modem_usb_term_stats_t *stats = &this_terminal->stats;
+            stats->rx_bytes += data_len;
+            stats->rx_transfers++;
+            stats->rx_buffer_full += data_len >= this_terminal->buffer_size ? 1 : 0;
+            stats->rx_cb_latency_max_us = std::max(stats->rx_cb_latency_max_us, latency);
+            this_terminal->rx_cb_time_us += latency;
+            portEXIT_CRITICAL(&this_terminal->stats_lock);
+            return released;
         } else {
             ESP_LOGD(TAG, "Unhandled RX data");
             return true;
         }
     }
 
+    static void handle_tx_done(esp_err_t status, void *user_arg)
+    {
+        if (status != ESP_OK) {
+            ESP_LOGW(TAG, "USB write failed: %s", esp_err_to_name(status));
+            auto *this_terminal = static_cast<UsbTerminal *>(user_arg);
+            this_terminal->tx_failed = true;
+            this_terminal->stats_add(&esp_modem_usb_term_stats_t::tx_errors, 1);
+        }
+    }
+
+    void stats_add(uint32_t esp_modem_usb_term_stats_t::*counter, uint32_t value)
+    {
+        portENTER_CRITICAL(&stats_lock);
+        stats.*counter += value;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+
+    /**
+     * @brief Get size of write chunks
+     *
+     * The size is rounded down to a multiple of MPS of both full-speed (64 B) and high-speed (512 B) bulk endpoints,
+     * so full chunks end on a packet boundary and no zero length packet is needed to terminate them.
+     */
+    static size_t tx_chunk_size(size_t buffer_size)
+    {
+        const size_t align = buffer_size >= 512 ? 512 : 64;
+        return buffer_size >= align ? buffer_size - buffer_size % align : buffer_size;
+    }
+
+    esp_err_t open_device()
+    {
+        if (cdc_compliant) {
+            return this->CdcAcmDevice::open(vid, pid, intf_idx, &dev_config);
+        }
+        return this->CdcAcmDevice::open_vendor_specific(vid, pid, intf_idx, &dev_config);
+    }
+
+    /**
+     * @brief Reopen the terminal's interface when the modem re-enumerates
+     *
+     * The terminal and its DTE are kept, only the CDC-ACM device is opened again with the stored configuration.
+     * cdc_acm_host_open() is woken up by the new device, so the terminal is usable right after enumeration of the modem.
+     */
+    static void reattach_task_fn(void *arg)
+    {
+        auto *this_terminal = static_cast<UsbTerminal *>(arg);
+        this_terminal->dev_config.connection_timeout_ms = USB_TERM_REATTACH_TIMEOUT_MS;
+        while (!this_terminal->reattach_stop) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            while (!this_terminal->reattach_stop) {
+                esp_err_t ret;
+                {
+                    std::lock_guard<std::mutex> lock(this_terminal->dev_mutex);
+                    ret = this_terminal->open_device();
+                    this_terminal->attached = ret == ESP_OK;
+                }
+                if (ret == ESP_OK) {
+                    ESP_LOGI(TAG, "USB terminal reattached");
+                    break;
+                }
+                if (ret != ESP_ERR_NOT_FOUND) {
+                    ESP_LOGW(TAG, "USB terminal reattach failed: %s", esp_err_to_name(ret));
+                    vTaskDelay(pdMS_TO_TICKS(100));
+                }
+            }
+        }
+        xSemaphoreGive(this_terminal->reattach_exit);
+        vTaskDelete(NULL);
+    }
+
     static void handle_notif(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
     {
         auto *this_terminal = static_cast<UsbTerminal *>(user_ctx);
@@ -172,10 +377,19 @@ private:
             if (this_terminal->on_error) {
                 this_terminal->on_error(terminal_error::DEVICE_GONE);
             }
-            this_terminal->close();
+            {
+                // Waits for a write() in progress, which fails within USB_TERM_TX_TIMEOUT_MS now
+                std::lock_guard<std::mutex> lock(this_terminal->dev_mutex);
+                this_terminal->attached = false;
+                this_terminal->close();
+            }
+            if (this_terminal->reattach_task) {
+                xTaskNotifyGive(this_terminal->reattach_task);
+            }
             break;
         case CDC_ACM_HOST_ERROR:
             ESP_LOGE(TAG, "Unexpected CDC-ACM error: %d.", event->data.error);
+            this_terminal->stats_add(&esp_modem_usb_term_stats_t::host_errors, 1);
             if (this_terminal->on_error) {
                 this_terminal->on_error(terminal_error::UNEXPECTED_CONTROL_FLOW);
             }
@@ -185,8 +399,31 @@ private:
         }
     }
     size_t buffer_size;
+    size_t chunk_size;
+    volatile bool tx_failed; // Set from USB Host context if an OUT transfer of previous write failed
+    const uint8_t *lent_data; // Unread part of USB IN buffer lent to on_read, nullptr outside of on_read
+    size_t lent_len;
+    uint16_t vid;
+    uint16_t pid;
+    uint8_t intf_idx;
+    bool cdc_compliant;
+    cdc_acm_host_device_config_t dev_config; // Kept for reattaching
+    std::mutex dev_mutex;                    // Serializes open and close of the device with write(), the reattach task opens it from another task
+    std::atomic<bool> attached;              // The device is open, written under dev_mutex
+    TaskHandle_t reattach_task;              // nullptr if auto_reattach is disabled
+    SemaphoreHandle_t reattach_exit;
+    volatile bool reattach_stop;
+    const DTE *owner;                  // DTE owning this terminal, set once the DTE is created
+    int idx;                           // 0: primary terminal, 1: secondary terminal
+    esp_modem_usb_term_stats_t stats;  // Derived averages are computed in get_stats()
+    uint64_t rx_cb_time_us;            // Total time spent in on_read
+    portMUX_TYPE stats_lock;           // Counters are updated from the USB Host and CDC-ACM contexts and from write()
+    static std::vector<UsbTerminal *> registry; // Created terminals, so the C API can find them by their DTE
+    static std::mutex registry_mutex;
 };
 TaskHandle_t UsbTerminal::usb_host_lib_task = nullptr;
+std::vector<UsbTerminal *> UsbTerminal::registry;
+std::mutex UsbTerminal::registry_mutex;
 
 std::unique_ptr<Terminal> create_usb_terminal(const esp_modem_dte_config *config, int term_idx)
 {
@@ -194,4 +431,16 @@ std::unique_ptr<Terminal> create_usb_terminal(const esp_modem_dte_config *config
         return std::make_unique<UsbTerminal>(config, term_idx);
     )
 }
+
+void bind_usb_terminal(Terminal *term, const DTE *dte)
+{
+    if (term) {
+        static_cast<UsbTerminal *>(term)->set_owner(dte);
+    }
+}
+
+esp_err_t get_usb_terminal_stats(const DTE *dte, int term_idx, esp_modem_usb_term_stats_t *stats)
+{
+    return UsbTerminal::get_stats(dte, term_idx, stats);
+}
 } // namespace esp_modem
@@ -24,12 +24,19 @@ std::shared_ptr<DTE> create_usb_dte(const dte_config *config)
     // *INDENT-OFF*
     TRY_CATCH_RET_NULL(
         auto primary_term = create_usb_terminal(config);
+        Terminal *primary = primary_term.get();
         auto *usb_config = static_cast<struct esp_modem_usb_term_config *>(config->extension_config);
         if (usb_config->secondary_interface_idx > -1) {
             auto secondary_term = create_usb_terminal(config, 1);
-            return std::make_shared<DTE>(config, std::move(primary_term), std::move(secondary_term));
+            Terminal *secondary = secondary_term.get();
+            auto dte = std::make_shared<DTE>(config, std::move(primary_term), std::move(secondary_term));
+            bind_usb_terminal(primary, dte.get());
+            bind_usb_terminal(secondary, dte.get());
+            return dte;
         }
-        return std::make_shared<DTE>(config, std::move(primary_term));
+        auto dte = std::make_shared<DTE>(config, std::move(primary_term));
+        bind_usb_terminal(primary, dte.get());
+        return dte;
     )
     // *INDENT-ON*
 }
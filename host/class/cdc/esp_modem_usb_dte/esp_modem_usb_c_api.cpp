@@ -7,6 +7,7 @@
 #include "esp_modem_usb_c_api.h"
 #include "cxx_include/esp_modem_usb_api.hpp"
 #include "esp_private/c_api_wrapper.hpp"
+#include "usb_terminal.hpp"
 
 using namespace esp_modem;
 
@@ -32,3 +33,11 @@ extern "C" esp_modem_dce_t *esp_modem_new_dev_usb(esp_modem_dce_device_t module,
     dce_wrap->dte_type = esp_modem_dce_wrap::modem_wrap_dte_type::USB;
     return dce_wrap;
 }
+
+extern "C" esp_err_t esp_modem_usb_get_term_stats(esp_modem_dce_t *dce_wrap, int term_idx, esp_modem_usb_term_stats_t *stats)
+{
+    if (dce_wrap == nullptr || stats == nullptr || dce_wrap->dte_type != esp_modem_dce_wrap::modem_wrap_dte_type::USB) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return get_usb_terminal_stats(dce_wrap->dte.get(), term_idx, stats);
+}
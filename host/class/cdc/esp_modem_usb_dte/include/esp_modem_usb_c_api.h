@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <stdint.h>
+#include "esp_err.h"
 #include "esp_modem_c_api_types.h"
 
 #ifdef __cplusplus
@@ -24,6 +26,39 @@ extern "C" {
  */
 esp_modem_dce_t *esp_modem_new_dev_usb(esp_modem_dce_device_t module, const esp_modem_dte_config_t *dte_config, const esp_modem_dce_config_t *dce_config, esp_netif_t *netif);
 
+/**
+ * @brief Statistics of USB terminal
+ *
+ * Counters run from creation of the terminal. Low rx_fill_avg with high rx_transfers points to the modem sending small packets,
+ * high rx_buffer_full or tx_buffer_full to the USB bus and high rx_cb_latency to the consumer of received data (e.g. lwIP).
+ */
+typedef struct {
+    uint64_t rx_bytes;             /*!< Received bytes passed to the DTE */
+    uint64_t tx_bytes;             /*!< Bytes submitted for transmission */
+    uint32_t rx_transfers;         /*!< Received data deliveries to the DTE */
+    uint32_t tx_transfers;         /*!< Submitted OUT transfers */
+    uint32_t rx_fill_avg;          /*!< Average fill of received data in [%] of dte_buffer_size */
+    uint32_t rx_cb_latency_avg_us; /*!< Average time spent in the DTE's receive callback in [us] */
+    uint32_t rx_cb_latency_max_us; /*!< Maximum time spent in the DTE's receive callback in [us] */
+    uint32_t rx_buffer_full;       /*!< Received data that filled the whole buffer: the modem probably had more data ready */
+    uint32_t tx_buffer_full;       /*!< Writes that had to wait for a free OUT transfer */
+    uint32_t tx_errors;            /*!< Failed OUT transfers */
+    uint32_t host_errors;          /*!< CDC_ACM_HOST_ERROR events */
+} esp_modem_usb_term_stats_t;
+
+/**
+ * @brief Get statistics of a USB terminal
+ *
+ * @param[in]  dce      DCE created by esp_modem_new_dev_usb()
+ * @param[in]  term_idx Terminal index. 0: primary terminal, 1: secondary terminal
+ * @param[out] stats    Statistics of the terminal
+ *
+ * @return ESP_OK on success
+ *         ESP_ERR_INVALID_ARG if the DCE does not use USB DTE
+ *         ESP_ERR_NOT_FOUND if the DTE has no such terminal
+ */
+esp_err_t esp_modem_usb_get_term_stats(esp_modem_dce_t *dce, int term_idx, esp_modem_usb_term_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,7 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief USB configuration structure
@@ -21,6 +22,10 @@ struct esp_modem_usb_term_config {
     int xCoreID;                 /*!< Core affinity of created tasks: CDC-ACM driver task and optional USB Host task */
     bool cdc_compliant;          /*!< Treat the USB device as CDC-compliant. Read CDC-ACM driver documentation for more details */
     bool install_usb_host;       /*!< Flag whether USB Host driver should be installed */
+    size_t rx_task_stack_size;   /*!< Dual-terminal mode only: stack size of per-terminal RX tasks. The AT terminal's task runs above the data terminal's,
+                                      so AT responses are not delayed by PPP traffic. Set to 0 to receive data of both terminals in CDC-ACM driver task */
+    bool auto_reattach;          /*!< Reopen the terminal when the same VID/PID reappears (e.g. after modem reset) instead of recreating the DTE.
+                                      DEVICE_GONE error is still reported on disconnection */
 };
 
 /**
@@ -55,7 +60,9 @@ struct esp_modem_usb_term_config {
         .timeout_ms = 0,                                             \
         .xCoreID = 0,                                                \
         .cdc_compliant = false,                                      \
-        .install_usb_host = true                                     \
+        .install_usb_host = true,                                    \
+        .rx_task_stack_size = 3072,                                  \
+        .auto_reattach = false                                       \
     }
 #define ESP_MODEM_DEFAULT_USB_CONFIG(_vid, _pid, _intf) ESP_MODEM_DEFAULT_USB_CONFIG_DUAL(_vid, _pid, _intf, -1)
 
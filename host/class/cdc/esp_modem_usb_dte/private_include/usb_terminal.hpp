@@ -6,6 +6,7 @@
 
 #pragma once
 #include "cxx_include/esp_modem_dte.hpp"
+#include "esp_modem_usb_c_api.h"
 
 struct esp_modem_dte_config;
 
@@ -18,4 +19,22 @@ namespace esp_modem {
  * @return std::unique_ptr<Terminal>
  */
 std::unique_ptr<Terminal> create_usb_terminal(const esp_modem_dte_config *config, int term_idx = 0);
+
+/**
+ * @brief Bind usb terminal to its DTE, so its statistics can be found by get_usb_terminal_stats()
+ *
+ * @param[in] term Terminal created by create_usb_terminal(). Can be nullptr
+ * @param[in] dte  DTE owning the terminal
+ */
+void bind_usb_terminal(Terminal *term, const DTE *dte);
+
+/**
+ * @brief Get statistics of a usb terminal
+ *
+ * @param[in]  dte      DTE owning the terminal
+ * @param[in]  term_idx Terminal index. 0: primary terminal, 1: secondary terminal.
+ * @param[out] stats    Statistics of the terminal
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the DTE has no such usb terminal
+ */
+esp_err_t get_usb_terminal_stats(const DTE *dte, int term_idx, esp_modem_usb_term_stats_t *stats);
 }  // namespace esp_modem
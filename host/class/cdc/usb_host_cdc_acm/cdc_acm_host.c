@@ -8,16 +8,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/queue.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/event_groups.h"
-#include "soc/soc_caps.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_system.h"
+#include "esp_idf_version.h"
 
 #include "usb/usb_host.h"
+#include "usb/usb_host_shared_client.h"
+#include "usb/usb_host_urb_pool.h"
+#include "usb/usb_host_class_trace.h"
+#include "usb/usb_class_stats.h"
+#include "usb/usb_dma_buf.h"
 #include "usb/cdc_acm_host.h"
 #include "cdc_host_descriptor_parsing.h"
 #include "cdc_host_types.h"
@@ -27,12 +33,19 @@ static const char *TAG = "cdc_acm";
 // Control transfer constants
 #define CDC_ACM_CTRL_TRANSFER_SIZE (64)   // All standard CTRL requests and responses fit in this size
 #define CDC_ACM_CTRL_TIMEOUT_MS    (5000) // Every CDC device should be able to respond to CTRL transfer in 5 seconds
+#define CDC_ACM_IN_XFER_COUNT_MAX  (8)    // More IN transfers in flight do not reduce latency of the data callback any further
+#define CDC_ACM_OUT_XFER_COUNT_MAX (8)    // Limit of OUT transfers for cdc_acm_host_data_tx_async()
+#define CDC_ACM_NOTIF_LOG_INTERVAL_MS (1000) // Unsupported notifications are logged at most once per interval
+#define CDC_ACM_ANY_ADDR           (0)    // USB address 0 is never assigned to an enumerated device
+#define CDC_ACM_AUTO_OPEN_QUEUE_LEN (16)  // New devices waiting for an auto-open task
 
 // CDC-ACM spinlock
 static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
 #define CDC_ACM_ENTER_CRITICAL()   portENTER_CRITICAL(&cdc_acm_lock)
 #define CDC_ACM_EXIT_CRITICAL()    portEXIT_CRITICAL(&cdc_acm_lock)
 
+#define CDC_ACM_TRACE(event, xfer) USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_CDC_ACM, USB_HOST_CLASS_TRACE_##event, xfer)
+
 // CDC-ACM events
 #define CDC_ACM_TEARDOWN          BIT0
 #define CDC_ACM_TEARDOWN_COMPLETE BIT1
@@ -51,13 +64,26 @@ static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
             }                                                               \
 })
 
+// Auto-open service
+typedef struct {
+    cdc_acm_host_auto_open_config_t config;             /*!< Copy of user's configuration */
+    QueueHandle_t dev_queue;                            /*!< Addresses of new devices, CDC_ACM_ANY_ADDR stops a task */
+    SemaphoreHandle_t task_exit;                        /*!< Given by each task when it exits */
+    size_t task_count;                                  /*!< Number of created tasks */
+    int refs;                                           /*!< cdc_acm_new_dev_handle() is sending to dev_queue, protected by cdc_acm_lock */
+} cdc_acm_auto_open_t;
+
 // CDC-ACM driver object
 typedef struct {
     usb_host_client_handle_t cdc_acm_client_hdl;        /*!< USB Host handle reused for all CDC-ACM devices in the system */
-    SemaphoreHandle_t open_close_mutex;
+    usb_host_shared_client_driver_handle_t shared_driver; /*!< Handle in the shared client, NULL if the driver has its own client */
+    SemaphoreHandle_t open_close_mutex;                 /*!< Serializes changes of cdc_devices_list, it is not held while waiting for device connection */
+    int open_pending;                                   /*!< Number of cdc_acm_host_open() calls waiting for device connection */
     EventGroupHandle_t event_group;
     cdc_acm_new_dev_callback_t new_dev_cb;
+    cdc_acm_auto_open_t *auto_open;                     /*!< Auto-open service, NULL if it is not running */
     SLIST_HEAD(list_dev, cdc_dev_s) cdc_devices_list;   /*!< List of open pseudo devices */
+    SLIST_HEAD(list_usb_dev, cdc_usb_dev_s) usb_devices_list; /*!< List of USB devices used by pseudo devices, with cached descriptors */
 } cdc_acm_obj_t;
 
 static cdc_acm_obj_t *p_cdc_acm_obj = NULL;
@@ -101,6 +127,24 @@ static void in_xfer_cb(usb_transfer_t *transfer);
  */
 static void out_xfer_cb(usb_transfer_t *transfer);
 
+/**
+ * @brief Asynchronous data send callback
+ *
+ * Informs the user and returns the transfer to the queue of free transfers
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void out_async_xfer_cb(usb_transfer_t *transfer);
+
+/**
+ * @brief Encapsulated response callback
+ *
+ * Delivers the response to the user and reads the next one, if it was announced meanwhile
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void encapsulated_response_xfer_cb(usb_transfer_t *transfer);
+
 /**
  * @brief USB Host Client event callback
  *
@@ -111,6 +155,20 @@ static void out_xfer_cb(usb_transfer_t *transfer);
  */
 static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg);
 
+/**
+ * @brief USB Host shared client probe
+ *
+ * The match table matches any interface, because CDC-ACM devices are opened by VID/PID and also by vendor specific interfaces.
+ *
+ * @param[in] probe New device with its indexed descriptors
+ * @param[in] arg Caller's argument (not used in this driver)
+ */
+static void usb_probe_cb(const usb_host_shared_client_probe_t *probe, void *arg);
+
+static const usb_host_shared_client_match_t cdc_acm_match_table[] = {
+    { .match_flags = 0 }, // Any interface
+};
+
 /**
  * @brief Send CDC specific request
  *
@@ -139,16 +197,101 @@ static esp_err_t send_cdc_request(cdc_dev_t *cdc_dev, bool in_transfer, cdc_requ
  */
 static void cdc_acm_reset_in_transfer(cdc_dev_t *cdc_dev)
 {
-    assert(cdc_dev->data.in_xfer);
-    usb_transfer_t *transfer = cdc_dev->data.in_xfer;
+    assert(cdc_dev->data.in_xfers);
+    usb_transfer_t *transfer = cdc_dev->data.in_xfers[0];
     uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
     *ptr = cdc_dev->data.in_data_buffer_base;
+    cdc_dev->data.in_data_len = 0;
     transfer->num_bytes = transfer->data_buffer_size;
     // This is a hotfix for IDF changes, where 'transfer->data_buffer_size' does not contain actual buffer length,
     // but *allocated* buffer length, which can be larger if CONFIG_HEAP_POISONING_COMPREHENSIVE is enabled
     transfer->num_bytes -= transfer->data_buffer_size % cdc_dev->data.in_mps;
 }
 
+static void cdc_acm_device_remove(cdc_dev_t *cdc_dev);
+
+/**
+ * @brief Drop reference of usb_event_cb() or cdc_acm_serial_state_flush() to the device
+ *
+ * Device closed while it was referenced is removed here
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_device_unref(cdc_dev_t *cdc_dev)
+{
+    CDC_ACM_ENTER_CRITICAL();
+    const bool remove = (--cdc_dev->refs == 0) && cdc_dev->closed;
+    CDC_ACM_EXIT_CRITICAL();
+    if (remove) {
+        cdc_acm_device_remove(cdc_dev);
+    }
+}
+
+/**
+ * @brief Inform user about current serial state of the device
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ * @param[in] now     Current tick count
+ */
+static void cdc_acm_serial_state_deliver(cdc_dev_t *cdc_dev, TickType_t now)
+{
+    cdc_dev->notif.state_tick = now;
+    if (cdc_dev->notif.cb) {
+        const cdc_acm_host_dev_event_data_t serial_state_event = {
+            .type = CDC_ACM_HOST_SERIAL_STATE,
+            .data.serial_state = cdc_dev->serial_state
+        };
+        cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
+    }
+}
+
+/**
+ * @brief Deliver coalesced SERIAL_STATE events whose interval elapsed
+ *
+ * Called from the driver's task, so the events are delivered from the same context as all other events
+ *
+ * @param[in] cdc_acm_obj Driver object
+ * @return Ticks until the next coalesced event is due, portMAX_DELAY if there is none
+ */
+static TickType_t cdc_acm_serial_state_flush(cdc_acm_obj_t *cdc_acm_obj)
+{
+    while (true) {
+        const TickType_t now = xTaskGetTickCount();
+        TickType_t wait = portMAX_DELAY;
+        cdc_dev_t *cdc_dev;
+        CDC_ACM_ENTER_CRITICAL();
+        SLIST_FOREACH(cdc_dev, &cdc_acm_obj->cdc_devices_list, list_entry) {
+            if (!cdc_dev->notif.state_pending) {
+                continue;
+            }
+            const TickType_t elapsed = now - cdc_dev->notif.state_tick;
+            if (elapsed >= cdc_dev->notif.state_interval) {
+                cdc_dev->notif.state_pending = false;
+                cdc_dev->refs++;
+                break;
+            }
+            wait = MIN(wait, cdc_dev->notif.state_interval - elapsed);
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        if (cdc_dev == NULL) {
+            return wait;
+        }
+        cdc_acm_serial_state_deliver(cdc_dev, now);
+        cdc_acm_device_unref(cdc_dev);
+    }
+}
+
+/**
+ * @brief Step of the driver in the shared client, replaces the wait computation of cdc_acm_client_task()
+ *
+ * @param[in] arg Driver object
+ * @return Ticks until the next coalesced event is due, portMAX_DELAY if there is none
+ */
+static TickType_t cdc_acm_shared_client_step(void *arg)
+{
+    return cdc_acm_serial_state_flush((cdc_acm_obj_t *)arg);
+}
+
 /**
  * @brief CDC-ACM driver handling task
  *
@@ -164,7 +307,7 @@ static void cdc_acm_client_task(void *arg)
 
     // Start handling client's events
     while (1) {
-        usb_host_client_handle_events(cdc_acm_obj->cdc_acm_client_hdl, portMAX_DELAY);
+        usb_host_client_handle_events(cdc_acm_obj->cdc_acm_client_hdl, cdc_acm_serial_state_flush(cdc_acm_obj));
         EventBits_t events = xEventGroupGetBits(cdc_acm_obj->event_group);
         if (events & CDC_ACM_TEARDOWN) {
             break;
@@ -205,14 +348,20 @@ static esp_err_t cdc_acm_reset_transfer_endpoint(usb_device_handle_t dev_hdl, us
  * @param cdc_dev
  * @param[in] event_cb  Device event callback
  * @param[in] in_cb     Data received callback
+ * @param[in] setup_cb  Interface setup callback, called before the data interface is claimed. Can be NULL
  * @param[in] user_arg  Optional user's argument, that will be passed to the callbacks
  * @return esp_err_t
  */
-static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t event_cb, cdc_acm_data_callback_t in_cb, void *user_arg)
+static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t event_cb, cdc_acm_data_callback_t in_cb,
+                               cdc_acm_host_setup_callback_t setup_cb, void *user_arg)
 {
     esp_err_t ret = ESP_OK;
     assert(cdc_dev);
 
+    if (setup_cb) {
+        ESP_RETURN_ON_ERROR(setup_cb((cdc_acm_dev_hdl_t)cdc_dev, user_arg), TAG, "Interface setup failed");
+    }
+
     CDC_ACM_ENTER_CRITICAL();
     cdc_dev->notif.cb = event_cb;
     cdc_dev->data.in_cb = in_cb;
@@ -227,9 +376,10 @@ static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t e
             cdc_dev->data.intf_desc->bInterfaceNumber,
             cdc_dev->data.intf_desc->bAlternateSetting),
         err, TAG, "Could not claim interface");
-    if (cdc_dev->data.in_xfer) {
+    for (size_t i = 0; i < cdc_dev->data.in_xfer_count; i++) {
         ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->data.in_xfer));
+        CDC_ACM_TRACE(SUBMIT, cdc_dev->data.in_xfers[i]);
+        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->data.in_xfers[i]));
     }
 
     // If notification are supported, claim its interface and start polling its IN endpoint
@@ -244,6 +394,7 @@ static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t e
                 err, TAG, "Could not claim interface");
         }
         ESP_LOGD(TAG, "Submitting poll for INTR IN transfer");
+        CDC_ACM_TRACE(SUBMIT, cdc_dev->notif.xfer);
         ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->notif.xfer));
     }
 
@@ -262,6 +413,135 @@ err:
 }
 
 static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev);
+static void cdc_acm_rx_task_stop(cdc_dev_t *cdc_dev);
+static void cdc_acm_rx_task(void *arg);
+/**
+ * @brief Release USB device used by CDC device
+ *
+ * The USB device is closed and its cached descriptors are freed when the last CDC device opened on it is removed
+ *
+ * @param[in] usb_dev USB device
+ */
+static void cdc_acm_usb_dev_put(cdc_usb_dev_t *usb_dev)
+{
+    assert(usb_dev);
+    CDC_ACM_ENTER_CRITICAL();
+    const bool last = (--usb_dev->cdc_dev_count == 0);
+    if (last) {
+        SLIST_REMOVE(&p_cdc_acm_obj->usb_devices_list, usb_dev, cdc_usb_dev_s, list_entry);
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    if (!last) {
+        return;
+    }
+
+    while (!SLIST_EMPTY(&usb_dev->intf_list)) {
+        cdc_intf_info_t *intf = SLIST_FIRST(&usb_dev->intf_list);
+        SLIST_REMOVE_HEAD(&usb_dev->intf_list, list_entry);
+        free(intf->info.func);
+        free(intf);
+    }
+    usb_host_desc_index_free(usb_dev->desc_index);
+    // We don't check the error code of usb_host_device_close, as the close might fail, if someone else is still using the device (not all interfaces are released)
+    usb_host_shared_client_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, usb_dev->dev_hdl); // Gracefully continue on error
+    vSemaphoreDelete(usb_dev->ctrl_reset_mux);
+    free(usb_dev);
+}
+
+/**
+ * @brief Get parsed layout of USB device interface
+ *
+ * Descriptors are fetched and indexed on the first use of the USB device, the interface is parsed on its first use only.
+ * Following opens of the same or other interfaces of the USB device reuse the results.
+ *
+ * @note Must be called with open_close_mutex taken
+ * @param[in] usb_dev     USB device
+ * @param[in] intf_idx    Index of the required interface
+ * @param[out] info_ret   Parsed interface, it is valid until the USB device is released
+ * @return
+ *     - ESP_OK:            Success
+ *     - ESP_ERR_NO_MEM:    Not enough memory for the cache entry or descriptor index
+ *     - ESP_ERR_NOT_FOUND: Interfaces and endpoints NOT found
+ */
+static esp_err_t cdc_acm_usb_dev_intf_get(cdc_usb_dev_t *usb_dev, uint8_t intf_idx, const cdc_parsed_info_t **info_ret)
+{
+    cdc_intf_info_t *intf;
+    SLIST_FOREACH(intf, &usb_dev->intf_list, list_entry) {
+        if (intf->intf_idx == intf_idx) {
+            *info_ret = &intf->info;
+            return ESP_OK;
+        }
+    }
+
+    if (usb_dev->config_desc == NULL) {
+        const usb_config_desc_t *config_desc;
+        ESP_ERROR_CHECK(usb_host_get_device_descriptor(usb_dev->dev_hdl, &usb_dev->device_desc));
+        ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(usb_dev->dev_hdl, &config_desc));
+        ESP_RETURN_ON_ERROR(usb_host_desc_index_build(config_desc, &usb_dev->desc_index), TAG, "Unable to index Configuration descriptor");
+        usb_dev->config_desc = config_desc;
+    }
+
+    intf = calloc(1, sizeof(cdc_intf_info_t));
+    if (intf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_err_t ret = cdc_parse_interface_index(usb_dev->device_desc, usb_dev->desc_index, intf_idx, &intf->info);
+    if (ret != ESP_OK) {
+        free(intf->info.func);
+        free(intf);
+        return ret;
+    }
+    intf->intf_idx = intf_idx;
+    SLIST_INSERT_HEAD(&usb_dev->intf_list, intf, list_entry);
+    *info_ret = &intf->info;
+    return ESP_OK;
+}
+
+/**
+ * @brief Register statistics entry of CDC device and account its buffers
+ *
+ * Failure is not fatal, the device is not counted then.
+ *
+ * @param[in] cdc_dev    CDC device with allocated transfers
+ * @param[in] dev_config Configuration of the device
+ */
+static void cdc_acm_stats_register(cdc_dev_t *cdc_dev, const cdc_acm_host_device_config_t *dev_config)
+{
+#if CONFIG_USB_CLASS_STATS
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_device_info(cdc_dev->dev_hdl, &dev_info));
+    const usb_class_stats_info_t stats_info = {
+        .driver = "cdc_acm",
+        .dev_addr = dev_info.dev_addr,
+        .intf_num = cdc_dev->data.intf_desc->bInterfaceNumber,
+    };
+    usb_class_stats_register(&stats_info, &cdc_dev->stats);
+
+    // Buffers live as long as the device, they are released from the accounting when the entry is unregistered
+    USB_CLASS_STATS_MEM_ALLOC(cdc_dev->stats, sizeof(cdc_dev_t), MALLOC_CAP_DEFAULT);
+    USB_CLASS_STATS_MEM_XFER(cdc_dev->stats, cdc_dev->ctrl_transfer);
+    USB_CLASS_STATS_MEM_XFER(cdc_dev->stats, cdc_dev->notif.xfer);
+    USB_CLASS_STATS_MEM_XFER(cdc_dev->stats, cdc_dev->notif.resp_xfer);
+    USB_CLASS_STATS_MEM_XFER(cdc_dev->stats, cdc_dev->data.out_xfer);
+    for (size_t i = 0; i < cdc_dev->data.in_xfer_count; i++) {
+        USB_CLASS_STATS_MEM_XFER(cdc_dev->stats, cdc_dev->data.in_xfers[i]);
+    }
+    for (size_t i = 0; i < cdc_dev->data.tx_slot_count; i++) {
+        USB_CLASS_STATS_MEM_XFER(cdc_dev->stats, cdc_dev->data.tx_slots[i].xfer);
+    }
+    if (cdc_dev->data.rx_stream) {
+        USB_CLASS_STATS_MEM_ALLOC(cdc_dev->stats, dev_config->rx_buffer_size, MALLOC_CAP_DEFAULT);
+    }
+    if (cdc_dev->data.framer) {
+        USB_CLASS_STATS_MEM_ALLOC(cdc_dev->stats, dev_config->framing.max_frame_size ? dev_config->framing.max_frame_size : CDC_ACM_FRAMING_FRAME_SIZE_DEFAULT,
+                                  MALLOC_CAP_DEFAULT);
+    }
+#else
+    (void)cdc_dev;
+    (void)dev_config;
+#endif
+}
+
 /**
  * @brief Helper function that releases resources claimed by CDC device
  *
@@ -273,10 +553,10 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev);
 static void cdc_acm_device_remove(cdc_dev_t *cdc_dev)
 {
     assert(cdc_dev);
+    cdc_acm_rx_task_stop(cdc_dev);
     cdc_acm_transfers_free(cdc_dev);
-    free(cdc_dev->cdc_func_desc);
-    // We don't check the error code of usb_host_device_close, as the close might fail, if someone else is still using the device (not all interfaces are released)
-    usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl); // Gracefully continue on error
+    usb_class_stats_unregister(cdc_dev->stats);
+    cdc_acm_usb_dev_put(cdc_dev->usb_dev);
     free(cdc_dev);
 }
 
@@ -288,42 +568,66 @@ static void cdc_acm_device_remove(cdc_dev_t *cdc_dev)
  * 2. USB device with matching VID/PID is NOT opened by this driver yet: poll USB connected devices until it is found.
  *
  * @note This function will block for timeout_ms, if the device is not enumerated at the moment of calling this function.
+ *       open_close_mutex is given between the polls, so other devices can be opened and closed meanwhile.
+ *       On success, the function returns with open_close_mutex taken.
+ *       A device with given address is already enumerated, so it is not polled for.
  * @param[in] vid Vendor ID
  * @param[in] pid Product ID
+ * @param[in] dev_addr USB address of the device, CDC_ACM_ANY_ADDR for the first device with matching VID/PID
  * @param[in] timeout_ms Connection timeout [ms]
  * @param[out] dev CDC-ACM device
  * @return esp_err_t
  */
-static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, int timeout_ms, cdc_dev_t **dev)
+static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, uint8_t dev_addr, int timeout_ms, cdc_dev_t **dev)
 {
     assert(p_cdc_acm_obj);
     assert(dev);
 
     *dev = calloc(1, sizeof(cdc_dev_t));
-    if (*dev == NULL) {
-        return ESP_ERR_NO_MEM;
-    }
-
-    // First, check list of already opened CDC devices
-    ESP_LOGD(TAG, "Checking list of opened USB devices");
-    cdc_dev_t *cdc_dev;
-    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
-        const usb_device_desc_t *device_desc;
-        ESP_ERROR_CHECK(usb_host_get_device_descriptor(cdc_dev->dev_hdl, &device_desc));
-        if ((vid == device_desc->idVendor || vid == CDC_HOST_ANY_VID) &&
-                (pid == device_desc->idProduct || pid == CDC_HOST_ANY_PID)) {
-            // Return path 1:
-            (*dev)->dev_hdl = cdc_dev->dev_hdl;
-            return ESP_OK;
+    cdc_usb_dev_t *new_usb_dev = calloc(1, sizeof(cdc_usb_dev_t)); // Used only if the USB device is not opened yet
+    SemaphoreHandle_t ctrl_reset_mux = xSemaphoreCreateMutex();
+    if (*dev == NULL || new_usb_dev == NULL || ctrl_reset_mux == NULL) {
+        free(*dev);
+        free(new_usb_dev);
+        if (ctrl_reset_mux) {
+            vSemaphoreDelete(ctrl_reset_mux);
         }
+        *dev = NULL;
+        return ESP_ERR_NO_MEM;
     }
+    new_usb_dev->ctrl_reset_mux = ctrl_reset_mux;
+    SLIST_INIT(&new_usb_dev->intf_list);
 
-    // Second, poll connected devices until new device is connected or timeout
     TickType_t timeout_ticks = (timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
     TimeOut_t connection_timeout;
     vTaskSetTimeOutState(&connection_timeout);
 
     do {
+        xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+
+        // First, check list of already opened USB devices, their descriptors are cached
+        ESP_LOGD(TAG, "Checking list of opened USB devices");
+        cdc_usb_dev_t *usb_dev;
+        CDC_ACM_ENTER_CRITICAL();
+        SLIST_FOREACH(usb_dev, &p_cdc_acm_obj->usb_devices_list, list_entry) {
+            if ((vid == usb_dev->device_desc->idVendor || vid == CDC_HOST_ANY_VID) &&
+                    (pid == usb_dev->device_desc->idProduct || pid == CDC_HOST_ANY_PID) &&
+                    (dev_addr == usb_dev->dev_addr || dev_addr == CDC_ACM_ANY_ADDR)) {
+                usb_dev->cdc_dev_count++;
+                break;
+            }
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        if (usb_dev) {
+            // Return path 1:
+            vSemaphoreDelete(new_usb_dev->ctrl_reset_mux);
+            free(new_usb_dev);
+            (*dev)->dev_hdl = usb_dev->dev_hdl;
+            (*dev)->usb_dev = usb_dev;
+            return ESP_OK;
+        }
+
+        // Second, check connected devices
         ESP_LOGD(TAG, "Checking list of connected USB devices");
         uint8_t dev_addr_list[10];
         int num_of_devices;
@@ -331,9 +635,12 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
 
         // Go through device address list and find the one we are looking for
         for (int i = 0; i < num_of_devices; i++) {
+            if (dev_addr != CDC_ACM_ANY_ADDR && dev_addr != dev_addr_list[i]) {
+                continue;
+            }
             usb_device_handle_t current_device;
             // Open USB device
-            if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
+            if (usb_host_shared_client_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
                 continue; // In case we failed to open this device, continue with next one in the list
             }
             assert(current_device);
@@ -342,15 +649,31 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
             if ((vid == device_desc->idVendor || vid == CDC_HOST_ANY_VID) &&
                     (pid == device_desc->idProduct || pid == CDC_HOST_ANY_PID)) {
                 // Return path 2:
+                new_usb_dev->dev_hdl = current_device;
+                new_usb_dev->dev_addr = dev_addr_list[i];
+                new_usb_dev->device_desc = device_desc;
+                new_usb_dev->cdc_dev_count = 1;
+                CDC_ACM_ENTER_CRITICAL();
+                SLIST_INSERT_HEAD(&p_cdc_acm_obj->usb_devices_list, new_usb_dev, list_entry);
+                CDC_ACM_EXIT_CRITICAL();
                 (*dev)->dev_hdl = current_device;
+                (*dev)->usb_dev = new_usb_dev;
                 return ESP_OK;
             }
-            usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, current_device);
+            usb_host_shared_client_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, current_device);
+        }
+
+        // Do not block opening and closing of other devices while waiting for this one
+        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+        if (dev_addr != CDC_ACM_ANY_ADDR) {
+            break; // The device is enumerated already, it does not match or it is gone
         }
         vTaskDelay(pdMS_TO_TICKS(50));
     } while (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) == pdFALSE);
 
     // Timeout was reached, clean-up
+    vSemaphoreDelete(new_usb_dev->ctrl_reset_mux);
+    free(new_usb_dev);
     free(*dev);
     *dev = NULL;
     return ESP_ERR_NOT_FOUND;
@@ -371,32 +694,50 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
     EventGroupHandle_t event_group = xEventGroupCreate();
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
     TaskHandle_t driver_task_h = NULL;
-    xTaskCreatePinnedToCore(
-        cdc_acm_client_task, "USB-CDC", driver_config->driver_task_stack_size, NULL,
-        driver_config->driver_task_priority, &driver_task_h, driver_config->xCoreID);
+    if (!driver_config->shared_client) {
+        xTaskCreatePinnedToCore(
+            cdc_acm_client_task, "USB-CDC", driver_config->driver_task_stack_size, NULL,
+            driver_config->driver_task_priority, &driver_task_h, driver_config->xCoreID);
+    }
 
-    if (cdc_acm_obj == NULL || driver_task_h == NULL || event_group == NULL || mutex == NULL) {
+    if (cdc_acm_obj == NULL || (driver_task_h == NULL && !driver_config->shared_client) || event_group == NULL || mutex == NULL) {
         ret = ESP_ERR_NO_MEM;
         goto err;
     }
 
-    // Register USB Host client
-    usb_host_client_handle_t usb_client = NULL;
-    const usb_host_client_config_t client_config = {
-        .is_synchronous = false,
-        .max_num_event_msg = 3,
-        .async.client_event_callback = usb_event_cb,
-        .async.callback_arg = NULL
-    };
-    ESP_GOTO_ON_ERROR(usb_host_client_register(&client_config, &usb_client), err, TAG, "Failed to register USB host client");
-
-    // Initialize CDC-ACM driver structure
+    // Initialize CDC-ACM driver structure, the shared client may call our step as soon as we are added to it
     SLIST_INIT(&(cdc_acm_obj->cdc_devices_list));
+    SLIST_INIT(&(cdc_acm_obj->usb_devices_list));
     cdc_acm_obj->event_group = event_group;
     cdc_acm_obj->open_close_mutex = mutex;
-    cdc_acm_obj->cdc_acm_client_hdl = usb_client;
     cdc_acm_obj->new_dev_cb = driver_config->new_dev_cb;
 
+    // Register USB Host client
+    usb_host_client_handle_t usb_client = NULL;
+    usb_host_shared_client_driver_handle_t shared_driver = NULL;
+    if (driver_config->shared_client) {
+        const usb_host_shared_client_driver_config_t shared_config = {
+            .event_cb = usb_event_cb,
+            .probe_cb = usb_probe_cb,
+            .match_table = cdc_acm_match_table,
+            .match_count = sizeof(cdc_acm_match_table) / sizeof(cdc_acm_match_table[0]),
+            .step_cb = cdc_acm_shared_client_step,
+            .arg = cdc_acm_obj,
+        };
+        ESP_GOTO_ON_ERROR(usb_host_shared_client_add_driver(&shared_config, &shared_driver, &usb_client), err, TAG,
+                          "Failed to add driver to USB host shared client");
+    } else {
+        const usb_host_client_config_t client_config = {
+            .is_synchronous = false,
+            .max_num_event_msg = 3,
+            .async.client_event_callback = usb_event_cb,
+            .async.callback_arg = NULL
+        };
+        ESP_GOTO_ON_ERROR(usb_host_client_register(&client_config, &usb_client), err, TAG, "Failed to register USB host client");
+    }
+    cdc_acm_obj->cdc_acm_client_hdl = usb_client;
+    cdc_acm_obj->shared_driver = shared_driver;
+
     // Between 1st call of this function and following section, another task might try to install this driver:
     // Make sure that there is only one instance of this driver in the system
     CDC_ACM_ENTER_CRITICAL();
@@ -411,11 +752,17 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
     CDC_ACM_EXIT_CRITICAL();
 
     // Everything OK: Start CDC-Driver task and return
-    xTaskNotifyGive(driver_task_h);
+    if (driver_task_h) {
+        xTaskNotifyGive(driver_task_h);
+    }
     return ESP_OK;
 
 client_err:
-    usb_host_client_deregister(usb_client);
+    if (shared_driver) {
+        usb_host_shared_client_remove_driver(shared_driver);
+    } else {
+        usb_host_client_deregister(usb_client);
+    }
 err: // Clean-up
     free(cdc_acm_obj);
     if (event_group) {
@@ -442,7 +789,8 @@ esp_err_t cdc_acm_host_uninstall()
     xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY); // Wait for all open/close calls to finish
 
     CDC_ACM_ENTER_CRITICAL();
-    if (SLIST_EMPTY(&p_cdc_acm_obj->cdc_devices_list)) { // Check that device list is empty (all devices closed)
+    // Check that device list is empty (all devices closed), no device is being opened and auto-open service is stopped
+    if (SLIST_EMPTY(&p_cdc_acm_obj->cdc_devices_list) && p_cdc_acm_obj->open_pending == 0 && p_cdc_acm_obj->auto_open == NULL) {
         p_cdc_acm_obj = NULL; // NULL static driver pointer: No open/close calls form this point
     } else {
         ret = ESP_ERR_INVALID_STATE;
@@ -451,12 +799,17 @@ esp_err_t cdc_acm_host_uninstall()
     }
     CDC_ACM_EXIT_CRITICAL();
 
-    // Signal to CDC task to stop, unblock it and wait for its deletion
-    xEventGroupSetBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN);
-    usb_host_client_unblock(cdc_acm_obj->cdc_acm_client_hdl);
-    ESP_GOTO_ON_FALSE(
-        xEventGroupWaitBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
-        ESP_ERR_NOT_FINISHED, unblock, TAG,);
+    if (cdc_acm_obj->shared_driver) {
+        // Shared client keeps running for other class drivers, only our callbacks are removed
+        ESP_ERROR_CHECK(usb_host_shared_client_remove_driver(cdc_acm_obj->shared_driver));
+    } else {
+        // Signal to CDC task to stop, unblock it and wait for its deletion
+        xEventGroupSetBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN);
+        usb_host_client_unblock(cdc_acm_obj->cdc_acm_client_hdl);
+        ESP_GOTO_ON_FALSE(
+            xEventGroupWaitBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
+            ESP_ERR_NOT_FINISHED, unblock, TAG,);
+    }
 
     // Free remaining resources and return
     vEventGroupDelete(cdc_acm_obj->event_group);
@@ -488,11 +841,18 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
 {
     assert(cdc_dev);
     if (cdc_dev->notif.xfer != NULL) {
-        usb_host_transfer_free(cdc_dev->notif.xfer);
+        usb_host_urb_pool_transfer_free(cdc_dev->notif.xfer);
     }
-    if (cdc_dev->data.in_xfer != NULL) {
-        cdc_acm_reset_in_transfer(cdc_dev);
-        usb_host_transfer_free(cdc_dev->data.in_xfer);
+    if (cdc_dev->data.in_xfers != NULL) {
+        if (cdc_dev->data.in_xfers[0] != NULL) {
+            cdc_acm_reset_in_transfer(cdc_dev);
+        }
+        for (size_t i = 0; i < cdc_dev->data.in_xfer_count; i++) {
+            if (cdc_dev->data.in_xfers[i] != NULL) {
+                usb_host_urb_pool_transfer_free(cdc_dev->data.in_xfers[i]);
+            }
+        }
+        free(cdc_dev->data.in_xfers);
     }
     if (cdc_dev->data.out_xfer != NULL) {
         if (cdc_dev->data.out_xfer->context != NULL) {
@@ -501,7 +861,31 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
         if (cdc_dev->data.out_mux != NULL) {
             vSemaphoreDelete(cdc_dev->data.out_mux);
         }
-        usb_host_transfer_free(cdc_dev->data.out_xfer);
+        usb_host_urb_pool_transfer_free(cdc_dev->data.out_xfer);
+    }
+    if (cdc_dev->data.tx_slots != NULL) {
+        for (size_t i = 0; i < cdc_dev->data.tx_slot_count; i++) {
+            if (cdc_dev->data.tx_slots[i].xfer != NULL) {
+                usb_host_urb_pool_transfer_free(cdc_dev->data.tx_slots[i].xfer);
+            }
+        }
+        free(cdc_dev->data.tx_slots);
+    }
+    if (cdc_dev->data.tx_free != NULL) {
+        vQueueDelete(cdc_dev->data.tx_free);
+    }
+    if (cdc_dev->data.tx_seg_done != NULL) {
+        vSemaphoreDelete(cdc_dev->data.tx_seg_done);
+    }
+    if (cdc_dev->data.rx_stream != NULL) {
+        vStreamBufferDelete(cdc_dev->data.rx_stream);
+    }
+    cdc_framer_delete(cdc_dev->data.framer);
+    if (cdc_dev->notif.resp_xfer != NULL) {
+        usb_host_urb_pool_transfer_free(cdc_dev->notif.resp_xfer);
+    }
+    if (cdc_dev->data.rx_queue != NULL) {
+        vQueueDelete(cdc_dev->data.rx_queue);
     }
     if (cdc_dev->ctrl_transfer != NULL) {
         if (cdc_dev->ctrl_transfer->context != NULL) {
@@ -510,7 +894,7 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
         if (cdc_dev->ctrl_mux != NULL) {
             vSemaphoreDelete(cdc_dev->ctrl_mux);
         }
-        usb_host_transfer_free(cdc_dev->ctrl_transfer);
+        usb_host_urb_pool_transfer_free(cdc_dev->ctrl_transfer);
     }
 }
 
@@ -521,14 +905,16 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
  * @param[in] notif_ep_desc Pointer to notification EP descriptor
  * @param[in] in_ep_desc-   Pointer to data IN EP descriptor
  * @param[in] in_buf_len    Length of data IN buffer
+ * @param[in] in_xfer_count Number of data IN transfers
  * @param[in] out_ep_desc   Pointer to data OUT EP descriptor
  * @param[in] out_buf_len   Length of data OUT buffer
+ * @param[in] out_xfer_count Number of data OUT transfers for asynchronous TX
  * @return
  *     - ESP_OK:            Success
  *     - ESP_ERR_NO_MEM:    Not enough memory for transfers and semaphores allocation
  *     - ESP_ERR_NOT_FOUND: IN or OUT endpoints were not found in the selected interface
  */
-static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const usb_ep_desc_t *in_ep_desc, size_t in_buf_len, const usb_ep_desc_t *out_ep_desc, size_t out_buf_len)
+static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const usb_ep_desc_t *in_ep_desc, size_t in_buf_len, size_t in_xfer_count, const usb_ep_desc_t *out_ep_desc, size_t out_buf_len, size_t out_xfer_count)
 {
     assert(in_ep_desc);
     assert(out_ep_desc);
@@ -537,7 +923,7 @@ static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_des
     // 1. Setup notification transfer if it is supported
     if (notif_ep_desc) {
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(USB_EP_DESC_GET_MPS(notif_ep_desc), 0, &cdc_dev->notif.xfer),
+            usb_host_urb_pool_transfer_alloc(USB_EP_DESC_GET_MPS(notif_ep_desc), 0, &cdc_dev->notif.xfer),
             err, TAG,);
         cdc_dev->notif.xfer->device_handle = cdc_dev->dev_hdl;
         cdc_dev->notif.xfer->bEndpointAddress = notif_ep_desc->bEndpointAddress;
@@ -548,7 +934,7 @@ static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_des
 
     // 2. Setup control transfer
     ESP_GOTO_ON_ERROR(
-        usb_host_transfer_alloc(CDC_ACM_CTRL_TRANSFER_SIZE, 0, &cdc_dev->ctrl_transfer),
+        usb_host_urb_pool_transfer_alloc(CDC_ACM_CTRL_TRANSFER_SIZE, 0, &cdc_dev->ctrl_transfer),
         err, TAG,);
     cdc_dev->ctrl_transfer->timeout_ms = 1000;
     cdc_dev->ctrl_transfer->bEndpointAddress = 0;
@@ -559,26 +945,32 @@ static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_des
     cdc_dev->ctrl_mux = xSemaphoreCreateMutex();
     ESP_GOTO_ON_FALSE(cdc_dev->ctrl_mux, ESP_ERR_NO_MEM, err, TAG,);
 
-    // 3. Setup IN data transfer (if it is required (in_buf_len > 0))
+    // 3. Setup IN data transfers (if they are required (in_buf_len > 0))
     if (in_buf_len != 0) {
-        ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(in_buf_len, 0, &cdc_dev->data.in_xfer),
-            err, TAG,
-        );
-        assert(cdc_dev->data.in_xfer);
-        cdc_dev->data.in_xfer->callback = in_xfer_cb;
-        cdc_dev->data.in_xfer->num_bytes = in_buf_len;
-        cdc_dev->data.in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
-        cdc_dev->data.in_xfer->device_handle = cdc_dev->dev_hdl;
-        cdc_dev->data.in_xfer->context = cdc_dev;
+        cdc_dev->data.in_xfers = calloc(in_xfer_count, sizeof(usb_transfer_t *));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.in_xfers, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.in_xfer_count = in_xfer_count;
+        for (size_t i = 0; i < in_xfer_count; i++) {
+            ESP_GOTO_ON_ERROR(
+                usb_host_urb_pool_transfer_alloc(in_buf_len, 0, &cdc_dev->data.in_xfers[i]),
+                err, TAG,
+            );
+            usb_transfer_t *in_xfer = cdc_dev->data.in_xfers[i];
+            assert(in_xfer);
+            in_xfer->callback = in_xfer_cb;
+            in_xfer->num_bytes = in_buf_len;
+            in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
+            in_xfer->device_handle = cdc_dev->dev_hdl;
+            in_xfer->context = cdc_dev;
+        }
         cdc_dev->data.in_mps = USB_EP_DESC_GET_MPS(in_ep_desc);
-        cdc_dev->data.in_data_buffer_base = cdc_dev->data.in_xfer->data_buffer;
+        cdc_dev->data.in_data_buffer_base = cdc_dev->data.in_xfers[0]->data_buffer;
     }
 
     // 4. Setup OUT bulk transfer (if it is required (out_buf_len > 0))
     if (out_buf_len != 0) {
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(out_buf_len, 0, &cdc_dev->data.out_xfer),
+            usb_host_urb_pool_transfer_alloc(out_buf_len, 0, &cdc_dev->data.out_xfer),
             err, TAG,
         );
         assert(cdc_dev->data.out_xfer);
@@ -589,6 +981,32 @@ static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_des
         ESP_GOTO_ON_FALSE(cdc_dev->data.out_mux, ESP_ERR_NO_MEM, err, TAG,);
         cdc_dev->data.out_xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
         cdc_dev->data.out_xfer->callback = out_xfer_cb;
+        cdc_dev->data.out_mps = USB_EP_DESC_GET_MPS(out_ep_desc);
+    }
+
+    // 5. Setup OUT bulk transfers for asynchronous TX (if they are required (out_buf_len > 0 and out_xfer_count > 0))
+    if (out_buf_len != 0 && out_xfer_count != 0) {
+        cdc_dev->data.tx_slots = calloc(out_xfer_count, sizeof(cdc_tx_slot_t));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.tx_slots, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.tx_slot_count = out_xfer_count;
+        cdc_dev->data.tx_free = xQueueCreate(out_xfer_count, sizeof(cdc_tx_slot_t *));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.tx_free, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.tx_seg_done = xSemaphoreCreateCounting(out_xfer_count, 0);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.tx_seg_done, ESP_ERR_NO_MEM, err, TAG,);
+        for (size_t i = 0; i < out_xfer_count; i++) {
+            cdc_tx_slot_t *slot = &cdc_dev->data.tx_slots[i];
+            ESP_GOTO_ON_ERROR(
+                usb_host_urb_pool_transfer_alloc(out_buf_len, 0, &slot->xfer),
+                err, TAG,
+            );
+            assert(slot->xfer);
+            slot->cdc_dev = cdc_dev;
+            slot->xfer->device_handle = cdc_dev->dev_hdl;
+            slot->xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
+            slot->xfer->callback = out_async_xfer_cb;
+            slot->xfer->context = slot;
+            xQueueSend(cdc_dev->data.tx_free, &slot, 0);
+        }
     }
     return ESP_OK;
 
@@ -597,32 +1015,29 @@ err:
     return ret;
 }
 
-esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
+/**
+ * @brief Open interface of USB device found by cdc_acm_find_and_open_usb_device()
+ *
+ * open_close_mutex is given before the interface is set up and claimed,
+ * so control requests of this device do not delay opening and closing of other devices.
+ *
+ * @note Must be called with open_close_mutex taken, it is given when the function returns
+ * @param[in] cdc_dev       CDC device with USB device assigned
+ * @param[in] interface_idx Index of device's interface used for CDC-ACM communication
+ * @param[in] dev_config    Configuration structure of the device
+ * @param[out] cdc_hdl_ret  CDC device handle, NULL on failure
+ * @return See cdc_acm_host_open()
+ */
+static esp_err_t cdc_acm_intf_open(cdc_dev_t *cdc_dev, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     esp_err_t ret;
-    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
-    CDC_ACM_CHECK(dev_config, ESP_ERR_INVALID_ARG);
-    CDC_ACM_CHECK(cdc_hdl_ret, ESP_ERR_INVALID_ARG);
-
-    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
-    // Find underlying USB device
-    cdc_dev_t *cdc_dev;
-    ret =  cdc_acm_find_and_open_usb_device(vid, pid, dev_config->connection_timeout_ms, &cdc_dev);
-    if (ESP_OK != ret) {
-        goto exit;
-    }
-
-    // Get Device and Configuration descriptors
-    const usb_config_desc_t *config_desc;
-    const usb_device_desc_t *device_desc;
-    ESP_ERROR_CHECK(usb_host_get_device_descriptor(cdc_dev->dev_hdl, &device_desc));
-    ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(cdc_dev->dev_hdl, &config_desc));
 
-    // Parse the required interface descriptor
-    cdc_parsed_info_t cdc_info;
+    // Parse the required interface descriptor, or reuse the result of previous open
+    const cdc_parsed_info_t *cdc_info_p;
     ESP_GOTO_ON_ERROR(
-        cdc_parse_interface_descriptor(device_desc, config_desc, interface_idx, &cdc_info),
+        cdc_acm_usb_dev_intf_get(cdc_dev->usb_dev, interface_idx, &cdc_info_p),
         err, TAG, "Could not open required interface as CDC");
+    const cdc_parsed_info_t cdc_info = *cdc_info_p;
 
     // Save all members of cdc_dev
     cdc_dev->data.intf_desc = cdc_info.data_intf;
@@ -636,62 +1051,378 @@ esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, c
 
     // The following line is here for backward compatibility with v1.0.*
     // where fixed size of IN buffer (equal to IN Maximum Packet Size) was used
-    const size_t in_buf_size = (dev_config->data_cb && (dev_config->in_buffer_size == 0)) ? USB_EP_DESC_GET_MPS(cdc_info.in_ep) : dev_config->in_buffer_size;
+    const bool rx_enabled = dev_config->data_cb || dev_config->rx_buffer_size || dev_config->framing.type != CDC_ACM_FRAMING_NONE;
+    const size_t in_buf_size = (rx_enabled && (dev_config->in_buffer_size == 0)) ? USB_EP_DESC_GET_MPS(cdc_info.in_ep) : dev_config->in_buffer_size;
+    const size_t in_xfer_count = MAX(dev_config->in_transfer_count, 1);
+    ESP_GOTO_ON_FALSE(in_xfer_count <= CDC_ACM_IN_XFER_COUNT_MAX, ESP_ERR_INVALID_ARG, err, TAG, "Too many IN transfers");
+    ESP_GOTO_ON_FALSE(dev_config->out_transfer_count <= CDC_ACM_OUT_XFER_COUNT_MAX, ESP_ERR_INVALID_ARG, err, TAG, "Too many OUT transfers");
+    ESP_GOTO_ON_FALSE(!(dev_config->data_cb && dev_config->rx_buffer_size), ESP_ERR_INVALID_ARG, err, TAG, "data_cb and rx_buffer_size are exclusive");
+    if (dev_config->framing.type != CDC_ACM_FRAMING_NONE) {
+        ESP_GOTO_ON_FALSE(!dev_config->data_cb && !dev_config->rx_buffer_size && dev_config->framing.frame_cb,
+                          ESP_ERR_INVALID_ARG, err, TAG, "Framing needs frame_cb instead of data_cb and rx_buffer_size");
+    }
 
     // Allocate USB transfers, claim CDC interfaces and return CDC-ACM handle
     ESP_GOTO_ON_ERROR(
-        cdc_acm_transfers_allocate(cdc_dev, cdc_info.notif_ep, cdc_info.in_ep, in_buf_size, cdc_info.out_ep, dev_config->out_buffer_size),
+        cdc_acm_transfers_allocate(cdc_dev, cdc_info.notif_ep, cdc_info.in_ep, in_buf_size, in_xfer_count, cdc_info.out_ep, dev_config->out_buffer_size, dev_config->out_transfer_count),
         err, TAG,);
-    ESP_GOTO_ON_ERROR(cdc_acm_start(cdc_dev, dev_config->event_cb, dev_config->data_cb, dev_config->user_arg), err, TAG,);
-    *cdc_hdl_ret = (cdc_acm_dev_hdl_t)cdc_dev;
+    if (dev_config->encapsulated_response_size && cdc_dev->notif.xfer) {
+        ESP_GOTO_ON_FALSE(dev_config->encapsulated_response_size <= UINT16_MAX, ESP_ERR_INVALID_ARG, err, TAG, "Encapsulated response too long");
+        ESP_GOTO_ON_ERROR(
+            usb_host_urb_pool_transfer_alloc(sizeof(usb_setup_packet_t) + dev_config->encapsulated_response_size, 0, &cdc_dev->notif.resp_xfer),
+            err, TAG,);
+        cdc_dev->notif.resp_xfer->device_handle = cdc_dev->dev_hdl;
+        cdc_dev->notif.resp_xfer->bEndpointAddress = 0;
+        cdc_dev->notif.resp_xfer->timeout_ms = CDC_ACM_CTRL_TIMEOUT_MS;
+        cdc_dev->notif.resp_xfer->callback = encapsulated_response_xfer_cb;
+        cdc_dev->notif.resp_xfer->context = cdc_dev;
+        usb_setup_packet_t *req = (usb_setup_packet_t *)cdc_dev->notif.resp_xfer->data_buffer;
+        req->bmRequestType = USB_BM_REQUEST_TYPE_DIR_IN | USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+        req->bRequest = USB_CDC_REQ_GET_ENCAPSULATED_RESPONSE;
+        req->wValue = 0;
+        req->wIndex = cdc_dev->notif.intf_desc->bInterfaceNumber;
+        req->wLength = dev_config->encapsulated_response_size;
+        cdc_dev->notif.resp_xfer->num_bytes = sizeof(usb_setup_packet_t) + dev_config->encapsulated_response_size;
+    }
+    cdc_dev->ctrl_timeout = pdMS_TO_TICKS(dev_config->ctrl_timeout_ms ? dev_config->ctrl_timeout_ms : CDC_ACM_CTRL_TIMEOUT_MS);
+    cdc_dev->ctrl_transfer->timeout_ms = dev_config->ctrl_timeout_ms ? dev_config->ctrl_timeout_ms : CDC_ACM_CTRL_TIMEOUT_MS;
+    cdc_dev->notif.state_interval = pdMS_TO_TICKS(dev_config->serial_state_interval_ms);
+    cdc_dev->notif.state_tick = xTaskGetTickCount() - cdc_dev->notif.state_interval; // First change is reported immediately
+    cdc_dev->notif.unknown_log_tick = xTaskGetTickCount() - pdMS_TO_TICKS(CDC_ACM_NOTIF_LOG_INTERVAL_MS);
+    if (dev_config->rx_buffer_size) {
+        cdc_dev->data.rx_stream = xStreamBufferCreate(dev_config->rx_buffer_size, 1);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_stream, ESP_ERR_NO_MEM, err, TAG,);
+    }
+    if (dev_config->framing.type != CDC_ACM_FRAMING_NONE) {
+        cdc_dev->data.framer = cdc_framer_create(dev_config->framing.type,
+                               dev_config->framing.max_frame_size ? dev_config->framing.max_frame_size : CDC_ACM_FRAMING_FRAME_SIZE_DEFAULT);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.framer, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.frame_cb = dev_config->framing.frame_cb;
+    }
+    if (dev_config->rx_task.stack_size && cdc_dev->data.in_xfers) {
+        // One more entry for the stop request
+        cdc_dev->data.rx_queue = xQueueCreate(cdc_dev->data.in_xfer_count + 1, sizeof(usb_transfer_t *));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_queue, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.rx_task_exit = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_task_exit, ESP_ERR_NO_MEM, err, TAG,);
+        TaskHandle_t rx_task_h = NULL;
+        xTaskCreatePinnedToCore(cdc_acm_rx_task, "CDC RX", dev_config->rx_task.stack_size, (void *)cdc_dev,
+                                dev_config->rx_task.priority, &rx_task_h, dev_config->rx_task.xCoreID);
+        if (rx_task_h == NULL) {
+            vSemaphoreDelete(cdc_dev->data.rx_task_exit);
+            cdc_dev->data.rx_task_exit = NULL;
+            ret = ESP_ERR_NO_MEM;
+            goto err;
+        }
+    }
+    cdc_acm_stats_register(cdc_dev, dev_config);
+
+    // The device is not in cdc_devices_list yet, so it can't be closed by anyone else
     xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    ret = cdc_acm_start(cdc_dev, dev_config->event_cb, dev_config->data_cb, dev_config->setup_cb, dev_config->user_arg);
+    if (ret != ESP_OK) {
+        cdc_acm_device_remove(cdc_dev);
+        *cdc_hdl_ret = NULL;
+        return ret;
+    }
+    *cdc_hdl_ret = (cdc_acm_dev_hdl_t)cdc_dev;
     return ESP_OK;
 
 err:
     cdc_acm_device_remove(cdc_dev);
-exit:
     xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
     *cdc_hdl_ret = NULL;
     return ret;
 }
 
-esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
+esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
+    esp_err_t ret;
     CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
-    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
-
-    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    CDC_ACM_CHECK(dev_config, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_hdl_ret, ESP_ERR_INVALID_ARG);
 
-    // Make sure that the device is in the devices list (that it is not already closed)
+    // Find underlying USB device. The driver must not be uninstalled until the device is opened
+    CDC_ACM_ENTER_CRITICAL();
+    CDC_ACM_CHECK_FROM_CRIT(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    p_cdc_acm_obj->open_pending++;
+    CDC_ACM_EXIT_CRITICAL();
     cdc_dev_t *cdc_dev;
-    bool device_found = false;
+    ret = cdc_acm_find_and_open_usb_device(vid, pid, CDC_ACM_ANY_ADDR, dev_config->connection_timeout_ms, &cdc_dev);
+    if (ESP_OK == ret) {
+        ret = cdc_acm_intf_open(cdc_dev, interface_idx, dev_config, cdc_hdl_ret);
+    } else {
+        *cdc_hdl_ret = NULL;
+    }
     CDC_ACM_ENTER_CRITICAL();
-    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
-        if (cdc_dev == (cdc_dev_t *)cdc_hdl) {
-            device_found = true;
-            break;
+    p_cdc_acm_obj->open_pending--;
+    CDC_ACM_EXIT_CRITICAL();
+    return ret;
+}
+
+/**
+ * @brief Fill identification of USB device for auto-open callbacks
+ *
+ * @param[in]  dev_hdl USB device handle
+ * @param[out] info    Identification of the device
+ */
+static void cdc_acm_auto_open_info_fill(usb_device_handle_t dev_hdl, cdc_acm_auto_open_dev_info_t *info)
+{
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_device_info(dev_hdl, &dev_info));
+
+    const usb_str_desc_t *serial = dev_info.str_desc_serial_num;
+    if (serial) {
+        const size_t serial_len = MIN((serial->bLength - USB_STANDARD_DESC_SIZE) / 2, CDC_HOST_SERIAL_LEN_MAX);
+        for (size_t i = 0; i < serial_len; i++) {
+            const uint16_t c = serial->wData[i];
+            info->serial[i] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
         }
+        info->serial[serial_len] = '\0';
     }
 
-    // Device was not found in the cdc_devices_list; it was already closed, return OK
-    if (!device_found) {
-        CDC_ACM_EXIT_CRITICAL();
-        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
-        return ESP_OK;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+    // Walk up the hub tree, port numbers are collected from the device towards the root port
+    uint8_t path[CDC_HOST_PORT_PATH_LEN_MAX];
+    size_t depth = 0;
+    while (dev_info.parent.dev_hdl && depth < CDC_HOST_PORT_PATH_LEN_MAX) {
+        path[depth++] = dev_info.parent.port_num;
+        if (usb_host_device_info(dev_info.parent.dev_hdl, &dev_info) != ESP_OK) {
+            break;
+        }
     }
+    for (size_t i = 0; i < depth; i++) {
+        info->port_path[i] = path[depth - 1 - i];
+    }
+    info->port_path_len = depth;
+#endif
+}
 
-    // No user callbacks from this point
-    cdc_dev->notif.cb = NULL;
-    cdc_dev->data.in_cb = NULL;
+/**
+ * @brief Check whether an interface of USB device is opened by this driver already
+ *
+ * @note Must be called with open_close_mutex taken
+ * @param[in] usb_dev  USB device
+ * @param[in] intf_idx Index of the interface
+ * @return true if a CDC device is opened on the interface
+ */
+static bool cdc_acm_usb_dev_intf_is_open(cdc_usb_dev_t *usb_dev, uint8_t intf_idx)
+{
+    const cdc_parsed_info_t *info;
+    if (cdc_acm_usb_dev_intf_get(usb_dev, intf_idx, &info) != ESP_OK) {
+        return false; // The error is reported by the open
+    }
+    bool is_open = false;
+    cdc_dev_t *cdc_dev;
+    CDC_ACM_ENTER_CRITICAL();
+    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+        if (cdc_dev->usb_dev == usb_dev && cdc_dev->data.intf_desc == info->data_intf) {
+            is_open = true;
+            break;
+        }
+    }
     CDC_ACM_EXIT_CRITICAL();
+    return is_open;
+}
 
-    // Cancel polling of BULK IN and INTERRUPT IN
-    if (cdc_dev->data.in_xfer) {
-        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.in_xfer));
+/**
+ * @brief Open matching interfaces of a new USB device
+ *
+ * Each interface is opened by the address of the device, so identical devices are never confused.
+ *
+ * @param[in] auto_open Auto-open service
+ * @param[in] dev_addr  USB address of the new device
+ */
+static void cdc_acm_auto_open_device(cdc_acm_auto_open_t *auto_open, uint8_t dev_addr)
+{
+    const cdc_acm_host_auto_open_config_t *config = &auto_open->config;
+    const uint32_t interface_mask = config->interface_mask ? config->interface_mask : BIT(0);
+    cdc_acm_auto_open_dev_info_t info = {
+        .dev_addr = dev_addr,
+    };
+    bool info_filled = false;
+
+    for (uint8_t intf_idx = 0; intf_idx < 32; intf_idx++) {
+        if (!(interface_mask & BIT(intf_idx))) {
+            continue;
+        }
+        cdc_dev_t *cdc_dev;
+        if (cdc_acm_find_and_open_usb_device(config->vid, config->pid, dev_addr, 0, &cdc_dev) != ESP_OK) {
+            return; // VID/PID do not match or the device is gone
+        }
+        if (!info_filled) {
+            cdc_acm_auto_open_info_fill(cdc_dev->dev_hdl, &info);
+            info_filled = true;
+        }
+        info.interface_idx = intf_idx;
+        cdc_acm_host_device_config_t dev_config = config->dev_config;
+        if (cdc_acm_usb_dev_intf_is_open(cdc_dev->usb_dev, intf_idx) ||
+                (config->match_cb && !config->match_cb(&info, &dev_config, config->user_arg))) {
+            cdc_acm_device_remove(cdc_dev);
+            xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+            continue;
+        }
+
+        cdc_acm_dev_hdl_t cdc_hdl;
+        const esp_err_t ret = cdc_acm_intf_open(cdc_dev, intf_idx, &dev_config, &cdc_hdl);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Auto-open of device %d interface %d failed: %s", dev_addr, intf_idx, esp_err_to_name(ret));
+        }
+        config->opened_cb(cdc_hdl, &info, ret, config->user_arg);
+    }
+}
+
+static void cdc_acm_auto_open_task(void *arg)
+{
+    cdc_acm_auto_open_t *auto_open = (cdc_acm_auto_open_t *)arg;
+    uint8_t dev_addr;
+    while (xQueueReceive(auto_open->dev_queue, &dev_addr, portMAX_DELAY) == pdTRUE && dev_addr != CDC_ACM_ANY_ADDR) {
+        cdc_acm_auto_open_device(auto_open, dev_addr);
+    }
+    xSemaphoreGive(auto_open->task_exit);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Stop auto-open tasks and free the service
+ *
+ * @param[in] auto_open Auto-open service, it is not reachable from usb_event_cb() anymore
+ */
+static void cdc_acm_auto_open_free(cdc_acm_auto_open_t *auto_open)
+{
+    // Stop requests go in front of the devices waiting, a device being opened is finished
+    const uint8_t stop = CDC_ACM_ANY_ADDR;
+    for (size_t i = 0; i < auto_open->task_count; i++) {
+        xQueueSendToFront(auto_open->dev_queue, &stop, portMAX_DELAY);
+    }
+    for (size_t i = 0; i < auto_open->task_count; i++) {
+        xSemaphoreTake(auto_open->task_exit, portMAX_DELAY);
+    }
+
+    // usb_event_cb() might have taken the service before it was unlinked
+    while (true) {
+        CDC_ACM_ENTER_CRITICAL();
+        const bool in_use = auto_open->refs > 0;
+        CDC_ACM_EXIT_CRITICAL();
+        if (!in_use) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+
+    if (auto_open->dev_queue) {
+        vQueueDelete(auto_open->dev_queue);
+    }
+    if (auto_open->task_exit) {
+        vSemaphoreDelete(auto_open->task_exit);
+    }
+    free(auto_open);
+}
+
+esp_err_t cdc_acm_host_auto_open_start(const cdc_acm_host_auto_open_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(config && config->opened_cb && config->task.stack_size, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(p_cdc_acm_obj->auto_open == NULL, ESP_ERR_INVALID_STATE);
+
+    const size_t task_count = MAX(config->task.count, 1);
+    cdc_acm_auto_open_t *auto_open = calloc(1, sizeof(cdc_acm_auto_open_t));
+    CDC_ACM_CHECK(auto_open, ESP_ERR_NO_MEM);
+    auto_open->config = *config;
+    auto_open->dev_queue = xQueueCreate(CDC_ACM_AUTO_OPEN_QUEUE_LEN + task_count, sizeof(uint8_t)); // One more entry for each stop request
+    auto_open->task_exit = xSemaphoreCreateCounting(task_count, 0);
+    ESP_GOTO_ON_FALSE(auto_open->dev_queue && auto_open->task_exit, ESP_ERR_NO_MEM, err, TAG,);
+    for (size_t i = 0; i < task_count; i++) {
+        TaskHandle_t task_h = NULL;
+        xTaskCreatePinnedToCore(cdc_acm_auto_open_task, "CDC open", config->task.stack_size, (void *)auto_open,
+                                config->task.priority, &task_h, config->task.xCoreID);
+        ESP_GOTO_ON_FALSE(task_h, ESP_ERR_NO_MEM, err, TAG, "Unable to create auto-open task");
+        auto_open->task_count++;
+    }
+
+    CDC_ACM_ENTER_CRITICAL();
+    if (p_cdc_acm_obj->auto_open) {
+        CDC_ACM_EXIT_CRITICAL();
+        ret = ESP_ERR_INVALID_STATE;
+        goto err;
+    }
+    p_cdc_acm_obj->auto_open = auto_open;
+    CDC_ACM_EXIT_CRITICAL();
+
+    // Devices connected before the service was started.
+    // A device enumerated meanwhile is announced also by usb_event_cb(), its opened interfaces are skipped the second time
+    uint8_t dev_addr_list[CDC_ACM_AUTO_OPEN_QUEUE_LEN];
+    int num_of_devices;
+    ESP_ERROR_CHECK(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_of_devices));
+    for (int i = 0; i < num_of_devices; i++) {
+        xQueueSend(auto_open->dev_queue, &dev_addr_list[i], 0);
+    }
+    return ESP_OK;
+
+err:
+    cdc_acm_auto_open_free(auto_open);
+    return ret;
+}
+
+esp_err_t cdc_acm_host_auto_open_stop(void)
+{
+    CDC_ACM_ENTER_CRITICAL();
+    CDC_ACM_CHECK_FROM_CRIT(p_cdc_acm_obj && p_cdc_acm_obj->auto_open, ESP_ERR_INVALID_STATE);
+    cdc_acm_auto_open_t *auto_open = p_cdc_acm_obj->auto_open;
+    p_cdc_acm_obj->auto_open = NULL;
+    CDC_ACM_EXIT_CRITICAL();
+
+    cdc_acm_auto_open_free(auto_open);
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+
+    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+
+    // Make sure that the device is in the devices list (that it is not already closed)
+    cdc_dev_t *cdc_dev;
+    bool device_found = false;
+    CDC_ACM_ENTER_CRITICAL();
+    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+        if (cdc_dev == (cdc_dev_t *)cdc_hdl) {
+            device_found = true;
+            break;
+        }
+    }
+
+    // Device was not found in the cdc_devices_list; it was already closed, return OK
+    if (!device_found) {
+        CDC_ACM_EXIT_CRITICAL();
+        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+        return ESP_OK;
+    }
+
+    // No user callbacks from this point
+    cdc_dev->notif.cb = NULL;
+    cdc_dev->data.in_cb = NULL;
+    cdc_dev->data.frame_cb = NULL;
+    for (size_t i = 0; i < cdc_dev->data.tx_slot_count; i++) {
+        cdc_dev->data.tx_slots[i].done_cb = NULL;
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    cdc_acm_rx_task_stop(cdc_dev); // Before the endpoint reset, so the RX task does not submit the transfers again
+
+    // Cancel polling of BULK IN and INTERRUPT IN. Endpoint reset cancels all IN transfers in flight
+    if (cdc_dev->data.in_xfers) {
+        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.in_xfers[0]));
     }
     if (cdc_dev->notif.xfer != NULL) {
         ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->notif.xfer));
     }
+    // Cancel asynchronous OUT transfers in flight
+    if (cdc_dev->data.tx_free != NULL && uxQueueMessagesWaiting(cdc_dev->data.tx_free) < cdc_dev->data.tx_slot_count) {
+        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.tx_slots[0].xfer));
+    }
 
     // Release all interfaces
     ESP_ERROR_CHECK(usb_host_interface_release(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl, cdc_dev->data.intf_desc->bInterfaceNumber));
@@ -701,9 +1432,14 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
 
     CDC_ACM_ENTER_CRITICAL();
     SLIST_REMOVE(&p_cdc_acm_obj->cdc_devices_list, cdc_dev, cdc_dev_s, list_entry);
+    cdc_dev->closed = true;
+    const bool in_use = (cdc_dev->refs > 0);
     CDC_ACM_EXIT_CRITICAL();
 
-    cdc_acm_device_remove(cdc_dev);
+    // A device referenced by usb_event_cb() is removed there, once its disconnection callback returns
+    if (!in_use) {
+        cdc_acm_device_remove(cdc_dev);
+    }
     xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
     return ESP_OK;
 }
@@ -711,6 +1447,7 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
 void cdc_acm_host_desc_print(cdc_acm_dev_hdl_t cdc_hdl)
 {
     assert(cdc_hdl);
+#ifndef CONFIG_CDC_ACM_HOST_MINIMAL
     cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
 
     const usb_device_desc_t *device_desc;
@@ -719,6 +1456,7 @@ void cdc_acm_host_desc_print(cdc_acm_dev_hdl_t cdc_hdl)
     ESP_ERROR_CHECK_WITHOUT_ABORT(usb_host_get_active_config_descriptor(cdc_dev->dev_hdl, &config_desc));
     usb_print_device_descriptor(device_desc);
     usb_print_config_descriptor(config_desc, cdc_print_desc);
+#endif // CONFIG_CDC_ACM_HOST_MINIMAL
 }
 
 /**
@@ -750,6 +1488,7 @@ static bool cdc_acm_is_transfer_completed(usb_transfer_t *transfer)
     case USB_TRANSFER_STATUS_SKIPPED:
     default:
         // Transfer was not completed or cancelled by user. Inform user about this
+        USB_CLASS_STATS_XFER(cdc_dev->stats, 0, false);
         if (cdc_dev->notif.cb) {
             const cdc_acm_host_dev_event_data_t error_event = {
                 .type = CDC_ACM_HOST_ERROR,
@@ -761,65 +1500,285 @@ static bool cdc_acm_is_transfer_completed(usb_transfer_t *transfer)
     return completed;
 }
 
-static void in_xfer_cb(usb_transfer_t *transfer)
+/**
+ * @brief Notify user about IN buffer overflow
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_in_overrun(cdc_dev_t *cdc_dev)
 {
-    ESP_LOGD(TAG, "in xfer cb");
-    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+    ESP_LOGW(TAG, "IN buffer overflow");
+    USB_CLASS_STATS_DROP(cdc_dev->stats, 1);
+    cdc_dev->serial_state.bOverRun = true;
+    if (cdc_dev->notif.cb) {
+        const cdc_acm_host_dev_event_data_t serial_state_event = {
+            .type = CDC_ACM_HOST_SERIAL_STATE,
+            .data.serial_state = cdc_dev->serial_state
+        };
+        cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
+    }
+    cdc_dev->serial_state.bOverRun = false;
+}
 
-    if (!cdc_acm_is_transfer_completed(transfer)) {
+/**
+ * @brief Deliver data of one of several IN transfers to the user
+ *
+ * The other IN transfers stay in flight while the user's callback runs.
+ * If the user does not process the data, the transfer is held back and data of following transfers are copied behind it,
+ * so the user gets all unprocessed data in one contiguous buffer.
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer Completed IN transfer
+ */
+static void cdc_acm_in_deliver_multi(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
+{
+    usb_transfer_t *pending = cdc_dev->data.in_pending;
+    const uint8_t *data = transfer->data_buffer;
+    size_t data_len = transfer->actual_num_bytes;
+
+    if (pending) {
+        if (cdc_dev->data.in_pending_len + data_len > pending->num_bytes) {
+            // The held back data cannot be extended any more, drop them
+            cdc_acm_in_overrun(cdc_dev);
+            cdc_dev->data.in_pending = NULL;
+            CDC_ACM_TRACE(RESUBMIT, pending);
+            usb_host_transfer_submit(pending);
+            pending = NULL;
+        } else {
+            memcpy(pending->data_buffer + cdc_dev->data.in_pending_len, data, data_len);
+            data = pending->data_buffer;
+            data_len += cdc_dev->data.in_pending_len;
+        }
+    }
+
+    CDC_ACM_TRACE(CB_ENTER, transfer);
+    USB_CLASS_STATS_CB_ENTER(cdc_dev->stats);
+    const bool data_processed = cdc_dev->data.in_cb(data, data_len, cdc_dev->cb_arg);
+    USB_CLASS_STATS_CB_EXIT(cdc_dev->stats);
+    CDC_ACM_TRACE(CB_EXIT, transfer);
+    if (data_processed) {
+        if (pending) {
+            cdc_dev->data.in_pending = NULL;
+            CDC_ACM_TRACE(RESUBMIT, pending);
+            usb_host_transfer_submit(pending);
+        }
+    } else {
+        cdc_dev->data.in_pending_len = data_len;
+        if (pending == NULL) {
+            cdc_dev->data.in_pending = transfer; // Hold the data back, the transfer is submitted once they are processed
+            return;
+        }
+    }
+    ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
+    CDC_ACM_TRACE(RESUBMIT, transfer);
+    usb_host_transfer_submit(transfer);
+}
+
+/**
+ * @brief Deliver data of completed IN transfer to the user and submit the transfer again
+ *
+ * Called from the USB Host task, or from the RX task of the device if it has one
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer Completed IN transfer
+ */
+static void cdc_acm_in_process(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
+{
+    if (cdc_dev->data.framer) {
+        // Frames are unescaped from the transfer into the frame buffer, so the transfer is free again at once
+        CDC_ACM_TRACE(CB_ENTER, transfer);
+        USB_CLASS_STATS_CB_ENTER(cdc_dev->stats);
+        const size_t dropped = cdc_framer_feed(cdc_dev->data.framer, transfer->data_buffer, transfer->actual_num_bytes,
+                                               cdc_dev->data.frame_cb, cdc_dev->cb_arg);
+        USB_CLASS_STATS_CB_EXIT(cdc_dev->stats);
+        CDC_ACM_TRACE(CB_EXIT, transfer);
+        if (dropped) {
+            USB_CLASS_STATS_DROP(cdc_dev->stats, dropped);
+        }
+        CDC_ACM_TRACE(RESUBMIT, transfer);
+        usb_host_transfer_submit(transfer);
+        return;
+    }
+
+    if (cdc_dev->data.rx_stream) {
+        // This task is the only writer, so the data are buffered without locking
+        const size_t sent = xStreamBufferSend(cdc_dev->data.rx_stream, transfer->data_buffer, transfer->actual_num_bytes, 0);
+        if (sent < transfer->actual_num_bytes) {
+            cdc_acm_in_overrun(cdc_dev); // The reader is too slow, rest of the data is dropped
+        }
+        USB_CLASS_STATS_QUEUE(cdc_dev->stats, xStreamBufferBytesAvailable(cdc_dev->data.rx_stream));
+        CDC_ACM_TRACE(RESUBMIT, transfer);
+        usb_host_transfer_submit(transfer);
+        return;
+    }
+
+    // USB Host Library completes transfers of one endpoint in order of submission, so the data are delivered in order
+    if (cdc_dev->data.in_xfer_count > 1) {
+        if (cdc_dev->data.in_cb) {
+            cdc_acm_in_deliver_multi(cdc_dev, transfer);
+        } else {
+            CDC_ACM_TRACE(RESUBMIT, transfer);
+            usb_host_transfer_submit(transfer);
+        }
         return;
     }
 
     if (cdc_dev->data.in_cb) {
-        const bool data_processed = cdc_dev->data.in_cb(transfer->data_buffer, transfer->actual_num_bytes, cdc_dev->cb_arg);
+        uint8_t *const base = cdc_dev->data.in_data_buffer_base;
+        const size_t data_len = cdc_dev->data.in_data_len + transfer->actual_num_bytes;
+        if (transfer->data_buffer != base + cdc_dev->data.in_data_len) {
+            // Appended data were received at cache line aligned position, close the gap behind the unprocessed data
+            memmove(base + cdc_dev->data.in_data_len, transfer->data_buffer, transfer->actual_num_bytes);
+        }
+        CDC_ACM_TRACE(CB_ENTER, transfer);
+        USB_CLASS_STATS_CB_ENTER(cdc_dev->stats);
+        const bool data_processed = cdc_dev->data.in_cb(base, data_len, cdc_dev->cb_arg);
+        USB_CLASS_STATS_CB_EXIT(cdc_dev->stats);
+        CDC_ACM_TRACE(CB_EXIT, transfer);
 
         // Information for developers:
         // In order to save RAM and CPU time, the application can indicate that the received data was not processed and that the application expects more data.
         // In this case, the next received data must be appended to the existing buffer.
         // Since the data_buffer in usb_transfer_t is a constant pointer, we must cast away to const qualifier.
         if (!data_processed) {
-#if !SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
             // In case the received data was not processed, the next RX data must be appended to current buffer
+            cdc_dev->data.in_data_len = data_len;
+            const size_t offset = usb_dma_buf_cache_align_up(data_len);
             uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
-            *ptr += transfer->actual_num_bytes;
+            *ptr = base + offset;
 
-            // Calculate remaining space in the buffer. Attention: pointer arithmetic!
-            size_t space_left = transfer->data_buffer_size - (transfer->data_buffer - cdc_dev->data.in_data_buffer_base);
+            // Calculate remaining space in the buffer
+            const size_t space_left = (offset < transfer->data_buffer_size) ? transfer->data_buffer_size - offset : 0;
             uint16_t mps = cdc_dev->data.in_mps;
             transfer->num_bytes = (space_left / mps) * mps; // Round down to MPS for next transfer
 
             if (transfer->num_bytes == 0) {
                 // The IN buffer cannot accept more data, inform the user and reset the buffer
-                ESP_LOGW(TAG, "IN buffer overflow");
-                cdc_dev->serial_state.bOverRun = true;
-                if (cdc_dev->notif.cb) {
-                    const cdc_acm_host_dev_event_data_t serial_state_event = {
-                        .type = CDC_ACM_HOST_SERIAL_STATE,
-                        .data.serial_state = cdc_dev->serial_state
-                    };
-                    cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
-                }
-
+                cdc_acm_in_overrun(cdc_dev);
                 cdc_acm_reset_in_transfer(cdc_dev);
-                cdc_dev->serial_state.bOverRun = false;
             }
-#else
-            // For targets that must sync internal memory through L1CACHE, we cannot change the data_buffer
-            // because it would lead to unaligned cache sync, which is not allowed
-            ESP_LOGW(TAG, "RX buffer append is not yet supported on ESP32-P4!");
-#endif
         } else {
             cdc_acm_reset_in_transfer(cdc_dev);
         }
     }
 
     ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-    usb_host_transfer_submit(cdc_dev->data.in_xfer);
+    CDC_ACM_TRACE(RESUBMIT, transfer);
+    usb_host_transfer_submit(transfer);
+}
+
+static void in_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "in xfer cb");
+    CDC_ACM_TRACE(COMPLETE, transfer);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+
+    if (!cdc_acm_is_transfer_completed(transfer)) {
+        return;
+    }
+    USB_CLASS_STATS_XFER(cdc_dev->stats, transfer->actual_num_bytes, true);
+
+    if (cdc_dev->data.rx_queue) {
+        // Hand the transfer over to the RX task of the device. The queue has space for all IN transfers, so it never blocks
+        xQueueSend(cdc_dev->data.rx_queue, &transfer, 0);
+        return;
+    }
+    cdc_acm_in_process(cdc_dev, transfer);
+}
+
+static void cdc_acm_rx_task(void *arg)
+{
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)arg;
+    usb_transfer_t *transfer;
+
+    while (1) {
+        xQueueReceive(cdc_dev->data.rx_queue, &transfer, portMAX_DELAY);
+        if (transfer == NULL) {
+            break; // Device is being closed
+        }
+        cdc_acm_in_process(cdc_dev, transfer);
+    }
+    xSemaphoreGive(cdc_dev->data.rx_task_exit);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Stop RX task of the device
+ *
+ * IN transfers completed after this call stay in the queue and are never submitted again.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_rx_task_stop(cdc_dev_t *cdc_dev)
+{
+    if (cdc_dev->data.rx_task_exit == NULL) {
+        return; // RX task was not started
+    }
+    usb_transfer_t *stop = NULL;
+    xQueueSend(cdc_dev->data.rx_queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(cdc_dev->data.rx_task_exit, portMAX_DELAY);
+    vSemaphoreDelete(cdc_dev->data.rx_task_exit);
+    cdc_dev->data.rx_task_exit = NULL;
+}
+
+/**
+ * @brief Read response to encapsulated command
+ *
+ * Called from the driver's task only. The response is read once the ongoing read finishes, if there is one.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_encapsulated_response_get(cdc_dev_t *cdc_dev)
+{
+    if (cdc_dev->notif.resp_in_flight) {
+        cdc_dev->notif.resp_pending++;
+        return;
+    }
+    CDC_ACM_ENTER_CRITICAL();
+    const bool closed = cdc_dev->closed;
+    if (!closed) {
+        cdc_dev->refs++; // Closing the device must wait for the transfer
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    if (closed) {
+        return;
+    }
+    cdc_dev->notif.resp_in_flight = true;
+    if (usb_host_transfer_submit_control(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->notif.resp_xfer) != ESP_OK) {
+        ESP_LOGE(TAG, "GET_ENCAPSULATED_RESPONSE failed");
+        cdc_dev->notif.resp_in_flight = false;
+        cdc_acm_device_unref(cdc_dev);
+    }
+}
+
+static void encapsulated_response_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "encapsulated response xfer cb");
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+
+    if (cdc_acm_is_transfer_completed(transfer) && cdc_dev->notif.cb) {
+        const cdc_acm_host_dev_event_data_t resp_event = {
+            .type = CDC_ACM_HOST_ENCAPSULATED_RESPONSE,
+            .data.encapsulated_response = {
+                .data = transfer->data_buffer + sizeof(usb_setup_packet_t),
+                .data_len = transfer->actual_num_bytes - sizeof(usb_setup_packet_t),
+            },
+        };
+        cdc_dev->notif.cb(&resp_event, cdc_dev->cb_arg);
+    }
+
+    cdc_dev->notif.resp_in_flight = false;
+    if (cdc_dev->notif.resp_pending > 0) {
+        cdc_dev->notif.resp_pending--;
+        cdc_acm_encapsulated_response_get(cdc_dev);
+    }
+    cdc_acm_device_unref(cdc_dev); // Last use of the device, it can be removed here if it was closed
 }
 
 static void notif_xfer_cb(usb_transfer_t *transfer)
 {
     ESP_LOGD(TAG, "notif xfer cb");
+    CDC_ACM_TRACE(COMPLETE, transfer);
     cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
 
     if (cdc_acm_is_transfer_completed(transfer)) {
@@ -836,25 +1795,47 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
             break;
         }
         case USB_CDC_NOTIF_SERIAL_STATE: {
+            const TickType_t now = xTaskGetTickCount();
             cdc_dev->serial_state.val = *((uint16_t *)notif->Data);
-            if (cdc_dev->notif.cb) {
-                const cdc_acm_host_dev_event_data_t serial_state_event = {
-                    .type = CDC_ACM_HOST_SERIAL_STATE,
-                    .data.serial_state = cdc_dev->serial_state
-                };
-                cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
+            if (cdc_dev->notif.state_interval == 0) {
+                cdc_acm_serial_state_deliver(cdc_dev, now);
+                break;
+            }
+            CDC_ACM_ENTER_CRITICAL();
+            const bool coalesce = cdc_dev->notif.state_pending || (now - cdc_dev->notif.state_tick < cdc_dev->notif.state_interval);
+            if (coalesce) {
+                cdc_dev->notif.state_pending = true; // The latest state is delivered by cdc_acm_serial_state_flush()
+            }
+            CDC_ACM_EXIT_CRITICAL();
+            if (!coalesce) {
+                cdc_acm_serial_state_deliver(cdc_dev, now);
             }
             break;
         }
-        case USB_CDC_NOTIF_RESPONSE_AVAILABLE: // Encapsulated commands not implemented - fallthrough
-        default:
-            ESP_LOGW(TAG, "Unsupported notification type 0x%02X", notif->bNotificationCode);
-            ESP_LOG_BUFFER_HEX(TAG, transfer->data_buffer, transfer->actual_num_bytes);
+        case USB_CDC_NOTIF_RESPONSE_AVAILABLE:
+            if (cdc_dev->notif.resp_xfer) {
+                cdc_acm_encapsulated_response_get(cdc_dev);
+                break;
+            }
+        // fallthrough: Responses are ignored
+        default: {
+            // Some devices flood unsupported notifications, do not let logging slow down the driver's task
+            const TickType_t now = xTaskGetTickCount();
+            if (now - cdc_dev->notif.unknown_log_tick >= pdMS_TO_TICKS(CDC_ACM_NOTIF_LOG_INTERVAL_MS)) {
+                ESP_LOGW(TAG, "Unsupported notification type 0x%02X, %"PRIu32" more suppressed", notif->bNotificationCode, cdc_dev->notif.unknown_suppressed);
+                ESP_LOG_BUFFER_HEX_LEVEL(TAG, transfer->data_buffer, transfer->actual_num_bytes, ESP_LOG_DEBUG);
+                cdc_dev->notif.unknown_log_tick = now;
+                cdc_dev->notif.unknown_suppressed = 0;
+            } else {
+                cdc_dev->notif.unknown_suppressed++;
+            }
             break;
         }
+        }
 
         // Start polling for new data again
         ESP_LOGD(TAG, "Submitting poll for INTR IN transfer");
+        CDC_ACM_TRACE(RESUBMIT, cdc_dev->notif.xfer);
         usb_host_transfer_submit(cdc_dev->notif.xfer);
     }
 }
@@ -862,46 +1843,129 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
 static void out_xfer_cb(usb_transfer_t *transfer)
 {
     ESP_LOGD(TAG, "out/ctrl xfer cb");
+    CDC_ACM_TRACE(COMPLETE, transfer);
     assert(transfer->context);
     xSemaphoreGive((SemaphoreHandle_t)transfer->context);
 }
 
-static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
+static void out_async_xfer_cb(usb_transfer_t *transfer)
 {
-    switch (event_msg->event) {
-    case USB_HOST_CLIENT_EVENT_NEW_DEV:
-        // Guard p_cdc_acm_obj->new_dev_cb from concurrent access
-        ESP_LOGD(TAG, "New device connected");
+    ESP_LOGD(TAG, "async out xfer cb");
+    CDC_ACM_TRACE(COMPLETE, transfer);
+    cdc_tx_slot_t *slot = (cdc_tx_slot_t *)transfer->context;
+    assert(slot);
+
+    esp_err_t status = ESP_OK;
+    if (transfer->status == USB_TRANSFER_STATUS_CANCELED || transfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
+        status = ESP_ERR_INVALID_STATE;
+    } else if (transfer->status != USB_TRANSFER_STATUS_COMPLETED || transfer->actual_num_bytes != transfer->num_bytes) {
+        ESP_LOGW(TAG, "Bulk OUT transfer error, status %d", transfer->status);
+        status = ESP_ERR_INVALID_RESPONSE;
+    }
+    USB_CLASS_STATS_XFER(slot->cdc_dev->stats, transfer->actual_num_bytes, status == ESP_OK);
+
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_acm_tx_done_callback_t done_cb = slot->done_cb;
+    void *done_arg = slot->done_arg;
+    CDC_ACM_EXIT_CRITICAL();
+    if (done_cb) {
+        CDC_ACM_TRACE(CB_ENTER, transfer);
+        USB_CLASS_STATS_CB_ENTER(slot->cdc_dev->stats);
+        done_cb(status, done_arg);
+        USB_CLASS_STATS_CB_EXIT(slot->cdc_dev->stats);
+        CDC_ACM_TRACE(CB_EXIT, transfer);
+    }
+    // The transfer can be reused from the user's callback onwards
+    xQueueSend(slot->cdc_dev->data.tx_free, &slot, 0);
+}
+
+/**
+ * @brief Pass a new device to the auto-open task and to the user's new device callback
+ *
+ * @param[in] dev_addr New device address
+ * @param[in] dev_hdl  Handle of the device opened by the shared client probe. NULL: The device is opened here
+ */
+static void cdc_acm_new_dev_handle(uint8_t dev_addr, usb_device_handle_t dev_hdl)
+{
+    // Guard p_cdc_acm_obj->new_dev_cb from concurrent access
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_acm_new_dev_callback_t _new_dev_cb = p_cdc_acm_obj->new_dev_cb;
+    cdc_acm_auto_open_t *auto_open = p_cdc_acm_obj->auto_open;
+    if (auto_open) {
+        auto_open->refs++;
+    }
+    CDC_ACM_EXIT_CRITICAL();
+
+    if (auto_open) {
+        // The device can't be opened from this context, it is passed to an auto-open task
+        if (xQueueSend(auto_open->dev_queue, &dev_addr, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "Auto-open queue full, device %d not opened", dev_addr);
+        }
         CDC_ACM_ENTER_CRITICAL();
-        cdc_acm_new_dev_callback_t _new_dev_cb = p_cdc_acm_obj->new_dev_cb;
+        auto_open->refs--;
         CDC_ACM_EXIT_CRITICAL();
+    }
 
-        if (_new_dev_cb) {
-            usb_device_handle_t new_dev;
-            if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, event_msg->new_dev.address, &new_dev) != ESP_OK) {
-                break;
-            }
-            assert(new_dev);
-            _new_dev_cb(new_dev);
-            usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, new_dev);
+    if (_new_dev_cb) {
+        if (dev_hdl) {
+            _new_dev_cb(dev_hdl);
+            return;
+        }
+        usb_device_handle_t new_dev;
+        if (usb_host_shared_client_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr, &new_dev) != ESP_OK) {
+            return;
         }
+        assert(new_dev);
+        _new_dev_cb(new_dev);
+        usb_host_shared_client_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, new_dev);
+    }
+}
+
+static void usb_probe_cb(const usb_host_shared_client_probe_t *probe, void *arg)
+{
+    ESP_LOGD(TAG, "New device connected");
+    cdc_acm_new_dev_handle(probe->dev_addr, probe->dev_hdl);
+}
 
+static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
+{
+    switch (event_msg->event) {
+    case USB_HOST_CLIENT_EVENT_NEW_DEV:
+        ESP_LOGD(TAG, "New device connected");
+        cdc_acm_new_dev_handle(event_msg->new_dev.address, NULL);
         break;
     case USB_HOST_CLIENT_EVENT_DEV_GONE: {
         ESP_LOGD(TAG, "Device suddenly disconnected");
-        // Find CDC pseudo-devices associated with this USB device and close them
-        cdc_dev_t *cdc_dev;
-        cdc_dev_t *tcdc_dev;
-        // We are using 'SAFE' version of 'SLIST_FOREACH' which enables user to close the disconnected device in the callback
-        SLIST_FOREACH_SAFE(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry, tcdc_dev) {
-            if (cdc_dev->dev_hdl == event_msg->dev_gone.dev_hdl && cdc_dev->notif.cb) {
+        // Find CDC pseudo-devices associated with this USB device and inform user about the disconnection.
+        // The list is locked only while it is searched, so the user can open and close devices from the callback.
+        // A reference keeps the device allocated until its callback returns, even if it is closed meanwhile.
+        while (true) {
+            cdc_dev_t *cdc_dev;
+            cdc_acm_host_dev_callback_t notif_cb = NULL;
+            CDC_ACM_ENTER_CRITICAL();
+            SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+                if (cdc_dev->dev_hdl == event_msg->dev_gone.dev_hdl && !cdc_dev->disconnected) {
+                    cdc_dev->disconnected = true;
+                    cdc_dev->refs++;
+                    notif_cb = cdc_dev->notif.cb;
+                    break;
+                }
+            }
+            CDC_ACM_EXIT_CRITICAL();
+            if (cdc_dev == NULL) {
+                break; // All devices were informed
+            }
+
+            if (notif_cb) {
                 // The suddenly disconnected device was opened by this driver: inform user about this
                 const cdc_acm_host_dev_event_data_t disconn_event = {
                     .type = CDC_ACM_HOST_DEVICE_DISCONNECTED,
                     .data.cdc_hdl = (cdc_acm_dev_hdl_t) cdc_dev,
                 };
-                cdc_dev->notif.cb(&disconn_event, cdc_dev->cb_arg);
+                notif_cb(&disconn_event, cdc_dev->cb_arg);
             }
+
+            cdc_acm_device_unref(cdc_dev);
         }
         break;
     }
@@ -911,6 +1975,168 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
     }
 }
 
+/**
+ * @brief Find asynchronous OUT transfer owning the buffer
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ * @param[in] buf     Buffer obtained from cdc_acm_host_tx_buffer_get()
+ * @return Slot of the buffer or NULL if the buffer does not belong to the device
+ */
+static cdc_tx_slot_t *cdc_acm_tx_slot_find(cdc_dev_t *cdc_dev, const uint8_t *buf)
+{
+    for (size_t i = 0; i < cdc_dev->data.tx_slot_count; i++) {
+        if (cdc_dev->data.tx_slots[i].xfer->data_buffer == buf) {
+            return &cdc_dev->data.tx_slots[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Submit asynchronous OUT transfer filled with data
+ *
+ * The slot is returned to the queue of free transfers on failure
+ */
+static esp_err_t cdc_acm_tx_slot_submit(cdc_dev_t *cdc_dev, cdc_tx_slot_t *slot, size_t data_len, bool zlp,
+                                        cdc_acm_tx_done_callback_t done_cb, void *done_arg)
+{
+    ESP_LOGD(TAG, "Submitting async BULK OUT transfer");
+    slot->xfer->num_bytes = data_len;
+    slot->xfer->flags = zlp ? USB_TRANSFER_FLAG_ZERO_PACK : 0;
+    CDC_ACM_ENTER_CRITICAL();
+    slot->done_cb = done_cb;
+    slot->done_arg = done_arg;
+    CDC_ACM_EXIT_CRITICAL();
+    CDC_ACM_TRACE(SUBMIT, slot->xfer);
+    esp_err_t ret = usb_host_transfer_submit(slot->xfer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Bulk OUT transfer submit failed");
+        xQueueSend(cdc_dev->data.tx_free, &slot, 0); // Callback will not be called, return the transfer
+    }
+    return ret;
+}
+
+/**
+ * @brief Send data in the OUT transfer of blocking writes and wait for its completion
+ *
+ * @note Must be called with out_mux taken
+ * @param[in] cdc_dev    Pointer to CDC device
+ * @param[in] data       Data to be sent, up to size of the OUT transfer
+ * @param[in] data_len   Data length
+ * @param[in] zlp        Terminate the transfer with zero-length packet if it ends at MPS boundary
+ * @param[in] timeout_ms Timeout of the transfer in [ms]
+ * @return esp_err_t
+ */
+static esp_err_t cdc_acm_out_xfer_send(cdc_dev_t *cdc_dev, const uint8_t *data, size_t data_len, bool zlp, uint32_t timeout_ms)
+{
+    ESP_LOGD(TAG, "Submitting BULK OUT transfer");
+    usb_transfer_t *out_xfer = cdc_dev->data.out_xfer;
+    SemaphoreHandle_t transfer_finished_semaphore = (SemaphoreHandle_t)out_xfer->context;
+    xSemaphoreTake(transfer_finished_semaphore, 0); // Make sure the semaphore is taken before we submit new transfer
+
+    memcpy(out_xfer->data_buffer, data, data_len);
+    out_xfer->num_bytes = data_len;
+    out_xfer->timeout_ms = timeout_ms;
+    out_xfer->flags = zlp ? USB_TRANSFER_FLAG_ZERO_PACK : 0;
+    CDC_ACM_TRACE(SUBMIT, out_xfer);
+    ESP_RETURN_ON_ERROR(usb_host_transfer_submit(out_xfer), TAG,);
+
+    // Wait for OUT transfer completion
+    if (!xSemaphoreTake(transfer_finished_semaphore, pdMS_TO_TICKS(timeout_ms))) {
+        cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, out_xfer); // Resetting the endpoint will cause all in-progress transfers to complete
+        ESP_LOGW(TAG, "TX transfer timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    USB_CLASS_STATS_XFER(cdc_dev->stats, out_xfer->actual_num_bytes,
+                         out_xfer->status == USB_TRANSFER_STATUS_COMPLETED && out_xfer->actual_num_bytes == data_len);
+    ESP_RETURN_ON_FALSE(out_xfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, TAG, "Bulk OUT transfer error");
+    ESP_RETURN_ON_FALSE(out_xfer->actual_num_bytes == data_len, ESP_ERR_INVALID_RESPONSE, TAG, "Incorrect number of bytes transferred");
+    return ESP_OK;
+}
+
+/**
+ * @brief Finish OUT transfer of a segmented blocking write
+ */
+static void cdc_acm_tx_segment_done(esp_err_t status, void *arg)
+{
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)arg;
+    if (status != ESP_OK) {
+        cdc_dev->data.tx_seg_status = status; // Read by the writing task after it takes tx_seg_done
+    }
+    xSemaphoreGive(cdc_dev->data.tx_seg_done);
+}
+
+/**
+ * @brief Send data longer than one OUT transfer
+ *
+ * Data are split into segments of the largest multiple of MPS that fits into the OUT transfer, so the device does not
+ * see a short packet before the end of the data. Write that ends at MPS boundary is terminated with zero-length packet.
+ * With asynchronous OUT transfers, segments are streamed through all of them, so the bus is kept busy while the next
+ * segment is copied. Otherwise, segments are sent one by one in the OUT transfer of blocking writes.
+ *
+ * @note Must be called with out_mux taken
+ * @param[in] cdc_dev    Pointer to CDC device
+ * @param[in] data       Data to be sent
+ * @param[in] data_len   Data length
+ * @param[in] timeout_ms Timeout of each segment in [ms]
+ * @return esp_err_t
+ */
+static esp_err_t cdc_acm_tx_segmented(cdc_dev_t *cdc_dev, const uint8_t *data, size_t data_len, uint32_t timeout_ms)
+{
+    const size_t mps = cdc_dev->data.out_mps;
+    const size_t buffer_size = cdc_dev->data.out_xfer->data_buffer_size;
+    const size_t segment_size = (buffer_size >= mps) ? buffer_size - (buffer_size % mps) : buffer_size;
+    const bool zlp = (data_len % mps == 0);
+
+    if (cdc_dev->data.tx_free == NULL) {
+        for (size_t offset = 0; offset < data_len; offset += segment_size) {
+            const size_t len = MIN(segment_size, data_len - offset);
+            ESP_RETURN_ON_ERROR(cdc_acm_out_xfer_send(cdc_dev, data + offset, len, zlp && (offset + len == data_len), timeout_ms), TAG,);
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t in_flight = 0;
+    cdc_dev->data.tx_seg_status = ESP_OK;
+    for (size_t offset = 0; offset < data_len && ret == ESP_OK; offset += segment_size) {
+        const size_t len = MIN(segment_size, data_len - offset);
+        cdc_tx_slot_t *slot;
+        if (xQueueReceive(cdc_dev->data.tx_free, &slot, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        memcpy(slot->xfer->data_buffer, data + offset, len);
+        ret = cdc_acm_tx_slot_submit(cdc_dev, slot, len, zlp && (offset + len == data_len), cdc_acm_tx_segment_done, cdc_dev);
+        if (ret == ESP_OK) {
+            in_flight++;
+        }
+        // Completed segments are collected on the way, so an error stops the write early
+        while (in_flight > 0 && xSemaphoreTake(cdc_dev->data.tx_seg_done, 0) == pdTRUE) {
+            in_flight--;
+        }
+        if (ret == ESP_OK) {
+            ret = cdc_dev->data.tx_seg_status;
+        }
+    }
+
+    // Wait for the segments in flight. Their callbacks refer to this write, so it cannot return before them
+    while (in_flight > 0) {
+        if (xSemaphoreTake(cdc_dev->data.tx_seg_done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+            ESP_LOGW(TAG, "TX transfer timeout");
+            cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.tx_slots[0].xfer); // All transfers in flight complete
+            while (in_flight > 0) {
+                xSemaphoreTake(cdc_dev->data.tx_seg_done, portMAX_DELAY);
+                in_flight--;
+            }
+            return ESP_ERR_TIMEOUT;
+        }
+        in_flight--;
+    }
+    return (ret == ESP_OK) ? cdc_dev->data.tx_seg_status : ret;
+}
+
 esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms)
 {
     esp_err_t ret;
@@ -918,39 +2144,84 @@ esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t
     cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
     CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
     CDC_ACM_CHECK(cdc_dev->data.out_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
-    CDC_ACM_CHECK(data_len <= cdc_dev->data.out_xfer->data_buffer_size, ESP_ERR_INVALID_SIZE);
 
-    // Take OUT mutex and fill the OUT transfer
+    // Take OUT mutex, so writes of several tasks are not interleaved
     BaseType_t taken = xSemaphoreTake(cdc_dev->data.out_mux, pdMS_TO_TICKS(timeout_ms));
     if (taken != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
+    if (data_len <= cdc_dev->data.out_xfer->data_buffer_size) {
+        ret = cdc_acm_out_xfer_send(cdc_dev, data, data_len, false, timeout_ms);
+    } else {
+        ret = cdc_acm_tx_segmented(cdc_dev, data, data_len, timeout_ms);
+    }
+    xSemaphoreGive(cdc_dev->data.out_mux);
+    return ret;
+}
 
-    ESP_LOGD(TAG, "Submitting BULK OUT transfer");
-    SemaphoreHandle_t transfer_finished_semaphore = (SemaphoreHandle_t)cdc_dev->data.out_xfer->context;
-    xSemaphoreTake(transfer_finished_semaphore, 0); // Make sure the semaphore is taken before we submit new transfer
+esp_err_t cdc_acm_host_tx_buffer_get(cdc_acm_dev_hdl_t cdc_hdl, uint8_t **buf, size_t *buf_size, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(buf && buf_size, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.tx_free, ESP_ERR_NOT_SUPPORTED); // Device was opened without asynchronous OUT transfers
 
-    memcpy(cdc_dev->data.out_xfer->data_buffer, data, data_len);
-    cdc_dev->data.out_xfer->num_bytes = data_len;
-    cdc_dev->data.out_xfer->timeout_ms = timeout_ms;
-    ESP_GOTO_ON_ERROR(usb_host_transfer_submit(cdc_dev->data.out_xfer), unblock, TAG,);
+    cdc_tx_slot_t *slot;
+    if (xQueueReceive(cdc_dev->data.tx_free, &slot, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    slot->borrowed = true;
+    *buf = slot->xfer->data_buffer;
+    *buf_size = slot->xfer->data_buffer_size;
+    return ESP_OK;
+}
 
-    // Wait for OUT transfer completion
-    taken = xSemaphoreTake(transfer_finished_semaphore, pdMS_TO_TICKS(timeout_ms));
-    if (!taken) {
-        cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.out_xfer); // Resetting the endpoint will cause all in-progress transfers to complete
-        ESP_LOGW(TAG, "TX transfer timeout");
-        ret = ESP_ERR_TIMEOUT;
-        goto unblock;
+esp_err_t cdc_acm_host_tx_buffer_commit(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *buf, size_t data_len,
+                                        cdc_acm_tx_done_callback_t done_cb, void *done_arg)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(buf, ESP_ERR_INVALID_ARG);
+    cdc_tx_slot_t *slot = cdc_acm_tx_slot_find(cdc_dev, buf);
+    CDC_ACM_CHECK(slot && slot->borrowed, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(data_len <= slot->xfer->data_buffer_size, ESP_ERR_INVALID_SIZE);
+    slot->borrowed = false;
+
+    if (data_len == 0) {
+        // Nothing to send, just return the buffer
+        xQueueSend(cdc_dev->data.tx_free, &slot, 0);
+        return ESP_OK;
     }
+    return cdc_acm_tx_slot_submit(cdc_dev, slot, data_len, false, done_cb, done_arg);
+}
 
-    ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Bulk OUT transfer error");
-    ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->actual_num_bytes == data_len, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
-    ret = ESP_OK;
+esp_err_t cdc_acm_host_data_rx_blocking(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(data && (data_len > 0) && rx_len, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.rx_stream, ESP_ERR_NOT_SUPPORTED); // Device was opened without RX buffer
 
-unblock:
-    xSemaphoreGive(cdc_dev->data.out_mux);
-    return ret;
+    *rx_len = xStreamBufferReceive(cdc_dev->data.rx_stream, data, data_len, pdMS_TO_TICKS(timeout_ms));
+    return (*rx_len > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t cdc_acm_host_data_tx_async(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len,
+                                     cdc_acm_tx_done_callback_t done_cb, void *done_arg, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.tx_free, ESP_ERR_NOT_SUPPORTED); // Device was opened without asynchronous OUT transfers
+    CDC_ACM_CHECK(data_len <= cdc_dev->data.tx_slots[0].xfer->data_buffer_size, ESP_ERR_INVALID_SIZE);
+
+    // Get a free OUT transfer. Transfers of one endpoint are executed in order of submission
+    cdc_tx_slot_t *slot;
+    if (xQueueReceive(cdc_dev->data.tx_free, &slot, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    memcpy(slot->xfer->data_buffer, data, data_len);
+    return cdc_acm_tx_slot_submit(cdc_dev, slot, data_len, false, done_cb, done_arg);
 }
 
 esp_err_t cdc_acm_host_line_coding_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_line_coding_t *line_coding)
@@ -988,6 +2259,16 @@ esp_err_t cdc_acm_host_set_control_line_state(cdc_acm_dev_hdl_t cdc_hdl, bool dt
     return ESP_OK;
 }
 
+esp_err_t cdc_acm_host_send_encapsulated_command(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, uint16_t data_len)
+{
+    CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
+
+    ESP_RETURN_ON_ERROR(
+        send_cdc_request((cdc_dev_t *)cdc_hdl, false, USB_CDC_REQ_SEND_ENCAPSULATED_COMMAND, (uint8_t *)data, data_len, 0),
+        TAG,);
+    return ESP_OK;
+}
+
 esp_err_t cdc_acm_host_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_ms)
 {
     ESP_RETURN_ON_ERROR(
@@ -999,6 +2280,26 @@ esp_err_t cdc_acm_host_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_m
     return ESP_OK;
 }
 
+/**
+ * @brief Cancel control transfer of CDC device by reset of endpoint 0
+ *
+ * Endpoint 0 is shared by all interfaces of the USB device, so their queued control transfers are cancelled too.
+ * They see the changed ctrl_resets and resubmit their transfers.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_ctrl_reset(cdc_dev_t *cdc_dev)
+{
+    cdc_usb_dev_t *usb_dev = cdc_dev->usb_dev;
+    xSemaphoreTake(usb_dev->ctrl_reset_mux, portMAX_DELAY);
+    usb_dev->ctrl_resets++;
+    cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->ctrl_transfer);
+    xSemaphoreGive(usb_dev->ctrl_reset_mux);
+
+    // The flushed transfer is returned through out_xfer_cb(), its completion must not be mistaken for the next request
+    xSemaphoreTake((SemaphoreHandle_t)cdc_dev->ctrl_transfer->context, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS));
+}
+
 esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
 {
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
@@ -1010,8 +2311,13 @@ esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bm
 
     esp_err_t ret;
 
+    // One deadline covers waiting for other requests of this device and the transfer itself
+    TickType_t remaining = cdc_dev->ctrl_timeout;
+    TimeOut_t deadline;
+    vTaskSetTimeOutState(&deadline);
+
     // Take Mutex and fill the CTRL request
-    BaseType_t taken = xSemaphoreTake(cdc_dev->ctrl_mux, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS));
+    BaseType_t taken = xSemaphoreTake(cdc_dev->ctrl_mux, remaining);
     if (!taken) {
         return ESP_ERR_TIMEOUT;
     }
@@ -1030,16 +2336,33 @@ esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bm
     }
 
     cdc_dev->ctrl_transfer->num_bytes = wLength + sizeof(usb_setup_packet_t);
-    ESP_GOTO_ON_ERROR(
-        usb_host_transfer_submit_control(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->ctrl_transfer),
-        unblock, TAG, "CTRL transfer failed");
+    cdc_usb_dev_t *usb_dev = cdc_dev->usb_dev;
+    while (true) {
+        xSemaphoreTake(usb_dev->ctrl_reset_mux, portMAX_DELAY);
+        const uint32_t resets = usb_dev->ctrl_resets;
+        ret = usb_host_transfer_submit_control(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->ctrl_transfer);
+        xSemaphoreGive(usb_dev->ctrl_reset_mux);
+        ESP_GOTO_ON_ERROR(ret, unblock, TAG, "CTRL transfer failed");
+
+        const bool expired = (xTaskCheckForTimeOut(&deadline, &remaining) == pdTRUE);
+        taken = xSemaphoreTake((SemaphoreHandle_t)cdc_dev->ctrl_transfer->context, expired ? 0 : remaining);
+        if (!taken) {
+            // Transfer was not finished in time, the device or USB LIB is stuck. Reset the endpoint
+            cdc_acm_ctrl_reset(cdc_dev);
+            ret = ESP_ERR_TIMEOUT;
+            goto unblock;
+        }
 
-    taken = xSemaphoreTake((SemaphoreHandle_t)cdc_dev->ctrl_transfer->context, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS));
-    if (!taken) {
-        // Transfer was not finished, error in USB LIB. Reset the endpoint
-        cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->ctrl_transfer);
-        ret = ESP_ERR_TIMEOUT;
-        goto unblock;
+        // The request was only queued behind a request of another interface that timed out, try again
+        xSemaphoreTake(usb_dev->ctrl_reset_mux, portMAX_DELAY);
+        const bool reset_meanwhile = (usb_dev->ctrl_resets != resets);
+        xSemaphoreGive(usb_dev->ctrl_reset_mux);
+        if (cdc_dev->ctrl_transfer->status == USB_TRANSFER_STATUS_CANCELED && reset_meanwhile &&
+                xTaskCheckForTimeOut(&deadline, &remaining) == pdFALSE) {
+            ESP_LOGD(TAG, "CTRL transfer cancelled by endpoint reset, resubmitting");
+            continue;
+        }
+        break;
     }
 
     ESP_GOTO_ON_FALSE(cdc_dev->ctrl_transfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Control transfer error");
@@ -9,6 +9,7 @@
 #include "esp_check.h"
 #include "esp_log.h"
 #include "usb/usb_helpers.h"
+#include "usb/usb_host_desc_index.h"
 #include "usb/usb_types_cdc.h"
 #include "cdc_host_descriptor_parsing.h"
 
@@ -27,19 +28,17 @@ static const char *TAG = "cdc_acm_parsing";
  * @brief Searches interface by index and verifies its CDC-compliance
  *
  * @param[in] device_desc Pointer to Device descriptor
- * @param[in] config_desc Pointer do Configuration descriptor
+ * @param[in] index       Descriptor index of Configuration descriptor
  * @param[in] intf_idx    Index of the required interface
  * @return true  The required interface is CDC compliant
  * @return false The required interface is NOT CDC compliant
  */
-static bool cdc_parse_is_cdc_compliant(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx)
+static bool cdc_parse_is_cdc_compliant(const usb_device_desc_t *device_desc, const usb_host_desc_index_t *index, uint8_t intf_idx)
 {
-    int desc_offset = 0;
-
     if (device_desc->bDeviceClass == USB_CLASS_PER_INTERFACE ||
             device_desc->bDeviceClass == USB_CLASS_COMM) {
-        const usb_intf_desc_t *intf_desc = usb_parse_interface_descriptor(config_desc, intf_idx, 0, NULL);
-        if (intf_desc->bInterfaceClass == USB_CLASS_COMM) {
+        const usb_host_desc_index_alt_t *alt = usb_host_desc_index_get_alt(index, intf_idx, 0);
+        if (alt->intf_desc->bInterfaceClass == USB_CLASS_COMM) {
             // 1. This is a Communication Device Class: Class defined in Interface descriptor
             return true;
         }
@@ -49,16 +48,15 @@ static bool cdc_parse_is_cdc_compliant(const usb_device_desc_t *device_desc, con
             (device_desc->bDeviceProtocol == USB_DEVICE_PROTOCOL_IAD)) ||
             ((device_desc->bDeviceClass == USB_CLASS_PER_INTERFACE) && (device_desc->bDeviceSubClass == USB_SUBCLASS_NULL) &&
              (device_desc->bDeviceProtocol == USB_PROTOCOL_NULL))) {
-        const usb_standard_desc_t *this_desc = (const usb_standard_desc_t *)config_desc;
-        while ((this_desc = usb_parse_next_descriptor_of_type(this_desc, config_desc->wTotalLength, USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION, &desc_offset))) {
-            const usb_iad_desc_t *iad_desc = (const usb_iad_desc_t *)this_desc;
+        for (int i = 0; i < index->num_iads; i++) {
+            const usb_iad_desc_t *iad_desc = index->iads[i];
             if ((iad_desc->bFirstInterface == intf_idx) &&
                     (iad_desc->bInterfaceCount == 2) &&
                     (iad_desc->bFunctionClass == USB_CLASS_COMM)) {
                 // 2. This is a composite device, that uses Interface Association Descriptor
                 return true;
             }
-        };
+        }
     }
     return false;
 }
@@ -67,30 +65,27 @@ static bool cdc_parse_is_cdc_compliant(const usb_device_desc_t *device_desc, con
  * @brief Parse CDC functional descriptors
  *
  * @attention The driver must take care of memory freeing
- * @param[in] intf_desc   Pointer to Notification interface descriptor
- * @param[in] total_len   wTotalLength of the Configuration descriptor
- * @param[in] desc_offset Offset of the intf_desc in the Configuration descriptor in bytes
+ * @param[in] alt         Alternate setting of Notification interface
  * @param[out] desc_cnt   Number of Functional descriptors found
  * @return Pointer to array of pointers to Functional descriptors
  */
-static cdc_func_array_t *cdc_parse_functional_descriptors(const usb_intf_desc_t *intf_desc, uint16_t total_len, int desc_offset, int *desc_cnt)
+static cdc_func_array_t *cdc_parse_functional_descriptors(const usb_host_desc_index_alt_t *alt, int *desc_cnt)
 {
-    // CDC specific descriptors should be right after CDC-Communication interface descriptor
-    // Note: That's why we use usb_parse_next_descriptor instead of usb_parse_next_descriptor_of_type.
-    // The latter could return CDC specific descriptors that don't belong to this interface
+    // CDC specific descriptors should be right after CDC-Communication interface descriptor,
+    // before any endpoint descriptor and any descriptor of other type
+    const usb_standard_desc_t *first_ep = alt->num_eps ? (const usb_standard_desc_t *)alt->ep_descs[0] : NULL;
     int func_desc_cnt = 0;
-    int intf_offset = desc_offset;
-    const usb_standard_desc_t *cdc_desc = (const usb_standard_desc_t *)intf_desc;
-    while ((cdc_desc = usb_parse_next_descriptor(cdc_desc, total_len, &intf_offset))) {
-        if (cdc_desc->bDescriptorType != ((USB_CLASS_COMM << 4) | USB_B_DESCRIPTOR_TYPE_INTERFACE )) {
-            if (func_desc_cnt == 0) {
-                return NULL; // There are no CDC specific descriptors
-            } else {
-                break;       // We found all CDC specific descriptors
-            }
+    while (func_desc_cnt < alt->num_class_descs) {
+        const usb_standard_desc_t *cdc_desc = alt->class_descs[func_desc_cnt];
+        if (cdc_desc->bDescriptorType != ((USB_CLASS_COMM << 4) | USB_B_DESCRIPTOR_TYPE_INTERFACE) ||
+                (first_ep && (const uint8_t *)cdc_desc > (const uint8_t *)first_ep)) {
+            break;
         }
         func_desc_cnt++;
     }
+    if (func_desc_cnt == 0) {
+        return NULL; // There are no CDC specific descriptors
+    }
 
     // Allocate memory for the functional descriptors pointers
     cdc_func_array_t *func_desc = malloc(func_desc_cnt * (sizeof(usb_standard_desc_t *)));
@@ -100,49 +95,51 @@ static cdc_func_array_t *cdc_parse_functional_descriptors(const usb_intf_desc_t
     }
 
     // Save the descriptors
-    intf_offset = desc_offset; // Reset the offset counter
-    cdc_desc = (const usb_standard_desc_t *)intf_desc;
     for (int i = 0; i < func_desc_cnt; i++) {
-        cdc_desc = (const usb_standard_desc_t *)usb_parse_next_descriptor(cdc_desc, total_len, &intf_offset);
-        (*func_desc)[i] = cdc_desc;
+        (*func_desc)[i] = alt->class_descs[i];
     }
     *desc_cnt = func_desc_cnt;
     return func_desc;
 }
 
-esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx, cdc_parsed_info_t *info_ret)
+/**
+ * @brief Sort endpoints of an alternate setting into parsed information
+ *
+ * @param[in]  alt         Alternate setting
+ * @param[in]  with_notif  Interrupt endpoint is the notification element, otherwise only bulk endpoints are used
+ * @param[out] info_ret    Parsed information
+ */
+static void cdc_parse_endpoints(const usb_host_desc_index_alt_t *alt, bool with_notif, cdc_parsed_info_t *info_ret)
 {
-    int desc_offset = 0;
-
-    memset(info_ret, 0, sizeof(cdc_parsed_info_t));
-    const usb_intf_desc_t *first_intf_desc = usb_parse_interface_descriptor(config_desc, intf_idx, 0, &desc_offset);
-    ESP_RETURN_ON_FALSE(
-        first_intf_desc,
-        ESP_ERR_NOT_FOUND, TAG, "Required interface no %d was not found.", intf_idx);
-
-    int temp_offset = desc_offset;
-    for (int i = 0; i < first_intf_desc->bNumEndpoints; i++) {
-        const usb_ep_desc_t *this_ep = usb_parse_endpoint_descriptor_by_index(first_intf_desc, i, config_desc->wTotalLength, &desc_offset);
-        assert(this_ep);
-
-        if (USB_EP_DESC_GET_XFERTYPE(this_ep) == USB_TRANSFER_TYPE_INTR) {
-            info_ret->notif_intf = first_intf_desc;
+    for (int i = 0; i < alt->num_eps; i++) {
+        const usb_ep_desc_t *this_ep = alt->ep_descs[i];
+        if (with_notif && USB_EP_DESC_GET_XFERTYPE(this_ep) == USB_TRANSFER_TYPE_INTR) {
+            info_ret->notif_intf = alt->intf_desc;
             info_ret->notif_ep = this_ep;
         } else if (USB_EP_DESC_GET_XFERTYPE(this_ep) == USB_TRANSFER_TYPE_BULK) {
-            info_ret->data_intf = first_intf_desc;
+            info_ret->data_intf = alt->intf_desc;
             if (USB_EP_DESC_GET_EP_DIR(this_ep)) {
                 info_ret->in_ep = this_ep;
             } else {
                 info_ret->out_ep = this_ep;
             }
         }
-        desc_offset = temp_offset;
     }
+}
 
-    const bool cdc_compliant = cdc_parse_is_cdc_compliant(device_desc, config_desc, intf_idx);
+esp_err_t cdc_parse_interface_index(const usb_device_desc_t *device_desc, const usb_host_desc_index_t *index, uint8_t intf_idx, cdc_parsed_info_t *info_ret)
+{
+    memset(info_ret, 0, sizeof(cdc_parsed_info_t));
+    const usb_host_desc_index_alt_t *first_alt = usb_host_desc_index_get_alt(index, intf_idx, 0);
+    ESP_RETURN_ON_FALSE(
+        first_alt,
+        ESP_ERR_NOT_FOUND, TAG, "Required interface no %d was not found.", intf_idx);
+    cdc_parse_endpoints(first_alt, true, info_ret);
+
+    const bool cdc_compliant = cdc_parse_is_cdc_compliant(device_desc, index, intf_idx);
     if (cdc_compliant) {
-        info_ret->notif_intf = first_intf_desc; // We make sure that intf_desc is set for CDC compliant devices that use EP0 as notification element
-        info_ret->func = cdc_parse_functional_descriptors(first_intf_desc, config_desc->wTotalLength, desc_offset, &info_ret->func_cnt);
+        info_ret->notif_intf = first_alt->intf_desc; // We make sure that intf_desc is set for CDC compliant devices that use EP0 as notification element
+        info_ret->func = cdc_parse_functional_descriptors(first_alt, &info_ret->func_cnt);
     }
 
     if (!info_ret->data_intf && cdc_compliant) {
@@ -150,24 +147,10 @@ esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, c
         // Some devices offer alternate settings for data interface:
         // First interface with 0 endpoints (default control pipe only) and second with standard 2 endpoints for full-duplex data
         // We always select interface with 2 bulk endpoints
-        const int num_of_alternate = usb_parse_interface_number_of_alternate(config_desc, intf_idx + 1);
-        for (int i = 0; i < num_of_alternate + 1; i++) {
-            const usb_intf_desc_t *second_intf_desc = usb_parse_interface_descriptor(config_desc, intf_idx + 1, i, &desc_offset);
-            temp_offset = desc_offset;
-            if (second_intf_desc && second_intf_desc->bNumEndpoints == 2) {
-                for (int i = 0; i < second_intf_desc->bNumEndpoints; i++) {
-                    const usb_ep_desc_t *this_ep = usb_parse_endpoint_descriptor_by_index(second_intf_desc, i, config_desc->wTotalLength, &desc_offset);
-                    assert(this_ep);
-                    if (USB_EP_DESC_GET_XFERTYPE(this_ep) == USB_TRANSFER_TYPE_BULK) {
-                        info_ret->data_intf = second_intf_desc;
-                        if (USB_EP_DESC_GET_EP_DIR(this_ep)) {
-                            info_ret->in_ep = this_ep;
-                        } else {
-                            info_ret->out_ep = this_ep;
-                        }
-                    }
-                    desc_offset = temp_offset;
-                }
+        const usb_host_desc_index_intf_t *second_intf = usb_host_desc_index_get_intf(index, intf_idx + 1);
+        for (int i = 0; second_intf && i < second_intf->num_alts; i++) {
+            if (second_intf->alts[i].intf_desc->bNumEndpoints == 2) {
+                cdc_parse_endpoints(&second_intf->alts[i], false, info_ret);
                 break;
             }
         }
@@ -177,6 +160,17 @@ esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, c
     return (info_ret->in_ep && info_ret->out_ep) ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
+esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx, cdc_parsed_info_t *info_ret)
+{
+    usb_host_desc_index_t *index;
+    memset(info_ret, 0, sizeof(cdc_parsed_info_t));
+    ESP_RETURN_ON_ERROR(usb_host_desc_index_build(config_desc, &index), TAG, "Invalid Configuration descriptor");
+    const esp_err_t ret = cdc_parse_interface_index(device_desc, index, intf_idx, info_ret);
+    usb_host_desc_index_free(index);
+    return ret;
+}
+
+#ifndef CONFIG_CDC_ACM_HOST_MINIMAL
 void cdc_print_desc(const usb_standard_desc_t *_desc)
 {
     if (_desc->bDescriptorType != ((USB_CLASS_COMM << 4) | USB_B_DESCRIPTOR_TYPE_INTERFACE )) {
@@ -216,3 +210,4 @@ void cdc_print_desc(const usb_standard_desc_t *_desc)
         break;
     }
 }
+#endif // CONFIG_CDC_ACM_HOST_MINIMAL
@@ -0,0 +1,241 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cdc_host_framing.h"
+
+#define HDLC_FLAG        (0x7E)
+#define HDLC_ESCAPE      (0x7D)
+#define HDLC_ESCAPE_XOR  (0x20)
+#define HDLC_FCS_INIT    (0xFFFF)
+#define HDLC_FCS_GOOD    (0xF0B8) // FCS-16 computed over a frame including its FCS (RFC 1662)
+#define HDLC_FCS_LEN     (2)
+
+#define SLIP_END         (0xC0)
+#define SLIP_ESC         (0xDB)
+#define SLIP_ESC_END     (0xDC)
+#define SLIP_ESC_ESC     (0xDD)
+
+#define FRAMER_WORD_ONES (0x01010101u)
+#define FRAMER_WORD_HIGH (0x80808080u)
+
+struct cdc_framer_s {
+    cdc_acm_framing_t type;
+    uint8_t flag;              // Byte delimiting frames
+    uint8_t escape;            // Byte escaping the following one
+    bool check_fcs;            // FCS-16 is checked and removed from delivered frames
+    bool escaped;              // Last byte of previous data was escape
+    bool discard;              // Current frame is dropped at its end, it was aborted or it does not fit into buf
+    uint16_t fcs;              // FCS-16 of current frame so far
+    size_t len;                // Length of current frame so far
+    size_t size;               // Size of buf
+    uint8_t buf[];             // Unescaped current frame
+};
+
+// FCS-16 lookup table, polynomial x^16 + x^12 + x^5 + 1 in reversed bit order (RFC 1662)
+static const uint16_t fcs16_table[256] = {
+    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+    0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+    0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+    0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+    0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+    0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+    0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+    0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+    0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+    0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+    0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+    0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+    0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+    0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+    0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+    0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+    0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+    0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+    0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+    0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+    0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+    0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+    0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+    0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+    0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+    0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+    0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+    0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+static uint16_t fcs16_update(uint16_t fcs, const uint8_t *data, size_t len)
+{
+    while (len--) {
+        fcs = (fcs >> 8) ^ fcs16_table[(fcs ^ *data++) & 0xFF];
+    }
+    return fcs;
+}
+
+/**
+ * @brief Check whether any byte of the word equals the byte repeated in pattern
+ *
+ * Bytes equal to the pattern are zero after XOR, and only zero bytes borrow into their top bit when 1 is subtracted.
+ */
+static inline uint32_t framer_word_has(uint32_t word, uint32_t pattern)
+{
+    const uint32_t x = word ^ pattern;
+    return (x - FRAMER_WORD_ONES) & ~x & FRAMER_WORD_HIGH;
+}
+
+/**
+ * @brief Find the first flag or escape byte
+ *
+ * @return Offset of the byte, len if there is none
+ */
+static size_t cdc_framer_scan(const cdc_framer_t *framer, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+    // Byte-wise up to word alignment
+    for (; i < len && ((uintptr_t)(data + i) & (sizeof(uint32_t) - 1)); i++) {
+        if (data[i] == framer->flag || data[i] == framer->escape) {
+            return i;
+        }
+    }
+    // Word-wise through the runs of ordinary bytes, which make most of the data
+    const uint32_t flag = framer->flag * FRAMER_WORD_ONES;
+    const uint32_t escape = framer->escape * FRAMER_WORD_ONES;
+    for (; i + sizeof(uint32_t) <= len; i += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, data + i, sizeof(word)); // Aligned, compiled as a single load
+        if (framer_word_has(word, flag) | framer_word_has(word, escape)) {
+            break;
+        }
+    }
+    // Byte-wise in the word that contains the special byte, and in the tail
+    for (; i < len; i++) {
+        if (data[i] == framer->flag || data[i] == framer->escape) {
+            return i;
+        }
+    }
+    return len;
+}
+
+static void cdc_framer_append(cdc_framer_t *framer, const uint8_t *data, size_t len)
+{
+    if (framer->discard || len == 0) {
+        return;
+    }
+    if (len > framer->size - framer->len) {
+        framer->discard = true;
+        return;
+    }
+    memcpy(framer->buf + framer->len, data, len);
+    framer->len += len;
+    if (framer->check_fcs) {
+        framer->fcs = fcs16_update(framer->fcs, data, len);
+    }
+}
+
+static uint8_t cdc_framer_unescape(const cdc_framer_t *framer, uint8_t byte)
+{
+    if (framer->type == CDC_ACM_FRAMING_SLIP) {
+        if (byte == SLIP_ESC_END) {
+            return SLIP_END;
+        }
+        if (byte == SLIP_ESC_ESC) {
+            return SLIP_ESC;
+        }
+        return byte; // Protocol violation, RFC 1055 keeps the byte
+    }
+    return byte ^ HDLC_ESCAPE_XOR;
+}
+
+/**
+ * @brief Deliver the current frame and start a new one
+ *
+ * @return 1 if the frame was dropped, 0 otherwise
+ */
+static size_t cdc_framer_frame_end(cdc_framer_t *framer, cdc_acm_frame_callback_t frame_cb, void *arg)
+{
+    size_t dropped = 0;
+    if (framer->discard) {
+        dropped = 1;
+    } else if (framer->len > 0) { // Empty frames of back-to-back flags are ignored
+        size_t len = framer->len;
+        if (framer->check_fcs) {
+            if (len <= HDLC_FCS_LEN || framer->fcs != HDLC_FCS_GOOD) {
+                dropped = 1;
+            }
+            len -= HDLC_FCS_LEN;
+        }
+        if (!dropped && frame_cb) {
+            frame_cb(framer->buf, len, arg);
+        }
+    }
+    framer->len = 0;
+    framer->fcs = HDLC_FCS_INIT;
+    framer->discard = false;
+    return dropped;
+}
+
+cdc_framer_t *cdc_framer_create(cdc_acm_framing_t type, size_t max_frame_size)
+{
+    if (type != CDC_ACM_FRAMING_HDLC && type != CDC_ACM_FRAMING_HDLC_NO_FCS && type != CDC_ACM_FRAMING_SLIP) {
+        return NULL;
+    }
+    cdc_framer_t *framer = calloc(1, sizeof(cdc_framer_t) + max_frame_size);
+    if (framer == NULL) {
+        return NULL;
+    }
+    framer->type = type;
+    framer->flag = (type == CDC_ACM_FRAMING_SLIP) ? SLIP_END : HDLC_FLAG;
+    framer->escape = (type == CDC_ACM_FRAMING_SLIP) ? SLIP_ESC : HDLC_ESCAPE;
+    framer->check_fcs = (type == CDC_ACM_FRAMING_HDLC);
+    framer->fcs = HDLC_FCS_INIT;
+    framer->size = max_frame_size;
+    return framer;
+}
+
+void cdc_framer_delete(cdc_framer_t *framer)
+{
+    free(framer);
+}
+
+size_t cdc_framer_feed(cdc_framer_t *framer, const uint8_t *data, size_t data_len, cdc_acm_frame_callback_t frame_cb, void *arg)
+{
+    size_t dropped = 0;
+    size_t i = 0;
+    while (i < data_len) {
+        if (framer->escaped) {
+            framer->escaped = false;
+            const uint8_t byte = data[i];
+            if (byte == framer->flag) {
+                // Escape followed by flag aborts the frame (RFC 1662 section 4.2), the flag is processed below
+                framer->discard = true;
+                continue;
+            }
+            const uint8_t unescaped = cdc_framer_unescape(framer, byte);
+            cdc_framer_append(framer, &unescaped, 1);
+            i++;
+            continue;
+        }
+
+        const size_t run = cdc_framer_scan(framer, data + i, data_len - i);
+        cdc_framer_append(framer, data + i, run);
+        i += run;
+        if (i == data_len) {
+            break;
+        }
+        if (data[i] == framer->flag) {
+            dropped += cdc_framer_frame_end(framer, frame_cb, arg);
+        } else {
+            framer->escaped = true;
+        }
+        i++;
+    }
+    return dropped;
+}
@@ -0,0 +1,186 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/*
+ * Encapsulated commands and responses
+ *
+ * Notifications are injected by completing the notification transfer of a mocked device. RESPONSE_AVAILABLE
+ * notification makes the driver read GET_ENCAPSULATED_RESPONSE, the read is completed by the test.
+ */
+
+constexpr uint8_t device_address = 0, interface_index = 2;
+constexpr uint16_t vid = 0x2C7C, pid = 0x0296; // BG96, interface 2 has notification endpoint
+constexpr size_t response_size = 64;
+
+static usb_transfer_t *s_notif_xfer;
+static usb_transfer_t *s_resp_xfer;            // GET_ENCAPSULATED_RESPONSE waiting for completion by the test
+static std::vector<usb_setup_packet_t> s_ctrl_requests;
+static std::vector<std::vector<uint8_t>> s_responses;
+
+static esp_err_t notif_xfer_capture(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    if (transfer->bEndpointAddress == 0x83) {
+        s_notif_xfer = transfer;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Record the CTRL request, complete OUT requests from within usb_host_transfer_submit_control()
+ */
+static esp_err_t ctrl_xfer_record(usb_host_client_handle_t client_hdl, usb_transfer_t *transfer, int cmock_num_calls)
+{
+    const usb_setup_packet_t *req = (const usb_setup_packet_t *)transfer->data_buffer;
+    s_ctrl_requests.push_back(*req);
+    if (req->bRequest == USB_CDC_REQ_GET_ENCAPSULATED_RESPONSE) {
+        s_resp_xfer = transfer;
+        return ESP_OK;
+    }
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+    return ESP_OK;
+}
+
+static void response_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
+{
+    if (event->type == CDC_ACM_HOST_ENCAPSULATED_RESPONSE) {
+        const uint8_t *data = event->data.encapsulated_response.data;
+        s_responses.emplace_back(data, data + event->data.encapsulated_response.data_len);
+    }
+}
+
+/**
+ * @brief Complete the notification transfer with RESPONSE_AVAILABLE notification
+ */
+static void response_available_notify(void)
+{
+    cdc_notification_t *notif = (cdc_notification_t *)s_notif_xfer->data_buffer;
+    notif->bmRequestType = 0xA1;
+    notif->bNotificationCode = USB_CDC_NOTIF_RESPONSE_AVAILABLE;
+    notif->wValue = 0;
+    notif->wIndex = interface_index;
+    notif->wLength = 0;
+    s_notif_xfer->actual_num_bytes = sizeof(cdc_notification_t);
+    s_notif_xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK); // The notification transfer is re-submitted
+    s_notif_xfer->callback(s_notif_xfer);
+}
+
+/**
+ * @brief Complete the pending GET_ENCAPSULATED_RESPONSE with the response
+ */
+static void encapsulated_response_complete(const char *response)
+{
+    usb_transfer_t *transfer = s_resp_xfer;
+    s_resp_xfer = nullptr;
+    memcpy(transfer->data_buffer + sizeof(usb_setup_packet_t), response, strlen(response));
+    transfer->actual_num_bytes = sizeof(usb_setup_packet_t) + strlen(response);
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+}
+
+SCENARIO("Encapsulated command")
+{
+    usb_host_mock_dev_list_init();
+    REQUIRE(ESP_OK == usb_host_mock_add_device(device_address, (const usb_device_desc_t *)bg96_device_desc_fs_hs,
+            (const usb_config_desc_t *)bg96_config_desc_fs));
+    REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+    cdc_acm_host_device_config_t dev_config = {};
+    dev_config.connection_timeout_ms = 1000;
+    dev_config.out_buffer_size = 64;
+    dev_config.in_buffer_size = 64;
+    dev_config.event_cb = response_cb;
+    dev_config.encapsulated_response_size = response_size;
+
+    cdc_acm_dev_hdl_t dev = nullptr;
+    s_notif_xfer = nullptr;
+    s_resp_xfer = nullptr;
+    s_ctrl_requests.clear();
+    s_responses.clear();
+    usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK); // GET_ENCAPSULATED_RESPONSE transfer
+    usb_host_transfer_submit_AddCallback(notif_xfer_capture);
+    REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+    usb_host_transfer_submit_AddCallback(nullptr);
+    REQUIRE(dev != nullptr);
+    REQUIRE(s_notif_xfer != nullptr);
+    usb_host_transfer_submit_control_Stub(ctrl_xfer_record);
+
+    GIVEN("Command is sent") {
+        const uint8_t command[] = "AT\r";
+        REQUIRE(ESP_OK == cdc_acm_host_send_encapsulated_command(dev, command, sizeof(command)));
+
+        THEN("SEND_ENCAPSULATED_COMMAND carries the command") {
+            REQUIRE(s_ctrl_requests.size() == 1);
+            CHECK(s_ctrl_requests[0].bmRequestType == 0x21);
+            CHECK(s_ctrl_requests[0].bRequest == USB_CDC_REQ_SEND_ENCAPSULATED_COMMAND);
+            CHECK(s_ctrl_requests[0].wIndex == interface_index);
+            CHECK(s_ctrl_requests[0].wLength == sizeof(command));
+        }
+    }
+
+    GIVEN("Invalid command") {
+        THEN("It is rejected") {
+            CHECK(ESP_ERR_INVALID_ARG == cdc_acm_host_send_encapsulated_command(dev, nullptr, 10));
+            CHECK(s_ctrl_requests.empty());
+        }
+    }
+
+    GIVEN("Device announces a response") {
+        response_available_notify();
+
+        THEN("GET_ENCAPSULATED_RESPONSE is issued without polling") {
+            REQUIRE(s_ctrl_requests.size() == 1);
+            CHECK(s_ctrl_requests[0].bmRequestType == 0xA1);
+            CHECK(s_ctrl_requests[0].bRequest == USB_CDC_REQ_GET_ENCAPSULATED_RESPONSE);
+            CHECK(s_ctrl_requests[0].wIndex == interface_index);
+            CHECK(s_ctrl_requests[0].wLength == response_size);
+            REQUIRE(s_resp_xfer != nullptr);
+        }
+
+        encapsulated_response_complete("OK");
+        THEN("The response is delivered to the user") {
+            REQUIRE(s_responses.size() == 1);
+            CHECK(s_responses[0] == std::vector<uint8_t>({'O', 'K'}));
+        }
+    }
+
+    GIVEN("Device announces another response while the first one is being read") {
+        response_available_notify();
+        response_available_notify();
+
+        THEN("The second response is read after the first one") {
+            CHECK(s_ctrl_requests.size() == 1);
+            encapsulated_response_complete("first");
+            CHECK(s_ctrl_requests.size() == 2);
+            encapsulated_response_complete("second");
+            CHECK(s_ctrl_requests.size() == 2);
+
+            REQUIRE(s_responses.size() == 2);
+            CHECK(s_responses[0] == std::vector<uint8_t>({'f', 'i', 'r', 's', 't'}));
+            CHECK(s_responses[1] == std::vector<uint8_t>({'s', 'e', 'c', 'o', 'n', 'd'}));
+        }
+    }
+
+    usb_host_transfer_submit_control_Stub(nullptr);
+    usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK); // GET_ENCAPSULATED_RESPONSE transfer
+    REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+    REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+}
@@ -0,0 +1,150 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/*
+ * Coalescing of SERIAL_STATE notifications with serial_state_interval_ms
+ *
+ * Notifications are injected by completing the notification transfer of a mocked device. Events coalesced within
+ * the interval are delivered from the driver's task, so usb_host_client_handle_events() is stubbed to return
+ * after one tick instead of blocking until the driver is uninstalled.
+ */
+
+constexpr uint8_t device_address = 0, interface_index = 2;
+constexpr uint16_t vid = 0x2C7C, pid = 0x0296; // BG96, interface 2 has notification endpoint with MPS 64
+constexpr uint32_t interval_ms = 200;
+
+static usb_transfer_t *s_notif_xfer;
+static std::atomic<int> s_serial_state_events;
+static std::atomic<uint16_t> s_serial_state;
+
+static esp_err_t notif_xfer_capture(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    if (transfer->bEndpointAddress == 0x83) {
+        s_notif_xfer = transfer;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t handle_events_poll(usb_host_client_handle_t client_hdl, TickType_t timeout_ticks, int cmock_num_calls)
+{
+    vTaskDelay(1); // The driver's task delivers coalesced events between the calls
+    return ESP_OK;
+}
+
+static void serial_state_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
+{
+    if (event->type == CDC_ACM_HOST_SERIAL_STATE) {
+        s_serial_state = event->data.serial_state.val;
+        s_serial_state_events++;
+    }
+}
+
+/**
+ * @brief Complete the notification transfer with SERIAL_STATE notification
+ */
+static void serial_state_notify(uint16_t state)
+{
+    cdc_notification_t *notif = (cdc_notification_t *)s_notif_xfer->data_buffer;
+    notif->bmRequestType = 0xA1;
+    notif->bNotificationCode = USB_CDC_NOTIF_SERIAL_STATE;
+    notif->wValue = 0;
+    notif->wIndex = interface_index;
+    notif->wLength = sizeof(state);
+    memcpy(notif->Data, &state, sizeof(state));
+    s_notif_xfer->actual_num_bytes = sizeof(cdc_notification_t) + sizeof(state);
+    s_notif_xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    s_notif_xfer->callback(s_notif_xfer);
+}
+
+static cdc_acm_dev_hdl_t serial_state_device_open(uint32_t serial_state_interval_ms)
+{
+    usb_host_mock_dev_list_init();
+    REQUIRE(ESP_OK == usb_host_mock_add_device(device_address, (const usb_device_desc_t *)bg96_device_desc_fs_hs,
+            (const usb_config_desc_t *)bg96_config_desc_fs));
+
+    usb_host_client_register_ExpectAnyArgsAndReturn(ESP_OK);
+    usb_host_client_register_AddCallback(usb_host_client_register_mock_callback);
+    usb_host_client_handle_events_Stub(handle_events_poll);
+    REQUIRE(ESP_OK == cdc_acm_host_install(nullptr));
+
+    cdc_acm_host_device_config_t dev_config = {};
+    dev_config.connection_timeout_ms = 1000;
+    dev_config.out_buffer_size = 64;
+    dev_config.in_buffer_size = 64;
+    dev_config.event_cb = serial_state_cb;
+    dev_config.serial_state_interval_ms = serial_state_interval_ms;
+
+    cdc_acm_dev_hdl_t dev = nullptr;
+    s_notif_xfer = nullptr;
+    s_serial_state_events = 0;
+    usb_host_transfer_submit_AddCallback(notif_xfer_capture);
+    REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+    usb_host_transfer_submit_AddCallback(nullptr);
+    REQUIRE(dev != nullptr);
+    REQUIRE(s_notif_xfer != nullptr);
+    return dev;
+}
+
+static void serial_state_device_close(cdc_acm_dev_hdl_t dev)
+{
+    REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+    REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+    usb_host_client_handle_events_Stub(nullptr);
+}
+
+SCENARIO("SERIAL_STATE coalescing")
+{
+    GIVEN("No interval is set") {
+        cdc_acm_dev_hdl_t dev = serial_state_device_open(0);
+
+        usb_host_transfer_submit_IgnoreAndReturn(ESP_OK); // The notification transfer is re-submitted after each completion
+        serial_state_notify(0x0001);
+        serial_state_notify(0x0003);
+        serial_state_notify(0x0002);
+        usb_host_transfer_submit_StopIgnore();
+
+        THEN("Every notification is delivered immediately") {
+            CHECK(s_serial_state_events == 3);
+            CHECK(s_serial_state == 0x0002);
+        }
+        serial_state_device_close(dev);
+    }
+
+    GIVEN("Interval is set") {
+        cdc_acm_dev_hdl_t dev = serial_state_device_open(interval_ms);
+
+        usb_host_transfer_submit_IgnoreAndReturn(ESP_OK);
+        serial_state_notify(0x0001);
+        serial_state_notify(0x0003);
+        serial_state_notify(0x0002);
+        usb_host_transfer_submit_StopIgnore();
+
+        THEN("The first change is delivered immediately, the following ones are coalesced") {
+            CHECK(s_serial_state_events == 1);
+            CHECK(s_serial_state == 0x0001);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(2 * interval_ms));
+        THEN("Only the latest state is delivered at the end of the interval") {
+            CHECK(s_serial_state_events == 2);
+            CHECK(s_serial_state == 0x0002);
+        }
+        serial_state_device_close(dev);
+    }
+}
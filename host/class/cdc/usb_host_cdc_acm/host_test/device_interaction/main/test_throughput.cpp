@@ -0,0 +1,174 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/*
+ * Data path throughput benchmark
+ *
+ * A mocked device is opened and completions of bulk transfers are replayed through the driver's transfer callbacks
+ * as fast as possible. IN transfers are completed directly, so in_xfer_cb() processes the data and resubmits
+ * the transfer. OUT transfers of cdc_acm_host_data_tx_blocking() are completed from the mocked
+ * usb_host_transfer_submit(), so out_xfer_cb() wakes up the sending task. Results are printed in ns per transfer,
+ * so changes to buffering and locking can be compared between CI runs without hardware.
+ *
+ * Environment variables:
+ * - CDC_BENCHMARK_TRANSFERS:           Number of transfers in each configuration (default 100000)
+ * - CDC_BENCHMARK_MAX_NS_PER_TRANSFER: If set, the test fails when any configuration is slower than this
+ */
+
+constexpr uint8_t device_address = 0, interface_index = 0;
+constexpr uint16_t vid = 0x10C4, pid = 0xEA60; // CP210x, no notification endpoint
+
+/**
+ * @brief Transfer size configuration
+ */
+struct transfer_config_t {
+    const char *name;
+    size_t size;
+};
+
+static usb_transfer_t *s_in_xfer;
+static size_t s_rx_bytes;
+
+static int benchmark_transfers(void)
+{
+    const char *transfers = getenv("CDC_BENCHMARK_TRANSFERS");
+    return transfers ? atoi(transfers) : 100000;
+}
+
+static void benchmark_check(const char *direction, const transfer_config_t &config, double ns)
+{
+    printf("%-4s %-32s %8.1f ns/transfer %8.0f MB/s\n", direction, config.name, ns, config.size * 1000.0 / ns);
+    const char *max_ns = getenv("CDC_BENCHMARK_MAX_NS_PER_TRANSFER");
+    if (max_ns) {
+        CHECK(ns <= atof(max_ns));
+    }
+}
+
+/**
+ * @brief Remember the IN transfer submitted while the device is opened
+ */
+static esp_err_t in_xfer_capture(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    if (transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) {
+        s_in_xfer = transfer;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Complete the OUT transfer from within usb_host_transfer_submit()
+ */
+static esp_err_t out_xfer_complete(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+    return ESP_OK;
+}
+
+static bool rx_count(const uint8_t *data, size_t data_len, void *user_arg)
+{
+    s_rx_bytes += data_len;
+    return true;
+}
+
+static cdc_acm_dev_hdl_t benchmark_device_open(size_t size)
+{
+    usb_host_mock_dev_list_init();
+    REQUIRE(ESP_OK == usb_host_mock_add_device(device_address, (const usb_device_desc_t *)cp210x_device_desc,
+            (const usb_config_desc_t *)cp210x_config_desc));
+    REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 1000,
+        .out_buffer_size = size,
+        .in_buffer_size = size,
+        .event_cb = nullptr,
+        .data_cb = rx_count,
+        .user_arg = nullptr,
+    };
+    cdc_acm_dev_hdl_t dev = nullptr;
+    s_in_xfer = nullptr;
+    usb_host_transfer_submit_AddCallback(in_xfer_capture);
+    REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+    usb_host_transfer_submit_AddCallback(nullptr);
+    REQUIRE(dev != nullptr);
+    REQUIRE(s_in_xfer != nullptr);
+    return dev;
+}
+
+static void benchmark_device_close(cdc_acm_dev_hdl_t dev)
+{
+    REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+    REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+}
+
+TEST_CASE("Bulk IN transfer processing speed", "[throughput][benchmark]")
+{
+    const transfer_config_t config = GENERATE(values<transfer_config_t>({
+        {"64 B transfers", 64},
+        {"512 B transfers", 512},
+        {"4 kB transfers", 4 * 1024},
+    }));
+    cdc_acm_dev_hdl_t dev = benchmark_device_open(config.size);
+    const int transfers = benchmark_transfers();
+    s_rx_bytes = 0;
+
+    usb_host_transfer_submit_IgnoreAndReturn(ESP_OK); // The IN transfer is re-submitted after each completion
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < transfers; i++) {
+        s_in_xfer->actual_num_bytes = config.size;
+        s_in_xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+        s_in_xfer->callback(s_in_xfer);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / transfers;
+    usb_host_transfer_submit_StopIgnore();
+
+    REQUIRE(s_rx_bytes == (size_t)transfers * config.size);
+    benchmark_check("IN", config, ns);
+    benchmark_device_close(dev);
+}
+
+TEST_CASE("Bulk OUT transfer processing speed", "[throughput][benchmark]")
+{
+    const transfer_config_t config = GENERATE(values<transfer_config_t>({
+        {"64 B transfers", 64},
+        {"512 B transfers", 512},
+        {"4 kB transfers", 4 * 1024},
+    }));
+    cdc_acm_dev_hdl_t dev = benchmark_device_open(config.size);
+    const int transfers = benchmark_transfers();
+    const std::vector<uint8_t> tx_buf(config.size, 0xA5);
+
+    int sent = 0;
+    usb_host_transfer_submit_Stub(out_xfer_complete);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < transfers; i++) {
+        sent += (ESP_OK == cdc_acm_host_data_tx_blocking(dev, tx_buf.data(), tx_buf.size(), 100));
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / transfers;
+    usb_host_transfer_submit_Stub(nullptr);
+
+    REQUIRE(sent == transfers);
+    benchmark_check("OUT", config, ns);
+    benchmark_device_close(dev);
+}
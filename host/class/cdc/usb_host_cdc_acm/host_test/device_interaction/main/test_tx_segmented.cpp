@@ -0,0 +1,100 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/*
+ * Blocking write longer than out_buffer_size, sent through the OUT transfer of blocking writes
+ *
+ * Segments are multiples of MPS, so only the last segment may end the write with zero-length packet.
+ */
+
+constexpr uint8_t device_address = 0, interface_index = 0;
+constexpr uint16_t vid = 0x10C4, pid = 0xEA60; // CP210x, Full-speed bulk endpoints with MPS 64
+
+/**
+ * @brief OUT transfer as submitted to the USB Host Library
+ */
+struct out_segment_t {
+    int num_bytes;
+    bool zlp;
+};
+
+static std::vector<out_segment_t> s_segments;
+
+/**
+ * @brief Record the OUT transfer and complete it from within usb_host_transfer_submit()
+ */
+static esp_err_t out_xfer_record(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    s_segments.push_back({transfer->num_bytes, (transfer->flags & USB_TRANSFER_FLAG_ZERO_PACK) != 0});
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+    return ESP_OK;
+}
+
+SCENARIO("Segmented blocking write")
+{
+    usb_host_mock_dev_list_init();
+    REQUIRE(ESP_OK == usb_host_mock_add_device(device_address, (const usb_device_desc_t *)cp210x_device_desc,
+            (const usb_config_desc_t *)cp210x_config_desc));
+    REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 1000,
+        .out_buffer_size = 100, // Segments of 64 bytes
+        .in_buffer_size = 64,
+        .event_cb = nullptr,
+        .data_cb = nullptr,
+        .user_arg = nullptr,
+    };
+    cdc_acm_dev_hdl_t dev = nullptr;
+    REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+    REQUIRE(dev != nullptr);
+
+    static uint8_t tx_buf[256];
+    s_segments.clear();
+    usb_host_transfer_submit_Stub(out_xfer_record);
+
+    GIVEN("Data length is a multiple of MPS") {
+        REQUIRE(ESP_OK == cdc_acm_host_data_tx_blocking(dev, tx_buf, 256, 100));
+
+        THEN("Only the last segment is terminated with zero-length packet") {
+            REQUIRE(s_segments.size() == 4);
+            for (size_t i = 0; i < s_segments.size(); i++) {
+                CHECK(s_segments[i].num_bytes == 64);
+                CHECK(s_segments[i].zlp == (i == s_segments.size() - 1));
+            }
+        }
+    }
+
+    GIVEN("Data length is not a multiple of MPS") {
+        REQUIRE(ESP_OK == cdc_acm_host_data_tx_blocking(dev, tx_buf, 200, 100));
+
+        THEN("The write ends with short packet, no segment is terminated with zero-length packet") {
+            REQUIRE(s_segments.size() == 4);
+            CHECK(s_segments[3].num_bytes == 8);
+            for (const out_segment_t &segment : s_segments) {
+                CHECK_FALSE(segment.zlp);
+            }
+        }
+    }
+
+    usb_host_transfer_submit_Stub(nullptr);
+    REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+    REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+}
@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "cdc_host_framing.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+static void frame_cb(const uint8_t *frame, size_t frame_len, void *user_arg)
+{
+    std::vector<bytes_t> *frames = (std::vector<bytes_t> *)user_arg;
+    frames->emplace_back(frame, frame + frame_len);
+}
+
+// HDLC-like framing of PPP with FCS-16, as sent by the device
+static bytes_t hdlc_encode(const bytes_t &frame)
+{
+    uint16_t fcs = 0xFFFF;
+    for (uint8_t byte : frame) {
+        fcs ^= byte;
+        for (int i = 0; i < 8; i++) {
+            fcs = (fcs & 1) ? (fcs >> 1) ^ 0x8408 : fcs >> 1;
+        }
+    }
+    fcs ^= 0xFFFF;
+    bytes_t payload = frame;
+    payload.push_back(fcs & 0xFF);
+    payload.push_back(fcs >> 8);
+
+    bytes_t encoded = {0x7E};
+    for (uint8_t byte : payload) {
+        if (byte == 0x7E || byte == 0x7D || byte < 0x20) {
+            encoded.push_back(0x7D);
+            encoded.push_back(byte ^ 0x20);
+        } else {
+            encoded.push_back(byte);
+        }
+    }
+    encoded.push_back(0x7E);
+    return encoded;
+}
+
+static bytes_t make_frame(size_t len, uint8_t seed)
+{
+    bytes_t frame(len);
+    for (size_t i = 0; i < len; i++) {
+        frame[i] = (uint8_t)(seed + i * 7);
+    }
+    return frame;
+}
+
+SCENARIO("HDLC framing")
+{
+    cdc_framer_t *framer = cdc_framer_create(CDC_ACM_FRAMING_HDLC, 1506);
+    REQUIRE(framer != nullptr);
+    std::vector<bytes_t> frames;
+
+    GIVEN("Frames with escaped bytes in one buffer") {
+        const bytes_t frame1 = make_frame(1500, 1);
+        const bytes_t frame2 = {0xFF, 0x03, 0x7E, 0x7D, 0x00, 0x21};
+        bytes_t stream = hdlc_encode(frame1);
+        const bytes_t encoded2 = hdlc_encode(frame2);
+        stream.insert(stream.end(), encoded2.begin() + 1, encoded2.end()); // Frames can share the flag
+
+        THEN("Both frames are delivered without FCS") {
+            REQUIRE(cdc_framer_feed(framer, stream.data(), stream.size(), frame_cb, &frames) == 0);
+            REQUIRE(frames.size() == 2);
+            REQUIRE(frames[0] == frame1);
+            REQUIRE(frames[1] == frame2);
+        }
+
+        THEN("Frames split at every position are delivered") {
+            for (size_t split = 1; split < stream.size(); split += 13) {
+                frames.clear();
+                REQUIRE(cdc_framer_feed(framer, stream.data(), split, frame_cb, &frames) == 0);
+                REQUIRE(cdc_framer_feed(framer, stream.data() + split, stream.size() - split, frame_cb, &frames) == 0);
+                REQUIRE(frames.size() == 2);
+                REQUIRE(frames[1] == frame2);
+            }
+        }
+    }
+
+    GIVEN("Frame split right after escape byte") {
+        const bytes_t frame = {0x7E, 0x7E, 0x7D};
+        const bytes_t stream = hdlc_encode(frame);
+        THEN("The escaped byte is unescaped in the next call") {
+            REQUIRE(cdc_framer_feed(framer, stream.data(), 2, frame_cb, &frames) == 0);
+            REQUIRE(cdc_framer_feed(framer, stream.data() + 2, stream.size() - 2, frame_cb, &frames) == 0);
+            REQUIRE(frames.size() == 1);
+            REQUIRE(frames[0] == frame);
+        }
+    }
+
+    GIVEN("Frame with corrupted byte") {
+        bytes_t stream = hdlc_encode(make_frame(100, 5));
+        stream[50] ^= 0x01;
+        THEN("Frame is dropped") {
+            REQUIRE(cdc_framer_feed(framer, stream.data(), stream.size(), frame_cb, &frames) == 1);
+            REQUIRE(frames.empty());
+        }
+    }
+
+    GIVEN("Aborted frame followed by valid frame") {
+        const bytes_t frame = make_frame(64, 9);
+        bytes_t stream = {0x7E, 0x11, 0x22, 0x7D};
+        const bytes_t encoded = hdlc_encode(frame);
+        stream.insert(stream.end(), encoded.begin(), encoded.end());
+        THEN("Only the valid frame is delivered") {
+            REQUIRE(cdc_framer_feed(framer, stream.data(), stream.size(), frame_cb, &frames) == 1);
+            REQUIRE(frames.size() == 1);
+            REQUIRE(frames[0] == frame);
+        }
+    }
+
+    GIVEN("Frame longer than the frame buffer") {
+        const bytes_t stream = hdlc_encode(make_frame(1600, 3));
+        THEN("Frame is dropped and the next one is delivered") {
+            REQUIRE(cdc_framer_feed(framer, stream.data(), stream.size(), frame_cb, &frames) == 1);
+            const bytes_t next = hdlc_encode(make_frame(10, 0));
+            REQUIRE(cdc_framer_feed(framer, next.data(), next.size(), frame_cb, &frames) == 0);
+            REQUIRE(frames.size() == 1);
+        }
+    }
+
+    cdc_framer_delete(framer);
+}
+
+SCENARIO("SLIP framing")
+{
+    cdc_framer_t *framer = cdc_framer_create(CDC_ACM_FRAMING_SLIP, 1006);
+    REQUIRE(framer != nullptr);
+    std::vector<bytes_t> frames;
+
+    GIVEN("Frames with escaped END and ESC") {
+        const bytes_t stream = {0xC0, 0x01, 0xDB, 0xDC, 0x02, 0xDB, 0xDD, 0xC0, 0x45, 0x00, 0xC0};
+        THEN("Frames are unescaped") {
+            REQUIRE(cdc_framer_feed(framer, stream.data(), stream.size(), frame_cb, &frames) == 0);
+            REQUIRE(frames.size() == 2);
+            REQUIRE(frames[0] == bytes_t({0x01, 0xC0, 0x02, 0xDB}));
+            REQUIRE(frames[1] == bytes_t({0x45, 0x00}));
+        }
+    }
+
+    cdc_framer_delete(framer);
+}
+
+SCENARIO("Invalid framing")
+{
+    REQUIRE(cdc_framer_create(CDC_ACM_FRAMING_NONE, 100) == nullptr);
+}
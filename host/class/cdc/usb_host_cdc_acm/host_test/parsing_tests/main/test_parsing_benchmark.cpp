@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "descriptors/cypress_rfa.hpp"
+#include "descriptors/stm32_device.hpp"
+#include "cdc_host_descriptor_parsing.h"
+#include "usb/cdc_acm_host.h"
+
+/*
+ * Descriptor parsing benchmark
+ *
+ * cdc_parse_interface_descriptor() runs every time a CDC interface is opened. It is called for every interface
+ * of every fixture, results are printed in ns per parsed interface, so they can be compared between CI runs.
+ *
+ * Environment variables:
+ * - CDC_BENCHMARK_ROUNDS:           Number of parsings of each fixture (default 10000)
+ * - CDC_BENCHMARK_MAX_NS_PER_PARSE: If set, the test fails when any fixture is slower than this
+ */
+
+/**
+ * @brief Device and Configuration descriptor fixture
+ */
+struct fixture_t {
+    const char *name;
+    const uint8_t *dev_desc;
+    const uint8_t *cfg_desc;
+};
+
+static int benchmark_rounds(void)
+{
+    const char *rounds = getenv("CDC_BENCHMARK_ROUNDS");
+    return rounds ? atoi(rounds) : 10000;
+}
+
+/**
+ * @brief Parse all interfaces of the fixture
+ *
+ * @return Number of interfaces parsed successfully
+ */
+static int parse_all_interfaces(const usb_device_desc_t *dev, const usb_config_desc_t *cfg)
+{
+    int parsed = 0;
+    for (uint8_t intf = 0; intf < cfg->bNumInterfaces; intf++) {
+        cdc_parsed_info_t info = {};
+        if (ESP_OK == cdc_parse_interface_descriptor(dev, cfg, intf, &info)) {
+            parsed++;
+        }
+        free(info.func);
+    }
+    return parsed;
+}
+
+TEST_CASE("Descriptor parsing speed", "[parsing][benchmark]")
+{
+    const fixture_t fixture = GENERATE(values<fixture_t>({
+        {"FTDI FS", ftdi_device_desc_fs_hs, ftdi_config_desc_fs},
+        {"FTDI HS", ftdi_device_desc_fs_hs, ftdi_config_desc_hs},
+        {"TTL232RG", ttl232_device_desc, ttl232_config_desc},
+        {"CP210x", cp210x_device_desc, cp210x_config_desc},
+        {"CH340", ch340_device_desc, ch340_config_desc},
+        {"Premium Cord FS", premium_cord_device_desc_fs, premium_cord_config_desc_fs},
+        {"Premium Cord HS", premium_cord_device_desc_hs, premium_cord_config_desc_hs},
+        {"i-tec FS", i_tec_device_desc_fs, i_tec_config_desc_fs},
+        {"i-tec HS", i_tec_device_desc_hs, i_tec_config_desc_hs},
+        {"Axagon FS 1", axagon_device_desc_fs_hs, axagon_config_desc_fs_1},
+        {"Axagon FS 2", axagon_device_desc_fs_hs, axagon_config_desc_fs_2},
+        {"Axagon HS 1", axagon_device_desc_fs_hs, axagon_config_desc_hs_1},
+        {"Axagon HS 2", axagon_device_desc_fs_hs, axagon_config_desc_hs_2},
+        {"SIM7070G FS", sim7070G_device_desc_fs_hs, sim7070G_config_desc_fs},
+        {"SIM7070G HS", sim7070G_device_desc_fs_hs, sim7070G_config_desc_hs},
+        {"BG96 FS", bg96_device_desc_fs_hs, bg96_config_desc_fs},
+        {"BG96 HS", bg96_device_desc_fs_hs, bg96_config_desc_hs},
+        {"SIM7000E FS", sim7000e_device_desc_fs_hs, sim7000e_config_desc_fs},
+        {"SIM7000E HS", sim7000e_device_desc_fs_hs, sim7000e_config_desc_hs},
+        {"SIM7600E FS", sim7600e_device_desc_fs_hs, sim7600e_config_desc_fs},
+        {"SIM7600E HS", sim7600e_device_desc_fs_hs, sim7600e_config_desc_hs},
+        {"SIM7080G FS", sim7080g_device_desc_fs_hs, sim7080g_config_desc_fs},
+        {"SIM7080G HS", sim7080g_device_desc_fs_hs, sim7080g_config_desc_hs},
+        {"SIMA7672E FS", sima7672e_device_desc_fs_hs, sima7672e_config_desc_fs},
+        {"SIMA7672E HS", sima7672e_device_desc_fs_hs, sima7672e_config_desc_hs},
+        {"Rapoo", rapoo_device_desc, rapoo_config_desc},
+        {"CSR FS", csr_device_desc_fs_hs, csr_config_desc_fs},
+        {"CSR HS", csr_device_desc_fs_hs, csr_config_desc_hs},
+        {"TinyUSB composite", tusb_composite_device_desc, tusb_composite_config_desc},
+        {"TinyUSB console", tusb_console_device_desc, tusb_console_config_desc},
+        {"TinyUSB HID", tusb_hid_device_desc, tusb_hid_config_desc},
+        {"TinyUSB MIDI", tusb_midi_device_desc, tusb_midi_config_desc},
+        {"TinyUSB MSC", tusb_msc_device_desc, tusb_msc_config_desc},
+        {"TinyUSB NCM", tusb_ncm_device_desc, tusb_ncm_config_desc},
+        {"TinyUSB serial FS", tusb_serial_device_device_desc_fs_hs, tusb_serial_device_config_desc_fs},
+        {"TinyUSB serial HS", tusb_serial_device_device_desc_fs_hs, tusb_serial_device_config_desc_hs},
+        {"TinyUSB dual serial FS", tusb_serial_device_dual_device_desc_fs_hs, tusb_serial_device_dual_config_desc_fs},
+        {"TinyUSB dual serial HS", tusb_serial_device_dual_device_desc_fs_hs, tusb_serial_device_dual_config_desc_hs},
+        {"Cypress RFA", cypress_rfa::dev_desc, cypress_rfa::cfg_desc},
+        {"STM32F103", stm32_device::dev_desc, stm32_device::cfg_desc},
+    }));
+    const usb_device_desc_t *dev = (const usb_device_desc_t *)fixture.dev_desc;
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)fixture.cfg_desc;
+    const int rounds = benchmark_rounds();
+    const int parsed = parse_all_interfaces(dev, cfg);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        REQUIRE(parse_all_interfaces(dev, cfg) == parsed);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds /
+                      cfg->bNumInterfaces;
+
+    printf("%-32s %2u interfaces %4u B %8.1f ns/parse\n", fixture.name, cfg->bNumInterfaces, cfg->wTotalLength, ns);
+    const char *max_ns = getenv("CDC_BENCHMARK_MAX_NS_PER_PARSE");
+    if (max_ns) {
+        CHECK(ns <= atof(max_ns));
+    }
+}
@@ -15,6 +15,13 @@
 #define CDC_HOST_ANY_VID (0)
 #define CDC_HOST_ANY_PID (0)
 
+// Frame buffer size used if cdc_acm_host_device_config_t framing.max_frame_size is 0: PPP frame with MRU of 1500 bytes and FCS-16
+#define CDC_ACM_FRAMING_FRAME_SIZE_DEFAULT (1506)
+
+// Identification of devices opened by cdc_acm_host_auto_open_start()
+#define CDC_HOST_PORT_PATH_LEN_MAX (7)  // USB allows at most 5 hubs between the root port and a device
+#define CDC_HOST_SERIAL_LEN_MAX    (32) // Longer serial numbers are truncated
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,7 +36,8 @@ typedef enum {
     CDC_ACM_HOST_ERROR,
     CDC_ACM_HOST_SERIAL_STATE,
     CDC_ACM_HOST_NETWORK_CONNECTION,
-    CDC_ACM_HOST_DEVICE_DISCONNECTED
+    CDC_ACM_HOST_DEVICE_DISCONNECTED,
+    CDC_ACM_HOST_ENCAPSULATED_RESPONSE
 } cdc_acm_host_dev_event_t;
 
 /**
@@ -43,6 +51,10 @@ typedef struct {
         cdc_acm_uart_state_t serial_state; //!< Serial (UART) state
         bool network_connected;            //!< Network connection event
         cdc_acm_dev_hdl_t cdc_hdl;         //!< Disconnection event
+        struct {
+            const uint8_t *data;           //!< Response data, valid only during the callback
+            size_t data_len;               //!< Response length
+        } encapsulated_response;           //!< Response to encapsulated command
     } data;
 } cdc_acm_host_dev_event_data_t;
 
@@ -67,6 +79,18 @@ typedef void (*cdc_acm_new_dev_callback_t)(usb_device_handle_t usb_dev);
  */
 typedef bool (*cdc_acm_data_callback_t)(const uint8_t *data, size_t data_len, void *user_arg);
 
+/**
+ * @brief Data transmit done callback type
+ *
+ * Called from the USB Host context, so it must not block.
+ *
+ * @param[in] status   ESP_OK: All data were sent
+ *                     ESP_ERR_INVALID_RESPONSE: Transfer error
+ *                     ESP_ERR_INVALID_STATE: Transfer was canceled, e.g. the device was disconnected or closed
+ * @param[in] user_arg User's argument passed to cdc_acm_host_data_tx_async()
+ */
+typedef void (*cdc_acm_tx_done_callback_t)(esp_err_t status, void *user_arg);
+
 /**
  * @brief Device event callback type
  *
@@ -75,6 +99,43 @@ typedef bool (*cdc_acm_data_callback_t)(const uint8_t *data, size_t data_len, vo
  */
 typedef void (*cdc_acm_host_dev_callback_t)(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
 
+/**
+ * @brief Interface setup callback type
+ *
+ * Called from cdc_acm_host_open() before the data interface is claimed, while it is still in alternate setting 0.
+ * Control requests can be sent with the passed handle, e.g. setup of CDC-NCM that is allowed only in alternate setting 0.
+ *
+ * @param[in] cdc_hdl  CDC handle of the device being opened
+ * @param[in] user_arg User's argument passed to open function
+ * @return ESP_OK to continue opening, error is returned by cdc_acm_host_open()
+ */
+typedef esp_err_t (*cdc_acm_host_setup_callback_t)(cdc_acm_dev_hdl_t cdc_hdl, void *user_arg);
+
+/**
+ * @brief Framing of received data
+ *
+ * With framing, received data are split into frames by the driver and unescaped into a frame buffer of the device.
+ * Each complete frame is delivered to cdc_acm_frame_callback_t. Frames with invalid FCS, aborted frames and frames
+ * longer than the frame buffer are dropped and counted in usb_class_stats.
+ */
+typedef enum {
+    CDC_ACM_FRAMING_NONE = 0,    /**< No framing, received data are delivered to data_cb */
+    CDC_ACM_FRAMING_HDLC,        /**< HDLC-like framing of PPP (RFC 1662): 0x7E flags and 0x7D escapes. FCS-16 is checked and removed */
+    CDC_ACM_FRAMING_HDLC_NO_FCS, /**< HDLC-like framing without FCS check, frames are delivered including their FCS if they have any */
+    CDC_ACM_FRAMING_SLIP,        /**< SLIP (RFC 1055): 0xC0 ends and 0xDB escapes */
+} cdc_acm_framing_t;
+
+/**
+ * @brief Received frame callback type
+ *
+ * Called from the same context as cdc_acm_data_callback_t.
+ *
+ * @param[in] frame     Unescaped frame without flags and FCS, valid only during the callback
+ * @param[in] frame_len Length of the frame in bytes
+ * @param[in] user_arg  User's argument passed to open function
+ */
+typedef void (*cdc_acm_frame_callback_t)(const uint8_t *frame, size_t frame_len, void *user_arg);
+
 /**
  * @brief Configuration structure of USB Host CDC-ACM driver
  *
@@ -84,6 +145,8 @@ typedef struct {
     unsigned driver_task_priority;         /**< Priority of the driver's task */
     int  xCoreID;                          /**< Core affinity of the driver's task */
     cdc_acm_new_dev_callback_t new_dev_cb; /**< New USB device connected callback. Can be NULL. */
+    bool shared_client;                    /**< Use the client installed with usb_host_shared_client_install() instead of own client.
+                                                No driver's task is created, the task fields above are ignored */
 } cdc_acm_host_driver_config_t;
 
 /**
@@ -97,8 +160,91 @@ typedef struct {
     cdc_acm_host_dev_callback_t event_cb; /**< Device's event callback function. Can be NULL */
     cdc_acm_data_callback_t data_cb;      /**< Device's data RX callback function. Can be NULL for write-only devices */
     void *user_arg;                       /**< User's argument that will be passed to the callbacks */
+    size_t in_transfer_count;             /**< Number of bulk IN transfers of in_buffer_size kept in flight, so the IN endpoint is polled
+                                               while data_cb runs. Data are delivered in order of reception. Set to 0 or 1 for single transfer */
+    size_t out_transfer_count;            /**< Number of bulk OUT transfers of out_buffer_size used by cdc_acm_host_data_tx_async()
+                                               and by cdc_acm_host_data_tx_blocking() of data longer than out_buffer_size.
+                                               Set to 0 if only cdc_acm_host_data_tx_blocking() is used */
+    size_t rx_buffer_size;                /**< Size of RX stream buffer read by cdc_acm_host_data_rx_blocking(). data_cb must be NULL if it is used.
+                                               Set to 0 to receive data by data_cb */
+    struct {
+        size_t stack_size;                /**< Stack size of the device's RX task, which calls data_cb. Set to 0 to call data_cb from the driver's task */
+        unsigned priority;                /**< Priority of the device's RX task */
+        int xCoreID;                      /**< Core affinity of the device's RX task */
+    } rx_task;                            /**< RX task of the device, so slow data_cb of other devices does not delay this device */
+    uint32_t serial_state_interval_ms;    /**< Minimum interval between CDC_ACM_HOST_SERIAL_STATE events in [ms]. Changes within the interval
+                                               are coalesced and only the latest state is reported at its end. Set to 0 to report every change */
+    size_t encapsulated_response_size;    /**< Maximum size of response to encapsulated command. Responses are read on RESPONSE_AVAILABLE notification
+                                               and delivered as CDC_ACM_HOST_ENCAPSULATED_RESPONSE event. Set to 0 to ignore the notification */
+    uint32_t ctrl_timeout_ms;             /**< Timeout of control requests of this device, including the time spent waiting for other requests.
+                                               Set to 0 for the default of 5 seconds */
+    cdc_acm_host_setup_callback_t setup_cb; /**< Called before the data interface is claimed. Can be NULL */
+    struct {
+        cdc_acm_framing_t type;           /**< Framing of received data. data_cb and rx_buffer_size must not be used with framing */
+        size_t max_frame_size;            /**< Size of the frame buffer, including FCS. Set to 0 for CDC_ACM_FRAMING_FRAME_SIZE_DEFAULT */
+        cdc_acm_frame_callback_t frame_cb;/**< Received frame callback */
+    } framing;                            /**< Framing stage on the RX path, so frames are found and unescaped without copying the stream first */
 } cdc_acm_host_device_config_t;
 
+/**
+ * @brief Identification of a device found by auto-open service
+ *
+ * Identical devices have the same VID/PID, but they are told apart by their place in the hub tree or by their serial number.
+ */
+typedef struct {
+    uint8_t dev_addr;                               /**< USB address, it changes with every connection */
+    uint8_t interface_idx;                          /**< Index of the interface being opened */
+    uint8_t port_path_len;                          /**< Number of hubs between the root port and the device, 0 if it is connected to the root port */
+    uint8_t port_path[CDC_HOST_PORT_PATH_LEN_MAX];  /**< Hub port numbers from the root port towards the device. Available from ESP-IDF v5.4 */
+    char serial[CDC_HOST_SERIAL_LEN_MAX + 1];       /**< Serial number string, non-ASCII characters replaced by '?'. Empty if the device has none */
+} cdc_acm_auto_open_dev_info_t;
+
+/**
+ * @brief Auto-open match callback type
+ *
+ * Called from an auto-open task before an interface of a device with matching VID/PID is opened.
+ * The driver's open/close mutex is held during the callback, so CDC devices must not be opened or closed from it.
+ *
+ * @param[in]    info       Identification of the device
+ * @param[inout] dev_config Copy of cdc_acm_host_auto_open_config_t::dev_config, it can be changed for this interface, e.g. its user_arg
+ * @param[in]    user_arg   User's argument of the auto-open service
+ * @return true to open the interface, false to skip it
+ */
+typedef bool (*cdc_acm_auto_open_match_callback_t)(const cdc_acm_auto_open_dev_info_t *info, cdc_acm_host_device_config_t *dev_config, void *user_arg);
+
+/**
+ * @brief Auto-open result callback type
+ *
+ * Called from an auto-open task after an interface was opened or failed to open.
+ * The application owns the handle and closes it with cdc_acm_host_close(), usually on CDC_ACM_HOST_DEVICE_DISCONNECTED event.
+ *
+ * @param[in] cdc_hdl  CDC handle of the opened interface, NULL on failure
+ * @param[in] info     Identification of the device
+ * @param[in] status   Result of the open, as returned by cdc_acm_host_open()
+ * @param[in] user_arg User's argument of the auto-open service
+ */
+typedef void (*cdc_acm_auto_open_callback_t)(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_auto_open_dev_info_t *info, esp_err_t status, void *user_arg);
+
+/**
+ * @brief Configuration structure of auto-open service
+ *
+ */
+typedef struct {
+    uint16_t vid;                                   /**< Vendor ID of opened devices, CDC_HOST_ANY_VID for any */
+    uint16_t pid;                                   /**< Product ID of opened devices, CDC_HOST_ANY_PID for any */
+    uint32_t interface_mask;                        /**< Bit n set: interface with index n is opened. Set to 0 for interface 0 only */
+    cdc_acm_host_device_config_t dev_config;        /**< Configuration of opened interfaces, connection_timeout_ms is ignored */
+    cdc_acm_auto_open_match_callback_t match_cb;    /**< Selects the interfaces to open and adjusts their configuration. Can be NULL to open all */
+    cdc_acm_auto_open_callback_t opened_cb;         /**< Result callback */
+    void *user_arg;                                 /**< User's argument passed to match_cb and opened_cb */
+    struct {
+        size_t count;                               /**< Number of tasks, up to this many devices are opened in parallel. Set to 0 for one task */
+        size_t stack_size;                          /**< Stack size of each task, it runs match_cb, opened_cb and setup_cb of dev_config */
+        unsigned priority;                          /**< Priority of the tasks */
+        int xCoreID;                                /**< Core affinity of the tasks */
+    } task;                                         /**< Tasks opening the devices, created by cdc_acm_host_auto_open_start() */
+} cdc_acm_host_auto_open_config_t;
+
 /**
  * @brief Install CDC-ACM driver
  *
@@ -164,6 +310,38 @@ static inline esp_err_t cdc_acm_host_open_vendor_specific(uint16_t vid, uint16_t
     return cdc_acm_host_open(vid, pid, interface_num, dev_config, cdc_hdl_ret);
 }
 
+/**
+ * @brief Start auto-open service
+ *
+ * Every device with matching VID/PID is opened as soon as it is enumerated, without polling and without blocking the caller.
+ * Devices connected before the call are opened as well. New devices are handed over to a pool of tasks,
+ * so several identical devices, e.g. modems on a hub, are opened in parallel and each one is opened by its USB address.
+ * The opened devices are identified in the callbacks by their hub port path and serial number.
+ *
+ * Transfers of the opened devices are taken from usb_host_urb_pool, if it is installed, so hot-plug does not allocate them from heap.
+ * Devices handled by the service should not be opened by cdc_acm_host_open() at the same time.
+ *
+ * @param[in] config Configuration of the service
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed or the service is already running
+ *   - ESP_ERR_INVALID_ARG: Invalid configuration
+ *   - ESP_ERR_NO_MEM: Not enough memory for the tasks
+ */
+esp_err_t cdc_acm_host_auto_open_start(const cdc_acm_host_auto_open_config_t *config);
+
+/**
+ * @brief Stop auto-open service
+ *
+ * Waits until devices being opened are finished. Devices opened by the service stay open.
+ * The service must be stopped before cdc_acm_host_uninstall().
+ *
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The service is not running
+ */
+esp_err_t cdc_acm_host_auto_open_stop(void);
+
 /**
  * @brief Close CDC device and release its resources
  *
@@ -178,14 +356,94 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl);
 /**
  * @brief Transmit data - blocking mode
  *
+ * Data longer than out_buffer_size are split into transfers of the largest multiple of MPS that fits into out_buffer_size,
+ * and data ending at MPS boundary are then terminated with a zero-length packet. With out_transfer_count > 0, the transfers
+ * are streamed through the OUT transfers of cdc_acm_host_data_tx_async(), so the bus is kept busy during the write.
+ *
  * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
  * @param[in] data       Data to be sent
  * @param[in] data_len   Data length
- * @param[in] timeout_ms Timeout in [ms]
+ * @param[in] timeout_ms Timeout of each transfer in [ms]
  * @return esp_err_t
  */
 esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms);
 
+/**
+ * @brief Receive data - blocking mode
+ *
+ * Received data are buffered in a stream buffer of rx_buffer_size by the USB Host task, so slow readers do not stall the IN endpoint.
+ * Only one task may read from the device.
+ *
+ * @param      cdc_hdl    CDC handle obtained from cdc_acm_host_open()
+ * @param[out] data       Buffer for received data
+ * @param[in]  data_len   Size of the buffer
+ * @param[out] rx_len     Number of received bytes, at least 1 on success
+ * @param[in]  timeout_ms Time to wait for the first byte in [ms], 0 to return immediately
+ * @return
+ *   - ESP_OK: Data received
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened with rx_buffer_size 0
+ *   - ESP_ERR_TIMEOUT: No data received within timeout
+ */
+esp_err_t cdc_acm_host_data_rx_blocking(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms);
+
+/**
+ * @brief Transmit data - non-blocking mode
+ *
+ * Data are copied into one of out_transfer_count OUT transfers, which is submitted immediately.
+ * Several transfers can be in flight, so consecutive writes are not delayed by round trip of the previous write.
+ * Data of consecutive calls are sent in order of the calls.
+ *
+ * @param     cdc_hdl    CDC handle obtained from cdc_acm_host_open()
+ * @param[in] data       Data to be sent
+ * @param[in] data_len   Data length, up to out_buffer_size
+ * @param[in] done_cb    Callback called when the transfer is finished. Can be NULL
+ * @param[in] done_arg   User's argument passed to done_cb
+ * @param[in] timeout_ms Time to wait for a free OUT transfer in [ms], 0 to return immediately
+ * @return
+ *   - ESP_OK: Data copied and transfer submitted, done_cb will be called
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened with out_transfer_count 0
+ *   - ESP_ERR_INVALID_SIZE: Data do not fit into out_buffer_size
+ *   - ESP_ERR_TIMEOUT: All OUT transfers are in flight
+ */
+esp_err_t cdc_acm_host_data_tx_async(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len,
+                                     cdc_acm_tx_done_callback_t done_cb, void *done_arg, uint32_t timeout_ms);
+
+/**
+ * @brief Borrow buffer of a free OUT transfer
+ *
+ * Data can be written directly into the returned DMA capable buffer, so they are not copied as in cdc_acm_host_data_tx_async().
+ * The buffer belongs to the caller until it is passed to cdc_acm_host_tx_buffer_commit().
+ *
+ * @param      cdc_hdl    CDC handle obtained from cdc_acm_host_open()
+ * @param[out] buf        Buffer to be filled with data
+ * @param[out] buf_size   Size of the buffer, which is at least out_buffer_size
+ * @param[in]  timeout_ms Time to wait for a free OUT transfer in [ms], 0 to return immediately
+ * @return
+ *   - ESP_OK: Buffer borrowed
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened with out_transfer_count 0
+ *   - ESP_ERR_TIMEOUT: All OUT transfers are in flight or borrowed
+ */
+esp_err_t cdc_acm_host_tx_buffer_get(cdc_acm_dev_hdl_t cdc_hdl, uint8_t **buf, size_t *buf_size, uint32_t timeout_ms);
+
+/**
+ * @brief Submit borrowed buffer
+ *
+ * @param     cdc_hdl  CDC handle obtained from cdc_acm_host_open()
+ * @param[in] buf      Buffer obtained from cdc_acm_host_tx_buffer_get()
+ * @param[in] data_len Length of data written into the buffer. 0 returns the buffer without sending anything
+ * @param[in] done_cb  Callback called when the transfer is finished. Can be NULL
+ * @param[in] done_arg User's argument passed to done_cb
+ * @return
+ *   - ESP_OK: Transfer submitted, done_cb will be called
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments or the buffer is not borrowed from this device
+ *   - ESP_ERR_INVALID_SIZE: data_len exceeds size of the buffer
+ */
+esp_err_t cdc_acm_host_tx_buffer_commit(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *buf, size_t data_len,
+                                        cdc_acm_tx_done_callback_t done_cb, void *done_arg);
+
 /**
  * @brief SetLineCoding function
  *
@@ -220,6 +478,21 @@ esp_err_t cdc_acm_host_line_coding_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_line_c
  */
 esp_err_t cdc_acm_host_set_control_line_state(cdc_acm_dev_hdl_t cdc_hdl, bool dtr, bool rts);
 
+/**
+ * @brief SendEncapsulatedCommand function
+ *
+ * Response of the device is read asynchronously, once the device announces it by RESPONSE_AVAILABLE notification.
+ * It is delivered as CDC_ACM_HOST_ENCAPSULATED_RESPONSE event, if encapsulated_response_size was set.
+ *
+ * @see Chapter 6.2.1, USB CDC specification rev. 1.2
+ *
+ * @param     cdc_hdl  CDC handle obtained from cdc_acm_host_open()
+ * @param[in] data     Command in the protocol of the control model, e.g. AT command or MBIM message
+ * @param[in] data_len Length of the command
+ * @return esp_err_t
+ */
+esp_err_t cdc_acm_host_send_encapsulated_command(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, uint16_t data_len);
+
 /**
  * @brief SendBreak function
  *
@@ -237,6 +510,7 @@ esp_err_t cdc_acm_host_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_m
  * @brief Print device's descriptors
  *
  * Device and full Configuration descriptors are printed in human readable format to stdout.
+ * Nothing is printed if CONFIG_CDC_ACM_HOST_MINIMAL is enabled.
  *
  * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
  */
@@ -274,6 +548,10 @@ esp_err_t cdc_acm_host_cdc_desc_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_desc_subtype_
  * This function can be used by device drivers that use custom/vendor specific commands.
  * These commands can either extend or replace commands defined in USB CDC-PSTN specification rev. 1.2.
  *
+ * @note Control requests of all interfaces of one USB device are queued on its endpoint 0.
+ *       A request that does not finish within ctrl_timeout_ms of the device is cancelled by reset of endpoint 0.
+ *       Requests of other interfaces cancelled by the reset are resubmitted within their own timeouts.
+ *
  * @param        cdc_hdl       CDC handle obtained from cdc_acm_host_open()
  * @param[in]    bmRequestType Field of USB control request
  * @param[in]    bRequest      Field of USB control request
@@ -287,10 +565,14 @@ esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bm
 
 #ifdef __cplusplus
 }
+#if __has_include(<span>)
+#include <span> // std::span overloads are available from C++20
+#endif
+
 class CdcAcmDevice {
 public:
     // Operators
-    CdcAcmDevice() : cdc_hdl(NULL) {};
+    CdcAcmDevice() : partial_line_coding(false), cdc_hdl(NULL), line_config_known(false) {};
     virtual ~CdcAcmDevice()
     {
         // Close CDC-ACM device, if it wasn't explicitly closed
@@ -299,11 +581,79 @@ public:
         }
     }
 
-    inline esp_err_t tx_blocking(uint8_t *data, size_t len, uint32_t timeout_ms = 100)
+    inline esp_err_t tx_blocking(const uint8_t *data, size_t len, uint32_t timeout_ms = 100)
     {
         return cdc_acm_host_data_tx_blocking(this->cdc_hdl, data, len, timeout_ms);
     }
 
+    inline esp_err_t rx_blocking(uint8_t *data, size_t len, size_t *rx_len, uint32_t timeout_ms = 100)
+    {
+        return cdc_acm_host_data_rx_blocking(this->cdc_hdl, data, len, rx_len, timeout_ms);
+    }
+
+    inline esp_err_t tx_async(const uint8_t *data, size_t len, cdc_acm_tx_done_callback_t done_cb = nullptr, void *done_arg = nullptr, uint32_t timeout_ms = 0)
+    {
+        return cdc_acm_host_data_tx_async(this->cdc_hdl, data, len, done_cb, done_arg, timeout_ms);
+    }
+
+    inline esp_err_t tx_buffer_get(uint8_t **buf, size_t *buf_size, uint32_t timeout_ms = 0)
+    {
+        return cdc_acm_host_tx_buffer_get(this->cdc_hdl, buf, buf_size, timeout_ms);
+    }
+
+    inline esp_err_t tx_buffer_commit(uint8_t *buf, size_t data_len, cdc_acm_tx_done_callback_t done_cb = nullptr, void *done_arg = nullptr)
+    {
+        return cdc_acm_host_tx_buffer_commit(this->cdc_hdl, buf, data_len, done_cb, done_arg);
+    }
+
+#ifdef __cpp_lib_span
+    inline esp_err_t tx_blocking(std::span<const uint8_t> data, uint32_t timeout_ms = 100)
+    {
+        return cdc_acm_host_data_tx_blocking(this->cdc_hdl, data.data(), data.size(), timeout_ms);
+    }
+
+    /**
+     * @brief Read buffered RX data, see cdc_acm_host_data_rx_blocking()
+     *
+     * @param[in]  buf        Buffer for received data
+     * @param[out] rx         Part of buf filled with received data
+     * @param[in]  timeout_ms Timeout in [ms]
+     * @return esp_err_t
+     */
+    inline esp_err_t rx_blocking(std::span<uint8_t> buf, std::span<uint8_t> &rx, uint32_t timeout_ms = 100)
+    {
+        size_t rx_len = 0;
+        const esp_err_t err = cdc_acm_host_data_rx_blocking(this->cdc_hdl, buf.data(), buf.size(), &rx_len, timeout_ms);
+        rx = buf.first(rx_len);
+        return err;
+    }
+
+    inline esp_err_t tx_async(std::span<const uint8_t> data, cdc_acm_tx_done_callback_t done_cb = nullptr, void *done_arg = nullptr, uint32_t timeout_ms = 0)
+    {
+        return cdc_acm_host_data_tx_async(this->cdc_hdl, data.data(), data.size(), done_cb, done_arg, timeout_ms);
+    }
+
+    /**
+     * @brief Data callback that calls a member function of the handler passed as user_arg
+     *
+     * The member function is a template argument, so it is called directly and can be inlined into the callback.
+     * There is no trampoline object and no heap allocation.
+     *
+     * @code{cpp}
+     * struct Parser {
+     *     bool on_rx(std::span<const uint8_t> data);
+     * } parser;
+     * dev_config.data_cb = CdcAcmDevice::data_callback<Parser, &Parser::on_rx>;
+     * dev_config.user_arg = &parser;
+     * @endcode
+     */
+    template<class Handler, bool (Handler::*Method)(std::span<const uint8_t>)>
+    static bool data_callback(const uint8_t *data, size_t data_len, void *user_arg)
+    {
+        return (static_cast<Handler *>(user_arg)->*Method)(std::span<const uint8_t>(data, data_len));
+    }
+#endif
+
     inline esp_err_t open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config)
     {
         return cdc_acm_host_open(vid, pid, interface_idx, dev_config, &this->cdc_hdl);
@@ -319,6 +669,7 @@ public:
         const esp_err_t err = cdc_acm_host_close(this->cdc_hdl);
         if (err == ESP_OK) {
             this->cdc_hdl = NULL;
+            this->line_config_known = false; // A reopened device starts with its default line configuration
         }
         return err;
     }
@@ -343,15 +694,73 @@ public:
         return cdc_acm_host_send_break(this->cdc_hdl, duration_ms);
     }
 
+    /**
+     * @brief Set Line Coding and Control Line State at once
+     *
+     * Only settings that differ from the configuration applied by previous call of this method are sent to the device.
+     * Drivers that can set baud rate and framing separately (partial_line_coding) send only the changed one.
+     *
+     * @note Settings applied by line_coding_set() or set_control_line_state() directly are not tracked
+     * @param[in] line_coding Line Coding structure
+     * @param[in] dtr         Data Terminal Ready
+     * @param[in] rts         Request To Send
+     * @return esp_err_t
+     */
+    virtual esp_err_t line_config_set(const cdc_acm_line_coding_t *line_coding, bool dtr, bool rts)
+    {
+        const bool known = this->line_config_known;
+        const bool rate_changed = !known || (line_coding->dwDTERate != this->line_config.dwDTERate);
+        const bool framing_changed = !known || (line_coding->bCharFormat != this->line_config.bCharFormat) ||
+                                     (line_coding->bParityType != this->line_config.bParityType) || (line_coding->bDataBits != this->line_config.bDataBits);
+        const bool lines_changed = !known || (dtr != this->line_config_dtr) || (rts != this->line_config_rts);
+
+        this->line_config_known = false; // Unknown until all requests succeed
+        if (rate_changed || framing_changed) {
+            cdc_acm_line_coding_t changed = *line_coding;
+            if (this->partial_line_coding) {
+                // Zero value means 'do not change' for drivers with partial Line Coding support
+                changed.dwDTERate = rate_changed ? changed.dwDTERate : 0;
+                changed.bDataBits = framing_changed ? changed.bDataBits : 0;
+            }
+            const esp_err_t err = this->line_coding_set(&changed);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        this->line_config = *line_coding;
+        if (lines_changed) {
+            const esp_err_t err = this->set_control_line_state(dtr, rts);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        this->line_config_dtr = dtr;
+        this->line_config_rts = rts;
+        this->line_config_known = true;
+        return ESP_OK;
+    }
+
+    inline esp_err_t send_encapsulated_command(const uint8_t *data, uint16_t data_len)
+    {
+        return cdc_acm_host_send_encapsulated_command(this->cdc_hdl, data, data_len);
+    }
+
     inline esp_err_t send_custom_request(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
     {
         return cdc_acm_host_send_custom_request(this->cdc_hdl, bmRequestType, bRequest, wValue, wIndex, wLength, data);
     }
 
+protected:
+    bool partial_line_coding; // line_coding_set() skips zero dwDTERate and zero bDataBits, set by drivers that support it
+
 private:
     CdcAcmDevice &operator= (const CdcAcmDevice &Copy);
     bool operator== (const CdcAcmDevice &param) const;
     bool operator!= (const CdcAcmDevice &param) const;
     cdc_acm_dev_hdl_t cdc_hdl;
+    bool line_config_known;             // Following members hold the configuration applied by line_config_set()
+    cdc_acm_line_coding_t line_config;
+    bool line_config_dtr;
+    bool line_config_rts;
 };
 #endif
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include "esp_err.h"
 #include "usb/usb_types_ch9.h"
+#include "usb/usb_host_desc_index.h"
 
 typedef const usb_standard_desc_t *cdc_func_array_t[]; // Array of pointers to const usb_standard_desc_t
 
@@ -43,12 +44,29 @@ extern "C" {
  */
 esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx, cdc_parsed_info_t *info_ret);
 
+/**
+ * @brief Parse CDC interface from descriptor index
+ *
+ * Same as cdc_parse_interface_descriptor(), for callers that keep descriptor index of the Configuration descriptor
+ *
+ * @param[in] device_desc Pointer to Device descriptor
+ * @param[in] index       Descriptor index of Configuration descriptor
+ * @param[in] intf_idx    Index of the required interface
+ * @param[out] info_ret   Array of parsed information, see cdc_parsed_info_t
+ * @return
+ *     - ESP_OK:            Success
+ *     - ESP_ERR_NOT_FOUND: Interfaces and endpoints NOT found
+ */
+esp_err_t cdc_parse_interface_index(const usb_device_desc_t *device_desc, const usb_host_desc_index_t *index, uint8_t intf_idx, cdc_parsed_info_t *info_ret);
+
 /**
  * @brief Print CDC specific descriptor in human readable form
  *
  * This is a callback function that is called from USB Host library,
  * when it wants to print full configuration descriptor to stdout.
  *
+ * @note Not available if CONFIG_CDC_ACM_HOST_MINIMAL is enabled
+ *
  * @param[in] _desc CDC specific descriptor
  */
 void cdc_print_desc(const usb_standard_desc_t *_desc);
@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "usb/cdc_acm_host.h" // For framing types
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cdc_framer_s cdc_framer_t;
+
+/**
+ * @brief Create framer
+ *
+ * @param[in] type           Framing, other than CDC_ACM_FRAMING_NONE
+ * @param[in] max_frame_size Size of the frame buffer, including FCS
+ * @return Framer, NULL if out of memory or type is invalid
+ */
+cdc_framer_t *cdc_framer_create(cdc_acm_framing_t type, size_t max_frame_size);
+
+/**
+ * @brief Delete framer
+ *
+ * @param[in] framer Framer, can be NULL
+ */
+void cdc_framer_delete(cdc_framer_t *framer);
+
+/**
+ * @brief Feed received data to the framer
+ *
+ * Runs of data between flag and escape bytes are found a word at a time and copied to the frame buffer at once,
+ * FCS is updated with each run. Frames may span several calls.
+ *
+ * @param[in] framer   Framer
+ * @param[in] data     Received data
+ * @param[in] data_len Length of received data
+ * @param[in] frame_cb Called with each complete frame. Can be NULL, frames are dropped then
+ * @param[in] arg      Argument of frame_cb
+ * @return Number of dropped frames: frames with invalid FCS, aborted frames and frames longer than the frame buffer
+ */
+size_t cdc_framer_feed(cdc_framer_t *framer, const uint8_t *data, size_t data_len, cdc_acm_frame_callback_t frame_cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,37 +11,102 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
 
 #include "usb/usb_host.h"      // For USB device handle and transfers
 #include "usb/cdc_acm_host.h"  // For callback types
 #include "usb/usb_types_cdc.h" // For protocol and serial state
+#include "usb/usb_class_stats.h" // For statistics entry
+#include "cdc_host_descriptor_parsing.h" // For parsed interface layout
+#include "cdc_host_framing.h"    // For framer of received data
 
 typedef struct cdc_dev_s cdc_dev_t;
+
+// Parsed layout of one interface of USB device
+typedef struct cdc_intf_info_s {
+    uint8_t intf_idx;                     // Interface number passed to cdc_parse_interface_descriptor()
+    cdc_parsed_info_t info;               // Parsed interface, its functional descriptors array is owned by this entry
+    SLIST_ENTRY(cdc_intf_info_s) list_entry;
+} cdc_intf_info_t;
+
+// USB device shared by all CDC devices opened on its interfaces
+typedef struct cdc_usb_dev_s {
+    usb_device_handle_t dev_hdl;          // USB device handle, it is closed when the last CDC device is removed
+    uint8_t dev_addr;                     // USB address of the device
+    const usb_device_desc_t *device_desc; // Device descriptor
+    const usb_config_desc_t *config_desc; // Active configuration descriptor, NULL until the first interface is parsed
+    usb_host_desc_index_t *desc_index;    // Index of config_desc, built with it
+    int cdc_dev_count;                    // Number of CDC devices using this USB device, protected by cdc_acm_lock
+    SemaphoreHandle_t ctrl_reset_mux;     // Serializes resets of endpoint 0 with submission of control transfers of all CDC devices
+    uint32_t ctrl_resets;                 // Number of resets of endpoint 0, protected by ctrl_reset_mux
+    SLIST_HEAD(list_intf, cdc_intf_info_s) intf_list; // Interfaces parsed so far
+    SLIST_ENTRY(cdc_usb_dev_s) list_entry;
+} cdc_usb_dev_t;
+
+// OUT transfer used by cdc_acm_host_data_tx_async()
+typedef struct {
+    cdc_dev_t *cdc_dev;                   // Device the transfer belongs to
+    usb_transfer_t *xfer;                 // OUT data transfer, its context points to this slot
+    cdc_acm_tx_done_callback_t done_cb;   // User's callback of the transfer in flight
+    void *done_arg;                       // Argument of done_cb
+    bool borrowed;                        // Buffer was obtained by cdc_acm_host_tx_buffer_get() and not committed yet
+} cdc_tx_slot_t;
+
 struct cdc_dev_s {
     usb_device_handle_t dev_hdl;          // USB device handle
+    cdc_usb_dev_t *usb_dev;               // USB device this CDC device is opened on
     void *cb_arg;                         // Common argument for user's callbacks (data IN and Notification)
     struct {
         usb_transfer_t *out_xfer;         // OUT data transfer
-        usb_transfer_t *in_xfer;          // IN data transfer
+        usb_transfer_t **in_xfers;        // IN data transfers, in_xfer_count of them are kept in flight
+        size_t in_xfer_count;             // Number of IN data transfers
+        usb_transfer_t *in_pending;       // IN transfer holding data not processed by in_cb, only used with several IN transfers
+        size_t in_pending_len;            // Length of data in in_pending
+        cdc_tx_slot_t *tx_slots;          // OUT transfers for asynchronous TX
+        size_t tx_slot_count;             // Number of asynchronous OUT transfers
+        QueueHandle_t tx_free;            // Queue of pointers to asynchronous OUT transfers that are not in flight
+        SemaphoreHandle_t tx_seg_done;    // Given when an OUT transfer of a segmented blocking write finishes
+        esp_err_t tx_seg_status;          // First error of the segmented blocking write, protected by out_mux
         cdc_acm_data_callback_t in_cb;    // User's callback for async (non-blocking) data IN
+        StreamBufferHandle_t rx_stream;   // RX data for cdc_acm_host_data_rx_blocking(), filled by in_xfer_cb() only
+        cdc_framer_t *framer;             // Framer of received data, NULL without framing
+        cdc_acm_frame_callback_t frame_cb;// User's callback for frames found by framer
+        QueueHandle_t rx_queue;           // Completed IN transfers handed over to the RX task of the device, NULL without RX task
+        SemaphoreHandle_t rx_task_exit;   // Given by the RX task when it exits, NULL if the RX task is not running
         uint16_t in_mps;                  // IN endpoint Maximum Packet Size
         uint8_t *in_data_buffer_base;     // Pointer to IN data buffer in usb_transfer_t
+        size_t in_data_len;               // Length of data not processed by in_cb at in_data_buffer_base, only used with single IN transfer
         const usb_intf_desc_t *intf_desc; // Pointer to data interface descriptor
         SemaphoreHandle_t out_mux;        // OUT mutex
+        uint16_t out_mps;                 // OUT endpoint Maximum Packet Size
     } data;
 
     struct {
         usb_transfer_t *xfer;             // IN notification transfer
         const usb_intf_desc_t *intf_desc; // Pointer to notification interface descriptor, can be NULL if there is no notification channel in the device
         cdc_acm_host_dev_callback_t cb;   // User's callback for device events
+        TickType_t state_interval;        // Minimum interval between SERIAL_STATE events, 0 to report every change
+        TickType_t state_tick;            // Time of the last SERIAL_STATE event
+        bool state_pending;               // Coalesced SERIAL_STATE waits for the end of state_interval
+        TickType_t unknown_log_tick;      // Time of the last log of unsupported notification
+        uint32_t unknown_suppressed;      // Unsupported notifications not logged since unknown_log_tick
+        usb_transfer_t *resp_xfer;        // CTRL transfer for GET_ENCAPSULATED_RESPONSE, NULL if responses are ignored
+        bool resp_in_flight;              // resp_xfer is submitted, it holds a reference to the device
+        uint32_t resp_pending;            // RESPONSE_AVAILABLE notifications received while resp_xfer was in flight
     } notif;                              // Structure with Notif pipe data
 
     usb_transfer_t *ctrl_transfer;        // CTRL (endpoint 0) transfer
     SemaphoreHandle_t ctrl_mux;           // CTRL mutex
+    TickType_t ctrl_timeout;              // Timeout of control requests
     cdc_acm_uart_state_t serial_state;    // Serial State
     cdc_comm_protocol_t comm_protocol;
     cdc_data_protocol_t data_protocol;
     int cdc_func_desc_cnt;                // Number of CDC Functional descriptors in following array
-    const usb_standard_desc_t *(*cdc_func_desc)[]; // Pointer to array of pointers to const usb_standard_desc_t
+    const usb_standard_desc_t *(*cdc_func_desc)[]; // Pointer to array of pointers to const usb_standard_desc_t, owned by usb_dev
+    int refs;                             // References held by usb_event_cb() while it calls the user, protected by cdc_acm_lock
+    bool closed;                          // Device was closed, it is removed once refs drops to 0
+    bool disconnected;                    // User was informed about disconnection of the device
+    usb_class_stats_entry_t *stats;       // Statistics entry, NULL if not counted
     SLIST_ENTRY(cdc_dev_s) list_entry;
 };
@@ -0,0 +1,188 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "usb/cdc_acm_host.h"
+
+/**
+ * @brief CDC-ACM host throughput and latency benchmarks
+ *
+ * The benchmarks run against the echoing TinyUSB dual CDC device of 'mock_device_app' test case on a second board.
+ * Echoed data are counted, so throughput is the same in both directions; it is measured for several
+ * IN and OUT buffer sizes and transfer counts. Round trip latency is measured for echoes of N bytes.
+ * CPU load is reported if the FreeRTOS run time statistics are enabled.
+ */
+
+void test_install_cdc_driver(void);
+
+#define BENCH_BYTES         (256 * 1024) // Data moved by one throughput measurement
+#define BENCH_TIMEOUT_MS    (20000)
+#define BENCH_LATENCY_OPS   (100)
+
+typedef struct {
+    size_t in_size;
+    size_t in_count;
+    size_t out_size;
+    size_t out_count;
+} bench_cfg_t;
+
+static const bench_cfg_t bench_cfgs[] = {
+    { .in_size = 64,   .in_count = 1, .out_size = 64,   .out_count = 0 },
+    { .in_size = 512,  .in_count = 1, .out_size = 512,  .out_count = 0 },
+    { .in_size = 512,  .in_count = 4, .out_size = 512,  .out_count = 4 },
+    { .in_size = 2048, .in_count = 1, .out_size = 2048, .out_count = 0 },
+    { .in_size = 2048, .in_count = 4, .out_size = 2048, .out_count = 4 },
+};
+static const size_t echo_sizes[] = { 1, 64, 512 };
+
+static volatile size_t rx_bytes;
+static volatile size_t rx_target;
+static SemaphoreHandle_t rx_done;
+
+static bool bench_rx_cb(const uint8_t *data, size_t data_len, void *arg)
+{
+    rx_bytes += data_len;
+    if (rx_target && rx_bytes >= rx_target) {
+        rx_target = 0;
+        xSemaphoreGive(rx_done);
+    }
+    return true;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+/**
+ * @brief Get run time of idle tasks of all cores and total run time
+ */
+static void bench_idle_time(uint64_t *idle, uint64_t *total)
+{
+    const UBaseType_t max_tasks = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = calloc(max_tasks, sizeof(TaskStatus_t));
+    TEST_ASSERT_NOT_NULL(tasks);
+    configRUN_TIME_COUNTER_TYPE total_time;
+    const UBaseType_t num_tasks = uxTaskGetSystemState(tasks, max_tasks, &total_time);
+    *idle = 0;
+    for (UBaseType_t i = 0; i < num_tasks; i++) {
+        for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+            if (tasks[i].xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+                *idle += tasks[i].ulRunTimeCounter;
+            }
+        }
+    }
+    *total = (uint64_t)total_time * portNUM_PROCESSORS;
+    free(tasks);
+}
+#endif // CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+static void bench_throughput(cdc_acm_dev_hdl_t cdc_dev, const bench_cfg_t *cfg, uint8_t *buf)
+{
+    rx_bytes = 0;
+    rx_target = BENCH_BYTES;
+    xSemaphoreTake(rx_done, 0);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint64_t idle_start, total_start, idle_end, total_end;
+    bench_idle_time(&idle_start, &total_start);
+#endif
+
+    const int64_t start = esp_timer_get_time();
+    for (size_t sent = 0; sent < BENCH_BYTES; sent += cfg->out_size) {
+        const size_t len = MIN(cfg->out_size, BENCH_BYTES - sent);
+        if (cfg->out_count) {
+            TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_async(cdc_dev, buf, len, NULL, NULL, 1000));
+        } else {
+            TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, buf, len, 1000));
+        }
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(pdTRUE, xSemaphoreTake(rx_done, pdMS_TO_TICKS(BENCH_TIMEOUT_MS)), "Echo incomplete");
+    const int64_t elapsed_us = MAX(esp_timer_get_time() - start, 1);
+
+    printf("in %4zu x %zu, out %4zu x %zu: %7.3f MB/s", cfg->in_size, cfg->in_count, cfg->out_size, MAX(cfg->out_count, 1),
+           (double)BENCH_BYTES / elapsed_us);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    bench_idle_time(&idle_end, &total_end);
+    const uint64_t total = MAX(total_end - total_start, 1);
+    printf("  CPU load %5.1f %%", 100.0 - 100.0 * (double)(idle_end - idle_start) / total);
+#endif
+    printf("\n");
+}
+
+static void bench_latency(cdc_acm_dev_hdl_t cdc_dev, const bench_cfg_t *cfg, uint8_t *buf, size_t size)
+{
+    if (size > cfg->out_size) {
+        return;
+    }
+    uint32_t latency[BENCH_LATENCY_OPS];
+    for (int i = 0; i < BENCH_LATENCY_OPS; i++) {
+        rx_bytes = 0;
+        rx_target = size;
+        xSemaphoreTake(rx_done, 0);
+        const int64_t start = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, buf, size, 1000));
+        TEST_ASSERT_EQUAL_MESSAGE(pdTRUE, xSemaphoreTake(rx_done, pdMS_TO_TICKS(1000)), "Echo incomplete");
+        latency[i] = esp_timer_get_time() - start;
+    }
+    qsort(latency, BENCH_LATENCY_OPS, sizeof(uint32_t), compare_u32);
+    printf("  echo %4zu B: round trip us p50 %6"PRIu32" p90 %6"PRIu32" p99 %6"PRIu32" max %6"PRIu32"\n", size,
+           latency[BENCH_LATENCY_OPS / 2], latency[BENCH_LATENCY_OPS * 9 / 10], latency[BENCH_LATENCY_OPS * 99 / 100],
+           latency[BENCH_LATENCY_OPS - 1]);
+}
+
+TEST_CASE("benchmark_loopback", "[cdc_acm_benchmark][ignore]")
+{
+    rx_done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(rx_done);
+    test_install_cdc_driver();
+
+    for (size_t i = 0; i < sizeof(bench_cfgs) / sizeof(bench_cfgs[0]); i++) {
+        const bench_cfg_t *cfg = &bench_cfgs[i];
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 500,
+            .out_buffer_size = cfg->out_size,
+            .in_buffer_size = cfg->in_size,
+            .data_cb = bench_rx_cb,
+            .in_transfer_count = cfg->in_count,
+            .out_transfer_count = cfg->out_count,
+        };
+        cdc_acm_dev_hdl_t cdc_dev;
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+        uint8_t *buf = malloc(cfg->out_size);
+        TEST_ASSERT_NOT_NULL(buf);
+        memset(buf, 0xA5, cfg->out_size);
+
+        bench_throughput(cdc_dev, cfg, buf);
+        for (size_t j = 0; j < sizeof(echo_sizes) / sizeof(echo_sizes[0]); j++) {
+            bench_latency(cdc_dev, cfg, buf, echo_sizes[j]);
+        }
+
+        free(buf);
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vSemaphoreDelete(rx_done);
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -9,10 +9,12 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/param.h>
 #include "esp_system.h"
 #include "unity.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_idf_version.h"
 #include "esp_log.h"
 #include "esp_err.h"
@@ -158,6 +160,28 @@ static bool handle_rx_advanced(const uint8_t *data, size_t data_len, void *arg)
     return *process_data;
 }
 
+static bool handle_rx_sequence(const uint8_t *data, size_t data_len, void *arg)
+{
+    uint8_t *expected = (uint8_t *)arg;
+    for (size_t i = 0; i < data_len; i++) {
+        TEST_ASSERT_EQUAL_UINT8(*expected, data[i]);
+        (*expected)++;
+    }
+    nb_of_responses++;
+    vTaskDelay(1); // Slow consumer, following data must be received by other IN transfers meanwhile
+    return true;
+}
+
+static bool handle_rx_accumulate(const uint8_t *data, size_t data_len, void *arg)
+{
+    size_t *accumulate_len = (size_t *)arg;
+    for (size_t i = 0; i < data_len; i++) {
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)i, data[i]); // Appended data must follow the unprocessed data
+    }
+    nb_of_responses++;
+    return data_len >= *accumulate_len;
+}
+
 static void notif_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
 {
     switch (event->type) {
@@ -410,6 +434,104 @@ TEST_CASE("sudden_disconnection", "[cdc_acm]")
     vTaskDelay(20); // Short delay to allow task to be cleaned up
 }
 
+static bool handle_rx_blocked(const uint8_t *data, size_t data_len, void *arg)
+{
+    xSemaphoreTake((SemaphoreHandle_t)arg, portMAX_DELAY); // Simulate a consumer stuck in data processing
+    nb_of_responses2++;
+    return true;
+}
+
+/* Slow data callback of a device with its own RX task does not delay other devices */
+TEST_CASE("rx_task", "[cdc_acm]")
+{
+    nb_of_responses = 0;
+    nb_of_responses2 = 0;
+    test_install_cdc_driver();
+    SemaphoreHandle_t unblock = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(unblock);
+
+    cdc_acm_dev_hdl_t cdc_dev1, cdc_dev2;
+    cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx,
+        .user_arg = tx_buf,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev1));
+    dev_config.data_cb = handle_rx_blocked;
+    dev_config.user_arg = unblock;
+    dev_config.rx_task.stack_size = 4096;
+    dev_config.rx_task.priority = 5;
+    dev_config.rx_task.xCoreID = tskNO_AFFINITY;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 2, &dev_config, &cdc_dev2));
+
+    // Second device gets stuck in its data callback
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev2, tx_buf2, sizeof(tx_buf2), 1000));
+    vTaskDelay(20);
+
+    // First device is served by the driver's task meanwhile
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev1, tx_buf, sizeof(tx_buf), 1000));
+    }
+    vTaskDelay(50);
+    TEST_ASSERT_EQUAL(5, nb_of_responses);
+    TEST_ASSERT_EQUAL(0, nb_of_responses2);
+
+    xSemaphoreGive(unblock);
+    vTaskDelay(20);
+    TEST_ASSERT_EQUAL(1, nb_of_responses2);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev1));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev2));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vSemaphoreDelete(unblock);
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+static void open_absent_device_task(void *arg)
+{
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 1000,
+        .out_buffer_size = 64,
+    };
+    cdc_acm_dev_hdl_t cdc_dev;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, cdc_acm_host_open(0x1234, 0x5678, 0, &dev_config, &cdc_dev));
+    xTaskNotifyGive((TaskHandle_t)arg);
+    vTaskDelete(NULL);
+}
+
+/* Waiting for connection of one device must not block closing of another one */
+TEST_CASE("open_close_concurrent", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx,
+        .user_arg = tx_buf,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    TEST_ASSERT_EQUAL(pdTRUE, xTaskCreate(open_absent_device_task, "CDC open", 4096, xTaskGetCurrentTaskHandle(), 4, NULL));
+    vTaskDelay(pdMS_TO_TICKS(100)); // Let the task wait for the device
+
+    // The driver cannot be uninstalled while a device is being opened
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cdc_acm_host_uninstall());
+    TEST_ASSERT_EQUAL(0, ulTaskNotifyTake(pdTRUE, 0)); // The close did not wait for the connection timeout
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(1, ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000)));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
 /**
  * @brief CDC-ACM error handling test
  *
@@ -463,8 +585,7 @@ TEST_CASE("error_handling", "[cdc_acm]")
     // Uninstall driver with open devices
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cdc_acm_host_uninstall());
 
-    // Send data that is too large and NULL data
-    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, cdc_acm_host_data_tx_blocking(cdc_dev, tx_buf, 1024, 1000));
+    // Send NULL data
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_data_tx_blocking(cdc_dev, NULL, 10, 1000));
 
     // Change mode to read-only and try to write to it
@@ -483,6 +604,43 @@ TEST_CASE("error_handling", "[cdc_acm]")
     vTaskDelay(20); // Short delay to allow task to be cleaned up
 }
 
+/**
+ * @brief Encapsulated command configuration
+ *
+ * TinyUSB does not implement the encapsulated command requests, so only the driver side is checked here.
+ * Responses announced by RESPONSE_AVAILABLE notification are covered by host_test/device_interaction.
+ */
+TEST_CASE("encapsulated_command", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx
+    };
+
+    // Response that does not fit into wLength of GET_ENCAPSULATED_RESPONSE
+    dev_config.encapsulated_response_size = UINT16_MAX + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+
+    dev_config.encapsulated_response_size = 256;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    // Send NULL and empty command
+    const uint8_t command[] = "AT\r";
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_send_encapsulated_command(cdc_dev, NULL, 10));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_send_encapsulated_command(cdc_dev, command, 0));
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
 TEST_CASE("custom_command", "[cdc_acm]")
 {
     test_install_cdc_driver();
@@ -591,11 +749,7 @@ TEST_CASE("rx_buffer", "[cdc_acm]")
     TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, sizeof(tx_data), 1000));
     vTaskDelay(5);
 
-#ifdef CONFIG_IDF_TARGET_ESP32P4    // RX buffer append is not yet supported on ESP32-P4
-    TEST_ASSERT_FALSE_MESSAGE(rx_overflow, "RX overflow");
-#else
     TEST_ASSERT_TRUE_MESSAGE(rx_overflow, "RX did not overflow");
-#endif
     rx_overflow = false;
 
     // 4. Send more data to the EP: Expect no error
@@ -610,6 +764,283 @@ TEST_CASE("rx_buffer", "[cdc_acm]")
     vTaskDelay(20); // Short delay to allow task to be cleaned up
 }
 
+/* Received data are buffered by the driver and read with a timeout */
+TEST_CASE("rx_blocking", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .in_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx,
+        .user_arg = tx_buf,
+        .rx_buffer_size = 1024,
+    };
+
+    // Data callback and RX buffer are exclusive
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    dev_config.data_cb = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    uint8_t rx_data[64];
+    size_t rx_len;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, cdc_acm_host_data_rx_blocking(cdc_dev, rx_data, sizeof(rx_data), &rx_len, 10));
+
+    // Several responses are buffered while nobody reads
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_buf, sizeof(tx_buf), 1000));
+    }
+    vTaskDelay(50);
+    size_t total = 0;
+    while (cdc_acm_host_data_rx_blocking(cdc_dev, rx_data, sizeof(tx_buf), &rx_len, 100) == ESP_OK) {
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(tx_buf + (total % sizeof(tx_buf)), rx_data, MIN(rx_len, sizeof(tx_buf) - (total % sizeof(tx_buf))));
+        total += rx_len;
+    }
+    TEST_ASSERT_EQUAL(4 * sizeof(tx_buf), total);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+/* Unprocessed data are delivered again together with the appended data, also on targets with cache synced IN buffers */
+TEST_CASE("rx_buffer_append", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+    nb_of_responses = 0;
+    size_t accumulate_len = 3 * 20;
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .in_buffer_size = 512,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx_accumulate,
+        .user_arg = &accumulate_len,
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    // Short packets of 20 bytes, they do not end at cache line boundary
+    uint8_t tx_data[20];
+    for (int i = 0; i < 3; i++) {
+        for (size_t j = 0; j < sizeof(tx_data); j++) {
+            tx_data[j] = (uint8_t)(i * sizeof(tx_data) + j);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, sizeof(tx_data), 1000));
+        vTaskDelay(5);
+    }
+    TEST_ASSERT_EQUAL(3, nb_of_responses);
+    TEST_ASSERT_FALSE_MESSAGE(rx_overflow, "RX overflowed");
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+/* Several IN transfers in flight: data must be delivered in order of reception */
+TEST_CASE("multiple_in_transfers", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+    nb_of_responses = 0;
+    uint8_t expected = 0;
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .in_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx_sequence,
+        .user_arg = &expected,
+        .in_transfer_count = 4,
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    uint8_t tx_data[32];
+    for (int i = 0; i < 32; i++) {
+        for (size_t j = 0; j < sizeof(tx_data); j++) {
+            tx_data[j] = (uint8_t)(i * sizeof(tx_data) + j);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, sizeof(tx_data), 1000));
+    }
+    vTaskDelay(100); // Wait until responses are processed
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)(32 * sizeof(tx_data)), expected);
+    TEST_ASSERT_GREATER_THAN(0, nb_of_responses);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+static void tx_done_cb(esp_err_t status, void *user_arg)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, status);
+    (*(volatile int *)user_arg)++;
+}
+
+/* Asynchronous TX: several OUT transfers in flight, data must be sent in order of the calls */
+TEST_CASE("tx_async", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+    nb_of_responses = 0;
+    uint8_t expected = 0;
+    volatile int tx_done = 0;
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .in_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx_sequence,
+        .user_arg = &expected,
+        .in_transfer_count = 2,
+        .out_transfer_count = 0,
+    };
+
+    // Asynchronous TX is not available without OUT transfers for it
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, cdc_acm_host_data_tx_async(cdc_dev, tx_buf, sizeof(tx_buf), NULL, NULL, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+
+    dev_config.out_transfer_count = 4;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    uint8_t tx_data[32];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, cdc_acm_host_data_tx_async(cdc_dev, tx_data, 65, NULL, NULL, 0));
+    for (int i = 0; i < 32; i++) {
+        for (size_t j = 0; j < sizeof(tx_data); j++) {
+            tx_data[j] = (uint8_t)(i * sizeof(tx_data) + j);
+        }
+        // Data are copied, so the buffer can be reused immediately
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_async(cdc_dev, tx_data, sizeof(tx_data), tx_done_cb, (void *)&tx_done, 1000));
+    }
+    vTaskDelay(100); // Wait until responses are processed
+    TEST_ASSERT_EQUAL(32, tx_done);
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)(32 * sizeof(tx_data)), expected);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+/* Blocking TX of data longer than out_buffer_size: data are split into several transfers and must be received in order */
+TEST_CASE("tx_segmented", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+    uint8_t expected;
+    static uint8_t tx_data[1024];
+    for (size_t i = 0; i < sizeof(tx_data); i++) {
+        tx_data[i] = (uint8_t)i;
+    }
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 100, // Not a multiple of MPS
+        .in_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx_sequence,
+        .user_arg = &expected,
+        .in_transfer_count = 4,
+        .out_transfer_count = 0,
+    };
+
+    // Transfers are sent one by one in the OUT transfer of blocking writes
+    expected = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, 1000, 1000));
+    vTaskDelay(100); // Wait until responses are processed
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)1000, expected);
+
+    // Write at MPS boundary is terminated with zero-length packet after the last segment only
+    expected = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, sizeof(tx_data), 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, 10, 1000)); // Following write is not merged
+    vTaskDelay(100);
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)10, expected);
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+
+    // Transfers are streamed through the asynchronous OUT transfers, the write ends at MPS boundary with zero-length packet
+    expected = 0;
+    dev_config.out_transfer_count = 4;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, sizeof(tx_data), 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_dev, tx_data, 10, 1000)); // Following write is not merged
+    vTaskDelay(100);
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)10, expected);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
+/* Zero-copy TX: data are written directly into borrowed OUT transfer buffers */
+TEST_CASE("tx_buffer_borrow", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+    nb_of_responses = 0;
+    uint8_t expected = 0;
+    volatile int tx_done = 0;
+
+    cdc_acm_dev_hdl_t cdc_dev;
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = 500,
+        .out_buffer_size = 64,
+        .in_buffer_size = 64,
+        .event_cb = notif_cb,
+        .data_cb = handle_rx_sequence,
+        .user_arg = &expected,
+        .out_transfer_count = 2,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open(0x303A, 0x4002, 0, &dev_config, &cdc_dev));
+    TEST_ASSERT_NOT_NULL(cdc_dev);
+
+    // All buffers borrowed: no more buffers until one is returned
+    uint8_t *buf, *buf2;
+    size_t buf_size;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_tx_buffer_get(cdc_dev, &buf, &buf_size, 0));
+    TEST_ASSERT_GREATER_OR_EQUAL(64, buf_size);
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_tx_buffer_get(cdc_dev, &buf2, &buf_size, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, cdc_acm_host_tx_buffer_get(cdc_dev, &buf, &buf_size, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, cdc_acm_host_tx_buffer_commit(cdc_dev, buf2, buf_size + 1, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_tx_buffer_commit(cdc_dev, buf2, 0, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_tx_buffer_commit(cdc_dev, buf2, 0, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cdc_acm_host_tx_buffer_commit(cdc_dev, tx_buf, 1, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_tx_buffer_commit(cdc_dev, buf, 0, NULL, NULL));
+
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_tx_buffer_get(cdc_dev, &buf, &buf_size, 1000));
+        for (size_t j = 0; j < 32; j++) {
+            buf[j] = (uint8_t)(i * 32 + j);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_tx_buffer_commit(cdc_dev, buf, 32, tx_done_cb, (void *)&tx_done));
+    }
+    vTaskDelay(100); // Wait until responses are processed
+    TEST_ASSERT_EQUAL(16, tx_done);
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)(16 * 32), expected);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_dev));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
 TEST_CASE("functional_descriptor", "[cdc_acm]")
 {
     test_install_cdc_driver();
@@ -759,6 +1190,108 @@ TEST_CASE("any_vid_pid", "[cdc_acm]")
     vTaskDelay(20); // Short delay to allow task to be cleaned up
 }
 
+#define AUTO_OPEN_ITF_NUM 2
+static cdc_acm_dev_hdl_t auto_open_hdl[AUTO_OPEN_ITF_NUM];
+
+static bool auto_open_match_cb(const cdc_acm_auto_open_dev_info_t *info, cdc_acm_host_device_config_t *dev_config, void *user_arg)
+{
+    printf("Auto-open match: address %d interface %d serial '%s'\n", info->dev_addr, info->interface_idx, info->serial);
+    // Each interface echoes its own message
+    if (info->interface_idx == 2) {
+        dev_config->data_cb = handle_rx2;
+        dev_config->user_arg = tx_buf2;
+    }
+    return true;
+}
+
+static void auto_open_cb(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_auto_open_dev_info_t *info, esp_err_t status, void *user_arg)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, status);
+    auto_open_hdl[info->interface_idx / 2] = cdc_hdl;
+    xTaskNotifyGive((TaskHandle_t)user_arg);
+}
+
+static void auto_open_event_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
+{
+    if (event->type == CDC_ACM_HOST_DEVICE_DISCONNECTED) {
+        for (int i = 0; i < AUTO_OPEN_ITF_NUM; i++) {
+            if (auto_open_hdl[i] == event->data.cdc_hdl) {
+                auto_open_hdl[i] = NULL;
+            }
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(event->data.cdc_hdl));
+    }
+}
+
+/**
+ * @brief Auto-open service
+ *
+ * Both interfaces of the dual CDC device are opened by the service, when the service starts and again after reconnection.
+ */
+TEST_CASE("auto_open", "[cdc_acm]")
+{
+    test_install_cdc_driver();
+
+    const cdc_acm_host_auto_open_config_t auto_open_config = {
+        .vid = 0x303A,
+        .pid = 0x4002,
+        .interface_mask = BIT(0) | BIT(2),
+        .dev_config = {
+            .out_buffer_size = 64,
+            .event_cb = auto_open_event_cb,
+            .data_cb = handle_rx,
+            .user_arg = tx_buf,
+        },
+        .match_cb = auto_open_match_cb,
+        .opened_cb = auto_open_cb,
+        .user_arg = xTaskGetCurrentTaskHandle(),
+        .task = {
+            .count = 2,
+            .stack_size = 4096,
+            .priority = 5,
+            .xCoreID = 0,
+        },
+    };
+
+    for (int round = 0; round < 2; round++) {
+        nb_of_responses = 0;
+        nb_of_responses2 = 0;
+        if (round == 0) {
+            // The device is connected already
+            TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_auto_open_start(&auto_open_config));
+            TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cdc_acm_host_auto_open_start(&auto_open_config));
+        } else {
+            force_conn_state(false, 50);
+            vTaskDelay(50);
+            TEST_ASSERT_NULL(auto_open_hdl[0]);
+            TEST_ASSERT_NULL(auto_open_hdl[1]);
+            force_conn_state(true, 0);
+        }
+        for (int i = 0; i < AUTO_OPEN_ITF_NUM; i++) {
+            TEST_ASSERT_EQUAL_MESSAGE(1, ulTaskNotifyTake(false, pdMS_TO_TICKS(2000)), "Interface was not opened");
+        }
+        TEST_ASSERT_NOT_NULL(auto_open_hdl[0]);
+        TEST_ASSERT_NOT_NULL(auto_open_hdl[1]);
+
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(auto_open_hdl[0], tx_buf, sizeof(tx_buf), 1000));
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(auto_open_hdl[1], tx_buf2, sizeof(tx_buf2), 1000));
+        vTaskDelay(100); // Wait for RX callbacks
+        TEST_ASSERT_EQUAL(1, nb_of_responses);
+        TEST_ASSERT_EQUAL(1, nb_of_responses2);
+    }
+
+    // Clean-up, the driver can't be uninstalled while the service runs
+    for (int i = 0; i < AUTO_OPEN_ITF_NUM; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(auto_open_hdl[i]));
+        auto_open_hdl[i] = NULL;
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cdc_acm_host_uninstall());
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_auto_open_stop());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cdc_acm_host_auto_open_stop());
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
 /* Following test case implements dual CDC-ACM USB device that can be used as mock device for CDC-ACM Host tests */
 void run_usb_dual_cdc_device(void);
 TEST_CASE("mock_device_app", "[cdc_acm_device][ignore]")
@@ -0,0 +1,517 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "usb/usb_host.h"
+#include "usb/cdc_acm_host.h"
+#include "usb/cdc_ncm_host.h"
+#include "cdc_ncm_ntb.h"
+
+static const char *TAG = "cdc_ncm";
+
+#define CDC_NCM_NTB_SIZE_MIN      (2048) // Minimal dwNtbInMaxSize and dwNtbOutMaxSize, USB CDC-NCM specification rev. 1.0, chapter 6.2.1
+#define CDC_NCM_MAC_STRING_LEN    (12)   // MAC address as hexadecimal digits in string descriptor
+#define CDC_NCM_LANGID_EN_US      (0x0409)
+// Transfers of a multiple of Maximum Packet Size would need a zero length packet to end. A zero byte behind the data ends them
+// with a short packet instead. 64 bytes covers bulk endpoints of Full and High Speed network devices
+#define CDC_NCM_SHORT_PACKET_MPS  (64)
+#define CDC_NCM_PACKET_FILTER     (USB_CDC_ETH_PACKET_TYPE_DIRECTED | USB_CDC_ETH_PACKET_TYPE_BROADCAST | USB_CDC_ETH_PACKET_TYPE_ALL_MULTICAST)
+
+static portMUX_TYPE cdc_ncm_lock = portMUX_INITIALIZER_UNLOCKED;
+#define CDC_NCM_ENTER_CRITICAL()   portENTER_CRITICAL(&cdc_ncm_lock)
+#define CDC_NCM_EXIT_CRITICAL()    portEXIT_CRITICAL(&cdc_ncm_lock)
+
+typedef struct cdc_ncm_dev_s {
+    cdc_acm_dev_hdl_t cdc_hdl;            // Device opened by CDC-ACM driver
+    uint8_t intf_idx;                     // Communication interface, recipient of class requests
+    bool ncm;                             // NTBs are used, otherwise ECM with one frame per transfer
+    bool link_up;                         // Last NETWORK_CONNECTION state
+    uint8_t mac[6];                       // MAC address from the Ethernet Networking Functional Descriptor
+    uint16_t max_segment_size;            // wMaxSegmentSize of the device
+    size_t ntb_in_size;                   // Size of received NTBs, set with SetNtbInputSize
+    size_t ntb_out_size;                  // Maximum size of sent NTBs
+    cdc_ncm_ntb_layout_t ntb_layout;      // Layout of sent NTBs
+    struct {
+        cdc_ncm_host_rx_cb_t rx_cb;       // Frame callback, of the device config or of the input path
+        cdc_ncm_host_event_cb_t event_cb; // Event callback, of the device config or of the input path
+        void *arg;                        // Argument of the callbacks
+    } cb, user_cb;                        // Active callbacks and callbacks of the device config, protected by cdc_ncm_lock
+    struct {
+        SemaphoreHandle_t mux;            // Protects the NTB being filled
+        uint8_t *buf;                     // Borrowed buffer of OUT transfer being filled, NULL if none
+        size_t buf_size;                  // Size of buf
+        cdc_ncm_ntb_tx_t ntb;             // NTB being filled in buf
+        uint16_t sequence;                // wSequence of the next NTB
+        atomic_int in_flight;             // OUT transfers submitted and not completed
+        atomic_bool kick;                 // OUT transfer completed while mux was held, the NTB being filled is to be sent
+    } tx;
+    cdc_ncm_host_info_t counters;         // Counters of cdc_ncm_host_info_t, protected by cdc_ncm_lock
+} cdc_ncm_dev_t;
+
+/**
+ * @brief Read MAC address from string descriptor
+ *
+ * @param[in] ncm       Device
+ * @param[in] str_index iMACAddress of the Ethernet Networking Functional Descriptor
+ * @return esp_err_t
+ */
+static esp_err_t cdc_ncm_mac_read(cdc_ncm_dev_t *ncm, uint8_t str_index)
+{
+    // bLength, bDescriptorType and 12 UTF-16LE hexadecimal digits
+    uint8_t str_desc[2 + CDC_NCM_MAC_STRING_LEN * 2];
+    ESP_RETURN_ON_ERROR(
+        cdc_acm_host_send_custom_request(ncm->cdc_hdl, USB_BM_REQUEST_TYPE_DIR_IN | USB_BM_REQUEST_TYPE_TYPE_STANDARD | USB_BM_REQUEST_TYPE_RECIP_DEVICE,
+                                         USB_B_REQUEST_GET_DESCRIPTOR, (USB_W_VALUE_DT_STRING << 8) | str_index, CDC_NCM_LANGID_EN_US,
+                                         sizeof(str_desc), str_desc),
+        TAG, "Could not read MAC address string");
+    ESP_RETURN_ON_FALSE(str_desc[0] >= sizeof(str_desc) && str_desc[1] == USB_B_DESCRIPTOR_TYPE_STRING,
+                        ESP_ERR_INVALID_RESPONSE, TAG, "Invalid MAC address string");
+
+    for (int i = 0; i < CDC_NCM_MAC_STRING_LEN; i++) {
+        const char c = str_desc[2 + i * 2];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else {
+            ESP_LOGE(TAG, "Invalid MAC address string");
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        ncm->mac[i / 2] = (i % 2) ? (ncm->mac[i / 2] | nibble) : (nibble << 4);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Negotiate NTB sizes and layout
+ *
+ * Must be called while the data interface is in alternate setting 0.
+ *
+ * @param[in] ncm Device
+ * @return esp_err_t
+ */
+static esp_err_t cdc_ncm_ntb_setup(cdc_ncm_dev_t *ncm)
+{
+    cdc_ncm_ntb_parameters_t params;
+    ESP_RETURN_ON_ERROR(
+        cdc_acm_host_send_custom_request(ncm->cdc_hdl, USB_BM_REQUEST_TYPE_DIR_IN | USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE,
+                                         USB_CDC_REQ_GET_NTB_PARAMETERS, 0, ncm->intf_idx, sizeof(params), (uint8_t *)&params),
+        TAG, "Could not get NTB parameters");
+    ESP_RETURN_ON_FALSE(params.bmNtbFormatsSupported & USB_CDC_NCM_NTB16_SUPPORTED, ESP_ERR_NOT_SUPPORTED, TAG, "NTB-16 not supported");
+
+    // The device sends NTBs up to the size of our IN transfers
+    ncm->ntb_in_size = MIN(ncm->ntb_in_size, MAX(params.dwNtbInMaxSize, CDC_NCM_NTB_SIZE_MIN));
+    uint32_t ntb_in_size = ncm->ntb_in_size;
+    ESP_RETURN_ON_ERROR(
+        cdc_acm_host_send_custom_request(ncm->cdc_hdl, USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE,
+                                         USB_CDC_REQ_SET_NTB_INPUT_SIZE, 0, ncm->intf_idx, sizeof(ntb_in_size), (uint8_t *)&ntb_in_size),
+        TAG, "Could not set NTB input size");
+
+    ncm->ntb_out_size = MIN(ncm->ntb_out_size, MAX(params.dwNtbOutMaxSize, CDC_NCM_NTB_SIZE_MIN));
+    cdc_ncm_ntb_layout_init(params.wNdpOutDivisor, params.wNdpOutPayloadRemainder, params.wNdpOutAlignment, params.wNtbOutMaxDatagrams,
+                            &ncm->ntb_layout);
+    ESP_LOGD(TAG, "NTB in %u, out %u bytes, %u datagrams", (unsigned)ncm->ntb_in_size, (unsigned)ncm->ntb_out_size, ncm->ntb_layout.max_datagrams);
+    return ESP_OK;
+}
+
+/**
+ * @brief Interface setup, called by CDC-ACM driver before the data interface is claimed
+ */
+static esp_err_t cdc_ncm_setup_cb(cdc_acm_dev_hdl_t cdc_hdl, void *user_arg)
+{
+    cdc_ncm_dev_t *ncm = (cdc_ncm_dev_t *)user_arg;
+    ncm->cdc_hdl = cdc_hdl;
+
+    const cdc_eth_desc_t *eth_desc;
+    ESP_RETURN_ON_FALSE(
+        cdc_acm_host_cdc_desc_get(cdc_hdl, USB_CDC_DESC_SUBTYPE_ETH, (const usb_standard_desc_t **)&eth_desc) == ESP_OK &&
+        eth_desc->bFunctionLength >= sizeof(cdc_eth_desc_t),
+        ESP_ERR_NOT_SUPPORTED, TAG, "Ethernet Networking Functional Descriptor not found");
+    ncm->max_segment_size = eth_desc->wMaxSegmentSize ? eth_desc->wMaxSegmentSize : CDC_NCM_HOST_FRAME_SIZE_MAX;
+    ESP_RETURN_ON_ERROR(cdc_ncm_mac_read(ncm, eth_desc->iMACAddress), TAG,);
+
+    const usb_standard_desc_t *ncm_desc;
+    ncm->ncm = (cdc_acm_host_cdc_desc_get(cdc_hdl, USB_CDC_DESC_SUBTYPE_NCM, &ncm_desc) == ESP_OK);
+    if (ncm->ncm) {
+        ESP_RETURN_ON_ERROR(cdc_ncm_ntb_setup(ncm), TAG,);
+    }
+
+    // Some devices pass no traffic until the filter is set, others do not support the request
+    if (cdc_acm_host_send_custom_request(cdc_hdl, USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE,
+                                         USB_CDC_REQ_SET_ETHERNET_PACKET_FILTER, CDC_NCM_PACKET_FILTER, ncm->intf_idx, 0, NULL) != ESP_OK) {
+        ESP_LOGD(TAG, "Packet filter not supported");
+    }
+    return ESP_OK;
+}
+
+typedef struct {
+    cdc_ncm_host_rx_cb_t rx_cb;
+    void *arg;
+} cdc_ncm_rx_ctx_t;
+
+static void cdc_ncm_datagram_cb(const uint8_t *datagram, size_t len, void *arg)
+{
+    const cdc_ncm_rx_ctx_t *ctx = (const cdc_ncm_rx_ctx_t *)arg;
+    if (ctx->rx_cb) {
+        ctx->rx_cb(datagram, len, ctx->arg);
+    }
+}
+
+/**
+ * @brief Data callback of CDC-ACM driver: one NTB or one ECM frame per IN transfer
+ */
+static bool cdc_ncm_in_cb(const uint8_t *data, size_t data_len, void *user_arg)
+{
+    cdc_ncm_dev_t *ncm = (cdc_ncm_dev_t *)user_arg;
+    if (data_len == 0) {
+        return true;
+    }
+
+    CDC_NCM_ENTER_CRITICAL();
+    const cdc_ncm_rx_ctx_t ctx = {
+        .rx_cb = ncm->cb.rx_cb,
+        .arg = ncm->cb.arg,
+    };
+    CDC_NCM_EXIT_CRITICAL();
+
+    int frames = 1;
+    if (ncm->ncm) {
+        frames = cdc_ncm_ntb_rx_parse(data, data_len, cdc_ncm_datagram_cb, (void *)&ctx);
+    } else {
+        cdc_ncm_datagram_cb(data, data_len, (void *)&ctx);
+    }
+
+    CDC_NCM_ENTER_CRITICAL();
+    ncm->counters.rx_transfers++;
+    if (frames < 0) {
+        ncm->counters.rx_errors++;
+    } else {
+        ncm->counters.rx_frames += frames;
+    }
+    CDC_NCM_EXIT_CRITICAL();
+    if (frames < 0) {
+        ESP_LOGW(TAG, "Malformed NTB of %u bytes", (unsigned)data_len);
+    }
+    return true;
+}
+
+static void cdc_ncm_event_deliver(cdc_ncm_dev_t *ncm, cdc_ncm_host_event_t event)
+{
+    CDC_NCM_ENTER_CRITICAL();
+    const cdc_ncm_host_event_cb_t event_cb = ncm->cb.event_cb;
+    void *arg = ncm->cb.arg;
+    CDC_NCM_EXIT_CRITICAL();
+    if (event_cb) {
+        event_cb(ncm, event, arg);
+    }
+}
+
+/**
+ * @brief Event callback of CDC-ACM driver
+ */
+static void cdc_ncm_acm_event_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
+{
+    cdc_ncm_dev_t *ncm = (cdc_ncm_dev_t *)user_ctx;
+    switch (event->type) {
+    case CDC_ACM_HOST_NETWORK_CONNECTION:
+        CDC_NCM_ENTER_CRITICAL();
+        ncm->link_up = event->data.network_connected;
+        CDC_NCM_EXIT_CRITICAL();
+        cdc_ncm_event_deliver(ncm, event->data.network_connected ? CDC_NCM_HOST_LINK_UP : CDC_NCM_HOST_LINK_DOWN);
+        break;
+    case CDC_ACM_HOST_DEVICE_DISCONNECTED:
+        CDC_NCM_ENTER_CRITICAL();
+        ncm->link_up = false;
+        CDC_NCM_EXIT_CRITICAL();
+        cdc_ncm_event_deliver(ncm, CDC_NCM_HOST_DEVICE_DISCONNECTED);
+        break;
+    case CDC_ACM_HOST_ERROR:
+        ESP_LOGW(TAG, "USB error %d", event->data.error);
+        break;
+    default:
+        break;
+    }
+}
+
+static void cdc_ncm_tx_kick(cdc_ncm_dev_t *ncm);
+
+/**
+ * @brief OUT transfer completed
+ *
+ * Called from the USB Host context, so the NTB waiting for this completion is sent only if tx.mux is free.
+ * Otherwise its holder sends it when releasing the mutex.
+ */
+static void cdc_ncm_tx_done_cb(esp_err_t status, void *user_arg)
+{
+    cdc_ncm_dev_t *ncm = (cdc_ncm_dev_t *)user_arg;
+    if (status != ESP_OK) {
+        CDC_NCM_ENTER_CRITICAL();
+        ncm->counters.tx_errors++;
+        CDC_NCM_EXIT_CRITICAL();
+    }
+    atomic_fetch_sub(&ncm->tx.in_flight, 1);
+    cdc_ncm_tx_kick(ncm);
+}
+
+/**
+ * @brief Submit the borrowed OUT buffer
+ *
+ * @note tx.mux must be held
+ * @param[in] ncm    Device
+ * @param[in] len    Length of data in the buffer
+ * @param[in] frames Number of frames in the buffer
+ * @return esp_err_t
+ */
+static esp_err_t cdc_ncm_tx_commit(cdc_ncm_dev_t *ncm, size_t len, uint16_t frames)
+{
+    // Avoid transfers of a multiple of MPS. NTB of the maximum size ends without a short packet
+    const size_t max_len = ncm->ncm ? ncm->ntb_out_size : ncm->tx.buf_size;
+    if ((len % CDC_NCM_SHORT_PACKET_MPS == 0) && (len < max_len)) {
+        ncm->tx.buf[len++] = 0;
+    }
+
+    uint8_t *buf = ncm->tx.buf;
+    ncm->tx.buf = NULL;
+    atomic_fetch_add(&ncm->tx.in_flight, 1);
+    const esp_err_t ret = cdc_acm_host_tx_buffer_commit(ncm->cdc_hdl, buf, len, cdc_ncm_tx_done_cb, ncm);
+    CDC_NCM_ENTER_CRITICAL();
+    if (ret == ESP_OK) {
+        ncm->counters.tx_frames += frames;
+        ncm->counters.tx_transfers++;
+    } else {
+        ncm->counters.tx_errors++;
+    }
+    CDC_NCM_EXIT_CRITICAL();
+    if (ret != ESP_OK) {
+        atomic_fetch_sub(&ncm->tx.in_flight, 1);
+    }
+    return ret;
+}
+
+/**
+ * @brief Send the NTB being filled, if it has any datagram
+ *
+ * @note tx.mux must be held
+ */
+static esp_err_t cdc_ncm_tx_flush(cdc_ncm_dev_t *ncm)
+{
+    if (ncm->tx.buf == NULL || ncm->tx.ntb.count == 0) {
+        return ESP_OK;
+    }
+    const size_t len = cdc_ncm_ntb_tx_finish(&ncm->tx.ntb, ncm->tx.sequence++);
+    return cdc_ncm_tx_commit(ncm, len, ncm->tx.ntb.count);
+}
+
+/**
+ * @brief Release tx.mux
+ *
+ * OUT transfers completed while the mutex was held could not send the NTB being filled, it is sent here.
+ */
+static void cdc_ncm_tx_unlock(cdc_ncm_dev_t *ncm)
+{
+    while (true) {
+        if (atomic_exchange(&ncm->tx.kick, false)) {
+            cdc_ncm_tx_flush(ncm);
+        }
+        xSemaphoreGive(ncm->tx.mux);
+        // Completion after the check above found the mutex taken
+        if (!atomic_load(&ncm->tx.kick) || xSemaphoreTake(ncm->tx.mux, 0) != pdTRUE) {
+            break;
+        }
+    }
+}
+
+static void cdc_ncm_tx_kick(cdc_ncm_dev_t *ncm)
+{
+    atomic_store(&ncm->tx.kick, true);
+    if (xSemaphoreTake(ncm->tx.mux, 0) == pdTRUE) {
+        cdc_ncm_tx_unlock(ncm);
+    }
+}
+
+/**
+ * @brief Borrow a buffer of free OUT transfer
+ *
+ * @note tx.mux must be held
+ */
+static esp_err_t cdc_ncm_tx_buffer_get(cdc_ncm_dev_t *ncm, uint32_t timeout_ms)
+{
+    if (ncm->tx.buf) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(cdc_acm_host_tx_buffer_get(ncm->cdc_hdl, &ncm->tx.buf, &ncm->tx.buf_size, timeout_ms), TAG,);
+    if (ncm->ncm) {
+        cdc_ncm_ntb_tx_init(&ncm->tx.ntb, ncm->tx.buf, MIN(ncm->tx.buf_size, ncm->ntb_out_size), &ncm->ntb_layout);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Append frame to the NTB being filled
+ *
+ * @note tx.mux must be held
+ */
+static esp_err_t cdc_ncm_tx_ntb_append(cdc_ncm_dev_t *ncm, const uint8_t *frame, size_t frame_len, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_ERROR(cdc_ncm_tx_buffer_get(ncm, timeout_ms), TAG,);
+    if (!cdc_ncm_ntb_tx_append(&ncm->tx.ntb, frame, frame_len)) {
+        // The NTB is full, send it and start a new one
+        ESP_RETURN_ON_ERROR(cdc_ncm_tx_flush(ncm), TAG,);
+        ESP_RETURN_ON_ERROR(cdc_ncm_tx_buffer_get(ncm, timeout_ms), TAG,);
+        if (!cdc_ncm_ntb_tx_append(&ncm->tx.ntb, frame, frame_len)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    // Aggregate only while another NTB is in flight, its completion sends this NTB
+    if (cdc_ncm_ntb_tx_is_full(&ncm->tx.ntb) || atomic_load(&ncm->tx.in_flight) == 0) {
+        return cdc_ncm_tx_flush(ncm);
+    }
+    return ESP_OK;
+}
+
+esp_err_t cdc_ncm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_ncm_host_device_config_t *dev_config, cdc_ncm_dev_hdl_t *ncm_hdl_ret)
+{
+    esp_err_t ret;
+    ESP_RETURN_ON_FALSE(dev_config && ncm_hdl_ret, ESP_ERR_INVALID_ARG, TAG,);
+    const size_t ntb_in_size = dev_config->ntb_in_size ? dev_config->ntb_in_size : CDC_NCM_HOST_NTB_IN_SIZE_DEFAULT;
+    const size_t ntb_out_size = dev_config->ntb_out_size ? dev_config->ntb_out_size : CDC_NCM_HOST_NTB_OUT_SIZE_DEFAULT;
+    ESP_RETURN_ON_FALSE(ntb_in_size >= CDC_NCM_NTB_SIZE_MIN && ntb_out_size >= CDC_NCM_NTB_SIZE_MIN, ESP_ERR_INVALID_ARG, TAG, "NTB smaller than 2048 bytes");
+    *ncm_hdl_ret = NULL;
+
+    cdc_ncm_dev_t *ncm = calloc(1, sizeof(cdc_ncm_dev_t));
+    ESP_RETURN_ON_FALSE(ncm, ESP_ERR_NO_MEM, TAG,);
+    ncm->intf_idx = interface_idx;
+    ncm->ntb_in_size = ntb_in_size;
+    ncm->ntb_out_size = ntb_out_size;
+    ncm->user_cb.rx_cb = dev_config->rx_cb;
+    ncm->user_cb.event_cb = dev_config->event_cb;
+    ncm->user_cb.arg = dev_config->user_arg;
+    ncm->cb = ncm->user_cb;
+    atomic_init(&ncm->tx.in_flight, 0);
+    atomic_init(&ncm->tx.kick, false);
+    ncm->tx.mux = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(ncm->tx.mux, ESP_ERR_NO_MEM, err, TAG,);
+
+    const cdc_acm_host_device_config_t acm_config = {
+        .connection_timeout_ms = dev_config->connection_timeout_ms,
+        .out_buffer_size = ntb_out_size,
+        .in_buffer_size = ntb_in_size,
+        .event_cb = cdc_ncm_acm_event_cb,
+        .data_cb = cdc_ncm_in_cb,
+        .user_arg = ncm,
+        .in_transfer_count = dev_config->in_transfer_count ? dev_config->in_transfer_count : CDC_NCM_HOST_XFER_COUNT_DEFAULT,
+        .out_transfer_count = dev_config->out_transfer_count ? dev_config->out_transfer_count : CDC_NCM_HOST_XFER_COUNT_DEFAULT,
+        .rx_task = {
+            .stack_size = dev_config->rx_task.stack_size,
+            .priority = dev_config->rx_task.priority,
+            .xCoreID = dev_config->rx_task.xCoreID,
+        },
+        .setup_cb = cdc_ncm_setup_cb,
+    };
+    cdc_acm_dev_hdl_t cdc_hdl;
+    ESP_GOTO_ON_ERROR(cdc_acm_host_open(vid, pid, interface_idx, &acm_config, &cdc_hdl), err, TAG, "Could not open network interface %d", interface_idx);
+    ESP_LOGI(TAG, "Opened %s device %02X:%02X:%02X:%02X:%02X:%02X", ncm->ncm ? "NCM" : "ECM",
+             ncm->mac[0], ncm->mac[1], ncm->mac[2], ncm->mac[3], ncm->mac[4], ncm->mac[5]);
+    *ncm_hdl_ret = ncm;
+    return ESP_OK;
+
+err:
+    if (ncm->tx.mux) {
+        vSemaphoreDelete(ncm->tx.mux);
+    }
+    free(ncm);
+    return ret;
+}
+
+esp_err_t cdc_ncm_host_close(cdc_ncm_dev_hdl_t ncm_hdl)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl, ESP_ERR_INVALID_ARG, TAG,);
+    cdc_ncm_dev_t *ncm = ncm_hdl;
+
+    // No OUT transfer callbacks after the device is closed, buffer of the NTB being filled is freed with it
+    xSemaphoreTake(ncm->tx.mux, portMAX_DELAY);
+    const esp_err_t ret = cdc_acm_host_close(ncm->cdc_hdl);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(ncm->tx.mux);
+        return ret;
+    }
+    vSemaphoreDelete(ncm->tx.mux);
+    free(ncm);
+    return ESP_OK;
+}
+
+esp_err_t cdc_ncm_host_send(cdc_ncm_dev_hdl_t ncm_hdl, const uint8_t *frame, size_t frame_len, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && frame && frame_len, ESP_ERR_INVALID_ARG, TAG,);
+    cdc_ncm_dev_t *ncm = ncm_hdl;
+
+    if (xSemaphoreTake(ncm->tx.mux, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret;
+    if (ncm->ncm) {
+        ret = cdc_ncm_tx_ntb_append(ncm, frame, frame_len, timeout_ms);
+    } else {
+        ret = cdc_ncm_tx_buffer_get(ncm, timeout_ms);
+        if (ret == ESP_OK) {
+            if (frame_len < ncm->tx.buf_size) { // Space for zero byte of short packet is left
+                memcpy(ncm->tx.buf, frame, frame_len);
+                ret = cdc_ncm_tx_commit(ncm, frame_len, 1);
+            } else {
+                ret = ESP_ERR_INVALID_SIZE; // The buffer stays borrowed for the next frame
+            }
+        }
+    }
+    cdc_ncm_tx_unlock(ncm);
+    return ret;
+}
+
+esp_err_t cdc_ncm_host_get_info(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_info_t *info)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && info, ESP_ERR_INVALID_ARG, TAG,);
+    cdc_ncm_dev_t *ncm = ncm_hdl;
+
+    CDC_NCM_ENTER_CRITICAL();
+    *info = ncm->counters;
+    info->link_up = ncm->link_up;
+    CDC_NCM_EXIT_CRITICAL();
+    info->ncm = ncm->ncm;
+    memcpy(info->mac, ncm->mac, sizeof(info->mac));
+    info->max_segment_size = ncm->max_segment_size;
+    info->ntb_in_size = ncm->ntb_in_size;
+    info->ntb_out_size = ncm->ntb_out_size;
+    info->ntb_out_max_datagrams = ncm->ncm ? ncm->ntb_layout.max_datagrams : 1;
+    return ESP_OK;
+}
+
+esp_err_t cdc_ncm_host_update_input_path(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_rx_cb_t rx_cb, cdc_ncm_host_event_cb_t event_cb, void *arg)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl, ESP_ERR_INVALID_ARG, TAG,);
+    cdc_ncm_dev_t *ncm = ncm_hdl;
+
+    CDC_NCM_ENTER_CRITICAL();
+    if (rx_cb) {
+        ncm->cb.rx_cb = rx_cb;
+        ncm->cb.event_cb = event_cb;
+        ncm->cb.arg = arg;
+    } else {
+        ncm->cb = ncm->user_cb;
+    }
+    CDC_NCM_EXIT_CRITICAL();
+    return ESP_OK;
+}
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_netif.h"
+#include "usb/cdc_ncm_host.h"
+#include "usb/cdc_ncm_host_netif.h"
+
+static const char *TAG = "cdc_ncm_netif";
+
+#define CDC_NCM_NETIF_TX_TIMEOUT_MS (100) // lwIP waits at most this long for a free OUT transfer, the frame is dropped then
+
+struct cdc_ncm_netif_glue_s {
+    esp_netif_driver_base_t base;         // Must be the first member, esp_netif passes it to post_attach
+    cdc_ncm_dev_hdl_t ncm_hdl;
+};
+
+static esp_err_t cdc_ncm_netif_transmit(void *handle, void *buffer, size_t len)
+{
+    struct cdc_ncm_netif_glue_s *glue = (struct cdc_ncm_netif_glue_s *)handle;
+    return cdc_ncm_host_send(glue->ncm_hdl, buffer, len, CDC_NCM_NETIF_TX_TIMEOUT_MS);
+}
+
+static void cdc_ncm_netif_free_rx_buffer(void *handle, void *buffer)
+{
+    (void)handle;
+    free(buffer);
+}
+
+static void cdc_ncm_netif_rx_cb(const uint8_t *frame, size_t frame_len, void *user_arg)
+{
+    struct cdc_ncm_netif_glue_s *glue = (struct cdc_ncm_netif_glue_s *)user_arg;
+    // The frame lives in the IN transfer, which is resubmitted after the callback. lwIP gets a copy and frees it with driver_free_rx_buffer
+    void *copy = malloc(frame_len);
+    if (copy == NULL) {
+        ESP_LOGD(TAG, "Out of memory, frame dropped");
+        return;
+    }
+    memcpy(copy, frame, frame_len);
+    esp_netif_receive(glue->base.netif, copy, frame_len, copy);
+}
+
+static void cdc_ncm_netif_event_cb(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_event_t event, void *user_arg)
+{
+    struct cdc_ncm_netif_glue_s *glue = (struct cdc_ncm_netif_glue_s *)user_arg;
+    switch (event) {
+    case CDC_NCM_HOST_LINK_UP:
+        esp_netif_action_connected(glue->base.netif, NULL, 0, NULL);
+        break;
+    case CDC_NCM_HOST_LINK_DOWN:
+    case CDC_NCM_HOST_DEVICE_DISCONNECTED:
+        esp_netif_action_disconnected(glue->base.netif, NULL, 0, NULL);
+        break;
+    default:
+        break;
+    }
+}
+
+static esp_err_t cdc_ncm_netif_post_attach(esp_netif_t *netif, void *args)
+{
+    struct cdc_ncm_netif_glue_s *glue = (struct cdc_ncm_netif_glue_s *)args;
+    glue->base.netif = netif;
+    const esp_netif_driver_ifconfig_t driver_ifconfig = {
+        .handle = glue,
+        .transmit = cdc_ncm_netif_transmit,
+        .driver_free_rx_buffer = cdc_ncm_netif_free_rx_buffer,
+    };
+    ESP_RETURN_ON_ERROR(esp_netif_set_driver_config(netif, &driver_ifconfig), TAG,);
+
+    cdc_ncm_host_info_t info;
+    ESP_RETURN_ON_ERROR(cdc_ncm_host_get_info(glue->ncm_hdl, &info), TAG,);
+    ESP_RETURN_ON_ERROR(esp_netif_set_mac(netif, info.mac), TAG, "Could not set MAC address");
+    esp_netif_action_start(netif, NULL, 0, NULL);
+    ESP_RETURN_ON_ERROR(cdc_ncm_host_update_input_path(glue->ncm_hdl, cdc_ncm_netif_rx_cb, cdc_ncm_netif_event_cb, glue), TAG,);
+
+    // The device could report its link before the glue was attached
+    cdc_ncm_host_get_info(glue->ncm_hdl, &info);
+    if (info.link_up) {
+        esp_netif_action_connected(netif, NULL, 0, NULL);
+    }
+    return ESP_OK;
+}
+
+cdc_ncm_host_netif_glue_handle_t cdc_ncm_host_new_netif_glue(cdc_ncm_dev_hdl_t ncm_hdl)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl, NULL, TAG, "Invalid device");
+    struct cdc_ncm_netif_glue_s *glue = calloc(1, sizeof(struct cdc_ncm_netif_glue_s));
+    ESP_RETURN_ON_FALSE(glue, NULL, TAG, "Out of memory");
+    glue->base.post_attach = cdc_ncm_netif_post_attach;
+    glue->ncm_hdl = ncm_hdl;
+    return glue;
+}
+
+esp_err_t cdc_ncm_host_del_netif_glue(cdc_ncm_host_netif_glue_handle_t glue)
+{
+    ESP_RETURN_ON_FALSE(glue, ESP_ERR_INVALID_ARG, TAG,);
+    cdc_ncm_host_update_input_path(glue->ncm_hdl, NULL, NULL, NULL);
+    if (glue->base.netif) {
+        esp_netif_action_stop(glue->base.netif, NULL, 0, NULL);
+    }
+    free(glue);
+    return ESP_OK;
+}
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "usb/usb_types_cdc_ncm.h"
+#include "cdc_ncm_ntb.h"
+
+#define CDC_NCM_NTB16_SIZE_MAX (0xFFFF) // wBlockLength of NTB-16
+#define CDC_NCM_NTB_NDPS_MAX   (8)      // NDPs of one received NTB, further NDPs are ignored
+#define CDC_NCM_ALIGN_MIN      (4)      // Minimal divisor and alignment, NTB structures are 32-bit aligned
+
+static inline bool cdc_ncm_is_pow2(uint16_t val)
+{
+    return (val & (val - 1)) == 0;
+}
+
+static inline size_t cdc_ncm_align_up(size_t offset, size_t align)
+{
+    return (offset + align - 1) & ~(align - 1);
+}
+
+void cdc_ncm_ntb_layout_init(uint16_t divisor, uint16_t remainder, uint16_t ndp_alignment, uint16_t max_datagrams, cdc_ncm_ntb_layout_t *layout)
+{
+    layout->divisor = (divisor >= CDC_NCM_ALIGN_MIN && cdc_ncm_is_pow2(divisor)) ? divisor : CDC_NCM_ALIGN_MIN;
+    layout->remainder = remainder & (layout->divisor - 1);
+    layout->ndp_alignment = (ndp_alignment >= CDC_NCM_ALIGN_MIN && cdc_ncm_is_pow2(ndp_alignment)) ? ndp_alignment : CDC_NCM_ALIGN_MIN;
+    layout->max_datagrams = (max_datagrams == 0 || max_datagrams > CDC_NCM_NTB_DATAGRAMS_MAX) ? CDC_NCM_NTB_DATAGRAMS_MAX : max_datagrams;
+}
+
+void cdc_ncm_ntb_tx_init(cdc_ncm_ntb_tx_t *ntb, uint8_t *buf, size_t size, const cdc_ncm_ntb_layout_t *layout)
+{
+    ntb->buf = buf;
+    ntb->size = size > CDC_NCM_NTB16_SIZE_MAX ? CDC_NCM_NTB16_SIZE_MAX : size;
+    ntb->offset = sizeof(cdc_ncm_nth16_t);
+    ntb->count = 0;
+    ntb->layout = *layout;
+}
+
+bool cdc_ncm_ntb_tx_append(cdc_ncm_ntb_tx_t *ntb, const uint8_t *data, size_t len)
+{
+    if (len == 0 || cdc_ncm_ntb_tx_is_full(ntb)) {
+        return false;
+    }
+
+    // Datagram starts at offset of remainder modulo divisor, so its payload is aligned as the device requires
+    const size_t start = cdc_ncm_align_up(ntb->offset - ntb->layout.remainder, ntb->layout.divisor) + ntb->layout.remainder;
+    const size_t end = start + len;
+    // NDP behind the datagrams has one more entry for this datagram and the terminating entry
+    const size_t ndp = cdc_ncm_align_up(end, ntb->layout.ndp_alignment);
+    const size_t ntb_len = ndp + sizeof(cdc_ncm_ndp16_t) + (ntb->count + 2) * sizeof(cdc_ncm_dpe16_t);
+    if (ntb_len > ntb->size) {
+        return false;
+    }
+
+    memset(ntb->buf + ntb->offset, 0, start - ntb->offset);
+    memcpy(ntb->buf + start, data, len);
+    ntb->index[ntb->count] = start;
+    ntb->length[ntb->count] = len;
+    ntb->count++;
+    ntb->offset = end;
+    return true;
+}
+
+size_t cdc_ncm_ntb_tx_finish(cdc_ncm_ntb_tx_t *ntb, uint16_t sequence)
+{
+    const size_t ndp_offset = cdc_ncm_align_up(ntb->offset, ntb->layout.ndp_alignment);
+    memset(ntb->buf + ntb->offset, 0, ndp_offset - ntb->offset);
+
+    cdc_ncm_ndp16_t *ndp = (cdc_ncm_ndp16_t *)(ntb->buf + ndp_offset);
+    ndp->dwSignature = USB_CDC_NCM_NDP16_NOCRC_SIGNATURE;
+    ndp->wLength = sizeof(cdc_ncm_ndp16_t) + (ntb->count + 1) * sizeof(cdc_ncm_dpe16_t);
+    ndp->wNextNdpIndex = 0;
+    for (int i = 0; i < ntb->count; i++) {
+        ndp->datagram[i].wDatagramIndex = ntb->index[i];
+        ndp->datagram[i].wDatagramLength = ntb->length[i];
+    }
+    ndp->datagram[ntb->count].wDatagramIndex = 0;
+    ndp->datagram[ntb->count].wDatagramLength = 0;
+
+    const size_t ntb_len = ndp_offset + ndp->wLength;
+    cdc_ncm_nth16_t *nth = (cdc_ncm_nth16_t *)ntb->buf;
+    nth->dwSignature = USB_CDC_NCM_NTH16_SIGNATURE;
+    nth->wHeaderLength = sizeof(cdc_ncm_nth16_t);
+    nth->wSequence = sequence;
+    nth->wBlockLength = ntb_len;
+    nth->wNdpIndex = ndp_offset;
+    return ntb_len;
+}
+
+int cdc_ncm_ntb_rx_parse(const uint8_t *buf, size_t len, cdc_ncm_ntb_datagram_cb_t cb, void *arg)
+{
+    if (len < sizeof(cdc_ncm_nth16_t)) {
+        return -1;
+    }
+    const cdc_ncm_nth16_t *nth = (const cdc_ncm_nth16_t *)buf;
+    if (nth->dwSignature != USB_CDC_NCM_NTH16_SIGNATURE || nth->wHeaderLength != sizeof(cdc_ncm_nth16_t) || nth->wBlockLength > len) {
+        return -1;
+    }
+    const size_t block_len = nth->wBlockLength ? nth->wBlockLength : len;
+
+    int count = 0;
+    size_t ndp_index = nth->wNdpIndex;
+    for (int i = 0; ndp_index != 0 && i < CDC_NCM_NTB_NDPS_MAX; i++) {
+        if ((ndp_index % CDC_NCM_ALIGN_MIN) || (ndp_index + sizeof(cdc_ncm_ndp16_t) > block_len)) {
+            return -1;
+        }
+        const cdc_ncm_ndp16_t *ndp = (const cdc_ncm_ndp16_t *)(buf + ndp_index);
+        if (ndp->dwSignature != USB_CDC_NCM_NDP16_NOCRC_SIGNATURE || ndp->wLength < sizeof(cdc_ncm_ndp16_t) + 2 * sizeof(cdc_ncm_dpe16_t) ||
+                (ndp->wLength % CDC_NCM_ALIGN_MIN) || (ndp_index + ndp->wLength > block_len)) {
+            return -1;
+        }
+
+        const size_t entries = (ndp->wLength - sizeof(cdc_ncm_ndp16_t)) / sizeof(cdc_ncm_dpe16_t);
+        for (size_t j = 0; j < entries; j++) {
+            const size_t index = ndp->datagram[j].wDatagramIndex;
+            const size_t length = ndp->datagram[j].wDatagramLength;
+            if (index == 0 || length == 0) {
+                break;
+            }
+            if (index + length > block_len) {
+                continue;
+            }
+            cb(buf + index, length, arg);
+            count++;
+        }
+        ndp_index = ndp->wNextNdpIndex;
+    }
+    return count;
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_types_cdc_ncm.h"
+#include "cdc_ncm_ntb.h"
+
+struct received_t {
+    std::vector<std::vector<uint8_t>> datagrams;
+    std::vector<size_t> offsets;
+    const uint8_t *base;
+};
+
+static void datagram_cb(const uint8_t *datagram, size_t len, void *arg)
+{
+    received_t *rx = (received_t *)arg;
+    rx->datagrams.emplace_back(datagram, datagram + len);
+    rx->offsets.push_back(datagram - rx->base);
+}
+
+static std::vector<uint8_t> make_frame(size_t len, uint8_t seed)
+{
+    std::vector<uint8_t> frame(len);
+    for (size_t i = 0; i < len; i++) {
+        frame[i] = (uint8_t)(seed + i);
+    }
+    return frame;
+}
+
+SCENARIO("NTB-16 aggregation and parsing")
+{
+    alignas(4) static uint8_t buf[4096];
+    cdc_ncm_ntb_layout_t layout;
+    cdc_ncm_ntb_tx_t ntb;
+
+    GIVEN("Device requiring datagrams at offset 2 modulo 16") {
+        cdc_ncm_ntb_layout_init(16, 2, 8, 0, &layout);
+        cdc_ncm_ntb_tx_init(&ntb, buf, sizeof(buf), &layout);
+        const std::vector<uint8_t> frames[] = {make_frame(60, 1), make_frame(1514, 2), make_frame(97, 3)};
+        for (const auto &frame : frames) {
+            REQUIRE(cdc_ncm_ntb_tx_append(&ntb, frame.data(), frame.size()));
+        }
+
+        THEN("Parsed NTB contains the same datagrams at the required offsets") {
+            const size_t len = cdc_ncm_ntb_tx_finish(&ntb, 7);
+            REQUIRE(len <= sizeof(buf));
+            const cdc_ncm_nth16_t *nth = (const cdc_ncm_nth16_t *)buf;
+            REQUIRE(nth->wSequence == 7);
+            REQUIRE(nth->wBlockLength == len);
+            REQUIRE(nth->wNdpIndex % 8 == 0);
+
+            received_t rx;
+            rx.base = buf;
+            REQUIRE(cdc_ncm_ntb_rx_parse(buf, len, datagram_cb, &rx) == 3);
+            for (int i = 0; i < 3; i++) {
+                REQUIRE(rx.datagrams[i] == frames[i]);
+                REQUIRE(rx.offsets[i] % 16 == 2);
+            }
+        }
+    }
+
+    GIVEN("Invalid layout from the device") {
+        cdc_ncm_ntb_layout_init(3, 7, 0, 1000, &layout);
+        THEN("Layout falls back to 32-bit alignment") {
+            REQUIRE(layout.divisor == 4);
+            REQUIRE(layout.remainder == 3);
+            REQUIRE(layout.ndp_alignment == 4);
+            REQUIRE(layout.max_datagrams == CDC_NCM_NTB_DATAGRAMS_MAX);
+        }
+    }
+
+    GIVEN("NTB limited to 2 datagrams") {
+        cdc_ncm_ntb_layout_init(4, 0, 4, 2, &layout);
+        cdc_ncm_ntb_tx_init(&ntb, buf, sizeof(buf), &layout);
+        const auto frame = make_frame(100, 0);
+        REQUIRE(cdc_ncm_ntb_tx_append(&ntb, frame.data(), frame.size()));
+        REQUIRE_FALSE(cdc_ncm_ntb_tx_is_full(&ntb));
+        REQUIRE(cdc_ncm_ntb_tx_append(&ntb, frame.data(), frame.size()));
+        THEN("Third datagram is refused") {
+            REQUIRE(cdc_ncm_ntb_tx_is_full(&ntb));
+            REQUIRE_FALSE(cdc_ncm_ntb_tx_append(&ntb, frame.data(), frame.size()));
+        }
+    }
+
+    GIVEN("Datagram bigger than the NTB") {
+        cdc_ncm_ntb_layout_init(4, 0, 4, 0, &layout);
+        cdc_ncm_ntb_tx_init(&ntb, buf, 1024, &layout);
+        const auto frame = make_frame(1514, 0);
+        THEN("Datagram is refused") {
+            REQUIRE_FALSE(cdc_ncm_ntb_tx_append(&ntb, frame.data(), frame.size()));
+            REQUIRE(ntb.count == 0);
+        }
+    }
+
+    GIVEN("Valid NTB with one datagram") {
+        cdc_ncm_ntb_layout_init(4, 0, 4, 0, &layout);
+        cdc_ncm_ntb_tx_init(&ntb, buf, sizeof(buf), &layout);
+        const auto frame = make_frame(64, 0);
+        REQUIRE(cdc_ncm_ntb_tx_append(&ntb, frame.data(), frame.size()));
+        const size_t len = cdc_ncm_ntb_tx_finish(&ntb, 0);
+        received_t rx;
+        rx.base = buf;
+        cdc_ncm_nth16_t *nth = (cdc_ncm_nth16_t *)buf;
+
+        THEN("Truncated NTB is malformed") {
+            REQUIRE(cdc_ncm_ntb_rx_parse(buf, len - 1, datagram_cb, &rx) == -1);
+        }
+        THEN("NTB with wrong signature is malformed") {
+            nth->dwSignature = 0;
+            REQUIRE(cdc_ncm_ntb_rx_parse(buf, len, datagram_cb, &rx) == -1);
+        }
+        THEN("NTB with NDP outside of the block is malformed") {
+            nth->wNdpIndex = len;
+            REQUIRE(cdc_ncm_ntb_rx_parse(buf, len, datagram_cb, &rx) == -1);
+        }
+        THEN("Datagram outside of the block is skipped") {
+            cdc_ncm_ndp16_t *ndp = (cdc_ncm_ndp16_t *)(buf + nth->wNdpIndex);
+            ndp->datagram[0].wDatagramLength = len;
+            REQUIRE(cdc_ncm_ntb_rx_parse(buf, len, datagram_cb, &rx) == 0);
+            REQUIRE(rx.datagrams.empty());
+        }
+    }
+}
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_types_cdc_ncm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CDC_NCM_HOST_NTB_IN_SIZE_DEFAULT  (8192) // NTBs received from the device
+#define CDC_NCM_HOST_NTB_OUT_SIZE_DEFAULT (4096) // NTBs sent to the device
+#define CDC_NCM_HOST_XFER_COUNT_DEFAULT   (2)    // Bulk IN and OUT transfers in flight
+#define CDC_NCM_HOST_FRAME_SIZE_MAX       (1514) // Ethernet frame without FCS
+
+typedef struct cdc_ncm_dev_s *cdc_ncm_dev_hdl_t;
+
+/**
+ * @brief CDC-NCM/ECM device event types
+ */
+typedef enum {
+    CDC_NCM_HOST_LINK_UP,             /**< Device reported connected network */
+    CDC_NCM_HOST_LINK_DOWN,           /**< Device reported disconnected network */
+    CDC_NCM_HOST_DEVICE_DISCONNECTED, /**< USB device was disconnected, close the handle */
+} cdc_ncm_host_event_t;
+
+/**
+ * @brief Received Ethernet frame callback type
+ *
+ * Called from the task of the CDC-ACM driver or from the RX task of the device.
+ *
+ * @param[in] frame     Ethernet frame, valid only during the callback
+ * @param[in] frame_len Length of the frame
+ * @param[in] user_arg  User's argument
+ */
+typedef void (*cdc_ncm_host_rx_cb_t)(const uint8_t *frame, size_t frame_len, void *user_arg);
+
+/**
+ * @brief Device event callback type
+ *
+ * @param[in] ncm_hdl  Device handle
+ * @param[in] event    Event
+ * @param[in] user_arg User's argument
+ */
+typedef void (*cdc_ncm_host_event_cb_t)(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_event_t event, void *user_arg);
+
+/**
+ * @brief Configuration structure of CDC-NCM/ECM device
+ *
+ * ECM devices use the same transfer sizes, each IN transfer carries one Ethernet frame.
+ */
+typedef struct {
+    uint32_t connection_timeout_ms;  /**< Timeout for USB device connection in [ms] */
+    size_t ntb_in_size;              /**< Size of NTBs received from the device, set by SetNtbInputSize. 0 for CDC_NCM_HOST_NTB_IN_SIZE_DEFAULT */
+    size_t ntb_out_size;             /**< Maximum size of NTBs sent to the device, limited by dwNtbOutMaxSize of the device.
+                                          0 for CDC_NCM_HOST_NTB_OUT_SIZE_DEFAULT */
+    size_t in_transfer_count;        /**< Bulk IN transfers in flight, so the device can send the next NTB while one is parsed.
+                                          0 for CDC_NCM_HOST_XFER_COUNT_DEFAULT */
+    size_t out_transfer_count;       /**< Bulk OUT transfers. Frames are aggregated into one NTB while other NTBs are in flight.
+                                          0 for CDC_NCM_HOST_XFER_COUNT_DEFAULT, 1 disables aggregation */
+    cdc_ncm_host_rx_cb_t rx_cb;      /**< Received Ethernet frame callback. Can be NULL */
+    cdc_ncm_host_event_cb_t event_cb;/**< Device event callback. Can be NULL */
+    void *user_arg;                  /**< User's argument that will be passed to the callbacks */
+    struct {
+        size_t stack_size;           /**< Stack size of the device's RX task, which parses NTBs and calls rx_cb. Set to 0 to use the driver's task */
+        unsigned priority;           /**< Priority of the device's RX task */
+        int xCoreID;                 /**< Core affinity of the device's RX task */
+    } rx_task;                       /**< RX task of the device, see cdc_acm_host_device_config_t */
+} cdc_ncm_host_device_config_t;
+
+/**
+ * @brief Device information and counters
+ */
+typedef struct {
+    bool ncm;                        /**< Device uses NCM with NTBs, otherwise ECM with one frame per transfer */
+    bool link_up;                    /**< Last network connection state reported by the device */
+    uint8_t mac[6];                  /**< MAC address of the device from its Ethernet Networking Functional Descriptor */
+    uint16_t max_segment_size;       /**< Maximum Ethernet frame the device accepts */
+    size_t ntb_in_size;              /**< Size of received NTBs */
+    size_t ntb_out_size;             /**< Maximum size of sent NTBs */
+    uint16_t ntb_out_max_datagrams;  /**< Maximum number of frames aggregated into one sent NTB */
+    uint32_t rx_frames;              /**< Received frames */
+    uint32_t rx_transfers;           /**< Received NTBs or ECM frames */
+    uint32_t rx_errors;              /**< Malformed NTBs */
+    uint32_t tx_frames;              /**< Sent frames */
+    uint32_t tx_transfers;           /**< Sent NTBs or ECM frames */
+    uint32_t tx_errors;              /**< Failed OUT transfers */
+} cdc_ncm_host_info_t;
+
+/**
+ * @brief Open CDC-NCM or CDC-ECM device
+ *
+ * The device is opened with the CDC-ACM driver, which must be installed with cdc_acm_host_install() before.
+ * NCM is selected if the interface has NCM Functional Descriptor. NTB sizes are negotiated before the data interface is claimed.
+ *
+ * @param[in]  vid           Device's Vendor ID, set to CDC_HOST_ANY_VID for any
+ * @param[in]  pid           Device's Product ID, set to CDC_HOST_ANY_PID for any
+ * @param[in]  interface_idx Index of Communication interface of the network function
+ * @param[in]  dev_config    Configuration structure of the device
+ * @param[out] ncm_hdl_ret   Device handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: dev_config or ncm_hdl_ret is NULL
+ *   - ESP_ERR_NOT_SUPPORTED: The interface is not CDC-NCM nor CDC-ECM, or does not support NTB-16
+ *   - ESP_ERR_NO_MEM: Not enough memory for opening the device
+ *   - Other errors of cdc_acm_host_open()
+ */
+esp_err_t cdc_ncm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_ncm_host_device_config_t *dev_config, cdc_ncm_dev_hdl_t *ncm_hdl_ret);
+
+/**
+ * @brief Close CDC-NCM/ECM device
+ *
+ * Frames waiting for aggregation are dropped.
+ *
+ * @param[in] ncm_hdl Device handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: ncm_hdl is NULL
+ */
+esp_err_t cdc_ncm_host_close(cdc_ncm_dev_hdl_t ncm_hdl);
+
+/**
+ * @brief Send Ethernet frame
+ *
+ * The frame is copied into the NTB being filled. The NTB is sent at once if no other NTB is in flight,
+ * otherwise when the next OUT transfer completes or the NTB is full. Consecutive frames are thus aggregated
+ * only while the bus is busy, so idle links do not add latency.
+ * ECM devices get each frame in its own transfer.
+ *
+ * @param[in] ncm_hdl    Device handle
+ * @param[in] frame      Ethernet frame without FCS
+ * @param[in] frame_len  Length of the frame, up to CDC_NCM_HOST_FRAME_SIZE_MAX
+ * @param[in] timeout_ms Time to wait for a free OUT transfer in [ms]
+ * @return
+ *   - ESP_OK: Frame queued
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ *   - ESP_ERR_INVALID_SIZE: Frame does not fit into an NTB
+ *   - ESP_ERR_TIMEOUT: All OUT transfers are in flight
+ */
+esp_err_t cdc_ncm_host_send(cdc_ncm_dev_hdl_t ncm_hdl, const uint8_t *frame, size_t frame_len, uint32_t timeout_ms);
+
+/**
+ * @brief Get device information and counters
+ *
+ * @param[in]  ncm_hdl Device handle
+ * @param[out] info    Information
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ */
+esp_err_t cdc_ncm_host_get_info(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_info_t *info);
+
+/**
+ * @brief Redirect received frames and events
+ *
+ * Frames and events are delivered to the given callbacks instead of those of cdc_ncm_host_device_config_t.
+ * Used by network stack glue, see usb/cdc_ncm_host_netif.h.
+ *
+ * @param[in] ncm_hdl  Device handle
+ * @param[in] rx_cb    Received Ethernet frame callback, NULL to restore callbacks of the device config
+ * @param[in] event_cb Device event callback
+ * @param[in] arg      Argument of the callbacks
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: ncm_hdl is NULL
+ */
+esp_err_t cdc_ncm_host_update_input_path(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_rx_cb_t rx_cb, cdc_ncm_host_event_cb_t event_cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_netif.h"
+#include "usb/cdc_ncm_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Glue between CDC-NCM/ECM device and esp_netif
+ */
+typedef struct cdc_ncm_netif_glue_s *cdc_ncm_host_netif_glue_handle_t;
+
+/**
+ * @brief Create glue of an opened device
+ *
+ * Attach the glue to Ethernet-like netif with esp_netif_attach(). On attach, received frames and link events of the device
+ * are redirected to the netif, MAC address of the netif is set to the MAC address of the device and the netif is started.
+ * Link up and down events of the device connect and disconnect the netif, e.g. start and stop its DHCP client.
+ *
+ * @code{c}
+ * esp_netif_config_t cfg = ESP_NETIF_DEFAULT_ETH();
+ * esp_netif_t *netif = esp_netif_new(&cfg);
+ * esp_netif_attach(netif, cdc_ncm_host_new_netif_glue(ncm_hdl));
+ * @endcode
+ *
+ * @param[in] ncm_hdl Device handle obtained from cdc_ncm_host_open()
+ * @return Glue handle, NULL if out of memory
+ */
+cdc_ncm_host_netif_glue_handle_t cdc_ncm_host_new_netif_glue(cdc_ncm_dev_hdl_t ncm_hdl);
+
+/**
+ * @brief Stop the netif and delete the glue
+ *
+ * Frames and events of the device are delivered to callbacks of its device config again.
+ * Call before cdc_ncm_host_close() and esp_netif_destroy().
+ *
+ * @param[in] glue Glue handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: glue is NULL
+ */
+esp_err_t cdc_ncm_host_del_netif_glue(cdc_ncm_host_netif_glue_handle_t glue);
+
+#ifdef __cplusplus
+}
+#endif
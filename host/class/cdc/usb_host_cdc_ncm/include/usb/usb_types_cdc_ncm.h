@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <inttypes.h>
+
+#define USB_CDC_NCM_NTH16_SIGNATURE      0x484D434E // "NCMH"
+#define USB_CDC_NCM_NDP16_NOCRC_SIGNATURE 0x304D434E // "NCM0"
+#define USB_CDC_NCM_NDP16_CRC_SIGNATURE  0x314D434E // "NCM1"
+
+#define USB_CDC_NCM_NTB16_SUPPORTED      (1 << 0)   // bmNtbFormatsSupported: NTB-16 format
+#define USB_CDC_NCM_NTB32_SUPPORTED      (1 << 1)   // bmNtbFormatsSupported: NTB-32 format
+
+/**
+ * @brief Ethernet packet filter bitmap of SetEthernetPacketFilter request
+ *
+ * @see Table 8, USB CDC-ECM specification rev. 1.2
+ */
+#define USB_CDC_ETH_PACKET_TYPE_PROMISCUOUS   (1 << 0)
+#define USB_CDC_ETH_PACKET_TYPE_ALL_MULTICAST (1 << 1)
+#define USB_CDC_ETH_PACKET_TYPE_DIRECTED      (1 << 2)
+#define USB_CDC_ETH_PACKET_TYPE_BROADCAST     (1 << 3)
+#define USB_CDC_ETH_PACKET_TYPE_MULTICAST     (1 << 4)
+
+/**
+ * @brief USB CDC Ethernet Networking Functional Descriptor
+ *
+ * @see Table 3, USB CDC-ECM specification rev. 1.2
+ */
+typedef struct {
+    uint8_t bFunctionLength;
+    const uint8_t bDescriptorType;
+    const uint8_t bDescriptorSubtype;
+    uint8_t iMACAddress;           // Index of string descriptor with the MAC address as 12 hexadecimal digits
+    uint32_t bmEthernetStatistics; // Ethernet statistics collected by the device
+    uint16_t wMaxSegmentSize;      // Maximum segment size of the device, typically 1514 bytes
+    uint16_t wNumberMCFilters;     // Number of multicast filters
+    uint8_t bNumberPowerFilters;   // Number of pattern filters for host wake-up
+} __attribute__((packed)) cdc_eth_desc_t;
+
+/**
+ * @brief USB CDC NCM Functional Descriptor
+ *
+ * @see Table 5-2, USB CDC-NCM specification rev. 1.0
+ */
+typedef struct {
+    uint8_t bFunctionLength;
+    const uint8_t bDescriptorType;
+    const uint8_t bDescriptorSubtype;
+    uint16_t bcdNcmVersion;
+    uint8_t bmNetworkCapabilities; // Optional requests supported by the device
+} __attribute__((packed)) cdc_ncm_desc_t;
+
+/**
+ * @brief NTB Parameter Structure, response to GetNtbParameters request
+ *
+ * @see Table 6-3, USB CDC-NCM specification rev. 1.0
+ */
+typedef struct {
+    uint16_t wLength;
+    uint16_t bmNtbFormatsSupported;  // USB_CDC_NCM_NTB16_SUPPORTED, USB_CDC_NCM_NTB32_SUPPORTED
+    uint32_t dwNtbInMaxSize;         // Maximum size of NTB the device sends
+    uint16_t wNdpInDivisor;
+    uint16_t wNdpInPayloadRemainder;
+    uint16_t wNdpInAlignment;
+    uint16_t wReserved;
+    uint32_t dwNtbOutMaxSize;        // Maximum size of NTB the device accepts
+    uint16_t wNdpOutDivisor;         // Datagrams sent to the device start at offset of wNdpOutPayloadRemainder modulo wNdpOutDivisor
+    uint16_t wNdpOutPayloadRemainder;
+    uint16_t wNdpOutAlignment;       // Alignment of NDP sent to the device
+    uint16_t wNtbOutMaxDatagrams;    // Maximum number of datagrams in NTB sent to the device, 0 for no limit
+} __attribute__((packed)) cdc_ncm_ntb_parameters_t;
+
+/**
+ * @brief NCM Transfer Header, 16-bit
+ *
+ * @see Table 3-1, USB CDC-NCM specification rev. 1.0
+ */
+typedef struct {
+    uint32_t dwSignature;  // USB_CDC_NCM_NTH16_SIGNATURE
+    uint16_t wHeaderLength;
+    uint16_t wSequence;
+    uint16_t wBlockLength; // Length of the NTB
+    uint16_t wNdpIndex;    // Offset of the first NDP
+} __attribute__((packed)) cdc_ncm_nth16_t;
+
+/**
+ * @brief Datagram pointer of NCM Datagram Pointer Table, 16-bit
+ */
+typedef struct {
+    uint16_t wDatagramIndex;  // Offset of the datagram in the NTB, 0 terminates the table
+    uint16_t wDatagramLength; // Length of the datagram, 0 terminates the table
+} __attribute__((packed)) cdc_ncm_dpe16_t;
+
+/**
+ * @brief NCM Datagram Pointer Table, 16-bit
+ *
+ * @see Table 3-3, USB CDC-NCM specification rev. 1.0
+ */
+typedef struct {
+    uint32_t dwSignature;     // USB_CDC_NCM_NDP16_NOCRC_SIGNATURE or USB_CDC_NCM_NDP16_CRC_SIGNATURE
+    uint16_t wLength;         // Length of the NDP, multiple of 4 and at least 16
+    uint16_t wNextNdpIndex;   // Offset of the next NDP, 0 for the last one
+    cdc_ncm_dpe16_t datagram[];
+} __attribute__((packed)) cdc_ncm_ndp16_t;
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CDC_NCM_NTB_DATAGRAMS_MAX (32) // Datagrams aggregated into one NTB, each costs 4 bytes of the NDP
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Layout of NTBs sent to the device, from its NTB Parameter Structure
+typedef struct {
+    uint16_t divisor;          // Datagrams start at offset of remainder modulo divisor
+    uint16_t remainder;
+    uint16_t ndp_alignment;    // Alignment of the NDP
+    uint16_t max_datagrams;    // Datagrams per NTB, at most CDC_NCM_NTB_DATAGRAMS_MAX
+} cdc_ncm_ntb_layout_t;
+
+// NTB-16 being filled with datagrams. Datagrams are placed behind the NTH, the NDP is written behind them by cdc_ncm_ntb_tx_finish()
+typedef struct {
+    uint8_t *buf;              // Buffer of the NTB
+    size_t size;               // Size of the NTB, at most 65535 bytes
+    size_t offset;             // End of the last datagram
+    uint16_t count;            // Number of datagrams
+    cdc_ncm_ntb_layout_t layout;
+    uint16_t index[CDC_NCM_NTB_DATAGRAMS_MAX];
+    uint16_t length[CDC_NCM_NTB_DATAGRAMS_MAX];
+} cdc_ncm_ntb_tx_t;
+
+/**
+ * @brief Datagram callback of cdc_ncm_ntb_rx_parse()
+ *
+ * @param[in] datagram Datagram, valid only during the callback
+ * @param[in] len      Length of the datagram
+ * @param[in] arg      Argument passed to cdc_ncm_ntb_rx_parse()
+ */
+typedef void (*cdc_ncm_ntb_datagram_cb_t)(const uint8_t *datagram, size_t len, void *arg);
+
+/**
+ * @brief Sanitize layout from NTB Parameter Structure of the device
+ *
+ * Divisor and alignment that are not powers of 2 of at least 4 are replaced by 4, remainder is taken modulo divisor.
+ *
+ * @param[in]  divisor        wNdpOutDivisor
+ * @param[in]  remainder      wNdpOutPayloadRemainder
+ * @param[in]  ndp_alignment  wNdpOutAlignment
+ * @param[in]  max_datagrams  wNtbOutMaxDatagrams, 0 for no limit
+ * @param[out] layout         Layout for cdc_ncm_ntb_tx_init()
+ */
+void cdc_ncm_ntb_layout_init(uint16_t divisor, uint16_t remainder, uint16_t ndp_alignment, uint16_t max_datagrams, cdc_ncm_ntb_layout_t *layout);
+
+/**
+ * @brief Start a new NTB
+ *
+ * @param[out] ntb    NTB
+ * @param[in]  buf    Buffer of the NTB
+ * @param[in]  size   Size of the buffer, limited to 65535 bytes of NTB-16
+ * @param[in]  layout Layout of NTBs accepted by the device
+ */
+void cdc_ncm_ntb_tx_init(cdc_ncm_ntb_tx_t *ntb, uint8_t *buf, size_t size, const cdc_ncm_ntb_layout_t *layout);
+
+/**
+ * @brief Append a datagram
+ *
+ * @param[inout] ntb  NTB
+ * @param[in]    data Datagram
+ * @param[in]    len  Length of the datagram
+ * @return true if appended, false if the NTB is full
+ */
+bool cdc_ncm_ntb_tx_append(cdc_ncm_ntb_tx_t *ntb, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check whether no further datagram can be appended because of datagram limit
+ */
+static inline bool cdc_ncm_ntb_tx_is_full(const cdc_ncm_ntb_tx_t *ntb)
+{
+    return ntb->count >= ntb->layout.max_datagrams;
+}
+
+/**
+ * @brief Write NTH and NDP of the NTB
+ *
+ * @param[inout] ntb      NTB with at least one datagram
+ * @param[in]    sequence wSequence of the NTH
+ * @return Length of the NTB
+ */
+size_t cdc_ncm_ntb_tx_finish(cdc_ncm_ntb_tx_t *ntb, uint16_t sequence);
+
+/**
+ * @brief Parse NTB-16 received from the device
+ *
+ * Datagrams of all NDPs are passed to the callback in order. Datagrams pointing out of the NTB are skipped.
+ *
+ * @param[in] buf Received NTB
+ * @param[in] len Length of the received NTB
+ * @param[in] cb  Datagram callback
+ * @param[in] arg Argument of the callback
+ * @return Number of datagrams passed to the callback, -1 if the NTB is malformed
+ */
+int cdc_ncm_ntb_rx_parse(const uint8_t *buf, size_t len, cdc_ncm_ntb_datagram_cb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
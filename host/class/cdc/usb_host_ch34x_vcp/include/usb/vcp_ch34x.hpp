@@ -16,6 +16,9 @@
 #define CH340_PID                  (0x7522)
 #define CH340_PID_1                (0x7523)
 #define CH341_PID                  (0x5523)
+#define CH343_PID                  (0x55D3)
+#define CH9102_PID                 (0x55D4)
+#define CH9101_PID                 (0x55D8)
 
 namespace esp_usb {
 class CH34x : public CdcAcmDevice {
@@ -24,6 +27,8 @@ public:
      * @brief Constructor for this CH34x driver
      *
      * @note USB Host library and CDC-ACM driver must be already installed
+     * @note High-speed variants (CH343, CH9102, CH9101) get larger IN transfers if in_buffer_size and in_transfer_count
+     *       of dev_config are 0, so the IN endpoint keeps up with their maximum baud rate
      *
      * @param[in] pid            PID eg. CH340_PID
      * @param[in] dev_config     CDC device configuration
@@ -52,12 +57,23 @@ public:
      */
     esp_err_t set_control_line_state(bool dtr, bool rts);
 
+    /**
+     * @brief Get maximum baud rate of the chip
+     *
+     * @return 6 Mbaud for CH343, CH9102 and CH9101, 2 Mbaud for CH340 and CH341
+     */
+    uint32_t max_baud_rate() const
+    {
+        return this->high_speed ? 6000000 : 2000000;
+    }
+
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = NANJING_QINHENG_MICROE_VID;
-    static constexpr std::array<uint16_t, 3> pids = {CH340_PID, CH340_PID_1, CH341_PID};
+    static constexpr std::array<uint16_t, 6> pids = {CH340_PID, CH340_PID_1, CH341_PID, CH343_PID, CH9102_PID, CH9101_PID};
 
 private:
     const uint8_t intf;
+    const bool high_speed; // CH343, CH9102 and CH9101 have 12 MHz baud rate clock and larger FIFOs
 
     // Make open functions from CdcAcmDevice class private
     using CdcAcmDevice::open;
@@ -66,6 +82,13 @@ private:
     using CdcAcmDevice::line_coding_get; // Manufacturer doesn't provide enough information to implement this
 
     // This function comes from official Linux driver
-    static int calculate_baud_divisor(unsigned int baud_rate, unsigned char *factor, unsigned char *divisor);
+    // High-speed variants use 12 MHz clock for all baud rates above 47058 baud, up to 6 Mbaud
+    static int calculate_baud_divisor(unsigned int baud_rate, bool high_speed, unsigned char *factor, unsigned char *divisor);
+
+    // Variant detection from PID, the high-speed variants share PIDs with no classic part
+    static constexpr bool is_high_speed(uint16_t pid)
+    {
+        return pid == CH343_PID || pid == CH9102_PID || pid == CH9101_PID;
+    }
 };
 } // namespace esp_usb
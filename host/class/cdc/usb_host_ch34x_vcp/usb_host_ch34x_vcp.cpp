@@ -48,6 +48,12 @@
 //CH34x Baud Rate
 #define CH34x_BAUDRATE_FACTOR 1532620800
 #define CH34x_BAUDRATE_DIVMAX 3
+#define CH34x_CLOCK_HIGH_SPEED 12000000 // Divisor 7: prescaler 3 with doubled clock, used for all rates by high-speed variants
+#define CH34x_DIVISOR_HIGH_SPEED 7
+
+// IN transfers of high-speed variants, 6 Mbaud deliver 600 bytes per 1 ms frame
+#define CH34x_HIGH_SPEED_IN_BUFFER_SIZE   (1024)
+#define CH34x_HIGH_SPEED_IN_TRANSFER_COUNT (2)
 
 // Line Coding Register (LCR)
 #define CH34x_REG_LCR          0x18
@@ -66,9 +72,20 @@ static const char *TAG = "CH34X";
 
 namespace esp_usb {
 CH34x::CH34x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
-    : intf(interface_idx)
+    : intf(interface_idx), high_speed(is_high_speed(pid))
 {
-    const esp_err_t err = this->open_vendor_specific(vid, pid, this->intf, dev_config);
+    this->partial_line_coding = true;
+    cdc_acm_host_device_config_t config = *dev_config;
+    if (this->high_speed && config.data_cb) {
+        // Single IN transfer of one packet cannot keep up with 6 Mbaud, the chip FIFO overflows
+        if (config.in_buffer_size == 0) {
+            config.in_buffer_size = CH34x_HIGH_SPEED_IN_BUFFER_SIZE;
+        }
+        if (config.in_transfer_count == 0) {
+            config.in_transfer_count = CH34x_HIGH_SPEED_IN_TRANSFER_COUNT;
+        }
+    }
+    const esp_err_t err = this->open_vendor_specific(vid, pid, this->intf, &config);
     if (err != ESP_OK) {
         throw (err);
     }
@@ -81,7 +98,7 @@ esp_err_t CH34x::line_coding_set(cdc_acm_line_coding_t *line_coding)
     // Baudrate
     if (line_coding->dwDTERate != 0) {
         uint8_t factor, divisor;
-        if (calculate_baud_divisor(line_coding->dwDTERate, &factor, &divisor) != 0) {
+        if (calculate_baud_divisor(line_coding->dwDTERate, this->high_speed, &factor, &divisor) != 0) {
             return ESP_ERR_INVALID_ARG;
         }
         uint16_t baud_reg_val = (factor << 8) | divisor;
@@ -156,7 +173,7 @@ esp_err_t CH34x::set_control_line_state(bool dtr, bool rts)
     return this->send_custom_request(CH34X_WRITE_REQ, CH34X_CMD_MODEM_OUT, wValue, this->intf, 0, NULL);
 }
 
-int CH34x::calculate_baud_divisor(unsigned int baud_rate, unsigned char *factor, unsigned char *divisor)
+int CH34x::calculate_baud_divisor(unsigned int baud_rate, bool high_speed, unsigned char *factor, unsigned char *divisor)
 {
     unsigned char a;
     unsigned char b;
@@ -165,6 +182,20 @@ int CH34x::calculate_baud_divisor(unsigned int baud_rate, unsigned char *factor,
     assert(factor);
     assert(divisor);
 
+    if (high_speed && baud_rate > CH34x_CLOCK_HIGH_SPEED / 2) {
+        return -1; // Above 6 Mbaud
+    }
+    if (high_speed && baud_rate > CH34x_CLOCK_HIGH_SPEED / 255) {
+        c = CH34x_CLOCK_HIGH_SPEED / baud_rate;
+        // Deal with integer division
+        if (CH34x_CLOCK_HIGH_SPEED / c - baud_rate > baud_rate - CH34x_CLOCK_HIGH_SPEED / (c + 1)) {
+            c++;
+        }
+        *factor = 256 - c;
+        *divisor = CH34x_DIVISOR_HIGH_SPEED;
+        return 0;
+    }
+
     switch (baud_rate) {
     case 921600:
         a = 0xf3;
@@ -50,6 +50,13 @@
 namespace esp_usb {
 class CP210x : public CdcAcmDevice {
 public:
+    // Flow control modes, handled by the chip
+    enum class Flow {
+        NONE,
+        RTS_CTS,
+        XON_XOFF,
+    };
+
     /**
      * @brief Constructor for this CP210x driver
      *
@@ -104,6 +111,31 @@ public:
      */
     esp_err_t send_break(uint16_t duration_ms);
 
+    /**
+     * @brief Set flow control
+     *
+     * State of DTR line and other handshaking settings are preserved.
+     *
+     * @see AN571: CP210x Virtual COM Port Interface chapters 5.17 and 5.18
+     * @param[in] flow Flow control mode
+     * @param[in] xon  XON character, used in Flow::XON_XOFF mode only
+     * @param[in] xoff XOFF character, used in Flow::XON_XOFF mode only
+     * @return esp_err_t
+     */
+    esp_err_t set_flow_control(Flow flow, uint8_t xon = 0x11, uint8_t xoff = 0x13);
+
+    /**
+     * @brief Set error character
+     *
+     * The error character replaces received characters with parity or framing error.
+     *
+     * @see AN571: CP210x Virtual COM Port Interface chapters 5.12 and 5.18
+     * @param[in] error_char Error character
+     * @param[in] enable     Enable the error character
+     * @return esp_err_t
+     */
+    esp_err_t set_error_char(uint8_t error_char, bool enable);
+
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = SILICON_LABS_VID;
     static constexpr std::array<uint16_t, 3> pids = {CP210X_PID, CP2105_PID, CP2108_PID};
@@ -111,6 +143,17 @@ public:
 private:
     const uint8_t intf;
 
+    /**
+     * @brief Read-modify-write of flow control settings
+     *
+     * @param[in] hs_clear   Bits of ulControlHandshake to be cleared
+     * @param[in] hs_set     Bits of ulControlHandshake to be set
+     * @param[in] repl_clear Bits of ulFlowReplace to be cleared
+     * @param[in] repl_set   Bits of ulFlowReplace to be set
+     * @return esp_err_t
+     */
+    esp_err_t flow_update(uint32_t hs_clear, uint32_t hs_set, uint32_t repl_clear, uint32_t repl_set);
+
     // Make open functions from CdcAcmDevice class private
     using CdcAcmDevice::open;
     using CdcAcmDevice::open_vendor_specific;
@@ -19,10 +19,32 @@
 #define CP210X_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_INTERFACE | USB_BM_REQUEST_TYPE_DIR_IN)
 #define CP210X_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_INTERFACE | USB_BM_REQUEST_TYPE_DIR_OUT)
 
+// Handshaking and flow settings of CP210X_CMD_SET_FLOW and CP210X_CMD_GET_FLOW
+typedef struct __attribute__((packed)) {
+    uint32_t ulControlHandshake;
+    uint32_t ulFlowReplace;
+    uint32_t ulXonLimit;
+    uint32_t ulXoffLimit;
+} cp210x_flow_t;
+
+#define CP210X_CTS_HANDSHAKE   (1 << 3) // ulControlHandshake
+#define CP210X_AUTO_TRANSMIT   (1 << 0) // ulFlowReplace
+#define CP210X_AUTO_RECEIVE    (1 << 1)
+#define CP210X_ERROR_CHAR      (1 << 2)
+#define CP210X_RTS_MASK        (3 << 6)
+#define CP210X_RTS_ACTIVE      (1 << 6)
+#define CP210X_RTS_FLOW        (2 << 6)
+#define CP210X_XON_XOFF_LIMIT  (128)    // Free and used space of the RX buffer for XON and XOFF
+
+#define CP210X_CHAR_ERROR      (1) // Index of special character for CP210X_CMD_SET_CHAR
+#define CP210X_CHAR_XON        (4)
+#define CP210X_CHAR_XOFF       (5)
+
 namespace esp_usb {
 CP210x::CP210x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
     : intf(interface_idx)
 {
+    this->partial_line_coding = true;
     esp_err_t err;
     err = this->open_vendor_specific(vid, pid, this->intf, dev_config);
     if (err != ESP_OK) {
@@ -78,4 +100,44 @@ esp_err_t CP210x::send_break(uint16_t duration_ms)
     vTaskDelay(pdMS_TO_TICKS(duration_ms));
     return this->send_custom_request(CP210X_WRITE_REQ, CP210X_CMD_SET_BREAK, 0, this->intf, 0, NULL);
 }
+
+esp_err_t CP210x::flow_update(uint32_t hs_clear, uint32_t hs_set, uint32_t repl_clear, uint32_t repl_set)
+{
+    cp210x_flow_t flow;
+    ESP_RETURN_ON_ERROR(this->send_custom_request(CP210X_READ_REQ, CP210X_CMD_GET_FLOW, 0, this->intf, sizeof(flow), (uint8_t *)&flow), "CP210x",);
+    flow.ulControlHandshake = (flow.ulControlHandshake & ~hs_clear) | hs_set;
+    flow.ulFlowReplace = (flow.ulFlowReplace & ~repl_clear) | repl_set;
+    return this->send_custom_request(CP210X_WRITE_REQ, CP210X_CMD_SET_FLOW, 0, this->intf, sizeof(flow), (uint8_t *)&flow);
+}
+
+esp_err_t CP210x::set_flow_control(Flow flow, uint8_t xon, uint8_t xoff)
+{
+    switch (flow) {
+    case Flow::NONE:
+        return this->flow_update(CP210X_CTS_HANDSHAKE, 0, CP210X_RTS_MASK | CP210X_AUTO_TRANSMIT | CP210X_AUTO_RECEIVE, CP210X_RTS_ACTIVE);
+    case Flow::RTS_CTS:
+        return this->flow_update(CP210X_CTS_HANDSHAKE, CP210X_CTS_HANDSHAKE, CP210X_RTS_MASK | CP210X_AUTO_TRANSMIT | CP210X_AUTO_RECEIVE, CP210X_RTS_FLOW);
+    case Flow::XON_XOFF: {
+        ESP_RETURN_ON_ERROR(this->send_custom_request(CP210X_WRITE_REQ, CP210X_CMD_SET_CHAR, CP210X_CHAR_XON | (xon << 8), this->intf, 0, NULL), "CP210x",);
+        ESP_RETURN_ON_ERROR(this->send_custom_request(CP210X_WRITE_REQ, CP210X_CMD_SET_CHAR, CP210X_CHAR_XOFF | (xoff << 8), this->intf, 0, NULL), "CP210x",);
+        cp210x_flow_t flow_cfg;
+        ESP_RETURN_ON_ERROR(this->send_custom_request(CP210X_READ_REQ, CP210X_CMD_GET_FLOW, 0, this->intf, sizeof(flow_cfg), (uint8_t *)&flow_cfg), "CP210x",);
+        flow_cfg.ulControlHandshake &= ~CP210X_CTS_HANDSHAKE;
+        flow_cfg.ulFlowReplace = (flow_cfg.ulFlowReplace & ~CP210X_RTS_MASK) | CP210X_RTS_ACTIVE | CP210X_AUTO_TRANSMIT | CP210X_AUTO_RECEIVE;
+        flow_cfg.ulXonLimit = CP210X_XON_XOFF_LIMIT;
+        flow_cfg.ulXoffLimit = CP210X_XON_XOFF_LIMIT;
+        return this->send_custom_request(CP210X_WRITE_REQ, CP210X_CMD_SET_FLOW, 0, this->intf, sizeof(flow_cfg), (uint8_t *)&flow_cfg);
+    }
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+esp_err_t CP210x::set_error_char(uint8_t error_char, bool enable)
+{
+    if (enable) {
+        ESP_RETURN_ON_ERROR(this->send_custom_request(CP210X_WRITE_REQ, CP210X_CMD_SET_CHAR, CP210X_CHAR_ERROR | (error_char << 8), this->intf, 0, NULL), "CP210x",);
+    }
+    return this->flow_update(0, 0, CP210X_ERROR_CHAR, enable ? CP210X_ERROR_CHAR : 0);
+}
 }
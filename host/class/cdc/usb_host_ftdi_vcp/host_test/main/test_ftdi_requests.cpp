@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/vcp_ftdi.hpp"
+
+/**
+ * @brief Vendor control request sent to the device
+ */
+struct ftdi_request_t {
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+};
+
+static std::vector<ftdi_request_t> s_requests;
+static int s_dummy_device;
+
+// Fakes of CDC-ACM driver, FT23x talks to the device only through send_custom_request()
+extern "C" {
+esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
+{
+    *cdc_hdl_ret = (cdc_acm_dev_hdl_t)&s_dummy_device;
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_line_coding_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_line_coding_t *line_coding)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t cdc_acm_host_line_coding_set(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_line_coding_t *line_coding)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t cdc_acm_host_set_control_line_state(cdc_acm_dev_hdl_t cdc_hdl, bool dtr, bool rts)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t cdc_acm_host_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_ms)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
+{
+    s_requests.push_back({bmRequestType, bRequest, wValue, wIndex});
+    return ESP_OK;
+}
+}
+
+static constexpr uint8_t vendor_out = 0x40; // Vendor request, host to device
+static constexpr uint8_t sio_modem_ctrl = 0x01;
+static constexpr uint8_t sio_set_flow_ctrl = 0x02;
+
+static void check_last_request(uint8_t bRequest, uint16_t wValue, uint16_t wIndex)
+{
+    REQUIRE(s_requests.size() == 1);
+    CHECK(s_requests[0].bmRequestType == vendor_out);
+    CHECK(s_requests[0].bRequest == bRequest);
+    CHECK(s_requests[0].wValue == wValue);
+    CHECK(s_requests[0].wIndex == wIndex);
+}
+
+SCENARIO("FTDI vendor requests")
+{
+    cdc_acm_host_device_config_t dev_config = {};
+    dev_config.out_buffer_size = 64;
+    dev_config.in_buffer_size = 64;
+    esp_usb::FT23x ftdi(FT232_PID, &dev_config);
+    s_requests.clear();
+
+    GIVEN("Modem lines") {
+        WHEN("DTR is set and RTS cleared") {
+            REQUIRE(ESP_OK == ftdi.set_control_line_state(true, false));
+            THEN("MODEM_CTRL changes both lines") {
+                check_last_request(sio_modem_ctrl, 0x0301, 0);
+            }
+        }
+        WHEN("RTS is set and DTR cleared") {
+            REQUIRE(ESP_OK == ftdi.set_control_line_state(false, true));
+            THEN("MODEM_CTRL changes both lines") {
+                check_last_request(sio_modem_ctrl, 0x0302, 0);
+            }
+        }
+    }
+
+    GIVEN("Flow control") {
+        WHEN("Flow control is disabled") {
+            REQUIRE(ESP_OK == ftdi.set_flow_control(esp_usb::FT23x::Flow::NONE));
+            THEN("SET_FLOW_CTRL has no mode in wIndex") {
+                check_last_request(sio_set_flow_ctrl, 0, 0x0000);
+            }
+        }
+        WHEN("RTS/CTS is selected") {
+            REQUIRE(ESP_OK == ftdi.set_flow_control(esp_usb::FT23x::Flow::RTS_CTS));
+            THEN("SET_FLOW_CTRL has RTS/CTS mode in wIndex") {
+                check_last_request(sio_set_flow_ctrl, 0, 0x0100);
+            }
+        }
+        WHEN("DTR/DSR is selected") {
+            REQUIRE(ESP_OK == ftdi.set_flow_control(esp_usb::FT23x::Flow::DTR_DSR));
+            THEN("SET_FLOW_CTRL has DTR/DSR mode in wIndex") {
+                check_last_request(sio_set_flow_ctrl, 0, 0x0200);
+            }
+        }
+        WHEN("XON/XOFF is selected") {
+            REQUIRE(ESP_OK == ftdi.set_flow_control(esp_usb::FT23x::Flow::XON_XOFF, 0x11, 0x13));
+            THEN("SET_FLOW_CTRL has XON/XOFF mode in wIndex and the characters in wValue") {
+                check_last_request(sio_set_flow_ctrl, 0x1311, 0x0400);
+            }
+        }
+    }
+}
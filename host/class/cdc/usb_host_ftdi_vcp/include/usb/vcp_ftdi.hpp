@@ -16,15 +16,27 @@
 #define FT231_PID            (0x6015)
 
 #define FTDI_CMD_RESET        (0x00)
-#define FTDI_CMD_SET_FLOW     (0x01)
-#define FTDI_CMD_SET_MHS      (0x02) // Modem handshaking
+#define FTDI_CMD_SET_MHS      (0x01) // Modem handshaking
+#define FTDI_CMD_SET_FLOW     (0x02)
 #define FTDI_CMD_SET_BAUDRATE (0x03)
 #define FTDI_CMD_SET_LINE_CTL (0x04)
 #define FTDI_CMD_GET_MDMSTS   (0x05) // Modem status
+#define FTDI_CMD_SET_EVENT_CHAR   (0x06)
+#define FTDI_CMD_SET_ERROR_CHAR   (0x07)
+#define FTDI_CMD_SET_LATENCY      (0x09) // Latency timer
+#define FTDI_CMD_GET_LATENCY      (0x0A)
 
 namespace esp_usb {
 class FT23x : public CdcAcmDevice {
 public:
+    // Flow control modes, handled by the chip
+    enum class Flow {
+        NONE,
+        RTS_CTS,
+        DTR_DSR,
+        XON_XOFF,
+    };
+
     /**
      * @brief Constructor for this FTDI driver
      *
@@ -57,6 +69,58 @@ public:
      */
     esp_err_t set_control_line_state(bool dtr, bool rts);
 
+    /**
+     * @brief Set latency timer
+     *
+     * FT23x sends received data to the host when its buffer is full, when the event character is received
+     * or when the latency timer expires. Default latency is 16 ms; lower values reduce latency of short messages
+     * at the cost of more USB packets.
+     *
+     * @param[in] latency_ms Latency timer in [ms], 1 - 255
+     * @return esp_err_t
+     */
+    esp_err_t set_latency_timer(uint8_t latency_ms);
+
+    /**
+     * @brief Get latency timer
+     *
+     * @param[out] latency_ms Latency timer in [ms]
+     * @return esp_err_t
+     */
+    esp_err_t get_latency_timer(uint8_t *latency_ms);
+
+    /**
+     * @brief Set event character
+     *
+     * Reception of the event character flushes received data to the host immediately, e.g. end of line of text protocols.
+     *
+     * @param[in] event_char Event character
+     * @param[in] enable     Enable the event character
+     * @return esp_err_t
+     */
+    esp_err_t set_event_char(uint8_t event_char, bool enable);
+
+    /**
+     * @brief Set error character
+     *
+     * The error character is inserted into received data on parity or framing error.
+     *
+     * @param[in] error_char Error character
+     * @param[in] enable     Enable the error character
+     * @return esp_err_t
+     */
+    esp_err_t set_error_char(uint8_t error_char, bool enable);
+
+    /**
+     * @brief Set flow control
+     *
+     * @param[in] flow Flow control mode
+     * @param[in] xon  XON character, used in Flow::XON_XOFF mode only
+     * @param[in] xoff XOFF character, used in Flow::XON_XOFF mode only
+     * @return esp_err_t
+     */
+    esp_err_t set_flow_control(Flow flow, uint8_t xon = 0x11, uint8_t xoff = 0x13);
+
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = FTDI_VID;
     static constexpr std::array<uint16_t, 2> pids = {FT232_PID, FT231_PID};
@@ -67,11 +131,14 @@ private:
     const cdc_acm_host_dev_callback_t user_event_cb;
     void *user_arg;
     uint16_t uart_state;
+    size_t rx_raw_len;     // Length of RX data not processed by the user, including stripped status bytes
+    size_t rx_payload_len; // Length of the payload compacted at the start of RX data not processed by the user
 
     /**
      * @brief FT23x's RX data handler
      *
-     * First two bytes are status bytes, the RX data start at data[2].
+     * Each packet of the transfer starts with two status bytes. They are stripped in place
+     * and the payload of all packets is delivered to the user in one contiguous block.
      * Coding of status bytes:
      * Byte 0:
      *      Bit 0: Full Speed packet
@@ -88,7 +155,7 @@ private:
      *      Bit 5: Transmitter holding register empty
      *      Bit 6: Transmitter empty
      *
-     * @todo When CTS is asserted, this driver should stop sending data.
+     * @note Transmission is stopped by CTS only if Flow::RTS_CTS is set by set_flow_control().
      *
      * @param[in] data     Received data
      * @param[in] data_len Received data length
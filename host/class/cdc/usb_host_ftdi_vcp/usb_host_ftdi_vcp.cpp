@@ -6,6 +6,7 @@
 
 #include <string.h>
 #include <inttypes.h>
+#include <algorithm>
 #include "usb/vcp_ftdi.hpp"
 #include "usb/usb_types_ch9.h"
 #include "esp_log.h"
@@ -19,11 +20,25 @@
 #define FTDI_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_DIR_IN)
 #define FTDI_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_DIR_OUT)
 
+#define FTDI_MHS_DTR      (0x0001)
+#define FTDI_MHS_RTS      (0x0002)
+#define FTDI_MHS_DTR_MASK (0x0100)
+#define FTDI_MHS_RTS_MASK (0x0200)
+
+#define FTDI_FLOW_RTS_CTS  (0x0100) // Flow control modes in upper byte of wIndex
+#define FTDI_FLOW_DTR_DSR  (0x0200)
+#define FTDI_FLOW_XON_XOFF (0x0400)
+#define FTDI_CHAR_ENABLE   (0x0100) // Event and error character enable in upper byte of wValue
+
+#define FTDI_PACKET_SIZE (64) // Supported FT23x chips are Full-speed devices
+#define FTDI_STATUS_LEN  (2)  // Every packet starts with two status bytes
+
 namespace esp_usb {
 FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
     : intf(interface_idx), user_data_cb(dev_config->data_cb), user_event_cb(dev_config->event_cb),
-      user_arg(dev_config->user_arg), uart_state(0)
+      user_arg(dev_config->user_arg), uart_state(0), rx_raw_len(0), rx_payload_len(0)
 {
+    this->partial_line_coding = true;
     cdc_acm_host_device_config_t ftdi_config;
     memcpy(&ftdi_config, dev_config, sizeof(cdc_acm_host_device_config_t));
     // FT23x reports modem status in first two bytes of RX data
@@ -31,13 +46,11 @@ FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8
 
     if (dev_config->data_cb) {
         ftdi_config.data_cb = ftdi_rx;
-        ftdi_config.user_arg = this;
     }
 
-    if (dev_config->event_cb) {
-        ftdi_config.event_cb = ftdi_event;
-        ftdi_config.user_arg = this;
-    }
+    // Events are always intercepted, RX buffer overflow discards the data kept by ftdi_rx()
+    ftdi_config.event_cb = ftdi_event;
+    ftdi_config.user_arg = this;
 
     esp_err_t err;
     err = this->open_vendor_specific(vid, pid, this->intf, &ftdi_config);
@@ -82,25 +95,92 @@ esp_err_t FT23x::line_coding_set(cdc_acm_line_coding_t *line_coding)
 
 esp_err_t FT23x::set_control_line_state(bool dtr, bool rts)
 {
-    ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, dtr ? 0x11 : 0x10, this->intf, 0, NULL), "FT23x",); // DTR
-    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, rts ? 0x21 : 0x20, this->intf, 0, NULL); // RTS
+    // Upper byte selects the lines to be changed, so both are set by one request
+    const uint16_t wValue = FTDI_MHS_DTR_MASK | FTDI_MHS_RTS_MASK | (dtr ? FTDI_MHS_DTR : 0) | (rts ? FTDI_MHS_RTS : 0);
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, wValue, this->intf, 0, NULL);
+}
+
+esp_err_t FT23x::set_latency_timer(uint8_t latency_ms)
+{
+    ESP_RETURN_ON_FALSE(latency_ms > 0, ESP_ERR_INVALID_ARG, "FT23x", "Latency must be at least 1 ms");
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_LATENCY, latency_ms, this->intf, 0, NULL);
+}
+
+esp_err_t FT23x::get_latency_timer(uint8_t *latency_ms)
+{
+    assert(latency_ms);
+    return this->send_custom_request(FTDI_READ_REQ, FTDI_CMD_GET_LATENCY, 0, this->intf, 1, latency_ms);
+}
+
+esp_err_t FT23x::set_event_char(uint8_t event_char, bool enable)
+{
+    const uint16_t wValue = event_char | (enable ? FTDI_CHAR_ENABLE : 0);
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_EVENT_CHAR, wValue, this->intf, 0, NULL);
+}
+
+esp_err_t FT23x::set_error_char(uint8_t error_char, bool enable)
+{
+    const uint16_t wValue = error_char | (enable ? FTDI_CHAR_ENABLE : 0);
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_ERROR_CHAR, wValue, this->intf, 0, NULL);
+}
+
+esp_err_t FT23x::set_flow_control(Flow flow, uint8_t xon, uint8_t xoff)
+{
+    uint16_t wValue = 0;
+    uint16_t wIndex = this->intf;
+    switch (flow) {
+    case Flow::NONE:
+        break;
+    case Flow::RTS_CTS:
+        wIndex |= FTDI_FLOW_RTS_CTS;
+        break;
+    case Flow::DTR_DSR:
+        wIndex |= FTDI_FLOW_DTR_DSR;
+        break;
+    case Flow::XON_XOFF:
+        wIndex |= FTDI_FLOW_XON_XOFF;
+        wValue = xon | (xoff << 8);
+        break;
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_FLOW, wValue, wIndex, 0, NULL);
 }
 
 bool FT23x::ftdi_rx(const uint8_t *data, size_t data_len, void *user_arg)
 {
     FT23x *this_ftdi = (FT23x *)user_arg;
 
+    // The buffer belongs to IN transfer of CDC-ACM driver, status bytes of all packets are stripped in place.
+    // If the user did not process the data last time, the buffer starts with rx_raw_len bytes that were already compacted
+    // into rx_payload_len bytes of payload, followed by newly received packets
+    uint8_t *buf = const_cast<uint8_t *>(data);
+    size_t payload_len = this_ftdi->rx_payload_len;
+    uint8_t modem_status = 0;
+    uint8_t line_status = 0;
+    bool status_received = false;
+    for (size_t pkt = this_ftdi->rx_raw_len; pkt + FTDI_STATUS_LEN <= data_len; pkt += FTDI_PACKET_SIZE) {
+        const size_t chunk_len = std::min<size_t>(FTDI_PACKET_SIZE, data_len - pkt) - FTDI_STATUS_LEN;
+        modem_status = buf[pkt];      // Latest modem lines
+        line_status |= buf[pkt + 1];  // Errors of any packet
+        status_received = true;
+        if (chunk_len > 0 && &buf[payload_len] != &buf[pkt + FTDI_STATUS_LEN]) {
+            memmove(&buf[payload_len], &buf[pkt + FTDI_STATUS_LEN], chunk_len);
+        }
+        payload_len += chunk_len;
+    }
+
     // Dispatch serial state if it has changed
-    if (this_ftdi->user_event_cb) {
+    if (this_ftdi->user_event_cb && status_received) {
         cdc_acm_uart_state_t new_state;
         new_state.val = 0;
-        new_state.bRxCarrier =  data[0] & 0x80; // DCD
-        new_state.bTxCarrier =  data[0] & 0x20; // DSR
-        new_state.bBreak =      data[1] & 0x10;
-        new_state.bRingSignal = data[0] & 0x40;
-        new_state.bFraming =    data[1] & 0x08;
-        new_state.bParity =     data[1] & 0x04;
-        new_state.bOverRun =    data[1] & 0x02;
+        new_state.bRxCarrier =  modem_status & 0x80; // DCD
+        new_state.bTxCarrier =  modem_status & 0x20; // DSR
+        new_state.bBreak =      line_status & 0x10;
+        new_state.bRingSignal = modem_status & 0x40;
+        new_state.bFraming =    line_status & 0x08;
+        new_state.bParity =     line_status & 0x04;
+        new_state.bOverRun =    line_status & 0x02;
 
         if (this_ftdi->uart_state != new_state.val) {
             cdc_acm_host_dev_event_data_t serial_event;
@@ -111,17 +191,27 @@ bool FT23x::ftdi_rx(const uint8_t *data, size_t data_len, void *user_arg)
         }
     }
 
-    // Dispatch data if any
-    if (data_len > 2) {
-        return this_ftdi->user_data_cb(&data[2], data_len - 2, this_ftdi->user_arg);
+    // Dispatch data if any, in one contiguous block
+    bool processed = true;
+    if (payload_len > 0) {
+        processed = this_ftdi->user_data_cb(buf, payload_len, this_ftdi->user_arg);
     }
-    return true;
+    this_ftdi->rx_raw_len = processed ? 0 : data_len;
+    this_ftdi->rx_payload_len = processed ? 0 : payload_len;
+    return processed;
 }
 
 void FT23x::ftdi_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
 {
     FT23x *this_ftdi = (FT23x *)user_ctx;
-    this_ftdi->user_event_cb(event, this_ftdi->user_arg);
+    if (event->type == CDC_ACM_HOST_SERIAL_STATE && event->data.serial_state.bOverRun) {
+        // CDC-ACM driver discarded the RX buffer, following data start with a new packet
+        this_ftdi->rx_raw_len = 0;
+        this_ftdi->rx_payload_len = 0;
+    }
+    if (this_ftdi->user_event_cb) {
+        this_ftdi->user_event_cb(event, this_ftdi->user_arg);
+    }
 }
 
 int FT23x::calculate_baudrate(uint32_t baudrate, uint16_t *wValue, uint16_t *wIndex)
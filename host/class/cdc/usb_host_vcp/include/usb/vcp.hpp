@@ -40,6 +40,9 @@ public:
      * #. pids: Array of supported PIDs
      * # Constructor with (uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx) input parameters
      *
+     * @note Every VID/PID combination is stored in a table sorted by VID and PID, so lookup by VID and PID is a binary search.
+     *       Registering a VID/PID combination again replaces the previous driver.
+     *
      * @tparam T VCP driver type
      */
     template<class T> static void
@@ -47,11 +50,11 @@ public:
     {
         static_assert(T::pids.begin() != nullptr, "Every VCP driver must contain array of supported PIDs in 'pids' array");
         static_assert(T::vid != 0, "Every VCP driver must contain supported VID in'vid' integer");
-        std::vector<uint16_t> pids(T::pids.begin(), T::pids.end()); // Convert array to vector
-        vcp_driver new_driver = vcp_driver([](uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx) {
-            return static_cast<CdcAcmDevice *> (new T(pid, dev_config, interface_idx)); // Lambda function: Open factory method
-        }, T::vid, pids);
-        drivers.push_back(new_driver);
+        for (const uint16_t pid : T::pids) {
+            add_driver(T::vid, pid, [](uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx) {
+                return static_cast<CdcAcmDevice *> (new T(_pid, dev_config, interface_idx)); // Lambda function: Open factory method
+            });
+        }
     }
 
     /**
@@ -66,9 +69,9 @@ public:
      * @param[in] _pid          PID of the device
      * @param[in] dev_config    Configuration of the device
      * @param[in] interface_idx USB interface to use
-     * @return std::shared_ptr<CdcAcmDevice>
+     * @return Opened device owned by the caller, nullptr if the device could not be opened
      */
-    static CdcAcmDevice *
+    static std::unique_ptr<CdcAcmDevice>
     open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0);
 
     /**
@@ -85,11 +88,46 @@ public:
      *
      * @param[in] dev_config    Configuration of the device
      * @param[in] interface_idx USB interface to use
-     * @return std::shared_ptr<CdcAcmDevice>
+     * @return Opened device owned by the caller, nullptr if no device could be opened
      */
-    static CdcAcmDevice *
+    static std::unique_ptr<CdcAcmDevice>
     open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0);
 
+    /**
+     * @brief Callback of automatically opened VCP device
+     *
+     * @param[in] vcp Opened device, the callee takes its ownership
+     * @param[in] arg User's argument
+     */
+    typedef void (*auto_open_callback_t)(std::unique_ptr<CdcAcmDevice> vcp, void *arg);
+
+    /**
+     * @brief Start automatic opening of hot-plugged VCP devices
+     *
+     * When a device with registered VID and PID is connected, it is opened by its driver and passed to open_cb.
+     * Devices are opened and open_cb is called from a task of the VCP service, not from the USB Host task.
+     *
+     * @note CDC-ACM driver is installed if it is not installed yet. Its new device callback is taken over by the VCP service.
+     * @attention USB Host Library must be installed before calling this function!
+     *
+     * @param[in] dev_config    Configuration of the opened devices, it is copied
+     * @param[in] open_cb       Callback of opened devices
+     * @param[in] arg           User's argument of open_cb
+     * @param[in] interface_idx USB interface to use
+     * @return
+     *     - ESP_OK: Success
+     *     - ESP_ERR_INVALID_STATE: Automatic opening is already running
+     *     - ESP_ERR_NO_MEM: Not enough memory for the task
+     */
+    static esp_err_t auto_open_start(const cdc_acm_host_device_config_t *dev_config, auto_open_callback_t open_cb, void *arg, uint8_t interface_idx = 0);
+
+    /**
+     * @brief Stop automatic opening of hot-plugged VCP devices
+     *
+     * Devices that were already opened stay open.
+     */
+    static void auto_open_stop(void);
+
 private:
     // Default operators
     VCP() = delete; // This driver acts as a service, you can't instantiate it
@@ -98,19 +136,42 @@ private:
     bool operator== (const VCP &param) = delete;
     bool operator!= (const VCP &param) = delete;
 
+    typedef CdcAcmDevice *(*open_func_t)(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
     /**
      * @brief VCP driver structure
      */
     typedef struct vcp_driver {
-        CdcAcmDevice *(*open)(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx); /*!< Factory method of this driver */
-        uint16_t vid;                                                                                               /*!< VID this driver supports */
-        std::vector<uint16_t> pids;                                                                                 /*!< List of PIDs this driver supports */
-        vcp_driver(auto open_func, const uint16_t _vid, const std::vector<uint16_t> &_pids): open(open_func), vid(_vid), pids(_pids) {};
+        uint32_t id;      /*!< VID in upper and PID in lower half-word */
+        open_func_t open; /*!< Factory method of the driver */
     } vcp_driver;
 
     /**
-     * @brief List of registered VCP drivers
+     * @brief Table of registered VID/PID combinations, sorted by id
      */
     static std::vector<vcp_driver> drivers;
+
+    /**
+     * @brief Insert VID/PID combination into the sorted table of drivers
+     */
+    static void add_driver(uint16_t vid, uint16_t pid, open_func_t open);
+
+    /**
+     * @brief Find driver of VID/PID combination
+     *
+     * @return Pointer to the driver, nullptr if not registered
+     */
+    static const vcp_driver *find_driver(uint16_t vid, uint16_t pid);
+
+    /**
+     * @brief Install CDC-ACM driver, if it is not installed yet
+     *
+     * @return true if the driver is installed
+     */
+    static bool cdc_acm_ready(void);
+
+    // Automatic opening of hot-plugged devices
+    static void new_dev_handler(usb_device_handle_t usb_dev);
+    static void auto_open_task(void *arg);
 }; // VCP class
 }  // namespace esp_usb
@@ -4,59 +4,104 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <algorithm>
+#include <inttypes.h>
 #include <stdexcept>
+#include <utility>
 #include "usb/vcp.hpp"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "VCP service";
 
+#define VCP_ID(vid, pid)          (((uint32_t)(vid) << 16) | (pid))
+#define VCP_AUTO_OPEN_QUEUE_LEN   (4)
+#define VCP_AUTO_OPEN_STACK_SIZE  (4096)
+#define VCP_AUTO_OPEN_PRIORITY    (5)
+#define VCP_AUTO_OPEN_STOP        (0) // VID 0 is not a valid VCP, used as stop request for auto_open_task
+
+// State of automatic opening of hot-plugged devices
+// The queue and semaphore are created on the first start and never deleted, new_dev_handler() may still run when it is stopped
+static struct {
+    QueueHandle_t queue;              // IDs of connected devices with registered driver
+    SemaphoreHandle_t exit;           // Given by auto_open_task when it exits
+    volatile bool running;            // auto_open_task is running
+    cdc_acm_host_device_config_t dev_config;
+    esp_usb::VCP::auto_open_callback_t open_cb;
+    void *arg;
+    uint8_t interface_idx;
+} auto_open;
+
 namespace esp_usb {
 std::vector<VCP::vcp_driver> VCP::drivers;
-CdcAcmDevice *VCP::open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+
+void VCP::add_driver(uint16_t vid, uint16_t pid, open_func_t open)
+{
+    const uint32_t id = VCP_ID(vid, pid);
+    auto it = std::lower_bound(drivers.begin(), drivers.end(), id, [](const vcp_driver & drv, uint32_t _id) {
+        return drv.id < _id;
+    });
+    if (it != drivers.end() && it->id == id) {
+        it->open = open;
+    } else {
+        drivers.insert(it, vcp_driver{id, open});
+    }
+}
+
+const VCP::vcp_driver *VCP::find_driver(uint16_t vid, uint16_t pid)
+{
+    const uint32_t id = VCP_ID(vid, pid);
+    auto it = std::lower_bound(drivers.cbegin(), drivers.cend(), id, [](const vcp_driver & drv, uint32_t _id) {
+        return drv.id < _id;
+    });
+    return (it != drivers.cend() && it->id == id) ? &(*it) : nullptr;
+}
+
+bool VCP::cdc_acm_ready(void)
 {
     // In case user didn't install CDC-ACM driver, we try to install it here.
+    // This is only a NULL check if the driver is already installed
     const esp_err_t err = cdc_acm_host_install(NULL);
     switch (err) {
-    case ESP_OK: ESP_LOGD(TAG, "CDC-ACM driver installed"); break;
-    case ESP_ERR_INVALID_STATE: ESP_LOGD(TAG, "CDC-ACM driver already installed"); break;
-    default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return nullptr;
+    case ESP_OK: ESP_LOGD(TAG, "CDC-ACM driver installed"); return true;
+    case ESP_ERR_INVALID_STATE: ESP_LOGD(TAG, "CDC-ACM driver already installed"); return true;
+    default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return false;
     }
+}
 
-    for (vcp_driver drv : drivers) {
-        if (drv.vid == _vid) {
-            for (uint16_t p : drv.pids) {
-                if (p == _pid) {
-                    try {
-                        return drv.open(_pid, dev_config, interface_idx);
-                    } catch (esp_err_t &e) {
-                        switch (e) {
-                        case ESP_ERR_NO_MEM: throw std::bad_alloc();
-                        case ESP_ERR_NOT_FOUND: // fallthrough
-                        default: return nullptr;
-                        }
-                    }
-                }
-            }
+std::unique_ptr<CdcAcmDevice> VCP::open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+{
+    if (!cdc_acm_ready()) {
+        return nullptr;
+    }
+
+    const vcp_driver *drv = find_driver(_vid, _pid);
+    if (drv == nullptr) {
+        return nullptr;
+    }
+    try {
+        return std::unique_ptr<CdcAcmDevice>(drv->open(_pid, dev_config, interface_idx));
+    } catch (esp_err_t &e) {
+        switch (e) {
+        case ESP_ERR_NO_MEM: throw std::bad_alloc();
+        case ESP_ERR_NOT_FOUND: // fallthrough
+        default: return nullptr;
         }
     }
-    return nullptr;
 }
 
-CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+std::unique_ptr<CdcAcmDevice> VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
 {
     // Setup this function timeout
     TickType_t timeout_ticks = (dev_config->connection_timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(dev_config->connection_timeout_ms);
     TimeOut_t connection_timeout;
     vTaskSetTimeOutState(&connection_timeout);
 
-    // In case user didn't install CDC-ACM driver, we try to install it here.
-    esp_err_t err = cdc_acm_host_install(NULL);
-    switch (err) {
-    case ESP_OK: ESP_LOGD(TAG, "CDC-ACM driver installed"); break;
-    case ESP_ERR_INVALID_STATE: ESP_LOGD(TAG, "CDC-ACM driver already installed"); break;
-    default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return nullptr;
+    if (!cdc_acm_ready()) {
+        return nullptr;
     }
 
     // dev_config->connection_timeout_ms is normally meant for 1 device,
@@ -66,16 +111,14 @@ CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t
 
     // Try opening all registered devices, return on first success
     do {
-        for (vcp_driver drv : drivers) {
-            for (uint16_t pid : drv.pids) {
-                try {
-                    return drv.open(pid, &_config, interface_idx);
-                } catch (esp_err_t &e) {
-                    switch (e) {
-                    case ESP_ERR_NOT_FOUND: break;
-                    case ESP_ERR_NO_MEM: throw std::bad_alloc();
-                    default: return nullptr;
-                    }
+        for (const vcp_driver &drv : drivers) {
+            try {
+                return std::unique_ptr<CdcAcmDevice>(drv.open(drv.id & 0xFFFF, &_config, interface_idx));
+            } catch (esp_err_t &e) {
+                switch (e) {
+                case ESP_ERR_NOT_FOUND: break;
+                case ESP_ERR_NO_MEM: throw std::bad_alloc();
+                default: return nullptr;
                 }
             }
         }
@@ -83,4 +126,90 @@ CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t
     } while (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) == pdFALSE);
     return nullptr;
 }
+
+void VCP::new_dev_handler(usb_device_handle_t usb_dev)
+{
+    // Called from USB Host task: only check the VID and PID, the device is opened by auto_open_task
+    const usb_device_desc_t *device_desc;
+    if (!auto_open.running || usb_host_get_device_descriptor(usb_dev, &device_desc) != ESP_OK) {
+        return;
+    }
+    if (find_driver(device_desc->idVendor, device_desc->idProduct) == nullptr) {
+        return;
+    }
+    const uint32_t id = VCP_ID(device_desc->idVendor, device_desc->idProduct);
+    if (xQueueSend(auto_open.queue, &id, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Auto open queue full, device %04X:%04X ignored", device_desc->idVendor, device_desc->idProduct);
+    }
+}
+
+void VCP::auto_open_task(void *arg)
+{
+    uint32_t id;
+    while (xQueueReceive(auto_open.queue, &id, portMAX_DELAY) == pdTRUE && id != VCP_AUTO_OPEN_STOP) {
+        std::unique_ptr<CdcAcmDevice> vcp;
+        try {
+            vcp = open(id >> 16, id & 0xFFFF, &auto_open.dev_config, auto_open.interface_idx);
+        } catch (std::bad_alloc &e) {
+            ESP_LOGE(TAG, "Not enough memory to open device %04" PRIX32 ":%04" PRIX32, id >> 16, id & 0xFFFF);
+        }
+        if (vcp) {
+            auto_open.open_cb(std::move(vcp), auto_open.arg);
+        } else {
+            ESP_LOGW(TAG, "Failed to open device %04" PRIX32 ":%04" PRIX32, id >> 16, id & 0xFFFF);
+        }
+    }
+    xSemaphoreGive(auto_open.exit);
+    vTaskDelete(NULL);
+}
+
+esp_err_t VCP::auto_open_start(const cdc_acm_host_device_config_t *dev_config, auto_open_callback_t open_cb, void *arg, uint8_t interface_idx)
+{
+    if (dev_config == nullptr || open_cb == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (auto_open.running || !cdc_acm_ready()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (auto_open.queue == NULL) {
+        auto_open.queue = xQueueCreate(VCP_AUTO_OPEN_QUEUE_LEN, sizeof(uint32_t));
+        auto_open.exit = xSemaphoreCreateBinary();
+        if (auto_open.queue == NULL || auto_open.exit == NULL) {
+            if (auto_open.queue) {
+                vQueueDelete(auto_open.queue);
+                auto_open.queue = NULL;
+            }
+            if (auto_open.exit) {
+                vSemaphoreDelete(auto_open.exit);
+                auto_open.exit = NULL;
+            }
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xQueueReset(auto_open.queue);
+
+    auto_open.dev_config = *dev_config;
+    auto_open.open_cb = open_cb;
+    auto_open.arg = arg;
+    auto_open.interface_idx = interface_idx;
+    if (xTaskCreate(auto_open_task, "VCP open", VCP_AUTO_OPEN_STACK_SIZE, NULL, VCP_AUTO_OPEN_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    auto_open.running = true;
+    cdc_acm_host_register_new_dev_callback(new_dev_handler);
+    return ESP_OK;
+}
+
+void VCP::auto_open_stop(void)
+{
+    if (!auto_open.running) {
+        return;
+    }
+    cdc_acm_host_register_new_dev_callback(NULL);
+    auto_open.running = false;
+    const uint32_t stop = VCP_AUTO_OPEN_STOP;
+    xQueueSend(auto_open.queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(auto_open.exit, portMAX_DELAY);
+}
 } // namespace esp_usb
@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "usb/hid_boot_decoder.h"
+
+static const char *TAG = "hid-boot-decoder";
+
+#define KEYBOARD_BITSET_WORDS       (sizeof(((hid_keyboard_state_t *)0)->pressed) / sizeof(uint32_t))
+#define KEYBOARD_MODIFIER_WORD      (HID_KEY_LEFT_CONTROL / 32)  // Modifier usages 0xE0..0xE7 are bits 0..7 of this word
+
+void hid_keyboard_state_init(hid_keyboard_state_t *state)
+{
+    memset(state, 0, sizeof(hid_keyboard_state_t));
+}
+
+/**
+ * @brief Report key events of the bits set in changed
+ *
+ * @param[in] changed   Changed bits of one word of the bitset
+ * @param[in] base      Usage of bit 0
+ * @param[in] pressed   Event type
+ * @param[in] modifier  Modifier bit mask of the report
+ * @param[in] cb        Event callback
+ * @param[in] arg       User argument of the callback
+ */
+static void keyboard_events_emit(uint32_t changed, uint8_t base, bool pressed, uint8_t modifier,
+                                 hid_keyboard_event_cb_t cb, void *arg)
+{
+    while (changed) {
+        const unsigned bit = __builtin_ctz(changed);
+        changed &= changed - 1;
+        const hid_keyboard_event_t event = {
+            .key = base + bit,
+            .pressed = pressed,
+            .modifier = modifier,
+        };
+        cb(&event, arg);
+    }
+}
+
+esp_err_t hid_keyboard_decode(hid_keyboard_state_t *state,
+                              const uint8_t *data,
+                              size_t length,
+                              hid_keyboard_event_cb_t cb,
+                              void *arg)
+{
+    ESP_RETURN_ON_FALSE(state && data && cb, ESP_ERR_INVALID_ARG, TAG, "Argument error");
+    ESP_RETURN_ON_FALSE(length >= sizeof(hid_keyboard_input_report_boot_t),
+                        ESP_ERR_INVALID_SIZE, TAG, "Keyboard report too short");
+
+    const hid_keyboard_input_report_boot_t *report = (const hid_keyboard_input_report_boot_t *)data;
+    uint32_t pressed[KEYBOARD_BITSET_WORDS] = {0};
+    bool phantom = false;
+    for (int i = 0; i < HID_KEYBOARD_KEY_MAX; i++) {
+        const uint8_t key = report->key[i];
+        // ErrorRollOver, POSTFail and ErrorUndefined fill all key slots when too many keys are pressed
+        phantom |= (key >= HID_KEY_ROLLOVER) && (key <= HID_KEY_ERROR_UNDEFINED);
+        pressed[key / 32] |= 1U << (key % 32);
+    }
+    pressed[0] &= ~0x0FU; // NoEvent and error codes are not keys
+
+    if (phantom) {
+        memcpy(pressed, state->pressed, sizeof(pressed));
+        pressed[KEYBOARD_MODIFIER_WORD] &= ~0xFFU;
+    }
+    // Modifier bits are in the order of usages 0xE0..0xE7
+    pressed[KEYBOARD_MODIFIER_WORD] |= report->modifier.val;
+
+    const uint8_t modifier = report->modifier.val;
+    for (unsigned w = 0; w < KEYBOARD_BITSET_WORDS; w++) {
+        keyboard_events_emit(state->pressed[w] & ~pressed[w], w * 32, false, modifier, cb, arg);
+    }
+    for (unsigned w = 0; w < KEYBOARD_BITSET_WORDS; w++) {
+        keyboard_events_emit(pressed[w] & ~state->pressed[w], w * 32, true, modifier, cb, arg);
+    }
+    memcpy(state->pressed, pressed, sizeof(pressed));
+    return ESP_OK;
+}
+
+esp_err_t hid_mouse_decode(hid_mouse_state_t *state,
+                           const uint8_t *data,
+                           size_t length,
+                           hid_mouse_event_t *event)
+{
+    ESP_RETURN_ON_FALSE(state && data && event, ESP_ERR_INVALID_ARG, TAG, "Argument error");
+    ESP_RETURN_ON_FALSE(length >= sizeof(hid_mouse_input_report_boot_t),
+                        ESP_ERR_INVALID_SIZE, TAG, "Mouse report too short");
+
+    const hid_mouse_input_report_boot_t *report = (const hid_mouse_input_report_boot_t *)data;
+    const uint8_t buttons = report->buttons.val;
+    event->x = report->x_displacement;
+    event->y = report->y_displacement;
+    // Most boot mice append the wheel, it is not a part of the boot report
+    event->wheel = (length > sizeof(hid_mouse_input_report_boot_t)) ? (int8_t)data[sizeof(hid_mouse_input_report_boot_t)] : 0;
+    event->buttons = buttons;
+    event->pressed = buttons & ~state->buttons;
+    event->released = state->buttons & ~buttons;
+    state->buttons = buttons;
+    return ESP_OK;
+}
+
+esp_err_t hid_host_keyboard_process(hid_host_device_handle_t hid_dev_handle,
+                                    hid_keyboard_state_t *state,
+                                    hid_keyboard_event_cb_t cb,
+                                    void *arg,
+                                    uint32_t timeout_ms)
+{
+    hid_host_report_t report;
+    ESP_RETURN_ON_ERROR(hid_host_device_report_borrow(hid_dev_handle, &report, timeout_ms), TAG, "");
+    const esp_err_t ret = hid_keyboard_decode(state, report.data, report.length, cb, arg);
+    hid_host_device_report_release(hid_dev_handle, &report);
+    return ret;
+}
+
+esp_err_t hid_host_mouse_process(hid_host_device_handle_t hid_dev_handle,
+                                 hid_mouse_state_t *state,
+                                 hid_mouse_event_t *event,
+                                 uint32_t timeout_ms)
+{
+    hid_host_report_t report;
+    ESP_RETURN_ON_ERROR(hid_host_device_report_borrow(hid_dev_handle, &report, timeout_ms), TAG, "");
+    const esp_err_t ret = hid_mouse_decode(state, report.data, report.length, event);
+    hid_host_device_report_release(hid_dev_handle, &report);
+    return ret;
+}
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -12,18 +13,34 @@
 #include <sys/param.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "usb/usb_host.h"
+#include "usb/usb_host_shared_client.h"
+#include "usb/usb_host_urb_pool.h"
+#include "usb/usb_host_class_trace.h"
+#include "usb/usb_class_stats.h"
+#include "usb/usb_host_bw.h"
 
 #include "usb/hid_host.h"
+#include "hid_host_descriptor_parsing.h"
+#include "hid_report_desc_cache.h"
+
+// Definition of USB_EP_DESC_GET_MULT for IDF versions that don't have it
+#ifndef USB_EP_DESC_GET_MULT
+#define USB_EP_DESC_GET_MULT(desc_ptr) (((desc_ptr)->wMaxPacketSize & 0x1800) >> 11)
+#endif
 
 // HID spinlock
 static portMUX_TYPE hid_lock = portMUX_INITIALIZER_UNLOCKED;
 #define HID_ENTER_CRITICAL()    portENTER_CRITICAL(&hid_lock)
 #define HID_EXIT_CRITICAL()     portEXIT_CRITICAL(&hid_lock)
 
+#define HID_TRACE(event, xfer) USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_HID, USB_HOST_CLASS_TRACE_##event, xfer)
+
 // HID verification macros
 #define HID_GOTO_ON_FALSE_CRITICAL(exp, err)    \
     do {                                        \
@@ -52,19 +69,6 @@ static portMUX_TYPE hid_lock = portMUX_INITIALIZER_UNLOCKED;
 
 #define HID_RETURN_ON_INVALID_ARG(exp) ESP_RETURN_ON_FALSE((exp) != NULL, ESP_ERR_INVALID_ARG, TAG, "Argument error")
 
-// USB Descriptor parsing helping macros
-#define GET_NEXT_INTERFACE_DESC(p, max_len, offs)                                                \
-    ((const usb_intf_desc_t *)usb_parse_next_descriptor_of_type((const usb_standard_desc_t *)p,  \
-                                                                max_len,                         \
-                                                                USB_B_DESCRIPTOR_TYPE_INTERFACE, \
-                                                                &(offs)))
-
-#define GET_NEXT_HID_DESC(p, max_len, offs)                                                      \
-    ((const hid_descriptor_t *)usb_parse_next_descriptor_of_type((const usb_standard_desc_t *)p, \
-                                                                max_len,                         \
-                                                                HID_CLASS_DESCRIPTOR_TYPE_HID,   \
-                                                                &(offs)))
-
 static const char *TAG = "hid-host";
 
 #define DEFAULT_TIMEOUT_MS  (5000)
@@ -80,6 +84,8 @@ typedef struct hid_host_device {
     usb_transfer_t *ctrl_xfer;                  /**< Pointer to control transfer buffer */
     usb_device_handle_t dev_hdl;                /**< USB device handle */
     uint8_t dev_addr;                           /**< USB device address */
+    struct hid_interface *prefetch_iface;       /**< Interface whose report descriptor is being prefetched */
+    bool gone;                                  /**< Device disconnected during the prefetch, uninstalled when the prefetch returns */
 } hid_device_t;
 
 /**
@@ -94,6 +100,62 @@ typedef enum {
     HID_INTERFACE_STATE_MAX
 } hid_iface_state_t;
 
+/**
+ * @brief Lock-free queue of input reports
+ *
+ * Single producer (IN transfer callback) and single consumer (hid_host_device_report_borrow() caller).
+ * head and tail are free running report counters, each slot keeps one report of up to ep_in_xfer_size bytes.
+ */
+typedef struct hid_report_queue {
+    atomic_uint head;                       /**< Reports pushed. Written by producer */
+    atomic_uint tail;                       /**< Reports released. Written by consumer */
+    atomic_bool consumer_waiting;           /**< Consumer waits for report_ready */
+    uint8_t slot_num;                       /**< Number of slots */
+    uint32_t dropped;                       /**< Reports dropped since the last pushed one. Written by producer */
+    SemaphoreHandle_t report_ready;         /**< Given after push if the consumer waits */
+    hid_host_report_t *slots;               /**< Report of each slot, data points into buf */
+    uint8_t *buf;                           /**< Data of all slots */
+} hid_report_queue_t;
+
+/**
+ * @brief HID Interface statistics
+ *
+ * Updated in the IN transfer callback, read by hid_host_device_get_stats() under HID spinlock.
+ */
+typedef struct {
+    hid_host_stats_t pub;                   /**< Statistics returned to the user */
+    int64_t last_report_us;                 /**< Time of the last input report, 0 before the first one */
+    uint64_t report_interval_sum_us;        /**< Sum of the times between input reports */
+} hid_iface_stats_t;
+
+/**
+ * @brief Change-only filter of input reports
+ *
+ * Accessed only from the IN transfer callback, callbacks of one client are serialized.
+ */
+typedef struct {
+    bool valid;                             /**< last holds a delivered report */
+    uint16_t last_len;                      /**< Length of the last delivered report */
+    int64_t last_us;                        /**< Time of the last delivered report */
+    int64_t keepalive_us;                   /**< Unchanged report is delivered after this time without delivery, 0 never */
+    uint8_t last[];                         /**< Last delivered report, up to ep_in_xfer_size bytes */
+} hid_report_filter_t;
+
+/**
+ * @brief OUT transfers of an interface
+ *
+ * Output reports in flight when the interface is released are cancelled. They are returned later in the client task,
+ * so the last returned transfer frees all OUT transfers, even if the interface is gone by then.
+ */
+typedef struct hid_out_xfers {
+    struct hid_interface *iface;            /**< Interface of the transfers, not valid once released */
+    QueueHandle_t free_queue;               /**< OUT transfers not in flight */
+    uint8_t num;                            /**< Number of OUT transfers */
+    uint8_t in_flight;                      /**< Submitted OUT transfers not returned yet. Under HID spinlock */
+    bool released;                          /**< Interface was released. Under HID spinlock */
+    usb_transfer_t *xfer[HID_HOST_OUT_XFER_NUM_MAX]; /**< OUT transfers */
+} hid_out_xfers_t;
+
 /**
  * @brief HID Interface structure in device to interact with. After HID device opening keeps the interface configuration
  *
@@ -104,10 +166,30 @@ typedef struct hid_interface {
     hid_host_dev_params_t dev_params;       /**< USB device parameters */
     uint8_t ep_in;                          /**< Interrupt IN EP number */
     uint16_t ep_in_mps;                     /**< Interrupt IN max size */
+    uint8_t ep_in_mult;                     /**< Interrupt IN additional transactions per microframe, high-bandwidth HS endpoint if not 0 */
+    uint16_t ep_in_xfer_size;               /**< Interrupt IN transfer size, max size of all transactions of one (micro)frame */
+    uint8_t ep_out;                         /**< Interrupt OUT EP number, 0 if not present */
+    uint16_t ep_out_mps;                    /**< Interrupt OUT max size */
     uint8_t country_code;                   /**< Country code */
     uint16_t report_desc_size;              /**< Size of Report */
     uint8_t *report_desc;                   /**< Pointer to HID Report */
-    usb_transfer_t *in_xfer;                /**< Pointer to IN transfer buffer */
+    hid_report_map_t *report_map;           /**< Compiled HID Report, NULL if not requested at open */
+    hid_desc_cache_entry_t *desc_cache;     /**< Cache entry owning report_desc and report_map, NULL if they are owned by the interface */
+    usb_transfer_t *in_xfer[HID_HOST_IN_XFER_NUM_MAX]; /**< IN transfers, all submitted while the interface is active */
+    uint8_t in_xfer_num;                    /**< Number of IN transfers */
+    usb_transfer_t *report_xfer;            /**< IN transfer with the input report being delivered */
+    uint8_t report_queue_len;               /**< Number of report queue slots, 0 if not used */
+    hid_report_queue_t *report_queue;       /**< Input report queue, NULL if not used */
+    uint8_t out_xfer_num;                   /**< Number of OUT transfers */
+    hid_out_xfers_t *out_xfers;             /**< OUT transfers for output reports, NULL if there is no EP OUT or the interface is not claimed */
+    uint8_t ep_in_interval;                 /**< Interrupt IN bInterval */
+    bool collect_stats;                     /**< Collect statistics, from device config */
+    hid_iface_stats_t *stats;               /**< Statistics, NULL if not collected */
+    bool filter_reports;                    /**< Filter unchanged input reports, from device config */
+    uint32_t filter_keepalive_ms;           /**< Keepalive of the report filter, from device config */
+    hid_report_filter_t *report_filter;     /**< Change-only filter of input reports, NULL if not used */
+    usb_class_stats_entry_t *class_stats;   /**< Entry in usb_class_stats registry, NULL if not counted */
+    usb_host_bw_hdl_t bw_hdl;               /**< Periodic bandwidth of Interrupt IN EP, NULL while not polled */
     hid_host_interface_event_cb_t user_cb;  /**< Interface application callback */
     void *user_cb_arg;                      /**< Interface application callback arg */
     hid_iface_state_t state;                /**< Interface state */
@@ -122,11 +204,13 @@ typedef struct {
     STAILQ_HEAD(devices, hid_host_device) hid_devices_tailq;    /**< STAILQ of HID interfaces */
     STAILQ_HEAD(interfaces, hid_interface) hid_ifaces_tailq;    /**< STAILQ of HID interfaces */
     usb_host_client_handle_t client_handle;                     /**< Client task handle */
+    usb_host_shared_client_driver_handle_t shared_driver;       /**< Handle in the shared client, NULL if the driver has its own client */
     hid_host_driver_event_cb_t user_cb;                         /**< User application callback */
     void *user_arg;                                             /**< User application callback args */
     bool event_handling_started;                                /**< Events handler started flag */
     SemaphoreHandle_t all_events_handled;                       /**< Events handler semaphore */
     volatile bool end_client_event_handling;                    /**< Client event handling flag */
+    bool prefetch_report_desc;                                  /**< Prefetch report descriptors at connection */
 } hid_driver_t;
 
 static hid_driver_t *s_hid_driver;                              /**< Internal pointer to HID driver */
@@ -141,6 +225,8 @@ static esp_err_t hid_host_install_device(uint8_t dev_addr,
 
 static esp_err_t hid_host_uninstall_device(hid_device_t *hid_device);
 
+static void hid_host_prefetch_report_desc(hid_device_t *hid_device);
+
 // --------------------------- Internal Logic ----------------------------------
 /**
  * @brief HID class specific request
@@ -245,51 +331,6 @@ static hid_iface_t *get_iface_by_handle(hid_host_device_handle_t hid_dev_handle)
     return hid_iface;
 }
 
-/**
- * @brief Returns pointer to first IN Endpoint descriptor
- *
- * @param[in] iface_desc    Pointer to Interface Descriptor
- * @param[in] total_length  Total length of configuration descriptor
- * @return usb_ep_desc_t Pointer to EP IN Descriptor
- */
-static inline const usb_ep_desc_t *get_iface_ep_in(const usb_intf_desc_t *iface_desc,
-        const size_t total_length)
-{
-    assert(iface_desc);
-    const usb_ep_desc_t *ep_desc = NULL;
-    for (int i = 0; i < iface_desc->bNumEndpoints; i++) {
-        int ep_offset = 0;
-        ep_desc = usb_parse_endpoint_descriptor_by_index(iface_desc, i, total_length, &ep_offset);
-        if (ep_desc) {
-            if (USB_EP_DESC_GET_EP_DIR(ep_desc)) {
-                return ep_desc;
-            }
-        }
-    }
-    return NULL;
-}
-
-/**
- * @brief Check HID interface descriptor present
- *
- * @param[in] config_desc  Pointer to Configuration Descriptor
- * @return esp_err_t
- */
-static bool hid_interface_present(const usb_config_desc_t *config_desc)
-{
-    assert(config_desc);
-    int offset = 0;
-    int total_len = config_desc->wTotalLength;
-    const usb_intf_desc_t *iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, total_len, offset);
-    while (iface_desc != NULL) {
-        if (USB_CLASS_HID == iface_desc->bInterfaceClass) {
-            return true;
-        }
-        iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_len, offset);
-    }
-    return false;
-}
-
 /**
  * @brief HID Interface user callback function.
  *
@@ -336,13 +377,15 @@ static inline void hid_host_user_device_callback(hid_iface_t *iface,
  * @param[in] hid_device    HID device handle
  * @param[in] iface_desc  Pointer to an Interface descriptor
  * @param[in] hid_desc    Pointer to an HID device descriptor
- * @param[in] ep_desc     Pointer to an EP descriptor
+ * @param[in] ep_in_desc  Pointer to an EP IN descriptor
+ * @param[in] ep_out_desc Pointer to an EP OUT descriptor, NULL if the interface has no EP OUT
  * @return esp_err_t
  */
 static esp_err_t hid_host_add_interface(hid_device_t *hid_device,
                                         const usb_intf_desc_t *iface_desc,
                                         const hid_descriptor_t *hid_desc,
-                                        const usb_ep_desc_t *ep_in_desc)
+                                        const usb_ep_desc_t *ep_in_desc,
+                                        const usb_ep_desc_t *ep_out_desc)
 {
     hid_iface_t *hid_iface = calloc(1, sizeof(hid_iface_t));
 
@@ -372,12 +415,21 @@ static esp_err_t hid_host_add_interface(hid_device_t *hid_device,
                 (ep_in_desc->bmAttributes & USB_B_ENDPOINT_ADDRESS_EP_NUM_MASK) ) {
             hid_iface->ep_in = ep_in_desc->bEndpointAddress;
             hid_iface->ep_in_mps = USB_EP_DESC_GET_MPS(ep_in_desc);
+            hid_iface->ep_in_mult = USB_EP_DESC_GET_MULT(ep_in_desc);
+            hid_iface->ep_in_xfer_size = hid_iface->ep_in_mps * (hid_iface->ep_in_mult + 1);
+            hid_iface->ep_in_interval = ep_in_desc->bInterval;
         } else {
             ESP_EARLY_LOGE(TAG, "HID device EP IN %#X configuration error",
                            ep_in_desc->bEndpointAddress);
         }
     }
 
+    // Optional EP OUT
+    if (ep_out_desc) {
+        hid_iface->ep_out = ep_out_desc->bEndpointAddress;
+        hid_iface->ep_out_mps = USB_EP_DESC_GET_MPS(ep_out_desc);
+    }
+
     if (iface_desc && hid_desc && ep_in_desc) {
         hid_iface->state = HID_INTERFACE_STATE_IDLE;
     }
@@ -433,49 +485,35 @@ static void hid_host_notify_interface_connected(hid_device_t *hid_device)
  * @brief Create a list of available interfaces in RAM
  *
  * @param[in] hid_device  Pointer to HID device structure
- * @param[in] dev_addr    USB device physical address
- * @param[in] sub_class   USB HID SubClass value
+ * @param[in] table       Table of HID interfaces from hid_config_desc_parse()
+ * @param[in] num         Number of HID interfaces
  * @return esp_err_t
  */
 static esp_err_t hid_host_interface_list_create(hid_device_t *hid_device,
-        const usb_config_desc_t *config_desc)
+        const hid_iface_desc_t *table,
+        size_t num)
 {
     assert(hid_device);
-    assert(config_desc);
-    size_t total_length = config_desc->wTotalLength;
-    const usb_intf_desc_t *iface_desc = NULL;
-    const hid_descriptor_t *hid_desc = NULL;
-    const usb_ep_desc_t *ep_in_desc = NULL;
-    int iface_offset = 0;
-    int hid_desc_offset = 0;
-
-    // Get first Interface descriptor
-    iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, total_length, iface_offset);
-    // For every Interface
-    while (iface_desc != NULL) {
-
-        hid_desc = NULL;
-        hid_desc_offset = iface_offset;
-        ep_in_desc = NULL;
-
-        if (USB_CLASS_HID == iface_desc->bInterfaceClass) {
-            ESP_LOGD(TAG, "Found HID, bInterfaceNumber=%d", iface_desc->bInterfaceNumber);
-            hid_desc = GET_NEXT_HID_DESC(iface_desc, total_length, hid_desc_offset);
-            if (hid_desc) {
-                ep_in_desc = get_iface_ep_in(iface_desc, total_length);
-                if (ep_in_desc) {
-                    HID_RETURN_ON_ERROR( hid_host_add_interface(hid_device,
-                                         iface_desc,
-                                         hid_desc,
-                                         ep_in_desc),
-                                         "Unable to add HID Interface to the RAM list");
-                }
-            }
-        } // HID Interface
-        iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_offset);
+
+    for (size_t i = 0; i < num; i++) {
+        const hid_iface_desc_t *entry = &table[i];
+        ESP_LOGD(TAG, "Found HID, bInterfaceNumber=%d", entry->iface_desc->bInterfaceNumber);
+        if (entry->hid_desc && entry->ep_in_desc) {
+            HID_RETURN_ON_ERROR( hid_host_add_interface(hid_device,
+                                 entry->iface_desc,
+                                 entry->hid_desc,
+                                 entry->ep_in_desc,
+                                 entry->ep_out_desc),
+                                 "Unable to add HID Interface to the RAM list");
+        }
     }
 
-    hid_host_notify_interface_connected(hid_device);
+    if (s_hid_driver->prefetch_report_desc) {
+        // User is notified when all report descriptors are received
+        hid_host_prefetch_report_desc(hid_device);
+    } else {
+        hid_host_notify_interface_connected(hid_device);
+    }
 
     return ESP_OK;
 }
@@ -484,19 +522,25 @@ static esp_err_t hid_host_interface_list_create(hid_device_t *hid_device,
  * @brief HID Host initialize device attempt
  *
  * @param[in] dev_addr   USB device physical address
+ * @param[in] index      Index of the active Configuration Descriptor from the shared client probe.
+ *                       NULL: The Configuration Descriptor is indexed here
  * @return true USB device contain HID Interface and device was initialized
  * @return false USB does not contain HID Interface
  */
-static bool hid_host_device_init_attempt(uint8_t dev_addr)
+static bool hid_host_device_init_attempt(uint8_t dev_addr, const usb_host_desc_index_t *index)
 {
     bool is_hid_device = false;
     usb_device_handle_t dev_hdl;
     const usb_config_desc_t *config_desc = NULL;
     hid_device_t *hid_device = NULL;
-
-    if (usb_host_device_open(s_hid_driver->client_handle, dev_addr, &dev_hdl) == ESP_OK) {
-        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK) {
-            is_hid_device = hid_interface_present(config_desc);
+    hid_iface_desc_t *iface_table = NULL;
+    size_t iface_num = 0;
+
+    if (usb_host_shared_client_device_open(s_hid_driver->client_handle, dev_addr, &dev_hdl) == ESP_OK) {
+        if (index) {
+            is_hid_device = (hid_desc_index_parse(index, &iface_table, &iface_num) == ESP_OK) && iface_num;
+        } else if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK) {
+            is_hid_device = (hid_config_desc_parse(config_desc, &iface_table, &iface_num) == ESP_OK) && iface_num;
         }
     }
 
@@ -505,9 +549,10 @@ static bool hid_host_device_init_attempt(uint8_t dev_addr)
         // Proceed, add HID device to the list, get handle if necessary
         ESP_ERROR_CHECK( hid_host_install_device(dev_addr, dev_hdl, &hid_device) );
         // Create Interfaces list for a possibility to claim Interface
-        ESP_ERROR_CHECK( hid_host_interface_list_create(hid_device, config_desc) );
+        ESP_ERROR_CHECK( hid_host_interface_list_create(hid_device, iface_table, iface_num) );
+        free(iface_table);
     } else {
-        usb_host_device_close(s_hid_driver->client_handle, dev_hdl);
+        usb_host_shared_client_device_close(s_hid_driver->client_handle, dev_hdl);
         ESP_LOGW(TAG, "No HID device at USB port %d", dev_addr);
     }
 
@@ -543,6 +588,12 @@ static esp_err_t hid_host_device_disconnected(usb_device_handle_t dev_hdl)
     }
     HID_EXIT_CRITICAL();
 
+    // Control transfer of the prefetch is still queued, the device is uninstalled by prefetch_xfer_done()
+    if (hid_device->prefetch_iface) {
+        hid_device->gone = true;
+        return ESP_OK;
+    }
+
     // Delete HID compliant device
     HID_RETURN_ON_ERROR( hid_host_uninstall_device(hid_device),
                          "Unable to uninstall device");
@@ -559,12 +610,300 @@ static esp_err_t hid_host_device_disconnected(usb_device_handle_t dev_hdl)
 static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
 {
     if (event->event == USB_HOST_CLIENT_EVENT_NEW_DEV) {
-        hid_host_device_init_attempt(event->new_dev.address);
+        hid_host_device_init_attempt(event->new_dev.address, NULL);
     } else if (event->event == USB_HOST_CLIENT_EVENT_DEV_GONE) {
         hid_host_device_disconnected(event->dev_gone.dev_hdl);
     }
 }
 
+static const usb_host_shared_client_match_t hid_match_table[] = {
+    {
+        .match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS,
+        .bInterfaceClass = USB_CLASS_HID,
+    },
+};
+
+/**
+ * @brief USB Host shared client probe, called only for devices with HID interface
+ *
+ * @param[in] probe    New device with its indexed descriptors
+ * @param[in] arg      Argument, does not used
+ */
+static void client_probe_cb(const usb_host_shared_client_probe_t *probe, void *arg)
+{
+    hid_host_device_init_attempt(probe->dev_addr, probe->index);
+}
+
+/**
+ * @brief Delete input report queue
+ *
+ * @param[in] queue  Pointer to report queue, can be NULL
+ */
+static void hid_report_queue_delete(hid_report_queue_t *queue)
+{
+    if (queue) {
+        if (queue->report_ready) {
+            vSemaphoreDelete(queue->report_ready);
+        }
+        free(queue->slots);
+        free(queue->buf);
+        free(queue);
+    }
+}
+
+/**
+ * @brief Create input report queue
+ *
+ * @param[in] slot_num   Number of reports
+ * @param[in] slot_size  Maximum size of one report
+ * @return Pointer to report queue, NULL if out of memory
+ */
+static hid_report_queue_t *hid_report_queue_create(uint8_t slot_num, uint16_t slot_size)
+{
+    hid_report_queue_t *queue = calloc(1, sizeof(hid_report_queue_t));
+    if (queue == NULL) {
+        return NULL;
+    }
+    queue->slot_num = slot_num;
+    queue->report_ready = xSemaphoreCreateBinary();
+    queue->slots = calloc(slot_num, sizeof(hid_host_report_t));
+    queue->buf = malloc((size_t)slot_num * slot_size);
+    if (!queue->report_ready || !queue->slots || !queue->buf) {
+        hid_report_queue_delete(queue);
+        return NULL;
+    }
+    for (int i = 0; i < slot_num; i++) {
+        queue->slots[i].data = queue->buf + i * slot_size;
+    }
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->consumer_waiting, false);
+    return queue;
+}
+
+/**
+ * @brief Copy input report of a completed transfer to the report queue
+ *
+ * If the queue is full, the report is dropped and counted in the next pushed report.
+ *
+ * @param[in] queue    Pointer to report queue
+ * @param[in] in_xfer  Completed IN transfer
+ * @return true if the report was queued, false if it was dropped
+ */
+static bool hid_report_queue_push(hid_report_queue_t *queue, const usb_transfer_t *in_xfer)
+{
+    const unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&queue->tail, memory_order_acquire) >= queue->slot_num) {
+        queue->dropped++;
+        return false;
+    }
+    hid_host_report_t *slot = &queue->slots[head % queue->slot_num];
+    memcpy((uint8_t *)slot->data, in_xfer->data_buffer, in_xfer->actual_num_bytes);
+    slot->length = in_xfer->actual_num_bytes;
+    slot->timestamp_us = esp_timer_get_time();
+    slot->dropped = queue->dropped;
+    queue->dropped = 0;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    if (atomic_exchange(&queue->consumer_waiting, false)) {
+        xSemaphoreGive(queue->report_ready);
+    }
+    return true;
+}
+
+/**
+ * @brief Check whether an input report repeats the last delivered report
+ *
+ * Unchanged report is suppressed unless keepalive_us passed since the last delivered report.
+ * Delivered report becomes the reference for the next ones.
+ *
+ * @param[in] filter   Pointer to report filter
+ * @param[in] in_xfer  Completed IN transfer
+ * @return true if the report shall not be delivered
+ */
+static bool hid_report_filter_suppress(hid_report_filter_t *filter, const usb_transfer_t *in_xfer)
+{
+    const int64_t now_us = esp_timer_get_time();
+    const uint16_t len = in_xfer->actual_num_bytes;
+    if (filter->valid && (len == filter->last_len) && (0 == memcmp(filter->last, in_xfer->data_buffer, len))
+            && ((0 == filter->keepalive_us) || (now_us - filter->last_us < filter->keepalive_us))) {
+        return true;
+    }
+    memcpy(filter->last, in_xfer->data_buffer, len);
+    filter->last_len = len;
+    filter->last_us = now_us;
+    filter->valid = true;
+    return false;
+}
+
+/**
+ * @brief Create statistics of the interface
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t hid_iface_stats_create(hid_iface_t *iface)
+{
+    usb_device_info_t dev_info;
+    HID_RETURN_ON_ERROR( usb_host_device_info(iface->parent->dev_hdl, &dev_info),
+                         "Unable to get device info");
+
+    iface->stats = calloc(1, sizeof(hid_iface_stats_t));
+    HID_RETURN_ON_FALSE(iface->stats,
+                        ESP_ERR_NO_MEM,
+                        "Unable to allocate statistics");
+
+    // bInterval is in frames for Low and Full speed, an exponent of microframes for High speed
+    if (USB_SPEED_HIGH == dev_info.speed) {
+        iface->stats->pub.polling_interval_us = 125 << (MIN(MAX(iface->ep_in_interval, 1), 16) - 1);
+    } else {
+        iface->stats->pub.polling_interval_us = iface->ep_in_interval * 1000;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Update statistics with a delivered input report
+ *
+ * The endpoint stays polled while the user callback runs as long as other IN transfers are submitted.
+ * Callbacks longer than the polling intervals covered by the other transfers are counted as overruns,
+ * every further polling interval as a possibly dropped report.
+ *
+ * @param[in] iface            Pointer to Interface structure
+ * @param[in] report_us        Time of the input report, before the user callback
+ * @param[in] callback_end_us  Time the user callback returned
+ * @param[in] queue_dropped    Report was not queued, report queue was full
+ */
+static void hid_iface_stats_update(hid_iface_t *iface, int64_t report_us, int64_t callback_end_us, bool queue_dropped)
+{
+    hid_iface_stats_t *stats = iface->stats;
+    hid_host_stats_t *pub = &stats->pub;
+    const uint32_t callback_us = callback_end_us - report_us;
+    const uint32_t covered_us = (iface->in_xfer_num - 1) * pub->polling_interval_us;
+
+    unsigned bin = 0;
+    while ((bin < HID_HOST_STATS_CB_HIST_BINS - 1) && (callback_us >= (50U << bin))) {
+        bin++;
+    }
+
+    HID_ENTER_CRITICAL();
+    pub->reports++;
+    if (stats->last_report_us) {
+        const uint32_t interval_us = report_us - stats->last_report_us;
+        stats->report_interval_sum_us += interval_us;
+        if ((0 == pub->report_interval_min_us) || (interval_us < pub->report_interval_min_us)) {
+            pub->report_interval_min_us = interval_us;
+        }
+    }
+    stats->last_report_us = report_us;
+    pub->callback_time_max_us = MAX(pub->callback_time_max_us, callback_us);
+    pub->callback_time_hist[bin]++;
+    if (pub->polling_interval_us && (callback_us > covered_us)) {
+        pub->callback_overruns++;
+        pub->reports_dropped += (callback_us - covered_us) / pub->polling_interval_us;
+    }
+    if (queue_dropped) {
+        pub->reports_dropped++;
+    }
+    HID_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Free OUT transfers
+ *
+ * @param[in] out_xfers   Pointer to OUT transfers, none of them in flight. Can be NULL
+ */
+static void hid_out_xfers_free(hid_out_xfers_t *out_xfers)
+{
+    if (out_xfers == NULL) {
+        return;
+    }
+    for (int i = 0; i < out_xfers->num; i++) {
+        if (out_xfers->xfer[i]) {
+            usb_host_urb_pool_transfer_free(out_xfers->xfer[i]);
+        }
+    }
+    if (out_xfers->free_queue) {
+        vQueueDelete(out_xfers->free_queue);
+    }
+    free(out_xfers);
+}
+
+/**
+ * @brief HID OUT Transfer complete callback
+ *
+ * Returns the transfer to the free OUT transfers of the interface.
+ * If the interface was released, the last returned transfer frees all OUT transfers.
+ *
+ * @param[in] out_xfer  Pointer to transfer data structure
+ */
+static void out_xfer_done(usb_transfer_t *out_xfer)
+{
+    assert(out_xfer);
+    assert(out_xfer->context);
+
+    hid_out_xfers_t *out_xfers = (hid_out_xfers_t *) out_xfer->context;
+    HID_TRACE(COMPLETE, out_xfer);
+
+    HID_ENTER_CRITICAL();
+    bool released = out_xfers->released;
+    HID_EXIT_CRITICAL();
+    if (!released) {
+        hid_iface_t *iface = out_xfers->iface;
+        if (out_xfer->status != USB_TRANSFER_STATUS_NO_DEVICE && out_xfer->status != USB_TRANSFER_STATUS_CANCELED) {
+            USB_CLASS_STATS_XFER(iface->class_stats, out_xfer->actual_num_bytes, out_xfer->status == USB_TRANSFER_STATUS_COMPLETED);
+        }
+        xQueueSend(out_xfers->free_queue, &out_xfer, 0);
+    }
+
+    HID_ENTER_CRITICAL();
+    out_xfers->in_flight--;
+    released = out_xfers->released;
+    const bool last = released && (out_xfers->in_flight == 0);
+    HID_EXIT_CRITICAL();
+    if (last) {
+        hid_out_xfers_free(out_xfers);
+    }
+    if (released) {
+        return;
+    }
+
+    switch (out_xfer->status) {
+    case USB_TRANSFER_STATUS_COMPLETED:
+    case USB_TRANSFER_STATUS_NO_DEVICE:
+    case USB_TRANSFER_STATUS_CANCELED:
+        return;
+    default:
+        break;
+    }
+
+    ESP_LOGE(TAG, "OUT transfer failed, status %d", out_xfer->status);
+    hid_host_user_interface_callback(out_xfers->iface, HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR);
+}
+
+/**
+ * @brief Release OUT transfers of the interface
+ *
+ * Transfers are freed now, or by out_xfer_done() of the last transfer in flight.
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void hid_host_interface_release_out_xfers(hid_iface_t *iface)
+{
+    hid_out_xfers_t *out_xfers = iface->out_xfers;
+    if (out_xfers == NULL) {
+        return;
+    }
+    iface->out_xfers = NULL;
+
+    HID_ENTER_CRITICAL();
+    out_xfers->released = true;
+    const bool idle = (out_xfers->in_flight == 0);
+    HID_EXIT_CRITICAL();
+    if (idle) {
+        hid_out_xfers_free(out_xfers);
+    }
+}
+
 /**
  * @brief HID Host claim Interface and prepare transfer, change state to READY
  *
@@ -573,17 +912,107 @@ static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
  */
 static esp_err_t hid_host_interface_claim_and_prepare_transfer(hid_iface_t *iface)
 {
+    esp_err_t ret;
     HID_RETURN_ON_ERROR( usb_host_interface_claim( s_hid_driver->client_handle,
                          iface->parent->dev_hdl,
                          iface->dev_params.iface_num, 0),
                          "Unable to claim Interface");
 
-    HID_RETURN_ON_ERROR( usb_host_transfer_alloc(iface->ep_in_mps, 0, &iface->in_xfer),
-                         "Unable to allocate transfer buffer for EP IN");
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        HID_GOTO_ON_ERROR( usb_host_urb_pool_transfer_alloc(iface->ep_in_xfer_size, 0, &iface->in_xfer[i]),
+                           "Unable to allocate transfer buffer for EP IN");
+    }
+
+    if (iface->report_queue_len) {
+        iface->report_queue = hid_report_queue_create(iface->report_queue_len, iface->ep_in_xfer_size);
+        HID_GOTO_ON_FALSE(iface->report_queue,
+                          ESP_ERR_NO_MEM,
+                          "Unable to allocate report queue");
+    }
+
+    if (iface->collect_stats) {
+        HID_GOTO_ON_ERROR( hid_iface_stats_create(iface),
+                           "Unable to create statistics");
+    }
+
+    if (iface->filter_reports) {
+        iface->report_filter = calloc(1, sizeof(hid_report_filter_t) + iface->ep_in_xfer_size);
+        HID_GOTO_ON_FALSE(iface->report_filter,
+                          ESP_ERR_NO_MEM,
+                          "Unable to allocate report filter");
+        iface->report_filter->keepalive_us = (int64_t)iface->filter_keepalive_ms * 1000;
+    }
+
+    const usb_class_stats_info_t class_stats_info = {
+        .driver = "hid",
+        .dev_addr = iface->dev_params.addr,
+        .intf_num = iface->dev_params.iface_num,
+    };
+    usb_class_stats_register(&class_stats_info, &iface->class_stats); // Interface is not counted on failure
+    // Buffers live as long as the interface is claimed, they are released from the accounting when the entry is unregistered
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        USB_CLASS_STATS_MEM_XFER(iface->class_stats, iface->in_xfer[i]);
+    }
+    if (iface->report_queue) {
+        USB_CLASS_STATS_MEM_ALLOC(iface->class_stats,
+                                  sizeof(hid_report_queue_t) + iface->report_queue_len * (sizeof(hid_host_report_t) + iface->ep_in_xfer_size),
+                                  MALLOC_CAP_DEFAULT);
+    }
+    if (iface->stats) {
+        USB_CLASS_STATS_MEM_ALLOC(iface->class_stats, sizeof(hid_iface_stats_t), MALLOC_CAP_DEFAULT);
+    }
+    if (iface->report_filter) {
+        USB_CLASS_STATS_MEM_ALLOC(iface->class_stats, sizeof(hid_report_filter_t) + iface->ep_in_xfer_size, MALLOC_CAP_DEFAULT);
+    }
+
+    if (iface->ep_out) {
+        hid_out_xfers_t *out_xfers = calloc(1, sizeof(hid_out_xfers_t));
+        HID_GOTO_ON_FALSE(out_xfers,
+                          ESP_ERR_NO_MEM,
+                          "Unable to allocate OUT transfers");
+        iface->out_xfers = out_xfers;
+        out_xfers->iface = iface;
+        out_xfers->num = iface->out_xfer_num;
+        out_xfers->free_queue = xQueueCreate(out_xfers->num, sizeof(usb_transfer_t *));
+        HID_GOTO_ON_FALSE(out_xfers->free_queue,
+                          ESP_ERR_NO_MEM,
+                          "Unable to create OUT transfer queue");
+        for (int i = 0; i < out_xfers->num; i++) {
+            HID_GOTO_ON_ERROR( usb_host_urb_pool_transfer_alloc(iface->ep_out_mps, 0, &out_xfers->xfer[i]),
+                               "Unable to allocate transfer buffer for EP OUT");
+            out_xfers->xfer[i]->device_handle = iface->parent->dev_hdl;
+            out_xfers->xfer[i]->callback = out_xfer_done;
+            out_xfers->xfer[i]->context = out_xfers;
+            out_xfers->xfer[i]->timeout_ms = DEFAULT_TIMEOUT_MS;
+            out_xfers->xfer[i]->bEndpointAddress = iface->ep_out;
+            xQueueSend(out_xfers->free_queue, &out_xfers->xfer[i], 0);
+            USB_CLASS_STATS_MEM_XFER(iface->class_stats, out_xfers->xfer[i]);
+        }
+    }
 
     // Change state
     iface->state = HID_INTERFACE_STATE_READY;
     return ESP_OK;
+
+fail:
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        if (iface->in_xfer[i]) {
+            usb_host_urb_pool_transfer_free(iface->in_xfer[i]);
+            iface->in_xfer[i] = NULL;
+        }
+    }
+    hid_report_queue_delete(iface->report_queue);
+    iface->report_queue = NULL;
+    free(iface->stats);
+    iface->stats = NULL;
+    free(iface->report_filter);
+    iface->report_filter = NULL;
+    usb_class_stats_unregister(iface->class_stats);
+    iface->class_stats = NULL;
+    hid_out_xfers_free(iface->out_xfers);
+    iface->out_xfers = NULL;
+    usb_host_interface_release(s_hid_driver->client_handle, iface->parent->dev_hdl, iface->dev_params.iface_num);
+    return ret;
 }
 
 /**
@@ -601,18 +1030,84 @@ static esp_err_t hid_host_interface_release_and_free_transfer(hid_iface_t *iface
                         ESP_ERR_NOT_FOUND,
                         "Interface handle not found");
 
+    // Output reports still in flight are cancelled, they are returned later in the client task
+    if (iface->out_xfers) {
+        HID_ENTER_CRITICAL();
+        const bool in_flight = (iface->out_xfers->in_flight != 0);
+        HID_EXIT_CRITICAL();
+        if (in_flight) {
+            HID_RETURN_ON_ERROR( usb_host_endpoint_halt(iface->parent->dev_hdl, iface->ep_out),
+                                 "Unable to HALT EP");
+            HID_RETURN_ON_ERROR( usb_host_endpoint_flush(iface->parent->dev_hdl, iface->ep_out),
+                                 "Unable to FLUSH EP");
+            usb_host_endpoint_clear(iface->parent->dev_hdl, iface->ep_out);
+        }
+    }
+
     HID_RETURN_ON_ERROR( usb_host_interface_release(s_hid_driver->client_handle,
                          iface->parent->dev_hdl,
                          iface->dev_params.iface_num),
                          "Unable to release HID Interface");
 
-    ESP_ERROR_CHECK( usb_host_transfer_free(iface->in_xfer) );
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        ESP_ERROR_CHECK( usb_host_urb_pool_transfer_free(iface->in_xfer[i]) );
+        iface->in_xfer[i] = NULL;
+    }
+    iface->report_xfer = NULL;
+    hid_report_queue_delete(iface->report_queue);
+    iface->report_queue = NULL;
+    hid_host_interface_release_out_xfers(iface);
+    free(iface->stats);
+    iface->stats = NULL;
+    free(iface->report_filter);
+    iface->report_filter = NULL;
+    usb_class_stats_unregister(iface->class_stats);
+    iface->class_stats = NULL;
 
     // Change state
     iface->state = HID_INTERFACE_STATE_IDLE;
     return ESP_OK;
 }
 
+/**
+ * @brief Reserve periodic bandwidth for polling the Interrupt IN EP
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_interface_bw_reserve(hid_iface_t *iface)
+{
+    usb_device_info_t dev_info;
+    HID_RETURN_ON_ERROR( usb_host_device_info(iface->parent->dev_hdl, &dev_info),
+                         "Unable to get device info");
+
+    const usb_ep_desc_t ep_desc = {
+        .bLength = USB_EP_DESC_SIZE,
+        .bDescriptorType = USB_B_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = iface->ep_in,
+        .bmAttributes = USB_BM_ATTRIBUTES_XFER_INT,
+        .wMaxPacketSize = iface->ep_in_mps | (iface->ep_in_mult << 11),
+        .bInterval = iface->ep_in_interval,
+    };
+    const usb_host_bw_request_t request = {
+        .root_port = 0,
+        .speed = dev_info.speed,
+        .ep_desc = &ep_desc,
+    };
+    return usb_host_bw_reserve(&request, &iface->bw_hdl);
+}
+
+/**
+ * @brief Release periodic bandwidth of the Interrupt IN EP
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void hid_host_interface_bw_release(hid_iface_t *iface)
+{
+    usb_host_bw_release(iface->bw_hdl);
+    iface->bw_hdl = NULL;
+}
+
 /**
  * @brief Disable active interface
  *
@@ -637,6 +1132,7 @@ static esp_err_t hid_host_disable_interface(hid_iface_t *iface)
     HID_RETURN_ON_ERROR( usb_host_endpoint_flush(iface->parent->dev_hdl, iface->ep_in),
                          "Unable to FLUSH EP");
     usb_host_endpoint_clear(iface->parent->dev_hdl, iface->ep_in);
+    hid_host_interface_bw_release(iface);
 
     iface->state = HID_INTERFACE_STATE_READY;
 
@@ -646,6 +1142,9 @@ static esp_err_t hid_host_disable_interface(hid_iface_t *iface)
 /**
  * @brief HID IN Transfer complete callback
  *
+ * Transfers of the endpoint complete in the order they were submitted, so input reports are delivered in order.
+ * While the user handles one report, the other transfers of the interface keep polling the endpoint.
+ *
  * @param[in] transfer  Pointer to transfer data structure
  */
 static void in_xfer_done(usb_transfer_t *in_xfer)
@@ -654,14 +1153,42 @@ static void in_xfer_done(usb_transfer_t *in_xfer)
     assert(in_xfer->context);
 
     hid_iface_t *iface = (hid_iface_t *) in_xfer->context;
+    HID_TRACE(COMPLETE, in_xfer);
 
     switch (in_xfer->status) {
-    case USB_TRANSFER_STATUS_COMPLETED:
+    case USB_TRANSFER_STATUS_COMPLETED: {
+        USB_CLASS_STATS_XFER(iface->class_stats, in_xfer->actual_num_bytes, true);
+        if (iface->report_filter && hid_report_filter_suppress(iface->report_filter, in_xfer)) {
+            if (iface->stats) {
+                HID_ENTER_CRITICAL();
+                iface->stats->pub.reports_filtered++;
+                HID_EXIT_CRITICAL();
+            }
+            HID_TRACE(RESUBMIT, in_xfer);
+            usb_host_transfer_submit(in_xfer);
+            return;
+        }
+        const bool queue_dropped = iface->report_queue && !hid_report_queue_push(iface->report_queue, in_xfer);
+        if (iface->report_queue) {
+            USB_CLASS_STATS_DROP(iface->class_stats, queue_dropped);
+            USB_CLASS_STATS_QUEUE(iface->class_stats, atomic_load(&iface->report_queue->head) - atomic_load(&iface->report_queue->tail));
+        }
+        const int64_t report_us = iface->stats ? esp_timer_get_time() : 0;
         // Notify user
+        iface->report_xfer = in_xfer;
+        HID_TRACE(CB_ENTER, in_xfer);
+        USB_CLASS_STATS_CB_ENTER(iface->class_stats);
         hid_host_user_interface_callback(iface, HID_HOST_INTERFACE_EVENT_INPUT_REPORT);
+        USB_CLASS_STATS_CB_EXIT(iface->class_stats);
+        HID_TRACE(CB_EXIT, in_xfer);
+        if (iface->stats) {
+            hid_iface_stats_update(iface, report_us, esp_timer_get_time(), queue_dropped);
+        }
         // Relaunch transfer
+        HID_TRACE(RESUBMIT, in_xfer);
         usb_host_transfer_submit(in_xfer);
         return;
+    }
     case USB_TRANSFER_STATUS_NO_DEVICE:
     case USB_TRANSFER_STATUS_CANCELED:
         // User is notified about device disconnection from usb_event_cb
@@ -673,6 +1200,12 @@ static void in_xfer_done(usb_transfer_t *in_xfer)
     }
 
     ESP_LOGE(TAG, "Transfer failed, status %d", in_xfer->status);
+    USB_CLASS_STATS_XFER(iface->class_stats, 0, false);
+    if (iface->stats) {
+        HID_ENTER_CRITICAL();
+        iface->stats->pub.transfer_errors++;
+        HID_EXIT_CRITICAL();
+    }
     // Notify user about transfer or any other error
     hid_host_user_interface_callback(iface, HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR);
 }
@@ -762,6 +1295,35 @@ static esp_err_t hid_control_transfer(hid_device_t *hid_device,
     return ESP_OK;
 }
 
+/**
+ * @brief Reallocate control transfer if its buffer is too small
+ *
+ * Use only with HID device locked
+ *
+ * @param[in] hid_device  Pointer to HID device structure
+ * @param[in] size        Number of bytes to transfer, including setup packet
+ * @return esp_err_t
+ */
+static esp_err_t hid_device_ctrl_xfer_reserve(hid_device_t *hid_device, size_t size)
+{
+    const size_t ctrl_size = hid_device->ctrl_xfer->data_buffer_size;
+
+    if (ctrl_size < size) {
+        // reallocate the ctrl xfer buffer for new length
+        ESP_LOGD(TAG, "Change HID ctrl xfer size from %d to %d",
+                 (int) ctrl_size,
+                 (int) size);
+
+        usb_host_urb_pool_transfer_free(hid_device->ctrl_xfer);
+        hid_device->ctrl_xfer = NULL;
+        HID_RETURN_ON_ERROR( usb_host_urb_pool_transfer_alloc(size,
+                             0,
+                             &hid_device->ctrl_xfer),
+                             "Unable to allocate transfer buffer for EP0");
+    }
+    return ESP_OK;
+}
+
 /**
  * @brief USB class standard request get descriptor
  *
@@ -772,8 +1334,6 @@ static esp_err_t hid_control_transfer(hid_device_t *hid_device,
 static esp_err_t usb_class_request_get_descriptor(hid_device_t *hid_device, const hid_class_request_t *req)
 {
     esp_err_t ret;
-    usb_transfer_t *ctrl_xfer = hid_device->ctrl_xfer;
-    const size_t ctrl_size = hid_device->ctrl_xfer->data_buffer_size;
 
     HID_RETURN_ON_INVALID_ARG(hid_device);
     HID_RETURN_ON_INVALID_ARG(hid_device->ctrl_xfer);
@@ -783,21 +1343,14 @@ static esp_err_t usb_class_request_get_descriptor(hid_device_t *hid_device, cons
     HID_RETURN_ON_ERROR( hid_device_try_lock(hid_device, DEFAULT_TIMEOUT_MS),
                          "HID Device is busy by other task");
 
-    if (ctrl_size < (USB_SETUP_PACKET_SIZE + req->wLength)) {
-        usb_device_info_t dev_info;
-        ESP_ERROR_CHECK(usb_host_device_info(hid_device->dev_hdl, &dev_info));
-        // reallocate the ctrl xfer buffer for new length
-        ESP_LOGD(TAG, "Change HID ctrl xfer size from %d to %d",
-                 (int) ctrl_size,
-                 (int) (USB_SETUP_PACKET_SIZE + req->wLength));
-
-        usb_host_transfer_free(hid_device->ctrl_xfer);
-        HID_RETURN_ON_ERROR( usb_host_transfer_alloc(USB_SETUP_PACKET_SIZE + req->wLength,
-                             0,
-                             &hid_device->ctrl_xfer),
-                             "Unable to allocate transfer buffer for EP0");
+    ret = hid_device_ctrl_xfer_reserve(hid_device, USB_SETUP_PACKET_SIZE + req->wLength);
+    if (ESP_OK != ret) {
+        hid_device_unlock(hid_device);
+        return ret;
     }
 
+    // Transfer could be reallocated
+    usb_transfer_t *ctrl_xfer = hid_device->ctrl_xfer;
     usb_setup_packet_t *setup = (usb_setup_packet_t *)ctrl_xfer->data_buffer;
 
     setup->bmRequestType = USB_BM_REQUEST_TYPE_DIR_IN |
@@ -826,6 +1379,82 @@ static esp_err_t usb_class_request_get_descriptor(hid_device_t *hid_device, cons
     return ret;
 }
 
+/**
+ * @brief Identify HID Interface for the Report Descriptor cache
+ *
+ * @param[in] iface       Pointer to HID Interface configuration structure
+ * @param[out] key        Interface identification
+ * @return true if the device descriptor is available
+ */
+static bool hid_host_interface_cache_key(const hid_iface_t *iface, hid_desc_cache_key_t *key)
+{
+    const usb_device_desc_t *device_desc;
+    if (ESP_OK != usb_host_get_device_descriptor(iface->parent->dev_hdl, &device_desc)) {
+        return false;
+    }
+    *key = (hid_desc_cache_key_t) {
+        .vid = device_desc->idVendor,
+        .pid = device_desc->idProduct,
+        .bcdDevice = device_desc->bcdDevice,
+        .iface_num = iface->dev_params.iface_num,
+    };
+    return true;
+}
+
+/**
+ * @brief Take Report Descriptor of the interface from the cache
+ *
+ * @param[in] iface       Pointer to HID Interface configuration structure, without Report Descriptor
+ * @return true if the Report Descriptor was cached
+ */
+static bool hid_host_interface_get_cached_report_desc(hid_iface_t *iface)
+{
+    hid_desc_cache_key_t key;
+    if (!hid_host_interface_cache_key(iface, &key)) {
+        return false;
+    }
+    hid_desc_cache_entry_t *entry = hid_desc_cache_get(&key, iface->report_desc_size);
+    if (NULL == entry) {
+        return false;
+    }
+    iface->desc_cache = entry;
+    iface->report_desc = entry->report_desc;
+    return true;
+}
+
+/**
+ * @brief Hand over Report Descriptor received from the device to the cache
+ *
+ * The interface keeps owning the Report Descriptor, if the cache is disabled or full.
+ *
+ * @param[in] iface       Pointer to HID Interface configuration structure
+ */
+static void hid_host_interface_cache_report_desc(hid_iface_t *iface)
+{
+    hid_desc_cache_key_t key;
+    if (hid_host_interface_cache_key(iface, &key)) {
+        iface->desc_cache = hid_desc_cache_put(&key, iface->report_desc, iface->report_desc_size);
+    }
+}
+
+/**
+ * @brief Free Report Descriptor and report map of the interface, or release them to the cache
+ *
+ * @param[in] iface       Pointer to HID Interface configuration structure
+ */
+static void hid_host_interface_free_report_desc(hid_iface_t *iface)
+{
+    if (iface->desc_cache) {
+        hid_desc_cache_release(iface->desc_cache);
+        iface->desc_cache = NULL;
+    } else {
+        free(iface->report_desc);
+        hid_report_map_delete(iface->report_map);
+    }
+    iface->report_desc = NULL;
+    iface->report_map = NULL;
+}
+
 /**
  * @brief HID Host Request Report Descriptor
  *
@@ -842,6 +1471,10 @@ static esp_err_t hid_class_request_report_descriptor(hid_iface_t *iface)
                         ESP_ERR_INVALID_STATE,
                         "Unable to request report descriptor. Interface is not ready");
 
+    if (hid_host_interface_get_cached_report_desc(iface)) {
+        return ESP_OK;
+    }
+
     iface->report_desc = malloc(iface->report_desc_size);
     HID_RETURN_ON_FALSE(iface->report_desc,
                         ESP_ERR_NO_MEM,
@@ -855,7 +1488,196 @@ static esp_err_t hid_class_request_report_descriptor(hid_iface_t *iface)
         .data = iface->report_desc
     };
 
-    return usb_class_request_get_descriptor(iface->parent, &get_desc);
+    const esp_err_t ret = usb_class_request_get_descriptor(iface->parent, &get_desc);
+    if (ESP_OK == ret) {
+        hid_host_interface_cache_report_desc(iface);
+    }
+    return ret;
+}
+
+/**
+ * @brief Find next interface of the device to prefetch the Report Descriptor for
+ *
+ * @param[in] hid_device  Pointer to HID device structure
+ * @param[in] iface       Interface to search after, NULL to search from the first one
+ * @return Pointer to HID Interface, NULL if there is no more interfaces
+ */
+static hid_iface_t *hid_host_prefetch_next_iface(hid_device_t *hid_device, hid_iface_t *iface)
+{
+    HID_ENTER_CRITICAL();
+    iface = iface ? STAILQ_NEXT(iface, tailq_entry) : STAILQ_FIRST(&s_hid_driver->hid_ifaces_tailq);
+    while (iface != NULL) {
+        if ((iface->parent == hid_device) &&
+                (HID_INTERFACE_STATE_IDLE == iface->state) &&
+                (NULL == iface->report_desc) &&
+                iface->report_desc_size) {
+            break;
+        }
+        iface = STAILQ_NEXT(iface, tailq_entry);
+    }
+    HID_EXIT_CRITICAL();
+    return iface;
+}
+
+static void prefetch_xfer_done(usb_transfer_t *ctrl_xfer);
+
+/**
+ * @brief Submit Get Report Descriptor request without waiting for its completion
+ *
+ * @param[in] hid_device  Pointer to HID device structure, locked
+ * @param[in] iface       Pointer to HID Interface
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_prefetch_submit(hid_device_t *hid_device, hid_iface_t *iface)
+{
+    HID_RETURN_ON_ERROR( hid_device_ctrl_xfer_reserve(hid_device, USB_SETUP_PACKET_SIZE + iface->report_desc_size),
+                         "Unable to allocate transfer buffer for EP0");
+
+    usb_transfer_t *ctrl_xfer = hid_device->ctrl_xfer;
+    usb_setup_packet_t *setup = (usb_setup_packet_t *)ctrl_xfer->data_buffer;
+
+    setup->bmRequestType = USB_BM_REQUEST_TYPE_DIR_IN |
+                           USB_BM_REQUEST_TYPE_TYPE_STANDARD |
+                           USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    setup->bRequest = USB_B_REQUEST_GET_DESCRIPTOR;
+    setup->wValue = (HID_CLASS_DESCRIPTOR_TYPE_REPORT << 8);
+    setup->wIndex = iface->dev_params.iface_num;
+    setup->wLength = iface->report_desc_size;
+
+    ctrl_xfer->device_handle = hid_device->dev_hdl;
+    ctrl_xfer->callback = prefetch_xfer_done;
+    ctrl_xfer->context = hid_device;
+    ctrl_xfer->bEndpointAddress = 0;
+    ctrl_xfer->timeout_ms = DEFAULT_TIMEOUT_MS;
+    ctrl_xfer->num_bytes = USB_SETUP_PACKET_SIZE + iface->report_desc_size;
+
+    hid_device->prefetch_iface = iface;
+    return usb_host_transfer_submit_control(s_hid_driver->client_handle, ctrl_xfer);
+}
+
+/**
+ * @brief Prefetch Report Descriptor of the next interface or finish prefetching
+ *
+ * When there is no more interfaces, the device is unlocked and the user is notified about its interfaces.
+ *
+ * @param[in] hid_device  Pointer to HID device structure, locked
+ * @param[in] iface       Interface whose Report Descriptor was prefetched, NULL to start
+ */
+static void hid_host_prefetch_continue(hid_device_t *hid_device, hid_iface_t *iface)
+{
+    while ((iface = hid_host_prefetch_next_iface(hid_device, iface)) != NULL) {
+        if (hid_host_interface_get_cached_report_desc(iface)) {
+            continue;
+        }
+        if (ESP_OK == hid_host_prefetch_submit(hid_device, iface)) {
+            return;
+        }
+        // Report Descriptor will be requested on demand
+        ESP_LOGW(TAG, "Unable to prefetch Report Descriptor of interface %d", iface->dev_params.iface_num);
+    }
+
+    hid_device->prefetch_iface = NULL;
+    hid_device_unlock(hid_device);
+    hid_host_notify_interface_connected(hid_device);
+}
+
+/**
+ * @brief Prefetch Report Descriptor transfer complete callback
+ *
+ * @param[in] ctrl_xfer  Pointer to transfer data structure
+ */
+static void prefetch_xfer_done(usb_transfer_t *ctrl_xfer)
+{
+    assert(ctrl_xfer);
+    hid_device_t *hid_device = (hid_device_t *)ctrl_xfer->context;
+    hid_iface_t *iface = hid_device->prefetch_iface;
+
+    if (hid_device->gone) {
+        // Interfaces were already removed on USB_HOST_CLIENT_EVENT_DEV_GONE
+        hid_device->prefetch_iface = NULL;
+        hid_device_unlock(hid_device);
+        hid_host_uninstall_device(hid_device);
+        return;
+    }
+
+    if (USB_TRANSFER_STATUS_NO_DEVICE == ctrl_xfer->status) {
+        // Interfaces are removed on USB_HOST_CLIENT_EVENT_DEV_GONE
+        hid_device->prefetch_iface = NULL;
+        hid_device_unlock(hid_device);
+        return;
+    }
+
+    const int report_desc_len = ctrl_xfer->actual_num_bytes - USB_SETUP_PACKET_SIZE;
+    if ((USB_TRANSFER_STATUS_COMPLETED == ctrl_xfer->status) &&
+            (report_desc_len == iface->report_desc_size)) {
+        uint8_t *report_desc = malloc(report_desc_len);
+        if (report_desc) {
+            memcpy(report_desc, ctrl_xfer->data_buffer + USB_SETUP_PACKET_SIZE, report_desc_len);
+            iface->report_desc = report_desc;
+            hid_host_interface_cache_report_desc(iface);
+        }
+    } else {
+        ESP_LOGW(TAG, "Unable to prefetch Report Descriptor of interface %d, status %d",
+                 iface->dev_params.iface_num, ctrl_xfer->status);
+    }
+
+    hid_host_prefetch_continue(hid_device, iface);
+}
+
+/**
+ * @brief Request Report Descriptors of all interfaces of a connected device
+ *
+ * Requests are chained in transfer callbacks, so the client task is not blocked
+ * and Report Descriptors of several devices are requested at the same time.
+ *
+ * @param[in] hid_device  Pointer to HID device structure
+ */
+static void hid_host_prefetch_report_desc(hid_device_t *hid_device)
+{
+    // Device was just installed, nobody else can hold it
+    if (ESP_OK != hid_device_try_lock(hid_device, 0)) {
+        hid_host_notify_interface_connected(hid_device);
+        return;
+    }
+    hid_host_prefetch_continue(hid_device, NULL);
+}
+
+/**
+ * @brief HID Host compile Report Descriptor into report map
+ *
+ * Report Descriptor is requested from the device, if it was not requested before.
+ * Report map of a cached Report Descriptor is compiled only once and shared with later connections.
+ *
+ * @param[in] iface       Pointer to HID Interface configuration structure
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_interface_create_report_map(hid_iface_t *iface)
+{
+    esp_err_t ret;
+
+    if (NULL == iface->report_desc) {
+        HID_GOTO_ON_ERROR( hid_class_request_report_descriptor(iface),
+                           "Unable to get report descriptor");
+    }
+
+    // Report map of a cache entry is set once and does not change while the entry is referenced
+    if (iface->desc_cache && iface->desc_cache->report_map) {
+        iface->report_map = iface->desc_cache->report_map;
+        return ESP_OK;
+    }
+
+    HID_GOTO_ON_ERROR( hid_report_map_create(iface->report_desc,
+                       iface->report_desc_size,
+                       &iface->report_map),
+                       "Unable to compile report descriptor");
+    if (iface->desc_cache) {
+        iface->report_map = hid_desc_cache_set_map(iface->desc_cache, iface->report_map);
+    }
+    return ESP_OK;
+
+fail:
+    hid_host_interface_free_report_desc(iface);
+    return ret;
 }
 
 /**
@@ -1001,7 +1823,7 @@ esp_err_t hid_host_install_device(uint8_t dev_addr,
     * To take the size of a report descriptor into a consideration,
     * we need to allocate more here, e.g. 512 bytes.
     */
-    HID_GOTO_ON_ERROR(usb_host_transfer_alloc(512, 0, &hid_device->ctrl_xfer),
+    HID_GOTO_ON_ERROR(usb_host_urb_pool_transfer_alloc(512, 0, &hid_device->ctrl_xfer),
                       "Unable to allocate transfer buffer");
 
     HID_ENTER_CRITICAL();
@@ -1025,9 +1847,9 @@ esp_err_t hid_host_uninstall_device(hid_device_t *hid_device)
 {
     HID_RETURN_ON_INVALID_ARG(hid_device);
 
-    HID_RETURN_ON_ERROR( usb_host_transfer_free(hid_device->ctrl_xfer),
+    HID_RETURN_ON_ERROR( usb_host_urb_pool_transfer_free(hid_device->ctrl_xfer),
                          "Unable to free transfer buffer for EP0");
-    HID_RETURN_ON_ERROR( usb_host_device_close(s_hid_driver->client_handle,
+    HID_RETURN_ON_ERROR( usb_host_shared_client_device_close(s_hid_driver->client_handle,
                          hid_device->dev_hdl),
                          "Unable to close USB host");
 
@@ -1059,6 +1881,9 @@ esp_err_t hid_host_install(const hid_host_driver_config_t *config)
     HID_RETURN_ON_INVALID_ARG(config);
     HID_RETURN_ON_INVALID_ARG(config->callback);
 
+    HID_RETURN_ON_FALSE(!(config->shared_client && config->create_background_task),
+                        ESP_ERR_INVALID_ARG,
+                        "Background task can't be created with shared client");
     if ( config->create_background_task ) {
         HID_RETURN_ON_FALSE(config->stack_size != 0,
                             ESP_ERR_INVALID_ARG,
@@ -1080,6 +1905,7 @@ esp_err_t hid_host_install(const hid_host_driver_config_t *config)
 
     driver->user_cb = config->callback;
     driver->user_arg = config->callback_arg;
+    driver->prefetch_report_desc = config->prefetch_report_desc;
 
     usb_host_client_config_t client_config = {
         .is_synchronous = false,
@@ -1094,9 +1920,23 @@ esp_err_t hid_host_install(const hid_host_driver_config_t *config)
                       ESP_ERR_NO_MEM,
                       "Unable to create semaphore");
 
-    HID_GOTO_ON_ERROR( usb_host_client_register(&client_config,
-                       &driver->client_handle),
-                       "Unable to register USB Host client");
+    if (config->shared_client) {
+        const usb_host_shared_client_driver_config_t shared_config = {
+            .event_cb = client_event_cb,
+            .probe_cb = client_probe_cb,
+            .match_table = hid_match_table,
+            .match_count = sizeof(hid_match_table) / sizeof(hid_match_table[0]),
+            .arg = NULL,
+        };
+        HID_GOTO_ON_ERROR( usb_host_shared_client_add_driver(&shared_config,
+                           &driver->shared_driver,
+                           &driver->client_handle),
+                           "Unable to add driver to USB Host shared client");
+    } else {
+        HID_GOTO_ON_ERROR( usb_host_client_register(&client_config,
+                           &driver->client_handle),
+                           "Unable to register USB Host client");
+    }
 
     HID_ENTER_CRITICAL();
     HID_GOTO_ON_FALSE_CRITICAL(!s_hid_driver, ESP_ERR_INVALID_STATE);
@@ -1105,6 +1945,9 @@ esp_err_t hid_host_install(const hid_host_driver_config_t *config)
     STAILQ_INIT(&s_hid_driver->hid_ifaces_tailq);
     HID_EXIT_CRITICAL();
 
+    HID_GOTO_ON_ERROR( hid_desc_cache_init(config->report_desc_cache_size),
+                       "Unable to allocate Report Descriptor cache");
+
     if (config->create_background_task) {
         BaseType_t task_created = xTaskCreatePinnedToCore(
                                       event_handler_task,
@@ -1123,7 +1966,10 @@ esp_err_t hid_host_install(const hid_host_driver_config_t *config)
 
 fail:
     s_hid_driver = NULL;
-    if (driver->client_handle) {
+    hid_desc_cache_deinit();
+    if (driver->shared_driver) {
+        usb_host_shared_client_remove_driver(driver->shared_driver);
+    } else if (driver->client_handle) {
         usb_host_client_deregister(driver->client_handle);
     }
     if (driver->all_events_handled) {
@@ -1150,13 +1996,18 @@ esp_err_t hid_host_uninstall(void)
     s_hid_driver->end_client_event_handling = true;
     HID_EXIT_CRITICAL();
 
-    if (s_hid_driver->event_handling_started) {
-        ESP_ERROR_CHECK( usb_host_client_unblock(s_hid_driver->client_handle) );
-        // In case the event handling started, we must wait until it finishes
-        xSemaphoreTake(s_hid_driver->all_events_handled, portMAX_DELAY);
+    if (s_hid_driver->shared_driver) {
+        ESP_ERROR_CHECK( usb_host_shared_client_remove_driver(s_hid_driver->shared_driver) );
+    } else {
+        if (s_hid_driver->event_handling_started) {
+            ESP_ERROR_CHECK( usb_host_client_unblock(s_hid_driver->client_handle) );
+            // In case the event handling started, we must wait until it finishes
+            xSemaphoreTake(s_hid_driver->all_events_handled, portMAX_DELAY);
+        }
+        ESP_ERROR_CHECK( usb_host_client_deregister(s_hid_driver->client_handle) );
     }
     vSemaphoreDelete(s_hid_driver->all_events_handled);
-    ESP_ERROR_CHECK( usb_host_client_deregister(s_hid_driver->client_handle) );
+    hid_desc_cache_deinit();
     free(s_hid_driver);
     s_hid_driver = NULL;
     return ESP_OK;
@@ -1182,10 +2033,36 @@ esp_err_t hid_host_device_open(hid_host_device_handle_t hid_dev_handle,
                         ESP_ERR_INVALID_STATE,
                         "Interface wrong state");
 
+    HID_RETURN_ON_FALSE(config->in_xfer_num <= HID_HOST_IN_XFER_NUM_MAX,
+                        ESP_ERR_INVALID_ARG,
+                        "Too many IN transfers");
+
+    HID_RETURN_ON_FALSE(config->out_xfer_num <= HID_HOST_OUT_XFER_NUM_MAX,
+                        ESP_ERR_INVALID_ARG,
+                        "Too many OUT transfers");
+
     // Claim interface, allocate xfer and save report callback
+    hid_iface->in_xfer_num = config->in_xfer_num ? config->in_xfer_num : HID_HOST_IN_XFER_NUM_DEFAULT;
+    hid_iface->report_queue_len = config->report_queue_len;
+    hid_iface->out_xfer_num = config->out_xfer_num ? config->out_xfer_num : HID_HOST_OUT_XFER_NUM_DEFAULT;
+    hid_iface->collect_stats = config->stats;
+    hid_iface->filter_reports = config->filter_reports;
+    hid_iface->filter_keepalive_ms = config->filter_keepalive_ms;
     HID_RETURN_ON_ERROR( hid_host_interface_claim_and_prepare_transfer(hid_iface),
                          "Unable to claim interface");
 
+    // Compile Report Descriptor once, so reports are decoded without walking the descriptor items
+    if (config->report_map) {
+        const esp_err_t ret = hid_host_interface_create_report_map(hid_iface);
+        if (ret != ESP_OK) {
+            hid_host_interface_release_and_free_transfer(hid_iface);
+            return ret;
+        }
+    }
+    if (hid_iface->report_desc) {
+        USB_CLASS_STATS_MEM_ALLOC(hid_iface->class_stats, hid_iface->report_desc_size, MALLOC_CAP_DEFAULT);
+    }
+
     // Save HID Interface callback
     hid_iface->user_cb = config->callback;
     hid_iface->user_cb_arg = config->callback_arg;
@@ -1214,8 +2091,7 @@ esp_err_t hid_host_device_close(hid_host_device_handle_t hid_dev_handle)
                              "Unable to release HID Interface");
 
         // If the device is closing by user before device detached we need to flush user callback here
-        free(hid_iface->report_desc);
-        hid_iface->report_desc = NULL;
+        hid_host_interface_free_report_desc(hid_iface);
     }
 
     if (hid_iface->user_cb && hid_iface->state != HID_INTERFACE_STATE_WAIT_USER_DELETION) {
@@ -1226,6 +2102,8 @@ esp_err_t hid_host_device_close(hid_host_device_handle_t hid_dev_handle)
         // Second call
         hid_iface->user_cb = NULL;
         hid_iface->user_cb_arg = NULL;
+        // Report Descriptor could be prefetched for a never opened interface
+        hid_host_interface_free_report_desc(hid_iface);
 
         /* Remove Interface from the list */
         ESP_LOGD(TAG, "Remove addr %d, iface %d from list",
@@ -1246,6 +2124,9 @@ esp_err_t hid_host_handle_events(uint32_t timeout)
                         "HID Driver is not installed");
 
     ESP_LOGD(TAG, "USB HID handling");
+    if (s_hid_driver->shared_driver) {
+        return usb_host_shared_client_handle_events(timeout);
+    }
     s_hid_driver->event_handling_started = true;
     esp_err_t ret = usb_host_client_handle_events(s_hid_driver->client_handle, timeout);
     if (s_hid_driver->end_client_event_handling) {
@@ -1291,14 +2172,171 @@ esp_err_t hid_host_device_get_raw_input_report_data(hid_host_device_handle_t hid
                         ESP_ERR_INVALID_ARG,
                         "Wrong argument");
 
-    size_t copied = (data_length_max >= iface->in_xfer->actual_num_bytes)
-                    ? iface->in_xfer->actual_num_bytes
+    HID_RETURN_ON_FALSE(iface->report_xfer,
+                        ESP_ERR_INVALID_STATE,
+                        "No input report");
+
+    size_t copied = (data_length_max >= iface->report_xfer->actual_num_bytes)
+                    ? iface->report_xfer->actual_num_bytes
                     : data_length_max;
-    memcpy(data, iface->in_xfer->data_buffer, copied);
+    memcpy(data, iface->report_xfer->data_buffer, copied);
     *data_length = copied;
     return ESP_OK;
 }
 
+esp_err_t hid_host_device_report_borrow(hid_host_device_handle_t hid_dev_handle,
+                                        hid_host_report_t *report,
+                                        uint32_t timeout_ms)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(report);
+
+    hid_report_queue_t *queue = iface->report_queue;
+    HID_RETURN_ON_FALSE(queue,
+                        ESP_ERR_INVALID_STATE,
+                        "Report queue not enabled");
+
+    TimeOut_t timeout;
+    TickType_t ticks_to_wait = pdMS_TO_TICKS(timeout_ms);
+    vTaskSetTimeOutState(&timeout);
+    const unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    while (atomic_load_explicit(&queue->head, memory_order_acquire) == tail) {
+        atomic_store(&queue->consumer_waiting, true);
+        // a report pushed before the flag was set does not give the semaphore
+        if (atomic_load_explicit(&queue->head, memory_order_acquire) != tail) {
+            atomic_store(&queue->consumer_waiting, false);
+            break;
+        }
+        const bool taken = xSemaphoreTake(queue->report_ready, ticks_to_wait);
+        if (!taken || xTaskCheckForTimeOut(&timeout, &ticks_to_wait) != pdFALSE) {
+            atomic_store(&queue->consumer_waiting, false);
+            if (atomic_load_explicit(&queue->head, memory_order_acquire) == tail) {
+                return ESP_ERR_TIMEOUT;
+            }
+        }
+    }
+
+    *report = queue->slots[tail % queue->slot_num];
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_report_release(hid_host_device_handle_t hid_dev_handle,
+        const hid_host_report_t *report)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(report);
+
+    hid_report_queue_t *queue = iface->report_queue;
+    HID_RETURN_ON_FALSE(queue,
+                        ESP_ERR_INVALID_STATE,
+                        "Report queue not enabled");
+
+    const unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    HID_RETURN_ON_FALSE(atomic_load_explicit(&queue->head, memory_order_acquire) != tail,
+                        ESP_ERR_INVALID_STATE,
+                        "Report queue empty");
+    HID_RETURN_ON_FALSE(report->data == queue->slots[tail % queue->slot_num].data,
+                        ESP_ERR_INVALID_ARG,
+                        "Report not borrowed");
+
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_send_report(hid_host_device_handle_t hid_dev_handle,
+                                      const uint8_t *data,
+                                      size_t length,
+                                      uint32_t timeout_ms)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(data);
+
+    HID_RETURN_ON_FALSE(iface->ep_out,
+                        ESP_ERR_NOT_SUPPORTED,
+                        "Interface has no EP OUT");
+
+    HID_RETURN_ON_FALSE((HID_INTERFACE_STATE_READY == iface->state) ||
+                        (HID_INTERFACE_STATE_ACTIVE == iface->state),
+                        ESP_ERR_INVALID_STATE,
+                        "Interface wrong state");
+
+    HID_RETURN_ON_FALSE(length && (length <= iface->ep_out_mps),
+                        ESP_ERR_INVALID_SIZE,
+                        "Report does not fit into EP OUT packet");
+
+    hid_out_xfers_t *out_xfers = iface->out_xfers;
+    usb_transfer_t *out_xfer;
+    HID_RETURN_ON_FALSE(xQueueReceive(out_xfers->free_queue, &out_xfer, pdMS_TO_TICKS(timeout_ms)) == pdTRUE,
+                        ESP_ERR_TIMEOUT,
+                        "No free OUT transfer");
+
+    memcpy(out_xfer->data_buffer, data, length);
+    out_xfer->num_bytes = length;
+
+    HID_ENTER_CRITICAL();
+    out_xfers->in_flight++;
+    HID_EXIT_CRITICAL();
+    HID_TRACE(SUBMIT, out_xfer);
+    const esp_err_t ret = usb_host_transfer_submit(out_xfer);
+    if (ESP_OK != ret) {
+        HID_ENTER_CRITICAL();
+        out_xfers->in_flight--;
+        HID_EXIT_CRITICAL();
+        xQueueSend(out_xfers->free_queue, &out_xfer, 0);
+    }
+    return ret;
+}
+
+esp_err_t hid_host_device_get_stats(hid_host_device_handle_t hid_dev_handle,
+                                    hid_host_stats_t *stats,
+                                    bool reset)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(stats);
+
+    HID_RETURN_ON_FALSE(iface->stats,
+                        ESP_ERR_INVALID_STATE,
+                        "Statistics not collected");
+
+    HID_ENTER_CRITICAL();
+    hid_iface_stats_t *iface_stats = iface->stats;
+    *stats = iface_stats->pub;
+    const uint64_t interval_sum_us = iface_stats->report_interval_sum_us;
+    if (reset) {
+        const uint32_t polling_interval_us = iface_stats->pub.polling_interval_us;
+        memset(iface_stats, 0, sizeof(hid_iface_stats_t));
+        iface_stats->pub.polling_interval_us = polling_interval_us;
+    }
+    HID_EXIT_CRITICAL();
+
+    stats->report_interval_avg_us = (stats->reports > 1) ? interval_sum_us / (stats->reports - 1) : 0;
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_get_report_map(hid_host_device_handle_t hid_dev_handle,
+        const hid_report_map_t **map)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(map);
+
+    HID_RETURN_ON_FALSE(iface->report_map,
+                        ESP_ERR_INVALID_STATE,
+                        "Report map not compiled");
+
+    *map = iface->report_map;
+    return ESP_OK;
+}
+
 // ------------------------ USB HID Host driver API ----------------------------
 
 esp_err_t hid_host_device_start(hid_host_device_handle_t hid_dev_handle)
@@ -1306,7 +2344,7 @@ esp_err_t hid_host_device_start(hid_host_device_handle_t hid_dev_handle)
     hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
 
     HID_RETURN_ON_INVALID_ARG(iface);
-    HID_RETURN_ON_INVALID_ARG(iface->in_xfer);
+    HID_RETURN_ON_INVALID_ARG(iface->in_xfer[0]);
     HID_RETURN_ON_INVALID_ARG(iface->parent);
 
     HID_RETURN_ON_FALSE(is_interface_in_list(iface),
@@ -1317,18 +2355,37 @@ esp_err_t hid_host_device_start(hid_host_device_handle_t hid_dev_handle)
                          ESP_ERR_INVALID_STATE,
                          "Interface wrong state");
 
-    // prepare transfer
-    iface->in_xfer->device_handle = iface->parent->dev_hdl;
-    iface->in_xfer->callback = in_xfer_done;
-    iface->in_xfer->context = iface;
-    iface->in_xfer->timeout_ms = DEFAULT_TIMEOUT_MS;
-    iface->in_xfer->bEndpointAddress = iface->ep_in;
-    iface->in_xfer->num_bytes = iface->ep_in_mps;
+    HID_RETURN_ON_ERROR( hid_host_interface_bw_reserve(iface),
+                         "Not enough periodic bandwidth for EP IN");
+
+    // The first report after start is always delivered
+    if (iface->report_filter) {
+        iface->report_filter->valid = false;
+    }
+
+    // prepare transfers
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        iface->in_xfer[i]->device_handle = iface->parent->dev_hdl;
+        iface->in_xfer[i]->callback = in_xfer_done;
+        iface->in_xfer[i]->context = iface;
+        iface->in_xfer[i]->timeout_ms = DEFAULT_TIMEOUT_MS;
+        iface->in_xfer[i]->bEndpointAddress = iface->ep_in;
+        // One transfer per (micro)frame, a report of a high-bandwidth endpoint spans all its transactions
+        iface->in_xfer[i]->num_bytes = iface->ep_in_xfer_size;
+    }
 
     iface->state = HID_INTERFACE_STATE_ACTIVE;
 
-    // start data transfer
-    return usb_host_transfer_submit(iface->in_xfer);
+    // start data transfer, all transfers are queued on the endpoint
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        HID_TRACE(SUBMIT, iface->in_xfer[i]);
+        esp_err_t ret = usb_host_transfer_submit(iface->in_xfer[i]);
+        if (ret != ESP_OK) {
+            hid_host_disable_interface(iface);
+            return ret;
+        }
+    }
+    return ESP_OK;
 }
 
 esp_err_t hid_host_device_stop(hid_host_device_handle_t hid_dev_handle)
@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "usb/usb_host_desc_index.h"
+#include "hid_host_descriptor_parsing.h"
+
+esp_err_t hid_config_desc_parse(const usb_config_desc_t *config_desc, hid_iface_desc_t **table, size_t *num)
+{
+    assert(config_desc);
+    usb_host_desc_index_t *index;
+    esp_err_t ret = usb_host_desc_index_build(config_desc, &index);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = hid_desc_index_parse(index, table, num);
+    usb_host_desc_index_free(index);
+    return ret;
+}
+
+esp_err_t hid_desc_index_parse(const usb_host_desc_index_t *index, hid_iface_desc_t **table, size_t *num)
+{
+    assert(index);
+    size_t num_entries = 0;
+    for (int i = 0; i < index->num_intfs; i++) {
+        for (int alt = 0; alt < index->intfs[i].num_alts; alt++) {
+            num_entries += (USB_CLASS_HID == index->intfs[i].alts[alt].intf_desc->bInterfaceClass);
+        }
+    }
+
+    hid_iface_desc_t *entries = NULL;
+    if (num_entries) {
+        entries = calloc(num_entries, sizeof(hid_iface_desc_t));
+        if (NULL == entries) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    hid_iface_desc_t *entry = entries;
+    for (int i = 0; i < index->num_intfs; i++) {
+        for (int alt = 0; alt < index->intfs[i].num_alts; alt++) {
+            const usb_host_desc_index_alt_t *this_alt = &index->intfs[i].alts[alt];
+            if (USB_CLASS_HID != this_alt->intf_desc->bInterfaceClass) {
+                continue;
+            }
+            entry->iface_desc = this_alt->intf_desc;
+            entry->hid_desc = (const hid_descriptor_t *)usb_host_desc_index_find_class_desc(this_alt, HID_CLASS_DESCRIPTOR_TYPE_HID, NULL);
+            // First IN endpoint of any type, first OUT endpoint of Interrupt type
+            for (int ep = 0; ep < this_alt->num_eps; ep++) {
+                if (USB_EP_DESC_GET_EP_DIR(this_alt->ep_descs[ep])) {
+                    entry->ep_in_desc = this_alt->ep_descs[ep];
+                    break;
+                }
+            }
+            entry->ep_out_desc = usb_host_desc_index_find_ep(this_alt, USB_TRANSFER_TYPE_INTR, false);
+            entry++;
+        }
+    }
+
+    *table = entries;
+    *num = num_entries;
+    return ESP_OK;
+}
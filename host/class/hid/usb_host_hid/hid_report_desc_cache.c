@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "hid_report_desc_cache.h"
+
+static const char *TAG = "hid-desc-cache";
+
+// Entries are only looked up and modified under the spinlock. Memory is freed after it is left
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+#define CACHE_ENTER_CRITICAL()  portENTER_CRITICAL(&cache_lock)
+#define CACHE_EXIT_CRITICAL()   portEXIT_CRITICAL(&cache_lock)
+
+static hid_desc_cache_entry_t *s_entries;
+static size_t s_entry_num;
+static uint32_t s_use_counter;
+
+static inline bool key_equal(const hid_desc_cache_key_t *a, const hid_desc_cache_key_t *b)
+{
+    return a->vid == b->vid && a->pid == b->pid && a->bcdDevice == b->bcdDevice && a->iface_num == b->iface_num;
+}
+
+esp_err_t hid_desc_cache_init(size_t entries)
+{
+    if (entries == 0) {
+        return ESP_OK;
+    }
+    hid_desc_cache_entry_t *new_entries = calloc(entries, sizeof(hid_desc_cache_entry_t));
+    if (new_entries == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    CACHE_ENTER_CRITICAL();
+    s_entries = new_entries;
+    s_entry_num = entries;
+    s_use_counter = 0;
+    CACHE_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+void hid_desc_cache_deinit(void)
+{
+    CACHE_ENTER_CRITICAL();
+    hid_desc_cache_entry_t *entries = s_entries;
+    const size_t entry_num = s_entry_num;
+    s_entries = NULL;
+    s_entry_num = 0;
+    CACHE_EXIT_CRITICAL();
+
+    for (size_t i = 0; i < entry_num; i++) {
+        assert(entries[i].refs == 0);
+        free(entries[i].report_desc);
+        hid_report_map_delete(entries[i].report_map);
+    }
+    free(entries);
+}
+
+hid_desc_cache_entry_t *hid_desc_cache_get(const hid_desc_cache_key_t *key, uint16_t report_desc_size)
+{
+    hid_desc_cache_entry_t *found = NULL;
+
+    CACHE_ENTER_CRITICAL();
+    for (size_t i = 0; i < s_entry_num; i++) {
+        hid_desc_cache_entry_t *entry = &s_entries[i];
+        if (entry->report_desc && key_equal(&entry->key, key) && entry->report_desc_size == report_desc_size) {
+            entry->refs++;
+            entry->last_use = ++s_use_counter;
+            found = entry;
+            break;
+        }
+    }
+    CACHE_EXIT_CRITICAL();
+
+    if (found) {
+        ESP_LOGD(TAG, "Report Descriptor of %04X:%04X interface %d found", key->vid, key->pid, key->iface_num);
+    }
+    return found;
+}
+
+hid_desc_cache_entry_t *hid_desc_cache_put(const hid_desc_cache_key_t *key, uint8_t *report_desc, uint16_t report_desc_size)
+{
+    hid_desc_cache_entry_t *victim = NULL;
+    uint8_t *old_desc = NULL;
+    hid_report_map_t *old_map = NULL;
+
+    CACHE_ENTER_CRITICAL();
+    // Free entry, or the least recently used entry with the same key or not used by any interface
+    for (size_t i = 0; i < s_entry_num; i++) {
+        hid_desc_cache_entry_t *entry = &s_entries[i];
+        if (entry->report_desc == NULL) {
+            victim = entry;
+            break;
+        }
+        if (entry->refs == 0 && (victim == NULL || key_equal(&entry->key, key) ||
+                                 (int32_t)(entry->last_use - victim->last_use) < 0)) {
+            victim = entry;
+            if (key_equal(&entry->key, key)) {
+                break; // Device with the same key changed its Report Descriptor length
+            }
+        }
+    }
+    if (victim) {
+        old_desc = victim->report_desc;
+        old_map = victim->report_map;
+        *victim = (hid_desc_cache_entry_t) {
+            .key = *key,
+            .report_desc_size = report_desc_size,
+            .report_desc = report_desc,
+            .refs = 1,
+            .last_use = ++s_use_counter,
+        };
+    }
+    CACHE_EXIT_CRITICAL();
+
+    free(old_desc);
+    hid_report_map_delete(old_map);
+    return victim;
+}
+
+hid_report_map_t *hid_desc_cache_set_map(hid_desc_cache_entry_t *entry, hid_report_map_t *report_map)
+{
+    hid_report_map_t *entry_map;
+
+    CACHE_ENTER_CRITICAL();
+    if (entry->report_map == NULL) {
+        entry->report_map = report_map;
+    }
+    entry_map = entry->report_map;
+    CACHE_EXIT_CRITICAL();
+
+    if (entry_map != report_map) {
+        hid_report_map_delete(report_map);
+    }
+    return entry_map;
+}
+
+void hid_desc_cache_release(hid_desc_cache_entry_t *entry)
+{
+    if (entry == NULL) {
+        return;
+    }
+    CACHE_ENTER_CRITICAL();
+    assert(entry->refs > 0);
+    entry->refs--;
+    CACHE_EXIT_CRITICAL();
+}
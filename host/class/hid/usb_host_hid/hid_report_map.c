@@ -0,0 +1,496 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "usb/hid_report_map.h"
+
+static const char *TAG = "hid-report-map";
+
+#define HID_REPORT_MAP_USAGES_MAX       (32)    // Usages of one main item, further usages repeat the last one
+#define HID_REPORT_MAP_GLOBAL_STACK     (4)     // Depth of Push/Pop
+#define HID_REPORT_MAP_FIELDS_MAX       (1024)  // Number of fields of all reports
+#define HID_REPORT_MAP_TYPE_NUM         (3)     // Input, Output, Feature
+
+/**
+ * @brief HID report descriptor item type
+ *
+ * @see 6.2.2.2 Short Items, p.26 of Device Class Definition for Human Interface Devices (HID) Version 1.11
+ */
+typedef enum {
+    HID_ITEM_TYPE_MAIN = 0,
+    HID_ITEM_TYPE_GLOBAL = 1,
+    HID_ITEM_TYPE_LOCAL = 2,
+} hid_item_type_t;
+
+#define HID_ITEM_LONG_PREFIX            (0xFE)
+
+// Main item tags
+#define HID_MAIN_INPUT                  (0x8)
+#define HID_MAIN_OUTPUT                 (0x9)
+#define HID_MAIN_COLLECTION             (0xA)
+#define HID_MAIN_FEATURE                (0xB)
+#define HID_MAIN_END_COLLECTION         (0xC)
+
+// Main item data bits
+#define HID_MAIN_DATA_CONSTANT          (1 << 0)
+#define HID_MAIN_DATA_VARIABLE          (1 << 1)
+#define HID_MAIN_DATA_RELATIVE          (1 << 2)
+
+// Global item tags
+#define HID_GLOBAL_USAGE_PAGE           (0x0)
+#define HID_GLOBAL_LOGICAL_MIN          (0x1)
+#define HID_GLOBAL_LOGICAL_MAX          (0x2)
+#define HID_GLOBAL_REPORT_SIZE          (0x7)
+#define HID_GLOBAL_REPORT_ID            (0x8)
+#define HID_GLOBAL_REPORT_COUNT         (0x9)
+#define HID_GLOBAL_PUSH                 (0xA)
+#define HID_GLOBAL_POP                  (0xB)
+
+// Local item tags
+#define HID_LOCAL_USAGE                 (0x0)
+#define HID_LOCAL_USAGE_MIN             (0x1)
+#define HID_LOCAL_USAGE_MAX             (0x2)
+
+/**
+ * @brief Global item state
+ */
+typedef struct {
+    uint16_t usage_page;
+    uint8_t report_id;
+    uint8_t logical_min_size;       // Size of Logical Minimum item data, for sign extension
+    uint8_t logical_max_size;       // Size of Logical Maximum item data, for sign extension
+    uint32_t logical_min;           // Logical Minimum item data
+    uint32_t logical_max;           // Logical Maximum item data
+    uint32_t report_size;
+    uint32_t report_count;
+} hid_global_state_t;
+
+/**
+ * @brief Local item state, cleared after each main item
+ *
+ * Usages are kept with Usage Page in the upper 16 bits if it was given in the item (extended usage),
+ * otherwise the Usage Page of the global state at the main item applies.
+ */
+typedef struct {
+    uint32_t usages[HID_REPORT_MAP_USAGES_MAX];
+    uint8_t num_usages;
+    bool usage_range;
+    uint32_t usage_min;
+    uint32_t usage_max;
+} hid_local_state_t;
+
+/**
+ * @brief Report descriptor compiler context
+ */
+typedef struct {
+    hid_global_state_t global;
+    hid_global_state_t global_stack[HID_REPORT_MAP_GLOBAL_STACK];
+    uint8_t global_stack_depth;
+    hid_local_state_t local;
+    unsigned collection_depth;
+    uint32_t (*bit_offsets)[256];   // Length in bits of every report type and Report ID so far
+    hid_report_field_t *fields;
+    size_t num_fields;
+    size_t fields_size;
+} hid_report_compiler_t;
+
+static int32_t sign_extend(uint32_t value, uint8_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    const unsigned shift = 32 - size * 8;
+    return (int32_t)(value << shift) >> shift;
+}
+
+static void usage_split(uint32_t usage, uint16_t usage_page, uint16_t *page_out, uint16_t *usage_out)
+{
+    *page_out = (usage >> 16) ? (usage >> 16) : usage_page;
+    *usage_out = usage & 0xFFFF;
+}
+
+static esp_err_t fields_reserve(hid_report_compiler_t *ctx, size_t num)
+{
+    ESP_RETURN_ON_FALSE(ctx->num_fields + num <= HID_REPORT_MAP_FIELDS_MAX,
+                        ESP_ERR_NOT_SUPPORTED, TAG, "Too many report fields");
+    if (ctx->num_fields + num <= ctx->fields_size) {
+        return ESP_OK;
+    }
+    size_t new_size = ctx->fields_size ? ctx->fields_size * 2 : 16;
+    while (new_size < ctx->num_fields + num) {
+        new_size *= 2;
+    }
+    hid_report_field_t *fields = realloc(ctx->fields, new_size * sizeof(hid_report_field_t));
+    ESP_RETURN_ON_FALSE(fields, ESP_ERR_NO_MEM, TAG, "Unable to allocate report fields");
+    ctx->fields = fields;
+    ctx->fields_size = new_size;
+    return ESP_OK;
+}
+
+/**
+ * @brief Add fields of an Input, Output or Feature item
+ *
+ * @param[in] ctx   Compiler context
+ * @param[in] type  Report type
+ * @param[in] data  Main item data
+ * @return esp_err_t
+ */
+static esp_err_t main_item_compile(hid_report_compiler_t *ctx, hid_report_type_t type, uint32_t data)
+{
+    const hid_global_state_t *global = &ctx->global;
+    const hid_local_state_t *local = &ctx->local;
+    uint32_t *bit_offset = &ctx->bit_offsets[type - HID_REPORT_TYPE_INPUT][global->report_id];
+
+    // Reports with ID start with the Report ID byte
+    if (*bit_offset == 0 && global->report_id != 0) {
+        *bit_offset = 8;
+    }
+
+    const uint32_t bits = global->report_size * global->report_count;
+    ESP_RETURN_ON_FALSE(global->report_count <= UINT16_MAX && *bit_offset + bits <= UINT16_MAX,
+                        ESP_ERR_NOT_SUPPORTED, TAG, "Report too long");
+    const uint32_t first_bit = *bit_offset;
+    *bit_offset += bits;
+
+    if ((data & HID_MAIN_DATA_CONSTANT) || bits == 0) {
+        return ESP_OK; // Padding
+    }
+    ESP_RETURN_ON_FALSE(global->report_size <= 32,
+                        ESP_ERR_NOT_SUPPORTED, TAG, "Report field larger than 32 bits");
+
+    hid_report_field_t field = {
+        .report_type = type,
+        .report_id = global->report_id,
+        .bit_size = global->report_size,
+        .flags = 0,
+        .logical_min = sign_extend(global->logical_min, global->logical_min_size),
+    };
+    // Logical Maximum is often given unsigned with the sign bit set, e.g. 0xFF for 0..255
+    field.logical_max = (field.logical_min < 0) ? sign_extend(global->logical_max, global->logical_max_size)
+                        : (int32_t)global->logical_max;
+    if (field.logical_min < 0) {
+        field.flags |= HID_REPORT_FIELD_FLAG_SIGNED;
+    }
+    if (data & HID_MAIN_DATA_RELATIVE) {
+        field.flags |= HID_REPORT_FIELD_FLAG_RELATIVE;
+    }
+
+    uint16_t usage_max_page; // Usage range cannot span Usage Pages
+    usage_split(local->usage_range ? local->usage_min : (local->num_usages ? local->usages[0] : 0),
+                global->usage_page, &field.usage_page, &field.usage_min);
+    usage_split(local->usage_range ? local->usage_max : (local->num_usages ? local->usages[local->num_usages - 1] : 0),
+                global->usage_page, &usage_max_page, &field.usage_max);
+
+    if (!(data & HID_MAIN_DATA_VARIABLE)) {
+        field.flags |= HID_REPORT_FIELD_FLAG_ARRAY;
+        field.usage = field.usage_min;
+    }
+
+    ESP_RETURN_ON_ERROR(fields_reserve(ctx, global->report_count), TAG, "");
+    for (uint32_t i = 0; i < global->report_count; i++) {
+        hid_report_field_t *new_field = &ctx->fields[ctx->num_fields++];
+        *new_field = field;
+        new_field->bit_offset = first_bit + i * global->report_size;
+        if (data & HID_MAIN_DATA_VARIABLE) {
+            // Every control of a Variable item has its own usage, the last usage repeats
+            if (local->usage_range) {
+                new_field->usage = ((int)i <= field.usage_max - field.usage_min) ? field.usage_min + i : field.usage_max;
+            } else if (local->num_usages) {
+                usage_split(local->usages[(i < local->num_usages) ? i : local->num_usages - 1],
+                            global->usage_page, &new_field->usage_page, &new_field->usage);
+            }
+            new_field->usage_min = new_field->usage;
+            new_field->usage_max = new_field->usage;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t global_item_compile(hid_report_compiler_t *ctx, uint8_t tag, uint32_t data, uint8_t size)
+{
+    hid_global_state_t *global = &ctx->global;
+    switch (tag) {
+    case HID_GLOBAL_USAGE_PAGE:
+        global->usage_page = data;
+        break;
+    case HID_GLOBAL_LOGICAL_MIN:
+        global->logical_min = data;
+        global->logical_min_size = size;
+        break;
+    case HID_GLOBAL_LOGICAL_MAX:
+        global->logical_max = data;
+        global->logical_max_size = size;
+        break;
+    case HID_GLOBAL_REPORT_SIZE:
+        global->report_size = data;
+        break;
+    case HID_GLOBAL_REPORT_ID:
+        ESP_RETURN_ON_FALSE(data != 0 && data <= UINT8_MAX,
+                            ESP_ERR_NOT_SUPPORTED, TAG, "Invalid Report ID");
+        global->report_id = data;
+        break;
+    case HID_GLOBAL_REPORT_COUNT:
+        global->report_count = data;
+        break;
+    case HID_GLOBAL_PUSH:
+        ESP_RETURN_ON_FALSE(ctx->global_stack_depth < HID_REPORT_MAP_GLOBAL_STACK,
+                            ESP_ERR_NOT_SUPPORTED, TAG, "Push too deep");
+        ctx->global_stack[ctx->global_stack_depth++] = *global;
+        break;
+    case HID_GLOBAL_POP:
+        ESP_RETURN_ON_FALSE(ctx->global_stack_depth > 0,
+                            ESP_ERR_NOT_SUPPORTED, TAG, "Pop without Push");
+        *global = ctx->global_stack[--ctx->global_stack_depth];
+        break;
+    default:
+        break; // Physical range and units are not part of the field table
+    }
+    return ESP_OK;
+}
+
+static void local_item_compile(hid_report_compiler_t *ctx, uint8_t tag, uint32_t data, uint8_t size)
+{
+    hid_local_state_t *local = &ctx->local;
+    // Usage Page is a part of the usage only in 4 byte items
+    if (size < 4) {
+        data &= 0xFFFF;
+    }
+    switch (tag) {
+    case HID_LOCAL_USAGE:
+        if (local->num_usages < HID_REPORT_MAP_USAGES_MAX) {
+            local->usages[local->num_usages++] = data;
+        }
+        break;
+    case HID_LOCAL_USAGE_MIN:
+        local->usage_range = true;
+        local->usage_min = data;
+        break;
+    case HID_LOCAL_USAGE_MAX:
+        local->usage_range = true;
+        local->usage_max = data;
+        break;
+    default:
+        break; // Designators, strings and delimiters are not supported
+    }
+}
+
+static bool field_compare_report(const hid_report_field_t *a, const hid_report_field_t *b)
+{
+    return a->report_type != b->report_type || a->report_id != b->report_id;
+}
+
+static int field_compare(const void *a, const void *b)
+{
+    const hid_report_field_t *fa = a;
+    const hid_report_field_t *fb = b;
+    if (fa->report_type != fb->report_type) {
+        return fa->report_type - fb->report_type;
+    }
+    if (fa->report_id != fb->report_id) {
+        return fa->report_id - fb->report_id;
+    }
+    return fa->bit_offset - fb->bit_offset;
+}
+
+/**
+ * @brief Sort fields by report and build the report table
+ *
+ * @param[in] ctx   Compiler context
+ * @param[in] map   Report map to fill
+ * @return esp_err_t
+ */
+static esp_err_t report_table_build(hid_report_compiler_t *ctx, hid_report_map_t *map)
+{
+    qsort(ctx->fields, ctx->num_fields, sizeof(hid_report_field_t), field_compare);
+
+    size_t num_reports = 0;
+    for (size_t i = 0; i < ctx->num_fields; i++) {
+        if (i == 0 || field_compare_report(&ctx->fields[i - 1], &ctx->fields[i])) {
+            num_reports++;
+        }
+    }
+
+    hid_report_info_t *reports = calloc(num_reports ? num_reports : 1, sizeof(hid_report_info_t));
+    ESP_RETURN_ON_FALSE(reports, ESP_ERR_NO_MEM, TAG, "Unable to allocate report table");
+
+    hid_report_info_t *report = NULL;
+    for (size_t i = 0; i < ctx->num_fields; i++) {
+        const hid_report_field_t *field = &ctx->fields[i];
+        if (i == 0 || field_compare_report(&ctx->fields[i - 1], field)) {
+            report = (report == NULL) ? reports : report + 1;
+            report->report_type = field->report_type;
+            report->report_id = field->report_id;
+            report->length = (ctx->bit_offsets[field->report_type - HID_REPORT_TYPE_INPUT][field->report_id] + 7) / 8;
+            report->fields = field;
+        }
+        report->num_fields++;
+    }
+
+    map->fields = ctx->fields;
+    map->num_fields = ctx->num_fields;
+    map->reports = reports;
+    map->num_reports = num_reports;
+    ctx->fields = NULL;
+    return ESP_OK;
+}
+
+/**
+ * @brief Compile all items of a report descriptor
+ *
+ * @param[in] ctx      Compiler context
+ * @param[in] desc     Report descriptor
+ * @param[in] len      Report descriptor length
+ * @param[out] map     Report map to fill
+ * @return esp_err_t
+ */
+static esp_err_t report_desc_compile(hid_report_compiler_t *ctx, const uint8_t *desc, size_t len, hid_report_map_t *map)
+{
+    size_t pos = 0;
+    while (pos < len) {
+        const uint8_t prefix = desc[pos];
+        if (prefix == HID_ITEM_LONG_PREFIX) {
+            // Long items are reserved, skip bDataSize, bLongItemTag and data
+            ESP_RETURN_ON_FALSE(pos + 1 < len, ESP_ERR_INVALID_SIZE, TAG, "Long item truncated");
+            pos += 3 + desc[pos + 1];
+            continue;
+        }
+        const uint8_t size = ((prefix & 0x03) == 3) ? 4 : (prefix & 0x03);
+        const uint8_t type = (prefix >> 2) & 0x03;
+        const uint8_t tag = prefix >> 4;
+        ESP_RETURN_ON_FALSE(pos + 1 + size <= len, ESP_ERR_INVALID_SIZE, TAG, "Item truncated");
+        uint32_t data = 0;
+        for (int i = 0; i < size; i++) {
+            data |= (uint32_t)desc[pos + 1 + i] << (8 * i);
+        }
+        pos += 1 + size;
+
+        switch (type) {
+        case HID_ITEM_TYPE_MAIN:
+            switch (tag) {
+            case HID_MAIN_INPUT:
+                ESP_RETURN_ON_ERROR(main_item_compile(ctx, HID_REPORT_TYPE_INPUT, data), TAG, "");
+                break;
+            case HID_MAIN_OUTPUT:
+                ESP_RETURN_ON_ERROR(main_item_compile(ctx, HID_REPORT_TYPE_OUTPUT, data), TAG, "");
+                break;
+            case HID_MAIN_FEATURE:
+                ESP_RETURN_ON_ERROR(main_item_compile(ctx, HID_REPORT_TYPE_FEATURE, data), TAG, "");
+                break;
+            case HID_MAIN_COLLECTION:
+                ctx->collection_depth++;
+                break;
+            case HID_MAIN_END_COLLECTION:
+                ESP_RETURN_ON_FALSE(ctx->collection_depth > 0,
+                                    ESP_ERR_NOT_SUPPORTED, TAG, "End Collection without Collection");
+                ctx->collection_depth--;
+                break;
+            default:
+                break;
+            }
+            memset(&ctx->local, 0, sizeof(ctx->local));
+            break;
+        case HID_ITEM_TYPE_GLOBAL:
+            if (tag == HID_GLOBAL_REPORT_ID) {
+                map->report_ids = true;
+            }
+            ESP_RETURN_ON_ERROR(global_item_compile(ctx, tag, data, size), TAG, "");
+            break;
+        case HID_ITEM_TYPE_LOCAL:
+            local_item_compile(ctx, tag, data, size);
+            break;
+        default:
+            break; // Reserved
+        }
+    }
+    return report_table_build(ctx, map);
+}
+
+esp_err_t hid_report_map_create(const uint8_t *report_desc, size_t report_desc_len, hid_report_map_t **map)
+{
+    ESP_RETURN_ON_FALSE(report_desc && report_desc_len && map, ESP_ERR_INVALID_ARG, TAG, "Argument error");
+
+    esp_err_t ret;
+    hid_report_map_t *new_map = calloc(1, sizeof(hid_report_map_t));
+    hid_report_compiler_t *ctx = calloc(1, sizeof(hid_report_compiler_t));
+    ESP_GOTO_ON_FALSE(new_map && ctx, ESP_ERR_NO_MEM, fail, TAG, "Unable to allocate report map");
+    ctx->bit_offsets = calloc(HID_REPORT_MAP_TYPE_NUM, sizeof(*ctx->bit_offsets));
+    ESP_GOTO_ON_FALSE(ctx->bit_offsets, ESP_ERR_NO_MEM, fail, TAG, "Unable to allocate report map");
+
+    ESP_GOTO_ON_ERROR(report_desc_compile(ctx, report_desc, report_desc_len, new_map),
+                      fail, TAG, "Unable to compile report descriptor");
+
+    free(ctx->bit_offsets);
+    free(ctx);
+    *map = new_map;
+    return ESP_OK;
+
+fail:
+    if (ctx) {
+        free(ctx->fields);
+        free(ctx->bit_offsets);
+        free(ctx);
+    }
+    free(new_map);
+    return ret;
+}
+
+void hid_report_map_delete(hid_report_map_t *map)
+{
+    if (map) {
+        free((void *)map->fields);
+        free((void *)map->reports);
+        free(map);
+    }
+}
+
+const hid_report_info_t *hid_report_map_find(const hid_report_map_t *map,
+        hid_report_type_t type,
+        const uint8_t *data,
+        size_t length)
+{
+    if (map == NULL || data == NULL || length == 0) {
+        return NULL;
+    }
+    const uint8_t report_id = map->report_ids ? data[0] : 0;
+    for (size_t i = 0; i < map->num_reports; i++) {
+        const hid_report_info_t *report = &map->reports[i];
+        if (report->report_type == type && report->report_id == report_id) {
+            return (length >= report->length) ? report : NULL;
+        }
+    }
+    return NULL;
+}
+
+int32_t hid_report_field_get(const hid_report_field_t *field, const uint8_t *data)
+{
+    // At most 5 bytes hold a 32 bit value that does not start on a byte boundary
+    const uint8_t *p = data + (field->bit_offset >> 3);
+    const unsigned shift = field->bit_offset & 0x07;
+    const unsigned num_bytes = (shift + field->bit_size + 7) >> 3;
+    uint64_t raw = 0;
+    for (unsigned i = 0; i < num_bytes; i++) {
+        raw |= (uint64_t)p[i] << (8 * i);
+    }
+    const uint32_t value = (uint32_t)(raw >> shift) & (uint32_t)(UINT64_MAX >> (64 - field->bit_size));
+    // Sign extension with shifts, sign_shift is 0 for unsigned fields
+    const unsigned sign_shift = (field->flags & HID_REPORT_FIELD_FLAG_SIGNED) ? 32 - field->bit_size : 0;
+    return (int32_t)(value << sign_shift) >> sign_shift;
+}
+
+uint16_t hid_report_field_array_usage(const hid_report_field_t *field, int32_t value)
+{
+    if (value < field->logical_min || value > field->logical_max) {
+        return 0;
+    }
+    const int32_t usage = field->usage_min + (value - field->logical_min);
+    return (usage <= field->usage_max) ? usage : 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Boot keyboard, one HID interface with IN endpoint
+const uint8_t boot_keyboard_config_desc[] = {
+    0x09, 0x02, 0x22, 0x00, 0x01, 0x01, 0x00, 0xA0, 0x32, // Configuration: 34 bytes, 1 interface
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x03, 0x01, 0x01, 0x00, // Interface 0: HID, Boot, Keyboard
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x3F, 0x00, // HID 1.11, Report descriptor 63 bytes
+    0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0A,             // EP 0x81: Interrupt IN, 8 bytes, 10 ms
+};
+
+// Keyboard and mouse composite, keyboard with Interrupt OUT endpoint for LEDs
+const uint8_t keyboard_mouse_config_desc[] = {
+    0x09, 0x02, 0x42, 0x00, 0x02, 0x01, 0x00, 0xA0, 0x32, // Configuration: 66 bytes, 2 interfaces
+    0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x01, 0x01, 0x00, // Interface 0: HID, Boot, Keyboard
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x41, 0x00, // HID 1.11, Report descriptor 65 bytes
+    0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0A,             // EP 0x81: Interrupt IN, 8 bytes, 10 ms
+    0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0A,             // EP 0x02: Interrupt OUT, 8 bytes, 10 ms
+    0x09, 0x04, 0x01, 0x00, 0x01, 0x03, 0x01, 0x02, 0x00, // Interface 1: HID, Boot, Mouse
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x34, 0x00, // HID 1.11, Report descriptor 52 bytes
+    0x07, 0x05, 0x83, 0x03, 0x04, 0x00, 0x0A,             // EP 0x83: Interrupt IN, 4 bytes, 10 ms
+};
+
+// TinyUSB CDC-ACM and HID composite with IAD, only the last interface is HID
+const uint8_t cdc_hid_composite_config_desc[] = {
+    0x09, 0x02, 0x6B, 0x00, 0x03, 0x01, 0x00, 0xA0, 0x32, // Configuration: 107 bytes, 3 interfaces
+    0x08, 0x0B, 0x00, 0x02, 0x02, 0x02, 0x00, 0x00,       // IAD: Interfaces 0-1, CDC ACM
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x02, 0x02, 0x00, 0x00, // Interface 0: CDC Communication, ACM
+    0x05, 0x24, 0x00, 0x10, 0x01,                         // CDC Header
+    0x05, 0x24, 0x01, 0x00, 0x01,                         // CDC Call Management
+    0x04, 0x24, 0x02, 0x02,                               // CDC ACM
+    0x05, 0x24, 0x06, 0x00, 0x01,                         // CDC Union
+    0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x10,             // EP 0x81: Interrupt IN, 8 bytes
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x00, // Interface 1: CDC Data
+    0x07, 0x05, 0x02, 0x02, 0x40, 0x00, 0x00,             // EP 0x02: Bulk OUT, 64 bytes
+    0x07, 0x05, 0x82, 0x02, 0x40, 0x00, 0x00,             // EP 0x82: Bulk IN, 64 bytes
+    0x09, 0x04, 0x02, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, // Interface 2: HID, no boot protocol
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x20, 0x00, // HID 1.11, Report descriptor 32 bytes
+    0x07, 0x05, 0x84, 0x03, 0x40, 0x00, 0x01,             // EP 0x84: Interrupt IN, 64 bytes, 1 ms
+    0x07, 0x05, 0x03, 0x03, 0x40, 0x00, 0x01,             // EP 0x03: Interrupt OUT, 64 bytes, 1 ms
+};
+
+// Vendor device with HID interface whose OUT endpoint is Bulk, so it is not used as HID OUT endpoint
+const uint8_t hid_bulk_out_config_desc[] = {
+    0x09, 0x02, 0x32, 0x00, 0x02, 0x01, 0x00, 0x80, 0xFA, // Configuration: 50 bytes, 2 interfaces
+    0x09, 0x04, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, // Interface 0: Vendor specific, no endpoints
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, // Interface 1: HID, no boot protocol
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x1C, 0x00, // HID 1.11, Report descriptor 28 bytes
+    0x07, 0x05, 0x02, 0x02, 0x40, 0x00, 0x00,             // EP 0x02: Bulk OUT, 64 bytes
+    0x07, 0x05, 0x85, 0x03, 0x40, 0x00, 0x04,             // EP 0x85: Interrupt IN, 64 bytes, 4 ms
+};
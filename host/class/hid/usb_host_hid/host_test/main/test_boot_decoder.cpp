@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/hid_boot_decoder.h"
+
+static void keyboard_event_cb(const hid_keyboard_event_t *event, void *arg)
+{
+    auto *events = static_cast<std::vector<hid_keyboard_event_t> *>(arg);
+    events->push_back(*event);
+}
+
+SCENARIO("HID boot keyboard decoding")
+{
+    hid_keyboard_state_t state;
+    hid_keyboard_state_init(&state);
+    std::vector<hid_keyboard_event_t> events;
+
+    const uint8_t shift_a_b[8] = {HID_LEFT_SHIFT, 0, HID_KEY_A, HID_KEY_B, 0, 0, 0, 0};
+    REQUIRE(ESP_OK == hid_keyboard_decode(&state, shift_a_b, sizeof(shift_a_b), keyboard_event_cb, &events));
+    REQUIRE(3 == events.size());
+    REQUIRE((events[0].key == HID_KEY_A && events[0].pressed));
+    REQUIRE((events[1].key == HID_KEY_B && events[1].pressed));
+    REQUIRE((events[2].key == HID_KEY_LEFT_SHIFT && events[2].pressed));
+    REQUIRE(HID_LEFT_SHIFT == events[2].modifier);
+
+    SECTION("Changed keys are reported, releases first") {
+        // Key slots are reordered, A released, C pressed
+        const uint8_t b_c[8] = {0, 0, HID_KEY_C, HID_KEY_B, 0, 0, 0, 0};
+        events.clear();
+        REQUIRE(ESP_OK == hid_keyboard_decode(&state, b_c, sizeof(b_c), keyboard_event_cb, &events));
+        REQUIRE(3 == events.size());
+        REQUIRE((events[0].key == HID_KEY_A && !events[0].pressed));
+        REQUIRE((events[1].key == HID_KEY_LEFT_SHIFT && !events[1].pressed));
+        REQUIRE((events[2].key == HID_KEY_C && events[2].pressed));
+    }
+
+    SECTION("Phantom state keeps pressed keys") {
+        const uint8_t rollover[8] = {HID_LEFT_SHIFT, 0, HID_KEY_ROLLOVER, HID_KEY_ROLLOVER, HID_KEY_ROLLOVER,
+                                     HID_KEY_ROLLOVER, HID_KEY_ROLLOVER, HID_KEY_ROLLOVER
+                                    };
+        events.clear();
+        REQUIRE(ESP_OK == hid_keyboard_decode(&state, rollover, sizeof(rollover), keyboard_event_cb, &events));
+        REQUIRE(events.empty());
+
+        const uint8_t released[8] = {};
+        REQUIRE(ESP_OK == hid_keyboard_decode(&state, released, sizeof(released), keyboard_event_cb, &events));
+        REQUIRE(3 == events.size());
+    }
+
+    SECTION("Short report") {
+        REQUIRE(ESP_ERR_INVALID_SIZE == hid_keyboard_decode(&state, shift_a_b, 4, keyboard_event_cb, &events));
+    }
+}
+
+SCENARIO("HID boot mouse decoding")
+{
+    hid_mouse_state_t state = {};
+    hid_mouse_event_t event;
+
+    const uint8_t report[4] = {0x01, 0xFF, 0x02, 0xFF}; // Button 1, X -1, Y 2, wheel -1
+    REQUIRE(ESP_OK == hid_mouse_decode(&state, report, sizeof(report), &event));
+    REQUIRE(-1 == event.x);
+    REQUIRE(2 == event.y);
+    REQUIRE(-1 == event.wheel);
+    REQUIRE(0x01 == event.pressed);
+    REQUIRE(0 == event.released);
+
+    const uint8_t boot_report[3] = {0x02, 0, 0}; // Button 1 released, button 2 pressed, no wheel
+    REQUIRE(ESP_OK == hid_mouse_decode(&state, boot_report, sizeof(boot_report), &event));
+    REQUIRE(0 == event.wheel);
+    REQUIRE(0x02 == event.pressed);
+    REQUIRE(0x01 == event.released);
+}
@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "hid_host_descriptor_parsing.h"
+#include "descriptors/hid_descriptors.hpp"
+
+/*
+ * Configuration descriptor walk benchmark
+ *
+ * hid_config_desc_parse() runs on every device connection. It is timed on every fixture, results are printed
+ * in ns per walk, so they can be compared between CI runs.
+ *
+ * Environment variables:
+ * - HID_BENCHMARK_ROUNDS:           Number of walks of each fixture (default 10000)
+ * - HID_BENCHMARK_MAX_NS_PER_PARSE: If set, the test fails when any fixture is slower than this
+ */
+
+/**
+ * @brief Configuration descriptor fixture
+ */
+struct fixture_t {
+    const char *name;
+    const uint8_t *cfg_desc;
+    size_t num_hid_ifaces;
+};
+
+static int benchmark_rounds(void)
+{
+    const char *rounds = getenv("HID_BENCHMARK_ROUNDS");
+    return rounds ? atoi(rounds) : 10000;
+}
+
+SCENARIO("HID interfaces in Configuration descriptor", "[hid][parsing]")
+{
+    hid_iface_desc_t *table = nullptr;
+    size_t num = 0;
+
+    GIVEN("Keyboard and mouse composite") {
+        REQUIRE(ESP_OK == hid_config_desc_parse((const usb_config_desc_t *)keyboard_mouse_config_desc, &table, &num));
+        REQUIRE(num == 2);
+        REQUIRE(table[0].iface_desc->bInterfaceNumber == 0);
+        REQUIRE(table[0].hid_desc != nullptr);
+        REQUIRE(table[0].ep_in_desc->bEndpointAddress == 0x81);
+        REQUIRE(table[0].ep_out_desc->bEndpointAddress == 0x02);
+        REQUIRE(table[1].iface_desc->bInterfaceNumber == 1);
+        REQUIRE(table[1].hid_desc != nullptr);
+        REQUIRE(table[1].ep_in_desc->bEndpointAddress == 0x83);
+        REQUIRE(table[1].ep_out_desc == nullptr);
+    }
+
+    GIVEN("CDC-ACM and HID composite") {
+        REQUIRE(ESP_OK == hid_config_desc_parse((const usb_config_desc_t *)cdc_hid_composite_config_desc, &table, &num));
+        REQUIRE(num == 1);
+        REQUIRE(table[0].iface_desc->bInterfaceNumber == 2);
+        REQUIRE(table[0].hid_desc != nullptr);
+        REQUIRE(table[0].ep_in_desc->bEndpointAddress == 0x84);
+        REQUIRE(table[0].ep_out_desc->bEndpointAddress == 0x03);
+    }
+
+    GIVEN("HID interface with Bulk OUT endpoint") {
+        REQUIRE(ESP_OK == hid_config_desc_parse((const usb_config_desc_t *)hid_bulk_out_config_desc, &table, &num));
+        REQUIRE(num == 1);
+        REQUIRE(table[0].iface_desc->bInterfaceNumber == 1);
+        REQUIRE(table[0].ep_in_desc->bEndpointAddress == 0x85);
+        REQUIRE(table[0].ep_out_desc == nullptr);
+    }
+
+    free(table);
+}
+
+TEST_CASE("Configuration descriptor walk speed", "[hid][parsing][benchmark]")
+{
+    const fixture_t fixture = GENERATE(values<fixture_t>({
+        {"Boot keyboard", boot_keyboard_config_desc, 1},
+        {"Keyboard and mouse composite", keyboard_mouse_config_desc, 2},
+        {"CDC-ACM and HID composite", cdc_hid_composite_config_desc, 1},
+        {"HID with Bulk OUT endpoint", hid_bulk_out_config_desc, 1},
+    }));
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)fixture.cfg_desc;
+    const int rounds = benchmark_rounds();
+    size_t found = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        hid_iface_desc_t *table = nullptr;
+        size_t num = 0;
+        REQUIRE(ESP_OK == hid_config_desc_parse(cfg, &table, &num));
+        found += num;
+        free(table);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    REQUIRE(found == fixture.num_hid_ifaces * rounds);
+    printf("%-40s %4u B %8.1f ns/parse\n", fixture.name, cfg->wTotalLength, ns);
+    const char *max_ns = getenv("HID_BENCHMARK_MAX_NS_PER_PARSE");
+    if (max_ns) {
+        CHECK(ns <= atof(max_ns));
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/hid_report_map.h"
+
+// Boot keyboard report descriptor, Appendix B.1 of Device Class Definition for HID 1.11
+static const uint8_t keyboard_report_desc[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,             // Usage Page (Generic Desktop), Usage (Keyboard), Collection (Application)
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7,             // Usage Page (Key Codes), Usage Minimum (224), Usage Maximum (231)
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, // Logical Minimum (0), Logical Maximum (1), Report Size (1), Report Count (8)
+    0x81, 0x02,                                     // Input (Data, Variable, Absolute), Modifier byte
+    0x95, 0x01, 0x75, 0x08, 0x81, 0x01,             // Report Count (1), Report Size (8), Input (Constant), Reserved byte
+    0x95, 0x05, 0x75, 0x01, 0x05, 0x08,             // Report Count (5), Report Size (1), Usage Page (LEDs)
+    0x19, 0x01, 0x29, 0x05, 0x91, 0x02,             // Usage Minimum (1), Usage Maximum (5), Output (Data, Variable, Absolute)
+    0x95, 0x01, 0x75, 0x03, 0x91, 0x01,             // Report Count (1), Report Size (3), Output (Constant), LED padding
+    0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, // Report Count (6), Report Size (8), Logical Minimum (0), Logical Maximum (101)
+    0x05, 0x07, 0x19, 0x00, 0x29, 0x65,             // Usage Page (Key Codes), Usage Minimum (0), Usage Maximum (101)
+    0x81, 0x00,                                     // Input (Data, Array), Key arrays (6 bytes)
+    0xC0                                            // End Collection
+};
+
+// Mouse with Report ID and 12 bit signed axes
+static const uint8_t mouse_report_desc[] = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01,             // Usage Page (Generic Desktop), Usage (Mouse), Collection (Application)
+    0x85, 0x02, 0x09, 0x01, 0xA1, 0x00,             // Report ID (2), Usage (Pointer), Collection (Physical)
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x03,             // Usage Page (Buttons), Usage Minimum (1), Usage Maximum (3)
+    0x15, 0x00, 0x25, 0x01, 0x95, 0x03, 0x75, 0x01, // Logical Minimum (0), Logical Maximum (1), Report Count (3), Report Size (1)
+    0x81, 0x02,                                     // Input (Data, Variable, Absolute)
+    0x95, 0x01, 0x75, 0x05, 0x81, 0x01,             // Report Count (1), Report Size (5), Input (Constant)
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31,             // Usage Page (Generic Desktop), Usage (X), Usage (Y)
+    0x16, 0x01, 0xF8, 0x26, 0xFF, 0x07,             // Logical Minimum (-2047), Logical Maximum (2047)
+    0x75, 0x0C, 0x95, 0x02, 0x81, 0x06,             // Report Size (12), Report Count (2), Input (Data, Variable, Relative)
+    0xC0, 0xC0                                      // End Collection, End Collection
+};
+
+SCENARIO("HID report descriptor compiling")
+{
+    hid_report_map_t *map = nullptr;
+
+    GIVEN("Boot keyboard report descriptor") {
+        REQUIRE(ESP_OK == hid_report_map_create(keyboard_report_desc, sizeof(keyboard_report_desc), &map));
+        REQUIRE_FALSE(map->report_ids);
+        REQUIRE(2 == map->num_reports);
+
+        SECTION("Input report has 8 modifier bits and 6 key array slots") {
+            const uint8_t report[8] = {0x02, 0x00, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00}; // Left Shift, 'a', 'b'
+            const hid_report_info_t *input = hid_report_map_find(map, HID_REPORT_TYPE_INPUT, report, sizeof(report));
+            REQUIRE(input != nullptr);
+            REQUIRE(8 == input->length);
+            REQUIRE(14 == input->num_fields);
+
+            const hid_report_field_t *left_shift = &input->fields[1];
+            REQUIRE(0x07 == left_shift->usage_page);
+            REQUIRE(0xE1 == left_shift->usage);
+            REQUIRE(1 == hid_report_field_get(left_shift, report));
+            REQUIRE(0 == hid_report_field_get(&input->fields[0], report));
+
+            const hid_report_field_t *key = &input->fields[8];
+            REQUIRE(key->flags & HID_REPORT_FIELD_FLAG_ARRAY);
+            REQUIRE(16 == key->bit_offset);
+            REQUIRE(0x04 == hid_report_field_array_usage(key, hid_report_field_get(key, report)));
+            REQUIRE(0x05 == hid_report_field_array_usage(&input->fields[9], hid_report_field_get(&input->fields[9], report)));
+            REQUIRE(0 == hid_report_field_array_usage(key, 0x80));
+        }
+
+        SECTION("Output report has 5 LEDs") {
+            const uint8_t report[1] = {0x02}; // Caps Lock
+            const hid_report_info_t *output = hid_report_map_find(map, HID_REPORT_TYPE_OUTPUT, report, sizeof(report));
+            REQUIRE(output != nullptr);
+            REQUIRE(1 == output->length);
+            REQUIRE(5 == output->num_fields);
+            REQUIRE(0x08 == output->fields[1].usage_page);
+            REQUIRE(0x02 == output->fields[1].usage);
+            REQUIRE(1 == hid_report_field_get(&output->fields[1], report));
+        }
+
+        SECTION("Short report is not decoded") {
+            const uint8_t report[4] = {};
+            REQUIRE(nullptr == hid_report_map_find(map, HID_REPORT_TYPE_INPUT, report, sizeof(report)));
+            REQUIRE(nullptr == hid_report_map_find(map, HID_REPORT_TYPE_FEATURE, report, sizeof(report)));
+        }
+        hid_report_map_delete(map);
+    }
+
+    GIVEN("Mouse report descriptor with Report ID") {
+        REQUIRE(ESP_OK == hid_report_map_create(mouse_report_desc, sizeof(mouse_report_desc), &map));
+        REQUIRE(map->report_ids);
+        REQUIRE(1 == map->num_reports);
+
+        SECTION("Fields start after Report ID and signed values are sign extended") {
+            const uint8_t report[5] = {0x02, 0x05, 0xFF, 0x2F, 0x00}; // Buttons 1 and 3, X = -1, Y = 2
+            const hid_report_info_t *input = hid_report_map_find(map, HID_REPORT_TYPE_INPUT, report, sizeof(report));
+            REQUIRE(input != nullptr);
+            REQUIRE(5 == input->length);
+            REQUIRE(5 == input->num_fields);
+            REQUIRE(8 == input->fields[0].bit_offset);
+            REQUIRE(1 == hid_report_field_get(&input->fields[0], report));
+            REQUIRE(0 == hid_report_field_get(&input->fields[1], report));
+            REQUIRE(1 == hid_report_field_get(&input->fields[2], report));
+
+            const hid_report_field_t *x = &input->fields[3];
+            REQUIRE(0x30 == x->usage);
+            REQUIRE(-2047 == x->logical_min);
+            REQUIRE(2047 == x->logical_max);
+            REQUIRE((x->flags & HID_REPORT_FIELD_FLAG_RELATIVE));
+            REQUIRE(-1 == hid_report_field_get(x, report));
+            REQUIRE(2 == hid_report_field_get(&input->fields[4], report));
+        }
+
+        SECTION("Unknown Report ID is not decoded") {
+            const uint8_t report[5] = {0x01};
+            REQUIRE(nullptr == hid_report_map_find(map, HID_REPORT_TYPE_INPUT, report, sizeof(report)));
+        }
+        hid_report_map_delete(map);
+    }
+
+    GIVEN("Malformed report descriptors") {
+        SECTION("Truncated item") {
+            const uint8_t desc[] = {0x05, 0x01, 0x26, 0xFF};
+            REQUIRE(ESP_ERR_INVALID_SIZE == hid_report_map_create(desc, sizeof(desc), &map));
+        }
+
+        SECTION("End Collection without Collection") {
+            const uint8_t desc[] = {0x05, 0x01, 0xC0};
+            REQUIRE(ESP_ERR_NOT_SUPPORTED == hid_report_map_create(desc, sizeof(desc), &map));
+        }
+
+        SECTION("Field larger than 32 bits") {
+            const uint8_t desc[] = {0x75, 0x40, 0x95, 0x01, 0x81, 0x02};
+            REQUIRE(ESP_ERR_NOT_SUPPORTED == hid_report_map_create(desc, sizeof(desc), &map));
+        }
+    }
+}
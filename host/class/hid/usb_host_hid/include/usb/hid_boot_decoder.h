@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "hid_host.h"
+#include "hid_usage_keyboard.h"
+#include "hid_usage_mouse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Keyboard state for the boot protocol decoder
+ *
+ * Pressed keys are kept as a bitset of 256 usages, modifiers as usages HID_KEY_LEFT_CONTROL..0xE7.
+ * Initialize with hid_keyboard_state_init() before the first report.
+ */
+typedef struct {
+    uint32_t pressed[8];        /**< Bitset of pressed key usages */
+} hid_keyboard_state_t;
+
+/**
+ * @brief Keyboard key event
+ */
+typedef struct {
+    uint8_t key;                /**< Key usage, hid_key_t. Modifiers are reported as keys 0xE0..0xE7 */
+    bool pressed;               /**< true if the key was pressed, false if it was released */
+    uint8_t modifier;           /**< Modifier bit mask of the report, HID_LEFT_CONTROL..HID_RIGHT_GUI */
+} hid_keyboard_event_t;
+
+/**
+ * @brief Keyboard key event callback
+ *
+ * @param[in] event  Key event
+ * @param[in] arg    User argument
+ */
+typedef void (*hid_keyboard_event_cb_t)(const hid_keyboard_event_t *event, void *arg);
+
+/**
+ * @brief Mouse state for the boot protocol decoder
+ */
+typedef struct {
+    uint8_t buttons;            /**< Buttons pressed in the last report */
+} hid_mouse_state_t;
+
+/**
+ * @brief Mouse event, decoded from one report
+ */
+typedef struct {
+    int8_t x;                   /**< X displacement */
+    int8_t y;                   /**< Y displacement */
+    int8_t wheel;               /**< Wheel displacement, 0 if the report has no wheel byte */
+    uint8_t buttons;            /**< Buttons pressed, bit 0 is button 1 */
+    uint8_t pressed;            /**< Buttons pressed since the previous report */
+    uint8_t released;           /**< Buttons released since the previous report */
+} hid_mouse_event_t;
+
+/**
+ * @brief Initialize keyboard state, no keys pressed
+ *
+ * @param[out] state  Keyboard state
+ */
+void hid_keyboard_state_init(hid_keyboard_state_t *state);
+
+/**
+ * @brief Decode boot keyboard input report into key events
+ *
+ * The keys of the report are compared with the previous report as bitsets, so decoding takes the same time
+ * for any number of pressed keys. Releases are reported before presses.
+ * Reports with Phantom state (ErrorRollOver) keep the previous keys, only modifiers are updated.
+ *
+ * @param[inout] state  Keyboard state
+ * @param[in] data      Report data, hid_keyboard_input_report_boot_t
+ * @param[in] length    Report length
+ * @param[in] cb        Callback for every key event
+ * @param[in] arg       User argument of the callback
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid
+ * - ESP_ERR_INVALID_SIZE if the report is shorter than hid_keyboard_input_report_boot_t
+ */
+esp_err_t hid_keyboard_decode(hid_keyboard_state_t *state,
+                              const uint8_t *data,
+                              size_t length,
+                              hid_keyboard_event_cb_t cb,
+                              void *arg);
+
+/**
+ * @brief Decode boot mouse input report
+ *
+ * @param[inout] state  Mouse state, zero initialized before the first report
+ * @param[in] data      Report data, hid_mouse_input_report_boot_t with optional wheel byte
+ * @param[in] length    Report length
+ * @param[out] event    Decoded mouse event
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid
+ * - ESP_ERR_INVALID_SIZE if the report is shorter than hid_mouse_input_report_boot_t
+ */
+esp_err_t hid_mouse_decode(hid_mouse_state_t *state,
+                           const uint8_t *data,
+                           size_t length,
+                           hid_mouse_event_t *event);
+
+/**
+ * @brief Decode the next boot keyboard report from the report queue
+ *
+ * Waits for a report with hid_host_device_report_borrow(), decodes it and releases it,
+ * so key events can be processed in any task instead of the USB Host client task.
+ *
+ * @param[in] hid_dev_handle  HID Device handle, opened with hid_host_device_config_t::report_queue_len > 0
+ * @param[inout] state        Keyboard state
+ * @param[in] cb              Callback for every key event
+ * @param[in] arg             User argument of the callback
+ * @param[in] timeout_ms      Time to wait for a report
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_TIMEOUT if no report arrived in time
+ * - Other errors of hid_host_device_report_borrow() and hid_keyboard_decode()
+ */
+esp_err_t hid_host_keyboard_process(hid_host_device_handle_t hid_dev_handle,
+                                    hid_keyboard_state_t *state,
+                                    hid_keyboard_event_cb_t cb,
+                                    void *arg,
+                                    uint32_t timeout_ms);
+
+/**
+ * @brief Decode the next boot mouse report from the report queue
+ *
+ * @param[in] hid_dev_handle  HID Device handle, opened with hid_host_device_config_t::report_queue_len > 0
+ * @param[inout] state        Mouse state
+ * @param[out] event          Decoded mouse event
+ * @param[in] timeout_ms      Time to wait for a report
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_TIMEOUT if no report arrived in time
+ * - Other errors of hid_host_device_report_borrow() and hid_mouse_decode()
+ */
+esp_err_t hid_host_mouse_process(hid_host_device_handle_t hid_dev_handle,
+                                 hid_mouse_state_t *state,
+                                 hid_mouse_event_t *event,
+                                 uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
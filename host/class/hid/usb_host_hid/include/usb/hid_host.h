@@ -12,6 +12,7 @@
 #include <freertos/FreeRTOS.h>
 
 #include "hid.h"
+#include "hid_report_map.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,6 +30,24 @@ extern "C" {
 */
 #define HID_STR_DESC_MAX_LENGTH           32
 
+/**
+ * @brief USB HID HOST number of interrupt IN transfers per interface
+ *
+ * While an input report is delivered to the user, the other transfers keep polling the endpoint,
+ * so reports of high polling-rate devices are not lost when the callback takes longer than the polling interval.
+*/
+#define HID_HOST_IN_XFER_NUM_DEFAULT      2
+#define HID_HOST_IN_XFER_NUM_MAX          8
+
+/**
+ * @brief USB HID HOST number of interrupt OUT transfers per interface
+ *
+ * Output reports sent with hid_host_device_send_report() are queued on the interrupt OUT endpoint,
+ * up to this number of reports can be in flight.
+*/
+#define HID_HOST_OUT_XFER_NUM_DEFAULT     4
+#define HID_HOST_OUT_XFER_NUM_MAX         16
+
 typedef struct hid_interface *hid_host_device_handle_t;    /**< Device Handle. Handle to a particular HID interface */
 
 // ------------------------ USB HID Host events --------------------------------
@@ -59,6 +78,16 @@ typedef struct {
     wchar_t iSerialNumber[HID_STR_DESC_MAX_LENGTH];
 } hid_host_dev_info_t;
 
+/**
+ * @brief Input report in the report queue of an interface
+*/
+typedef struct {
+    const uint8_t *data;                /**< Report data, valid until hid_host_device_report_release() */
+    size_t length;                      /**< Report length */
+    int64_t timestamp_us;               /**< esp_timer time of the transfer completion */
+    uint32_t dropped;                   /**< Reports dropped before this one because the queue was full */
+} hid_host_report_t;
+
 /**
  * @brief USB HID Host device parameters
 */
@@ -69,6 +98,30 @@ typedef struct {
     uint8_t proto;                      /**< HID Interface Protocol */
 } hid_host_dev_params_t;
 
+/**
+ * @brief USB HID HOST number of bins of the callback duration histogram
+ *
+ * Bin i counts callbacks shorter than 50 us << i, the last bin counts all longer ones.
+*/
+#define HID_HOST_STATS_CB_HIST_BINS       8
+
+/**
+ * @brief USB HID Host interface statistics
+ */
+typedef struct {
+    uint32_t reports;                   /**< Input reports received */
+    uint32_t reports_filtered;          /**< Unchanged input reports not delivered, see hid_host_device_config_t::filter_reports. Not counted in reports */
+    uint32_t transfer_errors;           /**< Failed IN transfers */
+    uint32_t reports_dropped;           /**< Estimated input reports lost while no IN transfer was polling the endpoint,
+                                             plus reports not queued because the report queue was full */
+    uint32_t callback_overruns;         /**< Callbacks that were longer than the IN transfers in flight can cover */
+    uint32_t polling_interval_us;       /**< Polling interval of the IN endpoint, from bInterval and device speed */
+    uint32_t report_interval_avg_us;    /**< Average time between input reports */
+    uint32_t report_interval_min_us;    /**< Shortest time between input reports */
+    uint32_t callback_time_max_us;      /**< Longest input report callback */
+    uint32_t callback_time_hist[HID_HOST_STATS_CB_HIST_BINS]; /**< Input report callback duration histogram */
+} hid_host_stats_t;
+
 // ------------------------ USB HID Host callbacks -----------------------------
 
 /**
@@ -103,8 +156,14 @@ typedef struct {
     size_t task_priority;                   /**< Task priority of created background task */
     size_t stack_size;                      /**< Stack size of created background task */
     BaseType_t core_id;                     /**< Select core on which background task will run or tskNO_AFFINITY  */
+    bool shared_client;                     /**< Use the client installed with usb_host_shared_client_install() instead of own client.
+                                                 Events are handled by the shared client task, create_background_task must be false */
     hid_host_driver_event_cb_t callback;    /**< Callback invoked when HID driver event occurs. Must not be NULL. */
     void *callback_arg;                     /**< User provided argument passed to callback */
+    bool prefetch_report_desc;              /**< Request report descriptors of all interfaces when a device is connected,
+                                                 before HID_HOST_DRIVER_EVENT_CONNECTED. Requests of different devices run concurrently */
+    size_t report_desc_cache_size;          /**< Number of report descriptors kept across reconnects, keyed by VID, PID, bcdDevice and interface.
+                                                 Report maps compiled from them are kept too. 0 disables the cache */
 } hid_host_driver_config_t;
 
 /**
@@ -113,6 +172,18 @@ typedef struct {
 typedef struct {
     hid_host_interface_event_cb_t callback;     /**< Callback invoked when HID Interface event occurs */
     void *callback_arg;                         /**< User provided argument passed to callback */
+    uint8_t in_xfer_num;                        /**< Number of interrupt IN transfers in flight, up to HID_HOST_IN_XFER_NUM_MAX.
+                                                     0 for HID_HOST_IN_XFER_NUM_DEFAULT */
+    uint8_t report_queue_len;                   /**< Number of input reports queued for hid_host_device_report_borrow().
+                                                     0 if reports are only read in the callback */
+    bool report_map;                            /**< Compile the report descriptor at open, see hid_host_device_get_report_map() */
+    uint8_t out_xfer_num;                       /**< Number of interrupt OUT transfers for hid_host_device_send_report(), up to HID_HOST_OUT_XFER_NUM_MAX.
+                                                     0 for HID_HOST_OUT_XFER_NUM_DEFAULT. Not used if the interface has no interrupt OUT endpoint */
+    bool stats;                                 /**< Collect statistics for hid_host_device_get_stats() */
+    bool filter_reports;                        /**< Deliver only input reports that differ from the last delivered report of the interface.
+                                                     Unchanged reports are neither passed to the callback nor queued */
+    uint32_t filter_keepalive_ms;               /**< filter_reports only: an unchanged report is delivered if no report was delivered
+                                                     for this time. 0: unchanged reports are never delivered */
 } hid_host_device_config_t;
 
 /**
@@ -175,6 +246,9 @@ esp_err_t hid_host_device_get_params(hid_host_device_handle_t hid_dev_handle,
  * This functions should be called after HID Interface device event HID_HOST_INTERFACE_EVENT_INPUT_REPORT
  * to get the actual raw data of input report.
  *
+ * @note Input reports are delivered in the order they were received. The data of a report is valid until
+ *       the callback of the event returns, then its transfer is submitted again.
+ *
  * @param[in] hid_dev_handle    HID Device handle
  * @param[in] data              Pointer to buffer where the input data will be copied
  * @param[in] data_length_max   Max length of data can be copied to data buffer
@@ -187,6 +261,103 @@ esp_err_t hid_host_device_get_raw_input_report_data(hid_host_device_handle_t hid
         size_t data_length_max,
         size_t *data_length);
 
+/**
+ * @brief HID Host borrow the oldest input report from the report queue
+ *
+ * Input reports are queued when the device was opened with hid_host_device_config_t::report_queue_len > 0.
+ * The report stays in the queue until hid_host_device_report_release(), borrowing again before that returns
+ * the same report. One task can consume the reports, it can run on another core than the USB Host client task.
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] report           Report data, length, timestamp and number of reports dropped before it
+ * @param[in] timeout_ms        Time to wait for a report
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the handle or report is invalid
+ * - ESP_ERR_INVALID_STATE if the report queue is not enabled
+ * - ESP_ERR_TIMEOUT if no report arrived in time
+ */
+esp_err_t hid_host_device_report_borrow(hid_host_device_handle_t hid_dev_handle,
+                                        hid_host_report_t *report,
+                                        uint32_t timeout_ms);
+
+/**
+ * @brief HID Host release the report borrowed with hid_host_device_report_borrow()
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[in] report            Borrowed report
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the handle is invalid or the report is not the borrowed one
+ * - ESP_ERR_INVALID_STATE if the report queue is not enabled or empty
+ */
+esp_err_t hid_host_device_report_release(hid_host_device_handle_t hid_dev_handle,
+        const hid_host_report_t *report);
+
+/**
+ * @brief HID Host send output report over the interrupt OUT endpoint
+ *
+ * The report is copied and queued, the function does not wait for its transfer.
+ * Transfer errors are reported with HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR.
+ * Interfaces without interrupt OUT endpoint receive output reports only with hid_class_request_set_report().
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[in] data              Report data, starting with Report ID if the device uses Report IDs
+ * @param[in] length            Report length, up to the OUT endpoint max packet size
+ * @param[in] timeout_ms        Time to wait for a free OUT transfer, when out_xfer_num reports are in flight
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid
+ * - ESP_ERR_INVALID_SIZE if the report does not fit into one OUT packet
+ * - ESP_ERR_INVALID_STATE if the device is not opened
+ * - ESP_ERR_NOT_SUPPORTED if the interface has no interrupt OUT endpoint
+ * - ESP_ERR_TIMEOUT if all OUT transfers stayed in flight
+ */
+esp_err_t hid_host_device_send_report(hid_host_device_handle_t hid_dev_handle,
+                                      const uint8_t *data,
+                                      size_t length,
+                                      uint32_t timeout_ms);
+
+/**
+ * @brief HID Host get interface statistics
+ *
+ * Statistics are collected from hid_host_device_open() when the device was opened with
+ * hid_host_device_config_t::stats, until hid_host_device_close().
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] stats            Statistics of the interface
+ * @param[in] reset             Reset the counters after reading them
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid
+ * - ESP_ERR_INVALID_STATE if statistics are not collected
+ */
+esp_err_t hid_host_device_get_stats(hid_host_device_handle_t hid_dev_handle,
+                                    hid_host_stats_t *stats,
+                                    bool reset);
+
+/**
+ * @brief HID Host get report map of the device
+ *
+ * Report map is the report descriptor compiled into tables of report fields at hid_host_device_open(),
+ * when the device was opened with hid_host_device_config_t::report_map.
+ * Reports are decoded with hid_report_map_find() and hid_report_field_get().
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] map              Pointer to report map, valid until hid_host_device_close()
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid
+ * - ESP_ERR_INVALID_STATE if the device was opened without report map
+ */
+esp_err_t hid_host_device_get_report_map(hid_host_device_handle_t hid_dev_handle,
+        const hid_report_map_t **map);
+
 // ------------------------ USB HID Host driver API ----------------------------
 
 /**
@@ -195,7 +366,10 @@ esp_err_t hid_host_device_get_raw_input_report_data(hid_host_device_handle_t hid
  * Calls a callback when the HID Interface event has occurred.
  *
  * @param[in] hid_dev_handle  HID Device handle
- * @return esp_err_t
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_NOT_FINISHED: Not enough periodic bus bandwidth left for polling the Interrupt IN endpoint
+ *   - Other error: Invalid argument, wrong interface state or transfer submit failed
  */
 esp_err_t hid_host_device_start(hid_host_device_handle_t hid_dev_handle);
 
@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "hid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief HID report field flags
+ *
+ * @see 6.2.2.5 Input, Output, and Feature Items, p.30 of Device Class Definition for Human Interface Devices (HID) Version 1.11
+ */
+#define HID_REPORT_FIELD_FLAG_ARRAY       (1 << 0)  /**< Value is an index into usage_min..usage_max, 0 usage means no control is asserted */
+#define HID_REPORT_FIELD_FLAG_RELATIVE    (1 << 1)  /**< Value is relative to the previous report */
+#define HID_REPORT_FIELD_FLAG_SIGNED      (1 << 2)  /**< Value is sign extended, logical_min is negative */
+
+/**
+ * @brief HID report field
+ *
+ * One data element of a report: one control of a Variable item, or one slot of an Array item.
+ * Constant (padding) items have no fields.
+ */
+typedef struct {
+    uint8_t report_type;      /**< Report type, hid_report_type_t */
+    uint8_t report_id;        /**< Report ID, 0 if the descriptor has no Report ID items */
+    uint8_t bit_size;         /**< Size of the value in bits, 1..32 */
+    uint8_t flags;            /**< HID_REPORT_FIELD_FLAG_* */
+    uint16_t bit_offset;      /**< Offset of the value from the start of the report, including the Report ID byte */
+    uint16_t usage_page;      /**< Usage Page */
+    uint16_t usage;           /**< Usage. For Array fields equal to usage_min */
+    uint16_t usage_min;       /**< Usage Minimum. For Variable fields equal to usage */
+    uint16_t usage_max;       /**< Usage Maximum. For Variable fields equal to usage */
+    int32_t logical_min;      /**< Logical Minimum */
+    int32_t logical_max;      /**< Logical Maximum */
+} hid_report_field_t;
+
+/**
+ * @brief HID report layout
+ */
+typedef struct {
+    uint8_t report_type;                /**< Report type, hid_report_type_t */
+    uint8_t report_id;                  /**< Report ID, 0 if the descriptor has no Report ID items */
+    uint16_t length;                    /**< Report length in bytes, including the Report ID byte */
+    const hid_report_field_t *fields;   /**< Fields of the report, in order of bit_offset */
+    size_t num_fields;                  /**< Number of fields */
+} hid_report_info_t;
+
+/**
+ * @brief HID report map
+ *
+ * Report descriptor compiled into flat tables of reports and their fields.
+ */
+typedef struct {
+    bool report_ids;                    /**< Reports start with Report ID byte */
+    const hid_report_info_t *reports;   /**< Reports, ordered by type and Report ID */
+    size_t num_reports;                 /**< Number of reports */
+    const hid_report_field_t *fields;   /**< Fields of all reports */
+    size_t num_fields;                  /**< Number of fields */
+} hid_report_map_t;
+
+/**
+ * @brief Compile HID report descriptor into a report map
+ *
+ * @param[in] report_desc      Report descriptor
+ * @param[in] report_desc_len  Report descriptor length
+ * @param[out] map             Pointer to report map, free with hid_report_map_delete()
+ *
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid
+ * - ESP_ERR_INVALID_SIZE if an item is truncated
+ * - ESP_ERR_NOT_SUPPORTED if the descriptor is malformed or a field is larger than 32 bits
+ * - ESP_ERR_NO_MEM if there is not enough memory
+ */
+esp_err_t hid_report_map_create(const uint8_t *report_desc, size_t report_desc_len, hid_report_map_t **map);
+
+/**
+ * @brief Delete HID report map
+ *
+ * @param[in] map  Pointer to report map, can be NULL
+ */
+void hid_report_map_delete(hid_report_map_t *map);
+
+/**
+ * @brief Find layout of a report
+ *
+ * The Report ID is taken from the first byte of data if the descriptor uses Report IDs.
+ *
+ * @param[in] map     Pointer to report map
+ * @param[in] type    Report type
+ * @param[in] data    Report data, as received from the device
+ * @param[in] length  Report data length
+ *
+ * @return Pointer to report layout, NULL if the report is unknown or shorter than its layout
+ */
+const hid_report_info_t *hid_report_map_find(const hid_report_map_t *map,
+        hid_report_type_t type,
+        const uint8_t *data,
+        size_t length);
+
+/**
+ * @brief Extract value of a report field
+ *
+ * Does not check the data length, use fields of hid_report_map_find() result with the same data.
+ *
+ * @param[in] field  Pointer to report field
+ * @param[in] data   Report data
+ *
+ * @return Field value, sign extended for fields with HID_REPORT_FIELD_FLAG_SIGNED
+ */
+int32_t hid_report_field_get(const hid_report_field_t *field, const uint8_t *data);
+
+/**
+ * @brief Get usage of an Array field value
+ *
+ * @param[in] field  Pointer to Array report field
+ * @param[in] value  Value returned by hid_report_field_get()
+ *
+ * @return Usage selected by value, 0 if the value is out of logical range
+ */
+uint16_t hid_report_field_array_usage(const hid_report_field_t *field, int32_t value);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
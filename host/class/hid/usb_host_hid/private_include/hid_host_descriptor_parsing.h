@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/usb_types_ch9.h"
+#include "usb/usb_host_desc_index.h"
+#include "usb/hid.h"
+
+/**
+ * @brief HID interface descriptors, found in one walk of the Configuration Descriptor
+ */
+typedef struct {
+    const usb_intf_desc_t *iface_desc;      /**< Interface descriptor */
+    const hid_descriptor_t *hid_desc;       /**< HID descriptor, NULL if not present */
+    const usb_ep_desc_t *ep_in_desc;        /**< First IN endpoint descriptor, NULL if not present */
+    const usb_ep_desc_t *ep_out_desc;       /**< First Interrupt OUT endpoint descriptor, NULL if not present */
+} hid_iface_desc_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Parse Configuration Descriptor into a table of HID interfaces
+ *
+ * The Configuration Descriptor is indexed once. Every HID interface gets its HID descriptor, first IN endpoint
+ * and first Interrupt OUT endpoint, found between the Interface descriptor and the next one.
+ *
+ * @param[in] config_desc  Pointer to Configuration Descriptor
+ * @param[out] table       Table of HID interfaces, free with free()
+ * @param[out] num         Number of HID interfaces
+ * @return
+ *     - ESP_OK:         Success, table is NULL if there is no HID interface
+ *     - ESP_ERR_NO_MEM: Not enough memory for the table
+ *     - ESP_ERR_INVALID_SIZE: Invalid descriptor length in Configuration Descriptor
+ */
+esp_err_t hid_config_desc_parse(const usb_config_desc_t *config_desc, hid_iface_desc_t **table, size_t *num);
+
+/**
+ * @brief Parse indexed Configuration Descriptor into a table of HID interfaces
+ *
+ * Same as hid_config_desc_parse(), for a Configuration Descriptor indexed by the caller.
+ *
+ * @param[in] index        Index of Configuration Descriptor
+ * @param[out] table       Table of HID interfaces, free with free()
+ * @param[out] num         Number of HID interfaces
+ * @return
+ *     - ESP_OK:         Success, table is NULL if there is no HID interface
+ *     - ESP_ERR_NO_MEM: Not enough memory for the table
+ */
+esp_err_t hid_desc_index_parse(const usb_host_desc_index_t *index, hid_iface_desc_t **table, size_t *num);
+
+#ifdef __cplusplus
+}
+#endif
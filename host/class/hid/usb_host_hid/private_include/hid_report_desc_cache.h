@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/hid_report_map.h"
+
+/**
+ * @brief Report Descriptors of known interfaces, kept across reconnects
+ *
+ * Entries are keyed by VID, PID, bcdDevice and interface number and verified by the Report Descriptor length
+ * from the HID descriptor. Interfaces with the same key share the cached Report Descriptor and its report map.
+ * Entries not used by any interface are evicted in least recently used order.
+ */
+
+/**
+ * @brief Interface identification
+ */
+typedef struct {
+    uint16_t vid;
+    uint16_t pid;
+    uint16_t bcdDevice;
+    uint8_t iface_num;
+} hid_desc_cache_key_t;
+
+/**
+ * @brief Cached Report Descriptor
+ */
+typedef struct {
+    hid_desc_cache_key_t key;
+    uint16_t report_desc_size;
+    uint8_t *report_desc;           /**< Report Descriptor, NULL if the entry is free */
+    hid_report_map_t *report_map;   /**< Compiled Report Descriptor, NULL until the first interface is opened with report_map */
+    uint32_t refs;                  /**< Number of interfaces using the entry */
+    uint32_t last_use;              /**< Use counter value of the last lookup, for eviction */
+} hid_desc_cache_entry_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocate the cache
+ *
+ * @param[in] entries  Number of entries, 0 disables the cache
+ * @return
+ *     - ESP_OK:         Success
+ *     - ESP_ERR_NO_MEM: Not enough memory for the entries
+ */
+esp_err_t hid_desc_cache_init(size_t entries);
+
+/**
+ * @brief Free the cache with all its Report Descriptors and report maps
+ *
+ * No entry may be in use.
+ */
+void hid_desc_cache_deinit(void);
+
+/**
+ * @brief Find Report Descriptor of an interface
+ *
+ * @param[in] key              Interface identification
+ * @param[in] report_desc_size Report Descriptor length from the HID descriptor
+ * @return Entry with a new reference, release with hid_desc_cache_release(). NULL if not cached
+ */
+hid_desc_cache_entry_t *hid_desc_cache_get(const hid_desc_cache_key_t *key, uint16_t report_desc_size);
+
+/**
+ * @brief Add Report Descriptor of an interface
+ *
+ * The entry takes ownership of the Report Descriptor. Nothing is added, if the cache is disabled
+ * or all entries are in use.
+ *
+ * @param[in] key              Interface identification
+ * @param[in] report_desc      Report Descriptor, allocated with malloc()
+ * @param[in] report_desc_size Report Descriptor length
+ * @return Entry with a new reference, release with hid_desc_cache_release(). NULL if not added, report_desc stays with the caller
+ */
+hid_desc_cache_entry_t *hid_desc_cache_put(const hid_desc_cache_key_t *key, uint8_t *report_desc, uint16_t report_desc_size);
+
+/**
+ * @brief Add report map to an entry
+ *
+ * @param[in] entry       Entry referenced by the caller
+ * @param[in] report_map  Report map compiled from the entry's Report Descriptor
+ * @return Report map of the entry. If another interface added a map before, report_map is deleted and the existing one is returned
+ */
+hid_report_map_t *hid_desc_cache_set_map(hid_desc_cache_entry_t *entry, hid_report_map_t *report_map);
+
+/**
+ * @brief Release reference to an entry
+ *
+ * @param[in] entry  Entry, can be NULL
+ */
+void hid_desc_cache_release(hid_desc_cache_entry_t *entry);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/midi_host.h"
+#include "usb/usb_host_desc_index.h"
+#include "midi_descriptor_parsing.h"
+
+// MIDI adapter from Appendix B of USB MIDI specification rev. 1.0, with MIDI 2.0 alternate setting added
+static const uint8_t midi_cfg_desc[] = {
+    0x09, 0x02, 0x8D, 0x00, 0x02, 0x01, 0x00, 0x80, 0x32,
+    // Audio Control interface
+    0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+    0x09, 0x24, 0x01, 0x00, 0x01, 0x09, 0x00, 0x01, 0x01,
+    // MIDIStreaming interface, alternate setting 0: MIDI 1.0
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x01, 0x03, 0x00, 0x00,
+    0x07, 0x24, 0x01, 0x00, 0x01, 0x41, 0x00,
+    0x06, 0x24, 0x02, 0x01, 0x01, 0x00,
+    0x06, 0x24, 0x02, 0x02, 0x02, 0x00,
+    0x09, 0x24, 0x03, 0x01, 0x03, 0x01, 0x02, 0x01, 0x00,
+    0x09, 0x24, 0x03, 0x02, 0x04, 0x01, 0x01, 0x01, 0x00,
+    0x09, 0x05, 0x01, 0x02, 0x40, 0x00, 0x00, 0x00, 0x00,
+    0x05, 0x25, 0x01, 0x01, 0x01,
+    0x09, 0x05, 0x81, 0x02, 0x40, 0x00, 0x00, 0x00, 0x00,
+    0x05, 0x25, 0x01, 0x01, 0x03,
+    // MIDIStreaming interface, alternate setting 1: MIDI 2.0
+    0x09, 0x04, 0x01, 0x01, 0x02, 0x01, 0x03, 0x00, 0x00,
+    0x07, 0x24, 0x01, 0x00, 0x02, 0x07, 0x00,
+    0x07, 0x05, 0x02, 0x02, 0x40, 0x00, 0x00,
+    0x05, 0x25, 0x02, 0x01, 0x01,
+    0x07, 0x05, 0x82, 0x02, 0x40, 0x00, 0x00,
+    0x05, 0x25, 0x02, 0x01, 0x01,
+};
+static_assert(sizeof(midi_cfg_desc) == 0x8D, "wTotalLength does not match");
+
+SCENARIO("MIDIStreaming interface parsing")
+{
+    usb_host_desc_index_t *index = nullptr;
+    REQUIRE(usb_host_desc_index_build((const usb_config_desc_t *)midi_cfg_desc, &index) == ESP_OK);
+    midi_desc_info_t info;
+
+    GIVEN("MIDI 1.0 is requested") {
+        REQUIRE(midi_desc_find_interface(index, MIDI_HOST_ANY_INTERFACE, false, &info) == ESP_OK);
+        REQUIRE(info.bInterfaceNumber == 1);
+        REQUIRE(info.bAlternateSetting == 0);
+        REQUIRE(info.bcdMSC == USB_MIDI_BCD_MSC_1_0);
+        REQUIRE(info.in_ep != nullptr);
+        REQUIRE(info.in_ep->bEndpointAddress == 0x81);
+        REQUIRE(info.out_ep != nullptr);
+        REQUIRE(info.out_ep->bEndpointAddress == 0x01);
+        REQUIRE(info.in_cables == 1);
+        REQUIRE(info.out_cables == 1);
+    }
+
+    GIVEN("MIDI 2.0 is requested") {
+        REQUIRE(midi_desc_find_interface(index, 1, true, &info) == ESP_OK);
+        REQUIRE(info.bAlternateSetting == 1);
+        REQUIRE(info.bcdMSC == USB_MIDI_BCD_MSC_2_0);
+        REQUIRE(info.in_ep->bEndpointAddress == 0x82);
+        REQUIRE(info.out_ep->bEndpointAddress == 0x02);
+    }
+
+    GIVEN("Interface that is not MIDIStreaming") {
+        REQUIRE(midi_desc_find_interface(index, 0, false, &info) == ESP_ERR_NOT_FOUND);
+        REQUIRE(midi_desc_find_interface(index, 2, false, &info) == ESP_ERR_NOT_FOUND);
+    }
+    usb_host_desc_index_free(index);
+}
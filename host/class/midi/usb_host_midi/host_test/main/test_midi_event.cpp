@@ -0,0 +1,174 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/midi_host.h"
+#include "midi_event.h"
+
+static midi_host_event_t make_event(uint8_t cable, std::vector<uint8_t> data)
+{
+    midi_host_event_t event = {};
+    event.cable = cable;
+    event.len = data.size();
+    memcpy(event.data, data.data(), data.size());
+    return event;
+}
+
+static midi_host_event_t make_ump(std::vector<uint32_t> words)
+{
+    midi_host_event_t event = {};
+    event.len = words.size();
+    memcpy(event.ump, words.data(), words.size() * sizeof(uint32_t));
+    return event;
+}
+
+SCENARIO("Code Index Number of MIDI 1.0 messages")
+{
+    GIVEN("Valid messages") {
+        const uint8_t note_on[] = {0x90, 60, 100};
+        const uint8_t program_change[] = {0xC1, 5};
+        const uint8_t song_position[] = {0xF2, 0x10, 0x20};
+        const uint8_t clock[] = {0xF8};
+        const uint8_t sysex_start[] = {0xF0, 0x7E, 0x00};
+        const uint8_t sysex_end[] = {0x06, 0x01, 0xF7};
+        const uint8_t sysex_short[] = {0xF0, 0xF7};
+        const uint8_t sysex_last[] = {0xF7};
+        REQUIRE(midi_event_cin(note_on, sizeof(note_on)) == USB_MIDI_CIN_NOTE_ON);
+        REQUIRE(midi_event_cin(program_change, sizeof(program_change)) == USB_MIDI_CIN_PROGRAM_CHANGE);
+        REQUIRE(midi_event_cin(song_position, sizeof(song_position)) == USB_MIDI_CIN_SYSCOM_3);
+        REQUIRE(midi_event_cin(clock, sizeof(clock)) == USB_MIDI_CIN_SINGLE_BYTE);
+        REQUIRE(midi_event_cin(sysex_start, sizeof(sysex_start)) == USB_MIDI_CIN_SYSEX_START);
+        REQUIRE(midi_event_cin(sysex_end, sizeof(sysex_end)) == USB_MIDI_CIN_SYSEX_END_3);
+        REQUIRE(midi_event_cin(sysex_short, sizeof(sysex_short)) == USB_MIDI_CIN_SYSEX_END_2);
+        REQUIRE(midi_event_cin(sysex_last, sizeof(sysex_last)) == USB_MIDI_CIN_SYSEX_END_1);
+    }
+
+    GIVEN("Invalid messages") {
+        const uint8_t short_note_on[] = {0x90, 60};
+        const uint8_t undefined[] = {0xF4};
+        const uint8_t short_sysex[] = {0x01, 0x02};
+        REQUIRE(midi_event_cin(short_note_on, sizeof(short_note_on)) == -1);
+        REQUIRE(midi_event_cin(undefined, sizeof(undefined)) == -1);
+        REQUIRE(midi_event_cin(short_sysex, sizeof(short_sysex)) == -1);
+        REQUIRE(midi_event_cin(short_sysex, 0) == -1);
+    }
+}
+
+SCENARIO("USB-MIDI Event Packets")
+{
+    GIVEN("Batch of MIDI 1.0 events") {
+        const midi_host_event_t events[] = {
+            make_event(2, {0x90, 60, 100}),
+            make_event(2, {0xC1, 5}),
+            make_event(0, {0xF8}),
+        };
+        uint8_t buf[sizeof(events) / sizeof(events[0]) * USB_MIDI_EVENT_PACKET_SIZE + USB_MIDI_EVENT_PACKET_SIZE] = {};
+        size_t len = 0;
+        for (const auto &event : events) {
+            REQUIRE(midi_event_encoded_size(&event, false) == USB_MIDI_EVENT_PACKET_SIZE);
+            len += midi_event_encode(&event, false, buf + len);
+        }
+
+        THEN("Packets have cable number and CIN in the header") {
+            const uint8_t expected[] = {0x29, 0x90, 60, 100, 0x2C, 0xC1, 5, 0, 0x0F, 0xF8, 0, 0};
+            REQUIRE(len == sizeof(expected));
+            REQUIRE(memcmp(buf, expected, sizeof(expected)) == 0);
+        }
+
+        AND_THEN("Decoding skips padding and returns the events") {
+            len += USB_MIDI_EVENT_PACKET_SIZE; // Empty packet
+            midi_host_event_t decoded[8];
+            REQUIRE(midi_event_decode(buf, len, false, 1234, decoded, 8) == 3);
+            for (int i = 0; i < 3; i++) {
+                REQUIRE(decoded[i].timestamp_us == 1234);
+                REQUIRE(decoded[i].cable == events[i].cable);
+                REQUIRE(decoded[i].len == events[i].len);
+                REQUIRE(memcmp(decoded[i].data, events[i].data, events[i].len) == 0);
+            }
+            REQUIRE(midi_event_decode(buf, len, false, 0, decoded, 2) == 2);
+        }
+    }
+
+    GIVEN("Invalid events") {
+        const midi_host_event_t bad_cable = make_event(16, {0x90, 60, 100});
+        const midi_host_event_t bad_len = make_event(0, {0x90, 60});
+        REQUIRE(midi_event_encoded_size(&bad_cable, false) == 0);
+        REQUIRE(midi_event_encoded_size(&bad_len, false) == 0);
+    }
+}
+
+SCENARIO("Universal MIDI Packets")
+{
+    GIVEN("MIDI 2.0 Note On and MIDI 1.0 Channel Voice message in group 3") {
+        const midi_host_event_t events[] = {
+            make_ump({0x43903C00, 0xFFFF0000}),
+            make_ump({0x23903C64}),
+        };
+        uint8_t buf[4 * sizeof(uint32_t)] = {};
+        size_t len = 0;
+        for (const auto &event : events) {
+            REQUIRE(midi_event_encoded_size(&event, true) == event.len * sizeof(uint32_t));
+            len += midi_event_encode(&event, true, buf + len);
+        }
+
+        THEN("Words are little-endian") {
+            const uint8_t expected[] = {0x00, 0x3C, 0x90, 0x43, 0x00, 0x00, 0xFF, 0xFF, 0x64, 0x3C, 0x90, 0x23};
+            REQUIRE(len == sizeof(expected));
+            REQUIRE(memcmp(buf, expected, sizeof(expected)) == 0);
+        }
+
+        AND_THEN("Decoding skips NOOP and incomplete packet") {
+            // NOOP, then 2-word UMP of which only the first word was received
+            const uint8_t tail[] = {0, 0, 0, 0, 0x00, 0x3C, 0x90, 0x43};
+            std::vector<uint8_t> data(buf, buf + len);
+            data.insert(data.end(), tail, tail + sizeof(tail));
+            midi_host_event_t decoded[8];
+            REQUIRE(midi_event_decode(data.data(), data.size(), true, 5, decoded, 8) == 2);
+            REQUIRE(decoded[0].len == 2);
+            REQUIRE(decoded[0].cable == 3);
+            REQUIRE(decoded[0].ump[0] == 0x43903C00);
+            REQUIRE(decoded[0].ump[1] == 0xFFFF0000);
+            REQUIRE(decoded[1].len == 1);
+            REQUIRE(decoded[1].ump[0] == 0x23903C64);
+        }
+    }
+
+    GIVEN("UMP with wrong number of words") {
+        const midi_host_event_t bad = make_ump({0x43903C00});
+        REQUIRE(midi_event_encoded_size(&bad, true) == 0);
+    }
+}
+
+SCENARIO("Event FIFO")
+{
+    midi_host_event_t storage[4];
+    midi_fifo_t fifo;
+    midi_fifo_init(&fifo, storage, 4);
+
+    std::vector<midi_host_event_t> events;
+    for (uint8_t i = 0; i < 8; i++) {
+        events.push_back(make_event(0, {0x90, i, 100}));
+    }
+    midi_host_event_t out[8];
+
+    GIVEN("More events than fit") {
+        REQUIRE(midi_fifo_push(&fifo, events.data(), 6) == 4);
+
+        THEN("Events are taken in order and the FIFO wraps around") {
+            REQUIRE(midi_fifo_pop(&fifo, out, 3) == 3);
+            REQUIRE(out[2].data[1] == 2);
+            REQUIRE(midi_fifo_push(&fifo, &events[4], 4) == 3);
+            REQUIRE(midi_fifo_pop(&fifo, out, 8) == 4);
+            for (uint8_t i = 0; i < 4; i++) {
+                REQUIRE(out[i].data[1] == i + 3);
+            }
+            REQUIRE(midi_fifo_pop(&fifo, out, 8) == 0);
+        }
+    }
+}
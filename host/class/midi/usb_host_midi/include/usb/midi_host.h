@@ -0,0 +1,227 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_types_midi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIDI_HOST_ANY_VID              (0)
+#define MIDI_HOST_ANY_PID              (0)
+#define MIDI_HOST_ANY_INTERFACE        (0xFF) // First MIDIStreaming interface of the device
+#define MIDI_HOST_XFER_COUNT_DEFAULT   (4)    // Bulk IN and OUT transfers in flight
+#define MIDI_HOST_FIFO_SIZE_DEFAULT    (256)  // Received events buffered for midi_host_receive()
+#define MIDI_HOST_OUT_SIZE_DEFAULT     (256)  // Bytes of one OUT transfer, 64 MIDI 1.0 events
+
+typedef struct midi_dev_s *midi_dev_hdl_t;
+
+/**
+ * @brief MIDI event
+ *
+ * With MIDI 1.0 the event is one USB-MIDI Event Packet: a MIDI message of up to 3 bytes, or a chunk of System Exclusive message.
+ * With MIDI 2.0 the event is one Universal MIDI Packet of 1 to 4 words.
+ */
+typedef struct {
+    int64_t timestamp_us;      /**< Time of reception from esp_timer_get_time(). All events of one IN transfer have the same timestamp. Ignored on send */
+    uint8_t cable;             /**< MIDI 1.0: Cable number, 0 to 15. MIDI 2.0: Group of the UMP, filled on reception only */
+    uint8_t len;               /**< MIDI 1.0: Bytes in data. MIDI 2.0: Words in ump */
+    union {
+        uint8_t data[3];       /**< MIDI 1.0 message, such as {0x90, note, velocity}. SysEx is carried in chunks of 3 bytes, the last chunk ends with 0xF7 */
+        uint32_t ump[4];       /**< MIDI 2.0 Universal MIDI Packet */
+    };
+} midi_host_event_t;
+
+/**
+ * @brief MIDI device event types
+ */
+typedef enum {
+    MIDI_HOST_DEVICE_DISCONNECTED,   /**< USB device was disconnected, close the handle */
+} midi_host_dev_event_t;
+
+/**
+ * @brief Received events callback type
+ *
+ * Called from the task of the driver as soon as an IN transfer completes, so the events do not wait in the FIFO.
+ * The callback must not block.
+ *
+ * @param[in] midi_hdl Device handle
+ * @param[in] events   Events of one IN transfer, valid only during the callback
+ * @param[in] count    Number of events
+ * @param[in] user_arg User's argument
+ */
+typedef void (*midi_host_rx_cb_t)(midi_dev_hdl_t midi_hdl, const midi_host_event_t *events, size_t count, void *user_arg);
+
+/**
+ * @brief Device event callback type
+ *
+ * @param[in] midi_hdl Device handle
+ * @param[in] event    Event
+ * @param[in] user_arg User's argument
+ */
+typedef void (*midi_host_dev_event_cb_t)(midi_dev_hdl_t midi_hdl, midi_host_dev_event_t event, void *user_arg);
+
+/**
+ * @brief Configuration structure of MIDI driver
+ */
+typedef struct {
+    size_t driver_task_stack_size;   /**< Stack size of the driver's task */
+    unsigned driver_task_priority;   /**< Priority of the driver's task. Received events are timestamped and delivered from it */
+    int xCoreID;                     /**< Core affinity of the driver's task */
+    bool shared_client;              /**< Use the shared USB Host client, see usb_host_shared_client_install(). No driver task is created then */
+} midi_host_driver_config_t;
+
+/**
+ * @brief Configuration structure of MIDI device
+ */
+typedef struct {
+    uint32_t connection_timeout_ms;  /**< Timeout for USB device connection in [ms], 0 to wait forever */
+    bool ump;                        /**< Use MIDI 2.0 alternate setting with Universal MIDI Packets, if the device has one */
+    size_t in_transfer_count;        /**< Bulk IN transfers in flight, each of one packet. 0 for MIDI_HOST_XFER_COUNT_DEFAULT */
+    size_t out_transfer_count;       /**< Bulk OUT transfers in flight. 0 for MIDI_HOST_XFER_COUNT_DEFAULT */
+    size_t out_transfer_size;        /**< Size of OUT transfers in bytes. 0 for MIDI_HOST_OUT_SIZE_DEFAULT */
+    size_t fifo_size;                /**< Events buffered for midi_host_receive(), rounded up to a power of 2. 0 for MIDI_HOST_FIFO_SIZE_DEFAULT.
+                                          Not used with rx_cb */
+    midi_host_rx_cb_t rx_cb;         /**< Received events callback. NULL to receive events with midi_host_receive() */
+    midi_host_dev_event_cb_t event_cb; /**< Device event callback. Can be NULL */
+    void *user_arg;                  /**< User's argument that will be passed to the callbacks */
+} midi_host_device_config_t;
+
+/**
+ * @brief Device information and counters
+ */
+typedef struct {
+    uint8_t bInterfaceNumber;        /**< Opened MIDIStreaming interface */
+    bool ump;                        /**< Events are Universal MIDI Packets of MIDI 2.0 */
+    uint8_t in_cables;               /**< Cables or Group Terminal Blocks of the IN endpoint, 0 if the device has none */
+    uint8_t out_cables;              /**< Cables or Group Terminal Blocks of the OUT endpoint, 0 if the device has none */
+    uint32_t rx_events;              /**< Received events */
+    uint32_t rx_dropped;             /**< Received events dropped because the FIFO was full */
+    uint32_t rx_transfers;           /**< Completed IN transfers */
+    uint32_t tx_events;              /**< Sent events */
+    uint32_t tx_transfers;           /**< Submitted OUT transfers */
+    uint32_t tx_errors;              /**< Failed OUT transfers */
+} midi_host_info_t;
+
+/**
+ * @brief Install MIDI driver
+ *
+ * - USB Host Library must already be installed before calling this function (via usb_host_install())
+ * - This function should be called before calling any other MIDI driver functions
+ *
+ * @param[in] driver_config Driver configuration structure. If set to NULL, a default configuration will be used
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The MIDI driver is already installed or USB host library is not installed
+ *   - ESP_ERR_NO_MEM: Not enough memory for installing the driver
+ */
+esp_err_t midi_host_install(const midi_host_driver_config_t *driver_config);
+
+/**
+ * @brief Uninstall MIDI driver
+ *
+ * - Users must ensure that all MIDI devices must be closed via midi_host_close() before calling this function
+ *
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The MIDI driver is not installed or not all devices are closed
+ *   - ESP_ERR_NOT_FINISHED: The MIDI driver failed to uninstall completely
+ */
+esp_err_t midi_host_uninstall(void);
+
+/**
+ * @brief Open MIDIStreaming interface of a USB device
+ *
+ * IN transfers are submitted at once, so the device is polled continuously from this point.
+ * The driver opens one MIDIStreaming interface per USB device.
+ *
+ * @param[in]  vid              Device's Vendor ID, set to MIDI_HOST_ANY_VID for any
+ * @param[in]  pid              Device's Product ID, set to MIDI_HOST_ANY_PID for any
+ * @param[in]  bInterfaceNumber MIDIStreaming interface, set to MIDI_HOST_ANY_INTERFACE for the first one
+ * @param[in]  dev_config       Configuration structure of the device
+ * @param[out] midi_hdl_ret     Device handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The MIDI driver is not installed
+ *   - ESP_ERR_INVALID_ARG: dev_config or midi_hdl_ret is NULL
+ *   - ESP_ERR_NOT_FOUND: No device with MIDIStreaming interface was connected within connection_timeout_ms
+ *   - ESP_ERR_NO_MEM: Not enough memory for opening the device
+ */
+esp_err_t midi_host_open(uint16_t vid, uint16_t pid, uint8_t bInterfaceNumber, const midi_host_device_config_t *dev_config, midi_dev_hdl_t *midi_hdl_ret);
+
+/**
+ * @brief Close MIDI device
+ *
+ * Transfers in flight are cancelled, events in the FIFO are dropped.
+ *
+ * @param[in] midi_hdl Device handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The MIDI driver is not installed
+ *   - ESP_ERR_INVALID_ARG: midi_hdl is NULL
+ */
+esp_err_t midi_host_close(midi_dev_hdl_t midi_hdl);
+
+/**
+ * @brief Send events
+ *
+ * Events are packed into OUT transfers of out_transfer_size bytes, so a batch of events costs one transfer
+ * instead of one per event. The function returns once the last transfer is submitted.
+ * Events of concurrent callers are not interleaved within a batch.
+ *
+ * @param[in]  midi_hdl   Device handle
+ * @param[in]  events     Events to send. MIDI 1.0 messages must start with status byte, except for SysEx continuation
+ * @param[in]  count      Number of events
+ * @param[out] sent_count Number of events submitted to the device, can be NULL
+ * @param[in]  timeout_ms Time to wait for free OUT transfers in [ms]
+ * @return
+ *   - ESP_OK: All events submitted
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments or an event is not a valid MIDI message. No event was sent
+ *   - ESP_ERR_NOT_SUPPORTED: The device has no OUT endpoint
+ *   - ESP_ERR_INVALID_STATE: The device was disconnected
+ *   - ESP_ERR_TIMEOUT: All OUT transfers are in flight. sent_count events were submitted
+ */
+esp_err_t midi_host_send(midi_dev_hdl_t midi_hdl, const midi_host_event_t *events, size_t count, size_t *sent_count, uint32_t timeout_ms);
+
+/**
+ * @brief Receive events
+ *
+ * Events are taken from a lock-free FIFO filled by the driver's task, in order of reception.
+ * All buffered events up to max_count are returned by one call. Only one task may receive events of a device.
+ *
+ * @param[in]  midi_hdl   Device handle
+ * @param[out] events     Received events
+ * @param[in]  max_count  Size of events array
+ * @param[out] count      Number of received events
+ * @param[in]  timeout_ms Time to wait for the first event in [ms]
+ * @return
+ *   - ESP_OK: At least one event received
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ *   - ESP_ERR_INVALID_STATE: Events are delivered to rx_cb, or the device was disconnected and all events were received
+ *   - ESP_ERR_TIMEOUT: No event was received within timeout_ms
+ */
+esp_err_t midi_host_receive(midi_dev_hdl_t midi_hdl, midi_host_event_t *events, size_t max_count, size_t *count, uint32_t timeout_ms);
+
+/**
+ * @brief Get device information and counters
+ *
+ * @param[in]  midi_hdl Device handle
+ * @param[out] info     Information
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ */
+esp_err_t midi_host_get_info(midi_dev_hdl_t midi_hdl, midi_host_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
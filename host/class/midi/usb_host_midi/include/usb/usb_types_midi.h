@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <inttypes.h>
+
+#define USB_MIDI_SUBCLASS_MIDISTREAMING  0x03   // bInterfaceSubClass of MIDIStreaming interface, bInterfaceClass is USB_CLASS_AUDIO
+
+#define USB_MIDI_CS_INTERFACE            0x24   // Class-specific interface descriptor type
+#define USB_MIDI_CS_ENDPOINT             0x25   // Class-specific endpoint descriptor type
+
+#define USB_MIDI_BCD_MSC_1_0             0x0100 // bcdMSC of USB MIDI 1.0 alternate setting
+#define USB_MIDI_BCD_MSC_2_0             0x0200 // bcdMSC of USB MIDI 2.0 (UMP) alternate setting
+
+/**
+ * @brief Class-specific MIDIStreaming interface descriptor subtypes
+ *
+ * @see Table A-1, USB MIDI specification rev. 1.0
+ */
+typedef enum {
+    USB_MIDI_DESC_SUBTYPE_MS_HEADER     = 0x01,
+    USB_MIDI_DESC_SUBTYPE_MIDI_IN_JACK  = 0x02,
+    USB_MIDI_DESC_SUBTYPE_MIDI_OUT_JACK = 0x03,
+    USB_MIDI_DESC_SUBTYPE_ELEMENT       = 0x04,
+} usb_midi_desc_subtype_t;
+
+/**
+ * @brief Class-specific MIDIStreaming endpoint descriptor subtypes
+ *
+ * @see Table A-2, USB MIDI specification rev. 1.0 and Table A-2, USB MIDI specification rev. 2.0
+ */
+typedef enum {
+    USB_MIDI_DESC_SUBTYPE_MS_GENERAL     = 0x01, // MIDI 1.0 endpoint with embedded jacks
+    USB_MIDI_DESC_SUBTYPE_MS_GENERAL_2_0 = 0x02, // MIDI 2.0 endpoint with Group Terminal Blocks
+} usb_midi_ep_desc_subtype_t;
+
+/**
+ * @brief Code Index Number, low nibble of the header of USB-MIDI Event Packet
+ *
+ * @see Table 4-1, USB MIDI specification rev. 1.0
+ */
+typedef enum {
+    USB_MIDI_CIN_MISC            = 0x0, // Reserved
+    USB_MIDI_CIN_CABLE_EVENT     = 0x1, // Reserved
+    USB_MIDI_CIN_SYSCOM_2        = 0x2, // Two-byte System Common message
+    USB_MIDI_CIN_SYSCOM_3        = 0x3, // Three-byte System Common message
+    USB_MIDI_CIN_SYSEX_START     = 0x4, // SysEx starts or continues
+    USB_MIDI_CIN_SYSEX_END_1     = 0x5, // Single-byte System Common message or SysEx ends with one byte
+    USB_MIDI_CIN_SYSEX_END_2     = 0x6, // SysEx ends with two bytes
+    USB_MIDI_CIN_SYSEX_END_3     = 0x7, // SysEx ends with three bytes
+    USB_MIDI_CIN_NOTE_OFF        = 0x8,
+    USB_MIDI_CIN_NOTE_ON         = 0x9,
+    USB_MIDI_CIN_POLY_KEYPRESS   = 0xA,
+    USB_MIDI_CIN_CONTROL_CHANGE  = 0xB,
+    USB_MIDI_CIN_PROGRAM_CHANGE  = 0xC,
+    USB_MIDI_CIN_CHANNEL_PRESSURE = 0xD,
+    USB_MIDI_CIN_PITCH_BEND      = 0xE,
+    USB_MIDI_CIN_SINGLE_BYTE     = 0xF, // Single byte, used for System Real-Time messages
+} usb_midi_cin_t;
+
+#define USB_MIDI_EVENT_PACKET_SIZE       4      // USB-MIDI Event Packet: header with cable number and CIN, 3 bytes of MIDI message
+
+/**
+ * @brief Class-specific MS Interface Header descriptor
+ *
+ * @see Table 6-2, USB MIDI specification rev. 1.0
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint16_t bcdMSC;               // USB_MIDI_BCD_MSC_1_0 or USB_MIDI_BCD_MSC_2_0
+    uint16_t wTotalLength;         // Total length of class-specific descriptors of the alternate setting
+} __attribute__((packed)) usb_midi_header_desc_t;
+
+/**
+ * @brief Class-specific MS Bulk Data Endpoint descriptor
+ *
+ * @see Table 6-7, USB MIDI specification rev. 1.0
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bNumEmbMIDIJack;       // Number of embedded MIDI jacks, cables of the endpoint (MIDI 1.0) or Group Terminal Blocks (MIDI 2.0)
+    uint8_t baAssocJackID[];
+} __attribute__((packed)) usb_midi_ep_desc_t;
@@ -0,0 +1,98 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "usb/usb_types_ch9.h"
+#include "usb/midi_host.h"
+#include "midi_descriptor_parsing.h"
+
+static bool midi_desc_is_midistreaming(const usb_host_desc_index_intf_t *intf)
+{
+    if (intf->num_alts == 0) {
+        return false;
+    }
+    const usb_intf_desc_t *intf_desc = intf->alts[0].intf_desc;
+    return intf_desc->bInterfaceClass == USB_CLASS_AUDIO && intf_desc->bInterfaceSubClass == USB_MIDI_SUBCLASS_MIDISTREAMING;
+}
+
+static uint16_t midi_desc_get_bcd_msc(const usb_host_desc_index_alt_t *alt)
+{
+    const usb_standard_desc_t *desc = NULL;
+    while ((desc = usb_host_desc_index_find_class_desc(alt, USB_MIDI_CS_INTERFACE, desc)) != NULL) {
+        const usb_midi_header_desc_t *header = (const usb_midi_header_desc_t *)desc;
+        if (header->bLength >= sizeof(usb_midi_header_desc_t) && header->bDescriptorSubtype == USB_MIDI_DESC_SUBTYPE_MS_HEADER) {
+            return header->bcdMSC;
+        }
+    }
+    return 0;
+}
+
+static const usb_ep_desc_t *midi_desc_find_ep(const usb_host_desc_index_alt_t *alt, bool in)
+{
+    const usb_ep_desc_t *ep = usb_host_desc_index_find_ep(alt, USB_TRANSFER_TYPE_BULK, in);
+    if (ep == NULL) {
+        ep = usb_host_desc_index_find_ep(alt, USB_TRANSFER_TYPE_INTR, in); // Allowed by USB MIDI 2.0
+    }
+    return ep;
+}
+
+/**
+ * @brief Get number of cables from class-specific endpoint descriptor, which follows the endpoint descriptor
+ */
+static uint8_t midi_desc_get_cables(const usb_config_desc_t *config_desc, const usb_ep_desc_t *ep)
+{
+    if (ep == NULL) {
+        return 0;
+    }
+    const uint8_t *config_end = (const uint8_t *)config_desc + config_desc->wTotalLength;
+    const usb_midi_ep_desc_t *cs_ep = (const usb_midi_ep_desc_t *)((const uint8_t *)ep + ep->bLength);
+    if ((const uint8_t *)cs_ep + sizeof(usb_midi_ep_desc_t) > config_end || cs_ep->bDescriptorType != USB_MIDI_CS_ENDPOINT ||
+            cs_ep->bLength < sizeof(usb_midi_ep_desc_t)) {
+        return 1; // Devices without the descriptor use cable 0
+    }
+    return cs_ep->bNumEmbMIDIJack;
+}
+
+esp_err_t midi_desc_find_interface(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber, bool ump, midi_desc_info_t *info)
+{
+    memset(info, 0, sizeof(midi_desc_info_t));
+    const usb_host_desc_index_intf_t *intf = NULL;
+    for (int i = 0; i < index->num_intfs; i++) {
+        const usb_host_desc_index_intf_t *candidate = &index->intfs[i];
+        if ((bInterfaceNumber == MIDI_HOST_ANY_INTERFACE || candidate->bInterfaceNumber == bInterfaceNumber) &&
+                midi_desc_is_midistreaming(candidate)) {
+            intf = candidate;
+            break;
+        }
+    }
+    if (intf == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Alternate setting 0 is MIDI 1.0, USB MIDI 2.0 devices add alternate setting 1 with UMP
+    const usb_host_desc_index_alt_t *alt = &intf->alts[0];
+    uint16_t bcd_msc = midi_desc_get_bcd_msc(alt);
+    for (int i = 1; ump && i < intf->num_alts; i++) {
+        const uint16_t alt_bcd_msc = midi_desc_get_bcd_msc(&intf->alts[i]);
+        if (alt_bcd_msc == USB_MIDI_BCD_MSC_2_0) {
+            alt = &intf->alts[i];
+            bcd_msc = alt_bcd_msc;
+            break;
+        }
+    }
+
+    info->bInterfaceNumber = intf->bInterfaceNumber;
+    info->bAlternateSetting = alt->intf_desc->bAlternateSetting;
+    info->bcdMSC = bcd_msc;
+    info->in_ep = midi_desc_find_ep(alt, true);
+    info->out_ep = midi_desc_find_ep(alt, false);
+    info->in_cables = midi_desc_get_cables(index->config_desc, info->in_ep);
+    info->out_cables = midi_desc_get_cables(index->config_desc, info->out_ep);
+    if (info->in_ep == NULL && info->out_ep == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
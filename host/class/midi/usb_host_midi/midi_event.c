@@ -0,0 +1,164 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <sys/param.h>
+#include "midi_event.h"
+
+#define MIDI_SYSEX_START  0xF0
+#define MIDI_SYSEX_END    0xF7
+
+// Bytes of MIDI message by Code Index Number, 0 for reserved CINs. Table 4-1, USB MIDI specification rev. 1.0
+static const uint8_t midi_cin_len[16] = {0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1};
+
+// Words of Universal MIDI Packet by Message Type. Table 2, Universal MIDI Packet Format and MIDI 2.0 Protocol ver. 1.1
+static const uint8_t midi_ump_words[16] = {1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4};
+
+static inline size_t midi_ump_len(uint32_t word)
+{
+    return midi_ump_words[word >> 28];
+}
+
+int midi_event_cin(const uint8_t *data, size_t len)
+{
+    if (len == 0 || len > 3) {
+        return -1;
+    }
+    const uint8_t status = data[0];
+    const bool sysex_end = (data[len - 1] == MIDI_SYSEX_END);
+
+    if (status >= 0x80 && status < 0xF0) {
+        // Channel Voice message, CIN is the status nibble
+        const int cin = status >> 4;
+        return (len == midi_cin_len[cin]) ? cin : -1;
+    }
+    if (status == MIDI_SYSEX_START || status < 0x80) {
+        // SysEx start or continuation, ends with 1 to 3 bytes or continues with 3 bytes
+        if (sysex_end) {
+            return USB_MIDI_CIN_SYSEX_END_1 + (int)len - 1;
+        }
+        return (len == 3) ? USB_MIDI_CIN_SYSEX_START : -1;
+    }
+    switch (status) {
+    case MIDI_SYSEX_END:
+        return (len == 1) ? USB_MIDI_CIN_SYSEX_END_1 : -1;
+    case 0xF1: // MIDI Time Code Quarter Frame
+    case 0xF3: // Song Select
+        return (len == 2) ? USB_MIDI_CIN_SYSCOM_2 : -1;
+    case 0xF2: // Song Position Pointer
+        return (len == 3) ? USB_MIDI_CIN_SYSCOM_3 : -1;
+    case 0xF6: // Tune Request
+        return (len == 1) ? USB_MIDI_CIN_SYSEX_END_1 : -1;
+    case 0xF4:
+    case 0xF5:
+        return -1; // Undefined System Common messages
+    default:
+        return (len == 1) ? USB_MIDI_CIN_SINGLE_BYTE : -1; // System Real-Time
+    }
+}
+
+size_t midi_event_encoded_size(const midi_host_event_t *event, bool ump)
+{
+    if (ump) {
+        return (event->len > 0 && event->len == midi_ump_len(event->ump[0])) ? event->len * sizeof(uint32_t) : 0;
+    }
+    return (event->cable < 16 && midi_event_cin(event->data, event->len) >= 0) ? USB_MIDI_EVENT_PACKET_SIZE : 0;
+}
+
+size_t midi_event_encode(const midi_host_event_t *event, bool ump, uint8_t *buf)
+{
+    if (ump) {
+        // UMP words are little-endian on the bus
+        for (size_t i = 0; i < event->len; i++) {
+            const uint32_t word = event->ump[i];
+            buf[i * 4 + 0] = (uint8_t)word;
+            buf[i * 4 + 1] = (uint8_t)(word >> 8);
+            buf[i * 4 + 2] = (uint8_t)(word >> 16);
+            buf[i * 4 + 3] = (uint8_t)(word >> 24);
+        }
+        return event->len * sizeof(uint32_t);
+    }
+
+    buf[0] = (uint8_t)((event->cable << 4) | midi_event_cin(event->data, event->len));
+    buf[1] = buf[2] = buf[3] = 0;
+    memcpy(&buf[1], event->data, event->len);
+    return USB_MIDI_EVENT_PACKET_SIZE;
+}
+
+size_t midi_event_decode(const uint8_t *data, size_t len, bool ump, int64_t timestamp_us, midi_host_event_t *events, size_t max_events)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos + 4 <= len && count < max_events) {
+        midi_host_event_t *event = &events[count];
+        if (ump) {
+            const uint32_t word = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+            const size_t words = midi_ump_len(word);
+            if (pos + words * 4 > len) {
+                break;
+            }
+            if (word == 0) {
+                pos += 4; // NOOP
+                continue;
+            }
+            event->timestamp_us = timestamp_us;
+            event->cable = (word >> 24) & 0x0F;
+            event->len = words;
+            event->ump[0] = word;
+            for (size_t i = 1; i < words; i++) {
+                const uint8_t *p = &data[pos + i * 4];
+                event->ump[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+            }
+            pos += words * 4;
+        } else {
+            const uint8_t cin = data[pos] & 0x0F;
+            const uint8_t msg_len = midi_cin_len[cin];
+            if (msg_len == 0) {
+                pos += USB_MIDI_EVENT_PACKET_SIZE; // Padding or reserved CIN
+                continue;
+            }
+            event->timestamp_us = timestamp_us;
+            event->cable = data[pos] >> 4;
+            event->len = msg_len;
+            memcpy(event->data, &data[pos + 1], 3);
+            pos += USB_MIDI_EVENT_PACKET_SIZE;
+        }
+        count++;
+    }
+    return count;
+}
+
+void midi_fifo_init(midi_fifo_t *fifo, midi_host_event_t *events, size_t size)
+{
+    fifo->events = events;
+    fifo->size = size;
+    fifo->head = 0;
+    fifo->tail = 0;
+}
+
+size_t midi_fifo_push(midi_fifo_t *fifo, const midi_host_event_t *events, size_t count)
+{
+    const size_t head = fifo->head;
+    const size_t tail = __atomic_load_n(&fifo->tail, __ATOMIC_ACQUIRE);
+    count = MIN(count, fifo->size - (head - tail));
+    for (size_t i = 0; i < count; i++) {
+        fifo->events[(head + i) & (fifo->size - 1)] = events[i];
+    }
+    __atomic_store_n(&fifo->head, head + count, __ATOMIC_RELEASE); // Publish events to the consumer
+    return count;
+}
+
+size_t midi_fifo_pop(midi_fifo_t *fifo, midi_host_event_t *events, size_t max_count)
+{
+    const size_t tail = fifo->tail;
+    const size_t head = __atomic_load_n(&fifo->head, __ATOMIC_ACQUIRE);
+    const size_t count = MIN(max_count, head - tail);
+    for (size_t i = 0; i < count; i++) {
+        events[i] = fifo->events[(tail + i) & (fifo->size - 1)];
+    }
+    __atomic_store_n(&fifo->tail, tail + count, __ATOMIC_RELEASE); // Return the slots to the producer
+    return count;
+}
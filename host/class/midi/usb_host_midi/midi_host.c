@@ -0,0 +1,720 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/queue.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#include "usb/usb_host.h"
+#include "usb/usb_host_shared_client.h"
+#include "usb/usb_host_urb_pool.h"
+#include "usb/usb_host_desc_index.h"
+#include "usb/midi_host.h"
+#include "midi_descriptor_parsing.h"
+#include "midi_event.h"
+
+static const char *TAG = "midi";
+
+#define MIDI_HOST_XFER_COUNT_MAX  (16) // More IN transfers in flight do not reduce latency any further
+
+// MIDI spinlock
+static portMUX_TYPE midi_lock = portMUX_INITIALIZER_UNLOCKED;
+#define MIDI_ENTER_CRITICAL()   portENTER_CRITICAL(&midi_lock)
+#define MIDI_EXIT_CRITICAL()    portEXIT_CRITICAL(&midi_lock)
+
+// MIDI driver events
+#define MIDI_TEARDOWN          BIT0
+#define MIDI_TEARDOWN_COMPLETE BIT1
+
+typedef struct midi_dev_s {
+    usb_device_handle_t dev_hdl;          // USB device
+    uint8_t dev_addr;                     // Address of the USB device, the driver opens one interface per USB device
+    midi_desc_info_t desc;                // Opened interface, endpoints point to the cached Configuration Descriptor of the open device
+    bool ump;                             // Events are Universal MIDI Packets
+    struct {
+        usb_transfer_t **xfers;           // IN transfers of one packet, all in flight
+        size_t xfer_count;
+        midi_host_event_t *events;        // Decoded events of one IN transfer, used from the driver's task only
+        size_t events_len;
+        midi_fifo_t fifo;                 // Received events for midi_host_receive(), filled from the driver's task
+        SemaphoreHandle_t ready;          // Given after events were pushed to the FIFO
+    } rx;
+    struct {
+        usb_transfer_t **xfers;           // OUT transfers
+        size_t xfer_count;
+        QueueHandle_t free;               // OUT transfers that are not in flight
+        SemaphoreHandle_t mux;            // Keeps batches of concurrent senders in order
+    } tx;
+    midi_host_rx_cb_t rx_cb;              // Cleared on close, protected by midi_lock
+    midi_host_dev_event_cb_t event_cb;    // Cleared on close, protected by midi_lock
+    void *user_arg;
+    bool disconnected;                    // USB device is gone, protected by midi_lock
+    bool closed;                          // Device was closed while usb_event_cb() referenced it, protected by midi_lock
+    int refs;                             // References of usb_event_cb(), protected by midi_lock
+    midi_host_info_t counters;            // Counters of midi_host_info_t, protected by midi_lock
+    SLIST_ENTRY(midi_dev_s) list_entry;
+} midi_dev_t;
+
+typedef struct {
+    usb_host_client_handle_t client_hdl;                  // USB Host handle reused for all MIDI devices in the system
+    usb_host_shared_client_driver_handle_t shared_driver; // Handle in the shared client, NULL if the driver has its own client
+    SemaphoreHandle_t open_close_mutex;                   // Serializes changes of devices list, it is not held while waiting for device connection
+    int open_pending;                                     // Number of midi_host_open() calls waiting for device connection
+    EventGroupHandle_t event_group;
+    SLIST_HEAD(list_dev, midi_dev_s) devices_list;        // List of open devices
+} midi_obj_t;
+
+static midi_obj_t *p_midi_obj = NULL;
+
+static const midi_host_driver_config_t midi_driver_config_default = {
+    .driver_task_stack_size = 4096,
+    .driver_task_priority = 10,
+    .xCoreID = 0,
+    .shared_client = false,
+};
+
+static void midi_client_task(void *arg)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    midi_obj_t *midi_obj = p_midi_obj; // Make local copy of the driver's handle
+    assert(midi_obj->client_hdl);
+
+    while (1) {
+        usb_host_client_handle_events(midi_obj->client_hdl, portMAX_DELAY);
+        EventBits_t events = xEventGroupGetBits(midi_obj->event_group);
+        if (events & MIDI_TEARDOWN) {
+            break;
+        }
+    }
+
+    ESP_LOGD(TAG, "Deregistering client");
+    ESP_ERROR_CHECK(usb_host_client_deregister(midi_obj->client_hdl));
+    xEventGroupSetBits(midi_obj->event_group, MIDI_TEARDOWN_COMPLETE);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Cancel transfers in flight and reset the endpoint
+ */
+static esp_err_t midi_reset_endpoint(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress)
+{
+    ESP_RETURN_ON_ERROR(usb_host_endpoint_halt(dev_hdl, bEndpointAddress), TAG,);
+    ESP_RETURN_ON_ERROR(usb_host_endpoint_flush(dev_hdl, bEndpointAddress), TAG,);
+    usb_host_endpoint_clear(dev_hdl, bEndpointAddress);
+    return ESP_OK;
+}
+
+static void midi_transfers_free(usb_transfer_t **xfers, size_t count)
+{
+    if (xfers == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (xfers[i]) {
+            usb_host_urb_pool_transfer_free(xfers[i]);
+        }
+    }
+    free(xfers);
+}
+
+/**
+ * @brief Free the device and close its USB device
+ *
+ * @note There can be no transfers in flight
+ */
+static void midi_device_remove(midi_dev_t *midi_dev)
+{
+    midi_transfers_free(midi_dev->rx.xfers, midi_dev->rx.xfer_count);
+    midi_transfers_free(midi_dev->tx.xfers, midi_dev->tx.xfer_count);
+    if (midi_dev->rx.ready) {
+        vSemaphoreDelete(midi_dev->rx.ready);
+    }
+    if (midi_dev->tx.free) {
+        vQueueDelete(midi_dev->tx.free);
+    }
+    if (midi_dev->tx.mux) {
+        vSemaphoreDelete(midi_dev->tx.mux);
+    }
+    free(midi_dev->rx.events);
+    free(midi_dev->rx.fifo.events);
+    if (midi_dev->dev_hdl) {
+        usb_host_shared_client_device_close(p_midi_obj->client_hdl, midi_dev->dev_hdl); // Gracefully continue on error
+    }
+    free(midi_dev);
+}
+
+static void midi_device_unref(midi_dev_t *midi_dev)
+{
+    MIDI_ENTER_CRITICAL();
+    const bool remove = (--midi_dev->refs == 0) && midi_dev->closed;
+    MIDI_EXIT_CRITICAL();
+    if (remove) {
+        midi_device_remove(midi_dev);
+    }
+}
+
+/**
+ * @brief IN transfer completed
+ *
+ * Events are decoded and timestamped in the driver's task and the transfer is submitted again at once,
+ * other IN transfers keep the endpoint polled meanwhile.
+ */
+static void midi_in_xfer_cb(usb_transfer_t *transfer)
+{
+    midi_dev_t *midi_dev = (midi_dev_t *)transfer->context;
+    if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+        if (transfer->status != USB_TRANSFER_STATUS_NO_DEVICE && transfer->status != USB_TRANSFER_STATUS_CANCELED) {
+            ESP_LOGW(TAG, "IN transfer error %d", transfer->status);
+            usb_host_transfer_submit(transfer); // Fails if the endpoint was halted on close
+        }
+        return;
+    }
+
+    const int64_t timestamp_us = esp_timer_get_time();
+    const size_t count = midi_event_decode(transfer->data_buffer, transfer->actual_num_bytes, midi_dev->ump, timestamp_us,
+                                           midi_dev->rx.events, midi_dev->rx.events_len);
+    MIDI_ENTER_CRITICAL();
+    const midi_host_rx_cb_t rx_cb = midi_dev->rx_cb;
+    void *user_arg = midi_dev->user_arg;
+    MIDI_EXIT_CRITICAL();
+
+    size_t dropped = 0;
+    if (count > 0) {
+        if (rx_cb) {
+            rx_cb(midi_dev, midi_dev->rx.events, count, user_arg);
+        } else {
+            dropped = count - midi_fifo_push(&midi_dev->rx.fifo, midi_dev->rx.events, count);
+            xSemaphoreGive(midi_dev->rx.ready);
+        }
+    }
+
+    MIDI_ENTER_CRITICAL();
+    midi_dev->counters.rx_transfers++;
+    midi_dev->counters.rx_events += count;
+    midi_dev->counters.rx_dropped += dropped;
+    MIDI_EXIT_CRITICAL();
+    usb_host_transfer_submit(transfer); // Fails if the endpoint was halted on close
+}
+
+static void midi_out_xfer_cb(usb_transfer_t *transfer)
+{
+    midi_dev_t *midi_dev = (midi_dev_t *)transfer->context;
+    if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+        MIDI_ENTER_CRITICAL();
+        midi_dev->counters.tx_errors++;
+        MIDI_EXIT_CRITICAL();
+    }
+    xQueueSend(midi_dev->tx.free, &transfer, 0);
+}
+
+static void midi_usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
+{
+    switch (event_msg->event) {
+    case USB_HOST_CLIENT_EVENT_NEW_DEV:
+        break; // Devices are found by polling in midi_host_open()
+    case USB_HOST_CLIENT_EVENT_DEV_GONE: {
+        // A reference keeps the device allocated until its callback returns, even if it is closed meanwhile
+        while (true) {
+            midi_dev_t *midi_dev;
+            midi_host_dev_event_cb_t event_cb = NULL;
+            void *user_arg = NULL;
+            MIDI_ENTER_CRITICAL();
+            SLIST_FOREACH(midi_dev, &p_midi_obj->devices_list, list_entry) {
+                if (midi_dev->dev_hdl == event_msg->dev_gone.dev_hdl && !midi_dev->disconnected) {
+                    midi_dev->disconnected = true;
+                    midi_dev->refs++;
+                    event_cb = midi_dev->event_cb;
+                    user_arg = midi_dev->user_arg;
+                    break;
+                }
+            }
+            MIDI_EXIT_CRITICAL();
+            if (midi_dev == NULL) {
+                break; // All devices were informed
+            }
+
+            xSemaphoreGive(midi_dev->rx.ready); // Unblock midi_host_receive()
+            if (event_cb) {
+                event_cb(midi_dev, MIDI_HOST_DEVICE_DISCONNECTED, user_arg);
+            }
+            midi_device_unref(midi_dev);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Find connected USB device with MIDIStreaming interface
+ *
+ * Devices already opened by this driver are skipped.
+ *
+ * @note On success, the function returns with open_close_mutex taken
+ * @param[in]  vid              Vendor ID
+ * @param[in]  pid              Product ID
+ * @param[in]  bInterfaceNumber MIDIStreaming interface or MIDI_HOST_ANY_INTERFACE
+ * @param[in]  ump              Prefer MIDI 2.0 alternate setting
+ * @param[in]  timeout_ms       Connection timeout [ms], 0 to wait forever
+ * @param[out] midi_dev         Device with dev_hdl, dev_addr and parsed interface
+ * @return esp_err_t
+ */
+static esp_err_t midi_find_and_open_usb_device(uint16_t vid, uint16_t pid, uint8_t bInterfaceNumber, bool ump, uint32_t timeout_ms, midi_dev_t *midi_dev)
+{
+    TickType_t timeout_ticks = (timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    TimeOut_t connection_timeout;
+    vTaskSetTimeOutState(&connection_timeout);
+
+    do {
+        xSemaphoreTake(p_midi_obj->open_close_mutex, portMAX_DELAY);
+        uint8_t dev_addr_list[10];
+        int num_of_devices;
+        ESP_ERROR_CHECK(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_of_devices));
+
+        for (int i = 0; i < num_of_devices; i++) {
+            bool opened = false;
+            midi_dev_t *other;
+            MIDI_ENTER_CRITICAL();
+            SLIST_FOREACH(other, &p_midi_obj->devices_list, list_entry) {
+                opened |= (other->dev_addr == dev_addr_list[i]);
+            }
+            MIDI_EXIT_CRITICAL();
+            usb_device_handle_t current_device;
+            if (opened || usb_host_shared_client_device_open(p_midi_obj->client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
+                continue;
+            }
+
+            const usb_device_desc_t *device_desc;
+            const usb_config_desc_t *config_desc;
+            usb_host_desc_index_t *index = NULL;
+            esp_err_t ret = ESP_ERR_NOT_FOUND;
+            ESP_ERROR_CHECK(usb_host_get_device_descriptor(current_device, &device_desc));
+            if ((vid == device_desc->idVendor || vid == MIDI_HOST_ANY_VID) &&
+                    (pid == device_desc->idProduct || pid == MIDI_HOST_ANY_PID) &&
+                    usb_host_get_active_config_descriptor(current_device, &config_desc) == ESP_OK &&
+                    usb_host_desc_index_build(config_desc, &index) == ESP_OK) {
+                ret = midi_desc_find_interface(index, bInterfaceNumber, ump, &midi_dev->desc);
+                usb_host_desc_index_free(index);
+            }
+            if (ret == ESP_OK) {
+                midi_dev->dev_hdl = current_device;
+                midi_dev->dev_addr = dev_addr_list[i];
+                return ESP_OK;
+            }
+            usb_host_shared_client_device_close(p_midi_obj->client_hdl, current_device);
+        }
+
+        // Do not block opening and closing of other devices while waiting for this one
+        xSemaphoreGive(p_midi_obj->open_close_mutex);
+        vTaskDelay(pdMS_TO_TICKS(50));
+    } while (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) == pdFALSE);
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t midi_transfers_allocate(midi_dev_t *midi_dev, const midi_host_device_config_t *dev_config)
+{
+    if (midi_dev->desc.in_ep) {
+        const size_t mps = USB_EP_DESC_GET_MPS(midi_dev->desc.in_ep);
+        midi_dev->rx.xfer_count = MIN(dev_config->in_transfer_count ? dev_config->in_transfer_count : MIDI_HOST_XFER_COUNT_DEFAULT,
+                                      MIDI_HOST_XFER_COUNT_MAX);
+        midi_dev->rx.xfers = calloc(midi_dev->rx.xfer_count, sizeof(usb_transfer_t *));
+        midi_dev->rx.events_len = mps / sizeof(uint32_t);
+        midi_dev->rx.events = calloc(midi_dev->rx.events_len, sizeof(midi_host_event_t));
+        ESP_RETURN_ON_FALSE(midi_dev->rx.xfers && midi_dev->rx.events, ESP_ERR_NO_MEM, TAG,);
+        for (size_t i = 0; i < midi_dev->rx.xfer_count; i++) {
+            // One packet per transfer: events of each packet are delivered as soon as it arrives
+            ESP_RETURN_ON_ERROR(usb_host_urb_pool_transfer_alloc(mps, 0, &midi_dev->rx.xfers[i]), TAG,);
+            usb_transfer_t *xfer = midi_dev->rx.xfers[i];
+            xfer->device_handle = midi_dev->dev_hdl;
+            xfer->bEndpointAddress = midi_dev->desc.in_ep->bEndpointAddress;
+            xfer->callback = midi_in_xfer_cb;
+            xfer->context = midi_dev;
+            xfer->num_bytes = mps;
+        }
+
+        if (dev_config->rx_cb == NULL) {
+            size_t fifo_size = 1;
+            while (fifo_size < (dev_config->fifo_size ? dev_config->fifo_size : MIDI_HOST_FIFO_SIZE_DEFAULT)) {
+                fifo_size <<= 1;
+            }
+            midi_host_event_t *fifo_events = calloc(fifo_size, sizeof(midi_host_event_t));
+            ESP_RETURN_ON_FALSE(fifo_events, ESP_ERR_NO_MEM, TAG,);
+            midi_fifo_init(&midi_dev->rx.fifo, fifo_events, fifo_size);
+        }
+    }
+    midi_dev->rx.ready = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(midi_dev->rx.ready, ESP_ERR_NO_MEM, TAG,);
+
+    if (midi_dev->desc.out_ep) {
+        const size_t out_size = dev_config->out_transfer_size ? dev_config->out_transfer_size : MIDI_HOST_OUT_SIZE_DEFAULT;
+        ESP_RETURN_ON_FALSE(out_size >= 4 * sizeof(uint32_t), ESP_ERR_INVALID_ARG, TAG, "OUT transfer smaller than one UMP");
+        midi_dev->tx.xfer_count = MIN(dev_config->out_transfer_count ? dev_config->out_transfer_count : MIDI_HOST_XFER_COUNT_DEFAULT,
+                                      MIDI_HOST_XFER_COUNT_MAX);
+        midi_dev->tx.xfers = calloc(midi_dev->tx.xfer_count, sizeof(usb_transfer_t *));
+        midi_dev->tx.free = xQueueCreate(midi_dev->tx.xfer_count, sizeof(usb_transfer_t *));
+        midi_dev->tx.mux = xSemaphoreCreateMutex();
+        ESP_RETURN_ON_FALSE(midi_dev->tx.xfers && midi_dev->tx.free && midi_dev->tx.mux, ESP_ERR_NO_MEM, TAG,);
+        for (size_t i = 0; i < midi_dev->tx.xfer_count; i++) {
+            ESP_RETURN_ON_ERROR(usb_host_urb_pool_transfer_alloc(out_size, 0, &midi_dev->tx.xfers[i]), TAG,);
+            usb_transfer_t *xfer = midi_dev->tx.xfers[i];
+            xfer->device_handle = midi_dev->dev_hdl;
+            xfer->bEndpointAddress = midi_dev->desc.out_ep->bEndpointAddress;
+            xfer->callback = midi_out_xfer_cb;
+            xfer->context = midi_dev;
+            xQueueSend(midi_dev->tx.free, &xfer, 0);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t midi_host_install(const midi_host_driver_config_t *driver_config)
+{
+    ESP_RETURN_ON_FALSE(!p_midi_obj, ESP_ERR_INVALID_STATE, TAG,);
+    if (driver_config == NULL) {
+        driver_config = &midi_driver_config_default;
+    }
+
+    esp_err_t ret;
+    midi_obj_t *midi_obj = calloc(1, sizeof(midi_obj_t));
+    EventGroupHandle_t event_group = xEventGroupCreate();
+    SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    TaskHandle_t driver_task_h = NULL;
+    if (!driver_config->shared_client) {
+        xTaskCreatePinnedToCore(midi_client_task, "USB-MIDI", driver_config->driver_task_stack_size, NULL,
+                                driver_config->driver_task_priority, &driver_task_h, driver_config->xCoreID);
+    }
+    if (midi_obj == NULL || (driver_task_h == NULL && !driver_config->shared_client) || event_group == NULL || mutex == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto err;
+    }
+    SLIST_INIT(&midi_obj->devices_list);
+    midi_obj->event_group = event_group;
+    midi_obj->open_close_mutex = mutex;
+
+    usb_host_client_handle_t usb_client = NULL;
+    usb_host_shared_client_driver_handle_t shared_driver = NULL;
+    if (driver_config->shared_client) {
+        const usb_host_shared_client_driver_config_t shared_config = {
+            .event_cb = midi_usb_event_cb,
+            .step_cb = NULL,
+            .arg = midi_obj,
+        };
+        ESP_GOTO_ON_ERROR(usb_host_shared_client_add_driver(&shared_config, &shared_driver, &usb_client), err, TAG,
+                          "Failed to add driver to USB host shared client");
+    } else {
+        const usb_host_client_config_t client_config = {
+            .is_synchronous = false,
+            .max_num_event_msg = 3,
+            .async.client_event_callback = midi_usb_event_cb,
+            .async.callback_arg = NULL
+        };
+        ESP_GOTO_ON_ERROR(usb_host_client_register(&client_config, &usb_client), err, TAG, "Failed to register USB host client");
+    }
+    midi_obj->client_hdl = usb_client;
+    midi_obj->shared_driver = shared_driver;
+
+    // Make sure that there is only one instance of this driver in the system
+    MIDI_ENTER_CRITICAL();
+    if (p_midi_obj) {
+        ret = ESP_ERR_INVALID_STATE;
+        MIDI_EXIT_CRITICAL();
+        goto client_err;
+    }
+    p_midi_obj = midi_obj;
+    MIDI_EXIT_CRITICAL();
+
+    if (driver_task_h) {
+        xTaskNotifyGive(driver_task_h);
+    }
+    return ESP_OK;
+
+client_err:
+    if (shared_driver) {
+        usb_host_shared_client_remove_driver(shared_driver);
+    } else {
+        usb_host_client_deregister(usb_client);
+    }
+err:
+    free(midi_obj);
+    if (event_group) {
+        vEventGroupDelete(event_group);
+    }
+    if (driver_task_h) {
+        vTaskDelete(driver_task_h);
+    }
+    if (mutex) {
+        vSemaphoreDelete(mutex);
+    }
+    return ret;
+}
+
+esp_err_t midi_host_uninstall(void)
+{
+    esp_err_t ret;
+    MIDI_ENTER_CRITICAL();
+    midi_obj_t *midi_obj = p_midi_obj;
+    MIDI_EXIT_CRITICAL();
+    ESP_RETURN_ON_FALSE(midi_obj, ESP_ERR_INVALID_STATE, TAG,);
+
+    xSemaphoreTake(midi_obj->open_close_mutex, portMAX_DELAY); // Wait for all open/close calls to finish
+    MIDI_ENTER_CRITICAL();
+    if (!SLIST_EMPTY(&midi_obj->devices_list) || midi_obj->open_pending != 0) {
+        MIDI_EXIT_CRITICAL();
+        ret = ESP_ERR_INVALID_STATE;
+        goto unblock;
+    }
+    p_midi_obj = NULL; // No open/close calls form this point
+    MIDI_EXIT_CRITICAL();
+
+    if (midi_obj->shared_driver) {
+        ESP_ERROR_CHECK(usb_host_shared_client_remove_driver(midi_obj->shared_driver));
+    } else {
+        // Signal to MIDI task to stop, unblock it and wait for its deletion
+        xEventGroupSetBits(midi_obj->event_group, MIDI_TEARDOWN);
+        usb_host_client_unblock(midi_obj->client_hdl);
+        ESP_GOTO_ON_FALSE(
+            xEventGroupWaitBits(midi_obj->event_group, MIDI_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
+            ESP_ERR_NOT_FINISHED, unblock, TAG,);
+    }
+
+    vEventGroupDelete(midi_obj->event_group);
+    xSemaphoreGive(midi_obj->open_close_mutex);
+    vSemaphoreDelete(midi_obj->open_close_mutex);
+    free(midi_obj);
+    return ESP_OK;
+
+unblock:
+    xSemaphoreGive(midi_obj->open_close_mutex);
+    return ret;
+}
+
+esp_err_t midi_host_open(uint16_t vid, uint16_t pid, uint8_t bInterfaceNumber, const midi_host_device_config_t *dev_config, midi_dev_hdl_t *midi_hdl_ret)
+{
+    esp_err_t ret;
+    ESP_RETURN_ON_FALSE(p_midi_obj, ESP_ERR_INVALID_STATE, TAG,);
+    ESP_RETURN_ON_FALSE(dev_config && midi_hdl_ret, ESP_ERR_INVALID_ARG, TAG,);
+    *midi_hdl_ret = NULL;
+
+    midi_dev_t *midi_dev = calloc(1, sizeof(midi_dev_t));
+    ESP_RETURN_ON_FALSE(midi_dev, ESP_ERR_NO_MEM, TAG,);
+    midi_dev->rx_cb = dev_config->rx_cb;
+    midi_dev->event_cb = dev_config->event_cb;
+    midi_dev->user_arg = dev_config->user_arg;
+
+    MIDI_ENTER_CRITICAL();
+    p_midi_obj->open_pending++;
+    MIDI_EXIT_CRITICAL();
+    ret = midi_find_and_open_usb_device(vid, pid, bInterfaceNumber, dev_config->ump, dev_config->connection_timeout_ms, midi_dev);
+    MIDI_ENTER_CRITICAL();
+    p_midi_obj->open_pending--;
+    MIDI_EXIT_CRITICAL();
+    if (ret != ESP_OK) {
+        free(midi_dev);
+        return ret;
+    }
+    // open_close_mutex is taken from here
+    midi_dev->ump = (midi_dev->desc.bcdMSC == USB_MIDI_BCD_MSC_2_0);
+    midi_dev->counters.bInterfaceNumber = midi_dev->desc.bInterfaceNumber;
+    midi_dev->counters.ump = midi_dev->ump;
+    midi_dev->counters.in_cables = midi_dev->desc.in_cables;
+    midi_dev->counters.out_cables = midi_dev->desc.out_cables;
+
+    ESP_GOTO_ON_ERROR(midi_transfers_allocate(midi_dev, dev_config), err, TAG, "Could not allocate transfers");
+    ESP_GOTO_ON_ERROR(
+        usb_host_interface_claim(p_midi_obj->client_hdl, midi_dev->dev_hdl, midi_dev->desc.bInterfaceNumber, midi_dev->desc.bAlternateSetting),
+        err, TAG, "Could not claim interface %d", midi_dev->desc.bInterfaceNumber);
+
+    MIDI_ENTER_CRITICAL();
+    SLIST_INSERT_HEAD(&p_midi_obj->devices_list, midi_dev, list_entry);
+    MIDI_EXIT_CRITICAL();
+
+    for (size_t i = 0; i < midi_dev->rx.xfer_count; i++) {
+        ESP_GOTO_ON_ERROR(usb_host_transfer_submit(midi_dev->rx.xfers[i]), submit_err, TAG, "Could not submit IN transfer");
+    }
+    ESP_LOGI(TAG, "Opened MIDI %s interface %d, %d IN and %d OUT cables", midi_dev->ump ? "2.0" : "1.0",
+             midi_dev->desc.bInterfaceNumber, midi_dev->desc.in_cables, midi_dev->desc.out_cables);
+    xSemaphoreGive(p_midi_obj->open_close_mutex);
+    *midi_hdl_ret = midi_dev;
+    return ESP_OK;
+
+submit_err:
+    xSemaphoreGive(p_midi_obj->open_close_mutex);
+    midi_host_close(midi_dev);
+    return ret;
+
+err:
+    midi_device_remove(midi_dev);
+    xSemaphoreGive(p_midi_obj->open_close_mutex);
+    return ret;
+}
+
+esp_err_t midi_host_close(midi_dev_hdl_t midi_hdl)
+{
+    ESP_RETURN_ON_FALSE(p_midi_obj, ESP_ERR_INVALID_STATE, TAG,);
+    ESP_RETURN_ON_FALSE(midi_hdl, ESP_ERR_INVALID_ARG, TAG,);
+    xSemaphoreTake(p_midi_obj->open_close_mutex, portMAX_DELAY);
+
+    // Make sure that the device is in the devices list (that it is not already closed)
+    midi_dev_t *midi_dev;
+    MIDI_ENTER_CRITICAL();
+    SLIST_FOREACH(midi_dev, &p_midi_obj->devices_list, list_entry) {
+        if (midi_dev == midi_hdl) {
+            break;
+        }
+    }
+    if (midi_dev == NULL) {
+        MIDI_EXIT_CRITICAL();
+        xSemaphoreGive(p_midi_obj->open_close_mutex);
+        return ESP_OK;
+    }
+    // No user callbacks from this point
+    midi_dev->rx_cb = NULL;
+    midi_dev->event_cb = NULL;
+    MIDI_EXIT_CRITICAL();
+
+    // Endpoint reset cancels all transfers in flight. Halted endpoint does not accept the resubmitted IN transfers
+    if (midi_dev->desc.in_ep) {
+        ESP_ERROR_CHECK(midi_reset_endpoint(midi_dev->dev_hdl, midi_dev->desc.in_ep->bEndpointAddress));
+    }
+    if (midi_dev->desc.out_ep) {
+        xSemaphoreTake(midi_dev->tx.mux, portMAX_DELAY);
+        if (uxQueueMessagesWaiting(midi_dev->tx.free) < midi_dev->tx.xfer_count) {
+            ESP_ERROR_CHECK(midi_reset_endpoint(midi_dev->dev_hdl, midi_dev->desc.out_ep->bEndpointAddress));
+        }
+    }
+    ESP_ERROR_CHECK(usb_host_interface_release(p_midi_obj->client_hdl, midi_dev->dev_hdl, midi_dev->desc.bInterfaceNumber));
+
+    MIDI_ENTER_CRITICAL();
+    SLIST_REMOVE(&p_midi_obj->devices_list, midi_dev, midi_dev_s, list_entry);
+    midi_dev->closed = true;
+    const bool in_use = (midi_dev->refs > 0);
+    MIDI_EXIT_CRITICAL();
+    if (midi_dev->tx.mux) {
+        xSemaphoreGive(midi_dev->tx.mux);
+    }
+
+    // A device referenced by midi_usb_event_cb() is removed there, once its disconnection callback returns
+    if (!in_use) {
+        midi_device_remove(midi_dev);
+    }
+    xSemaphoreGive(p_midi_obj->open_close_mutex);
+    return ESP_OK;
+}
+
+esp_err_t midi_host_send(midi_dev_hdl_t midi_hdl, const midi_host_event_t *events, size_t count, size_t *sent_count, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(midi_hdl && (events || count == 0), ESP_ERR_INVALID_ARG, TAG,);
+    midi_dev_t *midi_dev = midi_hdl;
+    if (sent_count) {
+        *sent_count = 0;
+    }
+    ESP_RETURN_ON_FALSE(midi_dev->desc.out_ep, ESP_ERR_NOT_SUPPORTED, TAG, "No OUT endpoint");
+    for (size_t i = 0; i < count; i++) {
+        ESP_RETURN_ON_FALSE(midi_event_encoded_size(&events[i], midi_dev->ump), ESP_ERR_INVALID_ARG, TAG, "Invalid event %u", (unsigned)i);
+    }
+
+    TickType_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
+    TimeOut_t send_timeout;
+    vTaskSetTimeOutState(&send_timeout);
+    if (xSemaphoreTake(midi_dev->tx.mux, timeout_ticks) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t sent = 0;
+    while (sent < count) {
+        MIDI_ENTER_CRITICAL();
+        const bool disconnected = midi_dev->disconnected;
+        MIDI_EXIT_CRITICAL();
+        if (disconnected) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        usb_transfer_t *xfer;
+        xTaskCheckForTimeOut(&send_timeout, &timeout_ticks);
+        if (xQueueReceive(midi_dev->tx.free, &xfer, timeout_ticks) != pdTRUE) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+
+        // Pack as many events as fit into the transfer
+        size_t len = 0;
+        size_t batch = 0;
+        while (sent + batch < count) {
+            const midi_host_event_t *event = &events[sent + batch];
+            if (len + midi_event_encoded_size(event, midi_dev->ump) > xfer->data_buffer_size) {
+                break;
+            }
+            len += midi_event_encode(event, midi_dev->ump, xfer->data_buffer + len);
+            batch++;
+        }
+        xfer->num_bytes = len;
+        ret = usb_host_transfer_submit(xfer);
+        if (ret != ESP_OK) {
+            xQueueSend(midi_dev->tx.free, &xfer, 0);
+            break;
+        }
+        sent += batch;
+        MIDI_ENTER_CRITICAL();
+        midi_dev->counters.tx_events += batch;
+        midi_dev->counters.tx_transfers++;
+        MIDI_EXIT_CRITICAL();
+    }
+    xSemaphoreGive(midi_dev->tx.mux);
+    if (sent_count) {
+        *sent_count = sent;
+    }
+    return ret;
+}
+
+esp_err_t midi_host_receive(midi_dev_hdl_t midi_hdl, midi_host_event_t *events, size_t max_count, size_t *count, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(midi_hdl && events && max_count && count, ESP_ERR_INVALID_ARG, TAG,);
+    midi_dev_t *midi_dev = midi_hdl;
+    *count = 0;
+    ESP_RETURN_ON_FALSE(midi_dev->rx.fifo.events, ESP_ERR_INVALID_STATE, TAG, "Events are delivered to rx_cb");
+
+    TickType_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
+    TimeOut_t receive_timeout;
+    vTaskSetTimeOutState(&receive_timeout);
+    while (true) {
+        *count = midi_fifo_pop(&midi_dev->rx.fifo, events, max_count);
+        if (*count > 0) {
+            return ESP_OK;
+        }
+        MIDI_ENTER_CRITICAL();
+        const bool disconnected = midi_dev->disconnected;
+        MIDI_EXIT_CRITICAL();
+        if (disconnected) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        // The semaphore may be given for events that were already taken, so the FIFO is checked again
+        if (xTaskCheckForTimeOut(&receive_timeout, &timeout_ticks) == pdTRUE ||
+                xSemaphoreTake(midi_dev->rx.ready, timeout_ticks) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+esp_err_t midi_host_get_info(midi_dev_hdl_t midi_hdl, midi_host_info_t *info)
+{
+    ESP_RETURN_ON_FALSE(midi_hdl && info, ESP_ERR_INVALID_ARG, TAG,);
+    midi_dev_t *midi_dev = midi_hdl;
+    MIDI_ENTER_CRITICAL();
+    *info = midi_dev->counters;
+    MIDI_EXIT_CRITICAL();
+    return ESP_OK;
+}
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_types_ch9.h"
+#include "usb/usb_host_desc_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parsed MIDIStreaming interface
+typedef struct {
+    uint8_t bInterfaceNumber;
+    uint8_t bAlternateSetting;      // 0 for MIDI 1.0, alternate setting with bcdMSC 2.0 for UMP
+    uint16_t bcdMSC;
+    const usb_ep_desc_t *in_ep;     // Bulk or interrupt IN endpoint, NULL if the device has none
+    const usb_ep_desc_t *out_ep;    // Bulk or interrupt OUT endpoint, NULL if the device has none
+    uint8_t in_cables;              // bNumEmbMIDIJack of the IN endpoint
+    uint8_t out_cables;             // bNumEmbMIDIJack of the OUT endpoint
+} midi_desc_info_t;
+
+/**
+ * @brief Find MIDIStreaming interface and its endpoints
+ *
+ * @param[in]  index            Index of Configuration Descriptor
+ * @param[in]  bInterfaceNumber Interface number, MIDI_HOST_ANY_INTERFACE for the first MIDIStreaming interface
+ * @param[in]  ump              Prefer MIDI 2.0 alternate setting. MIDI 1.0 alternate setting is used if there is none
+ * @param[out] info             Parsed interface, valid until the index is freed
+ * @return
+ *     - ESP_OK:                Success
+ *     - ESP_ERR_NOT_FOUND:     There is no such MIDIStreaming interface
+ *     - ESP_ERR_NOT_SUPPORTED: The interface has neither IN nor OUT endpoint
+ */
+esp_err_t midi_desc_find_interface(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber, bool ump, midi_desc_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
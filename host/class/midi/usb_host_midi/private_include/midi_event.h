@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "usb/midi_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Single producer, single consumer FIFO of events. Indexes run freely and are masked by size - 1
+typedef struct {
+    midi_host_event_t *events; // Storage of size events
+    size_t size;               // Power of 2
+    size_t head;               // Written by the producer only
+    size_t tail;               // Written by the consumer only
+} midi_fifo_t;
+
+/**
+ * @brief Get Code Index Number of MIDI 1.0 message
+ *
+ * SysEx chunks are told apart by their first and last byte: chunks that do not end with 0xF7 must have 3 bytes.
+ *
+ * @param[in] data MIDI message or SysEx chunk
+ * @param[in] len  Length of data, 1 to 3
+ * @return Code Index Number, -1 if the message is not valid
+ */
+int midi_event_cin(const uint8_t *data, size_t len);
+
+/**
+ * @brief Get size of the event in an OUT transfer
+ *
+ * @param[in] event Event to be sent
+ * @param[in] ump   Event is Universal MIDI Packet
+ * @return Size in bytes, 0 if the event is not valid
+ */
+size_t midi_event_encoded_size(const midi_host_event_t *event, bool ump);
+
+/**
+ * @brief Write the event to an OUT transfer
+ *
+ * @param[in]  event Valid event, see midi_event_encoded_size()
+ * @param[in]  ump   Event is Universal MIDI Packet
+ * @param[out] buf   Buffer of midi_event_encoded_size() bytes
+ * @return Number of bytes written
+ */
+size_t midi_event_encode(const midi_host_event_t *event, bool ump, uint8_t *buf);
+
+/**
+ * @brief Decode data of an IN transfer
+ *
+ * Empty USB-MIDI Event Packets and UMP NOOPs, which devices use as padding, and packets with reserved CIN are skipped.
+ * Incomplete packet at the end of data is ignored.
+ *
+ * @param[in]  data         Data of the IN transfer
+ * @param[in]  len          Length of data
+ * @param[in]  ump          Data are Universal MIDI Packets
+ * @param[in]  timestamp_us Timestamp of all events
+ * @param[out] events       Decoded events
+ * @param[in]  max_events   Size of events array. len / 4 events always fit
+ * @return Number of decoded events
+ */
+size_t midi_event_decode(const uint8_t *data, size_t len, bool ump, int64_t timestamp_us, midi_host_event_t *events, size_t max_events);
+
+/**
+ * @brief Initialize FIFO
+ *
+ * @param[out] fifo   FIFO
+ * @param[in]  events Storage of size events
+ * @param[in]  size   Capacity, power of 2
+ */
+void midi_fifo_init(midi_fifo_t *fifo, midi_host_event_t *events, size_t size);
+
+/**
+ * @brief Append events to FIFO, called by the producer
+ *
+ * @param[in] fifo   FIFO
+ * @param[in] events Events
+ * @param[in] count  Number of events
+ * @return Number of appended events. Events that do not fit are dropped
+ */
+size_t midi_fifo_push(midi_fifo_t *fifo, const midi_host_event_t *events, size_t count);
+
+/**
+ * @brief Take events from FIFO, called by the consumer
+ *
+ * @param[in]  fifo      FIFO
+ * @param[out] events    Events
+ * @param[in]  max_count Size of events array
+ * @return Number of taken events
+ */
+size_t midi_fifo_pop(midi_fifo_t *fifo, midi_host_event_t *events, size_t max_count);
+
+#ifdef __cplusplus
+}
+#endif
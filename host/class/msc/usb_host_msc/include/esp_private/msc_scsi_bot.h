@@ -21,31 +21,107 @@ typedef struct {
     uint8_t code_q;
 } scsi_sense_data_t;
 
+/**
+ * @brief Block Limits reported by Logical Unit, zero if not reported
+ */
+typedef struct {
+    uint32_t max_unmap_lba_count;           /**< Maximum number of sectors unmapped by one UNMAP command, 0 if UNMAP is not supported */
+    uint32_t max_unmap_descriptor_count;    /**< Maximum number of block descriptors in one UNMAP command */
+    uint32_t optimal_unmap_granularity;     /**< Optimal number of sectors unmapped at once */
+    uint32_t max_transfer_length;           /**< Maximum number of sectors transferred by one command */
+    uint16_t optimal_transfer_granularity;  /**< Optimal number of sectors transferred at once */
+} scsi_block_limits_t;
+
 esp_err_t scsi_cmd_read10(msc_host_device_handle_t device,
+                          uint8_t lun,
                           uint8_t *data,
                           uint32_t sector_address,
                           uint32_t num_sectors,
                           uint32_t sector_size);
 
 esp_err_t scsi_cmd_write10(msc_host_device_handle_t device,
+                           uint8_t lun,
                            const uint8_t *data,
                            uint32_t sector_address,
                            uint32_t num_sectors,
                            uint32_t sector_size);
 
+esp_err_t scsi_cmd_read16(msc_host_device_handle_t device,
+                          uint8_t lun,
+                          uint8_t *data,
+                          uint64_t sector_address,
+                          uint32_t num_sectors,
+                          uint32_t sector_size);
+
+esp_err_t scsi_cmd_write16(msc_host_device_handle_t device,
+                           uint8_t lun,
+                           const uint8_t *data,
+                           uint64_t sector_address,
+                           uint32_t num_sectors,
+                           uint32_t sector_size);
+
+/**
+ * @brief Read sectors with READ(10), or with READ(16) if address or length do not fit into READ(10)
+ */
+esp_err_t scsi_cmd_read(msc_host_device_handle_t device,
+                        uint8_t lun,
+                        uint8_t *data,
+                        uint64_t sector_address,
+                        uint32_t num_sectors,
+                        uint32_t sector_size);
+
+/**
+ * @brief Write sectors with WRITE(10), or with WRITE(16) if address or length do not fit into WRITE(10)
+ */
+esp_err_t scsi_cmd_write(msc_host_device_handle_t device,
+                         uint8_t lun,
+                         const uint8_t *data,
+                         uint64_t sector_address,
+                         uint32_t num_sectors,
+                         uint32_t sector_size);
+
+esp_err_t scsi_cmd_sync_cache(msc_host_device_handle_t device, uint8_t lun);
+
+esp_err_t scsi_cmd_unmap(msc_host_device_handle_t device, uint8_t lun, uint64_t sector_address, uint32_t num_sectors);
+
+/**
+ * @brief Read Block Limits VPD page
+ *
+ * @return
+ *    - ESP_OK: Limits read
+ *    - ESP_ERR_NOT_SUPPORTED: Logical Unit does not report Block Limits
+ */
+esp_err_t scsi_cmd_block_limits(msc_host_device_handle_t device, uint8_t lun, scsi_block_limits_t *limits);
+
 esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t device,
+                                 uint8_t lun,
                                  uint32_t *block_size,
                                  uint32_t *block_count);
 
-esp_err_t scsi_cmd_sense(msc_host_device_handle_t device, scsi_sense_data_t *sense);
+esp_err_t scsi_cmd_read_capacity16(msc_host_device_handle_t device,
+                                   uint8_t lun,
+                                   uint32_t *block_size,
+                                   uint64_t *block_count);
+
+esp_err_t scsi_cmd_sense(msc_host_device_handle_t device, uint8_t lun, scsi_sense_data_t *sense);
 
-esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t device);
+esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t device, uint8_t lun);
+
+/**
+ * @brief TEST UNIT READY, sense data of a unit that is not ready are returned instead of logged
+ *
+ * @param[in]  device MSC device
+ * @param[in]  lun    Logical Unit Number
+ * @param[out] sense  Sense data, valid if the command failed with ESP_FAIL
+ * @return esp_err_t
+ */
+esp_err_t scsi_cmd_unit_ready_sense(msc_host_device_handle_t device, uint8_t lun, scsi_sense_data_t *sense);
 
-esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t device);
+esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t device, uint8_t lun);
 
-esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t device, bool prevent);
+esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t device, uint8_t lun, bool prevent);
 
-esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t device);
+esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t device, uint8_t lun);
 
 #ifdef __cplusplus
 }
@@ -23,6 +23,14 @@ extern "C" {
 
 #define MSC_STR_DESC_SIZE 32
 
+#define MSC_HOST_MAX_LUN 16 /*!< Maximum number of Logical Units of one device, defined by Bulk-Only Transport */
+
+#define MSC_HOST_PIPELINE_CHUNK_SIZE_DEFAULT (16 * 1024) /*!< Default size of one pipelined bulk transfer */
+
+#define MSC_HOST_COPY_CHUNK_SIZE_DEFAULT (64 * 1024) /*!< Default size of one chunk copied by msc_host_copy_sectors() */
+
+#define MSC_HOST_STATS_LATENCY_BUCKETS 12 /*!< Number of buckets of command latency histogram */
+
 typedef struct msc_host_device *msc_host_device_handle_t;     /**< Handle to a Mass Storage Device */
 
 /**
@@ -46,6 +54,40 @@ typedef struct {
 */
 typedef void (*msc_host_event_cb_t)(const msc_host_event_t *event, void *arg);
 
+/**
+ * @brief Completion callback of asynchronous sector read or write.
+ *
+ * Called from the asynchronous I/O task of the device. The callback should not block for long,
+ * as following requests wait until it returns.
+ *
+ * @param[in] device Device the request was submitted to
+ * @param[in] status ESP_OK if all sectors were transferred, error code otherwise
+ * @param[in] arg    User argument provided upon request submission
+*/
+typedef void (*msc_host_io_done_cb_t)(msc_host_device_handle_t device, esp_err_t status, void *arg);
+
+/**
+ * @brief Workarounds of devices known to misbehave, flags of msc_host_quirk_t
+ */
+typedef enum {
+    MSC_HOST_QUIRK_NO_MODE_SENSE = (1 << 0),        /**< MODE SENSE is slow or rejected, scsi_cmd_mode_sense() succeeds without sending it */
+    MSC_HOST_QUIRK_NO_PREVENT_REMOVAL = (1 << 1),   /**< PREVENT ALLOW MEDIUM REMOVAL is rejected, scsi_cmd_prevent_removal() succeeds without sending it */
+    MSC_HOST_QUIRK_NO_BLOCK_LIMITS = (1 << 2),      /**< Block Limits VPD page is not requested while the device is installed */
+} msc_host_quirk_flags_t;
+
+#define MSC_HOST_QUIRK_ANY_PRODUCT 0xFFFF           /**< idProduct of msc_host_quirk_t matching all products of the vendor */
+
+/**
+ * @brief Entry of device quirks table, matched by VID and PID when the device is installed
+ */
+typedef struct {
+    uint16_t idVendor;
+    uint16_t idProduct;             /**< Product ID or MSC_HOST_QUIRK_ANY_PRODUCT */
+    uint32_t flags;                 /**< Bitmask of msc_host_quirk_flags_t */
+    uint16_t max_sectors;           /**< Largest READ/WRITE command in sectors, larger accesses are split. 0 if not limited */
+    uint16_t settle_ms;             /**< Delay after attach before the first class request is sent */
+} msc_host_quirk_t;
+
 /**
  * @brief MSC configuration structure.
 */
@@ -55,23 +97,88 @@ typedef struct {
     size_t task_priority;           /**< Task priority of created background task */
     size_t stack_size;              /**< Stack size of created background task */
     BaseType_t core_id;             /**< Select core on which background task will run or tskNO_AFFINITY  */
+    bool shared_client;             /**< Use the client installed with usb_host_shared_client_install() instead of own client.
+                                         Events are handled by the shared client task, create_backround_task must be false */
     msc_host_event_cb_t callback;   /**< Callback invoked when MSC event occurs. Must not be NULL. */
     void *callback_arg;             /**< User provided argument passed to callback */
+    size_t pipeline_depth;          /**< Number of bulk transfers kept in flight during data phase of large SCSI READ/WRITE commands.
+                                         Set to 0 or 1 to disable pipelining. */
+    size_t pipeline_chunk_size;     /**< Size of one pipelined bulk transfer in bytes, must be a multiple of 512.
+                                         Set to 0 to use default MSC_HOST_PIPELINE_CHUNK_SIZE_DEFAULT */
+    struct {
+        size_t size;                /**< Number of sectors cached per device. Set to 0 to disable the cache */
+        size_t read_ahead;          /**< Number of sectors read ahead on sequential cache miss */
+        bool write_back;            /**< true: written sectors are held in cache and merged into large writes on flush.
+                                         false: write-through */
+        uint32_t heap_caps;         /**< Heap caps of cache memory. Set to 0 for MALLOC_CAP_DEFAULT */
+        uint32_t flush_timeout_ms;  /**< With write_back, dirty sectors are written at latest after this timeout.
+                                         Set to 0 to write them only on CTRL_SYNC or when the cache is full */
+    } cache;                        /**< Sector cache used by the FATFS disk I/O layer */
+    struct {
+        size_t queue_size;          /**< Number of asynchronous requests that can wait in the queue of each device. Set to 0 to disable asynchronous API */
+        size_t task_priority;       /**< Task priority of asynchronous I/O task, one task is created for each device */
+        size_t stack_size;          /**< Stack size of asynchronous I/O task */
+        BaseType_t core_id;         /**< Select core on which asynchronous I/O task will run or tskNO_AFFINITY */
+        size_t reorder_window;      /**< Number of queued requests the elevator scheduler sorts by LUN, direction and sector and merges
+                                         into sequential commands. A request is overtaken at most reorder_window times.
+                                         Set to 0 or 1 to execute requests in order of submission */
+        size_t merge_buffer_size;   /**< Size in bytes of buffer gathering merged requests whose data buffers are not adjacent in memory.
+                                         Set to 0 to merge only requests with adjacent buffers */
+    } async;                        /**< Asynchronous sector I/O, see msc_host_read_sectors_async() */
+    struct {
+        uint32_t max_ms;            /**< Timeout of one USB transfer, upper bound of adaptive timeout. Set to 0 for default 5000 ms */
+        uint32_t min_ms;            /**< Lower bound of adaptive timeout derived from observed transfer durations.
+                                         Set to 0 to disable adaptive timeouts, max_ms is then used for all transfers */
+        uint8_t retries;            /**< Number of times a command is repeated after transport error, e.g. timeout.
+                                         Commands rejected by the device are not repeated */
+        uint32_t backoff_ms;        /**< Delay before the first retry, doubled before each further retry */
+    } timeout;                      /**< Transfer timeouts and retry policy. Worst-case duration of one command is
+                                         (retries + 1) * 3 * max_ms plus the retry delays */
+    const msc_host_quirk_t *quirks; /**< Quirks of application specific devices, matched before the built-in table.
+                                         Must stay valid until msc_host_uninstall(). Can be NULL */
+    size_t quirk_count;             /**< Number of entries in quirks */
 } msc_host_driver_config_t;
 
 /**
  * @brief MSC device info.
 */
 typedef struct {
-    uint32_t sector_count;
+    uint32_t sector_count;          /**< Saturated to UINT32_MAX for devices with more sectors */
     uint32_t sector_size;
     uint16_t idProduct;
     uint16_t idVendor;
     wchar_t iManufacturer[MSC_STR_DESC_SIZE];
     wchar_t iProduct[MSC_STR_DESC_SIZE];
     wchar_t iSerialNumber[MSC_STR_DESC_SIZE];
+    uint8_t lun_count;              /**< Number of Logical Units. sector_count and sector_size describe LUN 0 */
+    uint32_t max_transfer_size;     /**< Largest READ/WRITE command accepted by LUN 0 in bytes, 0 if not limited */
+    uint32_t allocation_unit_size;  /**< Recommended allocation_unit_size of esp_vfs_fat_mount_config_t matching erase block of LUN 0,
+                                         0 if the device does not report it */
+    uint32_t buffer_alignment;      /**< Alignment of DMA capable buffers, e.g. passed to setvbuf(), transferred without copying */
 } msc_host_device_info_t;
 
+/**
+ * @brief MSC device command statistics.
+ *
+ * Collected only if CONFIG_MSC_HOST_STATS is enabled. Times are in microseconds.
+*/
+typedef struct {
+    uint32_t commands;              /**< Number of executed SCSI commands */
+    uint32_t errors;                /**< Number of failed commands */
+    uint32_t retries;               /**< Number of status transports repeated after STALL and commands repeated after transport error */
+    uint32_t stalls;                /**< Number of STALLed bulk transfers */
+    uint32_t reset_recoveries;      /**< Number of msc_host_reset_recovery() calls */
+    uint64_t bytes_read;            /**< Data read by successful commands */
+    uint64_t bytes_written;         /**< Data written by successful commands */
+    uint64_t command_time_us;       /**< Total time spent in command transport (CBW or Command IU) */
+    uint64_t data_time_us;          /**< Total time spent in data transport */
+    uint64_t status_time_us;        /**< Total time spent in status transport (CSW or Sense IU) */
+    uint32_t max_latency_us;        /**< Longest command */
+    uint32_t latency_histogram[MSC_HOST_STATS_LATENCY_BUCKETS]; /**< Command latency. Bucket 0 counts commands shorter than 128 us,
+                                                                     bucket n commands from 64 << n to 128 << n us.
+                                                                     The last bucket counts also all longer commands */
+} msc_host_stats_t;
+
 /**
  * @brief Install USB Host Mass Storage Class driver
  *
@@ -139,6 +246,94 @@ __attribute__((deprecated("use API from esp_private/msc_scsi_bot.h")));
 esp_err_t msc_host_write_sector(msc_host_device_handle_t device, size_t sector, const void *data, size_t size)
 __attribute__((deprecated("use API from esp_private/msc_scsi_bot.h")));
 
+/**
+ * @brief Read sectors from mass storage device without blocking.
+ *
+ * The request is queued and executed by asynchronous I/O task of the device, which calls the callback when the request is finished.
+ * Requests are executed through the same sector cache as file system accesses, in order of submission unless
+ * async.reorder_window is set. The scheduler then executes the queued requests sorted by sector and merges contiguous ones,
+ * so completion order may differ from submission order. Requests accessing the same sectors never overtake each other,
+ * unless both are reads.
+ *
+ * @note Driver must be installed with non-zero async.queue_size
+ *
+ * @param[in]  device   Device handle
+ * @param[in]  lun      Logical Unit Number
+ * @param[in]  sector   First sector to read
+ * @param[in]  count    Number of sectors to read
+ * @param[out] data     Buffer for read data, it must stay valid until the callback is called
+ * @param[in]  callback Completion callback, must not be NULL
+ * @param[in]  arg      User argument passed to the callback
+ * @return esp_err_t
+ *    - ESP_OK: Request queued
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Asynchronous API was not enabled in driver configuration
+ *    - ESP_ERR_NO_MEM: Request queue is full
+ */
+esp_err_t msc_host_read_sectors_async(msc_host_device_handle_t device, uint8_t lun, uint32_t sector, uint32_t count,
+                                      void *data, msc_host_io_done_cb_t callback, void *arg);
+
+/**
+ * @brief Write sectors to mass storage device without blocking.
+ *
+ * @see msc_host_read_sectors_async()
+ *
+ * @param[in] device   Device handle
+ * @param[in] lun      Logical Unit Number
+ * @param[in] sector   First sector to write
+ * @param[in] count    Number of sectors to write
+ * @param[in] data     Data to be written, it must stay valid until the callback is called
+ * @param[in] callback Completion callback, must not be NULL
+ * @param[in] arg      User argument passed to the callback
+ * @return esp_err_t
+ *    - ESP_OK: Request queued
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Asynchronous API was not enabled in driver configuration
+ *    - ESP_ERR_NO_MEM: Request queue is full
+ */
+esp_err_t msc_host_write_sectors_async(msc_host_device_handle_t device, uint8_t lun, uint32_t sector, uint32_t count,
+                                       const void *data, msc_host_io_done_cb_t callback, void *arg);
+
+/**
+ * @brief Configuration of device-to-device copy
+ */
+typedef struct {
+    size_t chunk_size;              /**< Size of one READ or WRITE command in bytes, rounded down to whole sectors.
+                                         Two buffers of this size are allocated. Set to 0 for default MSC_HOST_COPY_CHUNK_SIZE_DEFAULT */
+    size_t task_priority;           /**< Priority of the task writing to the destination device */
+    size_t stack_size;              /**< Stack size of the task writing to the destination device */
+    BaseType_t core_id;             /**< Select core on which the writing task will run or tskNO_AFFINITY */
+} msc_host_copy_config_t;
+
+/**
+ * @brief Copy sectors from one mass storage device to another.
+ *
+ * The calling task reads chunks from the source while a temporary task writes the previous chunk to the destination,
+ * so both devices transfer data at the same time. The chunks are read and written through DMA capable buffers,
+ * without intermediate copies, and through the sector caches of both Logical Units.
+ * Destination Logical Unit is synchronized after the last chunk.
+ *
+ * @note File systems mounted on the destination range must be unmounted, as their cached data are not updated
+ *
+ * @param[in] src        Source device handle
+ * @param[in] src_lun    Source Logical Unit Number
+ * @param[in] src_sector First sector to read
+ * @param[in] dst        Destination device handle, can be the same as src
+ * @param[in] dst_lun    Destination Logical Unit Number
+ * @param[in] dst_sector First sector to write
+ * @param[in] count      Number of sectors to copy
+ * @param[in] config     Copy configuration, NULL for default chunk size and writing task with the priority of the caller
+ * @return esp_err_t
+ *    - ESP_OK: All sectors copied
+ *    - ESP_ERR_INVALID_ARG: Invalid argument, sector range out of the medium, Logical Units with different sector sizes,
+ *                           or destination range overlapping the end of source range on the same Logical Unit
+ *    - ESP_ERR_NO_MEM: Not enough memory for the buffers or the writing task
+ *    - Other: Error code of failed read or write, the destination range is partially written
+ */
+esp_err_t msc_host_copy_sectors(msc_host_device_handle_t src, uint8_t src_lun, uint32_t src_sector,
+                                msc_host_device_handle_t dst, uint8_t dst_lun, uint32_t dst_sector,
+                                uint32_t count, const msc_host_copy_config_t *config);
+
 /**
  * @brief Handle MSC HOST events.
  *
@@ -163,9 +358,44 @@ esp_err_t msc_host_handle_events(uint32_t timeout);
  */
 esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_device_info_t *info);
 
+/**
+ * @brief Gets command statistics of the device.
+ *
+ * @param[in]  device  Handle to device
+ * @param[out] stats   Structure to be populated with statistics
+ * @return
+ *     - ESP_OK:                Statistics copied
+ *     - ESP_ERR_NOT_SUPPORTED: CONFIG_MSC_HOST_STATS is disabled
+ */
+esp_err_t msc_host_get_stats(msc_host_device_handle_t device, msc_host_stats_t *stats);
+
+/**
+ * @brief Clears command statistics of the device.
+ *
+ * @param[in]  device  Handle to device
+ * @return
+ *     - ESP_OK:                Statistics cleared
+ *     - ESP_ERR_NOT_SUPPORTED: CONFIG_MSC_HOST_STATS is disabled
+ */
+esp_err_t msc_host_clear_stats(msc_host_device_handle_t device);
+
+/**
+ * @brief Removes stored geometry of all known devices.
+ *
+ * With CONFIG_MSC_HOST_DEVICE_CACHE, geometry of devices with serial number is stored in NVS and
+ * msc_host_install_device() skips probing of known devices. NVS must be initialized by the application.
+ *
+ * @return
+ *     - ESP_OK:                All entries removed
+ *     - ESP_ERR_NOT_SUPPORTED: CONFIG_MSC_HOST_DEVICE_CACHE is disabled
+ */
+esp_err_t msc_host_clear_device_cache(void);
+
 /**
  * @brief Print configuration descriptor.
  *
+ * @note Nothing is printed if CONFIG_MSC_HOST_MINIMAL is enabled
+ *
  * @param[in]  device  Handle of MSC device
  * @return esp_err_t
  */
@@ -30,6 +30,30 @@ typedef struct msc_host_vfs *msc_host_vfs_handle_t;           /**< VFS handle to
  */
 esp_err_t msc_host_vfs_format(msc_host_device_handle_t device, const esp_vfs_fat_mount_config_t *mount_config, const msc_host_vfs_handle_t vfs_handle);
 
+/**
+ * @brief Configuration of alignment-optimal formatting
+ */
+typedef struct {
+    size_t allocation_unit_size;        /**< Cluster size in bytes, 0 to derive it from the alignment */
+    bool exfat;                         /**< Format media over 32 GB as exFAT. Requires FATFS built with FF_FS_EXFAT, FAT32 is used otherwise */
+} msc_host_vfs_format_config_t;
+
+/**
+ * @brief Format MSC device with data area and clusters aligned to erase blocks of the device
+ *
+ * The alignment is the optimal granularity from Block Limits VPD page. Devices that do not report it are assumed
+ * to have 4 MB allocation units, as common flash media do. Clusters divide the alignment, so writing a cluster
+ * never touches two erase blocks of the device.
+ *
+ * @param[in] vfs_handle Handle to MSC device associated with registered VFS
+ * @param[in] config     Format configuration
+ * @return esp_err_t
+ *    - ESP_OK: Format completed
+ *    - ESP_ERR_INVALID_ARG: All arguments must be present and couldn't be NULL
+ *    - ESP_ERR_MSC_FORMAT_FAILED: Formatting failed
+ */
+esp_err_t msc_host_vfs_format_aligned(msc_host_vfs_handle_t vfs_handle, const msc_host_vfs_format_config_t *config);
+
 /**
  * @brief Register MSC device to Virtual filesystem.
  *
@@ -45,6 +69,28 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
                                 msc_host_vfs_handle_t *vfs_handle);
 
 
+/**
+ * @brief Register one Logical Unit of MSC device to Virtual filesystem.
+ *
+ * Devices with several Logical Units, such as multi-slot card readers, expose each unit as separate disk.
+ * msc_host_vfs_register() registers LUN 0.
+ *
+ * @param[in]  device  Device handle obtained from MSC callback provided upon initialization
+ * @param[in]  lun     Logical Unit Number, less than lun_count obtained from msc_host_get_device_info()
+ * @param[in]  base_path Base VFS path to be used to access file storage
+ * @param[in]  mount_config Mount configuration.
+ * @param[out] vfs_handle Handle to MSC device associated with registered VFS
+ * @return esp_err_t
+ *    - ESP_OK: Logical Unit registered
+ *    - ESP_ERR_INVALID_ARG: Invalid argument or the Logical Unit does not exist
+ *    - ESP_ERR_NOT_FOUND: There is no medium in the Logical Unit
+ */
+esp_err_t msc_host_vfs_register_lun(msc_host_device_handle_t device,
+                                    uint8_t lun,
+                                    const char *base_path,
+                                    const esp_vfs_fat_mount_config_t *mount_config,
+                                    msc_host_vfs_handle_t *vfs_handle);
+
 /**
  * @brief Unregister MSC device from Virtual filesystem.
  *
@@ -53,6 +99,64 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
  */
 esp_err_t msc_host_vfs_unregister(msc_host_vfs_handle_t vfs_handle);
 
+typedef struct msc_host_vfs_stream *msc_host_vfs_stream_handle_t; /**< Handle to raw stream into a preallocated file */
+
+/**
+ * @brief Create a file for raw sequential writing
+ *
+ * A contiguous extent of max_size bytes is allocated to the file by FATFS once. Data passed to
+ * msc_host_vfs_stream_write() are then written straight to sectors of the extent by large WRITE10 commands,
+ * without FAT table and directory updates. The file gets its real size on msc_host_vfs_stream_close(),
+ * so it is a normal FAT file afterwards.
+ *
+ * Requires FATFS built with FF_USE_EXPAND. The file must not be accessed through VFS until the stream is closed.
+ *
+ * @param[in]  vfs_handle    Handle obtained from msc_host_vfs_register()
+ * @param[in]  path          Path of the file within the registered base path, e.g. "/usb/capture.bin". Existing file is overwritten
+ * @param[in]  max_size      Size of the extent in bytes, maximum number of bytes that can be written to the stream
+ * @param[out] stream_handle Stream handle
+ * @return esp_err_t
+ *    - ESP_OK: Stream created
+ *    - ESP_ERR_INVALID_ARG: Invalid argument or path is not within the base path
+ *    - ESP_ERR_INVALID_SIZE: max_size is 0 or there is no contiguous free space of max_size bytes
+ *    - ESP_ERR_NOT_SUPPORTED: FATFS is built without FF_USE_EXPAND
+ *    - ESP_ERR_NO_MEM: Not enough memory
+ *    - ESP_FAIL: File could not be created
+ */
+esp_err_t msc_host_vfs_stream_open(msc_host_vfs_handle_t vfs_handle, const char *path, size_t max_size, msc_host_vfs_stream_handle_t *stream_handle);
+
+/**
+ * @brief Append data to the stream
+ *
+ * Whole sectors are written directly from the data buffer, without copying if the buffer is aligned to
+ * buffer_alignment obtained from msc_host_get_device_info(). Partial sector is kept until the next call.
+ *
+ * @param[in] stream_handle Stream handle
+ * @param[in] data          Data to be written
+ * @param[in] size          Size of data in bytes
+ * @return esp_err_t
+ *    - ESP_OK: Data written
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_SIZE: Data do not fit into the remaining space of the extent
+ *    - Error of the SCSI command. The stream should be closed then
+ */
+esp_err_t msc_host_vfs_stream_write(msc_host_vfs_stream_handle_t stream_handle, const void *data, size_t size);
+
+/**
+ * @brief Close the stream
+ *
+ * The partial sector is written, file size is set to the number of written bytes and the rest of the extent
+ * is returned to the free space. Written data are synchronized to the device.
+ *
+ * @param[in] stream_handle Stream handle
+ * @return esp_err_t
+ *    - ESP_OK: File closed
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_FAIL: File size could not be set
+ *    - Error of the SCSI command
+ */
+esp_err_t msc_host_vfs_stream_close(msc_host_vfs_stream_handle_t stream_handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,16 +6,29 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
  * @brief Mass storage disk initialization structure
+ *
+ * One disk is created for every Logical Unit of the device
  */
 typedef struct {
-    uint32_t block_size;    /**< Block size */
-    uint32_t block_count;   /**< Block count */
+    uint32_t block_size;                /**< Block size */
+    uint64_t block_count;               /**< Block count, 0 if there is no medium in the Logical Unit */
+    uint8_t lun;                        /**< Logical Unit Number */
+    struct msc_host_device *device;     /**< Device the Logical Unit belongs to */
+    struct msc_cache *cache;            /**< Sector cache, NULL if disabled */
+    bool sync_cache_unsupported;        /**< Logical Unit rejected SYNCHRONIZE CACHE, do not send it again */
+    uint32_t unmap_max_sectors;         /**< Maximum number of sectors unmapped by one UNMAP command, 0 if UNMAP is not supported */
+    uint32_t erase_block_size;          /**< Optimal unmap or transfer granularity in sectors, 1 if unknown */
+    uint32_t max_transfer_sectors;      /**< Maximum number of sectors in one READ/WRITE command, 0 if not limited */
+    uint32_t format_alignment;          /**< Data area alignment in sectors reported to f_mkfs, 0 to report erase_block_size */
 } usb_disk_t;
 
 /**
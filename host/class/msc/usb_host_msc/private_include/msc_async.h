@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "usb/msc_host.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct msc_async msc_async_t;
+
+/**
+ * @brief Asynchronous I/O worker configuration
+ */
+typedef struct {
+    size_t queue_size;          /**< Number of requests that can wait in the queue */
+    size_t task_priority;       /**< Priority of the worker task */
+    size_t stack_size;          /**< Stack size of the worker task */
+    BaseType_t core_id;         /**< Core affinity of the worker task */
+    size_t reorder_window;      /**< Number of requests the scheduler sorts by LUN, direction and sector, 0 or 1 executes requests in order of submission */
+    size_t merge_buffer_size;   /**< Size of the buffer gathering merged requests with non-adjacent data buffers, 0 merges only adjacent buffers */
+} msc_async_config_t;
+
+/**
+ * @brief Asynchronous sector read or write request
+ */
+typedef struct {
+    uint8_t lun;
+    bool write;
+    uint32_t sector;
+    uint32_t count;
+    void *data;
+    msc_host_io_done_cb_t callback;
+    void *arg;
+} msc_async_request_t;
+
+/**
+ * @brief Create request queue and the worker task executing requests of one device
+ *
+ * Every device has its own worker, so requests to different devices are executed in parallel.
+ *
+ * @param[in]  config    Worker configuration
+ * @param[in]  device    Device the requests are executed on
+ * @param[out] async_ret Created worker
+ * @return esp_err_t
+ */
+esp_err_t msc_async_create(const msc_async_config_t *config, msc_host_device_handle_t device, msc_async_t **async_ret);
+
+/**
+ * @brief Finish all queued requests, stop the worker task and delete the request queue
+ *
+ * @param[in] async Worker to delete, can be NULL
+ */
+void msc_async_delete(msc_async_t *async);
+
+/**
+ * @brief Queue a request without blocking
+ *
+ * @param[in] async   Worker
+ * @param[in] request Request, copied into the queue
+ * @return esp_err_t
+ *    - ESP_OK: Request queued, its callback will be called
+ *    - ESP_ERR_NO_MEM: Request queue is full
+ */
+esp_err_t msc_async_submit(msc_async_t *async, const msc_async_request_t *request);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "diskio_usb.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct msc_cache msc_cache_t;
+
+/**
+ * @brief Sector cache configuration
+ */
+typedef struct {
+    size_t size;            /**< Number of cached sectors */
+    size_t read_ahead;      /**< Number of sectors read ahead on sequential cache miss */
+    bool write_back;        /**< Keep written sectors in cache until eviction or sync */
+    uint32_t heap_caps;     /**< Heap caps of cache memory */
+    uint32_t flush_timeout_ms; /**< Dirty sectors are written at latest after this timeout, 0 to write only on sync or when the cache is full */
+} msc_cache_config_t;
+
+/**
+ * @brief Create sector cache
+ *
+ * @param[in]  disk      Disk with known block size and count
+ * @param[in]  config    Cache configuration
+ * @param[out] cache_ret Created cache
+ * @return esp_err_t
+ */
+esp_err_t msc_cache_create(usb_disk_t *disk, const msc_cache_config_t *config, msc_cache_t **cache_ret);
+
+/**
+ * @brief Delete sector cache
+ *
+ * @note Dirty sectors are discarded, call msc_cache_sync() before deleting the cache
+ *
+ * @param[in] cache Cache to delete
+ */
+void msc_cache_delete(msc_cache_t *cache);
+
+/**
+ * @brief Read sectors through disk's cache
+ *
+ * If the disk has no cache, the sectors are read directly from the device.
+ *
+ * @param[in]  disk   Disk (Logical Unit)
+ * @param[out] data   Buffer for read data
+ * @param[in]  sector First sector to read
+ * @param[in]  count  Number of sectors
+ * @return esp_err_t
+ */
+esp_err_t msc_cache_read(usb_disk_t *disk, uint8_t *data, uint32_t sector, uint32_t count);
+
+/**
+ * @brief Write sectors through disk's cache
+ *
+ * If the disk has no cache, the sectors are written directly to the device.
+ *
+ * @param[in] disk   Disk (Logical Unit)
+ * @param[in] data   Data to write
+ * @param[in] sector First sector to write
+ * @param[in] count  Number of sectors
+ * @return esp_err_t
+ */
+esp_err_t msc_cache_write(usb_disk_t *disk, const uint8_t *data, uint32_t sector, uint32_t count);
+
+/**
+ * @brief Write all dirty sectors of disk's cache to the device
+ *
+ * Dirty sectors are followed by SYNCHRONIZE CACHE command, if the device supports it.
+ *
+ * @param[in] disk Disk (Logical Unit)
+ * @return esp_err_t
+ */
+esp_err_t msc_cache_sync(usb_disk_t *disk);
+
+/**
+ * @brief Discard sectors from disk's cache and unmap them on the device
+ *
+ * Cached copies of the sectors, including dirty ones, are dropped.
+ * The sectors are then released by UNMAP commands, if the device supports them.
+ *
+ * @param[in] disk   Disk (Logical Unit)
+ * @param[in] sector First sector to discard
+ * @param[in] count  Number of sectors
+ * @return esp_err_t
+ *    - ESP_OK: Sectors were unmapped
+ *    - ESP_ERR_NOT_SUPPORTED: The device does not support UNMAP, only cached copies were discarded
+ */
+esp_err_t msc_cache_trim(usb_disk_t *disk, uint32_t sector, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,10 +10,17 @@
 #include <sys/queue.h>
 #include "esp_err.h"
 #include "esp_check.h"
+#include "sdkconfig.h"
 #include "diskio_usb.h"
+#include "msc_cache.h"
+#include "usb/msc_host.h"
 #include "usb/usb_host.h"
 #include "usb/usb_types_stack.h"
+#include "usb/usb_class_stats.h"
 #include "freertos/semphr.h"
+#ifdef CONFIG_MSC_HOST_STATS
+#include "esp_timer.h"
+#endif
 
 #ifdef __cplusplus
 extern "C"
@@ -21,26 +28,110 @@ extern "C"
 #endif
 
 typedef enum {
-    MSC_EP_OUT,
-    MSC_EP_IN
+    MSC_EP_OUT,                 // BOT: bulk OUT, UAS: data-out pipe
+    MSC_EP_IN,                  // BOT: bulk IN, UAS: data-in pipe
+    MSC_EP_UAS_COMMAND,         // UAS: command pipe
+    MSC_EP_UAS_STATUS,          // UAS: status pipe
 } msc_endpoint_t;
 
+typedef enum {
+    MSC_TRANSPORT_BOT,          // Bulk-Only Transport
+    MSC_TRANSPORT_UAS,          // USB Attached SCSI
+} msc_transport_t;
+
 typedef struct {
     uint16_t bulk_in_mps;
     uint8_t bulk_in_ep;
     uint8_t bulk_out_ep;
     uint8_t iface_num;
+    uint8_t alt_setting;
+    msc_transport_t transport;
+    uint8_t uas_command_ep;
+    uint8_t uas_status_ep;
 } msc_config_t;
 
+typedef struct {
+    uint8_t *status_buffer;     // Buffer for IUs received on status pipe, bulk_in_mps long
+    uint16_t tag;               // Tag of the last command IU
+    bool sense_valid;           // Sense data of the last failed command are valid
+    uint8_t sense_key;
+    uint8_t sense_code;
+    uint8_t sense_code_q;
+} msc_uas_t;
+
+typedef struct {
+    uint32_t min_ms;            // Lower bound of adaptive timeout, 0 if adaptive timeout is disabled
+    uint32_t max_ms;            // Upper bound of transfer timeout
+    uint8_t retries;            // Number of retries of a command failed by transport error
+    uint32_t backoff_ms;        // Delay before the first retry, doubled before each further retry
+    int64_t srtt_us;            // Smoothed duration of transfer of up to MSC_TIMEOUT_REF_SIZE bytes, 0 if not measured yet
+    int64_t rttvar_us;          // Mean deviation of the duration
+    bool recovering;            // Reset recovery in progress, its commands are not retried
+} msc_timeout_t;
+
+typedef struct {
+    usb_transfer_t *xfer;       // Transfer used for one chunk of pipelined data phase
+    uint8_t *bounce_buffer;     // Buffer allocated with the transfer, used if caller's buffer cannot be used directly
+    size_t bounce_buffer_size;
+} msc_pipeline_entry_t;
+
+typedef struct {
+    msc_pipeline_entry_t *entries;
+    size_t depth;               // Number of transfers that can be in flight. Pipelining is disabled if less than 2
+    size_t chunk_size;          // Maximum size of data transferred by one transfer
+    SemaphoreHandle_t done;     // Counting semaphore given by every finished pipelined transfer
+} msc_pipeline_t;
+
 typedef struct msc_host_device {
     STAILQ_ENTRY(msc_host_device) tailq_entry;
     SemaphoreHandle_t transfer_done;
+    SemaphoreHandle_t cmd_mutex;    // Held for the whole CBW/data/CSW sequence of one command
     usb_device_handle_t handle;
     usb_transfer_t *xfer;
+    msc_pipeline_t pipeline;
     msc_config_t config;
-    usb_disk_t disk;
+    msc_timeout_t timeout;          // Transfer timeouts and retry policy, protected by cmd_mutex
+    msc_uas_t uas;                  // UAS transport state, used only if config.transport is MSC_TRANSPORT_UAS
+    uint8_t lun_count;
+    usb_disk_t *disks;              // One disk for each Logical Unit
+    uint32_t cbw_tag;               // Tag of the last CBW, protected by cmd_mutex
+    struct msc_async *async;        // Asynchronous I/O worker of this device, NULL if disabled
+    usb_class_stats_entry_t *class_stats; // Entry in usb_class_stats registry, NULL if not counted
+    msc_host_quirk_t quirk;         // Workarounds matched by VID and PID, zeroed if the device has none
+#ifdef CONFIG_MSC_HOST_STATS
+    msc_host_stats_t stats;         // Protected by cmd_mutex
+#endif
 } msc_device_t;
 
+#ifdef CONFIG_MSC_HOST_STATS
+/**
+ * @brief Account one finished command in device statistics
+ *
+ * @param[in] device     MSC device
+ * @param[in] latency_us Duration of the command
+ * @param[in] data_in    Direction of the data phase
+ * @param[in] size       Size of data phase in bytes
+ * @param[in] result     Result of the command
+ */
+void msc_stats_command_done(msc_device_t *device, int64_t latency_us, bool data_in, size_t size, esp_err_t result);
+
+#define MSC_STATS_ADD(dev, field, n) ((dev)->stats.field += (n))
+#define MSC_STATS_TIMESTAMP(name) int64_t name = esp_timer_get_time()
+// Accumulates time elapsed since 'start' into 'field' and restarts the measurement
+#define MSC_STATS_PHASE_END(dev, field, start) ({        \
+    const int64_t _now = esp_timer_get_time();         \
+    (dev)->stats.field += _now - (start);              \
+    (start) = _now;                                    \
+})
+#define MSC_STATS_COMMAND_DONE(dev, start, data_in, size, result) \
+    msc_stats_command_done((dev), esp_timer_get_time() - (start), (data_in), (size), (result))
+#else
+#define MSC_STATS_ADD(dev, field, n)
+#define MSC_STATS_TIMESTAMP(name)
+#define MSC_STATS_PHASE_END(dev, field, start)
+#define MSC_STATS_COMMAND_DONE(dev, start, data_in, size, result)
+#endif
+
 /**
  * @brief Trigger a BULK transfer to device
  *
@@ -54,6 +145,75 @@ typedef struct msc_host_device {
  */
 esp_err_t msc_bulk_transfer(msc_device_t *device_handle, uint8_t *data, size_t size, msc_endpoint_t ep);
 
+/**
+ * @brief Make sure the transfer used for non-pipelined bulk transfers has a buffer of at least 'size' bytes
+ *
+ * Pre-sizing the transfer avoids its reallocation on the first large access.
+ *
+ * @param[in] device MSC device handle
+ * @param[in] size   Required buffer size in bytes
+ * @return esp_err_t
+ */
+esp_err_t msc_transfer_reserve(msc_device_t *device, size_t size);
+
+/**
+ * @brief Get allocation unit size matching erase block of the disk
+ *
+ * @param[in] disk Disk (Logical Unit)
+ * @return Allocation unit size in bytes, 0 if the disk does not report erase block size
+ */
+size_t msc_recommended_allocation_unit(const usb_disk_t *disk);
+
+/**
+ * @brief Get alignment of the data area for formatting the disk
+ *
+ * Erase block size reported by the disk is used if f_mkfs accepts it. Otherwise flash media are assumed
+ * to have 4 MB allocation units, reduced for small disks.
+ *
+ * @param[in] disk Disk (Logical Unit)
+ * @return Alignment in sectors, power of two between 1 and 32768
+ */
+uint32_t msc_format_alignment(const usb_disk_t *disk);
+
+/**
+ * @brief Get size of the largest non-pipelined bulk transfer
+ *
+ * @param[in] device MSC device handle
+ * @return Chunk size if pipelining is enabled, SIZE_MAX otherwise
+ */
+size_t msc_max_bulk_transfer_size(const msc_device_t *device);
+
+/**
+ * @brief Trigger a pipelined BULK transfer to device
+ *
+ * Data are split into chunks and several chunks are kept in flight, so the endpoint is never idle.
+ * Falls back to msc_bulk_transfer() if pipelining is disabled or the data fit into one chunk.
+ *
+ * @param[in]    device_handle MSC device handle
+ * @param[inout] data          Data buffer. Direction depends on 'ep'.
+ * @param[in]    size          Size of buffer in bytes
+ * @param[in]    ep            Direction of the transfer
+ * @return esp_err_t
+ */
+esp_err_t msc_bulk_transfer_pipelined(msc_device_t *device_handle, uint8_t *data, size_t size, msc_endpoint_t ep);
+
+/**
+ * @brief Execute SCSI command with USB Attached SCSI transport
+ *
+ * @param[in]    device  MSC device handle
+ * @param[in]    lun     Logical Unit Number
+ * @param[in]    cdb     Command Descriptor Block
+ * @param[in]    cdb_len Length of the CDB, at most 16 bytes
+ * @param[in]    data_in Direction of the data phase
+ * @param[inout] data    Data (optional)
+ * @param[in]    size    Size of data in bytes
+ * @return esp_err_t
+ *    - ESP_OK: Command succeeded
+ *    - ESP_FAIL: Command failed, sense data are stored for the following REQUEST SENSE
+ */
+esp_err_t uas_execute_command(msc_device_t *device, uint8_t lun, const uint8_t *cdb, size_t cdb_len,
+                              bool data_in, void *data, size_t size);
+
 /**
  * @brief Trigger a CTRL transfer to device
  *
@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "msc_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Geometry of known devices, stored in NVS
+ *
+ * Entries are keyed by VID, PID and serial number, devices without serial number are not cached.
+ * Only the results of the probing commands are stored, the descriptors are always read from the device.
+ */
+
+/**
+ * @brief Fill geometry of all Logical Units of the device from its stored entry
+ *
+ * @param[in] device MSC device, with lun_count and allocated disks
+ * @return esp_err_t
+ *    - ESP_OK: All disks filled
+ *    - ESP_ERR_NOT_FOUND: Device is not known or it has different number of Logical Units
+ */
+esp_err_t msc_device_cache_load(msc_device_t *device);
+
+/**
+ * @brief Store geometry of all Logical Units of the device
+ *
+ * @param[in] device MSC device with probed disks
+ * @return esp_err_t
+ */
+esp_err_t msc_device_cache_store(const msc_device_t *device);
+
+/**
+ * @brief Remove stored entry of the device
+ *
+ * @param[in] device MSC device
+ * @return esp_err_t
+ */
+esp_err_t msc_device_cache_remove(const msc_device_t *device);
+
+/**
+ * @brief Remove all stored entries
+ *
+ * @return esp_err_t
+ */
+esp_err_t msc_device_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
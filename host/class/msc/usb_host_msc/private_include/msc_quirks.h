@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb/msc_host.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Find quirks of a device
+ *
+ * Application entries are matched first, then the built-in table of devices known to misbehave.
+ * Exact product match takes precedence over MSC_HOST_QUIRK_ANY_PRODUCT within each table.
+ *
+ * @param[in]  vid       Vendor ID of the device
+ * @param[in]  pid       Product ID of the device
+ * @param[in]  app       Application table, can be NULL
+ * @param[in]  app_count Number of entries in app
+ * @param[out] quirk     Matched entry, zeroed if the device has no quirks
+ * @return true if the device has quirks
+ */
+bool msc_quirks_find(uint16_t vid, uint16_t pid, const msc_host_quirk_t *app, size_t app_count, msc_host_quirk_t *quirk);
+
+#ifdef __cplusplus
+}
+#endif
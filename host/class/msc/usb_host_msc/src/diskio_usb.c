@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <sys/param.h>
 #include "diskio_impl.h"
 #include "ffconf.h"
 #include "ff.h"
@@ -33,12 +34,10 @@ static DRESULT usb_disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
     assert(s_disks[pdrv]);
 
     usb_disk_t *disk = s_disks[pdrv];
-    size_t sector_size = disk->block_size;
-    msc_device_t *dev = __containerof(disk, msc_device_t, disk);
 
-    esp_err_t err = scsi_cmd_read10(dev, buff, sector, count, sector_size);
+    esp_err_t err = msc_cache_read(disk, buff, sector, count);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "scsi_cmd_read10 failed (%d)", err);
+        ESP_LOGE(TAG, "usb_disk_read failed (%d)", err);
         return RES_ERROR;
     }
 
@@ -51,12 +50,10 @@ static DRESULT usb_disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT c
     assert(s_disks[pdrv]);
 
     usb_disk_t *disk = s_disks[pdrv];
-    size_t sector_size = disk->block_size;
-    msc_device_t *dev = __containerof(disk, msc_device_t, disk);
 
-    esp_err_t err = scsi_cmd_write10(dev, buff, sector, count, sector_size);
+    esp_err_t err = msc_cache_write(disk, buff, sector, count);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "scsi_cmd_write10 failed (%d)", err);
+        ESP_LOGE(TAG, "usb_disk_write failed (%d)", err);
         return RES_ERROR;
     }
     return RES_OK;
@@ -71,15 +68,36 @@ static DRESULT usb_disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
 
     switch (cmd) {
     case CTRL_SYNC:
+        if (msc_cache_sync(disk) != ESP_OK) {
+            ESP_LOGE(TAG, "Cache sync failed");
+            return RES_ERROR;
+        }
         return RES_OK;
     case GET_SECTOR_COUNT:
-        *((DWORD *) buff) = disk->block_count;
+        *((DWORD *) buff) = MIN(disk->block_count, UINT32_MAX);
         return RES_OK;
     case GET_SECTOR_SIZE:
         *((WORD *) buff) = disk->block_size;
         return RES_OK;
     case GET_BLOCK_SIZE:
-        return RES_ERROR;
+        *((DWORD *) buff) = disk->format_alignment ? disk->format_alignment : disk->erase_block_size;
+        return RES_OK;
+#if FF_USE_TRIM
+    case CTRL_TRIM: {
+        const LBA_t *range = (const LBA_t *)buff; // Start and end sector, inclusive
+        if (range[1] < range[0] || range[1] >= disk->block_count) {
+            return RES_PARERR;
+        }
+        esp_err_t err = msc_cache_trim(disk, range[0], range[1] - range[0] + 1);
+        if (err != ESP_OK) {
+            if (err != ESP_ERR_NOT_SUPPORTED) {
+                ESP_LOGE(TAG, "usb_disk_trim failed (%d)", err);
+            }
+            return RES_ERROR;
+        }
+        return RES_OK;
+    }
+#endif
     }
     return RES_ERROR;
 }
@@ -0,0 +1,308 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "usb/usb_dma_buf.h"
+#include "msc_common.h"
+#include "msc_async.h"
+#include "msc_cache.h"
+
+static const char *TAG = "USB_MSC_ASYNC";
+
+typedef struct {
+    msc_async_request_t request;
+    size_t bypassed;            // Number of younger requests executed before this one
+    bool picked;                // Request is part of the command being built
+} pending_request_t;
+
+struct msc_async {
+    msc_device_t *device;
+    QueueHandle_t queue;
+    SemaphoreHandle_t stopped;  // Given by the worker task before it deletes itself
+    // Elevator scheduler, used if window > 1
+    size_t window;              // Maximum number of pending requests
+    pending_request_t *pending; // Requests taken from the queue, in order of submission
+    size_t pending_count;
+    uint8_t *merge_buf;         // Merged requests with separate buffers are gathered here, NULL if not configured
+    size_t merge_buf_size;
+    uint8_t head_lun;           // Position of the scheduler: LUN, direction and sector following the last executed request
+    bool head_write;
+    uint32_t head_sector;
+};
+
+static inline bool requests_overlap(const msc_async_request_t *a, const msc_async_request_t *b)
+{
+    return a->lun == b->lun && a->sector < b->sector + b->count && b->sector < a->sector + a->count;
+}
+
+/**
+ * @brief Check whether a pending request can be executed now
+ *
+ * A request must not overtake an older one accessing the same sectors, unless both are reads.
+ */
+static bool sched_is_ready(const msc_async_t *async, size_t idx)
+{
+    const msc_async_request_t *request = &async->pending[idx].request;
+    for (size_t i = 0; i < idx; i++) {
+        const msc_async_request_t *older = &async->pending[i].request;
+        if (!async->pending[i].picked && (request->write || older->write) && requests_overlap(request, older)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Choose the next request to execute
+ *
+ * C-LOOK elevator: the request of the current LUN and direction with the lowest sector after the head goes first,
+ * then any request of the LUN after the head, then the lowest sector overall.
+ * The oldest request is chosen once it was overtaken window times, which bounds the reordering.
+ */
+static size_t sched_pick_first(const msc_async_t *async)
+{
+    if (async->pending[0].bypassed >= async->window) {
+        return 0;
+    }
+
+    size_t best[3] = {SIZE_MAX, SIZE_MAX, SIZE_MAX}; // Same direction after head, after head, any
+    for (size_t i = 0; i < async->pending_count; i++) {
+        if (!sched_is_ready(async, i)) {
+            continue;
+        }
+        const msc_async_request_t *r = &async->pending[i].request;
+        const bool after_head = r->lun == async->head_lun && r->sector >= async->head_sector;
+        const int class = (after_head && r->write == async->head_write) ? 0 : after_head ? 1 : 2;
+        for (int c = class; c < 3; c++) {
+            const msc_async_request_t *b = (best[c] == SIZE_MAX) ? NULL : &async->pending[best[c]].request;
+            if (b == NULL || r->lun < b->lun || (r->lun == b->lun && r->sector < b->sector)) {
+                best[c] = i;
+            }
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        if (best[c] != SIZE_MAX) {
+            return best[c];
+        }
+    }
+    return 0; // Not reached, the oldest request is always ready
+}
+
+/**
+ * @brief Find a request continuing the command being built
+ *
+ * @return Index of the request, SIZE_MAX if there is none
+ */
+static size_t sched_pick_next(const msc_async_t *async, const msc_async_request_t *last, uint8_t *cmd_end, size_t cmd_bytes)
+{
+    const uint32_t block_size = async->device->disks[last->lun].block_size;
+    for (size_t i = 0; i < async->pending_count; i++) {
+        const pending_request_t *p = &async->pending[i];
+        if (p->picked || p->request.lun != last->lun || p->request.write != last->write ||
+                p->request.sector != last->sector + last->count) {
+            continue;
+        }
+        // Adjacent buffers are transferred at once, others must fit into the merge buffer
+        const bool adjacent = cmd_end && (uint8_t *)p->request.data == cmd_end;
+        if ((adjacent || cmd_bytes + p->request.count * block_size <= async->merge_buf_size) && sched_is_ready(async, i)) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/**
+ * @brief Execute one command made of one or more pending requests
+ */
+static void sched_execute(msc_async_t *async)
+{
+    pending_request_t *pending = async->pending;
+    const size_t first = sched_pick_first(async);
+    pending[first].picked = true;
+
+    const msc_async_request_t *last = &pending[first].request;
+    usb_disk_t *disk = &async->device->disks[last->lun];
+    size_t cmd_bytes = last->count * disk->block_size;
+    uint8_t *cmd_end = (uint8_t *)last->data + cmd_bytes; // NULL once the buffers are not adjacent
+    uint32_t cmd_count = last->count;
+    size_t next;
+    while ((next = sched_pick_next(async, last, cmd_end, cmd_bytes)) != SIZE_MAX) {
+        pending[next].picked = true;
+        last = &pending[next].request;
+        cmd_end = (cmd_end == last->data) ? cmd_end + last->count * disk->block_size : NULL;
+        cmd_bytes += last->count * disk->block_size;
+        cmd_count += last->count;
+    }
+
+    // Requests of the command follow the first one in order of sectors.
+    // Copy of the first one, as the pending list is compacted before the callbacks are called
+    const msc_async_request_t first_request = pending[first].request;
+    const bool write = first_request.write;
+    uint8_t *buf = cmd_end ? (uint8_t *)first_request.data : async->merge_buf;
+    if (cmd_end == NULL && write) {
+        for (size_t i = 0; i < async->pending_count; i++) {
+            if (pending[i].picked) {
+                memcpy(buf + (pending[i].request.sector - first_request.sector) * disk->block_size,
+                       pending[i].request.data, pending[i].request.count * disk->block_size);
+            }
+        }
+    }
+    if (cmd_count > first_request.count) {
+        ESP_LOGD(TAG, "Merged %s of %" PRIu32 " sectors at %" PRIu32, write ? "write" : "read", cmd_count, first_request.sector);
+    }
+    const esp_err_t ret = write ?
+                          msc_cache_write(disk, buf, first_request.sector, cmd_count) :
+                          msc_cache_read(disk, buf, first_request.sector, cmd_count);
+    async->head_lun = first_request.lun;
+    async->head_write = write;
+    async->head_sector = first_request.sector + cmd_count;
+
+    // Complete the requests in order of submission and remove them from the pending list
+    size_t last_picked = 0;
+    for (size_t i = 0; i < async->pending_count; i++) {
+        if (pending[i].picked) {
+            last_picked = i;
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < async->pending_count; i++) {
+        if (!pending[i].picked) {
+            if (i < last_picked) {
+                pending[i].bypassed++;
+            }
+            pending[kept++] = pending[i];
+            continue;
+        }
+        const msc_async_request_t *r = &pending[i].request;
+        if (cmd_end == NULL && !write && ret == ESP_OK) {
+            memcpy(r->data, buf + (r->sector - first_request.sector) * disk->block_size, r->count * disk->block_size);
+        }
+        r->callback(async->device, ret, r->arg);
+    }
+    async->pending_count = kept;
+}
+
+static void async_task(void *arg)
+{
+    msc_async_t *async = (msc_async_t *)arg;
+    msc_async_request_t request;
+    bool stopping = false;
+
+    ESP_LOGD(TAG, "USB MSC async I/O start");
+    while (!stopping || async->pending_count) {
+        if (async->window <= 1) {
+            // Requests are executed in order of submission
+            if (xQueueReceive(async->queue, &request, portMAX_DELAY) != pdTRUE || request.callback == NULL) {
+                break; // Stop request from msc_async_delete(), all requests queued before it are finished
+            }
+            usb_disk_t *disk = &async->device->disks[request.lun];
+            esp_err_t ret = request.write ?
+                            msc_cache_write(disk, request.data, request.sector, request.count) :
+                            msc_cache_read(disk, request.data, request.sector, request.count);
+            request.callback(async->device, ret, request.arg);
+            continue;
+        }
+
+        // Take all waiting requests that fit into the window, wait only if there is nothing to execute
+        while (!stopping && async->pending_count < async->window &&
+                xQueueReceive(async->queue, &request, async->pending_count ? 0 : portMAX_DELAY) == pdTRUE) {
+            if (request.callback == NULL) {
+                stopping = true; // Stop request is the last one in the queue, the pending requests are finished first
+                break;
+            }
+            async->pending[async->pending_count++] = (pending_request_t) {
+                .request = request,
+            };
+        }
+        if (async->pending_count) {
+            sched_execute(async);
+        }
+    }
+    ESP_LOGD(TAG, "USB MSC async I/O stop");
+    xSemaphoreGive(async->stopped);
+    vTaskDelete(NULL);
+}
+
+esp_err_t msc_async_create(const msc_async_config_t *config, msc_host_device_handle_t device, msc_async_t **async_ret)
+{
+    esp_err_t ret;
+    MSC_RETURN_ON_INVALID_ARG(config);
+    MSC_RETURN_ON_INVALID_ARG(device);
+    MSC_RETURN_ON_INVALID_ARG(async_ret);
+    MSC_RETURN_ON_FALSE(config->queue_size > 0 && config->stack_size > 0 && config->task_priority > 0, ESP_ERR_INVALID_ARG);
+
+    msc_async_t *async = calloc(1, sizeof(msc_async_t));
+    MSC_RETURN_ON_FALSE(async, ESP_ERR_NO_MEM);
+    async->device = (msc_device_t *)device;
+    async->window = config->reorder_window;
+
+    // One extra slot for the stop request, so it can always be queued
+    MSC_GOTO_ON_FALSE( async->queue = xQueueCreate(config->queue_size + 1, sizeof(msc_async_request_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( async->stopped = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+    if (async->window > 1) {
+        MSC_GOTO_ON_FALSE( async->pending = calloc(async->window, sizeof(pending_request_t)), ESP_ERR_NO_MEM );
+        if (config->merge_buffer_size) {
+            MSC_GOTO_ON_FALSE( async->merge_buf = usb_dma_buf_alloc(config->merge_buffer_size, 0), ESP_ERR_NO_MEM );
+            async->merge_buf_size = config->merge_buffer_size;
+        }
+    }
+    MSC_GOTO_ON_FALSE( xTaskCreatePinnedToCore(async_task, "USB MSC async", config->stack_size, async,
+                       config->task_priority, NULL, config->core_id) == pdPASS, ESP_ERR_NO_MEM );
+
+    // Released from the accounting with the device statistics entry, the worker is deleted together with the device
+    USB_CLASS_STATS_MEM_ALLOC(async->device->class_stats, sizeof(msc_async_t) + async->window * sizeof(pending_request_t), MALLOC_CAP_DEFAULT);
+    USB_CLASS_STATS_MEM_ALLOC(async->device->class_stats, async->merge_buf_size, MALLOC_CAP_DMA);
+    *async_ret = async;
+    return ESP_OK;
+
+fail:
+    usb_dma_buf_free(async->merge_buf);
+    free(async->pending);
+    if (async->stopped) {
+        vSemaphoreDelete(async->stopped);
+    }
+    if (async->queue) {
+        vQueueDelete(async->queue);
+    }
+    free(async);
+    return ret;
+}
+
+void msc_async_delete(msc_async_t *async)
+{
+    if (async == NULL) {
+        return;
+    }
+
+    // The queue is FIFO, so the worker finishes all pending requests before it stops
+    const msc_async_request_t stop_request = { .callback = NULL };
+    xQueueSend(async->queue, &stop_request, portMAX_DELAY);
+    xSemaphoreTake(async->stopped, portMAX_DELAY);
+
+    usb_dma_buf_free(async->merge_buf);
+    free(async->pending);
+    vSemaphoreDelete(async->stopped);
+    vQueueDelete(async->queue);
+    free(async);
+}
+
+esp_err_t msc_async_submit(msc_async_t *async, const msc_async_request_t *request)
+{
+    // Leave the last slot for the stop request
+    if (uxQueueSpacesAvailable(async->queue) <= 1 || xQueueSend(async->queue, request, 0) != pdTRUE) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
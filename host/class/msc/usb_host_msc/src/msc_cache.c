@@ -0,0 +1,446 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "usb/usb_dma_buf.h"
+#include "msc_common.h"
+#include "msc_cache.h"
+#include "msc_scsi_bot.h"
+
+static const char *TAG = "USB_MSC_CACHE";
+
+#define INVALID_SECTOR UINT32_MAX
+
+typedef struct {
+    uint32_t sector;        // Cached sector or INVALID_SECTOR
+    uint32_t last_used;     // Value of use counter at last access, used for LRU eviction
+    bool dirty;             // Sector was written, but not yet transferred to the device
+} cache_entry_t;
+
+struct msc_cache {
+    usb_disk_t *disk;
+    cache_entry_t *entries;
+    uint8_t *data;          // Data of all entries, entry 'i' has data at offset 'i * sector_size'
+    uint8_t *scratch;       // Buffer for reading missing sectors with read-ahead and for merging dirty sectors
+    size_t scratch_sectors;
+    size_t size;
+    size_t max_run;         // Longer accesses bypass the cache
+    size_t read_ahead;
+    size_t dirty_count;
+    bool write_back;
+    uint32_t flush_timeout_ms;
+    uint32_t sector_size;
+    uint32_t sector_count;
+    uint32_t use_counter;
+    SemaphoreHandle_t mutex;
+    esp_timer_handle_t flush_timer;
+};
+
+// Accesses are split into commands the Logical Unit accepts
+static esp_err_t lun_read(usb_disk_t *disk, uint8_t *data, uint32_t sector, uint32_t count)
+{
+    const uint32_t max = disk->max_transfer_sectors ? disk->max_transfer_sectors : count;
+    while (count) {
+        const uint32_t run = MIN(count, max);
+        MSC_RETURN_ON_ERROR( scsi_cmd_read(disk->device, disk->lun, data, sector, run, disk->block_size) );
+        data += run * disk->block_size;
+        sector += run;
+        count -= run;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t lun_write(usb_disk_t *disk, const uint8_t *data, uint32_t sector, uint32_t count)
+{
+    const uint32_t max = disk->max_transfer_sectors ? disk->max_transfer_sectors : count;
+    while (count) {
+        const uint32_t run = MIN(count, max);
+        MSC_RETURN_ON_ERROR( scsi_cmd_write(disk->device, disk->lun, data, sector, run, disk->block_size) );
+        data += run * disk->block_size;
+        sector += run;
+        count -= run;
+    }
+    return ESP_OK;
+}
+
+static inline uint8_t *entry_data(msc_cache_t *cache, const cache_entry_t *entry)
+{
+    return cache->data + (entry - cache->entries) * cache->sector_size;
+}
+
+static cache_entry_t *cache_find(msc_cache_t *cache, uint32_t sector)
+{
+    for (size_t i = 0; i < cache->size; i++) {
+        if (cache->entries[i].sector == sector) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static inline void cache_touch(msc_cache_t *cache, cache_entry_t *entry)
+{
+    entry->last_used = ++cache->use_counter;
+}
+
+/**
+ * @brief Write dirty entries within range to the device, so the range can be accessed directly
+ *
+ * Dirty sectors with consecutive addresses are merged in the scratch buffer and written by one WRITE10 command.
+ */
+static esp_err_t cache_flush_range(msc_cache_t *cache, uint32_t sector, uint32_t count)
+{
+    const uint32_t end = sector + count;
+
+    while (cache->dirty_count > 0) {
+        // Find the lowest dirty sector within the range
+        cache_entry_t *first = NULL;
+        for (size_t i = 0; i < cache->size; i++) {
+            cache_entry_t *entry = &cache->entries[i];
+            if (entry->dirty && entry->sector >= sector && entry->sector < end &&
+                    (first == NULL || entry->sector < first->sector)) {
+                first = entry;
+            }
+        }
+        if (first == NULL) {
+            break;
+        }
+
+        // Collect the run of following dirty sectors
+        const uint32_t run_start = first->sector;
+        uint32_t run = 0;
+        cache_entry_t *entry = first;
+        do {
+            memcpy(cache->scratch + run * cache->sector_size, entry_data(cache, entry), cache->sector_size);
+            run++;
+            entry = cache_find(cache, run_start + run);
+        } while (run < cache->scratch_sectors && run_start + run < end && entry && entry->dirty);
+
+        MSC_RETURN_ON_ERROR( lun_write(cache->disk, cache->scratch, run_start, run) );
+        for (uint32_t i = 0; i < run; i++) {
+            cache_find(cache, run_start + i)->dirty = false;
+        }
+        cache->dirty_count -= run;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Get an entry for a new sector, evicting the least recently used clean one
+ *
+ * If all entries are dirty, the whole cache is flushed first.
+ *
+ * @note Flushing uses the scratch buffer. Callers holding data in the scratch buffer
+ *       must make sure there are enough clean entries beforehand.
+ */
+static esp_err_t cache_alloc(msc_cache_t *cache, uint32_t sector, cache_entry_t **entry_ret)
+{
+    if (cache->dirty_count == cache->size) {
+        MSC_RETURN_ON_ERROR( cache_flush_range(cache, 0, cache->sector_count) );
+    }
+
+    cache_entry_t *victim = NULL;
+    for (size_t i = 0; i < cache->size; i++) {
+        cache_entry_t *entry = &cache->entries[i];
+        if (entry->sector == INVALID_SECTOR) {
+            victim = entry;
+            break;
+        }
+        if (!entry->dirty && (victim == NULL || entry->last_used < victim->last_used)) {
+            victim = entry;
+        }
+    }
+
+    assert(victim);
+    victim->sector = sector;
+    cache_touch(cache, victim);
+    *entry_ret = victim;
+    return ESP_OK;
+}
+
+/**
+ * @brief Update cached copies of sectors that were written directly to the device
+ */
+static void cache_update_range(msc_cache_t *cache, const uint8_t *data, uint32_t sector, uint32_t count)
+{
+    for (size_t i = 0; i < cache->size; i++) {
+        cache_entry_t *entry = &cache->entries[i];
+        if (entry->sector != INVALID_SECTOR && entry->sector >= sector && entry->sector < sector + count) {
+            memcpy(entry_data(cache, entry), data + (entry->sector - sector) * cache->sector_size, cache->sector_size);
+            if (entry->dirty) {
+                entry->dirty = false;
+                cache->dirty_count--;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Read a run of missing sectors together with read-ahead and insert them into the cache
+ */
+static esp_err_t cache_fill(msc_cache_t *cache, uint32_t sector, uint32_t count, bool read_ahead)
+{
+    if (read_ahead) {
+        count = MIN(count + cache->read_ahead, cache->sector_count - sector);
+    }
+
+    // Flush now if there is not enough clean entries, because flushing overwrites the scratch buffer
+    if (cache->size - cache->dirty_count < count) {
+        MSC_RETURN_ON_ERROR( cache_flush_range(cache, 0, cache->sector_count) );
+    }
+    MSC_RETURN_ON_ERROR( lun_read(cache->disk, cache->scratch, sector, count) );
+
+    for (uint32_t i = 0; i < count; i++) {
+        cache_entry_t *entry = cache_find(cache, sector + i);
+        if (entry) {
+            continue; // Read-ahead sector is already cached and might be dirty
+        }
+        MSC_RETURN_ON_ERROR( cache_alloc(cache, sector + i, &entry) );
+        memcpy(entry_data(cache, entry), cache->scratch + i * cache->sector_size, cache->sector_size);
+    }
+    return ESP_OK;
+}
+
+static void cache_flush_timer_cb(void *arg)
+{
+    msc_cache_t *cache = (msc_cache_t *)arg;
+    xSemaphoreTake(cache->mutex, portMAX_DELAY);
+    if (cache_flush_range(cache, 0, cache->sector_count) != ESP_OK) {
+        ESP_LOGW(TAG, "Delayed write of cached sectors failed");
+    }
+    xSemaphoreGive(cache->mutex);
+}
+
+esp_err_t msc_cache_create(usb_disk_t *disk, const msc_cache_config_t *config, msc_cache_t **cache_ret)
+{
+    esp_err_t ret;
+    MSC_RETURN_ON_INVALID_ARG(disk);
+    MSC_RETURN_ON_INVALID_ARG(config);
+    MSC_RETURN_ON_INVALID_ARG(cache_ret);
+    const uint32_t sector_size = disk->block_size;
+    MSC_RETURN_ON_FALSE(config->size >= 2 && sector_size > 0, ESP_ERR_INVALID_ARG);
+
+    const uint32_t caps = config->heap_caps ? config->heap_caps : MALLOC_CAP_DEFAULT;
+    msc_cache_t *cache = calloc(1, sizeof(msc_cache_t));
+    MSC_RETURN_ON_FALSE(cache, ESP_ERR_NO_MEM);
+
+    cache->disk = disk;
+    cache->size = config->size;
+    cache->max_run = config->size / 2;
+    cache->read_ahead = MIN(config->read_ahead, config->size - cache->max_run); // Whole fill must fit into the cache
+    cache->scratch_sectors = cache->max_run + cache->read_ahead;
+    cache->write_back = config->write_back;
+    cache->flush_timeout_ms = config->flush_timeout_ms;
+    cache->sector_size = sector_size;
+    cache->sector_count = MIN(disk->block_count, UINT32_MAX); // Disk I/O layer uses 32-bit sector addresses
+
+    MSC_GOTO_ON_FALSE( cache->entries = calloc(cache->size, sizeof(cache_entry_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( cache->data = heap_caps_malloc(cache->size * sector_size, caps), ESP_ERR_NO_MEM );
+    // Scratch buffer is read and written by USB DMA directly, if it is aligned
+    const size_t scratch_size = usb_dma_buf_align_up(cache->scratch_sectors * sector_size);
+    MSC_GOTO_ON_FALSE( cache->scratch = config->heap_caps ? heap_caps_aligned_alloc(USB_DMA_BUF_ALIGN, scratch_size, caps)
+                                        : usb_dma_buf_alloc(scratch_size, 0), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( cache->mutex = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM );
+    if (cache->write_back && cache->flush_timeout_ms) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = cache_flush_timer_cb,
+            .arg = cache,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "msc_cache_flush",
+        };
+        MSC_GOTO_ON_ERROR( esp_timer_create(&timer_args, &cache->flush_timer) );
+    }
+
+    for (size_t i = 0; i < cache->size; i++) {
+        cache->entries[i].sector = INVALID_SECTOR;
+    }
+
+    // Released from the accounting with the device statistics entry, the cache is deleted together with the device
+    usb_class_stats_entry_t *class_stats = disk->device->class_stats;
+    USB_CLASS_STATS_MEM_ALLOC(class_stats, sizeof(msc_cache_t) + cache->size * sizeof(cache_entry_t), MALLOC_CAP_DEFAULT);
+    USB_CLASS_STATS_MEM_ALLOC(class_stats, cache->size * sector_size, caps);
+    USB_CLASS_STATS_MEM_ALLOC(class_stats, scratch_size, config->heap_caps ? caps : MALLOC_CAP_DMA);
+
+    ESP_LOGD(TAG, "Created cache of %zu sectors, read-ahead %zu sectors, %s",
+             cache->size, cache->read_ahead, cache->write_back ? "write-back" : "write-through");
+    *cache_ret = cache;
+    return ESP_OK;
+
+fail:
+    msc_cache_delete(cache);
+    return ret;
+}
+
+void msc_cache_delete(msc_cache_t *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    if (cache->flush_timer) {
+        esp_timer_stop(cache->flush_timer);
+        // Wait for flush callback that might be running
+        xSemaphoreTake(cache->mutex, portMAX_DELAY);
+        esp_timer_delete(cache->flush_timer);
+        xSemaphoreGive(cache->mutex);
+    }
+    if (cache->mutex) {
+        vSemaphoreDelete(cache->mutex);
+    }
+    heap_caps_free(cache->scratch);
+    heap_caps_free(cache->data);
+    free(cache->entries);
+    free(cache);
+}
+
+static esp_err_t cache_read_locked(msc_cache_t *cache, uint8_t *data, uint32_t sector, uint32_t count)
+{
+    if (count > cache->max_run) {
+        // Large read: dirty sectors are written first and the rest is read directly from the device
+        MSC_RETURN_ON_ERROR( cache_flush_range(cache, sector, count) );
+        return lun_read(cache->disk, data, sector, count);
+    }
+
+    uint32_t i = 0;
+    while (i < count) {
+        cache_entry_t *entry = cache_find(cache, sector + i);
+        if (entry) {
+            memcpy(data + i * cache->sector_size, entry_data(cache, entry), cache->sector_size);
+            cache_touch(cache, entry);
+            i++;
+            continue;
+        }
+
+        // Find the run of missing sectors and read it at once
+        uint32_t missing = 1;
+        while (i + missing < count && cache_find(cache, sector + i + missing) == NULL) {
+            missing++;
+        }
+        // Read ahead only if the run reaches end of the request, which indicates sequential access
+        const bool read_ahead = (i + missing == count);
+        MSC_RETURN_ON_ERROR( cache_fill(cache, sector + i, missing, read_ahead) );
+        memcpy(data + i * cache->sector_size, cache->scratch, missing * cache->sector_size);
+        i += missing;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t cache_write_locked(msc_cache_t *cache, const uint8_t *data, uint32_t sector, uint32_t count)
+{
+    if (!cache->write_back || count > cache->max_run) {
+        MSC_RETURN_ON_ERROR( lun_write(cache->disk, data, sector, count) );
+        cache_update_range(cache, data, sector, count);
+        return ESP_OK;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        cache_entry_t *entry = cache_find(cache, sector + i);
+        if (entry == NULL) {
+            MSC_RETURN_ON_ERROR( cache_alloc(cache, sector + i, &entry) );
+        } else {
+            cache_touch(cache, entry);
+        }
+        memcpy(entry_data(cache, entry), data + i * cache->sector_size, cache->sector_size);
+        if (!entry->dirty) {
+            entry->dirty = true;
+            cache->dirty_count++;
+        }
+    }
+
+    // Start delayed write of the oldest dirty sectors
+    if (cache->flush_timer && !esp_timer_is_active(cache->flush_timer)) {
+        esp_timer_start_once(cache->flush_timer, (uint64_t)cache->flush_timeout_ms * 1000);
+    }
+    return ESP_OK;
+}
+
+esp_err_t msc_cache_read(usb_disk_t *disk, uint8_t *data, uint32_t sector, uint32_t count)
+{
+    msc_cache_t *cache = disk->cache;
+    if (cache == NULL) {
+        return lun_read(disk, data, sector, count);
+    }
+
+    xSemaphoreTake(cache->mutex, portMAX_DELAY);
+    esp_err_t ret = cache_read_locked(cache, data, sector, count);
+    xSemaphoreGive(cache->mutex);
+    return ret;
+}
+
+esp_err_t msc_cache_write(usb_disk_t *disk, const uint8_t *data, uint32_t sector, uint32_t count)
+{
+    msc_cache_t *cache = disk->cache;
+    if (cache == NULL) {
+        return lun_write(disk, data, sector, count);
+    }
+
+    xSemaphoreTake(cache->mutex, portMAX_DELAY);
+    esp_err_t ret = cache_write_locked(cache, data, sector, count);
+    xSemaphoreGive(cache->mutex);
+    return ret;
+}
+
+esp_err_t msc_cache_sync(usb_disk_t *disk)
+{
+    msc_cache_t *cache = disk->cache;
+    if (cache) {
+        xSemaphoreTake(cache->mutex, portMAX_DELAY);
+        esp_err_t ret = cache_flush_range(cache, 0, cache->sector_count);
+        xSemaphoreGive(cache->mutex);
+        MSC_RETURN_ON_ERROR(ret);
+    }
+
+    // Ask the device to write its own cache to the medium
+    if (!disk->sync_cache_unsupported) {
+        esp_err_t ret = scsi_cmd_sync_cache(disk->device, disk->lun);
+        if (ret == ESP_ERR_NOT_SUPPORTED) {
+            ESP_LOGD(TAG, "SYNCHRONIZE CACHE not supported by LUN %d", disk->lun);
+            disk->sync_cache_unsupported = true;
+        } else {
+            MSC_RETURN_ON_ERROR(ret);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t msc_cache_trim(usb_disk_t *disk, uint32_t sector, uint32_t count)
+{
+    msc_cache_t *cache = disk->cache;
+    if (cache) {
+        xSemaphoreTake(cache->mutex, portMAX_DELAY);
+        for (size_t i = 0; i < cache->size; i++) {
+            cache_entry_t *entry = &cache->entries[i];
+            if (entry->sector != INVALID_SECTOR && entry->sector >= sector && entry->sector - sector < count) {
+                if (entry->dirty) {
+                    entry->dirty = false;
+                    cache->dirty_count--;
+                }
+                entry->sector = INVALID_SECTOR;
+            }
+        }
+        xSemaphoreGive(cache->mutex);
+    }
+
+    if (disk->unmap_max_sectors == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    while (count) {
+        const uint32_t run = MIN(count, disk->unmap_max_sectors);
+        MSC_RETURN_ON_ERROR( scsi_cmd_unmap(disk->device, disk->lun, sector, run) );
+        sector += run;
+        count -= run;
+    }
+    return ESP_OK;
+}
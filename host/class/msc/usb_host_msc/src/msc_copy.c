@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "usb/usb_dma_buf.h"
+#include "usb/msc_host.h"
+#include "msc_common.h"
+#include "msc_cache.h"
+
+static const char *TAG = "USB_MSC_COPY";
+
+#define COPY_BUFFERS 2  // One buffer is read from the source while the other one is written to the destination
+
+/**
+ * @brief Chunk passed between the reading and the writing task
+ *
+ * Chunk with count 0 stops the writing task.
+ */
+typedef struct {
+    uint8_t *buf;
+    uint32_t sector;        // Destination sector
+    uint32_t count;
+    esp_err_t status;       // Result of the write
+} copy_chunk_t;
+
+typedef struct {
+    usb_disk_t *dst;
+    QueueHandle_t to_write; // Chunks read from the source
+    QueueHandle_t written;  // Chunks written to the destination, their buffers can be read into again
+} copy_ctx_t;
+
+static void copy_write_task(void *arg)
+{
+    copy_ctx_t *ctx = (copy_ctx_t *)arg;
+    copy_chunk_t chunk;
+    do {
+        xQueueReceive(ctx->to_write, &chunk, portMAX_DELAY);
+        if (chunk.count) {
+            chunk.status = msc_cache_write(ctx->dst, chunk.buf, chunk.sector, chunk.count);
+        }
+        xQueueSend(ctx->written, &chunk, portMAX_DELAY);
+    } while (chunk.count);
+    vTaskDelete(NULL);
+}
+
+esp_err_t msc_host_copy_sectors(msc_host_device_handle_t src, uint8_t src_lun, uint32_t src_sector,
+                                msc_host_device_handle_t dst, uint8_t dst_lun, uint32_t dst_sector,
+                                uint32_t count, const msc_host_copy_config_t *config)
+{
+    esp_err_t ret;
+    MSC_RETURN_ON_INVALID_ARG(src);
+    MSC_RETURN_ON_INVALID_ARG(dst);
+    msc_device_t *src_dev = (msc_device_t *)src;
+    msc_device_t *dst_dev = (msc_device_t *)dst;
+    MSC_RETURN_ON_FALSE(src_lun < src_dev->lun_count && dst_lun < dst_dev->lun_count, ESP_ERR_INVALID_ARG);
+    usb_disk_t *src_disk = &src_dev->disks[src_lun];
+    usb_disk_t *dst_disk = &dst_dev->disks[dst_lun];
+    MSC_RETURN_ON_FALSE(src_disk->block_size == dst_disk->block_size, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE((uint64_t)src_sector + count <= src_disk->block_count &&
+                        (uint64_t)dst_sector + count <= dst_disk->block_count, ESP_ERR_INVALID_ARG);
+    // Chunks are copied in ascending order, so the destination must not overwrite source sectors that are not read yet
+    MSC_RETURN_ON_FALSE(src_disk != dst_disk || dst_sector <= src_sector || dst_sector >= src_sector + count, ESP_ERR_INVALID_ARG);
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    const msc_host_copy_config_t default_config = {
+        .chunk_size = MSC_HOST_COPY_CHUNK_SIZE_DEFAULT,
+        .task_priority = uxTaskPriorityGet(NULL),
+        .stack_size = 3072,
+        .core_id = tskNO_AFFINITY,
+    };
+    if (config == NULL) {
+        config = &default_config;
+    }
+    MSC_RETURN_ON_FALSE(config->stack_size > 0 && config->task_priority > 0, ESP_ERR_INVALID_ARG);
+    const size_t chunk_size = config->chunk_size ? config->chunk_size : MSC_HOST_COPY_CHUNK_SIZE_DEFAULT;
+    const uint32_t chunk_sectors = MIN(chunk_size / src_disk->block_size, count);
+    MSC_RETURN_ON_FALSE(chunk_sectors > 0, ESP_ERR_INVALID_ARG);
+
+    copy_ctx_t ctx = {
+        .dst = dst_disk,
+    };
+    uint8_t *bufs[COPY_BUFFERS] = { NULL };
+    size_t pending = 0;     // Chunks sent to the writing task and not returned yet
+    for (int i = 0; i < COPY_BUFFERS; i++) {
+        MSC_GOTO_ON_FALSE( bufs[i] = usb_dma_buf_alloc(chunk_sectors * src_disk->block_size, 0), ESP_ERR_NO_MEM );
+    }
+    // The queues hold all chunks, so neither task blocks on send
+    MSC_GOTO_ON_FALSE( ctx.to_write = xQueueCreate(COPY_BUFFERS + 1, sizeof(copy_chunk_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( ctx.written = xQueueCreate(COPY_BUFFERS + 1, sizeof(copy_chunk_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( xTaskCreatePinnedToCore(copy_write_task, "USB MSC copy", config->stack_size, &ctx,
+                       config->task_priority, NULL, config->core_id) == pdPASS, ESP_ERR_NO_MEM );
+
+    ret = ESP_OK;
+    uint32_t done = 0;
+    while (done < count && ret == ESP_OK) {
+        copy_chunk_t chunk;
+        if (pending < COPY_BUFFERS) {
+            chunk.buf = bufs[pending];
+        } else {
+            // Wait until the oldest chunk is written and read into its buffer
+            xQueueReceive(ctx.written, &chunk, portMAX_DELAY);
+            pending--;
+            if (chunk.status != ESP_OK) {
+                ret = chunk.status;
+                break;
+            }
+        }
+        chunk.sector = dst_sector + done;
+        chunk.count = MIN(chunk_sectors, count - done);
+        ret = msc_cache_read(src_disk, chunk.buf, src_sector + done, chunk.count);
+        if (ret == ESP_OK) {
+            xQueueSend(ctx.to_write, &chunk, portMAX_DELAY);
+            pending++;
+            done += chunk.count;
+        }
+    }
+
+    // Stop the writing task after the queued chunks are written and collect their results
+    const copy_chunk_t stop = { .count = 0 };
+    xQueueSend(ctx.to_write, &stop, portMAX_DELAY);
+    for (;;) {
+        copy_chunk_t chunk;
+        xQueueReceive(ctx.written, &chunk, portMAX_DELAY);
+        if (chunk.count == 0) {
+            break;
+        }
+        if (ret == ESP_OK) {
+            ret = chunk.status;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = msc_cache_sync(dst_disk);
+    } else {
+        ESP_LOGE(TAG, "Copy of %" PRIu32 " sectors from %" PRIu32 " failed: %s", count, src_sector, esp_err_to_name(ret));
+    }
+
+fail:
+    if (ctx.written) {
+        vQueueDelete(ctx.written);
+    }
+    if (ctx.to_write) {
+        vQueueDelete(ctx.to_write);
+    }
+    for (int i = 0; i < COPY_BUFFERS; i++) {
+        usb_dma_buf_free(bufs[i]);
+    }
+    return ret;
+}
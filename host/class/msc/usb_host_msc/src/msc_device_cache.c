@@ -0,0 +1,195 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sdkconfig.h"
+#ifdef CONFIG_MSC_HOST_DEVICE_CACHE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "nvs.h"
+#include "usb/usb_host.h"
+#include "msc_common.h"
+#include "msc_device_cache.h"
+
+static const char *TAG = "USB_MSC_CACHE";
+
+#define DEVICE_CACHE_NAMESPACE  "usb_msc"
+#define DEVICE_CACHE_VERSION    1
+
+typedef struct {
+    uint64_t block_count;
+    uint32_t block_size;
+    uint32_t unmap_max_sectors;
+    uint32_t erase_block_size;
+    uint32_t max_transfer_sectors;
+} device_cache_lun_t;
+
+typedef struct {
+    uint16_t version;
+    uint16_t vid;
+    uint16_t pid;
+    uint8_t serial_len;
+    uint8_t lun_count;
+    uint16_t serial[MSC_STR_DESC_SIZE];
+    device_cache_lun_t luns[MSC_HOST_MAX_LUN]; // Only lun_count entries are stored
+} device_cache_entry_t;
+
+#define ENTRY_SIZE(lun_count) (offsetof(device_cache_entry_t, luns) + (lun_count) * sizeof(device_cache_lun_t))
+
+/**
+ * @brief Fill identification of the device and NVS key derived from it
+ *
+ * NVS keys are limited to 15 characters, so the key is a hash. Collisions are detected by comparing the identification.
+ */
+static esp_err_t device_cache_identify(const msc_device_t *device, device_cache_entry_t *entry, char key[NVS_KEY_NAME_MAX_SIZE])
+{
+    const usb_device_desc_t *device_desc;
+    usb_device_info_t dev_info;
+
+    MSC_RETURN_ON_ERROR( usb_host_get_device_descriptor(device->handle, &device_desc) );
+    MSC_RETURN_ON_ERROR( usb_host_device_info(device->handle, &dev_info) );
+    if (dev_info.str_desc_serial_num == NULL || dev_info.str_desc_serial_num->bLength <= USB_STANDARD_DESC_SIZE) {
+        return ESP_ERR_NOT_SUPPORTED; // Identical devices without serial number could not be distinguished
+    }
+
+    memset(entry, 0, sizeof(device_cache_entry_t));
+    entry->version = DEVICE_CACHE_VERSION;
+    entry->vid = device_desc->idVendor;
+    entry->pid = device_desc->idProduct;
+    entry->serial_len = MIN((dev_info.str_desc_serial_num->bLength - USB_STANDARD_DESC_SIZE) / 2, MSC_STR_DESC_SIZE);
+    memcpy(entry->serial, dev_info.str_desc_serial_num->wData, entry->serial_len * sizeof(uint16_t));
+
+    // FNV-1a over the identification
+    uint32_t hash = 2166136261;
+    const uint8_t *id = (const uint8_t *)&entry->vid;
+    const size_t id_len = offsetof(device_cache_entry_t, lun_count) - offsetof(device_cache_entry_t, vid);
+    for (size_t i = 0; i < id_len; i++) {
+        hash = (hash ^ id[i]) * 16777619;
+    }
+    for (size_t i = 0; i < entry->serial_len * sizeof(uint16_t); i++) {
+        hash = (hash ^ ((const uint8_t *)entry->serial)[i]) * 16777619;
+    }
+    snprintf(key, NVS_KEY_NAME_MAX_SIZE, "dev%08"PRIx32, hash);
+    return ESP_OK;
+}
+
+esp_err_t msc_device_cache_load(msc_device_t *device)
+{
+    device_cache_entry_t id, entry;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t nvs;
+
+    esp_err_t ret = device_cache_identify(device, &id, key);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // Unknown device is not an error, namespace does not exist until the first device is stored
+    if (nvs_open(DEVICE_CACHE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t size = sizeof(entry);
+    ret = nvs_get_blob(nvs, key, &entry, &size);
+    nvs_close(nvs);
+    if (ret != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (entry.version != id.version || entry.lun_count != device->lun_count || size != ENTRY_SIZE(entry.lun_count) ||
+            memcmp(&entry, &id, offsetof(device_cache_entry_t, lun_count)) != 0 ||
+            memcmp(entry.serial, id.serial, sizeof(id.serial)) != 0) {
+        ESP_LOGD(TAG, "Entry %s does not match the device", key);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (uint8_t lun = 0; lun < device->lun_count; lun++) {
+        usb_disk_t *disk = &device->disks[lun];
+        disk->block_count = entry.luns[lun].block_count;
+        disk->block_size = entry.luns[lun].block_size;
+        disk->unmap_max_sectors = entry.luns[lun].unmap_max_sectors;
+        disk->erase_block_size = entry.luns[lun].erase_block_size;
+        disk->max_transfer_sectors = entry.luns[lun].max_transfer_sectors;
+    }
+    ESP_LOGD(TAG, "Device %04X:%04X found in cache", entry.vid, entry.pid);
+    return ESP_OK;
+}
+
+esp_err_t msc_device_cache_store(const msc_device_t *device)
+{
+    device_cache_entry_t entry;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t nvs;
+
+    esp_err_t ret = device_cache_identify(device, &entry, key);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    entry.lun_count = device->lun_count;
+    for (uint8_t lun = 0; lun < device->lun_count; lun++) {
+        const usb_disk_t *disk = &device->disks[lun];
+        entry.luns[lun] = (device_cache_lun_t) {
+            .block_count = disk->block_count,
+            .block_size = disk->block_size,
+            .unmap_max_sectors = disk->unmap_max_sectors,
+            .erase_block_size = disk->erase_block_size,
+            .max_transfer_sectors = disk->max_transfer_sectors,
+        };
+    }
+
+    ret = nvs_open(DEVICE_CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret; // NVS was not initialized by the application
+    }
+    ret = nvs_set_blob(nvs, key, &entry, ENTRY_SIZE(entry.lun_count));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t msc_device_cache_remove(const msc_device_t *device)
+{
+    device_cache_entry_t entry;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t nvs;
+
+    esp_err_t ret = device_cache_identify(device, &entry, key);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    MSC_RETURN_ON_ERROR( nvs_open(DEVICE_CACHE_NAMESPACE, NVS_READWRITE, &nvs) );
+    ret = nvs_erase_key(nvs, key);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t msc_device_cache_clear(void)
+{
+    nvs_handle_t nvs;
+
+    esp_err_t ret = nvs_open(DEVICE_CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK; // Nothing was stored yet
+    }
+    MSC_RETURN_ON_ERROR(ret);
+    ret = nvs_erase_all(nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+#endif // CONFIG_MSC_HOST_DEVICE_CACHE
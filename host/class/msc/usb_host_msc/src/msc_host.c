@@ -13,12 +13,22 @@
 #include <sys/param.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "usb/usb_host.h"
+#include "usb/usb_host_shared_client.h"
+#include "usb/usb_host_urb_pool.h"
+#include "usb/usb_host_desc_index.h"
+#include "usb/usb_host_class_trace.h"
+#include "usb/usb_class_stats.h"
+#include "usb/usb_dma_buf.h"
 #include "diskio_usb.h"
 #include "msc_common.h"
+#include "msc_async.h"
+#include "msc_device_cache.h"
+#include "msc_quirks.h"
 #include "usb/msc_host.h"
 #include "msc_scsi_bot.h"
 #include "usb/usb_types_ch9.h"
@@ -30,6 +40,8 @@ static portMUX_TYPE msc_lock = portMUX_INITIALIZER_UNLOCKED;
 #define MSC_ENTER_CRITICAL()    portENTER_CRITICAL(&msc_lock)
 #define MSC_EXIT_CRITICAL()     portEXIT_CRITICAL(&msc_lock)
 
+#define MSC_TRACE(event, xfer) USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_MSC, USB_HOST_CLASS_TRACE_##event, xfer)
+
 #define MSC_GOTO_ON_FALSE_CRITICAL(exp, err)    \
     do {                                        \
         if(!(exp)) {                            \
@@ -81,60 +93,62 @@ static portMUX_TYPE msc_lock = portMUX_INITIALIZER_UNLOCKED;
 
 #define DEFAULT_XFER_SIZE   (64) // Transfer size used for all transfers apart from SCSI read/write
 #define WAIT_FOR_READY_TIMEOUT_MS 5000
+#define DEFAULT_TIMEOUT_MS  5000
+#define MSC_TIMEOUT_REF_SIZE (16 * 1024) // Longer transfers get proportionally longer adaptive timeout
 #define SCSI_COMMAND_SET    0x06
 #define BULK_ONLY_TRANSFER  0x50
+#define USB_ATTACHED_SCSI   0x62
+#define UAS_PIPE_USAGE_DESC 0x24
+#define UAS_PIPE_ID_COMMAND 1
+#define UAS_PIPE_ID_STATUS  2
+#define UAS_PIPE_ID_DATA_IN 3
+#define UAS_PIPE_ID_DATA_OUT 4
 #define MSC_NO_SENSE        0x00
 #define MSC_NOT_READY       0x02
 #define MSC_UNIT_ATTENTION  0x06
+#define MSC_ASC_POWER_ON_RESET 0x29 // Reported by most devices in the first command after attach
 
 static const char *TAG = "USB_MSC";
 typedef struct {
     usb_host_client_handle_t client_handle;
+    usb_host_shared_client_driver_handle_t shared_driver; // NULL if the driver has its own client
     msc_host_event_cb_t user_cb;
     void *user_arg;
     SemaphoreHandle_t all_events_handled;
     volatile bool end_client_event_handling;
     bool event_handling_started;
+    size_t pipeline_depth;
+    size_t pipeline_chunk_size;
+    msc_cache_config_t cache_config;
+    msc_timeout_t timeout_config;
+    msc_async_config_t async_config;    // Asynchronous I/O worker of each device, disabled if queue_size is 0
+    const msc_host_quirk_t *quirks;     // Application quirks table, matched before the built-in one
+    size_t quirk_count;
     STAILQ_HEAD(devices, msc_host_device) devices_tailq;
 } msc_driver_t;
 
 static msc_driver_t *s_msc_driver;
 
 
-static const usb_standard_desc_t *next_interface_desc(const usb_standard_desc_t *desc, size_t len, size_t *offset)
-{
-    return usb_parse_next_descriptor_of_type(desc, len, USB_W_VALUE_DT_INTERFACE, (int *)offset);
-}
-
-static const usb_standard_desc_t *next_endpoint_desc(const usb_standard_desc_t *desc, size_t len, size_t *offset)
+static inline bool is_msc_alt(const usb_host_desc_index_alt_t *alt)
 {
-    return usb_parse_next_descriptor_of_type(desc, len, USB_B_DESCRIPTOR_TYPE_ENDPOINT, (int *)offset);
+    const usb_intf_desc_t *ifc_desc = alt->intf_desc;
+    return ifc_desc->bInterfaceClass == USB_CLASS_MASS_STORAGE &&
+           ifc_desc->bInterfaceSubClass == SCSI_COMMAND_SET &&
+           (ifc_desc->bInterfaceProtocol == BULK_ONLY_TRANSFER ||
+            ifc_desc->bInterfaceProtocol == USB_ATTACHED_SCSI);
 }
 
-static inline bool is_in_endpoint(uint8_t endpoint)
+static const usb_host_desc_index_intf_t *find_msc_interface(const usb_host_desc_index_t *index)
 {
-    return endpoint & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK ? true : false;
-}
-
-static const usb_intf_desc_t *find_msc_interface(const usb_config_desc_t *config_desc, size_t *offset)
-{
-    size_t total_length = config_desc->wTotalLength;
-    const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)config_desc;
-
-    next_desc = next_interface_desc(next_desc, total_length, offset);
-
-    while ( next_desc ) {
-
-        const usb_intf_desc_t *ifc_desc = (const usb_intf_desc_t *)next_desc;
-
-        if ( ifc_desc->bInterfaceClass == USB_CLASS_MASS_STORAGE &&
-                ifc_desc->bInterfaceSubClass == SCSI_COMMAND_SET &&
-                ifc_desc->bInterfaceProtocol == BULK_ONLY_TRANSFER ) {
-            return ifc_desc;
+    for (int i = 0; i < index->num_intfs; i++) {
+        const usb_host_desc_index_intf_t *intf = &index->intfs[i];
+        for (int alt = 0; alt < intf->num_alts; alt++) {
+            if (is_msc_alt(&intf->alts[alt])) {
+                return intf;
+            }
         }
-
-        next_desc = next_interface_desc(next_desc, total_length, offset);
-    };
+    }
     return NULL;
 }
 
@@ -186,15 +200,13 @@ static esp_err_t msc_mass_reset(msc_host_device_handle_t dev)
  *
  * If the device implements 3 LUNs, the returned value is 2. (LUN0, LUN1, LUN2).
  *
- * This driver does not support multiple LUNs yet.
- *
  * @see USB Mass Storage Class – Bulk Only Transport, Chapter 3.2
  *
  * @param[in]  dev MSC device handle
  * @param[out] lun Maximum Logical Unit Number
  * @return esp_err_t
  */
-__attribute__((unused)) static esp_err_t msc_get_max_lun(msc_host_device_handle_t dev, uint8_t *lun)
+static esp_err_t msc_get_max_lun(msc_host_device_handle_t dev, uint8_t *lun)
 {
     msc_device_t *device = (msc_device_t *)dev;
     usb_transfer_t *xfer = device->xfer;
@@ -208,11 +220,115 @@ __attribute__((unused)) static esp_err_t msc_get_max_lun(msc_host_device_handle_
 }
 
 /**
- * @brief Extracts configuration from configuration descriptor.
+ * @brief Select alternate setting of the MSC interface
+ *
+ * @param[in] device MSC device
+ * @return esp_err_t
+ */
+static esp_err_t msc_set_interface(msc_device_t *device)
+{
+    usb_transfer_t *xfer = device->xfer;
+
+    USB_SETUP_PACKET_INIT_SET_INTERFACE((usb_setup_packet_t *)xfer->data_buffer,
+                                        device->config.iface_num, device->config.alt_setting);
+    return msc_control_transfer(device, USB_SETUP_PACKET_SIZE);
+}
+
+/**
+ * @brief Extracts UAS configuration from alternate setting of the MSC interface
+ *
+ * @note  Each of the four bulk endpoints is followed by Pipe Usage descriptor identifying its role
+ *
+ * @param[in]  alt  Alternate setting with UAS protocol
+ * @param[out] cfg  Obtained configuration
+ * @return esp_err_t
+ */
+static esp_err_t extract_uas_config(const usb_host_desc_index_alt_t *alt, msc_config_t *cfg)
+{
+    const usb_ep_desc_t *ep_desc = NULL;
+    uint8_t found = 0;
+    int ep = 0;
+
+    for (int i = 0; i < alt->num_class_descs; i++) {
+        const uint8_t *desc = (const uint8_t *)alt->class_descs[i];
+        // Pipe Usage descriptor belongs to the endpoint just before it
+        while (ep < alt->num_eps && (const uint8_t *)alt->ep_descs[ep] < desc) {
+            ep_desc = alt->ep_descs[ep++];
+        }
+        if (desc[1] != UAS_PIPE_USAGE_DESC || !ep_desc || desc[0] < 3) {
+            continue;
+        }
+        switch (desc[2]) {
+        case UAS_PIPE_ID_COMMAND: cfg->uas_command_ep = ep_desc->bEndpointAddress; break;
+        case UAS_PIPE_ID_STATUS: cfg->uas_status_ep = ep_desc->bEndpointAddress; break;
+        case UAS_PIPE_ID_DATA_IN:
+            cfg->bulk_in_ep = ep_desc->bEndpointAddress;
+            cfg->bulk_in_mps = ep_desc->wMaxPacketSize;
+            break;
+        case UAS_PIPE_ID_DATA_OUT: cfg->bulk_out_ep = ep_desc->bEndpointAddress; break;
+        default: continue;
+        }
+        found |= 1 << desc[2];
+        ep_desc = NULL;
+    }
+
+    const uint8_t all_pipes = (1 << UAS_PIPE_ID_COMMAND) | (1 << UAS_PIPE_ID_STATUS) |
+                              (1 << UAS_PIPE_ID_DATA_IN) | (1 << UAS_PIPE_ID_DATA_OUT);
+    MSC_RETURN_ON_FALSE(found == all_pipes, ESP_ERR_NOT_SUPPORTED);
+    cfg->transport = MSC_TRANSPORT_UAS;
+    cfg->alt_setting = alt->intf_desc->bAlternateSetting;
+    return ESP_OK;
+}
+
+/**
+ * @brief Extracts configuration from descriptor index of configuration descriptor.
  *
  * @note  Passes interface and endpoint descriptors to obtain:
 
  *        - interface number, IN endpoint, OUT endpoint, max. packet size
+ *        - transport; UAS alternate setting is preferred over Bulk-Only Transport
+ *
+ * @param[in]  index  Descriptor index of configuration descriptor
+ * @param[out] cfg    Obtained configuration
+ * @return esp_err_t
+ */
+static esp_err_t extract_config_from_index(const usb_host_desc_index_t *index, msc_config_t *cfg)
+{
+    const usb_host_desc_index_intf_t *intf = find_msc_interface(index);
+    MSC_RETURN_ON_FALSE(intf, ESP_ERR_NOT_SUPPORTED);
+    cfg->iface_num = intf->bInterfaceNumber;
+
+    // Look for UAS among alternate settings of the interface
+    for (int i = 0; i < intf->num_alts; i++) {
+        const usb_host_desc_index_alt_t *alt = &intf->alts[i];
+        if (is_msc_alt(alt) && alt->intf_desc->bInterfaceProtocol == USB_ATTACHED_SCSI && extract_uas_config(alt, cfg) == ESP_OK) {
+            return ESP_OK;
+        }
+    }
+
+    // Bulk-Only Transport
+    const usb_host_desc_index_alt_t *bot_alt = NULL;
+    for (int i = 0; i < intf->num_alts && !bot_alt; i++) {
+        if (is_msc_alt(&intf->alts[i]) && intf->alts[i].intf_desc->bInterfaceProtocol == BULK_ONLY_TRANSFER) {
+            bot_alt = &intf->alts[i];
+        }
+    }
+    MSC_RETURN_ON_FALSE(bot_alt, ESP_ERR_NOT_SUPPORTED);
+    cfg->transport = MSC_TRANSPORT_BOT;
+    cfg->alt_setting = bot_alt->intf_desc->bAlternateSetting;
+
+    const usb_ep_desc_t *in_ep = usb_host_desc_index_find_ep(bot_alt, USB_TRANSFER_TYPE_BULK, true);
+    const usb_ep_desc_t *out_ep = usb_host_desc_index_find_ep(bot_alt, USB_TRANSFER_TYPE_BULK, false);
+    MSC_RETURN_ON_FALSE(in_ep && out_ep, ESP_ERR_NOT_SUPPORTED);
+    cfg->bulk_in_ep = in_ep->bEndpointAddress;
+    cfg->bulk_in_mps = in_ep->wMaxPacketSize;
+    cfg->bulk_out_ep = out_ep->bEndpointAddress;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Extracts configuration from configuration descriptor.
  *
  * @param[in]  cfg_desc  Configuration descriptor
  * @param[out] cfg       Obtained configuration
@@ -220,38 +336,89 @@ __attribute__((unused)) static esp_err_t msc_get_max_lun(msc_host_device_handle_
  */
 static esp_err_t extract_config_from_descriptor(const usb_config_desc_t *cfg_desc, msc_config_t *cfg)
 {
-    size_t offset = 0;
-    size_t total_len = cfg_desc->wTotalLength;
-    const usb_intf_desc_t *ifc_desc = find_msc_interface(cfg_desc, &offset);
-    assert(ifc_desc);
-    const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)ifc_desc;
-    const usb_ep_desc_t *ep_desc = NULL;
+    usb_host_desc_index_t *index;
+    MSC_RETURN_ON_ERROR( usb_host_desc_index_build(cfg_desc, &index) );
+    const esp_err_t ret = extract_config_from_index(index, cfg);
+    usb_host_desc_index_free(index);
+    return ret;
+}
+
+/**
+ * @brief Count completed transfer in usb_class_stats registry
+ *
+ * Transfers cancelled on disconnection are not counted as errors.
+ */
+static inline void msc_class_stats_xfer(msc_device_t *device, const usb_transfer_t *transfer)
+{
+    if (transfer->status != USB_TRANSFER_STATUS_NO_DEVICE && transfer->status != USB_TRANSFER_STATUS_CANCELED) {
+        USB_CLASS_STATS_XFER(device->class_stats, transfer->actual_num_bytes, transfer->status == USB_TRANSFER_STATUS_COMPLETED);
+    }
+}
 
-    cfg->iface_num = ifc_desc->bInterfaceNumber;
+static void pipeline_transfer_callback(usb_transfer_t *transfer)
+{
+    msc_device_t *device = (msc_device_t *)transfer->context;
+    MSC_TRACE(COMPLETE, transfer);
+    msc_class_stats_xfer(device, transfer);
+    xSemaphoreGive(device->pipeline.done);
+}
 
-    next_desc = next_endpoint_desc(next_desc, total_len, &offset);
-    MSC_RETURN_ON_FALSE(next_desc, ESP_ERR_NOT_SUPPORTED);
-    ep_desc = (const usb_ep_desc_t *)next_desc;
+static void msc_pipeline_free(msc_device_t *dev)
+{
+    msc_pipeline_t *pipeline = &dev->pipeline;
 
-    if (is_in_endpoint(ep_desc->bEndpointAddress)) {
-        cfg->bulk_in_ep = ep_desc->bEndpointAddress;
-        cfg->bulk_in_mps = ep_desc->wMaxPacketSize;
-    } else {
-        cfg->bulk_out_ep = ep_desc->bEndpointAddress;
+    if (pipeline->entries) {
+        for (size_t i = 0; i < pipeline->depth; i++) {
+            if (pipeline->entries[i].xfer) {
+                usb_host_urb_pool_transfer_free(pipeline->entries[i].xfer);
+            }
+        }
+        free(pipeline->entries);
+        pipeline->entries = NULL;
+    }
+    if (pipeline->done) {
+        vSemaphoreDelete(pipeline->done);
+        pipeline->done = NULL;
     }
+    pipeline->depth = 0;
+}
 
-    next_desc = next_endpoint_desc(next_desc, total_len, &offset);
-    MSC_RETURN_ON_FALSE(next_desc, ESP_ERR_NOT_SUPPORTED);
-    ep_desc = (const usb_ep_desc_t *)next_desc;
+/**
+ * @brief Allocate transfers for pipelined data phase
+ *
+ * @param[in] dev        MSC device
+ * @param[in] depth      Number of transfers. No transfers are allocated for depth less than 2
+ * @param[in] chunk_size Size of each transfer
+ * @return esp_err_t
+ */
+static esp_err_t msc_pipeline_alloc(msc_device_t *dev, size_t depth, size_t chunk_size)
+{
+    esp_err_t ret;
+    msc_pipeline_t *pipeline = &dev->pipeline;
 
-    if (is_in_endpoint(ep_desc->bEndpointAddress)) {
-        cfg->bulk_in_ep = ep_desc->bEndpointAddress;
-        cfg->bulk_in_mps = ep_desc->wMaxPacketSize;
-    } else {
-        cfg->bulk_out_ep = ep_desc->bEndpointAddress;
+    if (depth < 2) {
+        return ESP_OK;
     }
 
+    MSC_GOTO_ON_FALSE( pipeline->entries = calloc(depth, sizeof(msc_pipeline_entry_t)), ESP_ERR_NO_MEM );
+    pipeline->depth = depth;
+    pipeline->chunk_size = chunk_size;
+    MSC_GOTO_ON_FALSE( pipeline->done = xSemaphoreCreateCounting(depth, 0), ESP_ERR_NO_MEM );
+
+    for (size_t i = 0; i < depth; i++) {
+        msc_pipeline_entry_t *entry = &pipeline->entries[i];
+        MSC_GOTO_ON_ERROR( usb_host_urb_pool_transfer_alloc(chunk_size, 0, &entry->xfer) );
+        entry->bounce_buffer = entry->xfer->data_buffer;
+        entry->bounce_buffer_size = entry->xfer->data_buffer_size;
+        entry->xfer->device_handle = dev->handle;
+        entry->xfer->callback = pipeline_transfer_callback;
+        entry->xfer->context = dev;
+    }
     return ESP_OK;
+
+fail:
+    msc_pipeline_free(dev);
+    return ret;
 }
 
 static esp_err_t msc_deinit_device(msc_device_t *dev, bool install_failed)
@@ -261,38 +428,51 @@ static esp_err_t msc_deinit_device(msc_device_t *dev, bool install_failed)
     STAILQ_REMOVE(&s_msc_driver->devices_tailq, dev, msc_host_device, tailq_entry);
     MSC_EXIT_CRITICAL();
 
+    msc_async_delete(dev->async);
     if (dev->transfer_done) {
         vSemaphoreDelete(dev->transfer_done);
     }
+    if (dev->cmd_mutex) {
+        vSemaphoreDelete(dev->cmd_mutex);
+    }
+    msc_pipeline_free(dev);
+    free(dev->uas.status_buffer);
+    usb_class_stats_unregister(dev->class_stats);
     if (install_failed) {
         // Error code is unchecked, as it's unknown at what point installation failed.
         usb_host_interface_release(s_msc_driver->client_handle, dev->handle, dev->config.iface_num);
-        usb_host_device_close(s_msc_driver->client_handle, dev->handle);
-        usb_host_transfer_free(dev->xfer);
+        usb_host_shared_client_device_close(s_msc_driver->client_handle, dev->handle);
+        usb_host_urb_pool_transfer_free(dev->xfer);
     } else {
         MSC_RETURN_ON_ERROR( usb_host_interface_release(s_msc_driver->client_handle, dev->handle, dev->config.iface_num) );
-        MSC_RETURN_ON_ERROR( usb_host_device_close(s_msc_driver->client_handle, dev->handle) );
-        MSC_RETURN_ON_ERROR( usb_host_transfer_free(dev->xfer) );
+        MSC_RETURN_ON_ERROR( usb_host_shared_client_device_close(s_msc_driver->client_handle, dev->handle) );
+        MSC_RETURN_ON_ERROR( usb_host_urb_pool_transfer_free(dev->xfer) );
     }
 
+    if (dev->disks) {
+        for (uint8_t lun = 0; lun < dev->lun_count; lun++) {
+            msc_cache_delete(dev->disks[lun].cache);
+        }
+        free(dev->disks);
+    }
     free(dev);
     return ESP_OK;
 }
 
 // Some MSC devices requires to change its internal state from non-ready to ready
-static esp_err_t msc_wait_for_ready_state(msc_device_t *dev, size_t timeout_ms)
+static esp_err_t msc_wait_for_ready_state(msc_device_t *dev, uint8_t lun, size_t timeout_ms)
 {
     esp_err_t err;
     scsi_sense_data_t sense;
     uint32_t trials = MAX(1, timeout_ms / 100);
 
     do {
-        err = scsi_cmd_unit_ready(dev);
+        err = scsi_cmd_unit_ready(dev, lun);
         if (err == ESP_OK) {
             return ESP_OK;
         } else {
             // Some MSC devices report 'NOT READY TO READY TRANSITION - MEDIA CHANGED', which isn't cleared until a REQUEST SENSE is performed.
-            MSC_RETURN_ON_ERROR( scsi_cmd_sense(dev, &sense) );
+            MSC_RETURN_ON_ERROR( scsi_cmd_sense(dev, lun, &sense) );
             if (sense.key != MSC_NOT_READY &&
                     sense.key != MSC_UNIT_ATTENTION &&
                     sense.key != MSC_NO_SENSE) {
@@ -307,20 +487,22 @@ static esp_err_t msc_wait_for_ready_state(msc_device_t *dev, size_t timeout_ms)
 
 static bool is_mass_storage_device(uint8_t dev_addr)
 {
-    size_t dummy = 0;
     bool is_msc_device = false;
     usb_device_handle_t device;
     const usb_config_desc_t *config_desc;
+    usb_host_desc_index_t *index;
 
-    if ( usb_host_device_open(s_msc_driver->client_handle, dev_addr, &device) == ESP_OK) {
-        if ( usb_host_get_active_config_descriptor(device, &config_desc) == ESP_OK ) {
-            if ( find_msc_interface(config_desc, &dummy) ) {
+    if ( usb_host_shared_client_device_open(s_msc_driver->client_handle, dev_addr, &device) == ESP_OK) {
+        if ( usb_host_get_active_config_descriptor(device, &config_desc) == ESP_OK &&
+                usb_host_desc_index_build(config_desc, &index) == ESP_OK ) {
+            if ( find_msc_interface(index) ) {
                 is_msc_device = true;
             } else {
                 ESP_LOGD(TAG, "Connected USB device is not MSC");
             }
+            usb_host_desc_index_free(index);
         }
-        usb_host_device_close(s_msc_driver->client_handle, device);
+        usb_host_shared_client_device_close(s_msc_driver->client_handle, device);
     }
 
     return is_msc_device;
@@ -331,6 +513,9 @@ esp_err_t msc_host_handle_events(uint32_t timeout)
     MSC_RETURN_ON_FALSE(s_msc_driver != NULL, ESP_ERR_INVALID_STATE);
 
     ESP_LOGV(TAG, "USB MSC handling");
+    if (s_msc_driver->shared_driver) {
+        return usb_host_shared_client_handle_events(timeout);
+    }
     s_msc_driver->event_handling_started = true;
     esp_err_t ret = usb_host_client_handle_events(s_msc_driver->client_handle, timeout);
     if (s_msc_driver->end_client_event_handling) {
@@ -373,15 +558,44 @@ static msc_device_t *find_msc_device(usb_device_handle_t device_handle)
     return device_found;
 }
 
+static void msc_device_connected_notify(uint8_t dev_addr)
+{
+    const msc_host_event_t msc_event = {
+        .event = MSC_DEVICE_CONNECTED,
+        .device.address = dev_addr,
+    };
+    s_msc_driver->user_cb(&msc_event, s_msc_driver->user_arg);
+}
+
+// Interfaces accepted by is_msc_alt()
+static const usb_host_shared_client_match_t msc_match_table[] = {
+    {
+        .match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS | USB_HOST_SHARED_CLIENT_MATCH_INTF_SUBCLASS | USB_HOST_SHARED_CLIENT_MATCH_INTF_PROTOCOL,
+        .bInterfaceClass = USB_CLASS_MASS_STORAGE,
+        .bInterfaceSubClass = SCSI_COMMAND_SET,
+        .bInterfaceProtocol = BULK_ONLY_TRANSFER,
+    },
+    {
+        .match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS | USB_HOST_SHARED_CLIENT_MATCH_INTF_SUBCLASS | USB_HOST_SHARED_CLIENT_MATCH_INTF_PROTOCOL,
+        .bInterfaceClass = USB_CLASS_MASS_STORAGE,
+        .bInterfaceSubClass = SCSI_COMMAND_SET,
+        .bInterfaceProtocol = USB_ATTACHED_SCSI,
+    },
+};
+
+/**
+ * @brief Probe of the shared client, called only for devices with MSC interface
+ */
+static void client_probe_cb(const usb_host_shared_client_probe_t *probe, void *arg)
+{
+    msc_device_connected_notify(probe->dev_addr);
+}
+
 static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
 {
     if (event->event == USB_HOST_CLIENT_EVENT_NEW_DEV) {
         if (is_mass_storage_device(event->new_dev.address)) {
-            const msc_host_event_t msc_event = {
-                .event = MSC_DEVICE_CONNECTED,
-                .device.address = event->new_dev.address,
-            };
-            s_msc_driver->user_cb(&msc_event, s_msc_driver->user_arg);
+            msc_device_connected_notify(event->new_dev.address);
         }
     } else if (event->event == USB_HOST_CLIENT_EVENT_DEV_GONE) {
         msc_device_t *msc_device = find_msc_device(event->dev_gone.dev_hdl);
@@ -401,16 +615,42 @@ esp_err_t msc_host_install(const msc_host_driver_config_t *config)
 
     MSC_RETURN_ON_INVALID_ARG(config);
     MSC_RETURN_ON_INVALID_ARG(config->callback);
+    MSC_RETURN_ON_FALSE(!(config->shared_client && config->create_backround_task), ESP_ERR_INVALID_ARG);
     if ( config->create_backround_task ) {
         MSC_RETURN_ON_FALSE(config->stack_size != 0, ESP_ERR_INVALID_ARG);
         MSC_RETURN_ON_FALSE(config->task_priority != 0, ESP_ERR_INVALID_ARG);
     }
+    MSC_RETURN_ON_FALSE(config->pipeline_chunk_size % 512 == 0, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(config->cache.size != 1, ESP_ERR_INVALID_ARG);
+    if (config->async.queue_size) {
+        MSC_RETURN_ON_FALSE(config->async.stack_size != 0, ESP_ERR_INVALID_ARG);
+        MSC_RETURN_ON_FALSE(config->async.task_priority != 0, ESP_ERR_INVALID_ARG);
+    }
+    MSC_RETURN_ON_FALSE(!config->timeout.min_ms || !config->timeout.max_ms ||
+                        config->timeout.min_ms <= config->timeout.max_ms, ESP_ERR_INVALID_ARG);
     MSC_RETURN_ON_FALSE(!s_msc_driver, ESP_ERR_INVALID_STATE);
 
     msc_driver_t *driver = calloc(1, sizeof(msc_driver_t));
     MSC_RETURN_ON_FALSE(driver, ESP_ERR_NO_MEM);
     driver->user_cb = config->callback;
     driver->user_arg = config->callback_arg;
+    driver->pipeline_depth = config->pipeline_depth;
+    driver->pipeline_chunk_size = config->pipeline_chunk_size ? config->pipeline_chunk_size : MSC_HOST_PIPELINE_CHUNK_SIZE_DEFAULT;
+    driver->cache_config = (msc_cache_config_t) {
+        .size = config->cache.size,
+        .read_ahead = config->cache.read_ahead,
+        .write_back = config->cache.write_back,
+        .heap_caps = config->cache.heap_caps,
+        .flush_timeout_ms = config->cache.flush_timeout_ms,
+    };
+    driver->timeout_config = (msc_timeout_t) {
+        .max_ms = config->timeout.max_ms ? config->timeout.max_ms : DEFAULT_TIMEOUT_MS,
+        .retries = config->timeout.retries,
+        .backoff_ms = config->timeout.backoff_ms,
+    };
+    driver->timeout_config.min_ms = MIN(config->timeout.min_ms, driver->timeout_config.max_ms);
+    driver->quirks = config->quirks;
+    driver->quirk_count = config->quirk_count;
 
     usb_host_client_config_t client_config = {
         .async.client_event_callback = client_event_cb,
@@ -422,7 +662,28 @@ esp_err_t msc_host_install(const msc_host_driver_config_t *config)
     driver->all_events_handled = xSemaphoreCreateBinary();
     MSC_GOTO_ON_FALSE(driver->all_events_handled, ESP_ERR_NO_MEM);
 
-    MSC_GOTO_ON_ERROR( usb_host_client_register(&client_config, &driver->client_handle) );
+    if (config->shared_client) {
+        const usb_host_shared_client_driver_config_t shared_config = {
+            .event_cb = client_event_cb,
+            .probe_cb = client_probe_cb,
+            .match_table = msc_match_table,
+            .match_count = sizeof(msc_match_table) / sizeof(msc_match_table[0]),
+            .arg = NULL,
+        };
+        MSC_GOTO_ON_ERROR( usb_host_shared_client_add_driver(&shared_config, &driver->shared_driver, &driver->client_handle) );
+    } else {
+        MSC_GOTO_ON_ERROR( usb_host_client_register(&client_config, &driver->client_handle) );
+    }
+
+    // USB transfers are finished by the client task, so blocking SCSI commands must run in separate tasks
+    driver->async_config = (msc_async_config_t) {
+        .queue_size = config->async.queue_size,
+        .task_priority = config->async.task_priority,
+        .stack_size = config->async.stack_size,
+        .core_id = config->async.core_id,
+        .reorder_window = config->async.reorder_window,
+        .merge_buffer_size = config->async.merge_buffer_size,
+    };
 
     MSC_ENTER_CRITICAL();
     MSC_GOTO_ON_FALSE_CRITICAL(!s_msc_driver, ESP_ERR_INVALID_STATE);
@@ -446,7 +707,11 @@ esp_err_t msc_host_install(const msc_host_driver_config_t *config)
 
 fail:
     s_msc_driver = NULL;
-    usb_host_client_deregister(driver->client_handle);
+    if (driver->shared_driver) {
+        usb_host_shared_client_remove_driver(driver->shared_driver);
+    } else if (driver->client_handle) {
+        usb_host_client_deregister(driver->client_handle);
+    }
     if (driver->all_events_handled) {
         vSemaphoreDelete(driver->all_events_handled);
     }
@@ -466,23 +731,179 @@ esp_err_t msc_host_uninstall(void)
     s_msc_driver->end_client_event_handling = true;
     MSC_EXIT_CRITICAL();
 
-    if (s_msc_driver->event_handling_started) {
-        ESP_ERROR_CHECK( usb_host_client_unblock(s_msc_driver->client_handle) );
-        // In case the event handling started, we must wait until it finishes
-        xSemaphoreTake(s_msc_driver->all_events_handled, portMAX_DELAY);
+    if (s_msc_driver->shared_driver) {
+        ESP_ERROR_CHECK( usb_host_shared_client_remove_driver(s_msc_driver->shared_driver) );
+    } else {
+        if (s_msc_driver->event_handling_started) {
+            ESP_ERROR_CHECK( usb_host_client_unblock(s_msc_driver->client_handle) );
+            // In case the event handling started, we must wait until it finishes
+            xSemaphoreTake(s_msc_driver->all_events_handled, portMAX_DELAY);
+        }
+        ESP_ERROR_CHECK( usb_host_client_deregister(s_msc_driver->client_handle) );
     }
     vSemaphoreDelete(s_msc_driver->all_events_handled);
-    ESP_ERROR_CHECK( usb_host_client_deregister(s_msc_driver->client_handle) );
     free(s_msc_driver);
     s_msc_driver = NULL;
     return ESP_OK;
 }
 
+/**
+ * @brief Get capacity of a Logical Unit and create its disk
+ *
+ * @param[in] dev     MSC device
+ * @param[in] lun     Logical Unit Number
+ * @param[in] timeout Time to wait for the unit to get ready
+ * @return esp_err_t
+ */
+static esp_err_t msc_init_lun(msc_device_t *dev, uint8_t lun, size_t timeout_ms)
+{
+    uint32_t block_size, block_count;
+    uint64_t block_count64;
+    usb_disk_t *disk = &dev->disks[lun];
+
+    disk->lun = lun;
+    disk->device = dev;
+
+    MSC_RETURN_ON_ERROR( msc_wait_for_ready_state(dev, lun, timeout_ms) );
+    MSC_RETURN_ON_ERROR( scsi_cmd_read_capacity(dev, lun, &block_size, &block_count) );
+    block_count64 = block_count;
+    if (block_count == UINT32_MAX) {
+        // Capacity does not fit into READ CAPACITY(10) response
+        MSC_RETURN_ON_ERROR( scsi_cmd_read_capacity16(dev, lun, &block_size, &block_count64) );
+    }
+
+    disk->block_size = block_size;
+    disk->block_count = block_count64;
+
+    // Optional: UNMAP support and erase block size
+    scsi_block_limits_t limits;
+    disk->erase_block_size = 1;
+    if (!(dev->quirk.flags & MSC_HOST_QUIRK_NO_BLOCK_LIMITS) && scsi_cmd_block_limits(dev, lun, &limits) == ESP_OK) {
+        if (limits.max_unmap_lba_count && limits.max_unmap_descriptor_count) {
+            disk->unmap_max_sectors = limits.max_unmap_lba_count;
+        }
+        disk->max_transfer_sectors = limits.max_transfer_length;
+        if (limits.optimal_unmap_granularity) {
+            disk->erase_block_size = limits.optimal_unmap_granularity;
+        } else if (limits.optimal_transfer_granularity) {
+            disk->erase_block_size = limits.optimal_transfer_granularity;
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Probe all Logical Units of a newly attached device
+ *
+ * @param[in] dev MSC device
+ * @return esp_err_t
+ */
+static esp_err_t msc_probe_luns(msc_device_t *dev)
+{
+    MSC_RETURN_ON_ERROR( scsi_cmd_inquiry(dev, 0) );
+    MSC_RETURN_ON_ERROR( msc_init_lun(dev, 0, WAIT_FOR_READY_TIMEOUT_MS) );
+    for (uint8_t lun = 1; lun < dev->lun_count; lun++) {
+        // Other LUNs are typically slots of card readers, which can be empty
+        if (msc_init_lun(dev, lun, 0) != ESP_OK) {
+            ESP_LOGW(TAG, "LUN %d is not ready", lun);
+            dev->disks[lun].block_count = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Limit commands of all Logical Units to the quirk of the device
+ *
+ * Applied after probing and after restoring geometry from the device cache alike
+ */
+static void msc_apply_quirks(msc_device_t *dev)
+{
+    if (dev->quirk.max_sectors == 0) {
+        return;
+    }
+    for (uint8_t lun = 0; lun < dev->lun_count; lun++) {
+        usb_disk_t *disk = &dev->disks[lun];
+        if (disk->max_transfer_sectors == 0 || disk->max_transfer_sectors > dev->quirk.max_sectors) {
+            disk->max_transfer_sectors = dev->quirk.max_sectors;
+        }
+    }
+}
+
+#ifdef CONFIG_MSC_HOST_DEVICE_CACHE
+/**
+ * @brief Check that a Logical Unit with stored geometry is ready, without waiting for it
+ *
+ * Power on reset reported after attach is cleared by the failed command. Any other error, e.g. medium change,
+ * means the stored geometry may be stale.
+ */
+static esp_err_t msc_check_known_lun(msc_device_t *dev, uint8_t lun)
+{
+    scsi_sense_data_t sense = { 0 };
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        esp_err_t ret = scsi_cmd_unit_ready_sense(dev, lun, &sense);
+        if (ret == ESP_OK) {
+            return ESP_OK;
+        }
+        if (ret != ESP_FAIL || sense.key != MSC_UNIT_ATTENTION || sense.code != MSC_ASC_POWER_ON_RESET) {
+            break;
+        }
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+/**
+ * @brief Use stored geometry of a known device instead of probing it
+ *
+ * @param[in] dev MSC device
+ * @return esp_err_t
+ *    - ESP_OK: Device is known and ready
+ *    - Other: Device must be probed
+ */
+static esp_err_t msc_restore_luns(msc_device_t *dev)
+{
+    bool changed = false;
+
+    MSC_RETURN_ON_ERROR( msc_device_cache_load(dev) );
+    if (msc_check_known_lun(dev, 0) != ESP_OK) {
+        // Stale entry, the device must be probed with full timeout
+        msc_device_cache_remove(dev);
+        memset(dev->disks, 0, dev->lun_count * sizeof(usb_disk_t));
+        return ESP_ERR_INVALID_STATE;
+    }
+    dev->disks[0].lun = 0;
+    dev->disks[0].device = dev;
+    for (uint8_t lun = 1; lun < dev->lun_count; lun++) {
+        usb_disk_t *disk = &dev->disks[lun];
+        disk->lun = lun;
+        disk->device = dev;
+        if (disk->block_count && msc_check_known_lun(dev, lun) == ESP_OK) {
+            continue;
+        }
+        // Medium of a card reader slot was inserted, removed or changed
+        changed = true;
+        memset(disk, 0, sizeof(usb_disk_t));
+        if (msc_init_lun(dev, lun, 0) != ESP_OK) {
+            ESP_LOGW(TAG, "LUN %d is not ready", lun);
+            disk->block_count = 0;
+        }
+    }
+    if (changed) {
+        msc_device_cache_store(dev);
+    }
+    ESP_LOGD(TAG, "Known device, probing skipped");
+    return ESP_OK;
+}
+#endif // CONFIG_MSC_HOST_DEVICE_CACHE
+
 esp_err_t msc_host_install_device(uint8_t device_address, msc_host_device_handle_t *msc_device_handle)
 {
     esp_err_t ret;
-    uint32_t block_size, block_count;
+    uint8_t max_lun;
     const usb_config_desc_t *config_desc;
+    const usb_device_desc_t *device_desc;
     msc_device_t *msc_device;
 
     MSC_GOTO_ON_FALSE( msc_device = calloc(1, sizeof(msc_device_t)), ESP_ERR_NO_MEM );
@@ -494,21 +915,70 @@ esp_err_t msc_host_install_device(uint8_t device_address, msc_host_device_handle
     MSC_EXIT_CRITICAL();
 
     MSC_GOTO_ON_FALSE( msc_device->transfer_done = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM);
-    MSC_GOTO_ON_ERROR( usb_host_device_open(s_msc_driver->client_handle, device_address, &msc_device->handle) );
+    MSC_GOTO_ON_FALSE( msc_device->cmd_mutex = xSemaphoreCreateRecursiveMutex(), ESP_ERR_NO_MEM);
+    MSC_GOTO_ON_ERROR( usb_host_shared_client_device_open(s_msc_driver->client_handle, device_address, &msc_device->handle) );
     MSC_GOTO_ON_ERROR( usb_host_get_active_config_descriptor(msc_device->handle, &config_desc) );
     MSC_GOTO_ON_ERROR( extract_config_from_descriptor(config_desc, &msc_device->config) );
-    MSC_GOTO_ON_ERROR( usb_host_transfer_alloc(DEFAULT_XFER_SIZE, 0, &msc_device->xfer) );
+    MSC_GOTO_ON_ERROR( usb_host_get_device_descriptor(msc_device->handle, &device_desc) );
+    msc_quirks_find(device_desc->idVendor, device_desc->idProduct, s_msc_driver->quirks, s_msc_driver->quirk_count, &msc_device->quirk);
+    msc_device->timeout = s_msc_driver->timeout_config;
+    MSC_GOTO_ON_ERROR( usb_host_urb_pool_transfer_alloc(DEFAULT_XFER_SIZE, 0, &msc_device->xfer) );
+    MSC_GOTO_ON_ERROR( msc_pipeline_alloc(msc_device, s_msc_driver->pipeline_depth, s_msc_driver->pipeline_chunk_size) );
     MSC_GOTO_ON_ERROR( usb_host_interface_claim(
                            s_msc_driver->client_handle,
                            msc_device->handle,
-                           msc_device->config.iface_num, 0) );
-
-    MSC_GOTO_ON_ERROR( scsi_cmd_inquiry(msc_device) );
-    MSC_GOTO_ON_ERROR( msc_wait_for_ready_state(msc_device, WAIT_FOR_READY_TIMEOUT_MS) );
-    MSC_GOTO_ON_ERROR( scsi_cmd_read_capacity(msc_device, &block_size, &block_count) );
+                           msc_device->config.iface_num, msc_device->config.alt_setting) );
+    const usb_class_stats_info_t class_stats_info = {
+        .driver = "msc",
+        .dev_addr = device_address,
+        .intf_num = msc_device->config.iface_num,
+    };
+    usb_class_stats_register(&class_stats_info, &msc_device->class_stats); // Device is not counted on failure
+    // Buffers live as long as the device, they are released from the accounting when the entry is unregistered
+    USB_CLASS_STATS_MEM_ALLOC(msc_device->class_stats, sizeof(msc_device_t), MALLOC_CAP_DEFAULT);
+    USB_CLASS_STATS_MEM_XFER(msc_device->class_stats, msc_device->xfer);
+    for (size_t i = 0; i < msc_device->pipeline.depth; i++) {
+        USB_CLASS_STATS_MEM_XFER(msc_device->class_stats, msc_device->pipeline.entries[i].xfer);
+    }
 
-    msc_device->disk.block_size = block_size;
-    msc_device->disk.block_count = block_count;
+    if (msc_device->quirk.settle_ms) {
+        vTaskDelay(pdMS_TO_TICKS(msc_device->quirk.settle_ms));
+    }
+    if (msc_device->config.transport == MSC_TRANSPORT_UAS) {
+        MSC_GOTO_ON_ERROR( msc_set_interface(msc_device) );
+        MSC_GOTO_ON_FALSE( msc_device->uas.status_buffer = malloc(msc_device->config.bulk_in_mps), ESP_ERR_NO_MEM );
+        USB_CLASS_STATS_MEM_ALLOC(msc_device->class_stats, msc_device->config.bulk_in_mps, MALLOC_CAP_DEFAULT);
+        max_lun = 0; // GET MAX LUN is Bulk-Only Transport request
+    } else if (msc_get_max_lun(msc_device, &max_lun) != ESP_OK || max_lun >= MSC_HOST_MAX_LUN) {
+        // Devices with single LUN may STALL this request
+        max_lun = 0;
+    }
+    MSC_GOTO_ON_FALSE( msc_device->disks = calloc(max_lun + 1, sizeof(usb_disk_t)), ESP_ERR_NO_MEM );
+    USB_CLASS_STATS_MEM_ALLOC(msc_device->class_stats, (max_lun + 1) * sizeof(usb_disk_t), MALLOC_CAP_DEFAULT);
+    msc_device->lun_count = max_lun + 1;
+
+#ifdef CONFIG_MSC_HOST_DEVICE_CACHE
+    if (msc_restore_luns(msc_device) != ESP_OK) {
+        MSC_GOTO_ON_ERROR( msc_probe_luns(msc_device) );
+        if (msc_device_cache_store(msc_device) != ESP_OK) {
+            ESP_LOGD(TAG, "Device geometry not stored");
+        }
+    }
+#else
+    MSC_GOTO_ON_ERROR( msc_probe_luns(msc_device) );
+#endif
+    msc_apply_quirks(msc_device);
+    if (s_msc_driver->cache_config.size) {
+        for (uint8_t lun = 0; lun < msc_device->lun_count; lun++) {
+            usb_disk_t *disk = &msc_device->disks[lun];
+            if (disk->block_count) {
+                MSC_GOTO_ON_ERROR( msc_cache_create(disk, &s_msc_driver->cache_config, &disk->cache) );
+            }
+        }
+    }
+    if (s_msc_driver->async_config.queue_size) {
+        MSC_GOTO_ON_ERROR( msc_async_create(&s_msc_driver->async_config, msc_device, &msc_device->async) );
+    }
     *msc_device_handle = msc_device;
 
     return ESP_OK;
@@ -521,7 +991,19 @@ fail:
 esp_err_t msc_host_uninstall_device(msc_host_device_handle_t device)
 {
     MSC_RETURN_ON_INVALID_ARG(device);
-    return msc_deinit_device((msc_device_t *)device, false);
+    msc_device_t *dev = (msc_device_t *)device;
+
+    // Finish queued asynchronous requests
+    msc_async_delete(dev->async);
+    dev->async = NULL;
+
+    // Try to write dirty cached sectors. This fails if the device was already disconnected
+    for (uint8_t lun = 0; lun < dev->lun_count; lun++) {
+        if (dev->disks[lun].block_count && msc_cache_sync(&dev->disks[lun]) != ESP_OK) {
+            ESP_LOGW(TAG, "Cached sectors of LUN %d could not be written to the device", lun);
+        }
+    }
+    return msc_deinit_device(dev, false);
 }
 
 esp_err_t msc_host_read_sector(msc_host_device_handle_t device, size_t sector, void *data, size_t size)
@@ -529,7 +1011,7 @@ esp_err_t msc_host_read_sector(msc_host_device_handle_t device, size_t sector, v
     MSC_RETURN_ON_INVALID_ARG(device);
     msc_device_t *dev = (msc_device_t *)device;
 
-    return scsi_cmd_read10(dev, data, sector, 1, dev->disk.block_size);
+    return scsi_cmd_read10(dev, 0, data, sector, 1, dev->disks[0].block_size);
 }
 
 esp_err_t msc_host_write_sector(msc_host_device_handle_t device, size_t sector, const void *data, size_t size)
@@ -537,7 +1019,41 @@ esp_err_t msc_host_write_sector(msc_host_device_handle_t device, size_t sector,
     MSC_RETURN_ON_INVALID_ARG(device);
     msc_device_t *dev = (msc_device_t *)device;
 
-    return scsi_cmd_write10(dev, data, sector, 1, dev->disk.block_size);
+    return scsi_cmd_write10(dev, 0, data, sector, 1, dev->disks[0].block_size);
+}
+
+static esp_err_t msc_host_submit_async(msc_host_device_handle_t device, uint8_t lun, bool write, uint32_t sector,
+                                       uint32_t count, void *data, msc_host_io_done_cb_t callback, void *arg)
+{
+    MSC_RETURN_ON_INVALID_ARG(device);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_INVALID_ARG(callback);
+    msc_device_t *dev = (msc_device_t *)device;
+    MSC_RETURN_ON_FALSE(dev->async, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(lun < dev->lun_count && count > 0, ESP_ERR_INVALID_ARG);
+
+    const msc_async_request_t request = {
+        .lun = lun,
+        .write = write,
+        .sector = sector,
+        .count = count,
+        .data = data,
+        .callback = callback,
+        .arg = arg,
+    };
+    return msc_async_submit(dev->async, &request);
+}
+
+esp_err_t msc_host_read_sectors_async(msc_host_device_handle_t device, uint8_t lun, uint32_t sector, uint32_t count,
+                                      void *data, msc_host_io_done_cb_t callback, void *arg)
+{
+    return msc_host_submit_async(device, lun, false, sector, count, data, callback, arg);
+}
+
+esp_err_t msc_host_write_sectors_async(msc_host_device_handle_t device, uint8_t lun, uint32_t sector, uint32_t count,
+                                       const void *data, msc_host_io_done_cb_t callback, void *arg)
+{
+    return msc_host_submit_async(device, lun, true, sector, count, (void *)data, callback, arg);
 }
 
 static void copy_string_desc(wchar_t *dest, const usb_str_desc_t *src)
@@ -558,6 +1074,33 @@ static void copy_string_desc(wchar_t *dest, const usb_str_desc_t *src)
     }
 }
 
+size_t msc_recommended_allocation_unit(const usb_disk_t *disk)
+{
+    if (disk->erase_block_size <= 1) {
+        return 0;
+    }
+    // FATFS cluster is a power of two between 1 and 128 sectors
+    size_t sectors = 1;
+    while (sectors < disk->erase_block_size && sectors < 128) {
+        sectors *= 2;
+    }
+    return sectors * disk->block_size;
+}
+
+uint32_t msc_format_alignment(const usb_disk_t *disk)
+{
+    const uint32_t erase_block = disk->erase_block_size;
+    if (erase_block > 1 && erase_block <= 32768 && (erase_block & (erase_block - 1)) == 0) {
+        return erase_block;
+    }
+    // Alignment wastes at most 1/256 of small disks
+    uint64_t align = 4 * 1024 * 1024;
+    while (align > disk->block_size && align * 256 > disk->block_count * disk->block_size) {
+        align /= 2;
+    }
+    return MIN(MAX(align / disk->block_size, 1), 32768);
+}
+
 esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_device_info_t *info)
 {
     MSC_RETURN_ON_INVALID_ARG(device);
@@ -572,8 +1115,12 @@ esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_dev
 
     info->idProduct = desc->idProduct;
     info->idVendor = desc->idVendor;
-    info->sector_size = dev->disk.block_size;
-    info->sector_count = dev->disk.block_count;
+    info->sector_size = dev->disks[0].block_size;
+    info->sector_count = MIN(dev->disks[0].block_count, UINT32_MAX);
+    info->lun_count = dev->lun_count;
+    info->max_transfer_size = (uint32_t)MIN((uint64_t)dev->disks[0].max_transfer_sectors * dev->disks[0].block_size, UINT32_MAX);
+    info->allocation_unit_size = msc_recommended_allocation_unit(&dev->disks[0]);
+    info->buffer_alignment = USB_DMA_BUF_ALIGN;
 
     copy_string_desc(info->iManufacturer, dev_info.str_desc_manufacturer);
     copy_string_desc(info->iProduct, dev_info.str_desc_product);
@@ -582,8 +1129,74 @@ esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_dev
     return ESP_OK;
 }
 
+#ifdef CONFIG_MSC_HOST_STATS
+void msc_stats_command_done(msc_device_t *device, int64_t latency_us, bool data_in, size_t size, esp_err_t result)
+{
+    msc_host_stats_t *stats = &device->stats;
+    const uint32_t latency = MIN(latency_us, UINT32_MAX);
+
+    stats->commands++;
+    if (result != ESP_OK) {
+        stats->errors++;
+    } else if (data_in) {
+        stats->bytes_read += size;
+    } else {
+        stats->bytes_written += size;
+    }
+    stats->max_latency_us = MAX(stats->max_latency_us, latency);
+
+    // Logarithmic buckets: bucket n ends at 128 << n us
+    size_t bucket = 0;
+    while (bucket < MSC_HOST_STATS_LATENCY_BUCKETS - 1 && latency >= (128UL << bucket)) {
+        bucket++;
+    }
+    stats->latency_histogram[bucket]++;
+}
+#endif
+
+esp_err_t msc_host_get_stats(msc_host_device_handle_t device, msc_host_stats_t *stats)
+{
+    MSC_RETURN_ON_INVALID_ARG(device);
+    MSC_RETURN_ON_INVALID_ARG(stats);
+#ifdef CONFIG_MSC_HOST_STATS
+    msc_device_t *dev = (msc_device_t *)device;
+
+    xSemaphoreTakeRecursive(dev->cmd_mutex, portMAX_DELAY);
+    *stats = dev->stats;
+    xSemaphoreGiveRecursive(dev->cmd_mutex);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t msc_host_clear_stats(msc_host_device_handle_t device)
+{
+    MSC_RETURN_ON_INVALID_ARG(device);
+#ifdef CONFIG_MSC_HOST_STATS
+    msc_device_t *dev = (msc_device_t *)device;
+
+    xSemaphoreTakeRecursive(dev->cmd_mutex, portMAX_DELAY);
+    memset(&dev->stats, 0, sizeof(dev->stats));
+    xSemaphoreGiveRecursive(dev->cmd_mutex);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t msc_host_clear_device_cache(void)
+{
+#ifdef CONFIG_MSC_HOST_DEVICE_CACHE
+    return msc_device_cache_clear();
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 esp_err_t msc_host_print_descriptors(msc_host_device_handle_t device)
 {
+#ifndef CONFIG_MSC_HOST_MINIMAL
     msc_device_t *dev = (msc_device_t *)device;
     const usb_device_desc_t *device_desc;
     const usb_config_desc_t *config_desc;
@@ -591,12 +1204,15 @@ esp_err_t msc_host_print_descriptors(msc_host_device_handle_t device)
     MSC_RETURN_ON_ERROR( usb_host_get_active_config_descriptor(dev->handle, &config_desc) );
     usb_print_device_descriptor(device_desc);
     usb_print_config_descriptor(config_desc, NULL);
+#endif // CONFIG_MSC_HOST_MINIMAL
     return ESP_OK;
 }
 
 static void transfer_callback(usb_transfer_t *transfer)
 {
     msc_device_t *device = (msc_device_t *)transfer->context;
+    MSC_TRACE(COMPLETE, transfer);
+    msc_class_stats_xfer(device, transfer);
 
     if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
         ESP_LOGE("Transfer failed", "Status %d", transfer->status);
@@ -605,6 +1221,76 @@ static void transfer_callback(usb_transfer_t *transfer)
     xSemaphoreGive(device->transfer_done);
 }
 
+/**
+ * @brief Set data buffer of a transfer
+ *
+ * Since data_buffer and data_buffer_size in usb_transfer_t are constant, we must cast away the const qualifier.
+ * The original buffer must be restored before the transfer is freed.
+ */
+static inline void transfer_set_buffer(usb_transfer_t *xfer, uint8_t *buffer, size_t size)
+{
+    uint8_t **buffer_ptr = (uint8_t **)(&(xfer->data_buffer));
+    size_t *buffer_size_ptr = (size_t *)(&(xfer->data_buffer_size));
+    *buffer_ptr = buffer;
+    *buffer_size_ptr = size;
+}
+
+static inline void transfer_cancel(usb_transfer_t *xfer)
+{
+    usb_host_endpoint_halt(xfer->device_handle, xfer->bEndpointAddress);
+    usb_host_endpoint_flush(xfer->device_handle, xfer->bEndpointAddress);
+    usb_host_endpoint_clear(xfer->device_handle, xfer->bEndpointAddress);
+}
+
+/**
+ * @brief Get timeout of a bulk transfer
+ *
+ * Adaptive timeout is derived from smoothed duration of previous transfers as in TCP (RFC 6298),
+ * scaled by number of MSC_TIMEOUT_REF_SIZE blocks in the transfer and clamped to configured bounds.
+ *
+ * @param[in] device MSC device
+ * @param[in] size   Size of the transfer in bytes
+ * @return Timeout in milliseconds
+ */
+static uint32_t msc_transfer_timeout_ms(const msc_device_t *device, size_t size)
+{
+    const msc_timeout_t *timeout = &device->timeout;
+    if (timeout->min_ms == 0 || timeout->srtt_us == 0) {
+        return timeout->max_ms;
+    }
+
+    const int64_t blocks = (size + MSC_TIMEOUT_REF_SIZE - 1) / MSC_TIMEOUT_REF_SIZE;
+    const int64_t rto_ms = (timeout->srtt_us + 4 * timeout->rttvar_us) * MAX(blocks, 1) / 1000 + 1;
+    return MIN(MAX(rto_ms, timeout->min_ms), timeout->max_ms);
+}
+
+/**
+ * @brief Update smoothed transfer duration with a new sample
+ *
+ * @param[in] device      MSC device
+ * @param[in] size        Size of the finished transfer in bytes
+ * @param[in] duration_us Duration of the transfer
+ */
+static void msc_transfer_timeout_update(msc_device_t *device, size_t size, int64_t duration_us)
+{
+    msc_timeout_t *timeout = &device->timeout;
+    if (timeout->min_ms == 0) {
+        return;
+    }
+
+    const int64_t blocks = (size + MSC_TIMEOUT_REF_SIZE - 1) / MSC_TIMEOUT_REF_SIZE;
+    const int64_t sample = MAX(duration_us / MAX(blocks, 1), 1);
+    if (timeout->srtt_us == 0) {
+        timeout->srtt_us = sample;
+        timeout->rttvar_us = sample / 2;
+    } else {
+        const int64_t delta = sample > timeout->srtt_us ? sample - timeout->srtt_us : timeout->srtt_us - sample;
+        timeout->rttvar_us += (delta - timeout->rttvar_us) / 4;
+        timeout->srtt_us += (sample - timeout->srtt_us) / 8;
+        timeout->srtt_us = MAX(timeout->srtt_us, 1);
+    }
+}
+
 static usb_transfer_status_t wait_for_transfer_done(usb_transfer_t *xfer)
 {
     msc_device_t *device = (msc_device_t *)xfer->context;
@@ -612,9 +1298,7 @@ static usb_transfer_status_t wait_for_transfer_done(usb_transfer_t *xfer)
     usb_transfer_status_t status = xfer->status;
 
     if (received != pdTRUE) {
-        usb_host_endpoint_halt(xfer->device_handle, xfer->bEndpointAddress);
-        usb_host_endpoint_flush(xfer->device_handle, xfer->bEndpointAddress);
-        usb_host_endpoint_clear(xfer->device_handle, xfer->bEndpointAddress);
+        transfer_cancel(xfer);
         xSemaphoreTake(device->transfer_done, portMAX_DELAY); // Since we flushed the EP, this should return immediately
         status = USB_TRANSFER_STATUS_TIMED_OUT;
     }
@@ -622,42 +1306,118 @@ static usb_transfer_status_t wait_for_transfer_done(usb_transfer_t *xfer)
     return status;
 }
 
+/**
+ * @brief Check whether the data can be transferred directly from/to the caller's buffer
+ *
+ * The buffer is accessed by the USB DMA, so it must be DMA capable and aligned, see usb_dma_buf_is_dma_ready().
+ * IN transfers must be a multiple of MPS, so the device cannot write outside of the buffer.
+ *
+ * @param[in] device MSC device handle
+ * @param[in] data   Caller's buffer
+ * @param[in] size   Size of the caller's buffer in bytes
+ * @return true if zero-copy transfer is possible
+ */
+static inline bool msc_zero_copy_possible(const msc_device_t *device, const uint8_t *data, size_t size)
+{
+    const size_t mps = device->config.bulk_in_mps;
+    return (mps != 0) &&
+           (size >= mps) &&
+           (size % mps == 0) &&
+           usb_dma_buf_is_dma_ready(data, size);
+}
+
+static uint8_t msc_endpoint_address(const msc_device_t *device, msc_endpoint_t ep)
+{
+    switch (ep) {
+    case MSC_EP_IN: return device->config.bulk_in_ep;
+    case MSC_EP_UAS_COMMAND: return device->config.uas_command_ep;
+    case MSC_EP_UAS_STATUS: return device->config.uas_status_ep;
+    default: return device->config.bulk_out_ep;
+    }
+}
+
+static inline bool msc_endpoint_is_in(msc_endpoint_t ep)
+{
+    return ep == MSC_EP_IN || ep == MSC_EP_UAS_STATUS;
+}
+
+esp_err_t msc_transfer_reserve(msc_device_t *device, size_t size)
+{
+    esp_err_t ret = ESP_OK;
+    size = usb_round_up_to_mps(size, device->config.bulk_in_mps);
+
+    xSemaphoreTakeRecursive(device->cmd_mutex, portMAX_DELAY);
+    if (device->xfer->data_buffer_size < size) {
+        // Allocate the new transfer first, so the device keeps a valid transfer if allocation fails
+        usb_transfer_t *xfer;
+        ret = usb_host_urb_pool_transfer_alloc(size, 0, &xfer);
+        if (ret == ESP_OK) {
+            usb_host_urb_pool_transfer_free(device->xfer);
+            device->xfer = xfer;
+        }
+    }
+    xSemaphoreGiveRecursive(device->cmd_mutex);
+    return ret;
+}
+
 esp_err_t msc_bulk_transfer(msc_device_t *device, uint8_t *data, size_t size, msc_endpoint_t ep)
 {
     esp_err_t ret = ESP_OK;
     usb_transfer_t *xfer = device->xfer;
-    size_t transfer_size = (ep == MSC_EP_IN) ? usb_round_up_to_mps(size, device->config.bulk_in_mps) : size;
+    const bool ep_in = msc_endpoint_is_in(ep);
+    size_t transfer_size = ep_in ? usb_round_up_to_mps(size, device->config.bulk_in_mps) : size;
+    const bool zero_copy = msc_zero_copy_possible(device, data, size);
+
+    uint8_t *const bounce_buffer = xfer->data_buffer;
+    const size_t bounce_buffer_size = xfer->data_buffer_size;
 
-    if (xfer->data_buffer_size < transfer_size) {
+    if (zero_copy) {
+        // Point the transfer directly to caller's buffer. The original buffer is restored after the transfer
+        transfer_set_buffer(xfer, data, size);
+    } else if (xfer->data_buffer_size < transfer_size) {
         // The allocated buffer is not large enough -> realloc
-        MSC_RETURN_ON_ERROR( usb_host_transfer_free(xfer) );
-        MSC_RETURN_ON_ERROR( usb_host_transfer_alloc(transfer_size, 0, &device->xfer) );
+        MSC_RETURN_ON_ERROR( msc_transfer_reserve(device, transfer_size) );
         xfer = device->xfer;
     }
 
-    if (ep == MSC_EP_IN) {
-        xfer->bEndpointAddress = device->config.bulk_in_ep;
-    } else {
-        xfer->bEndpointAddress = device->config.bulk_out_ep;
-        memcpy(xfer->data_buffer, data, size);
+    xfer->bEndpointAddress = msc_endpoint_address(device, ep);
+    if (!ep_in) {
+        if (!zero_copy) {
+            memcpy(xfer->data_buffer, data, size);
+        }
     }
 
     xfer->num_bytes = transfer_size;
     xfer->device_handle = device->handle;
     xfer->callback = transfer_callback;
-    xfer->timeout_ms = 5000;
+    xfer->timeout_ms = msc_transfer_timeout_ms(device, transfer_size);
     xfer->context = device;
 
-    MSC_RETURN_ON_ERROR( usb_host_transfer_submit(xfer) );
-    const usb_transfer_status_t status = wait_for_transfer_done(xfer);
+    usb_transfer_status_t status = USB_TRANSFER_STATUS_ERROR;
+    const int64_t start = esp_timer_get_time();
+    MSC_TRACE(SUBMIT, xfer);
+    ret = usb_host_transfer_submit(xfer);
+    if (ret == ESP_OK) {
+        status = wait_for_transfer_done(xfer);
+    }
+    if (status == USB_TRANSFER_STATUS_COMPLETED) {
+        msc_transfer_timeout_update(device, transfer_size, esp_timer_get_time() - start);
+    }
+
+    if (zero_copy) {
+        transfer_set_buffer(xfer, bounce_buffer, bounce_buffer_size);
+    }
+    MSC_RETURN_ON_ERROR(ret);
+
     switch (status) {
     case USB_TRANSFER_STATUS_COMPLETED:
-        if (ep == MSC_EP_IN) {
+        if (ep_in && !zero_copy) {
             memcpy(data, xfer->data_buffer, xfer->actual_num_bytes);
         }
         ret = ESP_OK;
         break;
     case USB_TRANSFER_STATUS_STALL:
+        MSC_STATS_ADD(device, stalls, 1);
         ret = ESP_ERR_MSC_STALL; break;
     default:
         ret = ESP_ERR_MSC_INTERNAL; break;
@@ -666,13 +1426,115 @@ esp_err_t msc_bulk_transfer(msc_device_t *device, uint8_t *data, size_t size, ms
     return ret;
 }
 
+size_t msc_max_bulk_transfer_size(const msc_device_t *device)
+{
+    return device->pipeline.depth < 2 ? SIZE_MAX : device->pipeline.chunk_size;
+}
+
+esp_err_t msc_bulk_transfer_pipelined(msc_device_t *device, uint8_t *data, size_t size, msc_endpoint_t ep)
+{
+    msc_pipeline_t *pipeline = &device->pipeline;
+    if (pipeline->depth < 2 || size <= pipeline->chunk_size) {
+        return msc_bulk_transfer(device, data, size, ep);
+    }
+
+    esp_err_t ret = ESP_OK;
+    const size_t chunk_size = pipeline->chunk_size;
+    const size_t chunks = (size + chunk_size - 1) / chunk_size;
+    const bool ep_in = msc_endpoint_is_in(ep);
+    const uint8_t ep_addr = msc_endpoint_address(device, ep);
+    const uint32_t timeout_ms = msc_transfer_timeout_ms(device, chunk_size);
+    const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    size_t submitted = 0;
+    size_t completed = 0;
+    int64_t last_done = esp_timer_get_time(); // With full pipeline, chunks finish one chunk duration apart
+
+    while (completed < chunks) {
+        // Keep the endpoint busy: submit next chunks until all transfers are in flight
+        while (ret == ESP_OK && submitted < chunks && (submitted - completed) < pipeline->depth) {
+            usb_transfer_t *xfer = pipeline->entries[submitted % pipeline->depth].xfer;
+            uint8_t *chunk = data + submitted * chunk_size;
+            const size_t len = MIN(chunk_size, size - submitted * chunk_size);
+
+            if (msc_zero_copy_possible(device, chunk, len)) {
+                transfer_set_buffer(xfer, chunk, len);
+            } else if (!ep_in) {
+                memcpy(xfer->data_buffer, chunk, len);
+            }
+            xfer->bEndpointAddress = ep_addr;
+            xfer->num_bytes = ep_in ? usb_round_up_to_mps(len, device->config.bulk_in_mps) : len;
+            xfer->timeout_ms = timeout_ms;
+            if (submitted < pipeline->depth) {
+                MSC_TRACE(SUBMIT, xfer);
+            } else {
+                MSC_TRACE(RESUBMIT, xfer); // Transfer of a completed chunk reused for the next one
+            }
+            ret = usb_host_transfer_submit(xfer);
+            if (ret != ESP_OK) {
+                const msc_pipeline_entry_t *entry = &pipeline->entries[submitted % pipeline->depth];
+                transfer_set_buffer(xfer, entry->bounce_buffer, entry->bounce_buffer_size);
+                break;
+            }
+            submitted++;
+        }
+
+        if (completed == submitted) {
+            break; // Nothing in flight, submission failed
+        }
+
+        // Transfers on one endpoint finish in order of submission
+        const msc_pipeline_entry_t *entry = &pipeline->entries[completed % pipeline->depth];
+        usb_transfer_t *xfer = entry->xfer;
+        if (xSemaphoreTake(pipeline->done, timeout) != pdTRUE) {
+            // Flushing the endpoint finishes all transfers in flight, they are collected below
+            transfer_cancel(xfer);
+            ret = ESP_ERR_MSC_INTERNAL;
+            xSemaphoreTake(pipeline->done, portMAX_DELAY);
+        }
+
+        const size_t expected = MIN(chunk_size, size - completed * chunk_size);
+        const bool zero_copy = (xfer->data_buffer != entry->bounce_buffer);
+        if (ret == ESP_OK) {
+            if (xfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+                ret = (xfer->status == USB_TRANSFER_STATUS_STALL) ? ESP_ERR_MSC_STALL : ESP_ERR_MSC_INTERNAL;
+                if (ret == ESP_ERR_MSC_STALL) {
+                    MSC_STATS_ADD(device, stalls, 1);
+                }
+            } else if (xfer->actual_num_bytes < expected) {
+                ret = ESP_ERR_MSC_INTERNAL; // Short packet, the device ended the data phase early
+            } else {
+                const int64_t now = esp_timer_get_time();
+                msc_transfer_timeout_update(device, expected, now - last_done);
+                last_done = now;
+                if (ep_in && !zero_copy) {
+                    memcpy(data + completed * chunk_size, xfer->data_buffer, expected);
+                }
+            }
+            if (ret != ESP_OK && (completed + 1) < submitted) {
+                // Transfers still in flight must not consume the status stage
+                transfer_cancel(xfer);
+            }
+        }
+        if (zero_copy) {
+            transfer_set_buffer(xfer, entry->bounce_buffer, entry->bounce_buffer_size);
+        }
+        completed++;
+
+        if (ret != ESP_OK && completed == submitted) {
+            break;
+        }
+    }
+
+    return ret;
+}
+
 esp_err_t msc_control_transfer(msc_device_t *device, size_t len)
 {
     usb_transfer_t *xfer = device->xfer;
     xfer->device_handle = device->handle;
     xfer->bEndpointAddress = 0;
     xfer->callback = transfer_callback;
-    xfer->timeout_ms = 5000;
+    xfer->timeout_ms = device->timeout.max_ms;
     xfer->num_bytes = len;
     xfer->context = device;
 
@@ -689,10 +1551,26 @@ esp_err_t msc_host_reset_recovery(msc_host_device_handle_t device)
     // (b) a Clear Feature HALT to the Bulk-In endpoint
     // (c) a Clear Feature HALT to the Bulk-Out endpoint
 
-    ESP_RETURN_ON_ERROR( msc_mass_reset(device), TAG, "Mass reset failed" );
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTakeRecursive(device->cmd_mutex, portMAX_DELAY);
+    MSC_STATS_ADD(device, reset_recoveries, 1);
+    const bool recovering = device->timeout.recovering;
+    device->timeout.recovering = true; // Commands issued here must not recurse into another recovery
+
+    if (device->config.transport == MSC_TRANSPORT_UAS) {
+        // UAS has no class-specific reset, halted pipes are simply cleared
+        clear_feature(device, device->config.uas_command_ep);
+        clear_feature(device, device->config.uas_status_ep);
+    } else {
+        ESP_GOTO_ON_ERROR( msc_mass_reset(device), fail, TAG, "Mass reset failed" );
+    }
     // Clear feature will fail if there is not STALL on the endpoint, so we don't check the errors here
     clear_feature(device, device->config.bulk_in_ep);
     clear_feature(device, device->config.bulk_out_ep);
-    MSC_RETURN_ON_ERROR( msc_wait_for_ready_state(device, WAIT_FOR_READY_TIMEOUT_MS) );
-    return ESP_OK;
+    MSC_GOTO_ON_ERROR( msc_wait_for_ready_state(device, 0, WAIT_FOR_READY_TIMEOUT_MS) );
+
+fail:
+    device->timeout.recovering = recovering;
+    xSemaphoreGiveRecursive(device->cmd_mutex);
+    return ret;
 }
@@ -5,7 +5,9 @@
  */
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
 #include "msc_common.h"
@@ -16,29 +18,43 @@
 #include "esp_idf_version.h"
 
 #define DRIVE_STR_LEN 3
+#define MSC_VFS_EXFAT_MIN_SIZE (32ULL * 1024 * 1024 * 1024) // Media over 32 GB are formatted as exFAT, as SDXC cards are
 
 typedef struct msc_host_vfs {
     char drive[DRIVE_STR_LEN];
     char *base_path;
     uint8_t pdrv;
+    usb_disk_t *disk;
 } msc_host_vfs_t;
 
+typedef struct msc_host_vfs_stream {
+    FIL file;
+    usb_disk_t *disk;
+    uint32_t next_sector;   // Sector of the extent to be written next
+    uint32_t max_run;       // Maximum number of sectors written at once
+    size_t written;         // Bytes written to the stream, including the partial sector
+    size_t max_size;        // Size of the extent requested by the user
+    size_t partial_len;     // Bytes in the partial sector buffer
+    uint8_t *partial;       // Sector that is not complete yet
+} msc_host_vfs_stream_t;
+
 static const char *TAG = "MSC VFS";
 
-static esp_err_t msc_format_storage(size_t block_size, size_t allocation_size, const char *drv)
+static esp_err_t msc_format_storage(size_t block_size, size_t allocation_size, BYTE fmt, const char *drv)
 {
     void *workbuf = NULL;
     const size_t workbuf_size = 4096;
 
     MSC_RETURN_ON_FALSE( workbuf = ff_memalloc(workbuf_size), ESP_ERR_NO_MEM );
 
-    // Valid value of cluster size is between sector_size and 128 * sector_size.
-    size_t cluster_size = MIN(MAX(allocation_size, block_size), 128 * block_size);
+    // Valid value of cluster size is between sector_size and 128 * sector_size, exFAT allows up to 32 MB
+    const size_t max_cluster_size = (fmt & FM_EXFAT) ? 32 * 1024 * 1024 : 128 * block_size;
+    size_t cluster_size = MIN(MAX(allocation_size, block_size), max_cluster_size);
 
 #if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
-    FRESULT err = f_mkfs(drv, FM_ANY | FM_SFD, cluster_size, workbuf, workbuf_size);
+    FRESULT err = f_mkfs(drv, fmt | FM_SFD, cluster_size, workbuf, workbuf_size);
 #else
-    const MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, 0, 0, cluster_size};
+    const MKFS_PARM opt = {(BYTE)(fmt | FM_SFD), 0, 0, 0, cluster_size};
     FRESULT err = f_mkfs(drv, &opt, workbuf, workbuf_size);
 #endif
 
@@ -58,10 +74,41 @@ esp_err_t msc_host_vfs_format(msc_host_device_handle_t device, const esp_vfs_fat
     MSC_RETURN_ON_INVALID_ARG(mount_config);
     MSC_RETURN_ON_INVALID_ARG(vfs_handle);
 
-    size_t block_size = ((msc_device_t *)device)->disk.block_size;
-    size_t alloc_size = mount_config->allocation_unit_size;
+    size_t block_size = vfs_handle->disk->block_size;
+    size_t alloc_size = mount_config->allocation_unit_size ?
+                        mount_config->allocation_unit_size : msc_recommended_allocation_unit(vfs_handle->disk);
 
-    return msc_format_storage(block_size, alloc_size, vfs_handle->drive);
+    return msc_format_storage(block_size, alloc_size, FM_ANY, vfs_handle->drive);
+}
+
+esp_err_t msc_host_vfs_format_aligned(msc_host_vfs_handle_t vfs_handle, const msc_host_vfs_format_config_t *config)
+{
+    MSC_RETURN_ON_INVALID_ARG(vfs_handle);
+    MSC_RETURN_ON_INVALID_ARG(config);
+
+    usb_disk_t *disk = vfs_handle->disk;
+    const size_t block_size = disk->block_size;
+    const uint32_t alignment = msc_format_alignment(disk);
+    BYTE fmt = FM_FAT | FM_FAT32;
+    size_t max_cluster_size = 32 * 1024;
+    if (config->exfat && disk->block_count * block_size > MSC_VFS_EXFAT_MIN_SIZE) {
+#if FF_FS_EXFAT
+        fmt = FM_EXFAT;
+        max_cluster_size = 128 * 1024;
+#else
+        ESP_LOGW(TAG, "FATFS is built without exFAT support, formatting as FAT");
+#endif
+    }
+
+    // Clusters divide the alignment, so no cluster crosses an erase block
+    size_t alloc_size = config->allocation_unit_size ?
+                        config->allocation_unit_size : MIN((size_t)alignment * block_size, max_cluster_size);
+
+    ESP_LOGD(TAG, "Formatting with data area aligned to %" PRIu32 " sectors, %zu B clusters", alignment, alloc_size);
+    disk->format_alignment = alignment;
+    esp_err_t ret = msc_format_storage(block_size, alloc_size, fmt, vfs_handle->drive);
+    disk->format_alignment = 0;
+    return ret;
 }
 
 static void dealloc_msc_vfs(msc_host_vfs_t *vfs)
@@ -74,6 +121,15 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
                                 const char *base_path,
                                 const esp_vfs_fat_mount_config_t *mount_config,
                                 msc_host_vfs_handle_t *vfs_handle)
+{
+    return msc_host_vfs_register_lun(device, 0, base_path, mount_config, vfs_handle);
+}
+
+esp_err_t msc_host_vfs_register_lun(msc_host_device_handle_t device,
+                                    uint8_t lun,
+                                    const char *base_path,
+                                    const esp_vfs_fat_mount_config_t *mount_config,
+                                    msc_host_vfs_handle_t *vfs_handle)
 {
     MSC_RETURN_ON_INVALID_ARG(device);
     MSC_RETURN_ON_INVALID_ARG(base_path);
@@ -85,21 +141,26 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
     bool diskio_registered = false;
     esp_err_t ret = ESP_ERR_MSC_MOUNT_FAILED;
     msc_device_t *dev = (msc_device_t *)device;
-    size_t block_size = dev->disk.block_size;
-    size_t alloc_size = mount_config->allocation_unit_size;
+    MSC_RETURN_ON_FALSE(lun < dev->lun_count, ESP_ERR_INVALID_ARG);
+    usb_disk_t *disk = &dev->disks[lun];
+    MSC_RETURN_ON_FALSE(disk->block_count > 0, ESP_ERR_NOT_FOUND);
+    size_t block_size = disk->block_size;
+    size_t alloc_size = mount_config->allocation_unit_size ?
+                        mount_config->allocation_unit_size : msc_recommended_allocation_unit(disk);
 
     msc_host_vfs_t *vfs = calloc(1, sizeof(msc_host_vfs_t));
     MSC_RETURN_ON_FALSE(vfs != NULL, ESP_ERR_NO_MEM);
 
     MSC_GOTO_ON_ERROR( ff_diskio_get_drive(&pdrv) );
 
-    ff_diskio_register_msc(pdrv, &dev->disk);
+    ff_diskio_register_msc(pdrv, disk);
     char drive[DRIVE_STR_LEN] = {(char)('0' + pdrv), ':', 0};
     diskio_registered = true;
 
     strncpy(vfs->drive, drive, DRIVE_STR_LEN);
     MSC_GOTO_ON_FALSE( vfs->base_path = strdup(base_path), ESP_ERR_NO_MEM );
     vfs->pdrv = pdrv;
+    vfs->disk = disk;
 
     MSC_GOTO_ON_ERROR( esp_vfs_fat_register(base_path, drive, mount_config->max_files, &fs) );
 
@@ -108,13 +169,23 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
     if ( fresult != FR_OK) {
         if (mount_config->format_if_mount_failed &&
                 (fresult == FR_NO_FILESYSTEM || fresult == FR_INT_ERR)) {
-            MSC_GOTO_ON_ERROR( msc_format_storage(block_size, alloc_size, drive) );
+            MSC_GOTO_ON_ERROR( msc_format_storage(block_size, alloc_size, FM_ANY, drive) );
             MSC_GOTO_ON_FALSE( f_mount(fs, drive, 0) == FR_OK, ESP_ERR_MSC_MOUNT_FAILED );
         } else {
             goto fail;
         }
     }
 
+    // FATFS reads whole clusters directly into the caller's buffer. Size the bulk transfer for them now,
+    // so it is not reallocated on the first large access
+    size_t transfer_size = MIN((size_t)fs->csize * block_size, msc_max_bulk_transfer_size(dev));
+    if (disk->max_transfer_sectors) {
+        transfer_size = MIN(transfer_size, (size_t)disk->max_transfer_sectors * block_size);
+    }
+    if (msc_transfer_reserve(dev, transfer_size) != ESP_OK) {
+        ESP_LOGW(TAG, "Transfer buffer of %zu bytes could not be allocated", transfer_size);
+    }
+
     *vfs_handle = vfs;
     return ESP_OK;
 
@@ -141,3 +212,139 @@ esp_err_t msc_host_vfs_unregister(msc_host_vfs_handle_t vfs_handle)
     dealloc_msc_vfs(vfs);
     return ESP_OK;
 }
+
+esp_err_t msc_host_vfs_stream_open(msc_host_vfs_handle_t vfs_handle, const char *path, size_t max_size, msc_host_vfs_stream_handle_t *stream_handle)
+{
+    MSC_RETURN_ON_INVALID_ARG(vfs_handle);
+    MSC_RETURN_ON_INVALID_ARG(path);
+    MSC_RETURN_ON_INVALID_ARG(stream_handle);
+    MSC_RETURN_ON_FALSE(max_size > 0, ESP_ERR_INVALID_SIZE);
+#if FF_USE_EXPAND
+    msc_host_vfs_t *vfs = (msc_host_vfs_t *)vfs_handle;
+    const size_t base_len = strlen(vfs->base_path);
+    MSC_RETURN_ON_FALSE(strncmp(path, vfs->base_path, base_len) == 0 && path[base_len] == '/', ESP_ERR_INVALID_ARG);
+
+    esp_err_t ret;
+    bool file_open = false;
+    usb_disk_t *disk = vfs->disk;
+    msc_host_vfs_stream_t *stream = calloc(1, sizeof(msc_host_vfs_stream_t));
+    MSC_RETURN_ON_FALSE(stream != NULL, ESP_ERR_NO_MEM);
+    MSC_GOTO_ON_FALSE( stream->partial = malloc(disk->block_size), ESP_ERR_NO_MEM );
+
+    // FATFS path is the drive followed by the path within the base path
+    const size_t fat_path_len = DRIVE_STR_LEN + strlen(path + base_len);
+    char *fat_path = malloc(fat_path_len);
+    MSC_GOTO_ON_FALSE( fat_path, ESP_ERR_NO_MEM );
+    snprintf(fat_path, fat_path_len, "%s%s", vfs->drive, path + base_len);
+    FRESULT fresult = f_open(&stream->file, fat_path, FA_WRITE | FA_CREATE_ALWAYS);
+    free(fat_path);
+    if (fresult != FR_OK) {
+        ESP_LOGE(TAG, "Could not create %s: %d", path, fresult);
+        ret = ESP_FAIL;
+        goto fail;
+    }
+    file_open = true;
+
+    fresult = f_expand(&stream->file, max_size, 1);
+    if (fresult != FR_OK) {
+        ESP_LOGE(TAG, "Could not allocate %zu contiguous bytes: %d", max_size, fresult);
+        ret = (fresult == FR_DENIED) ? ESP_ERR_INVALID_SIZE : ESP_FAIL;
+        goto fail;
+    }
+
+    // First sector of the first cluster. Clusters are numbered from 2
+    FATFS *fs = stream->file.obj.fs;
+    stream->next_sector = (uint32_t)(fs->database + (uint64_t)fs->csize * (stream->file.obj.sclust - 2));
+    stream->disk = disk;
+    stream->max_size = max_size;
+    // Without pipelining, commands longer than the cluster the transfer buffer was sized for reallocate the buffer
+    stream->max_run = (msc_max_bulk_transfer_size(disk->device) == SIZE_MAX) ? fs->csize : UINT32_MAX;
+
+    *stream_handle = stream;
+    return ESP_OK;
+
+fail:
+    if (file_open) {
+        f_close(&stream->file);
+    }
+    free(stream->partial);
+    free(stream);
+    return ret;
+#else
+    ESP_LOGE(TAG, "Streaming requires FATFS with FF_USE_EXPAND");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t msc_host_vfs_stream_write(msc_host_vfs_stream_handle_t stream_handle, const void *data, size_t size)
+{
+    MSC_RETURN_ON_INVALID_ARG(stream_handle);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    msc_host_vfs_stream_t *stream = (msc_host_vfs_stream_t *)stream_handle;
+    MSC_RETURN_ON_FALSE(size <= stream->max_size - stream->written, ESP_ERR_INVALID_SIZE);
+
+    usb_disk_t *disk = stream->disk;
+    const size_t block_size = disk->block_size;
+    const uint8_t *src = data;
+    const size_t total = size;
+
+    // Complete the partial sector first
+    if (stream->partial_len) {
+        const size_t len = MIN(size, block_size - stream->partial_len);
+        memcpy(stream->partial + stream->partial_len, src, len);
+        stream->partial_len += len;
+        src += len;
+        size -= len;
+        if (stream->partial_len < block_size) {
+            stream->written += total;
+            return ESP_OK;
+        }
+        MSC_RETURN_ON_ERROR( msc_cache_write(disk, stream->partial, stream->next_sector, 1) );
+        stream->next_sector++;
+        stream->partial_len = 0;
+    }
+
+    // Whole sectors go straight from the caller's buffer
+    uint32_t sectors = size / block_size;
+    while (sectors) {
+        const uint32_t run = MIN(sectors, stream->max_run);
+        MSC_RETURN_ON_ERROR( msc_cache_write(disk, src, stream->next_sector, run) );
+        stream->next_sector += run;
+        src += run * block_size;
+        sectors -= run;
+    }
+
+    stream->partial_len = size % block_size;
+    memcpy(stream->partial, src, stream->partial_len);
+    stream->written += total;
+    return ESP_OK;
+}
+
+esp_err_t msc_host_vfs_stream_close(msc_host_vfs_stream_handle_t stream_handle)
+{
+    MSC_RETURN_ON_INVALID_ARG(stream_handle);
+    msc_host_vfs_stream_t *stream = (msc_host_vfs_stream_t *)stream_handle;
+    usb_disk_t *disk = stream->disk;
+    esp_err_t ret = ESP_OK;
+
+    if (stream->partial_len) {
+        memset(stream->partial + stream->partial_len, 0, disk->block_size - stream->partial_len);
+        ret = msc_cache_write(disk, stream->partial, stream->next_sector, 1);
+    }
+
+    // Truncating at the written size sets the file size and frees clusters behind it
+    if (f_lseek(&stream->file, stream->written) != FR_OK || f_truncate(&stream->file) != FR_OK) {
+        ESP_LOGE(TAG, "Could not set file size");
+        ret = (ret == ESP_OK) ? ESP_FAIL : ret;
+    }
+    if (f_close(&stream->file) != FR_OK) {
+        ret = (ret == ESP_OK) ? ESP_FAIL : ret;
+    }
+    if (ret == ESP_OK) {
+        ret = msc_cache_sync(disk);
+    }
+
+    free(stream->partial);
+    free(stream);
+    return ret;
+}
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "msc_quirks.h"
+
+static const char *TAG = "USB_MSC_QUIRKS";
+
+// Devices failing commands the driver would otherwise recover from by reset recovery
+static const msc_host_quirk_t s_builtin_quirks[] = {
+    // Genesys Logic USB to IDE bridges and card readers fail READ/WRITE commands over 32 kB
+    { .idVendor = 0x05E3, .idProduct = 0x0701, .max_sectors = 64 },
+    { .idVendor = 0x05E3, .idProduct = 0x0702, .max_sectors = 64 },
+    { .idVendor = 0x05E3, .idProduct = 0x0723, .max_sectors = 64 },
+};
+
+static const msc_host_quirk_t *quirks_match(uint16_t vid, uint16_t pid, const msc_host_quirk_t *table, size_t count)
+{
+    const msc_host_quirk_t *any_product = NULL;
+    for (size_t i = 0; i < count; i++) {
+        if (table[i].idVendor != vid) {
+            continue;
+        }
+        if (table[i].idProduct == pid) {
+            return &table[i];
+        }
+        if (table[i].idProduct == MSC_HOST_QUIRK_ANY_PRODUCT && any_product == NULL) {
+            any_product = &table[i];
+        }
+    }
+    return any_product;
+}
+
+bool msc_quirks_find(uint16_t vid, uint16_t pid, const msc_host_quirk_t *app, size_t app_count, msc_host_quirk_t *quirk)
+{
+    const msc_host_quirk_t *found = NULL;
+    if (app) {
+        found = quirks_match(vid, pid, app, app_count);
+    }
+    if (found == NULL) {
+        found = quirks_match(vid, pid, s_builtin_quirks, sizeof(s_builtin_quirks) / sizeof(s_builtin_quirks[0]));
+    }
+    if (found == NULL) {
+        memset(quirk, 0, sizeof(msc_host_quirk_t));
+        return false;
+    }
+    *quirk = *found;
+    ESP_LOGD(TAG, "Device %04X:%04X: flags 0x%" PRIx32 ", max %u sectors, settle %u ms",
+             vid, pid, quirk->flags, quirk->max_sectors, quirk->settle_ms);
+    return true;
+}
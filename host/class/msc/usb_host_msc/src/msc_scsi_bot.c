@@ -6,6 +6,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <sys/param.h>
 #include "esp_log.h"
 #include "inttypes.h"
 #include <stdio.h>
@@ -14,6 +16,8 @@
 #include <assert.h>
 #include "esp_check.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "msc_common.h"
 #include "msc_scsi_bot.h"
 #include "usb/msc_host.h"
@@ -24,6 +28,7 @@ static const char *TAG = "USB_MSC_SCSI";
 #define CMD_SENSE_VALID_BIT (1 << 7)
 #define SCSI_FLAG_DPO (1<<4)
 #define SCSI_FLAG_FUA (1<<3)
+#define SCSI_SENSE_KEY_ILLEGAL_REQUEST 0x05
 
 #define SCSI_CMD_FORMAT_UNIT 0x04
 #define SCSI_CMD_INQUIRY 0x12
@@ -32,36 +37,47 @@ static const char *TAG = "USB_MSC_SCSI";
 #define SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL 0x1E
 #define SCSI_CMD_READ10 0x28
 #define SCSI_CMD_READ12 0xA8
+#define SCSI_CMD_READ16 0x88
 #define SCSI_CMD_READ_CAPACITY 0x25
+#define SCSI_CMD_SERVICE_ACTION_IN16 0x9E
+#define SCSI_SERVICE_ACTION_READ_CAPACITY16 0x10
 #define SCSI_CMD_READ_FORMAT_CAPACITIES 0x23
 #define SCSI_CMD_REQUEST_SENSE 0x03
 #define SCSI_CMD_REZERO 0x01
 #define SCSI_CMD_SEEK10 0x2B
 #define SCSI_CMD_SEND_DIAGNOSTIC 0x1D
 #define SCSI_CMD_START_STOP Unit 0x1B
+#define SCSI_CMD_SYNCHRONIZE_CACHE10 0x35
 #define SCSI_CMD_TEST_UNIT_READY 0x00
+#define SCSI_CMD_UNMAP 0x42
 #define SCSI_CMD_VERIFY 0x2F
 #define SCSI_CMD_WRITE10 0x2A
 #define SCSI_CMD_WRITE12 0xAA
+#define SCSI_CMD_WRITE16 0x8A
 #define SCSI_CMD_WRITE_AND_VERIFY 0x2E
 
 #define IN_DIR   CWB_FLAG_DIRECTION_IN
 #define OUT_DIR  0
 
+#define INQUIRY_EVPD        0x01
+#define VPD_SUPPORTED_PAGES 0x00
+#define VPD_BLOCK_LIMITS    0xB0
+#define VPD_HEADER_SIZE     4
+#define VPD_MAX_SIZE        64
+
 #define INQUIRY_VID_SIZE    8
 #define INQUIRY_PID_SIZE    16
 #define INQUIRY_REV_SIZE    4
 
 #define CBW_CMD_SIZE(cmd) (sizeof(cmd) - sizeof(msc_cbw_t))
 
-#define CBW_BASE_INIT(dir, cbw_len, data_len)   \
-    .base = {                                   \
-        .signature = 0x43425355,                \
-        .tag = ++cbw_tag,                       \
-        .flags = dir,                           \
-        .lun = 0,                               \
-        .data_length = data_len,                \
-        .cbw_length = cbw_len,                  \
+#define CBW_BASE_INIT(dir, cbw_len, data_len, lun_num) \
+    .base = {                                          \
+        .signature = 0x43425355,                       \
+        .flags = dir,                                  \
+        .lun = lun_num,                                \
+        .data_length = data_len,                       \
+        .cbw_length = cbw_len,                         \
     }
 
 #define CSW_SIGNATURE   0x53425355
@@ -142,6 +158,77 @@ typedef struct __attribute__((packed))
     uint8_t reserved2[1];
 } cbw_write10_t;
 
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t flags;
+    uint64_t address;
+    uint32_t length;
+    uint8_t reserved[2];
+} cbw_read16_t;
+
+typedef cbw_read16_t cbw_write16_t;
+
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t flags;
+    uint32_t address;
+    uint8_t reserved1;
+    uint16_t length;
+    uint8_t reserved2[1];
+} cbw_sync_cache10_t;
+
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t anchor;
+    uint8_t reserved[4];
+    uint8_t group;
+    uint16_t parameter_list_length;
+    uint8_t control;
+} cbw_unmap_t;
+
+/**
+ * @brief UNMAP parameter list with one block descriptor
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 109
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t data_length;
+    uint16_t block_descriptor_data_length;
+    uint8_t reserved_0[4];
+    uint64_t address;
+    uint32_t length;
+    uint8_t reserved_1[4];
+} unmap_parameter_list_t;
+
+/**
+ * @brief Block Limits VPD page
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 188
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t peripheral;
+    uint8_t page_code;
+    uint16_t page_length;
+    uint8_t wsnz;
+    uint8_t max_compare_write_length;
+    uint16_t optimal_transfer_length_granularity;
+    uint32_t max_transfer_length;
+    uint32_t optimal_transfer_length;
+    uint32_t max_prefetch_length;
+    uint32_t max_unmap_lba_count;
+    uint32_t max_unmap_block_descriptor_count;
+    uint32_t optimal_unmap_granularity;
+    uint32_t unmap_granularity_alignment;
+} vpd_block_limits_t;
+
 typedef struct __attribute__((packed))
 {
     msc_cbw_t base;
@@ -157,6 +244,23 @@ typedef struct __attribute__((packed))
     uint32_t block_size;
 } cbw_read_capacity_response_t;
 
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t service_action;
+    uint64_t address;
+    uint32_t allocation_length;
+    uint8_t reserved[2];
+} cbw_read_capacity16_t;
+
+typedef struct __attribute__((packed))
+{
+    uint64_t block_count;
+    uint32_t block_size;
+    uint8_t reserved[20];
+} cbw_read_capacity16_response_t;
+
 typedef struct __attribute__((packed))
 {
     msc_cbw_t base;
@@ -230,9 +334,6 @@ typedef struct __attribute__((packed))
     uint8_t data[36];
 } cbw_inquiry_response_t;
 
-// Unique number based on which MSC protocol pairs request and response
-static uint32_t cbw_tag;
-
 static esp_err_t check_csw(msc_csw_t *csw, uint32_t tag)
 {
     const bool csw_ok = csw->signature == CSW_SIGNATURE && csw->tag == tag &&
@@ -256,8 +357,6 @@ static esp_err_t check_csw(msc_csw_t *csw, uint32_t tag)
  * 3. Status transport
  * 3.1. Error recovery (in case of error)
  *
- * This function is not 'static' so it could be called from unit test
- *
  * @see USB Mass Storage Class – Bulk Only Transport, Chapter 5.3
  *
  * @param[in] device MSC device handle
@@ -266,17 +365,23 @@ static esp_err_t check_csw(msc_csw_t *csw, uint32_t tag)
  * @param[in] size   Size of data in bytes
  * @return esp_err_t
  */
-esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data, size_t size)
+static esp_err_t bot_execute_command_locked(msc_device_t *device, msc_cbw_t *cbw, void *data, size_t size)
 {
     msc_csw_t csw;
     msc_endpoint_t ep = (cbw->flags & CWB_FLAG_DIRECTION_IN) ? MSC_EP_IN : MSC_EP_OUT;
+    MSC_STATS_TIMESTAMP(phase_start);
+
+    // Unique number based on which MSC protocol pairs request and response
+    cbw->tag = ++device->cbw_tag;
 
     // 1. Command transport
     MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, (uint8_t *)cbw, CBW_SIZE, MSC_EP_OUT) );
+    MSC_STATS_PHASE_END(device, command_time_us, phase_start);
 
     // 2. Optional data transport
     if (data) {
-        MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, (uint8_t *)data, size, ep) );
+        MSC_RETURN_ON_ERROR( msc_bulk_transfer_pipelined(device, (uint8_t *)data, size, ep) );
+        MSC_STATS_PHASE_END(device, data_time_us, phase_start);
     }
 
     // 3. Status transport
@@ -286,8 +391,9 @@ esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data,
     if (err == ESP_ERR_MSC_STALL) {
         // In case of the status transport failure, we can try reading the status again after clearing feature
         ESP_RETURN_ON_ERROR( clear_feature(device, device->config.bulk_in_ep), TAG, "Clear feature failed" );
+        MSC_STATS_ADD(device, retries, 1);
         err = msc_bulk_transfer(device, (uint8_t *)&csw, sizeof(msc_csw_t), MSC_EP_IN);
-        if (ESP_OK != err) {
+        if (ESP_OK != err && !device->timeout.recovering) {
             // In case the repeated status transport failed we do reset recovery
             // We don't check the error code here, the command has already failed.
             msc_host_reset_recovery(device);
@@ -295,10 +401,54 @@ esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data,
     }
 
     MSC_RETURN_ON_ERROR(err);
+    MSC_STATS_PHASE_END(device, status_time_us, phase_start);
 
     return check_csw(&csw, cbw->tag);
 }
 
+/**
+ * @brief Execute BOT command
+ *
+ * Commands to all LUNs of the device share its bulk endpoints. Each command holds the device
+ * only for its own CBW, data and CSW, so commands to different LUNs are interleaved command by command.
+ *
+ * This function is not 'static' so it could be called from unit test
+ */
+esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data, size_t size)
+{
+    // Recursive, because reset recovery of a failed command issues TEST UNIT READY
+    xSemaphoreTakeRecursive(device->cmd_mutex, portMAX_DELAY);
+    MSC_STATS_TIMESTAMP(start);
+    esp_err_t ret;
+    uint32_t backoff_ms = device->timeout.backoff_ms;
+    for (uint8_t attempt = 0; ; attempt++) {
+        if (device->config.transport == MSC_TRANSPORT_UAS) {
+            // The same CDB is sent in UAS Command IU, the CBW header is not used
+            ret = uas_execute_command(device, cbw->lun, (const uint8_t *)(cbw + 1), cbw->cbw_length,
+                                      cbw->flags & CWB_FLAG_DIRECTION_IN, data, size);
+        } else {
+            ret = bot_execute_command_locked(device, cbw, data, size);
+        }
+
+        // Only transport errors are retried, the device rejecting the command would reject it again
+        if (ret != ESP_ERR_MSC_INTERNAL || attempt >= device->timeout.retries || device->timeout.recovering) {
+            break;
+        }
+        ESP_LOGD(TAG, "Transport error, retry %d", attempt + 1);
+        MSC_STATS_ADD(device, retries, 1);
+        if (msc_host_reset_recovery(device) != ESP_OK) {
+            break;
+        }
+        if (backoff_ms) {
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+            backoff_ms *= 2;
+        }
+    }
+    MSC_STATS_COMMAND_DONE(device, start, cbw->flags & CWB_FLAG_DIRECTION_IN, data ? size : 0, ret);
+    xSemaphoreGiveRecursive(device->cmd_mutex);
+    return ret;
+}
+
 static const char *decode_sense_keys(cbw_sense_response_t *sense_response)
 {
     // Only decode WRITE_PROTECTED_MEDIA sense key, other keys are not implemented
@@ -315,6 +465,7 @@ static const char *decode_sense_keys(cbw_sense_response_t *sense_response)
 
 
 esp_err_t scsi_cmd_read10(msc_host_device_handle_t dev,
+                          uint8_t lun,
                           uint8_t *data,
                           uint32_t sector_address,
                           uint32_t num_sectors,
@@ -322,9 +473,8 @@ esp_err_t scsi_cmd_read10(msc_host_device_handle_t dev,
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_read10_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read10_t), num_sectors * sector_size),
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read10_t), num_sectors * sector_size, lun),
         .opcode = SCSI_CMD_READ10,
-        .flags = 0, // lun
         .address = __builtin_bswap32(sector_address),
         .length = __builtin_bswap16(num_sectors),
     };
@@ -333,12 +483,13 @@ esp_err_t scsi_cmd_read10(msc_host_device_handle_t dev,
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
     }
     return ret;
 }
 
 esp_err_t scsi_cmd_write10(msc_host_device_handle_t dev,
+                           uint8_t lun,
                            const uint8_t *data,
                            uint32_t sector_address,
                            uint32_t num_sectors,
@@ -346,7 +497,7 @@ esp_err_t scsi_cmd_write10(msc_host_device_handle_t dev,
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_write10_t cbw = {
-        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(cbw_write10_t), num_sectors * sector_size),
+        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(cbw_write10_t), num_sectors * sector_size, lun),
         .opcode = SCSI_CMD_WRITE10,
         .address = __builtin_bswap32(sector_address),
         .length = __builtin_bswap16(num_sectors),
@@ -356,18 +507,222 @@ esp_err_t scsi_cmd_write10(msc_host_device_handle_t dev,
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
     }
     return ret;
 }
 
-esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint32_t *block_size, uint32_t *block_count)
+esp_err_t scsi_cmd_read16(msc_host_device_handle_t dev,
+                          uint8_t lun,
+                          uint8_t *data,
+                          uint64_t sector_address,
+                          uint32_t num_sectors,
+                          uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_read16_t cbw = {
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read16_t), num_sectors * sector_size, lun),
+        .opcode = SCSI_CMD_READ16,
+        .address = __builtin_bswap64(sector_address),
+        .length = __builtin_bswap32(num_sectors),
+    };
+
+    esp_err_t ret = bot_execute_command(device, &cbw.base, data, num_sectors * sector_size);
+
+    // In case of an error, get an error code
+    if (unlikely(ret != ESP_OK)) {
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
+    }
+    return ret;
+}
+
+esp_err_t scsi_cmd_write16(msc_host_device_handle_t dev,
+                           uint8_t lun,
+                           const uint8_t *data,
+                           uint64_t sector_address,
+                           uint32_t num_sectors,
+                           uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_write16_t cbw = {
+        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(cbw_write16_t), num_sectors * sector_size, lun),
+        .opcode = SCSI_CMD_WRITE16,
+        .address = __builtin_bswap64(sector_address),
+        .length = __builtin_bswap32(num_sectors),
+    };
+
+    esp_err_t ret = bot_execute_command(device, &cbw.base, (void *)data, num_sectors * sector_size);
+
+    // In case of an error, get an error code
+    if (unlikely(ret != ESP_OK)) {
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
+    }
+    return ret;
+}
+
+/**
+ * @brief Check whether the access can be encoded into 10 byte command block
+ *
+ * READ(10)/WRITE(10) have 32-bit address and 16-bit length
+ */
+static inline bool scsi_cdb10_sufficient(uint64_t sector_address, uint32_t num_sectors)
+{
+    return num_sectors <= UINT16_MAX && sector_address + num_sectors - 1 <= UINT32_MAX;
+}
+
+esp_err_t scsi_cmd_read(msc_host_device_handle_t dev,
+                        uint8_t lun,
+                        uint8_t *data,
+                        uint64_t sector_address,
+                        uint32_t num_sectors,
+                        uint32_t sector_size)
+{
+    if (scsi_cdb10_sufficient(sector_address, num_sectors)) {
+        return scsi_cmd_read10(dev, lun, data, (uint32_t)sector_address, num_sectors, sector_size);
+    }
+    return scsi_cmd_read16(dev, lun, data, sector_address, num_sectors, sector_size);
+}
+
+esp_err_t scsi_cmd_write(msc_host_device_handle_t dev,
+                         uint8_t lun,
+                         const uint8_t *data,
+                         uint64_t sector_address,
+                         uint32_t num_sectors,
+                         uint32_t sector_size)
+{
+    if (scsi_cdb10_sufficient(sector_address, num_sectors)) {
+        return scsi_cmd_write10(dev, lun, data, (uint32_t)sector_address, num_sectors, sector_size);
+    }
+    return scsi_cmd_write16(dev, lun, data, sector_address, num_sectors, sector_size);
+}
+
+esp_err_t scsi_cmd_sync_cache(msc_host_device_handle_t dev, uint8_t lun)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_sync_cache10_t cbw = {
+        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(cbw_sync_cache10_t), 0, lun),
+        .opcode = SCSI_CMD_SYNCHRONIZE_CACHE10,
+        .address = 0, // Zero address and length: synchronize whole medium
+        .length = 0,
+    };
+
+    esp_err_t ret = bot_execute_command(device, &cbw.base, NULL, 0);
+
+    // Optional command, many flash drives have no cache and reject it as illegal request
+    if (unlikely(ret != ESP_OK)) {
+        scsi_sense_data_t sense;
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, &sense));
+        if (sense.key == SCSI_SENSE_KEY_ILLEGAL_REQUEST) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    return ret;
+}
+
+esp_err_t scsi_cmd_unmap(msc_host_device_handle_t dev, uint8_t lun, uint64_t sector_address, uint32_t num_sectors)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    unmap_parameter_list_t parameters = {
+        .data_length = __builtin_bswap16(sizeof(parameters) - 2),
+        .block_descriptor_data_length = __builtin_bswap16(sizeof(parameters) - 8),
+        .address = __builtin_bswap64(sector_address),
+        .length = __builtin_bswap32(num_sectors),
+    };
+
+    cbw_unmap_t cbw = {
+        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(cbw_unmap_t), sizeof(parameters), lun),
+        .opcode = SCSI_CMD_UNMAP,
+        .parameter_list_length = __builtin_bswap16(sizeof(parameters)),
+    };
+
+    esp_err_t ret = bot_execute_command(device, &cbw.base, &parameters, sizeof(parameters));
+
+    // In case of an error, get an error code
+    if (unlikely(ret != ESP_OK)) {
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
+    }
+    return ret;
+}
+
+/**
+ * @brief Read Vital Product Data page
+ *
+ * The page header is read first and then exactly the length reported by the device,
+ * because Bulk-Only Transport treats shorter data phase as an error.
+ *
+ * @param[in]  device MSC device
+ * @param[in]  lun    Logical Unit Number
+ * @param[in]  page   VPD page code
+ * @param[out] data   Buffer for the page
+ * @param[in]  size   Size of the buffer, at most VPD_MAX_SIZE
+ * @param[out] len    Number of bytes read, including header
+ * @return esp_err_t
+ */
+static esp_err_t inquiry_vpd(msc_device_t *device, uint8_t lun, uint8_t page, uint8_t *data, size_t size, size_t *len)
+{
+    size_t request = VPD_HEADER_SIZE;
+    for (int i = 0; i < 2; i++) {
+        cbw_inquiry_t cbw = {
+            CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_inquiry_t), request, lun),
+            .opcode = SCSI_CMD_INQUIRY,
+            .flags = INQUIRY_EVPD,
+            .page_code = page,
+            .allocation_length = request,
+        };
+
+        esp_err_t ret = bot_execute_command(device, &cbw.base, data, request);
+        if (unlikely(ret != ESP_OK)) {
+            // Optional pages are commonly rejected as illegal request, do not log it as an error
+            scsi_sense_data_t sense;
+            MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, &sense));
+            return sense.key == SCSI_SENSE_KEY_ILLEGAL_REQUEST ? ESP_ERR_NOT_SUPPORTED : ret;
+        }
+        MSC_RETURN_ON_FALSE(data[1] == page, ESP_ERR_NOT_SUPPORTED);
+        request = MIN(size, VPD_HEADER_SIZE + ((data[2] << 8) | data[3]));
+    }
+    *len = request;
+    return ESP_OK;
+}
+
+esp_err_t scsi_cmd_block_limits(msc_host_device_handle_t dev, uint8_t lun, scsi_block_limits_t *limits)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    uint8_t page[VPD_MAX_SIZE];
+    size_t len;
+
+    memset(limits, 0, sizeof(scsi_block_limits_t));
+
+    // Many flash drives do not implement VPD pages at all, check the list of supported pages first
+    MSC_RETURN_ON_ERROR( inquiry_vpd(device, lun, VPD_SUPPORTED_PAGES, page, sizeof(page), &len) );
+    bool supported = false;
+    for (size_t i = VPD_HEADER_SIZE; i < len; i++) {
+        supported |= (page[i] == VPD_BLOCK_LIMITS);
+    }
+    if (!supported) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    MSC_RETURN_ON_ERROR( inquiry_vpd(device, lun, VPD_BLOCK_LIMITS, page, sizeof(page), &len) );
+    const vpd_block_limits_t *vpd = (const vpd_block_limits_t *)page;
+    if (len >= offsetof(vpd_block_limits_t, optimal_transfer_length)) {
+        limits->optimal_transfer_granularity = __builtin_bswap16(vpd->optimal_transfer_length_granularity);
+        limits->max_transfer_length = __builtin_bswap32(vpd->max_transfer_length);
+    }
+    if (len >= sizeof(vpd_block_limits_t)) {
+        limits->max_unmap_lba_count = __builtin_bswap32(vpd->max_unmap_lba_count);
+        limits->max_unmap_descriptor_count = __builtin_bswap32(vpd->max_unmap_block_descriptor_count);
+        limits->optimal_unmap_granularity = __builtin_bswap32(vpd->optimal_unmap_granularity);
+    }
+    return ESP_OK;
+}
+
+esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint8_t lun, uint32_t *block_size, uint32_t *block_count)
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_read_capacity_response_t response;
 
     cbw_read_capacity_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read_capacity_t), sizeof(response)),
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read_capacity_t), sizeof(response), lun),
         .opcode = SCSI_CMD_READ_CAPACITY,
     };
 
@@ -375,7 +730,7 @@ esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint32_t *block_s
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
     }
 
     *block_count = __builtin_bswap32(response.block_count);
@@ -384,11 +739,41 @@ esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint32_t *block_s
     return ret;
 }
 
-esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t dev)
+esp_err_t scsi_cmd_read_capacity16(msc_host_device_handle_t dev, uint8_t lun, uint32_t *block_size, uint64_t *block_count)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_read_capacity16_response_t response;
+
+    cbw_read_capacity16_t cbw = {
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read_capacity16_t), sizeof(response), lun),
+        .opcode = SCSI_CMD_SERVICE_ACTION_IN16,
+        .service_action = SCSI_SERVICE_ACTION_READ_CAPACITY16,
+        .allocation_length = __builtin_bswap32(sizeof(response)),
+    };
+
+    esp_err_t ret = bot_execute_command(device, &cbw.base, &response, sizeof(response));
+
+    // In case of an error, get an error code
+    if (unlikely(ret != ESP_OK)) {
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
+    }
+
+    *block_count = __builtin_bswap64(response.block_count);
+    *block_size = __builtin_bswap32(response.block_size);
+
+    return ret;
+}
+
+esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t dev, uint8_t lun)
+{
+    return scsi_cmd_unit_ready_sense(dev, lun, NULL);
+}
+
+esp_err_t scsi_cmd_unit_ready_sense(msc_host_device_handle_t dev, uint8_t lun, scsi_sense_data_t *sense)
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_unit_ready_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_unit_ready_t), 0),
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_unit_ready_t), 0, lun),
         .opcode = SCSI_CMD_TEST_UNIT_READY,
     };
 
@@ -396,23 +781,31 @@ esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t dev)
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, sense));
     }
     return ret;
 }
 
-esp_err_t scsi_cmd_sense(msc_host_device_handle_t dev, scsi_sense_data_t *sense)
+esp_err_t scsi_cmd_sense(msc_host_device_handle_t dev, uint8_t lun, scsi_sense_data_t *sense)
 {
     msc_device_t *device = (msc_device_t *)dev;
-    cbw_sense_response_t response;
-
-    cbw_sense_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_sense_t), sizeof(response)),
-        .opcode = SCSI_CMD_REQUEST_SENSE,
-        .allocation_length = sizeof(response),
-    };
-
-    MSC_RETURN_ON_ERROR( bot_execute_command(device, &cbw.base, &response, sizeof(response)) );
+    cbw_sense_response_t response = { 0 };
+
+    if (device->uas.sense_valid) {
+        // UAS devices return sense data with the failed command, REQUEST SENSE would report no error
+        response.sense_key = device->uas.sense_key;
+        response.sense_code = device->uas.sense_code;
+        response.sense_code_qualifier = device->uas.sense_code_q;
+        device->uas.sense_valid = false;
+    } else {
+        cbw_sense_t cbw = {
+            CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_sense_t), sizeof(response), lun),
+            .opcode = SCSI_CMD_REQUEST_SENSE,
+            .allocation_length = sizeof(response),
+        };
+
+        MSC_RETURN_ON_ERROR( bot_execute_command(device, &cbw.base, &response, sizeof(response)) );
+    }
 
     if (sense == NULL) {
         ESP_LOGE(TAG, "Sense error codes: Sense Key 0x%02"PRIx8", ASC: 0x%02"PRIx8", ASCQ: 0x%02"PRIx8"",
@@ -429,13 +822,13 @@ esp_err_t scsi_cmd_sense(msc_host_device_handle_t dev, scsi_sense_data_t *sense)
     return ESP_OK;
 }
 
-esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t dev)
+esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t dev, uint8_t lun)
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_inquiry_response_t response = { 0 };
 
     cbw_inquiry_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_inquiry_t), sizeof(response)),
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_inquiry_t), sizeof(response), lun),
         .opcode = SCSI_CMD_INQUIRY,
         .allocation_length = sizeof(response),
     };
@@ -444,18 +837,21 @@ esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t dev)
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
     }
     return ret;
 }
 
-esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t dev)
+esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t dev, uint8_t lun)
 {
     msc_device_t *device = (msc_device_t *)dev;
     mode_sense_response_t response = { 0 };
 
+    if (device->quirk.flags & MSC_HOST_QUIRK_NO_MODE_SENSE) {
+        return ESP_OK;
+    }
     mode_sense_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(mode_sense_t), sizeof(response)),
+        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(mode_sense_t), sizeof(response), lun),
         .opcode = SCSI_CMD_MODE_SENSE,
         .pc_page_code = 0x3F,
         .parameter_list_length = sizeof(response),
@@ -465,16 +861,19 @@ esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t dev)
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
     }
     return ret;
 }
 
-esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t dev, bool prevent)
+esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t dev, uint8_t lun, bool prevent)
 {
     msc_device_t *device = (msc_device_t *)dev;
+    if (device->quirk.flags & MSC_HOST_QUIRK_NO_PREVENT_REMOVAL) {
+        return ESP_OK;
+    }
     prevent_allow_medium_removal_t cbw = {
-        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(prevent_allow_medium_removal_t), 0),
+        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(prevent_allow_medium_removal_t), 0, lun),
         .opcode = SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL,
         .prevent = (uint8_t) prevent,
     };
@@ -483,7 +882,7 @@ esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t dev, bool prevent)
 
     // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, lun, NULL));
     }
     return ret;
 }
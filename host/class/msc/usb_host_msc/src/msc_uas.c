@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "usb/msc_host.h"
+#include "msc_common.h"
+
+static const char *TAG = "USB_MSC_UAS";
+
+/* --------------------------- UAS Definitions ------------------------------ */
+// Information Unit IDs
+#define UAS_IU_ID_COMMAND        0x01
+#define UAS_IU_ID_SENSE          0x03
+#define UAS_IU_ID_RESPONSE       0x04
+#define UAS_IU_ID_READ_READY     0x06
+#define UAS_IU_ID_WRITE_READY    0x07
+
+#define UAS_TASK_ATTR_SIMPLE     0x00
+#define UAS_CDB_SIZE             16
+
+#define SCSI_STATUS_GOOD         0x00
+
+/**
+ * @brief Command IU
+ *
+ * @see USB Attached SCSI, Table 8
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t iu_id;
+    uint8_t reserved_0;
+    uint16_t tag;
+    uint8_t task_attribute;
+    uint8_t reserved_1;
+    uint8_t additional_cdb_length;
+    uint8_t reserved_2;
+    uint8_t lun[8];
+    uint8_t cdb[UAS_CDB_SIZE];
+} uas_command_iu_t;
+
+/**
+ * @brief Common header of IUs sent by the device on status pipe
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t iu_id;
+    uint8_t reserved;
+    uint16_t tag;
+} uas_iu_header_t;
+
+/**
+ * @brief Sense IU
+ *
+ * @see USB Attached SCSI, Table 10
+ */
+typedef struct __attribute__((packed))
+{
+    uas_iu_header_t header;
+    uint16_t status_qualifier;
+    uint8_t status;
+    uint8_t reserved[7];
+    uint16_t sense_length;
+    uint8_t sense_data[];
+} uas_sense_iu_t;
+
+// Offsets in fixed format sense data
+#define SENSE_DATA_KEY_OFFSET    2
+#define SENSE_DATA_ASC_OFFSET    12
+#define SENSE_DATA_ASCQ_OFFSET   13
+
+static esp_err_t uas_read_status(msc_device_t *device, uint8_t expected_iu_id)
+{
+    uint8_t *buffer = device->uas.status_buffer;
+    const uas_iu_header_t *header = (const uas_iu_header_t *)buffer;
+
+    MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, buffer, device->config.bulk_in_mps, MSC_EP_UAS_STATUS) );
+
+    if (__builtin_bswap16(header->tag) != device->uas.tag) {
+        ESP_LOGD(TAG, "Unexpected tag 0x%04x", __builtin_bswap16(header->tag));
+        return ESP_ERR_MSC_INTERNAL;
+    }
+    if (header->iu_id == expected_iu_id) {
+        return ESP_OK;
+    }
+    if (header->iu_id == UAS_IU_ID_SENSE) {
+        return ESP_ERR_NOT_FINISHED; // Command finished without data phase, e.g. due to an error
+    }
+    ESP_LOGD(TAG, "Unexpected IU 0x%02x", header->iu_id);
+    return ESP_ERR_MSC_INTERNAL;
+}
+
+static esp_err_t uas_check_sense(msc_device_t *device)
+{
+    const uas_sense_iu_t *sense = (const uas_sense_iu_t *)device->uas.status_buffer;
+
+    if (sense->status == SCSI_STATUS_GOOD) {
+        return ESP_OK;
+    }
+
+    ESP_LOGD(TAG, "Command failed: status 0x%02x", sense->status);
+    const size_t sense_length = __builtin_bswap16(sense->sense_length);
+    if (sense_length > SENSE_DATA_ASCQ_OFFSET &&
+            sizeof(uas_sense_iu_t) + sense_length <= device->config.bulk_in_mps) {
+        // The device does not keep sense data for REQUEST SENSE, so store them here
+        device->uas.sense_key = sense->sense_data[SENSE_DATA_KEY_OFFSET] & 0x0F;
+        device->uas.sense_code = sense->sense_data[SENSE_DATA_ASC_OFFSET];
+        device->uas.sense_code_q = sense->sense_data[SENSE_DATA_ASCQ_OFFSET];
+        device->uas.sense_valid = true;
+    }
+    return ESP_FAIL;
+}
+
+esp_err_t uas_execute_command(msc_device_t *device, uint8_t lun, const uint8_t *cdb, size_t cdb_len,
+                              bool data_in, void *data, size_t size)
+{
+    MSC_RETURN_ON_FALSE(cdb_len <= UAS_CDB_SIZE, ESP_ERR_INVALID_ARG);
+
+    // Tags 0 and 0xFFFF are reserved
+    device->uas.tag = (device->uas.tag % 0xFFFE) + 1;
+    device->uas.sense_valid = false;
+
+    uas_command_iu_t command = {
+        .iu_id = UAS_IU_ID_COMMAND,
+        .tag = __builtin_bswap16(device->uas.tag),
+        .task_attribute = UAS_TASK_ATTR_SIMPLE,
+        .lun = { 0, lun }, // Single level LUN structure, peripheral device addressing
+    };
+    memcpy(command.cdb, cdb, cdb_len);
+    MSC_STATS_TIMESTAMP(phase_start);
+
+    // 1. Command IU on command pipe
+    MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, (uint8_t *)&command, sizeof(command), MSC_EP_UAS_COMMAND) );
+    MSC_STATS_PHASE_END(device, command_time_us, phase_start);
+
+    // 2. Optional data phase, started when the device reports it is ready
+    if (data) {
+        esp_err_t ret = uas_read_status(device, data_in ? UAS_IU_ID_READ_READY : UAS_IU_ID_WRITE_READY);
+        if (ret == ESP_ERR_NOT_FINISHED) {
+            return uas_check_sense(device) == ESP_OK ? ESP_ERR_MSC_INTERNAL : ESP_FAIL;
+        }
+        MSC_RETURN_ON_ERROR(ret);
+        MSC_RETURN_ON_ERROR( msc_bulk_transfer_pipelined(device, (uint8_t *)data, size, data_in ? MSC_EP_IN : MSC_EP_OUT) );
+        MSC_STATS_PHASE_END(device, data_time_us, phase_start);
+    }
+
+    // 3. Sense IU on status pipe
+    MSC_RETURN_ON_ERROR( uas_read_status(device, UAS_IU_ID_SENSE) );
+    MSC_STATS_PHASE_END(device, status_time_us, phase_start);
+    return uas_check_sense(device);
+}
@@ -13,11 +13,16 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include "esp_idf_version.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "esp_private/msc_scsi_bot.h"
 #include "esp_private/usb_phy.h"
 #include "usb/usb_host.h"
 #include "usb/msc_host_vfs.h"
+#include "nvs_flash.h"
+#include "ffconf.h"
 #include "test_common.h"
+#include "test_msc_host.h"
 #include "../private_include/msc_common.h"
 
 static const char *TAG = "APP";
@@ -92,7 +97,7 @@ static bool install_phy(void)
 static void delete_phy(void) {}
 #endif // ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 3, 0)
 
-static void msc_event_cb(const msc_host_event_t *event, void *arg)
+void msc_event_cb(const msc_host_event_t *event, void *arg)
 {
     if (waiting_for_sudden_disconnect) {
         waiting_for_sudden_disconnect = false;
@@ -213,7 +218,7 @@ static void check_sudden_disconnect(void)
     fclose(file);
 }
 
-static void msc_test_init(void)
+void msc_test_init(void)
 {
     BaseType_t task_created;
 
@@ -230,7 +235,7 @@ static void msc_test_init(void)
     TEST_ASSERT(task_created);
 }
 
-static void msc_test_wait_and_install_device(void)
+void msc_test_wait_and_install_device(void)
 {
     ESP_LOGI(TAG, "Waiting for USB stick to be connected");
     msc_host_event_t app_event;
@@ -255,6 +260,16 @@ static void msc_setup(void)
     msc_test_wait_and_install_device();
 }
 
+msc_host_device_handle_t msc_test_get_device(void)
+{
+    return device;
+}
+
+msc_host_vfs_handle_t msc_test_get_vfs_handle(void)
+{
+    return vfs_handle;
+}
+
 static void msc_test_uninstall_device(void)
 {
     ESP_OK_ASSERT( msc_host_vfs_unregister(vfs_handle) );
@@ -275,7 +290,7 @@ static void msc_test_deinit(void)
     vTaskDelay(10); // Wait for FreeRTOS to clean up deleted tasks
 }
 
-static void msc_teardown(void)
+void msc_teardown(void)
 {
     msc_test_uninstall_device();
     msc_test_deinit();
@@ -289,19 +304,40 @@ static void write_read_sectors(void)
     memset(write_data, 0x55, DISK_BLOCK_SIZE);
     memset(read_data, 0, DISK_BLOCK_SIZE);
 
-    ESP_OK_ASSERT( scsi_cmd_write10(device, write_data, 10, 1, DISK_BLOCK_SIZE));
-    ESP_OK_ASSERT( scsi_cmd_read10(device, read_data, 10, 1, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( scsi_cmd_write10(device, 0, write_data, 10, 1, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, 10, 1, DISK_BLOCK_SIZE));
 
     TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, DISK_BLOCK_SIZE);
 }
 
+static void write_read_sectors_zero_copy(void)
+{
+    // DMA capable buffers aligned to cache line are used directly by USB transfers
+    const size_t data_size = 4 * DISK_BLOCK_SIZE;
+    uint8_t *write_data = heap_caps_aligned_calloc(64, 1, data_size, MALLOC_CAP_DMA);
+    uint8_t *read_data = heap_caps_aligned_calloc(64, 1, data_size, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+
+    for (int i = 0; i < data_size; i++) {
+        write_data[i] = i & 0xFF;
+    }
+
+    ESP_OK_ASSERT( scsi_cmd_write10(device, 0, write_data, 10, 4, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, 10, 4, DISK_BLOCK_SIZE));
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, data_size);
+
+    free(write_data);
+    free(read_data);
+}
+
 static void erase_storage(void)
 {
     uint8_t data[DISK_BLOCK_SIZE];
     memset(data, 0xFF, DISK_BLOCK_SIZE);
 
     for (int block = 0; block < DISK_BLOCK_NUM; block++) {
-        scsi_cmd_write10(device, data, block, 1, DISK_BLOCK_SIZE);
+        scsi_cmd_write10(device, 0, data, block, 1, DISK_BLOCK_SIZE);
     }
 }
 
@@ -326,6 +362,54 @@ TEST_CASE("sectors_can_be_written_and_read", "[usb_msc]")
     msc_teardown();
 }
 
+TEST_CASE("sectors_can_be_written_and_read_zero_copy", "[usb_msc]")
+{
+    msc_setup();
+    write_read_sectors_zero_copy();
+    msc_teardown();
+}
+
+/**
+ * @brief Optional Block Limits VPD page
+ *
+ * Devices without VPD pages must report the page as not supported and keep working afterwards
+ */
+TEST_CASE("block_limits", "[usb_msc]")
+{
+    scsi_block_limits_t limits;
+
+    msc_setup();
+    esp_err_t err = scsi_cmd_block_limits(device, 0, &limits);
+    TEST_ASSERT(err == ESP_OK || err == ESP_ERR_NOT_SUPPORTED);
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        TEST_ASSERT_EQUAL(0, limits.max_unmap_lba_count);
+    }
+    write_read_sectors();
+    msc_teardown();
+}
+
+TEST_CASE("command_stats", "[usb_msc]")
+{
+    msc_host_stats_t stats;
+
+    msc_setup();
+    ESP_OK_ASSERT( msc_host_clear_stats(device) );
+    write_read_sectors();
+    ESP_OK_ASSERT( msc_host_get_stats(device, &stats) );
+
+    TEST_ASSERT_GREATER_THAN(0, stats.commands);
+    TEST_ASSERT_EQUAL(0, stats.errors);
+    TEST_ASSERT_GREATER_THAN(0, stats.bytes_read);
+    TEST_ASSERT_GREATER_THAN(0, stats.bytes_written);
+    TEST_ASSERT_GREATER_THAN(0, stats.max_latency_us);
+    uint32_t histogram_sum = 0;
+    for (int i = 0; i < MSC_HOST_STATS_LATENCY_BUCKETS; i++) {
+        histogram_sum += stats.latency_histogram[i];
+    }
+    TEST_ASSERT_EQUAL(stats.commands, histogram_sum);
+    msc_teardown();
+}
+
 esp_err_t bot_execute_command(msc_device_t *device, uint8_t *cbw, void *data, size_t size);
 /**
  * @brief Error recovery testcase
@@ -366,7 +450,7 @@ TEST_CASE("error_recovery_2", "[usb_msc][ignore]")
     // Write to and read from invalid sector
     // Some flash disks will respond with stall, some with error in CSW, some with timeout
     printf("read 10\n");
-    err = scsi_cmd_read10(device, data, UINT32_MAX, 1, DISK_BLOCK_SIZE);
+    err = scsi_cmd_read10(device, 0, data, UINT32_MAX, 1, DISK_BLOCK_SIZE);
     TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
     err = msc_host_reset_recovery(device);
     TEST_ASSERT_EQUAL(ESP_OK, err);
@@ -479,6 +563,28 @@ TEST_CASE("can_be_formated_by_api", "[usb_msc]")
     msc_teardown();
 }
 
+/**
+ * @brief USB MSC aligned format testcase
+ * @attention This testcase deletes all content on the USB MSC device.
+ *            The device must be reset in order to contain the FILE_NAME again.
+ */
+TEST_CASE("can_be_formated_aligned", "[usb_msc]")
+{
+    msc_setup();
+    write_read_file(FILE_NAME);
+
+    const msc_host_vfs_format_config_t format_config = {
+        .exfat = true, // Mock device is too small, FAT is used
+    };
+    ESP_OK_ASSERT( msc_host_vfs_format_aligned(vfs_handle, &format_config) );
+    TEST_ASSERT_FALSE(file_exists(FILE_NAME));
+
+    // Data area alignment is not reported to FATFS after formatting
+    TEST_ASSERT_EQUAL(0, device->disks[0].format_alignment);
+    write_read_file(FILE_NAME);
+    msc_teardown();
+}
+
 static void print_device_info(msc_host_device_info_t *info)
 {
     const size_t megabyte = 1024 * 1024;
@@ -488,6 +594,7 @@ static void print_device_info(msc_host_device_info_t *info)
     printf("\t Capacity: %llu MB\n", capacity);
     printf("\t Sector size: %"PRIu32"\n", info->sector_size);
     printf("\t Sector count: %"PRIu32"\n", info->sector_count);
+    printf("\t LUN count: %d\n", info->lun_count);
     printf("\t PID: 0x%4X \n", info->idProduct);
     printf("\t VID: 0x%4X \n", info->idVendor);
     wprintf(L"\t iProduct: %S \n", info->iProduct);
@@ -508,6 +615,11 @@ TEST_CASE("device_info", "[usb_msc]")
     esp_err_t err = msc_host_get_device_info(device, &info);
     msc_teardown();
     TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(1, info.lun_count); // Mock device has single LUN
+    TEST_ASSERT_NOT_EQUAL(0, info.buffer_alignment);
+    if (info.allocation_unit_size) {
+        TEST_ASSERT_EQUAL(0, info.allocation_unit_size % info.sector_size);
+    }
     print_device_info(&info);
 }
 
@@ -534,6 +646,427 @@ TEST_CASE("no_background_task", "[usb_msc]")
     msc_teardown();
 }
 
+/**
+ * @brief USB MSC driver with adaptive timeouts and retries
+ *
+ * Timeouts derived from observed transfer durations must not break regular reads and writes
+ */
+TEST_CASE("adaptive_timeout", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .timeout = {
+            .max_ms = 1000,
+            .min_ms = 50,
+            .retries = 2,
+            .backoff_ms = 10,
+        },
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+    write_read_sectors();
+    msc_teardown();
+}
+
+/**
+ * @brief USB MSC driver with quirks of the mock device
+ *
+ * Commands marked as broken are not sent and larger accesses are split by the quirk limit
+ */
+TEST_CASE("device_quirks", "[usb_msc]")
+{
+    const msc_host_quirk_t quirks[] = {
+        {
+            .idVendor = 0x303A,
+            .idProduct = MSC_HOST_QUIRK_ANY_PRODUCT,
+            .flags = MSC_HOST_QUIRK_NO_MODE_SENSE | MSC_HOST_QUIRK_NO_PREVENT_REMOVAL,
+            .max_sectors = 2,
+            .settle_ms = 10,
+        },
+    };
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .quirks = quirks,
+        .quirk_count = 1,
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    msc_host_device_info_t info;
+    ESP_OK_ASSERT( msc_host_get_device_info(device, &info) );
+    TEST_ASSERT_EQUAL(2 * info.sector_size, info.max_transfer_size);
+    ESP_OK_ASSERT( msc_host_clear_stats(device) );
+    ESP_OK_ASSERT( scsi_cmd_mode_sense(device, 0) );
+    ESP_OK_ASSERT( scsi_cmd_prevent_removal(device, 0, true) );
+#ifdef CONFIG_MSC_HOST_STATS
+    msc_host_stats_t stats;
+    ESP_OK_ASSERT( msc_host_get_stats(device, &stats) );
+    TEST_ASSERT_EQUAL(0, stats.commands);
+#endif
+    write_read_file(FILE_NAME); // File accesses are split into commands of 2 sectors
+    msc_teardown();
+}
+
+/**
+ * @brief USB MSC driver with cached geometry of known devices
+ *
+ * The first installation probes the device and stores its geometry in NVS.
+ * The second installation must skip probing and report the same geometry.
+ */
+TEST_CASE("device_cache", "[usb_msc]")
+{
+    ESP_OK_ASSERT( nvs_flash_init() );
+    ESP_OK_ASSERT( msc_host_clear_device_cache() );
+    msc_setup();
+
+    msc_host_device_info_t probed, restored;
+    usb_device_info_t dev_info;
+    ESP_OK_ASSERT( msc_host_get_device_info(device, &probed) );
+    ESP_OK_ASSERT( usb_host_device_info(((msc_device_t *)device)->handle, &dev_info) );
+    msc_test_uninstall_device();
+
+    const int64_t start = esp_timer_get_time();
+    ESP_OK_ASSERT( msc_host_install_device(dev_info.dev_addr, &device) );
+    printf("Known device installed in %"PRId64" us\n", esp_timer_get_time() - start);
+    ESP_OK_ASSERT( msc_host_vfs_register(device, "/usb", &mount_config, &vfs_handle) );
+    ESP_OK_ASSERT( msc_host_get_device_info(device, &restored) );
+    TEST_ASSERT_EQUAL(probed.sector_size, restored.sector_size);
+    TEST_ASSERT_EQUAL(probed.sector_count, restored.sector_count);
+    TEST_ASSERT_EQUAL(probed.lun_count, restored.lun_count);
+    TEST_ASSERT_EQUAL(probed.allocation_unit_size, restored.allocation_unit_size);
+    write_read_sectors();
+
+    msc_teardown();
+    ESP_OK_ASSERT( msc_host_clear_device_cache() );
+    ESP_OK_ASSERT( nvs_flash_deinit() );
+}
+
+/**
+ * @brief USB MSC driver with pipelined data phase
+ *
+ * Install the driver with several transfers in flight and make sure
+ * that multi-chunk reads and writes work correctly
+ */
+TEST_CASE("pipelined_read_write", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .pipeline_depth = 3,
+        .pipeline_chunk_size = 2 * DISK_BLOCK_SIZE,
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    const size_t sectors = 7; // Not a multiple of the chunk size
+    uint8_t *write_data = malloc(sectors * DISK_BLOCK_SIZE);
+    uint8_t *read_data = calloc(1, sectors * DISK_BLOCK_SIZE);
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    for (int i = 0; i < sectors * DISK_BLOCK_SIZE; i++) {
+        write_data[i] = (i * 7) & 0xFF;
+    }
+
+    ESP_OK_ASSERT( scsi_cmd_write10(device, 0, write_data, 20, sectors, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, 20, sectors, DISK_BLOCK_SIZE));
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, sectors * DISK_BLOCK_SIZE);
+    write_read_file(FILE_NAME);
+
+    free(write_data);
+    free(read_data);
+    msc_teardown();
+}
+
+/**
+ * @brief USB MSC driver with sector cache
+ *
+ * Install the driver with write-back sector cache and make sure
+ * that file operations work and cached data reach the device on sync
+ */
+TEST_CASE("sector_cache", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .cache = {
+            .size = 16,
+            .read_ahead = 4,
+            .write_back = true,
+        },
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    write_read_file(FILE_NAME);
+
+    // Sector written to the cache must reach the device after sync
+    uint8_t write_data[DISK_BLOCK_SIZE];
+    uint8_t read_data[DISK_BLOCK_SIZE];
+    memset(write_data, 0xA5, DISK_BLOCK_SIZE);
+    memset(read_data, 0, DISK_BLOCK_SIZE);
+    ESP_OK_ASSERT( msc_cache_write(&device->disks[0], write_data, 10, 1) );
+    ESP_OK_ASSERT( msc_cache_sync(&device->disks[0]) );
+    ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, 10, 1, DISK_BLOCK_SIZE));
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, DISK_BLOCK_SIZE);
+
+    msc_teardown();
+}
+
+/**
+ * @brief Write-back cache merging and delayed flush
+ *
+ * Write scattered single sectors, which are merged into consecutive runs on flush,
+ * and make sure that the delayed flush writes them to the device without explicit sync
+ */
+TEST_CASE("sector_cache_delayed_flush", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .cache = {
+            .size = 8,
+            .write_back = true,
+            .flush_timeout_ms = 100,
+        },
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    const uint32_t sectors[] = {33, 30, 31, 35, 32};
+    uint8_t write_data[DISK_BLOCK_SIZE];
+    uint8_t read_data[DISK_BLOCK_SIZE];
+    for (int i = 0; i < sizeof(sectors) / sizeof(sectors[0]); i++) {
+        memset(write_data, sectors[i], DISK_BLOCK_SIZE);
+        ESP_OK_ASSERT( msc_cache_write(&device->disks[0], write_data, sectors[i], 1) );
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(300)); // Wait for the delayed flush
+    for (int i = 0; i < sizeof(sectors) / sizeof(sectors[0]); i++) {
+        memset(write_data, sectors[i], DISK_BLOCK_SIZE);
+        ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, sectors[i], 1, DISK_BLOCK_SIZE));
+        TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, DISK_BLOCK_SIZE);
+    }
+
+    write_read_file(FILE_NAME);
+    msc_teardown();
+}
+
+static void async_io_done_cb(msc_host_device_handle_t dev, esp_err_t status, void *arg)
+{
+    TEST_ASSERT_EQUAL(device, dev);
+    TEST_ASSERT_EQUAL(ESP_OK, status);
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+/**
+ * @brief Asynchronous sector I/O
+ *
+ * Queue several writes followed by reads without waiting
+ * and check that all of them complete with correct data
+ */
+TEST_CASE("async_read_write", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .async = {
+            .queue_size = 8,
+            .stack_size = 4096,
+            .task_priority = 4,
+            .core_id = tskNO_AFFINITY,
+        },
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    const int requests = 4;
+    uint8_t *write_data = malloc(requests * DISK_BLOCK_SIZE);
+    uint8_t *read_data = calloc(1, requests * DISK_BLOCK_SIZE);
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(2 * requests, 0);
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    TEST_ASSERT_NOT_NULL(done);
+    for (int i = 0; i < requests * DISK_BLOCK_SIZE; i++) {
+        write_data[i] = (i * 3) & 0xFF;
+    }
+
+    for (int i = 0; i < requests; i++) {
+        ESP_OK_ASSERT( msc_host_write_sectors_async(device, 0, 40 + i, 1, write_data + i * DISK_BLOCK_SIZE, async_io_done_cb, done) );
+    }
+    for (int i = 0; i < requests; i++) {
+        ESP_OK_ASSERT( msc_host_read_sectors_async(device, 0, 40 + i, 1, read_data + i * DISK_BLOCK_SIZE, async_io_done_cb, done) );
+    }
+    for (int i = 0; i < 2 * requests; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(5000)));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, requests * DISK_BLOCK_SIZE);
+
+    vSemaphoreDelete(done);
+    free(write_data);
+    free(read_data);
+    msc_teardown();
+}
+
+/**
+ * @brief Elevator scheduling of asynchronous requests
+ *
+ * Queue interleaved writes of two sequential streams and a rewrite of an already queued sector.
+ * Requests are sorted and merged by the scheduler, but the rewrite must not overtake the first write.
+ */
+TEST_CASE("async_elevator", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .async = {
+            .queue_size = 16,
+            .stack_size = 4096,
+            .task_priority = 4,
+            .core_id = tskNO_AFFINITY,
+            .reorder_window = 8,
+            .merge_buffer_size = 4 * DISK_BLOCK_SIZE,
+        },
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    const int requests = 8;
+    uint8_t *write_data = malloc((requests + 1) * DISK_BLOCK_SIZE);
+    uint8_t *read_data = calloc(1, 2 * requests * DISK_BLOCK_SIZE);
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(2 * requests + 1, 0);
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    TEST_ASSERT_NOT_NULL(done);
+    for (int i = 0; i < (requests + 1) * DISK_BLOCK_SIZE; i++) {
+        write_data[i] = (i * 7 + i / DISK_BLOCK_SIZE) & 0xFF;
+    }
+
+    // Stream A writes sectors 100.., stream B writes sectors 60.., the last buffer rewrites sector 100
+    for (int i = 0; i < requests; i++) {
+        const uint32_t sector = (i % 2) ? 60 + i / 2 : 100 + i / 2;
+        ESP_OK_ASSERT( msc_host_write_sectors_async(device, 0, sector, 1, write_data + i * DISK_BLOCK_SIZE, async_io_done_cb, done) );
+    }
+    ESP_OK_ASSERT( msc_host_write_sectors_async(device, 0, 100, 1, write_data + requests * DISK_BLOCK_SIZE, async_io_done_cb, done) );
+    for (int i = 0; i < requests; i++) {
+        const uint32_t sector = (i % 2) ? 60 + i / 2 : 100 + i / 2;
+        ESP_OK_ASSERT( msc_host_read_sectors_async(device, 0, sector, 1, read_data + i * DISK_BLOCK_SIZE, async_io_done_cb, done) );
+    }
+    for (int i = 0; i < 2 * requests + 1; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(5000)));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(write_data + requests * DISK_BLOCK_SIZE, read_data, DISK_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(write_data + DISK_BLOCK_SIZE, read_data + DISK_BLOCK_SIZE, (requests - 1) * DISK_BLOCK_SIZE);
+
+    vSemaphoreDelete(done);
+    free(write_data);
+    free(read_data);
+    msc_teardown();
+}
+
+/**
+ * @brief Sector copy
+ *
+ * Copy sectors within the device in several chunks, so reading and writing overlap,
+ * and check that invalid ranges are refused
+ */
+TEST_CASE("copy_sectors", "[usb_msc]")
+{
+    const int sectors = 10;
+    uint8_t *write_data = malloc(sectors * DISK_BLOCK_SIZE);
+    uint8_t *read_data = calloc(1, sectors * DISK_BLOCK_SIZE);
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    for (int i = 0; i < sectors * DISK_BLOCK_SIZE; i++) {
+        write_data[i] = (i * 11 + i / DISK_BLOCK_SIZE) & 0xFF;
+    }
+
+    msc_setup();
+    ESP_OK_ASSERT( scsi_cmd_write10(device, 0, write_data, 200, sectors, DISK_BLOCK_SIZE) );
+
+    const msc_host_copy_config_t copy_config = {
+        .chunk_size = 3 * DISK_BLOCK_SIZE,
+        .task_priority = 5,
+        .stack_size = 3072,
+        .core_id = tskNO_AFFINITY,
+    };
+    ESP_OK_ASSERT( msc_host_copy_sectors(device, 0, 200, device, 0, 300, sectors, &copy_config) );
+    ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, 300, sectors, DISK_BLOCK_SIZE) );
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, sectors * DISK_BLOCK_SIZE);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, msc_host_copy_sectors(device, 0, 200, device, 0, 205, sectors, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, msc_host_copy_sectors(device, 0, 200, device, 1, 300, sectors, NULL));
+
+    free(write_data);
+    free(read_data);
+    msc_teardown();
+}
+
+#if FF_USE_EXPAND
+/**
+ * @brief Raw stream into preallocated file
+ *
+ * Write data not aligned to sectors through the stream and make sure
+ * that the file has the written size and content when read through VFS
+ */
+TEST_CASE("raw_stream", "[usb_msc]")
+{
+    const size_t chunks[] = {3000, 1100, 7, 2 * DISK_BLOCK_SIZE};
+    const size_t data_size = 3000 + 1100 + 7 + 2 * DISK_BLOCK_SIZE;
+    uint8_t *write_data = malloc(data_size);
+    uint8_t *read_data = calloc(1, data_size + 1); // One more byte to detect longer file
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    for (int i = 0; i < data_size; i++) {
+        write_data[i] = (i * 13) & 0xFF;
+    }
+
+    msc_setup();
+    msc_host_vfs_stream_handle_t stream;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, msc_host_vfs_stream_open(vfs_handle, "/other/stream.bin", data_size, &stream));
+    ESP_OK_ASSERT( msc_host_vfs_stream_open(vfs_handle, "/usb/stream.bin", 16 * 1024, &stream) );
+    size_t offset = 0;
+    for (int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        ESP_OK_ASSERT( msc_host_vfs_stream_write(stream, write_data + offset, chunks[i]) );
+        offset += chunks[i];
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, msc_host_vfs_stream_write(stream, write_data, 16 * 1024));
+    ESP_OK_ASSERT( msc_host_vfs_stream_close(stream) );
+
+    FILE *f = fopen("/usb/stream.bin", "r");
+    TEST_ASSERT(f);
+    TEST_ASSERT_EQUAL(data_size, fread(read_data, 1, data_size + 1, f));
+    fclose(f);
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, data_size);
+
+    free(write_data);
+    free(read_data);
+    msc_teardown();
+}
+#endif // FF_USE_EXPAND
+
 /**
  * @brief USB MSC driver with no background task
  *
@@ -0,0 +1,232 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_private/msc_scsi_bot.h"
+#include "diskio_impl.h"
+#include "diskio.h"
+#include "usb/usb_host.h"
+#include "usb/msc_host_vfs.h"
+#include "test_msc_host.h"
+#include "../private_include/msc_common.h"
+
+/**
+ * @brief MSC host throughput benchmarks
+ *
+ * Sequential and random reads and writes of 4 kB, 64 kB and 1 MB blocks are measured over raw SCSI commands,
+ * over the FATFS disk I/O layer and over VFS fread/fwrite. Each test case installs the driver with different
+ * options, so the effect of pipelining and caching can be compared.
+ *
+ * The benchmarks write raw sectors and destroy data on the device. They are meant to be run manually
+ * against a real flash drive, sizes that do not fit the device or the available memory are skipped.
+ */
+
+static const char *TAG = "BENCH";
+
+#define BENCH_FILE           "/usb/bench.bin"
+#define BENCH_REGION_MAX     (8 * 1024 * 1024)  // Area of the device used by one measurement
+#define BENCH_BYTES_PER_TEST (4 * 1024 * 1024)  // Data moved by one measurement
+#define BENCH_MIN_OPS        8
+#define BENCH_MAX_OPS        256
+
+typedef enum {
+    BENCH_RAW,
+    BENCH_DISKIO,
+    BENCH_VFS,
+} bench_layer_t;
+
+static const char *const layer_names[] = { "raw", "diskio", "vfs" };
+static const size_t block_sizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+
+typedef struct {
+    msc_host_device_handle_t device;
+    usb_disk_t *disk;
+    BYTE pdrv;
+    FILE *file;
+    size_t region;          // Size of the used area in bytes
+} bench_ctx_t;
+
+static uint32_t bench_random(uint32_t *state)
+{
+    // Fixed seed LCG, so every run accesses the same offsets
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 8;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static esp_err_t bench_op(bench_ctx_t *ctx, bench_layer_t layer, bool write, uint8_t *buf, size_t offset, size_t size)
+{
+    const uint32_t sector_size = ctx->disk->block_size;
+    const uint32_t sector = offset / sector_size;
+    const uint32_t count = size / sector_size;
+
+    switch (layer) {
+    case BENCH_RAW:
+        return write ? scsi_cmd_write(ctx->device, 0, buf, sector, count, sector_size) :
+               scsi_cmd_read(ctx->device, 0, buf, sector, count, sector_size);
+    case BENCH_DISKIO:
+        return (write ? ff_disk_write(ctx->pdrv, buf, sector, count) :
+                ff_disk_read(ctx->pdrv, buf, sector, count)) == RES_OK ? ESP_OK : ESP_FAIL;
+    case BENCH_VFS:
+        if (fseek(ctx->file, offset, SEEK_SET) != 0) {
+            return ESP_FAIL;
+        }
+        return (write ? fwrite(buf, 1, size, ctx->file) : fread(buf, 1, size, ctx->file)) == size ? ESP_OK : ESP_FAIL;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+static void bench_run(bench_ctx_t *ctx, bench_layer_t layer, bool write, bool random, size_t size)
+{
+    if (size > ctx->region) {
+        printf("%-6s %-5s %-4s %7zu kB: skipped, device too small\n",
+               layer_names[layer], write ? "write" : "read", random ? "rand" : "seq", size / 1024);
+        return;
+    }
+
+    // DMA capable buffer is transferred without copying, fall back to any memory for large blocks
+    uint8_t *buf = heap_caps_aligned_alloc(64, size, MALLOC_CAP_DMA);
+    if (buf == NULL) {
+        buf = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+    }
+    const size_t ops = MIN(MAX(BENCH_BYTES_PER_TEST / size, BENCH_MIN_OPS), BENCH_MAX_OPS);
+    uint32_t *latency = calloc(ops, sizeof(uint32_t));
+    if (buf == NULL || latency == NULL) {
+        printf("%-6s %-5s %-4s %7zu kB: skipped, out of memory\n",
+               layer_names[layer], write ? "write" : "read", random ? "rand" : "seq", size / 1024);
+        free(buf);
+        free(latency);
+        return;
+    }
+    memset(buf, 0xA5, size);
+
+    const size_t slots = ctx->region / size;
+    uint32_t seed = 12345;
+    const int64_t start = esp_timer_get_time();
+    for (size_t i = 0; i < ops; i++) {
+        const size_t offset = (random ? bench_random(&seed) % slots : i % slots) * size;
+        const int64_t op_start = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, bench_op(ctx, layer, write, buf, offset, size));
+        latency[i] = esp_timer_get_time() - op_start;
+    }
+    if (layer == BENCH_VFS && write) {
+        fflush(ctx->file);
+        fsync(fileno(ctx->file));
+    }
+    const int64_t elapsed_us = MAX(esp_timer_get_time() - start, 1);
+
+    qsort(latency, ops, sizeof(uint32_t), compare_u32);
+    const double mbps = (double)ops * size / elapsed_us; // Bytes per microsecond equal MB/s
+    const double iops = ops * 1000000.0 / elapsed_us;
+    printf("%-6s %-5s %-4s %7zu kB: %8.2f MB/s %8.1f IOPS  latency us p50 %7"PRIu32" p90 %7"PRIu32" p99 %7"PRIu32" max %7"PRIu32"\n",
+           layer_names[layer], write ? "write" : "read", random ? "rand" : "seq", size / 1024, mbps, iops,
+           latency[ops / 2], latency[ops * 9 / 10], latency[ops * 99 / 100], latency[ops - 1]);
+
+    free(latency);
+    free(buf);
+}
+
+static void bench_all(const char *name)
+{
+    bench_ctx_t ctx = {
+        .device = msc_test_get_device(),
+    };
+    msc_device_t *dev = (msc_device_t *)ctx.device;
+    ctx.disk = &dev->disks[0];
+    ctx.pdrv = ff_diskio_get_pdrv_disk(ctx.disk);
+    ctx.region = MIN(ctx.disk->block_count * ctx.disk->block_size / 2, BENCH_REGION_MAX);
+    ctx.region -= ctx.region % block_sizes[0];
+
+    ESP_LOGW(TAG, "Benchmark '%s' overwrites data on the device", name);
+    printf("--- %s ---\n", name);
+    for (bench_layer_t layer = BENCH_RAW; layer <= BENCH_VFS; layer++) {
+        if (layer == BENCH_VFS) {
+            // Raw writes destroyed the file system, start with a fresh one
+            ESP_LOGI(TAG, "Formatting");
+            const esp_vfs_fat_mount_config_t mount_config = { .allocation_unit_size = 32 * 1024 };
+            TEST_ASSERT_EQUAL(ESP_OK, msc_host_vfs_format(ctx.device, &mount_config, msc_test_get_vfs_handle()));
+            ctx.file = fopen(BENCH_FILE, "w+");
+            TEST_ASSERT_NOT_NULL(ctx.file);
+            setvbuf(ctx.file, NULL, _IONBF, 0); // Measure the driver, not newlib buffering
+        }
+        for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++) {
+            bench_run(&ctx, layer, true, false, block_sizes[i]);
+            bench_run(&ctx, layer, false, false, block_sizes[i]);
+            bench_run(&ctx, layer, true, true, block_sizes[i]);
+            bench_run(&ctx, layer, false, true, block_sizes[i]);
+        }
+    }
+    fclose(ctx.file);
+    unlink(BENCH_FILE);
+}
+
+static void bench_setup(const msc_host_driver_config_t *config)
+{
+    msc_test_init();
+    TEST_ASSERT_EQUAL(ESP_OK, msc_host_install(config));
+    msc_test_wait_and_install_device();
+}
+
+static msc_host_driver_config_t bench_config(void)
+{
+    return (msc_host_driver_config_t) {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+    };
+}
+
+TEST_CASE("benchmark_default", "[usb_msc_benchmark][ignore]")
+{
+    const msc_host_driver_config_t config = bench_config();
+    bench_setup(&config);
+    bench_all("default");
+    msc_teardown();
+}
+
+TEST_CASE("benchmark_pipelined", "[usb_msc_benchmark][ignore]")
+{
+    msc_host_driver_config_t config = bench_config();
+    config.pipeline_depth = 3;
+    config.pipeline_chunk_size = 16 * 1024;
+    bench_setup(&config);
+    bench_all("pipeline 3 x 16 kB");
+    msc_teardown();
+}
+
+TEST_CASE("benchmark_cached", "[usb_msc_benchmark][ignore]")
+{
+    msc_host_driver_config_t config = bench_config();
+    config.pipeline_depth = 3;
+    config.pipeline_chunk_size = 16 * 1024;
+    config.cache.size = 64;
+    config.cache.read_ahead = 16;
+    config.cache.write_back = true;
+    bench_setup(&config);
+    bench_all("pipeline 3 x 16 kB, write-back cache 64 sectors");
+    msc_teardown();
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,41 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include "usb/msc_host.h"
+#include "usb/msc_host_vfs.h"
+
+// Host side test helpers, implemented in test_msc.c
+
+/**
+ * @brief MSC driver event callback, forwards events to the waiting test
+ */
+void msc_event_cb(const msc_host_event_t *event, void *arg);
+
+/**
+ * @brief Install USB Host Library, MSC driver must be installed by the test afterwards
+ */
+void msc_test_init(void);
+
+/**
+ * @brief Wait for MSC device, install it and mount it to "/usb"
+ */
+void msc_test_wait_and_install_device(void);
+
+/**
+ * @brief Unmount and uninstall the device, uninstall MSC driver and USB Host Library
+ */
+void msc_teardown(void);
+
+/**
+ * @brief Get handle of the device installed by msc_test_wait_and_install_device()
+ */
+msc_host_device_handle_t msc_test_get_device(void);
+
+/**
+ * @brief Get VFS handle of the device mounted by msc_test_wait_and_install_device()
+ */
+msc_host_vfs_handle_t msc_test_get_vfs_handle(void);
@@ -259,6 +259,20 @@ typedef enum {
     UAC_PITCH_CONTROL                                 = 0x02
 } uac_ep_control_selector_t;
 
+/**
+ * @brief Isochronous Endpoint bmAttributes
+ *
+ * @see Table 9-13 of usb_20.pdf
+ */
+typedef enum {
+    UAC_EP_SYNC_TYPE_MASK                             = 0x0C,
+    UAC_EP_SYNC_TYPE_ASYNC                            = 0x04,
+    UAC_EP_SYNC_TYPE_ADAPTIVE                         = 0x08,
+    UAC_EP_SYNC_TYPE_SYNC                             = 0x0C,
+    UAC_EP_USAGE_TYPE_MASK                            = 0x30,
+    UAC_EP_USAGE_TYPE_FEEDBACK                        = 0x10
+} uac_ep_attributes_t;
+
 /**
  * @brief Feature Unit Control Position
  *
@@ -490,6 +504,22 @@ typedef struct {
     uint8_t tSamFreq[3 * UAC_FREQ_NUM_MAX];
 } __attribute__((packed)) uac_as_type_I_format_desc_t;
 
+/**
+ * @brief Standard AS Isochronous Audio Data and Synch Endpoint Descriptor
+ *
+ * @see Table 4-20 and Table 4-22 of audio10.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t bInterval;
+    uint8_t bRefresh;
+    uint8_t bSynchAddress;
+} __attribute__((packed)) uac_as_iso_ep_desc_t;
+
 /**
  * @brief Audio Class-Specific AS Isochronous Audio Data Endpoint Descriptor
  *
@@ -504,9 +534,232 @@ typedef struct {
     uint16_t wLockDelay;
 } __attribute__((packed)) uac_as_cs_ep_desc_t;
 
+/********************************* Refer audio20.pdf ***************************************************/
+
+/**
+ * @brief Audio Device Class Specification Release Numbers, bcdADC of the AC Interface Header Descriptor
+ */
+typedef enum {
+    UAC_VERSION_1                                     = 0x0100,
+    UAC_VERSION_2                                     = 0x0200,
+} uac_version_t;
+
+/**
+ * @brief Audio Class-Specific AC Interface Descriptor Subtypes added in UAC 2.0
+ *
+ * @see Table A-9 of audio20.pdf
+ */
+typedef enum {
+    UAC2_AC_CLOCK_SOURCE                              = 0x0A,
+    UAC2_AC_CLOCK_SELECTOR                            = 0x0B,
+    UAC2_AC_CLOCK_MULTIPLIER                          = 0x0C,
+    UAC2_AC_SAMPLE_RATE_CONVERTER                     = 0x0D
+} uac2_ac_descriptor_subtype_t;
+
+/**
+ * @brief Audio Class-Specific Request Codes, the direction is given by bmRequestType
+ *
+ * @see Table A-14 of audio20.pdf
+ */
+typedef enum {
+    UAC2_REQUEST_CODE_UNDEFINED                       = 0x00,
+    UAC2_CUR                                          = 0x01,
+    UAC2_RANGE                                        = 0x02,
+    UAC2_MEM                                          = 0x03
+} uac2_request_code_t;
+
+/**
+ * @brief Clock Source Control Selectors
+ *
+ * @see Table A-17 of audio20.pdf
+ */
+typedef enum {
+    UAC2_CS_CONTROL_UNDEFINED                         = 0x00,
+    UAC2_CS_SAM_FREQ_CONTROL                          = 0x01,
+    UAC2_CS_CLOCK_VALID_CONTROL                       = 0x02
+} uac2_cs_control_selector_t;
+
+/**
+ * @brief Value of a 2-bit control field in bmControls
+ *
+ * @see Section 4.1 of audio20.pdf
+ */
+typedef enum {
+    UAC2_CONTROL_NOT_PRESENT                          = 0x00,
+    UAC2_CONTROL_READ_ONLY                            = 0x01,
+    UAC2_CONTROL_PROGRAMMABLE                         = 0x03,
+    UAC2_CONTROL_MASK                                 = 0x03
+} uac2_control_t;
+
+/**
+ * @brief Audio Class-Specific AC Interface Header Descriptor
+ *
+ * @see Table 4-5 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint16_t bcdADC;
+    uint8_t bCategory;
+    uint16_t wTotalLength;
+    uint8_t bmControls;
+} __attribute__((packed)) uac2_ac_header_desc_t;
+
+/**
+ * @brief Audio Class-Specific AC Clock Source Descriptor
+ *
+ * @see Table 4-6 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bClockID;
+    uint8_t bmAttributes;
+    uint8_t bmControls;
+    uint8_t bAssocTerminal;
+    uint8_t iClockSource;
+} __attribute__((packed)) uac2_ac_clock_source_desc_t;
+
+/**
+ * @brief Audio Class-Specific AC Clock Selector Descriptor (bNrInPins=1)
+ *
+ * @see Table 4-7 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bClockID;
+    uint8_t bNrInPins;
+    uint8_t baCSourceID[1];
+    uint8_t bmControls;
+    uint8_t iClockSelector;
+} __attribute__((packed)) uac2_ac_clock_selector_desc_t;
+
+/**
+ * @brief Audio Class-Specific AC Clock Multiplier Descriptor
+ *
+ * @see Table 4-8 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bClockID;
+    uint8_t bCSourceID;
+    uint8_t bmControls;
+    uint8_t iClockMultiplier;
+} __attribute__((packed)) uac2_ac_clock_multiplier_desc_t;
+
+/**
+ * @brief Audio Class-Specific AC Input Terminal Descriptor
+ *
+ * @see Table 4-9 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t bAssocTerminal;
+    uint8_t bCSourceID;
+    uint8_t bNrChannels;
+    uint32_t bmChannelConfig;
+    uint8_t iChannelNames;
+    uint16_t bmControls;
+    uint8_t iTerminal;
+} __attribute__((packed)) uac2_ac_input_terminal_desc_t;
+
+/**
+ * @brief Audio Class-Specific AC Output Terminal Descriptor
+ *
+ * @see Table 4-10 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t bAssocTerminal;
+    uint8_t bSourceID;
+    uint8_t bCSourceID;
+    uint16_t bmControls;
+    uint8_t iTerminal;
+} __attribute__((packed)) uac2_ac_output_terminal_desc_t;
+
+/**
+ * @brief Audio Class-Specific AC Feature Unit Descriptor (ch=2)
+ *
+ * Each bmaControls entry is 4 bytes with a 2-bit field per control: mute in bits 0-1, volume in bits 2-3
+ *
+ * @see Table 4-13 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bUnitID;
+    uint8_t bSourceID;
+    uint8_t bmaControls[3 * 4]; // 2 channels + channel 0, 4 bytes each
+    uint8_t iFeature;
+} __attribute__((packed)) uac2_ac_feature_unit_desc_t;
+
+/**
+ * @brief Audio Class-Specific AS General Descriptor
+ *
+ * @see Table 4-27 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bTerminalLink;
+    uint8_t bmControls;
+    uint8_t bFormatType;
+    uint32_t bmFormats;
+    uint8_t bNrChannels;
+    uint32_t bmChannelConfig;
+    uint8_t iChannelNames;
+} __attribute__((packed)) uac2_as_general_desc_t;
+
+/**
+ * @brief Audio Class-Specific AS Type I Format Type Descriptor
+ *
+ * @see Table 2-2 of frmts20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bFormatType;
+    uint8_t bSubslotSize;
+    uint8_t bBitResolution;
+} __attribute__((packed)) uac2_as_type_I_format_desc_t;
+
+/**
+ * @brief Audio Class-Specific AS Isochronous Audio Data Endpoint Descriptor
+ *
+ * @see Table 4-34 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bmAttributes;
+    uint8_t bmControls;
+    uint8_t bLockDelayUnits;
+    uint16_t wLockDelay;
+} __attribute__((packed)) uac2_as_cs_ep_desc_t;
+
 /**
  * @brief Print UAC device full configuration descriptor
  *
+ * @note Nothing is printed if CONFIG_UAC_HOST_MINIMAL is enabled
+ *
  * @param cfg_desc
  */
 void print_uac_descriptors(const usb_config_desc_t *cfg_desc);
@@ -32,10 +32,29 @@ extern "C" {
  *
  * FLAG_STREAM_SUSPEND_AFTER_START: do not start stream transfer during start, only claim interface and prepare memory
  * @note User should call uac_host_device_resume to start stream transfer when needed
+ *
+ * FLAG_STREAM_TX_UNDERRUN_SILENCE: keep all TX transfers in flight. If the buffer has less data than one transfer,
+ * the data is sent with silence in place of the missing samples, instead of waiting for the next uac_host_device_write
+ *
+ * FLAG_STREAM_APP_PLANAR: data of uac_host_device_read/uac_host_device_write is planar, all samples of one channel
+ * are stored together. With a buffer of size bytes, each channel takes size / app_channels bytes
+ *
+ * FLAG_STREAM_RX_RESAMPLE: RX stream only. uac_host_device_read resamples the data to the rate it is called at,
+ * keeping the audio buffer half full. The stream then follows the clock of the reading task instead of the device clock,
+ * so streams of several devices can be consumed by one task indefinitely. The correction is limited to +-1000 ppm
+ *
+ * FLAG_STREAM_KEEP_PREPARED: uac_host_device_stop only selects alternate setting 0, the interface stays claimed and
+ * transfers stay allocated. The next uac_host_device_start with the same stream configuration only selects the alternate
+ * setting again, a different configuration releases them first. uac_host_device_close releases them
 */
 #define FLAG_STREAM_SUSPEND_AFTER_START      (1 << 0)
+#define FLAG_STREAM_TX_UNDERRUN_SILENCE      (1 << 1)
+#define FLAG_STREAM_APP_PLANAR               (1 << 2)
+#define FLAG_STREAM_RX_RESAMPLE              (1 << 3)
+#define FLAG_STREAM_KEEP_PREPARED            (1 << 4)
 
 typedef struct uac_interface *uac_host_device_handle_t;    /*!< Logic Device Handle. Handle to a particular UAC interface */
+typedef struct uac_duplex *uac_host_duplex_handle_t;       /*!< Duplex Stream Handle. Handle to a pair of RX and TX interfaces */
 
 // ------------------------ USB UAC Host events --------------------------------
 /**
@@ -71,6 +90,10 @@ typedef void (*uac_host_driver_event_cb_t)(uint8_t addr, uint8_t iface_num,
 /**
  * @brief USB UAC logic device/interface event callback.
  *
+ * @note RX_DONE, TX_DONE and TRANSFER_ERROR are delivered from uac_host_handle_events() after the USB transfers
+ *       which raised them are resubmitted, not from the transfer callbacks. Events of the same type raised before
+ *       the callback runs are delivered once.
+ *
  * @param[in] uac_device_handle     UAC device handle (UAC Interface)
  * @param[in] event                 UAC device event
  * @param[in] arg                   User argument
@@ -142,6 +165,8 @@ typedef struct {
     size_t task_priority;                   /*!< Task priority of created background task */
     size_t stack_size;                      /*!< Stack size of created background task */
     BaseType_t core_id;                     /*!< Select core on which background task will run or tskNO_AFFINITY  */
+    bool shared_client;                     /*!< Use the client installed with usb_host_shared_client_install() instead of own client.
+                                                 Events are handled by the shared client task, create_background_task must be false */
     uac_host_driver_event_cb_t callback;    /*!< Callback invoked when UAC driver event occurs. Must not be NULL. */
     void *callback_arg;                     /*!< User provided argument passed to callback */
 } uac_host_driver_config_t;
@@ -159,6 +184,22 @@ typedef struct {
     void *callback_arg;                                 /*!< User provided argument passed to callback */
 } uac_host_device_config_t;
 
+/**
+ * @brief Callback filling a TX transfer buffer, see uac_host_stream_config_t::tx_fill_cb
+ *
+ * Called when a transfer completes, while the other transfers of the stream are sent, so the data is always
+ * requested uac_host_stream_config_t::urb_num - 1 transfers ahead.
+ *
+ * @note Called from the USB Host client task (uac_host_handle_events), must not block
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] data           Transfer buffer to fill with audio data
+ * @param[in] size            Number of bytes to fill, uac_host_stream_config_t::packets_per_urb packets of the stream
+ * @param[in] arg             User provided argument
+ * @return Number of bytes filled. The rest of the transfer is filled with silence
+ */
+typedef uint32_t (*uac_host_tx_fill_cb_t)(uac_host_device_handle_t uac_dev_handle, uint8_t *data, uint32_t size, void *arg);
+
 /**
  * @brief UAC stream configuration structure
  *
@@ -168,8 +209,69 @@ typedef struct {
     uint8_t bit_resolution;                              /*!< Audio bit resolution */
     uint32_t sample_freq;                                /*!< Audio sample resolution */
     uint16_t flags;                                      /*!< Control flags */
+    uint8_t urb_num;                                     /*!< Number of ISOC URBs, 0 for CONFIG_UAC_NUM_ISOC_URBS */
+    uint8_t packets_per_urb;                             /*!< Packets per ISOC URB, 0 for CONFIG_UAC_NUM_PACKETS_PER_URB.
+                                                              Fewer packets give lower latency, more packets fewer interrupts */
+    uac_host_tx_fill_cb_t tx_fill_cb;                    /*!< TX stream only, can be NULL. If set, all transfers are kept in flight
+                                                              and filled by this callback, the audio buffer and write functions are not used */
+    void *tx_fill_cb_arg;                                /*!< User provided argument passed to tx_fill_cb */
+    uint8_t app_channels;                                /*!< Channels of data passed to read/write, 0 for channels.
+                                                              Mono is copied to all channels, more channels are averaged to mono */
+    uint8_t app_bit_resolution;                          /*!< Bit resolution of data passed to read/write, 0 for bit_resolution.
+                                                              8, 16, 24 or 32, converted to the stream while copying to/from the audio buffer */
 } uac_host_stream_config_t;
 
+/**
+ * @brief Duplex stream callback, processes one period of capture and playback
+ *
+ * Called for every TX transfer from the USB Host client task (uac_host_handle_events), must not block.
+ *
+ * @param[in] rx_data   Captured data of one TX transfer period, missing samples are replaced by silence
+ * @param[in] rx_size   Number of bytes in rx_data
+ * @param[out] tx_data  Transfer buffer to fill with playback data
+ * @param[in] tx_size   Number of bytes to fill
+ * @param[in] arg       User provided argument
+ */
+typedef void (*uac_host_duplex_cb_t)(const uint8_t *rx_data, uint32_t rx_size, uint8_t *tx_data, uint32_t tx_size, void *arg);
+
+/**
+ * @brief UAC duplex stream configuration structure
+ *
+ * urb_num and packets_per_urb of the stream configurations are replaced by the common values,
+ * tx_fill_cb of tx_config must be NULL.
+*/
+typedef struct {
+    uac_host_device_handle_t rx_handle;                  /*!< Opened RX interface */
+    uac_host_device_handle_t tx_handle;                  /*!< Opened TX interface of the same device */
+    uac_host_stream_config_t rx_config;                  /*!< RX stream configuration */
+    uac_host_stream_config_t tx_config;                  /*!< TX stream configuration, with the sample frequency of rx_config */
+    uint8_t urb_num;                                     /*!< Number of ISOC URBs of both streams, 0 for CONFIG_UAC_NUM_ISOC_URBS */
+    uint8_t packets_per_urb;                             /*!< Packets per ISOC URB of both streams, 0 for CONFIG_UAC_NUM_PACKETS_PER_URB */
+    uac_host_duplex_cb_t callback;                       /*!< Duplex stream callback. Must not be NULL */
+    void *callback_arg;                                  /*!< User provided argument passed to callback */
+} uac_host_duplex_config_t;
+
+/**
+ * @brief UAC stream statistics, reset when the stream is started or resumed
+ *
+ * The USB Host Library does not expose the bus frame number. Transfers are timestamped with esp_timer_get_time()
+ * in their completion callback and each ISOC packet is one frame, so `packets` is the frame count since the start.
+ */
+typedef struct {
+    uint64_t packets;                                    /*!< Packets (frames) of completed transfers, including bad packets */
+    uint64_t samples;                                    /*!< Samples of completed transfers. RX: written to the buffer, including silence. TX: sent */
+    uint32_t bad_packets;                                /*!< RX packets with error status, replaced by silence of nominal size */
+    uint32_t overruns;                                   /*!< RX transfers dropped because the buffer was full */
+    uint32_t underruns;                                  /*!< TX transfers sent with silence in place of missing data */
+    int64_t first_xfer_time_us;                          /*!< Completion time of the first transfer */
+    int64_t last_xfer_time_us;                           /*!< Completion time of the last transfer */
+    int32_t drift_ppm;                                   /*!< Measured sample rate relative to the nominal one, 0 until two transfers completed */
+    uint32_t buffer_level_min;                           /*!< Lowest audio buffer level at transfer completion, in bytes */
+    uint32_t buffer_level_max;                           /*!< Highest audio buffer level at transfer completion, in bytes */
+    int32_t resample_ppm;                                /*!< FLAG_STREAM_RX_RESAMPLE: input samples per output sample relative to 1,
+                                                              the device clock relative to the reading task. Else 0 */
+} uac_host_stream_stats_t;
+
 // ----------------------------- Public ---------------------------------------
 /**
  * @brief Install USB Host UAC Class driver
@@ -256,6 +358,20 @@ esp_err_t uac_host_device_close(uac_host_device_handle_t uac_dev_handle);
  */
 esp_err_t uac_host_get_device_info(uac_host_device_handle_t uac_dev_handle, uac_host_dev_info_t *uac_dev_info);
 
+/**
+ * @brief Get UAC stream statistics
+ *
+ * @note Capture time of RX data: the last sample written to the buffer was received at last_xfer_time_us,
+ * so a sample read `n` samples before `samples` was captured about n / sample_freq seconds earlier
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] stats          Pointer to UAC stream statistics structure
+ * @return esp_err_t
+ *  - ESP_OK on success
+ *  - ESP_ERR_INVALID_ARG if the device handle or stats is invalid
+ */
+esp_err_t uac_host_device_get_stats(uac_host_device_handle_t uac_dev_handle, uac_host_stream_stats_t *stats);
+
 /**
  * @brief Get UAC device alt setting parameters by interface alternate index
  *
@@ -272,6 +388,8 @@ esp_err_t uac_host_get_device_alt_param(uac_host_device_handle_t uac_dev_handle,
 /**
  * @brief Print the UAC device information and alternate parameters
  *
+ * @note Nothing is printed if CONFIG_UAC_HOST_MINIMAL is enabled
+ *
  * @param[in] uac_dev_handle  UAC device handle
  * @return esp_err_t
  * - ESP_OK on success
@@ -305,8 +423,12 @@ esp_err_t uac_host_handle_events(uint32_t timeout);
  * - ESP_OK on success
  * - ESP_ERR_INVALID_ARG if the device handle or stream configuration is invalid
  * - ESP_ERR_NOT_FOUND if the stream configuration is not supported
+ * - ESP_ERR_NOT_SUPPORTED if a packet of the stream does not fit the endpoint MPS, the TX endpoint interval is not 1 ms,
+ *   or a High Speed endpoint is serviced less than once per frame
+ * - ESP_ERR_INVALID_SIZE if one URB of the stream is larger than the audio buffer
  * - ESP_ERR_INVALID_STATE if the device is not in the right state
  * - ESP_ERR_NO_MEM if memory allocation failed
+ * - ESP_ERR_NOT_FINISHED if other periodic streams left too little bus bandwidth for the stream
  * - ESP_ERR_TIMEOUT if the control transfer timeout
  */
 esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const uac_host_stream_config_t *stream_config);
@@ -329,13 +451,16 @@ esp_err_t uac_host_device_suspend(uac_host_device_handle_t uac_dev_handle);
  * @return esp_err_t
  * - ESP_OK on success
  * - ESP_ERR_INVALID_ARG if the device handle is invalid
- * - ESP_ERR_INVALID_STATE if the device is not in the right state
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state, or the stream was stopped
+ * - ESP_ERR_NOT_FINISHED if other periodic streams left too little bus bandwidth for the stream
  */
 esp_err_t uac_host_device_resume(uac_host_device_handle_t uac_dev_handle);
 
 /**
  * @brief Stop a UAC stream, stream resources will be released
  *
+ * @note With FLAG_STREAM_KEEP_PREPARED, the interface and transfers are kept for the next uac_host_device_start
+ *
  * @param[in] uac_dev_handle  UAC device handle
  * @return esp_err_t
  * - ESP_OK on success
@@ -347,6 +472,11 @@ esp_err_t uac_host_device_stop(uac_host_device_handle_t uac_dev_handle);
 /**
  * @brief Read data from UAC stream buffer, only available after stream started
  *
+ * @note With app_channels or app_bit_resolution in uac_host_stream_config_t, the data is converted while copying
+ * and whole frames of the application format are read
+ * @note With FLAG_STREAM_RX_RESAMPLE, only one task may read the stream. The number of frames taken from the buffer
+ * differs from the number of frames read by the resampling ratio
+ *
  * @param[in] uac_dev_handle  UAC device handle
  * @param[out] data           Pointer to the buffer to store the data
  * @param[in] size            Number of bytes to read
@@ -365,6 +495,8 @@ esp_err_t uac_host_device_read(uac_host_device_handle_t uac_dev_handle, uint8_t
  *
  * @note The data will be sent to internal ringbuffer before function return,
  * the actual data transfer is scheduled by the background task.
+ * With app_channels or app_bit_resolution in uac_host_stream_config_t, the data is converted while copying,
+ * size should be a multiple of the application frame size.
  *
  * @param[in] uac_dev_handle  UAC device handle
  * @param[in] data            Pointer to the data buffer
@@ -374,11 +506,84 @@ esp_err_t uac_host_device_read(uac_host_device_handle_t uac_dev_handle, uint8_t
  * - ESP_OK on success
  * - ESP_ERR_INVALID_ARG if the device handle or data is invalid
  * - ESP_ERR_INVALID_STATE if the device is not in the right state
+ * - ESP_ERR_NOT_SUPPORTED if the stream was started with tx_fill_cb
  * - ESP_FAIL if write failed or timeout
 */
 esp_err_t uac_host_device_write(uac_host_device_handle_t uac_dev_handle, uint8_t *data, uint32_t size,
                                 uint32_t timeout);
 
+/**
+ * @brief Get received data in UAC stream buffer without copying, only available after stream started
+ *
+ * The returned region is contiguous and stays valid until uac_host_device_read_release().
+ * It may be shorter than the buffered data at the buffer wraparound, acquire again after release to get the rest.
+ * The data is in the stream format, app_channels and app_bit_resolution are not applied.
+ *
+ * @note Only one task may read the stream. Do not mix with uac_host_device_read() while a region is acquired.
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] data           Pointer to the start of the region
+ * @param[out] size           Number of bytes in the region
+ * @param[in] timeout         Timeout in ticks for at least 1 byte. For milliseconds, please use 'pdMS_TO_TICKS()' macros
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle, data or size is invalid
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state or is not an RX stream
+ * - ESP_ERR_NOT_SUPPORTED if the stream was started with FLAG_STREAM_RX_RESAMPLE
+ * - ESP_FAIL if no data until timeout
+ */
+esp_err_t uac_host_device_read_acquire(uac_host_device_handle_t uac_dev_handle, const uint8_t **data, uint32_t *size,
+                                       uint32_t timeout);
+
+/**
+ * @brief Free bytes from the start of the region returned by uac_host_device_read_acquire()
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[in] size            Number of bytes consumed
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle is invalid
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state or is not an RX stream
+ * - ESP_ERR_INVALID_SIZE if size is larger than the buffered data
+ */
+esp_err_t uac_host_device_read_release(uac_host_device_handle_t uac_dev_handle, uint32_t size);
+
+/**
+ * @brief Get free space in UAC stream buffer to write data to without copying, only available after stream started
+ *
+ * The returned region is contiguous, it may be shorter than the free space at the buffer wraparound.
+ * The data is sent after uac_host_device_write_commit().
+ *
+ * @note Only one task may write the stream. Do not mix with uac_host_device_write() while a region is acquired.
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] data           Pointer to the start of the region
+ * @param[out] size           Number of bytes in the region
+ * @param[in] timeout         Timeout in ticks for at least 1 free byte. For milliseconds, please use 'pdMS_TO_TICKS()' macros
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle, data or size is invalid
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state or is not a TX stream
+ * - ESP_ERR_NOT_SUPPORTED if the stream was started with tx_fill_cb
+ * - ESP_FAIL if no free space until timeout
+ */
+esp_err_t uac_host_device_write_acquire(uac_host_device_handle_t uac_dev_handle, uint8_t **data, uint32_t *size,
+                                        uint32_t timeout);
+
+/**
+ * @brief Send bytes written to the start of the region returned by uac_host_device_write_acquire()
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[in] size            Number of bytes written
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle is invalid
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state or is not a TX stream
+ * - ESP_ERR_NOT_SUPPORTED if the stream was started with tx_fill_cb
+ * - ESP_ERR_INVALID_SIZE if size is larger than the acquired region
+ */
+esp_err_t uac_host_device_write_commit(uac_host_device_handle_t uac_dev_handle, uint32_t size);
+
 /**
  * @brief Mute or un-mute the UAC device
  * @param[in] uac_dev_handle  UAC device handle
@@ -459,6 +664,52 @@ esp_err_t uac_host_device_set_volume_db(uac_host_device_handle_t uac_dev_handle,
  */
 esp_err_t uac_host_device_get_volume_db(uac_host_device_handle_t uac_dev_handle, int16_t *volume_db);
 
+// ------------------------ USB UAC Host duplex API ----------------------------
+/**
+ * @brief Start capture and playback of one device as a duplex stream
+ *
+ * Both streams use the same URB geometry and are resumed back to back, so their transfers run in lockstep on the
+ * device's frames. Playback is in TX fill mode: for every TX transfer, the callback gets the same period of captured
+ * data and fills the playback data. The TX ring buffer is not used and at most one period of capture is kept
+ * buffered, older data is dropped.
+ *
+ * @note uac_host_device_read() and uac_host_device_write() must not be used on the interfaces of a duplex stream
+ *
+ * @param[in] config          Pointer to duplex stream configuration structure
+ * @param[out] duplex_handle  Duplex stream handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the configuration is invalid, the interfaces are not RX and TX of one device or sample frequencies differ
+ * - ESP_ERR_NO_MEM if memory allocation failed
+ * - Else: error of uac_host_device_start() or uac_host_device_resume()
+ */
+esp_err_t uac_host_duplex_start(const uac_host_duplex_config_t *config, uac_host_duplex_handle_t *duplex_handle);
+
+/**
+ * @brief Stop both streams of a duplex stream and free it
+ *
+ * @param[in] duplex_handle  Duplex stream handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the duplex handle is invalid
+ * - Else: error of uac_host_device_stop()
+ */
+esp_err_t uac_host_duplex_stop(uac_host_duplex_handle_t duplex_handle);
+
+/**
+ * @brief Get the loopback delay of a duplex stream
+ *
+ * Time from capture of a sample to playback of the data produced for it in the same callback: capture buffered
+ * in the RX URB and ring buffer plus the playback queued in TX URBs. Updated for every TX transfer.
+ *
+ * @param[in] duplex_handle  Duplex stream handle
+ * @param[out] delay_us      Loopback delay in microseconds
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the duplex handle or delay_us is invalid
+ */
+esp_err_t uac_host_duplex_get_delay(uac_host_duplex_handle_t duplex_handle, uint32_t *delay_us);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -8,11 +8,16 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/param.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "unity.h"
 #include "esp_private/usb_phy.h"
 #include "usb/usb_host.h"
@@ -526,12 +531,159 @@ TEST_CASE("test uac rx reading", "[uac_host][rx]")
     }
 exit_rx:
     ESP_LOGI(TAG, "Stop reading data from MIC");
+    uac_host_stream_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_get_stats(uac_device_handle, &stats));
+    ESP_LOGI(TAG, "%"PRIu64" packets, %"PRIu64" samples, %"PRIu32" bad packets, %"PRIu32" overruns, drift %"PRIi32" ppm",
+             stats.packets, stats.samples, stats.bad_packets, stats.overruns, stats.drift_ppm);
+    TEST_ASSERT_GREATER_OR_EQUAL(time_counter * iface_alt_params.sample_freq[0] / 1000, stats.samples);
+    TEST_ASSERT_GREATER_THAN(stats.first_xfer_time_us, stats.last_xfer_time_us);
     TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_set_mute(uac_device_handle, 1));
     TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_close(uac_device_handle));
 
     free(rx_buffer);
 }
 
+/**
+ * @brief start and stop the microphone repeatedly with FLAG_STREAM_KEEP_PREPARED,
+ * the transfers are allocated only once and the stream delivers data after every start
+ */
+TEST_CASE("test uac rx start stop keep prepared", "[uac_host][rx]")
+{
+    uint8_t mic_iface_num = 0;
+    uint8_t spk_iface_num = 0;
+    uint8_t if_rx = false;
+    test_handle_dev_connection(&mic_iface_num, &if_rx);
+    if (!if_rx) {
+        spk_iface_num = mic_iface_num;
+        test_handle_dev_connection(&mic_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, true);
+    } else {
+        test_handle_dev_connection(&spk_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, false);
+    }
+
+    const uint32_t buffer_size = 19200;
+    const uint32_t read_size = 960;
+    const int cycles = 10;
+
+    uac_host_device_handle_t uac_device_handle = NULL;
+    test_open_mic_device(mic_iface_num, buffer_size, 0, &uac_device_handle);
+    uac_host_dev_alt_param_t iface_alt_params;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_get_device_alt_param(uac_device_handle, 1, &iface_alt_params));
+    uac_host_stream_config_t stream_config = {
+        .channels = iface_alt_params.channels,
+        .bit_resolution = iface_alt_params.bit_resolution,
+        .sample_freq = iface_alt_params.sample_freq[0],
+        .flags = FLAG_STREAM_KEEP_PREPARED,
+    };
+    uint8_t *rx_buffer = (uint8_t *)calloc(1, read_size);
+    TEST_ASSERT_NOT_NULL(rx_buffer);
+
+    size_t free_heap = 0;
+    int64_t start_us_max = 0;
+    for (int i = 0; i < cycles; i++) {
+        const int64_t start_us = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_start(uac_device_handle, &stream_config));
+        start_us_max = (i > 0) ? MAX(start_us_max, esp_timer_get_time() - start_us) : 0;
+        uint32_t rx_size = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_read(uac_device_handle, rx_buffer, read_size, &rx_size, pdMS_TO_TICKS(1000)));
+        TEST_ASSERT_GREATER_THAN(0, rx_size);
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_stop(uac_device_handle));
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, uac_host_device_resume(uac_device_handle));
+        if (i == 0) {
+            free_heap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+        } else {
+            // Nothing is allocated or freed by the later cycles
+            TEST_ASSERT_EQUAL(free_heap, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+        }
+    }
+    ESP_LOGI(TAG, "%d start/stop cycles, restart takes at most %"PRIi64" us", cycles, start_us_max);
+
+    // Different configuration releases the kept transfers and allocates new ones
+    stream_config.urb_num = CONFIG_UAC_NUM_ISOC_URBS + 1;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_start(uac_device_handle, &stream_config));
+    uint32_t rx_size = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_read(uac_device_handle, rx_buffer, read_size, &rx_size, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_GREATER_THAN(0, rx_size);
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_stop(uac_device_handle));
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_close(uac_device_handle));
+
+    free(rx_buffer);
+}
+
+/**
+ * @brief read the microphone with FLAG_STREAM_RX_RESAMPLE at a rate 500 ppm below nominal,
+ * the resampler takes up the difference and the device drift without overruns
+ */
+TEST_CASE("test uac rx resampling", "[uac_host][rx]")
+{
+    uint8_t mic_iface_num = 0;
+    uint8_t spk_iface_num = 0;
+    uint8_t if_rx = false;
+    test_handle_dev_connection(&mic_iface_num, &if_rx);
+    if (!if_rx) {
+        spk_iface_num = mic_iface_num;
+        test_handle_dev_connection(&mic_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, true);
+    } else {
+        test_handle_dev_connection(&spk_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, false);
+    }
+
+    const uint32_t buffer_size = 19200;
+    const uint32_t chunk_ms = 10;
+    const uint32_t duration_ms = 20000;
+    const int32_t reader_offset_ppm = -500;
+
+    uac_host_device_handle_t uac_device_handle = NULL;
+    test_open_mic_device(mic_iface_num, buffer_size, 0, &uac_device_handle);
+    uac_host_dev_alt_param_t iface_alt_params;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_get_device_alt_param(uac_device_handle, 1, &iface_alt_params));
+    const uint32_t sample_freq = iface_alt_params.sample_freq[0];
+    const uac_host_stream_config_t stream_config = {
+        .channels = iface_alt_params.channels,
+        .bit_resolution = iface_alt_params.bit_resolution,
+        .sample_freq = sample_freq,
+        .flags = FLAG_STREAM_RX_RESAMPLE,
+        .app_channels = 1,
+        .app_bit_resolution = 16,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_start(uac_device_handle, &stream_config));
+    const uint8_t *region = NULL;
+    uint32_t region_size = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, uac_host_device_read_acquire(uac_device_handle, &region, &region_size, 0));
+
+    const uint32_t chunk_samples = sample_freq * chunk_ms / 1000;
+    int16_t *rx_chunk = (int16_t *)calloc(chunk_samples, sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(rx_chunk);
+    const double reader_freq = sample_freq * (1.0 + reader_offset_ppm / 1e6);
+    uint64_t read = 0;
+    int64_t start = 0;
+    while (read < (uint64_t)sample_freq * duration_ms / 1000) {
+        uint32_t rx_size = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_read(uac_device_handle, (uint8_t *)rx_chunk, chunk_samples * sizeof(int16_t),
+                                                       &rx_size, pdMS_TO_TICKS(1000)));
+        if (!start) {
+            start = esp_timer_get_time();
+        }
+        read += rx_size / sizeof(int16_t);
+        // consume at the reader clock
+        while (esp_timer_get_time() - start < (int64_t)(read * 1000000 / reader_freq)) {
+            vTaskDelay(1);
+        }
+    }
+
+    uac_host_stream_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_get_stats(uac_device_handle, &stats));
+    ESP_LOGI(TAG, "drift %"PRIi32" ppm, resampling %"PRIi32" ppm, %"PRIu32" overruns, buffer %"PRIu32"-%"PRIu32" B",
+             stats.drift_ppm, stats.resample_ppm, stats.overruns, stats.buffer_level_min, stats.buffer_level_max);
+    TEST_ASSERT_EQUAL(0, stats.overruns);
+    TEST_ASSERT_INT32_WITHIN(150, stats.drift_ppm - reader_offset_ppm, stats.resample_ppm);
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_close(uac_device_handle));
+
+    free(rx_chunk);
+}
+
 /**
  * @brief playback the wav sound to speaker, the wav will be down-sampled
  * if the device's sample frequency is not matched
@@ -869,6 +1021,304 @@ exit_rx:
     }
 }
 
+static volatile bool s_load_task_run;
+static volatile uint32_t s_load_task_loops;
+
+/**
+ * @brief Lowest priority busy loop on the USB tasks' core, its loop rate drops with CPU time used by the driver
+ */
+static void load_task(void *arg)
+{
+    while (s_load_task_run) {
+        s_load_task_loops++;
+    }
+    xTaskNotifyGive(arg);
+    vTaskDelete(NULL);
+}
+
+static void load_task_start(void)
+{
+    s_load_task_loops = 0;
+    s_load_task_run = true;
+    TEST_ASSERT_EQUAL(pdTRUE, xTaskCreatePinnedToCore(load_task, "load", 2048, xTaskGetCurrentTaskHandle(), 1, NULL, 0));
+}
+
+static uint32_t load_task_stop(void)
+{
+    s_load_task_run = false;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return s_load_task_loops;
+}
+
+/**
+ * @brief Compare latency against CPU load of MIC streams with different URB geometry
+ *
+ * Latency is the average time between two deliveries of data by the driver, the CPU load is the share of a
+ * low priority busy loop's iterations lost compared to a run without stream.
+ */
+TEST_CASE("test uac rx urb geometry benchmark", "[uac_host][rx][benchmark]")
+{
+    uint8_t mic_iface_num = 0;
+    uint8_t spk_iface_num = 0;
+    uint8_t if_rx = false;
+    test_handle_dev_connection(&mic_iface_num, &if_rx);
+    if (!if_rx) {
+        spk_iface_num = mic_iface_num;
+        test_handle_dev_connection(&mic_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, true);
+    } else {
+        test_handle_dev_connection(&spk_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, false);
+    }
+
+    const uint32_t buffer_size = 19200;
+    const uint32_t duration_ms = 2000;
+    const struct {
+        uint8_t urb_num;
+        uint8_t packets_per_urb;
+    } geometry[] = {{2, 1}, {3, 3}, {3, 10}, {2, 32}};
+
+    uac_host_device_handle_t uac_device_handle = NULL;
+    // threshold equal to buffer size, data is read without RX_DONE events
+    test_open_mic_device(mic_iface_num, buffer_size, buffer_size, &uac_device_handle);
+    uac_host_dev_alt_param_t iface_alt_params;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_get_device_alt_param(uac_device_handle, 1, &iface_alt_params));
+
+    load_task_start();
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    const uint32_t idle_loops = load_task_stop();
+    printf("URBs  packets  latency [us]  CPU load [%%]\n");
+    for (int i = 0; i < sizeof(geometry) / sizeof(geometry[0]); i++) {
+        const uac_host_stream_config_t stream_config = {
+            .channels = iface_alt_params.channels,
+            .bit_resolution = iface_alt_params.bit_resolution,
+            .sample_freq = iface_alt_params.sample_freq[0],
+            .urb_num = geometry[i].urb_num,
+            .packets_per_urb = geometry[i].packets_per_urb,
+        };
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_start(uac_device_handle, &stream_config));
+
+        load_task_start();
+        uint32_t deliveries = 0;
+        const int64_t start = esp_timer_get_time();
+        int64_t last = start;
+        int64_t last_delivery = start;
+        while (last - start < duration_ms * 1000) {
+            const uint8_t *data = NULL;
+            uint32_t size = 0;
+            if (uac_host_device_read_acquire(uac_device_handle, &data, &size, pdMS_TO_TICKS(100)) == ESP_OK) {
+                TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_read_release(uac_device_handle, size));
+                // packets of one URB are buffered back to back, count them as one delivery
+                const int64_t now = esp_timer_get_time();
+                if (now - last_delivery > 250) {
+                    deliveries++;
+                }
+                last_delivery = now;
+            }
+            last = esp_timer_get_time();
+        }
+        const uint32_t loops = load_task_stop();
+        TEST_ASSERT_GREATER_THAN(0, deliveries);
+
+        const uint32_t latency_us = (uint32_t)((last - start) / deliveries);
+        const uint32_t load = loops < idle_loops ? 100 - (uint32_t)((uint64_t)loops * 100 / idle_loops) : 0;
+        printf("%4d  %7d  %12"PRIu32"  %12"PRIu32"\n", geometry[i].urb_num, geometry[i].packets_per_urb, latency_us, load);
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_stop(uac_device_handle));
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_close(uac_device_handle));
+    test_uac_queue_reset();
+}
+
+/**
+ * @brief Loopback glitch detector state, for a sine of known frequency
+ *
+ * A sample is a glitch if the second difference of the signal is larger than a sine of the peak amplitude can have.
+ */
+typedef struct {
+    int16_t prev[2];
+    int32_t peak;
+    uint32_t samples;
+    uint32_t glitches;
+} glitch_detector_t;
+
+static void glitch_detector_feed(glitch_detector_t *det, const int16_t *data, size_t num, float max_step)
+{
+    for (size_t i = 0; i < num; i++) {
+        const int32_t x = data[i];
+        det->peak = MAX(det->peak, abs(x));
+        if (det->samples >= 2) {
+            const int32_t second_diff = x - 2 * det->prev[1] + det->prev[0];
+            // 4x margin and a noise floor for analog loopbacks
+            if (abs(second_diff) > (int32_t)(4 * max_step * det->peak) + 256) {
+                det->glitches++;
+            }
+        }
+        det->prev[0] = det->prev[1];
+        det->prev[1] = x;
+        det->samples++;
+    }
+}
+
+/**
+ * @brief Loopback benchmark: sine written to the speaker, read back from the microphone
+ *
+ * The device or a cable must loop the speaker to the microphone. Both streams use 16-bit mono in the application,
+ * converted by the driver. For each URB geometry, prints:
+ * - latency from uac_host_device_write() of the first sine samples to uac_host_device_read() returning them
+ * - glitches: discontinuities in the recorded sine, RX bad packets and overruns, TX underruns
+ * - CPU time per ms of audio, from the iterations lost by a low priority busy loop
+ * - lowest and highest levels of both audio buffers
+ */
+TEST_CASE("test uac tx rx loopback benchmark", "[uac_host][tx][rx][benchmark]")
+{
+    uint8_t mic_iface_num = 0;
+    uint8_t spk_iface_num = 0;
+    uint8_t if_rx = false;
+    test_handle_dev_connection(&mic_iface_num, &if_rx);
+    if (!if_rx) {
+        spk_iface_num = mic_iface_num;
+        test_handle_dev_connection(&mic_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, true);
+    } else {
+        test_handle_dev_connection(&spk_iface_num, &if_rx);
+        TEST_ASSERT_EQUAL(if_rx, false);
+    }
+
+    const uint32_t buffer_size = 19200;
+    const uint32_t duration_ms = 3000;
+    const uint32_t silence_ms = 300;
+    const uint32_t chunk_ms = 10;
+    const uint32_t prefill_ms = 40;
+    const float sine_freq = 250.0f;
+    const struct {
+        uint8_t urb_num;
+        uint8_t packets_per_urb;
+    } geometry[] = {{2, 1}, {3, 3}, {3, 10}, {2, 32}};
+
+    uac_host_device_handle_t mic_device_handle = NULL;
+    uac_host_device_handle_t spk_device_handle = NULL;
+    // threshold equal to buffer size, no RX_DONE events. TX_DONE events are dropped by the full queue
+    test_open_mic_device(mic_iface_num, buffer_size, buffer_size, &mic_device_handle);
+    test_open_spk_device(spk_iface_num, buffer_size, 0, &spk_device_handle);
+    uac_host_dev_alt_param_t mic_alt_params;
+    uac_host_dev_alt_param_t spk_alt_params;
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_get_device_alt_param(mic_device_handle, 1, &mic_alt_params));
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_get_device_alt_param(spk_device_handle, 1, &spk_alt_params));
+    const uint32_t sample_freq = mic_alt_params.sample_freq[0];
+    const uint32_t chunk_samples = sample_freq * chunk_ms / 1000;
+    const float max_step = powf(2.0f * (float)M_PI * sine_freq / sample_freq, 2);
+
+    int16_t *tx_chunk = (int16_t *)calloc(chunk_samples, sizeof(int16_t));
+    int16_t *rx_chunk = (int16_t *)calloc(chunk_samples, sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(tx_chunk);
+    TEST_ASSERT_NOT_NULL(rx_chunk);
+
+    load_task_start();
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    const uint32_t idle_loops = load_task_stop();
+    printf("URBs  packets  latency [us]  glitches  CPU [us/ms]  RX buffer [B]  TX buffer [B]\n");
+    for (int i = 0; i < sizeof(geometry) / sizeof(geometry[0]); i++) {
+        const uac_host_stream_config_t mic_config = {
+            .channels = mic_alt_params.channels,
+            .bit_resolution = mic_alt_params.bit_resolution,
+            .sample_freq = sample_freq,
+            .flags = FLAG_STREAM_SUSPEND_AFTER_START,
+            .urb_num = geometry[i].urb_num,
+            .packets_per_urb = geometry[i].packets_per_urb,
+            .app_channels = 1,
+            .app_bit_resolution = 16,
+        };
+        const uac_host_stream_config_t spk_config = {
+            .channels = spk_alt_params.channels,
+            .bit_resolution = spk_alt_params.bit_resolution,
+            .sample_freq = sample_freq,
+            .flags = FLAG_STREAM_SUSPEND_AFTER_START,
+            .urb_num = geometry[i].urb_num,
+            .packets_per_urb = geometry[i].packets_per_urb,
+            .app_channels = 1,
+            .app_bit_resolution = 16,
+        };
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_start(mic_device_handle, &mic_config));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_start(spk_device_handle, &spk_config));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_set_mute(mic_device_handle, 0));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_set_mute(spk_device_handle, 0));
+
+        glitch_detector_t detector = {0};
+        uint64_t written = 0;
+        uint64_t read = 0;
+        const uint64_t sine_start = (uint64_t)sample_freq * silence_ms / 1000;
+        int64_t sine_write_time = 0;
+        int64_t sine_read_time = 0;
+
+        load_task_start();
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_resume(mic_device_handle));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_resume(spk_device_handle));
+        const int64_t start = esp_timer_get_time();
+        while (esp_timer_get_time() - start < duration_ms * 1000) {
+            // keep prefill_ms of audio ahead of what was recorded
+            while (written < read + sample_freq * prefill_ms / 1000) {
+                for (uint32_t n = 0; n < chunk_samples; n++) {
+                    const uint64_t index = written + n;
+                    tx_chunk[n] = (index < sine_start) ? 0 :
+                                  (int16_t)(8192.0f * sinf(2.0f * (float)M_PI * sine_freq * (index - sine_start) / sample_freq));
+                }
+                if (uac_host_device_write(spk_device_handle, (uint8_t *)tx_chunk, chunk_samples * sizeof(int16_t), 0) != ESP_OK) {
+                    break;
+                }
+                if (written <= sine_start && sine_start < written + chunk_samples) {
+                    sine_write_time = esp_timer_get_time() + (int64_t)(sine_start - written) * 1000000 / sample_freq;
+                }
+                written += chunk_samples;
+            }
+
+            uint32_t rx_size = 0;
+            if (uac_host_device_read(mic_device_handle, (uint8_t *)rx_chunk, chunk_samples * sizeof(int16_t), &rx_size,
+                                     pdMS_TO_TICKS(chunk_ms)) != ESP_OK) {
+                continue;
+            }
+            const size_t rx_samples = rx_size / sizeof(int16_t);
+            size_t onset = 0;
+            if (!sine_read_time) {
+                // the sine starts with the first sample above 1/8 of its amplitude
+                while (onset < rx_samples && abs(rx_chunk[onset]) < 1024) {
+                    onset++;
+                }
+                if (onset < rx_samples) {
+                    sine_read_time = esp_timer_get_time();
+                }
+            }
+            if (sine_read_time) {
+                glitch_detector_feed(&detector, rx_chunk + onset, rx_samples - onset, max_step);
+            }
+            read += rx_samples;
+        }
+        const uint32_t loops = load_task_stop();
+
+        uac_host_stream_stats_t mic_stats;
+        uac_host_stream_stats_t spk_stats;
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_get_stats(mic_device_handle, &mic_stats));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_get_stats(spk_device_handle, &spk_stats));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_stop(spk_device_handle));
+        TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_stop(mic_device_handle));
+        TEST_ASSERT_NOT_EQUAL(0, sine_read_time);
+
+        const uint32_t latency_us = (uint32_t)(sine_read_time - sine_write_time);
+        const uint32_t glitches = detector.glitches + mic_stats.bad_packets + mic_stats.overruns + spk_stats.underruns;
+        const uint32_t lost_loops = loops < idle_loops ? idle_loops - loops : 0;
+        const uint32_t cpu_us_per_ms = (uint32_t)((uint64_t)lost_loops * 1000 / idle_loops);
+        printf("%4d  %7d  %12"PRIu32"  %8"PRIu32"  %11"PRIu32"  %5"PRIu32" %7"PRIu32"  %5"PRIu32" %7"PRIu32"\n",
+               geometry[i].urb_num, geometry[i].packets_per_urb, latency_us, glitches, cpu_us_per_ms,
+               mic_stats.buffer_level_min, mic_stats.buffer_level_max, spk_stats.buffer_level_min, spk_stats.buffer_level_max);
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_close(spk_device_handle));
+    TEST_ASSERT_EQUAL(ESP_OK, uac_host_device_close(mic_device_handle));
+    free(tx_chunk);
+    free(rx_chunk);
+    test_uac_queue_reset();
+}
+
 /**
  * @brief: Test disconnect the device when the stream is running
  * @note: Currently, the P4 PHY can't be controlled to emulate the hot-plug event,
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
+#include "sdkconfig.h"
 #include "usb/usb_helpers.h"
 #include "usb/usb_types_ch9.h"
 #include "esp_check.h"
@@ -17,6 +18,7 @@
 
 // ----------------------------------------------- Descriptor Printing -------------------------------------------------
 
+#ifndef CONFIG_UAC_HOST_MINIMAL
 static void print_ep_desc(const usb_ep_desc_t *ep_desc)
 {
     const char *ep_type_str;
@@ -355,3 +357,9 @@ void print_uac_descriptors(const usb_config_desc_t *cfg_desc)
 {
     usb_print_config_descriptor_with_context(cfg_desc, print_uac_class_descriptors);
 }
+#else
+void print_uac_descriptors(const usb_config_desc_t *cfg_desc)
+{
+    (void)cfg_desc;
+}
+#endif // CONFIG_UAC_HOST_MINIMAL
@@ -13,14 +13,23 @@
 #include <sys/queue.h>
 #include <sys/param.h>
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/ringbuf.h"
 #include "usb/usb_host.h"
+#include "usb/usb_host_shared_client.h"
+#include "usb/usb_host_urb_pool.h"
+#include "usb/usb_host_desc_index.h"
+#include "usb/usb_host_class_trace.h"
+#include "usb/usb_class_stats.h"
+#include "usb/usb_host_bw.h"
 #include "usb/uac_host.h"
 #include "usb/usb_types_ch9.h"
 
@@ -29,6 +38,8 @@ static portMUX_TYPE uac_lock = portMUX_INITIALIZER_UNLOCKED;
 #define UAC_ENTER_CRITICAL()    portENTER_CRITICAL(&uac_lock)
 #define UAC_EXIT_CRITICAL()     portEXIT_CRITICAL(&uac_lock)
 
+#define UAC_TRACE(event, xfer) USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_UAC, USB_HOST_CLASS_TRACE_##event, xfer)
+
 // UAC verification macros
 #define UAC_GOTO_ON_FALSE_CRITICAL(exp, err)    \
     do {                                        \
@@ -58,16 +69,6 @@ static portMUX_TYPE uac_lock = portMUX_INITIALIZER_UNLOCKED;
 #define UAC_RETURN_ON_INVALID_ARG(exp) ESP_RETURN_ON_FALSE((exp) != NULL, ESP_ERR_INVALID_ARG, TAG, "Argument error")
 
 // USB Descriptor parsing helping macros
-#define GET_NEXT_INTERFACE_DESC(p, max_len, offs)                                                \
-    ((const usb_intf_desc_t *)usb_parse_next_descriptor_of_type((const usb_standard_desc_t *)p,  \
-                                                                max_len,                         \
-                                                                USB_B_DESCRIPTOR_TYPE_INTERFACE, \
-                                                                &(offs)))
-#define GET_NEXT_UAC_CS_DESC(p, max_len, offs)                                                      \
-    ((const uac_desc_header_t *)usb_parse_next_descriptor_of_type((const usb_standard_desc_t *)p, \
-                                                                max_len,                         \
-                                                                UAC_CS_INTERFACE,   \
-                                                                &(offs)))
 #define GET_NEXT_DESC(p, max_len, offs)                                                            \
     ((const usb_standard_desc_t *)usb_parse_next_descriptor((const usb_standard_desc_t *)p,       \
                                                             max_len,                               \
@@ -77,11 +78,39 @@ static const char *TAG = "uac-host";
 
 #define DEFAULT_CTRL_XFER_TIMEOUT_MS        (5000)
 #define DEFAULT_ISOC_XFER_TIMEOUT_MS        (100)
+#define UAC_CONVERT_CHANNELS_MAX            (8)
+#define UAC2_FREQ_SUBRANGE_NUM_MAX          (16)   // Clock frequency subranges read from UAC 2.0 devices
+#define UAC2_CTRL_XFER_SIZE                 (USB_SETUP_PACKET_SIZE + 2 + UAC2_FREQ_SUBRANGE_NUM_MAX * 12)
 #define INTERFACE_FLAGS_OFFSET              (16)
 #define FLAG_INTERFACE_WAIT_USER_DELETE     (1 << INTERFACE_FLAGS_OFFSET)
+#define FLAG_INTERFACE_STOPPED_PREPARED     (1 << (INTERFACE_FLAGS_OFFSET + 1))  // READY after stop with FLAG_STREAM_KEEP_PREPARED
 #define UAC_EP_DIR_IN                       (0x80)
 #define VOLUME_DB_MIN                       (-127.9961f)
 #define VOLUME_DB_MAX                       (127.9961f)
+#define UAC_RINGBUF_CACHE_LINE              (64)   // Largest cache line of supported targets. Keeps producer and consumer indexes apart
+#define UAC_RESAMPLE_TAPS                   (16)   // FIR taps of one resampler filter phase
+#define UAC_RESAMPLE_PHASE_BITS             (5)    // 32 filter phases per input sample, coefficients are interpolated between them
+#define UAC_RESAMPLE_PHASES                 (1 << UAC_RESAMPLE_PHASE_BITS)
+#define UAC_RESAMPLE_COEF_SHIFT             (20)   // Filter coefficients are Q20
+#define UAC_RESAMPLE_ONE                    (1ULL << 32) // One input sample in resampler positions, Q32
+#define UAC_RESAMPLE_BLOCK_FRAMES           (32)   // Frames resampled at once before conversion to the application format
+#define UAC_RESAMPLE_PPM_MAX                (1000.0f)
+#define UAC_RESAMPLE_TIME_CONSTANT_S        (4.0f) // Time constant of the buffer level control loop
+#define UAC_RESAMPLE_LEVEL_FILTER_S         (0.25f) // Time constant of the buffer level low-pass filter, smooths URB sized steps
+
+/**
+ * @brief Terminal or unit of the Audio Control interface
+ */
+typedef struct {
+    uint8_t id;                                     /*!< Terminal or unit ID */
+    uint8_t subtype;                                /*!< Descriptor subtype */
+    uint8_t source_id;                              /*!< First source, 0 for input terminals */
+    uint8_t next_id;                                /*!< First entity in descriptor order with this one as a source, 0 if none */
+    uint8_t clock_id;                               /*!< UAC 2.0 terminals: clock entity of the terminal, else 0 */
+    uint8_t freq_range_num;                         /*!< UAC 2.0 clock sources: number of frequency subranges in freq_ranges */
+    uint32_t (*freq_ranges)[3];                     /*!< UAC 2.0 clock sources: MIN, MAX, RES of each subrange, NULL if not read yet */
+    const uac_desc_header_t *desc;                  /*!< Descriptor in cs_ac_desc */
+} uac_ac_entity_t;
 
 /**
  * @brief UAC Device structure.
@@ -94,11 +123,16 @@ typedef struct uac_host_device {
     // constant values after device opening
     usb_device_handle_t dev_hdl;                    /*!< USB device handle */
     uint8_t addr;                                   /*!< USB device address */
+    usb_host_desc_index_t *desc_index;              /*!< Index of the active Configuration Descriptor */
     SemaphoreHandle_t device_busy;                  /*!< UAC device main mutex */
     SemaphoreHandle_t ctrl_xfer_done;               /*!< Control transfer semaphore */
     usb_transfer_t *ctrl_xfer;                      /*!< Pointer to control transfer buffer */
     uint8_t ctrl_iface_num;                         /*!< Control interface number */
+    uint16_t uac_version;                           /*!< bcdADC of the Audio Control interface, UAC_VERSION_1 or UAC_VERSION_2 */
     uint8_t *cs_ac_desc;                            /*!< Class-Specific Audio Control Interface descriptor */
+    size_t cs_ac_desc_len;                          /*!< Total length of cs_ac_desc */
+    uac_ac_entity_t *entities;                      /*!< Terminals and units in cs_ac_desc, in descriptor order */
+    uint8_t entity_num;                             /*!< Number of entities */
 } uac_device_t;
 
 /**
@@ -124,6 +158,12 @@ typedef struct uac_interface_alt {
     uint16_t ep_mps;                           /*!< audio stream endpoint max size */
     uint8_t ep_attr;                           /*!< audio stream endpoint attributes */
     uint8_t interval;                          /*!< audio stream endpoint interval */
+    const usb_ep_desc_t *ep_desc;              /*!< audio stream endpoint descriptor, for bus bandwidth reservation */
+    uint8_t subslot_size;                      /*!< bytes per sample of one channel in USB transfers */
+    uint8_t clock_id;                          /*!< UAC 2.0: clock source of the connected terminal, else 0 */
+    uint8_t fb_ep_addr;                        /*!< explicit feedback endpoint number, 0 if not present */
+    uint16_t fb_ep_mps;                        /*!< explicit feedback endpoint max size */
+    const usb_ep_desc_t *fb_ep_desc;           /*!< explicit feedback endpoint descriptor, NULL if not present */
     uint8_t connected_terminal;                /*!< connected terminal ID */
     uint8_t feature_unit;                      /*!< connected feature unit ID */
     uint8_t vol_ch_map;                        /*!< volume channel map */
@@ -132,6 +172,59 @@ typedef struct uac_interface_alt {
     uac_host_dev_alt_param_t dev_alt_param;    /*!< audio stream alternate setting parameters */
 } uac_iface_alt_t;
 
+/**
+ * @brief Lock-free ring buffer for audio data
+ *
+ * One producer (RX: USB callback, TX: uac_host_device_write) and any number of consumers, which claim data with CAS.
+ * head and tail are free running byte counters, so length is their difference and needs no lock.
+ * The first `mirror` bytes of the buffer are also stored behind its end; reads of up to `mirror` bytes
+ * (one URB of the largest alternate setting) are then a single memcpy, even if they wrap around.
+ */
+typedef struct uac_ringbuf {
+    _Alignas(UAC_RINGBUF_CACHE_LINE) atomic_size_t head;   /*!< Bytes written since creation. Written by producer */
+    _Alignas(UAC_RINGBUF_CACHE_LINE) atomic_size_t tail;   /*!< Bytes read since creation. Written by consumers */
+    _Alignas(UAC_RINGBUF_CACHE_LINE) uint8_t *buf;         /*!< Data storage of size + mirror bytes */
+    size_t size;                                           /*!< Capacity in bytes */
+    size_t mirror;                                         /*!< Bytes mirrored behind the end of buf */
+    atomic_bool reader_waiting;                            /*!< A reader waits for data_sem */
+    atomic_bool writer_waiting;                            /*!< A writer waits for space_sem */
+    atomic_bool closed;                                    /*!< Blocked and new readers and writers return immediately */
+    SemaphoreHandle_t data_sem;                            /*!< Given after write if a reader waits */
+    SemaphoreHandle_t space_sem;                           /*!< Given after read if a writer waits */
+} uac_ringbuf_t;
+
+/**
+ * @brief Layout of PCM samples in a buffer
+ */
+typedef struct {
+    uint8_t channels;                          /*!< Number of channels */
+    uint8_t bytes;                             /*!< Bytes per sample of one channel, little endian */
+    bool is_unsigned;                          /*!< Unsigned samples with 0x80.. as zero, 8-bit PCM */
+    bool planar;                               /*!< All samples of a channel are stored together, else interleaved */
+} uac_pcm_format_t;
+
+/**
+ * @brief Adaptive resampler of an RX stream with FLAG_STREAM_RX_RESAMPLE
+ *
+ * Polyphase FIR interpolator. Its ratio is set by a PI controller, which keeps the audio buffer half full,
+ * so the output follows the rate uac_host_device_read() is called at. Used by the single reading task only.
+ */
+typedef struct {
+    int32_t coef[UAC_RESAMPLE_PHASES + 1][UAC_RESAMPLE_TAPS];   /*!< Filter phases, Q20. The last one is the first delayed by one sample */
+    int32_t hist[UAC_CONVERT_CHANNELS_MAX][2 * UAC_RESAMPLE_TAPS];   /*!< Last input samples of each channel, stored twice to be contiguous */
+    int32_t block[UAC_RESAMPLE_BLOCK_FRAMES * UAC_CONVERT_CHANNELS_MAX];  /*!< Resampled frames, left justified 32-bit */
+    uint8_t frame[UAC_CONVERT_CHANNELS_MAX * sizeof(int32_t)];  /*!< Input frame split by the end of the audio buffer */
+    uint8_t hist_pos;                          /*!< Oldest sample in hist */
+    uint64_t pos;                              /*!< Position of the next output sample behind the filter center, Q32 */
+    uint64_t step;                             /*!< Input samples per output sample, Q32 */
+    const uint8_t *src;                        /*!< Acquired region of the audio buffer */
+    size_t src_len;                            /*!< Bytes of the acquired region */
+    size_t src_used;                           /*!< Bytes of the acquired region taken as input */
+    float level_avg;                           /*!< Filtered audio buffer level in frames, negative before the first read */
+    float integral;                            /*!< Integrated buffer level error, frames * s */
+    uint32_t frames_out;                       /*!< Frames read since the last controller update */
+} uac_resampler_t;
+
 /**
  * @brief UAC Interface structure in device to interact with. After UAC device opening keeps the interface configuration
  *
@@ -147,23 +240,64 @@ typedef struct uac_interface {
     uint32_t flags;                            /*!< Interface flags */
     uint8_t cur_alt;                           /*!< Current alternate setting (-1) */
     uint8_t cur_vol;                           /*!< volume % 0-100 */
+    uac_host_tx_fill_cb_t tx_fill_cb;          /*!< TX transfers are filled by this callback instead of from ringbuf */
+    void *tx_fill_cb_arg;                      /*!< TX fill callback arg */
+    uac_host_stream_config_t stream_config;    /*!< Configuration of the last uac_host_device_start */
     // constant parameters after interface opening
     uac_device_t *parent;                      /*!< Parent USB UAC device */
     uint8_t xfer_num;                          /*!< Number of transfers */
     uint8_t packet_num;                        /*!< packets per transfer */
     uint32_t packet_size;                      /*!< size of each packet */
+    uint32_t packet_period_us;                 /*!< time between packets, from endpoint bInterval and device speed */
+    usb_speed_t speed;                         /*!< device speed */
+    uint8_t sample_bytes;                      /*!< bytes per sample of all channels */
+    bool convert;                              /*!< uac_host_device_read/write convert between app_format and dev_format */
+    uac_pcm_format_t app_format;               /*!< Format of data passed to uac_host_device_read/write */
+    uac_pcm_format_t dev_format;               /*!< Format of data in the ringbuf and USB transfers */
+    uac_resampler_t *resampler;                /*!< uac_host_device_read resamples, NULL without FLAG_STREAM_RX_RESAMPLE */
     uac_host_device_event_cb_t user_cb;        /*!< Interface application callback */
     void *user_cb_arg;                         /*!< Interface application callback arg */
-    RingbufHandle_t ringbuf;                   /*!< Ring buffer for audio data */
+    atomic_uint pending_events;                /*!< Bitmask of events posted by transfer callbacks, not delivered yet */
+    uac_ringbuf_t *ringbuf;                    /*!< Ring buffer for audio data */
     uint32_t ringbuf_size;                     /*!< Ring buffer size */
     uint32_t ringbuf_threshold;                /*!< Ring buffer threshold */
     uac_host_dev_info_t dev_info;              /*!< USB device parameters */
     int16_t vol_min_db;                        /*!< volume min with 1/256 db step */
     int16_t vol_max_db;                        /*!< volume max with 1/256 db step */
     int16_t vol_res_db;                        /*!< volume resolution with 1/256 db step */
+    uint8_t vol_range_unit;                    /*!< Feature unit the volume range was read from, 0 if not read yet */
     uac_iface_alt_t *iface_alt;                /*!< audio stream alternate setting */
+    // asynchronous TX stream with explicit feedback endpoint
+    struct {
+        usb_transfer_t *xfer;                  /*!< Feedback IN transfer, NULL if the current alternate setting has no feedback endpoint */
+        volatile uint32_t samples;             /*!< Samples per packet requested by the device, Q16.16 */
+        uint32_t remainder;                    /*!< Fraction of a sample not sent yet. Q16.16 with feedback endpoint, otherwise in 1/nominal_den units */
+        uint32_t nominal;                      /*!< Samples per packet at cur_sampling_freq, Q16.16 */
+        uint32_t nominal_num;                  /*!< Samples per packet at cur_sampling_freq, exactly nominal_num / nominal_den */
+        uint32_t nominal_den;                  /*!< Denominator of the exact nominal rate */
+        uint8_t frames_per_packet;             /*!< (Micro)frames per packet, feedback values are per (micro)frame */
+    } feedback;
+    // written by transfer callbacks, read with uac_host_device_get_stats(), protected by critical section
+    uac_host_stream_stats_t stats;             /*!< Stream statistics since resume */
+    uint64_t samples_after_first;              /*!< Samples of transfers completed after the first one, for drift */
+    usb_class_stats_entry_t *class_stats;      /*!< Entry in usb_class_stats registry, NULL if not counted */
+    usb_host_bw_hdl_t bw_hdl;                  /*!< Bus bandwidth of the data endpoint, reserved while the interface is active */
+    usb_host_bw_hdl_t fb_bw_hdl;               /*!< Bus bandwidth of the feedback endpoint, reserved while the interface is active */
 } uac_iface_t;
 
+/**
+ * @brief UAC duplex stream: RX interface read and TX interface filled in the same callback
+ */
+typedef struct uac_duplex {
+    uac_iface_t *rx_iface;                     /*!< Capture interface */
+    uac_iface_t *tx_iface;                     /*!< Playback interface, in TX fill mode */
+    uac_host_duplex_cb_t callback;             /*!< Duplex stream callback */
+    void *callback_arg;                        /*!< Duplex stream callback arg */
+    uint8_t *rx_buf;                           /*!< One TX transfer period of capture, passed to callback */
+    uint32_t rx_period_bytes;                  /*!< Capture bytes per TX transfer period */
+    volatile uint32_t delay_us;                /*!< Last loopback delay */
+} uac_duplex_t;
+
 /**
  * @brief UAC driver default context
  *
@@ -174,9 +308,11 @@ typedef struct {
     STAILQ_HEAD(devices, uac_host_device) uac_devices_tailq;    /*!< STAILQ of UAC interfaces */
     STAILQ_HEAD(interfaces, uac_interface) uac_ifaces_tailq;    /*!< STAILQ of UAC interfaces */
     volatile bool end_client_event_handling;                    /*!< Client event handling flag */
+    atomic_bool events_pending;                                 /*!< An interface has pending_events */
     // constant values after UAC Host initialization
     bool event_handling_started;                                /*!< Events handler started flag */
     usb_host_client_handle_t client_handle;                     /*!< Client task handle */
+    usb_host_shared_client_driver_handle_t shared_driver;       /*!< Handle in the shared client, NULL if the driver has its own client */
     uac_host_driver_event_cb_t user_cb;                         /*!< User application callback */
     void *user_arg;                                             /*!< User application callback args */
     SemaphoreHandle_t all_events_handled;                       /*!< Events handler semaphore */
@@ -202,6 +338,8 @@ static esp_err_t _uac_host_device_add(uint8_t addr, usb_device_handle_t dev_hdl,
 static esp_err_t _uac_host_device_delete(uac_device_t *uac_device);
 static esp_err_t uac_cs_request_set(uac_device_t *uac_device, const uac_cs_request_t *req);
 static esp_err_t uac_cs_request_set_ep_frequency(uac_iface_t *iface, uint8_t ep_addr, uint32_t freq);
+static esp_err_t uac_cs_request_set_clock_frequency(uac_iface_t *iface, uint8_t clock_id, uint32_t freq);
+static esp_err_t uac_host_interface_clock_params(uac_device_t *uac_device, uac_iface_alt_t *iface_alt);
 
 // --------------------------- Utility Functions --------------------------------
 /**
@@ -231,70 +369,257 @@ static int16_t _volume_db_f_2_i16(float volume_db_f)
 }
 
 // --------------------------- Buffer Management --------------------------------
-static size_t _ring_buffer_get_len(RingbufHandle_t ringbuf_hdl)
+static void _ring_buffer_delete(uac_ringbuf_t *ringbuf)
 {
-    assert(ringbuf_hdl);
-    size_t size = 0;
-    vRingbufferGetInfo(ringbuf_hdl, NULL, NULL, NULL, NULL, &size);
-    return size;
+    assert(ringbuf);
+    free(ringbuf->buf);
+    if (ringbuf->data_sem) {
+        vSemaphoreDelete(ringbuf->data_sem);
+    }
+    if (ringbuf->space_sem) {
+        vSemaphoreDelete(ringbuf->space_sem);
+    }
+    heap_caps_free(ringbuf);
 }
 
-static void _ring_buffer_flush(RingbufHandle_t ringbuf_hdl)
+static uac_ringbuf_t *_ring_buffer_create(size_t size, size_t mirror)
 {
-    assert(ringbuf_hdl);
-    size_t read_bytes = 0;
-    size_t uxItemsWaiting = 0;
-    vRingbufferGetInfo(ringbuf_hdl, NULL, NULL, NULL, NULL, &uxItemsWaiting);
-    uint8_t *buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, &read_bytes, 0, uxItemsWaiting);
+    uac_ringbuf_t *ringbuf = heap_caps_aligned_calloc(UAC_RINGBUF_CACHE_LINE, 1, sizeof(uac_ringbuf_t), MALLOC_CAP_DEFAULT);
+    if (!ringbuf) {
+        return NULL;
+    }
+    ringbuf->size = size;
+    ringbuf->mirror = MIN(mirror, size);
+    ringbuf->buf = malloc(size + ringbuf->mirror);
+    ringbuf->data_sem = xSemaphoreCreateBinary();
+    ringbuf->space_sem = xSemaphoreCreateBinary();
+    if (!ringbuf->buf || !ringbuf->data_sem || !ringbuf->space_sem) {
+        _ring_buffer_delete(ringbuf);
+        return NULL;
+    }
+    return ringbuf;
+}
+
+static inline size_t _ring_buffer_get_len(uac_ringbuf_t *ringbuf)
+{
+    assert(ringbuf);
+    return atomic_load(&ringbuf->head) - atomic_load(&ringbuf->tail);
+}
 
-    if (buf_rcv) {
-        vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
+/**
+ * @brief Wake a task blocked in _ring_buffer_push() or _ring_buffer_pop()
+ *
+ * The waiting flag is set by the blocked task before it checks the buffer again, so either it sees the new data/space
+ * or we see the flag. The semaphore is only touched when somebody waits.
+ */
+static inline void _ring_buffer_wake(atomic_bool *waiting, SemaphoreHandle_t sem)
+{
+    if (atomic_load(waiting) && atomic_exchange(waiting, false)) {
+        xSemaphoreGive(sem);
     }
+}
 
-    if (uxItemsWaiting > read_bytes) {
-        // read the second time to flush all data
-        vRingbufferGetInfo(ringbuf_hdl, NULL, NULL, NULL, NULL, &uxItemsWaiting);
-        buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, &read_bytes, 0, uxItemsWaiting);
-        if (buf_rcv) {
-            vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
+/**
+ * @brief Block until cond_met() is true, buffer is closed or timeout
+ *
+ * @return true if cond_met() is true
+ */
+static bool _ring_buffer_wait(uac_ringbuf_t *ringbuf, bool (*cond_met)(uac_ringbuf_t *, size_t), size_t arg,
+                              atomic_bool *waiting, SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+    while (!cond_met(ringbuf, arg)) {
+        if (ticks_to_wait == 0 || atomic_load(&ringbuf->closed)) {
+            return false;
+        }
+        atomic_store(waiting, true);
+        if (cond_met(ringbuf, arg)) {
+            atomic_store(waiting, false);
+            break;
+        }
+        const bool taken = xSemaphoreTake(sem, ticks_to_wait);
+        atomic_store(waiting, false);
+        if (!taken || xTaskCheckForTimeOut(&timeout, &ticks_to_wait) != pdFALSE) {
+            return cond_met(ringbuf, arg);
         }
     }
+    return !atomic_load(&ringbuf->closed);
+}
+
+static bool _ring_buffer_has_data(uac_ringbuf_t *ringbuf, size_t unused)
+{
+    return _ring_buffer_get_len(ringbuf) > 0;
+}
+
+static bool _ring_buffer_has_space(uac_ringbuf_t *ringbuf, size_t bytes)
+{
+    return ringbuf->size - _ring_buffer_get_len(ringbuf) >= bytes;
+}
+
+static bool _ring_buffer_has_level(uac_ringbuf_t *ringbuf, size_t bytes)
+{
+    return _ring_buffer_get_len(ringbuf) >= bytes;
+}
+
+static void _ring_buffer_flush(uac_ringbuf_t *ringbuf)
+{
+    assert(ringbuf);
+    size_t tail = atomic_load(&ringbuf->tail);
+    while (!atomic_compare_exchange_weak(&ringbuf->tail, &tail, atomic_load(&ringbuf->head))) {
+    }
+    _ring_buffer_wake(&ringbuf->writer_waiting, ringbuf->space_sem);
+}
+
+/**
+ * @brief Unblock readers and writers before the buffer is deleted
+ */
+static void _ring_buffer_close(uac_ringbuf_t *ringbuf)
+{
+    assert(ringbuf);
+    atomic_store(&ringbuf->closed, true);
+    xSemaphoreGive(ringbuf->data_sem);
+    xSemaphoreGive(ringbuf->space_sem);
 }
 
-static esp_err_t _ring_buffer_push(RingbufHandle_t ringbuf_hdl, uint8_t *buf, size_t write_bytes, TickType_t xTicksToWait)
+/**
+ * @brief Keep the mirror behind the end equal to the start of the buffer, after len bytes were written at pos
+ */
+static inline void _ring_buffer_mirror_update(uac_ringbuf_t *ringbuf, size_t pos, size_t len)
 {
-    assert(ringbuf_hdl && buf);
-    int res = xRingbufferSend(ringbuf_hdl, buf, write_bytes, xTicksToWait);
+    if (pos < ringbuf->mirror) {
+        memcpy(ringbuf->buf + ringbuf->size + pos, ringbuf->buf + pos, MIN(len, ringbuf->mirror - pos));
+    }
+}
 
-    if (res != pdTRUE) {
+static esp_err_t _ring_buffer_push(uac_ringbuf_t *ringbuf, const uint8_t *buf, size_t write_bytes, TickType_t xTicksToWait)
+{
+    assert(ringbuf && buf);
+    if (write_bytes > ringbuf->size ||
+            !_ring_buffer_wait(ringbuf, _ring_buffer_has_space, write_bytes, &ringbuf->writer_waiting, ringbuf->space_sem, xTicksToWait)) {
         ESP_LOGD(TAG, "buffer is too small, push failed");
         return ESP_FAIL;
     }
+
+    const size_t head = atomic_load_explicit(&ringbuf->head, memory_order_relaxed); // Only the producer writes head
+    const size_t pos = head % ringbuf->size;
+    const size_t first = MIN(write_bytes, ringbuf->size - pos);
+    const size_t wrapped = write_bytes - first;
+    memcpy(ringbuf->buf + pos, buf, first);
+    _ring_buffer_mirror_update(ringbuf, pos, first);
+    if (wrapped) {
+        memcpy(ringbuf->buf, buf + first, wrapped);
+        _ring_buffer_mirror_update(ringbuf, 0, wrapped);
+    }
+    atomic_store(&ringbuf->head, head + write_bytes);
+    _ring_buffer_wake(&ringbuf->reader_waiting, ringbuf->data_sem);
     return ESP_OK;
 }
 
-static esp_err_t _ring_buffer_pop(RingbufHandle_t ringbuf_hdl, uint8_t *buf, size_t req_bytes, size_t *read_bytes, TickType_t ticks_to_wait)
+/**
+ * @brief Read up to req_bytes, block until at least 1 byte is available
+ */
+static esp_err_t _ring_buffer_pop(uac_ringbuf_t *ringbuf, uint8_t *buf, size_t req_bytes, size_t *read_bytes, TickType_t ticks_to_wait)
 {
-    assert(ringbuf_hdl && buf && read_bytes);
-    uint8_t *buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, read_bytes, ticks_to_wait, req_bytes);
+    assert(ringbuf && buf && read_bytes);
+    *read_bytes = 0;
+    if (!_ring_buffer_wait(ringbuf, _ring_buffer_has_data, 0, &ringbuf->reader_waiting, ringbuf->data_sem, ticks_to_wait)) {
+        return ESP_FAIL;
+    }
+
+    // Copy first, then claim the data. If another consumer claimed it meanwhile, our copy may be overwritten: copy again
+    size_t tail = atomic_load(&ringbuf->tail);
+    size_t len;
+    do {
+        len = MIN(req_bytes, atomic_load(&ringbuf->head) - tail);
+        const size_t pos = tail % ringbuf->size;
+        if (pos + len <= ringbuf->size + ringbuf->mirror) {
+            memcpy(buf, ringbuf->buf + pos, len);
+        } else {
+            const size_t first = ringbuf->size - pos;
+            memcpy(buf, ringbuf->buf + pos, first);
+            memcpy(buf + first, ringbuf->buf, len - first);
+        }
+    } while (!atomic_compare_exchange_weak(&ringbuf->tail, &tail, tail + len));
 
-    if (!buf_rcv) {
+    *read_bytes = len;
+    _ring_buffer_wake(&ringbuf->writer_waiting, ringbuf->space_sem);
+    return ESP_OK;
+}
+
+/**
+ * @brief Get the free region at head, block until at least 1 byte is free
+ *
+ * The region ends at the end of the buffer at latest, so it is contiguous. Only the producer may call this.
+ * The data is published by _ring_buffer_write_commit().
+ */
+static esp_err_t _ring_buffer_write_acquire(uac_ringbuf_t *ringbuf, uint8_t **buf, size_t *len, TickType_t ticks_to_wait)
+{
+    assert(ringbuf && buf && len);
+    *len = 0;
+    if (!_ring_buffer_wait(ringbuf, _ring_buffer_has_space, 1, &ringbuf->writer_waiting, ringbuf->space_sem, ticks_to_wait)) {
         return ESP_FAIL;
     }
 
-    memcpy(buf, buf_rcv, *read_bytes);
-    vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
+    const size_t pos = atomic_load_explicit(&ringbuf->head, memory_order_relaxed) % ringbuf->size;
+    *buf = ringbuf->buf + pos;
+    *len = MIN(ringbuf->size - _ring_buffer_get_len(ringbuf), ringbuf->size - pos);
+    return ESP_OK;
+}
 
-    size_t read_bytes2 = 0;
-    if (*read_bytes < req_bytes) {
-        buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, &read_bytes2, 0, req_bytes - *read_bytes);
-        if (buf_rcv) {
-            memcpy(buf + *read_bytes, buf_rcv, read_bytes2);
-            *read_bytes += read_bytes2;
-            vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
-        }
+/**
+ * @brief Publish bytes written to the region returned by _ring_buffer_write_acquire()
+ */
+static esp_err_t _ring_buffer_write_commit(uac_ringbuf_t *ringbuf, size_t bytes)
+{
+    assert(ringbuf);
+    const size_t head = atomic_load_explicit(&ringbuf->head, memory_order_relaxed);
+    const size_t pos = head % ringbuf->size;
+    if (bytes > MIN(ringbuf->size - _ring_buffer_get_len(ringbuf), ringbuf->size - pos)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    _ring_buffer_mirror_update(ringbuf, pos, bytes);
+    atomic_store(&ringbuf->head, head + bytes);
+    _ring_buffer_wake(&ringbuf->reader_waiting, ringbuf->data_sem);
+    return ESP_OK;
+}
+
+/**
+ * @brief Get the data region at tail, block until at least 1 byte is available
+ *
+ * The region continues into the mirror, so up to `mirror` bytes behind the end of the buffer are contiguous.
+ * The data stays in the buffer until _ring_buffer_read_release(). Only for buffers with a single consumer.
+ */
+static esp_err_t _ring_buffer_read_acquire(uac_ringbuf_t *ringbuf, const uint8_t **buf, size_t *len, TickType_t ticks_to_wait)
+{
+    assert(ringbuf && buf && len);
+    *len = 0;
+    if (!_ring_buffer_wait(ringbuf, _ring_buffer_has_data, 0, &ringbuf->reader_waiting, ringbuf->data_sem, ticks_to_wait)) {
+        return ESP_FAIL;
     }
 
+    const size_t tail = atomic_load(&ringbuf->tail);
+    const size_t pos = tail % ringbuf->size;
+    *buf = ringbuf->buf + pos;
+    *len = MIN(atomic_load(&ringbuf->head) - tail, ringbuf->size + ringbuf->mirror - pos);
+    return ESP_OK;
+}
+
+/**
+ * @brief Free bytes of the region returned by _ring_buffer_read_acquire()
+ */
+static esp_err_t _ring_buffer_read_release(uac_ringbuf_t *ringbuf, size_t bytes)
+{
+    assert(ringbuf);
+    size_t tail = atomic_load(&ringbuf->tail);
+    do {
+        if (bytes > atomic_load(&ringbuf->head) - tail) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    } while (!atomic_compare_exchange_weak(&ringbuf->tail, &tail, tail + bytes));
+
+    _ring_buffer_wake(&ringbuf->writer_waiting, ringbuf->space_sem);
     return ESP_OK;
 }
 
@@ -463,20 +788,16 @@ static uac_iface_t *get_iface_by_handle(uac_host_device_handle_t uac_dev_handle)
 /**
  * @brief Check UAC interface descriptor present
  *
- * @param[in] config_desc  Pointer to Configuration Descriptor
+ * @param[in] desc_index  Index of Configuration Descriptor
  * @return esp_err_t
  */
-static bool uac_interface_present(const usb_config_desc_t *config_desc)
+static bool uac_interface_present(const usb_host_desc_index_t *desc_index)
 {
-    assert(config_desc);
-    int offset = 0;
-    int total_len = config_desc->wTotalLength;
-    const usb_intf_desc_t *iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, total_len, offset);
-    while (iface_desc != NULL) {
-        if (USB_CLASS_AUDIO == iface_desc->bInterfaceClass) {
+    assert(desc_index);
+    for (int i = 0; i < desc_index->num_intfs; i++) {
+        if (USB_CLASS_AUDIO == desc_index->intfs[i].alts[0].intf_desc->bInterfaceClass) {
             return true;
         }
-        iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_len, offset);
     }
     return false;
 }
@@ -496,6 +817,65 @@ static inline void uac_host_user_interface_callback(uac_iface_t *uac_iface, cons
     }
 }
 
+/**
+ * @brief Post UAC Interface event from a transfer callback
+ *
+ * The event is delivered by uac_host_handle_events() after the USB Host client events are handled, so all completed
+ * transfers are resubmitted before any user callback runs. Events of the same type posted before delivery are coalesced.
+ *
+ * @param[in] uac_iface   Pointer to an Interface structure
+ * @param[in] event       UAC Interface event
+ */
+static inline void uac_host_interface_event_post(uac_iface_t *uac_iface, const uac_host_device_event_t event)
+{
+    assert(uac_iface);
+    if (uac_iface->user_cb) {
+        atomic_fetch_or(&uac_iface->pending_events, 1U << event);
+        atomic_store(&s_uac_driver->events_pending, true);
+    }
+}
+
+/**
+ * @brief Deliver events posted by transfer callbacks to the users
+ *
+ * The interface list is scanned again after every callback, because the user may close an interface from it.
+ */
+static void uac_host_interface_events_dispatch(void)
+{
+    if (!atomic_exchange(&s_uac_driver->events_pending, false)) {
+        return;
+    }
+    while (true) {
+        uac_iface_t *uac_iface = NULL;
+        unsigned events = 0;
+        UAC_ENTER_CRITICAL();
+        STAILQ_FOREACH(uac_iface, &s_uac_driver->uac_ifaces_tailq, tailq_entry) {
+            events = atomic_exchange(&uac_iface->pending_events, 0);
+            if (events) {
+                break;
+            }
+        }
+        UAC_EXIT_CRITICAL();
+        if (!uac_iface) {
+            return;
+        }
+        for (int event = UAC_HOST_DEVICE_EVENT_RX_DONE; event <= UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR; event++) {
+            if (events & (1U << event)) {
+                uac_host_user_interface_callback(uac_iface, event);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Step of the driver in the shared client, delivers events posted by transfer callbacks
+ */
+static TickType_t uac_host_shared_client_step(void *arg)
+{
+    uac_host_interface_events_dispatch();
+    return portMAX_DELAY;
+}
+
 /**
  * @brief UAC Device user callback function.
  *
@@ -550,138 +930,163 @@ static inline esp_err_t uac_host_interface_unlock(uac_iface_t *iface)
     return (xSemaphoreGive(iface->state_mutex) ? ESP_OK : ESP_FAIL);
 }
 
-static uint8_t _uac_next_linked_uint_id(const uint8_t *desc, uint8_t unit_id, uint8_t **feat_desc)
+/**
+ * @brief Check the interface is streaming in the given direction, for zero-copy access to its ringbuffer
+ */
+static esp_err_t uac_host_interface_check_streaming(uac_iface_t *iface, uac_host_stream_t type)
+{
+    UAC_RETURN_ON_FALSE(iface->dev_info.type == type, ESP_ERR_INVALID_STATE, "Wrong stream direction");
+    UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
+    const bool active = (UAC_INTERFACE_STATE_ACTIVE == iface->state);
+    uac_host_interface_unlock(iface);
+    return active ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+/**
+ * @brief Get source IDs of a terminal or unit descriptor
+ *
+ * @param[in]  desc    Terminal or unit descriptor
+ * @param[out] sources Array of source IDs
+ * @return Number of sources
+ */
+static uint8_t _uac_ac_entity_sources(const uac_desc_header_t *desc, const uint8_t **sources)
 {
-    *feat_desc = NULL;
-    if (!desc) {
+    switch (desc->bDescriptorSubtype) {
+    case UAC_AC_OUTPUT_TERMINAL:
+        *sources = &((const uac_ac_output_terminal_desc_t *)desc)->bSourceID;
+        return 1;
+    case UAC_AC_FEATURE_UNIT:
+        *sources = &((const uac_ac_feature_unit_desc_t *)desc)->bSourceID;
+        return 1;
+    case UAC_AC_SELECTOR_UNIT:
+        *sources = ((const uac_ac_selector_unit_desc_t *)desc)->baSourceID;
+        return ((const uac_ac_selector_unit_desc_t *)desc)->bNrInPins;
+    case UAC_AC_MIXER_UNIT:
+        *sources = ((const uac_ac_mixer_unit_desc_t *)desc)->baSourceID;
+        return ((const uac_ac_mixer_unit_desc_t *)desc)->bNrInPins;
+    case UAC2_AC_CLOCK_SELECTOR:
+        *sources = ((const uac2_ac_clock_selector_desc_t *)desc)->baCSourceID;
+        return ((const uac2_ac_clock_selector_desc_t *)desc)->bNrInPins;
+    case UAC2_AC_CLOCK_MULTIPLIER:
+        *sources = &((const uac2_ac_clock_multiplier_desc_t *)desc)->bCSourceID;
+        return 1;
+    default:
+        *sources = NULL;
         return 0;
     }
-    uac_ac_header_desc_t *header_desc = (uac_ac_header_desc_t *)desc;
-    const size_t total_length = header_desc->wTotalLength;
-    int uac_desc_offset = 0;
-    const uac_desc_header_t *uac_cs_desc = (const uac_desc_header_t *)header_desc;
-    while (uac_cs_desc) {
-        switch (uac_cs_desc->bDescriptorSubtype) {
-        case UAC_AC_HEADER:
-        case UAC_AC_INPUT_TERMINAL:
-            break;
-        case UAC_AC_OUTPUT_TERMINAL: {
-            const uac_ac_output_terminal_desc_t *output_terminal_desc = (const uac_ac_output_terminal_desc_t *)uac_cs_desc;
-            if (output_terminal_desc->bSourceID == unit_id) {
-                return output_terminal_desc->bTerminalID;
-            }
-            break;
-        }
-        case UAC_AC_FEATURE_UNIT: {
-            const uac_ac_feature_unit_desc_t *feature_unit_desc = (const uac_ac_feature_unit_desc_t *)uac_cs_desc;
-            if (feature_unit_desc->bSourceID == unit_id) {
-                *feat_desc = (uint8_t *)feature_unit_desc;
-                return feature_unit_desc->bUnitID;
-            }
-            break;
-        }
-        case UAC_AC_SELECTOR_UNIT: {
-            const uac_ac_selector_unit_desc_t *selector_unit_desc = (const uac_ac_selector_unit_desc_t *)uac_cs_desc;
-            for (int i = 0; i < selector_unit_desc->bNrInPins; i++) {
-                if (selector_unit_desc->baSourceID[i] == unit_id) {
-                    return selector_unit_desc->bUnitID;
-                }
-            }
-            break;
-        }
-        case UAC_AC_MIXER_UNIT: {
-            const uac_ac_mixer_unit_desc_t *mixer_unit_desc = (const uac_ac_mixer_unit_desc_t *)uac_cs_desc;
-            for (int i = 0; i < mixer_unit_desc->bNrInPins; i++) {
-                if (mixer_unit_desc->baSourceID[i] == unit_id) {
-                    return mixer_unit_desc->bUnitID;
-                }
-            }
-            break;
-        }
-        default:
-            ESP_LOGD(TAG, "UAC Unknown Descriptor Subtype %d", uac_cs_desc->bDescriptorSubtype);
-            break;
+}
+
+static uac_ac_entity_t *_uac_ac_entity_find(const uac_device_t *uac_device, uint8_t id)
+{
+    for (int i = 0; id && i < uac_device->entity_num; i++) {
+        if (uac_device->entities[i].id == id) {
+            return &uac_device->entities[i];
         }
-        uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
     }
-    return 0;
+    return NULL;
 }
 
-static uint8_t _uac_last_linked_uint_id(const uint8_t *desc, uint8_t unit_id, uint8_t **feat_desc)
+/**
+ * @brief Index terminals and units of the Audio Control interface and link each one to its first source and sink
+ *
+ * Done once per device, so finding the feature unit of each streaming interface and alternate setting
+ * does not walk the descriptors again. UAC 2.0 clock entities are indexed too, linked by their clock inputs.
+ *
+ * @param[in] uac_device  Pointer to UAC device with cs_ac_desc
+ * @return esp_err_t
+ */
+static esp_err_t _uac_host_device_topology_build(uac_device_t *uac_device)
 {
-    *feat_desc = NULL;
-    if (!desc) {
-        return 0;
+    const uac_desc_header_t *header_desc = (const uac_desc_header_t *)uac_device->cs_ac_desc;
+    if (!header_desc) {
+        return ESP_OK;
     }
-    uac_ac_header_desc_t *header_desc = (uac_ac_header_desc_t *)desc;
-    const size_t total_length = header_desc->wTotalLength;
-    int uac_desc_offset = 0;
-    const uac_desc_header_t *uac_cs_desc = (const uac_desc_header_t *)header_desc;
-    while (uac_cs_desc) {
-        switch (uac_cs_desc->bDescriptorSubtype) {
-        case UAC_AC_HEADER:
-        case UAC_AC_INPUT_TERMINAL:
-            break;
-        case UAC_AC_OUTPUT_TERMINAL: {
-            const uac_ac_output_terminal_desc_t *output_terminal_desc = (const uac_ac_output_terminal_desc_t *)uac_cs_desc;
-            if (output_terminal_desc->bTerminalID == unit_id) {
-                return output_terminal_desc->bSourceID;
-            }
-            break;
-        }
-        case UAC_AC_FEATURE_UNIT: {
-            const uac_ac_feature_unit_desc_t *feature_unit_desc = (const uac_ac_feature_unit_desc_t *)uac_cs_desc;
-            if (feature_unit_desc->bUnitID == unit_id) {
-                *feat_desc = (uint8_t *)feature_unit_desc;
-                return feature_unit_desc->bSourceID;
+    const size_t total_length = uac_device->cs_ac_desc_len;
+    const bool uac2 = (uac_device->uac_version == UAC_VERSION_2);
+
+    // count and store the entities, in descriptor order
+    for (int pass = 0; pass < 2; pass++) {
+        int uac_desc_offset = 0;
+        int num = 0;
+        const uac_desc_header_t *uac_cs_desc = header_desc;
+        while (uac_cs_desc) {
+            switch (uac_cs_desc->bDescriptorSubtype) {
+            case UAC2_AC_CLOCK_SOURCE:
+            case UAC2_AC_CLOCK_SELECTOR:
+            case UAC2_AC_CLOCK_MULTIPLIER:
+                if (!uac2) {
+                    break;
+                }
+            // fall through
+            case UAC_AC_INPUT_TERMINAL:
+            case UAC_AC_OUTPUT_TERMINAL:
+            case UAC_AC_MIXER_UNIT:
+            case UAC_AC_SELECTOR_UNIT:
+            case UAC_AC_FEATURE_UNIT:
+                if (pass) {
+                    uac_ac_entity_t *entity = &uac_device->entities[num];
+                    const uint8_t *sources = NULL;
+                    // terminal and unit IDs are at the same offset in all these descriptors
+                    entity->id = ((const uac_ac_feature_unit_desc_t *)uac_cs_desc)->bUnitID;
+                    entity->subtype = uac_cs_desc->bDescriptorSubtype;
+                    entity->source_id = _uac_ac_entity_sources(uac_cs_desc, &sources) ? sources[0] : 0;
+                    entity->desc = uac_cs_desc;
+                    if (uac2 && entity->subtype == UAC_AC_INPUT_TERMINAL) {
+                        entity->clock_id = ((const uac2_ac_input_terminal_desc_t *)uac_cs_desc)->bCSourceID;
+                    } else if (uac2 && entity->subtype == UAC_AC_OUTPUT_TERMINAL) {
+                        entity->clock_id = ((const uac2_ac_output_terminal_desc_t *)uac_cs_desc)->bCSourceID;
+                    }
+                }
+                num++;
+                break;
+            default:
+                break;
             }
-            break;
+            uac_cs_desc = (const uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
         }
-        case UAC_AC_SELECTOR_UNIT: {
-            const uac_ac_selector_unit_desc_t *selector_unit_desc = (const uac_ac_selector_unit_desc_t *)uac_cs_desc;
-            if (selector_unit_desc->bUnitID == unit_id) {
-                // for basic audio device, the first source should be microphone
-                return selector_unit_desc->baSourceID[0];
-            }
-            break;
+        if (!pass) {
+            UAC_RETURN_ON_FALSE(num <= UINT8_MAX, ESP_ERR_NOT_SUPPORTED, "Too many terminals and units");
+            uac_device->entities = calloc(num, sizeof(uac_ac_entity_t));
+            UAC_RETURN_ON_FALSE(uac_device->entities || !num, ESP_ERR_NO_MEM, "Unable to allocate memory for UAC topology");
         }
-        case UAC_AC_MIXER_UNIT: {
-            const uac_ac_mixer_unit_desc_t *mixer_unit_desc = (const uac_ac_mixer_unit_desc_t *)uac_cs_desc;
-            if (mixer_unit_desc->bUnitID == unit_id) {
-                return mixer_unit_desc->baSourceID[0];
+        uac_device->entity_num = num;
+    }
+
+    // the sink of an entity is the first one in descriptor order that has it as any of its sources
+    for (int i = 0; i < uac_device->entity_num; i++) {
+        const uint8_t *sources = NULL;
+        const uint8_t nr_sources = _uac_ac_entity_sources(uac_device->entities[i].desc, &sources);
+        for (int j = 0; j < nr_sources; j++) {
+            uac_ac_entity_t *source = _uac_ac_entity_find(uac_device, sources[j]);
+            if (source && !source->next_id) {
+                source->next_id = uac_device->entities[i].id;
             }
-            break;
-        }
-        default:
-            ESP_LOGD(TAG, "UAC Unknown Descriptor Subtype %d", uac_cs_desc->bDescriptorSubtype);
-            break;
         }
-        uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
     }
-    return 0;
+    ESP_LOGD(TAG, "UAC Control %d terminals and units", uac_device->entity_num);
+    return ESP_OK;
 }
 
-static uac_ac_feature_unit_desc_t *_uac_host_device_find_feature_unit(const uint8_t *header_desc, uint8_t terminal_id, bool if_input)
+/**
+ * @brief Find the first feature unit after an input terminal or before an output terminal
+ *
+ * @param[in] uac_device   Pointer to UAC device
+ * @param[in] terminal_id  Terminal ID
+ * @param[in] if_input     The terminal is an input terminal, follow the sinks. Else follow the first sources
+ * @return Feature unit descriptor, NULL if there is none
+ */
+static const uac_ac_feature_unit_desc_t *_uac_host_device_find_feature_unit(const uac_device_t *uac_device, uint8_t terminal_id, bool if_input)
 {
-    if (!header_desc) {
-        return NULL;
-    }
-
-    uint8_t unit_id = terminal_id;
-    uac_ac_feature_unit_desc_t *feature_unit_desc = NULL;
-    if (if_input) {
-        while (feature_unit_desc == NULL && unit_id != 0) {
-            unit_id = _uac_next_linked_uint_id(header_desc, unit_id, (uint8_t **)&feature_unit_desc);
-            ESP_LOGD(TAG, "Input Terminal next linked unit ID %d", unit_id);
-        }
-    } else {
-        while (feature_unit_desc == NULL && unit_id != 0) {
-            unit_id = _uac_last_linked_uint_id(header_desc, unit_id, (uint8_t **)&feature_unit_desc);
-            ESP_LOGD(TAG, "Output Terminal last linked unit ID %d", unit_id);
+    const uac_ac_entity_t *entity = _uac_ac_entity_find(uac_device, terminal_id);
+    // every entity is visited at most once, also for malformed descriptors with loops
+    for (int i = 0; entity && i < uac_device->entity_num; i++) {
+        entity = _uac_ac_entity_find(uac_device, if_input ? entity->next_id : entity->source_id);
+        ESP_LOGD(TAG, "%s Terminal linked unit ID %d", if_input ? "Input" : "Output", entity ? entity->id : 0);
+        if (entity && entity->subtype == UAC_AC_FEATURE_UNIT) {
+            return (const uac_ac_feature_unit_desc_t *)entity->desc;
         }
     }
-
-    return feature_unit_desc;
+    return NULL;
 }
 
 /**
@@ -698,47 +1103,58 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
     UAC_RETURN_ON_FALSE(uac_iface, ESP_ERR_NO_MEM, "Unable to allocate memory");
     uac_iface->state_mutex = xSemaphoreCreateMutex();
     UAC_GOTO_ON_FALSE(uac_iface->state_mutex, ESP_ERR_NO_MEM, "Unable to create state mutex");
-    const usb_config_desc_t *config_desc = NULL;
+    const usb_config_desc_t *config_desc = uac_device->desc_index->config_desc;
+    const usb_host_desc_index_intf_t *intf = usb_host_desc_index_get_intf(uac_device->desc_index, iface_num);
     const usb_intf_desc_t *iface_desc = NULL;
-    const usb_intf_desc_t *iface_alt_desc = NULL;
     const usb_ep_desc_t *ep_desc = NULL;
     const usb_standard_desc_t *cs_desc = NULL;
 
-    usb_host_get_active_config_descriptor(uac_device->dev_hdl, &config_desc);
-    UAC_GOTO_ON_FALSE(config_desc, ESP_ERR_INVALID_STATE, "No active configuration descriptor");
+    UAC_GOTO_ON_FALSE(intf, ESP_ERR_NOT_FOUND, "Interface not found");
     const size_t total_length = config_desc->wTotalLength;
-    int iface_alt_offset = 0;
+    const bool uac2 = (uac_device->uac_version == UAC_VERSION_2);
     int iface_alt_idx = 0;
 
-    iface_desc = usb_parse_interface_descriptor(config_desc, iface_num, 0, &iface_alt_offset);
-    iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_alt_offset);
+    iface_desc = intf->alts[0].intf_desc;
+    // Alternate setting 0 has no endpoints, all others are streaming alternate settings
+    if (intf->num_alts > 1) {
+        uac_iface->iface_alt = calloc(intf->num_alts - 1, sizeof(uac_iface_alt_t));
+        UAC_GOTO_ON_FALSE(uac_iface->iface_alt, ESP_ERR_NO_MEM, "Unable to allocate memory");
+    }
     // For every alternate setting
-    while (iface_alt_desc != NULL) {
-        // Check if the alternate setting is for the same interface
-        if (iface_alt_desc->bInterfaceNumber != iface_desc->bInterfaceNumber) {
-            break;
-        }
+    for (int i = 1; i < intf->num_alts; i++) {
+        const usb_intf_desc_t *iface_alt_desc = intf->alts[i].intf_desc;
         ESP_LOGD(TAG, "Found UAC bInterfaceNumber= %d, bAlternateSetting= %d",
                  iface_alt_desc->bInterfaceNumber, iface_alt_desc->bAlternateSetting);
-        iface_alt_idx++;
-        // Allocate memory for the alternate setting
-        uac_iface->iface_alt = realloc(uac_iface->iface_alt, iface_alt_idx * sizeof(uac_iface_alt_t));
-        UAC_GOTO_ON_FALSE(uac_iface->iface_alt, ESP_ERR_NO_MEM, "Unable to allocate memory");
-        uac_iface_alt_t *iface_alt = &uac_iface->iface_alt[iface_alt_idx - 1];
-        memset(iface_alt, 0, sizeof(uac_iface_alt_t));
+        uac_iface_alt_t *iface_alt = &uac_iface->iface_alt[iface_alt_idx++];
         iface_alt->alt_idx = iface_alt_desc->bAlternateSetting;
-        // Parse each descriptor following the alternate interface descriptor
-        int cs_offset = iface_alt_offset;
+        // Parse each descriptor following the alternate interface descriptor, in the order of the device
+        int cs_offset = (const uint8_t *)iface_alt_desc - (const uint8_t *)config_desc;
         cs_desc = GET_NEXT_DESC(iface_alt_desc, total_length, cs_offset);
         bool parse_continue = true;
         while (cs_desc != NULL && parse_continue) {
             switch (cs_desc->bDescriptorType) {
             case UAC_CS_INTERFACE: {
                 const uac_desc_header_t *uac_desc = (const uac_desc_header_t *)cs_desc;
-                if (uac_desc->bDescriptorSubtype == UAC_AS_GENERAL) {
+                if (uac_desc->bDescriptorSubtype == UAC_AS_GENERAL && uac2) {
+                    // the lowest format bit is used, bit n of bmFormats is UAC 1.0 format tag n + 1
+                    const uac2_as_general_desc_t *as_general_desc = (const uac2_as_general_desc_t *)uac_desc;
+                    iface_alt->dev_alt_param.format = __builtin_ffs(as_general_desc->bmFormats);
+                    iface_alt->dev_alt_param.channels = as_general_desc->bNrChannels;
+                    iface_alt->connected_terminal = as_general_desc->bTerminalLink;
+                } else if (uac_desc->bDescriptorSubtype == UAC_AS_GENERAL) {
                     const uac_as_general_desc_t *as_general_desc = (const uac_as_general_desc_t *)uac_desc;
                     iface_alt->dev_alt_param.format = as_general_desc->wFormatTag;
                     iface_alt->connected_terminal = as_general_desc->bTerminalLink;
+                } else if (uac_desc->bDescriptorSubtype == UAC_AS_FORMAT_TYPE && uac2) {
+                    const uac2_as_type_I_format_desc_t *as_format_type_desc = (const uac2_as_type_I_format_desc_t *)uac_desc;
+                    if (as_format_type_desc->bFormatType != UAC_FORMAT_TYPE_I) {
+                        ESP_LOGE(TAG, "UAC Format Type %d", as_format_type_desc->bFormatType);
+                        UAC_GOTO_ON_FALSE(0, ESP_ERR_NOT_SUPPORTED, "UAC Format Type not supported");
+                    }
+                    iface_alt->dev_alt_param.bit_resolution = as_format_type_desc->bBitResolution;
+                    iface_alt->subslot_size = as_format_type_desc->bSubslotSize;
+                    ESP_LOGD(TAG, "UAC AS Format Type %d, Subslot Size %d, Bit Resolution %d", as_format_type_desc->bFormatType,
+                             as_format_type_desc->bSubslotSize, as_format_type_desc->bBitResolution);
                 } else if (uac_desc->bDescriptorSubtype == UAC_AS_FORMAT_TYPE) {
                     const uac_as_type_I_format_desc_t *as_format_type_desc = (const uac_as_type_I_format_desc_t *)uac_desc;
                     if (as_format_type_desc->bFormatType != UAC_FORMAT_TYPE_I) {
@@ -747,6 +1163,7 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
                     }
                     iface_alt->dev_alt_param.channels = as_format_type_desc->bNrChannels;
                     iface_alt->dev_alt_param.bit_resolution = as_format_type_desc->bBitResolution;
+                    iface_alt->subslot_size = as_format_type_desc->bSubframeSize;
                     iface_alt->dev_alt_param.sample_freq_type = as_format_type_desc->bSamFreqType;
                     if (as_format_type_desc->bSamFreqType == 0) {
                         iface_alt->dev_alt_param.sample_freq_lower = (as_format_type_desc->tSamFreq[2] << 16) | (as_format_type_desc->tSamFreq[1] << 8) | as_format_type_desc->tSamFreq[0];
@@ -767,14 +1184,43 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
             }
             case USB_B_DESCRIPTOR_TYPE_ENDPOINT: {
                 ep_desc = (const usb_ep_desc_t *)cs_desc;
+                if (iface_alt->ep_addr) {
+                    // the endpoint following the data endpoint of an asynchronous OUT stream is its feedback endpoint
+                    if ((ep_desc->bEndpointAddress & UAC_EP_DIR_IN) &&
+                            (ep_desc->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_ISOC) {
+                        iface_alt->fb_ep_addr = ep_desc->bEndpointAddress;
+                        iface_alt->fb_ep_mps = USB_EP_DESC_GET_MPS(ep_desc);
+                        iface_alt->fb_ep_desc = ep_desc;
+                        ESP_LOGD(TAG, "UAC Feedback Endpoint 0x%02X, Max Packet Size %d", ep_desc->bEndpointAddress, ep_desc->wMaxPacketSize);
+                    }
+                    parse_continue = false;
+                    break;
+                }
                 iface_alt->ep_addr = ep_desc->bEndpointAddress;
-                iface_alt->ep_mps = ep_desc->wMaxPacketSize;
+                // High Speed high-bandwidth endpoints send up to 3 transactions per microframe
+                iface_alt->ep_mps = USB_EP_DESC_GET_MPS(ep_desc) * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
                 iface_alt->ep_attr = ep_desc->bmAttributes;
                 iface_alt->interval = ep_desc->bInterval;
+                iface_alt->ep_desc = ep_desc;
                 uac_iface->dev_info.type = (ep_desc->bEndpointAddress & UAC_EP_DIR_IN) ? UAC_STREAM_RX : UAC_STREAM_TX;
-                uac_ac_feature_unit_desc_t *feature_unit_desc = _uac_host_device_find_feature_unit((uint8_t *)uac_device->cs_ac_desc,
+                const uac_ac_feature_unit_desc_t *feature_unit_desc = _uac_host_device_find_feature_unit(uac_device,
                         iface_alt->connected_terminal, !(ep_desc->bEndpointAddress & UAC_EP_DIR_IN));
-                if (feature_unit_desc) {
+                if (feature_unit_desc && uac2) {
+                    // 4 bytes of 2-bit control fields per channel, only programmable controls are used
+                    const uac2_ac_feature_unit_desc_t *fu2_desc = (const uac2_ac_feature_unit_desc_t *)feature_unit_desc;
+                    iface_alt->feature_unit = fu2_desc->bUnitID;
+                    for (size_t i = 0; i < (fu2_desc->bLength - 6) / 4 && i < 8; i++) {
+                        const uint8_t controls = fu2_desc->bmaControls[i * 4];
+                        if (((controls >> 2) & UAC2_CONTROL_MASK) == UAC2_CONTROL_PROGRAMMABLE) {
+                            iface_alt->vol_ch_map |= (1 << i);
+                        }
+                        if ((controls & UAC2_CONTROL_MASK) == UAC2_CONTROL_PROGRAMMABLE) {
+                            iface_alt->mute_ch_map |= (1 << i);
+                        }
+                    }
+                    ESP_LOGD(TAG, "UAC %s Feature Unit ID %d, Volume Ch Map %02X, Mute Ch Map %02X", uac_iface->dev_info.type == UAC_STREAM_RX ? "RX" : "TX",
+                             fu2_desc->bUnitID, iface_alt->vol_ch_map, iface_alt->mute_ch_map);
+                } else if (feature_unit_desc) {
                     iface_alt->feature_unit = feature_unit_desc->bUnitID;
                     uint8_t ch_num = 0;
                     for (size_t i = 0; i < (feature_unit_desc->bLength - 7) / feature_unit_desc->bControlSize; i++) {
@@ -796,20 +1242,33 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
                 // we has got enough information to fill the uac_iface_alt_t, so we can break
                 const uac_as_cs_ep_desc_t *cs_ep_desc = (const uac_as_cs_ep_desc_t *)cs_desc;
                 if (cs_ep_desc->bDescriptorSubtype == UAC_EP_GENERAL) {
-                    iface_alt->freq_ctrl_supported = cs_ep_desc->bmAttributes & UAC_SAMPLING_FREQ_CONTROL;
-                    parse_continue = false;
+                    // UAC 2.0 sampling frequency is a control of the clock source, not of the endpoint
+                    iface_alt->freq_ctrl_supported = !uac2 && (cs_ep_desc->bmAttributes & UAC_SAMPLING_FREQ_CONTROL);
+                    // asynchronous OUT endpoint is followed by its feedback endpoint
+                    parse_continue = !(iface_alt->ep_addr & UAC_EP_DIR_IN) &&
+                                     (iface_alt->ep_attr & UAC_EP_SYNC_TYPE_MASK) == UAC_EP_SYNC_TYPE_ASYNC;
                     ESP_LOGD(TAG, "UAC EP General, Attributes 0x%02X", cs_ep_desc->bmAttributes);
                     ESP_LOGD(TAG, "UAC EP Frequency Control %d", iface_alt->freq_ctrl_supported);
                 }
                 break;
             }
+            case USB_B_DESCRIPTOR_TYPE_INTERFACE:
+            case USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION:
+                // end of this alternate setting
+                parse_continue = false;
+                break;
             default:
                 break;
             }
             cs_desc = GET_NEXT_DESC(cs_desc, total_length, cs_offset);
         }
-        // Get next alternate setting
-        iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_alt_desc, total_length, iface_alt_offset);
+        if (!iface_alt->subslot_size) {
+            iface_alt->subslot_size = iface_alt->dev_alt_param.bit_resolution / 8;
+        }
+        // UAC 2.0 sampling frequencies are not in the descriptors, they are read from the clock source
+        if (uac2 && iface_alt->connected_terminal && uac_host_interface_clock_params(uac_device, iface_alt) != ESP_OK) {
+            ESP_LOGW(TAG, "UAC Interface %d->%d, sampling frequencies unknown", iface_desc->bInterfaceNumber, iface_alt->alt_idx);
+        }
     }
     uac_iface->state = UAC_INTERFACE_STATE_NOT_INITIALIZED;
     uac_iface->parent = uac_device;
@@ -871,86 +1330,86 @@ static esp_err_t uac_host_interface_delete(uac_iface_t *uac_iface)
  * @brief Check every interface in the USB device, notify user about connected interfaces/logic devices
  *
  * @param[in] addr         USB device address
- * @param[in] config_desc  Pointer to Configuration Descriptor
+ * @param[in] desc_index   Index of Configuration Descriptor
  * @return esp_err_t
  * @retval ESP_OK          UAC Interface found
  * @retval ESP_ERR_NOT_FOUND UAC Interface not found
  */
-static esp_err_t uac_host_interface_check(uint8_t addr, const usb_config_desc_t *config_desc)
+static esp_err_t uac_host_interface_check(uint8_t addr, const usb_host_desc_index_t *desc_index)
 {
-    assert(config_desc);
-    size_t total_length = config_desc->wTotalLength;
-    const usb_intf_desc_t *iface_desc = NULL;
-    int iface_offset = 0;
+    assert(desc_index);
     bool is_uac_interface = false;
 
-    // Get first Interface descriptor
-    iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, total_length, iface_offset);
     // Check every uac stream interface
-    while (iface_desc != NULL) {
-        if (iface_desc->bInterfaceClass == USB_CLASS_AUDIO && iface_desc->bInterfaceSubClass == UAC_SUBCLASS_AUDIOSTREAMING) {
-            // notify user about the connected Interfaces
-            is_uac_interface = true;
-            const usb_intf_desc_t *iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_offset);
-            int ep_offset = iface_offset;
-            const usb_ep_desc_t *ep_desc = usb_parse_endpoint_descriptor_by_index(iface_alt_desc, 0, total_length, &ep_offset);
-            if (ep_desc == NULL) {
-                ESP_LOGW(TAG, "No endpoint descriptor found");
-            } else if (ep_desc->bEndpointAddress & UAC_EP_DIR_IN) {
-                // notify user about the connected Interfaces
-                uac_host_user_device_callback(addr, iface_desc->bInterfaceNumber, UAC_HOST_DRIVER_EVENT_RX_CONNECTED);
-            } else {
-                // notify user about the connected Interfaces
-                uac_host_user_device_callback(addr, iface_desc->bInterfaceNumber, UAC_HOST_DRIVER_EVENT_TX_CONNECTED);
-            }
-            // Skip all alternate settings belonging to the current interface
-            while (iface_alt_desc != NULL) {
-                // Check if the alternate setting is for the same interface
-                if (iface_alt_desc->bInterfaceNumber != iface_desc->bInterfaceNumber) {
-                    break;
-                }
-                iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_alt_desc, total_length, iface_offset);
-            }
-            iface_desc = iface_alt_desc;
+    for (int i = 0; i < desc_index->num_intfs; i++) {
+        const usb_host_desc_index_intf_t *intf = &desc_index->intfs[i];
+        const usb_intf_desc_t *iface_desc = intf->alts[0].intf_desc;
+        if (iface_desc->bInterfaceClass != USB_CLASS_AUDIO || iface_desc->bInterfaceSubClass != UAC_SUBCLASS_AUDIOSTREAMING) {
             continue;
         }
-        iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_offset);
+        is_uac_interface = true;
+        // Direction of the stream is the direction of the first endpoint of the first alternate setting
+        const usb_host_desc_index_alt_t *alt = (intf->num_alts > 1) ? &intf->alts[1] : NULL;
+        if (alt == NULL || alt->num_eps == 0) {
+            ESP_LOGW(TAG, "No endpoint descriptor found");
+        } else if (alt->ep_descs[0]->bEndpointAddress & UAC_EP_DIR_IN) {
+            // notify user about the connected Interfaces
+            uac_host_user_device_callback(addr, iface_desc->bInterfaceNumber, UAC_HOST_DRIVER_EVENT_RX_CONNECTED);
+        } else {
+            // notify user about the connected Interfaces
+            uac_host_user_device_callback(addr, iface_desc->bInterfaceNumber, UAC_HOST_DRIVER_EVENT_TX_CONNECTED);
+        }
     }
 
     return is_uac_interface ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
 /**
- * @brief Handler for USB device connected event
+ * @brief Create UAC interfaces of a connected device from its indexed descriptors
  *
- * @param[in] addr   USB device physical address
+ * @param[in] addr        USB device physical address
+ * @param[in] desc_index  Index of the active Configuration Descriptor
  * @return esp_err_t
  */
-static esp_err_t _uac_host_device_connected(uint8_t addr)
+static esp_err_t _uac_host_device_add(uint8_t addr, const usb_host_desc_index_t *desc_index)
 {
-    bool is_uac_device = false;
-    usb_device_handle_t dev_hdl;
-    const usb_config_desc_t *config_desc = NULL;
-
-    if (usb_host_device_open(s_uac_driver->client_handle, addr, &dev_hdl) == ESP_OK) {
-        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK) {
-            is_uac_device = uac_interface_present(config_desc);
-        }
-        UAC_RETURN_ON_ERROR(usb_host_device_close(s_uac_driver->client_handle, dev_hdl), "Unable to close USB device");
-    }
-
-    // Create UAC interfaces list in RAM, connected to the particular USB dev
-    if (is_uac_device) {
+    if (!uac_interface_present(desc_index)) {
+        ESP_LOGW(TAG, "USB device with addr(%d) is not UAC device", addr);
+        return ESP_ERR_NOT_FOUND;
+    }
 #ifdef CONFIG_PRINTF_UAC_CONFIGURATION_DESCRIPTOR
-        print_uac_descriptors(config_desc);
+    print_uac_descriptors(desc_index->config_desc);
 #endif
-        // Create Interfaces list for a possibility to claim Interface
-        UAC_RETURN_ON_ERROR(uac_host_interface_check(addr, config_desc), "uac stream interface not found");
-    } else {
-        ESP_LOGW(TAG, "USB device with addr(%d) is not UAC device", addr);
+    // Create Interfaces list for a possibility to claim Interface
+    UAC_RETURN_ON_ERROR(uac_host_interface_check(addr, desc_index), "uac stream interface not found");
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for USB device connected event
+ *
+ * @param[in] addr   USB device physical address
+ * @return esp_err_t
+ */
+static esp_err_t _uac_host_device_connected(uint8_t addr)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    usb_device_handle_t dev_hdl;
+    const usb_config_desc_t *config_desc = NULL;
+    usb_host_desc_index_t *desc_index = NULL;
+
+    if (usb_host_shared_client_device_open(s_uac_driver->client_handle, addr, &dev_hdl) == ESP_OK) {
+        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK &&
+                usb_host_desc_index_build(config_desc, &desc_index) == ESP_OK) {
+            // Create UAC interfaces list in RAM, connected to the particular USB dev
+            ret = _uac_host_device_add(addr, desc_index);
+        }
+        UAC_GOTO_ON_ERROR(usb_host_shared_client_device_close(s_uac_driver->client_handle, dev_hdl), "Unable to close USB device");
     }
 
-    return is_uac_device ? ESP_OK : ESP_ERR_NOT_FOUND;
+fail:
+    usb_host_desc_index_free(desc_index);
+    return ret;
 }
 
 /**
@@ -1023,6 +1482,67 @@ static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
     }
 }
 
+static const usb_host_shared_client_match_t uac_match_table[] = {
+    {
+        .match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS,
+        .bInterfaceClass = USB_CLASS_AUDIO,
+    },
+};
+
+/**
+ * @brief USB Host shared client probe, called only for devices with Audio interface
+ *
+ * @param[in] probe    New device with its indexed descriptors
+ * @param[in] arg      Argument, does not used
+ */
+static void client_probe_cb(const usb_host_shared_client_probe_t *probe, void *arg)
+{
+    _uac_host_device_add(probe->dev_addr, probe->index);
+}
+
+/**
+ * @brief Reserve bus bandwidth of the data and feedback endpoints of current alternate setting
+ *
+ * The reservation is kept until the interface is suspended or released, so a failed resume can be retried.
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_interface_bw_reserve(uac_iface_t *iface)
+{
+    const uac_iface_alt_t *iface_alt = &iface->iface_alt[iface->cur_alt];
+    if (iface->bw_hdl == NULL) {
+        const usb_host_bw_request_t request = {
+            .root_port = 0,
+            .speed = iface->speed,
+            .ep_desc = iface_alt->ep_desc,
+        };
+        UAC_RETURN_ON_ERROR(usb_host_bw_reserve(&request, &iface->bw_hdl), "Not enough bus bandwidth for audio stream");
+    }
+    if (iface_alt->fb_ep_desc && iface->fb_bw_hdl == NULL) {
+        const usb_host_bw_request_t request = {
+            .root_port = 0,
+            .speed = iface->speed,
+            .ep_desc = iface_alt->fb_ep_desc,
+        };
+        UAC_RETURN_ON_ERROR(usb_host_bw_reserve(&request, &iface->fb_bw_hdl), "Not enough bus bandwidth for feedback endpoint");
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Release bus bandwidth of the interface
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void uac_host_interface_bw_release(uac_iface_t *iface)
+{
+    usb_host_bw_release(iface->bw_hdl);
+    usb_host_bw_release(iface->fb_bw_hdl);
+    iface->bw_hdl = NULL;
+    iface->fb_bw_hdl = NULL;
+}
+
 /**
  * @brief UAC Host release Interface and free transfers, change state to IDLE
  *
@@ -1040,7 +1560,7 @@ static esp_err_t uac_host_interface_release_and_free_transfer(uac_iface_t *iface
     if (iface->free_xfer_list) {
         for (int i = 0; i < iface->xfer_num; i++) {
             if (iface->free_xfer_list[i]) {
-                ESP_ERROR_CHECK(usb_host_transfer_free(iface->free_xfer_list[i]));
+                ESP_ERROR_CHECK(usb_host_urb_pool_transfer_free(iface->free_xfer_list[i]));
             }
         }
         free(iface->free_xfer_list);
@@ -1049,13 +1569,24 @@ static esp_err_t uac_host_interface_release_and_free_transfer(uac_iface_t *iface
     if (iface->xfer_list) {
         for (int i = 0; i < iface->xfer_num; i++) {
             if (iface->xfer_list[i]) {
-                ESP_ERROR_CHECK(usb_host_transfer_free(iface->xfer_list[i]));
+                ESP_ERROR_CHECK(usb_host_urb_pool_transfer_free(iface->xfer_list[i]));
             }
         }
         free(iface->xfer_list);
     }
 
+    if (iface->feedback.xfer) {
+        ESP_ERROR_CHECK(usb_host_urb_pool_transfer_free(iface->feedback.xfer));
+        iface->feedback.xfer = NULL;
+    }
+    free(iface->resampler);
+    iface->resampler = NULL;
+    usb_class_stats_unregister(iface->class_stats);
+    iface->class_stats = NULL;
+    uac_host_interface_bw_release(iface);
+
     // Change state
+    iface->flags &= ~FLAG_INTERFACE_STOPPED_PREPARED;
     iface->state = UAC_INTERFACE_STATE_IDLE;
     return ESP_OK;
 }
@@ -1080,9 +1611,29 @@ static esp_err_t uac_host_interface_claim_and_prepare_transfer(uac_iface_t *ifac
     iface->free_xfer_list = calloc(iface->xfer_num, sizeof(usb_transfer_t *));
     UAC_GOTO_ON_FALSE(iface->free_xfer_list, ESP_ERR_NO_MEM, "Unable to allocate free transfer list");
     for (int i = 0; i < iface->xfer_num; i++) {
-        UAC_GOTO_ON_ERROR(usb_host_transfer_alloc(packet_size * iface->packet_num, iface->packet_num, &iface->free_xfer_list[i]),
+        UAC_GOTO_ON_ERROR(usb_host_urb_pool_transfer_alloc(packet_size * iface->packet_num, iface->packet_num, &iface->free_xfer_list[i]),
                           "Unable to allocate transfer buffer for EP IN");
     }
+    if (iface->iface_alt[iface->cur_alt].fb_ep_addr) {
+        UAC_GOTO_ON_ERROR(usb_host_urb_pool_transfer_alloc(iface->iface_alt[iface->cur_alt].fb_ep_mps, 1, &iface->feedback.xfer),
+                          "Unable to allocate transfer buffer for feedback EP");
+    }
+    const usb_class_stats_info_t class_stats_info = {
+        .driver = "uac",
+        .dev_addr = iface->dev_info.addr,
+        .intf_num = iface->dev_info.iface_num,
+        .label = (iface->dev_info.type == UAC_STREAM_RX) ? "rx" : "tx",
+    };
+    usb_class_stats_register(&class_stats_info, &iface->class_stats); // Stream is not counted on failure
+    // Buffers of the stream are released from the accounting when the entry is unregistered
+    for (int i = 0; i < iface->xfer_num; i++) {
+        USB_CLASS_STATS_MEM_XFER(iface->class_stats, iface->free_xfer_list[i]);
+    }
+    USB_CLASS_STATS_MEM_XFER(iface->class_stats, iface->feedback.xfer);
+    USB_CLASS_STATS_MEM_ALLOC(iface->class_stats, sizeof(uac_ringbuf_t) + iface->ringbuf->size + iface->ringbuf->mirror, MALLOC_CAP_DEFAULT);
+    if (iface->resampler) {
+        USB_CLASS_STATS_MEM_ALLOC(iface->class_stats, sizeof(uac_resampler_t), MALLOC_CAP_DEFAULT);
+    }
     // Change state
     iface->state = UAC_INTERFACE_STATE_READY;
     return ESP_OK;
@@ -1092,6 +1643,225 @@ fail:
     return ret;
 }
 
+/**
+ * @brief Fill audio buffer with silence of the current format
+ */
+static inline void stream_silence_fill(uac_iface_t *iface, uint8_t *data, size_t len)
+{
+    // 8-bit PCM is unsigned, the other formats are signed
+    const bool unsigned_pcm = (iface->iface_alt[iface->cur_alt].dev_alt_param.format == UAC_TYPE_I_PCM8);
+    memset(data, unsigned_pcm ? 0x80 : 0, len);
+}
+
+/**
+ * @brief Load one PCM sample as left justified 32-bit signed value
+ */
+static inline int32_t pcm_sample_load(const uint8_t *src, const uac_pcm_format_t *format)
+{
+    uint32_t val;
+    switch (format->bytes) {
+    case 1:
+        val = (uint32_t)(format->is_unsigned ? src[0] ^ 0x80 : src[0]) << 24;
+        break;
+    case 2:
+        val = ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 24);
+        break;
+    case 3:
+        val = ((uint32_t)src[0] << 8) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 24);
+        break;
+    default:
+        val = (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+        break;
+    }
+    return (int32_t)val;
+}
+
+/**
+ * @brief Store left justified 32-bit signed value as one PCM sample, lower bits are truncated
+ */
+static inline void pcm_sample_store(uint8_t *dst, const uac_pcm_format_t *format, int32_t sample)
+{
+    const uint32_t val = (uint32_t)sample;
+    switch (format->bytes) {
+    case 1:
+        dst[0] = (uint8_t)(val >> 24) ^ (format->is_unsigned ? 0x80 : 0);
+        break;
+    case 2:
+        dst[0] = val >> 16;
+        dst[1] = val >> 24;
+        break;
+    case 3:
+        dst[0] = val >> 8;
+        dst[1] = val >> 16;
+        dst[2] = val >> 24;
+        break;
+    default:
+        dst[0] = val;
+        dst[1] = val >> 8;
+        dst[2] = val >> 16;
+        dst[3] = val >> 24;
+        break;
+    }
+}
+
+/**
+ * @brief Distance of two frames in a buffer of this format
+ */
+static inline size_t pcm_frame_stride(const uac_pcm_format_t *format)
+{
+    return format->planar ? format->bytes : format->bytes * format->channels;
+}
+
+/**
+ * @brief Convert PCM frames between bit resolutions, channel counts and interleaved/planar layout
+ *
+ * Mono is copied to all channels, more channels are averaged to mono. Otherwise the channels are copied in order,
+ * missing channels are repeated from the first ones and extra channels are dropped.
+ *
+ * @param[in]  src        Source frames
+ * @param[in]  src_format Source format
+ * @param[in]  src_plane  Bytes between channels of a planar source
+ * @param[out] dst        Destination frames
+ * @param[in]  dst_format Destination format
+ * @param[in]  dst_plane  Bytes between channels of a planar destination
+ * @param[in]  frames     Number of frames to convert
+ */
+static void pcm_convert(const uint8_t *src, const uac_pcm_format_t *src_format, size_t src_plane,
+                        uint8_t *dst, const uac_pcm_format_t *dst_format, size_t dst_plane, size_t frames)
+{
+    const size_t src_frame = pcm_frame_stride(src_format);
+    const size_t dst_frame = pcm_frame_stride(dst_format);
+    const size_t src_channel = src_format->planar ? src_plane : src_format->bytes;
+    const size_t dst_channel = dst_format->planar ? dst_plane : dst_format->bytes;
+    const uint8_t src_channels = src_format->channels;
+    const uint8_t dst_channels = dst_format->channels;
+
+    if (dst_channels == 1 && src_channels > 1) {
+        for (size_t i = 0; i < frames; i++, src += src_frame, dst += dst_frame) {
+            int64_t sum = 0;
+            for (uint8_t c = 0; c < src_channels; c++) {
+                sum += pcm_sample_load(src + c * src_channel, src_format);
+            }
+            pcm_sample_store(dst, dst_format, (int32_t)(sum / src_channels));
+        }
+        return;
+    }
+    for (size_t i = 0; i < frames; i++, src += src_frame, dst += dst_frame) {
+        for (uint8_t c = 0; c < dst_channels; c++) {
+            pcm_sample_store(dst + c * dst_channel, dst_format, pcm_sample_load(src + (c % src_channels) * src_channel, src_format));
+        }
+    }
+}
+
+/**
+ * @brief Compute the resampler filter: windowed sinc at every phase, each phase normalized to unity gain
+ */
+static void stream_resampler_coef_init(uac_resampler_t *rs)
+{
+    // 0.9 of the Nyquist frequency. The ratio is close to 1, there is no need for stronger anti-aliasing
+    const float cutoff = 0.9f;
+    for (int p = 0; p <= UAC_RESAMPLE_PHASES; p++) {
+        float h[UAC_RESAMPLE_TAPS];
+        float sum = 0;
+        for (int k = 0; k < UAC_RESAMPLE_TAPS; k++) {
+            // distance of the tap from the output sample, which is between taps TAPS/2 - 1 and TAPS/2
+            const float t = k - (UAC_RESAMPLE_TAPS / 2 - 1) - (float)p / UAC_RESAMPLE_PHASES;
+            const float x = (float)M_PI * cutoff * t;
+            const float sinc = (t == 0.0f) ? 1.0f : sinf(x) / x;
+            const float w = 2.0f * (float)M_PI * t / UAC_RESAMPLE_TAPS; // Blackman window
+            h[k] = sinc * (0.42f + 0.5f * cosf(w) + 0.08f * cosf(2.0f * w));
+            sum += h[k];
+        }
+        for (int k = 0; k < UAC_RESAMPLE_TAPS; k++) {
+            rs->coef[p][k] = (int32_t)lroundf(h[k] / sum * (1 << UAC_RESAMPLE_COEF_SHIFT));
+        }
+    }
+}
+
+/**
+ * @brief Reset the resampler to silence and ratio 1, before the stream is resumed
+ */
+static void stream_resampler_reset(uac_resampler_t *rs)
+{
+    memset(rs->hist, 0, sizeof(rs->hist));
+    rs->hist_pos = 0;
+    rs->pos = UAC_RESAMPLE_ONE;
+    rs->step = UAC_RESAMPLE_ONE;
+    rs->src = NULL;
+    rs->src_len = 0;
+    rs->src_used = 0;
+    rs->level_avg = -1.0f;
+    rs->integral = 0.0f;
+    rs->frames_out = 0;
+}
+
+/**
+ * @brief Add one input frame to the resampler history
+ */
+static inline void stream_resampler_push(uac_resampler_t *rs, const uint8_t *frame, const uac_pcm_format_t *format)
+{
+    for (uint8_t c = 0; c < format->channels; c++) {
+        const int32_t sample = pcm_sample_load(frame + c * format->bytes, format);
+        rs->hist[c][rs->hist_pos] = sample;
+        rs->hist[c][rs->hist_pos + UAC_RESAMPLE_TAPS] = sample;
+    }
+    rs->hist_pos = (rs->hist_pos + 1) % UAC_RESAMPLE_TAPS;
+}
+
+/**
+ * @brief Compute one output frame at the fractional position of the resampler
+ *
+ * Coefficients are interpolated between the two nearest filter phases once and applied to all channels.
+ */
+static inline void stream_resampler_frame(uac_resampler_t *rs, uint8_t channels, int32_t *out)
+{
+    const uint32_t frac = (uint32_t)rs->pos;
+    const uint32_t phase = frac >> (32 - UAC_RESAMPLE_PHASE_BITS);
+    const int64_t mix = (frac >> (16 - UAC_RESAMPLE_PHASE_BITS)) & 0xFFFF; // Q16 between the phases
+    const int32_t *c0 = rs->coef[phase];
+    const int32_t *c1 = rs->coef[phase + 1];
+    int32_t coef[UAC_RESAMPLE_TAPS];
+    for (int k = 0; k < UAC_RESAMPLE_TAPS; k++) {
+        coef[k] = c0[k] + (int32_t)(((int64_t)(c1[k] - c0[k]) * mix) >> 16);
+    }
+    for (uint8_t c = 0; c < channels; c++) {
+        const int32_t *x = &rs->hist[c][rs->hist_pos];
+        int64_t acc = 1 << (UAC_RESAMPLE_COEF_SHIFT - 1);
+        for (int k = 0; k < UAC_RESAMPLE_TAPS; k++) {
+            acc += (int64_t)x[k] * coef[k];
+        }
+        // the sinc overshoots at full scale transients
+        acc >>= UAC_RESAMPLE_COEF_SHIFT;
+        out[c] = (int32_t)MAX(MIN(acc, INT32_MAX), INT32_MIN);
+    }
+}
+
+/**
+ * @brief Account a completed transfer in the stream statistics
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] packets     Number of ISOC packets of the transfer
+ * @param[in] samples     Number of samples transferred
+ */
+static void stream_stats_xfer_done(uac_iface_t *iface, int packets, uint32_t samples)
+{
+    const int64_t now = esp_timer_get_time();
+    const uint32_t level = _ring_buffer_get_len(iface->ringbuf);
+    UAC_ENTER_CRITICAL();
+    if (iface->stats.packets == 0) {
+        iface->stats.first_xfer_time_us = now;
+        iface->stats.buffer_level_min = level;
+    } else {
+        iface->samples_after_first += samples;
+    }
+    iface->stats.buffer_level_min = MIN(iface->stats.buffer_level_min, level);
+    iface->stats.buffer_level_max = MAX(iface->stats.buffer_level_max, level);
+    iface->stats.last_xfer_time_us = now;
+    iface->stats.packets += packets;
+    iface->stats.samples += samples;
+    UAC_EXIT_CRITICAL();
+}
+
 /**
  * @brief UAC IN Transfer complete callback
  *
@@ -1103,6 +1873,7 @@ static void stream_rx_xfer_done(usb_transfer_t *in_xfer)
 
     uac_iface_t *iface = in_xfer->context;
     assert(iface);
+    UAC_TRACE(COMPLETE, in_xfer);
 
     if (iface->state != UAC_INTERFACE_STATE_ACTIVE) {
         in_xfer->status = USB_TRANSFER_STATUS_CANCELED;
@@ -1110,41 +1881,53 @@ static void stream_rx_xfer_done(usb_transfer_t *in_xfer)
 
     switch (in_xfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED: {
-
-        // if ringbuffer will overflow, notify user to read data
+        // if ringbuffer overflow (happens if user does not read after the RX_DONE events), the data will be dropped
         size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len + in_xfer->actual_num_bytes >= iface->ringbuf_size) {
-            uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_RX_DONE);
-        }
-
-        // if ringbuffer overflow (happens if user not read in above callback), the data will be dropped
-        data_len = _ring_buffer_get_len(iface->ringbuf);
+        uint32_t pushed_bytes = 0;
+        uint32_t bad_packets = 0;
+        USB_CLASS_STATS_XFER(iface->class_stats, in_xfer->actual_num_bytes, true);
         if (data_len + in_xfer->actual_num_bytes > iface->ringbuf_size) {
             ESP_LOGD(TAG, "RX Ringbuffer overflow");
+            UAC_ENTER_CRITICAL();
+            iface->stats.overruns++;
+            UAC_EXIT_CRITICAL();
+            USB_CLASS_STATS_DROP(iface->class_stats, in_xfer->actual_num_bytes / iface->sample_bytes);
         } else {
             // else push data to ringbuffer
             for (int i = 0; i < in_xfer->num_isoc_packets; i++) {
+                int requested_num_bytes = in_xfer->isoc_packet_desc[i].num_bytes;
+                int actual_num_bytes = in_xfer->isoc_packet_desc[i].actual_num_bytes;
                 if (in_xfer->isoc_packet_desc[i].status != USB_TRANSFER_STATUS_COMPLETED) {
-                    // copy data to ringbuffer
+                    // keep the timing of the following samples: replace the packet with silence of nominal size
                     ESP_LOGD(TAG, "Bad RX Isoc packet %d status %d", i, in_xfer->isoc_packet_desc[i].status);
-                    continue;
+                    actual_num_bytes = iface->packet_size - iface->packet_size % iface->sample_bytes;
+                    stream_silence_fill(iface, in_xfer->data_buffer + i * requested_num_bytes, actual_num_bytes);
+                    bad_packets++;
                 }
-                int requested_num_bytes = in_xfer->isoc_packet_desc[i].num_bytes;
-                int actual_num_bytes = in_xfer->isoc_packet_desc[i].actual_num_bytes;
                 // in UAC, the actual_num_bytes may less than requested_num_bytes
                 // eg. the packet_size is 64, but the endpoint size is 100
                 assert(requested_num_bytes >= actual_num_bytes);
                 // copy data to ringbuffer
-                _ring_buffer_push(iface->ringbuf, in_xfer->data_buffer + i * requested_num_bytes, actual_num_bytes, 0);
+                if (_ring_buffer_push(iface->ringbuf, in_xfer->data_buffer + i * requested_num_bytes, actual_num_bytes, 0) == ESP_OK) {
+                    pushed_bytes += actual_num_bytes;
+                }
             }
         }
+        if (bad_packets) {
+            UAC_ENTER_CRITICAL();
+            iface->stats.bad_packets += bad_packets;
+            UAC_EXIT_CRITICAL();
+        }
+        stream_stats_xfer_done(iface, in_xfer->num_isoc_packets, pushed_bytes / iface->sample_bytes);
         // Relaunch transfer
+        UAC_TRACE(RESUBMIT, in_xfer);
         usb_host_transfer_submit(in_xfer);
 
-        // if ringbuffer is reach the threshold, notify user to read out
+        // if ringbuffer is reach the threshold or the next transfer would overflow it, notify user to read out
         data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len >= iface->ringbuf_threshold) {
-            uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_RX_DONE);
+        USB_CLASS_STATS_QUEUE(iface->class_stats, data_len);
+        if (data_len >= iface->ringbuf_threshold || data_len + in_xfer->actual_num_bytes >= iface->ringbuf_size) {
+            uac_host_interface_event_post(iface, UAC_HOST_DEVICE_EVENT_RX_DONE);
         }
 
         return;
@@ -1160,31 +1943,93 @@ static void stream_rx_xfer_done(usb_transfer_t *in_xfer)
     }
 
     ESP_LOGE(TAG, "Transfer failed, status %d", in_xfer->status);
+    USB_CLASS_STATS_XFER(iface->class_stats, 0, false);
     // Notify user about transfer or any other error
-    uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR);
+    uac_host_interface_event_post(iface, UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR);
+}
+
+/**
+ * @brief Set packet sizes of a TX transfer from the nominal rate or the device feedback
+ *
+ * Only whole samples are sent, the fraction is carried to the next packet. Packets are limited to the endpoint MPS.
+ * Without feedback endpoint, the nominal rate is accumulated as an exact fraction, so e.g. 44.1 kHz at Full Speed
+ * gives nine packets of 44 samples and one of 45, and the stream does not drift from the device clock.
+ *
+ * @param[in] iface         Pointer to Interface structure
+ * @param[in] out_xfer      Pointer to TX transfer
+ * @param[inout] remainder  Fraction of a sample carried between packets, Q16.16
+ * @return Number of bytes of the transfer
+ */
+static uint32_t stream_tx_packets_size(uac_iface_t *iface, usb_transfer_t *out_xfer, uint32_t *remainder)
+{
+    const uint32_t samples_max = iface->iface_alt[iface->cur_alt].ep_mps / iface->sample_bytes;
+    const uint32_t samples_per_packet = iface->feedback.samples;
+    const uint32_t num = iface->feedback.nominal_num;
+    const uint32_t den = iface->feedback.nominal_den;
+    uint32_t xfer_bytes = 0;
+    for (int i = 0; i < iface->packet_num; i++) {
+        uint32_t samples;
+        if (iface->feedback.xfer) {
+            const uint32_t acc = *remainder + samples_per_packet;
+            samples = MIN(acc >> 16, samples_max);
+            *remainder = (acc - (samples << 16)) & 0xFFFF;
+        } else {
+            // The nominal packet never exceeds the MPS, checked in uac_host_device_start()
+            const uint32_t acc = *remainder + num;
+            samples = acc / den;
+            *remainder = acc % den;
+        }
+        out_xfer->isoc_packet_desc[i].num_bytes = samples * iface->sample_bytes;
+        xfer_bytes += out_xfer->isoc_packet_desc[i].num_bytes;
+    }
+    out_xfer->num_bytes = xfer_bytes;
+    return xfer_bytes;
 }
 
-static void stream_tx_xfer_submit(usb_transfer_t *out_xfer)
+/**
+ * @brief Fill TX transfer with the next audio data and submit it
+ *
+ * Data comes from the fill callback or from the ringbuffer. With too little data in the ringbuffer, the transfer is
+ * added to the free list, or with FLAG_STREAM_TX_UNDERRUN_SILENCE sent with silence in place of the missing samples.
+ *
+ * @param[in] out_xfer  Pointer to TX transfer
+ * @param[in] resubmit  Called from the completion callback of the transfer
+ * @return esp_err_t of usb_host_transfer_submit(), ESP_OK if the transfer was added to the free list
+ */
+static esp_err_t stream_tx_xfer_submit(usb_transfer_t *out_xfer, bool resubmit)
 {
     uac_iface_t *iface = out_xfer->context;
     assert(iface);
+    const usb_host_class_trace_event_t trace_event = resubmit ? USB_HOST_CLASS_TRACE_RESUBMIT : USB_HOST_CLASS_TRACE_SUBMIT;
+
+    if (iface->tx_fill_cb) {
+        // The user writes directly to the transfer buffer, ringbuf is not used
+        stream_tx_packets_size(iface, out_xfer, &iface->feedback.remainder);
+        UAC_TRACE(CB_ENTER, out_xfer);
+        USB_CLASS_STATS_CB_ENTER(iface->class_stats);
+        uint32_t filled = iface->tx_fill_cb(iface, out_xfer->data_buffer, out_xfer->num_bytes, iface->tx_fill_cb_arg);
+        USB_CLASS_STATS_CB_EXIT(iface->class_stats);
+        UAC_TRACE(CB_EXIT, out_xfer);
+        filled = MIN(filled, (uint32_t)out_xfer->num_bytes);
+        filled -= filled % iface->sample_bytes;
+        if (filled < out_xfer->num_bytes) {
+            ESP_LOGD(TAG, "TX underrun, %"PRIu32" of %d bytes", filled, out_xfer->num_bytes);
+            UAC_ENTER_CRITICAL();
+            iface->stats.underruns++;
+            UAC_EXIT_CRITICAL();
+            USB_CLASS_STATS_DROP(iface->class_stats, (out_xfer->num_bytes - filled) / iface->sample_bytes);
+            stream_silence_fill(iface, out_xfer->data_buffer + filled, out_xfer->num_bytes - filled);
+        }
+        USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_UAC, trace_event, out_xfer);
+        return usb_host_transfer_submit(out_xfer);
+    }
 
+    uint32_t remainder = iface->feedback.remainder;
+    const uint32_t xfer_bytes = stream_tx_packets_size(iface, out_xfer, &remainder);
     size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-    if (data_len >= iface->packet_size * iface->packet_num) {
-        data_len = iface->packet_size * iface->packet_num;
-        size_t actual_num_bytes = 0;
-        _ring_buffer_pop(iface->ringbuf, out_xfer->data_buffer, data_len, &actual_num_bytes, 0);
-        assert(actual_num_bytes == data_len);
-        // Relaunch transfer, as the pipe state may change
-        // the transfer may fail eg. the device is disconnected or the pipe is suspended
-        // the data in ringbuffer will be dropped without notify user
-        usb_host_transfer_submit(out_xfer);
-        data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len <= iface->ringbuf_threshold) {
-            // Notify user send done
-            uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TX_DONE);
-        }
-    } else {
+    USB_CLASS_STATS_QUEUE(iface->class_stats, data_len);
+    const bool underrun = (data_len < xfer_bytes);
+    if (underrun && !(iface->flags & FLAG_STREAM_TX_UNDERRUN_SILENCE)) {
         // add the transfer to free list
         UAC_ENTER_CRITICAL();
         for (int i = 0; i < iface->xfer_num; i++) {
@@ -1196,8 +2041,36 @@ static void stream_tx_xfer_submit(usb_transfer_t *out_xfer)
         }
         UAC_EXIT_CRITICAL();
         // Notify user send done
-        uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TX_DONE);
+        uac_host_interface_event_post(iface, UAC_HOST_DEVICE_EVENT_TX_DONE);
+        return ESP_OK;
+    }
+
+    data_len = underrun ? data_len - data_len % iface->sample_bytes : xfer_bytes;
+    iface->feedback.remainder = remainder;
+    if (data_len) {
+        size_t actual_num_bytes = 0;
+        _ring_buffer_pop(iface->ringbuf, out_xfer->data_buffer, data_len, &actual_num_bytes, 0);
+        assert(actual_num_bytes == data_len);
+    }
+    if (underrun) {
+        ESP_LOGD(TAG, "TX underrun, %d of %"PRIu32" bytes", (int)data_len, xfer_bytes);
+        UAC_ENTER_CRITICAL();
+        iface->stats.underruns++;
+        UAC_EXIT_CRITICAL();
+        USB_CLASS_STATS_DROP(iface->class_stats, (xfer_bytes - data_len) / iface->sample_bytes);
+        stream_silence_fill(iface, out_xfer->data_buffer + data_len, xfer_bytes - data_len);
+    }
+    // Relaunch transfer, as the pipe state may change
+    // the transfer may fail eg. the device is disconnected or the pipe is suspended
+    // the data in ringbuffer will be dropped without notify user
+    USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_UAC, trace_event, out_xfer);
+    esp_err_t ret = usb_host_transfer_submit(out_xfer);
+    data_len = _ring_buffer_get_len(iface->ringbuf);
+    if (data_len <= iface->ringbuf_threshold) {
+        // Notify user send done
+        uac_host_interface_event_post(iface, UAC_HOST_DEVICE_EVENT_TX_DONE);
     }
+    return ret;
 }
 
 /**
@@ -1211,6 +2084,7 @@ static void stream_tx_xfer_done(usb_transfer_t *out_xfer)
 
     uac_iface_t *iface = out_xfer->context;
     assert(iface);
+    UAC_TRACE(COMPLETE, out_xfer);
 
     // If the iface is not active, cancel the transfer
     if (iface->state != UAC_INTERFACE_STATE_ACTIVE) {
@@ -1219,8 +2093,10 @@ static void stream_tx_xfer_done(usb_transfer_t *out_xfer)
 
     switch (out_xfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED: {
+        USB_CLASS_STATS_XFER(iface->class_stats, out_xfer->num_bytes, true);
+        stream_stats_xfer_done(iface, out_xfer->num_isoc_packets, out_xfer->num_bytes / iface->sample_bytes);
         // Submit the next transfer
-        stream_tx_xfer_submit(out_xfer);
+        stream_tx_xfer_submit(out_xfer, true);
         return;
     }
     case USB_TRANSFER_STATUS_NO_DEVICE:
@@ -1243,8 +2119,101 @@ static void stream_tx_xfer_done(usb_transfer_t *out_xfer)
     }
 
     ESP_LOGE(TAG, "Transfer failed, status %d", out_xfer->status);
+    USB_CLASS_STATS_XFER(iface->class_stats, 0, false);
     // Notify user about transfer or any other error
-    uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR);
+    uac_host_interface_event_post(iface, UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR);
+}
+
+/**
+ * @brief UAC feedback IN Transfer complete callback
+ *
+ * The feedback is stored as samples per packet, Q16.16. Full Speed devices send it in 10.14 format (3 bytes),
+ * High Speed devices in 16.16 format (4 bytes), both per (micro)frame. Values more than 1/8 off the nominal rate are ignored.
+ *
+ * @param[in] fb_xfer  Pointer to transfer data structure
+ */
+static void stream_fb_xfer_done(usb_transfer_t *fb_xfer)
+{
+    assert(fb_xfer);
+
+    uac_iface_t *iface = fb_xfer->context;
+    assert(iface);
+    UAC_TRACE(COMPLETE, fb_xfer);
+
+    if (iface->state != UAC_INTERFACE_STATE_ACTIVE) {
+        return;
+    }
+
+    switch (fb_xfer->status) {
+    case USB_TRANSFER_STATUS_COMPLETED: {
+        const uint8_t *data = fb_xfer->data_buffer;
+        const int len = fb_xfer->isoc_packet_desc[0].actual_num_bytes;
+        uint32_t samples = 0;
+        if (fb_xfer->isoc_packet_desc[0].status != USB_TRANSFER_STATUS_COMPLETED) {
+            break;
+        }
+        if (len == 3) {
+            samples = (data[0] | (data[1] << 8) | (data[2] << 16)) << 2;
+        } else if (len >= 4) {
+            samples = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        }
+        samples *= iface->feedback.frames_per_packet;
+        const uint32_t nominal = iface->feedback.nominal;
+        if (samples > nominal - nominal / 8 && samples < nominal + nominal / 8) {
+            iface->feedback.samples = samples;
+        } else if (len) {
+            ESP_LOGD(TAG, "Feedback 0x%08"PRIX32" out of range, ignored", samples);
+        }
+        break;
+    }
+    case USB_TRANSFER_STATUS_NO_DEVICE:
+    case USB_TRANSFER_STATUS_CANCELED:
+        return;
+    default:
+        // Keep the last value, the device may answer the next poll
+        ESP_LOGD(TAG, "Feedback transfer failed, status %d", fb_xfer->status);
+        break;
+    }
+    UAC_TRACE(RESUBMIT, fb_xfer);
+    usb_host_transfer_submit(fb_xfer);
+}
+
+/**
+ * @brief Submit free TX transfers while the ringbuffer has data
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the interface changed to inactive
+ */
+static esp_err_t stream_tx_xfer_submit_free(uac_iface_t *iface)
+{
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < iface->xfer_num; i++) {
+        UAC_ENTER_CRITICAL();
+        if (iface->free_xfer_list[i]) {
+            size_t data_len = _ring_buffer_get_len(iface->ringbuf);
+            if (data_len == 0) {
+                goto exit_critical;
+            }
+            // if interface state changed to inactive during blocking write
+            // we need to return invalid state to safely exit the write function
+            if (UAC_INTERFACE_STATE_ACTIVE != iface->state) {
+                ret = ESP_ERR_INVALID_STATE;
+                goto exit_critical;
+            }
+            iface->xfer_list[i] = iface->free_xfer_list[i];
+            iface->free_xfer_list[i] = NULL;
+            iface->xfer_list[i]->status = USB_TRANSFER_STATUS_COMPLETED;
+            UAC_EXIT_CRITICAL();
+            stream_tx_xfer_submit(iface->xfer_list[i], false);
+            UAC_ENTER_CRITICAL();
+        }
+exit_critical:
+        UAC_EXIT_CRITICAL();
+    }
+
+    return ret;
 }
 
 /**
@@ -1271,11 +2240,18 @@ static esp_err_t uac_host_interface_suspend(uac_iface_t *iface)
     } else {
         ESP_LOGI(TAG, "Set Interface %d-%d", iface->dev_info.iface_num, 0);
     }
+    uac_host_interface_bw_release(iface); // The endpoints are not polled anymore, even if the device did not respond
 
     uint8_t ep_addr = iface->iface_alt[iface->cur_alt].ep_addr;
     UAC_RETURN_ON_ERROR(usb_host_endpoint_halt(iface->parent->dev_hdl, ep_addr), "Unable to HALT EP");
     UAC_RETURN_ON_ERROR(usb_host_endpoint_flush(iface->parent->dev_hdl, ep_addr), "Unable to FLUSH EP");
     usb_host_endpoint_clear(iface->parent->dev_hdl, ep_addr);
+    if (iface->feedback.xfer) {
+        const uint8_t fb_ep_addr = iface->iface_alt[iface->cur_alt].fb_ep_addr;
+        UAC_RETURN_ON_ERROR(usb_host_endpoint_halt(iface->parent->dev_hdl, fb_ep_addr), "Unable to HALT feedback EP");
+        UAC_RETURN_ON_ERROR(usb_host_endpoint_flush(iface->parent->dev_hdl, fb_ep_addr), "Unable to FLUSH feedback EP");
+        usb_host_endpoint_clear(iface->parent->dev_hdl, fb_ep_addr);
+    }
     _ring_buffer_flush(iface->ringbuf);
 
     // add all the transfer to free list
@@ -1307,17 +2283,31 @@ static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
     UAC_RETURN_ON_FALSE(is_interface_in_list(iface), ESP_ERR_NOT_FOUND, "Interface handle not found");
     UAC_RETURN_ON_FALSE((UAC_INTERFACE_STATE_READY == iface->state), ESP_ERR_INVALID_STATE, "Interface wrong state");
 
+    // Reserve bus bandwidth before the device starts streaming, so other periodic streams on the bus are not disturbed
+    UAC_RETURN_ON_ERROR(uac_host_interface_bw_reserve(iface), "Unable to reserve bus bandwidth");
+
     // Set Interface alternate setting
     usb_setup_packet_t request;
     USB_SETUP_PACKET_INIT_SET_INTERFACE(&request, iface->dev_info.iface_num, iface->cur_alt + 1);
     UAC_RETURN_ON_ERROR(uac_cs_request_set(iface->parent, (uac_cs_request_t *)&request), "Unable to set Interface alternate");
     ESP_LOGI(TAG, "Set Interface %d-%d", iface->dev_info.iface_num, iface->cur_alt + 1);
-    // Set endpoint frequency control
-    if (iface->iface_alt[iface->cur_alt].freq_ctrl_supported) {
+    // Set sampling frequency of the UAC 2.0 clock source or of the UAC 1.0 endpoint
+    if (iface->iface_alt[iface->cur_alt].freq_ctrl_supported && iface->iface_alt[iface->cur_alt].clock_id) {
+        ESP_LOGI(TAG, "Set Clock %d frequency %"PRIu32, iface->iface_alt[iface->cur_alt].clock_id, iface->iface_alt[iface->cur_alt].cur_sampling_freq);
+        UAC_RETURN_ON_ERROR(uac_cs_request_set_clock_frequency(iface, iface->iface_alt[iface->cur_alt].clock_id,
+                            iface->iface_alt[iface->cur_alt].cur_sampling_freq), "Unable to set clock frequency");
+    } else if (iface->iface_alt[iface->cur_alt].freq_ctrl_supported) {
         ESP_LOGI(TAG, "Set EP %02X frequency %"PRIu32, iface->iface_alt[iface->cur_alt].ep_addr, iface->iface_alt[iface->cur_alt].cur_sampling_freq);
         UAC_RETURN_ON_ERROR(uac_cs_request_set_ep_frequency(iface, iface->iface_alt[iface->cur_alt].ep_addr,
                             iface->iface_alt[iface->cur_alt].cur_sampling_freq), "Unable to set endpoint frequency");
     }
+    UAC_ENTER_CRITICAL();
+    memset(&iface->stats, 0, sizeof(iface->stats));
+    iface->samples_after_first = 0;
+    UAC_EXIT_CRITICAL();
+    if (iface->resampler) {
+        stream_resampler_reset(iface->resampler);
+    }
     // for RX, we just submit all the transfers
     if (iface->dev_info.type == UAC_STREAM_RX) {
         assert(iface->iface_alt[iface->cur_alt].ep_addr & 0x80);
@@ -1336,10 +2326,27 @@ static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
             }
             iface->xfer_list[i] = iface->free_xfer_list[i];
             iface->free_xfer_list[i] = NULL;
+            UAC_TRACE(SUBMIT, iface->xfer_list[i]);
             UAC_RETURN_ON_ERROR(usb_host_transfer_submit(iface->xfer_list[i]), "Unable to submit RX transfer");
         }
     } else if (iface->dev_info.type == UAC_STREAM_TX) {
         assert(!(iface->iface_alt[iface->cur_alt].ep_addr & 0x80));
+        // packets carry the nominal number of samples, fractional rates like 44.1 kHz alternate between packet sizes
+        iface->feedback.samples = iface->feedback.nominal;
+        iface->feedback.remainder = 0;
+        // for asynchronous TX, poll the feedback endpoint. Packet sizes follow the device clock from now on
+        if (iface->feedback.xfer) {
+            usb_transfer_t *fb_xfer = iface->feedback.xfer;
+            fb_xfer->device_handle = iface->parent->dev_hdl;
+            fb_xfer->callback = stream_fb_xfer_done;
+            fb_xfer->context = iface;
+            fb_xfer->timeout_ms = DEFAULT_ISOC_XFER_TIMEOUT_MS;
+            fb_xfer->bEndpointAddress = iface->iface_alt[iface->cur_alt].fb_ep_addr;
+            fb_xfer->num_bytes = iface->iface_alt[iface->cur_alt].fb_ep_mps;
+            fb_xfer->isoc_packet_desc[0].num_bytes = iface->iface_alt[iface->cur_alt].fb_ep_mps;
+            UAC_TRACE(SUBMIT, fb_xfer);
+            UAC_RETURN_ON_ERROR(usb_host_transfer_submit(fb_xfer), "Unable to submit feedback transfer");
+        }
         // for TX, we submit the first transfer with data 0 to make the speaker quiet
         for (int i = 0; i < iface->xfer_num; i++) {
             assert(iface->free_xfer_list[i]);
@@ -1348,13 +2355,19 @@ static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
             iface->free_xfer_list[i]->context = iface;
             iface->free_xfer_list[i]->timeout_ms = DEFAULT_ISOC_XFER_TIMEOUT_MS;
             iface->free_xfer_list[i]->bEndpointAddress = iface->iface_alt[iface->cur_alt].ep_addr;
-            // set the data buffer to 0
-            memset(iface->free_xfer_list[i]->data_buffer, 0, iface->free_xfer_list[i]->data_buffer_size);
+            // set the data buffer to silence
+            stream_silence_fill(iface, iface->free_xfer_list[i]->data_buffer, iface->free_xfer_list[i]->data_buffer_size);
             // for synchronous transfer type, the packet size depends on the actual sample rate, channels and bit resolution.
             for (int j = 0; j < iface->packet_num; j++) {
                 iface->free_xfer_list[i]->isoc_packet_desc[j].num_bytes = iface->packet_size;
             }
             iface->free_xfer_list[i]->num_bytes = iface->packet_num * iface->packet_size;
+            // in pull modes, all the transfers are kept in flight from the start
+            if (iface->tx_fill_cb || (iface->flags & FLAG_STREAM_TX_UNDERRUN_SILENCE)) {
+                iface->xfer_list[i] = iface->free_xfer_list[i];
+                iface->free_xfer_list[i] = NULL;
+                UAC_RETURN_ON_ERROR(stream_tx_xfer_submit(iface->xfer_list[i], false), "Unable to submit TX transfer");
+            }
         }
     }
 
@@ -1382,62 +2395,60 @@ static esp_err_t _uac_host_device_add(uint8_t addr, usb_device_handle_t dev_hdl,
     uac_device->addr = addr;
     uac_device->dev_hdl = dev_hdl;
 
-    // Parse the configuration descriptor to find the UAC control interface
-    const size_t total_length = config_desc->wTotalLength;
-    const usb_intf_desc_t *iface_desc = NULL;
-    const uac_desc_header_t *uac_cs_desc = NULL;
-    int iface_offset = 0;
-    int uac_desc_offset = 0;
-    // Get first Interface descriptor
-    iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, total_length, iface_offset);
-    while (iface_desc != NULL) {
-        uac_desc_offset = iface_offset;
-        // 1. Parse the configuration descriptor to find only the first the UAC control interface
-        // 2. Parse each class specific audio control interface
-        // 2.1. for header descriptor, check if it is supported uac version
-        // 2.2. save the class specific audio control descriptor for future use
-        if (iface_desc->bInterfaceClass == USB_CLASS_AUDIO && iface_desc->bInterfaceSubClass == UAC_SUBCLASS_AUDIOCONTROL) {
-            ESP_LOGD(TAG, "Found UAC Control, bInterfaceNumber=%d", iface_desc->bInterfaceNumber);
-            uac_cs_desc = GET_NEXT_UAC_CS_DESC(iface_desc, total_length, uac_desc_offset);
-            uac_device->ctrl_iface_num = iface_desc->bInterfaceNumber;
-            // break if all UAC control class specific descriptors are parsed
-            while (uac_cs_desc != NULL) {
-                switch (uac_cs_desc->bDescriptorSubtype) {
-                case UAC_AC_HEADER: {
-                    const uac_ac_header_desc_t *header_desc = (const uac_ac_header_desc_t *)uac_cs_desc;
-                    if (header_desc->bcdADC != 0x0100) {
-                        ESP_LOGW(TAG, "UAC version 0x%04X not supported", header_desc->bcdADC);
-                        free(uac_device);
-                        return ESP_ERR_NOT_SUPPORTED;
-                    }
-                    uint8_t *cs_ac_desc = calloc(header_desc->wTotalLength, sizeof(uint8_t));
-                    UAC_GOTO_ON_FALSE(cs_ac_desc, ESP_ERR_NO_MEM, "Unable to allocate memory for UAC Control CS descriptor");
-                    memcpy(cs_ac_desc, uac_cs_desc, header_desc->wTotalLength);
-                    uac_device->cs_ac_desc = cs_ac_desc;
-                    ESP_LOGD(TAG, "UAC version 0x%04X", header_desc->bcdADC);
-                    break;
-                }
-                default:
-                    break;
-                }
-                uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
-                if (uac_cs_desc->bDescriptorType != UAC_CS_INTERFACE) {
-                    // parse stop if the next descriptor is not UAC class specific interface descriptor
-                    break;
-                }
+    // Index the configuration descriptor once, interfaces are looked up in it when they are opened
+    UAC_GOTO_ON_ERROR(usb_host_desc_index_build(config_desc, &uac_device->desc_index), "Unable to index configuration descriptor");
+
+    // 1. Find only the first UAC control interface
+    // 2. Parse each class specific audio control interface descriptor
+    // 2.1. for header descriptor, check if it is supported uac version
+    // 2.2. save the class specific audio control descriptor for future use
+    for (int i = 0; i < uac_device->desc_index->num_intfs; i++) {
+        const usb_host_desc_index_alt_t *alt = &uac_device->desc_index->intfs[i].alts[0];
+        const usb_intf_desc_t *iface_desc = alt->intf_desc;
+        if (iface_desc->bInterfaceClass != USB_CLASS_AUDIO || iface_desc->bInterfaceSubClass != UAC_SUBCLASS_AUDIOCONTROL) {
+            continue;
+        }
+        ESP_LOGD(TAG, "Found UAC Control, bInterfaceNumber=%d", iface_desc->bInterfaceNumber);
+        uac_device->ctrl_iface_num = iface_desc->bInterfaceNumber;
+        // class specific descriptors directly follow the interface descriptor
+        for (int j = 0; j < alt->num_class_descs && alt->class_descs[j]->bDescriptorType == UAC_CS_INTERFACE; j++) {
+            const uac_desc_header_t *uac_cs_desc = (const uac_desc_header_t *)alt->class_descs[j];
+            if (uac_cs_desc->bDescriptorSubtype != UAC_AC_HEADER) {
+                continue;
             }
-            // all parse stop, only parse the first UAC control interface
-            break;
+            // bcdADC is at the same offset in both versions, wTotalLength is not
+            const uac_ac_header_desc_t *header_desc = (const uac_ac_header_desc_t *)uac_cs_desc;
+            size_t cs_ac_desc_len = 0;
+            if (header_desc->bcdADC == UAC_VERSION_1) {
+                cs_ac_desc_len = header_desc->wTotalLength;
+            } else if (header_desc->bcdADC == UAC_VERSION_2) {
+                cs_ac_desc_len = ((const uac2_ac_header_desc_t *)uac_cs_desc)->wTotalLength;
+            } else {
+                ESP_LOGW(TAG, "UAC version 0x%04X not supported", header_desc->bcdADC);
+                usb_host_desc_index_free(uac_device->desc_index);
+                free(uac_device);
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            uint8_t *cs_ac_desc = calloc(cs_ac_desc_len, sizeof(uint8_t));
+            UAC_GOTO_ON_FALSE(cs_ac_desc, ESP_ERR_NO_MEM, "Unable to allocate memory for UAC Control CS descriptor");
+            memcpy(cs_ac_desc, uac_cs_desc, cs_ac_desc_len);
+            uac_device->cs_ac_desc = cs_ac_desc;
+            uac_device->cs_ac_desc_len = cs_ac_desc_len;
+            uac_device->uac_version = header_desc->bcdADC;
+            ESP_LOGD(TAG, "UAC version 0x%04X", header_desc->bcdADC);
         }
-        iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_offset);
+        // only parse the first UAC control interface
+        break;
     }
+    UAC_GOTO_ON_ERROR(_uac_host_device_topology_build(uac_device), "Unable to parse UAC Control topology");
 
     // Create Semaphore for control transfer
     UAC_GOTO_ON_FALSE(uac_device->ctrl_xfer_done = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM, "Unable to create semaphore");
     UAC_GOTO_ON_FALSE(uac_device->device_busy =  xSemaphoreCreateMutex(), ESP_ERR_NO_MEM, "Unable to create mutex");
 
-    // Allocate control transfer buffer
-    UAC_GOTO_ON_ERROR(usb_host_transfer_alloc(64, 0, &uac_device->ctrl_xfer), "Unable to allocate transfer buffer");
+    // Allocate control transfer buffer, UAC 2.0 clock frequency ranges need more than 64 bytes
+    const size_t ctrl_xfer_size = (uac_device->uac_version == UAC_VERSION_2) ? UAC2_CTRL_XFER_SIZE : 64;
+    UAC_GOTO_ON_ERROR(usb_host_urb_pool_transfer_alloc(ctrl_xfer_size, 0, &uac_device->ctrl_xfer), "Unable to allocate transfer buffer");
 
     UAC_GOTO_ON_FALSE_CRITICAL(s_uac_driver, ESP_ERR_INVALID_STATE);
     UAC_GOTO_ON_FALSE_CRITICAL(s_uac_driver->client_handle, ESP_ERR_INVALID_STATE);
@@ -1466,7 +2477,7 @@ static esp_err_t _uac_host_device_delete(uac_device_t *uac_device)
     UAC_RETURN_ON_INVALID_ARG(uac_device);
 
     if (uac_device->ctrl_xfer) {
-        UAC_RETURN_ON_ERROR(usb_host_transfer_free(uac_device->ctrl_xfer), "Unable to free transfer buffer for EP0");
+        UAC_RETURN_ON_ERROR(usb_host_urb_pool_transfer_free(uac_device->ctrl_xfer), "Unable to free transfer buffer for EP0");
     }
 
     if (uac_device->ctrl_xfer_done) {
@@ -1480,6 +2491,11 @@ static esp_err_t _uac_host_device_delete(uac_device_t *uac_device)
     if (uac_device->cs_ac_desc) {
         free(uac_device->cs_ac_desc);
     }
+    usb_host_desc_index_free(uac_device->desc_index);
+    for (int i = 0; uac_device->entities && i < uac_device->entity_num; i++) {
+        free(uac_device->entities[i].freq_ranges);
+    }
+    free(uac_device->entities);
 
     ESP_LOGD(TAG, "Remove addr %d device from list", uac_device->addr);
 
@@ -1680,6 +2696,126 @@ static esp_err_t uac_cs_request_set_ep_frequency(uac_iface_t *iface, uint8_t ep_
     return uac_cs_request_set(iface->parent, &set_freq);
 }
 
+/**
+ * @brief UAC 2.0 class specific request - Set Clock Source Frequency
+ * @param[in] iface       Pointer to UAC interface structure
+ * @param[in] clock_id    Clock source ID
+ * @param[in] freq        Frequency to set
+ * @return esp_err_t
+ */
+static esp_err_t uac_cs_request_set_clock_frequency(uac_iface_t *iface, uint8_t clock_id, uint32_t freq)
+{
+    uint8_t tmp[4] = { freq & 0xff, (freq >> 8) & 0xff, (freq >> 16) & 0xff, (freq >> 24) & 0xff };
+
+    const uac_cs_request_t set_freq = {
+        .bRequest = UAC2_CUR,
+        .wValue = UAC2_CS_SAM_FREQ_CONTROL << 8,
+        .wIndex = (clock_id << 8) | (iface->parent->ctrl_iface_num & 0xff),
+        .wLength = 4,
+        .data = tmp
+    };
+    return uac_cs_request_set(iface->parent, &set_freq);
+}
+
+/**
+ * @brief UAC 2.0 class specific request - Get Clock Source Frequency ranges
+ *
+ * The number of subranges is read first, then as many subranges as fit into the control transfer.
+ *
+ * @param[in] uac_device  Pointer to UAC device structure
+ * @param[in] clock       Clock source entity, its freq_ranges are allocated and filled
+ * @return esp_err_t
+ */
+static esp_err_t uac_cs_request_get_clock_freq_range(uac_device_t *uac_device, uac_ac_entity_t *clock)
+{
+    uint8_t tmp[UAC2_CTRL_XFER_SIZE - USB_SETUP_PACKET_SIZE];
+    uac_cs_request_t get_range = {
+        .bRequest = UAC2_RANGE,
+        .wValue = UAC2_CS_SAM_FREQ_CONTROL << 8,
+        .wIndex = (clock->id << 8) | (uac_device->ctrl_iface_num & 0xff),
+        .wLength = 2,
+        .data = tmp
+    };
+
+    size_t actual_length = 0;
+    UAC_RETURN_ON_ERROR(uac_cs_request_get(uac_device, &get_range, &actual_length), "Unable to get clock frequency range");
+    UAC_RETURN_ON_FALSE(actual_length == 2, ESP_ERR_INVALID_RESPONSE, "Incorrect clock frequency range");
+    uint16_t range_num = MIN(tmp[0] | (tmp[1] << 8), UAC2_FREQ_SUBRANGE_NUM_MAX);
+    UAC_RETURN_ON_FALSE(range_num, ESP_ERR_INVALID_RESPONSE, "No clock frequency range");
+
+    get_range.wLength = 2 + range_num * 12;
+    UAC_RETURN_ON_ERROR(uac_cs_request_get(uac_device, &get_range, &actual_length), "Unable to get clock frequency range");
+    range_num = MIN(range_num, (actual_length - 2) / 12);
+    UAC_RETURN_ON_FALSE(actual_length >= 2 && range_num, ESP_ERR_INVALID_RESPONSE, "Incorrect clock frequency range");
+
+    clock->freq_ranges = calloc(range_num, sizeof(*clock->freq_ranges));
+    UAC_RETURN_ON_FALSE(clock->freq_ranges, ESP_ERR_NO_MEM, "Unable to allocate memory for clock frequency range");
+    clock->freq_range_num = range_num;
+    // dMIN, dMAX, dRES of each subrange
+    for (int i = 0; i < range_num; i++) {
+        for (int j = 0; j < 3; j++) {
+            const uint8_t *value = &tmp[2 + i * 12 + j * 4];
+            clock->freq_ranges[i][j] = value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24);
+        }
+        ESP_LOGD(TAG, "Clock %d frequency range %"PRIu32" - %"PRIu32", res %"PRIu32, clock->id,
+                 clock->freq_ranges[i][0], clock->freq_ranges[i][1], clock->freq_ranges[i][2]);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Fill sampling frequencies of a UAC 2.0 alternate setting from the clock source of its terminal
+ *
+ * Clock selectors and multipliers are followed through their first input. Frequency ranges are read once
+ * per clock source. If all subranges are single frequencies, they are reported as discrete frequencies.
+ *
+ * @param[in] uac_device  Pointer to UAC device structure
+ * @param[in] iface_alt   Alternate setting with connected_terminal
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_interface_clock_params(uac_device_t *uac_device, uac_iface_alt_t *iface_alt)
+{
+    const uac_ac_entity_t *terminal = _uac_ac_entity_find(uac_device, iface_alt->connected_terminal);
+    UAC_RETURN_ON_FALSE(terminal, ESP_ERR_NOT_FOUND, "Terminal not found");
+    uac_ac_entity_t *clock = _uac_ac_entity_find(uac_device, terminal->clock_id);
+    for (int i = 0; clock && clock->subtype != UAC2_AC_CLOCK_SOURCE && i < uac_device->entity_num; i++) {
+        clock = _uac_ac_entity_find(uac_device, clock->source_id);
+    }
+    UAC_RETURN_ON_FALSE(clock && clock->subtype == UAC2_AC_CLOCK_SOURCE, ESP_ERR_NOT_FOUND, "Clock source not found");
+    if (!clock->freq_ranges) {
+        UAC_RETURN_ON_ERROR(uac_cs_request_get_clock_freq_range(uac_device, clock), "Unable to get clock frequency range");
+    }
+
+    const uac2_ac_clock_source_desc_t *clock_desc = (const uac2_ac_clock_source_desc_t *)clock->desc;
+    iface_alt->clock_id = clock->id;
+    iface_alt->freq_ctrl_supported = (clock_desc->bmControls & UAC2_CONTROL_MASK) == UAC2_CONTROL_PROGRAMMABLE;
+
+    uac_host_dev_alt_param_t *param = &iface_alt->dev_alt_param;
+    bool discrete = true;
+    for (int i = 0; i < clock->freq_range_num; i++) {
+        discrete &= (clock->freq_ranges[i][0] == clock->freq_ranges[i][1]);
+    }
+    if (discrete) {
+        param->sample_freq_type = clock->freq_range_num;
+        for (int i = 0; i < clock->freq_range_num && i < UAC_FREQ_NUM_MAX; i++) {
+            param->sample_freq[i] = clock->freq_ranges[i][0];
+        }
+        if (clock->freq_range_num > UAC_FREQ_NUM_MAX) {
+            ESP_LOGW(TAG, "UAC Clock %d, Frequency Number %d exceed the maximum %d", clock->id, clock->freq_range_num, UAC_FREQ_NUM_MAX);
+        }
+    } else {
+        param->sample_freq_type = 0;
+        param->sample_freq_lower = UINT32_MAX;
+        param->sample_freq_upper = 0;
+        for (int i = 0; i < clock->freq_range_num; i++) {
+            param->sample_freq_lower = MIN(param->sample_freq_lower, clock->freq_ranges[i][0]);
+            param->sample_freq_upper = MAX(param->sample_freq_upper, clock->freq_ranges[i][1]);
+        }
+    }
+    ESP_LOGD(TAG, "UAC Clock Source %d, Frequency Control %d", clock->id, iface_alt->freq_ctrl_supported);
+    return ESP_OK;
+}
+
 /**
  * @brief UAC class specific request - Set Volume
  * @param[in] iface       Pointer to UAC interface structure
@@ -1730,7 +2866,7 @@ static esp_err_t uac_cs_request_get_volume(uac_iface_t *iface, int16_t *volume_d
     esp_err_t ret = ESP_OK;
 
     uac_cs_request_t get_volume = {
-        .bRequest = UAC_GET_CUR,
+        .bRequest = (iface->parent->uac_version == UAC_VERSION_2) ? UAC2_CUR : UAC_GET_CUR,
         .wIndex = (feature_unit << 8) | (ctrl_iface_num & 0xff),
         .wLength = 2,
         .data = tmp
@@ -1782,26 +2918,43 @@ static esp_err_t uac_cs_request_get_volume_range(uac_iface_t *iface, int16_t *vo
     }
 
     size_t actual_length = 0;
-    ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
-    if (ret != ESP_OK || actual_length != get_volume.wLength) {
-        ESP_LOGE(TAG, "Failed to get volume min");
-        return ESP_FAIL;
-    }
-    volume_min = tmp[0] | (tmp[1] << 8);
+    if (iface->parent->uac_version == UAC_VERSION_2) {
+        // one RANGE request: wNumSubRanges followed by MIN, MAX, RES of the first subrange
+        uint8_t range[8] = { 0 };
+        get_volume.bRequest = UAC2_RANGE;
+        get_volume.wLength = sizeof(range);
+        get_volume.data = range;
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume range");
+            return ESP_FAIL;
+        }
+        tmp[0] = range[6];
+        tmp[1] = range[7];
+        volume_min = range[2] | (range[3] << 8);
+        volume_max = range[4] | (range[5] << 8);
+    } else {
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume min");
+            return ESP_FAIL;
+        }
+        volume_min = tmp[0] | (tmp[1] << 8);
 
-    get_volume.bRequest = UAC_GET_MAX;
-    ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
-    if (ret != ESP_OK || actual_length != get_volume.wLength) {
-        ESP_LOGE(TAG, "Failed to get volume max");
-        return ESP_FAIL;
-    }
-    volume_max = tmp[0] | (tmp[1] << 8);
+        get_volume.bRequest = UAC_GET_MAX;
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume max");
+            return ESP_FAIL;
+        }
+        volume_max = tmp[0] | (tmp[1] << 8);
 
-    get_volume.bRequest = UAC_GET_RES;
-    ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
-    if (ret != ESP_OK || actual_length != get_volume.wLength) {
-        ESP_LOGE(TAG, "Failed to get volume res");
-        return ESP_FAIL;
+        get_volume.bRequest = UAC_GET_RES;
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume res");
+            return ESP_FAIL;
+        }
     }
     volume_res = tmp[0] | (tmp[1] << 8);
     *volume_min_db = volume_min;
@@ -1813,6 +2966,24 @@ static esp_err_t uac_cs_request_get_volume_range(uac_iface_t *iface, int16_t *vo
     return ret;
 }
 
+/**
+ * @brief Read the volume range of the feature unit of the current alternate setting, if not read yet
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_interface_volume_range_update(uac_iface_t *iface)
+{
+    const uint8_t feature_unit = iface->iface_alt[iface->cur_alt].feature_unit;
+    if (feature_unit && feature_unit == iface->vol_range_unit) {
+        return ESP_OK;
+    }
+    UAC_RETURN_ON_ERROR(uac_cs_request_get_volume_range(iface, &iface->vol_min_db, &iface->vol_max_db, &iface->vol_res_db),
+                        "Unable to get volume range");
+    iface->vol_range_unit = feature_unit;
+    return ESP_OK;
+}
+
 /**
  * @brief UAC class specific request - Set Mute
  * @param[in] iface       Pointer to UAC interface structure
@@ -1862,7 +3033,7 @@ static esp_err_t uac_cs_request_get_mute(uac_iface_t *iface, bool *mute)
     esp_err_t ret = ESP_OK;
 
     uac_cs_request_t get_mute = {
-        .bRequest = UAC_GET_CUR,
+        .bRequest = (iface->parent->uac_version == UAC_VERSION_2) ? UAC2_CUR : UAC_GET_CUR,
         .wIndex = (feature_unit << 8) | (ctrl_iface_num & 0xff),
         .wLength = 1,
         .data = tmp
@@ -1896,6 +3067,8 @@ esp_err_t uac_host_install(const uac_host_driver_config_t *config)
     UAC_RETURN_ON_INVALID_ARG(config);
     UAC_RETURN_ON_INVALID_ARG(config->callback);
 
+    UAC_RETURN_ON_FALSE(!(config->shared_client && config->create_background_task), ESP_ERR_INVALID_ARG,
+                        "Background task can't be created with shared client");
     if (config->create_background_task) {
         UAC_RETURN_ON_FALSE(config->stack_size != 0, ESP_ERR_INVALID_ARG, "Wrong stack size value");
         UAC_RETURN_ON_FALSE(config->task_priority != 0, ESP_ERR_INVALID_ARG, "Wrong task priority value");
@@ -1917,7 +3090,20 @@ esp_err_t uac_host_install(const uac_host_driver_config_t *config)
         .async.callback_arg = NULL,
         .max_num_event_msg = 16,
     };
-    UAC_GOTO_ON_ERROR(usb_host_client_register(&client_config, &driver->client_handle), "Unable to register USB Host client");
+    if (config->shared_client) {
+        const usb_host_shared_client_driver_config_t shared_config = {
+            .event_cb = client_event_cb,
+            .probe_cb = client_probe_cb,
+            .match_table = uac_match_table,
+            .match_count = sizeof(uac_match_table) / sizeof(uac_match_table[0]),
+            .step_cb = uac_host_shared_client_step,
+            .arg = NULL,
+        };
+        UAC_GOTO_ON_ERROR(usb_host_shared_client_add_driver(&shared_config, &driver->shared_driver, &driver->client_handle),
+                          "Unable to add driver to USB Host shared client");
+    } else {
+        UAC_GOTO_ON_ERROR(usb_host_client_register(&client_config, &driver->client_handle), "Unable to register USB Host client");
+    }
 
     UAC_ENTER_CRITICAL();
     s_uac_driver = driver;
@@ -1935,7 +3121,9 @@ esp_err_t uac_host_install(const uac_host_driver_config_t *config)
 
 fail:
     s_uac_driver = NULL;
-    if (driver->client_handle) {
+    if (driver->shared_driver) {
+        usb_host_shared_client_remove_driver(driver->shared_driver);
+    } else if (driver->client_handle) {
         usb_host_client_deregister(driver->client_handle);
     }
     if (driver->all_events_handled) {
@@ -1959,13 +3147,17 @@ esp_err_t uac_host_uninstall(void)
     s_uac_driver->end_client_event_handling = true;
     UAC_EXIT_CRITICAL();
 
-    if (s_uac_driver->event_handling_started) {
-        ESP_ERROR_CHECK(usb_host_client_unblock(s_uac_driver->client_handle));
-        // In case the event handling started, we must wait until it finishes
-        xSemaphoreTake(s_uac_driver->all_events_handled, portMAX_DELAY);
+    if (s_uac_driver->shared_driver) {
+        ESP_ERROR_CHECK(usb_host_shared_client_remove_driver(s_uac_driver->shared_driver));
+    } else {
+        if (s_uac_driver->event_handling_started) {
+            ESP_ERROR_CHECK(usb_host_client_unblock(s_uac_driver->client_handle));
+            // In case the event handling started, we must wait until it finishes
+            xSemaphoreTake(s_uac_driver->all_events_handled, portMAX_DELAY);
+        }
+        ESP_ERROR_CHECK(usb_host_client_deregister(s_uac_driver->client_handle));
     }
     vSemaphoreDelete(s_uac_driver->all_events_handled);
-    ESP_ERROR_CHECK(usb_host_client_deregister(s_uac_driver->client_handle));
     free(s_uac_driver);
     s_uac_driver = NULL;
     return ESP_OK;
@@ -1998,7 +3190,7 @@ esp_err_t uac_host_device_open(const uac_host_device_config_t *config, uac_host_
     bool new_device = false;
     usb_device_handle_t dev_hdl = NULL;
     if (!uac_device) {
-        UAC_GOTO_ON_ERROR(usb_host_device_open(s_uac_driver->client_handle, config->addr, &dev_hdl), "Unable to open USB device");
+        UAC_GOTO_ON_ERROR(usb_host_shared_client_device_open(s_uac_driver->client_handle, config->addr, &dev_hdl), "Unable to open USB device");
         ESP_LOGD(TAG, "line %d, Open Device addr %d", __LINE__, config->addr);
         const usb_config_desc_t *config_desc;
         UAC_GOTO_ON_ERROR(usb_host_get_active_config_descriptor(dev_hdl, &config_desc), "Unable to get active config descriptor");
@@ -2014,7 +3206,12 @@ esp_err_t uac_host_device_open(const uac_host_device_config_t *config, uac_host_
     uac_iface->user_cb = config->callback;
     uac_iface->user_cb_arg = config->callback_arg;
     // create a ringbuffer for the incoming/outgoing data
-    uac_iface->ringbuf = xRingbufferCreate(config->buffer_size, RINGBUF_TYPE_BYTEBUF);
+    // URBs of the largest alternate setting are read from it with a single memcpy
+    uint16_t ep_mps_max = 0;
+    for (int i = 0; i < uac_iface->dev_info.iface_alt_num; i++) {
+        ep_mps_max = MAX(ep_mps_max, uac_iface->iface_alt[i].ep_mps);
+    }
+    uac_iface->ringbuf = _ring_buffer_create(config->buffer_size, ep_mps_max * CONFIG_UAC_NUM_PACKETS_PER_URB);
     UAC_GOTO_ON_FALSE(uac_iface->ringbuf, ESP_ERR_NO_MEM, "Unable to create ringbuffer");
     uac_iface->ringbuf_size = config->buffer_size;
     // if the threshold is not set, set it to 25% of the buffer size
@@ -2025,28 +3222,21 @@ esp_err_t uac_host_device_open(const uac_host_device_config_t *config, uac_host_
     uac_device->opened_cnt++;
     UAC_EXIT_CRITICAL();
 
-    // Get the current volume range if the device supports volume control
-    if (uac_iface->iface_alt[uac_iface->cur_alt].feature_unit && uac_iface->iface_alt[uac_iface->cur_alt].vol_ch_map) {
-        ret = uac_cs_request_get_volume_range(uac_iface, &uac_iface->vol_min_db, &uac_iface->vol_max_db, &uac_iface->vol_res_db);
-        if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to get volume range");
-        }
-    }
-
+    // the volume range is read from the device when it is needed first
     return ESP_OK;
 
 fail:
     if (uac_iface) {
+        if (uac_iface->ringbuf) {
+            _ring_buffer_delete(uac_iface->ringbuf);
+        }
         uac_host_interface_delete(uac_iface);
     }
     if (new_device) {
         _uac_host_device_delete(uac_device);
     }
     if (dev_hdl) {
-        usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
-    }
-    if (uac_iface->ringbuf) {
-        vRingbufferDelete(uac_iface->ringbuf);
+        usb_host_shared_client_device_close(s_uac_driver->client_handle, dev_hdl);
     }
     return ret;
 }
@@ -2085,14 +3275,14 @@ esp_err_t uac_host_device_open_with_vid_pid(uint16_t vid, uint16_t pid, const ua
             ESP_LOGD(TAG, "Found Device VID 0x%04X, PID 0x%04X", vid, pid);
             return uac_host_device_open(&config_copy, uac_dev_handle);
         } else {
-            UAC_RETURN_ON_ERROR(usb_host_device_open(s_uac_driver->client_handle, dev_addr_list[i], &dev_hdl), "Unable to open USB device");
+            UAC_RETURN_ON_ERROR(usb_host_shared_client_device_open(s_uac_driver->client_handle, dev_addr_list[i], &dev_hdl), "Unable to open USB device");
             UAC_RETURN_ON_ERROR(usb_host_get_device_descriptor(dev_hdl, &dev_desc), "Unable to get device descriptor");
             ESP_LOGD(TAG, "Found Device VID 0x%04X, PID 0x%04X", dev_desc->idVendor, dev_desc->idProduct);
             if (dev_desc->idVendor == vid && dev_desc->idProduct == pid) {
-                usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
+                usb_host_shared_client_device_close(s_uac_driver->client_handle, dev_hdl);
                 return uac_host_device_open(&config_copy, uac_dev_handle);
             }
-            usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
+            usb_host_shared_client_device_close(s_uac_driver->client_handle, dev_hdl);
         }
     }
 
@@ -2125,7 +3315,7 @@ esp_err_t uac_host_device_close(uac_host_device_handle_t uac_dev_handle)
     UAC_ENTER_CRITICAL();
     if (--uac_iface->parent->opened_cnt == 0) {
         UAC_EXIT_CRITICAL();
-        UAC_GOTO_ON_ERROR(usb_host_device_close(s_uac_driver->client_handle, uac_iface->parent->dev_hdl), "Unable to close USB device");
+        UAC_GOTO_ON_ERROR(usb_host_shared_client_device_close(s_uac_driver->client_handle, uac_iface->parent->dev_hdl), "Unable to close USB device");
         ESP_LOGD(TAG, "line %d, Close Device addr %d", __LINE__, uac_iface->parent->addr);
         UAC_GOTO_ON_ERROR(_uac_host_device_delete(uac_iface->parent), "Unable to delete UAC device");
         uac_iface->parent = NULL;
@@ -2136,17 +3326,11 @@ esp_err_t uac_host_device_close(uac_host_device_handle_t uac_dev_handle)
     // To delete the ringbuffer safely
     // We should unblock the task that is waiting for the ringbuffer
     if (uac_iface->ringbuf) {
-        if (uac_iface->dev_info.type == UAC_STREAM_RX) {
-            // Unblock the task that is waiting for read from the ringbuffer
-            uint8_t dummy = 0;
-            xRingbufferSend(uac_iface->ringbuf, &dummy, sizeof(dummy), 0);
-        } else {
-            // Unblock the task that is waiting for the ringbuffer
-            _ring_buffer_flush(uac_iface->ringbuf);
-        }
+        // Unblock the task that is waiting for read from or write to the ringbuffer
+        _ring_buffer_close(uac_iface->ringbuf);
         // Unblock the low priority tasks waiting for the ringbuffer before deleting it
         vTaskDelay(pdMS_TO_TICKS(CONFIG_UAC_RINGBUF_SAFE_DELETE_WAITING_MS));
-        vRingbufferDelete(uac_iface->ringbuf);
+        _ring_buffer_delete(uac_iface->ringbuf);
         uac_iface->ringbuf = NULL;
     }
 
@@ -2165,8 +3349,13 @@ fail:
 esp_err_t uac_host_handle_events(uint32_t timeout)
 {
     UAC_RETURN_ON_FALSE(s_uac_driver != NULL, ESP_ERR_INVALID_STATE, "UAC Driver is not installed");
+    if (s_uac_driver->shared_driver) {
+        return usb_host_shared_client_handle_events(timeout);
+    }
     s_uac_driver->event_handling_started = true;
     esp_err_t ret = usb_host_client_handle_events(s_uac_driver->client_handle, timeout);
+    // user callbacks run after all completed transfers are resubmitted
+    uac_host_interface_events_dispatch();
     UAC_ENTER_CRITICAL();
     if (s_uac_driver->end_client_event_handling) {
         UAC_EXIT_CRITICAL();
@@ -2192,6 +3381,7 @@ esp_err_t uac_host_printf_device_param(uac_host_device_handle_t uac_dev_handle)
 {
     uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
     UAC_RETURN_ON_FALSE(iface, ESP_ERR_INVALID_STATE, "UAC Interface not found");
+#ifndef CONFIG_UAC_HOST_MINIMAL
     uac_host_dev_info_t dev_info;
     UAC_RETURN_ON_ERROR(uac_host_get_device_info(uac_dev_handle, &dev_info), "Unable to get UAC device params");
     printf("find UAC 1.0 %s device\n", dev_info.type == UAC_STREAM_TX ? "Speaker" : "Microphone");
@@ -2212,9 +3402,252 @@ esp_err_t uac_host_printf_device_param(uac_host_device_handle_t uac_dev_handle)
             printf("<= \t%" PRIu32 "\n", iface_alt_params.sample_freq_upper);
         }
     }
+#endif // CONFIG_UAC_HOST_MINIMAL
+    return ESP_OK;
+}
+
+/**
+ * @brief Read from the RX ringbuf, converting to the application format while copying
+ *
+ * Whole frames are converted from the ringbuf memory directly. A frame split by the end of the buffer is copied once.
+ */
+static esp_err_t stream_rx_read_convert(uac_iface_t *iface, uint8_t *data, uint32_t size, uint32_t *bytes_read, uint32_t timeout)
+{
+    const size_t app_frame_bytes = iface->app_format.bytes * iface->app_format.channels;
+    const size_t dev_frame_bytes = iface->sample_bytes;
+    const size_t frames_max = size / app_frame_bytes;
+    const size_t app_plane = frames_max * iface->app_format.bytes;
+    const size_t app_stride = pcm_frame_stride(&iface->app_format);
+    size_t frames_done = 0;
+    *bytes_read = 0;
+
+    while (frames_done < frames_max) {
+        const uint8_t *src = NULL;
+        size_t len = 0;
+        // block for the first data only, then take what is buffered
+        if (_ring_buffer_read_acquire(iface->ringbuf, &src, &len, frames_done ? 0 : timeout) != ESP_OK) {
+            if (frames_done) {
+                break;
+            }
+            ESP_LOGD(TAG, "RX Ringbuffer read failed");
+            return ESP_FAIL;
+        }
+        size_t frames = MIN(len / dev_frame_bytes, frames_max - frames_done);
+        if (frames) {
+            pcm_convert(src, &iface->dev_format, 0, data + frames_done * app_stride, &iface->app_format, app_plane, frames);
+            _ring_buffer_read_release(iface->ringbuf, frames * dev_frame_bytes);
+        } else {
+            uint8_t frame[UAC_CONVERT_CHANNELS_MAX * sizeof(int32_t)];
+            size_t frame_len = 0;
+            if (_ring_buffer_get_len(iface->ringbuf) < dev_frame_bytes) {
+                break;
+            }
+            _ring_buffer_pop(iface->ringbuf, frame, dev_frame_bytes, &frame_len, 0);
+            frames = 1;
+            pcm_convert(frame, &iface->dev_format, 0, data + frames_done * app_stride, &iface->app_format, app_plane, frames);
+        }
+        frames_done += frames;
+    }
+    *bytes_read = frames_done * app_frame_bytes;
     return ESP_OK;
 }
 
+/**
+ * @brief Release the input taken by the resampler from the RX ringbuf
+ */
+static void stream_rx_resample_release(uac_iface_t *iface)
+{
+    uac_resampler_t *rs = iface->resampler;
+    if (rs->src_used) {
+        _ring_buffer_read_release(iface->ringbuf, rs->src_used);
+    }
+    rs->src_len = 0;
+    rs->src_used = 0;
+}
+
+/**
+ * @brief Get the next input frame of the resampler from the RX ringbuf
+ *
+ * Frames are taken from the acquired ringbuf region, which is released when it is used up. A frame split by the end
+ * of the buffer is copied once.
+ *
+ * @return Pointer to the frame, NULL if no frame was buffered until timeout
+ */
+static const uint8_t *stream_rx_resample_input(uac_iface_t *iface, TickType_t timeout)
+{
+    uac_resampler_t *rs = iface->resampler;
+    const size_t frame_bytes = iface->sample_bytes;
+    if (rs->src_used + frame_bytes > rs->src_len) {
+        stream_rx_resample_release(iface);
+        if (_ring_buffer_read_acquire(iface->ringbuf, &rs->src, &rs->src_len, timeout) != ESP_OK) {
+            return NULL;
+        }
+        if (rs->src_len < frame_bytes) {
+            size_t frame_len = 0;
+            rs->src_len = 0;
+            if (_ring_buffer_get_len(iface->ringbuf) < frame_bytes ||
+                    _ring_buffer_pop(iface->ringbuf, rs->frame, frame_bytes, &frame_len, 0) != ESP_OK) {
+                return NULL;
+            }
+            return rs->frame;
+        }
+    }
+    const uint8_t *frame = rs->src + rs->src_used;
+    rs->src_used += frame_bytes;
+    return frame;
+}
+
+/**
+ * @brief Update the resampling ratio from the RX ringbuf level
+ *
+ * The level is low-pass filtered, as it changes in steps of one URB. The PI controller keeps it at half of the buffer:
+ * a fuller buffer means the device clock is faster than the reader, so more input samples are taken per output sample.
+ */
+static void stream_rx_resample_control(uac_iface_t *iface)
+{
+    uac_resampler_t *rs = iface->resampler;
+    const float freq = (float)iface->iface_alt[iface->cur_alt].cur_sampling_freq;
+    const float level = (float)(_ring_buffer_get_len(iface->ringbuf) / iface->sample_bytes);
+    const float target = (float)(iface->ringbuf_size / 2 / iface->sample_bytes);
+    const float dt = rs->frames_out / freq;
+    rs->frames_out = 0;
+
+    if (rs->level_avg < 0.0f) {
+        rs->level_avg = level;
+    } else {
+        rs->level_avg += (level - rs->level_avg) * dt / (dt + UAC_RESAMPLE_LEVEL_FILTER_S);
+    }
+    const float error = rs->level_avg - target;
+    // integral time of 4 time constants keeps the loop critically damped
+    float ppm = 1e6f * (error + rs->integral / (4.0f * UAC_RESAMPLE_TIME_CONSTANT_S)) / (freq * UAC_RESAMPLE_TIME_CONSTANT_S);
+    if (fabsf(ppm) < UAC_RESAMPLE_PPM_MAX) {
+        rs->integral += error * dt;
+    } else {
+        ppm = copysignf(UAC_RESAMPLE_PPM_MAX, ppm); // no integration while limited
+    }
+    rs->step = (uint64_t)((int64_t)UAC_RESAMPLE_ONE + (int64_t)(ppm * (UAC_RESAMPLE_ONE / 1e6f)));
+    UAC_ENTER_CRITICAL();
+    iface->stats.resample_ppm = (int32_t)ppm;
+    UAC_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Read from the RX ringbuf through the resampler, converting to the application format
+ *
+ * Blocks of frames are resampled to left justified 32-bit samples and converted to the application format.
+ * Input frames are read from the ringbuf memory directly.
+ */
+static esp_err_t stream_rx_read_resample(uac_iface_t *iface, uint8_t *data, uint32_t size, uint32_t *bytes_read, uint32_t timeout)
+{
+    uac_resampler_t *rs = iface->resampler;
+    const uac_pcm_format_t block_format = {
+        .channels = iface->dev_format.channels,
+        .bytes = sizeof(int32_t),
+    };
+    const uint8_t channels = iface->dev_format.channels;
+    const size_t app_frame_bytes = iface->app_format.bytes * iface->app_format.channels;
+    const size_t frames_max = size / app_frame_bytes;
+    const size_t app_plane = frames_max * iface->app_format.bytes;
+    const size_t app_stride = pcm_frame_stride(&iface->app_format);
+    size_t frames_done = 0;
+    bool starved = false;
+    *bytes_read = 0;
+
+    // the first read after start or resume waits until the buffer is half full, the control loop starts from there
+    if (rs->level_avg < 0.0f && !_ring_buffer_wait(iface->ringbuf, _ring_buffer_has_level, iface->ringbuf_size / 2,
+            &iface->ringbuf->reader_waiting, iface->ringbuf->data_sem, timeout)) {
+        ESP_LOGD(TAG, "RX Ringbuffer not filled for resampling");
+        return ESP_FAIL;
+    }
+    stream_rx_resample_control(iface);
+    while (frames_done < frames_max && !starved) {
+        const size_t block_frames = MIN(UAC_RESAMPLE_BLOCK_FRAMES, frames_max - frames_done);
+        size_t frames = 0;
+        for (; frames < block_frames; frames++) {
+            for (; rs->pos >= UAC_RESAMPLE_ONE; rs->pos -= UAC_RESAMPLE_ONE) {
+                // block for the first data only, then take what is buffered
+                const uint8_t *frame = stream_rx_resample_input(iface, (frames_done || frames) ? 0 : timeout);
+                if (!frame) {
+                    starved = true;
+                    break;
+                }
+                stream_resampler_push(rs, frame, &iface->dev_format);
+            }
+            if (starved) {
+                break;
+            }
+            stream_resampler_frame(rs, channels, &rs->block[frames * channels]);
+            rs->pos += rs->step;
+        }
+        if (frames) {
+            pcm_convert((const uint8_t *)rs->block, &block_format, 0, data + frames_done * app_stride, &iface->app_format, app_plane, frames);
+        }
+        frames_done += frames;
+    }
+    stream_rx_resample_release(iface);
+    rs->frames_out += frames_done;
+    *bytes_read = frames_done * app_frame_bytes;
+    if (!frames_done) {
+        ESP_LOGD(TAG, "RX Ringbuffer read failed");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Write to the TX ringbuf, converting to the stream format while copying
+ *
+ * Frames are converted into the ringbuf memory directly. A frame split by the end of the buffer is copied once.
+ */
+static esp_err_t stream_tx_write_convert(uac_iface_t *iface, const uint8_t *data, uint32_t size, uint32_t timeout)
+{
+    const size_t app_frame_bytes = iface->app_format.bytes * iface->app_format.channels;
+    const size_t dev_frame_bytes = iface->sample_bytes;
+    const size_t frames_total = size / app_frame_bytes;
+    const size_t app_plane = frames_total * iface->app_format.bytes;
+    const size_t app_stride = pcm_frame_stride(&iface->app_format);
+    TickType_t ticks_to_wait = timeout;
+    TimeOut_t time_out;
+    vTaskSetTimeOutState(&time_out);
+
+    for (size_t frames_done = 0; frames_done < frames_total;) {
+        if (frames_done && xTaskCheckForTimeOut(&time_out, &ticks_to_wait) != pdFALSE) {
+            ticks_to_wait = 0;
+        }
+        uint8_t *dst = NULL;
+        size_t len = 0;
+        if (_ring_buffer_write_acquire(iface->ringbuf, &dst, &len, ticks_to_wait) != ESP_OK) {
+            ESP_LOGD(TAG, "TX Ringbuffer write failed");
+            return ESP_FAIL;
+        }
+        size_t frames = MIN(len / dev_frame_bytes, frames_total - frames_done);
+        if (frames) {
+            pcm_convert(data + frames_done * app_stride, &iface->app_format, app_plane, dst, &iface->dev_format, 0, frames);
+            _ring_buffer_write_commit(iface->ringbuf, frames * dev_frame_bytes);
+        } else {
+            uint8_t frame[UAC_CONVERT_CHANNELS_MAX * sizeof(int32_t)];
+            frames = 1;
+            pcm_convert(data + frames_done * app_stride, &iface->app_format, app_plane, frame, &iface->dev_format, 0, frames);
+            if (_ring_buffer_push(iface->ringbuf, frame, dev_frame_bytes, ticks_to_wait) != ESP_OK) {
+                return ESP_FAIL;
+            }
+        }
+        frames_done += frames;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Check if a stream configuration results in the same interface setup and transfers
+ */
+static bool stream_config_equal(const uac_host_stream_config_t *a, const uac_host_stream_config_t *b)
+{
+    return a->channels == b->channels && a->bit_resolution == b->bit_resolution && a->sample_freq == b->sample_freq &&
+           a->flags == b->flags && a->urb_num == b->urb_num && a->packets_per_urb == b->packets_per_urb &&
+           a->tx_fill_cb == b->tx_fill_cb && a->tx_fill_cb_arg == b->tx_fill_cb_arg &&
+           a->app_channels == b->app_channels && a->app_bit_resolution == b->app_bit_resolution;
+}
+
 // ------------------------ USB UAC Host driver API ----------------------------
 
 esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const uac_host_stream_config_t *stream_config)
@@ -2226,16 +3659,42 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
     UAC_RETURN_ON_FALSE(stream_config->bit_resolution, ESP_ERR_INVALID_ARG, "Invalid bit resolution");
     UAC_RETURN_ON_FALSE(stream_config->channels, ESP_ERR_INVALID_ARG, "Invalid number of channels");
     UAC_RETURN_ON_FALSE(stream_config->sample_freq, ESP_ERR_INVALID_ARG, "Invalid sample frequency");
+    UAC_RETURN_ON_FALSE(!stream_config->tx_fill_cb || iface->dev_info.type == UAC_STREAM_TX, ESP_ERR_INVALID_ARG, "TX fill callback only for TX stream");
+    const uint8_t app_channels = stream_config->app_channels ? stream_config->app_channels : stream_config->channels;
+    const uint8_t app_bit_resolution = stream_config->app_bit_resolution ? stream_config->app_bit_resolution : stream_config->bit_resolution;
+    const bool convert = app_channels != stream_config->channels || app_bit_resolution != stream_config->bit_resolution ||
+                         (stream_config->flags & FLAG_STREAM_APP_PLANAR);
+    const bool resample = stream_config->flags & FLAG_STREAM_RX_RESAMPLE;
+    UAC_RETURN_ON_FALSE(!resample || iface->dev_info.type == UAC_STREAM_RX, ESP_ERR_INVALID_ARG, "Resampling only for RX stream");
+    if (convert || resample) {
+        UAC_RETURN_ON_FALSE(app_bit_resolution % 8 == 0 && app_bit_resolution <= 32 && stream_config->bit_resolution <= 32,
+                            ESP_ERR_NOT_SUPPORTED, "Conversion only between 8, 16, 24 and 32 bit");
+        UAC_RETURN_ON_FALSE(app_channels <= UAC_CONVERT_CHANNELS_MAX && stream_config->channels <= UAC_CONVERT_CHANNELS_MAX,
+                            ESP_ERR_NOT_SUPPORTED, "Too many channels for conversion");
+    }
 
     // get the mutex first to change the device/interface state
     UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
-    if (UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state) {
+    const bool prepared = iface->flags & FLAG_INTERFACE_STOPPED_PREPARED;
+    if (!prepared && (UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state)) {
         uac_host_interface_unlock(iface);
         return ESP_OK;
     }
 
     esp_err_t ret = ESP_OK;
     bool iface_claimed = false;
+    if (prepared) {
+        iface->flags &= ~FLAG_INTERFACE_STOPPED_PREPARED;
+        if (stream_config_equal(&iface->stream_config, stream_config)) {
+            // Interface is claimed and transfers are allocated for this configuration, only select the alternate setting
+            if (!(iface->flags & FLAG_STREAM_SUSPEND_AFTER_START)) {
+                UAC_GOTO_ON_ERROR(uac_host_interface_resume(iface), "Unable to enable UAC Interface");
+            }
+            uac_host_interface_unlock(iface);
+            return ESP_OK;
+        }
+        UAC_GOTO_ON_ERROR(uac_host_interface_release_and_free_transfer(iface), "Unable to release UAC Interface");
+    }
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_IDLE == iface->state), ESP_ERR_INVALID_STATE, "Interface wrong state");
 
     // check if any alt setting meets the channels, sample frequency and bit resolution requirements
@@ -2264,17 +3723,76 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
 
     UAC_GOTO_ON_FALSE(iface->cur_alt != UINT8_MAX, ESP_ERR_NOT_FOUND, "No suitable alt setting found");
 
+    // packets are sent once per endpoint service interval: (micro)frames for Full Speed (High Speed)
+    usb_device_info_t dev_info;
+    UAC_GOTO_ON_ERROR(usb_host_device_info(iface->parent->dev_hdl, &dev_info), "Unable to get USB device info");
+    const uac_iface_alt_t *iface_alt = &iface->iface_alt[iface->cur_alt];
+    const uint8_t interval = iface_alt->interval ? MIN(iface_alt->interval, 16) : 1;
+    // High Speed audio endpoints are serviced at least once per frame: bInterval 1..4, i.e. 1 to 8 microframes
+    UAC_GOTO_ON_FALSE((dev_info.speed != USB_SPEED_HIGH) || (interval <= 4), ESP_ERR_NOT_SUPPORTED, "Endpoint interval not supported");
+    const uint32_t frames_per_packet = (dev_info.speed == USB_SPEED_HIGH) ? (1UL << (interval - 1)) : 1;
+    iface->packet_period_us = ((dev_info.speed == USB_SPEED_HIGH) ? 125 : 1000) * frames_per_packet;
+    iface->speed = dev_info.speed;
+    // samples are stored in subslots, which may be wider than the bit resolution (e.g. 24 bit in 4 bytes)
+    const uint8_t subslot_size = iface_alt->subslot_size;
+    UAC_GOTO_ON_FALSE(subslot_size && subslot_size <= 4, ESP_ERR_NOT_SUPPORTED, "Subslot size not supported");
+
     // enqueue multiple transfers to make sure the data is not lost
-    iface->xfer_num = CONFIG_UAC_NUM_ISOC_URBS;
-    iface->packet_num = CONFIG_UAC_NUM_PACKETS_PER_URB;
-    iface->packet_size = iface->iface_alt[iface->cur_alt].cur_sampling_freq * stream_config->channels * stream_config->bit_resolution / 8 / 1000;
+    iface->xfer_num = stream_config->urb_num ? stream_config->urb_num : CONFIG_UAC_NUM_ISOC_URBS;
+    iface->packet_num = stream_config->packets_per_urb ? stream_config->packets_per_urb : CONFIG_UAC_NUM_PACKETS_PER_URB;
+    // samples per packet as an exact fraction, e.g. 44100 Hz in 1 ms packets is 441/10
+    uint64_t samples_num = (uint64_t)iface_alt->cur_sampling_freq * iface->packet_period_us;
+    uint64_t samples_den = 1000000;
+    uint64_t gcd = samples_den;
+    for (uint64_t rem = samples_num % gcd, prev; rem; rem = prev % rem) {
+        prev = gcd;
+        gcd = rem;
+    }
+    samples_num /= gcd;
+    samples_den /= gcd;
+    // packets carry whole samples, the largest packet has one sample more if the rate is not an integer
+    iface->packet_size = (uint32_t)((samples_num + samples_den - 1) / samples_den) * stream_config->channels * subslot_size;
+    iface->flags &= ~((1 << INTERFACE_FLAGS_OFFSET) - 1);
     iface->flags |= stream_config->flags;
-    // if the packet size is not an integer, we need to add one more byte
-    if (iface->iface_alt[iface->cur_alt].cur_sampling_freq * stream_config->channels * stream_config->bit_resolution / 8 % 1000) {
-        ESP_LOGD(TAG, "packet_size %" PRIu32 " is not an integer, add one more byte", iface->packet_size);
-        iface->packet_size++;
+    iface->stream_config = *stream_config;
+    iface->sample_bytes = stream_config->channels * subslot_size;
+    iface->tx_fill_cb = stream_config->tx_fill_cb;
+    iface->tx_fill_cb_arg = stream_config->tx_fill_cb_arg;
+    iface->convert = convert;
+    iface->dev_format = (uac_pcm_format_t) {
+        .channels = stream_config->channels,
+        .bytes = subslot_size,
+        .is_unsigned = (iface_alt->dev_alt_param.format == UAC_TYPE_I_PCM8),
+        .planar = false,
+    };
+    // 8-bit application data is unsigned like UAC_TYPE_I_PCM8
+    iface->app_format = (uac_pcm_format_t) {
+        .channels = app_channels,
+        .bytes = app_bit_resolution / 8,
+        .is_unsigned = (app_bit_resolution == 8),
+        .planar = (stream_config->flags & FLAG_STREAM_APP_PLANAR),
+    };
+    if (samples_den > 1) {
+        ESP_LOGD(TAG, "%" PRIu64 "/%" PRIu64 " samples per packet, packets up to %" PRIu32 " bytes", samples_num, samples_den, iface->packet_size);
+    }
+    UAC_GOTO_ON_FALSE(iface->packet_size <= iface_alt->ep_mps, ESP_ERR_NOT_SUPPORTED, "Packet size exceeds endpoint MPS");
+    UAC_GOTO_ON_FALSE(iface->packet_size * iface->packet_num <= iface->ringbuf_size, ESP_ERR_INVALID_SIZE, "URB larger than audio buffer");
+    if (resample) {
+        iface->resampler = malloc(sizeof(uac_resampler_t));
+        UAC_GOTO_ON_FALSE(iface->resampler, ESP_ERR_NO_MEM, "Unable to allocate resampler");
+        stream_resampler_coef_init(iface->resampler);
+        stream_resampler_reset(iface->resampler);
+    }
+    ESP_LOGD(TAG, "%d URBs of %d packets, %"PRIu32" us per URB", iface->xfer_num, iface->packet_num, iface->packet_num * iface->packet_period_us);
+
+    // TX packets carry whole samples at the nominal rate, or at the rate requested by the feedback endpoint
+    iface->feedback.frames_per_packet = frames_per_packet;
+    iface->feedback.nominal = (uint32_t)(((uint64_t)iface_alt->cur_sampling_freq << 16) * iface->packet_period_us / 1000000);
+    iface->feedback.nominal_num = (uint32_t)samples_num;
+    iface->feedback.nominal_den = (uint32_t)samples_den;
+    if (iface_alt->fb_ep_addr) {
+        ESP_LOGI(TAG, "Asynchronous stream, feedback EP %02X", iface_alt->fb_ep_addr);
     }
-    assert(iface->packet_size <= iface->iface_alt[iface->cur_alt].ep_mps);
 
     // Claim Interface and prepare transfer
     UAC_GOTO_ON_ERROR(uac_host_interface_claim_and_prepare_transfer(iface), "Unable to claim Interface");
@@ -2287,9 +3805,11 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
     return ESP_OK;
 
 fail:
-    if (iface_claimed) {
+    if (iface_claimed || (prepared && UAC_INTERFACE_STATE_READY == iface->state)) {
         uac_host_interface_release_and_free_transfer(iface);
     }
+    free(iface->resampler);
+    iface->resampler = NULL;
     uac_host_interface_unlock(iface);
     return ret;
 }
@@ -2329,6 +3849,7 @@ esp_err_t uac_host_device_resume(uac_host_device_handle_t uac_dev_handle)
 
     esp_err_t ret = ESP_OK;
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_READY == iface->state), ESP_ERR_INVALID_STATE, "device not ready");
+    UAC_GOTO_ON_FALSE(!(iface->flags & FLAG_INTERFACE_STOPPED_PREPARED), ESP_ERR_INVALID_STATE, "device stopped");
     UAC_GOTO_ON_ERROR(uac_host_interface_resume(iface), "Unable to enable UAC Interface");
 
     uac_host_interface_unlock(iface);
@@ -2351,7 +3872,12 @@ esp_err_t uac_host_device_stop(uac_host_device_handle_t uac_dev_handle)
     }
 
     if (UAC_INTERFACE_STATE_READY == iface->state) {
-        UAC_GOTO_ON_ERROR(uac_host_interface_release_and_free_transfer(iface), "Unable to release UAC Interface");
+        if (iface->flags & FLAG_STREAM_KEEP_PREPARED) {
+            // Keep the interface claimed and transfers allocated for the next start
+            iface->flags |= FLAG_INTERFACE_STOPPED_PREPARED;
+        } else {
+            UAC_GOTO_ON_ERROR(uac_host_interface_release_and_free_transfer(iface), "Unable to release UAC Interface");
+        }
     }
 
     uac_host_interface_unlock(iface);
@@ -2376,11 +3902,16 @@ esp_err_t uac_host_device_read(uac_host_device_handle_t uac_dev_handle, uint8_t
     }
     uac_host_interface_unlock(iface);
 
-    size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-    if (data_len > size) {
-        data_len = size;
+    if (iface->resampler) {
+        return stream_rx_read_resample(iface, data, size, bytes_read, timeout);
     }
-    esp_err_t ret = _ring_buffer_pop(iface->ringbuf, data, data_len, (size_t *)bytes_read, timeout);
+    if (iface->convert) {
+        return stream_rx_read_convert(iface, data, size, bytes_read, timeout);
+    }
+
+    size_t read_len = 0;
+    esp_err_t ret = _ring_buffer_pop(iface->ringbuf, data, size, &read_len, timeout);
+    *bytes_read = read_len;
 
     if (ESP_OK != ret) {
         ESP_LOGD(TAG, "RX Ringbuffer read failed");
@@ -2407,8 +3938,10 @@ esp_err_t uac_host_device_write(uac_host_device_handle_t uac_dev_handle, uint8_t
         return ESP_ERR_INVALID_STATE;
     }
     uac_host_interface_unlock(iface);
+    UAC_RETURN_ON_FALSE(!iface->tx_fill_cb, ESP_ERR_NOT_SUPPORTED, "Stream uses TX fill callback");
 
-    esp_err_t ret = _ring_buffer_push(iface->ringbuf, data, size, timeout);
+    esp_err_t ret = iface->convert ? stream_tx_write_convert(iface, data, size, timeout)
+                    : _ring_buffer_push(iface->ringbuf, data, size, timeout);
 
     if (ESP_OK != ret) {
         ESP_LOGD(TAG, "TX Ringbuffer write failed");
@@ -2416,33 +3949,78 @@ esp_err_t uac_host_device_write(uac_host_device_handle_t uac_dev_handle, uint8_t
     }
 
     // We need to submit the transfer if there is free transfer in the list
-    for (int i = 0; i < iface->xfer_num; i++) {
-        UAC_ENTER_CRITICAL();
-        if (iface->free_xfer_list[i]) {
-            size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-            if (data_len == 0) {
-                goto exit_critical;
-            }
-            // if interface state changed to inactive during blocking write
-            // we need to return invalid state to safely exit the write function
-            if (UAC_INTERFACE_STATE_ACTIVE != iface->state) {
-                ret = ESP_ERR_INVALID_STATE;
-                goto exit_critical;
-            }
-            iface->xfer_list[i] = iface->free_xfer_list[i];
-            iface->free_xfer_list[i] = NULL;
-            iface->xfer_list[i]->status = USB_TRANSFER_STATUS_COMPLETED;
-            UAC_EXIT_CRITICAL();
-            stream_tx_xfer_submit(iface->xfer_list[i]);
-            UAC_ENTER_CRITICAL();
-        }
-exit_critical:
-        UAC_EXIT_CRITICAL();
+    return stream_tx_xfer_submit_free(iface);
+}
+
+esp_err_t uac_host_device_read_acquire(uac_host_device_handle_t uac_dev_handle, const uint8_t **data, uint32_t *size, uint32_t timeout)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(data);
+    UAC_RETURN_ON_INVALID_ARG(size);
+    *size = 0;
+    esp_err_t ret = uac_host_interface_check_streaming(iface, UAC_STREAM_RX);
+    if (ESP_OK != ret) {
+        return ret;
+    }
+    UAC_RETURN_ON_FALSE(!iface->resampler, ESP_ERR_NOT_SUPPORTED, "Stream is resampled");
+
+    size_t len = 0;
+    ret = _ring_buffer_read_acquire(iface->ringbuf, data, &len, timeout);
+    *size = len;
+    if (ESP_OK != ret) {
+        ESP_LOGD(TAG, "RX Ringbuffer acquire failed");
+    }
+    return ret;
+}
+
+esp_err_t uac_host_device_read_release(uac_host_device_handle_t uac_dev_handle, uint32_t size)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    esp_err_t ret = uac_host_interface_check_streaming(iface, UAC_STREAM_RX);
+    if (ESP_OK != ret) {
+        return ret;
+    }
+    return _ring_buffer_read_release(iface->ringbuf, size);
+}
+
+esp_err_t uac_host_device_write_acquire(uac_host_device_handle_t uac_dev_handle, uint8_t **data, uint32_t *size, uint32_t timeout)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(data);
+    UAC_RETURN_ON_INVALID_ARG(size);
+    *size = 0;
+    esp_err_t ret = uac_host_interface_check_streaming(iface, UAC_STREAM_TX);
+    if (ESP_OK != ret) {
+        return ret;
     }
+    UAC_RETURN_ON_FALSE(!iface->tx_fill_cb, ESP_ERR_NOT_SUPPORTED, "Stream uses TX fill callback");
 
+    size_t len = 0;
+    ret = _ring_buffer_write_acquire(iface->ringbuf, data, &len, timeout);
+    *size = len;
+    if (ESP_OK != ret) {
+        ESP_LOGD(TAG, "TX Ringbuffer acquire failed");
+    }
     return ret;
 }
 
+esp_err_t uac_host_device_write_commit(uac_host_device_handle_t uac_dev_handle, uint32_t size)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    esp_err_t ret = uac_host_interface_check_streaming(iface, UAC_STREAM_TX);
+    if (ESP_OK != ret) {
+        return ret;
+    }
+    UAC_RETURN_ON_FALSE(!iface->tx_fill_cb, ESP_ERR_NOT_SUPPORTED, "Stream uses TX fill callback");
+    UAC_RETURN_ON_ERROR(_ring_buffer_write_commit(iface->ringbuf, size), "Commit exceeds acquired region");
+
+    return stream_tx_xfer_submit_free(iface);
+}
+
 esp_err_t uac_host_get_device_info(uac_host_device_handle_t uac_dev_handle, uac_host_dev_info_t *uac_dev_info)
 {
     uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
@@ -2452,6 +4030,26 @@ esp_err_t uac_host_get_device_info(uac_host_device_handle_t uac_dev_handle, uac_
     return ESP_OK;
 }
 
+esp_err_t uac_host_device_get_stats(uac_host_device_handle_t uac_dev_handle, uac_host_stream_stats_t *stats)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(stats);
+
+    UAC_ENTER_CRITICAL();
+    *stats = iface->stats;
+    const uint64_t samples_after_first = iface->samples_after_first;
+    UAC_EXIT_CRITICAL();
+
+    const int64_t elapsed_us = stats->last_xfer_time_us - stats->first_xfer_time_us;
+    if (elapsed_us > 0 && iface->cur_alt < iface->dev_info.iface_alt_num) {
+        const double nominal = iface->iface_alt[iface->cur_alt].cur_sampling_freq;
+        const double rate = (double)samples_after_first * 1000000.0 / elapsed_us;
+        stats->drift_ppm = (int32_t)((rate - nominal) * 1000000.0 / nominal);
+    }
+    return ESP_OK;
+}
+
 esp_err_t uac_host_device_set_mute(uac_host_device_handle_t uac_dev_handle, bool mute)
 {
     uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
@@ -2502,6 +4100,7 @@ esp_err_t uac_host_device_set_volume(uac_host_device_handle_t uac_dev_handle, ui
     UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state),
                       ESP_ERR_INVALID_STATE, "device not ready or active");
+    UAC_GOTO_ON_ERROR(uac_host_interface_volume_range_update(iface), "Volume range unknown");
 
     // Calculate target volume in float to avoid the int16_t calculation overflow
     float volume_db_f = _volume_db_i16_2_f(iface->vol_min_db) + (_volume_db_i16_2_f(iface->vol_max_db) - _volume_db_i16_2_f(iface->vol_min_db)) * (float)volume / 100.0f;
@@ -2545,6 +4144,7 @@ esp_err_t uac_host_device_get_volume(uac_host_device_handle_t uac_dev_handle, ui
     // Otherwise, get the volume from the device
     // Get volume range, calculate in dB float
     int16_t volume_db = 0;
+    UAC_GOTO_ON_ERROR(uac_host_interface_volume_range_update(iface), "Volume range unknown");
     UAC_GOTO_ON_ERROR(uac_cs_request_get_volume(iface, &volume_db), "Unable to get volume");
     const float volume_db_f = _volume_db_i16_2_f(volume_db);
     // Calculate volume in percentage
@@ -2568,6 +4168,7 @@ esp_err_t uac_host_device_set_volume_db(uac_host_device_handle_t uac_dev_handle,
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state),
                       ESP_ERR_INVALID_STATE, "device not ready or active");
     // Check if the volume is within the range
+    UAC_GOTO_ON_ERROR(uac_host_interface_volume_range_update(iface), "Volume range unknown");
     UAC_GOTO_ON_FALSE((volume_db >= iface->vol_min_db && volume_db <= iface->vol_max_db), ESP_ERR_INVALID_ARG, "Invalid volume value");
     UAC_GOTO_ON_ERROR(uac_cs_request_set_volume(iface, volume_db), "Unable to set volume");
     uac_host_interface_unlock(iface);
@@ -2597,3 +4198,129 @@ fail:
     uac_host_interface_unlock(iface);
     return ret;
 }
+
+// ------------------------ USB UAC Host duplex API ----------------------------
+/**
+ * @brief TX fill callback of a duplex stream
+ *
+ * Takes one period of capture from the RX ringbuffer, older capture is dropped so that the delay stays at one period.
+ */
+static uint32_t uac_duplex_tx_fill(uac_host_device_handle_t tx_handle, uint8_t *data, uint32_t size, void *arg)
+{
+    uac_duplex_t *duplex = arg;
+    uac_iface_t *rx_iface = duplex->rx_iface;
+    const uint32_t period = duplex->rx_period_bytes;
+
+    // drop whole periods of older capture
+    size_t level = _ring_buffer_get_len(rx_iface->ringbuf);
+    if (level >= 2 * period) {
+        const size_t drop = (level / period - 1) * period;
+        if (_ring_buffer_read_release(rx_iface->ringbuf, drop) == ESP_OK) {
+            level -= drop;
+        }
+    }
+    size_t rx_len = 0;
+    if (level > 0) {
+        _ring_buffer_pop(rx_iface->ringbuf, duplex->rx_buf, MIN(level - level % rx_iface->sample_bytes, period), &rx_len, 0);
+    }
+    if (rx_len < period) {
+        stream_silence_fill(rx_iface, duplex->rx_buf + rx_len, period - rx_len);
+    }
+
+    // capture still buffered and this period, time since the last capture arrived, and playback queued before this transfer
+    const uint32_t freq = rx_iface->iface_alt[rx_iface->cur_alt].cur_sampling_freq;
+    const uint64_t buffered_samples = (_ring_buffer_get_len(rx_iface->ringbuf) + period) / rx_iface->sample_bytes;
+    const int64_t since_rx_us = rx_iface->stats.packets ? esp_timer_get_time() - rx_iface->stats.last_xfer_time_us : 0;
+    duplex->delay_us = (uint32_t)(buffered_samples * 1000000 / freq + since_rx_us +
+                                  (duplex->tx_iface->xfer_num - 1) * duplex->tx_iface->packet_num * duplex->tx_iface->packet_period_us);
+
+    duplex->callback(duplex->rx_buf, period, data, size, duplex->callback_arg);
+    return size;
+}
+
+esp_err_t uac_host_duplex_start(const uac_host_duplex_config_t *config, uac_host_duplex_handle_t *duplex_handle)
+{
+    UAC_RETURN_ON_INVALID_ARG(config);
+    UAC_RETURN_ON_INVALID_ARG(duplex_handle);
+    UAC_RETURN_ON_INVALID_ARG(config->callback);
+    uac_iface_t *rx_iface = get_iface_by_handle(config->rx_handle);
+    uac_iface_t *tx_iface = get_iface_by_handle(config->tx_handle);
+    UAC_RETURN_ON_INVALID_ARG(rx_iface);
+    UAC_RETURN_ON_INVALID_ARG(tx_iface);
+    UAC_RETURN_ON_FALSE(rx_iface->dev_info.type == UAC_STREAM_RX && tx_iface->dev_info.type == UAC_STREAM_TX,
+                        ESP_ERR_INVALID_ARG, "Duplex needs RX and TX interface");
+    UAC_RETURN_ON_FALSE(rx_iface->parent == tx_iface->parent, ESP_ERR_INVALID_ARG, "Interfaces of different devices");
+    UAC_RETURN_ON_FALSE(config->rx_config.sample_freq == config->tx_config.sample_freq, ESP_ERR_INVALID_ARG, "Sample frequencies differ");
+    UAC_RETURN_ON_FALSE(!config->tx_config.tx_fill_cb, ESP_ERR_INVALID_ARG, "TX fill callback is used by duplex");
+    UAC_RETURN_ON_FALSE(!(config->rx_config.flags & FLAG_STREAM_RX_RESAMPLE), ESP_ERR_INVALID_ARG, "Duplex capture is not resampled");
+
+    esp_err_t ret = ESP_OK;
+    bool rx_started = false;
+    bool tx_started = false;
+    uac_duplex_t *duplex = calloc(1, sizeof(uac_duplex_t));
+    UAC_RETURN_ON_FALSE(duplex, ESP_ERR_NO_MEM, "Unable to allocate memory");
+    duplex->rx_iface = rx_iface;
+    duplex->tx_iface = tx_iface;
+    duplex->callback = config->callback;
+    duplex->callback_arg = config->callback_arg;
+
+    // start both suspended, transfers are allocated before the streams are resumed back to back
+    uac_host_stream_config_t rx_config = config->rx_config;
+    rx_config.flags |= FLAG_STREAM_SUSPEND_AFTER_START;
+    rx_config.urb_num = config->urb_num;
+    rx_config.packets_per_urb = config->packets_per_urb;
+    uac_host_stream_config_t tx_config = config->tx_config;
+    tx_config.flags |= FLAG_STREAM_SUSPEND_AFTER_START;
+    tx_config.urb_num = config->urb_num;
+    tx_config.packets_per_urb = config->packets_per_urb;
+    tx_config.tx_fill_cb = uac_duplex_tx_fill;
+    tx_config.tx_fill_cb_arg = duplex;
+
+    UAC_GOTO_ON_ERROR(uac_host_device_start(config->rx_handle, &rx_config), "Unable to start RX stream");
+    rx_started = true;
+    UAC_GOTO_ON_ERROR(uac_host_device_start(config->tx_handle, &tx_config), "Unable to start TX stream");
+    tx_started = true;
+
+    // one TX transfer period of capture, in whole samples. RX and TX endpoints may have different service intervals
+    duplex->rx_period_bytes = rx_iface->packet_size * tx_iface->packet_num * tx_iface->packet_period_us / rx_iface->packet_period_us;
+    duplex->rx_period_bytes -= duplex->rx_period_bytes % rx_iface->sample_bytes;
+    duplex->rx_buf = malloc(duplex->rx_period_bytes);
+    UAC_GOTO_ON_FALSE(duplex->rx_buf, ESP_ERR_NO_MEM, "Unable to allocate capture buffer");
+
+    UAC_GOTO_ON_ERROR(uac_host_device_resume(config->rx_handle), "Unable to resume RX stream");
+    UAC_GOTO_ON_ERROR(uac_host_device_resume(config->tx_handle), "Unable to resume TX stream");
+    *duplex_handle = duplex;
+    return ESP_OK;
+
+fail:
+    if (tx_started) {
+        uac_host_device_stop(config->tx_handle);
+    }
+    if (rx_started) {
+        uac_host_device_stop(config->rx_handle);
+    }
+    free(duplex->rx_buf);
+    free(duplex);
+    return ret;
+}
+
+esp_err_t uac_host_duplex_stop(uac_host_duplex_handle_t duplex_handle)
+{
+    UAC_RETURN_ON_INVALID_ARG(duplex_handle);
+    uac_duplex_t *duplex = duplex_handle;
+
+    // stop playback first, it reads the capture ringbuffer and the capture buffer
+    UAC_RETURN_ON_ERROR(uac_host_device_stop(duplex->tx_iface), "Unable to stop TX stream");
+    UAC_RETURN_ON_ERROR(uac_host_device_stop(duplex->rx_iface), "Unable to stop RX stream");
+    free(duplex->rx_buf);
+    free(duplex);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_duplex_get_delay(uac_host_duplex_handle_t duplex_handle, uint32_t *delay_us)
+{
+    UAC_RETURN_ON_INVALID_ARG(duplex_handle);
+    UAC_RETURN_ON_INVALID_ARG(delay_us);
+    *delay_us = duplex_handle->delay_us;
+    return ESP_OK;
+}
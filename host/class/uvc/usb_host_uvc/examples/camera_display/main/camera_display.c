@@ -14,19 +14,18 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/queue.h"
 
 #include "display.h"
-#include "jpeg_decoder.h"
+#include "jpeg_pipeline.h"
 #include "usb/usb_host.h"
 #include "usb/uvc_host.h"
+#include "usb/uvc_convert.h"
 
 #define FRAME_H_RES  480
 #define FRAME_V_RES  320
 #define FRAME_FORMAT UVC_VS_FORMAT_MJPEG
 #define FRAME_FPS    15
-#define DECODE_EVERY_XTH_FRAME 2        // Every 2nd frame will be decoded and send to display. This save CPU time
-#define DECODE_WORKING_BUFFER_SIZE 4000 // We must increase JPEG decoder working buffer size
+#define BAND_LINES   16 // YUY2 frames are converted and displayed in bands of this many lines
 
 #if CONFIG_SPIRAM
 #define NUMBER_OF_FRAME_BUFFERS 3 // Number of frames from the camera
@@ -36,14 +35,18 @@
 
 //@todo make the LCD feature optional
 
-static uint16_t *fb = NULL; // Framebuffer for decoded data (to LCD)
+static uint16_t *band_buffers[2] = {NULL}; // Converted bands of YUY2 frames (to LCD)
 static const char *TAG = "example";
 static esp_lcd_panel_handle_t display_panel;
-static QueueHandle_t frame_q = NULL; // Queue of received frames that are passed to processing task
+static jpeg_pipeline_hdl_t jpeg_pipeline = NULL; // Decodes MJPEG frames in its own task
 static SemaphoreHandle_t device_disconnected_sem;
 static uvc_host_stream_hdl_t stream;
 
-void yuy2_to_rgb565(const uint8_t *yuy2, uint16_t *rgb565, int width, int height);
+static void yuy2_band_callback(const uint16_t *rgb565, size_t y, size_t lines, void *user_ctx)
+{
+    const uvc_host_frame_t *frame = (const uvc_host_frame_t *)user_ctx;
+    esp_lcd_panel_draw_bitmap(display_panel, 0, y, frame->vs_format.h_res, y + lines, (const void *)rgb565);
+}
 
 void stream_callback(const uvc_host_stream_event_data_t *event, void *user_ctx)
 {
@@ -75,77 +78,37 @@ bool frame_callback(const uvc_host_frame_t *frame, void *user_ctx)
     switch (frame->vs_format.format) {
     case UVC_VS_FORMAT_YUY2: {
         ESP_LOGD(TAG, "YUY2 frame %dx%d", frame->vs_format.h_res, frame->vs_format.v_res);
-        if (fb) {
-            yuy2_to_rgb565(frame->data, fb, frame->vs_format.h_res, frame->vs_format.v_res);
-            esp_lcd_panel_draw_bitmap(display_panel, 0, 0, frame->vs_format.h_res, frame->vs_format.v_res, (const void *)fb);
+        if (band_buffers[0]) {
+            // Bands are sent to the display while the next one is being converted, no full RGB565 frame buffer is needed
+            const uvc_convert_band_config_t band_config = {
+                .band_buffers = {band_buffers[0], band_buffers[1]},
+                .band_lines = BAND_LINES,
+                .swap_bytes = false,
+                .band_cb = yuy2_band_callback,
+                .user_ctx = (void *)frame,
+            };
+            uvc_convert_yuy2_to_rgb565_banded(frame->data, frame->vs_format.h_res, frame->vs_format.v_res, &band_config);
         }
         frame_processed = true;
         break;
     }
-    case UVC_VS_FORMAT_H264:
-    case UVC_VS_FORMAT_H265:
     case UVC_VS_FORMAT_MJPEG: {
-        // Attempt to put the new frame into the queue without checking if it is full.
-        // If successful, we save processing time since we avoid the overhead of a full check for every frame.
-        BaseType_t frame_put_to_queue = xQueueSendToBack(frame_q, &frame, 0);
-
-        // Adding the frame to our queue should never fail, because our frame_q has the same length as the UVC driver queue (NUMBER_OF_FRAME_BUFFERS)
-        assert(frame_put_to_queue == pdPASS);
+        ESP_LOGD(TAG, "MJPEG frame %dx%d %d bytes", frame->vs_format.h_res, frame->vs_format.v_res, frame->data_len);
+        // The frame is returned by the pipeline after decoding, or immediately if the decoder falls behind
+        frame_processed = jpeg_pipeline_feed(jpeg_pipeline, stream, frame);
         break;
     }
     default:
         ESP_LOGI(TAG, "Unsupported format!");
+        frame_processed = true;
         break;
     }
     return frame_processed;
 }
 
-static void processing_task(void *pvParameters)
+static void decoded_image_callback(const uint16_t *rgb565, uint16_t width, uint16_t height, void *user_ctx)
 {
-    uvc_host_frame_t *frame;
-    uint8_t *jpeg_working_buffer = malloc(DECODE_WORKING_BUFFER_SIZE);
-    assert(jpeg_working_buffer);
-
-    while (1) {
-        xQueueReceive(frame_q, &frame, portMAX_DELAY);
-        ESP_LOGD(TAG, "MJPEG frame %dx%d %d bytes", frame->vs_format.h_res, frame->vs_format.v_res, frame->data_len);
-
-        static int frame_i = 0;
-        if (fb && ((frame_i % DECODE_EVERY_XTH_FRAME) == 0)) {
-            frame_i = 0;
-            esp_jpeg_image_cfg_t jpeg_cfg = {
-                .indata = (uint8_t *)frame->data,
-                .indata_size = frame->data_len,
-                .outbuf = (uint8_t *)fb,
-                .outbuf_size = FRAME_H_RES * FRAME_V_RES * 2,
-                .out_format = JPEG_IMAGE_FORMAT_RGB565,
-                .out_scale = JPEG_IMAGE_SCALE_0,
-                .flags = {
-                    .swap_color_bytes = 0,
-                },
-                .advanced = {
-                    .working_buffer = jpeg_working_buffer,
-                    .working_buffer_size = DECODE_WORKING_BUFFER_SIZE,
-                },
-            };
-            esp_jpeg_image_output_t outimg;
-
-            if (ESP_OK == esp_jpeg_decode(&jpeg_cfg, &outimg)) {
-                esp_lcd_panel_draw_bitmap(display_panel, 0, 0, outimg.width, outimg.height, (const void *)fb);
-            } else {
-                ESP_LOGW(TAG, "Decoding failed");
-            }
-        } else {
-            ESP_LOGI(TAG, "Skipping decoding of received MJPEG frame");
-        }
-        frame_i++;
-
-        uvc_host_frame_return(stream, frame);
-    }
-
-    // This code should never be reached. Leaving it here for completeness
-    free(jpeg_working_buffer);
-    vTaskDelete(NULL);
+    esp_lcd_panel_draw_bitmap(display_panel, 0, 0, width, height, (const void *)rgb565);
 }
 
 static void usb_lib_task(void *arg)
@@ -173,15 +136,31 @@ void app_main(void)
     };
     bsp_display_new(&config, &display_panel, &display_io);
 
-    //@todo does not work in PSRAM... :'(
-    fb = heap_caps_aligned_alloc(64, FRAME_H_RES * FRAME_V_RES * 2, MALLOC_CAP_INTERNAL);
-    if (fb == NULL) {
-        ESP_LOGW(TAG, "Insufficient memory for LCD frame buffer. LCD output disabled.");
+    if (FRAME_FORMAT == UVC_VS_FORMAT_YUY2) {
+        // Band buffers are small enough to stay in internal DMA capable RAM
+        for (int i = 0; i < 2; i++) {
+            band_buffers[i] = heap_caps_aligned_alloc(64, FRAME_H_RES * BAND_LINES * 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+        }
+        if (band_buffers[0] == NULL) {
+            ESP_LOGW(TAG, "Insufficient memory for LCD band buffers. LCD output disabled.");
+        }
+    } else {
+        // MJPEG frames are decoded by hardware JPEG decoder on ESP32-P4, by esp_jpeg on other targets
+        const jpeg_pipeline_config_t jpeg_pipeline_config = {
+            .max_width = FRAME_H_RES,
+            .max_height = FRAME_V_RES,
+            .queue_length = NUMBER_OF_FRAME_BUFFERS - 1, // Keep one frame buffer for reception
+            .drop_policy = JPEG_PIPELINE_DROP_OLDEST,    // Display the latest frame
+            .output_cb = decoded_image_callback,
+            .user_ctx = NULL,
+            .task_priority = 2,
+            .task_core = tskNO_AFFINITY,
+        };
+        ESP_ERROR_CHECK(jpeg_pipeline_new(&jpeg_pipeline_config, &jpeg_pipeline));
     }
 
-    frame_q = xQueueCreate(NUMBER_OF_FRAME_BUFFERS, sizeof (uvc_host_frame_t *));
     device_disconnected_sem = xSemaphoreCreateBinary();
-    assert(device_disconnected_sem && frame_q);
+    assert(device_disconnected_sem);
 
     // Install USB Host driver. Should only be called once in entire application
     ESP_LOGI(TAG, "Installing USB Host");
@@ -235,9 +214,6 @@ void app_main(void)
         },
     };
 
-    BaseType_t ret = xTaskCreate(processing_task, "frame_process", 4 * 1024, NULL, 2, NULL);
-    assert(ret == pdPASS);
-
     while (true) {
         ESP_LOGI(TAG, "Opening the stream...");
         esp_err_t err = uvc_host_stream_open(&uvc_stream_config, pdMS_TO_TICKS(5000), &stream);
@@ -0,0 +1,222 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "jpeg_pipeline.h"
+
+#if SOC_JPEG_DECODE_SUPPORTED
+#include "driver/jpeg_decode.h"
+#define JPEG_PIPELINE_OUTPUT_BUFFERS 2 // Double buffering: one image is being decoded while the other one is displayed
+#else
+#include "jpeg_decoder.h"
+#define JPEG_PIPELINE_WORKING_BUFFER_SIZE 4000 // esp_jpeg needs larger working buffer than default for UVC cameras
+#define JPEG_PIPELINE_OUTPUT_BUFFERS 1         // Output buffer must be in internal RAM, there is no space for two
+#endif
+
+static const char *TAG = "jpeg-pipeline";
+
+typedef struct {
+    uvc_host_stream_hdl_t stream_hdl; // Stream the frame must be returned to
+    const uvc_host_frame_t *frame;    // Frame waiting for decoding
+} jpeg_pipeline_item_t;
+
+struct jpeg_pipeline_s {
+    QueueHandle_t queue;                                  // Frames waiting for decoding
+    jpeg_pipeline_drop_policy_t drop_policy;
+    jpeg_pipeline_output_cb_t output_cb;
+    void *user_ctx;
+    size_t max_width;
+    size_t max_height;
+    uint16_t *out_buf[JPEG_PIPELINE_OUTPUT_BUFFERS];      // Decoded images
+    size_t out_buf_size;                                  // Size of one output buffer in bytes
+    unsigned out_index;                                   // Output buffer for the next image
+    uint32_t dropped;                                     // Number of dropped frames
+#if SOC_JPEG_DECODE_SUPPORTED
+    jpeg_decoder_handle_t decoder;                        // Hardware JPEG decoder engine
+#else
+    uint8_t *working_buffer;                              // esp_jpeg working buffer
+#endif
+};
+
+/**
+ * @brief Decode MJPEG frame to RGB565
+ *
+ * @param[in]  pipeline Pipeline
+ * @param[in]  frame    MJPEG frame
+ * @param[out] out      Output buffer
+ * @param[out] width    Width of decoded image
+ * @param[out] height   Height of decoded image
+ * @return
+ *     - ESP_OK: Success
+ *     - Else: The frame could not be decoded
+ */
+static esp_err_t jpeg_pipeline_decode(jpeg_pipeline_hdl_t pipeline, const uvc_host_frame_t *frame, uint16_t *out, uint16_t *width, uint16_t *height)
+{
+#if SOC_JPEG_DECODE_SUPPORTED
+    jpeg_decode_picture_info_t info;
+    ESP_RETURN_ON_ERROR(jpeg_decoder_get_info(frame->data, frame->data_len, &info), TAG, "Invalid JPEG header");
+    ESP_RETURN_ON_FALSE(info.width <= pipeline->max_width && info.height <= pipeline->max_height, ESP_ERR_INVALID_SIZE, TAG,
+                        "Image %" PRIu32 "x%" PRIu32 " too large", info.width, info.height);
+
+    // The frame buffer is read by DMA directly, in place
+    const jpeg_decode_cfg_t decode_cfg = {
+        .output_format = JPEG_DECODE_OUT_FORMAT_RGB565,
+        .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+    };
+    uint32_t out_size;
+    ESP_RETURN_ON_ERROR(
+        jpeg_decoder_process(pipeline->decoder, &decode_cfg, frame->data, frame->data_len, (uint8_t *)out, pipeline->out_buf_size, &out_size),
+        TAG, "Hardware decoding failed");
+    *width = info.width;
+    *height = info.height;
+#else
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)frame->data,
+        .indata_size = frame->data_len,
+        .outbuf = (uint8_t *)out,
+        .outbuf_size = pipeline->out_buf_size,
+        .out_format = JPEG_IMAGE_FORMAT_RGB565,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .flags = {
+            .swap_color_bytes = 0,
+        },
+        .advanced = {
+            .working_buffer = pipeline->working_buffer,
+            .working_buffer_size = JPEG_PIPELINE_WORKING_BUFFER_SIZE,
+        },
+    };
+    esp_jpeg_image_output_t outimg;
+    ESP_RETURN_ON_ERROR(esp_jpeg_decode(&jpeg_cfg, &outimg), TAG, "Software decoding failed");
+    *width = outimg.width;
+    *height = outimg.height;
+#endif
+    return ESP_OK;
+}
+
+static void jpeg_pipeline_task(void *arg)
+{
+    jpeg_pipeline_hdl_t pipeline = (jpeg_pipeline_hdl_t)arg;
+    jpeg_pipeline_item_t item;
+
+    while (1) {
+        xQueueReceive(pipeline->queue, &item, portMAX_DELAY);
+        uint16_t *out = pipeline->out_buf[pipeline->out_index];
+        uint16_t width, height;
+        const esp_err_t ret = jpeg_pipeline_decode(pipeline, item.frame, out, &width, &height);
+
+        // Return the frame before the output callback, so the UVC driver can receive next frame to it while we display this one
+        uvc_host_frame_return(item.stream_hdl, (uvc_host_frame_t *)item.frame);
+        if (ret == ESP_OK) {
+            pipeline->output_cb(out, width, height, pipeline->user_ctx);
+            pipeline->out_index = (pipeline->out_index + 1) % JPEG_PIPELINE_OUTPUT_BUFFERS;
+        }
+    }
+}
+
+esp_err_t jpeg_pipeline_new(const jpeg_pipeline_config_t *config, jpeg_pipeline_hdl_t *pipeline_ret)
+{
+    ESP_RETURN_ON_FALSE(config && pipeline_ret && config->output_cb && config->queue_length, ESP_ERR_INVALID_ARG, TAG,);
+    esp_err_t ret = ESP_OK;
+
+    jpeg_pipeline_hdl_t pipeline = calloc(1, sizeof(struct jpeg_pipeline_s));
+    ESP_RETURN_ON_FALSE(pipeline, ESP_ERR_NO_MEM, TAG,);
+    pipeline->drop_policy = config->drop_policy;
+    pipeline->output_cb = config->output_cb;
+    pipeline->user_ctx = config->user_ctx;
+    pipeline->max_width = config->max_width;
+    pipeline->max_height = config->max_height;
+    pipeline->out_buf_size = config->max_width * config->max_height * sizeof(uint16_t);
+
+    pipeline->queue = xQueueCreate(config->queue_length, sizeof(jpeg_pipeline_item_t));
+    ESP_GOTO_ON_FALSE(pipeline->queue, ESP_ERR_NO_MEM, err, TAG,);
+
+#if SOC_JPEG_DECODE_SUPPORTED
+    const jpeg_decode_engine_cfg_t engine_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = 100,
+    };
+    ESP_GOTO_ON_ERROR(jpeg_new_decoder_engine(&engine_cfg, &pipeline->decoder), err, TAG, "Could not create JPEG decoder");
+    const jpeg_decode_memory_alloc_cfg_t mem_cfg = {
+        .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
+    };
+    for (int i = 0; i < JPEG_PIPELINE_OUTPUT_BUFFERS; i++) {
+        size_t allocated;
+        pipeline->out_buf[i] = jpeg_alloc_decoder_mem(pipeline->out_buf_size, &mem_cfg, &allocated); // Aligned to cache line for DMA
+        ESP_GOTO_ON_FALSE(pipeline->out_buf[i], ESP_ERR_NO_MEM, err, TAG, "Not enough memory for output buffers");
+    }
+#else
+    pipeline->working_buffer = malloc(JPEG_PIPELINE_WORKING_BUFFER_SIZE);
+    ESP_GOTO_ON_FALSE(pipeline->working_buffer, ESP_ERR_NO_MEM, err, TAG,);
+    for (int i = 0; i < JPEG_PIPELINE_OUTPUT_BUFFERS; i++) {
+        pipeline->out_buf[i] = heap_caps_aligned_alloc(64, pipeline->out_buf_size, MALLOC_CAP_INTERNAL);
+        ESP_GOTO_ON_FALSE(pipeline->out_buf[i], ESP_ERR_NO_MEM, err, TAG, "Not enough memory for output buffers");
+    }
+#endif
+
+    ESP_GOTO_ON_FALSE(
+        xTaskCreatePinnedToCore(jpeg_pipeline_task, "jpeg_decode", 4 * 1024, pipeline, config->task_priority, NULL, config->task_core) == pdPASS,
+        ESP_ERR_NO_MEM, err, TAG, "Could not create decoding task");
+
+    *pipeline_ret = pipeline;
+    return ESP_OK;
+
+err:
+    for (int i = 0; i < JPEG_PIPELINE_OUTPUT_BUFFERS; i++) {
+        free(pipeline->out_buf[i]);
+    }
+#if SOC_JPEG_DECODE_SUPPORTED
+    if (pipeline->decoder) {
+        jpeg_del_decoder_engine(pipeline->decoder);
+    }
+#else
+    free(pipeline->working_buffer);
+#endif
+    if (pipeline->queue) {
+        vQueueDelete(pipeline->queue);
+    }
+    free(pipeline);
+    return ret;
+}
+
+bool jpeg_pipeline_feed(jpeg_pipeline_hdl_t pipeline, uvc_host_stream_hdl_t stream_hdl, const uvc_host_frame_t *frame)
+{
+    const jpeg_pipeline_item_t item = {
+        .stream_hdl = stream_hdl,
+        .frame = frame,
+    };
+    if (xQueueSendToBack(pipeline->queue, &item, 0) == pdPASS) {
+        return false; // The frame is returned by the decoding task
+    }
+
+    // The decoder falls behind
+    pipeline->dropped++;
+    if (pipeline->drop_policy == JPEG_PIPELINE_DROP_OLDEST) {
+        jpeg_pipeline_item_t oldest;
+        if (xQueueReceive(pipeline->queue, &oldest, 0) == pdPASS) {
+            uvc_host_frame_return(oldest.stream_hdl, (uvc_host_frame_t *)oldest.frame);
+        }
+        if (xQueueSendToBack(pipeline->queue, &item, 0) == pdPASS) {
+            return false;
+        }
+    }
+    return true; // Drop the new frame
+}
+
+uint32_t jpeg_pipeline_get_dropped(jpeg_pipeline_hdl_t pipeline)
+{
+    return pipeline->dropped;
+}
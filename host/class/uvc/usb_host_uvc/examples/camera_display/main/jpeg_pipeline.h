@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief MJPEG decoding stage for UVC frames
+ *
+ * Received MJPEG frames are queued and decoded to RGB565 in a separate task, so decoding overlaps with USB reception.
+ * On targets with JPEG decoder peripheral (ESP32-P4) the hardware decoder is used, esp_jpeg software decoder otherwise.
+ * Decoded images are passed to the user without copying. With the hardware decoder, two output buffers are used alternately.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct jpeg_pipeline_s *jpeg_pipeline_hdl_t;
+
+/**
+ * @brief What to do with a new frame when the decoder falls behind
+ */
+typedef enum {
+    JPEG_PIPELINE_DROP_NEWEST, /**< The new frame is returned to the UVC driver without decoding */
+    JPEG_PIPELINE_DROP_OLDEST, /**< The oldest queued frame is returned to the UVC driver, the new one is queued. Lower latency */
+} jpeg_pipeline_drop_policy_t;
+
+/**
+ * @brief Decoded image callback
+ *
+ * @note With the hardware decoder, the image stays valid until this callback returns for the next image, so it can be displayed by DMA
+ *       in the meantime. With the software decoder, the image is valid only until this callback returns
+ * @param[in] rgb565   Decoded image
+ * @param[in] width    Image width in pixels
+ * @param[in] height   Image height in pixels
+ * @param[in] user_ctx User's argument from the pipeline configuration
+ */
+typedef void (*jpeg_pipeline_output_cb_t)(const uint16_t *rgb565, uint16_t width, uint16_t height, void *user_ctx);
+
+/**
+ * @brief Configuration of the decoding stage
+ */
+typedef struct {
+    size_t max_width;                         /**< Maximum width of decoded images in pixels */
+    size_t max_height;                        /**< Maximum height of decoded images in pixels */
+    unsigned queue_length;                    /**< Number of frames waiting for decoding. Must be lower than number of UVC frame buffers */
+    jpeg_pipeline_drop_policy_t drop_policy;  /**< Policy for frames that do not fit into the queue */
+    jpeg_pipeline_output_cb_t output_cb;      /**< Decoded image callback, called from the decoding task */
+    void *user_ctx;                           /**< User's argument passed to output_cb */
+    unsigned task_priority;                   /**< Priority of the decoding task */
+    int task_core;                            /**< Core affinity of the decoding task */
+} jpeg_pipeline_config_t;
+
+/**
+ * @brief Create the decoding stage
+ *
+ * @param[in]  config       Configuration
+ * @param[out] pipeline_ret Handle of the pipeline
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid configuration
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ *     - Else: JPEG decoder error
+ */
+esp_err_t jpeg_pipeline_new(const jpeg_pipeline_config_t *config, jpeg_pipeline_hdl_t *pipeline_ret);
+
+/**
+ * @brief Pass received frame to the decoding stage
+ *
+ * Call this from uvc_host_frame_callback_t. Queued frames are returned to the UVC driver with uvc_host_frame_return()
+ * after decoding, so the frame callback must return the result of this function.
+ *
+ * @param[in] pipeline   Handle of the pipeline
+ * @param[in] stream_hdl UVC stream the frame belongs to
+ * @param[in] frame      Received MJPEG frame
+ * @return true if the frame was not queued and can be returned to the UVC driver immediately
+ */
+bool jpeg_pipeline_feed(jpeg_pipeline_hdl_t pipeline, uvc_host_stream_hdl_t stream_hdl, const uvc_host_frame_t *frame);
+
+/**
+ * @brief Get number of frames dropped by the decoding stage
+ *
+ * @param[in] pipeline Handle of the pipeline
+ * @return Number of dropped frames
+ */
+uint32_t jpeg_pipeline_get_dropped(jpeg_pipeline_hdl_t pipeline);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/uvc_convert.h"
+
+constexpr size_t width = 320;
+constexpr size_t height = 240;
+constexpr size_t band_lines = 7; // Last band of the image is shorter
+
+static std::vector<uint8_t> random_yuy2_image(void)
+{
+    std::vector<uint8_t> yuy2(width * height * 2);
+    std::mt19937 gen(0x12345678);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto &byte : yuy2) {
+        byte = static_cast<uint8_t>(dist(gen));
+    }
+    return yuy2;
+}
+
+SCENARIO("YUY2 to RGB565 conversion", "[convert]")
+{
+    GIVEN("Random YUY2 image") {
+        const std::vector<uint8_t> yuy2 = random_yuy2_image();
+        std::vector<uint16_t> expected(width * height);
+        std::vector<uint16_t> result(width * height);
+
+        for (bool swap_bytes : {false, true}) {
+            WHEN("Converted by the optimized and the reference implementation") {
+                uvc_convert_yuy2_to_rgb565_ref(yuy2.data(), expected.data(), width, height, swap_bytes);
+                uvc_convert_yuy2_to_rgb565(yuy2.data(), result.data(), width, height, swap_bytes);
+                THEN("The images are identical") {
+                    REQUIRE(result == expected);
+                }
+            }
+        }
+
+        WHEN("Converted in bands") {
+            uvc_convert_yuy2_to_rgb565(yuy2.data(), expected.data(), width, height, false);
+            std::vector<uint16_t> bands[2] = {std::vector<uint16_t>(width * band_lines), std::vector<uint16_t>(width * band_lines)};
+            struct {
+                std::vector<uint16_t> *image;
+                size_t next_line;
+                const uint16_t *last_band;
+                bool alternated;
+            } ctx = {&result, 0, nullptr, true};
+
+            const uvc_convert_band_config_t config = {
+                .band_buffers = {bands[0].data(), bands[1].data()},
+                .band_lines = band_lines,
+                .swap_bytes = false,
+                .band_cb = [](const uint16_t *rgb565, size_t y, size_t lines, void *user_ctx) {
+                    auto *c = static_cast<decltype(ctx) *>(user_ctx);
+                    REQUIRE(y == c->next_line);
+                    REQUIRE(lines <= band_lines);
+                    if (rgb565 == c->last_band) {
+                        c->alternated = false;
+                    }
+                    std::copy(rgb565, rgb565 + width * lines, c->image->begin() + y * width);
+                    c->next_line = y + lines;
+                    c->last_band = rgb565;
+                },
+                .user_ctx = &ctx,
+            };
+            REQUIRE(ESP_OK == uvc_convert_yuy2_to_rgb565_banded(yuy2.data(), width, height, &config));
+            THEN("All bands were delivered from alternating buffers") {
+                REQUIRE(ctx.next_line == height);
+                REQUIRE(ctx.alternated);
+                AND_THEN("The image is identical to full frame conversion") {
+                    REQUIRE(result == expected);
+                }
+            }
+        }
+
+        WHEN("Band configuration is invalid") {
+            uvc_convert_band_config_t config = {
+                .band_buffers = {result.data(), nullptr},
+                .band_lines = 0,
+                .swap_bytes = false,
+                .band_cb = [](const uint16_t *, size_t, size_t, void *) {},
+                .user_ctx = nullptr,
+            };
+            THEN("Conversion is refused") {
+                REQUIRE(ESP_ERR_INVALID_ARG == uvc_convert_yuy2_to_rgb565_banded(yuy2.data(), width, height, &config));
+                config.band_lines = 8;
+                REQUIRE(ESP_ERR_INVALID_ARG == uvc_convert_yuy2_to_rgb565_banded(yuy2.data(), width - 1, height, &config));
+                REQUIRE(ESP_OK == uvc_convert_yuy2_to_rgb565_banded(yuy2.data(), width, height, &config));
+            }
+        }
+    }
+}
+
+// Not run by default, select with "[benchmark]" tag
+TEST_CASE("YUY2 to RGB565 conversion speed", "[.][benchmark][convert]")
+{
+    const std::vector<uint8_t> yuy2 = random_yuy2_image();
+    std::vector<uint16_t> rgb565(width * height);
+    constexpr int rounds = 100;
+
+    auto measure = [&](auto convert) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            convert();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    };
+
+    const double ref_us = measure([&] { uvc_convert_yuy2_to_rgb565_ref(yuy2.data(), rgb565.data(), width, height, false); });
+    const double fast_us = measure([&] { uvc_convert_yuy2_to_rgb565(yuy2.data(), rgb565.data(), width, height, false); });
+    printf("YUY2 %zux%zu to RGB565: reference %.1f us, optimized %.1f us per frame\n", width, height, ref_us, fast_us);
+    REQUIRE(fast_us > 0);
+}
@@ -80,3 +80,30 @@ SCENARIO("Camera descriptor parsing: Anker Powerconf C200", "[anker][powerconf][
         }
     }
 }
+
+SCENARIO("Still image sizes: Anker Powerconf C200", "[anker][powerconf][c200][still]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+    uvc_desc_index_t *index = nullptr;
+    REQUIRE(ESP_OK == uvc_desc_index_build(cfg, 1, &index));
+    REQUIRE(index->bStillCaptureMethod == 2);
+    uvc_desc_still_size_t still_size = {};
+
+    GIVEN("MJPEG and YUY2 formats with Still Image Frame descriptor") {
+        for (uint8_t bFormatIndex : {1, 2}) {
+            REQUIRE(ESP_OK == uvc_desc_index_get_still_size(index, bFormatIndex, 0, 0, &still_size));
+            REQUIRE(still_size.bFrameIndex == 1);
+            REQUIRE(still_size.bCompressionIndex == 0);
+            REQUIRE(still_size.bEndpointAddress == 0);
+            REQUIRE(still_size.wWidth == 1920);
+            REQUIRE(still_size.wHeight == 1080);
+            REQUIRE(ESP_OK == uvc_desc_index_get_still_size(index, bFormatIndex, 1920, 1080, &still_size));
+            REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_index_get_still_size(index, bFormatIndex, 640, 480, &still_size));
+        }
+    }
+
+    GIVEN("H.264 format without Still Image Frame descriptor") {
+        REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_index_get_still_size(index, 3, 0, 0, &still_size));
+    }
+    uvc_desc_index_free(index);
+}
@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "usb/uvc_host.h"
+#include "uvc_descriptors_priv.h"
+
+#include "descriptors/anker_powerconf_c200.hpp"
+#include "descriptors/customer.hpp"
+#include "descriptors/customer_dual.hpp"
+#include "descriptors/dual_tusb.hpp"
+#include "descriptors/elp_h264.hpp"
+#include "descriptors/elp_h265.hpp"
+#include "descriptors/logitech_c270.hpp"
+#include "descriptors/logitech_streamcam.hpp"
+#include "descriptors/old.hpp"
+#include "descriptors/trust_webcam.hpp"
+
+/*
+ * Frame format lookup benchmark
+ *
+ * Every frame format offered by a fixture is looked up with uvc_desc_get_frame_format_by_format(), which walks
+ * the Configuration descriptor, and with uvc_desc_index_get_frame_format_by_format(), which uses the descriptor index.
+ * Results are printed in ns per lookup, so they can be compared between CI runs.
+ *
+ * Environment variables:
+ * - UVC_BENCHMARK_LOOKUP_ROUNDS:     Number of lookups of each frame format (default 1000)
+ * - UVC_BENCHMARK_MAX_NS_PER_LOOKUP: If set, the test fails when lookups in any fixture are slower than this
+ */
+
+/**
+ * @brief Configuration descriptor fixture
+ */
+struct fixture_t {
+    const char *name;
+    const uint8_t *cfg_desc;
+};
+
+/**
+ * @brief Frame format and Video Streaming interface that offers it
+ */
+struct lookup_t {
+    uvc_host_stream_format_t vs_format;
+    uint8_t bInterfaceNumber;
+};
+
+static int benchmark_rounds(void)
+{
+    const char *rounds = getenv("UVC_BENCHMARK_LOOKUP_ROUNDS");
+    return rounds ? atoi(rounds) : 1000;
+}
+
+static void benchmark_check(const char *name, const char *method, double ns)
+{
+    printf("%-32s %-8s %8.1f ns/lookup\n", name, method, ns);
+    const char *max_ns = getenv("UVC_BENCHMARK_MAX_NS_PER_LOOKUP");
+    if (max_ns) {
+        CHECK(ns <= atof(max_ns));
+    }
+}
+
+/**
+ * @brief Collect frame formats of all UVC functions, at their default frame interval
+ */
+static std::vector<lookup_t> lookups_create(const usb_config_desc_t *cfg)
+{
+    std::vector<lookup_t> lookups;
+    for (uint8_t uvc_index = 0; ; uvc_index++) {
+        size_t list_size = 0;
+        if (ESP_OK != uvc_desc_get_frame_list(cfg, uvc_index, nullptr, &list_size)) {
+            break;
+        }
+        std::vector<uvc_host_frame_list_entry_t> frame_list(list_size);
+        REQUIRE(ESP_OK == uvc_desc_get_frame_list(cfg, uvc_index, frame_list.data(), &list_size));
+
+        for (const uvc_host_frame_list_entry_t &entry : frame_list) {
+            if (entry.format == UVC_VS_FORMAT_UNDEFINED || entry.dwDefaultFrameInterval == 0) {
+                continue;
+            }
+            lookup_t lookup = {};
+            lookup.vs_format = {entry.h_res, entry.v_res, UVC_DESC_DWFRAMEINTERVAL_TO_FPS(entry.dwDefaultFrameInterval), entry.format};
+            uint16_t bcdUVC = 0;
+            if (ESP_OK == uvc_desc_get_streaming_interface_num(cfg, uvc_index, &lookup.vs_format, &bcdUVC, &lookup.bInterfaceNumber)) {
+                lookups.push_back(lookup);
+            }
+        }
+    }
+    return lookups;
+}
+
+TEST_CASE("Frame format lookup speed", "[parsing][benchmark]")
+{
+    const fixture_t fixture = GENERATE(values<fixture_t>({
+        {"Anker PowerConf C200", anker_powerconf_c200::cfg_desc},
+        {"Customer camera", customer_camera::cfg_desc},
+        {"Customer camera dual", customer_camera_dual::cfg_desc},
+        {"TinyUSB dual", dual_tusb::cfg_desc},
+        {"ELP H264", elp_h264::cfg_desc},
+        {"ELP H265", elp_h265::cfg_desc},
+        {"Logitech C270", logitech_c270::cfg_desc},
+        {"Logitech StreamCam", logitech_streamcam::cfg_desc},
+        {"Canyon CNE CWC2", old_cameras::CANYON_CNE_CWC2},
+        {"Logitech C980", old_cameras::Logitech_C980},
+        {"Trust webcam", trust_webcam::cfg_desc},
+    }));
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)fixture.cfg_desc;
+    const std::vector<lookup_t> lookups = lookups_create(cfg);
+    REQUIRE_FALSE(lookups.empty());
+    const int rounds = benchmark_rounds();
+
+    SECTION("Descriptor walk") {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            for (const lookup_t &lookup : lookups) {
+                const uvc_format_desc_t *format_desc = nullptr;
+                const uvc_frame_desc_t *frame_desc = nullptr;
+                REQUIRE(ESP_OK == uvc_desc_get_frame_format_by_format(cfg, lookup.bInterfaceNumber, &lookup.vs_format, &format_desc, &frame_desc));
+            }
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds / lookups.size();
+        benchmark_check(fixture.name, "walk", ns);
+    }
+
+    SECTION("Descriptor index") {
+        std::map<uint8_t, uvc_desc_index_t *> indexes;
+        for (const lookup_t &lookup : lookups) {
+            if (indexes.count(lookup.bInterfaceNumber) == 0) {
+                REQUIRE(ESP_OK == uvc_desc_index_build(cfg, lookup.bInterfaceNumber, &indexes[lookup.bInterfaceNumber]));
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            for (const lookup_t &lookup : lookups) {
+                const uvc_format_desc_t *format_desc = nullptr;
+                const uvc_frame_desc_t *frame_desc = nullptr;
+                REQUIRE(ESP_OK == uvc_desc_index_get_frame_format_by_format(indexes[lookup.bInterfaceNumber], &lookup.vs_format, &format_desc, &frame_desc));
+            }
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds / lookups.size();
+        benchmark_check(fixture.name, "index", ns);
+
+        for (auto &index : indexes) {
+            uvc_desc_index_free(index.second);
+        }
+    }
+}
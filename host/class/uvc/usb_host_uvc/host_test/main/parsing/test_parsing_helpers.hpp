@@ -93,6 +93,30 @@
     {x, y, 20, UVC_VS_FORMAT_H265}, \
     {x, y, 15, UVC_VS_FORMAT_H265}
 
+/**
+ * @brief Helper that checks that descriptor index finds the same descriptors as linear parsing
+ */
+#define REQUIRE_INDEX_LOOKUP(cfg, intf_num, format, format_desc, frame_desc, intf_desc, ep_desc)                             \
+    do {                                                                                                                   \
+        uvc_desc_index_t *index = nullptr;                                                                                 \
+        REQUIRE(ESP_OK == uvc_desc_index_build(cfg, intf_num, &index));                                                    \
+        const uvc_format_desc_t *index_format_desc = nullptr;                                                              \
+        const uvc_frame_desc_t *index_frame_desc = nullptr;                                                                \
+        REQUIRE(ESP_OK == uvc_desc_index_get_frame_format_by_format(index, &format, &index_format_desc, &index_frame_desc)); \
+        REQUIRE(index_format_desc == format_desc);                                                                         \
+        REQUIRE(index_frame_desc == frame_desc);                                                                           \
+        REQUIRE(ESP_OK == uvc_desc_index_get_frame_format_by_index(index, format_desc->bFormatIndex, frame_desc->bFrameIndex, \
+                &index_format_desc, &index_frame_desc));                                                                   \
+        REQUIRE(index_format_desc == format_desc);                                                                         \
+        REQUIRE(index_frame_desc == frame_desc);                                                                           \
+        const usb_intf_desc_t *index_intf_desc = nullptr;                                                                  \
+        const usb_ep_desc_t *index_ep_desc = nullptr;                                                                      \
+        REQUIRE(ESP_OK == uvc_desc_index_get_streaming_intf_and_ep(index, 1024, &index_intf_desc, &index_ep_desc));        \
+        REQUIRE(index_intf_desc == intf_desc);                                                                             \
+        REQUIRE(index_ep_desc == ep_desc);                                                                                 \
+        uvc_desc_index_free(index);                                                                                        \
+    } while (0)
+
 /**
  * @brief Helper that check if required format is supported
  */
@@ -112,6 +136,7 @@
         REQUIRE(ESP_OK == uvc_desc_get_frame_format_by_format(cfg, bInterfaceNumber, &format, &format_desc, &frame_desc)); \
         REQUIRE(format_desc != nullptr);                                                                                   \
         REQUIRE(frame_desc != nullptr);                                                                                    \
+        REQUIRE_INDEX_LOOKUP(cfg, bInterfaceNumber, format, format_desc, frame_desc, intf_desc, ep_desc);                  \
     } while (0)
 
 /**
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <vector>
 #include <catch2/catch_test_macros.hpp>
 
 #include "usb/uvc_host.h"
@@ -100,3 +101,167 @@ SCENARIO("Camera descriptor parsing: Logitech C270", "[logitech][c270]")
         }
     }
 }
+
+SCENARIO("Bandwidth aware alternate setting selection: Logitech C270", "[logitech][c270][bandwidth]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+    const usb_intf_desc_t *intf_desc = nullptr;
+    const usb_ep_desc_t *ep_desc = nullptr;
+
+    // High Speed: service interval of all alternate settings is 125us
+    GIVEN("Low bandwidth requirement") {
+        // 125 bytes per microframe
+        REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, true, 1000000, 0, 4096, &intf_desc, &ep_desc));
+        THEN("The smallest alternate setting is selected") {
+            REQUIRE(intf_desc->bAlternateSetting == 1);
+            REQUIRE(USB_EP_DESC_GET_MPS(ep_desc) == 0xC0);
+        }
+    }
+
+    GIVEN("Medium bandwidth requirement") {
+        // 500 bytes per microframe
+        REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, true, 4000000, 0, 4096, &intf_desc, &ep_desc));
+        THEN("The smallest sufficient alternate setting is selected") {
+            REQUIRE(intf_desc->bAlternateSetting == 3);
+        }
+    }
+
+    GIVEN("Bandwidth requirement limited by dwMaxPayloadTransferSize") {
+        REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, true, 100000000, 0x180, 4096, &intf_desc, &ep_desc));
+        THEN("Alternate setting matching the max payload is selected") {
+            REQUIRE(intf_desc->bAlternateSetting == 2);
+        }
+    }
+
+    GIVEN("Bandwidth requirement that no alternate setting meets") {
+        REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, true, 100000000, 0, 4096, &intf_desc, &ep_desc));
+        THEN("The largest alternate setting is selected") {
+            REQUIRE(intf_desc->bAlternateSetting == 0x0B);
+        }
+    }
+}
+
+SCENARIO("Alternate setting step down: Logitech C270", "[logitech][c270][bandwidth]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+    uvc_desc_index_t *index = nullptr;
+    REQUIRE(ESP_OK == uvc_desc_index_build(cfg, 1, &index));
+    const usb_intf_desc_t *intf_desc = nullptr;
+    const usb_ep_desc_t *ep_desc = nullptr;
+
+    GIVEN("Alternate setting with 2 transactions per microframe") {
+        // Alternate setting 7: 2x 0x280 bytes, alternate setting 6: 1x 0x3B0 bytes
+        REQUIRE(ESP_OK == uvc_desc_index_get_streaming_intf_and_ep_step_down(index, true, index->alts[7].ep_desc, 4096, &intf_desc, &ep_desc));
+        THEN("The largest smaller alternate setting is selected") {
+            REQUIRE(intf_desc->bAlternateSetting == 6);
+            REQUIRE(ep_desc == index->alts[6].ep_desc);
+        }
+    }
+
+    GIVEN("Largest alternate setting that does not fit in IN FIFO") {
+        REQUIRE(ESP_OK == uvc_desc_index_get_streaming_intf_and_ep_step_down(index, true, index->alts[11].ep_desc, 0x300, &intf_desc, &ep_desc));
+        THEN("Only alternate settings that fit are selected") {
+            REQUIRE(intf_desc->bAlternateSetting == 7);
+        }
+    }
+
+    GIVEN("The smallest alternate setting") {
+        THEN("There is nothing to step down to") {
+            REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_index_get_streaming_intf_and_ep_step_down(index, true, index->alts[1].ep_desc, 4096, &intf_desc, &ep_desc));
+        }
+    }
+    uvc_desc_index_free(index);
+}
+
+SCENARIO("Frame list: Logitech C270", "[logitech][c270][frame_list]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+
+    GIVEN("Empty list") {
+        size_t list_size = 0;
+        REQUIRE(ESP_OK == uvc_desc_get_frame_list(cfg, 0, nullptr, &list_size));
+        THEN("Number of all frame formats is returned") {
+            REQUIRE(list_size == 38); // 19 MJPEG + 19 YUY2
+
+            AND_WHEN("The list is filled") {
+                std::vector<uvc_host_frame_list_entry_t> frame_list(list_size);
+                REQUIRE(ESP_OK == uvc_desc_get_frame_list(cfg, 0, frame_list.data(), &list_size));
+                REQUIRE(list_size == frame_list.size());
+                THEN("Every entry is a supported format at every its frame interval") {
+                    for (const auto &entry : frame_list) {
+                        REQUIRE(entry.bFrameIntervalType > 0);
+                        REQUIRE(entry.dwMaxVideoFrameSize > 0);
+                        for (int i = 0; i < entry.bFrameIntervalType && i < UVC_HOST_FRAME_INTERVALS_MAX; i++) {
+                            uvc_host_stream_format_t vs_format = {
+                                entry.h_res, entry.v_res, UVC_DESC_DWFRAMEINTERVAL_TO_FPS(entry.discrete[i]), entry.format
+                            };
+                            REQUIRE_FORMAT_SUPPORTED(cfg, vs_format, 1);
+                        }
+                    }
+                }
+                THEN("YUY2 frame size matches resolution") {
+                    for (const auto &entry : frame_list) {
+                        if (entry.format == UVC_VS_FORMAT_YUY2) {
+                            REQUIRE(entry.dwMaxVideoFrameSize == entry.h_res * entry.v_res * 2);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    GIVEN("List shorter than number of frame formats") {
+        uvc_host_frame_list_entry_t frame_list[2];
+        size_t list_size = 2;
+        REQUIRE(ESP_OK == uvc_desc_get_frame_list(cfg, 0, frame_list, &list_size));
+        THEN("Only the list is filled, number of all frame formats is returned") {
+            REQUIRE(list_size == 38);
+            REQUIRE(frame_list[0].format != UVC_VS_FORMAT_UNDEFINED);
+        }
+    }
+
+    GIVEN("Non existent UVC function") {
+        size_t list_size = 0;
+        THEN("Not found error is returned") {
+            REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_get_frame_list(cfg, 1, nullptr, &list_size));
+        }
+    }
+}
+
+SCENARIO("Control units: Logitech C270", "[logitech][c270][controls]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+
+    GIVEN("Logitech C270 Video Control interface") {
+        uvc_desc_control_units_t units;
+        REQUIRE(ESP_OK == uvc_desc_get_control_units(cfg, 0, &units));
+        THEN("Camera Terminal and Processing Unit are found") {
+            REQUIRE(units.bInterfaceNumber == 0);
+            REQUIRE(units.camera_terminal_id == 1);
+            REQUIRE(units.camera_controls == 0x0E);
+            REQUIRE(units.processing_unit_id == 2);
+            REQUIRE(units.processing_controls == 0x175B); // bControlSize == 2
+        }
+        THEN("Supported controls are reported from bmControls") {
+            REQUIRE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL, UVC_CT_AE_MODE_CONTROL));
+            REQUIRE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL, UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL));
+            REQUIRE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, UVC_PU_BRIGHTNESS_CONTROL));
+            REQUIRE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, UVC_PU_BACKLIGHT_COMPENSATION_CONTROL));
+            REQUIRE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL));
+        }
+        THEN("Other controls are not supported") {
+            REQUIRE_FALSE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL, UVC_CT_FOCUS_ABSOLUTE_CONTROL));
+            REQUIRE_FALSE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL, UVC_CT_ZOOM_ABSOLUTE_CONTROL));
+            REQUIRE_FALSE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, UVC_PU_HUE_CONTROL));
+            REQUIRE_FALSE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, UVC_PU_CONTROL_UNDEFINED));
+            REQUIRE_FALSE(uvc_desc_control_is_supported(&units, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, 0x40));
+        }
+    }
+
+    GIVEN("Non existent UVC function") {
+        uvc_desc_control_units_t units;
+        THEN("Not found error is returned") {
+            REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_get_control_units(cfg, 1, &units));
+        }
+    }
+}
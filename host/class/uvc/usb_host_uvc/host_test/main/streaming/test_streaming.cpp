@@ -6,12 +6,14 @@
 
 #include <stdio.h>
 #include <functional>
+#include <vector>
 #include <catch2/catch_test_macros.hpp>
 
 #include "usb/usb_types_stack.h"
 #include "usb/uvc_host.h"
 #include "uvc_types_priv.h"
 #include "uvc_frame_priv.h"
+#include "uvc_mjpeg_priv.h"
 
 #include "images/test_logo_jpg.hpp"
 #include "test_streaming_helpers.hpp"
@@ -81,6 +83,10 @@ void run_streaming_frame_reconstruction_scenario(void)
                 REQUIRE(frame->vs_format.v_res == stream.constant.vs_format.v_res);
                 REQUIRE(frame->vs_format.fps == stream.constant.vs_format.fps);
                 REQUIRE(frame->vs_format.format == stream.constant.vs_format.format);
+                REQUIRE(frame->info.sequence >= (uint32_t)frame_callback_called); // Frames with errors also get sequence number
+                REQUIRE(frame->info.sof_timestamp_us <= frame->info.eof_timestamp_us);
+                REQUIRE_FALSE(frame->info.pts_valid); // Test payload headers contain no PTS and SCR
+                REQUIRE(frame->info.capture_timestamp_us == 0);
 
                 std::vector<uint8_t> frame_data(frame->data, frame->data + frame->data_len);
                 std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
@@ -98,6 +104,8 @@ void run_streaming_frame_reconstruction_scenario(void)
 
                     THEN("The frame callback is called with expected frame data") {
                         REQUIRE(frame_callback_called == 1);
+                        REQUIRE(stream.stats.frames_delivered == 1);
+                        REQUIRE(stream.stats.bytes_delivered == logo_jpg.size());
                     }
 
                     AND_WHEN("Next frame is send") {
@@ -114,6 +122,7 @@ void run_streaming_frame_reconstruction_scenario(void)
                 send_function_wrapper(1024, &stream, std::span(logo_jpg), 0, true);
                 THEN("The frame callback is not called") {
                     REQUIRE(frame_callback_called == 0);
+                    REQUIRE(stream.stats.skipped_error == 1);
                 }
 
                 AND_WHEN("Next frame is send") {
@@ -129,6 +138,7 @@ void run_streaming_frame_reconstruction_scenario(void)
                 send_function_wrapper(1024, &stream, std::span(logo_jpg), 0, false, true);
                 THEN("The frame callback is not called") {
                     REQUIRE(frame_callback_called == 0);
+                    REQUIRE(stream.stats.skipped_error == 1);
                 }
 
                 AND_WHEN("Next frame is send") {
@@ -172,6 +182,47 @@ void run_streaming_frame_reconstruction_scenario(void)
                 send_function_wrapper(1024, &stream, std::span(logo_jpg));
                 THEN("Buffer overflow event is generated") {
                     REQUIRE(event_type == UVC_HOST_FRAME_BUFFER_OVERFLOW);
+                    REQUIRE(stream.stats.skipped_overflow == 1);
+                }
+            }
+
+            REQUIRE(uvc_frame_are_all_returned(&stream));
+            uvc_frame_free(&stream);
+        }
+
+        AND_GIVEN("Frame buffer is too small, but adaptive") {
+            int frame_callback_called = 0;
+            frame_callback = [&](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+                frame_callback_called++;
+                std::vector<uint8_t> frame_data(frame->data, frame->data + frame->data_len);
+                std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+                REQUIRE(frame_data == original_data);
+                return true;
+            };
+            stream.constant.adaptive_frame_size = true;
+            REQUIRE(uvc_frame_allocate(&stream, 1, logo_jpg.size() / 4, 0) == ESP_OK);
+
+            WHEN("The frame is bigger than frame buffer") {
+                send_function_wrapper(1024, &stream, std::span(logo_jpg));
+                THEN("The frame buffer grows and the frame callback is called") {
+                    REQUIRE(frame_callback_called == 1);
+                    REQUIRE(stream.constant.frames[0]->data_buffer_len >= logo_jpg.size());
+                    REQUIRE(stream.single_thread.frame_size_peak == logo_jpg.size());
+                }
+            }
+
+            AND_GIVEN("Frame buffer size is limited") {
+                stream.constant.frame_size_max = logo_jpg.size() - 100;
+                enum uvc_host_dev_event event_type = static_cast<enum uvc_host_dev_event>(-1); // Explicitly set to invalid value
+                stream_callback = [&](const uvc_host_stream_event_data_t *event, void *user_ctx) {
+                    event_type = event->type;
+                };
+                WHEN("The frame is bigger than the limit") {
+                    send_function_wrapper(1024, &stream, std::span(logo_jpg));
+                    THEN("Buffer overflow event is generated") {
+                        REQUIRE(event_type == UVC_HOST_FRAME_BUFFER_OVERFLOW);
+                        REQUIRE(frame_callback_called == 0);
+                    }
                 }
             }
 
@@ -196,6 +247,7 @@ void run_streaming_frame_reconstruction_scenario(void)
                 send_function_wrapper(1024, &stream, std::span(logo_jpg));
                 THEN("Buffer underflow event is generated") {
                     REQUIRE(event_type == UVC_HOST_FRAME_BUFFER_UNDERFLOW);
+                    REQUIRE(stream.stats.skipped_underflow == 1);
                     REQUIRE_FALSE(uvc_frame_are_all_returned(&stream));
                 }
             }
@@ -244,6 +296,140 @@ SCENARIO("Bulk stream frame reconstruction", "[streaming][bulk]")
     run_streaming_frame_reconstruction_scenario();
 }
 
+SCENARIO("Bulk stream payload boundaries", "[streaming][bulk]")
+{
+    constexpr size_t transfer_size = 2048;
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.wMaxPacketSize = 512;
+
+    static std::vector<uint8_t> received_data;
+    static int frames_received;
+    received_data.clear();
+    frames_received = 0;
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        received_data.assign(frame->data, frame->data + frame->data_len);
+        frames_received++;
+        return true;
+    };
+    REQUIRE(uvc_frame_allocate(&stream, 1, 16 * 1024, 0) == ESP_OK);
+
+    std::vector<uint8_t> frame_data(4096);
+    for (size_t i = 0; i < frame_data.size(); i++) {
+        frame_data[i] = (uint8_t)(i * 7);
+    }
+
+    // Payload stream as sent by the device, split into transfers of transfer_size
+    std::vector<uint8_t> usb_data;
+    std::vector<size_t> payload_ends; // End offsets of payload transfers in usb_data
+    auto add_payload = [&](size_t data_offset, size_t data_len, bool eof) {
+        const uint8_t header[HEADER_LEN] = {HEADER_LEN, (uint8_t)(0x80 | (eof ? 0x02 : 0x00))}; // EOH, EoF, FID = 0
+        usb_data.insert(usb_data.end(), header, header + HEADER_LEN);
+        usb_data.insert(usb_data.end(), frame_data.begin() + data_offset, frame_data.begin() + data_offset + data_len);
+        payload_ends.push_back(usb_data.size());
+    };
+    auto send_usb_data = [&]() {
+        std::vector<uint8_t> buffer(transfer_size);
+        usb_transfer_t transfer = {
+            .data_buffer = buffer.data(),
+            .data_buffer_size = transfer_size,
+            .num_bytes = 0,
+            .actual_num_bytes = 0,
+            .flags = 0,
+            .device_handle = nullptr,
+            .bEndpointAddress = 0,
+            .status = USB_TRANSFER_STATUS_COMPLETED,
+            .timeout_ms = 0,
+            .callback = nullptr,
+            .context = &stream,
+            .num_isoc_packets = 0,
+        };
+        for (size_t offset = 0; offset < usb_data.size(); offset += transfer_size) {
+            transfer.actual_num_bytes = std::min(transfer_size, usb_data.size() - offset);
+            std::copy_n(usb_data.begin() + offset, transfer.actual_num_bytes, buffer.begin());
+            usb_host_transfer_submit_ExpectAndReturn(&transfer, ESP_OK);
+            bulk_transfer_callback(&transfer);
+        }
+    };
+    // URBs sized to dwMaxPayloadTransferSize: every payload transfer completes one URB, by its size or by short packet
+    auto send_payload_urbs = [&]() {
+        const size_t urb_size = stream.constant.dwMaxPayloadTransferSize;
+        std::vector<uint8_t> buffer(urb_size);
+        usb_transfer_t transfer = {
+            .data_buffer = buffer.data(),
+            .data_buffer_size = urb_size,
+            .num_bytes = (int)urb_size,
+            .actual_num_bytes = 0,
+            .flags = 0,
+            .device_handle = nullptr,
+            .bEndpointAddress = 0,
+            .status = USB_TRANSFER_STATUS_COMPLETED,
+            .timeout_ms = 0,
+            .callback = nullptr,
+            .context = &stream,
+            .num_isoc_packets = 0,
+        };
+        size_t offset = 0;
+        for (const size_t end : payload_ends) {
+            transfer.actual_num_bytes = end - offset;
+            std::copy_n(usb_data.begin() + offset, transfer.actual_num_bytes, buffer.begin());
+            usb_host_transfer_submit_ExpectAndReturn(&transfer, ESP_OK);
+            bulk_transfer_callback(&transfer);
+            offset = end;
+        }
+    };
+
+    GIVEN("Last data packet of the frame has MPS size") {
+        // EoF header follows the last data packet without short packet
+        const size_t data_len = transfer_size - HEADER_LEN + 2 * 512;
+        add_payload(0, data_len, false);
+        add_payload(0, 0, true);
+
+        WHEN("The frame is received") {
+            send_usb_data();
+            THEN("The frame is not discarded") {
+                REQUIRE(frames_received == 1);
+                REQUIRE(received_data == std::vector<uint8_t>(frame_data.begin(), frame_data.begin() + data_len));
+            }
+        }
+    }
+
+    GIVEN("Payload transfers are limited by dwMaxPayloadTransferSize") {
+        // Payload transfers follow each other within one Bulk transfer
+        stream.constant.dwMaxPayloadTransferSize = 1000;
+        add_payload(0, 988, false);
+        add_payload(988, 988, false);
+        add_payload(2 * 988, 500, true);
+
+        WHEN("The frame is received") {
+            send_usb_data();
+            THEN("Headers of all payload transfers are removed") {
+                REQUIRE(frames_received == 1);
+                REQUIRE(received_data == std::vector<uint8_t>(frame_data.begin(), frame_data.begin() + 2 * 988 + 500));
+            }
+        }
+    }
+
+    GIVEN("URBs hold one payload transfer each") {
+        stream.constant.dwMaxPayloadTransferSize = 1024;
+        add_payload(0, 1024 - HEADER_LEN, false);
+        add_payload(1024 - HEADER_LEN, 1024 - HEADER_LEN, false);
+        add_payload(2 * (1024 - HEADER_LEN), 300, false);
+        add_payload(0, 0, true);
+
+        WHEN("Each payload transfer completes one URB") {
+            send_payload_urbs();
+            THEN("The frame is assembled from payloads of all URBs") {
+                REQUIRE(frames_received == 1);
+                REQUIRE(received_data == std::vector<uint8_t>(frame_data.begin(), frame_data.begin() + 2 * (1024 - HEADER_LEN) + 300));
+            }
+        }
+    }
+
+    uvc_frame_free(&stream);
+}
+
 SCENARIO("Isochronous stream frame reconstruction", "[streaming][isoc]")
 {
     send_frame_function = test_streaming_isoc_send_frame;
@@ -258,3 +444,893 @@ SCENARIO("Isochronous stream frame reconstruction", "[streaming][isoc]")
     - Unaligned USB transfer sizes
     */
 }
+
+SCENARIO("Zero-copy payload delivery", "[streaming][payload]")
+{
+    static constexpr int user_arg = 0x12345678;
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.cb_arg = (void *)&user_arg;
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+
+    // Reassemble the frame from payload segments
+    static std::vector<uint8_t> frame_data;
+    static int frames_received;
+    static bool error_received;
+    static bool in_frame;
+    frame_data.clear();
+    frames_received = 0;
+    error_received = false;
+    in_frame = false;
+    stream.constant.payload_cb = [](const uvc_host_payload_segment_t *segments, size_t num_segments, void *user_ctx) {
+        REQUIRE(*(int *)user_ctx == user_arg);
+        for (size_t i = 0; i < num_segments; i++) {
+            if (segments[i].start_of_frame) {
+                frame_data.clear();
+                in_frame = true;
+            }
+            error_received |= segments[i].error;
+            if (in_frame) {
+                frame_data.insert(frame_data.end(), segments[i].data, segments[i].data + segments[i].data_len);
+            }
+            if (segments[i].end_of_frame && in_frame) {
+                // ISOC cameras can send more empty packets with EoF flag, count only the first one
+                frames_received++;
+                in_frame = false;
+            }
+        }
+    };
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+
+    GIVEN("Bulk stream") {
+        WHEN("A frame is received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg));
+            THEN("Payload segments contain the frame data without headers") {
+                REQUIRE(frames_received == 1);
+                REQUIRE_FALSE(error_received);
+                REQUIRE(frame_data == original_data);
+            }
+        }
+    }
+
+    GIVEN("Isochronous stream") {
+        uvc_host_payload_segment_t segments[8]; // test_streaming_isoc_send_frame() uses 8 ISOC packets per transfer
+        stream.constant.segments = segments;
+        stream.constant.max_segments = 8;
+
+        WHEN("A frame is received") {
+            test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg));
+            THEN("Payload segments contain the frame data without headers") {
+                REQUIRE(frames_received == 1);
+                REQUIRE_FALSE(error_received);
+                REQUIRE(frame_data == original_data);
+            }
+        }
+
+        WHEN("A frame with error is received") {
+            test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg), 0, true);
+            THEN("The error is signalled in payload segments") {
+                REQUIRE(error_received);
+            }
+        }
+    }
+}
+
+SCENARIO("Partial frame delivery in slices", "[streaming][slice]")
+{
+    static constexpr int user_arg = 0x12345678;
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.cb_arg = (void *)&user_arg;
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.slice_size = 1024;
+
+    // Reassemble the frame from slices
+    static std::vector<uint8_t> frame_data;
+    static int slices_received;
+    static int frames_received;
+    static bool frame_dropped;
+    frame_data.clear();
+    slices_received = 0;
+    frames_received = 0;
+    frame_dropped = false;
+    stream.constant.slice_cb = [](const uvc_host_slice_t *slice, void *user_ctx) {
+        REQUIRE(*(int *)user_ctx == user_arg);
+        if (slice->frame_dropped) {
+            frame_dropped = true;
+            frame_data.clear();
+            return;
+        }
+        REQUIRE(slice->offset == frame_data.size());
+        REQUIRE((slice->end_of_frame || slice->data_len >= 1024));
+        frame_data.insert(frame_data.end(), slice->data, slice->data + slice->data_len);
+        slices_received++;
+        if (slice->end_of_frame) {
+            frames_received++;
+        }
+    };
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+    REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+
+    GIVEN("Bulk stream") {
+        WHEN("A frame is received") {
+            test_streaming_bulk_send_frame(512, &stream, std::span(logo_jpg));
+            THEN("The frame is delivered in several slices") {
+                REQUIRE(frames_received == 1);
+                REQUIRE(slices_received > 1);
+                REQUIRE_FALSE(frame_dropped);
+                REQUIRE(frame_data == original_data);
+            }
+        }
+    }
+
+    GIVEN("Isochronous stream") {
+        WHEN("A frame is received") {
+            test_streaming_isoc_send_frame(512, &stream, std::span(logo_jpg));
+            THEN("The frame is delivered in several slices") {
+                REQUIRE(frames_received == 1);
+                REQUIRE(slices_received > 1);
+                REQUIRE_FALSE(frame_dropped);
+                REQUIRE(frame_data == original_data);
+            }
+        }
+
+        WHEN("A frame with error in EoF is received") {
+            test_streaming_isoc_send_frame(512, &stream, std::span(logo_jpg), 0, false, true);
+            THEN("Already delivered slices are invalidated") {
+                REQUIRE(frames_received == 0);
+                REQUIRE(frame_dropped);
+            }
+        }
+    }
+
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
+
+SCENARIO("Latest frame policy", "[streaming][latest]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.frame_policy = UVC_HOST_FRAME_POLICY_LATEST;
+    stream.constant.latest_frame_sem = xSemaphoreCreateBinary();
+    REQUIRE(stream.constant.latest_frame_sem != nullptr);
+    REQUIRE(uvc_frame_allocate(&stream, 2, 100 * 1024, 0) == ESP_OK);
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+    uvc_host_frame_t *frame = nullptr;
+
+    GIVEN("No frame was received") {
+        THEN("uvc_host_frame_get_latest() times out") {
+            REQUIRE(uvc_host_frame_get_latest(&stream, &frame, 0) == ESP_ERR_TIMEOUT);
+        }
+    }
+
+    GIVEN("Bulk stream") {
+        WHEN("More frames are received than there are frame buffers") {
+            for (uint8_t i = 0; i < 4; i++) {
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), i % 2);
+            }
+            THEN("Only the newest frame is kept and no frame is skipped") {
+                REQUIRE(stream.stats.frames_delivered == 4);
+                REQUIRE(stream.stats.frames_overwritten == 3);
+                REQUIRE(stream.stats.skipped_underflow == 0);
+                REQUIRE(uvc_host_frame_get_latest(&stream, &frame, 0) == ESP_OK);
+                REQUIRE(frame->info.sequence == 4);
+                REQUIRE(std::vector<uint8_t>(frame->data, frame->data + frame->data_len) == original_data);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                REQUIRE(uvc_host_frame_get_latest(&stream, &frame, 0) == ESP_ERR_TIMEOUT);
+            }
+        }
+
+        WHEN("The user holds one frame while more frames are received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+            REQUIRE(uvc_host_frame_get_latest(&stream, &frame, 0) == ESP_OK);
+            for (uint8_t i = 1; i < 4; i++) {
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), i % 2);
+            }
+            THEN("The unconsumed frame buffer is reclaimed instead of underflow") {
+                REQUIRE(stream.stats.frames_delivered == 4);
+                REQUIRE(stream.stats.frames_overwritten == 2);
+                REQUIRE(stream.stats.skipped_underflow == 0);
+
+                uvc_host_frame_t *newest;
+                REQUIRE(uvc_host_frame_get_latest(&stream, &newest, 0) == ESP_OK);
+                REQUIRE(newest != frame);
+                REQUIRE(newest->info.sequence == 4);
+                REQUIRE(uvc_host_frame_return(&stream, newest) == ESP_OK);
+            }
+            REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+        }
+    }
+
+    GIVEN("Isochronous stream") {
+        WHEN("A frame is received") {
+            test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg));
+            THEN("The frame is taken with uvc_host_frame_get_latest()") {
+                REQUIRE(uvc_host_frame_get_latest(&stream, &frame, 0) == ESP_OK);
+                REQUIRE(std::vector<uint8_t>(frame->data, frame->data + frame->data_len) == original_data);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+            }
+        }
+    }
+
+    // Unconsumed frame is returned when the stream is paused
+    stream.dynamic.streaming = false;
+    uvc_frame_latest_release(&stream);
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+    vSemaphoreDelete(stream.constant.latest_frame_sem);
+}
+
+SCENARIO("Acquire frame policy", "[streaming][acquire]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.frame_policy = UVC_HOST_FRAME_POLICY_ACQUIRE;
+    REQUIRE(uvc_frame_allocate(&stream, 2, 100 * 1024, 0) == ESP_OK);
+    stream.constant.frame_queue = xQueueCreate(stream.constant.num_of_frames, sizeof(uvc_host_frame_t *));
+    REQUIRE(stream.constant.frame_queue != nullptr);
+    // Frame buffer underflow is expected when the user holds all frames
+    static int underflows;
+    underflows = 0;
+    stream.constant.stream_cb = [](const uvc_host_stream_event_data_t *event, void *user_ctx) {
+        REQUIRE(event->type == UVC_HOST_FRAME_BUFFER_UNDERFLOW);
+        underflows++;
+    };
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+    uvc_host_frame_t *frame = nullptr;
+
+    GIVEN("No frame was received") {
+        THEN("uvc_host_frame_acquire() times out") {
+            REQUIRE(uvc_host_frame_acquire(&stream, &frame, 0) == ESP_ERR_TIMEOUT);
+            REQUIRE(uvc_host_frame_get_latest(&stream, &frame, 0) == ESP_ERR_INVALID_STATE);
+        }
+    }
+
+    GIVEN("Bulk stream") {
+        WHEN("The user holds all frames while another frame is received") {
+            for (uint8_t i = 0; i < 3; i++) {
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), i % 2);
+            }
+            THEN("Frames are acquired in order and the new frame is skipped") {
+                REQUIRE(stream.stats.frames_delivered == 2);
+                REQUIRE(stream.stats.skipped_underflow == 1);
+                REQUIRE(underflows == 1);
+
+                uvc_host_frame_t *second;
+                REQUIRE(uvc_host_frame_acquire(&stream, &frame, 0) == ESP_OK);
+                REQUIRE(uvc_host_frame_acquire(&stream, &second, 0) == ESP_OK);
+                REQUIRE(frame->info.sequence == 1);
+                REQUIRE(second->info.sequence == 2);
+                REQUIRE(std::vector<uint8_t>(second->data, second->data + second->data_len) == original_data);
+                REQUIRE(uvc_host_frame_acquire(&stream, &frame, 0) == ESP_ERR_TIMEOUT);
+                REQUIRE(uvc_host_frame_return(&stream, second) == ESP_OK);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+            }
+        }
+    }
+
+    GIVEN("Isochronous stream") {
+        WHEN("A frame is received") {
+            test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg));
+            THEN("The frame is taken with uvc_host_frame_acquire()") {
+                REQUIRE(uvc_host_frame_acquire(&stream, &frame, 0) == ESP_OK);
+                REQUIRE(std::vector<uint8_t>(frame->data, frame->data + frame->data_len) == original_data);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+            }
+
+            AND_WHEN("The stream is paused") {
+                stream.dynamic.streaming = false;
+                uvc_frame_queue_release(&stream);
+                THEN("Queued frames are returned") {
+                    REQUIRE(uvc_host_frame_acquire(&stream, &frame, 0) == ESP_ERR_TIMEOUT);
+                }
+            }
+        }
+    }
+
+    stream.dynamic.streaming = false;
+    uvc_frame_queue_release(&stream);
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+    vQueueDelete(stream.constant.frame_queue);
+}
+
+/**
+ * @brief Mock stream that takes its frame buffers from shared frame pool
+ *
+ * Frames are held in the acquire queue until the test takes and returns them.
+ */
+static void shared_pool_stream_init(uvc_stream_t *stream, uvc_frame_slab_pool_t *pool, int nb_of_fb, int nb_reserved)
+{
+    stream->single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream->dynamic.streaming = true;
+    stream->constant.frame_policy = UVC_HOST_FRAME_POLICY_ACQUIRE;
+    REQUIRE(uvc_frame_allocate_shared(stream, pool, nb_of_fb, nb_reserved) == ESP_OK);
+    stream->constant.frame_queue = xQueueCreate(stream->constant.num_of_frames, sizeof(uvc_host_frame_t *));
+    REQUIRE(stream->constant.frame_queue != nullptr);
+}
+
+static void shared_pool_stream_deinit(uvc_stream_t *stream)
+{
+    stream->dynamic.streaming = false;
+    uvc_frame_queue_release(stream);
+    REQUIRE(uvc_frame_are_all_returned(stream));
+    uvc_frame_free(stream);
+    vQueueDelete(stream->constant.frame_queue);
+}
+
+SCENARIO("Shared frame pool", "[streaming][pool]")
+{
+    uvc_frame_slab_pool_t *pool = nullptr;
+    REQUIRE(uvc_frame_pool_create(3, 100 * 1024, 0, &pool) == ESP_OK);
+    uvc_stream_t camera_a = {}; // Define mock streams
+    uvc_stream_t camera_b = {};
+    shared_pool_stream_init(&camera_a, pool, 3, 1);
+    shared_pool_stream_init(&camera_b, pool, 2, 1);
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+    uvc_host_frame_t *frame = nullptr;
+    uvc_host_frame_t *second = nullptr;
+
+    GIVEN("Two streams with one reserved frame buffer each") {
+        THEN("Reservation of another stream fails if the pool cannot satisfy it") {
+            uvc_stream_t camera_c = {};
+            REQUIRE(uvc_frame_allocate_shared(&camera_c, pool, 2, 2) == ESP_ERR_NO_MEM);
+            REQUIRE(camera_c.constant.frames == nullptr);
+            REQUIRE(uvc_frame_allocate_shared(&camera_c, pool, 1, 2) == ESP_ERR_INVALID_ARG);
+        }
+
+        WHEN("Camera A holds more frames than its reservation") {
+            for (uint8_t i = 0; i < 3; i++) {
+                test_streaming_bulk_send_frame(1024, &camera_a, std::span(logo_jpg), i % 2);
+            }
+            THEN("It takes the free slab of the pool and skips the frame when the pool is empty") {
+                REQUIRE(camera_a.stats.frames_delivered == 2);
+                REQUIRE(camera_a.stats.skipped_underflow == 1);
+                REQUIRE(uvc_host_frame_acquire(&camera_a, &frame, 0) == ESP_OK);
+                REQUIRE(uvc_host_frame_acquire(&camera_a, &second, 0) == ESP_OK);
+                REQUIRE(frame->data_buffer_len == 100 * 1024);
+                REQUIRE(second->data_buffer_len == 100 * 1024);
+                REQUIRE(frame->data != second->data);
+                REQUIRE(std::vector<uint8_t>(second->data, second->data + second->data_len) == original_data);
+                REQUIRE(uvc_host_frame_return(&camera_a, second) == ESP_OK);
+                REQUIRE(uvc_host_frame_return(&camera_a, frame) == ESP_OK);
+            }
+
+            AND_THEN("Camera B still gets its reserved frame buffer, but not more") {
+                test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 0);
+                test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 1);
+                REQUIRE(camera_b.stats.frames_delivered == 1);
+                REQUIRE(camera_b.stats.skipped_underflow == 1);
+            }
+
+            AND_WHEN("Camera A returns its frames") {
+                REQUIRE(uvc_host_frame_acquire(&camera_a, &frame, 0) == ESP_OK);
+                REQUIRE(uvc_host_frame_return(&camera_a, frame) == ESP_OK);
+                REQUIRE(uvc_host_frame_acquire(&camera_a, &frame, 0) == ESP_OK);
+                REQUIRE(uvc_host_frame_return(&camera_a, frame) == ESP_OK);
+                THEN("The slab above its reservation can be used by camera B") {
+                    test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 0);
+                    test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 1);
+                    REQUIRE(camera_b.stats.frames_delivered == 2);
+                    REQUIRE(camera_b.stats.skipped_underflow == 0);
+                }
+            }
+        }
+
+        WHEN("Camera A is paused in the middle of a frame that is not reserved") {
+            test_streaming_bulk_send_frame(1024, &camera_a, std::span(logo_jpg), 0);
+            uvc_host_frame_t *held = uvc_frame_get_empty(&camera_a);
+            REQUIRE(held != nullptr);
+            REQUIRE(held->data != nullptr);
+            uvc_frame_return_current(&camera_a, held);
+            THEN("The frame buffer keeps its slab until the stream's pool is trimmed") {
+                REQUIRE(held->data != nullptr);
+                test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 0);
+                test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 1);
+                REQUIRE(camera_b.stats.skipped_underflow == 1);
+
+                uvc_frame_pool_trim(&camera_a);
+                REQUIRE(held->data == nullptr);
+                REQUIRE(uvc_host_frame_acquire(&camera_b, &frame, 0) == ESP_OK);
+                REQUIRE(uvc_host_frame_return(&camera_b, frame) == ESP_OK);
+                test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 0);
+                test_streaming_isoc_send_frame(1024, &camera_b, std::span(logo_jpg), 1);
+                REQUIRE(camera_b.stats.frames_delivered == 3);
+            }
+        }
+    }
+
+    shared_pool_stream_deinit(&camera_a);
+    shared_pool_stream_deinit(&camera_b);
+    uvc_frame_pool_delete(pool);
+}
+
+/**
+ * @brief Append NAL unit with start code to Annex B byte stream
+ *
+ * @param stream    Byte stream
+ * @param header    NAL unit header
+ * @param body_len  Length of NAL unit body. It never contains a start code
+ * @param long_code Use 4 byte start code
+ */
+static void append_nal_unit(std::vector<uint8_t> &stream, std::initializer_list<uint8_t> header, size_t body_len, bool long_code = true)
+{
+    if (long_code) {
+        stream.push_back(0x00);
+    }
+    stream.insert(stream.end(), {0x00, 0x00, 0x01});
+    stream.insert(stream.end(), header);
+    stream.insert(stream.end(), body_len, 0xAB);
+}
+
+SCENARIO("NAL units of frame based formats", "[streaming][nal]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    static uvc_host_frame_info_t info;
+    info = {};
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        info = frame->info;
+        return true;
+    };
+    REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+    std::vector<uint8_t> params;
+    size_t params_len = 0;
+
+    GIVEN("H.264 stream") {
+        stream.constant.vs_format.format = UVC_VS_FORMAT_H264;
+        std::vector<uint8_t> keyframe;
+        append_nal_unit(keyframe, {0x67}, 10);             // SPS
+        append_nal_unit(keyframe, {0x68}, 3);              // PPS
+        append_nal_unit(keyframe, {0x65}, 20000, false);   // IDR slice, 3 byte start code
+        std::vector<uint8_t> non_reference;
+        append_nal_unit(non_reference, {0x01}, 5000);      // Non-reference slice, nal_ref_idc = 0
+
+        WHEN("No parameter sets were received") {
+            THEN("There are no cached parameter sets") {
+                REQUIRE(uvc_host_stream_get_parameter_sets(&stream, nullptr, &params_len) == ESP_ERR_NOT_FOUND);
+            }
+        }
+
+        for (size_t transfer_size : {512, 1024, 3072}) {
+            WHEN("A keyframe is received over ISOC, transfer_size = " + std::to_string(transfer_size)) {
+                test_streaming_isoc_send_frame(transfer_size, &stream, std::span(keyframe));
+                THEN("NAL units are listed in frame metadata") {
+                    REQUIRE(info.nal.num_units == 3);
+                    REQUIRE_FALSE(info.nal.overflow);
+                    REQUIRE(info.nal.keyframe);
+                    REQUIRE(info.nal.reference);
+                    REQUIRE(info.nal.parameter_sets);
+                    REQUIRE(info.nal.units[0].offset == 4);
+                    REQUIRE(info.nal.units[0].size == 11);
+                    REQUIRE(info.nal.units[0].type == 7);
+                    REQUIRE(info.nal.units[1].offset == 19);
+                    REQUIRE(info.nal.units[1].size == 4);
+                    REQUIRE(info.nal.units[1].type == 8);
+                    REQUIRE(info.nal.units[2].offset == 26);
+                    REQUIRE(info.nal.units[2].size == 20001);
+                    REQUIRE(info.nal.units[2].type == 5);
+                }
+                AND_THEN("SPS and PPS are cached") {
+                    params_len = 64;
+                    REQUIRE(uvc_host_stream_get_parameter_sets(&stream, nullptr, &params_len) == ESP_ERR_INVALID_ARG);
+                    params_len = 0;
+                    REQUIRE(uvc_host_stream_get_parameter_sets(&stream, nullptr, &params_len) == ESP_ERR_INVALID_SIZE);
+                    params.resize(64);
+                    REQUIRE(params_len == 4 + 11 + 4 + 4);
+                    REQUIRE(uvc_host_stream_get_parameter_sets(&stream, params.data(), &params_len) == ESP_OK);
+                    params.resize(params_len);
+                    REQUIRE(params == std::vector<uint8_t>(keyframe.begin(), keyframe.begin() + params_len));
+                }
+
+                AND_WHEN("Non-reference frame is received") {
+                    test_streaming_isoc_send_frame(transfer_size, &stream, std::span(non_reference), 1);
+                    THEN("It can be dropped and the parameter sets stay cached") {
+                        REQUIRE(info.nal.num_units == 1);
+                        REQUIRE_FALSE(info.nal.keyframe);
+                        REQUIRE_FALSE(info.nal.reference);
+                        REQUIRE_FALSE(info.nal.parameter_sets);
+                        REQUIRE(info.nal.units[0].size == 5001);
+                        params_len = 0;
+                        REQUIRE(uvc_host_stream_get_parameter_sets(&stream, nullptr, &params_len) == ESP_ERR_INVALID_SIZE);
+                        REQUIRE(params_len == 4 + 11 + 4 + 4);
+                    }
+                }
+            }
+
+            WHEN("A keyframe is received over Bulk, transfer_size = " + std::to_string(transfer_size)) {
+                test_streaming_bulk_send_frame(transfer_size, &stream, std::span(keyframe));
+                THEN("NAL units are listed in frame metadata") {
+                    REQUIRE(info.nal.num_units == 3);
+                    REQUIRE(info.nal.keyframe);
+                    REQUIRE(info.nal.units[2].offset == 26);
+                    REQUIRE(info.nal.units[2].size == 20001);
+                }
+            }
+        }
+
+        WHEN("A frame has more NAL units than can be listed") {
+            std::vector<uint8_t> many;
+            for (int i = 0; i < UVC_HOST_FRAME_NAL_UNITS_MAX; i++) {
+                append_nal_unit(many, {0x01}, 100);
+            }
+            append_nal_unit(many, {0x25}, 100); // IDR slice after the listed units
+            test_streaming_isoc_send_frame(1024, &stream, std::span(many));
+            THEN("Flags cover all NAL units") {
+                REQUIRE(info.nal.num_units == UVC_HOST_FRAME_NAL_UNITS_MAX);
+                REQUIRE(info.nal.overflow);
+                REQUIRE(info.nal.keyframe);
+                REQUIRE(info.nal.reference);
+            }
+        }
+    }
+
+    GIVEN("H.265 stream") {
+        stream.constant.vs_format.format = UVC_VS_FORMAT_H265;
+        std::vector<uint8_t> keyframe;
+        append_nal_unit(keyframe, {0x40, 0x01}, 20);  // VPS
+        append_nal_unit(keyframe, {0x42, 0x01}, 30);  // SPS
+        append_nal_unit(keyframe, {0x44, 0x01}, 5);   // PPS
+        append_nal_unit(keyframe, {0x26, 0x01}, 8000); // IDR_W_RADL
+        std::vector<uint8_t> non_reference;
+        append_nal_unit(non_reference, {0x00, 0x01}, 3000); // TRAIL_N
+
+        WHEN("A keyframe and a non-reference frame are received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(keyframe));
+            THEN("VPS, SPS and PPS are cached") {
+                REQUIRE(info.nal.num_units == 4);
+                REQUIRE(info.nal.keyframe);
+                REQUIRE(info.nal.reference);
+                REQUIRE(info.nal.parameter_sets);
+                REQUIRE(info.nal.units[3].type == 19);
+                params.resize(UVC_NAL_PARAMETER_SETS_SIZE);
+                params_len = params.size();
+                REQUIRE(uvc_host_stream_get_parameter_sets(&stream, params.data(), &params_len) == ESP_OK);
+                REQUIRE(params_len == 3 * 4 + 22 + 32 + 7);
+            }
+
+            test_streaming_bulk_send_frame(1024, &stream, std::span(non_reference), 1);
+            THEN("Non-reference frame is flagged") {
+                REQUIRE(info.nal.units[0].type == 0);
+                REQUIRE_FALSE(info.nal.reference);
+                REQUIRE_FALSE(info.nal.keyframe);
+            }
+        }
+    }
+
+    GIVEN("MJPEG stream") {
+        stream.constant.vs_format.format = UVC_VS_FORMAT_MJPEG;
+        std::vector<uint8_t> frame;
+        append_nal_unit(frame, {0x65}, 1000);
+        WHEN("A frame containing start code is received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(frame));
+            THEN("No NAL units are listed") {
+                REQUIRE(info.nal.num_units == 0);
+                REQUIRE_FALSE(info.nal.keyframe);
+            }
+        }
+    }
+
+    uvc_frame_free(&stream);
+}
+
+SCENARIO("MJPEG integrity check", "[streaming][mjpeg]")
+{
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+
+    GIVEN("JPEG images") {
+        THEN("Valid image is intact") {
+            REQUIRE(uvc_mjpeg_is_intact(original_data.data(), original_data.size()));
+        }
+        THEN("Image padded with zeros after EOI is intact") {
+            std::vector<uint8_t> padded = original_data;
+            padded.resize(padded.size() + 16, 0x00);
+            REQUIRE(uvc_mjpeg_is_intact(padded.data(), padded.size()));
+        }
+        THEN("Truncated image is not intact") {
+            REQUIRE_FALSE(uvc_mjpeg_is_intact(original_data.data(), original_data.size() - 100));
+            REQUIRE_FALSE(uvc_mjpeg_is_intact(original_data.data(), 3000)); // Ends in header segments
+        }
+        THEN("Image without SOI is not intact") {
+            REQUIRE_FALSE(uvc_mjpeg_is_intact(original_data.data() + 2, original_data.size() - 2));
+        }
+        THEN("Image with corrupted segment length is not intact") {
+            std::vector<uint8_t> corrupted = original_data;
+            corrupted[4] = 0xFF; // Length of APP0 segment points beyond the image
+            REQUIRE_FALSE(uvc_mjpeg_is_intact(corrupted.data(), corrupted.size()));
+        }
+    }
+
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.vs_format.format = UVC_VS_FORMAT_MJPEG;
+    static int frames_received;
+    static bool corrupted_received;
+    frames_received = 0;
+    corrupted_received = false;
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        frames_received++;
+        corrupted_received |= frame->info.corrupted;
+        return true;
+    };
+    REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+    const std::span<const uint8_t> truncated(logo_jpg.data(), logo_jpg.size() - 100);
+
+    GIVEN("Corrupted frames are dropped") {
+        stream.constant.mjpeg_check = UVC_HOST_MJPEG_CHECK_DROP;
+
+        WHEN("Truncated frame is received followed by a valid one") {
+            test_streaming_isoc_send_frame(1024, &stream, truncated, 0);
+            test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg), 1);
+            THEN("Only the valid frame is delivered") {
+                REQUIRE(frames_received == 1);
+                REQUIRE_FALSE(corrupted_received);
+                REQUIRE(stream.stats.skipped_corrupted == 1);
+                REQUIRE(stream.stats.frames_delivered == 1);
+            }
+        }
+
+        WHEN("Frame is much smaller than recent frames") {
+            stream.single_thread.mjpeg_size_avg = logo_jpg.size() * 10;
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg));
+            THEN("The frame is dropped") {
+                REQUIRE(frames_received == 0);
+                REQUIRE(stream.stats.skipped_corrupted == 1);
+            }
+        }
+    }
+
+    GIVEN("Corrupted frames are flagged") {
+        stream.constant.mjpeg_check = UVC_HOST_MJPEG_CHECK_FLAG;
+
+        WHEN("Truncated frame is received") {
+            test_streaming_isoc_send_frame(1024, &stream, truncated);
+            THEN("The frame is delivered as corrupted") {
+                REQUIRE(frames_received == 1);
+                REQUIRE(corrupted_received);
+                REQUIRE(stream.stats.skipped_corrupted == 0);
+            }
+        }
+    }
+
+    GIVEN("Check is enabled for other format") {
+        stream.constant.mjpeg_check = UVC_HOST_MJPEG_CHECK_DROP;
+        stream.constant.vs_format.format = UVC_VS_FORMAT_YUY2;
+
+        WHEN("Truncated frame is received") {
+            test_streaming_isoc_send_frame(1024, &stream, truncated);
+            THEN("The frame is not checked") {
+                REQUIRE(frames_received == 1);
+                REQUIRE_FALSE(corrupted_received);
+            }
+        }
+    }
+
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
+
+SCENARIO("Frame decimation", "[streaming][decimation]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.frame_decimation = 3;
+    static std::vector<uint32_t> sequences;
+    sequences.clear();
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        REQUIRE(frame->data_len == logo_jpg.size());
+        sequences.push_back(frame->info.sequence);
+        return true;
+    };
+    REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+
+    for (bool isoc : {false, true}) {
+        GIVEN(isoc ? "Isochronous stream" : "Bulk stream") {
+            WHEN("Six frames are received") {
+                for (uint8_t i = 0; i < 6; i++) {
+                    if (isoc) {
+                        test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg), i % 2);
+                    } else {
+                        test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), i % 2);
+                    }
+                }
+                THEN("First frame and every third frame after it are delivered") {
+                    REQUIRE(sequences == std::vector<uint32_t>({1, 4}));
+                    REQUIRE(stream.stats.frames_delivered == 2);
+                    REQUIRE(stream.stats.frames_decimated == 4);
+                    REQUIRE(stream.stats.skipped_error == 0);
+                    REQUIRE(stream.stats.skipped_underflow == 0);
+                }
+            }
+        }
+    }
+
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
+
+SCENARIO("Still image frames", "[streaming][still]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.vs_format = {640, 480, 30, UVC_VS_FORMAT_MJPEG};
+    stream.constant.frame_decimation = 3;
+    stream.constant.still.committed = true;
+    stream.constant.still.h_res = 1920;
+    stream.constant.still.v_res = 1080;
+    static std::vector<std::pair<uint32_t, unsigned>> frames; // Sequence and horizontal resolution of still images, 0 for video frames
+    frames.clear();
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        REQUIRE(frame->data_len == logo_jpg.size());
+        REQUIRE(frame->vs_format.v_res == (frame->info.still_image ? 1080 : 480));
+        frames.push_back({frame->info.sequence, frame->info.still_image ? frame->vs_format.h_res : 0});
+        return true;
+    };
+    REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+
+    for (bool isoc : {false, true}) {
+        GIVEN(isoc ? "Isochronous stream" : "Bulk stream") {
+            WHEN("Still image is received between video frames") {
+                for (uint8_t i = 0; i < 3; i++) {
+                    const bool still_image = (i == 1);
+                    if (isoc) {
+                        test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg), i % 2, false, false, still_image);
+                    } else {
+                        test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), i % 2, false, false, still_image);
+                    }
+                }
+                THEN("Still image is delivered with its resolution and is not decimated") {
+                    REQUIRE(frames == std::vector<std::pair<uint32_t, unsigned>>({{1, 0}, {2, 1920}}));
+                    REQUIRE(stream.stats.frames_decimated == 1);
+                }
+            }
+        }
+    }
+
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
+
+SCENARIO("Region of interest of uncompressed frames", "[streaming][roi]")
+{
+    constexpr unsigned h_res = 32;
+    constexpr unsigned v_res = 16;
+    const uvc_host_stream_format_t vs_format = {
+        .h_res = h_res,
+        .v_res = v_res,
+        .fps = 30,
+        .format = UVC_VS_FORMAT_YUY2,
+    };
+    std::vector<uint8_t> yuy2(h_res * v_res * 2);
+    for (size_t i = 0; i < yuy2.size(); i++) {
+        yuy2[i] = (uint8_t)(i * 7 + i / 256);
+    }
+
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    stream.constant.vs_format = vs_format;
+
+    GIVEN("Window that does not fit") {
+        THEN("It is refused") {
+            const uvc_host_stream_format_t mjpeg = {.h_res = h_res, .v_res = v_res, .fps = 30, .format = UVC_VS_FORMAT_MJPEG};
+            const uvc_host_roi_t valid = {.x = 4, .y = 3, .width = 8, .height = 5};
+            const uvc_host_roi_t odd_x = {.x = 3, .y = 3, .width = 8, .height = 5};
+            const uvc_host_roi_t too_wide = {.x = 4, .y = 3, .width = h_res, .height = 5};
+            const uvc_host_roi_t too_high = {.x = 4, .y = 3, .width = 8, .height = v_res};
+            REQUIRE(uvc_frame_roi_set(&stream, &valid, &mjpeg) == ESP_ERR_INVALID_ARG);
+            REQUIRE(uvc_frame_roi_set(&stream, &odd_x, &vs_format) == ESP_ERR_INVALID_ARG);
+            REQUIRE(uvc_frame_roi_set(&stream, &too_wide, &vs_format) == ESP_ERR_INVALID_ARG);
+            REQUIRE(uvc_frame_roi_set(&stream, &too_high, &vs_format) == ESP_ERR_INVALID_ARG);
+            REQUIRE(uvc_frame_roi_size(&stream) == 0);
+        }
+    }
+
+    GIVEN("Window inside the frame") {
+        const uvc_host_roi_t roi = {.x = 4, .y = 3, .width = 8, .height = 5};
+        REQUIRE(uvc_frame_roi_set(&stream, &roi, &vs_format) == ESP_OK);
+        REQUIRE(uvc_frame_roi_size(&stream) == roi.width * roi.height * 2);
+        REQUIRE(uvc_frame_allocate(&stream, 1, uvc_frame_roi_size(&stream), 0) == ESP_OK);
+
+        static std::vector<uint8_t> expected;
+        expected.clear();
+        for (unsigned row = roi.y; row < roi.y + roi.height; row++) {
+            const auto row_start = yuy2.begin() + (row * h_res + roi.x) * 2;
+            expected.insert(expected.end(), row_start, row_start + roi.width * 2);
+        }
+        static int frames_received;
+        frames_received = 0;
+        stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+            REQUIRE(frame->vs_format.h_res == 8);
+            REQUIRE(frame->vs_format.v_res == 5);
+            REQUIRE(std::vector<uint8_t>(frame->data, frame->data + frame->data_len) == expected);
+            frames_received++;
+            return true;
+        };
+
+        WHEN("Bulk frames are received") {
+            test_streaming_bulk_send_frame(512, &stream, std::span(yuy2), 0);
+            test_streaming_bulk_send_frame(512, &stream, std::span(yuy2), 1);
+            THEN("Only the window is stored in frame buffers") {
+                REQUIRE(frames_received == 2);
+            }
+        }
+
+        WHEN("Isochronous frames are received") {
+            test_streaming_isoc_send_frame(512, &stream, std::span(yuy2), 0);
+            test_streaming_isoc_send_frame(512, &stream, std::span(yuy2), 1);
+            THEN("Only the window is stored in frame buffers") {
+                REQUIRE(frames_received == 2);
+            }
+        }
+
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("Frame subscribers with reference counting", "[streaming][subscribe]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream.dynamic.streaming = true;
+    REQUIRE(uvc_frame_allocate(&stream, 2, 100 * 1024, 0) == ESP_OK);
+    const std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+
+    // The display only looks at the frame, the recorder keeps it for later
+    static std::vector<uvc_host_frame_t *> displayed;
+    static std::vector<uvc_host_frame_t *> recorded;
+    displayed.clear();
+    recorded.clear();
+    const uvc_host_frame_subscriber_cb_t display_cb = [](uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame, void *user_ctx) {
+        displayed.push_back(frame);
+    };
+    const uvc_host_frame_subscriber_cb_t recorder_cb = [](uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame, void *user_ctx) {
+        REQUIRE(uvc_host_frame_ref(stream_hdl, frame) == ESP_OK);
+        recorded.push_back(frame);
+    };
+    REQUIRE(uvc_host_frame_subscribe(&stream, display_cb, nullptr) == ESP_OK);
+    REQUIRE(uvc_host_frame_subscribe(&stream, recorder_cb, nullptr) == ESP_OK);
+
+    GIVEN("Frame received") {
+        test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg));
+
+        THEN("All subscribers get the same frame buffer") {
+            REQUIRE(displayed.size() == 1);
+            REQUIRE(recorded.size() == 1);
+            REQUIRE(displayed[0] == recorded[0]);
+            REQUIRE(std::vector<uint8_t>(recorded[0]->data, recorded[0]->data + recorded[0]->data_len) == original_data);
+            REQUIRE(uvc_host_frame_unref(&stream, recorded[0]) == ESP_OK);
+        }
+
+        THEN("The frame is returned only after the last reference is dropped") {
+            REQUIRE_FALSE(uvc_frame_are_all_returned(&stream));
+            REQUIRE(uvc_host_frame_unref(&stream, recorded[0]) == ESP_OK);
+            REQUIRE(uvc_frame_are_all_returned(&stream));
+            REQUIRE(uvc_host_frame_ref(&stream, recorded[0]) == ESP_ERR_INVALID_STATE);
+            REQUIRE(uvc_host_frame_unref(&stream, recorded[0]) == ESP_FAIL);
+        }
+
+        AND_WHEN("The recorder unsubscribes") {
+            REQUIRE(uvc_host_frame_unsubscribe(&stream, recorder_cb, nullptr) == ESP_OK);
+            REQUIRE(uvc_host_frame_unsubscribe(&stream, recorder_cb, nullptr) == ESP_ERR_NOT_FOUND);
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 1);
+            THEN("Only the display gets the next frame") {
+                REQUIRE(displayed.size() == 2);
+                REQUIRE(recorded.size() == 1);
+                REQUIRE(displayed[1] != recorded[0]);
+            }
+            REQUIRE(uvc_host_frame_unref(&stream, recorded[0]) == ESP_OK);
+        }
+    }
+
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
@@ -0,0 +1,260 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "usb/usb_types_stack.h"
+#include "usb/usb_types_uvc.h"
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+#include "uvc_frame_priv.h"
+#include "test_streaming_helpers.hpp"
+
+/*
+ * Frame reconstruction benchmark
+ *
+ * Synthetic frames are split into ISOC or Bulk URBs in advance and then fed through isoc_transfer_callback()
+ * and bulk_transfer_callback() as fast as possible. Only the driver's hot path is measured, results are printed
+ * in ns per byte of frame data and ns per USB packet, so they can be compared between CI runs.
+ *
+ * Environment variables:
+ * - UVC_BENCHMARK_FRAMES:          Number of frames sent in each configuration (default 50)
+ * - UVC_BENCHMARK_MAX_NS_PER_BYTE: If set, the test fails when any configuration is slower than this
+ */
+
+constexpr size_t frame_size = 400 * 1024;
+constexpr uint8_t frame_data = 0xA5;
+
+/**
+ * @brief ISOC bus configuration
+ */
+struct isoc_config_t {
+    const char *name;
+    size_t packet_size;     // Bytes per (micro)frame, including payload header
+    int packets_per_urb;
+};
+
+/**
+ * @brief Bulk bus configuration
+ */
+struct bulk_config_t {
+    const char *name;
+    uint16_t mps;
+    size_t urb_size;
+    uint32_t max_payload;   // dwMaxPayloadTransferSize
+};
+
+/**
+ * @brief Benchmark result
+ */
+struct benchmark_result_t {
+    double ns_per_byte;
+    double ns_per_packet;
+};
+
+static int benchmark_frames(void)
+{
+    const char *frames = getenv("UVC_BENCHMARK_FRAMES");
+    return frames ? atoi(frames) : 50;
+}
+
+static void benchmark_check(const char *name, const benchmark_result_t &result)
+{
+    printf("%-52s %6.3f ns/B %8.1f ns/packet %8.0f MB/s\n", name, result.ns_per_byte, result.ns_per_packet, 1000.0 / result.ns_per_byte);
+    const char *max_ns_per_byte = getenv("UVC_BENCHMARK_MAX_NS_PER_BYTE");
+    if (max_ns_per_byte) {
+        CHECK(result.ns_per_byte <= atof(max_ns_per_byte));
+    }
+}
+
+/**
+ * @brief Set of URBs that carry one frame
+ */
+class frame_urbs {
+public:
+    usb_transfer_t *add(size_t buffer_size, int num_isoc_packets, void *context)
+    {
+        const size_t urb_size = sizeof(usb_transfer_t) + num_isoc_packets * sizeof(usb_isoc_packet_desc_t);
+        auto urb = std::make_unique<uint8_t[]>(urb_size);
+        auto buffer = std::make_unique<uint8_t[]>(buffer_size);
+        usb_transfer_t *transfer = new (urb.get()) usb_transfer_t{
+            .data_buffer = buffer.get(),
+            .data_buffer_size = buffer_size,
+            .num_bytes = (int)buffer_size,
+            .actual_num_bytes = 0,
+            .flags = 0,
+            .device_handle = nullptr,
+            .bEndpointAddress = 0,
+            .status = USB_TRANSFER_STATUS_COMPLETED,
+            .timeout_ms = 0,
+            .callback = nullptr,
+            .context = context,
+            .num_isoc_packets = num_isoc_packets,
+        };
+        transfers.push_back(transfer);
+        urbs.push_back(std::move(urb));
+        buffers.push_back(std::move(buffer));
+        return transfer;
+    }
+
+    void send(void (*callback)(usb_transfer_t *))
+    {
+        for (usb_transfer_t *transfer : transfers) {
+            callback(transfer);
+        }
+    }
+
+    std::vector<usb_transfer_t *> transfers;
+    size_t packets = 0;
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> urbs;
+    std::vector<std::unique_ptr<uint8_t[]>> buffers;
+};
+
+static void payload_header_fill(uint8_t *buf, uint8_t frame_id, bool end_of_frame)
+{
+    uvc_payload_header_t *header = reinterpret_cast<uvc_payload_header_t *>(buf);
+    header->bHeaderLength = HEADER_LEN;
+    header->bmHeaderInfo.val = 0;
+    header->bmHeaderInfo.end_of_header = 1;
+    header->bmHeaderInfo.frame_id = frame_id;
+    header->bmHeaderInfo.end_of_frame = end_of_frame;
+}
+
+/**
+ * @brief Split frame into ISOC URBs. Every packet carries payload header, packets after End of Frame are empty
+ */
+static void isoc_frame_urbs_create(frame_urbs &frame, const isoc_config_t &config, void *context, uint8_t frame_id)
+{
+    const size_t data_per_packet = config.packet_size - HEADER_LEN;
+    const size_t packets = (frame_size + data_per_packet - 1) / data_per_packet;
+    size_t offset = 0;
+    for (size_t first = 0; first < packets; first += config.packets_per_urb) {
+        usb_transfer_t *transfer = frame.add(config.packets_per_urb * config.packet_size, config.packets_per_urb, context);
+        for (int i = 0; i < config.packets_per_urb; i++) {
+            uint8_t *packet = transfer->data_buffer + i * config.packet_size;
+            const size_t data_len = std::min(data_per_packet, frame_size - offset);
+            payload_header_fill(packet, frame_id, offset + data_len == frame_size);
+            memset(packet + HEADER_LEN, frame_data, data_len);
+            transfer->isoc_packet_desc[i].num_bytes = config.packet_size;
+            transfer->isoc_packet_desc[i].actual_num_bytes = (offset < frame_size) ? HEADER_LEN + data_len : 0;
+            transfer->isoc_packet_desc[i].status = USB_TRANSFER_STATUS_COMPLETED;
+            offset += data_len;
+        }
+        frame.packets += config.packets_per_urb;
+    }
+}
+
+/**
+ * @brief Split frame into Bulk URBs
+ *
+ * The frame is sent in payload transfers of dwMaxPayloadTransferSize bytes, each starting with a header.
+ * The last payload transfer has EoF bit set and ends with a short transfer.
+ */
+static void bulk_frame_urbs_create(frame_urbs &frame, const bulk_config_t &config, void *context, uint8_t frame_id)
+{
+    // Serialize payload transfers of the frame
+    const size_t data_per_payload = config.max_payload - HEADER_LEN;
+    std::vector<uint8_t> stream;
+    for (size_t offset = 0; offset < frame_size; offset += data_per_payload) {
+        const size_t data_len = std::min(data_per_payload, frame_size - offset);
+        stream.resize(stream.size() + HEADER_LEN);
+        payload_header_fill(stream.data() + stream.size() - HEADER_LEN, frame_id, offset + data_len == frame_size);
+        stream.insert(stream.end(), data_len, frame_data);
+    }
+
+    // Cut it into URBs. Zero length transfer terminates the frame if its end is aligned to URB size
+    for (size_t offset = 0; offset <= stream.size(); offset += config.urb_size) {
+        const size_t len = std::min(config.urb_size, stream.size() - offset);
+        if (len == 0 && stream.size() % config.urb_size != 0) {
+            break;
+        }
+        usb_transfer_t *transfer = frame.add(config.urb_size, 0, context);
+        memcpy(transfer->data_buffer, stream.data() + offset, len);
+        transfer->actual_num_bytes = len;
+        frame.packets += std::max<size_t>(1, (len + config.mps - 1) / config.mps);
+    }
+}
+
+/**
+ * @brief Send frames alternately and measure time spent in the driver
+ */
+static benchmark_result_t benchmark_run(uvc_stream_t *stream, frame_urbs (&frames)[2], void (*callback)(usb_transfer_t *))
+{
+    const int rounds = benchmark_frames();
+    usb_host_transfer_submit_IgnoreAndReturn(ESP_OK); // All URBs are re-submitted
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        frames[i % 2].send(callback);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+    usb_host_transfer_submit_StopIgnore();
+
+    REQUIRE(stream->stats.frames_delivered == (uint64_t)rounds);
+    REQUIRE(stream->stats.bytes_delivered == (uint64_t)rounds * frame_size);
+    return {
+        .ns_per_byte = ns / frame_size,
+        .ns_per_packet = ns / frames[0].packets,
+    };
+}
+
+static void benchmark_stream_init(uvc_stream_t *stream)
+{
+    stream->single_thread.current_frame_id = 2; // Start with invalid frame ID
+    stream->dynamic.streaming = true;
+    stream->constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        return true;
+    };
+    REQUIRE(uvc_frame_allocate(stream, 1, frame_size, 0) == ESP_OK);
+}
+
+TEST_CASE("Isochronous frame reconstruction speed", "[streaming][isoc][benchmark]")
+{
+    const isoc_config_t config = GENERATE(values<isoc_config_t>({
+        {"ISOC Full Speed, 1023 B per 1 ms, 8 packets", 1023, 8},
+        {"ISOC High Speed, 1024 B per 125 us, 8 packets", 1024, 8},
+        {"ISOC High Speed, 3 x 1024 B per 125 us, 8 packets", 3072, 8},
+        {"ISOC High Speed, 3 x 1024 B per 125 us, 32 packets", 3072, 32},
+    }));
+
+    uvc_stream_t stream = {}; // Define mock stream
+    benchmark_stream_init(&stream);
+    frame_urbs frames[2];
+    isoc_frame_urbs_create(frames[0], config, &stream, 0);
+    isoc_frame_urbs_create(frames[1], config, &stream, 1);
+
+    const benchmark_result_t result = benchmark_run(&stream, frames, isoc_transfer_callback);
+    benchmark_check(config.name, result);
+    uvc_frame_free(&stream);
+}
+
+TEST_CASE("Bulk frame reconstruction speed", "[streaming][bulk][benchmark]")
+{
+    const bulk_config_t config = GENERATE(values<bulk_config_t>({
+        {"Bulk Full Speed, 64 B MPS, 4 kB URBs", 64, 4 * 1024, 4 * 1024},
+        {"Bulk High Speed, 512 B MPS, 16 kB URBs", 512, 16 * 1024, 32 * 1024},
+        {"Bulk High Speed, 512 B MPS, 64 kB URBs", 512, 64 * 1024, 64 * 1024},
+    }));
+
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.wMaxPacketSize = config.mps;
+    stream.constant.dwMaxPayloadTransferSize = config.max_payload;
+    benchmark_stream_init(&stream);
+    frame_urbs frames[2];
+    bulk_frame_urbs_create(frames[0], config, &stream, 0);
+    bulk_frame_urbs_create(frames[1], config, &stream, 1);
+
+    const benchmark_result_t result = benchmark_run(&stream, frames, bulk_transfer_callback);
+    benchmark_check(config.name, result);
+    uvc_frame_free(&stream);
+}
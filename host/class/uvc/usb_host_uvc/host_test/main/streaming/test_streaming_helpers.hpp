@@ -33,8 +33,9 @@ extern "C" {
  * @param frame_id
  * @param error_in_sof
  * @param error_in_eof
+ * @param still_image
  */
-inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_context, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false)
+inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_context, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false, bool still_image = false)
 {
     assert(transfer_size > HEADER_LEN);
     assert(!data.empty());
@@ -64,6 +65,7 @@ inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_
     header_sof->bmHeaderInfo.end_of_header = 1;
     header_sof->bmHeaderInfo.frame_id = frame_id;
     header_sof->bmHeaderInfo.error = error_in_sof;
+    header_sof->bmHeaderInfo.still_image = still_image;
 
 
     // Add Frame data to first SoF transfer
@@ -97,6 +99,7 @@ inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_
     header_eof->bmHeaderInfo.end_of_header = 1;
     header_eof->bmHeaderInfo.frame_id = frame_id;
     header_eof->bmHeaderInfo.error = error_in_eof;
+    header_eof->bmHeaderInfo.still_image = still_image;
     transfer->actual_num_bytes = HEADER_LEN;
     usb_host_transfer_submit_ExpectAndReturn(transfer, ESP_OK); // Each must be re-submitted
     bulk_transfer_callback(transfer);
@@ -114,8 +117,9 @@ inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_
  * @param frame_id
  * @param error_in_sof
  * @param error_in_eof
+ * @param still_image
  */
-inline void test_streaming_isoc_send_frame(size_t transfer_size, void *transfer_context, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false)
+inline void test_streaming_isoc_send_frame(size_t transfer_size, void *transfer_context, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false, bool still_image = false)
 {
     assert(transfer_size > HEADER_LEN);
     assert(!data.empty());
@@ -170,6 +174,7 @@ inline void test_streaming_isoc_send_frame(size_t transfer_size, void *transfer_
             header->bmHeaderInfo.val = 0;
             header->bmHeaderInfo.end_of_header = 1;
             header->bmHeaderInfo.frame_id = frame_id;
+            header->bmHeaderInfo.still_image = still_image;
 
             // This is Start of Frame
             if (offset == 0) {
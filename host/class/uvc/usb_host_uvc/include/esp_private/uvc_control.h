@@ -48,6 +48,80 @@ esp_err_t uvc_host_usb_ctrl(uvc_host_stream_hdl_t stream_hdl, uint8_t bmRequestT
  */
 esp_err_t uvc_host_stream_control_negotiate(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format, uvc_vs_ctrl_t *vs_result_ret);
 
+/**
+ * @brief Check whether the format is committed to the device
+ *
+ * The committed Video Stream control is cached by uvc_host_stream_control_negotiate().
+ *
+ * @param     stream_hdl UVC stream
+ * @param[in] vs_format  Video Stream format
+ * @return true if the last successful commit was for this format
+ */
+bool uvc_host_stream_control_is_committed(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format);
+
+/**
+ * @brief Send the cached Video Stream control to the device again, without probing
+ *
+ * @param stream_hdl UVC stream
+ * @return
+ *     - ESP_OK: Format committed
+ *     - ESP_ERR_INVALID_STATE: No format is committed
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_recommit(uvc_host_stream_hdl_t stream_hdl);
+
+/**
+ * @brief Commit a Video Stream control known from earlier negotiation, without probing
+ *
+ * Used for formats whose negotiation result was stored. If the device rejects the control, the format must be negotiated.
+ *
+ * @param     stream_hdl UVC stream
+ * @param[in] vs_format  Video Stream format of the control
+ * @param[in] vs_ctrl    Video Stream control committed by earlier negotiation of vs_format
+ * @return
+ *     - ESP_OK: Format committed
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_NOT_FOUND: The format was not found
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_commit_known(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format, const uvc_vs_ctrl_t *vs_ctrl);
+
+/**
+ * @brief Forget the committed format
+ *
+ * Next uvc_host_stream_start() will negotiate the format again. Call this when the device might have lost its state.
+ *
+ * @param stream_hdl UVC stream
+ */
+void uvc_host_stream_control_invalidate(uvc_host_stream_hdl_t stream_hdl);
+
+/**
+ * @brief Negotiate and commit still image format
+ *
+ * Still Probe is set with format, frame and compression indexes of still_ctrl, the device's result is read back and committed.
+ *
+ * @param        stream_hdl UVC stream
+ * @param[inout] still_ctrl In: bFormatIndex, bFrameIndex and bCompressionIndex. Out: Committed Still Probe control
+ * @return
+ *     - ESP_OK: Still image format committed
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or still_ctrl is NULL
+ *     - ESP_ERR_NOT_SUPPORTED: The device did not accept the requested indexes
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_still_negotiate(uvc_host_stream_hdl_t stream_hdl, uvc_still_ctrl_t *still_ctrl);
+
+/**
+ * @brief Request transmission of still image
+ *
+ * Sets Still Image Trigger Control to 'Transmit still image'.
+ *
+ * @param stream_hdl UVC stream
+ * @return
+ *     - ESP_OK: Still image requested
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_still_trigger(uvc_host_stream_hdl_t stream_hdl);
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,6 +53,70 @@ enum uvc_vs_ctrl_selector {
     UVC_VS_SYNC_DELAY_CONTROL = 0x09
 };
 
+/**
+ * @brief Camera Terminal control selector
+ *
+ * @see USB UVC specification ver 1.5, table A.9.4
+ */
+enum uvc_ct_ctrl_selector {
+    UVC_CT_CONTROL_UNDEFINED = 0x00,
+    UVC_CT_SCANNING_MODE_CONTROL = 0x01,
+    UVC_CT_AE_MODE_CONTROL = 0x02,
+    UVC_CT_AE_PRIORITY_CONTROL = 0x03,
+    UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL = 0x04,
+    UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL = 0x05,
+    UVC_CT_FOCUS_ABSOLUTE_CONTROL = 0x06,
+    UVC_CT_FOCUS_RELATIVE_CONTROL = 0x07,
+    UVC_CT_FOCUS_AUTO_CONTROL = 0x08,
+    UVC_CT_IRIS_ABSOLUTE_CONTROL = 0x09,
+    UVC_CT_IRIS_RELATIVE_CONTROL = 0x0A,
+    UVC_CT_ZOOM_ABSOLUTE_CONTROL = 0x0B,
+    UVC_CT_ZOOM_RELATIVE_CONTROL = 0x0C,
+    UVC_CT_PANTILT_ABSOLUTE_CONTROL = 0x0D,
+    UVC_CT_PANTILT_RELATIVE_CONTROL = 0x0E,
+    UVC_CT_ROLL_ABSOLUTE_CONTROL = 0x0F,
+    UVC_CT_ROLL_RELATIVE_CONTROL = 0x10,
+    UVC_CT_PRIVACY_CONTROL = 0x11,
+    UVC_CT_FOCUS_SIMPLE_CONTROL = 0x12,
+    UVC_CT_WINDOW_CONTROL = 0x13,
+    UVC_CT_REGION_OF_INTEREST_CONTROL = 0x14
+};
+
+/**
+ * @brief Processing Unit control selector
+ *
+ * @see USB UVC specification ver 1.5, table A.9.5
+ */
+enum uvc_pu_ctrl_selector {
+    UVC_PU_CONTROL_UNDEFINED = 0x00,
+    UVC_PU_BACKLIGHT_COMPENSATION_CONTROL = 0x01,
+    UVC_PU_BRIGHTNESS_CONTROL = 0x02,
+    UVC_PU_CONTRAST_CONTROL = 0x03,
+    UVC_PU_GAIN_CONTROL = 0x04,
+    UVC_PU_POWER_LINE_FREQUENCY_CONTROL = 0x05,
+    UVC_PU_HUE_CONTROL = 0x06,
+    UVC_PU_SATURATION_CONTROL = 0x07,
+    UVC_PU_SHARPNESS_CONTROL = 0x08,
+    UVC_PU_GAMMA_CONTROL = 0x09,
+    UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL = 0x0A,
+    UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL = 0x0B,
+    UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL = 0x0C,
+    UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL = 0x0D,
+    UVC_PU_DIGITAL_MULTIPLIER_CONTROL = 0x0E,
+    UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL = 0x0F,
+    UVC_PU_HUE_AUTO_CONTROL = 0x10,
+    UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL = 0x11,
+    UVC_PU_ANALOG_LOCK_STATUS_CONTROL = 0x12,
+    UVC_PU_CONTRAST_AUTO_CONTROL = 0x13
+};
+
+/**
+ * @brief Input Terminal type of camera sensor
+ *
+ * @see USB UVC specification ver 1.5, table B-2
+ */
+#define UVC_ITT_CAMERA (0x0201)
+
 /**
  * @brief VideoControl interface descriptor subtype
  *
@@ -124,6 +188,20 @@ typedef struct {
 } USB_DESC_ATTR uvc_vs_ctrl_t;
 ESP_STATIC_ASSERT(sizeof(uvc_vs_ctrl_t) == 48, "Size of uvc_vs_ctrl_t incorrect");
 
+/**
+ * @brief Video Still Probe and Commit Controls
+ *
+ * @see USB UVC specification ver 1.5, table 4-76
+ */
+typedef struct {
+    uint8_t  bFormatIndex;
+    uint8_t  bFrameIndex;       // Index of image size pattern in Still Image Frame descriptor
+    uint8_t  bCompressionIndex;
+    uint32_t dwMaxVideoFrameSize;
+    uint32_t dwMaxPayloadTransferSize;
+} USB_DESC_ATTR uvc_still_ctrl_t;
+ESP_STATIC_ASSERT(sizeof(uvc_still_ctrl_t) == 11, "Size of uvc_still_ctrl_t incorrect");
+
 /**
  * @brief Video Frame Descriptor
  *
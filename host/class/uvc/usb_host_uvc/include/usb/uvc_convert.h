@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Pixel format conversion of UVC frames
+ *
+ * Helpers for displaying uncompressed UVC frames. YUY2 (YUV 4:2:2) is converted to RGB565 with BT.601 coefficients.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Band of converted image callback
+ *
+ * @param[in] rgb565   Converted lines of the image, width x lines pixels
+ * @param[in] y        First line of this band in the image
+ * @param[in] lines    Number of lines in this band
+ * @param[in] user_ctx User's argument from the configuration
+ */
+typedef void (*uvc_convert_band_cb_t)(const uint16_t *rgb565, size_t y, size_t lines, void *user_ctx);
+
+/**
+ * @brief Configuration of banded YUY2 to RGB565 conversion
+ */
+typedef struct {
+    uint16_t *band_buffers[2];      /**< Buffers for width x band_lines pixels, e.g. display DMA buffers in internal RAM.
+                                         If both are set, they are used alternately, so one band can be transferred while the next one is converted.
+                                         band_buffers[1] can be NULL */
+    size_t band_lines;              /**< Number of lines converted into one band buffer */
+    bool swap_bytes;                /**< Store RGB565 pixels in big endian, e.g. for SPI displays */
+    uvc_convert_band_cb_t band_cb;  /**< Called with every converted band */
+    void *user_ctx;                 /**< User's argument passed to band_cb */
+} uvc_convert_band_config_t;
+
+/**
+ * @brief Convert YUY2 image to RGB565
+ *
+ * Clamping and packing to RGB565 is done with lookup tables instead of branches, two pixels sharing chroma are converted together.
+ *
+ * @param[in]  yuy2       YUY2 image
+ * @param[out] rgb565     RGB565 image, width x height pixels
+ * @param[in]  width      Image width in pixels. Must be even
+ * @param[in]  height     Image height in pixels
+ * @param[in]  swap_bytes Store RGB565 pixels in big endian
+ */
+void uvc_convert_yuy2_to_rgb565(const uint8_t *yuy2, uint16_t *rgb565, size_t width, size_t height, bool swap_bytes);
+
+/**
+ * @brief Convert YUY2 image to RGB565 - reference implementation
+ *
+ * Straightforward per-pixel computation. Produces the same output as uvc_convert_yuy2_to_rgb565(), useful for comparison.
+ *
+ * @param[in]  yuy2       YUY2 image
+ * @param[out] rgb565     RGB565 image, width x height pixels
+ * @param[in]  width      Image width in pixels. Must be even
+ * @param[in]  height     Image height in pixels
+ * @param[in]  swap_bytes Store RGB565 pixels in big endian
+ */
+void uvc_convert_yuy2_to_rgb565_ref(const uint8_t *yuy2, uint16_t *rgb565, size_t width, size_t height, bool swap_bytes);
+
+/**
+ * @brief Convert YUY2 image to RGB565 in bands
+ *
+ * The image is converted band by band into small buffers, which stay in cache (or internal RAM) and can be sent to the display
+ * directly. A full RGB565 frame buffer is not needed.
+ *
+ * @param[in] yuy2   YUY2 image
+ * @param[in] width  Image width in pixels. Must be even
+ * @param[in] height Image height in pixels
+ * @param[in] config Band configuration
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid image size or configuration
+ */
+esp_err_t uvc_convert_yuy2_to_rgb565_banded(const uint8_t *yuy2, size_t width, size_t height, const uvc_convert_band_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,6 +14,11 @@
 // Use this macros for opening a UVC stream with any VID or PID
 #define UVC_HOST_ANY_VID (0)
 #define UVC_HOST_ANY_PID (0)
+#define UVC_HOST_TASK_CORE_AUTO (-1) /**< Pin stream's processing task to the core with least UVC processing tasks */
+#define UVC_HOST_FRAME_INTERVALS_MAX (8) /**< Maximum number of discrete frame intervals in uvc_host_frame_list_entry_t */
+#define UVC_HOST_CONTROL_DATA_MAX (16)   /**< Maximum data length of one camera control request */
+#define UVC_HOST_FRAME_SUBSCRIBERS_MAX (4) /**< Maximum number of frame subscribers of one stream */
+#define UVC_HOST_STREAM_GROUP_MAX (4)      /**< Maximum number of streams opened or started together */
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +35,14 @@ typedef struct {
     int xCoreID;                   /**< Core affinity of the driver's task */
     bool create_background_task;   /**< When set to true, background task handling usb events is created.
                                         Otherwise user has to periodically call uvc_host_handle_events function */
+    bool shared_client;            /**< Use the client installed with usb_host_shared_client_install() instead of own client.
+                                        Events are handled by the shared client task, create_background_task must be false */
+    struct {
+        int num_slabs;             /**< Number of frame buffers in the shared frame pool. 0: No shared frame pool */
+        size_t slab_size;          /**< Size of one frame buffer in the shared frame pool */
+        uint32_t heap_caps;        /**< Memory capabilities of the shared frame pool. Directly passed to heap_caps_malloc() */
+    } frame_pool;                  /**< Frame buffers shared by streams with advanced.shared_frame_pool. They are allocated
+                                        in one block at driver install, so opening and closing streams does not fragment the heap */
 } uvc_host_driver_config_t;
 
 /**
@@ -39,7 +52,8 @@ enum uvc_host_dev_event {
     UVC_HOST_TRANSFER_ERROR,         /**< USB transfer error */
     UVC_HOST_DEVICE_DISCONNECTED,    /**< Device was suddenly disconnected. The stream is stopped. */
     UVC_HOST_FRAME_BUFFER_OVERFLOW,  /**< The received frame was discarded because it exceeded the available frame buffer space.
-                                          To resolve this, increase the `frame_size` parameter in `uvc_host_stream_config_t.advanced` to allocate a larger buffer. */
+                                          To resolve this, increase the `frame_size` parameter in `uvc_host_stream_config_t.advanced` to allocate a larger buffer.
+                                          With `adaptive_frame_size`, the frame buffer could not grow: dwMaxVideoFrameSize exceeded or not enough memory. */
     UVC_HOST_FRAME_BUFFER_UNDERFLOW, /**< The received frame was discarded because no available buffer was free for storage.
                                           To address this, either optimize your processing speed or increase the `number_of_frame_buffers` parameter in
                                           `uvc_host_stream_config_t.advanced` to allocate additional buffers. */
@@ -82,6 +96,99 @@ typedef struct {
     enum uvc_host_stream_format format; /**< Frame coding format */
 } uvc_host_stream_format_t;
 
+/**
+ * @brief Frame format offered by UVC device
+ *
+ * Frame intervals are in 100 ns units, as in UVC descriptors. FPS = 10000000 / interval.
+ */
+typedef struct {
+    enum uvc_host_stream_format format; /**< Frame coding format. UVC_VS_FORMAT_UNDEFINED for formats not supported by this driver */
+    unsigned h_res;                     /**< Horizontal resolution */
+    unsigned v_res;                     /**< Vertical resolution */
+    uint32_t dwMaxVideoFrameSize;       /**< Maximum size of one frame in bytes. 0 if the device does not provide it (frame based formats) */
+    uint32_t dwMaxBitRate;              /**< Maximum bit rate at the shortest frame interval, in bits per second */
+    uint32_t dwDefaultFrameInterval;    /**< Default frame interval */
+    uint8_t bFrameIntervalType;         /**< 0: Continuous frame intervals in 'continuous'.
+                                             Else: Number of discrete frame intervals, only first UVC_HOST_FRAME_INTERVALS_MAX are in 'discrete' */
+    union {
+        struct {
+            uint32_t dwMinFrameInterval;  /**< Shortest frame interval */
+            uint32_t dwMaxFrameInterval;  /**< Longest frame interval */
+            uint32_t dwFrameIntervalStep; /**< Granularity of frame intervals */
+        } continuous;
+        uint32_t discrete[UVC_HOST_FRAME_INTERVALS_MAX]; /**< Supported frame intervals */
+    };
+} uvc_host_frame_list_entry_t;
+
+#define UVC_HOST_FRAME_NAL_UNITS_MAX (16) // Maximum number of NAL units listed in frame metadata
+
+/**
+ * @brief Frame metadata
+ *
+ * Device timestamps are in ticks of the device clock, see clock_frequency.
+ * Host timestamps are in microseconds of esp_timer_get_time().
+ */
+typedef struct {
+    uint32_t sequence;                /**< Frame sequence number, incremented with every Start of Frame. Gaps indicate dropped frames */
+    bool pts_valid;                   /**< The device sent Presentation Time Stamp in this frame */
+    bool scr_valid;                   /**< The device sent Source Clock Reference in this frame */
+    uint32_t pts;                     /**< Presentation Time Stamp: Device clock at start of capture of this frame */
+    uint32_t scr_stc;                 /**< Source Clock Reference: Device clock when the first payload with SCR was formed */
+    uint16_t scr_sof;                 /**< Source Clock Reference: USB SOF token counter at scr_stc (11 bits) */
+    uint32_t clock_frequency;         /**< Device clock frequency in Hz, from Video Control Interface Header. 0 if unknown */
+    int64_t sof_timestamp_us;         /**< Host time of reception of the first payload of this frame */
+    int64_t eof_timestamp_us;         /**< Host time of reception of the last payload of this frame */
+    int64_t capture_timestamp_us;     /**< Host time of capture, derived from sof_timestamp_us, PTS and SCR. 0 if PTS, SCR or clock frequency is unknown */
+    uint32_t dropped_packets;         /**< Number of skipped or timed out packets while this frame was assembled */
+    bool corrupted;                   /**< MJPEG only: the frame failed the integrity check of UVC_HOST_MJPEG_CHECK_FLAG */
+    bool still_image;                 /**< The frame is a still image requested by uvc_host_stream_still_capture().
+                                           Its resolution in vs_format is the still image resolution */
+    struct {
+        uint8_t num_units;            /**< Number of NAL units listed in 'units' */
+        bool overflow;                /**< The frame has more than UVC_HOST_FRAME_NAL_UNITS_MAX NAL units, the rest is not listed.
+                                           The flags below cover all NAL units of the frame */
+        bool keyframe;                /**< The frame contains IDR (H.264) or IRAP (H.265) picture */
+        bool reference;               /**< The frame contains picture used for reference. Other frames can be dropped under congestion */
+        bool parameter_sets;          /**< The frame contains SPS and PPS (and VPS for H.265). See uvc_host_stream_get_parameter_sets() */
+        struct {
+            uint32_t offset;          /**< Offset of NAL unit header in frame data, after the start code */
+            uint32_t size;            /**< Size of NAL unit without start code, ready for RTP packetization */
+            uint8_t type;             /**< nal_unit_type */
+        } units[UVC_HOST_FRAME_NAL_UNITS_MAX];
+    } nal;                            /**< H.264 and H.265 only: NAL units found in Annex B byte stream during frame assembly */
+} uvc_host_frame_info_t;
+
+/**
+ * @brief Statistics of UVC stream
+ *
+ * Counters are cumulative since the stream was opened. In zero-copy mode (payload_cb), frames are not assembled by the driver,
+ * so only usb_errors, urbs_completed and urb_fill_percent are updated.
+ */
+typedef struct {
+    uint32_t frames_delivered;        /**< Complete frames passed to the user */
+    uint64_t bytes_delivered;         /**< Data bytes of delivered frames */
+    float fps;                        /**< Delivered frames per second since previous uvc_host_stream_get_stats() call */
+    uint32_t bitrate;                 /**< Bits per second of delivered frames since previous uvc_host_stream_get_stats() call */
+    struct {
+        uint32_t missed_eof;          /**< End of Frame was not received before the next frame started */
+        uint32_t error;               /**< Error bit in payload header or USB error */
+        uint32_t overflow;            /**< The frame did not fit into frame buffer, UVC_HOST_FRAME_BUFFER_OVERFLOW */
+        uint32_t underflow;           /**< No free frame buffer, UVC_HOST_FRAME_BUFFER_UNDERFLOW */
+        uint32_t corrupted;           /**< MJPEG frame failed the integrity check of UVC_HOST_MJPEG_CHECK_DROP */
+    } frames_skipped;                 /**< Skipped frames per reason */
+    uint32_t frames_decimated;        /**< Frames dropped at Start of Frame by advanced.frame_decimation */
+    uint32_t frames_overwritten;      /**< UVC_HOST_FRAME_POLICY_LATEST only: delivered frames replaced by a newer frame
+                                           before they were taken with uvc_host_frame_get_latest() */
+    struct {
+        uint32_t error;               /**< USB_TRANSFER_STATUS_ERROR */
+        uint32_t overflow;            /**< USB_TRANSFER_STATUS_OVERFLOW */
+        uint32_t stall;               /**< USB_TRANSFER_STATUS_STALL */
+        uint32_t missed;              /**< USB_TRANSFER_STATUS_SKIPPED or USB_TRANSFER_STATUS_TIMED_OUT. ISOC only */
+    } usb_errors;                     /**< ISOC packets (or Bulk transfers) completed with error status */
+    uint32_t urbs_completed;          /**< Processed URBs */
+    uint8_t urb_fill_percent;         /**< Average number of received bytes per URB, relative to URB size */
+} uvc_host_stream_stats_t;
+
 /**
  * @brief Video Stream frame
  *
@@ -92,6 +199,7 @@ typedef struct {
     size_t data_buffer_len;                   /**< Max data length supported by this frame buffer */
     size_t data_len;                          /**< Data length of currently store frame */
     uint8_t *data;                            /**< Frame data */
+    uvc_host_frame_info_t info;               /**< Timestamps and statistics of this frame */
 } uvc_host_frame_t;
 
 /**
@@ -114,12 +222,114 @@ typedef void (*uvc_host_stream_callback_t)(const uvc_host_stream_event_data_t *e
  */
 typedef bool (*uvc_host_frame_callback_t)(const uvc_host_frame_t *frame, void *user_ctx);
 
+/**
+ * @brief Frame subscriber callback type
+ *
+ * Called for every complete frame, before frame_cb. All subscribers get the same frame buffer, the frame is not copied.
+ * The frame is valid until the callback returns. To keep it longer, e.g. to pass it to another task, take a reference
+ * with uvc_host_frame_ref() in the callback and drop it with uvc_host_frame_unref() when done.
+ *
+ * @param[in] stream_hdl UVC stream the frame belongs to
+ * @param[in] frame      Received frame. Must not be modified, other subscribers share it
+ * @param[in] user_ctx   User's argument passed to uvc_host_frame_subscribe()
+ */
+typedef void (*uvc_host_frame_subscriber_cb_t)(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame, void *user_ctx);
+
+/**
+ * @brief Segment of Video Stream payload
+ *
+ * Payload data without UVC payload header, pointing directly into USB transfer buffer
+ */
+typedef struct {
+    const uint8_t *data;  /**< Payload data. Valid only during the payload callback */
+    size_t data_len;      /**< Payload data length. Can be 0 for segments that only signal start or end of frame */
+    bool start_of_frame;  /**< This segment starts a new frame */
+    bool end_of_frame;    /**< This segment ends the frame */
+    bool error;           /**< The camera or USB signalled an error: the frame this segment belongs to is corrupted */
+} uvc_host_payload_segment_t;
+
+/**
+ * @brief Payload callback type
+ *
+ * Called for every completed USB transfer with scatter-gather list of its payload segments in order of reception.
+ * The USB transfer is resubmitted after this callback returns, so the data must be consumed (e.g. by DMA) before returning.
+ *
+ * @param[in] segments     Array of payload segments
+ * @param[in] num_segments Number of segments in the array
+ * @param[in] user_ctx     User's argument passed to open function
+ */
+typedef void (*uvc_host_payload_callback_t)(const uvc_host_payload_segment_t *segments, size_t num_segments, void *user_ctx);
+
+/**
+ * @brief Slice of a frame that is being assembled
+ */
+typedef struct {
+    const uvc_host_frame_t *frame;  /**< Frame buffer that is being assembled */
+    const uint8_t *data;            /**< Slice data, points into the frame buffer */
+    size_t data_len;                /**< Slice length in bytes */
+    size_t offset;                  /**< Offset of this slice from start of the frame */
+    bool end_of_frame;              /**< This is the last slice of the frame. Can have zero length */
+    bool frame_dropped;             /**< The frame was dropped (error or overflow), previously delivered slices of it are invalid. No data */
+} uvc_host_slice_t;
+
+/**
+ * @brief Slice callback type
+ *
+ * Called while a frame is being assembled, every time at least slice_size new bytes were received.
+ * Lets the user process (e.g. forward to network) start of the frame before its end arrives.
+ *
+ * @param[in] slice    Slice of the frame. Slice data are valid until the frame is passed to frame_cb or returned
+ * @param[in] user_ctx User's argument passed to open function
+ */
+typedef void (*uvc_host_slice_callback_t)(const uvc_host_slice_t *slice, void *user_ctx);
+
+/**
+ * @brief Policy for passing complete frames to the user
+ */
+typedef enum {
+    UVC_HOST_FRAME_POLICY_CALLBACK = 0, /**< Every complete frame is passed to frame_cb. If the user holds all frame buffers,
+                                             new frames are skipped with UVC_HOST_FRAME_BUFFER_UNDERFLOW */
+    UVC_HOST_FRAME_POLICY_LATEST,    /**< Live preview: only the newest complete frame is kept, the user takes it with
+                                          uvc_host_frame_get_latest(). A newer frame replaces an older one that was not taken yet,
+                                          and the older frame buffer is reused instead of skipping the new frame. frame_cb is not used */
+    UVC_HOST_FRAME_POLICY_ACQUIRE,   /**< Complete frames are queued in order, consumer tasks take them with uvc_host_frame_acquire().
+                                          If the user holds all frame buffers, new frames are skipped with UVC_HOST_FRAME_BUFFER_UNDERFLOW.
+                                          frame_cb is not used */
+} uvc_host_frame_policy_t;
+
+/**
+ * @brief Region of interest of uncompressed frames, in pixels
+ */
+typedef struct {
+    unsigned x;                      /**< First column of the window. Must be even for YUY2 */
+    unsigned y;                      /**< First row of the window */
+    unsigned width;                  /**< Width of the window. Must be even for YUY2. 0: Whole frame is assembled */
+    unsigned height;                 /**< Height of the window */
+} uvc_host_roi_t;
+
+/**
+ * @brief Integrity check of MJPEG frames
+ *
+ * Isochronous transfers have no CRC, so a frame with lost or corrupted packets can still be assembled.
+ * On End of Frame, SOI and EOI markers and the header segments up to Start of Scan are checked, and the frame size is compared
+ * with the running average of recent frames. The check reads only the frame header and trailer, not the entropy-coded data
+ */
+typedef enum {
+    UVC_HOST_MJPEG_CHECK_OFF = 0,    /**< Frames are not checked */
+    UVC_HOST_MJPEG_CHECK_FLAG,       /**< Corrupted frames are delivered with uvc_host_frame_info_t::corrupted set */
+    UVC_HOST_MJPEG_CHECK_DROP,       /**< Corrupted frames are skipped and counted in uvc_host_stream_stats_t::frames_skipped.corrupted */
+} uvc_host_mjpeg_check_t;
+
 /**
  * @brief Configuration structure of UVC device
  */
 typedef struct {
     uvc_host_stream_callback_t event_cb;  /**< Stream's event callback function. Can be NULL */
     uvc_host_frame_callback_t frame_cb;   /**< Stream's frame callback function */
+    uvc_host_payload_callback_t payload_cb; /**< Zero-copy mode: payload segments are passed directly from USB transfers, no frame buffers are allocated
+                                                 and frame_cb is not used. Set to NULL to receive assembled frames in frame_cb */
+    uvc_host_slice_callback_t slice_cb;   /**< Slice mode: parts of frames are passed while the frames are being assembled. Can be NULL.
+                                               The complete frame is still passed to frame_cb, if set */
     void *user_ctx;                       /**< User's argument that will be passed to the callbacks */
     struct {
         uint16_t vid;                     /**< Device's Vendor ID. Set to 0 for any */
@@ -128,16 +338,85 @@ typedef struct {
     } usb;
     uvc_host_stream_format_t vs_format;   /**< Video Stream format. Resolution, FPS and encoding */
     struct {
-        int number_of_frame_buffers; /**< Number of frame buffers. These can be very large as they must hold the full frame.*/
+        int number_of_frame_buffers; /**< Number of frame buffers, up to 32. These can be very large as they must hold the full frame.*/
         size_t frame_size;           /**< 0: Use dwMaxVideoFrameSize from format negotiation result (might be too large).
                                           (0; SIZE_MAX>: Use user provide frame size. */
         uint32_t frame_heap_caps;    /**< Memory capabilities for frame buffers. Directly passed to heap_caps_malloc() */
+        bool adaptive_frame_size;    /**< Frame buffers start small (frame_size, or 1/8 of dwMaxVideoFrameSize if 0) and grow up to
+                                          dwMaxVideoFrameSize according to the largest received frames. Recommended for compressed formats */
         int number_of_urbs;          /**< Number of URBs for this stream. Triple buffering scheme is recommended */
         size_t urb_size;             /**< Size in bytes of 1 URB, 10kB should be enough for start.
                                           Larger value results in less frequent interrupts at the cost of memory consumption */
+        uint32_t urb_heap_caps;      /**< Memory capabilities for URB data buffers, MALLOC_CAP_DMA is added. E.g. MALLOC_CAP_SPIRAM
+                                          on esp32p4, whose USB DMA reaches PSRAM. 0: Internal DMA memory of the USB Host Library */
+        size_t urb_alignment;        /**< Alignment of URB data buffers in bytes, power of two. Used only with urb_heap_caps.
+                                          0: Cache line of the memory */
+        bool auto_bandwidth;         /**< Select the alternate setting that reserves the least bus bandwidth for negotiated frame size x fps
+                                          (with headroom) and derive URBs from its service interval. number_of_urbs and urb_size are ignored */
+        bool bulk_payload_urbs;      /**< Bulk only: size URBs to dwMaxPayloadTransferSize of negotiated format (up to 32 kB), so every completed
+                                          URB carries one payload transfer with one header. urb_size is ignored, at least 3 URBs are queued.
+                                          URBs are resized when uvc_host_stream_format_select() changes dwMaxPayloadTransferSize.
+                                          Implied by auto_bandwidth. Not used for ISOC streams */
+        size_t slice_size;           /**< Slice mode only: slice_cb is called when at least this many bytes were added to the frame.
+                                          0: slice_cb is called for every USB packet with payload */
+        uvc_host_frame_policy_t frame_policy; /**< Policy for passing complete frames to the user */
+        bool shared_frame_pool;      /**< Take frame buffers from the driver's shared frame pool, see uvc_host_driver_config_t.
+                                          number_of_frame_buffers is the maximum this stream can hold at once, frame_size and
+                                          frame_heap_caps are not used and adaptive_frame_size must be false */
+        int frame_pool_reserved;     /**< Shared frame pool only: number of frame buffers taken from the pool at stream open and kept
+                                          until stream close. Other frame buffers are taken from the pool when needed and put back
+                                          when returned. Up to number_of_frame_buffers */
+        uvc_host_mjpeg_check_t mjpeg_check; /**< Integrity check of MJPEG frames before they are passed to the user.
+                                                 Not used for other formats and in zero-copy mode */
+        unsigned frame_decimation;   /**< Keep only every n-th frame, e.g. 6 for 5 fps from a 30 fps stream. Other frames are dropped
+                                          at Start of Frame: no frame buffer is taken and their data are not copied.
+                                          0 or 1: Keep all frames. Not used in zero-copy mode */
+        uvc_host_roi_t roi;          /**< YUY2 only: only bytes inside this window are copied to frame buffers, row after row.
+                                          Frames are delivered with h_res and v_res of the window in vs_format. With frame_size 0,
+                                          frame buffers are sized for the window. The window must fit into the format, also
+                                          after uvc_host_stream_format_select(). Not used in zero-copy mode */
     } advanced;
+    struct {
+        size_t stack_size;           /**< Stack size of the stream's processing task. Set to 0 to process URBs in the driver's task */
+        unsigned priority;           /**< Priority of the stream's processing task */
+        int xCoreID;                 /**< Core affinity of the stream's processing task. UVC_HOST_TASK_CORE_AUTO spreads streams across cores */
+    } processing_task;               /**< Completed URBs are processed and frame/payload callbacks are called in this task.
+                                          A slow callback then does not delay the driver's task and one spare URB keeps the endpoint polled */
 } uvc_host_stream_config_t;
 
+/**
+ * @brief Unit of the Video Control interface that implements a camera control
+ */
+typedef enum {
+    UVC_HOST_CONTROL_UNIT_CAMERA = 0,    /**< Camera Terminal, selectors from enum uvc_ct_ctrl_selector */
+    UVC_HOST_CONTROL_UNIT_PROCESSING,    /**< Processing Unit, selectors from enum uvc_pu_ctrl_selector */
+} uvc_host_control_unit_t;
+
+/**
+ * @brief Camera control request
+ */
+typedef struct {
+    uvc_host_control_unit_t unit;        /**< Unit of the control */
+    uint8_t selector;                    /**< Control selector */
+    uint8_t request;                     /**< UVC_SET_CUR or one of GET requests from enum uvc_req_code */
+    uint8_t len;                         /**< Length of data, 1 to UVC_HOST_CONTROL_DATA_MAX */
+    uint8_t data[UVC_HOST_CONTROL_DATA_MAX]; /**< SET_CUR: value sent to the device. GET requests: filled when the request completes */
+} uvc_host_control_t;
+
+/**
+ * @brief Camera control completion callback type
+ *
+ * Called from the driver's task (uvc_host_handle_events()) when a control request submitted with
+ * uvc_host_stream_control_submit() completes. The callback must not block, next queued request is sent after it returns.
+ *
+ * @param[in] stream_hdl UVC stream
+ * @param[in] result     ESP_OK: Request succeeded. ESP_ERR_INVALID_RESPONSE: Device stalled or did not reply.
+ *                       ESP_ERR_INVALID_STATE: Request was dropped, because the stream is being closed
+ * @param[in] control    Completed request. data was filled for GET requests
+ * @param[in] user_ctx   User's argument passed to uvc_host_stream_control_submit()
+ */
+typedef void (*uvc_host_control_callback_t)(uvc_host_stream_hdl_t stream_hdl, esp_err_t result, const uvc_host_control_t *control, void *user_ctx);
+
 /**
  * @brief Install UVC driver
  *
@@ -148,7 +427,7 @@ typedef struct {
  * @return
  *     - ESP_OK: Success - driver installed
  *     - ESP_ERR_INVALID_STATE: Driver already installed or USB Host Library is not installed
- *     - ESP_ERR_NO_MEM: Not enough free memory for the driver
+ *     - ESP_ERR_NO_MEM: Not enough free memory for the driver or its shared frame pool
  */
 esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config);
 
@@ -178,6 +457,42 @@ esp_err_t uvc_host_uninstall(void);
  */
 esp_err_t uvc_host_handle_events(unsigned long timeout);
 
+/**
+ * @brief Get list of frame formats offered by UVC device
+ *
+ * The list is taken from descriptors of the device, no stream is opened and no format is negotiated.
+ * Use it to pick the most suitable format for uvc_host_stream_open().
+ *
+ * @note This function will block for timeout, if the device is not enumerated at the moment of calling this function
+ * @param[in]    vid              Device's Vendor ID. UVC_HOST_ANY_VID for any
+ * @param[in]    pid              Device's Product ID. UVC_HOST_ANY_PID for any
+ * @param[in]    uvc_stream_index Index of UVC function, as in uvc_host_stream_config_t
+ * @param[in]    timeout          Timeout in FreeRTOS ticks
+ * @param[out]   frame_list       Frame formats of all Video Streaming interfaces of the UVC function. Can be NULL to get the number of formats
+ * @param[inout] list_size        In: Length of frame_list. Out: Number of formats offered by the device, may be larger than the length of frame_list
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_STATE: UVC driver is not installed
+ *     - ESP_ERR_INVALID_ARG: list_size is NULL
+ *     - ESP_ERR_NOT_FOUND: Device or its UVC function was not found
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t uvc_host_get_frame_list(uint16_t vid, uint16_t pid, uint8_t uvc_stream_index, int timeout,
+                                  uvc_host_frame_list_entry_t *frame_list, size_t *list_size);
+
+/**
+ * @brief Remove stored format negotiation results of all known cameras
+ *
+ * With CONFIG_UVC_HOST_NEGOTIATION_CACHE, the committed Video Stream control and the selected alternate setting of every
+ * opened format are stored in NVS. uvc_host_stream_open() commits the stored result of a known camera and format without
+ * probing. NVS must be initialized by the application.
+ *
+ * @return
+ *     - ESP_OK: All results removed
+ *     - ESP_ERR_NOT_SUPPORTED: CONFIG_UVC_HOST_NEGOTIATION_CACHE is disabled
+ */
+esp_err_t uvc_host_clear_negotiation_cache(void);
+
 /**
  * @brief Open UVC compliant device
  *
@@ -186,13 +501,33 @@ esp_err_t uvc_host_handle_events(unsigned long timeout);
  * @param[out] stream_hdl_ret UVC stream handle
  * @return
  *     - ESP_OK: Success - stream opened
- *     - ESP_ERR_INVALID_STATE: UVC driver is not installed
- *     - ESP_ERR_INVALID_ARG: stream_config or stream_hdl_ret is NULL
- *     - ESP_ERR_NO_MEM: Not enough free memory for the stream
+ *     - ESP_ERR_INVALID_STATE: UVC driver is not installed, or it has no shared frame pool and advanced.shared_frame_pool is set
+ *     - ESP_ERR_INVALID_ARG: stream_config or stream_hdl_ret is NULL, or invalid combination of stream_config members
+ *     - ESP_ERR_NO_MEM: Not enough free memory for the stream, or not enough free frame buffers in the shared frame pool
  *     - ESP_ERR_NOT_FOUND: UVC stream with requested configuration was not found
  */
 esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, int timeout, uvc_host_stream_hdl_t *stream_hdl_ret);
 
+/**
+ * @brief Open several UVC functions of one composite device
+ *
+ * The device is found once, by VID/PID of the first configuration, and all streams are opened on it.
+ * Each stream keeps its own configuration: format, frame buffers, callbacks and processing task.
+ * Set processing_task.xCoreID of each stream to pin its callbacks to a core, or use UVC_HOST_TASK_CORE_AUTO to spread them.
+ * The streams are closed one by one with uvc_host_stream_close(). The device is closed with the last one.
+ *
+ * @param[in]  stream_configs Configurations of the streams. All must have the same VID and PID and different uvc_stream_index
+ * @param[in]  num_streams    Number of streams, at most UVC_HOST_STREAM_GROUP_MAX
+ * @param[in]  timeout        Timeout in FreeRTOS ticks
+ * @param[out] stream_hdls    Array of num_streams UVC stream handles
+ * @return
+ *     - ESP_OK: Success - all streams opened
+ *     - ESP_ERR_INVALID_ARG: Invalid argument or configurations of different devices
+ *     - Else: Error of uvc_host_stream_open() for one of the streams. No stream is left open
+ */
+esp_err_t uvc_host_stream_open_group(const uvc_host_stream_config_t *stream_configs, size_t num_streams, int timeout,
+                                     uvc_host_stream_hdl_t *stream_hdls);
+
 /**
  * @brief Start UVC stream
  *
@@ -204,10 +539,29 @@ esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, in
  *     - ESP_ERR_INVALID_ARG: stream_hdl is NULL
  *     - ESP_ERR_INVALID_STATE: Stream already streaming
  *     - ESP_ERR_NOT_FOUND: Format negotiation error
+ *     - ESP_ERR_NOT_FINISHED: Not enough periodic bus bandwidth left, even for the smallest ISOC alternate setting
  *     - Else: USB lib error
  */
 esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl);
 
+/**
+ * @brief Start several UVC streams with shared bus bandwidth
+ *
+ * Periodic bandwidth of all ISOC streams is reserved together before any of them starts. If the preferred alternate
+ * settings do not fit on the bus, the stream with the largest endpoint steps down to a smaller alternate setting first,
+ * until all streams fit. Streams started one by one with uvc_host_stream_start() would leave the last one with what remains.
+ *
+ * @param[in] stream_hdls Handles of stopped streams, e.g. from uvc_host_stream_open_group()
+ * @param[in] num_streams Number of streams, at most UVC_HOST_STREAM_GROUP_MAX
+ * @return
+ *     - ESP_OK: Success - all streams started
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_INVALID_STATE: One of the streams is already streaming
+ *     - ESP_ERR_NOT_FINISHED: Not enough periodic bus bandwidth, even for the smallest alternate settings
+ *     - Else: Error of uvc_host_stream_start() for one of the streams. No stream is left streaming
+ */
+esp_err_t uvc_host_stream_start_group(const uvc_host_stream_hdl_t *stream_hdls, size_t num_streams);
+
 /**
  * @brief Stop UVC stream
  *
@@ -219,6 +573,177 @@ esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl);
  */
 esp_err_t uvc_host_stream_stop(uvc_host_stream_hdl_t stream_hdl);
 
+/**
+ * @brief Put UVC stream to low-power idle, e.g. between motion triggers
+ *
+ * The camera stops sending video and ISOC streams switch to alternate setting 0, so their bus bandwidth is released.
+ * Unlike uvc_host_stream_stop(), frame buffers taken from the shared frame pool are kept. URBs, frame buffers and the
+ * committed format stay with the stream, so uvc_host_stream_start() wakes it with one SET_INTERFACE (ISOC) or VS_COMMIT (Bulk)
+ * request and submits URBs right after it.
+ *
+ * @note USB Host Library does not offer selective suspend of a device, so the camera stays powered in idle
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @return
+ *     - ESP_OK: Success - stream is idle
+ *     - ESP_ERR_INVALID_ARG: stream_hdl is NULL
+ *     - ESP_ERR_INVALID_STATE: Stream is not streaming
+ *     - Else: USB lib error
+ */
+esp_err_t uvc_host_stream_idle(uvc_host_stream_hdl_t stream_hdl);
+
+/**
+ * @brief Select new video format of opened UVC stream
+ *
+ * The format is negotiated with the device. Frame buffers are reused if they are large enough for the new format,
+ * USB transfers are reallocated only if the streaming endpoint's alternate setting changes.
+ * If the stream is streaming, it is stopped and restarted with the new format.
+ *
+ * @note If the frame buffers must be enlarged, all frames must be returned to the driver
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] vs_format  New Video Stream format
+ * @return
+ *     - ESP_OK: Success - new format selected
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or vs_format is NULL, or advanced.roi does not fit into the new format
+ *     - ESP_ERR_NOT_SUPPORTED: The format is not offered by the stream's Video Streaming interface
+ *     - ESP_ERR_INVALID_STATE: Frame buffers must be enlarged, but not all frames were returned
+ *     - ESP_ERR_NO_MEM: Not enough memory for new frame buffers or USB transfers
+ *     - Else: Format negotiation or USB lib error. The previous format is restored
+ */
+esp_err_t uvc_host_stream_format_select(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format);
+
+/**
+ * @brief Capture still image without stopping the video stream
+ *
+ * The still image format is negotiated with Still Probe and Commit controls, only when its resolution changes,
+ * and the image is requested with Still Image Trigger control. The device sends the still image instead of the next
+ * video frame (still capture method 2, or method 3 with bulk video endpoint). It is passed to the user like other frames,
+ * with info.still_image set. Frame buffers must be large enough for the still image: with adaptive_frame_size, they grow
+ * up to dwMaxVideoFrameSize of the still image. Larger still images are skipped as frame buffer overflow.
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] h_res      Horizontal resolution of the still image. 0 with v_res 0 for the largest still image of the current format
+ * @param[in] v_res      Vertical resolution of the still image
+ * @return
+ *     - ESP_OK: Still image requested
+ *     - ESP_ERR_INVALID_ARG: stream_hdl is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream is not started
+ *     - ESP_ERR_NOT_SUPPORTED: The device does not support still capture method 2 or 3 over the video endpoint,
+ *                              or the stream uses zero-copy mode or advanced.roi
+ *     - ESP_ERR_NOT_FOUND: The current format has no still image of this resolution
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_still_capture(uvc_host_stream_hdl_t stream_hdl, unsigned h_res, unsigned v_res);
+
+/**
+ * @brief Get statistics of UVC stream
+ *
+ * The counters are updated with atomic operations, this function can be called from any task at any time.
+ * fps and bitrate are averaged over time since previous call of this function (or since the stream was opened).
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[out] stats      Statistics of the stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or stats is NULL
+ */
+esp_err_t uvc_host_stream_get_stats(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_stats_t *stats);
+
+/**
+ * @brief Memory used by UVC stream
+ */
+typedef struct {
+    size_t urb_internal;              /**< Bytes of URB data buffers in internal memory */
+    size_t urb_external;              /**< Bytes of URB data buffers in external memory (PSRAM) */
+    size_t frame_internal;            /**< Bytes of frame buffers in internal memory */
+    size_t frame_external;            /**< Bytes of frame buffers in external memory (PSRAM) */
+} uvc_host_stream_mem_t;
+
+/**
+ * @brief Get memory used by UVC stream for URBs and frame buffers
+ *
+ * Frame buffers of the shared frame pool are counted only while this stream holds them.
+ * With adaptive_frame_size, a frame buffer that grows during this call can be counted with its previous size.
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[out] mem        Memory used by the stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or mem is NULL
+ */
+esp_err_t uvc_host_stream_get_mem_usage(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_mem_t *mem);
+
+/**
+ * @brief Get the last H.264/H.265 parameter sets received in the stream
+ *
+ * Parameter sets (VPS, SPS and PPS) are cached from the last frame that contained them, see uvc_host_frame_info_t::nal.
+ * They are returned in Annex B format, each with 4 byte start code, e.g. for SDP of a network streamer or for a decoder
+ * that joins the stream after a keyframe.
+ *
+ * @param[in]    stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[out]   buf        Buffer for parameter sets
+ * @param[inout] size       In: size of buf. Out: length of parameter sets
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or size is NULL, or buf is NULL and *size is not 0
+ *     - ESP_ERR_NOT_FOUND: No parameter sets were received yet
+ *     - ESP_ERR_INVALID_SIZE: buf is too small, *size is set to the required size
+ */
+esp_err_t uvc_host_stream_get_parameter_sets(uvc_host_stream_hdl_t stream_hdl, uint8_t *buf, size_t *size);
+
+/**
+ * @brief Check whether the camera implements a control
+ *
+ * Taken from bmControls of Camera Terminal and Processing Unit descriptors.
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] unit       Unit of the control
+ * @param[in] selector   Control selector
+ * @return true if the control is supported
+ */
+bool uvc_host_stream_control_is_supported(uvc_host_stream_hdl_t stream_hdl, uvc_host_control_unit_t unit, uint8_t selector);
+
+/**
+ * @brief Queue camera control requests without waiting for them
+ *
+ * Requests are sent to the device one after another in submission order, while the calling task continues, e.g. while
+ * streaming. The batch is queued whole or not at all. A SET_CUR request replaces a queued SET_CUR of the same control
+ * that was not sent yet, so only the newest value of e.g. a slider is sent. The callback of the replaced request is not called.
+ * uvc_host_stream_close() drops queued requests with ESP_ERR_INVALID_STATE; the request in flight completes without callback.
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] controls   Array of control requests. Copied, can be freed when this function returns
+ * @param[in] num        Number of control requests
+ * @param[in] cb         Called once for every request when it completes. Can be NULL
+ * @param[in] user_ctx   User's argument passed to cb
+ * @return
+ *     - ESP_OK: All requests were queued
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or controls is NULL, num is 0, or a request has invalid request code or length
+ *     - ESP_ERR_NOT_SUPPORTED: The camera does not implement one of the controls
+ *     - ESP_ERR_NO_MEM: Not enough space in the queue for the batch
+ *     - ESP_ERR_INVALID_STATE: The stream is being closed
+ */
+esp_err_t uvc_host_stream_control_submit(uvc_host_stream_hdl_t stream_hdl, const uvc_host_control_t *controls, size_t num,
+        uvc_host_control_callback_t cb, void *user_ctx);
+
+/**
+ * @brief Get the current value of a camera control without USB transfer
+ *
+ * The value is cached by completed GET_CUR and SET_CUR requests of uvc_host_stream_control_submit().
+ *
+ * @param[in]    stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in]    unit       Unit of the control
+ * @param[in]    selector   Control selector
+ * @param[out]   data       Buffer for the value
+ * @param[inout] len        In: size of data. Out: length of the value
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl, data or len is NULL, or selector is out of range
+ *     - ESP_ERR_NOT_FOUND: The value is not cached yet
+ *     - ESP_ERR_INVALID_SIZE: data is too small, *len is set to the length of the value
+ */
+esp_err_t uvc_host_stream_control_get_cached(uvc_host_stream_hdl_t stream_hdl, uvc_host_control_unit_t unit, uint8_t selector,
+        uint8_t *data, size_t *len);
+
 /**
  * @brief Close UVC device and release its resources
  *
@@ -235,6 +760,8 @@ esp_err_t uvc_host_stream_close(uvc_host_stream_hdl_t stream_hdl);
  *
  * Must not call this function if the frame callback returns true.
  * Must call this function after the frame is processed if the frame callback returns false.
+ * Drops the reference passed to the user, same as uvc_host_frame_unref(). The frame buffer is reused only after
+ * the last reference is dropped.
  *
  * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
  * @param[in] frame      Frame obtained from frame callback
@@ -245,10 +772,109 @@ esp_err_t uvc_host_stream_close(uvc_host_stream_hdl_t stream_hdl);
  */
 esp_err_t uvc_host_frame_return(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame);
 
+/**
+ * @brief Subscribe to complete frames of a stream
+ *
+ * Lets several consumers (e.g. display, recorder and network streamer) share each frame buffer without copying.
+ * Only for streams with UVC_HOST_FRAME_POLICY_CALLBACK. frame_cb of the stream can be NULL if subscribers are used.
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] cb         Subscriber callback, called from the task that processes the stream's transfers
+ * @param[in] user_ctx   User's argument passed to cb
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or cb is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream does not use UVC_HOST_FRAME_POLICY_CALLBACK
+ *     - ESP_ERR_NO_MEM: The stream has UVC_HOST_FRAME_SUBSCRIBERS_MAX subscribers already
+ */
+esp_err_t uvc_host_frame_subscribe(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_subscriber_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Unsubscribe from complete frames of a stream
+ *
+ * If a frame is being delivered at the moment, cb can still be called with it once.
+ * References taken by the subscriber must be dropped with uvc_host_frame_unref().
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] cb         Subscriber callback passed to uvc_host_frame_subscribe()
+ * @param[in] user_ctx   User's argument passed to uvc_host_frame_subscribe()
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl is NULL
+ *     - ESP_ERR_NOT_FOUND: No such subscriber
+ */
+esp_err_t uvc_host_frame_unsubscribe(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_subscriber_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Take a reference to a frame
+ *
+ * The frame buffer is not reused until every reference is dropped with uvc_host_frame_unref().
+ * Can be called from any task for a frame the caller already holds, e.g. in a subscriber callback or frame_cb.
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] frame      Frame of this stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or frame is NULL, or the frame does not belong to this stream
+ *     - ESP_ERR_INVALID_STATE: The frame was already returned to the driver
+ */
+esp_err_t uvc_host_frame_ref(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame);
+
+/**
+ * @brief Drop a reference to a frame
+ *
+ * The frame buffer is returned to the driver when the last reference is dropped.
+ *
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in] frame      Frame taken with uvc_host_frame_ref()
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or frame is NULL, or the frame does not belong to this stream
+ *     - ESP_FAIL: The frame was already returned to the driver
+ */
+esp_err_t uvc_host_frame_unref(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame);
+
+/**
+ * @brief Take the newest complete frame
+ *
+ * Only for streams opened with UVC_HOST_FRAME_POLICY_LATEST. Each frame is returned only once: if no new frame was completed
+ * since the previous call, this function waits for the next one.
+ * The frame must be returned with uvc_host_frame_return() after it is processed.
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[out] frame_ret  Newest complete frame
+ * @param[in]  timeout    Timeout in FreeRTOS ticks to wait for a new frame
+ * @return
+ *     - ESP_OK: Success - frame_ret holds the newest frame
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or frame_ret is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream does not use UVC_HOST_FRAME_POLICY_LATEST
+ *     - ESP_ERR_TIMEOUT: No new frame was completed in time
+ */
+esp_err_t uvc_host_frame_get_latest(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t **frame_ret, int timeout);
+
+/**
+ * @brief Take the oldest complete frame from the stream's queue
+ *
+ * Only for streams opened with UVC_HOST_FRAME_POLICY_ACQUIRE. Can be called from any task, frames are received in order.
+ * The frame must be returned with uvc_host_frame_return() after it is processed. Frames that are held by the user
+ * are not available for reception, which gives the application control over back-pressure.
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[out] frame_ret  Oldest complete frame
+ * @param[in]  timeout    Timeout in FreeRTOS ticks to wait for a frame
+ * @return
+ *     - ESP_OK: Success - frame_ret holds the frame
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or frame_ret is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream does not use UVC_HOST_FRAME_POLICY_ACQUIRE
+ *     - ESP_ERR_TIMEOUT: No frame was completed in time
+ */
+esp_err_t uvc_host_frame_acquire(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t **frame_ret, int timeout);
+
 /**
  * @brief Print device's descriptors
  *
  * Device and full Configuration descriptors are printed in human readable format to stdout.
+ * Nothing is printed if CONFIG_UVC_HOST_MINIMAL is enabled.
  *
  * @param stream_hdl UVC handle obtained from uvc_host_stream_open()
  */
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "usb/usb_host.h"
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+#include "uvc_descriptors_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create queue of asynchronous camera control requests
+ *
+ * The queue has its own CTRL transfer, so queued requests do not block synchronous requests of uvc_host_usb_ctrl().
+ *
+ * @param[in]  uvc_stream UVC stream
+ * @param[in]  client_hdl USB Host client that submits the CTRL transfers
+ * @param[in]  units      Camera Terminal and Processing Unit of the stream's UVC function
+ * @param[out] ctrl_ret   Control queue
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t uvc_ctrl_async_create(uvc_stream_t *uvc_stream, usb_host_client_handle_t client_hdl, const uvc_desc_control_units_t *units, uvc_ctrl_async_t **ctrl_ret);
+
+/**
+ * @brief Delete control queue
+ *
+ * Callbacks of queued requests are called with ESP_ERR_INVALID_STATE. If a request is in flight, the queue is freed
+ * when it completes, without calling its callback. Does not block, so it can be called from the driver's task.
+ *
+ * @param[in] ctrl Control queue. Can be NULL
+ */
+void uvc_ctrl_async_delete(uvc_ctrl_async_t *ctrl);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,6 +16,13 @@ extern portMUX_TYPE uvc_lock;
 #define UVC_EXIT_CRITICAL()               portEXIT_CRITICAL(&uvc_lock)
 
 #define UVC_ATOMIC_LOAD(x)                __atomic_load_n(&x, __ATOMIC_SEQ_CST)
+#define UVC_ATOMIC_STORE(x, new_x)        __atomic_store_n(&(x), (new_x), __ATOMIC_SEQ_CST)
+#define UVC_ATOMIC_EXCHANGE(x, new_x)     __atomic_exchange_n(&(x), (new_x), __ATOMIC_SEQ_CST)
+#define UVC_ATOMIC_ADD(x, val)            __atomic_fetch_add(&(x), (val), __ATOMIC_RELAXED) // For statistics counters, no ordering needed
+#define UVC_ATOMIC_SET_IF(x, old_x, new_x) ({ \
+                                              __typeof__(x) expected = (old_x); \
+                                              __atomic_compare_exchange_n(&(x), &expected, (new_x), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+                                          })
 #define UVC_ATOMIC_SET_IF_NULL(x, new_x)  ({ \
                                               __typeof__(x) expected = NULL; \
                                               __atomic_compare_exchange_n(&(x), &expected, (new_x), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
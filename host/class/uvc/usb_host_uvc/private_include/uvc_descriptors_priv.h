@@ -19,6 +19,204 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Format of Video Streaming interface with its frames
+ */
+typedef struct {
+    const uvc_format_desc_t *format_desc;     // Format descriptor. NULL if the device did not provide it
+    int format;                               // Format of this driver, enum uvc_host_stream_format
+    uint8_t num_frames;                       // bNumFrameDescriptors of the format
+    const uvc_frame_desc_t **frame_descs;     // Frame descriptors indexed by bFrameIndex - 1
+    const uvc_still_image_frame_desc_t *still_desc; // Still Image Frame descriptor. NULL if the format has no still images
+} uvc_desc_index_format_t;
+
+/**
+ * @brief Alternate setting of Video Streaming interface
+ */
+typedef struct {
+    const usb_intf_desc_t *intf_desc;         // Interface descriptor. NULL if the device did not provide it
+    const usb_ep_desc_t *ep_desc;             // Streaming endpoint. NULL for zero bandwidth alternate setting
+} uvc_desc_index_alt_t;
+
+/**
+ * @brief Index of Video Streaming interface descriptors
+ *
+ * Built in one pass over the configuration descriptor. Lookups then do not walk the descriptors again.
+ * Pointers point into the configuration descriptor, which must outlive the index.
+ */
+typedef struct {
+    const usb_config_desc_t *cfg_desc;        // Indexed configuration descriptor
+    uint8_t bInterfaceNumber;                 // Indexed Video Streaming interface
+    uint8_t bStillCaptureMethod;              // bStillCaptureMethod of Video Streaming input header
+    uint8_t num_formats;                      // bNumFormats of Video Streaming input header
+    uvc_desc_index_format_t *formats;         // Formats indexed by bFormatIndex - 1
+    uint8_t num_alts;                         // Number of alternate settings
+    uvc_desc_index_alt_t *alts;               // Alternate settings indexed by bAlternateSetting
+} uvc_desc_index_t;
+
+/**
+ * @brief Build index of Video Streaming interface
+ *
+ * @param[in]  cfg_desc         Configuration descriptor
+ * @param[in]  bInterfaceNumber Video Streaming interface
+ * @param[out] index_ret        Index, free it with uvc_desc_index_free()
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: cfg_desc or index_ret is NULL
+ *     - ESP_ERR_NOT_FOUND: bInterfaceNumber is not a Video Streaming interface
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t uvc_desc_index_build(const usb_config_desc_t *cfg_desc, uint8_t bInterfaceNumber, uvc_desc_index_t **index_ret);
+
+/**
+ * @brief Free index of Video Streaming interface
+ *
+ * @param[in] index Index to free. Can be NULL
+ */
+void uvc_desc_index_free(uvc_desc_index_t *index);
+
+/**
+ * @brief Get Format and Frame descriptors by their indexes
+ *
+ * @param[in]  index           Index of Video Streaming interface
+ * @param[in]  bFormatIndex    Format index, from 1
+ * @param[in]  bFrameIndex     Frame index, from 1
+ * @param[out] format_desc_ret Format descriptor
+ * @param[out] frame_desc_ret  Frame descriptor
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_NOT_FOUND: The interface does not offer such format or frame
+ */
+esp_err_t uvc_desc_index_get_frame_format_by_index(
+    const uvc_desc_index_t *index,
+    uint8_t bFormatIndex,
+    uint8_t bFrameIndex,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret);
+
+/**
+ * @brief Get Format and Frame descriptors that offer the Video Stream format
+ *
+ * @param[in]  index           Index of Video Streaming interface
+ * @param[in]  vs_format       Video Stream format
+ * @param[out] format_desc_ret Format descriptor. Can be NULL
+ * @param[out] frame_desc_ret  Frame descriptor. Can be NULL
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: index or vs_format is NULL
+ *     - ESP_ERR_NOT_FOUND: The interface does not offer the format
+ */
+esp_err_t uvc_desc_index_get_frame_format_by_format(
+    const uvc_desc_index_t *index,
+    const uvc_host_stream_format_t *vs_format,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret);
+
+/**
+ * @brief Image size pattern of Still Image Frame descriptor
+ */
+typedef struct {
+    uint8_t bFrameIndex;                      // Index of the pattern, from 1. Used as bFrameIndex of Still Probe Control
+    uint8_t bCompressionIndex;                // Index of the first compression pattern, 0 if the descriptor has none
+    uint8_t bEndpointAddress;                 // Bulk still image endpoint for method 3. 0: Still images are sent over the video endpoint
+    uint16_t wWidth;                          // Horizontal resolution of the still image
+    uint16_t wHeight;                         // Vertical resolution of the still image
+} uvc_desc_still_size_t;
+
+/**
+ * @brief Get still image size pattern of a format
+ *
+ * @param[in]  index        Index of Video Streaming interface
+ * @param[in]  bFormatIndex Format index, from 1
+ * @param[in]  h_res        Horizontal resolution. 0 with v_res 0 for the largest pattern
+ * @param[in]  v_res        Vertical resolution
+ * @param[out] size_ret     Image size pattern
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: index or size_ret is NULL
+ *     - ESP_ERR_NOT_FOUND: The format has no still images of this size
+ */
+esp_err_t uvc_desc_index_get_still_size(
+    const uvc_desc_index_t *index,
+    uint8_t bFormatIndex,
+    unsigned h_res,
+    unsigned v_res,
+    uvc_desc_still_size_t *size_ret);
+
+/**
+ * @brief Get Streaming Interface and Endpoint descriptors from the index
+ *
+ * @see uvc_desc_get_streaming_intf_and_ep()
+ */
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep(
+    const uvc_desc_index_t *index,
+    uint16_t dwMaxPayloadTransferSize,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
+/**
+ * @brief Get Streaming Interface and Endpoint descriptors that meet required bandwidth from the index
+ *
+ * @see uvc_desc_get_streaming_intf_and_ep_by_bandwidth()
+ */
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+    const uvc_desc_index_t *index,
+    bool high_speed,
+    uint32_t bytes_per_second,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
+/**
+ * @brief Get a known alternate setting of Streaming Interface and its Endpoint from the index
+ *
+ * Used for alternate settings selected in earlier sessions with the same device.
+ *
+ * @param[in]  index             Index of Video Streaming interface
+ * @param[in]  bAlternateSetting Alternate setting
+ * @param[in]  bEndpointAddress  Expected streaming endpoint of the alternate setting
+ * @param[in]  max_mps           Maximum MPS that fits in IN FIFO
+ * @param[out] intf_desc_ret     Interface descriptor of the alternate setting
+ * @param[out] ep_desc_ret       Streaming endpoint of this alternate setting
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_NOT_FOUND: The alternate setting does not exist, does not have the endpoint or its MPS is too large
+ */
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_by_alt(
+    const uvc_desc_index_t *index,
+    uint8_t bAlternateSetting,
+    uint8_t bEndpointAddress,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
+/**
+ * @brief Get the next smaller ISOC alternate setting of Streaming Interface from the index
+ *
+ * Used when the bus does not have enough periodic bandwidth left for the selected alternate setting.
+ *
+ * @param[in]  index         Index of Video Streaming interface
+ * @param[in]  high_speed    The device is connected at High Speed
+ * @param[in]  ep_desc       Streaming endpoint of the current alternate setting
+ * @param[in]  max_mps       Maximum MPS that fits in IN FIFO
+ * @param[out] intf_desc_ret Alternate setting with the largest reserved bandwidth below the current one
+ * @param[out] ep_desc_ret   Streaming endpoint of this alternate setting
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_NOT_FOUND: The current alternate setting is the smallest one
+ */
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_step_down(
+    const uvc_desc_index_t *index,
+    bool high_speed,
+    const usb_ep_desc_t *ep_desc,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
 /**
  * @brief Helper to convert UVC format desc to this driver format
  *
@@ -34,6 +232,64 @@ esp_err_t uvc_desc_get_streaming_interface_num(
     uint16_t *bcdUVC,
     uint8_t *bInterfaceNumber);
 
+/**
+ * @brief Get frame formats of all Video Streaming interfaces of UVC function
+ *
+ * @param[in]    cfg_desc   Configuration descriptor
+ * @param[in]    uvc_index  Index of UVC function
+ * @param[out]   frame_list Frame formats. Can be NULL
+ * @param[inout] list_size  In: Length of frame_list. Out: Number of all frame formats
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: cfg_desc or list_size is NULL
+ *     - ESP_ERR_NOT_FOUND: UVC function not found
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t uvc_desc_get_frame_list(const usb_config_desc_t *cfg_desc, uint8_t uvc_index, uvc_host_frame_list_entry_t *frame_list, size_t *list_size);
+
+/**
+ * @brief Get device clock frequency of UVC function
+ *
+ * @param[in] cfg_desc  Configuration descriptor
+ * @param[in] uvc_index Index of UVC function
+ * @return dwClockFrequency from Video Control Interface Header descriptor, 0 if not found
+ */
+uint32_t uvc_desc_get_clock_frequency(const usb_config_desc_t *cfg_desc, uint8_t uvc_index);
+
+/**
+ * @brief Units of Video Control interface with camera controls
+ */
+typedef struct {
+    uint8_t bInterfaceNumber;       // Video Control interface
+    uint8_t camera_terminal_id;     // bTerminalID of Camera Terminal. 0 if not found
+    uint32_t camera_controls;       // bmControls of Camera Terminal
+    uint8_t processing_unit_id;     // bUnitID of Processing Unit. 0 if not found
+    uint32_t processing_controls;   // bmControls of Processing Unit
+} uvc_desc_control_units_t;
+
+/**
+ * @brief Get Camera Terminal and Processing Unit of UVC function
+ *
+ * @param[in]  cfg_desc  Configuration descriptor
+ * @param[in]  uvc_index Index of UVC function
+ * @param[out] units     Units of the Video Control interface. The first Camera Terminal and Processing Unit are used
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: cfg_desc or units is NULL
+ *     - ESP_ERR_NOT_FOUND: UVC function was not found
+ */
+esp_err_t uvc_desc_get_control_units(const usb_config_desc_t *cfg_desc, uint8_t uvc_index, uvc_desc_control_units_t *units);
+
+/**
+ * @brief Check whether a control is supported
+ *
+ * @param[in] units    Units from uvc_desc_get_control_units()
+ * @param[in] subtype  UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL for Camera Terminal controls or UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT
+ * @param[in] selector Control selector, enum uvc_ct_ctrl_selector or enum uvc_pu_ctrl_selector
+ * @return true if the unit exists and its bmControls has the control
+ */
+bool uvc_desc_control_is_supported(const uvc_desc_control_units_t *units, uint8_t subtype, uint8_t selector);
+
 /**
  * @brief Get Streaming Interface and Endpoint descriptors
  *
@@ -60,6 +316,48 @@ esp_err_t uvc_desc_get_streaming_intf_and_ep(
     const usb_intf_desc_t **intf_desc_ret,
     const usb_ep_desc_t **ep_desc_ret);
 
+/**
+ * @brief Get service interval of an endpoint
+ *
+ * @param[in] ep_desc    Endpoint descriptor
+ * @param[in] high_speed The device is connected at High Speed
+ * @return Service interval in microseconds
+ */
+uint32_t uvc_desc_get_ep_interval_us(const usb_ep_desc_t *ep_desc, bool high_speed);
+
+/**
+ * @brief Get Streaming Interface and Endpoint descriptors that meet required bandwidth
+ *
+ * We go through all alternate interfaces and pick the one that:
+ * * Can transfer bytes_per_second (but at most dwMaxPayloadTransferSize in one service interval)
+ * * Reserves the least bus bandwidth, so other devices can use the rest
+ *
+ * If no alternate setting meets the bandwidth, the one with maximum bandwidth is returned.
+ * Bulk interfaces have only one alternate setting which is always returned.
+ *
+ * @param[in] cfg_desc                 Configuration descriptor
+ * @param[in] bInterfaceNumber         Index of Streaming interface
+ * @param[in] high_speed               The device is connected at High Speed
+ * @param[in] bytes_per_second         Required bandwidth, including headroom
+ * @param[in] dwMaxPayloadTransferSize Maximum payload in one service interval from format negotiation. 0 if unknown
+ * @param[in] max_mps                  Maximum MPS that fits in IN FIFO
+ * @param[out] intf_desc_ret           Interface descriptor
+ * @param[out] ep_desc_ret             Endpoint descriptor
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: cfg_desc, intf_desc_ret or ep_desc_ret is NULL
+ *     - ESP_ERR_NOT_FOUND: Could not find interface with required parameters
+ */
+esp_err_t uvc_desc_get_streaming_intf_and_ep_by_bandwidth(
+    const usb_config_desc_t *cfg_desc,
+    uint8_t bInterfaceNumber,
+    bool high_speed,
+    uint32_t bytes_per_second,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
 esp_err_t uvc_desc_get_frame_format_by_index(
     const usb_config_desc_t *cfg_desc,
     uint8_t bInterfaceNumber,
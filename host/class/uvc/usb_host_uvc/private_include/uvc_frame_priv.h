@@ -13,11 +13,22 @@
 extern "C" {
 #endif
 
+#define UVC_FRAME_POOL_MAX (32) // Free frame buffers are tracked in one 32-bit mask
+
+/**
+ * @brief Reason for skipping a frame, for stream statistics
+ */
+typedef enum {
+    UVC_FRAME_SKIP_ERROR,     // Error bit in payload header or USB error
+    UVC_FRAME_SKIP_OVERFLOW,  // Frame buffer overflow
+    UVC_FRAME_SKIP_UNDERFLOW, // No free frame buffer
+} uvc_frame_skip_reason_t;
+
 /**
  * @brief Allocate frame buffers for UVC stream
  *
  * @param[in] uvc_stream UVC stream handle
- * @param[in] nb_of_fb   Number of frame buffers to allocate
+ * @param[in] nb_of_fb   Number of frame buffers to allocate, up to UVC_FRAME_POOL_MAX
  * @param[in] fb_size    Size of 1 frame buffer in bytes
  * @param[in] fb_caps    Memory capabilities of memory for frame buffers
  * @return
@@ -27,14 +38,77 @@ extern "C" {
  */
 esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_size, uint32_t fb_caps);
 
+/**
+ * @brief Allocate frame buffers for UVC stream from shared frame pool
+ *
+ * Only frame buffer descriptors are allocated. The first nb_reserved frame buffers get a slab from the pool now,
+ * others get one in uvc_frame_get_empty() and put it back when they are returned.
+ *
+ * @param[in] uvc_stream  UVC stream handle
+ * @param[in] pool        Shared frame pool
+ * @param[in] nb_of_fb    Maximum number of frame buffers of this stream, up to UVC_FRAME_POOL_MAX
+ * @param[in] nb_reserved Number of frame buffers that keep their slab until uvc_frame_free(), up to nb_of_fb
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory for frame buffer descriptors or not enough free slabs in the pool
+ *     - ESP_ERR_INVALID_ARG: Invalid count of frame buffers
+ */
+esp_err_t uvc_frame_allocate_shared(uvc_stream_t *uvc_stream, uvc_frame_slab_pool_t *pool, int nb_of_fb, int nb_reserved);
+
 /**
  * @brief Free allocated frame buffers
  *
+ * Slabs of shared frame pool are put back to the pool.
+ *
  * @attention The caller must ensure that the frame buffers are not accessed after this call and that streaming is not on
  * @param[in] uvc_stream UVC stream
  */
 void uvc_frame_free(uvc_stream_t *uvc_stream);
 
+/**
+ * @brief Create shared frame pool
+ *
+ * All slabs are allocated in one block.
+ *
+ * @param[in]  num_slabs Number of slabs
+ * @param[in]  slab_size Size of one slab in bytes
+ * @param[in]  heap_caps Memory capabilities of the slabs
+ * @param[out] pool_ret  Shared frame pool
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid count or size of slabs
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t uvc_frame_pool_create(int num_slabs, size_t slab_size, uint32_t heap_caps, uvc_frame_slab_pool_t **pool_ret);
+
+/**
+ * @brief Delete shared frame pool
+ *
+ * @attention Frame buffers of all streams that use this pool must be freed
+ * @param[in] pool Shared frame pool. Can be NULL
+ */
+void uvc_frame_pool_delete(uvc_frame_slab_pool_t *pool);
+
+/**
+ * @brief Put slabs of free frame buffers back to shared frame pool
+ *
+ * uvc_host_stream_pause() returns the frame in progress with its slab, because processing of the last URB can still write to it.
+ * Call this function once the stream's URBs are not processed anymore. Reserved frame buffers keep their slabs.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_pool_trim(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Return frame in progress to the stream
+ *
+ * Same as uvc_host_frame_return(), but a slab of shared frame pool stays with the frame buffer, see uvc_frame_pool_trim().
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer that was current frame of the stream
+ */
+void uvc_frame_return_current(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
 /**
  * @brief Check if all frame buffers are returned to this driver
  *
@@ -48,23 +122,193 @@ bool uvc_frame_are_all_returned(uvc_stream_t *uvc_stream);
 /**
  * @brief Get empty frame buffer
  *
+ * Lock-free, it can run concurrently with uvc_host_frame_return() from other tasks.
+ * With adaptive frame size, a frame buffer smaller than the largest received frame is enlarged before it is returned.
+ * With latest frame policy, the published frame that was not taken by the user is reused if the pool is empty.
+ *
  * @param[in] uvc_stream UVC stream
  * @return Pointer to empty frame buffer. Can be NULL if not frame buffer is available.
  */
 uvc_host_frame_t *uvc_frame_get_empty(uvc_stream_t *uvc_stream);
 
+/**
+ * @brief Pass complete frame to the user
+ *
+ * Callback policy: the frame is passed to subscribers, then to frame_cb.
+ * Latest frame policy: the frame is published for uvc_host_frame_get_latest(), a previously published frame that was not taken
+ * is returned to the pool.
+ * Acquire policy: the frame is queued for uvc_host_frame_acquire().
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Complete frame
+ * @return
+ *     - true:  The frame can be returned to the pool now
+ *     - false: The frame is owned by the user
+ */
+bool uvc_frame_pass_to_user(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Return published frame that was not taken by the user
+ *
+ * Latest frame policy only, does nothing otherwise. Called when the stream is paused, so all frames can be returned.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_latest_release(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Return queued frames that were not acquired by the user
+ *
+ * Acquire policy only, does nothing otherwise. Called when the stream is paused, so all frames can be returned.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_queue_release(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Set frame buffer that is being written to
+ *
+ * Must be called only from the thread that processes the stream's transfers.
+ * If the stream is paused concurrently, the frame is returned to the pool.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Empty frame buffer from uvc_frame_get_empty()
+ */
+void uvc_frame_set_current(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Make room for more data in the frame buffer
+ *
+ * With adaptive frame size, the frame buffer is enlarged if the data do not fit.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @param[in] data_len   Number of bytes that will be added after frame->data_len
+ * @return
+ *     - ESP_OK: There is room for data_len more bytes
+ *     - ESP_ERR_INVALID_SIZE: Frame buffer overflow
+ */
+esp_err_t uvc_frame_reserve(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, size_t data_len);
+
 /**
  * @brief Add data to the frame buffer
  *
- * @param[in] frame    Frame buffer
- * @param[in] data     Pointer to data
- * @param[in] data_len Data length in bytes
+ * With adaptive frame size, the frame buffer is enlarged if the data do not fit.
+ * With region of interest, only bytes inside the window are added.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @param[in] data       Pointer to data
+ * @param[in] data_len   Data length in bytes
  * @return
  *     - ESP_OK: Data added to the frame buffer
  *     - ESP_ERR_INVALID_ARG: frame or data is NULL
  *     - ESP_ERR_INVALID_SIZE: Frame buffer overflow
  */
-esp_err_t uvc_frame_add_data(uvc_host_frame_t *frame, const uint8_t *data, size_t data_len);
+esp_err_t uvc_frame_add_data(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *data, size_t data_len);
+
+/**
+ * @brief Set region of interest of uncompressed frames
+ *
+ * @note The stream must be stopped
+ * @param[in] uvc_stream UVC stream
+ * @param[in] roi        Window in pixels. Width 0 disables ROI
+ * @param[in] vs_format  Format the window must fit into
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: The format is not uncompressed or the window does not fit into it. ROI of the stream is not changed
+ */
+esp_err_t uvc_frame_roi_set(uvc_stream_t *uvc_stream, const uvc_host_roi_t *roi, const uvc_host_stream_format_t *vs_format);
+
+/**
+ * @brief Get size of frame cropped to region of interest
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return Size of the window in bytes. 0 if ROI is not used
+ */
+size_t uvc_frame_roi_size(const uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Start metadata of a new frame
+ *
+ * Called on Start of Frame. Increments the sequence number and saves the host timestamp.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_info_start(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Decide whether the frame that is starting is dropped by frame decimation
+ *
+ * Called on Start of Frame, after uvc_frame_info_start(). The first frame and then every n-th frame is kept, as well as still images.
+ * A dropped frame is marked to be skipped, so no frame buffer is taken and its data are not copied. It is not counted as skipped frame.
+ *
+ * @param[in] uvc_stream     UVC stream
+ * @param[in] payload_header Payload header that starts the frame
+ * @return
+ *     - true:  The frame is dropped
+ *     - false: The frame is assembled
+ */
+bool uvc_frame_decimate(uvc_stream_t *uvc_stream, const uvc_payload_header_t *payload_header);
+
+/**
+ * @brief Save PTS, SCR and still image flag from payload header
+ *
+ * PTS and SCR of the first payload header that contains them are kept for the whole frame.
+ *
+ * @param[in] uvc_stream     UVC stream
+ * @param[in] payload_header Payload header of the received packet
+ */
+void uvc_frame_info_parse_header(uvc_stream_t *uvc_stream, const uvc_payload_header_t *payload_header);
+
+/**
+ * @brief Finish metadata of the frame and store them in the frame buffer
+ *
+ * Called on End of Frame, before the frame is passed to the user. With region of interest, the resolution of the window
+ * is stored in the frame's format. Still images get the resolution of the committed still image format.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ */
+void uvc_frame_info_finish(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Pass new data of the frame to slice callback
+ *
+ * Does nothing if slice mode is not used or less than slice_size bytes were added since previous slice.
+ *
+ * @param[in] uvc_stream   UVC stream
+ * @param[in] frame        Frame buffer that is being assembled
+ * @param[in] end_of_frame Pass the rest of the frame as last slice
+ */
+void uvc_frame_slice_deliver(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame, bool end_of_frame);
+
+/**
+ * @brief Inform slice callback that the frame was dropped
+ *
+ * Does nothing if no slice of the current frame was delivered.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_slice_drop(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Skip current frame
+ *
+ * Only the first reason is counted in stream statistics.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] reason     Reason for skipping the frame
+ */
+void uvc_frame_skip(uvc_stream_t *uvc_stream, uvc_frame_skip_reason_t reason);
+
+/**
+ * @brief Count complete frame in stream statistics
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame passed to the user
+ */
+void uvc_frame_delivered(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame);
 
 /**
  * @brief Reset a frame buffer
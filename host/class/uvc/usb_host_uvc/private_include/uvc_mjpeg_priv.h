@@ -0,0 +1,51 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Check structure of JPEG image
+ *
+ * The image must start with SOI and end with EOI (zero padding after EOI is allowed). Header segments between them
+ * must have valid lengths and include a Start of Frame before Start of Scan, followed by entropy-coded data.
+ * Entropy-coded data are not parsed.
+ *
+ * @param[in] data JPEG image
+ * @param[in] len  Length of the image in bytes
+ * @return true if the structure is valid
+ */
+bool uvc_mjpeg_is_intact(const uint8_t *data, size_t len);
+
+/**
+ * @brief Check integrity of complete MJPEG frame
+ *
+ * Called on End of Frame, before the metadata are stored in the frame buffer.
+ * Does nothing for formats other than MJPEG or with UVC_HOST_MJPEG_CHECK_OFF.
+ * Frames much smaller than the running average of recent frames are considered truncated.
+ * With UVC_HOST_MJPEG_CHECK_FLAG, corrupted frames are marked in frame metadata.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Complete frame buffer
+ * @return
+ *     - true:  The frame can be passed to the user
+ *     - false: The frame is corrupted and was counted as skipped (UVC_HOST_MJPEG_CHECK_DROP)
+ */
+bool uvc_mjpeg_check(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
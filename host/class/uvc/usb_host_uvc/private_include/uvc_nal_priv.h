@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start NAL unit tracking of a new frame
+ *
+ * Called on Start of Frame, after frame metadata were reset.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_nal_start(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Find NAL units in data added to the frame
+ *
+ * Only bytes added since the previous call are scanned for Annex B start codes, while they are still in cache.
+ * Does nothing for formats other than H.264 and H.265.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer that is being assembled
+ */
+void uvc_nal_scan(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame);
+
+/**
+ * @brief Finish NAL units of the frame
+ *
+ * Called on End of Frame, before the metadata are stored in the frame buffer.
+ * The last NAL unit is closed and parameter sets of the frame are cached in the stream.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Complete frame buffer
+ */
+void uvc_nal_finish(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_types_uvc.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Results of format negotiation of known cameras, stored in NVS
+ *
+ * Entries are keyed by VID, PID, bcdDevice, bus speed, Video Streaming interface, format and bandwidth mode.
+ * The committed Video Stream control is stored together with the selected alternate setting and its endpoint.
+ */
+
+/**
+ * @brief Stored negotiation result
+ */
+typedef struct {
+    uvc_vs_ctrl_t vs_ctrl;          // Committed Video Stream control
+    uint8_t bAlternateSetting;      // Alternate setting selected for vs_ctrl
+    uint8_t bEndpointAddress;       // Streaming endpoint of the alternate setting
+} uvc_negotiation_cache_result_t;
+
+/**
+ * @brief Find stored negotiation result of the format
+ *
+ * @param[in]  uvc_stream UVC stream, with found Streaming interface and known bus speed
+ * @param[in]  vs_format  Requested Video Stream format
+ * @param[out] result     Stored result
+ * @return
+ *     - ESP_OK: Result found
+ *     - ESP_ERR_NOT_FOUND: The camera or format is not known
+ */
+esp_err_t uvc_negotiation_cache_load(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format,
+                                     uvc_negotiation_cache_result_t *result);
+
+/**
+ * @brief Store negotiation result of the format
+ *
+ * @param[in] uvc_stream UVC stream with committed format and claimed interface
+ * @param[in] vs_format  Negotiated Video Stream format
+ * @return esp_err_t
+ */
+esp_err_t uvc_negotiation_cache_store(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format);
+
+/**
+ * @brief Remove stored negotiation result of the format
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] vs_format  Video Stream format
+ * @return esp_err_t
+ */
+esp_err_t uvc_negotiation_cache_remove(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format);
+
+/**
+ * @brief Remove all stored results
+ *
+ * @return esp_err_t
+ */
+esp_err_t uvc_negotiation_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
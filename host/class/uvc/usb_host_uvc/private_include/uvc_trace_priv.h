@@ -0,0 +1,17 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "usb/usb_host_class_trace.h"
+#include "usb/usb_class_stats.h"
+
+// Trace points on the transfer path, compiled out unless enabled in menuconfig
+#define UVC_TRACE(event, xfer) USB_HOST_CLASS_TRACE(USB_HOST_CLASS_TRACE_UVC, USB_HOST_CLASS_TRACE_##event, xfer)
+
+// Counters of the stream in usb_class_stats registry, compiled out unless enabled in menuconfig
+#define UVC_CLASS_STATS_CB_ENTER(uvc_stream) USB_CLASS_STATS_CB_ENTER((uvc_stream)->constant.class_stats)
+#define UVC_CLASS_STATS_CB_EXIT(uvc_stream)  USB_CLASS_STATS_CB_EXIT((uvc_stream)->constant.class_stats)
@@ -12,19 +12,35 @@
 
 #include "usb/usb_host.h"
 #include "usb/uvc_host.h"
+#include "uvc_descriptors_priv.h"
+#include "usb/usb_class_stats.h"
+#include "usb/usb_host_bw.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 typedef struct uvc_host_stream_s uvc_stream_t;
+typedef struct uvc_frame_slab_pool_s uvc_frame_slab_pool_t;
+typedef struct uvc_ctrl_async_s uvc_ctrl_async_t;
+
+#define UVC_NAL_PARAMETER_SETS_SIZE (256) // Parameter sets of typical cameras take less than 100 bytes
+
+/**
+ * @brief Data buffer of usb_transfer_t
+ */
+typedef struct {
+    uint8_t *data_buffer;
+    size_t data_buffer_size;
+} uvc_urb_buf_t;
 
 /**
- * @brief Enum for simple state machine of Bulk frame data processing
+ * @brief Enum for simple state machine of Bulk payload tracking
  */
 typedef enum {
-    UVC_STREAM_BULK_PACKET_SOF = 0,
-    UVC_STREAM_BULK_PACKET_DATA,
-    UVC_STREAM_BULK_PACKET_EOF,
+    UVC_STREAM_BULK_PACKET_SOF = 0, // Payload header of a new frame is expected
+    UVC_STREAM_BULK_PACKET_DATA,    // Payload data are expected
+    UVC_STREAM_BULK_PACKET_EOF,     // Payload header of the frame in progress is expected. It can signal End of Frame
 } uvc_stream_bulk_packet_type_t;
 
 struct uvc_host_stream_s {
@@ -34,30 +50,136 @@ struct uvc_host_stream_s {
         // UVC driver related members
         uvc_host_stream_callback_t stream_cb; // User's callback for stream events
         uvc_host_frame_callback_t frame_cb;   // User's frame callback
+        uvc_host_payload_callback_t payload_cb; // User's payload callback. If set, frames are not assembled by this driver
+        uvc_host_payload_segment_t *segments; // Scatter-gather list passed to payload_cb, one entry per ISOC packet
+        unsigned max_segments;                // Length of segments array
+        uvc_host_slice_callback_t slice_cb;   // User's slice callback
+        size_t slice_size;                    // Minimum size of one slice
         void *cb_arg;                         // Common argument for user's callbacks
-        uvc_host_stream_format_t vs_format;   // Format of the video stream (Runtime format change of opened stream is not supported)
-        QueueHandle_t empty_fb_queue;         // Queue of empty framebuffers
+        uvc_host_stream_format_t vs_format;   // Format of the video stream. Changed only by uvc_host_stream_format_select() while the stream is stopped
+        size_t frame_size;                    // User's frame buffer size. 0: Use dwMaxVideoFrameSize from format negotiation
+        uint32_t frame_heap_caps;             // Memory capabilities of frame buffers
+        bool adaptive_frame_size;             // Frame buffers grow according to received frames
+        size_t frame_size_max;                // Adaptive frame size only: frame buffers never grow above this size. 0: No limit
+        size_t urb_size;                      // Requested size of 1 URB
+        uint32_t urb_heap_caps;               // Memory capabilities of URB data buffers. 0: Buffers allocated by the USB Host Library
+        size_t urb_alignment;                 // Alignment of URB data buffers allocated with urb_heap_caps. 0: Cache line of the memory
+        bool auto_bandwidth;                  // Alternate setting and URBs are derived from negotiated format
+        bool bulk_payload_urbs;               // Bulk URBs are sized to dwMaxPayloadTransferSize of negotiated format
+        bool high_speed;                      // The device is connected at High Speed
+        uvc_host_frame_t **frames;            // Frame pool of this stream. NULL in zero-copy mode
+        unsigned num_of_frames;               // Number of frame buffers in the pool
+        uvc_frame_slab_pool_t *slab_pool;     // Shared frame pool of the driver the frame buffers are taken from. NULL: Own frame buffers
+        unsigned slab_pool_reserved;          // Shared frame pool only: frames with lower index keep their slab until stream close
+        uvc_host_frame_policy_t frame_policy; // Policy for passing complete frames to the user
+        SemaphoreHandle_t latest_frame_sem;   // Latest frame policy only: given when a new frame is published
+        QueueHandle_t frame_queue;            // Acquire policy only: complete frames waiting for uvc_host_frame_acquire()
+        uvc_host_mjpeg_check_t mjpeg_check;   // Integrity check of complete MJPEG frames
+        unsigned frame_decimation;            // Keep only every n-th frame. 0 or 1: Keep all frames
+        struct {
+            uvc_host_roi_t window;            // Window in pixels, as configured by the user
+            size_t stride;                    // Bytes of one row of the full frame
+            size_t row_offset;                // Offset of the window in a row, in bytes
+            size_t row_len;                   // Bytes of one row of the window. 0: ROI is not used
+        } roi;                                // Region of interest of uncompressed frames. Changed only while the stream is stopped
 
         // Constant USB descriptor values
         uint16_t bcdUVC;                      // Version of UVC specs this device implements
         uint8_t  bInterfaceNumber;            // USB Video Streaming interface claimed by this stream. Needed for ISOC Stream start and CTRL transfers
         uint8_t  bAlternateSetting;           // Alternate setting for selected interface. Needed for ISOC Stream start
         uint8_t  bEndpointAddress;            // Streaming endpoint address. Needed for BULK Stream stop
+        uint16_t wMaxPacketSize;              // MPS of streaming endpoint. Needed for BULK payload tracking
+        uint32_t dwMaxPayloadTransferSize;    // Size of one payload transfer from format negotiation. Needed for BULK payload tracking
+        uint32_t dwClockFrequency;            // Device clock frequency for PTS and SCR. 0 if unknown
+        uvc_desc_index_t *desc_index;         // Index of Video Streaming interface descriptors. Built once at stream open
+        uvc_ctrl_async_t *ctrl_async;         // Queue of asynchronous camera control requests
+        usb_class_stats_entry_t *class_stats; // Entry in usb_class_stats registry, NULL if not counted
+        usb_host_bw_hdl_t bw_hdl;             // Periodic bandwidth reserved while ISOC stream is on. NULL otherwise
+
+        // Format committed to the device. Lets uvc_host_stream_start() skip renegotiation of an unchanged format
+        struct {
+            bool valid;                       // The device holds this commit
+            uvc_host_stream_format_t format;  // Committed format
+            uvc_vs_ctrl_t vs_ctrl;            // Committed Video Stream control
+            int64_t time_us;                  // Time of the last VS_COMMIT request
+        } commit;
+
+        // Still image format committed to the device. Changed only by uvc_host_stream_still_capture()
+        struct {
+            bool committed;                   // The device holds this still commit
+            uint8_t bFormatIndex;             // Committed format
+            uint8_t bFrameIndex;              // Committed image size pattern
+            int64_t video_commit_time_us;     // commit.time_us of the video format at still commit. Video commit can reset the still commit
+            uint16_t h_res;                   // Resolution stored in format of still image frames
+            uint16_t v_res;
+        } still;
 
         // USB host related members
         usb_device_handle_t dev_hdl;          // USB device handle
         unsigned num_of_xfers;                // Number of USB transfers
         usb_transfer_t **xfers;               // Pointer to array of USB transfers. Accessible only by the UVC driver
+        uvc_urb_buf_t *urb_bufs;              // urb_heap_caps only: data buffers of the USB Host Library, restored before xfers are freed
+        QueueHandle_t xfer_queue;             // Completed USB transfers waiting for the processing task. NULL if URBs are processed in USB callback
+        SemaphoreHandle_t task_exit;          // Given by the processing task when it exits
+        int task_core;                        // Core of the processing task, if selected with UVC_HOST_TASK_CORE_AUTO. Otherwise -1
     } constant; // Constant members do no change after installation thus do not require a critical section
 
     struct {
         uvc_host_frame_t *current_frame;      // Frame that is being written to
         bool streaming;                       // Flag whether stream is on/off
-    } dynamic; // Dynamic members require a critical section
+        uint32_t free_frames;                 // Bit mask of free frame buffers in 'frames' pool
+        uvc_host_frame_t *latest_frame;       // Latest frame policy only: newest complete frame not taken by the user yet
+    } dynamic; // Dynamic members are accessed only with atomic operations
+
+    struct {
+        uint32_t frames_delivered;            // Complete frames passed to the user
+        uint64_t bytes_delivered;             // Data bytes of delivered frames
+        uint32_t skipped_missed_eof;          // Frames skipped because End of Frame was not received
+        uint32_t skipped_error;               // Frames skipped because of error bit or USB error
+        uint32_t skipped_overflow;            // Frames skipped because of frame buffer overflow
+        uint32_t skipped_underflow;           // Frames skipped because no frame buffer was free
+        uint32_t skipped_corrupted;           // MJPEG frames skipped because they failed the integrity check
+        uint32_t frames_decimated;            // Frames dropped at Start of Frame by frame decimation
+        uint32_t frames_overwritten;          // Latest frame policy only: delivered frames replaced before the user took them
+        uint32_t usb_error;                   // Packets with USB_TRANSFER_STATUS_ERROR
+        uint32_t usb_overflow;                // Packets with USB_TRANSFER_STATUS_OVERFLOW
+        uint32_t usb_stall;                   // Packets with USB_TRANSFER_STATUS_STALL
+        uint32_t usb_missed;                  // ISOC packets with USB_TRANSFER_STATUS_SKIPPED or USB_TRANSFER_STATUS_TIMED_OUT
+        uint32_t urbs_completed;              // Processed URBs
+        uint64_t urb_bytes;                   // Bytes received in processed URBs
+        uint64_t urb_capacity;                // Requested bytes of processed URBs
+    } stats; // Written by the processing thread with relaxed atomic additions, read by uvc_host_stream_get_stats()
+
+    struct {
+        int64_t timestamp_us;                 // Time of previous uvc_host_stream_get_stats() call
+        uint32_t frames_delivered;            // frames_delivered at previous uvc_host_stream_get_stats() call
+        uint64_t bytes_delivered;             // bytes_delivered at previous uvc_host_stream_get_stats() call
+    } stats_rate; // Protected by uvc_lock
+
+    struct {
+        uint8_t data[UVC_NAL_PARAMETER_SETS_SIZE]; // Annex B parameter sets with 4 byte start codes
+        size_t len;                                // Length of data. 0 if no parameter sets were received
+    } parameter_sets; // H.264 and H.265 only: parameter sets of the last frame that contained them. Protected by uvc_lock
+
+    struct {
+        uvc_host_frame_subscriber_cb_t cb;    // Subscriber callback. NULL: Free slot
+        void *user_ctx;                       // Argument of cb
+    } subscribers[UVC_HOST_FRAME_SUBSCRIBERS_MAX]; // Consumers sharing complete frames. Protected by uvc_lock
 
     struct {
         uvc_stream_bulk_packet_type_t next_bulk_packet; // Bulk only: next expected packet
+        size_t bulk_payload_len;                        // Bulk only: bytes of current payload transfer received so far, including header
+        bool bulk_eof_pending;                          // Bulk only: header of current payload signalled End of Frame
+        bool bulk_resync;                               // Bulk only: payload boundaries were lost, current frame is incomplete
         bool skip_current_frame;                        // Flag to skip current frame. An error has occurred in the stream
         uint8_t current_frame_id;                       // Frame ID can be only 0 or 1. But we also allow setting it to invalid value = 2.
+        uint32_t frame_sequence;                        // Sequence number of the last started frame
+        uvc_host_frame_info_t frame_info;               // Metadata of the frame that is being received
+        size_t slice_offset;                            // Slice mode: bytes of current frame already passed to slice_cb
+        size_t nal_scan_offset;                         // H.264 and H.265 only: bytes of current frame already scanned for start codes
+        size_t nal_pending;                             // H.264 and H.265 only: offset of NAL unit whose end was not found yet. SIZE_MAX if none
+        size_t frame_size_peak;                         // Adaptive frame size only: size of the largest frame received in current format
+        size_t roi_offset;                              // ROI only: bytes of the full frame received so far
+        size_t mjpeg_size_avg;                          // MJPEG check only: running average size of frames with valid structure. 0 if none yet
     } single_thread; // Single thread members are only accessed from 1 thread, so they do not need protection
 };
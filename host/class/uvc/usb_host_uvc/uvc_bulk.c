@@ -13,10 +13,308 @@
 #include "uvc_types_priv.h"
 #include "uvc_check_priv.h"
 #include "uvc_frame_priv.h"
+#include "uvc_nal_priv.h"
+#include "uvc_mjpeg_priv.h"
 #include "uvc_critical_priv.h"
+#include "uvc_trace_priv.h"
 
 static const char *TAG = "uvc-bulk";
 
+#define UVC_BULK_SEGMENTS_MAX (4) // Segments passed to payload_cb in one call. Usually one Bulk transfer carries 1 or 2 payload chunks
+
+/**
+ * @brief Part of Bulk transfer that belongs to one payload transfer
+ */
+typedef struct {
+    const uvc_payload_header_t *header; // Payload header at start of this chunk. NULL if the chunk continues a payload transfer
+    const uint8_t *data;                // Payload data of this chunk, without header
+    size_t data_len;                    // Length of payload data
+    bool start_of_frame;                // The header starts a new frame
+    bool payload_end;                   // This chunk completes the payload transfer
+    bool error;                         // Payload header was expected, but not found. Data of this chunk are lost
+} bulk_chunk_t;
+
+/**
+ * @brief Check whether payload data end with a standalone EoF header
+ *
+ * If the last data packet of a payload transfer has MPS size, no short packet separates it from the following
+ * header-only EoF payload transfer. The device then ends the Bulk transfer by the short EoF header.
+ * We recognize it in the last packet of a short transfer: the packet must be exactly one payload header with
+ * EOH and EoF bits set and Frame ID of the frame in progress.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed short USB transfer
+ * @param[in] data_start Offset of payload data in this transfer
+ * @return Length of the EoF header at the end of the transfer, 0 if there is none
+ */
+static size_t bulk_eof_header_len(const uvc_stream_t *uvc_stream, const usb_transfer_t *transfer, size_t data_start)
+{
+    const size_t actual = transfer->actual_num_bytes;
+    const uint16_t mps = uvc_stream->constant.wMaxPacketSize;
+    const size_t last_packet = mps ? ((actual - 1) / mps) * mps : 0;
+    const size_t last_packet_len = actual - last_packet;
+    if (actual == 0 || last_packet < data_start || last_packet_len < 2) {
+        return 0;
+    }
+
+    const uvc_payload_header_t *header = (const uvc_payload_header_t *)(transfer->data_buffer + last_packet);
+    if (header->bHeaderLength == last_packet_len &&
+            header->bmHeaderInfo.end_of_header &&
+            header->bmHeaderInfo.end_of_frame &&
+            header->bmHeaderInfo.frame_id == uvc_stream->single_thread.current_frame_id) {
+        return last_packet_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Get next payload chunk of Bulk transfer
+ *
+ * Bulk transfer can contain data of several payload transfers and payload transfer can span several Bulk transfers.
+ * Only the first chunk of each payload transfer starts with a header. Payload transfer ends:
+ * - after dwMaxPayloadTransferSize bytes (including its header) from format negotiation, or
+ * - with a short packet, or
+ * - before a standalone EoF header at the end of a short transfer, see bulk_eof_header_len()
+ *
+ * The function updates the state of the Bulk payload tracker of the stream: after a payload transfer ends,
+ * next_bulk_packet is set to UVC_STREAM_BULK_PACKET_EOF. The caller sets it to UVC_STREAM_BULK_PACKET_SOF
+ * if the frame was finished.
+ *
+ * @param[in]    uvc_stream UVC stream
+ * @param[in]    transfer   Completed USB transfer
+ * @param[inout] offset     Offset of not yet processed data in the transfer. Set to 0 before the first call
+ * @param[out]   chunk      Next chunk
+ * @return true if a chunk was returned, false if the whole transfer was processed
+ */
+static bool bulk_next_chunk(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer, size_t *offset, bulk_chunk_t *chunk)
+{
+    const size_t actual = transfer->actual_num_bytes;
+    const bool short_transfer = (transfer->data_buffer_size > actual);
+    const uvc_stream_bulk_packet_type_t state = uvc_stream->single_thread.next_bulk_packet;
+
+    // Zero length packet is processed only if it terminates payload data
+    if (*offset == actual && (actual != 0 || state != UVC_STREAM_BULK_PACKET_DATA)) {
+        return false;
+    }
+
+    size_t pos = *offset;
+    size_t remaining = actual - pos;
+    *chunk = (bulk_chunk_t) {
+        0
+    };
+
+    if (state != UVC_STREAM_BULK_PACKET_DATA) {
+        // Payload header is expected
+        const uvc_payload_header_t *header = (const uvc_payload_header_t *)(transfer->data_buffer + pos);
+        uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_DATA;
+        if (remaining < 2 || header->bHeaderLength < 2 || header->bHeaderLength > remaining) {
+            // We lost track of payload boundaries. Drop the rest of this transfer and wait for short packet
+            ESP_LOGD(TAG, "Invalid payload header");
+            chunk->error = true;
+            chunk->payload_end = short_transfer;
+            uvc_stream->single_thread.bulk_resync = true;
+            uvc_stream->single_thread.bulk_payload_len = 0;
+            if (short_transfer) {
+                uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_EOF;
+            }
+            *offset = actual;
+            return true;
+        }
+
+        chunk->header = header;
+        chunk->start_of_frame = (state == UVC_STREAM_BULK_PACKET_SOF) ||
+                                (header->bmHeaderInfo.frame_id != uvc_stream->single_thread.current_frame_id);
+        pos += header->bHeaderLength;
+        remaining -= header->bHeaderLength;
+        uvc_stream->single_thread.bulk_payload_len = header->bHeaderLength;
+    }
+
+    // Find end of this payload transfer
+    const size_t payload_len = uvc_stream->single_thread.bulk_payload_len;
+    const uint32_t max_payload = uvc_stream->constant.dwMaxPayloadTransferSize;
+    size_t data_len = remaining;
+    if (max_payload && payload_len + remaining >= max_payload) {
+        data_len = (max_payload > payload_len) ? (max_payload - payload_len) : 0;
+        chunk->payload_end = true;
+    } else if (short_transfer) {
+        data_len -= bulk_eof_header_len(uvc_stream, transfer, pos);
+        chunk->payload_end = true;
+    }
+
+    chunk->data = transfer->data_buffer + pos;
+    chunk->data_len = data_len;
+    *offset = pos + data_len;
+    if (chunk->payload_end) {
+        uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_EOF;
+        uvc_stream->single_thread.bulk_payload_len = 0;
+    } else {
+        uvc_stream->single_thread.bulk_payload_len += data_len;
+    }
+    return true;
+}
+
+/**
+ * @brief Update stream statistics with completed Bulk transfer
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed USB transfer
+ */
+static void bulk_transfer_stats(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer)
+{
+    switch (transfer->status) {
+    case USB_TRANSFER_STATUS_COMPLETED:
+        UVC_ATOMIC_ADD(uvc_stream->stats.urbs_completed, 1);
+        UVC_ATOMIC_ADD(uvc_stream->stats.urb_bytes, transfer->actual_num_bytes);
+        UVC_ATOMIC_ADD(uvc_stream->stats.urb_capacity, transfer->num_bytes);
+        USB_CLASS_STATS_XFER(uvc_stream->constant.class_stats, transfer->actual_num_bytes, true);
+        return;
+    case USB_TRANSFER_STATUS_ERROR:    UVC_ATOMIC_ADD(uvc_stream->stats.usb_error, 1); break;
+    case USB_TRANSFER_STATUS_OVERFLOW: UVC_ATOMIC_ADD(uvc_stream->stats.usb_overflow, 1); break;
+    case USB_TRANSFER_STATUS_STALL:    UVC_ATOMIC_ADD(uvc_stream->stats.usb_stall, 1); break;
+    default: return;
+    }
+    USB_CLASS_STATS_XFER(uvc_stream->constant.class_stats, 0, false);
+}
+
+/**
+ * @brief Pass payload of Bulk transfer to the user without frame assembly
+ *
+ * Follows the same payload tracking as bulk_transfer_process(), but describes every payload chunk by one segment
+ * instead of copying it into a frame buffer.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed USB transfer
+ */
+static void bulk_transfer_payload(uvc_stream_t *uvc_stream, usb_transfer_t *transfer)
+{
+    uvc_host_payload_segment_t segments[UVC_BULK_SEGMENTS_MAX];
+    size_t num_segments = 0;
+    size_t offset = 0;
+    bulk_chunk_t chunk;
+
+    while (bulk_next_chunk(uvc_stream, transfer, &offset, &chunk)) {
+        if (chunk.header) {
+            uvc_stream->single_thread.current_frame_id = chunk.header->bmHeaderInfo.frame_id;
+            uvc_stream->single_thread.bulk_eof_pending = chunk.header->bmHeaderInfo.end_of_frame;
+        }
+        const bool end_of_frame = chunk.payload_end && uvc_stream->single_thread.bulk_eof_pending;
+        if (end_of_frame) {
+            uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
+            uvc_stream->single_thread.bulk_eof_pending = false;
+            uvc_stream->single_thread.bulk_resync = false;
+        }
+
+        uvc_host_payload_segment_t *segment = &segments[num_segments];
+        *segment = (uvc_host_payload_segment_t) {
+            .data = chunk.data,
+            .data_len = chunk.data_len,
+            .start_of_frame = chunk.start_of_frame,
+            .end_of_frame = end_of_frame,
+            .error = chunk.error || (chunk.header && chunk.header->bmHeaderInfo.error),
+        };
+        if (segment->data_len || segment->start_of_frame || segment->end_of_frame || segment->error) {
+            num_segments++;
+        }
+        if (num_segments == UVC_BULK_SEGMENTS_MAX) {
+            UVC_TRACE(CB_ENTER, transfer);
+            UVC_CLASS_STATS_CB_ENTER(uvc_stream);
+            uvc_stream->constant.payload_cb(segments, num_segments, uvc_stream->constant.cb_arg);
+            UVC_CLASS_STATS_CB_EXIT(uvc_stream);
+            UVC_TRACE(CB_EXIT, transfer);
+            num_segments = 0;
+        }
+    }
+
+    if (num_segments) {
+        UVC_TRACE(CB_ENTER, transfer);
+        UVC_CLASS_STATS_CB_ENTER(uvc_stream);
+        uvc_stream->constant.payload_cb(segments, num_segments, uvc_stream->constant.cb_arg);
+        UVC_CLASS_STATS_CB_EXIT(uvc_stream);
+        UVC_TRACE(CB_EXIT, transfer);
+    }
+}
+
+/**
+ * @brief Start assembly of a new frame
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] header     Payload header that starts the frame
+ */
+static void bulk_frame_start(uvc_stream_t *uvc_stream, const uvc_payload_header_t *header)
+{
+    // We detected start of new frame. Update Frame ID and start fetching this frame
+    uvc_stream->single_thread.current_frame_id   = header->bmHeaderInfo.frame_id;
+    uvc_stream->single_thread.skip_current_frame = false;
+    uvc_frame_info_start(uvc_stream);
+    const bool decimated = uvc_frame_decimate(uvc_stream, header);
+
+    // Get free frame buffer for this new frame
+    uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+    if (current_frame) {
+        // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer.
+        // A decimated frame keeps it empty and returns it on End of Frame
+        uvc_frame_reset(current_frame);
+        uvc_frame_slice_drop(uvc_stream);
+        UVC_ATOMIC_ADD(uvc_stream->stats.skipped_missed_eof, 1);
+        USB_CLASS_STATS_DROP(uvc_stream->constant.class_stats, 1);
+    } else if (!decimated) {
+        current_frame = uvc_frame_get_empty(uvc_stream);
+        if (current_frame == NULL) {
+            // There is no free frame buffer now, skipping this frame
+            uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_UNDERFLOW);
+
+            // Inform the user about the underflow
+            uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
+            if (stream_cb) {
+                const uvc_host_stream_event_data_t event = {
+                    .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
+                };
+                stream_cb(&event, uvc_stream->constant.cb_arg);
+            }
+        } else {
+            uvc_frame_set_current(uvc_stream, current_frame);
+        }
+    }
+    if (uvc_stream->single_thread.bulk_resync) {
+        uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_ERROR); // Start of this frame might have been lost
+    }
+}
+
+/**
+ * @brief Finish assembly of current frame and pass it to the user
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void bulk_frame_end(uvc_stream_t *uvc_stream)
+{
+    // Get the current frame being processed and clear it from the stream,
+    // so no more data is written to this frame after the end of frame
+    uvc_host_frame_t *this_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+
+    // Determine if we should pass the frame to the user:
+    // Only if streaming is active, we have a valid frame and it passed the MJPEG integrity check, if enabled.
+    const bool frame_complete = (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && this_frame && !uvc_stream->single_thread.skip_current_frame
+                                 && uvc_mjpeg_check(uvc_stream, this_frame));
+
+    bool return_frame = true; // Default to returning the frame in case streaming has been stopped
+    if (frame_complete) {
+        memcpy((uvc_host_stream_format_t *)&this_frame->vs_format, &uvc_stream->constant.vs_format, sizeof(uvc_host_stream_format_t));
+        uvc_frame_info_finish(uvc_stream, this_frame);
+        uvc_frame_slice_deliver(uvc_stream, this_frame, true);
+        uvc_frame_delivered(uvc_stream, this_frame);
+
+        // Pass the frame to the user. If false is returned,
+        // we do not return the frame to the empty queue (i.e., the user wants to keep it for processing)
+        return_frame = uvc_frame_pass_to_user(uvc_stream, this_frame);
+    } else {
+        uvc_frame_slice_drop(uvc_stream);
+    }
+    if (return_frame) {
+        // If the user has processed the frame (or the stream is stopped), return it to the empty frame queue
+        uvc_host_frame_return(uvc_stream, this_frame);
+    }
+}
+
 /**
  * @brief Callback function for handling Bulk USB transfers from a UVC camera.
  *
@@ -25,24 +323,29 @@ static const char *TAG = "uvc-bulk";
  *
  * - **CRC Included**: Ensures no errors in frame data.
  * - **ACK Mechanism**: Missed packets are retransmitted, ensuring reliable data delivery.
- * - **Packet Headers**: Not all packets contain headers; the end of a transfer is indicated by a short packet
- *   (less than the maximum packet size), and the next packet usually contains a header.
+ * - **Packet Headers**: Only the first packet of each payload transfer contains a header. Payload transfer ends after
+ *   dwMaxPayloadTransferSize bytes or with a short packet (less than the maximum packet size).
  *
- * To process these packets, a state machine is implemented to track the next expected Bulk packet type:
- * - Start of Frame (SoF), usually followed by data packets in the same transfer
+ * To process these packets, a payload tracker splits every transfer into payload chunks, see bulk_next_chunk().
+ * The tracker's state machine follows the next expected Bulk packet type:
+ * - Header of a new frame (SoF)
  * - Data packets (no header)
- * - End of Frame (EoF)
+ * - Header of next payload transfer of the frame in progress. It can signal End of Frame (EoF)
  *
+ * A frame is finished at the end of the payload transfer whose header has EoF bit set.
  * The function handles USB transfer statuses, manages frame buffers, and invokes user-defined callbacks for
  * completed frames.
  *
  * @param[in] transfer Pointer to the completed USB transfer structure.
+ * @return true if the transfer shall be resubmitted
  */
-void bulk_transfer_callback(usb_transfer_t *transfer)
+bool bulk_transfer_process(usb_transfer_t *transfer)
 {
     ESP_LOGD(TAG, "%s", __FUNCTION__);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
 
+    bulk_transfer_stats(uvc_stream, transfer);
+
     // Check USB transfer status
     switch (transfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED:
@@ -63,113 +366,42 @@ void bulk_transfer_callback(usb_transfer_t *transfer)
     }
 
     if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
-        return; // If the streaming was turned off, we don't have to do anything
+        return false; // If the streaming was turned off, we don't have to do anything
     }
 
-    // In BULK implementation, 'payload' is a constant pointer to constant data,
-    // meaning both the pointer and the data it points to cannot be changed.
-    // This contrasts with the ISOC implementation, where 'payload' is a variable
-    // pointer and is increased after every ISOC packet processing
-    const uint8_t *const payload = transfer->data_buffer;
-    const uint8_t *payload_data  = payload;
-    size_t payload_data_len      = transfer->actual_num_bytes;
+    if (uvc_stream->constant.payload_cb) {
+        bulk_transfer_payload(uvc_stream, transfer);
+        return UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+    }
 
     // Note for developers:
-    // The order of SoF, Data, and EoF handling is intentional and represents a workaround for detecting EoF in the Bulk stream.
-    // Normally, a complete Sample transfer includes two short packets: one marking the last data packet and another with the EoF header.
-    // However, if the last data packet has a size equal to the Maximum Packet Size (MPS), there is no zero-length packet between the data and the EoF header.
-    // Consequently, it becomes impossible to distinguish between the last data packet and the EoF header.
-    // To address this, the hack discards all frames whose last data packet has the MPS size.
-    switch (uvc_stream->single_thread.next_bulk_packet) {
-    case UVC_STREAM_BULK_PACKET_EOF: {
-        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
-        uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
-
-        if (payload_header->bmHeaderInfo.end_of_frame) {
-            assert(payload_header->bmHeaderInfo.frame_id == uvc_stream->single_thread.current_frame_id);
-            if (payload_header->bmHeaderInfo.error) {
-                uvc_stream->single_thread.skip_current_frame = true;
-            }
-
-            // Get the current frame being processed and clear it from the stream,
-            // so no more data is written to this frame after the end of frame
-            UVC_ENTER_CRITICAL(); // Enter critical section to safely check and modify the stream state.
-            uvc_host_frame_t *this_frame = uvc_stream->dynamic.current_frame;
-            uvc_stream->dynamic.current_frame = NULL;
-
-            // Determine if we should invoke the frame callback:
-            // Only invoke the callback if streaming is active, a frame callback exists,
-            // and we have a valid frame to pass to the user.
-            const bool invoke_fb_callback = (uvc_stream->dynamic.streaming && uvc_stream->constant.frame_cb && this_frame && !uvc_stream->single_thread.skip_current_frame);
-            UVC_EXIT_CRITICAL();
-
-            bool return_frame = true; // Default to returning the frame in case streaming has been stopped
-            if (invoke_fb_callback) {
-                memcpy((uvc_host_stream_format_t *)&this_frame->vs_format, &uvc_stream->constant.vs_format, sizeof(uvc_host_stream_format_t));
-
-                // Call the user's frame callback. If the callback returns false,
-                // we do not return the frame to the empty queue (i.e., the user wants to keep it for processing)
-                return_frame = uvc_stream->constant.frame_cb(this_frame, uvc_stream->constant.cb_arg);
-            }
-            if (return_frame) {
-                // If the user has processed the frame (or the stream is stopped), return it to the empty frame queue
-                uvc_host_frame_return(uvc_stream, this_frame);
-            }
-            break;
+    // Frame ends with the payload transfer whose header has EoF bit set. Many devices send a header-only EoF payload transfer
+    // after the last data. If the last data packet has Maximum Packet Size (MPS), there is no short packet between the data
+    // and the EoF header. bulk_next_chunk() ends the payload transfer by dwMaxPayloadTransferSize or recognizes
+    // the EoF header at the end of the short transfer, so these frames are not discarded.
+    size_t offset = 0;
+    bulk_chunk_t chunk;
+    while (bulk_next_chunk(uvc_stream, transfer, &offset, &chunk)) {
+        if (chunk.start_of_frame) {
+            bulk_frame_start(uvc_stream, chunk.header);
         }
-
-        __attribute__((fallthrough));  // Fall through! This is not EoF but SoF!
-    }
-    case UVC_STREAM_BULK_PACKET_SOF: {
-        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
-        assert(!payload_header->bmHeaderInfo.end_of_frame);
-
-        // We detected start of new frame. Update Frame ID and start fetching this frame
-        uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
-        uvc_stream->single_thread.skip_current_frame = payload_header->bmHeaderInfo.error; // Check for error flag
-
-        // Get free frame buffer for this new frame
-        UVC_ENTER_CRITICAL();
-        const bool need_new_frame = (uvc_stream->dynamic.streaming && !uvc_stream->dynamic.current_frame);
-        if (need_new_frame) {
-            UVC_EXIT_CRITICAL();
-            uvc_stream->dynamic.current_frame = uvc_frame_get_empty(uvc_stream);
-            if (uvc_stream->dynamic.current_frame == NULL) {
-                // There is no free frame buffer now, skipping this frame
-                uvc_stream->single_thread.skip_current_frame = true;
-
-                // Inform the user about the underflow
-                uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
-                if (stream_cb) {
-                    const uvc_host_stream_event_data_t event = {
-                        .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
-                    };
-                    stream_cb(&event, uvc_stream->constant.cb_arg);
-                }
-            }
-        } else {
-            // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer
-            uvc_frame_reset(uvc_stream->dynamic.current_frame);
-            UVC_EXIT_CRITICAL();
+        if (chunk.header) {
+            uvc_frame_info_parse_header(uvc_stream, chunk.header);
+            uvc_stream->single_thread.bulk_eof_pending = chunk.header->bmHeaderInfo.end_of_frame;
         }
 
-        payload_data     += payload_header->bHeaderLength; // Pointer arithmetic!
-        payload_data_len -= payload_header->bHeaderLength;
-        uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_DATA;
-        __attribute__((fallthrough));  // Fall through! There can be data after SoF!
-    }
-    case UVC_STREAM_BULK_PACKET_DATA: {
-        // We got short packet in data section, next packet is EoF
-        if (transfer->data_buffer_size > transfer->actual_num_bytes) {
-            uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_EOF;
+        // Check for error flag
+        if (chunk.error || (chunk.header && chunk.header->bmHeaderInfo.error)) {
+            uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_ERROR);
         }
+
         // Add received data to frame buffer
-        if (!uvc_stream->single_thread.skip_current_frame) {
+        if (chunk.data_len && !uvc_stream->single_thread.skip_current_frame) {
             uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
-            esp_err_t ret = uvc_frame_add_data(current_frame, payload_data, payload_data_len);
+            esp_err_t ret = uvc_frame_add_data(uvc_stream, current_frame, chunk.data, chunk.data_len);
             if (ret != ESP_OK) {
                 // Frame buffer overflow
-                uvc_stream->single_thread.skip_current_frame = true;
+                uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_OVERFLOW);
 
                 // Inform the user about the overflow
                 uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
@@ -179,14 +411,29 @@ void bulk_transfer_callback(usb_transfer_t *transfer)
                     };
                     stream_cb(&event, uvc_stream->constant.cb_arg);
                 }
+            } else {
+                uvc_nal_scan(uvc_stream, current_frame);
+                uvc_frame_slice_deliver(uvc_stream, current_frame, false);
             }
         }
-        break;
-    }
-    default: abort();
+
+        // End of Frame. Pass the frame to user
+        if (chunk.payload_end && uvc_stream->single_thread.bulk_eof_pending) {
+            uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
+            uvc_stream->single_thread.bulk_eof_pending = false;
+            uvc_stream->single_thread.bulk_resync = false;
+            bulk_frame_end(uvc_stream);
+        }
     }
 
-    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+    return UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+}
+
+void bulk_transfer_callback(usb_transfer_t *transfer)
+{
+    UVC_TRACE(COMPLETE, transfer);
+    if (bulk_transfer_process(transfer)) {
+        UVC_TRACE(RESUBMIT, transfer);
         usb_host_transfer_submit(transfer); // Restart the transfer
     }
 }
@@ -5,19 +5,56 @@
  */
 // This file will contain all Class-Specific request from USB UVC specification chapter 4
 
+#include <inttypes.h>
+#include <stdlib.h> // For calloc
 #include <string.h> // For memset
 
 #include "esp_check.h"
+#include "esp_timer.h"
 
 #include "uvc_control.h"
+#include "usb/usb_host_urb_pool.h"
 #include "usb/usb_types_ch9.h"
 #include "usb/usb_types_uvc.h"
 #include "uvc_types_priv.h"
 #include "uvc_descriptors_priv.h"
 #include "uvc_check_priv.h"
+#include "uvc_control_priv.h"
+#include "uvc_critical_priv.h"
 
 static const char *TAG = "uvc-control";
 
+// Asynchronous camera controls
+#define UVC_CTRL_ASYNC_QUEUE_LEN    (8)  // Requests waiting to be sent
+#define UVC_CTRL_ASYNC_SELECTORS    (32) // Control selectors of Camera Terminal and Processing Unit are below 0x20
+#define UVC_CTRL_ASYNC_TRANSFER_LEN (64) // Worst case HS MPS
+
+typedef struct {
+    uvc_host_control_t control;
+    uvc_host_control_callback_t cb;
+    void *user_ctx;
+} uvc_ctrl_async_req_t;
+
+struct uvc_ctrl_async_s {
+    uvc_stream_t *uvc_stream;                 // Stream passed to completion callbacks
+    usb_host_client_handle_t client_hdl;      // USB Host client that submits the CTRL transfer
+    usb_transfer_t *transfer;                 // CTRL transfer of the request in flight
+    uvc_desc_control_units_t units;           // Camera Terminal and Processing Unit
+
+    // Members below are protected by uvc_lock
+    uvc_ctrl_async_req_t queue[UVC_CTRL_ASYNC_QUEUE_LEN]; // Ring buffer of requests waiting to be sent
+    unsigned head;                            // Index of the oldest request in queue
+    unsigned count;                           // Number of requests in queue
+    uvc_ctrl_async_req_t current;             // Request in flight
+    bool in_flight;                           // A request is being sent. Only one request is sent at a time
+    bool cancelled;                           // The stream is being closed, no new requests are accepted
+    bool orphaned;                            // Deleted with a request in flight, freed when the request completes
+    struct {
+        uint8_t len;                          // 0: Not cached
+        uint8_t data[UVC_HOST_CONTROL_DATA_MAX];
+    } cache[2][UVC_CTRL_ASYNC_SELECTORS];     // Current values of controls, per uvc_host_control_unit_t and selector
+};
+
 static uint16_t uvc_vs_control_size(uint16_t uvc_version)
 {
     if (uvc_version < UVC_VERSION_1_1) {
@@ -34,8 +71,8 @@ static esp_err_t uvc_host_stream_control(uvc_host_stream_hdl_t stream_hdl, uvc_v
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
     uint8_t bmRequestType, bRequest;
     uint16_t wValue, wIndex, wLength;
-    const usb_config_desc_t *cfg_desc;
-    ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(uvc_stream->constant.dev_hdl, &cfg_desc));
+    const uvc_desc_index_t *desc_index = uvc_stream->constant.desc_index;
+    UVC_CHECK(desc_index, ESP_ERR_INVALID_STATE);
     esp_err_t ret = ESP_OK;
     const bool set = (req_code == UVC_SET_CUR) ? true : false;
 
@@ -53,7 +90,7 @@ static esp_err_t uvc_host_stream_control(uvc_host_stream_hdl_t stream_hdl, uvc_v
         const uvc_frame_desc_t *frame_desc;
 
         ESP_RETURN_ON_ERROR(
-            uvc_desc_get_frame_format_by_format(cfg_desc, uvc_stream->constant.bInterfaceNumber, vs_format, &format_desc, &frame_desc),
+            uvc_desc_index_get_frame_format_by_format(desc_index, vs_format, &format_desc, &frame_desc),
             TAG, "Could not find format that matches required format");
         UVC_CHECK(format_desc && frame_desc, ESP_ERR_NOT_FOUND);
 
@@ -72,7 +109,7 @@ static esp_err_t uvc_host_stream_control(uvc_host_stream_hdl_t stream_hdl, uvc_v
         const uvc_format_desc_t *format_desc = NULL;
         const uvc_frame_desc_t *frame_desc = NULL;
         ESP_RETURN_ON_ERROR(
-            uvc_desc_get_frame_format_by_index(cfg_desc, uvc_stream->constant.bInterfaceNumber, vs_control->bFormatIndex, vs_control->bFrameIndex, &format_desc, &frame_desc),
+            uvc_desc_index_get_frame_format_by_index(desc_index, vs_control->bFormatIndex, vs_control->bFrameIndex, &format_desc, &frame_desc),
             TAG, "Could not find requested frame format");
 
         vs_format->format = uvc_desc_parse_format(format_desc);
@@ -152,6 +189,14 @@ esp_err_t uvc_host_stream_control_negotiate(uvc_host_stream_hdl_t stream_hdl, co
 
     // Commit the negotiated format
     ret = uvc_host_stream_control_commit(stream_hdl, &vs_result, vs_format);
+    stream_hdl->constant.commit.time_us = esp_timer_get_time();
+    stream_hdl->constant.commit.valid = (ret == ESP_OK);
+    if (ret == ESP_OK) {
+        // Bulk streams need the committed payload transfer size to find boundaries of payloads
+        stream_hdl->constant.dwMaxPayloadTransferSize = vs_result.dwMaxPayloadTransferSize;
+        memcpy(&stream_hdl->constant.commit.format, vs_format, sizeof(uvc_host_stream_format_t));
+        memcpy(&stream_hdl->constant.commit.vs_ctrl, &vs_result, sizeof(uvc_vs_ctrl_t));
+    }
 
     // Pass the result to user
     if (vs_result_ret) {
@@ -160,3 +205,366 @@ esp_err_t uvc_host_stream_control_negotiate(uvc_host_stream_hdl_t stream_hdl, co
 
     return ret;
 }
+
+bool uvc_host_stream_control_is_committed(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format)
+{
+    return stream_hdl->constant.commit.valid && uvc_is_vs_format_equal(&stream_hdl->constant.commit.format, vs_format);
+}
+
+esp_err_t uvc_host_stream_control_recommit(uvc_host_stream_hdl_t stream_hdl)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(stream_hdl->constant.commit.valid, ESP_ERR_INVALID_STATE);
+
+    // Work on a copy, the control request overwrites format and frame indexes from the format
+    uvc_vs_ctrl_t vs_ctrl;
+    memcpy(&vs_ctrl, &stream_hdl->constant.commit.vs_ctrl, sizeof(uvc_vs_ctrl_t));
+    const esp_err_t ret = uvc_host_stream_control_commit(stream_hdl, &vs_ctrl, &stream_hdl->constant.commit.format);
+    stream_hdl->constant.commit.time_us = esp_timer_get_time();
+    stream_hdl->constant.commit.valid = (ret == ESP_OK);
+    return ret;
+}
+
+esp_err_t uvc_host_stream_control_commit_known(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format, const uvc_vs_ctrl_t *vs_ctrl)
+{
+    UVC_CHECK(stream_hdl && vs_format && vs_ctrl, ESP_ERR_INVALID_ARG);
+
+    // Work on a copy, the control request overwrites format and frame indexes from the format
+    uvc_vs_ctrl_t vs_result;
+    memcpy(&vs_result, vs_ctrl, sizeof(uvc_vs_ctrl_t));
+    const esp_err_t ret = uvc_host_stream_control_commit(stream_hdl, &vs_result, vs_format);
+    stream_hdl->constant.commit.time_us = esp_timer_get_time();
+    stream_hdl->constant.commit.valid = (ret == ESP_OK);
+    if (ret == ESP_OK) {
+        stream_hdl->constant.dwMaxPayloadTransferSize = vs_result.dwMaxPayloadTransferSize;
+        memcpy(&stream_hdl->constant.commit.format, vs_format, sizeof(uvc_host_stream_format_t));
+        memcpy(&stream_hdl->constant.commit.vs_ctrl, &vs_result, sizeof(uvc_vs_ctrl_t));
+    }
+    return ret;
+}
+
+void uvc_host_stream_control_invalidate(uvc_host_stream_hdl_t stream_hdl)
+{
+    stream_hdl->constant.commit.valid = false;
+    stream_hdl->constant.still.committed = false;
+}
+
+static esp_err_t uvc_host_stream_control_still(uvc_host_stream_hdl_t stream_hdl, uvc_still_ctrl_t *still_ctrl, enum uvc_req_code req_code, bool commit)
+{
+    const bool set = (req_code == UVC_SET_CUR);
+    uint8_t bmRequestType = USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    bmRequestType |= set ? USB_BM_REQUEST_TYPE_DIR_OUT : USB_BM_REQUEST_TYPE_DIR_IN;
+    const uint16_t wValue = (commit ? UVC_VS_STILL_COMMIT_CONTROL : UVC_VS_STILL_PROBE_CONTROL) << 8;
+    return uvc_host_usb_ctrl(stream_hdl, bmRequestType, (uint8_t)req_code, wValue, stream_hdl->constant.bInterfaceNumber,
+                             sizeof(uvc_still_ctrl_t), (uint8_t *)still_ctrl);
+}
+
+esp_err_t uvc_host_stream_control_still_negotiate(uvc_host_stream_hdl_t stream_hdl, uvc_still_ctrl_t *still_ctrl)
+{
+    UVC_CHECK(stream_hdl && still_ctrl, ESP_ERR_INVALID_ARG);
+
+    // The device fills dwMaxVideoFrameSize and dwMaxPayloadTransferSize
+    // @see USB UVC specification ver 1.5, section 4.3.1.2
+    uvc_still_ctrl_t still_result = {
+        .bFormatIndex = still_ctrl->bFormatIndex,
+        .bFrameIndex = still_ctrl->bFrameIndex,
+        .bCompressionIndex = still_ctrl->bCompressionIndex,
+    };
+    ESP_RETURN_ON_ERROR(uvc_host_stream_control_still(stream_hdl, &still_result, UVC_SET_CUR, false), TAG, "Still probe set failed");
+    ESP_RETURN_ON_ERROR(uvc_host_stream_control_still(stream_hdl, &still_result, UVC_GET_CUR, false), TAG, "Still probe get failed");
+    UVC_CHECK(still_result.bFormatIndex == still_ctrl->bFormatIndex && still_result.bFrameIndex == still_ctrl->bFrameIndex, ESP_ERR_NOT_SUPPORTED);
+    ESP_RETURN_ON_ERROR(uvc_host_stream_control_still(stream_hdl, &still_result, UVC_SET_CUR, true), TAG, "Still commit failed");
+
+    ESP_LOGD(TAG, "Still image format %d, frame %d committed, max size %"PRIu32,
+             still_result.bFormatIndex, still_result.bFrameIndex, still_result.dwMaxVideoFrameSize);
+    memcpy(still_ctrl, &still_result, sizeof(uvc_still_ctrl_t));
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_stream_control_still_trigger(uvc_host_stream_hdl_t stream_hdl)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    uint8_t trigger = 1; // Transmit still image
+    // @see USB UVC specification ver 1.5, table 4-80
+    return uvc_host_usb_ctrl(stream_hdl, USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE,
+                             UVC_SET_CUR, UVC_VS_STILL_IMAGE_TRIGGER_CONTROL << 8, stream_hdl->constant.bInterfaceNumber, 1, &trigger);
+}
+
+static inline uint8_t uvc_ctrl_async_unit_subtype(uvc_host_control_unit_t unit)
+{
+    return (unit == UVC_HOST_CONTROL_UNIT_CAMERA) ? UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL : UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT;
+}
+
+static inline bool uvc_ctrl_async_same_control(const uvc_host_control_t *a, const uvc_host_control_t *b)
+{
+    return a->unit == b->unit && a->selector == b->selector;
+}
+
+/**
+ * @brief Find queued SET_CUR request that a new SET_CUR of the same control can replace
+ *
+ * Only the newest queued request of the control is considered. If it is not SET_CUR, e.g. GET_CUR that must read
+ * the previous value, the new request is queued behind it.
+ *
+ * @note Must be called with uvc_lock held
+ * @return Pointer to the queued request or NULL
+ */
+static uvc_ctrl_async_req_t *uvc_ctrl_async_find_replaceable(uvc_ctrl_async_t *ctrl, const uvc_host_control_t *control)
+{
+    for (int i = (int)ctrl->count - 1; i >= 0; i--) {
+        uvc_ctrl_async_req_t *req = &ctrl->queue[(ctrl->head + i) % UVC_CTRL_ASYNC_QUEUE_LEN];
+        if (uvc_ctrl_async_same_control(&req->control, control)) {
+            return (req->control.request == UVC_SET_CUR) ? req : NULL;
+        }
+    }
+    return NULL;
+}
+
+static void uvc_ctrl_async_free(uvc_ctrl_async_t *ctrl)
+{
+    if (ctrl->transfer) {
+        usb_host_urb_pool_transfer_free(ctrl->transfer);
+    }
+    free(ctrl);
+}
+
+/**
+ * @brief Send queued requests until one is in flight or the queue is empty
+ *
+ * @note The caller owns the in_flight flag, it is cleared here when there is nothing to send
+ */
+static void uvc_ctrl_async_send_next(uvc_ctrl_async_t *ctrl)
+{
+    while (true) {
+        UVC_ENTER_CRITICAL();
+        if (ctrl->cancelled || ctrl->count == 0) {
+            const bool orphaned = ctrl->orphaned;
+            ctrl->in_flight = false;
+            UVC_EXIT_CRITICAL();
+            if (orphaned) {
+                uvc_ctrl_async_free(ctrl); // The stream was closed while this function was running
+            }
+            return;
+        }
+        memcpy(&ctrl->current, &ctrl->queue[ctrl->head], sizeof(uvc_ctrl_async_req_t));
+        ctrl->head = (ctrl->head + 1) % UVC_CTRL_ASYNC_QUEUE_LEN;
+        ctrl->count--;
+        UVC_EXIT_CRITICAL();
+
+        // Fill the CTRL request, see USB UVC specification ver 1.5, chapter 4.2
+        const uvc_host_control_t *control = &ctrl->current.control;
+        const bool set = (control->request == UVC_SET_CUR);
+        const uint8_t unit_id = (control->unit == UVC_HOST_CONTROL_UNIT_CAMERA) ? ctrl->units.camera_terminal_id : ctrl->units.processing_unit_id;
+        usb_setup_packet_t *req = (usb_setup_packet_t *)ctrl->transfer->data_buffer;
+        req->bmRequestType = USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE |
+                             (set ? USB_BM_REQUEST_TYPE_DIR_OUT : USB_BM_REQUEST_TYPE_DIR_IN);
+        req->bRequest = control->request;
+        req->wValue = control->selector << 8;
+        req->wIndex = (unit_id << 8) | ctrl->units.bInterfaceNumber;
+        req->wLength = control->len;
+        if (set) {
+            memcpy(ctrl->transfer->data_buffer + sizeof(usb_setup_packet_t), control->data, control->len);
+        }
+        ctrl->transfer->device_handle = ctrl->uvc_stream->constant.dev_hdl;
+        ctrl->transfer->num_bytes = sizeof(usb_setup_packet_t) + control->len;
+
+        const esp_err_t ret = usb_host_transfer_submit_control(ctrl->client_hdl, ctrl->transfer);
+        if (ret == ESP_OK) {
+            return; // Next request is sent from the completion callback
+        }
+        ESP_LOGW(TAG, "Could not submit control request: %s", esp_err_to_name(ret));
+        if (ctrl->current.cb) {
+            ctrl->current.cb(ctrl->uvc_stream, ret, control, ctrl->current.user_ctx);
+        }
+    }
+}
+
+static void uvc_ctrl_async_transfer_cb(usb_transfer_t *transfer)
+{
+    uvc_ctrl_async_t *ctrl = (uvc_ctrl_async_t *)transfer->context;
+    UVC_ENTER_CRITICAL();
+    const bool orphaned = ctrl->orphaned;
+    UVC_EXIT_CRITICAL();
+    if (orphaned) {
+        uvc_ctrl_async_free(ctrl); // The stream is closed, nobody waits for the result
+        return;
+    }
+
+    uvc_host_control_t *control = &ctrl->current.control;
+    esp_err_t result = ESP_OK;
+    if (transfer->status != USB_TRANSFER_STATUS_COMPLETED || transfer->actual_num_bytes != transfer->num_bytes) {
+        result = ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (result == ESP_OK) {
+        if (control->request != UVC_SET_CUR) {
+            memcpy(control->data, transfer->data_buffer + sizeof(usb_setup_packet_t), control->len);
+        }
+        if (control->request == UVC_SET_CUR || control->request == UVC_GET_CUR) {
+            UVC_ENTER_CRITICAL();
+            ctrl->cache[control->unit][control->selector].len = control->len;
+            memcpy(ctrl->cache[control->unit][control->selector].data, control->data, control->len);
+            UVC_EXIT_CRITICAL();
+        }
+    }
+
+    if (ctrl->current.cb) {
+        ctrl->current.cb(ctrl->uvc_stream, result, control, ctrl->current.user_ctx);
+    }
+    uvc_ctrl_async_send_next(ctrl);
+}
+
+esp_err_t uvc_ctrl_async_create(uvc_stream_t *uvc_stream, usb_host_client_handle_t client_hdl, const uvc_desc_control_units_t *units, uvc_ctrl_async_t **ctrl_ret)
+{
+    esp_err_t ret;
+    uvc_ctrl_async_t *ctrl = calloc(1, sizeof(uvc_ctrl_async_t));
+    UVC_CHECK(ctrl, ESP_ERR_NO_MEM);
+
+    ESP_GOTO_ON_ERROR(usb_host_urb_pool_transfer_alloc(UVC_CTRL_ASYNC_TRANSFER_LEN, 0, &ctrl->transfer), err, TAG,);
+    ctrl->transfer->bEndpointAddress = 0;
+    ctrl->transfer->timeout_ms = 5000;
+    ctrl->transfer->callback = uvc_ctrl_async_transfer_cb;
+    ctrl->transfer->context = ctrl;
+    ctrl->uvc_stream = uvc_stream;
+    ctrl->client_hdl = client_hdl;
+    memcpy(&ctrl->units, units, sizeof(uvc_desc_control_units_t));
+    *ctrl_ret = ctrl;
+    return ESP_OK;
+
+err:
+    uvc_ctrl_async_free(ctrl);
+    return ret;
+}
+
+void uvc_ctrl_async_delete(uvc_ctrl_async_t *ctrl)
+{
+    if (!ctrl) {
+        return;
+    }
+
+    uvc_ctrl_async_req_t dropped[UVC_CTRL_ASYNC_QUEUE_LEN];
+    uvc_stream_t *uvc_stream = ctrl->uvc_stream;
+    UVC_ENTER_CRITICAL();
+    ctrl->cancelled = true;
+    const unsigned num_dropped = ctrl->count;
+    for (unsigned i = 0; i < num_dropped; i++) {
+        memcpy(&dropped[i], &ctrl->queue[(ctrl->head + i) % UVC_CTRL_ASYNC_QUEUE_LEN], sizeof(uvc_ctrl_async_req_t));
+    }
+    ctrl->count = 0;
+    // The transfer in flight cannot be cancelled. Its completion callback frees the queue instead.
+    // This also works if the stream is closed from the driver's task, e.g. on device disconnection
+    const bool in_flight = ctrl->in_flight;
+    ctrl->orphaned = in_flight;
+    UVC_EXIT_CRITICAL();
+
+    for (unsigned i = 0; i < num_dropped; i++) {
+        if (dropped[i].cb) {
+            dropped[i].cb(uvc_stream, ESP_ERR_INVALID_STATE, &dropped[i].control, dropped[i].user_ctx);
+        }
+    }
+    if (!in_flight) {
+        uvc_ctrl_async_free(ctrl);
+    }
+}
+
+bool uvc_host_stream_control_is_supported(uvc_host_stream_hdl_t stream_hdl, uvc_host_control_unit_t unit, uint8_t selector)
+{
+    UVC_CHECK(stream_hdl && stream_hdl->constant.ctrl_async, false);
+    UVC_CHECK(unit == UVC_HOST_CONTROL_UNIT_CAMERA || unit == UVC_HOST_CONTROL_UNIT_PROCESSING, false);
+    return uvc_desc_control_is_supported(&stream_hdl->constant.ctrl_async->units, uvc_ctrl_async_unit_subtype(unit), selector);
+}
+
+esp_err_t uvc_host_stream_control_submit(uvc_host_stream_hdl_t stream_hdl, const uvc_host_control_t *controls, size_t num,
+        uvc_host_control_callback_t cb, void *user_ctx)
+{
+    UVC_CHECK(stream_hdl && controls && num > 0, ESP_ERR_INVALID_ARG);
+    uvc_ctrl_async_t *ctrl = stream_hdl->constant.ctrl_async;
+    UVC_CHECK(ctrl, ESP_ERR_INVALID_STATE);
+
+    // Check the whole batch before anything is queued
+    for (size_t i = 0; i < num; i++) {
+        const uvc_host_control_t *control = &controls[i];
+        const bool valid_request = (control->request == UVC_SET_CUR) || (control->request >= UVC_GET_CUR && control->request <= UVC_GET_DEF);
+        UVC_CHECK(valid_request && control->len > 0 && control->len <= UVC_HOST_CONTROL_DATA_MAX, ESP_ERR_INVALID_ARG);
+        UVC_CHECK(uvc_host_stream_control_is_supported(stream_hdl, control->unit, control->selector), ESP_ERR_NOT_SUPPORTED);
+    }
+
+    esp_err_t ret = ESP_OK;
+    bool start = false;
+    UVC_ENTER_CRITICAL();
+    if (ctrl->cancelled) {
+        ret = ESP_ERR_INVALID_STATE;
+        goto exit;
+    }
+
+    // Count free slots needed by the batch: replaced requests do not need one
+    size_t needed = 0;
+    for (size_t i = 0; i < num; i++) {
+        bool replaces = false;
+        if (controls[i].request == UVC_SET_CUR) {
+            replaces = (uvc_ctrl_async_find_replaceable(ctrl, &controls[i]) != NULL);
+            for (size_t j = i; j-- > 0 && !replaces;) {
+                if (uvc_ctrl_async_same_control(&controls[j], &controls[i])) {
+                    replaces = (controls[j].request == UVC_SET_CUR);
+                    break;
+                }
+            }
+        }
+        needed += replaces ? 0 : 1;
+    }
+    if (ctrl->count + needed > UVC_CTRL_ASYNC_QUEUE_LEN) {
+        ret = ESP_ERR_NO_MEM;
+        goto exit;
+    }
+
+    for (size_t i = 0; i < num; i++) {
+        uvc_ctrl_async_req_t *req = NULL;
+        if (controls[i].request == UVC_SET_CUR) {
+            req = uvc_ctrl_async_find_replaceable(ctrl, &controls[i]);
+        }
+        if (!req) {
+            req = &ctrl->queue[(ctrl->head + ctrl->count) % UVC_CTRL_ASYNC_QUEUE_LEN];
+            ctrl->count++;
+        }
+        memcpy(&req->control, &controls[i], sizeof(uvc_host_control_t));
+        req->cb = cb;
+        req->user_ctx = user_ctx;
+    }
+    if (!ctrl->in_flight) {
+        ctrl->in_flight = true;
+        start = true;
+    }
+
+exit:
+    UVC_EXIT_CRITICAL();
+    if (start) {
+        uvc_ctrl_async_send_next(ctrl);
+    }
+    return ret;
+}
+
+esp_err_t uvc_host_stream_control_get_cached(uvc_host_stream_hdl_t stream_hdl, uvc_host_control_unit_t unit, uint8_t selector,
+        uint8_t *data, size_t *len)
+{
+    UVC_CHECK(stream_hdl && data && len, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(unit == UVC_HOST_CONTROL_UNIT_CAMERA || unit == UVC_HOST_CONTROL_UNIT_PROCESSING, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(selector < UVC_CTRL_ASYNC_SELECTORS, ESP_ERR_INVALID_ARG);
+    uvc_ctrl_async_t *ctrl = stream_hdl->constant.ctrl_async;
+    UVC_CHECK(ctrl, ESP_ERR_INVALID_STATE);
+
+    esp_err_t ret = ESP_OK;
+    UVC_ENTER_CRITICAL();
+    const size_t cached_len = ctrl->cache[unit][selector].len;
+    if (cached_len == 0) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else if (*len < cached_len) {
+        ret = ESP_ERR_INVALID_SIZE;
+    } else {
+        memcpy(data, ctrl->cache[unit][selector].data, cached_len);
+    }
+    UVC_EXIT_CRITICAL();
+    if (ret != ESP_ERR_NOT_FOUND) {
+        *len = cached_len;
+    }
+    return ret;
+}
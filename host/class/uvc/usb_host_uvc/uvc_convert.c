@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_attr.h"
+#include "esp_check.h"
+
+#include "usb/uvc_convert.h"
+
+static const char *TAG = "uvc-convert";
+
+// Components of BT.601 conversion are in fixed point 8.8 format, so after shift they are within <-277; 534>.
+// Clamp tables are indexed with these values + offset
+#define CLAMP_TABLE_OFFSET (288)
+#define CLAMP_TABLE_SIZE   (832)
+
+// Clamped color components already shifted to their position in RGB565 pixel
+static DRAM_ATTR uint16_t s_r_table[CLAMP_TABLE_SIZE];
+static DRAM_ATTR uint16_t s_g_table[CLAMP_TABLE_SIZE];
+static DRAM_ATTR uint16_t s_b_table[CLAMP_TABLE_SIZE];
+static bool s_tables_ready = false;
+
+// Clamp the value between 0 and 255
+static inline uint8_t clamp(int value)
+{
+    if (value < 0) {
+        return 0;
+    }
+    if (value > 255) {
+        return 255;
+    }
+    return (uint8_t)value;
+}
+
+/**
+ * @brief Fill clamp tables
+ *
+ * Concurrent calls are harmless, all of them write the same values.
+ */
+static void convert_tables_init(void)
+{
+    for (int i = 0; i < CLAMP_TABLE_SIZE; i++) {
+        const uint8_t value = clamp(i - CLAMP_TABLE_OFFSET);
+        s_r_table[i] = (value >> 3) << 11;
+        s_g_table[i] = (value >> 2) << 5;
+        s_b_table[i] = (value >> 3);
+    }
+    __atomic_store_n(&s_tables_ready, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Convert pixels of YUY2 image
+ *
+ * Inlined with constant swap_bytes, so the byte swap does not cost anything if not used.
+ *
+ * @param[in]  yuy2       YUY2 pixels
+ * @param[out] rgb565     RGB565 pixels
+ * @param[in]  pairs      Number of pixel pairs (one pair shares U and V)
+ * @param[in]  swap_bytes Store RGB565 pixels in big endian
+ */
+static inline __attribute__((always_inline)) void convert_pairs(const uint8_t *yuy2, uint16_t *rgb565, size_t pairs, bool swap_bytes)
+{
+    const uint16_t *r_table = s_r_table + CLAMP_TABLE_OFFSET;
+    const uint16_t *g_table = s_g_table + CLAMP_TABLE_OFFSET;
+    const uint16_t *b_table = s_b_table + CLAMP_TABLE_OFFSET;
+
+    for (size_t i = 0; i < pairs; i++, yuy2 += 4, rgb565 += 2) {
+        // Chroma is shared by both pixels of the pair
+        const int d = yuy2[1] - 128;
+        const int e = yuy2[3] - 128;
+        const int r_uv = 409 * e;
+        const int g_uv = -100 * d - 208 * e;
+        const int b_uv = 516 * d;
+
+        const int y0 = 298 * (yuy2[0] - 16) + 128;
+        const int y1 = 298 * (yuy2[2] - 16) + 128;
+        uint16_t p0 = r_table[(y0 + r_uv) >> 8] | g_table[(y0 + g_uv) >> 8] | b_table[(y0 + b_uv) >> 8];
+        uint16_t p1 = r_table[(y1 + r_uv) >> 8] | g_table[(y1 + g_uv) >> 8] | b_table[(y1 + b_uv) >> 8];
+        if (swap_bytes) {
+            p0 = __builtin_bswap16(p0);
+            p1 = __builtin_bswap16(p1);
+        }
+        rgb565[0] = p0;
+        rgb565[1] = p1;
+    }
+}
+
+void IRAM_ATTR uvc_convert_yuy2_to_rgb565(const uint8_t *yuy2, uint16_t *rgb565, size_t width, size_t height, bool swap_bytes)
+{
+    if (!__atomic_load_n(&s_tables_ready, __ATOMIC_ACQUIRE)) {
+        convert_tables_init();
+    }
+
+    const size_t pairs = width * height / 2;
+    if (swap_bytes) {
+        convert_pairs(yuy2, rgb565, pairs, true);
+    } else {
+        convert_pairs(yuy2, rgb565, pairs, false);
+    }
+}
+
+void uvc_convert_yuy2_to_rgb565_ref(const uint8_t *yuy2, uint16_t *rgb565, size_t width, size_t height, bool swap_bytes)
+{
+    const size_t size = width * height;
+
+    for (size_t i = 0; i < size; i += 2) {
+        int y0 = yuy2[i * 2 + 0];
+        int u  = yuy2[i * 2 + 1];
+        int y1 = yuy2[i * 2 + 2];
+        int v  = yuy2[i * 2 + 3];
+
+        int c0 = y0 - 16;
+        int c1 = y1 - 16;
+        int d = u - 128;
+        int e = v - 128;
+
+        int r0 = clamp((298 * c0 + 409 * e + 128) >> 8);
+        int g0 = clamp((298 * c0 - 100 * d - 208 * e + 128) >> 8);
+        int b0 = clamp((298 * c0 + 516 * d + 128) >> 8);
+
+        int r1 = clamp((298 * c1 + 409 * e + 128) >> 8);
+        int g1 = clamp((298 * c1 - 100 * d - 208 * e + 128) >> 8);
+        int b1 = clamp((298 * c1 + 516 * d + 128) >> 8);
+
+        // Convert RGB888 to RGB565 for both pixels
+        uint16_t p0 = ((r0 >> 3) << 11) | ((g0 >> 2) << 5) | (b0 >> 3);
+        uint16_t p1 = ((r1 >> 3) << 11) | ((g1 >> 2) << 5) | (b1 >> 3);
+        rgb565[i]     = swap_bytes ? __builtin_bswap16(p0) : p0;
+        rgb565[i + 1] = swap_bytes ? __builtin_bswap16(p1) : p1;
+    }
+}
+
+esp_err_t uvc_convert_yuy2_to_rgb565_banded(const uint8_t *yuy2, size_t width, size_t height, const uvc_convert_band_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(yuy2 && config && config->band_buffers[0] && config->band_lines && config->band_cb, ESP_ERR_INVALID_ARG, TAG,);
+    ESP_RETURN_ON_FALSE(width % 2 == 0, ESP_ERR_INVALID_ARG, TAG, "Width must be even");
+
+    unsigned buffer_index = 0;
+    for (size_t y = 0; y < height; y += config->band_lines) {
+        const size_t lines = (height - y < config->band_lines) ? (height - y) : config->band_lines;
+        uint16_t *band = config->band_buffers[buffer_index];
+
+        // Lines of the band are contiguous in both images
+        uvc_convert_yuy2_to_rgb565(yuy2 + y * width * 2, band, width, lines, config->swap_bytes);
+        config->band_cb(band, y, lines, config->user_ctx);
+        if (config->band_buffers[1]) {
+            buffer_index ^= 1;
+        }
+    }
+    return ESP_OK;
+}
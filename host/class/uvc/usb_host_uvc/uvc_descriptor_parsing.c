@@ -7,6 +7,8 @@
 #include <inttypes.h>
 #include <string.h> // strncmp for guid format parsing
 #include <math.h>   // fabs for float comparison
+#include <stdlib.h> // calloc for descriptor index
+#include <stddef.h> // offsetof for control bitmaps
 #include "usb/usb_helpers.h"
 #include "usb/uvc_host.h"
 #include "uvc_check_priv.h"
@@ -42,43 +44,44 @@ esp_err_t uvc_desc_get_streaming_intf_and_ep(
 {
     UVC_CHECK(cfg_desc && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
 
-    const usb_intf_desc_t *intf_desc = NULL;
-    const usb_ep_desc_t *ep_desc = NULL;
-    int offset = 0;
+    uvc_desc_index_t *index;
+    esp_err_t ret = uvc_desc_index_build(cfg_desc, bInterfaceNumber, &index);
+    if (ret == ESP_OK) {
+        ret = uvc_desc_index_get_streaming_intf_and_ep(index, dwMaxPayloadTransferSize, intf_desc_ret, ep_desc_ret);
+        uvc_desc_index_free(index);
+    }
+    return ret;
+}
 
-    const uint8_t num_of_alternate = usb_parse_interface_number_of_alternate(cfg_desc, bInterfaceNumber);
-    uint16_t last_mps = 0; // Looking for maximum MPS: init to zero
-    uint8_t last_mult = UINT8_MAX; // Looking for minimum: init to max
-    for (int i = 0; i <= num_of_alternate; i++) {
-        // Check Interface desc
-        intf_desc = usb_parse_interface_descriptor(cfg_desc, bInterfaceNumber, i, &offset);
-        UVC_CHECK(intf_desc, ESP_ERR_NOT_FOUND);
-        UVC_CHECK(intf_desc->bInterfaceClass == USB_CLASS_VIDEO, ESP_ERR_NOT_FOUND);
-        UVC_CHECK(intf_desc->bInterfaceSubClass == UVC_SC_VIDEOSTREAMING, ESP_ERR_NOT_FOUND);
-        if (intf_desc->bNumEndpoints == 0 && i == 0) {
-            continue; // This is Alternate setting 0 for ISOC cameras.
-        }
-        UVC_CHECK(intf_desc->bNumEndpoints == 1, ESP_ERR_NOT_FOUND); // Only 1 endpoint is expected
+uint32_t uvc_desc_get_ep_interval_us(const usb_ep_desc_t *ep_desc, bool high_speed)
+{
+    assert(ep_desc);
+    // Service interval of ISOC endpoints is 2^(bInterval-1) (micro)frames
+    // @see USB 2.0 specification, table 9-13
+    const uint8_t bInterval = (ep_desc->bInterval >= 1 && ep_desc->bInterval <= 16) ? ep_desc->bInterval : 1;
+    return (high_speed ? 125 : 1000) << (bInterval - 1);
+}
 
-        // Check EP desc
-        ep_desc = usb_parse_endpoint_descriptor_by_index(intf_desc, 0, cfg_desc->wTotalLength, &offset);
-        UVC_CHECK(ep_desc, ESP_ERR_NOT_FOUND);
+esp_err_t uvc_desc_get_streaming_intf_and_ep_by_bandwidth(
+    const usb_config_desc_t *cfg_desc,
+    uint8_t bInterfaceNumber,
+    bool high_speed,
+    uint32_t bytes_per_second,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(cfg_desc && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
 
-        // Here we look for an interface that offers the largest MPS with minimum multiple transactions in a microframe
-        // and that is not bigger that max. requests MPS
-        const uint16_t current_mps = USB_EP_DESC_GET_MPS(ep_desc);
-        const uint8_t current_mult = USB_EP_DESC_GET_MULT(ep_desc);
-        if (current_mps >= last_mps && current_mult <= last_mult && current_mps <= dwMaxPayloadTransferSize) {
-            last_mps = current_mps;
-            last_mult = current_mult;
-            *ep_desc_ret = ep_desc;
-            *intf_desc_ret = intf_desc;
-        } else {
-            break;
-        }
+    uvc_desc_index_t *index;
+    esp_err_t ret = uvc_desc_index_build(cfg_desc, bInterfaceNumber, &index);
+    if (ret == ESP_OK) {
+        ret = uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+                  index, high_speed, bytes_per_second, dwMaxPayloadTransferSize, max_mps, intf_desc_ret, ep_desc_ret);
+        uvc_desc_index_free(index);
     }
-
-    return ESP_OK;
+    return ret;
 }
 
 /**
@@ -124,6 +127,22 @@ static bool uvc_desc_is_frame_desc(const usb_standard_desc_t *_desc)
     return is_frame_desc;
 }
 
+/**
+ * @brief Check if this descriptor is Still Image Frame descriptor
+ *
+ * @param[in] _desc USB descriptor of Video Streaming interface
+ * @return true  Is Still Image Frame descriptor
+ * @return false Is NOT Still Image Frame descriptor
+ */
+static bool uvc_desc_is_still_frame_desc(const usb_standard_desc_t *_desc)
+{
+    assert(_desc);
+    const uvc_still_image_frame_desc_t *desc = (const uvc_still_image_frame_desc_t *)_desc;
+    return desc->bDescriptorType == UVC_CS_INTERFACE &&
+           desc->bDescriptorSubType == UVC_VS_DESC_SUBTYPE_STILL_IMAGE_FRAME &&
+           desc->bLength >= 5;
+}
+
 int uvc_desc_parse_format(const uvc_format_desc_t *format_desc)
 {
     // Input checks
@@ -303,6 +322,220 @@ static const uvc_vc_header_desc_t *uvc_desc_get_control_interface_header(const u
     return header_desc_ret;
 }
 
+uint32_t uvc_desc_get_clock_frequency(const usb_config_desc_t *cfg_desc, uint8_t uvc_index)
+{
+    const uvc_vc_header_desc_t *vc_header_desc = uvc_desc_get_control_interface_header(cfg_desc, uvc_index);
+    return vc_header_desc ? vc_header_desc->dwClockFrequency : 0;
+}
+
+/**
+ * @brief Read bmControls bitmap of Terminal or Unit descriptor
+ *
+ * @param[in] bmControls   Start of bmControls
+ * @param[in] bControlSize Size of bmControls in bytes
+ * @return bmControls, at most 32 bits
+ */
+static uint32_t uvc_desc_read_controls(const uint8_t *bmControls, uint8_t bControlSize)
+{
+    uint32_t controls = 0;
+    for (int i = 0; i < bControlSize && i < 4; i++) {
+        controls |= (uint32_t)bmControls[i] << (8 * i);
+    }
+    return controls;
+}
+
+esp_err_t uvc_desc_get_control_units(const usb_config_desc_t *cfg_desc, uint8_t uvc_index, uvc_desc_control_units_t *units)
+{
+    UVC_CHECK(cfg_desc && units, ESP_ERR_INVALID_ARG);
+    memset(units, 0, sizeof(uvc_desc_control_units_t));
+
+    // Find IAD UVC descriptor with desired index. Its first interface is the Video Control interface
+    int offset = 0;
+    int uvc_iad_idx = 0;
+    const usb_iad_desc_t *iad_desc = NULL;
+    const usb_standard_desc_t *current_desc = (const usb_standard_desc_t *)cfg_desc;
+    while ((current_desc = usb_parse_next_descriptor_of_type(current_desc, cfg_desc->wTotalLength, USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION, &offset))) {
+        const usb_iad_desc_t *this_iad = (const usb_iad_desc_t *)current_desc;
+        if (this_iad->bFunctionClass == USB_CLASS_VIDEO && this_iad->bFunctionSubClass == UVC_SC_VIDEO_INTERFACE_COLLECTION) {
+            if (uvc_iad_idx++ == uvc_index) {
+                iad_desc = this_iad;
+                break;
+            }
+        }
+    }
+    UVC_CHECK(iad_desc, ESP_ERR_NOT_FOUND);
+    units->bInterfaceNumber = iad_desc->bFirstInterface;
+
+    // Class specific descriptors of the Video Control interface follow until the next interface
+    bool in_vc_intf = false;
+    while ((current_desc = usb_parse_next_descriptor(current_desc, cfg_desc->wTotalLength, &offset))) {
+        if (current_desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE) {
+            const usb_intf_desc_t *intf_desc = (const usb_intf_desc_t *)current_desc;
+            if (in_vc_intf && intf_desc->bInterfaceNumber != units->bInterfaceNumber) {
+                break;
+            }
+            in_vc_intf = (intf_desc->bInterfaceNumber == units->bInterfaceNumber);
+            continue;
+        }
+        if (!in_vc_intf || current_desc->bDescriptorType != UVC_CS_INTERFACE) {
+            continue;
+        }
+
+        const uint8_t *desc = (const uint8_t *)current_desc;
+        switch (desc[2]) { // bDescriptorSubType
+        case UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL: {
+            const uvc_input_terminal_camera_desc_t *ct_desc = (const uvc_input_terminal_camera_desc_t *)desc;
+            const size_t controls_offset = offsetof(uvc_input_terminal_camera_desc_t, bmControls);
+            if (units->camera_terminal_id == 0 && ct_desc->wTerminalType == UVC_ITT_CAMERA &&
+                    ct_desc->bLength >= controls_offset && ct_desc->bLength >= controls_offset + ct_desc->bControlSize) {
+                units->camera_terminal_id = ct_desc->bTerminalID;
+                units->camera_controls = uvc_desc_read_controls(ct_desc->bmControls, ct_desc->bControlSize);
+            }
+            break;
+        }
+        case UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT: {
+            const uvc_processing_unit_desc_t *pu_desc = (const uvc_processing_unit_desc_t *)desc;
+            const size_t controls_offset = offsetof(uvc_processing_unit_desc_t, bmControls);
+            if (units->processing_unit_id == 0 &&
+                    pu_desc->bLength >= controls_offset && pu_desc->bLength >= controls_offset + pu_desc->bControlSize) {
+                units->processing_unit_id = pu_desc->bUnitID;
+                units->processing_controls = uvc_desc_read_controls(pu_desc->bmControls, pu_desc->bControlSize);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+bool uvc_desc_control_is_supported(const uvc_desc_control_units_t *units, uint8_t subtype, uint8_t selector)
+{
+    // Bit of bmControls for every control selector, UVC 1.5 tables 3-6 and 3-8. -1: Not a control of this unit
+    static const int8_t ct_bits[] = {
+        [UVC_CT_SCANNING_MODE_CONTROL] = 0,           [UVC_CT_AE_MODE_CONTROL] = 1,
+        [UVC_CT_AE_PRIORITY_CONTROL] = 2,             [UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL] = 3,
+        [UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL] = 4,  [UVC_CT_FOCUS_ABSOLUTE_CONTROL] = 5,
+        [UVC_CT_FOCUS_RELATIVE_CONTROL] = 6,          [UVC_CT_FOCUS_AUTO_CONTROL] = 17,
+        [UVC_CT_IRIS_ABSOLUTE_CONTROL] = 7,           [UVC_CT_IRIS_RELATIVE_CONTROL] = 8,
+        [UVC_CT_ZOOM_ABSOLUTE_CONTROL] = 9,           [UVC_CT_ZOOM_RELATIVE_CONTROL] = 10,
+        [UVC_CT_PANTILT_ABSOLUTE_CONTROL] = 11,       [UVC_CT_PANTILT_RELATIVE_CONTROL] = 12,
+        [UVC_CT_ROLL_ABSOLUTE_CONTROL] = 13,          [UVC_CT_ROLL_RELATIVE_CONTROL] = 14,
+        [UVC_CT_PRIVACY_CONTROL] = 18,                [UVC_CT_FOCUS_SIMPLE_CONTROL] = 19,
+        [UVC_CT_WINDOW_CONTROL] = 20,                 [UVC_CT_REGION_OF_INTEREST_CONTROL] = 21,
+    };
+    static const int8_t pu_bits[] = {
+        [UVC_PU_BACKLIGHT_COMPENSATION_CONTROL] = 8,  [UVC_PU_BRIGHTNESS_CONTROL] = 0,
+        [UVC_PU_CONTRAST_CONTROL] = 1,                [UVC_PU_GAIN_CONTROL] = 9,
+        [UVC_PU_POWER_LINE_FREQUENCY_CONTROL] = 10,   [UVC_PU_HUE_CONTROL] = 2,
+        [UVC_PU_SATURATION_CONTROL] = 3,              [UVC_PU_SHARPNESS_CONTROL] = 4,
+        [UVC_PU_GAMMA_CONTROL] = 5,                   [UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL] = 6,
+        [UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL] = 12, [UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL] = 7,
+        [UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL] = 13,   [UVC_PU_DIGITAL_MULTIPLIER_CONTROL] = 14,
+        [UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL] = 15,       [UVC_PU_HUE_AUTO_CONTROL] = 11,
+        [UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL] = 16,  [UVC_PU_ANALOG_LOCK_STATUS_CONTROL] = 17,
+        [UVC_PU_CONTRAST_AUTO_CONTROL] = 18,
+    };
+    UVC_CHECK(units, false);
+
+    const int8_t *bits;
+    size_t num_bits;
+    uint32_t controls;
+    if (subtype == UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL && units->camera_terminal_id) {
+        bits = ct_bits;
+        num_bits = sizeof(ct_bits) / sizeof(ct_bits[0]);
+        controls = units->camera_controls;
+    } else if (subtype == UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT && units->processing_unit_id) {
+        bits = pu_bits;
+        num_bits = sizeof(pu_bits) / sizeof(pu_bits[0]);
+        controls = units->processing_controls;
+    } else {
+        return false;
+    }
+    // Selector 0 is undefined. Its table entry is 0 like the entry of bit 0, so it is rejected here
+    if (selector == 0 || selector >= num_bits) {
+        return false;
+    }
+    return controls & (1UL << bits[selector]);
+}
+
+/**
+ * @brief Fill frame list entry from Format and Frame descriptors
+ *
+ * @param[in]  format     Indexed format
+ * @param[in]  frame_desc Frame descriptor of the format
+ * @param[out] entry      Frame list entry
+ */
+static void uvc_desc_fill_frame_list_entry(const uvc_desc_index_format_t *format, const uvc_frame_desc_t *frame_desc, uvc_host_frame_list_entry_t *entry)
+{
+    memset(entry, 0, sizeof(uvc_host_frame_list_entry_t));
+    entry->format = format->format;
+    entry->h_res = frame_desc->wWidth;
+    entry->v_res = frame_desc->wHeight;
+    entry->dwMaxBitRate = frame_desc->dwMaxBitRate;
+
+    // Descriptors are packed, intervals are copied member by member
+    const bool frame_based = (frame_desc->bDescriptorSubType == UVC_VS_DESC_SUBTYPE_FRAME_FRAME_BASED);
+#define FRAME_DESC_FIELD(field) (frame_based ? frame_desc->frame_based.field : frame_desc->mjpeg_uncompressed.field)
+    entry->dwDefaultFrameInterval = FRAME_DESC_FIELD(dwDefaultFrameInterval);
+    entry->bFrameIntervalType = FRAME_DESC_FIELD(bFrameIntervalType);
+    if (entry->bFrameIntervalType == 0) {
+        entry->continuous.dwMinFrameInterval = FRAME_DESC_FIELD(dwMinFrameInterval);
+        entry->continuous.dwMaxFrameInterval = FRAME_DESC_FIELD(dwMaxFrameInterval);
+        entry->continuous.dwFrameIntervalStep = FRAME_DESC_FIELD(dwFrameIntervalStep);
+    } else {
+        const int num = (entry->bFrameIntervalType < UVC_HOST_FRAME_INTERVALS_MAX) ? entry->bFrameIntervalType : UVC_HOST_FRAME_INTERVALS_MAX;
+        for (int i = 0; i < num; i++) {
+            entry->discrete[i] = FRAME_DESC_FIELD(dwFrameInterval[i]);
+        }
+    }
+#undef FRAME_DESC_FIELD
+
+    if (!frame_based) {
+        entry->dwMaxVideoFrameSize = frame_desc->mjpeg_uncompressed.dwMaxVideoFrameBufferSize;
+        if (entry->dwMaxVideoFrameSize == 0 && frame_desc->bDescriptorSubType == UVC_VS_DESC_SUBTYPE_FRAME_UNCOMPRESSED) {
+            // dwMaxVideoFrameBufferSize is deprecated since UVC 1.5, size of uncompressed frame is known
+            entry->dwMaxVideoFrameSize = frame_desc->wWidth * frame_desc->wHeight * format->format_desc->uncompressed_frame_based.bBitsPerPixel / 8;
+        }
+    }
+}
+
+esp_err_t uvc_desc_get_frame_list(const usb_config_desc_t *cfg_desc, uint8_t uvc_index, uvc_host_frame_list_entry_t *frame_list, size_t *list_size)
+{
+    UVC_CHECK(cfg_desc && list_size, ESP_ERR_INVALID_ARG);
+
+    const uvc_vc_header_desc_t *vc_header_desc = uvc_desc_get_control_interface_header(cfg_desc, uvc_index);
+    UVC_CHECK(vc_header_desc, ESP_ERR_NOT_FOUND);
+
+    const size_t capacity = frame_list ? *list_size : 0;
+    size_t num_of_entries = 0;
+    for (int streaming_if = 0; streaming_if < vc_header_desc->bInCollection; streaming_if++) {
+        uvc_desc_index_t *index;
+        const esp_err_t ret = uvc_desc_index_build(cfg_desc, vc_header_desc->baInterfaceNr[streaming_if], &index);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            continue; // Not a Video Streaming interface
+        }
+        UVC_CHECK(ret == ESP_OK, ret);
+
+        for (int i = 0; i < index->num_formats; i++) {
+            const uvc_desc_index_format_t *format = &index->formats[i];
+            for (int j = 0; format->format_desc && j < format->num_frames; j++) {
+                if (!format->frame_descs[j]) {
+                    continue;
+                }
+                if (num_of_entries < capacity) {
+                    uvc_desc_fill_frame_list_entry(format, format->frame_descs[j], &frame_list[num_of_entries]);
+                }
+                num_of_entries++;
+            }
+        }
+        uvc_desc_index_free(index);
+    }
+    *list_size = num_of_entries;
+    return ESP_OK;
+}
+
 esp_err_t uvc_desc_get_frame_format_by_index(
     const usb_config_desc_t *cfg_desc,
     uint8_t bInterfaceNumber,
@@ -375,3 +608,372 @@ esp_err_t uvc_desc_get_streaming_interface_num(
     }
     return ret;
 }
+
+esp_err_t uvc_desc_index_build(const usb_config_desc_t *cfg_desc, uint8_t bInterfaceNumber, uvc_desc_index_t **index_ret)
+{
+    UVC_CHECK(cfg_desc && index_ret, ESP_ERR_INVALID_ARG);
+
+    const uvc_vs_input_header_desc_t *input_header = uvc_desc_get_streaming_input_header(cfg_desc, bInterfaceNumber);
+    UVC_CHECK(input_header, ESP_ERR_NOT_FOUND);
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    uvc_desc_index_t *index = calloc(1, sizeof(uvc_desc_index_t));
+    UVC_CHECK(index, ESP_ERR_NO_MEM);
+    index->cfg_desc = cfg_desc;
+    index->bInterfaceNumber = bInterfaceNumber;
+    index->bStillCaptureMethod = input_header->bStillCaptureMethod;
+    index->num_formats = input_header->bNumFormats;
+    index->num_alts = usb_parse_interface_number_of_alternate(cfg_desc, bInterfaceNumber) + 1;
+    index->formats = calloc(index->num_formats ? index->num_formats : 1, sizeof(uvc_desc_index_format_t));
+    index->alts = calloc(index->num_alts, sizeof(uvc_desc_index_alt_t));
+    if (!index->formats || !index->alts) {
+        goto err;
+    }
+
+    // Walk all descriptors of this interface once: from alternate setting 0 up to the next interface
+    int offset = 0;
+    const usb_standard_desc_t *current_desc = (const usb_standard_desc_t *)usb_parse_interface_descriptor(cfg_desc, bInterfaceNumber, 0, &offset);
+    uvc_desc_index_format_t *format = NULL;
+    uvc_desc_index_alt_t *alt = NULL;
+    while (current_desc) {
+        if (current_desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE) {
+            const usb_intf_desc_t *intf_desc = (const usb_intf_desc_t *)current_desc;
+            if (intf_desc->bInterfaceNumber != bInterfaceNumber) {
+                break; // End of this interface
+            }
+            alt = NULL;
+            if (intf_desc->bAlternateSetting < index->num_alts && !index->alts[intf_desc->bAlternateSetting].intf_desc) {
+                alt = &index->alts[intf_desc->bAlternateSetting];
+                alt->intf_desc = intf_desc;
+            }
+        } else if (current_desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_ENDPOINT) {
+            if (alt && !alt->ep_desc) {
+                alt->ep_desc = (const usb_ep_desc_t *)current_desc;
+            }
+        } else if (uvc_desc_is_format_desc(current_desc)) {
+            const uvc_format_desc_t *format_desc = (const uvc_format_desc_t *)current_desc;
+            format = NULL;
+            if (format_desc->bFormatIndex >= 1 && format_desc->bFormatIndex <= index->num_formats &&
+                    !index->formats[format_desc->bFormatIndex - 1].format_desc) {
+                format = &index->formats[format_desc->bFormatIndex - 1];
+                format->format_desc = format_desc;
+                format->format = uvc_desc_parse_format(format_desc);
+                format->num_frames = format_desc->bNumFrameDescriptors;
+                if (format->num_frames) {
+                    format->frame_descs = calloc(format->num_frames, sizeof(uvc_frame_desc_t *));
+                    if (!format->frame_descs) {
+                        goto err;
+                    }
+                }
+            }
+        } else if (uvc_desc_is_frame_desc(current_desc)) {
+            // Frame descriptors follow their format descriptor
+            const uvc_frame_desc_t *frame_desc = (const uvc_frame_desc_t *)current_desc;
+            if (format && frame_desc->bFrameIndex >= 1 && frame_desc->bFrameIndex <= format->num_frames) {
+                format->frame_descs[frame_desc->bFrameIndex - 1] = frame_desc;
+            }
+        } else if (uvc_desc_is_still_frame_desc(current_desc)) {
+            // Still Image Frame descriptor follows the frame descriptors of its format
+            if (format && !format->still_desc) {
+                format->still_desc = (const uvc_still_image_frame_desc_t *)current_desc;
+            }
+        }
+        current_desc = usb_parse_next_descriptor(current_desc, cfg_desc->wTotalLength, &offset);
+    }
+
+    *index_ret = index;
+    return ESP_OK;
+
+err:
+    uvc_desc_index_free(index);
+    return ret;
+}
+
+void uvc_desc_index_free(uvc_desc_index_t *index)
+{
+    if (!index) {
+        return;
+    }
+    if (index->formats) {
+        for (int i = 0; i < index->num_formats; i++) {
+            free(index->formats[i].frame_descs);
+        }
+    }
+    free(index->formats);
+    free(index->alts);
+    free(index);
+}
+
+esp_err_t uvc_desc_index_get_frame_format_by_index(
+    const uvc_desc_index_t *index,
+    uint8_t bFormatIndex,
+    uint8_t bFrameIndex,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret)
+{
+    UVC_CHECK(bFormatIndex > 0, ESP_ERR_INVALID_ARG); // Formats are indexed from 1
+    UVC_CHECK(bFrameIndex > 0, ESP_ERR_INVALID_ARG); // Frames are indexed from 1
+    UVC_CHECK(index && format_desc_ret && frame_desc_ret, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(bFormatIndex <= index->num_formats, ESP_ERR_NOT_FOUND);
+
+    const uvc_desc_index_format_t *format = &index->formats[bFormatIndex - 1];
+    UVC_CHECK(format->format_desc && bFrameIndex <= format->num_frames, ESP_ERR_NOT_FOUND);
+    UVC_CHECK(format->frame_descs[bFrameIndex - 1], ESP_ERR_NOT_FOUND);
+    *format_desc_ret = format->format_desc;
+    *frame_desc_ret = format->frame_descs[bFrameIndex - 1];
+    return ESP_OK;
+}
+
+esp_err_t uvc_desc_index_get_still_size(
+    const uvc_desc_index_t *index,
+    uint8_t bFormatIndex,
+    unsigned h_res,
+    unsigned v_res,
+    uvc_desc_still_size_t *size_ret)
+{
+    UVC_CHECK(index && size_ret, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(bFormatIndex >= 1 && bFormatIndex <= index->num_formats, ESP_ERR_NOT_FOUND);
+    const uvc_still_image_frame_desc_t *still_desc = index->formats[bFormatIndex - 1].still_desc;
+    UVC_CHECK(still_desc, ESP_ERR_NOT_FOUND);
+
+    // Variable length descriptor: bNumImageSizePatterns x (wWidth, wHeight), then bNumCompressionPattern x bCompression
+    // @see USB UVC specification ver 1.5, table 3-18
+    const uint8_t *desc = (const uint8_t *)still_desc;
+    const unsigned num_patterns = still_desc->bNumImageSizePatterns;
+    const unsigned compression_offset = 5 + num_patterns * 4;
+    UVC_CHECK(still_desc->bLength >= compression_offset, ESP_ERR_NOT_FOUND);
+
+    int found = -1;
+    uint32_t found_area = 0;
+    for (unsigned i = 0; i < num_patterns; i++) {
+        const uint16_t width = desc[5 + i * 4] | (desc[6 + i * 4] << 8);
+        const uint16_t height = desc[7 + i * 4] | (desc[8 + i * 4] << 8);
+        if (h_res == 0 && v_res == 0) {
+            if ((uint32_t)width * height > found_area) {
+                found = i;
+                found_area = (uint32_t)width * height;
+            }
+        } else if (width == h_res && height == v_res) {
+            found = i;
+            break;
+        }
+    }
+    UVC_CHECK(found >= 0, ESP_ERR_NOT_FOUND);
+
+    size_ret->bFrameIndex = found + 1;
+    size_ret->bCompressionIndex = (still_desc->bLength > compression_offset && desc[compression_offset] > 0) ? 1 : 0;
+    size_ret->bEndpointAddress = still_desc->bEndpointAddress;
+    size_ret->wWidth = desc[5 + found * 4] | (desc[6 + found * 4] << 8);
+    size_ret->wHeight = desc[7 + found * 4] | (desc[8 + found * 4] << 8);
+    return ESP_OK;
+}
+
+esp_err_t uvc_desc_index_get_frame_format_by_format(
+    const uvc_desc_index_t *index,
+    const uvc_host_stream_format_t *vs_format,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret)
+{
+    UVC_CHECK(index && vs_format, ESP_ERR_INVALID_ARG);
+
+    for (int i = 0; i < index->num_formats; i++) {
+        const uvc_desc_index_format_t *format = &index->formats[i];
+        if (!format->format_desc || format->format != vs_format->format) {
+            continue;
+        }
+        if (format_desc_ret) {
+            *format_desc_ret = format->format_desc;
+        }
+        // We found required Format, now we look for correct Frame
+        for (int j = 0; j < format->num_frames; j++) {
+            if (format->frame_descs[j] && uvc_desc_format_is_equal(format->frame_descs[j], vs_format)) {
+                if (frame_desc_ret) {
+                    *frame_desc_ret = format->frame_descs[j];
+                }
+                return ESP_OK;
+            }
+        }
+        break;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Check alternate setting of Video Streaming interface
+ *
+ * @param[in] alt Alternate setting
+ * @return true if this is Video Streaming interface descriptor
+ */
+static inline bool uvc_desc_index_alt_is_streaming(const uvc_desc_index_alt_t *alt)
+{
+    return alt->intf_desc &&
+           alt->intf_desc->bInterfaceClass == USB_CLASS_VIDEO &&
+           alt->intf_desc->bInterfaceSubClass == UVC_SC_VIDEOSTREAMING;
+}
+
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep(
+    const uvc_desc_index_t *index,
+    uint16_t dwMaxPayloadTransferSize,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(index && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
+
+    uint16_t last_mps = 0; // Looking for maximum MPS: init to zero
+    uint8_t last_mult = UINT8_MAX; // Looking for minimum: init to max
+    for (int i = 0; i < index->num_alts; i++) {
+        // Check Interface desc
+        const uvc_desc_index_alt_t *alt = &index->alts[i];
+        UVC_CHECK(uvc_desc_index_alt_is_streaming(alt), ESP_ERR_NOT_FOUND);
+        if (alt->intf_desc->bNumEndpoints == 0 && i == 0) {
+            continue; // This is Alternate setting 0 for ISOC cameras.
+        }
+        UVC_CHECK(alt->intf_desc->bNumEndpoints == 1, ESP_ERR_NOT_FOUND); // Only 1 endpoint is expected
+
+        // Check EP desc
+        UVC_CHECK(alt->ep_desc, ESP_ERR_NOT_FOUND);
+
+        // Here we look for an interface that offers the largest MPS with minimum multiple transactions in a microframe
+        // and that is not bigger that max. requests MPS
+        const uint16_t current_mps = USB_EP_DESC_GET_MPS(alt->ep_desc);
+        const uint8_t current_mult = USB_EP_DESC_GET_MULT(alt->ep_desc);
+        if (current_mps >= last_mps && current_mult <= last_mult && current_mps <= dwMaxPayloadTransferSize) {
+            last_mps = current_mps;
+            last_mult = current_mult;
+            *ep_desc_ret = alt->ep_desc;
+            *intf_desc_ret = alt->intf_desc;
+        } else {
+            break;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+    const uvc_desc_index_t *index,
+    bool high_speed,
+    uint32_t bytes_per_second,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(index && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
+
+    const usb_intf_desc_t *best_intf = NULL, *largest_intf = NULL;
+    const usb_ep_desc_t *best_ep = NULL, *largest_ep = NULL;
+    uint64_t best_reserved = UINT64_MAX; // Looking for minimum reserved bandwidth: init to max
+    uint64_t largest_reserved = 0;       // Fallback: maximum reserved bandwidth
+
+    for (int i = 0; i < index->num_alts; i++) {
+        UVC_CHECK(uvc_desc_index_alt_is_streaming(&index->alts[i]), ESP_ERR_NOT_FOUND);
+        const usb_intf_desc_t *intf_desc = index->alts[i].intf_desc;
+        if (intf_desc->bNumEndpoints == 0) {
+            continue; // This is Alternate setting 0 for ISOC cameras.
+        }
+        const usb_ep_desc_t *ep_desc = index->alts[i].ep_desc;
+        UVC_CHECK(ep_desc, ESP_ERR_NOT_FOUND);
+
+        if (USB_EP_DESC_GET_XFERTYPE(ep_desc) != USB_BM_ATTRIBUTES_XFER_ISOC) {
+            // Bulk endpoints do not reserve bandwidth, there is nothing to select from
+            *intf_desc_ret = intf_desc;
+            *ep_desc_ret = ep_desc;
+            return ESP_OK;
+        }
+        if (USB_EP_DESC_GET_MPS(ep_desc) > max_mps) {
+            continue; // Does not fit in IN FIFO
+        }
+
+        // Bytes that must be transferred in one service interval of this alternate setting.
+        // The device will never send more than dwMaxPayloadTransferSize in one interval
+        const uint32_t interval_us = uvc_desc_get_ep_interval_us(ep_desc, high_speed);
+        uint64_t required = ((uint64_t)bytes_per_second * interval_us + 999999) / 1000000;
+        if (dwMaxPayloadTransferSize && required > dwMaxPayloadTransferSize) {
+            required = dwMaxPayloadTransferSize;
+        }
+        const uint32_t capacity = USB_EP_DESC_GET_MPS(ep_desc) * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+        const uint64_t reserved = (uint64_t)capacity * 1000000 / interval_us; // Reserved bus bandwidth in bytes per second
+
+        if (capacity >= required && reserved < best_reserved) {
+            best_reserved = reserved;
+            best_intf = intf_desc;
+            best_ep = ep_desc;
+        }
+        if (reserved > largest_reserved) {
+            largest_reserved = reserved;
+            largest_intf = intf_desc;
+            largest_ep = ep_desc;
+        }
+    }
+
+    if (!best_intf) {
+        // No alternate setting offers enough bandwidth, use the largest one
+        UVC_CHECK(largest_intf, ESP_ERR_NOT_FOUND);
+        best_intf = largest_intf;
+        best_ep = largest_ep;
+    }
+    *intf_desc_ret = best_intf;
+    *ep_desc_ret = best_ep;
+    return ESP_OK;
+}
+
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_by_alt(
+    const uvc_desc_index_t *index,
+    uint8_t bAlternateSetting,
+    uint8_t bEndpointAddress,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(index && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(bAlternateSetting < index->num_alts, ESP_ERR_NOT_FOUND);
+
+    const uvc_desc_index_alt_t *alt = &index->alts[bAlternateSetting];
+    UVC_CHECK(uvc_desc_index_alt_is_streaming(alt) && alt->ep_desc, ESP_ERR_NOT_FOUND);
+    UVC_CHECK(alt->ep_desc->bEndpointAddress == bEndpointAddress && USB_EP_DESC_GET_MPS(alt->ep_desc) <= max_mps, ESP_ERR_NOT_FOUND);
+    *intf_desc_ret = alt->intf_desc;
+    *ep_desc_ret = alt->ep_desc;
+    return ESP_OK;
+}
+
+/**
+ * @brief Bus bandwidth reserved by an ISOC endpoint, in bytes per second
+ */
+static uint64_t uvc_desc_ep_reserved_bandwidth(const usb_ep_desc_t *ep_desc, bool high_speed)
+{
+    const uint32_t capacity = USB_EP_DESC_GET_MPS(ep_desc) * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+    return (uint64_t)capacity * 1000000 / uvc_desc_get_ep_interval_us(ep_desc, high_speed);
+}
+
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_step_down(
+    const uvc_desc_index_t *index,
+    bool high_speed,
+    const usb_ep_desc_t *ep_desc,
+    uint16_t max_mps,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(index && ep_desc && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
+
+    const uint64_t current = uvc_desc_ep_reserved_bandwidth(ep_desc, high_speed);
+    const uvc_desc_index_alt_t *best = NULL;
+    uint64_t best_reserved = 0; // Looking for maximum below current: init to min
+    for (int i = 0; i < index->num_alts; i++) {
+        const uvc_desc_index_alt_t *alt = &index->alts[i];
+        if (!uvc_desc_index_alt_is_streaming(alt) || !alt->ep_desc ||
+                USB_EP_DESC_GET_XFERTYPE(alt->ep_desc) != USB_BM_ATTRIBUTES_XFER_ISOC ||
+                USB_EP_DESC_GET_MPS(alt->ep_desc) > max_mps) {
+            continue;
+        }
+        const uint64_t reserved = uvc_desc_ep_reserved_bandwidth(alt->ep_desc, high_speed);
+        if (reserved < current && reserved > best_reserved) {
+            best_reserved = reserved;
+            best = alt;
+        }
+    }
+    UVC_CHECK(best, ESP_ERR_NOT_FOUND);
+    *intf_desc_ret = best->intf_desc;
+    *ep_desc_ret = best->ep_desc;
+    return ESP_OK;
+}
@@ -7,10 +7,13 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "sdkconfig.h"
 #include "usb/usb_host.h"
 #include "usb/uvc_host.h"
 #include "uvc_types_priv.h"
 
+#ifndef CONFIG_UVC_HOST_MINIMAL
+
 #define TERMINAL_INPUT_CAMERA_TYPE      0x0201
 #define TERMINAL_INPUT_COMPOSITE_TYPE   0x0401
 #define ITT_MEDIA_TRANSPORT_INPUT       0x0202
@@ -392,3 +395,9 @@ void uvc_host_desc_print(uvc_host_stream_hdl_t stream_hdl)
     usb_print_device_descriptor(device_desc);
     usb_print_config_descriptor(config_desc, &uvc_print_desc);
 }
+#else
+void uvc_host_desc_print(uvc_host_stream_hdl_t stream_hdl)
+{
+    assert(stream_hdl);
+}
+#endif // CONFIG_UVC_HOST_MINIMAL
@@ -9,41 +9,280 @@
 
 #include "esp_check.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include "usb/uvc_host.h"
 #include "uvc_frame_priv.h"
+#include "uvc_nal_priv.h"
 #include "uvc_types_priv.h"
 #include "uvc_check_priv.h"
-
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "uvc_critical_priv.h"
+#include "uvc_trace_priv.h"
 
 static const char *TAG = "uvc-frame";
 
+#define UVC_FRAME_ADAPTIVE_ALIGN (4 * 1024) // Adaptive frame buffers grow in multiples of this size
+#define UVC_FRAME_ADAPTIVE_HEADROOM (4)     // Adaptive frame buffers are larger than the largest received frame by 1/n of its size
+
+/**
+ * @brief Frame buffer of the stream's frame pool
+ *
+ * The user gets pointer to the public part. Index of the frame in the pool is needed to return it without a lock.
+ */
+typedef struct {
+    uvc_host_frame_t frame; // Must be first: Frame buffers are passed to the user by reference
+    uint8_t index;          // Bit of this frame buffer in free_frames mask
+    uint32_t refs;          // References held by the driver, the user and subscribers. 0: The frame buffer is free
+} uvc_frame_buf_t;
+
+/**
+ * @brief Shared frame pool
+ *
+ * Slabs of equal size in one memory block. Streams take them for their frame buffers, free slabs are kept on a stack
+ * protected by uvc_lock.
+ */
+struct uvc_frame_slab_pool_s {
+    uint8_t *memory;        // All slabs
+    size_t slab_size;       // Size of one slab
+    int num_slabs;          // Number of slabs in memory
+    int num_free;           // Number of slabs on the free stack
+    uint8_t *free_slabs[];  // Stack of free slabs
+};
+
+/**
+ * @brief Take a slab from shared frame pool
+ *
+ * @param[in] pool Shared frame pool
+ * @return Slab, NULL if the pool is empty
+ */
+static uint8_t *uvc_frame_slab_take(uvc_frame_slab_pool_t *pool)
+{
+    uint8_t *slab = NULL;
+    UVC_ENTER_CRITICAL();
+    if (pool->num_free > 0) {
+        slab = pool->free_slabs[--pool->num_free];
+    }
+    UVC_EXIT_CRITICAL();
+    return slab;
+}
+
+/**
+ * @brief Put a slab back to shared frame pool
+ *
+ * @param[in] pool Shared frame pool
+ * @param[in] slab Slab from uvc_frame_slab_take()
+ */
+static void uvc_frame_slab_give(uvc_frame_slab_pool_t *pool, uint8_t *slab)
+{
+    UVC_ENTER_CRITICAL();
+    assert(pool->num_free < pool->num_slabs);
+    pool->free_slabs[pool->num_free++] = slab;
+    UVC_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Check that frame buffer belongs to the stream's pool
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @return true if the frame buffer belongs to the stream
+ */
+static inline bool uvc_frame_is_own(const uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    const uvc_frame_buf_t *frame_buf = (const uvc_frame_buf_t *)frame;
+    return frame_buf->index < uvc_stream->constant.num_of_frames && uvc_stream->constant.frames[frame_buf->index] == frame;
+}
+
+/**
+ * @brief Return frame buffer to the stream's pool
+ *
+ * Drops one reference, the frame buffer is put back to the pool with the last one.
+ *
+ * @param[in] uvc_stream   UVC stream
+ * @param[in] frame        Frame buffer
+ * @param[in] release_slab Put slab of shared frame pool back, unless this frame buffer is reserved
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: The frame buffer does not belong to this stream
+ *     - ESP_FAIL: The frame buffer was already returned
+ */
+static esp_err_t uvc_frame_return(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, bool release_slab)
+{
+    UVC_CHECK(uvc_frame_is_own(uvc_stream, frame), ESP_ERR_INVALID_ARG);
+    uvc_frame_buf_t *frame_buf = (uvc_frame_buf_t *)frame;
+
+    // Acquire-release: writes of other consumers to the frame must be done before it is reset
+    uint32_t refs = __atomic_load_n(&frame_buf->refs, __ATOMIC_RELAXED);
+    do {
+        UVC_CHECK(refs > 0, ESP_FAIL); // This frame was already returned
+    } while (!__atomic_compare_exchange_n(&frame_buf->refs, &refs, refs - 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    if (refs > 1) {
+        return ESP_OK; // Other consumers still hold the frame
+    }
+
+    uvc_frame_reset(frame);
+    uvc_frame_slab_pool_t *pool = uvc_stream->constant.slab_pool;
+    if (release_slab && pool && frame->data && frame_buf->index >= uvc_stream->constant.slab_pool_reserved) {
+        // Put the slab back now, so other streams can use it while this frame buffer is free
+        uvc_frame_slab_give(pool, frame->data);
+        frame->data = NULL;
+        frame->data_buffer_len = 0;
+    }
+
+    // Release store: Reset of the frame must be visible before the frame can be taken by uvc_frame_get_empty()
+    const uint32_t frame_bit = 1UL << frame_buf->index;
+    const uint32_t free_frames = __atomic_fetch_or(&uvc_stream->dynamic.free_frames, frame_bit, __ATOMIC_RELEASE);
+    UVC_CHECK(!(free_frames & frame_bit), ESP_FAIL); // This frame was already returned
+    return ESP_OK;
+}
+
 esp_err_t uvc_host_frame_return(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame)
+{
+    UVC_CHECK(stream_hdl && frame, ESP_ERR_INVALID_ARG);
+    return uvc_frame_return((uvc_stream_t *)stream_hdl, frame, true);
+}
+
+esp_err_t uvc_host_frame_unref(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame)
+{
+    return uvc_host_frame_return(stream_hdl, frame);
+}
+
+esp_err_t uvc_host_frame_ref(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame)
 {
     UVC_CHECK(stream_hdl && frame, ESP_ERR_INVALID_ARG);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
-    uvc_frame_reset(frame);
-    BaseType_t result = xQueueSend(uvc_stream->constant.empty_fb_queue, &frame, 0);
-    UVC_CHECK(pdPASS == result, ESP_FAIL);
+    UVC_CHECK(uvc_frame_is_own(uvc_stream, frame), ESP_ERR_INVALID_ARG);
+    uvc_frame_buf_t *frame_buf = (uvc_frame_buf_t *)frame;
+
+    // A free frame buffer must not be revived, it can be taken by uvc_frame_get_empty() concurrently
+    uint32_t refs = __atomic_load_n(&frame_buf->refs, __ATOMIC_RELAXED);
+    do {
+        UVC_CHECK(refs > 0, ESP_ERR_INVALID_STATE);
+    } while (!__atomic_compare_exchange_n(&frame_buf->refs, &refs, refs + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_frame_subscribe(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_subscriber_cb_t cb, void *user_ctx)
+{
+    UVC_CHECK(stream_hdl && cb, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    UVC_CHECK(uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_CALLBACK, ESP_ERR_INVALID_STATE);
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    UVC_ENTER_CRITICAL();
+    for (int i = 0; i < UVC_HOST_FRAME_SUBSCRIBERS_MAX; i++) {
+        if (uvc_stream->subscribers[i].cb == NULL) {
+            uvc_stream->subscribers[i].cb = cb;
+            uvc_stream->subscribers[i].user_ctx = user_ctx;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    UVC_EXIT_CRITICAL();
+    return ret;
+}
+
+esp_err_t uvc_host_frame_unsubscribe(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_subscriber_cb_t cb, void *user_ctx)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    UVC_ENTER_CRITICAL();
+    for (int i = 0; i < UVC_HOST_FRAME_SUBSCRIBERS_MAX; i++) {
+        if (uvc_stream->subscribers[i].cb == cb && uvc_stream->subscribers[i].user_ctx == user_ctx) {
+            uvc_stream->subscribers[i].cb = NULL;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    UVC_EXIT_CRITICAL();
+    return ret;
+}
+
+/**
+ * @brief Pass complete frame to all subscribers
+ *
+ * The list is copied under uvc_lock, the callbacks are called without it. The driver's reference keeps the frame valid meanwhile.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Complete frame
+ */
+static void uvc_frame_subscribers_notify(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    __typeof__(uvc_stream->subscribers) subscribers;
+    UVC_ENTER_CRITICAL();
+    memcpy(subscribers, uvc_stream->subscribers, sizeof(subscribers));
+    UVC_EXIT_CRITICAL();
+
+    for (int i = 0; i < UVC_HOST_FRAME_SUBSCRIBERS_MAX; i++) {
+        if (subscribers[i].cb) {
+            UVC_TRACE(CB_ENTER, NULL);
+            UVC_CLASS_STATS_CB_ENTER(uvc_stream);
+            subscribers[i].cb(uvc_stream, frame, subscribers[i].user_ctx);
+            UVC_CLASS_STATS_CB_EXIT(uvc_stream);
+            UVC_TRACE(CB_EXIT, NULL);
+        }
+    }
+}
+
+void uvc_frame_return_current(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    uvc_frame_return(uvc_stream, frame, false);
+}
+
+esp_err_t uvc_host_frame_get_latest(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t **frame_ret, int timeout)
+{
+    UVC_CHECK(stream_hdl && frame_ret, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    UVC_CHECK(uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_LATEST, ESP_ERR_INVALID_STATE);
+
+    // The semaphore can be given for a frame that was already taken (or reclaimed), so we check the slot after every wake-up
+    const TickType_t start = xTaskGetTickCount();
+    while (true) {
+        uvc_host_frame_t *frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.latest_frame, NULL);
+        if (frame) {
+            *frame_ret = frame;
+            return ESP_OK;
+        }
+        const TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= (TickType_t)timeout ||
+                xSemaphoreTake(uvc_stream->constant.latest_frame_sem, (TickType_t)timeout - elapsed) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+esp_err_t uvc_host_frame_acquire(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t **frame_ret, int timeout)
+{
+    UVC_CHECK(stream_hdl && frame_ret, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    UVC_CHECK(uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_ACQUIRE, ESP_ERR_INVALID_STATE);
+
+    if (xQueueReceive(uvc_stream->constant.frame_queue, frame_ret, (TickType_t)timeout) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
     return ESP_OK;
 }
 
 esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_size, uint32_t fb_caps)
 {
     UVC_CHECK(uvc_stream, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(nb_of_fb > 0 && nb_of_fb <= UVC_FRAME_POOL_MAX, ESP_ERR_INVALID_ARG);
     esp_err_t ret;
 
     // We will be passing the frame buffers by reference
-    uvc_stream->constant.empty_fb_queue = xQueueCreate(nb_of_fb, sizeof(uvc_host_frame_t *));
-    UVC_CHECK(uvc_stream->constant.empty_fb_queue, ESP_ERR_NO_MEM);
+    uvc_stream->constant.frames = calloc(nb_of_fb, sizeof(uvc_host_frame_t *));
+    UVC_CHECK(uvc_stream->constant.frames, ESP_ERR_NO_MEM);
+    uvc_stream->constant.num_of_frames = 0;
+    if (fb_caps == 0) {
+        fb_caps = MALLOC_CAP_DEFAULT; // In case the user did not fill the config, set it to default
+    }
     for (int i = 0; i < nb_of_fb; i++) {
         // Allocate the frame buffer
-        uvc_host_frame_t *this_fb = malloc(sizeof(uvc_host_frame_t));
-        if (fb_caps == 0) {
-            fb_caps = MALLOC_CAP_DEFAULT; // In case the user did not fill the config, set it to default
-        }
+        uvc_frame_buf_t *this_fb = malloc(sizeof(uvc_frame_buf_t));
         uint8_t *this_data = heap_caps_malloc(fb_size, fb_caps);
         if (this_data == NULL || this_fb == NULL) {
             free(this_fb);
@@ -54,14 +293,65 @@ esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_s
         }
 
         // Set members to default
-        this_fb->data = this_data;
-        this_fb->data_buffer_len = fb_size;
-        this_fb->data_len = 0;
+        this_fb->frame.data = this_data;
+        this_fb->frame.data_buffer_len = fb_size;
+        this_fb->frame.data_len = 0;
+        this_fb->index = i;
+        this_fb->refs = 0;
+        uvc_stream->constant.frames[i] = &this_fb->frame;
+        uvc_stream->constant.num_of_frames++;
+        USB_CLASS_STATS_MEM_ALLOC(uvc_stream->constant.class_stats, sizeof(uvc_frame_buf_t), MALLOC_CAP_DEFAULT);
+        USB_CLASS_STATS_MEM_ALLOC(uvc_stream->constant.class_stats, fb_size, fb_caps);
+    }
+
+    // All frames are free
+    const uint32_t all_frames = (nb_of_fb == UVC_FRAME_POOL_MAX) ? UINT32_MAX : ((1UL << nb_of_fb) - 1);
+    __atomic_store_n(&uvc_stream->dynamic.free_frames, all_frames, __ATOMIC_RELEASE);
+    return ESP_OK;
 
-        // Add the frame to Queue of empty frames
-        const BaseType_t result = xQueueSend(uvc_stream->constant.empty_fb_queue, &this_fb, 0);
-        assert(pdPASS == result);
+err:
+    uvc_frame_free(uvc_stream);
+    return ret;
+}
+
+esp_err_t uvc_frame_allocate_shared(uvc_stream_t *uvc_stream, uvc_frame_slab_pool_t *pool, int nb_of_fb, int nb_reserved)
+{
+    UVC_CHECK(uvc_stream && pool, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(nb_of_fb > 0 && nb_of_fb <= UVC_FRAME_POOL_MAX, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(nb_reserved >= 0 && nb_reserved <= nb_of_fb, ESP_ERR_INVALID_ARG);
+    esp_err_t ret;
+
+    uvc_stream->constant.frames = calloc(nb_of_fb, sizeof(uvc_host_frame_t *));
+    UVC_CHECK(uvc_stream->constant.frames, ESP_ERR_NO_MEM);
+    uvc_stream->constant.num_of_frames = 0;
+    uvc_stream->constant.slab_pool = pool;
+    uvc_stream->constant.slab_pool_reserved = nb_reserved;
+    for (int i = 0; i < nb_of_fb; i++) {
+        uvc_frame_buf_t *this_fb = calloc(1, sizeof(uvc_frame_buf_t));
+        if (this_fb == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            goto err;
+        }
+        this_fb->index = i;
+        uvc_stream->constant.frames[i] = &this_fb->frame;
+        uvc_stream->constant.num_of_frames++;
+        USB_CLASS_STATS_MEM_ALLOC(uvc_stream->constant.class_stats, sizeof(uvc_frame_buf_t), MALLOC_CAP_DEFAULT); // Slabs belong to the driver
+
+        // Reserved frame buffers get their slab now, others when they are needed
+        if (i < nb_reserved) {
+            this_fb->frame.data = uvc_frame_slab_take(pool);
+            if (this_fb->frame.data == NULL) {
+                ret = ESP_ERR_NO_MEM;
+                ESP_LOGE(TAG, "Not enough free frame buffers in shared frame pool for %d reserved", nb_reserved);
+                goto err;
+            }
+            this_fb->frame.data_buffer_len = pool->slab_size;
+        }
     }
+
+    // All frames are free
+    const uint32_t all_frames = (nb_of_fb == UVC_FRAME_POOL_MAX) ? UINT32_MAX : ((1UL << nb_of_fb) - 1);
+    __atomic_store_n(&uvc_stream->dynamic.free_frames, all_frames, __ATOMIC_RELEASE);
     return ESP_OK;
 
 err:
@@ -71,55 +361,535 @@ err:
 
 void uvc_frame_free(uvc_stream_t *uvc_stream)
 {
-    if (!uvc_stream || !uvc_stream->constant.empty_fb_queue) {
+    if (!uvc_stream || !uvc_stream->constant.frames) {
         return;
     }
 
-    // Free all Frame Buffers and the Queue itself
-    uvc_host_frame_t *this_fb;
-    while (xQueueReceive(uvc_stream->constant.empty_fb_queue, &this_fb, 0) == pdPASS) {
-        free(this_fb->data);
+    // Free all Frame Buffers and the pool itself
+    uvc_frame_slab_pool_t *pool = uvc_stream->constant.slab_pool;
+    const uint32_t caps = uvc_stream->constant.frame_heap_caps ? uvc_stream->constant.frame_heap_caps : MALLOC_CAP_DEFAULT;
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_frames; i++) {
+        uvc_host_frame_t *this_fb = uvc_stream->constant.frames[i];
+        if (pool) {
+            if (this_fb->data) {
+                uvc_frame_slab_give(pool, this_fb->data);
+            }
+        } else {
+            USB_CLASS_STATS_MEM_FREE(uvc_stream->constant.class_stats, this_fb->data_buffer_len, caps);
+            free(this_fb->data);
+        }
+        USB_CLASS_STATS_MEM_FREE(uvc_stream->constant.class_stats, sizeof(uvc_frame_buf_t), MALLOC_CAP_DEFAULT);
         free(this_fb);
     }
-    vQueueDelete(uvc_stream->constant.empty_fb_queue);
-    uvc_stream->constant.empty_fb_queue = NULL;
+    free(uvc_stream->constant.frames);
+    uvc_stream->constant.frames = NULL;
+    uvc_stream->constant.num_of_frames = 0;
+    uvc_stream->constant.slab_pool = NULL;
+    uvc_stream->constant.slab_pool_reserved = 0;
+    __atomic_store_n(&uvc_stream->dynamic.free_frames, 0, __ATOMIC_RELAXED);
+}
+
+esp_err_t uvc_frame_pool_create(int num_slabs, size_t slab_size, uint32_t heap_caps, uvc_frame_slab_pool_t **pool_ret)
+{
+    UVC_CHECK(pool_ret && num_slabs > 0 && slab_size > 0, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(slab_size <= SIZE_MAX / num_slabs, ESP_ERR_INVALID_ARG);
+    if (heap_caps == 0) {
+        heap_caps = MALLOC_CAP_DEFAULT;
+    }
+
+    uvc_frame_slab_pool_t *pool = calloc(1, sizeof(uvc_frame_slab_pool_t) + num_slabs * sizeof(uint8_t *));
+    UVC_CHECK(pool, ESP_ERR_NO_MEM);
+    pool->memory = heap_caps_malloc(num_slabs * slab_size, heap_caps);
+    if (pool->memory == NULL) {
+        ESP_LOGE(TAG, "Not enough memory for shared frame pool %d x %zu", num_slabs, slab_size);
+        free(pool);
+        return ESP_ERR_NO_MEM;
+    }
+    pool->slab_size = slab_size;
+    pool->num_slabs = num_slabs;
+    pool->num_free = num_slabs;
+    for (int i = 0; i < num_slabs; i++) {
+        pool->free_slabs[i] = pool->memory + (size_t)(num_slabs - 1 - i) * slab_size; // Lowest slab on top
+    }
+    *pool_ret = pool;
+    return ESP_OK;
+}
+
+void uvc_frame_pool_delete(uvc_frame_slab_pool_t *pool)
+{
+    if (pool) {
+        assert(pool->num_free == pool->num_slabs); // All streams must be closed
+        free(pool->memory);
+        free(pool);
+    }
+}
+
+void uvc_frame_pool_trim(uvc_stream_t *uvc_stream)
+{
+    uvc_frame_slab_pool_t *pool = uvc_stream->constant.slab_pool;
+    if (!pool) {
+        return;
+    }
+
+    // Take all free frame buffers that are not reserved, so they cannot be taken while we release their slabs
+    const unsigned reserved = uvc_stream->constant.slab_pool_reserved;
+    const uint32_t not_reserved = (reserved >= UVC_FRAME_POOL_MAX) ? 0 : ~((1UL << reserved) - 1);
+    const uint32_t taken = __atomic_fetch_and(&uvc_stream->dynamic.free_frames, ~not_reserved, __ATOMIC_ACQUIRE) & not_reserved;
+    for (uint32_t frames = taken; frames; frames &= frames - 1) {
+        uvc_host_frame_t *frame = uvc_stream->constant.frames[__builtin_ctz(frames)];
+        if (frame->data) {
+            uvc_frame_slab_give(pool, frame->data);
+            frame->data = NULL;
+            frame->data_buffer_len = 0;
+        }
+    }
+    __atomic_fetch_or(&uvc_stream->dynamic.free_frames, taken, __ATOMIC_RELEASE);
 }
 
 bool uvc_frame_are_all_returned(uvc_stream_t *uvc_stream)
 {
     UVC_CHECK(uvc_stream, false);
-    UVC_CHECK(uvc_stream->constant.empty_fb_queue, false);
+    if (uvc_stream->constant.frames == NULL) {
+        return true; // No frame buffers in zero-copy mode
+    }
 
     // In case the user returns 'false' from uvc_host_frame_callback_t, he must return the frame buffers with uvc_host_frame_return()
-    // Here we check whether all allocated frame buffers are in the 'empty_fb_queue'
-    const UBaseType_t uxSpacesAvailable = uxQueueSpacesAvailable(uvc_stream->constant.empty_fb_queue);
-    return (uxSpacesAvailable == 0);
+    // Here we check whether all allocated frame buffers are marked free
+    const unsigned num_of_frames = uvc_stream->constant.num_of_frames;
+    const uint32_t all_frames = (num_of_frames == UVC_FRAME_POOL_MAX) ? UINT32_MAX : ((1UL << num_of_frames) - 1);
+    return (__atomic_load_n(&uvc_stream->dynamic.free_frames, __ATOMIC_ACQUIRE) == all_frames);
+}
+
+/**
+ * @brief Get size of adaptive frame buffer that can hold required bytes
+ *
+ * Received frames can vary in size (e.g. MJPEG), so some headroom above the largest received frame is added.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] required   Number of bytes the frame buffer must hold
+ * @return New size of frame buffer. Smaller than required if the limit of the stream is reached
+ */
+static size_t uvc_frame_adaptive_size(const uvc_stream_t *uvc_stream, size_t required)
+{
+    const size_t peak = uvc_stream->single_thread.frame_size_peak;
+    size_t size = (required > peak) ? required : peak;
+    size += size / UVC_FRAME_ADAPTIVE_HEADROOM;
+    size = (size + UVC_FRAME_ADAPTIVE_ALIGN - 1) & ~(size_t)(UVC_FRAME_ADAPTIVE_ALIGN - 1);
+
+    const size_t size_max = uvc_stream->constant.frame_size_max;
+    if (size_max && size > size_max) {
+        size = size_max;
+    }
+    return size;
+}
+
+/**
+ * @brief Change size of frame buffer
+ *
+ * Data already in the frame buffer are kept. The frame buffer is not changed on failure.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @param[in] size       New size of the frame buffer
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+static esp_err_t uvc_frame_resize(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, size_t size)
+{
+    const uint32_t caps = uvc_stream->constant.frame_heap_caps ? uvc_stream->constant.frame_heap_caps : MALLOC_CAP_DEFAULT;
+    uint8_t *data;
+    if (frame->data_len == 0) {
+        // Nothing to copy. Allocate new buffer first, so we keep the old one on failure
+        data = heap_caps_malloc(size, caps);
+        if (data) {
+            free(frame->data);
+        }
+    } else {
+        data = heap_caps_realloc(frame->data, size, caps);
+    }
+    if (data == NULL) {
+        ESP_LOGW(TAG, "Not enough memory for frame buffer %zu", size);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGD(TAG, "Frame buffer resized %zu -> %zu", frame->data_buffer_len, size);
+    USB_CLASS_STATS_MEM_FREE(uvc_stream->constant.class_stats, frame->data_buffer_len, caps);
+    USB_CLASS_STATS_MEM_ALLOC(uvc_stream->constant.class_stats, size, caps);
+    frame->data = data;
+    frame->data_buffer_len = size;
+    return ESP_OK;
 }
 
 uvc_host_frame_t *uvc_frame_get_empty(uvc_stream_t *uvc_stream)
 {
     UVC_CHECK(uvc_stream, NULL);
-    uvc_host_frame_t *this_fb;
-    if (xQueueReceive(uvc_stream->constant.empty_fb_queue, &this_fb, 0) == pdPASS) {
-        return this_fb;
-    } else {
-        return NULL;
+
+    // Take the lowest free frame. The CAS only fails if a frame was returned (or taken) concurrently, then we try again
+    // with the updated mask. Acquire pairs with the release in uvc_host_frame_return()
+    uint32_t free_frames = __atomic_load_n(&uvc_stream->dynamic.free_frames, __ATOMIC_ACQUIRE);
+    uint32_t no_slab = 0; // Free frames without slab, while the shared frame pool is empty
+    while (free_frames & ~no_slab) {
+        const unsigned index = __builtin_ctz(free_frames & ~no_slab);
+        if (__atomic_compare_exchange_n(&uvc_stream->dynamic.free_frames, &free_frames, free_frames & ~(1UL << index),
+                                        true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            uvc_host_frame_t *frame = uvc_stream->constant.frames[index];
+            __atomic_store_n(&((uvc_frame_buf_t *)frame)->refs, 1, __ATOMIC_RELAXED); // Reference of the driver, passed to the user with the frame
+            uvc_frame_reset(frame); // ISOC processing can append a few packets to the frame after uvc_host_stream_pause() returned it
+            if (frame->data == NULL) {
+                // Shared frame pool: this frame buffer is not reserved, take a slab for it
+                frame->data = uvc_frame_slab_take(uvc_stream->constant.slab_pool);
+                if (frame->data == NULL) {
+                    // Pool is empty. Return the frame buffer, other free ones might still have a slab
+                    __atomic_store_n(&((uvc_frame_buf_t *)frame)->refs, 0, __ATOMIC_RELAXED);
+                    no_slab |= 1UL << index;
+                    free_frames = __atomic_or_fetch(&uvc_stream->dynamic.free_frames, 1UL << index, __ATOMIC_ACQ_REL);
+                    continue;
+                }
+                frame->data_buffer_len = uvc_stream->constant.slab_pool->slab_size;
+            }
+            if (uvc_stream->constant.adaptive_frame_size && frame->data_buffer_len < uvc_stream->single_thread.frame_size_peak) {
+                // Grow the buffer now, while it is empty, rather than in the middle of the frame.
+                // On failure we try again with data from uvc_frame_add_data()
+                const size_t size = uvc_frame_adaptive_size(uvc_stream, 0);
+                if (size > frame->data_buffer_len) {
+                    uvc_frame_resize(uvc_stream, frame, size);
+                }
+            }
+            return frame;
+        }
+    }
+
+    // Latest frame policy: the newest complete frame is older than the frame that is starting now, reuse it
+    if (uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_LATEST) {
+        uvc_host_frame_t *frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.latest_frame, NULL);
+        if (frame) {
+            uvc_frame_reset(frame);
+            UVC_ATOMIC_ADD(uvc_stream->stats.frames_overwritten, 1);
+            return frame;
+        }
+    }
+    return NULL;
+}
+
+bool uvc_frame_pass_to_user(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    if (uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_LATEST) {
+        uvc_host_frame_t *older = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.latest_frame, frame);
+        if (older) {
+            uvc_host_frame_return(uvc_stream, older);
+            UVC_ATOMIC_ADD(uvc_stream->stats.frames_overwritten, 1);
+        }
+        if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+            // Paused before it could see the published frame, see uvc_frame_set_current()
+            uvc_frame_latest_release(uvc_stream);
+        }
+        xSemaphoreGive(uvc_stream->constant.latest_frame_sem);
+        return false; // The frame is returned by the user after uvc_host_frame_get_latest(), or when it is replaced
+    }
+    if (uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_ACQUIRE) {
+        // The queue can hold all frames of the pool, so this never fails
+        xQueueSend(uvc_stream->constant.frame_queue, &frame, 0);
+        USB_CLASS_STATS_QUEUE(uvc_stream->constant.class_stats, uxQueueMessagesWaiting(uvc_stream->constant.frame_queue));
+        if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+            uvc_frame_queue_release(uvc_stream); // Paused before it could see the queued frame
+        }
+        return false; // The frame is returned by the user after uvc_host_frame_acquire()
+    }
+    // Subscribers first: if frame_cb keeps the frame, it can be returned from another task at any time
+    uvc_frame_subscribers_notify(uvc_stream, frame);
+    if (uvc_stream->constant.frame_cb) {
+        UVC_TRACE(CB_ENTER, NULL);
+        UVC_CLASS_STATS_CB_ENTER(uvc_stream);
+        const bool frame_processed = uvc_stream->constant.frame_cb(frame, uvc_stream->constant.cb_arg);
+        UVC_CLASS_STATS_CB_EXIT(uvc_stream);
+        UVC_TRACE(CB_EXIT, NULL);
+        return frame_processed;
+    }
+    return true;
+}
+
+void uvc_frame_latest_release(uvc_stream_t *uvc_stream)
+{
+    uvc_host_frame_t *frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.latest_frame, NULL);
+    if (frame) {
+        uvc_host_frame_return(uvc_stream, frame);
+    }
+}
+
+void uvc_frame_queue_release(uvc_stream_t *uvc_stream)
+{
+    if (!uvc_stream->constant.frame_queue) {
+        return;
+    }
+    uvc_host_frame_t *frame;
+    while (xQueueReceive(uvc_stream->constant.frame_queue, &frame, 0) == pdTRUE) {
+        uvc_host_frame_return(uvc_stream, frame);
+    }
+}
+
+void uvc_frame_set_current(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    // Only the processing thread sets current_frame, uvc_host_stream_pause() can clear it concurrently.
+    // If the stream was paused before it could see the new frame, it is our job to return it
+    UVC_ATOMIC_STORE(uvc_stream->dynamic.current_frame, frame);
+    if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+        uvc_host_frame_t *current_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+        if (current_frame) {
+            uvc_host_frame_return(uvc_stream, current_frame);
+        }
+    }
+}
+
+esp_err_t uvc_frame_reserve(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, size_t data_len)
+{
+    const size_t required = frame->data_len + data_len;
+    if (required > frame->data_buffer_len) {
+        UVC_CHECK(uvc_stream->constant.adaptive_frame_size, ESP_ERR_INVALID_SIZE);
+        const size_t size = uvc_frame_adaptive_size(uvc_stream, required);
+        UVC_CHECK(size >= required, ESP_ERR_INVALID_SIZE);
+        UVC_CHECK(uvc_frame_resize(uvc_stream, frame, size) == ESP_OK, ESP_ERR_INVALID_SIZE);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uvc_frame_roi_set(uvc_stream_t *uvc_stream, const uvc_host_roi_t *roi, const uvc_host_stream_format_t *vs_format)
+{
+    if (roi->width == 0) {
+        uvc_stream->constant.roi.window = *roi;
+        uvc_stream->constant.roi.row_len = 0;
+        return ESP_OK;
+    }
+    const size_t bytes_per_pixel = 2; // YUY2 is the only uncompressed format, 4 bytes per 2 pixels
+    UVC_CHECK(vs_format->format == UVC_VS_FORMAT_YUY2, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(roi->x % 2 == 0 && roi->width % 2 == 0 && roi->height > 0, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(roi->x + roi->width <= vs_format->h_res && roi->y + roi->height <= vs_format->v_res, ESP_ERR_INVALID_ARG);
+
+    uvc_stream->constant.roi.window = *roi;
+    uvc_stream->constant.roi.stride = vs_format->h_res * bytes_per_pixel;
+    uvc_stream->constant.roi.row_offset = roi->x * bytes_per_pixel;
+    uvc_stream->constant.roi.row_len = roi->width * bytes_per_pixel;
+    return ESP_OK;
+}
+
+size_t uvc_frame_roi_size(const uvc_stream_t *uvc_stream)
+{
+    return uvc_stream->constant.roi.row_len * uvc_stream->constant.roi.window.height;
+}
+
+/**
+ * @brief Add bytes of received data that are inside region of interest
+ *
+ * Position of the data in the full frame is tracked in roi_offset. Parts of rows inside the window are copied,
+ * the rest is skipped without touching it.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @param[in] data       Pointer to data
+ * @param[in] data_len   Data length in bytes
+ * @return
+ *     - ESP_OK: Data added to the frame buffer
+ *     - ESP_ERR_INVALID_SIZE: Frame buffer overflow
+ */
+static esp_err_t uvc_frame_add_data_roi(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
+{
+    const size_t stride = uvc_stream->constant.roi.stride;
+    const size_t row_start = uvc_stream->constant.roi.row_offset;
+    const size_t row_end = row_start + uvc_stream->constant.roi.row_len;
+    const size_t roi_start = uvc_stream->constant.roi.window.y * stride + row_start;
+    const size_t roi_end = (uvc_stream->constant.roi.window.y + uvc_stream->constant.roi.window.height - 1) * stride + row_end;
+
+    const size_t data_start = uvc_stream->single_thread.roi_offset;
+    const size_t data_end = data_start + data_len;
+    uvc_stream->single_thread.roi_offset = data_end;
+
+    size_t pos = (data_start > roi_start) ? data_start : roi_start;
+    const size_t end = (data_end < roi_end) ? data_end : roi_end;
+    while (pos < end) {
+        const size_t column = pos % stride;
+        if (column < row_start) {
+            pos += row_start - column;
+            continue;
+        }
+        if (column >= row_end) {
+            pos += stride - column + row_start;
+            continue;
+        }
+        const size_t run = (row_end - column < end - pos) ? row_end - column : end - pos;
+        UVC_CHECK(uvc_frame_reserve(uvc_stream, frame, run) == ESP_OK, ESP_ERR_INVALID_SIZE);
+        memcpy(frame->data + frame->data_len, data + (pos - data_start), run);
+        frame->data_len += run;
+        pos += run;
     }
+    return ESP_OK;
 }
 
-esp_err_t uvc_frame_add_data(uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
+esp_err_t uvc_frame_add_data(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
 {
     if (data_len == 0) {
         return ESP_OK; // Fast return in case of zero data
     }
     UVC_CHECK(frame && data, ESP_ERR_INVALID_ARG);
-    UVC_CHECK(frame->data_len + data_len <= frame->data_buffer_len, ESP_ERR_INVALID_SIZE);
+    if (uvc_stream->constant.roi.row_len) {
+        return uvc_frame_add_data_roi(uvc_stream, frame, data, data_len);
+    }
+    UVC_CHECK(uvc_frame_reserve(uvc_stream, frame, data_len) == ESP_OK, ESP_ERR_INVALID_SIZE);
 
     memcpy(frame->data + frame->data_len, data, data_len);
     frame->data_len += data_len;
     return ESP_OK;
 }
 
+void uvc_frame_info_start(uvc_stream_t *uvc_stream)
+{
+    uvc_host_frame_info_t *info = &uvc_stream->single_thread.frame_info;
+    *info = (uvc_host_frame_info_t) {
+        .sequence = ++uvc_stream->single_thread.frame_sequence,
+        .clock_frequency = uvc_stream->constant.dwClockFrequency,
+        .sof_timestamp_us = esp_timer_get_time(),
+    };
+    uvc_stream->single_thread.roi_offset = 0;
+    uvc_nal_start(uvc_stream);
+}
+
+bool uvc_frame_decimate(uvc_stream_t *uvc_stream, const uvc_payload_header_t *payload_header)
+{
+    const unsigned decimation = uvc_stream->constant.frame_decimation;
+    if (decimation <= 1 || (uvc_stream->single_thread.frame_sequence - 1) % decimation == 0) {
+        return false;
+    }
+    if (payload_header->bmHeaderInfo.still_image) {
+        return false; // Still images were requested by the user
+    }
+    uvc_stream->single_thread.skip_current_frame = true;
+    UVC_ATOMIC_ADD(uvc_stream->stats.frames_decimated, 1);
+    return true;
+}
+
+void uvc_frame_info_parse_header(uvc_stream_t *uvc_stream, const uvc_payload_header_t *payload_header)
+{
+    uvc_host_frame_info_t *info = &uvc_stream->single_thread.frame_info;
+    if (payload_header->bmHeaderInfo.still_image) {
+        info->still_image = true;
+    }
+    if (info->scr_valid || !(payload_header->bmHeaderInfo.presentation_time || payload_header->bmHeaderInfo.source_clock_reference)) {
+        return; // Fast return: We already have both timestamps or there are none in this header
+    }
+
+    // Optional fields follow bmHeaderInfo: dwPresentationTime (4 bytes), then SCR (4 bytes STC + 2 bytes SOF counter)
+    // @see USB UVC specification ver 1.5, table 2-5
+    const uint8_t *field = (const uint8_t *)payload_header + sizeof(uvc_payload_header_t);
+    const uint8_t *header_end = (const uint8_t *)payload_header + payload_header->bHeaderLength;
+    if (payload_header->bmHeaderInfo.presentation_time) {
+        if (field + sizeof(uint32_t) > header_end) {
+            return; // Malformed header
+        }
+        if (!info->pts_valid) {
+            memcpy(&info->pts, field, sizeof(uint32_t));
+            info->pts_valid = true;
+        }
+        field += sizeof(uint32_t);
+    }
+    if (payload_header->bmHeaderInfo.source_clock_reference && field + sizeof(uint32_t) + sizeof(uint16_t) <= header_end) {
+        memcpy(&info->scr_stc, field, sizeof(uint32_t));
+        memcpy(&info->scr_sof, field + sizeof(uint32_t), sizeof(uint16_t));
+        info->scr_sof &= 0x07FF; // Bits 11..15 are reserved
+        info->scr_valid = true;
+    }
+}
+
+void uvc_frame_info_finish(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    uvc_host_frame_info_t *info = &uvc_stream->single_thread.frame_info;
+    info->eof_timestamp_us = esp_timer_get_time();
+    if (info->pts_valid && info->scr_valid && info->clock_frequency) {
+        // SCR was sampled when the first payload was formed, shortly before its reception at sof_timestamp_us.
+        // Time elapsed between capture (PTS) and SCR is subtracted from the reception time
+        const uint32_t capture_to_scr = info->scr_stc - info->pts; // Unsigned arithmetic handles wrap-around of device clock
+        info->capture_timestamp_us = info->sof_timestamp_us - (int64_t)((uint64_t)capture_to_scr * 1000000 / info->clock_frequency);
+    }
+    uvc_nal_finish(uvc_stream, frame);
+    frame->info = *info;
+    if (uvc_stream->constant.roi.row_len) {
+        uvc_host_stream_format_t *vs_format = (uvc_host_stream_format_t *)&frame->vs_format;
+        vs_format->h_res = uvc_stream->constant.roi.window.width;
+        vs_format->v_res = uvc_stream->constant.roi.window.height;
+    } else if (info->still_image && uvc_stream->constant.still.committed) {
+        uvc_host_stream_format_t *vs_format = (uvc_host_stream_format_t *)&frame->vs_format;
+        vs_format->h_res = uvc_stream->constant.still.h_res;
+        vs_format->v_res = uvc_stream->constant.still.v_res;
+    }
+
+    if (frame->data_len > uvc_stream->single_thread.frame_size_peak) {
+        uvc_stream->single_thread.frame_size_peak = frame->data_len;
+    }
+}
+
+void uvc_frame_slice_deliver(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame, bool end_of_frame)
+{
+    uvc_host_slice_callback_t slice_cb = uvc_stream->constant.slice_cb;
+    if (!slice_cb || !frame) {
+        return; // No frame after End of Frame, e.g. ISOC packets with EoF flag and no data
+    }
+    const size_t offset = uvc_stream->single_thread.slice_offset;
+    const size_t pending = frame->data_len - offset;
+    if (!end_of_frame && (pending == 0 || pending < uvc_stream->constant.slice_size)) {
+        return;
+    }
+
+    const uvc_host_slice_t slice = {
+        .frame = frame,
+        .data = frame->data + offset,
+        .data_len = pending,
+        .offset = offset,
+        .end_of_frame = end_of_frame,
+    };
+    uvc_stream->single_thread.slice_offset = end_of_frame ? 0 : frame->data_len;
+    UVC_TRACE(CB_ENTER, NULL);
+    UVC_CLASS_STATS_CB_ENTER(uvc_stream);
+    slice_cb(&slice, uvc_stream->constant.cb_arg);
+    UVC_CLASS_STATS_CB_EXIT(uvc_stream);
+    UVC_TRACE(CB_EXIT, NULL);
+}
+
+void uvc_frame_slice_drop(uvc_stream_t *uvc_stream)
+{
+    uvc_host_slice_callback_t slice_cb = uvc_stream->constant.slice_cb;
+    if (!slice_cb || uvc_stream->single_thread.slice_offset == 0) {
+        return;
+    }
+
+    const uvc_host_slice_t slice = {
+        .offset = uvc_stream->single_thread.slice_offset,
+        .frame_dropped = true,
+    };
+    uvc_stream->single_thread.slice_offset = 0;
+    slice_cb(&slice, uvc_stream->constant.cb_arg);
+}
+
+void uvc_frame_skip(uvc_stream_t *uvc_stream, uvc_frame_skip_reason_t reason)
+{
+    if (uvc_stream->single_thread.skip_current_frame) {
+        return; // Already skipped and counted
+    }
+    uvc_stream->single_thread.skip_current_frame = true;
+    if (reason != UVC_FRAME_SKIP_UNDERFLOW && UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame) == NULL) {
+        return; // No frame is being assembled, e.g. USB error between frames
+    }
+    switch (reason) {
+    case UVC_FRAME_SKIP_ERROR:     UVC_ATOMIC_ADD(uvc_stream->stats.skipped_error, 1); break;
+    case UVC_FRAME_SKIP_OVERFLOW:  UVC_ATOMIC_ADD(uvc_stream->stats.skipped_overflow, 1); break;
+    case UVC_FRAME_SKIP_UNDERFLOW: UVC_ATOMIC_ADD(uvc_stream->stats.skipped_underflow, 1); break;
+    default: assert(false);
+    }
+    USB_CLASS_STATS_DROP(uvc_stream->constant.class_stats, 1);
+}
+
+void uvc_frame_delivered(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    UVC_ATOMIC_ADD(uvc_stream->stats.frames_delivered, 1);
+    UVC_ATOMIC_ADD(uvc_stream->stats.bytes_delivered, frame->data_len);
+}
+
 void uvc_frame_reset(uvc_host_frame_t *frame)
 {
     assert(frame);
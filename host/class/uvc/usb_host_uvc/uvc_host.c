@@ -13,16 +13,23 @@
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 
 #include "usb/usb_host.h"
+#include "usb/usb_host_shared_client.h"
+#include "usb/usb_host_urb_pool.h"
+#include "usb/usb_dma_buf.h"
 #include "usb/uvc_host.h"
 #include "uvc_control.h"
+#include "uvc_control_priv.h"
 #include "uvc_stream.h"
 #include "uvc_types_priv.h"
 #include "uvc_frame_priv.h"
 #include "uvc_descriptors_priv.h"
+#include "uvc_negotiation_cache_priv.h"
 #include "uvc_check_priv.h"
 #include "uvc_critical_priv.h"
+#include "uvc_trace_priv.h"
 #include "uvc_idf_version_priv.h"
 
 #include "freertos/FreeRTOS.h"
@@ -41,19 +48,40 @@ portMUX_TYPE uvc_lock = portMUX_INITIALIZER_UNLOCKED;
 #define UVC_TEARDOWN          BIT1 // UVC is being uninstalled
 #define UVC_TEARDOWN_COMPLETE BIT2 // UVC uninstall finished
 
+// Automatic bandwidth mode
+#define UVC_AUTO_BANDWIDTH_HEADROOM (25)        // Percent of bandwidth reserved over frame size x fps
+#define UVC_AUTO_URB_SPAN_US        (1000)      // Minimum time covered by one ISOC URB
+#define UVC_AUTO_URB_QUEUE_US       (4000)      // Time covered by all ISOC URBs together
+#define UVC_AUTO_URB_MIN_COUNT      (3)         // Triple buffering
+#define UVC_AUTO_BULK_URB_MAX       (32 * 1024) // Upper limit for Bulk URB size
+
+// Adaptive frame size
+#define UVC_ADAPTIVE_FRAME_SIZE_DIV (8)         // Initial frame buffer size is dwMaxVideoFrameSize / n
+#define UVC_ADAPTIVE_FRAME_SIZE_MIN (16 * 1024) // Lower limit for initial frame buffer size
+
+#define UVC_COMMIT_TO_SET_INTERFACE_DELAY_MS (10) // Some cameras need delay between format Commit and SetInterface
+
 // Transfer callbacks
 static void ctrl_xfer_cb(usb_transfer_t *transfer);
 void isoc_transfer_callback(usb_transfer_t *transfer);
 void bulk_transfer_callback(usb_transfer_t *transfer);
+bool isoc_transfer_process(usb_transfer_t *transfer);
+bool bulk_transfer_process(usb_transfer_t *transfer);
+static void deferred_transfer_callback(usb_transfer_t *transfer);
+static esp_err_t uvc_stream_bw_reserve(uvc_stream_t *uvc_stream);
 
 // UVC driver object
 typedef struct {
     usb_host_client_handle_t usb_client_hdl; /*!< USB Host handle reused for all UVC devices in the system */
+    usb_host_shared_client_driver_handle_t shared_driver; /*!< Handle in the shared client, NULL if the driver has its own client */
     SemaphoreHandle_t open_close_mutex;      /*!< Protects list of opened devices from concurrent access */
     EventGroupHandle_t driver_status;        /*!< Holds status of the driver */
     usb_transfer_t *ctrl_transfer;           /*!< CTRL (endpoint 0) transfer */
     SemaphoreHandle_t ctrl_mutex;            /*!< CTRL mutex */
     SLIST_HEAD(list_dev, uvc_host_stream_s) uvc_stream_list;   /*!< List of open streams */
+    int driver_task_core;                    /*!< Core affinity of the driver's task */
+    unsigned stream_tasks[portNUM_PROCESSORS]; /*!< Number of automatically pinned processing tasks per core */
+    uvc_frame_slab_pool_t *frame_pool;       /*!< Frame buffers shared by streams. NULL if not configured */
 } uvc_host_driver_t;
 
 static uvc_host_driver_t *p_uvc_host_driver = NULL;
@@ -104,6 +132,9 @@ esp_err_t uvc_host_handle_events(unsigned long timeout)
     static bool called = false;
     uvc_host_driver_t *uvc_obj = UVC_ATOMIC_LOAD(p_uvc_host_driver); // Make local copy of the driver's handle
     UVC_CHECK(uvc_obj, ESP_ERR_INVALID_STATE);
+    if (uvc_obj->shared_driver) {
+        return usb_host_shared_client_handle_events(timeout);
+    }
 
     // We use this static variable so we don't have to call FreeRTOS API in every handling call
     if (!called) {
@@ -138,6 +169,180 @@ static void uvc_client_task(void *arg)
     vTaskDelete(NULL);
 }
 
+/**
+ * @brief Pass completed USB transfer to the stream's processing task
+ *
+ * @param[in] transfer Completed USB transfer
+ */
+static void deferred_transfer_callback(usb_transfer_t *transfer)
+{
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
+    UVC_TRACE(COMPLETE, transfer);
+    // The queue can hold all transfers of this stream, so this never fails
+    xQueueSend(uvc_stream->constant.xfer_queue, &transfer, 0);
+}
+
+/**
+ * @brief Stream's processing task
+ *
+ * Completed USB transfers are processed here and resubmitted. While one USB transfer is being processed,
+ * the spare transfer keeps the endpoint polled.
+ *
+ * @param[in] arg UVC stream
+ */
+static void uvc_stream_task(void *arg)
+{
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)arg;
+    usb_transfer_t *transfer;
+    while (xQueueReceive(uvc_stream->constant.xfer_queue, &transfer, portMAX_DELAY) == pdTRUE && transfer) {
+        const bool is_isoc = (transfer->num_isoc_packets > 0);
+        const bool resubmit = is_isoc ? isoc_transfer_process(transfer) : bulk_transfer_process(transfer);
+        if (resubmit) {
+            UVC_TRACE(RESUBMIT, transfer);
+            usb_host_transfer_submit(transfer); // Restart the transfer
+        }
+    }
+    xSemaphoreGive(uvc_stream->constant.task_exit);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Release core selected by uvc_stream_task_core_select()
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void uvc_stream_task_core_release(uvc_stream_t *uvc_stream)
+{
+    if (uvc_stream->constant.task_core >= 0) {
+        UVC_ENTER_CRITICAL();
+        p_uvc_host_driver->stream_tasks[uvc_stream->constant.task_core]--;
+        UVC_EXIT_CRITICAL();
+        uvc_stream->constant.task_core = -1;
+    }
+}
+
+/**
+ * @brief Select core for stream's processing task
+ *
+ * The core with least automatically pinned processing tasks is selected.
+ * On tie, a core that does not run the driver's task is preferred, so two streams do not share a core with USB events.
+ *
+ * @return Core ID
+ */
+static int uvc_stream_task_core_select(void)
+{
+    int core = 0;
+    UVC_ENTER_CRITICAL();
+    for (int i = 1; i < portNUM_PROCESSORS; i++) {
+        const unsigned tasks = p_uvc_host_driver->stream_tasks[i];
+        const unsigned best_tasks = p_uvc_host_driver->stream_tasks[core];
+        if (tasks < best_tasks || (tasks == best_tasks && core == p_uvc_host_driver->driver_task_core)) {
+            core = i;
+        }
+    }
+    p_uvc_host_driver->stream_tasks[core]++;
+    UVC_EXIT_CRITICAL();
+    return core;
+}
+
+/**
+ * @brief Start the stream's processing task
+ *
+ * @param[in] uvc_stream    UVC stream with allocated USB transfers
+ * @param[in] stream_config Stream configuration
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory for the task
+ */
+static esp_err_t uvc_stream_task_start(uvc_stream_t *uvc_stream, const uvc_host_stream_config_t *stream_config)
+{
+    uvc_stream->constant.task_core = -1;
+    int core_id = stream_config->processing_task.xCoreID;
+    if (core_id == UVC_HOST_TASK_CORE_AUTO) {
+        core_id = uvc_stream_task_core_select();
+        uvc_stream->constant.task_core = core_id;
+    }
+
+    // One more entry for the exit request
+    uvc_stream->constant.xfer_queue = xQueueCreate(uvc_stream->constant.num_of_xfers + 1, sizeof(usb_transfer_t *));
+    uvc_stream->constant.task_exit = xSemaphoreCreateBinary();
+    TaskHandle_t task_hdl = NULL;
+    if (uvc_stream->constant.xfer_queue && uvc_stream->constant.task_exit) {
+        xTaskCreatePinnedToCore(uvc_stream_task, "UVC stream", stream_config->processing_task.stack_size, uvc_stream,
+                                stream_config->processing_task.priority, &task_hdl, core_id);
+    }
+    if (task_hdl == NULL) {
+        if (uvc_stream->constant.xfer_queue) {
+            vQueueDelete(uvc_stream->constant.xfer_queue);
+            uvc_stream->constant.xfer_queue = NULL;
+        }
+        if (uvc_stream->constant.task_exit) {
+            vSemaphoreDelete(uvc_stream->constant.task_exit);
+            uvc_stream->constant.task_exit = NULL;
+        }
+        uvc_stream_task_core_release(uvc_stream);
+        return ESP_ERR_NO_MEM;
+    }
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
+        uvc_stream->constant.xfers[i]->callback = deferred_transfer_callback;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Stop the stream's processing task
+ *
+ * @note There can be no transfers in flight, at the moment of calling this function.
+ * @param[in] uvc_stream UVC stream
+ */
+static void uvc_stream_task_stop(uvc_stream_t *uvc_stream)
+{
+    if (uvc_stream->constant.xfer_queue == NULL) {
+        return; // URBs are processed in USB callback
+    }
+    usb_transfer_t *exit_request = NULL;
+    xQueueSend(uvc_stream->constant.xfer_queue, &exit_request, portMAX_DELAY);
+    xSemaphoreTake(uvc_stream->constant.task_exit, portMAX_DELAY);
+    vQueueDelete(uvc_stream->constant.xfer_queue);
+    vSemaphoreDelete(uvc_stream->constant.task_exit);
+    uvc_stream->constant.xfer_queue = NULL;
+    uvc_stream->constant.task_exit = NULL;
+    uvc_stream_task_core_release(uvc_stream);
+}
+
+/**
+ * @brief Drop completed USB transfers queued for the stream's processing task
+ *
+ * Transfers of a paused stream are not resubmitted. If they stayed in the queue, the processing task could
+ * resubmit them after uvc_host_stream_unpause() has already submitted them again.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void uvc_stream_task_flush(uvc_stream_t *uvc_stream)
+{
+    if (uvc_stream->constant.xfer_queue == NULL) {
+        return; // URBs are processed in USB callback
+    }
+    usb_transfer_t *transfer;
+    while (xQueueReceive(uvc_stream->constant.xfer_queue, &transfer, 0) == pdTRUE) {
+        assert(transfer); // Exit request is sent only by uvc_stream_task_stop()
+    }
+}
+
+/**
+ * @brief Set data buffer of a transfer
+ *
+ * Since data_buffer and data_buffer_size in usb_transfer_t are constant, we must cast away the const qualifier.
+ * The original buffer must be restored before the transfer is freed.
+ */
+static inline void uvc_transfer_set_buffer(usb_transfer_t *xfer, uint8_t *buffer, size_t size)
+{
+    uint8_t **buffer_ptr = (uint8_t **)(&(xfer->data_buffer));
+    size_t *buffer_size_ptr = (size_t *)(&(xfer->data_buffer_size));
+    *buffer_ptr = buffer;
+    *buffer_size_ptr = size;
+}
+
 /**
  * @brief Free USB transfers used by this device
  *
@@ -148,9 +353,22 @@ static void uvc_transfers_free(uvc_stream_t *uvc_stream)
 {
     assert(uvc_stream);
     for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
-        usb_host_transfer_free(uvc_stream->constant.xfers[i]);
+        usb_transfer_t *xfer = uvc_stream->constant.xfers[i];
+        if (uvc_stream->constant.urb_bufs && uvc_stream->constant.urb_bufs[i].data_buffer) {
+            USB_CLASS_STATS_MEM_FREE(uvc_stream->constant.class_stats, xfer->data_buffer_size, uvc_stream->constant.urb_heap_caps);
+            usb_dma_buf_free(xfer->data_buffer);
+            uvc_transfer_set_buffer(xfer, uvc_stream->constant.urb_bufs[i].data_buffer, uvc_stream->constant.urb_bufs[i].data_buffer_size);
+        }
+        USB_CLASS_STATS_MEM_FREE(uvc_stream->constant.class_stats, xfer->data_buffer_size, MALLOC_CAP_DMA);
+        usb_host_urb_pool_transfer_free(xfer);
     }
     free(uvc_stream->constant.xfers);
+    uvc_stream->constant.xfers = NULL;
+    uvc_stream->constant.num_of_xfers = 0;
+    free(uvc_stream->constant.urb_bufs);
+    uvc_stream->constant.urb_bufs = NULL;
+    free(uvc_stream->constant.segments);
+    uvc_stream->constant.segments = NULL;
 }
 
 /**
@@ -194,14 +412,37 @@ static esp_err_t uvc_transfers_allocate(uvc_stream_t *uvc_stream, unsigned num_o
     uvc_stream->constant.xfers = malloc(num_of_transfers * sizeof(usb_transfer_t *));
     UVC_CHECK(uvc_stream->constant.xfers, ESP_ERR_NO_MEM);
 
+    // Data buffers placed by the user replace the buffers of the USB Host Library, which are then kept minimal
+    const bool own_buffers = (uvc_stream->constant.urb_heap_caps != 0);
+    if (own_buffers) {
+        uvc_stream->constant.urb_bufs = calloc(num_of_transfers, sizeof(uvc_urb_buf_t));
+        ESP_GOTO_ON_FALSE(uvc_stream->constant.urb_bufs, ESP_ERR_NO_MEM, err, TAG,);
+    }
+
+    // Zero-copy mode: scatter-gather list with one segment per ISOC packet. Bulk transfers are described by one segment on stack
+    if (uvc_stream->constant.payload_cb && is_isoc) {
+        uvc_stream->constant.segments = calloc(num_isoc_packets, sizeof(uvc_host_payload_segment_t));
+        ESP_GOTO_ON_FALSE(uvc_stream->constant.segments, ESP_ERR_NO_MEM, err, TAG,);
+        uvc_stream->constant.max_segments = num_isoc_packets;
+    }
+
     // Allocate and init all the transfers
     for (unsigned i = 0; i < num_of_transfers; i++) {
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(transfer_size, num_isoc_packets, &uvc_stream->constant.xfers[i]),
+            usb_host_urb_pool_transfer_alloc(own_buffers ? sizeof(uint32_t) : transfer_size, num_isoc_packets, &uvc_stream->constant.xfers[i]),
             err, TAG, "Could not allocate USB transfers");
 
         uvc_stream->constant.num_of_xfers++;
         usb_transfer_t *this_transfer = uvc_stream->constant.xfers[i];
+        USB_CLASS_STATS_MEM_XFER(uvc_stream->constant.class_stats, this_transfer);
+        if (own_buffers) {
+            uint8_t *data_buffer = usb_dma_buf_alloc_caps(transfer_size, uvc_stream->constant.urb_alignment, uvc_stream->constant.urb_heap_caps);
+            ESP_GOTO_ON_FALSE(data_buffer, ESP_ERR_NO_MEM, err, TAG, "Could not allocate URB data buffers with caps 0x%"PRIx32, uvc_stream->constant.urb_heap_caps);
+            uvc_stream->constant.urb_bufs[i].data_buffer = this_transfer->data_buffer;
+            uvc_stream->constant.urb_bufs[i].data_buffer_size = this_transfer->data_buffer_size;
+            uvc_transfer_set_buffer(this_transfer, data_buffer, transfer_size);
+            USB_CLASS_STATS_MEM_ALLOC(uvc_stream->constant.class_stats, transfer_size, uvc_stream->constant.urb_heap_caps);
+        }
         this_transfer->device_handle = uvc_stream->constant.dev_hdl;
         this_transfer->context = uvc_stream;
         this_transfer->timeout_ms = 1000;
@@ -236,10 +477,21 @@ err:
 static void uvc_device_remove(uvc_stream_t *uvc_stream)
 {
     assert(uvc_stream);
+    uvc_stream_task_stop(uvc_stream);
     uvc_transfers_free(uvc_stream);
     uvc_frame_free(uvc_stream);
+    if (uvc_stream->constant.latest_frame_sem) {
+        vSemaphoreDelete(uvc_stream->constant.latest_frame_sem);
+    }
+    if (uvc_stream->constant.frame_queue) {
+        vQueueDelete(uvc_stream->constant.frame_queue);
+    }
+    uvc_desc_index_free(uvc_stream->constant.desc_index);
+    uvc_ctrl_async_delete(uvc_stream->constant.ctrl_async);
+    usb_class_stats_unregister(uvc_stream->constant.class_stats);
+    usb_host_bw_release(uvc_stream->constant.bw_hdl);
     // We don't check the error code of usb_host_device_close, as the close might fail, if someone else is still using the device (not all interfaces are released)
-    usb_host_device_close(p_uvc_host_driver->usb_client_hdl, uvc_stream->constant.dev_hdl); // Gracefully continue on error
+    usb_host_shared_client_device_close(p_uvc_host_driver->usb_client_hdl, uvc_stream->constant.dev_hdl); // Gracefully continue on error
     free(uvc_stream);
 }
 
@@ -298,7 +550,7 @@ static esp_err_t uvc_find_and_open_usb_device(uint16_t vid, uint16_t pid, TickTy
         for (int i = 0; i < num_of_devices; i++) {
             usb_device_handle_t current_device;
             // Open USB device
-            if (usb_host_device_open(p_uvc_host_driver->usb_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
+            if (usb_host_shared_client_device_open(p_uvc_host_driver->usb_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
                 continue; // In case we failed to open this device, continue with next one in the list
             }
             assert(current_device);
@@ -310,7 +562,7 @@ static esp_err_t uvc_find_and_open_usb_device(uint16_t vid, uint16_t pid, TickTy
                 (*dev)->constant.dev_hdl = current_device;
                 return ESP_OK;
             }
-            usb_host_device_close(p_uvc_host_driver->usb_client_hdl, current_device);
+            usb_host_shared_client_device_close(p_uvc_host_driver->usb_client_hdl, current_device);
         }
         vTaskDelay(pdMS_TO_TICKS(50));
     } while (xTaskCheckForTimeOut(&connection_timeout, &timeout) == pdFALSE);
@@ -341,32 +593,140 @@ static esp_err_t uvc_find_streaming_intf(uvc_stream_t *uvc_stream, uint8_t uvc_i
     // bAlternateSetting and bEndpointAddress are saved during interface claim
     uvc_stream->constant.bInterfaceNumber = bInterfaceNumber;
     uvc_stream->constant.bcdUVC = bcdUVC;
+    uvc_stream->constant.dwClockFrequency = uvc_desc_get_clock_frequency(cfg_desc, uvc_index);
+
+    // All later format and alternate setting lookups use this index instead of walking the configuration descriptor
+    ESP_RETURN_ON_ERROR(
+        uvc_desc_index_build(cfg_desc, bInterfaceNumber, &uvc_stream->constant.desc_index),
+        TAG, "Could not index Streaming interface %d", bInterfaceNumber);
+
+    // Camera controls of the function's Video Control interface are sent by the stream's control queue
+    uvc_desc_control_units_t units;
+    ESP_RETURN_ON_ERROR(uvc_desc_get_control_units(cfg_desc, uvc_index, &units), TAG, "Could not find Video Control interface");
+    ESP_RETURN_ON_ERROR(
+        uvc_ctrl_async_create(uvc_stream, p_uvc_host_driver->usb_client_hdl, &units, &uvc_stream->constant.ctrl_async),
+        TAG, "Could not create control queue");
     return ESP_OK;
 }
 
+/**
+ * @brief Select alternate setting of streaming interface and its endpoint
+ *
+ * In automatic bandwidth mode, the alternate setting with the least reserved bandwidth that can carry frames of
+ * negotiated size at requested fps is selected. Otherwise, the largest MPS that fits in IN FIFO is selected.
+ *
+ * @param[in]  uvc_stream    UVC stream handle
+ * @param[in]  vs_format     Negotiated Video Stream format
+ * @param[in]  vs_result     Result of format negotiation
+ * @param[out] intf_desc_ret Selected alternate setting
+ * @param[out] ep_desc_ret   Streaming endpoint of the selected alternate setting
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NOT_FOUND: Could not find Streaming interface
+ */
+static esp_err_t uvc_stream_select_intf_and_ep(uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format, const uvc_vs_ctrl_t *vs_result,
+        const usb_intf_desc_t **intf_desc_ret, const usb_ep_desc_t **ep_desc_ret)
+{
+    if (!uvc_stream->constant.auto_bandwidth) {
+        return uvc_desc_index_get_streaming_intf_and_ep(uvc_stream->constant.desc_index, MAX_MPS_IN, intf_desc_ret, ep_desc_ret);
+    }
+
+    uint64_t bytes_per_second = (uint64_t)(vs_result->dwMaxVideoFrameSize * vs_format->fps);
+    bytes_per_second = bytes_per_second * (100 + UVC_AUTO_BANDWIDTH_HEADROOM) / 100;
+    return uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+               uvc_stream->constant.desc_index, uvc_stream->constant.high_speed,
+               bytes_per_second > UINT32_MAX ? UINT32_MAX : (uint32_t)bytes_per_second,
+               vs_result->dwMaxPayloadTransferSize, MAX_MPS_IN, intf_desc_ret, ep_desc_ret);
+}
+
+/**
+ * @brief Size of Bulk URB that holds one payload transfer
+ *
+ * Every completed URB then carries one payload header: it completes after dwMaxPayloadTransferSize bytes or with the short
+ * packet that ends a shorter payload transfer. Payload transfers larger than UVC_AUTO_BULK_URB_MAX span several URBs.
+ *
+ * @param[in] vs_result Result of format negotiation
+ * @param[in] ep_desc   Bulk streaming endpoint
+ * @return Size of 1 URB in bytes
+ */
+static size_t uvc_stream_bulk_urb_size(const uvc_vs_ctrl_t *vs_result, const usb_ep_desc_t *ep_desc)
+{
+    const size_t mps = USB_EP_DESC_GET_MPS(ep_desc);
+    const size_t size = vs_result->dwMaxPayloadTransferSize;
+    return (size < mps) ? mps : (size > UVC_AUTO_BULK_URB_MAX) ? UVC_AUTO_BULK_URB_MAX : size;
+}
+
+/**
+ * @brief Check whether URBs of the stream are sized to payload transfers of the negotiated format
+ *
+ * @param[in] uvc_stream UVC stream handle
+ * @param[in] ep_desc    Streaming endpoint
+ * @return true for Bulk endpoint in automatic bandwidth or Bulk payload URB mode
+ */
+static bool uvc_stream_has_payload_urbs(const uvc_stream_t *uvc_stream, const usb_ep_desc_t *ep_desc)
+{
+    return (uvc_stream->constant.auto_bandwidth || uvc_stream->constant.bulk_payload_urbs) &&
+           USB_EP_DESC_GET_XFERTYPE(ep_desc) != USB_BM_ATTRIBUTES_XFER_ISOC;
+}
+
+/**
+ * @brief Derive number and size of URBs from the streaming endpoint
+ *
+ * ISOC: One URB spans at least UVC_AUTO_URB_SPAN_US of service intervals and all URBs span UVC_AUTO_URB_QUEUE_US.
+ * Bulk: One URB holds one payload transfer.
+ *
+ * @param[in]  uvc_stream UVC stream handle
+ * @param[in]  vs_result  Result of format negotiation
+ * @param[in]  ep_desc    Streaming endpoint
+ * @param[out] num_ret    Number of URBs
+ * @param[out] size_ret   Size of 1 URB in bytes
+ */
+static void uvc_stream_auto_urbs(const uvc_stream_t *uvc_stream, const uvc_vs_ctrl_t *vs_result, const usb_ep_desc_t *ep_desc,
+                                 unsigned *num_ret, size_t *size_ret)
+{
+    const size_t mps = USB_EP_DESC_GET_MPS(ep_desc);
+    if (USB_EP_DESC_GET_XFERTYPE(ep_desc) != USB_BM_ATTRIBUTES_XFER_ISOC) {
+        *size_ret = uvc_stream_bulk_urb_size(vs_result, ep_desc);
+        *num_ret = UVC_AUTO_URB_MIN_COUNT;
+        return;
+    }
+
+    const uint32_t interval_us = uvc_desc_get_ep_interval_us(ep_desc, uvc_stream->constant.high_speed);
+    const unsigned packets = (interval_us >= UVC_AUTO_URB_SPAN_US) ? 1 : UVC_AUTO_URB_SPAN_US / interval_us;
+    const uint32_t urb_span_us = packets * interval_us;
+    const unsigned num = (UVC_AUTO_URB_QUEUE_US + urb_span_us - 1) / urb_span_us;
+    *size_ret = packets * mps * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+    *num_ret = (num < UVC_AUTO_URB_MIN_COUNT) ? UVC_AUTO_URB_MIN_COUNT : num;
+}
+
 /**
  * @brief Claim streaming interface
  *
  * @param[in]  uvc_stream       UVC stream handle
+ * @param[in]  vs_format        Negotiated Video Stream format
+ * @param[in]  vs_result        Result of format negotiation
+ * @param[in]  known            Stored negotiation result with selected alternate setting. NULL: Select alternate setting
  * @param[out] ep_desc_ret      Pointer of associated streaming endpoint
  * @return
  *     - ESP_OK: Success - interface claimed
  *     - Else: Error
  */
-static esp_err_t uvc_claim_interface(uvc_stream_t *uvc_stream, const usb_ep_desc_t **ep_desc_ret)
+static esp_err_t uvc_claim_interface(uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format, const uvc_vs_ctrl_t *vs_result,
+                                     const uvc_negotiation_cache_result_t *known, const usb_ep_desc_t **ep_desc_ret)
 {
     const usb_intf_desc_t *intf_desc;
     const usb_ep_desc_t *ep_desc;
-    const usb_config_desc_t *cfg_desc;
-    ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(uvc_stream->constant.dev_hdl, &cfg_desc));
-
-    ESP_RETURN_ON_ERROR(
-        uvc_desc_get_streaming_intf_and_ep(cfg_desc, uvc_stream->constant.bInterfaceNumber, MAX_MPS_IN, &intf_desc, &ep_desc),
-        TAG, "Could not find Streaming interface %d", uvc_stream->constant.bInterfaceNumber);
+    if (!known || uvc_desc_index_get_streaming_intf_and_ep_by_alt(uvc_stream->constant.desc_index, known->bAlternateSetting,
+            known->bEndpointAddress, MAX_MPS_IN, &intf_desc, &ep_desc) != ESP_OK) {
+        ESP_RETURN_ON_ERROR(
+            uvc_stream_select_intf_and_ep(uvc_stream, vs_format, vs_result, &intf_desc, &ep_desc),
+            TAG, "Could not find Streaming interface %d", uvc_stream->constant.bInterfaceNumber);
+    }
 
     // Save all required parameters
     uvc_stream->constant.bAlternateSetting = intf_desc->bAlternateSetting;
     uvc_stream->constant.bEndpointAddress  = ep_desc->bEndpointAddress;
+    uvc_stream->constant.wMaxPacketSize    = USB_EP_DESC_GET_MPS(ep_desc);
     *ep_desc_ret = ep_desc;
 
     return usb_host_interface_claim(p_uvc_host_driver->usb_client_hdl, uvc_stream->constant.dev_hdl, intf_desc->bInterfaceNumber, intf_desc->bAlternateSetting);
@@ -386,6 +746,7 @@ esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config)
     if (driver_config == NULL) {
         driver_config = &default_driver_config;
     }
+    UVC_CHECK(!(driver_config->shared_client && driver_config->create_background_task), ESP_ERR_INVALID_ARG);
 
     // Allocate all we need for this driver
     esp_err_t ret;
@@ -395,8 +756,14 @@ esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config)
     SemaphoreHandle_t ctrl_mutex = xSemaphoreCreateMutex();
     SemaphoreHandle_t ctrl_sem = xSemaphoreCreateBinary();
     usb_transfer_t *ctrl_xfer = NULL;
-    usb_host_transfer_alloc(64, 0, &ctrl_xfer); // Worst case HS MPS
+    usb_host_urb_pool_transfer_alloc(64, 0, &ctrl_xfer); // Worst case HS MPS
     TaskHandle_t driver_task_h = NULL;
+    uvc_frame_slab_pool_t *frame_pool = NULL;
+    if (driver_config->frame_pool.num_slabs > 0) {
+        ESP_GOTO_ON_ERROR(
+            uvc_frame_pool_create(driver_config->frame_pool.num_slabs, driver_config->frame_pool.slab_size, driver_config->frame_pool.heap_caps, &frame_pool),
+            err, TAG, "Could not create shared frame pool");
+    }
 
     if (driver_config->create_background_task) {
         xTaskCreatePinnedToCore(
@@ -412,25 +779,39 @@ esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config)
 
     // Register USB Host client
     usb_host_client_handle_t usb_client = NULL;
-    const usb_host_client_config_t client_config = {
-        .is_synchronous = false,
-        .max_num_event_msg = 3,
-        .async.client_event_callback = usb_event_cb,
-        .async.callback_arg = NULL
-    };
-    ESP_GOTO_ON_ERROR(usb_host_client_register(&client_config, &usb_client), err, TAG, "Failed to register USB host client");
+    usb_host_shared_client_driver_handle_t shared_driver = NULL;
+    if (driver_config->shared_client) {
+        const usb_host_shared_client_driver_config_t shared_config = {
+            .event_cb = usb_event_cb,
+            .step_cb = NULL,
+            .arg = NULL,
+        };
+        ESP_GOTO_ON_ERROR(usb_host_shared_client_add_driver(&shared_config, &shared_driver, &usb_client), err, TAG,
+                          "Failed to add driver to USB host shared client");
+    } else {
+        const usb_host_client_config_t client_config = {
+            .is_synchronous = false,
+            .max_num_event_msg = 3,
+            .async.client_event_callback = usb_event_cb,
+            .async.callback_arg = NULL
+        };
+        ESP_GOTO_ON_ERROR(usb_host_client_register(&client_config, &usb_client), err, TAG, "Failed to register USB host client");
+    }
 
     // Initialize UVC driver structure
     SLIST_INIT(&(uvc_obj->uvc_stream_list));
+    uvc_obj->driver_task_core = driver_config->create_background_task ? driver_config->xCoreID : tskNO_AFFINITY;
     uvc_obj->driver_status = driver_status;
     uvc_obj->open_close_mutex = mutex;
     uvc_obj->usb_client_hdl = usb_client;
+    uvc_obj->shared_driver = shared_driver;
     uvc_obj->ctrl_mutex = ctrl_mutex;
     uvc_obj->ctrl_transfer = ctrl_xfer;
     uvc_obj->ctrl_transfer->context = ctrl_sem;
     uvc_obj->ctrl_transfer->bEndpointAddress = 0;
     uvc_obj->ctrl_transfer->timeout_ms = 5000;
     uvc_obj->ctrl_transfer->callback = ctrl_xfer_cb;
+    uvc_obj->frame_pool = frame_pool;
 
     // Between 1st call of this function and following section, another task might try to install this driver:
     // Make sure that there is only one instance of this driver in the system
@@ -446,7 +827,11 @@ esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config)
     return ESP_OK;
 
 client_err:
-    usb_host_client_deregister(usb_client);
+    if (shared_driver) {
+        usb_host_shared_client_remove_driver(shared_driver);
+    } else {
+        usb_host_client_deregister(usb_client);
+    }
 err: // Clean-up
     free(uvc_obj);
     if (driver_status) {
@@ -462,11 +847,12 @@ err: // Clean-up
         vSemaphoreDelete(ctrl_mutex);
     }
     if (ctrl_xfer) {
-        usb_host_transfer_free(ctrl_xfer);
+        usb_host_urb_pool_transfer_free(ctrl_xfer);
     }
     if (ctrl_sem) {
         vSemaphoreDelete(ctrl_sem);
     }
+    uvc_frame_pool_delete(frame_pool);
     return ret;
 }
 
@@ -489,18 +875,24 @@ esp_err_t uvc_host_uninstall()
     }
     UVC_EXIT_CRITICAL();
 
-    // Signal to UVC task to stop, unblock it and wait for its deletion
-    xEventGroupSetBits(uvc_obj->driver_status, UVC_TEARDOWN);
-    EventBits_t driver_status = xEventGroupGetBits(uvc_obj->driver_status);
-    if (driver_status & UVC_STARTED) {
-        usb_host_client_unblock(uvc_obj->usb_client_hdl);
-        ESP_GOTO_ON_FALSE(
-            xEventGroupWaitBits(uvc_obj->driver_status, UVC_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
-            ESP_ERR_NOT_FINISHED, unblock, TAG,);
-    }
+    if (uvc_obj->shared_driver) {
+        // Shared client keeps running for other class drivers, only our callbacks are removed
+        ESP_LOGD(TAG, "Removing driver from shared client");
+        ESP_ERROR_CHECK(usb_host_shared_client_remove_driver(uvc_obj->shared_driver));
+    } else {
+        // Signal to UVC task to stop, unblock it and wait for its deletion
+        xEventGroupSetBits(uvc_obj->driver_status, UVC_TEARDOWN);
+        EventBits_t driver_status = xEventGroupGetBits(uvc_obj->driver_status);
+        if (driver_status & UVC_STARTED) {
+            usb_host_client_unblock(uvc_obj->usb_client_hdl);
+            ESP_GOTO_ON_FALSE(
+                xEventGroupWaitBits(uvc_obj->driver_status, UVC_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
+                ESP_ERR_NOT_FINISHED, unblock, TAG,);
+        }
 
-    ESP_LOGD(TAG, "Deregistering client");
-    ESP_ERROR_CHECK(usb_host_client_deregister(uvc_obj->usb_client_hdl));
+        ESP_LOGD(TAG, "Deregistering client");
+        ESP_ERROR_CHECK(usb_host_client_deregister(uvc_obj->usb_client_hdl));
+    }
 
     // Free remaining resources and return
     vEventGroupDelete(uvc_obj->driver_status);
@@ -509,7 +901,8 @@ esp_err_t uvc_host_uninstall()
     xSemaphoreGive(uvc_obj->ctrl_mutex);
     vSemaphoreDelete(uvc_obj->ctrl_mutex);
     vSemaphoreDelete(uvc_obj->ctrl_transfer->context);
-    usb_host_transfer_free(uvc_obj->ctrl_transfer);
+    usb_host_urb_pool_transfer_free(uvc_obj->ctrl_transfer);
+    uvc_frame_pool_delete(uvc_obj->frame_pool);
     free(uvc_obj);
     return ESP_OK;
 
@@ -519,20 +912,132 @@ unblock:
     return ret;
 }
 
-esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, int timeout, uvc_host_stream_hdl_t *stream_hdl_ret)
+/**
+ * @brief Get initial size of adaptive frame buffers
+ *
+ * @param[in] vs_result Result of format negotiation
+ * @return Initial frame buffer size
+ */
+static size_t uvc_stream_adaptive_frame_size(const uvc_vs_ctrl_t *vs_result)
+{
+    size_t size = vs_result->dwMaxVideoFrameSize / UVC_ADAPTIVE_FRAME_SIZE_DIV;
+    if (size < UVC_ADAPTIVE_FRAME_SIZE_MIN) {
+        size = UVC_ADAPTIVE_FRAME_SIZE_MIN;
+    }
+    if (vs_result->dwMaxVideoFrameSize && size > vs_result->dwMaxVideoFrameSize) {
+        size = vs_result->dwMaxVideoFrameSize;
+    }
+    return size;
+}
+
+esp_err_t uvc_host_clear_negotiation_cache(void)
+{
+#ifdef CONFIG_UVC_HOST_NEGOTIATION_CACHE
+    return uvc_negotiation_cache_clear();
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t uvc_host_get_frame_list(uint16_t vid, uint16_t pid, uint8_t uvc_stream_index, int timeout,
+                                  uvc_host_frame_list_entry_t *frame_list, size_t *list_size)
 {
-    esp_err_t ret;
     UVC_CHECK(UVC_ATOMIC_LOAD(p_uvc_host_driver), ESP_ERR_INVALID_STATE);
-    UVC_CHECK(stream_config, ESP_ERR_INVALID_ARG);
-    UVC_CHECK(stream_hdl_ret, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(list_size, ESP_ERR_INVALID_ARG);
 
     uvc_stream_t *uvc_stream;
     xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY);
+    esp_err_t ret = uvc_find_and_open_usb_device(vid, pid, timeout, &uvc_stream);
+    if (ret == ESP_OK) {
+        const usb_config_desc_t *cfg_desc;
+        ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(uvc_stream->constant.dev_hdl, &cfg_desc));
+        ret = uvc_desc_get_frame_list(cfg_desc, uvc_stream_index, frame_list, list_size);
+
+        // The USB device stays open if it is used by opened streams
+        bool device_in_use = false;
+        uvc_stream_t *opened_stream;
+        SLIST_FOREACH(opened_stream, &p_uvc_host_driver->uvc_stream_list, list_entry) {
+            device_in_use |= (opened_stream->constant.dev_hdl == uvc_stream->constant.dev_hdl);
+        }
+        if (device_in_use) {
+            free(uvc_stream);
+        } else {
+            uvc_device_remove(uvc_stream);
+        }
+    }
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ret;
+}
+
+/**
+ * @brief Negotiate format of a stream being opened
+ *
+ * With CONFIG_UVC_HOST_NEGOTIATION_CACHE, the result stored for this camera and format is committed without probing.
+ * The format is negotiated if it is not known, or if the device rejects the stored result.
+ *
+ * @param[in]  uvc_stream UVC stream with found Streaming interface
+ * @param[in]  vs_format  Requested Video Stream format
+ * @param[out] vs_result  Committed Video Stream control
+ * @param[out] known      Stored result, filled only if true is returned in known_ret
+ * @param[out] known_ret  The stored result was committed
+ * @return see uvc_host_stream_control_negotiate()
+ */
+static esp_err_t uvc_stream_open_negotiate(uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format, uvc_vs_ctrl_t *vs_result,
+        uvc_negotiation_cache_result_t *known, bool *known_ret)
+{
+    *known_ret = false;
+#ifdef CONFIG_UVC_HOST_NEGOTIATION_CACHE
+    if (uvc_negotiation_cache_load(uvc_stream, vs_format, known) == ESP_OK) {
+        if (uvc_host_stream_control_commit_known(uvc_stream, vs_format, &known->vs_ctrl) == ESP_OK) {
+            memcpy(vs_result, &uvc_stream->constant.commit.vs_ctrl, sizeof(uvc_vs_ctrl_t));
+            *known_ret = true;
+            ESP_LOGD(TAG, "Known format committed, negotiation skipped");
+            return ESP_OK;
+        }
+        // Stale entry, e.g. after firmware update of the camera without bcdDevice change
+        ESP_LOGD(TAG, "Stored format rejected by the device");
+        uvc_negotiation_cache_remove(uvc_stream, vs_format);
+    }
+#endif // CONFIG_UVC_HOST_NEGOTIATION_CACHE
+    return uvc_host_stream_control_negotiate(uvc_stream, vs_format, vs_result);
+}
 
-    // Find underlying USB device
-    ret = uvc_find_and_open_usb_device(stream_config->usb.vid, stream_config->usb.pid, timeout, &uvc_stream);
-    if (ESP_OK != ret) {
-        goto not_found;
+/**
+ * @brief Open one UVC stream
+ *
+ * @note open_close_mutex must be held by the caller
+ * @param[in]  stream_config  Configuration of the stream
+ * @param[in]  timeout        Timeout in FreeRTOS ticks, used only if dev_hdl is NULL
+ * @param[in]  dev_hdl        USB device already used by an opened stream of the same group. NULL: Find the device by VID/PID
+ * @param[out] stream_hdl_ret UVC stream handle
+ * @return see uvc_host_stream_open()
+ */
+static esp_err_t uvc_stream_open(const uvc_host_stream_config_t *stream_config, int timeout, usb_device_handle_t dev_hdl,
+                                 uvc_host_stream_hdl_t *stream_hdl_ret)
+{
+    esp_err_t ret;
+    UVC_CHECK(!(stream_config->payload_cb && stream_config->advanced.frame_policy != UVC_HOST_FRAME_POLICY_CALLBACK), ESP_ERR_INVALID_ARG);
+    UVC_CHECK((stream_config->advanced.urb_alignment & (stream_config->advanced.urb_alignment - 1)) == 0, ESP_ERR_INVALID_ARG);
+    if (stream_config->advanced.shared_frame_pool) {
+        UVC_CHECK(p_uvc_host_driver->frame_pool, ESP_ERR_INVALID_STATE);
+        UVC_CHECK(!stream_config->advanced.adaptive_frame_size && !stream_config->payload_cb, ESP_ERR_INVALID_ARG);
+    }
+
+    uvc_stream_t *uvc_stream;
+    if (dev_hdl) {
+        // Another stream of the group holds the USB device open
+        uvc_stream = calloc(1, sizeof(uvc_stream_t));
+        if (uvc_stream == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            goto not_found;
+        }
+        uvc_stream->constant.dev_hdl = dev_hdl;
+    } else {
+        // Find underlying USB device
+        ret = uvc_find_and_open_usb_device(stream_config->usb.vid, stream_config->usb.pid, timeout, &uvc_stream);
+        if (ESP_OK != ret) {
+            goto not_found;
+        }
     }
 
     // Find the streaming interface
@@ -540,52 +1045,127 @@ esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, in
         uvc_find_streaming_intf(uvc_stream, stream_config->usb.uvc_stream_index, &stream_config->vs_format),
         err, TAG, "Could not find streaming interface");
 
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_device_info(uvc_stream->constant.dev_hdl, &dev_info));
+    uvc_stream->constant.high_speed = (dev_info.speed == USB_SPEED_HIGH);
+    uvc_stream->constant.auto_bandwidth = stream_config->advanced.auto_bandwidth;
+    uvc_stream->constant.bulk_payload_urbs = stream_config->advanced.bulk_payload_urbs;
+
+    // Registered before transfers and frames are allocated, so their memory is accounted to the stream
+    const usb_class_stats_info_t class_stats_info = {
+        .driver = "uvc",
+        .dev_addr = dev_info.dev_addr,
+        .intf_num = uvc_stream->constant.bInterfaceNumber,
+    };
+    usb_class_stats_register(&class_stats_info, &uvc_stream->constant.class_stats); // Stream is not counted on failure
+    USB_CLASS_STATS_MEM_ALLOC(uvc_stream->constant.class_stats, sizeof(uvc_stream_t), MALLOC_CAP_DEFAULT);
+
     // Negotiate the frame format
     uvc_vs_ctrl_t vs_result;
+    uvc_negotiation_cache_result_t known;
+    bool is_known;
     ESP_GOTO_ON_ERROR(
-        uvc_host_stream_control_negotiate(uvc_stream, &stream_config->vs_format, &vs_result),
+        uvc_stream_open_negotiate(uvc_stream, &stream_config->vs_format, &vs_result, &known, &is_known),
         err, TAG, "Failed to negotiate requested Video Stream format");
 
     // Claim Video Streaming interface
     const usb_ep_desc_t *ep_desc;
     ESP_GOTO_ON_ERROR(
-        uvc_claim_interface(uvc_stream, &ep_desc),
+        uvc_claim_interface(uvc_stream, &stream_config->vs_format, &vs_result, is_known ? &known : NULL, &ep_desc),
         claim_err, TAG, "Could not claim Streaming interface");
     ESP_LOGD(TAG, "Claimed interface index %d with MPS %d", uvc_stream->constant.bInterfaceNumber, USB_EP_DESC_GET_MPS(ep_desc));
+#ifdef CONFIG_UVC_HOST_NEGOTIATION_CACHE
+    if (!is_known && uvc_negotiation_cache_store(uvc_stream, &stream_config->vs_format) != ESP_OK) {
+        ESP_LOGD(TAG, "Negotiation result not stored");
+    }
+#endif // CONFIG_UVC_HOST_NEGOTIATION_CACHE
 
     // Allocate USB transfers
+    uvc_stream->constant.payload_cb = stream_config->payload_cb;
+    unsigned number_of_urbs = stream_config->advanced.number_of_urbs;
+    size_t urb_size = stream_config->advanced.urb_size;
+    if (uvc_stream->constant.auto_bandwidth) {
+        uvc_stream_auto_urbs(uvc_stream, &vs_result, ep_desc, &number_of_urbs, &urb_size);
+        ESP_LOGD(TAG, "Automatic bandwidth: alternate setting %d, %u URBs of %zu bytes", uvc_stream->constant.bAlternateSetting, number_of_urbs, urb_size);
+    } else if (uvc_stream_has_payload_urbs(uvc_stream, ep_desc)) {
+        urb_size = uvc_stream_bulk_urb_size(&vs_result, ep_desc);
+        number_of_urbs = (number_of_urbs < UVC_AUTO_URB_MIN_COUNT) ? UVC_AUTO_URB_MIN_COUNT : number_of_urbs;
+        ESP_LOGD(TAG, "Bulk payload URBs: %u URBs of %zu bytes", number_of_urbs, urb_size);
+    }
+    const bool processing_task = (stream_config->processing_task.stack_size != 0);
+    number_of_urbs += (processing_task ? 1 : 0); // One spare URB for the processing task
+    uvc_stream->constant.urb_heap_caps = stream_config->advanced.urb_heap_caps;
+    uvc_stream->constant.urb_alignment = stream_config->advanced.urb_alignment;
     ESP_GOTO_ON_ERROR(
-        uvc_transfers_allocate(uvc_stream, stream_config->advanced.number_of_urbs, stream_config->advanced.urb_size, ep_desc),
+        uvc_transfers_allocate(uvc_stream, number_of_urbs, urb_size, ep_desc),
         err, TAG,);
+    if (processing_task) {
+        ESP_GOTO_ON_ERROR(uvc_stream_task_start(uvc_stream, stream_config), err, TAG, "Could not start stream's processing task");
+    }
 
     // Allocate Frame buffers
+    ESP_GOTO_ON_ERROR(
+        uvc_frame_roi_set(uvc_stream, &stream_config->advanced.roi, &stream_config->vs_format),
+        err, TAG, "Region of interest does not fit into the format");
     size_t frame_buffer_size;
     if (stream_config->advanced.frame_size != 0) {
         frame_buffer_size = stream_config->advanced.frame_size; // If user provided custom frame size, use it
+    } else if (uvc_frame_roi_size(uvc_stream)) {
+        frame_buffer_size = uvc_frame_roi_size(uvc_stream); // Only the window is stored
+    } else if (stream_config->advanced.adaptive_frame_size) {
+        frame_buffer_size = uvc_stream_adaptive_frame_size(&vs_result); // Start small, frame buffers grow with received frames
     } else {
         frame_buffer_size = vs_result.dwMaxVideoFrameSize; // Use value from frame format negotiation
     };
+    uvc_stream->constant.adaptive_frame_size = stream_config->advanced.adaptive_frame_size;
+    uvc_stream->constant.frame_size_max = vs_result.dwMaxVideoFrameSize;
+    uvc_stream->constant.frame_heap_caps = stream_config->advanced.frame_heap_caps;
 
-    ESP_GOTO_ON_ERROR(
-        uvc_frame_allocate(
-            uvc_stream,
-            stream_config->advanced.number_of_frame_buffers,
-            frame_buffer_size,
-            stream_config->advanced.frame_heap_caps),
-        err, TAG,);
+    if (stream_config->advanced.shared_frame_pool) {
+        ESP_GOTO_ON_ERROR(
+            uvc_frame_allocate_shared(
+                uvc_stream,
+                p_uvc_host_driver->frame_pool,
+                stream_config->advanced.number_of_frame_buffers,
+                stream_config->advanced.frame_pool_reserved),
+            err, TAG,);
+    } else if (!stream_config->payload_cb) { // Frames are not assembled in zero-copy mode
+        ESP_GOTO_ON_ERROR(
+            uvc_frame_allocate(
+                uvc_stream,
+                stream_config->advanced.number_of_frame_buffers,
+                frame_buffer_size,
+                stream_config->advanced.frame_heap_caps),
+            err, TAG,);
+    }
+    uvc_stream->constant.frame_policy = stream_config->advanced.frame_policy;
+    if (uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_LATEST) {
+        uvc_stream->constant.latest_frame_sem = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(uvc_stream->constant.latest_frame_sem, ESP_ERR_NO_MEM, err, TAG,);
+    } else if (uvc_stream->constant.frame_policy == UVC_HOST_FRAME_POLICY_ACQUIRE) {
+        uvc_stream->constant.frame_queue = xQueueCreate(uvc_stream->constant.num_of_frames, sizeof(uvc_host_frame_t *));
+        ESP_GOTO_ON_FALSE(uvc_stream->constant.frame_queue, ESP_ERR_NO_MEM, err, TAG,);
+    }
 
     // Save info
     memcpy((uvc_host_stream_format_t *)&uvc_stream->constant.vs_format, &stream_config->vs_format, sizeof(uvc_host_stream_format_t));
     uvc_stream->constant.stream_cb = stream_config->event_cb;
     uvc_stream->constant.frame_cb = stream_config->frame_cb;
+    uvc_stream->constant.slice_cb = stream_config->slice_cb;
+    uvc_stream->constant.slice_size = stream_config->advanced.slice_size;
+    uvc_stream->constant.mjpeg_check = stream_config->advanced.mjpeg_check;
+    uvc_stream->constant.frame_decimation = stream_config->advanced.frame_decimation;
+    uvc_stream->constant.frame_size = stream_config->advanced.frame_size;
+    uvc_stream->constant.urb_size = stream_config->advanced.urb_size;
     uvc_stream->constant.cb_arg = stream_config->user_ctx;
 
+    uvc_stream->stats_rate.timestamp_us = esp_timer_get_time();
+
     // Everything OK, add the device into list
     UVC_ENTER_CRITICAL();
     SLIST_INSERT_HEAD(&p_uvc_host_driver->uvc_stream_list, uvc_stream, list_entry);
     UVC_EXIT_CRITICAL();
     *stream_hdl_ret = (uvc_host_stream_hdl_t)uvc_stream;
-    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
     return ESP_OK;
 
 err:
@@ -593,11 +1173,60 @@ err:
 claim_err:
     uvc_device_remove(uvc_stream);
 not_found:
-    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
     *stream_hdl_ret = NULL;
     return ret;
 }
 
+esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, int timeout, uvc_host_stream_hdl_t *stream_hdl_ret)
+{
+    UVC_CHECK(UVC_ATOMIC_LOAD(p_uvc_host_driver), ESP_ERR_INVALID_STATE);
+    UVC_CHECK(stream_config, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(stream_hdl_ret, ESP_ERR_INVALID_ARG);
+
+    xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY);
+    const esp_err_t ret = uvc_stream_open(stream_config, timeout, NULL, stream_hdl_ret);
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ret;
+}
+
+esp_err_t uvc_host_stream_open_group(const uvc_host_stream_config_t *stream_configs, size_t num_streams, int timeout,
+                                     uvc_host_stream_hdl_t *stream_hdls)
+{
+    UVC_CHECK(UVC_ATOMIC_LOAD(p_uvc_host_driver), ESP_ERR_INVALID_STATE);
+    UVC_CHECK(stream_configs && stream_hdls && num_streams > 0 && num_streams <= UVC_HOST_STREAM_GROUP_MAX, ESP_ERR_INVALID_ARG);
+    for (size_t i = 1; i < num_streams; i++) {
+        // All streams are functions of one device
+        UVC_CHECK(stream_configs[i].usb.vid == stream_configs[0].usb.vid && stream_configs[i].usb.pid == stream_configs[0].usb.pid,
+                  ESP_ERR_INVALID_ARG);
+        for (size_t j = 0; j < i; j++) {
+            UVC_CHECK(stream_configs[i].usb.uvc_stream_index != stream_configs[j].usb.uvc_stream_index, ESP_ERR_INVALID_ARG);
+        }
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t opened = 0;
+    xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY);
+    // The first stream finds the device, the others reuse its handle and need no timeout
+    for (; opened < num_streams; opened++) {
+        const usb_device_handle_t dev_hdl = opened ? ((uvc_stream_t *)stream_hdls[0])->constant.dev_hdl : NULL;
+        ret = uvc_stream_open(&stream_configs[opened], timeout, dev_hdl, &stream_hdls[opened]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Could not open stream %zu of the group", opened);
+            break;
+        }
+    }
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+
+    if (ret != ESP_OK) {
+        // All or nothing: close streams opened so far, in reverse order so the device is closed with the last one
+        while (opened--) {
+            uvc_host_stream_close(stream_hdls[opened]);
+            stream_hdls[opened] = NULL;
+        }
+    }
+    return ret;
+}
+
 esp_err_t uvc_host_stream_close(uvc_host_stream_hdl_t stream_hdl)
 {
     UVC_CHECK(UVC_ATOMIC_LOAD(p_uvc_host_driver), ESP_ERR_INVALID_STATE);
@@ -681,6 +1310,54 @@ static esp_err_t uvc_clear_endpoint_feature(uvc_host_stream_hdl_t stream_hdl)
                NULL);
 }
 
+/**
+ * @brief Reset frame assembly state and mark the stream as streaming
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_STATE: Stream is already streaming
+ */
+static esp_err_t uvc_stream_rx_prepare(uvc_stream_t *uvc_stream)
+{
+    UVC_CHECK(!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming), ESP_ERR_INVALID_STATE);
+    uvc_stream_task_flush(uvc_stream); // Transfers that completed after the stream was paused
+    // Start of Frame is detected when received FrameID != current_frame_id
+    // We set current_frame_id to illegal value (FrameID can be 0 or 1) so we catch SoF of the very first frame
+    uvc_stream->single_thread.current_frame_id = 2;
+    uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
+    uvc_stream->single_thread.bulk_payload_len = 0;
+    uvc_stream->single_thread.bulk_eof_pending = false;
+    uvc_stream->single_thread.bulk_resync = false;
+    uvc_stream->single_thread.slice_offset = 0;
+    UVC_CHECK(UVC_ATOMIC_SET_IF(uvc_stream->dynamic.streaming, false, true), ESP_ERR_INVALID_STATE);
+    return ESP_OK;
+}
+
+/**
+ * @brief Submit all URBs of the stream
+ *
+ * @param[in] uvc_stream UVC stream, prepared with uvc_stream_rx_prepare()
+ * @return
+ *     - ESP_OK: Success
+ *     - Else: Failed to submit USB transfer, the stream is paused
+ */
+static esp_err_t uvc_stream_transfers_submit(uvc_stream_t *uvc_stream)
+{
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
+        UVC_TRACE(SUBMIT, uvc_stream->constant.xfers[i]);
+        ESP_GOTO_ON_ERROR(
+            usb_host_transfer_submit(uvc_stream->constant.xfers[i]),
+            stop_stream, TAG, "Could not submit transfer %d", i);
+    }
+    return ret;
+
+stop_stream:
+    uvc_host_stream_pause(uvc_stream);
+    return ret;
+}
+
 esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl)
 {
     UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
@@ -688,93 +1365,631 @@ esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl)
 
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
 
+    const bool is_isoc = (uvc_stream->constant.bAlternateSetting != 0);
+    esp_err_t ret;
+
     // 1. Negotiate the frame format
     // @see USB UVC specification ver 1.5, figure 4-1
-    ESP_RETURN_ON_ERROR(
-        uvc_host_stream_control_negotiate(uvc_stream, &uvc_stream->constant.vs_format, NULL),
-        TAG, "Failed to negotiate requested Video Stream format");
-    vTaskDelay(pdMS_TO_TICKS(10)); // Some cameras need delay between format Commit and SetInterface
-
-    // 2. Send command to the camera to start streaming: ISOC only
-    if (uvc_stream->constant.bAlternateSetting != 0) {
+    // The device keeps committed format while the stream is stopped, so restart of the same format does not need probing.
+    // Bulk devices start streaming on VS_COMMIT, so the cached control is committed again
+    if (!uvc_host_stream_control_is_committed(uvc_stream, &uvc_stream->constant.vs_format)) {
         ESP_RETURN_ON_ERROR(
-            uvc_set_interface(stream_hdl, true),
-            TAG, "Could not Set Interface %d-%d", uvc_stream->constant.bInterfaceNumber, uvc_stream->constant.bAlternateSetting);
+            uvc_host_stream_control_negotiate(uvc_stream, &uvc_stream->constant.vs_format, NULL),
+            TAG, "Failed to negotiate requested Video Stream format");
+    } else if (!is_isoc) {
+        ESP_RETURN_ON_ERROR(uvc_host_stream_control_recommit(uvc_stream), TAG, "Failed to commit Video Stream format");
     }
 
-    // 3. Unpause: Submit all URBs
-    ESP_RETURN_ON_ERROR(
-        uvc_host_stream_unpause(stream_hdl),
-        TAG, "Could not unpause the stream");
+    // 2. Reserve periodic bandwidth of the bus: ISOC only. The alternate setting can step down, so do it before URBs are prepared
+    if (is_isoc) {
+        ESP_GOTO_ON_ERROR(uvc_stream_bw_reserve(uvc_stream), err, TAG, "Could not reserve bus bandwidth");
+    }
+
+    // 3. Prepare frame assembly before the camera starts sending, so nothing delays submission of URBs after SET_INTERFACE
+    ESP_GOTO_ON_ERROR(uvc_stream_rx_prepare(uvc_stream), err, TAG, "Could not prepare the stream");
+
+    // 4. Send command to the camera to start streaming: ISOC only
+    if (is_isoc) {
+        const int64_t since_commit_ms = (esp_timer_get_time() - uvc_stream->constant.commit.time_us) / 1000;
+        if (since_commit_ms < UVC_COMMIT_TO_SET_INTERFACE_DELAY_MS) {
+            vTaskDelay(pdMS_TO_TICKS(UVC_COMMIT_TO_SET_INTERFACE_DELAY_MS - since_commit_ms));
+        }
+        ret = uvc_set_interface(stream_hdl, true);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Could not Set Interface %d-%d", uvc_stream->constant.bInterfaceNumber, uvc_stream->constant.bAlternateSetting);
+            uvc_host_stream_pause(stream_hdl);
+            goto err;
+        }
+    }
 
+    // 5. Submit all URBs
+    ESP_GOTO_ON_ERROR(uvc_stream_transfers_submit(uvc_stream), err, TAG, "Could not unpause the stream");
     return ESP_OK;
+
+err:
+    uvc_host_stream_control_invalidate(uvc_stream); // The device is in unknown state, negotiate again on next start
+    usb_host_bw_release(uvc_stream->constant.bw_hdl);
+    uvc_stream->constant.bw_hdl = NULL;
+    return ret;
 }
 
-esp_err_t uvc_host_stream_stop(uvc_host_stream_hdl_t stream_hdl)
+/**
+ * @brief Stop receiving data and stop the camera
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] trim       Put frame buffers of the shared frame pool back, so other streams can use them
+ * @return
+ *     - ESP_OK: Success
+ *     - Else: CTRL request failed
+ */
+static esp_err_t uvc_stream_halt(uvc_stream_t *uvc_stream, bool trim)
 {
-    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
-    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
-
-    ESP_RETURN_ON_ERROR(uvc_host_stream_pause(stream_hdl), TAG, "Could not pause the stream");
+    ESP_RETURN_ON_ERROR(uvc_host_stream_pause(uvc_stream), TAG, "Could not pause the stream");
 
     //@todo this is not a clean solution
     vTaskDelay(pdMS_TO_TICKS(50)); // Wait for all transfers to finish
+    if (trim) {
+        uvc_frame_pool_trim(uvc_stream); // Other streams can use our free frame buffers now
+    }
 
     if (uvc_stream->constant.bAlternateSetting != 0) { // if (is_isoc_stream)
         // ISOC streams are stopped by setting alternate interface 0
-        return uvc_set_interface(stream_hdl, false);
+        const esp_err_t ret = uvc_set_interface(uvc_stream, false);
+        usb_host_bw_release(uvc_stream->constant.bw_hdl); // The endpoint is not polled anymore, even if the device did not respond
+        uvc_stream->constant.bw_hdl = NULL;
+        return ret;
     } else {
         // BULK streams are stopped by halting the endpoint
-        return uvc_clear_endpoint_feature(stream_hdl);
+        return uvc_clear_endpoint_feature(uvc_stream);
     }
 }
 
-esp_err_t uvc_host_stream_pause(uvc_host_stream_hdl_t stream_hdl)
+esp_err_t uvc_host_stream_stop(uvc_host_stream_hdl_t stream_hdl)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    return uvc_stream_halt((uvc_stream_t *)stream_hdl, true);
+}
+
+esp_err_t uvc_host_stream_idle(uvc_host_stream_hdl_t stream_hdl)
 {
     UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    UVC_CHECK(UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming), ESP_ERR_INVALID_STATE);
+    return uvc_stream_halt(uvc_stream, false);
+}
 
-    // We do not cancel the ongoing transfers here, it is not supported by USB Host Library
-    // By setting uvc_stream->dynamic.streaming = false; no frame callbacks will be called and the transfer can gracefully finish
-    UVC_ENTER_CRITICAL();
-    UVC_CHECK_FROM_CRIT(uvc_stream->dynamic.streaming, ESP_OK); // Return immediately if already paused
-    uvc_stream->dynamic.streaming = false;
-    uvc_host_frame_t *current_frame = uvc_stream->dynamic.current_frame;
-    uvc_stream->dynamic.current_frame = NULL;
-    UVC_EXIT_CRITICAL();
+/**
+ * @brief Replace USB transfers of a stopped stream
+ *
+ * @param[in] uvc_stream   UVC stream
+ * @param[in] num_of_xfers Number of USB transfers, including the spare one of the processing task
+ * @param[in] urb_size     Size of 1 URB in bytes
+ * @param[in] ep_desc      Streaming endpoint
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory for transfers
+ */
+static esp_err_t uvc_stream_transfers_reallocate(uvc_stream_t *uvc_stream, unsigned num_of_xfers, size_t urb_size, const usb_ep_desc_t *ep_desc)
+{
+    uvc_transfers_free(uvc_stream);
+    ESP_RETURN_ON_ERROR(
+        uvc_transfers_allocate(uvc_stream, num_of_xfers, urb_size, ep_desc),
+        TAG, "Could not allocate USB transfers");
+    if (uvc_stream->constant.xfer_queue) {
+        for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
+            uvc_stream->constant.xfers[i]->callback = deferred_transfer_callback;
+        }
+    }
+    return ESP_OK;
+}
 
-    if (current_frame) {
-        uvc_host_frame_return(uvc_stream, current_frame);
+/**
+ * @brief Reallocate USB transfers for new alternate setting of the streaming interface
+ *
+ * @note The stream must be stopped
+ * @param[in] uvc_stream UVC stream
+ * @param[in] vs_result  Result of format negotiation
+ * @param[in] intf_desc  New alternate setting of Video Streaming interface
+ * @param[in] ep_desc    Streaming endpoint of the new alternate setting
+ * @return
+ *     - ESP_OK: Success
+ *     - Else: USB lib error or not enough memory
+ */
+static esp_err_t uvc_stream_alt_setting_change(uvc_stream_t *uvc_stream, const uvc_vs_ctrl_t *vs_result, const usb_intf_desc_t *intf_desc, const usb_ep_desc_t *ep_desc)
+{
+    // Endpoints of the USB Host Library are bound to the alternate setting of claimed interface: Claim it again
+    ESP_RETURN_ON_ERROR(
+        usb_host_interface_release(p_uvc_host_driver->usb_client_hdl, uvc_stream->constant.dev_hdl, uvc_stream->constant.bInterfaceNumber),
+        TAG, "Could not release Streaming interface");
+    ESP_RETURN_ON_ERROR(
+        usb_host_interface_claim(p_uvc_host_driver->usb_client_hdl, uvc_stream->constant.dev_hdl, intf_desc->bInterfaceNumber, intf_desc->bAlternateSetting),
+        TAG, "Could not claim Streaming interface %d-%d", intf_desc->bInterfaceNumber, intf_desc->bAlternateSetting);
+    uvc_stream->constant.bAlternateSetting = intf_desc->bAlternateSetting;
+    uvc_stream->constant.bEndpointAddress  = ep_desc->bEndpointAddress;
+    uvc_stream->constant.wMaxPacketSize    = USB_EP_DESC_GET_MPS(ep_desc);
+
+    unsigned num_of_xfers = uvc_stream->constant.num_of_xfers;
+    size_t urb_size = uvc_stream->constant.urb_size;
+    if (uvc_stream->constant.auto_bandwidth) {
+        uvc_stream_auto_urbs(uvc_stream, vs_result, ep_desc, &num_of_xfers, &urb_size);
+        num_of_xfers += (uvc_stream->constant.xfer_queue ? 1 : 0); // One spare URB for the processing task
+    } else if (uvc_stream_has_payload_urbs(uvc_stream, ep_desc)) {
+        urb_size = uvc_stream_bulk_urb_size(vs_result, ep_desc);
     }
+    return uvc_stream_transfers_reallocate(uvc_stream, num_of_xfers, urb_size, ep_desc);
+}
 
+/**
+ * @brief Apply negotiated format to frame buffers and USB transfers
+ *
+ * @note The stream must be stopped
+ * @param[in] uvc_stream UVC stream
+ * @param[in] vs_format  Negotiated Video Stream format
+ * @param[in] vs_result  Result of format negotiation
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_STATE: Frame buffers must be enlarged, but not all frames were returned
+ *     - Else: USB lib error or not enough memory
+ */
+static esp_err_t uvc_stream_resources_update(uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format, const uvc_vs_ctrl_t *vs_result)
+{
+    // Adaptive frame buffers are always reused, they grow with frames of the new format
+    if (uvc_stream->constant.adaptive_frame_size) {
+        uvc_stream->constant.frame_size_max = vs_result->dwMaxVideoFrameSize;
+        uvc_stream->single_thread.frame_size_peak = 0;
+    } else if (uvc_stream->constant.slab_pool) {
+        // Slabs of shared frame pool have fixed size. Larger frames are skipped with UVC_HOST_FRAME_BUFFER_OVERFLOW
+    } else if (uvc_stream->constant.frames) {
+        // Frame buffers are reused if they can hold frames of the new format
+        size_t frame_size = uvc_stream->constant.frame_size ? uvc_stream->constant.frame_size : uvc_frame_roi_size(uvc_stream);
+        if (frame_size == 0) {
+            frame_size = vs_result->dwMaxVideoFrameSize;
+        }
+        if (uvc_stream->constant.frames[0]->data_buffer_len < frame_size) {
+            UVC_CHECK(uvc_frame_are_all_returned(uvc_stream), ESP_ERR_INVALID_STATE);
+            const int num_of_frames = uvc_stream->constant.num_of_frames;
+            uvc_frame_free(uvc_stream);
+            ESP_RETURN_ON_ERROR(
+                uvc_frame_allocate(uvc_stream, num_of_frames, frame_size, uvc_stream->constant.frame_heap_caps),
+                TAG, "Could not allocate frame buffers");
+        }
+    }
+
+    // USB transfers are reallocated only if the alternate setting changes
+    const usb_intf_desc_t *intf_desc;
+    const usb_ep_desc_t *ep_desc;
+    ESP_RETURN_ON_ERROR(
+        uvc_stream_select_intf_and_ep(uvc_stream, vs_format, vs_result, &intf_desc, &ep_desc),
+        TAG, "Could not find Streaming interface %d", uvc_stream->constant.bInterfaceNumber);
+    if (intf_desc->bAlternateSetting != uvc_stream->constant.bAlternateSetting) {
+        return uvc_stream_alt_setting_change(uvc_stream, vs_result, intf_desc, ep_desc);
+    }
+
+    // Bulk URBs that hold one payload transfer follow dwMaxPayloadTransferSize of the new format
+    if (uvc_stream_has_payload_urbs(uvc_stream, ep_desc)) {
+        const size_t urb_size = usb_round_up_to_mps(uvc_stream_bulk_urb_size(vs_result, ep_desc), USB_EP_DESC_GET_MPS(ep_desc));
+        if (uvc_stream->constant.xfers[0]->num_bytes != urb_size) {
+            return uvc_stream_transfers_reallocate(uvc_stream, uvc_stream->constant.num_of_xfers, urb_size, ep_desc);
+        }
+    }
     return ESP_OK;
 }
 
-esp_err_t uvc_host_stream_unpause(uvc_host_stream_hdl_t stream_hdl)
+/**
+ * @brief Reserve periodic bandwidth of the ISOC streaming endpoint before SET_INTERFACE
+ *
+ * The alternate setting selected for the committed format is tried first. If the bus does not have enough periodic bandwidth left,
+ * e.g. because of an audio stream on the same bus, the stream steps down to alternate settings with smaller packets.
+ * Frames that do not fit in the reduced bandwidth are then skipped, but the other streams keep working.
+ *
+ * @note The stream must be stopped and its format committed
+ * @param[in] uvc_stream UVC stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NOT_FINISHED: Not enough periodic bandwidth even for the smallest alternate setting
+ *     - Else: USB lib error or not enough memory
+ */
+static esp_err_t uvc_stream_bw_reserve(uvc_stream_t *uvc_stream)
+{
+    if (uvc_stream->constant.bw_hdl) {
+        return ESP_OK; // Reserved by uvc_host_stream_start_group()
+    }
+    const uvc_vs_ctrl_t *vs_result = &uvc_stream->constant.commit.vs_ctrl;
+    const usb_intf_desc_t *intf_desc;
+    const usb_ep_desc_t *ep_desc;
+    ESP_RETURN_ON_ERROR(
+        uvc_stream_select_intf_and_ep(uvc_stream, &uvc_stream->constant.commit.format, vs_result, &intf_desc, &ep_desc),
+        TAG, "Could not find Streaming interface %d", uvc_stream->constant.bInterfaceNumber);
+
+    esp_err_t ret;
+    while (true) {
+        const usb_host_bw_request_t request = {
+            .root_port = 0,
+            .speed = uvc_stream->constant.high_speed ? USB_SPEED_HIGH : USB_SPEED_FULL,
+            .ep_desc = ep_desc,
+        };
+        ret = usb_host_bw_reserve(&request, &uvc_stream->constant.bw_hdl);
+        if (ret != ESP_ERR_NOT_FINISHED) {
+            break;
+        }
+        const uint8_t bAlternateSetting = intf_desc->bAlternateSetting;
+        ESP_RETURN_ON_FALSE(
+            uvc_desc_index_get_streaming_intf_and_ep_step_down(uvc_stream->constant.desc_index, uvc_stream->constant.high_speed,
+                    ep_desc, MAX_MPS_IN, &intf_desc, &ep_desc) == ESP_OK,
+            ESP_ERR_NOT_FINISHED, TAG, "Not enough bus bandwidth for Streaming interface %d", uvc_stream->constant.bInterfaceNumber);
+        ESP_LOGW(TAG, "Not enough bus bandwidth for alternate setting %d, stepping down to %d", bAlternateSetting, intf_desc->bAlternateSetting);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (intf_desc->bAlternateSetting != uvc_stream->constant.bAlternateSetting) {
+        ret = uvc_stream_alt_setting_change(uvc_stream, vs_result, intf_desc, ep_desc);
+        if (ret != ESP_OK) {
+            usb_host_bw_release(uvc_stream->constant.bw_hdl);
+            uvc_stream->constant.bw_hdl = NULL;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Reserve periodic bandwidth of several ISOC streams together
+ *
+ * Preferred alternate settings of all streams are reserved first. If they do not fit, the stream with the most expensive
+ * endpoint steps down and the reservation is repeated. So the bandwidth is shared among the streams, instead of the stream
+ * started last getting only what is left.
+ *
+ * @note The streams must be stopped and their formats committed
+ * @param[in] streams     ISOC streams
+ * @param[in] num_streams Number of streams
+ * @return
+ *     - ESP_OK: Success, bw_hdl of all streams is set
+ *     - ESP_ERR_NOT_FINISHED: Not enough periodic bandwidth even for the smallest alternate settings
+ *     - Else: USB lib error or not enough memory
+ */
+static esp_err_t uvc_stream_group_bw_reserve(uvc_stream_t *const *streams, size_t num_streams)
+{
+    const usb_intf_desc_t *intf_descs[UVC_HOST_STREAM_GROUP_MAX];
+    const usb_ep_desc_t *ep_descs[UVC_HOST_STREAM_GROUP_MAX];
+    for (size_t i = 0; i < num_streams; i++) {
+        ESP_RETURN_ON_ERROR(
+            uvc_stream_select_intf_and_ep(streams[i], &streams[i]->constant.commit.format, &streams[i]->constant.commit.vs_ctrl,
+                                          &intf_descs[i], &ep_descs[i]),
+            TAG, "Could not find Streaming interface %d", streams[i]->constant.bInterfaceNumber);
+    }
+
+    esp_err_t ret;
+    while (true) {
+        size_t reserved = 0;
+        for (ret = ESP_OK; reserved < num_streams && ret == ESP_OK; reserved++) {
+            const usb_host_bw_request_t request = {
+                .root_port = 0,
+                .speed = streams[reserved]->constant.high_speed ? USB_SPEED_HIGH : USB_SPEED_FULL,
+                .ep_desc = ep_descs[reserved],
+            };
+            ret = usb_host_bw_reserve(&request, &streams[reserved]->constant.bw_hdl);
+        }
+        if (ret == ESP_OK) {
+            break;
+        }
+        for (size_t i = 0; i < num_streams; i++) {
+            usb_host_bw_release(streams[i]->constant.bw_hdl);
+            streams[i]->constant.bw_hdl = NULL;
+        }
+        if (ret != ESP_ERR_NOT_FINISHED) {
+            return ret;
+        }
+
+        // Step down the most expensive endpoint that has a smaller alternate setting
+        size_t step = num_streams;
+        uint32_t step_cost = 0;
+        const usb_intf_desc_t *step_intf = NULL;
+        const usb_ep_desc_t *step_ep = NULL;
+        for (size_t i = 0; i < num_streams; i++) {
+            const bool high_speed = streams[i]->constant.high_speed;
+            const uint32_t cost = usb_host_bw_ep_cost_ns(high_speed ? USB_SPEED_HIGH : USB_SPEED_FULL, ep_descs[i]);
+            const usb_intf_desc_t *intf_desc;
+            const usb_ep_desc_t *ep_desc;
+            if (cost > step_cost &&
+                    uvc_desc_index_get_streaming_intf_and_ep_step_down(streams[i]->constant.desc_index, high_speed,
+                            ep_descs[i], MAX_MPS_IN, &intf_desc, &ep_desc) == ESP_OK) {
+                step = i;
+                step_cost = cost;
+                step_intf = intf_desc;
+                step_ep = ep_desc;
+            }
+        }
+        ESP_RETURN_ON_FALSE(step < num_streams, ESP_ERR_NOT_FINISHED, TAG, "Not enough bus bandwidth for the stream group");
+        ESP_LOGW(TAG, "Not enough bus bandwidth for the stream group, stepping down interface %d from alternate setting %d to %d",
+                 streams[step]->constant.bInterfaceNumber, intf_descs[step]->bAlternateSetting, step_intf->bAlternateSetting);
+        intf_descs[step] = step_intf;
+        ep_descs[step] = step_ep;
+    }
+
+    for (size_t i = 0; i < num_streams; i++) {
+        if (intf_descs[i]->bAlternateSetting != streams[i]->constant.bAlternateSetting) {
+            ret = uvc_stream_alt_setting_change(streams[i], &streams[i]->constant.commit.vs_ctrl, intf_descs[i], ep_descs[i]);
+            if (ret != ESP_OK) {
+                break;
+            }
+        }
+    }
+    if (ret != ESP_OK) {
+        for (size_t i = 0; i < num_streams; i++) {
+            usb_host_bw_release(streams[i]->constant.bw_hdl);
+            streams[i]->constant.bw_hdl = NULL;
+        }
+    }
+    return ret;
+}
+
+esp_err_t uvc_host_stream_start_group(const uvc_host_stream_hdl_t *stream_hdls, size_t num_streams)
+{
+    UVC_CHECK(stream_hdls && num_streams > 0 && num_streams <= UVC_HOST_STREAM_GROUP_MAX, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *isoc_streams[UVC_HOST_STREAM_GROUP_MAX];
+    size_t num_isoc = 0;
+    for (size_t i = 0; i < num_streams; i++) {
+        uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdls[i];
+        UVC_CHECK(uvc_stream, ESP_ERR_INVALID_ARG);
+        UVC_CHECK(UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) == false, ESP_ERR_INVALID_STATE);
+        if (uvc_stream->constant.bAlternateSetting != 0) {
+            isoc_streams[num_isoc++] = uvc_stream;
+        }
+    }
+
+    // 1. Commit formats of ISOC streams, so their bandwidth is known. uvc_host_stream_start() then does not negotiate again
+    esp_err_t ret;
+    for (size_t i = 0; i < num_isoc; i++) {
+        if (!uvc_host_stream_control_is_committed(isoc_streams[i], &isoc_streams[i]->constant.vs_format)) {
+            ESP_RETURN_ON_ERROR(
+                uvc_host_stream_control_negotiate(isoc_streams[i], &isoc_streams[i]->constant.vs_format, NULL),
+                TAG, "Failed to negotiate requested Video Stream format");
+        }
+    }
+
+    // 2. Reserve bandwidth of all ISOC streams together
+    if (num_isoc) {
+        ESP_RETURN_ON_ERROR(uvc_stream_group_bw_reserve(isoc_streams, num_isoc), TAG, "Could not reserve bus bandwidth");
+    }
+
+    // 3. Start the streams with reserved bandwidth
+    size_t started = 0;
+    for (; started < num_streams; started++) {
+        ret = uvc_host_stream_start(stream_hdls[started]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Could not start stream %zu of the group", started);
+            break;
+        }
+    }
+    if (ret != ESP_OK) {
+        for (size_t i = 0; i < num_streams; i++) {
+            uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdls[i];
+            if (i < started) {
+                uvc_host_stream_stop(stream_hdls[i]);
+            } else {
+                usb_host_bw_release(uvc_stream->constant.bw_hdl);
+                uvc_stream->constant.bw_hdl = NULL;
+            }
+        }
+    }
+    return ret;
+}
+
+esp_err_t uvc_host_stream_format_select(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format)
+{
+    UVC_CHECK(UVC_ATOMIC_LOAD(p_uvc_host_driver), ESP_ERR_INVALID_STATE);
+    UVC_CHECK(stream_hdl && vs_format, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    esp_err_t ret;
+
+    // The new format must be offered by the claimed Video Streaming interface
+    ESP_RETURN_ON_FALSE(
+        uvc_desc_index_get_frame_format_by_format(uvc_stream->constant.desc_index, vs_format, NULL, NULL) == ESP_OK,
+        ESP_ERR_NOT_SUPPORTED, TAG, "Format %dx%d@%2.1fFPS not offered by Streaming interface %d",
+        vs_format->h_res, vs_format->v_res, vs_format->fps, uvc_stream->constant.bInterfaceNumber);
+
+    xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY); // Do not let the stream be closed in the meantime
+    const bool was_streaming = UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+    if (was_streaming) {
+        ESP_GOTO_ON_ERROR(uvc_host_stream_stop(stream_hdl), exit, TAG, "Could not stop the stream");
+    }
+
+    uvc_vs_ctrl_t vs_result;
+    ESP_GOTO_ON_ERROR(
+        uvc_host_stream_control_negotiate(uvc_stream, vs_format, &vs_result),
+        restore, TAG, "Failed to negotiate requested Video Stream format");
+    ESP_GOTO_ON_ERROR(
+        uvc_frame_roi_set(uvc_stream, &uvc_stream->constant.roi.window, vs_format),
+        restore, TAG, "Region of interest does not fit into the new format");
+    ESP_GOTO_ON_ERROR(uvc_stream_resources_update(uvc_stream, vs_format, &vs_result), restore, TAG,);
+    memcpy(&uvc_stream->constant.vs_format, vs_format, sizeof(uvc_host_stream_format_t));
+    uvc_stream->single_thread.mjpeg_size_avg = 0; // Frame sizes of the previous format are not comparable
+
+    if (was_streaming) {
+        ESP_GOTO_ON_ERROR(uvc_host_stream_start(stream_hdl), exit, TAG, "Could not restart the stream");
+    }
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ESP_OK;
+
+restore:
+    // Commit the previous format again, so the device and the driver agree on it
+    if (uvc_host_stream_control_negotiate(uvc_stream, &uvc_stream->constant.vs_format, &vs_result) == ESP_OK) {
+        uvc_stream_resources_update(uvc_stream, &uvc_stream->constant.vs_format, &vs_result);
+    }
+    if (was_streaming) {
+        uvc_host_stream_start(stream_hdl);
+    }
+exit:
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ret;
+}
+
+esp_err_t uvc_host_stream_still_capture(uvc_host_stream_hdl_t stream_hdl, unsigned h_res, unsigned v_res)
 {
     UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
-    esp_err_t ret = ESP_OK;
+    const uvc_desc_index_t *desc_index = uvc_stream->constant.desc_index;
+    UVC_CHECK(desc_index, ESP_ERR_INVALID_STATE);
+    // Method 1 sends only video frames. Method 3 sends still images over the video endpoint only if it is bulk
+    const uint8_t method = desc_index->bStillCaptureMethod;
+    UVC_CHECK(method == 2 || method == 3, ESP_ERR_NOT_SUPPORTED);
+    // Still images have a different size than video frames, they cannot be cropped and zero-copy mode has no frame metadata
+    UVC_CHECK(!uvc_stream->constant.payload_cb && !uvc_stream->constant.roi.row_len, ESP_ERR_NOT_SUPPORTED);
+
+    esp_err_t ret;
+    xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY);
+    ESP_GOTO_ON_FALSE(UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && uvc_stream->constant.commit.valid,
+                      ESP_ERR_INVALID_STATE, exit, TAG, "Stream is not started");
+    const uint8_t bFormatIndex = uvc_stream->constant.commit.vs_ctrl.bFormatIndex;
+    uvc_desc_still_size_t still_size;
+    ESP_GOTO_ON_ERROR(
+        uvc_desc_index_get_still_size(desc_index, bFormatIndex, h_res, v_res, &still_size),
+        exit, TAG, "Still image %ux%u not offered by the current format", h_res, v_res);
+    ESP_GOTO_ON_FALSE(
+        still_size.bEndpointAddress == 0 || still_size.bEndpointAddress == uvc_stream->constant.bEndpointAddress,
+        ESP_ERR_NOT_SUPPORTED, exit, TAG, "Dedicated still image endpoint is not supported");
+
+    // Still commit is kept by the device until the video format is committed again, so repeated captures only send the trigger
+    if (!uvc_stream->constant.still.committed
+            || uvc_stream->constant.still.video_commit_time_us != uvc_stream->constant.commit.time_us
+            || uvc_stream->constant.still.bFormatIndex != bFormatIndex
+            || uvc_stream->constant.still.bFrameIndex != still_size.bFrameIndex) {
+        uvc_still_ctrl_t still_ctrl = {
+            .bFormatIndex = bFormatIndex,
+            .bFrameIndex = still_size.bFrameIndex,
+            .bCompressionIndex = still_size.bCompressionIndex,
+        };
+        uvc_stream->constant.still.committed = false;
+        ESP_GOTO_ON_ERROR(uvc_host_stream_control_still_negotiate(stream_hdl, &still_ctrl), exit, TAG, "Still image negotiation failed");
+        uvc_stream->constant.still.bFormatIndex = bFormatIndex;
+        uvc_stream->constant.still.bFrameIndex = still_size.bFrameIndex;
+        uvc_stream->constant.still.h_res = still_size.wWidth;
+        uvc_stream->constant.still.v_res = still_size.wHeight;
+        uvc_stream->constant.still.video_commit_time_us = uvc_stream->constant.commit.time_us;
+        uvc_stream->constant.still.committed = true;
+
+        if (uvc_stream->constant.adaptive_frame_size) {
+            if (uvc_stream->constant.frame_size_max && still_ctrl.dwMaxVideoFrameSize > uvc_stream->constant.frame_size_max) {
+                uvc_stream->constant.frame_size_max = still_ctrl.dwMaxVideoFrameSize;
+            }
+        } else if (uvc_stream->constant.num_of_frames && uvc_stream->constant.frames[0]->data_buffer_len < still_ctrl.dwMaxVideoFrameSize) {
+            ESP_LOGW(TAG, "Still images up to %"PRIu32" bytes might not fit into frame buffers", still_ctrl.dwMaxVideoFrameSize);
+        }
+    }
+    ret = uvc_host_stream_control_still_trigger(stream_hdl);
+
+exit:
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ret;
+}
+
+esp_err_t uvc_host_stream_get_stats(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_stats_t *stats)
+{
+    UVC_CHECK(stream_hdl && stats, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
 
+    *stats = (uvc_host_stream_stats_t) {
+        .frames_delivered = UVC_ATOMIC_LOAD(uvc_stream->stats.frames_delivered),
+        .bytes_delivered = UVC_ATOMIC_LOAD(uvc_stream->stats.bytes_delivered),
+        .frames_skipped = {
+            .missed_eof = UVC_ATOMIC_LOAD(uvc_stream->stats.skipped_missed_eof),
+            .error = UVC_ATOMIC_LOAD(uvc_stream->stats.skipped_error),
+            .overflow = UVC_ATOMIC_LOAD(uvc_stream->stats.skipped_overflow),
+            .underflow = UVC_ATOMIC_LOAD(uvc_stream->stats.skipped_underflow),
+            .corrupted = UVC_ATOMIC_LOAD(uvc_stream->stats.skipped_corrupted),
+        },
+        .frames_decimated = UVC_ATOMIC_LOAD(uvc_stream->stats.frames_decimated),
+        .frames_overwritten = UVC_ATOMIC_LOAD(uvc_stream->stats.frames_overwritten),
+        .usb_errors = {
+            .error = UVC_ATOMIC_LOAD(uvc_stream->stats.usb_error),
+            .overflow = UVC_ATOMIC_LOAD(uvc_stream->stats.usb_overflow),
+            .stall = UVC_ATOMIC_LOAD(uvc_stream->stats.usb_stall),
+            .missed = UVC_ATOMIC_LOAD(uvc_stream->stats.usb_missed),
+        },
+        .urbs_completed = UVC_ATOMIC_LOAD(uvc_stream->stats.urbs_completed),
+    };
+    const uint64_t urb_capacity = UVC_ATOMIC_LOAD(uvc_stream->stats.urb_capacity);
+    if (urb_capacity) {
+        stats->urb_fill_percent = (uint8_t)(UVC_ATOMIC_LOAD(uvc_stream->stats.urb_bytes) * 100 / urb_capacity);
+    }
+
+    // Rates are computed from the difference to the previous call
+    const int64_t now = esp_timer_get_time();
     UVC_ENTER_CRITICAL();
-    UVC_CHECK_FROM_CRIT(!uvc_stream->dynamic.streaming, ESP_ERR_INVALID_STATE);
-    uvc_stream->dynamic.streaming = true;
-    // Start of Frame is detected when received FrameID != current_frame_id
-    // We set current_frame_id to illegal value (FrameID can be 0 or 1) so we catch SoF of the very first frame
-    uvc_stream->single_thread.current_frame_id = 2;
-    uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
+    const int64_t elapsed_us = now - uvc_stream->stats_rate.timestamp_us;
+    const uint32_t frames = stats->frames_delivered - uvc_stream->stats_rate.frames_delivered;
+    const uint64_t bytes = stats->bytes_delivered - uvc_stream->stats_rate.bytes_delivered;
+    uvc_stream->stats_rate.timestamp_us = now;
+    uvc_stream->stats_rate.frames_delivered = stats->frames_delivered;
+    uvc_stream->stats_rate.bytes_delivered = stats->bytes_delivered;
     UVC_EXIT_CRITICAL();
 
-    for (int i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
-        ESP_GOTO_ON_ERROR(
-            usb_host_transfer_submit(uvc_stream->constant.xfers[i]),
-            stop_stream, TAG, "Could not submit transfer %d", i);
+    if (elapsed_us > 0) {
+        stats->fps = (float)frames * 1000000 / elapsed_us;
+        stats->bitrate = (uint32_t)(bytes * 8 * 1000000 / elapsed_us);
     }
-    return ret;
+    return ESP_OK;
+}
 
-stop_stream:
-    uvc_host_stream_pause(stream_hdl);
-    return ret;
+esp_err_t uvc_host_stream_get_mem_usage(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_mem_t *mem)
+{
+    UVC_CHECK(stream_hdl && mem, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    *mem = (uvc_host_stream_mem_t) {0};
+
+    // Transfers and frame buffers are reallocated by uvc_host_stream_format_select() under the same mutex
+    xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY);
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
+        const usb_transfer_t *xfer = uvc_stream->constant.xfers[i];
+        size_t *bytes = usb_dma_buf_is_external(xfer->data_buffer) ? &mem->urb_external : &mem->urb_internal;
+        *bytes += xfer->data_buffer_size;
+        if (uvc_stream->constant.urb_bufs) {
+            mem->urb_internal += uvc_stream->constant.urb_bufs[i].data_buffer_size; // Minimal buffer of the USB Host Library
+        }
+    }
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_frames; i++) {
+        const uvc_host_frame_t *frame = uvc_stream->constant.frames[i];
+        const uint8_t *data = UVC_ATOMIC_LOAD(frame->data);
+        if (data == NULL) {
+            continue; // Shared frame pool: no slab is held
+        }
+        size_t *bytes = usb_dma_buf_is_external(data) ? &mem->frame_external : &mem->frame_internal;
+        *bytes += UVC_ATOMIC_LOAD(frame->data_buffer_len);
+    }
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_stream_pause(uvc_host_stream_hdl_t stream_hdl)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+
+    // We do not cancel the ongoing transfers here, it is not supported by USB Host Library
+    // By setting uvc_stream->dynamic.streaming = false; no frame callbacks will be called and the transfer can gracefully finish
+    if (!UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.streaming, false)) {
+        return ESP_OK; // Return immediately if already paused
+    }
+    uvc_stream_task_flush(uvc_stream);
+    uvc_host_frame_t *current_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+
+    if (current_frame) {
+        uvc_frame_return_current(uvc_stream, current_frame); // Processing of the last URB can still write to it
+    }
+    uvc_frame_latest_release(uvc_stream);
+    uvc_frame_queue_release(uvc_stream);
+
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_stream_unpause(uvc_host_stream_hdl_t stream_hdl)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+
+    ESP_RETURN_ON_ERROR(uvc_stream_rx_prepare(uvc_stream), TAG,);
+    return uvc_stream_transfers_submit(uvc_stream);
 }
 
 static void ctrl_xfer_cb(usb_transfer_t *transfer)
@@ -7,177 +7,445 @@
 #include <stdbool.h>
 #include <string.h> // For memcpy
 
+#include "esp_check.h"
 #include "esp_log.h"
 
 #include "uvc_stream.h" // For uvc_host_stream_pause()
 #include "uvc_types_priv.h"
 #include "uvc_check_priv.h"
 #include "uvc_frame_priv.h"
+#include "uvc_nal_priv.h"
+#include "uvc_mjpeg_priv.h"
 #include "uvc_critical_priv.h"
+#include "uvc_trace_priv.h"
 
 static const char *TAG = "uvc-isoc";
 
 /**
- * @brief Callback function for handling Isochronous USB transfers from a UVC camera.
- *
- * This function processes isochronous transfer packets, which may contain video frame data. The following key points
- * are handled in the transfer:
- *
- * - **Start of Frame (SoF)**: Detected by a change in Frame ID, which toggles between 0 and 1.
- * - **End of Frame (EoF)**: Signaled in the packet header.
- * - **Transfer Characteristics**:
- *   - **No CRC**: Data corruption is possible.
- *   - **No ACK**: Packets can be missed.
- *   - **Packet Header**: Each packet includes a header used to detect errors, missed packets, and other issues.
- *
- * The callback performs the following tasks:
- * 1. Checks the status of each isochronous packet and handles various USB transfer statuses (e.g., completed,
- *    error, device disconnected).
- * 2. Parses packet headers to detect the start of new frames, handles errors, and manages frame buffers.
- * 3. Aggregates valid data into a frame buffer, ensuring no buffer overflow occurs.
- * 4. Signals the end of a frame and invokes user-defined callbacks if necessary.
+ * @brief Update stream statistics with completed Isochronous transfer
  *
- * @param[in] transfer Pointer to the completed USB transfer structure.
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed USB transfer
  */
-void isoc_transfer_callback(usb_transfer_t *transfer)
+static void isoc_transfer_stats(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer)
 {
-    ESP_LOGD(TAG, "%s", __FUNCTION__);
-    uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
-
-    // USB_TRANSFER_STATUS_NO_DEVICE is set in transfer->status.
-    // Other error codes are saved in status of each ISOC packet descriptor
-    if (transfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
-        ESP_ERROR_CHECK(uvc_host_stream_pause(uvc_stream)); // This should never fail
-    }
-
-    if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
-        return; // If the streaming was turned off, we don't have to do anything
+    size_t received = 0;
+    bool failed = false;
+    for (int i = 0; i < transfer->num_isoc_packets; i++) {
+        const usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
+        switch (isoc_desc->status) {
+        case USB_TRANSFER_STATUS_COMPLETED: received += isoc_desc->actual_num_bytes; break;
+        case USB_TRANSFER_STATUS_ERROR:     UVC_ATOMIC_ADD(uvc_stream->stats.usb_error, 1); failed = true; break;
+        case USB_TRANSFER_STATUS_OVERFLOW:  UVC_ATOMIC_ADD(uvc_stream->stats.usb_overflow, 1); failed = true; break;
+        case USB_TRANSFER_STATUS_STALL:     UVC_ATOMIC_ADD(uvc_stream->stats.usb_stall, 1); failed = true; break;
+        case USB_TRANSFER_STATUS_TIMED_OUT:
+        case USB_TRANSFER_STATUS_SKIPPED:   UVC_ATOMIC_ADD(uvc_stream->stats.usb_missed, 1); break;
+        default: break;
+        }
     }
+    USB_CLASS_STATS_XFER(uvc_stream->constant.class_stats, received, !failed);
+    UVC_ATOMIC_ADD(uvc_stream->stats.urbs_completed, 1);
+    UVC_ATOMIC_ADD(uvc_stream->stats.urb_bytes, received);
+    UVC_ATOMIC_ADD(uvc_stream->stats.urb_capacity, transfer->num_bytes);
+}
 
+/**
+ * @brief Pass payload of Isochronous transfer to the user without frame assembly
+ *
+ * Each ISOC packet with payload data is described by one segment in scatter-gather list, its header is not copied.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed USB transfer
+ */
+static void isoc_transfer_payload(uvc_stream_t *uvc_stream, usb_transfer_t *transfer)
+{
+    uvc_host_payload_segment_t *segments = uvc_stream->constant.segments;
+    size_t num_segments = 0;
     const uint8_t *payload = transfer->data_buffer;
-    for (int i = 0; i < transfer->num_isoc_packets; i++) {
-        usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
+    for (int i = 0; i < transfer->num_isoc_packets; payload += transfer->isoc_packet_desc[i].num_bytes, i++) {
+        const usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
+        uvc_host_payload_segment_t *segment = &segments[num_segments];
 
-        // Check USB status
         switch (isoc_desc->status) {
         case USB_TRANSFER_STATUS_COMPLETED:
             break;
         case USB_TRANSFER_STATUS_NO_DEVICE:
         case USB_TRANSFER_STATUS_CANCELED:
             ESP_ERROR_CHECK(uvc_host_stream_pause(uvc_stream)); // This should never fail
-            return; // No need to process the rest
+            return;
         case USB_TRANSFER_STATUS_ERROR:
         case USB_TRANSFER_STATUS_OVERFLOW:
         case USB_TRANSFER_STATUS_STALL:
-            ESP_LOGW(TAG, "usb err %d", isoc_desc->status);
-            uvc_stream->single_thread.skip_current_frame = true;
-            goto next_isoc_packet; // Data corrupted
-
+            // Data lost: inform the user with empty segment
+            *segment = (uvc_host_payload_segment_t) {
+                .error = true,
+            };
+            num_segments++;
+            continue;
         case USB_TRANSFER_STATUS_TIMED_OUT:
         case USB_TRANSFER_STATUS_SKIPPED:
-            goto next_isoc_packet; // Skipped and timed out ISOC transfers are not an issue
+            continue;
         default:
             assert(false);
         }
 
-        // Check for Zero Length Packet
-        if (isoc_desc->actual_num_bytes == 0) {
-            goto next_isoc_packet;
+        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
+        if (isoc_desc->actual_num_bytes == 0 || payload_header->bHeaderLength > isoc_desc->actual_num_bytes) {
+            continue; // Zero length packet or invalid header
+        }
+        const bool start_of_frame = (uvc_stream->single_thread.current_frame_id != payload_header->bmHeaderInfo.frame_id);
+        uvc_stream->single_thread.current_frame_id = payload_header->bmHeaderInfo.frame_id;
+        *segment = (uvc_host_payload_segment_t) {
+            .data = payload + payload_header->bHeaderLength,
+            .data_len = isoc_desc->actual_num_bytes - payload_header->bHeaderLength,
+            .start_of_frame = start_of_frame,
+            .end_of_frame = payload_header->bmHeaderInfo.end_of_frame,
+            .error = payload_header->bmHeaderInfo.error,
+        };
+        if (segment->data_len || segment->start_of_frame || segment->end_of_frame || segment->error) {
+            num_segments++;
         }
+    }
+
+    if (num_segments && UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+        UVC_TRACE(CB_ENTER, transfer);
+        UVC_CLASS_STATS_CB_ENTER(uvc_stream);
+        uvc_stream->constant.payload_cb(segments, num_segments, uvc_stream->constant.cb_arg);
+        UVC_CLASS_STATS_CB_EXIT(uvc_stream);
+        UVC_TRACE(CB_EXIT, transfer);
+    }
+}
+
+// Flags of bmHeaderInfo that decide whether a packet only continues the frame in progress
+#define UVC_ISOC_HEADER_FID (1 << 0) // Frame ID
+#define UVC_ISOC_HEADER_EOF (1 << 1) // End of Frame
+#define UVC_ISOC_HEADER_ERR (1 << 6) // Error
+
+/**
+ * @brief Check that ISOC packet starts with a valid payload header
+ *
+ * @param[in] isoc_desc      Packet descriptor
+ * @param[in] payload_header Start of the packet
+ * @return true if the header fits into the packet
+ */
+static inline bool isoc_header_is_valid(const usb_isoc_packet_desc_t *isoc_desc, const uvc_payload_header_t *payload_header)
+{
+    return isoc_desc->actual_num_bytes >= sizeof(uvc_payload_header_t)
+           && payload_header->bHeaderLength >= sizeof(uvc_payload_header_t)
+           && payload_header->bHeaderLength <= isoc_desc->actual_num_bytes;
+}
 
-        // Check for start of new frame
+/**
+ * @brief Find run of ISOC packets that only carry data of the frame in progress
+ *
+ * These packets completed without USB error, have a valid header with the current Frame ID and neither error
+ * nor End of Frame flag. Their data can be appended to the frame without per-packet state handling.
+ *
+ * @param[in]  uvc_stream   UVC stream
+ * @param[in]  transfer     Completed USB transfer
+ * @param[in]  first        Index of the first packet of the run
+ * @param[in]  payload      Start of the first packet
+ * @param[out] data_len_ret Number of data bytes in the run, without headers
+ * @return Number of packets in the run, can be 0
+ */
+static int isoc_data_run(const uvc_stream_t *uvc_stream, const usb_transfer_t *transfer, int first, const uint8_t *payload, size_t *data_len_ret)
+{
+    const uint8_t expected_flags = uvc_stream->single_thread.current_frame_id; // No EoF, no error
+    size_t data_len = 0;
+    int i;
+    for (i = first; i < transfer->num_isoc_packets; payload += transfer->isoc_packet_desc[i].num_bytes, i++) {
+        const usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
         const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
-        const bool start_of_frame = (uvc_stream->single_thread.current_frame_id != payload_header->bmHeaderInfo.frame_id);
-        if (start_of_frame) {
-            // We detected start of new frame. Update Frame ID and start fetching this frame
-            uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
-            uvc_stream->single_thread.skip_current_frame = payload_header->bmHeaderInfo.error;
-
-            // Get free frame buffer for this new frame
-            UVC_ENTER_CRITICAL();
-            const bool need_new_frame = (uvc_stream->dynamic.streaming && !uvc_stream->dynamic.current_frame);
-            if (need_new_frame) {
-                UVC_EXIT_CRITICAL();
-                uvc_stream->dynamic.current_frame = uvc_frame_get_empty(uvc_stream);
-                if (uvc_stream->dynamic.current_frame == NULL) {
-                    // There is no free frame buffer now, skipping this frame
-                    uvc_stream->single_thread.skip_current_frame = true;
-
-                    // Inform the user about the underflow
-                    uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
-                    if (stream_cb) {
-                        const uvc_host_stream_event_data_t event = {
-                            .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
-                        };
-                        stream_cb(&event, uvc_stream->constant.cb_arg);
-                    }
-                    goto next_isoc_packet;
-                }
-            } else {
-                // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer
-                uvc_frame_reset(uvc_stream->dynamic.current_frame);
-                UVC_EXIT_CRITICAL();
-            }
+        if (isoc_desc->status != USB_TRANSFER_STATUS_COMPLETED
+                || !isoc_header_is_valid(isoc_desc, payload_header)
+                || (payload_header->bmHeaderInfo.val & (UVC_ISOC_HEADER_FID | UVC_ISOC_HEADER_EOF | UVC_ISOC_HEADER_ERR)) != expected_flags) {
+            break;
         }
+        data_len += isoc_desc->actual_num_bytes - payload_header->bHeaderLength;
+    }
+    *data_len_ret = data_len;
+    return i - first;
+}
 
-        // Check for error flag
-        if (payload_header->bmHeaderInfo.error) {
-            uvc_stream->single_thread.skip_current_frame = true;
+/**
+ * @brief Append run of data packets to the frame in progress
+ *
+ * Space in the frame buffer is reserved once for the whole run, slice callback is called once after the run.
+ * With region of interest, each packet is cropped by uvc_frame_add_data().
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame in progress
+ * @param[in] transfer   Completed USB transfer
+ * @param[in] first      Index of the first packet of the run
+ * @param[in] run        Number of packets in the run, from isoc_data_run()
+ * @param[in] payload    Start of the first packet
+ * @param[in] data_len   Number of data bytes in the run, from isoc_data_run()
+ * @return
+ *     - ESP_OK: Data appended
+ *     - ESP_ERR_INVALID_SIZE: Frame buffer overflow
+ */
+static esp_err_t isoc_data_run_append(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const usb_transfer_t *transfer,
+                                      int first, int run, const uint8_t *payload, size_t data_len)
+{
+    if (uvc_stream->constant.roi.row_len) {
+        for (int i = first; i < first + run; payload += transfer->isoc_packet_desc[i].num_bytes, i++) {
+            const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
+            const size_t packet_data_len = transfer->isoc_packet_desc[i].actual_num_bytes - payload_header->bHeaderLength;
+            uvc_frame_info_parse_header(uvc_stream, payload_header);
+            ESP_RETURN_ON_ERROR(uvc_frame_add_data(uvc_stream, frame, payload + payload_header->bHeaderLength, packet_data_len),
+                                TAG, "Frame buffer overflow");
         }
+    } else {
+        ESP_RETURN_ON_ERROR(uvc_frame_reserve(uvc_stream, frame, data_len), TAG, "Frame buffer overflow");
+        uint8_t *dst = frame->data + frame->data_len;
+        for (int i = first; i < first + run; payload += transfer->isoc_packet_desc[i].num_bytes, i++) {
+            const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
+            const size_t packet_data_len = transfer->isoc_packet_desc[i].actual_num_bytes - payload_header->bHeaderLength;
+            uvc_frame_info_parse_header(uvc_stream, payload_header);
+            memcpy(dst, payload + payload_header->bHeaderLength, packet_data_len);
+            dst += packet_data_len;
+        }
+        frame->data_len += data_len;
+    }
+    uvc_nal_scan(uvc_stream, frame);
+    uvc_frame_slice_deliver(uvc_stream, frame, false);
+    return ESP_OK;
+}
 
-        // Add received data to frame buffer
-        if (!uvc_stream->single_thread.skip_current_frame) {
-            const uint8_t *payload_data = payload + payload_header->bHeaderLength;
-            const size_t payload_data_len = isoc_desc->actual_num_bytes - payload_header->bHeaderLength;
-            uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+/**
+ * @brief Inform the user about frame buffer overflow and skip the frame
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void isoc_frame_overflow(uvc_stream_t *uvc_stream)
+{
+    uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_OVERFLOW);
+    uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
+    if (stream_cb) {
+        const uvc_host_stream_event_data_t event = {
+            .type = UVC_HOST_FRAME_BUFFER_OVERFLOW,
+        };
+        stream_cb(&event, uvc_stream->constant.cb_arg);
+    }
+}
+
+/**
+ * @brief Process one ISOC packet that needs state handling
+ *
+ * USB errors, Start of Frame, End of Frame and payload header errors are handled here. Packets that only continue
+ * the frame in progress are handled by isoc_data_run_append().
+ *
+ * @param[in]    uvc_stream    UVC stream
+ * @param[in]    isoc_desc     Packet descriptor
+ * @param[in]    payload       Start of the packet
+ * @param[inout] current_frame Frame in progress, updated on Start and End of Frame
+ * @return false if the stream was paused and the rest of the transfer must not be processed
+ */
+static bool isoc_packet_process(uvc_stream_t *uvc_stream, const usb_isoc_packet_desc_t *isoc_desc, const uint8_t *payload,
+                                uvc_host_frame_t **current_frame)
+{
+    // Check USB status
+    switch (isoc_desc->status) {
+    case USB_TRANSFER_STATUS_COMPLETED:
+        break;
+    case USB_TRANSFER_STATUS_NO_DEVICE:
+    case USB_TRANSFER_STATUS_CANCELED:
+        ESP_ERROR_CHECK(uvc_host_stream_pause(uvc_stream)); // This should never fail
+        return false; // No need to process the rest
+    case USB_TRANSFER_STATUS_ERROR:
+    case USB_TRANSFER_STATUS_OVERFLOW:
+    case USB_TRANSFER_STATUS_STALL:
+        ESP_LOGD(TAG, "usb err %d", isoc_desc->status); // Counted in stream statistics
+        uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_ERROR);
+        return true; // Data corrupted
+    case USB_TRANSFER_STATUS_TIMED_OUT:
+    case USB_TRANSFER_STATUS_SKIPPED:
+        uvc_stream->single_thread.frame_info.dropped_packets++;
+        return true; // Skipped and timed out ISOC transfers are not an issue
+    default:
+        assert(false);
+    }
 
-            esp_err_t ret = uvc_frame_add_data(current_frame, payload_data, payload_data_len);
-            if (ret != ESP_OK) {
-                // Frame buffer overflow, skip this frame
-                uvc_stream->single_thread.skip_current_frame = true;
+    // Check for Zero Length Packet
+    if (isoc_desc->actual_num_bytes == 0) {
+        return true;
+    }
+
+    // ISOC has no CRC, do not trust header length
+    const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
+    if (!isoc_header_is_valid(isoc_desc, payload_header)) {
+        uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_ERROR);
+        return true;
+    }
 
-                // Inform the user about the overflow
+    // Check for start of new frame
+    const bool start_of_frame = (uvc_stream->single_thread.current_frame_id != payload_header->bmHeaderInfo.frame_id);
+    if (start_of_frame) {
+        // We detected start of new frame. Update Frame ID and start fetching this frame
+        uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
+        uvc_stream->single_thread.skip_current_frame = false; // Error flag is checked below
+        uvc_frame_info_start(uvc_stream);
+        const bool decimated = uvc_frame_decimate(uvc_stream, payload_header);
+
+        // Get free frame buffer for this new frame
+        if (*current_frame) {
+            // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer.
+            // A decimated frame keeps it empty and returns it on End of Frame
+            uvc_frame_reset(*current_frame);
+            uvc_frame_slice_drop(uvc_stream);
+            UVC_ATOMIC_ADD(uvc_stream->stats.skipped_missed_eof, 1);
+        } else if (!decimated) {
+            uvc_host_frame_t *new_frame = uvc_frame_get_empty(uvc_stream);
+            if (new_frame == NULL) {
+                // There is no free frame buffer now, skipping this frame
+                uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_UNDERFLOW);
+
+                // Inform the user about the underflow
                 uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
                 if (stream_cb) {
                     const uvc_host_stream_event_data_t event = {
-                        .type = UVC_HOST_FRAME_BUFFER_OVERFLOW,
+                        .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
                     };
                     stream_cb(&event, uvc_stream->constant.cb_arg);
                 }
-                goto next_isoc_packet;
+                return true;
             }
+            uvc_frame_set_current(uvc_stream, new_frame);
+            *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame); // NULL if the stream was paused meanwhile
+        }
+    }
+
+    uvc_frame_info_parse_header(uvc_stream, payload_header);
+
+    // Check for error flag
+    if (payload_header->bmHeaderInfo.error) {
+        uvc_frame_skip(uvc_stream, UVC_FRAME_SKIP_ERROR);
+    }
+
+    // Add received data to frame buffer
+    if (!uvc_stream->single_thread.skip_current_frame && *current_frame) {
+        const uint8_t *payload_data = payload + payload_header->bHeaderLength;
+        const size_t payload_data_len = isoc_desc->actual_num_bytes - payload_header->bHeaderLength;
+
+        esp_err_t ret = uvc_frame_add_data(uvc_stream, *current_frame, payload_data, payload_data_len);
+        if (ret != ESP_OK) {
+            // Frame buffer overflow, skip this frame
+            isoc_frame_overflow(uvc_stream);
+            return true;
         }
+        uvc_nal_scan(uvc_stream, *current_frame);
+        uvc_frame_slice_deliver(uvc_stream, *current_frame, false);
+    }
 
-        // End of Frame. Pass the frame to user
-        if (payload_header->bmHeaderInfo.end_of_frame) {
-            bool return_frame = true; // In case streaming is stopped ATM, we must return the frame
+    // End of Frame. Pass the frame to user
+    if (payload_header->bmHeaderInfo.end_of_frame) {
+        bool return_frame = true; // In case streaming is stopped ATM, we must return the frame
 
-            // Check if the user did not stop the stream in the meantime
-            UVC_ENTER_CRITICAL();
-            uvc_host_frame_t *this_frame = uvc_stream->dynamic.current_frame;
-            uvc_stream->dynamic.current_frame = NULL; // Stop writing more data to this frame
+        // Check if the user did not stop the stream in the meantime
+        uvc_host_frame_t *this_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL); // Stop writing more data to this frame
+        *current_frame = NULL;
 
-            // Determine if we should invoke the frame callback:
-            // Only invoke the callback if streaming is active, a frame callback exists,
-            // and we have a valid frame to pass to the user.
-            const bool invoke_fb_callback = (uvc_stream->dynamic.streaming && uvc_stream->constant.frame_cb && this_frame && !uvc_stream->single_thread.skip_current_frame);
-            UVC_EXIT_CRITICAL();
+        // Determine if we should pass the frame to the user:
+        // Only if streaming is active, we have a valid frame and it passed the MJPEG integrity check, if enabled.
+        const bool frame_complete = (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && this_frame && !uvc_stream->single_thread.skip_current_frame
+                                     && uvc_mjpeg_check(uvc_stream, this_frame));
 
-            if (invoke_fb_callback) {
-                memcpy((uvc_host_stream_format_t *)&this_frame->vs_format, &uvc_stream->constant.vs_format, sizeof(uvc_host_stream_format_t));
-                return_frame = uvc_stream->constant.frame_cb(this_frame, uvc_stream->constant.cb_arg);
-            }
-            if (return_frame) {
-                // The user has processed the frame in his callback, return it back to empty queue
-                uvc_host_frame_return(uvc_stream, this_frame);
+        if (frame_complete) {
+            memcpy((uvc_host_stream_format_t *)&this_frame->vs_format, &uvc_stream->constant.vs_format, sizeof(uvc_host_stream_format_t));
+            uvc_frame_info_finish(uvc_stream, this_frame);
+            uvc_frame_slice_deliver(uvc_stream, this_frame, true);
+            uvc_frame_delivered(uvc_stream, this_frame);
+            return_frame = uvc_frame_pass_to_user(uvc_stream, this_frame);
+        } else {
+            uvc_frame_slice_drop(uvc_stream);
+        }
+        if (return_frame && this_frame) {
+            // The user has processed the frame in his callback, return it back to empty queue
+            uvc_host_frame_return(uvc_stream, this_frame);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Callback function for handling Isochronous USB transfers from a UVC camera.
+ *
+ * This function processes isochronous transfer packets, which may contain video frame data. The following key points
+ * are handled in the transfer:
+ *
+ * - **Start of Frame (SoF)**: Detected by a change in Frame ID, which toggles between 0 and 1.
+ * - **End of Frame (EoF)**: Signaled in the packet header.
+ * - **Transfer Characteristics**:
+ *   - **No CRC**: Data corruption is possible.
+ *   - **No ACK**: Packets can be missed.
+ *   - **Packet Header**: Each packet includes a header used to detect errors, missed packets, and other issues.
+ *
+ * Most packets of a transfer only continue the frame in progress. Runs of such packets are found with one combined
+ * check of status and header flags per packet and appended at once. The remaining packets (USB errors, Start and End
+ * of Frame, error flag) are processed one by one in isoc_packet_process().
+ *
+ * The frame in progress is loaded once per transfer: only this thread sets it, uvc_host_stream_pause() can clear it
+ * concurrently. That is detected on End of Frame and the frame is not delivered.
+ *
+ * @param[in] transfer Pointer to the completed USB transfer structure.
+ * @return true if the transfer shall be resubmitted
+ */
+bool isoc_transfer_process(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "%s", __FUNCTION__);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
+
+    // USB_TRANSFER_STATUS_NO_DEVICE is set in transfer->status.
+    // Other error codes are saved in status of each ISOC packet descriptor
+    if (transfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
+        ESP_ERROR_CHECK(uvc_host_stream_pause(uvc_stream)); // This should never fail
+    }
+
+    if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+        return false; // If the streaming was turned off, we don't have to do anything
+    }
+    isoc_transfer_stats(uvc_stream, transfer);
+
+    if (uvc_stream->constant.payload_cb) {
+        isoc_transfer_payload(uvc_stream, transfer);
+        return UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+    }
+
+    uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+    const uint8_t *payload = transfer->data_buffer;
+    int i = 0;
+    while (i < transfer->num_isoc_packets) {
+        // Fast path: append run of packets that continue the frame in progress
+        if (current_frame && !uvc_stream->single_thread.skip_current_frame) {
+            size_t data_len;
+            const int run = isoc_data_run(uvc_stream, transfer, i, payload, &data_len);
+            if (run) {
+                if (isoc_data_run_append(uvc_stream, current_frame, transfer, i, run, payload, data_len) != ESP_OK) {
+                    isoc_frame_overflow(uvc_stream);
+                }
+                for (const int end = i + run; i < end; i++) {
+                    payload += transfer->isoc_packet_desc[i].num_bytes;
+                }
+                continue;
             }
         }
-next_isoc_packet:
-        payload += isoc_desc->num_bytes;
-        continue;
+
+        // Slow path: packet that changes state of the stream
+        if (!isoc_packet_process(uvc_stream, &transfer->isoc_packet_desc[i], payload, &current_frame)) {
+            return false;
+        }
+        payload += transfer->isoc_packet_desc[i].num_bytes;
+        i++;
     }
 
-    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+    return UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+}
+
+void isoc_transfer_callback(usb_transfer_t *transfer)
+{
+    UVC_TRACE(COMPLETE, transfer);
+    if (isoc_transfer_process(transfer)) {
+        UVC_TRACE(RESUBMIT, transfer);
         usb_host_transfer_submit(transfer); // Restart the transfer
     }
 }
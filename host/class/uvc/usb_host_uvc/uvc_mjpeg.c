@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_mjpeg_priv.h"
+
+// JPEG markers, ITU-T T.81 table B.1
+#define JPEG_MARKER 0xFF
+#define JPEG_SOF0   0xC0 // SOF0..SOF15, except DHT, JPG and DAC
+#define JPEG_DHT    0xC4
+#define JPEG_JPG    0xC8
+#define JPEG_DAC    0xCC
+#define JPEG_SOF15  0xCF
+#define JPEG_RST0   0xD0
+#define JPEG_SOI    0xD8
+#define JPEG_EOI    0xD9
+#define JPEG_SOS    0xDA
+
+#define UVC_MJPEG_SEGMENTS_MAX  (64) // Header segments checked before Start of Scan. Typical camera frames have less than 10
+#define UVC_MJPEG_PADDING_MAX   (64) // Some cameras pad frames after EOI with zeros
+#define UVC_MJPEG_SIZE_DIVISOR  (8)  // Frames smaller than 1/n of the running average are considered truncated
+#define UVC_MJPEG_AVG_WEIGHT    (3)  // Running average of frame size gives new frames weight 1/2^n
+
+static inline bool uvc_mjpeg_is_sof(uint8_t marker)
+{
+    return marker >= JPEG_SOF0 && marker <= JPEG_SOF15 && marker != JPEG_DHT && marker != JPEG_JPG && marker != JPEG_DAC;
+}
+
+bool uvc_mjpeg_is_intact(const uint8_t *data, size_t len)
+{
+    if (len < 4 || data[0] != JPEG_MARKER || data[1] != JPEG_SOI) {
+        return false;
+    }
+
+    // EOI must end the frame. Truncated frames usually end in entropy-coded data
+    size_t end = len;
+    const size_t padding_end = (len > UVC_MJPEG_PADDING_MAX + 4) ? len - UVC_MJPEG_PADDING_MAX : 4;
+    while (end > padding_end && data[end - 1] == 0x00) {
+        end--;
+    }
+    if (data[end - 2] != JPEG_MARKER || data[end - 1] != JPEG_EOI) {
+        return false;
+    }
+
+    // Walk header segments up to Start of Scan. Each one is a marker followed by its big-endian length, which includes the length field
+    bool sof_found = false;
+    size_t pos = 2;
+    for (int i = 0; i < UVC_MJPEG_SEGMENTS_MAX; i++) {
+        if (pos >= end || data[pos] != JPEG_MARKER) {
+            return false;
+        }
+        while (pos < end && data[pos] == JPEG_MARKER) {
+            pos++; // Markers can be preceded by fill bytes
+        }
+        if (pos + 3 > end) {
+            return false;
+        }
+        const uint8_t marker = data[pos];
+        if (marker == 0x00 || marker == JPEG_SOI || marker == JPEG_EOI || (marker & 0xF8) == JPEG_RST0) {
+            return false; // Not expected in header
+        }
+        const size_t segment_len = ((size_t)data[pos + 1] << 8) | data[pos + 2];
+        if (segment_len < 2 || pos + 1 + segment_len > end) {
+            return false;
+        }
+        pos += 1 + segment_len;
+        if (uvc_mjpeg_is_sof(marker)) {
+            sof_found = true;
+        } else if (marker == JPEG_SOS) {
+            return sof_found && pos < end - 2; // Entropy-coded data must follow the scan header
+        }
+    }
+    return false;
+}
+
+bool uvc_mjpeg_check(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    const uvc_host_mjpeg_check_t check = uvc_stream->constant.mjpeg_check;
+    if (check == UVC_HOST_MJPEG_CHECK_OFF || uvc_stream->constant.vs_format.format != UVC_VS_FORMAT_MJPEG) {
+        return true;
+    }
+
+    bool intact = uvc_mjpeg_is_intact(frame->data, frame->data_len);
+    if (intact) {
+        // Lost packets in the middle of the frame leave SOI and EOI in place. Such frames are much smaller than recent ones.
+        // The average follows every frame with valid structure, so it adapts to real changes of the scene within a few frames
+        size_t *avg = &uvc_stream->single_thread.mjpeg_size_avg;
+        intact = (frame->data_len >= *avg / UVC_MJPEG_SIZE_DIVISOR);
+        if (*avg == 0) {
+            *avg = frame->data_len;
+        } else {
+            *avg = *avg - (*avg >> UVC_MJPEG_AVG_WEIGHT) + (frame->data_len >> UVC_MJPEG_AVG_WEIGHT);
+        }
+    }
+    if (intact) {
+        return true;
+    }
+
+    if (check == UVC_HOST_MJPEG_CHECK_DROP) {
+        UVC_ATOMIC_ADD(uvc_stream->stats.skipped_corrupted, 1);
+        USB_CLASS_STATS_DROP(uvc_stream->constant.class_stats, 1);
+        return false;
+    }
+    uvc_stream->single_thread.frame_info.corrupted = true;
+    return true;
+}
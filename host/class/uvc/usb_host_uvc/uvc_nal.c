@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <string.h> // For memcpy
+
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_nal_priv.h"
+
+#define UVC_NAL_NONE SIZE_MAX
+
+// H.264 nal_unit_type, ITU-T H.264 table 7-1
+#define H264_NAL_SLICE    1
+#define H264_NAL_IDR      5
+#define H264_NAL_SPS      7
+#define H264_NAL_PPS      8
+
+// H.265 nal_unit_type, ITU-T H.265 table 7-1
+#define H265_NAL_RSV_VCL_N14 14 // Even types up to 14 are sub-layer non-reference pictures
+#define H265_NAL_BLA_W_LP    16 // IRAP pictures: 16..21
+#define H265_NAL_RSV_IRAP_23 23
+#define H265_NAL_VCL_MAX     31
+#define H265_NAL_VPS         32
+#define H265_NAL_SPS         33
+#define H265_NAL_PPS         34
+
+static inline bool uvc_nal_format(const uvc_stream_t *uvc_stream)
+{
+    const enum uvc_host_stream_format format = uvc_stream->constant.vs_format.format;
+    return format == UVC_VS_FORMAT_H264 || format == UVC_VS_FORMAT_H265;
+}
+
+static inline bool uvc_nal_is_parameter_set(const uvc_stream_t *uvc_stream, uint8_t type)
+{
+    if (uvc_stream->constant.vs_format.format == UVC_VS_FORMAT_H264) {
+        return type == H264_NAL_SPS || type == H264_NAL_PPS;
+    }
+    return type >= H265_NAL_VPS && type <= H265_NAL_PPS;
+}
+
+/**
+ * @brief Classify NAL unit by its header and update flags of the frame
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] header     First byte of NAL unit header
+ * @return nal_unit_type
+ */
+static uint8_t uvc_nal_classify(uvc_stream_t *uvc_stream, uint8_t header)
+{
+    uvc_host_frame_info_t *info = &uvc_stream->single_thread.frame_info;
+    uint8_t type;
+    if (uvc_stream->constant.vs_format.format == UVC_VS_FORMAT_H264) {
+        type = header & 0x1F;
+        const bool nal_ref_idc = (header >> 5) & 0x03;
+        info->nal.keyframe |= (type == H264_NAL_IDR);
+        info->nal.reference |= (type >= H264_NAL_SLICE && type <= H264_NAL_IDR && nal_ref_idc);
+    } else {
+        type = (header >> 1) & 0x3F;
+        info->nal.keyframe |= (type >= H265_NAL_BLA_W_LP && type <= H265_NAL_RSV_IRAP_23);
+        info->nal.reference |= (type <= H265_NAL_VCL_MAX && !(type <= H265_NAL_RSV_VCL_N14 && (type % 2) == 0));
+    }
+    info->nal.parameter_sets |= uvc_nal_is_parameter_set(uvc_stream, type);
+    return type;
+}
+
+/**
+ * @brief Close the pending NAL unit
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @param[in] end        Offset of the first byte after the NAL unit
+ */
+static void uvc_nal_close(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame, size_t end)
+{
+    const size_t offset = uvc_stream->single_thread.nal_pending;
+    if (offset == UVC_NAL_NONE || offset >= end) {
+        return; // Start code without NAL unit header
+    }
+    const uint8_t type = uvc_nal_classify(uvc_stream, frame->data[offset]);
+
+    uvc_host_frame_info_t *info = &uvc_stream->single_thread.frame_info;
+    if (info->nal.num_units < UVC_HOST_FRAME_NAL_UNITS_MAX) {
+        info->nal.units[info->nal.num_units].offset = offset;
+        info->nal.units[info->nal.num_units].size = end - offset;
+        info->nal.units[info->nal.num_units].type = type;
+        info->nal.num_units++;
+    } else {
+        info->nal.overflow = true;
+    }
+}
+
+void uvc_nal_start(uvc_stream_t *uvc_stream)
+{
+    uvc_stream->single_thread.nal_scan_offset = 0;
+    uvc_stream->single_thread.nal_pending = UVC_NAL_NONE;
+}
+
+void uvc_nal_scan(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    if (!frame || !uvc_nal_format(uvc_stream)) {
+        return;
+    }
+
+    // Look at the last byte of every 3 byte window: if it is greater than 1, no start code 00 00 01 can overlap it
+    const uint8_t *data = frame->data;
+    const uint8_t *end = data + frame->data_len;
+    const uint8_t *p = data + uvc_stream->single_thread.nal_scan_offset;
+    while (p + 2 < end) {
+        if (p[2] > 1) {
+            p += 3;
+        } else if (p[2] == 0) {
+            p++;
+        } else {
+            if (p[0] == 0 && p[1] == 0) {
+                // Zero byte before 3 byte start code belongs to the start code (4 byte form) or is trailing zero
+                const size_t start_code = (p > data && p[-1] == 0) ? (size_t)(p - 1 - data) : (size_t)(p - data);
+                uvc_nal_close(uvc_stream, frame, start_code);
+                uvc_stream->single_thread.nal_pending = (p + 3) - data;
+            }
+            p += 3;
+        }
+    }
+    uvc_stream->single_thread.nal_scan_offset = p - data;
+}
+
+void uvc_nal_finish(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    if (!uvc_nal_format(uvc_stream)) {
+        return;
+    }
+    uvc_nal_scan(uvc_stream, frame);
+    uvc_nal_close(uvc_stream, frame, frame->data_len);
+    uvc_stream->single_thread.nal_pending = UVC_NAL_NONE;
+
+    const uvc_host_frame_info_t *info = &uvc_stream->single_thread.frame_info;
+    if (!info->nal.parameter_sets) {
+        return;
+    }
+
+    // Cache parameter sets of this frame. They are few and small, building them outside of the critical section
+    // would need another buffer of the same size
+    static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    UVC_ENTER_CRITICAL();
+    size_t len = 0;
+    for (int i = 0; i < info->nal.num_units; i++) {
+        if (!uvc_nal_is_parameter_set(uvc_stream, info->nal.units[i].type)) {
+            continue;
+        }
+        if (len + sizeof(start_code) + info->nal.units[i].size > sizeof(uvc_stream->parameter_sets.data)) {
+            len = 0; // Does not fit, rather report no parameter sets than incomplete ones
+            break;
+        }
+        memcpy(uvc_stream->parameter_sets.data + len, start_code, sizeof(start_code));
+        len += sizeof(start_code);
+        memcpy(uvc_stream->parameter_sets.data + len, frame->data + info->nal.units[i].offset, info->nal.units[i].size);
+        len += info->nal.units[i].size;
+    }
+    uvc_stream->parameter_sets.len = len;
+    UVC_EXIT_CRITICAL();
+}
+
+esp_err_t uvc_host_stream_get_parameter_sets(uvc_host_stream_hdl_t stream_hdl, uint8_t *buf, size_t *size)
+{
+    UVC_CHECK(stream_hdl && size, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(buf || *size == 0, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    esp_err_t ret = ESP_OK;
+
+    UVC_ENTER_CRITICAL();
+    const size_t len = uvc_stream->parameter_sets.len;
+    if (len == 0) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else if (len > *size) {
+        ret = ESP_ERR_INVALID_SIZE;
+    } else {
+        memcpy(buf, uvc_stream->parameter_sets.data, len);
+    }
+    UVC_EXIT_CRITICAL();
+    *size = len;
+    return ret;
+}
@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sdkconfig.h"
+#ifdef CONFIG_UVC_HOST_NEGOTIATION_CACHE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "nvs.h"
+#include "usb/usb_host.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_negotiation_cache_priv.h"
+
+static const char *TAG = "uvc-neg-cache";
+
+#define NEGOTIATION_CACHE_NAMESPACE "usb_uvc"
+#define NEGOTIATION_CACHE_VERSION   1
+
+/**
+ * @brief Identification of a format of a camera. All members are 4 bytes wide, so there is no padding to compare
+ */
+typedef struct {
+    uint32_t version;
+    uint32_t vid_pid;
+    uint32_t bcdDevice;
+    uint32_t bInterfaceNumber;
+    uint32_t high_speed;
+    uint32_t auto_bandwidth;
+    uvc_host_stream_format_t format;
+} negotiation_cache_id_t;
+
+typedef struct {
+    negotiation_cache_id_t id;
+    uvc_negotiation_cache_result_t result;
+} negotiation_cache_entry_t;
+
+/**
+ * @brief Fill identification of the format and NVS key derived from it
+ *
+ * NVS keys are limited to 15 characters, so the key is a hash. Collisions are detected by comparing the identification.
+ */
+static esp_err_t negotiation_cache_identify(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format,
+        negotiation_cache_id_t *id, char key[NVS_KEY_NAME_MAX_SIZE])
+{
+    const usb_device_desc_t *device_desc;
+    ESP_RETURN_ON_ERROR(usb_host_get_device_descriptor(uvc_stream->constant.dev_hdl, &device_desc), TAG,);
+
+    *id = (negotiation_cache_id_t) {
+        .version = NEGOTIATION_CACHE_VERSION,
+        .vid_pid = ((uint32_t)device_desc->idVendor << 16) | device_desc->idProduct,
+        .bcdDevice = device_desc->bcdDevice,
+        .bInterfaceNumber = uvc_stream->constant.bInterfaceNumber,
+        .high_speed = uvc_stream->constant.high_speed,
+        .auto_bandwidth = uvc_stream->constant.auto_bandwidth,
+        .format = *vs_format,
+    };
+
+    // FNV-1a over the identification
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i < sizeof(negotiation_cache_id_t); i++) {
+        hash = (hash ^ ((const uint8_t *)id)[i]) * 16777619;
+    }
+    snprintf(key, NVS_KEY_NAME_MAX_SIZE, "neg%08"PRIx32, hash);
+    return ESP_OK;
+}
+
+esp_err_t uvc_negotiation_cache_load(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format,
+                                     uvc_negotiation_cache_result_t *result)
+{
+    negotiation_cache_id_t id;
+    negotiation_cache_entry_t entry;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t nvs;
+
+    ESP_RETURN_ON_ERROR(negotiation_cache_identify(uvc_stream, vs_format, &id, key), TAG,);
+    // Unknown camera is not an error, namespace does not exist until the first result is stored
+    UVC_CHECK(nvs_open(NEGOTIATION_CACHE_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK, ESP_ERR_NOT_FOUND);
+    size_t size = sizeof(entry);
+    const esp_err_t ret = nvs_get_blob(nvs, key, &entry, &size);
+    nvs_close(nvs);
+    UVC_CHECK(ret == ESP_OK, ESP_ERR_NOT_FOUND);
+
+    if (size != sizeof(entry) || memcmp(&entry.id, &id, sizeof(id)) != 0) {
+        ESP_LOGD(TAG, "Entry %s does not match the format", key);
+        return ESP_ERR_NOT_FOUND;
+    }
+    *result = entry.result;
+    return ESP_OK;
+}
+
+esp_err_t uvc_negotiation_cache_store(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format)
+{
+    negotiation_cache_entry_t entry;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t nvs;
+
+    UVC_CHECK(uvc_stream->constant.commit.valid, ESP_ERR_INVALID_STATE);
+    memset(&entry, 0, sizeof(entry)); // Stored blobs are compared, padding must be defined
+    ESP_RETURN_ON_ERROR(negotiation_cache_identify(uvc_stream, vs_format, &entry.id, key), TAG,);
+    memcpy(&entry.result.vs_ctrl, &uvc_stream->constant.commit.vs_ctrl, sizeof(uvc_vs_ctrl_t));
+    entry.result.bAlternateSetting = uvc_stream->constant.bAlternateSetting;
+    entry.result.bEndpointAddress = uvc_stream->constant.bEndpointAddress;
+
+    esp_err_t ret = nvs_open(NEGOTIATION_CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret; // NVS was not initialized by the application
+    }
+    ret = nvs_set_blob(nvs, key, &entry, sizeof(entry));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t uvc_negotiation_cache_remove(const uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format)
+{
+    negotiation_cache_id_t id;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_handle_t nvs;
+
+    ESP_RETURN_ON_ERROR(negotiation_cache_identify(uvc_stream, vs_format, &id, key), TAG,);
+    ESP_RETURN_ON_ERROR(nvs_open(NEGOTIATION_CACHE_NAMESPACE, NVS_READWRITE, &nvs), TAG,);
+    esp_err_t ret = nvs_erase_key(nvs, key);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t uvc_negotiation_cache_clear(void)
+{
+    nvs_handle_t nvs;
+
+    esp_err_t ret = nvs_open(NEGOTIATION_CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK; // Nothing was stored yet
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "Could not open NVS");
+    ret = nvs_erase_all(nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+#endif // CONFIG_UVC_HOST_NEGOTIATION_CACHE
@@ -0,0 +1,252 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "usb/usb_class_stats.h"
+
+/*
+ * Registry is a global state, every scenario unregisters all its entries.
+ * CONFIG_USB_CLASS_STATS_MAX_ENTRIES is 4 in sdkconfig.defaults.
+ */
+
+static usb_class_stats_entry_t *entry_register(const char *driver, uint8_t intf_num, const char *label = nullptr)
+{
+    const usb_class_stats_info_t info = {
+        .driver = driver,
+        .dev_addr = 1,
+        .intf_num = intf_num,
+        .label = label,
+    };
+    usb_class_stats_entry_t *entry = nullptr;
+    REQUIRE(ESP_OK == usb_class_stats_register(&info, &entry));
+    REQUIRE(entry != nullptr);
+    return entry;
+}
+
+static usb_class_stats_snapshot_t entry_snapshot(uint8_t intf_num)
+{
+    usb_class_stats_snapshot_t snapshots[CONFIG_USB_CLASS_STATS_MAX_ENTRIES];
+    const size_t num = usb_class_stats_snapshot(snapshots, CONFIG_USB_CLASS_STATS_MAX_ENTRIES);
+    for (size_t i = 0; i < num; i++) {
+        if (snapshots[i].info.intf_num == intf_num) {
+            return snapshots[i];
+        }
+    }
+    FAIL("Entry of interface " << (int)intf_num << " not found");
+    return {};
+}
+
+static usb_class_stats_driver_mem_t driver_mem(const char *driver)
+{
+    usb_class_stats_driver_mem_t drivers[USB_CLASS_STATS_MEM_MAX_DRIVERS];
+    const size_t num = usb_class_stats_mem_drivers(drivers, USB_CLASS_STATS_MEM_MAX_DRIVERS);
+    for (size_t i = 0; i < num; i++) {
+        if (strcmp(drivers[i].driver, driver) == 0) {
+            return drivers[i];
+        }
+    }
+    FAIL("Driver " << driver << " not found");
+    return {};
+}
+
+SCENARIO("Statistics registry")
+{
+    usb_class_stats_snapshot_t snapshots[CONFIG_USB_CLASS_STATS_MAX_ENTRIES];
+    REQUIRE(0 == usb_class_stats_snapshot(snapshots, CONFIG_USB_CLASS_STATS_MAX_ENTRIES));
+
+    GIVEN("Invalid arguments") {
+        const usb_class_stats_info_t info = {.driver = "test"};
+        usb_class_stats_entry_t *entry;
+        THEN("Entry is not registered") {
+            CHECK(ESP_ERR_INVALID_ARG == usb_class_stats_register(nullptr, &entry));
+            CHECK(ESP_ERR_INVALID_ARG == usb_class_stats_register(&info, nullptr));
+        }
+    }
+
+    GIVEN("Entries are registered") {
+        usb_class_stats_entry_t *in = entry_register("test", 0, "in");
+        usb_class_stats_entry_t *out = entry_register("test", 1, "out");
+
+        THEN("They are in the snapshot with their owner") {
+            REQUIRE(2 == usb_class_stats_snapshot(snapshots, CONFIG_USB_CLASS_STATS_MAX_ENTRIES));
+            const usb_class_stats_snapshot_t snapshot = entry_snapshot(0);
+            CHECK(strcmp(snapshot.info.driver, "test") == 0);
+            CHECK(snapshot.info.dev_addr == 1);
+            CHECK(strcmp(snapshot.info.label, "in") == 0);
+            CHECK(1 == usb_class_stats_snapshot(snapshots, 1)); // Limited by the length of out
+        }
+
+        WHEN("Transfers, drops and queue levels are recorded") {
+            usb_class_stats_xfer(in, 64, true);
+            usb_class_stats_xfer(in, 10, true);
+            usb_class_stats_xfer(in, 0, false);
+            usb_class_stats_drop(in, 3);
+            usb_class_stats_drop(in, 0);
+            usb_class_stats_queue_level(in, 5);
+            usb_class_stats_queue_level(in, 2);
+
+            THEN("Counters of the entry are updated") {
+                const usb_class_stats_counters_t counters = entry_snapshot(0).counters;
+                CHECK(counters.bytes == 74);
+                CHECK(counters.transfers == 2);
+                CHECK(counters.errors == 1);
+                CHECK(counters.drops == 3);
+                CHECK(counters.queue_hwm == 5);
+            }
+
+            THEN("Other entries are not affected") {
+                const usb_class_stats_counters_t counters = entry_snapshot(1).counters;
+                CHECK(counters.bytes == 0);
+                CHECK(counters.transfers == 0);
+                CHECK(counters.queue_hwm == 0);
+            }
+
+            THEN("Counters are cleared by reset") {
+                usb_class_stats_reset();
+                const usb_class_stats_counters_t counters = entry_snapshot(0).counters;
+                CHECK(counters.bytes == 0);
+                CHECK(counters.transfers == 0);
+                CHECK(counters.errors == 0);
+                CHECK(counters.drops == 0);
+                CHECK(counters.queue_hwm == 0);
+            }
+        }
+
+        WHEN("User callbacks are recorded") {
+            usb_class_stats_cb_enter(out);
+            vTaskDelay(pdMS_TO_TICKS(10));
+            usb_class_stats_cb_exit(out);
+            usb_class_stats_cb_enter(out);
+            usb_class_stats_cb_exit(out);
+
+            THEN("Their count and time are counted") {
+                const usb_class_stats_counters_t counters = entry_snapshot(1).counters;
+                CHECK(counters.cb_count == 2);
+                CHECK(counters.cb_time_max_us >= 5000);
+                CHECK(counters.cb_time_total_us >= counters.cb_time_max_us);
+            }
+        }
+
+        WHEN("Recording into NULL entry") {
+            usb_class_stats_xfer(nullptr, 64, true);
+            usb_class_stats_drop(nullptr, 1);
+            usb_class_stats_queue_level(nullptr, 1);
+            usb_class_stats_cb_enter(nullptr);
+            usb_class_stats_cb_exit(nullptr);
+            usb_class_stats_unregister(nullptr);
+
+            THEN("Nothing is recorded") {
+                CHECK(entry_snapshot(0).counters.transfers == 0);
+                CHECK(entry_snapshot(1).counters.transfers == 0);
+            }
+        }
+
+        WHEN("All entries are in use") {
+            usb_class_stats_entry_t *more[] = {entry_register("test", 2), entry_register("test", 3)};
+            const usb_class_stats_info_t info = {.driver = "test", .intf_num = 4};
+            usb_class_stats_entry_t *entry = in;
+
+            THEN("Another entry is not registered") {
+                CHECK(ESP_ERR_NO_MEM == usb_class_stats_register(&info, &entry));
+                CHECK(entry == nullptr);
+            }
+
+            THEN("Unregistered entry can be registered again") {
+                usb_class_stats_unregister(more[1]);
+                more[1] = entry_register("test", 4);
+                CHECK(entry_snapshot(4).counters.transfers == 0);
+            }
+            usb_class_stats_unregister(more[0]);
+            usb_class_stats_unregister(more[1]);
+        }
+
+        usb_class_stats_unregister(in);
+        usb_class_stats_unregister(out);
+        THEN("Unregistered entries are not in the snapshot") {
+            CHECK(0 == usb_class_stats_snapshot(snapshots, CONFIG_USB_CLASS_STATS_MAX_ENTRIES));
+        }
+    }
+}
+
+SCENARIO("Heap accounting")
+{
+    usb_class_stats_reset(); // Peaks of drivers from other scenarios
+
+    GIVEN("Two entries of one driver") {
+        char driver_copy[] = "mem_test"; // Entries of a driver are summed up by the name, not by the pointer
+        usb_class_stats_entry_t *first = entry_register("mem_test", 0);
+        usb_class_stats_entry_t *second = entry_register(driver_copy, 1);
+
+        WHEN("Memory is allocated with different heap caps") {
+            usb_class_stats_mem_alloc(first, 100, MALLOC_CAP_DEFAULT);
+            usb_class_stats_mem_alloc(first, 512, MALLOC_CAP_DMA);
+            usb_class_stats_mem_alloc(first, 1000, MALLOC_CAP_SPIRAM);
+            usb_class_stats_mem_alloc(second, 64, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+            usb_class_stats_mem_alloc(nullptr, 64, MALLOC_CAP_DMA);
+
+            THEN("It is accounted to the entry by heap caps") {
+                const usb_class_stats_mem_t mem = entry_snapshot(0).mem;
+                CHECK(mem.current[USB_CLASS_STATS_MEM_DEFAULT] == 100);
+                CHECK(mem.current[USB_CLASS_STATS_MEM_DMA] == 512);
+                CHECK(mem.current[USB_CLASS_STATS_MEM_SPIRAM] == 1000);
+                CHECK(mem.peak_total == 1612);
+                CHECK(entry_snapshot(1).mem.current[USB_CLASS_STATS_MEM_DMA] == 64);
+            }
+
+            THEN("It is summed up for the driver") {
+                const usb_class_stats_mem_t mem = driver_mem("mem_test").mem;
+                CHECK(mem.current[USB_CLASS_STATS_MEM_DMA] == 576);
+                CHECK(mem.peak_total == 1676);
+            }
+
+            WHEN("Memory is freed") {
+                usb_class_stats_mem_free(first, 512, MALLOC_CAP_DMA);
+                usb_class_stats_mem_alloc(first, 256, MALLOC_CAP_DMA);
+
+                THEN("Current usage decreases, peaks are kept") {
+                    const usb_class_stats_mem_t mem = entry_snapshot(0).mem;
+                    CHECK(mem.current[USB_CLASS_STATS_MEM_DMA] == 256);
+                    CHECK(mem.peak[USB_CLASS_STATS_MEM_DMA] == 512);
+                    CHECK(mem.peak_total == 1612);
+                }
+
+                THEN("Peaks are lowered to current usage by reset") {
+                    usb_class_stats_reset();
+                    const usb_class_stats_mem_t mem = entry_snapshot(0).mem;
+                    CHECK(mem.peak[USB_CLASS_STATS_MEM_DMA] == 256);
+                    CHECK(mem.peak_total == 1356);
+                    CHECK(driver_mem("mem_test").mem.peak_total == 1420);
+                }
+            }
+
+            WHEN("An entry is unregistered") {
+                usb_class_stats_unregister(first);
+                first = nullptr;
+
+                THEN("Its memory is released from the driver, the peak is kept") {
+                    const usb_class_stats_mem_t mem = driver_mem("mem_test").mem;
+                    CHECK(mem.current[USB_CLASS_STATS_MEM_DEFAULT] == 0);
+                    CHECK(mem.current[USB_CLASS_STATS_MEM_DMA] == 64);
+                    CHECK(mem.current[USB_CLASS_STATS_MEM_SPIRAM] == 0);
+                    CHECK(mem.peak_total == 1676);
+                }
+            }
+        }
+
+        usb_class_stats_unregister(first);
+        usb_class_stats_unregister(second);
+        THEN("Memory of the driver is released with its entries") {
+            const usb_class_stats_mem_t mem = driver_mem("mem_test").mem;
+            for (int caps = 0; caps < USB_CLASS_STATS_MEM_CAPS_NUM; caps++) {
+                CHECK(mem.current[caps] == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,313 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Statistics entry, one per device, interface or stream of a class driver
+ */
+typedef struct usb_class_stats_entry_s usb_class_stats_entry_t;
+
+/**
+ * @brief Owner of a statistics entry
+ */
+typedef struct {
+    const char *driver;         /**< Class driver, e.g. "cdc_acm". Static string, not copied */
+    uint8_t dev_addr;           /**< Device address, 0 for device side drivers */
+    uint8_t intf_num;           /**< Interface number */
+    const char *label;          /**< Stream within the interface, e.g. "in", "out". Static string or NULL */
+} usb_class_stats_info_t;
+
+/**
+ * @brief Counters of a statistics entry
+ */
+typedef struct {
+    uint64_t bytes;             /**< Bytes transferred */
+    uint32_t transfers;         /**< Transfers completed successfully */
+    uint32_t errors;            /**< Transfers completed with an error */
+    uint32_t drops;             /**< Data dropped by the driver: reports, frames, samples, ... */
+    uint32_t cb_count;          /**< User callbacks */
+    uint64_t cb_time_total_us;  /**< Time spent in user callbacks */
+    uint32_t cb_time_max_us;    /**< Longest user callback */
+    uint32_t queue_hwm;         /**< High-water mark of the driver's queue or buffer */
+} usb_class_stats_counters_t;
+
+/**
+ * @brief Heap capabilities memory of class drivers is accounted by
+ */
+typedef enum {
+    USB_CLASS_STATS_MEM_DEFAULT,    /**< Internal memory: driver objects, ring buffers, descriptor copies */
+    USB_CLASS_STATS_MEM_DMA,        /**< DMA capable memory: transfer buffers */
+    USB_CLASS_STATS_MEM_SPIRAM,     /**< External RAM: frame buffers, caches */
+    USB_CLASS_STATS_MEM_CAPS_NUM,
+} usb_class_stats_mem_caps_t;
+
+/**
+ * @brief Heap usage of a statistics entry or a driver, in bytes
+ */
+typedef struct {
+    size_t current[USB_CLASS_STATS_MEM_CAPS_NUM];   /**< Allocated now */
+    size_t peak[USB_CLASS_STATS_MEM_CAPS_NUM];      /**< High-water mark of current */
+    size_t peak_total;                              /**< High-water mark of the sum of current over all heap caps */
+} usb_class_stats_mem_t;
+
+/**
+ * @brief Consistent copy of a statistics entry
+ */
+typedef struct {
+    usb_class_stats_info_t info;            /**< Owner of the entry */
+    usb_class_stats_counters_t counters;    /**< Counters */
+    usb_class_stats_mem_t mem;              /**< Heap usage, zero without CONFIG_USB_CLASS_STATS_MEM */
+} usb_class_stats_snapshot_t;
+
+/**
+ * @brief Maximum number of drivers whose heap usage is summed up
+ */
+#define USB_CLASS_STATS_MEM_MAX_DRIVERS 8
+
+/**
+ * @brief Heap usage of all entries of a class driver
+ *
+ * Memory of unregistered entries is released, the peaks are kept until usb_class_stats_reset().
+ */
+typedef struct {
+    const char *driver;                     /**< Class driver, as in usb_class_stats_info_t */
+    usb_class_stats_mem_t mem;              /**< Heap usage */
+} usb_class_stats_driver_mem_t;
+
+#if CONFIG_USB_CLASS_STATS
+/**
+ * @brief Register a statistics entry
+ *
+ * Called by class drivers when a device, interface or stream is opened.
+ *
+ * @param[in]  info      Owner of the entry, copied
+ * @param[out] entry_ret Entry, NULL on failure. Recording into a NULL entry does nothing
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: info or entry_ret is NULL
+ *   - ESP_ERR_NO_MEM: All CONFIG_USB_CLASS_STATS_MAX_ENTRIES entries are in use
+ */
+esp_err_t usb_class_stats_register(const usb_class_stats_info_t *info, usb_class_stats_entry_t **entry_ret);
+
+/**
+ * @brief Unregister a statistics entry
+ *
+ * @param[in] entry Entry, can be NULL
+ */
+void usb_class_stats_unregister(usb_class_stats_entry_t *entry);
+
+/**
+ * @brief Record a completed transfer
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] bytes Bytes transferred
+ * @param[in] ok    true if the transfer completed successfully, false to count an error
+ */
+void usb_class_stats_xfer(usb_class_stats_entry_t *entry, size_t bytes, bool ok);
+
+/**
+ * @brief Record dropped data
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] count Number of dropped reports, frames, samples, ...
+ */
+void usb_class_stats_drop(usb_class_stats_entry_t *entry, uint32_t count);
+
+/**
+ * @brief Record current level of the driver's queue or buffer, only the high-water mark is kept
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] level Current level
+ */
+void usb_class_stats_queue_level(usb_class_stats_entry_t *entry, uint32_t level);
+
+/**
+ * @brief Record entering a user callback
+ *
+ * Callbacks of one entry must not be nested.
+ *
+ * @param[in] entry Entry, can be NULL
+ */
+void usb_class_stats_cb_enter(usb_class_stats_entry_t *entry);
+
+/**
+ * @brief Record return from a user callback
+ *
+ * @param[in] entry Entry, can be NULL
+ */
+void usb_class_stats_cb_exit(usb_class_stats_entry_t *entry);
+
+/**
+ * @brief Copy all registered entries
+ *
+ * Lock-free: class drivers are never blocked by the reader, the reader retries an entry that was updated while copied.
+ *
+ * @param[out] out Snapshots
+ * @param[in]  max Length of out
+ * @return Number of entries copied to out
+ */
+size_t usb_class_stats_snapshot(usb_class_stats_snapshot_t *out, size_t max);
+
+/**
+ * @brief Reset counters of all registered entries
+ */
+void usb_class_stats_reset(void);
+
+#if CONFIG_USB_CLASS_STATS_MEM
+/**
+ * @brief Account memory allocated for an entry
+ *
+ * Memory still accounted to the entry is released when the entry is unregistered,
+ * so class drivers account buffers living as long as the entry only once.
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] size  Bytes allocated
+ * @param[in] caps  Heap capabilities of the allocation, MALLOC_CAP_SPIRAM and MALLOC_CAP_DMA are told apart
+ */
+void usb_class_stats_mem_alloc(usb_class_stats_entry_t *entry, size_t size, uint32_t caps);
+
+/**
+ * @brief Account memory freed before the entry is unregistered
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] size  Bytes freed
+ * @param[in] caps  Heap capabilities of the allocation, as passed to usb_class_stats_mem_alloc()
+ */
+void usb_class_stats_mem_free(usb_class_stats_entry_t *entry, size_t size, uint32_t caps);
+
+/**
+ * @brief Copy heap usage of all drivers
+ *
+ * @param[out] out Heap usage of the drivers
+ * @param[in]  max Length of out
+ * @return Number of drivers copied to out
+ */
+size_t usb_class_stats_mem_drivers(usb_class_stats_driver_mem_t *out, size_t max);
+
+#define USB_CLASS_STATS_MEM_ALLOC(entry, size, caps) usb_class_stats_mem_alloc((entry), (size), (caps))
+#define USB_CLASS_STATS_MEM_FREE(entry, size, caps)  usb_class_stats_mem_free((entry), (size), (caps))
+#endif // CONFIG_USB_CLASS_STATS_MEM
+
+#if CONFIG_USB_CLASS_STATS_CONSOLE
+/**
+ * @brief Register 'usb_stats' console command
+ *
+ * 'usb_stats' prints a table of all registered entries, 'usb_stats -r' resets the counters afterwards.
+ *
+ * @return
+ *   - ESP_OK: Success
+ *   - Error of esp_console_cmd_register()
+ */
+esp_err_t usb_class_stats_console_register(void);
+#endif // CONFIG_USB_CLASS_STATS_CONSOLE
+
+#define USB_CLASS_STATS_XFER(entry, bytes, ok)  usb_class_stats_xfer((entry), (bytes), (ok))
+#define USB_CLASS_STATS_DROP(entry, count)      usb_class_stats_drop((entry), (count))
+#define USB_CLASS_STATS_QUEUE(entry, level)     usb_class_stats_queue_level((entry), (level))
+#define USB_CLASS_STATS_CB_ENTER(entry)         usb_class_stats_cb_enter((entry))
+#define USB_CLASS_STATS_CB_EXIT(entry)          usb_class_stats_cb_exit((entry))
+#else
+static inline esp_err_t usb_class_stats_register(const usb_class_stats_info_t *info, usb_class_stats_entry_t **entry_ret)
+{
+    (void)info;
+    if (entry_ret) {
+        *entry_ret = NULL;
+    }
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline void usb_class_stats_unregister(usb_class_stats_entry_t *entry)
+{
+    (void)entry;
+}
+
+static inline size_t usb_class_stats_snapshot(usb_class_stats_snapshot_t *out, size_t max)
+{
+    (void)out;
+    (void)max;
+    return 0;
+}
+
+static inline void usb_class_stats_reset(void)
+{
+}
+
+#define USB_CLASS_STATS_XFER(entry, bytes, ok)  do { (void)(entry); (void)(bytes); (void)(ok); } while (0)
+#define USB_CLASS_STATS_DROP(entry, count)      do { (void)(entry); (void)(count); } while (0)
+#define USB_CLASS_STATS_QUEUE(entry, level)     do { (void)(entry); (void)(level); } while (0)
+#define USB_CLASS_STATS_CB_ENTER(entry)         do { (void)(entry); } while (0)
+#define USB_CLASS_STATS_CB_EXIT(entry)          do { (void)(entry); } while (0)
+#endif // CONFIG_USB_CLASS_STATS
+
+#if !CONFIG_USB_CLASS_STATS_MEM
+static inline size_t usb_class_stats_mem_drivers(usb_class_stats_driver_mem_t *out, size_t max)
+{
+    (void)out;
+    (void)max;
+    return 0;
+}
+
+#define USB_CLASS_STATS_MEM_ALLOC(entry, size, caps) do { (void)(entry); (void)(size); (void)(caps); } while (0)
+#define USB_CLASS_STATS_MEM_FREE(entry, size, caps)  do { (void)(entry); (void)(size); (void)(caps); } while (0)
+#endif // !CONFIG_USB_CLASS_STATS_MEM
+
+/**
+ * @brief Account buffer of a USB transfer
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] xfer  Pointer to usb_transfer_t, can be NULL
+ */
+#define USB_CLASS_STATS_MEM_XFER(entry, xfer) \
+    USB_CLASS_STATS_MEM_ALLOC((entry), (xfer) ? (xfer)->data_buffer_size : 0, MALLOC_CAP_DMA)
+
+/**
+ * @brief Allocate memory accounted to an entry
+ *
+ * @param[in] entry Entry, can be NULL
+ * @param[in] size  Bytes to allocate
+ * @param[in] caps  Heap capabilities
+ * @return Pointer to memory, NULL if not enough memory
+ */
+static inline void *usb_class_stats_malloc(usb_class_stats_entry_t *entry, size_t size, uint32_t caps)
+{
+    void *ptr = heap_caps_malloc(size, caps);
+    if (ptr) {
+        USB_CLASS_STATS_MEM_ALLOC(entry, size, caps);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Free memory allocated with usb_class_stats_malloc()
+ *
+ * @param[in] entry Entry the memory was allocated for, can be NULL
+ * @param[in] ptr   Pointer to memory, can be NULL
+ * @param[in] size  Bytes allocated
+ * @param[in] caps  Heap capabilities of the allocation
+ */
+static inline void usb_class_stats_free(usb_class_stats_entry_t *entry, void *ptr, size_t size, uint32_t caps)
+{
+    if (ptr) {
+        USB_CLASS_STATS_MEM_FREE(entry, size, caps);
+        heap_caps_free(ptr);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,325 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_check.h"
+#include "usb/usb_class_stats.h"
+
+static const char *TAG = "usb_class_stats";
+
+enum {
+    ENTRY_FREE,
+    ENTRY_CLAIMED,
+    ENTRY_ACTIVE,
+};
+
+/**
+ * @brief Statistics entry
+ *
+ * Updates are serialized by s_stats_lock and published with a sequence counter, odd while an update is in progress.
+ * Readers copy the entry without locking and retry if the sequence counter was odd or changed during the copy.
+ */
+struct usb_class_stats_entry_s {
+    atomic_int state;
+    atomic_uint seq;
+    usb_class_stats_info_t info;
+    usb_class_stats_counters_t counters;
+    int64_t cb_start_us;        // Written and read only by the task calling the user callbacks
+#if CONFIG_USB_CLASS_STATS_MEM
+    usb_class_stats_mem_t mem;
+    usb_class_stats_driver_mem_t *driver_mem; // Sum of all entries of the driver, NULL if there was no free slot
+#endif
+};
+
+static usb_class_stats_entry_t s_entries[CONFIG_USB_CLASS_STATS_MAX_ENTRIES];
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_USB_CLASS_STATS_MEM
+static usb_class_stats_driver_mem_t s_driver_mem[USB_CLASS_STATS_MEM_MAX_DRIVERS]; // Protected by s_stats_lock
+#endif
+
+static inline void entry_update_begin(usb_class_stats_entry_t *entry)
+{
+    portENTER_CRITICAL_SAFE(&s_stats_lock);
+    atomic_fetch_add_explicit(&entry->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void entry_update_end(usb_class_stats_entry_t *entry)
+{
+    atomic_fetch_add_explicit(&entry->seq, 1, memory_order_release);
+    portEXIT_CRITICAL_SAFE(&s_stats_lock);
+}
+
+#if CONFIG_USB_CLASS_STATS_MEM
+/**
+ * @brief Find or add heap usage slot of a driver
+ *
+ * @note Must be called with s_stats_lock taken
+ */
+static usb_class_stats_driver_mem_t *driver_mem_get(const char *driver)
+{
+    for (int i = 0; i < USB_CLASS_STATS_MEM_MAX_DRIVERS; i++) {
+        usb_class_stats_driver_mem_t *driver_mem = &s_driver_mem[i];
+        if (driver_mem->driver == NULL) {
+            driver_mem->driver = driver;
+            return driver_mem;
+        }
+        if (driver_mem->driver == driver || strcmp(driver_mem->driver, driver) == 0) {
+            return driver_mem;
+        }
+    }
+    return NULL;
+}
+
+static inline usb_class_stats_mem_caps_t mem_caps(uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return USB_CLASS_STATS_MEM_SPIRAM;
+    }
+    return (caps & MALLOC_CAP_DMA) ? USB_CLASS_STATS_MEM_DMA : USB_CLASS_STATS_MEM_DEFAULT;
+}
+
+static void mem_usage_update(usb_class_stats_mem_t *mem, usb_class_stats_mem_caps_t caps, int64_t delta)
+{
+    mem->current[caps] += delta;
+    size_t total = 0;
+    for (int i = 0; i < USB_CLASS_STATS_MEM_CAPS_NUM; i++) {
+        total += mem->current[i];
+    }
+    if (mem->current[caps] > mem->peak[caps]) {
+        mem->peak[caps] = mem->current[caps];
+    }
+    if (total > mem->peak_total) {
+        mem->peak_total = total;
+    }
+}
+
+static void mem_peak_reset(usb_class_stats_mem_t *mem)
+{
+    mem->peak_total = 0;
+    for (int i = 0; i < USB_CLASS_STATS_MEM_CAPS_NUM; i++) {
+        mem->peak[i] = mem->current[i];
+        mem->peak_total += mem->current[i];
+    }
+}
+
+/**
+ * @note Must be called between entry_update_begin() and entry_update_end()
+ */
+static void mem_update(usb_class_stats_entry_t *entry, usb_class_stats_mem_caps_t caps, int64_t delta)
+{
+    if (delta == 0) {
+        return;
+    }
+    mem_usage_update(&entry->mem, caps, delta);
+    if (entry->driver_mem) {
+        mem_usage_update(&entry->driver_mem->mem, caps, delta);
+    }
+}
+#endif // CONFIG_USB_CLASS_STATS_MEM
+
+esp_err_t usb_class_stats_register(const usb_class_stats_info_t *info, usb_class_stats_entry_t **entry_ret)
+{
+    ESP_RETURN_ON_FALSE(info && entry_ret, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    *entry_ret = NULL;
+    for (int i = 0; i < CONFIG_USB_CLASS_STATS_MAX_ENTRIES; i++) {
+        usb_class_stats_entry_t *entry = &s_entries[i];
+        int expected = ENTRY_FREE;
+        if (atomic_compare_exchange_strong(&entry->state, &expected, ENTRY_CLAIMED)) {
+            entry_update_begin(entry);
+            entry->info = *info;
+            memset(&entry->counters, 0, sizeof(entry->counters));
+#if CONFIG_USB_CLASS_STATS_MEM
+            memset(&entry->mem, 0, sizeof(entry->mem));
+            entry->driver_mem = driver_mem_get(info->driver);
+#endif
+            atomic_store_explicit(&entry->state, ENTRY_ACTIVE, memory_order_relaxed);
+            entry_update_end(entry);
+            *entry_ret = entry;
+            return ESP_OK;
+        }
+    }
+    ESP_LOGW(TAG, "No free entry for %s, increase CONFIG_USB_CLASS_STATS_MAX_ENTRIES", info->driver);
+    return ESP_ERR_NO_MEM;
+}
+
+void usb_class_stats_unregister(usb_class_stats_entry_t *entry)
+{
+    if (entry == NULL) {
+        return;
+    }
+    entry_update_begin(entry);
+    atomic_store_explicit(&entry->state, ENTRY_FREE, memory_order_relaxed);
+#if CONFIG_USB_CLASS_STATS_MEM
+    // Buffers of the entry are freed together with it
+    for (int caps = 0; caps < USB_CLASS_STATS_MEM_CAPS_NUM; caps++) {
+        mem_update(entry, caps, -(int64_t)entry->mem.current[caps]);
+    }
+#endif
+    entry_update_end(entry);
+}
+
+void usb_class_stats_xfer(usb_class_stats_entry_t *entry, size_t bytes, bool ok)
+{
+    if (entry == NULL) {
+        return;
+    }
+    entry_update_begin(entry);
+    entry->counters.bytes += bytes;
+    if (ok) {
+        entry->counters.transfers++;
+    } else {
+        entry->counters.errors++;
+    }
+    entry_update_end(entry);
+}
+
+void usb_class_stats_drop(usb_class_stats_entry_t *entry, uint32_t count)
+{
+    if (entry == NULL || count == 0) {
+        return;
+    }
+    entry_update_begin(entry);
+    entry->counters.drops += count;
+    entry_update_end(entry);
+}
+
+void usb_class_stats_queue_level(usb_class_stats_entry_t *entry, uint32_t level)
+{
+    // The high-water mark only grows, so it can be checked before taking the lock
+    if (entry == NULL || level <= entry->counters.queue_hwm) {
+        return;
+    }
+    entry_update_begin(entry);
+    if (level > entry->counters.queue_hwm) {
+        entry->counters.queue_hwm = level;
+    }
+    entry_update_end(entry);
+}
+
+void usb_class_stats_cb_enter(usb_class_stats_entry_t *entry)
+{
+    if (entry) {
+        entry->cb_start_us = esp_timer_get_time();
+    }
+}
+
+void usb_class_stats_cb_exit(usb_class_stats_entry_t *entry)
+{
+    if (entry == NULL) {
+        return;
+    }
+    const uint32_t cb_time_us = (uint32_t)(esp_timer_get_time() - entry->cb_start_us);
+    entry_update_begin(entry);
+    entry->counters.cb_count++;
+    entry->counters.cb_time_total_us += cb_time_us;
+    if (cb_time_us > entry->counters.cb_time_max_us) {
+        entry->counters.cb_time_max_us = cb_time_us;
+    }
+    entry_update_end(entry);
+}
+
+/**
+ * @brief Copy one entry without locking
+ *
+ * @return true if the entry was active during the copy
+ */
+static bool entry_read(usb_class_stats_entry_t *entry, usb_class_stats_snapshot_t *out)
+{
+    unsigned seq_begin, seq_end;
+    bool active;
+    do {
+        seq_begin = atomic_load_explicit(&entry->seq, memory_order_acquire);
+        if (seq_begin & 1) {
+            continue; // Update in progress on the other core
+        }
+        active = atomic_load_explicit(&entry->state, memory_order_relaxed) == ENTRY_ACTIVE;
+        out->info = entry->info;
+        out->counters = entry->counters;
+#if CONFIG_USB_CLASS_STATS_MEM
+        out->mem = entry->mem;
+#else
+        memset(&out->mem, 0, sizeof(out->mem));
+#endif
+        atomic_thread_fence(memory_order_acquire);
+        seq_end = atomic_load_explicit(&entry->seq, memory_order_relaxed);
+    } while ((seq_begin & 1) || seq_begin != seq_end);
+    return active;
+}
+
+size_t usb_class_stats_snapshot(usb_class_stats_snapshot_t *out, size_t max)
+{
+    size_t num = 0;
+    for (int i = 0; i < CONFIG_USB_CLASS_STATS_MAX_ENTRIES && num < max; i++) {
+        if (atomic_load(&s_entries[i].state) == ENTRY_FREE) {
+            continue;
+        }
+        if (entry_read(&s_entries[i], &out[num])) {
+            num++;
+        }
+    }
+    return num;
+}
+
+void usb_class_stats_reset(void)
+{
+    for (int i = 0; i < CONFIG_USB_CLASS_STATS_MAX_ENTRIES; i++) {
+        usb_class_stats_entry_t *entry = &s_entries[i];
+        entry_update_begin(entry);
+        memset(&entry->counters, 0, sizeof(entry->counters));
+#if CONFIG_USB_CLASS_STATS_MEM
+        mem_peak_reset(&entry->mem);
+#endif
+        entry_update_end(entry);
+    }
+#if CONFIG_USB_CLASS_STATS_MEM
+    portENTER_CRITICAL_SAFE(&s_stats_lock);
+    for (int i = 0; i < USB_CLASS_STATS_MEM_MAX_DRIVERS; i++) {
+        mem_peak_reset(&s_driver_mem[i].mem);
+    }
+    portEXIT_CRITICAL_SAFE(&s_stats_lock);
+#endif
+}
+
+#if CONFIG_USB_CLASS_STATS_MEM
+void usb_class_stats_mem_alloc(usb_class_stats_entry_t *entry, size_t size, uint32_t caps)
+{
+    if (entry == NULL) {
+        return;
+    }
+    entry_update_begin(entry);
+    mem_update(entry, mem_caps(caps), (int64_t)size);
+    entry_update_end(entry);
+}
+
+void usb_class_stats_mem_free(usb_class_stats_entry_t *entry, size_t size, uint32_t caps)
+{
+    if (entry == NULL) {
+        return;
+    }
+    const usb_class_stats_mem_caps_t mem_cap = mem_caps(caps);
+    entry_update_begin(entry);
+    assert(entry->mem.current[mem_cap] >= size);
+    mem_update(entry, mem_cap, -(int64_t)size);
+    entry_update_end(entry);
+}
+
+size_t usb_class_stats_mem_drivers(usb_class_stats_driver_mem_t *out, size_t max)
+{
+    size_t num = 0;
+    portENTER_CRITICAL_SAFE(&s_stats_lock);
+    for (int i = 0; i < USB_CLASS_STATS_MEM_MAX_DRIVERS && num < max && s_driver_mem[i].driver; i++) {
+        out[num++] = s_driver_mem[i];
+    }
+    portEXIT_CRITICAL_SAFE(&s_stats_lock);
+    return num;
+}
+#endif // CONFIG_USB_CLASS_STATS_MEM
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_console.h"
+#include "usb/usb_class_stats.h"
+
+static int usb_stats_cmd(int argc, char **argv)
+{
+    const bool reset = (argc > 1 && strcmp(argv[1], "-r") == 0);
+    usb_class_stats_snapshot_t *snapshots = calloc(CONFIG_USB_CLASS_STATS_MAX_ENTRIES, sizeof(usb_class_stats_snapshot_t));
+    if (snapshots == NULL) {
+        printf("Not enough memory\n");
+        return 1;
+    }
+    const size_t num = usb_class_stats_snapshot(snapshots, CONFIG_USB_CLASS_STATS_MAX_ENTRIES);
+
+    printf("%-10s %4s %4s %-6s %12s %10s %8s %8s %10s %8s %8s %6s\n",
+           "Driver", "Addr", "Intf", "Label", "Bytes", "Xfers", "Errors", "Drops", "Callbacks", "CbAvg", "CbMax", "QueHWM");
+    for (size_t i = 0; i < num; i++) {
+        const usb_class_stats_info_t *info = &snapshots[i].info;
+        const usb_class_stats_counters_t *c = &snapshots[i].counters;
+        const uint32_t cb_avg_us = c->cb_count ? (uint32_t)(c->cb_time_total_us / c->cb_count) : 0;
+        printf("%-10s %4u %4u %-6s %12" PRIu64 " %10" PRIu32 " %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %6" PRIu32 "us %6" PRIu32 "us %6" PRIu32 "\n",
+               info->driver, info->dev_addr, info->intf_num, info->label ? info->label : "-",
+               c->bytes, c->transfers, c->errors, c->drops, c->cb_count, cb_avg_us, c->cb_time_max_us, c->queue_hwm);
+    }
+
+#if CONFIG_USB_CLASS_STATS_MEM
+    printf("\n%-10s %4s %4s %-6s %10s %10s %10s %10s\n", "Driver", "Addr", "Intf", "Label", "Internal", "DMA", "SPIRAM", "PeakTotal");
+    for (size_t i = 0; i < num; i++) {
+        const usb_class_stats_info_t *info = &snapshots[i].info;
+        const usb_class_stats_mem_t *m = &snapshots[i].mem;
+        printf("%-10s %4u %4u %-6s %10zu %10zu %10zu %10zu\n",
+               info->driver, info->dev_addr, info->intf_num, info->label ? info->label : "-",
+               m->current[USB_CLASS_STATS_MEM_DEFAULT], m->current[USB_CLASS_STATS_MEM_DMA],
+               m->current[USB_CLASS_STATS_MEM_SPIRAM], m->peak_total);
+    }
+    usb_class_stats_driver_mem_t drivers[USB_CLASS_STATS_MEM_MAX_DRIVERS];
+    const size_t driver_num = usb_class_stats_mem_drivers(drivers, USB_CLASS_STATS_MEM_MAX_DRIVERS);
+    printf("\n%-10s %21s %21s %21s %10s\n", "Driver", "Internal now/peak", "DMA now/peak", "SPIRAM now/peak", "PeakTotal");
+    for (size_t i = 0; i < driver_num; i++) {
+        const usb_class_stats_mem_t *m = &drivers[i].mem;
+        printf("%-10s %10zu/%-10zu %10zu/%-10zu %10zu/%-10zu %10zu\n", drivers[i].driver,
+               m->current[USB_CLASS_STATS_MEM_DEFAULT], m->peak[USB_CLASS_STATS_MEM_DEFAULT],
+               m->current[USB_CLASS_STATS_MEM_DMA], m->peak[USB_CLASS_STATS_MEM_DMA],
+               m->current[USB_CLASS_STATS_MEM_SPIRAM], m->peak[USB_CLASS_STATS_MEM_SPIRAM], m->peak_total);
+    }
+#endif // CONFIG_USB_CLASS_STATS_MEM
+    free(snapshots);
+
+    if (reset) {
+        usb_class_stats_reset();
+    }
+    return 0;
+}
+
+esp_err_t usb_class_stats_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "usb_stats",
+        .help = "Print statistics of USB class drivers, -r resets them afterwards",
+        .hint = "[-r]",
+        .func = &usb_stats_cmd,
+    };
+    return esp_console_cmd_register(&cmd);
+}
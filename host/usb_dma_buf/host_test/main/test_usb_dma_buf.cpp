@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "esp_heap_caps.h"
+#include "usb/usb_dma_buf.h"
+
+/*
+ * Linux target has no cache: USB_DMA_BUF_CACHE_LINE is 1 and buffers are aligned to a word.
+ * Cache sync does nothing and USB DMA cannot reach external memory, as on targets older than esp32p4.
+ */
+
+static bool is_zeroed(const void *buf, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (((const uint8_t *)buf)[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SCENARIO("Alignment of sizes")
+{
+    GIVEN("Target without cache") {
+        THEN("Sizes are rounded up to a word") {
+            CHECK(USB_DMA_BUF_CACHE_LINE == 1);
+            CHECK(USB_DMA_BUF_ALIGN == 4);
+            CHECK(usb_dma_buf_cache_align_up(13) == 13);
+            CHECK(usb_dma_buf_align_up(0) == 0);
+            CHECK(usb_dma_buf_align_up(1) == 4);
+            CHECK(usb_dma_buf_align_up(4) == 4);
+            CHECK(usb_dma_buf_align_up(5) == 8);
+        }
+    }
+}
+
+SCENARIO("DMA buffer allocation")
+{
+    GIVEN("Buffer allocated with default placement") {
+        uint8_t *buf = (uint8_t *)usb_dma_buf_alloc(10, 0);
+        REQUIRE(buf != nullptr);
+
+        THEN("It is aligned and zeroed") {
+            CHECK((uintptr_t)buf % USB_DMA_BUF_ALIGN == 0);
+            CHECK(is_zeroed(buf, usb_dma_buf_align_up(10)));
+            CHECK_FALSE(usb_dma_buf_is_external(buf));
+        }
+
+        THEN("It is DMA ready for its aligned size only") {
+            CHECK(usb_dma_buf_is_dma_ready(buf, usb_dma_buf_align_up(10)));
+            CHECK_FALSE(usb_dma_buf_is_dma_ready(buf, 10));
+            CHECK_FALSE(usb_dma_buf_is_dma_ready(buf + 1, USB_DMA_BUF_ALIGN));
+            CHECK_FALSE(usb_dma_buf_is_dma_ready(nullptr, USB_DMA_BUF_ALIGN));
+        }
+
+        THEN("Cache sync succeeds") {
+            CHECK(ESP_OK == usb_dma_buf_sync_to_device(buf, 10));
+            CHECK(ESP_OK == usb_dma_buf_sync_from_device(buf, usb_dma_buf_align_up(10)));
+        }
+        usb_dma_buf_free(buf);
+    }
+
+    GIVEN("Buffer preferring external memory") {
+        void *buf = usb_dma_buf_alloc(64, USB_DMA_BUF_FLAG_PSRAM);
+        THEN("It falls back to internal memory") {
+            REQUIRE(buf != nullptr);
+            CHECK_FALSE(usb_dma_buf_is_external(buf));
+        }
+        usb_dma_buf_free(buf);
+    }
+
+    GIVEN("Buffer with explicit alignment") {
+        uint8_t *buf = (uint8_t *)usb_dma_buf_alloc_caps(100, 64, MALLOC_CAP_INTERNAL);
+        REQUIRE(buf != nullptr);
+
+        THEN("It is aligned as requested and zeroed") {
+            CHECK((uintptr_t)buf % 64 == 0);
+            CHECK(is_zeroed(buf, 128)); // Size is rounded up to the alignment
+            CHECK(usb_dma_buf_is_dma_ready(buf, 128));
+        }
+        usb_dma_buf_free(buf);
+    }
+
+    GIVEN("Invalid requests") {
+        THEN("No buffer is allocated") {
+            CHECK(usb_dma_buf_alloc(0, 0) == nullptr);
+            CHECK(usb_dma_buf_alloc_caps(0, 0, MALLOC_CAP_INTERNAL) == nullptr);
+            CHECK(usb_dma_buf_alloc_caps(64, 48, MALLOC_CAP_INTERNAL) == nullptr); // Not a power of two
+            CHECK(usb_dma_buf_alloc_caps(64, 0, MALLOC_CAP_SPIRAM) == nullptr); // Not reachable by USB DMA
+        }
+
+        THEN("Freeing NULL does nothing") {
+            usb_dma_buf_free(nullptr);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Cache line of internal memory accessed by USB DMA
+ *
+ * On targets with internal memory behind L1 cache (esp32p4), the USB Host Library and TinyUSB sync transfer buffers
+ * with the cache. Each buffer, and each part of a buffer that is synced on its own, must start at a cache line.
+ * 1 on targets without such cache.
+ */
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+#define USB_DMA_BUF_CACHE_LINE      (CONFIG_CACHE_L1_CACHE_LINE_SIZE)
+#else
+#define USB_DMA_BUF_CACHE_LINE      (1)
+#endif
+
+/**
+ * @brief Alignment of buffers accessed by USB DMA: cache line, but at least a word
+ */
+#define USB_DMA_BUF_ALIGN           (USB_DMA_BUF_CACHE_LINE > 4 ? USB_DMA_BUF_CACHE_LINE : 4)
+
+/**
+ * @brief Round size up to USB_DMA_BUF_CACHE_LINE
+ *
+ * @param[in] size Size in bytes
+ * @return Size rounded up, so data placed behind it starts at a cache line
+ */
+static inline size_t usb_dma_buf_cache_align_up(size_t size)
+{
+    return (size + USB_DMA_BUF_CACHE_LINE - 1) / USB_DMA_BUF_CACHE_LINE * USB_DMA_BUF_CACHE_LINE;
+}
+
+/**
+ * @brief Round size up to USB_DMA_BUF_ALIGN
+ *
+ * @param[in] size Size in bytes
+ * @return Size rounded up, so the buffer does not share a cache line with other data
+ */
+static inline size_t usb_dma_buf_align_up(size_t size)
+{
+    return (size + USB_DMA_BUF_ALIGN - 1) / USB_DMA_BUF_ALIGN * USB_DMA_BUF_ALIGN;
+}
+
+#define USB_DMA_BUF_FLAG_PSRAM      (1 << 0) /**< Prefer external memory, fall back to internal memory */
+
+/**
+ * @brief Allocate a zeroed buffer for USB DMA
+ *
+ * The buffer starts at a cache line and its size is rounded up to whole cache lines,
+ * so syncing it never touches neighbouring data.
+ *
+ * @param[in] size  Size in bytes
+ * @param[in] flags USB_DMA_BUF_FLAG_* or 0
+ * @return Buffer, NULL if out of memory. Free with usb_dma_buf_free()
+ */
+void *usb_dma_buf_alloc(size_t size, uint32_t flags);
+
+/**
+ * @brief Allocate a zeroed buffer for USB DMA from memory with given capabilities
+ *
+ * MALLOC_CAP_DMA is added to caps. The alignment is raised to the cache line of the memory if needed,
+ * and the size is rounded up to the alignment. External memory (MALLOC_CAP_SPIRAM) is reachable by USB DMA of esp32p4 only.
+ *
+ * @param[in] size  Size in bytes
+ * @param[in] align Alignment in bytes, power of two. 0 for the cache line of the memory
+ * @param[in] caps  Memory capabilities, passed to heap_caps_aligned_calloc()
+ * @return Buffer, NULL if out of memory or USB DMA cannot reach the memory. Free with usb_dma_buf_free()
+ */
+void *usb_dma_buf_alloc_caps(size_t size, size_t align, uint32_t caps);
+
+/**
+ * @brief Free a buffer allocated with usb_dma_buf_alloc() or usb_dma_buf_alloc_caps()
+ *
+ * @param[in] buf Buffer, can be NULL
+ */
+void usb_dma_buf_free(void *buf);
+
+/**
+ * @brief Check whether the buffer is placed in external memory (PSRAM)
+ *
+ * @param[in] buf Buffer
+ * @return true if the buffer is in external memory. Always false on targets whose USB DMA cannot reach it
+ */
+bool usb_dma_buf_is_external(const void *buf);
+
+/**
+ * @brief Write back CPU cache of the buffer, before USB DMA reads it
+ *
+ * Does nothing if the buffer is not cached. Not needed for buffers of usb_transfer_t, which are synced by the USB Host Library.
+ *
+ * @param[in] buf  Buffer
+ * @param[in] size Size in bytes
+ * @return
+ *   - ESP_OK: Success
+ *   - Error of esp_cache_msync()
+ */
+esp_err_t usb_dma_buf_sync_to_device(void *buf, size_t size);
+
+/**
+ * @brief Invalidate CPU cache of the buffer, after USB DMA wrote it
+ *
+ * Does nothing if the buffer is not cached. Buffer and size must be aligned to the cache line of the memory, as done by usb_dma_buf_alloc().
+ *
+ * @param[in] buf  Buffer
+ * @param[in] size Size in bytes
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Buffer or size is not aligned
+ *   - Error of esp_cache_msync()
+ */
+esp_err_t usb_dma_buf_sync_from_device(void *buf, size_t size);
+
+/**
+ * @brief Check whether USB DMA can access the buffer directly
+ *
+ * The buffer must be DMA capable, and the buffer and its size aligned to the cache line of the memory.
+ * Class drivers use this to decide between zero-copy transfer and a bounce buffer.
+ *
+ * @param[in] buf  Buffer
+ * @param[in] size Size in bytes
+ * @return true if the buffer can be transferred without copying
+ */
+bool usb_dma_buf_is_dma_ready(const void *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
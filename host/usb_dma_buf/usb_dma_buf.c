@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include "esp_idf_version.h"
+#include "esp_heap_caps.h"
+#include "usb/usb_dma_buf.h"
+#if CONFIG_IDF_TARGET_LINUX
+#define USB_DMA_BUF_CACHE_SYNC 0 // Host tests: no cache, all memory is DMA capable
+#else
+#include "esp_memory_utils.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#include "esp_cache.h"
+#define USB_DMA_BUF_CACHE_SYNC 1
+#else
+#define USB_DMA_BUF_CACHE_SYNC 0 // No target supported by IDF 5.0 and older needs cache sync of USB buffers
+#endif
+#endif // CONFIG_IDF_TARGET_LINUX
+
+#if CONFIG_IDF_TARGET_ESP32P4
+// USB OTG DMA of esp32p4 reaches PSRAM, older targets access internal memory only
+#define USB_DMA_BUF_EXT_RAM_DMA 1
+#else
+#define USB_DMA_BUF_EXT_RAM_DMA 0
+#endif
+
+/**
+ * @brief Alignment of a buffer in the memory given by caps
+ *
+ * External memory can have a longer cache line than internal memory.
+ */
+static size_t usb_dma_buf_alignment(uint32_t caps)
+{
+    size_t align = USB_DMA_BUF_ALIGN;
+#if USB_DMA_BUF_CACHE_SYNC && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+    size_t cache_align = 0;
+    if (esp_cache_get_alignment(caps, &cache_align) == ESP_OK && cache_align > align) {
+        align = cache_align;
+    }
+#else
+    (void)caps;
+#endif
+    return align;
+}
+
+/**
+ * @brief Alignment of an existing buffer
+ */
+static size_t usb_dma_buf_ptr_alignment(const void *buf)
+{
+#if USB_DMA_BUF_EXT_RAM_DMA
+    if (esp_ptr_external_ram(buf)) {
+        return usb_dma_buf_alignment(MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA);
+    }
+#else
+    (void)buf;
+#endif
+    return USB_DMA_BUF_ALIGN;
+}
+
+void *usb_dma_buf_alloc_caps(size_t size, size_t align, uint32_t caps)
+{
+    if (size == 0 || (align & (align - 1)) != 0) {
+        return NULL;
+    }
+#if !USB_DMA_BUF_EXT_RAM_DMA
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return NULL;
+    }
+#endif
+    caps |= MALLOC_CAP_DMA;
+    const size_t cache_align = usb_dma_buf_alignment(caps);
+    if (align < cache_align) {
+        align = cache_align;
+    }
+#if CONFIG_IDF_TARGET_LINUX
+    // Heap of Linux target is backed by posix_memalign(), which needs a multiple of sizeof(void *)
+    if (align < sizeof(void *)) {
+        align = sizeof(void *);
+    }
+#endif
+    const size_t alloc_size = (size + align - 1) / align * align;
+    return heap_caps_aligned_calloc(align, 1, alloc_size, caps);
+}
+
+void *usb_dma_buf_alloc(size_t size, uint32_t flags)
+{
+    if (size == 0) {
+        return NULL;
+    }
+    void *buf = NULL;
+#if USB_DMA_BUF_EXT_RAM_DMA
+    if (flags & USB_DMA_BUF_FLAG_PSRAM) {
+        buf = usb_dma_buf_alloc_caps(size, 0, MALLOC_CAP_SPIRAM);
+    }
+#else
+    (void)flags;
+#endif
+    if (buf == NULL) {
+        buf = usb_dma_buf_alloc_caps(size, 0, MALLOC_CAP_INTERNAL);
+    }
+    return buf;
+}
+
+void usb_dma_buf_free(void *buf)
+{
+    heap_caps_free(buf);
+}
+
+bool usb_dma_buf_is_external(const void *buf)
+{
+#if USB_DMA_BUF_EXT_RAM_DMA
+    return esp_ptr_external_ram(buf);
+#else
+    (void)buf;
+    return false;
+#endif
+}
+
+#if USB_DMA_BUF_CACHE_SYNC
+/**
+ * @brief Check whether CPU accesses the buffer through cache that USB DMA bypasses
+ */
+static inline bool usb_dma_buf_is_cached(const void *buf)
+{
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+    (void)buf;
+    return true;
+#elif USB_DMA_BUF_EXT_RAM_DMA
+    return esp_ptr_external_ram(buf);
+#else
+    (void)buf;
+    return false;
+#endif
+}
+#endif // USB_DMA_BUF_CACHE_SYNC
+
+esp_err_t usb_dma_buf_sync_to_device(void *buf, size_t size)
+{
+#if USB_DMA_BUF_CACHE_SYNC
+    if (buf == NULL || size == 0 || !usb_dma_buf_is_cached(buf)) {
+        return ESP_OK;
+    }
+    return esp_cache_msync(buf, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+#else
+    (void)buf;
+    (void)size;
+    return ESP_OK;
+#endif
+}
+
+esp_err_t usb_dma_buf_sync_from_device(void *buf, size_t size)
+{
+#if USB_DMA_BUF_CACHE_SYNC
+    if (buf == NULL || size == 0 || !usb_dma_buf_is_cached(buf)) {
+        return ESP_OK;
+    }
+    // Invalidating a partial cache line would discard CPU writes to the neighbouring data
+    const size_t align = usb_dma_buf_ptr_alignment(buf);
+    if ((uintptr_t)buf % align != 0 || size % align != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_cache_msync(buf, size, ESP_CACHE_MSYNC_FLAG_DIR_M2C);
+#else
+    (void)buf;
+    (void)size;
+    return ESP_OK;
+#endif
+}
+
+bool usb_dma_buf_is_dma_ready(const void *buf, size_t size)
+{
+    if (buf == NULL) {
+        return false;
+    }
+    const size_t align = usb_dma_buf_ptr_alignment(buf);
+    if ((uintptr_t)buf % align != 0 || size % align != 0) {
+        return false;
+    }
+#if USB_DMA_BUF_EXT_RAM_DMA
+    if (esp_ptr_external_ram(buf)) {
+        return true;
+    }
+#endif
+#if CONFIG_IDF_TARGET_LINUX
+    return true;
+#else
+    return esp_ptr_dma_capable(buf);
+#endif
+}
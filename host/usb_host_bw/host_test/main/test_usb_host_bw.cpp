@@ -0,0 +1,242 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_host_bw.h"
+
+constexpr uint32_t fs_budget_ns = 1000000 / 100 * CONFIG_USB_HOST_BW_FS_PERIODIC_PERCENT;
+constexpr uint32_t hs_budget_ns = 125000 / 100 * CONFIG_USB_HOST_BW_HS_PERIODIC_PERCENT;
+
+static usb_ep_desc_t make_ep(uint8_t address, uint8_t type, uint16_t wMaxPacketSize, uint8_t bInterval)
+{
+    usb_ep_desc_t ep = {};
+    ep.bLength = sizeof(usb_ep_desc_t);
+    ep.bDescriptorType = USB_B_DESCRIPTOR_TYPE_ENDPOINT;
+    ep.bEndpointAddress = address;
+    ep.bmAttributes = type;
+    ep.wMaxPacketSize = wMaxPacketSize;
+    ep.bInterval = bInterval;
+    return ep;
+}
+
+/**
+ * @brief Bus time as written in USB 2.0 specification, chapter 5.11.3, without host delay
+ *
+ * @param[in] overhead_ns Protocol overhead of the transaction
+ * @param[in] bit_ns      Bit time
+ * @param[in] bytes       Data payload
+ */
+static double spec_cost_ns(double overhead_ns, double bit_ns, unsigned bytes)
+{
+    const double bit_stuff_time = 7.0 * 8.0 * bytes / 6.0;
+    return overhead_ns + bit_ns * floor(3.167 + bit_stuff_time);
+}
+
+static void check_cost(usb_speed_t speed, const usb_ep_desc_t &ep, double expected_ns)
+{
+    const uint32_t cost_ns = usb_host_bw_ep_cost_ns(speed, &ep);
+    INFO("MPS " << USB_EP_DESC_GET_MPS(&ep) << ": " << cost_ns << " ns, expected " << expected_ns << " ns");
+    CHECK(fabs(cost_ns - expected_ns) <= 3.0); // Integer arithmetic of the driver
+}
+
+static usb_host_bw_hdl_t reserve(usb_speed_t speed, const usb_ep_desc_t &ep, esp_err_t expected_ret)
+{
+    const usb_host_bw_request_t request = {
+        .root_port = 0,
+        .speed = speed,
+        .ep_desc = &ep,
+    };
+    usb_host_bw_hdl_t bw_hdl = nullptr;
+    REQUIRE(expected_ret == usb_host_bw_reserve(&request, &bw_hdl));
+    if (expected_ret != ESP_OK) {
+        CHECK(bw_hdl == nullptr);
+    }
+    return bw_hdl;
+}
+
+static usb_host_bw_port_info_t get_info(void)
+{
+    usb_host_bw_port_info_t info;
+    REQUIRE(ESP_OK == usb_host_bw_get_info(0, &info));
+    return info;
+}
+
+SCENARIO("Bus time of an endpoint")
+{
+    GIVEN("Full Speed endpoints") {
+        const unsigned mps[] = {1, 8, 64, 192, 1023};
+        for (unsigned bytes : mps) {
+            check_cost(USB_SPEED_FULL, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_ISOC, bytes, 1), spec_cost_ns(7268, 83.54, bytes));
+            check_cost(USB_SPEED_FULL, make_ep(0x01, USB_BM_ATTRIBUTES_XFER_ISOC, bytes, 1), spec_cost_ns(6265, 83.54, bytes));
+            if (bytes <= 64) {
+                check_cost(USB_SPEED_FULL, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_INT, bytes, 1), spec_cost_ns(9107, 83.54, bytes));
+                check_cost(USB_SPEED_FULL, make_ep(0x01, USB_BM_ATTRIBUTES_XFER_INT, bytes, 1), spec_cost_ns(9107, 83.54, bytes));
+            }
+        }
+    }
+
+    GIVEN("Low Speed endpoints") {
+        check_cost(USB_SPEED_LOW, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_INT, 8, 10), spec_cost_ns(64060, 676.67, 8));
+        check_cost(USB_SPEED_LOW, make_ep(0x01, USB_BM_ATTRIBUTES_XFER_INT, 8, 10), spec_cost_ns(64107, 676.67, 8));
+    }
+
+    GIVEN("High Speed endpoints") {
+        const unsigned mps[] = {1, 64, 512, 1024};
+        for (unsigned bytes : mps) {
+            check_cost(USB_SPEED_HIGH, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_ISOC, bytes, 1), spec_cost_ns(38 * 8 * 2.083, 2.083, bytes));
+            check_cost(USB_SPEED_HIGH, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_INT, bytes, 1), spec_cost_ns(55 * 8 * 2.083, 2.083, bytes));
+        }
+    }
+
+    GIVEN("High Speed high-bandwidth endpoints") {
+        const double one = spec_cost_ns(38 * 8 * 2.083, 2.083, 1024);
+        THEN("Every additional transaction per microframe is accounted") {
+            check_cost(USB_SPEED_HIGH, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_ISOC, (1 << 11) | 1024, 1), 2 * one);
+            check_cost(USB_SPEED_HIGH, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_ISOC, (2 << 11) | 1024, 1), 3 * one);
+        }
+    }
+
+    GIVEN("Non-periodic endpoints") {
+        THEN("They cost no periodic bus time") {
+            const usb_ep_desc_t bulk = make_ep(0x81, USB_BM_ATTRIBUTES_XFER_BULK, 512, 0);
+            const usb_ep_desc_t ctrl = make_ep(0x00, USB_BM_ATTRIBUTES_XFER_CONTROL, 64, 0);
+            CHECK(0 == usb_host_bw_ep_cost_ns(USB_SPEED_HIGH, &bulk));
+            CHECK(0 == usb_host_bw_ep_cost_ns(USB_SPEED_FULL, &ctrl));
+            CHECK(0 == usb_host_bw_ep_cost_ns(USB_SPEED_FULL, nullptr));
+        }
+    }
+}
+
+SCENARIO("Admission of periodic endpoints")
+{
+    const usb_host_bw_port_info_t idle = get_info();
+    REQUIRE(idle.fs.budget_ns == fs_budget_ns);
+    REQUIRE(idle.hs.budget_ns == hs_budget_ns);
+    REQUIRE(idle.fs.free_ns == fs_budget_ns);
+    REQUIRE(idle.hs.free_ns == hs_budget_ns);
+    REQUIRE(idle.fs.num_endpoints == 0);
+    REQUIRE(idle.hs.num_endpoints == 0);
+
+    GIVEN("Invalid requests") {
+        const usb_ep_desc_t ep = make_ep(0x81, USB_BM_ATTRIBUTES_XFER_INT, 8, 1);
+        usb_host_bw_request_t request = {
+            .root_port = USB_HOST_BW_ROOT_PORTS,
+            .speed = USB_SPEED_FULL,
+            .ep_desc = &ep,
+        };
+        usb_host_bw_hdl_t bw_hdl;
+        CHECK(ESP_ERR_INVALID_ARG == usb_host_bw_reserve(&request, &bw_hdl));
+        request.root_port = 0;
+        request.ep_desc = nullptr;
+        CHECK(ESP_ERR_INVALID_ARG == usb_host_bw_reserve(&request, &bw_hdl));
+        CHECK(ESP_ERR_INVALID_ARG == usb_host_bw_reserve(nullptr, &bw_hdl));
+        CHECK(ESP_ERR_INVALID_ARG == usb_host_bw_get_info(USB_HOST_BW_ROOT_PORTS, nullptr));
+    }
+
+    GIVEN("Bulk endpoint") {
+        THEN("It is admitted without reservation") {
+            CHECK(nullptr == reserve(USB_SPEED_FULL, make_ep(0x81, USB_BM_ATTRIBUTES_XFER_BULK, 64, 0), ESP_OK));
+            CHECK(get_info().fs.num_endpoints == 0);
+            usb_host_bw_release(nullptr);
+        }
+    }
+
+    GIVEN("Full Speed Isochronous endpoint serviced every frame") {
+        const usb_ep_desc_t isoc = make_ep(0x81, USB_BM_ATTRIBUTES_XFER_ISOC, 1023, 1);
+        const uint32_t isoc_ns = usb_host_bw_ep_cost_ns(USB_SPEED_FULL, &isoc);
+        usb_host_bw_hdl_t first = reserve(USB_SPEED_FULL, isoc, ESP_OK);
+        REQUIRE(first != nullptr);
+
+        THEN("Its bus time is taken from every frame") {
+            const usb_host_bw_port_info_t info = get_info();
+            CHECK(info.fs.free_ns == fs_budget_ns - isoc_ns);
+            CHECK(info.fs.free_max_ns == fs_budget_ns - isoc_ns);
+            CHECK(info.fs.num_endpoints == 1);
+            CHECK(info.hs.free_ns == hs_budget_ns);
+        }
+
+        WHEN("Endpoints are added up to the budget") {
+            // Interrupt endpoints that fit into the bus time left, the last one exceeds it
+            const usb_ep_desc_t intr = make_ep(0x82, USB_BM_ATTRIBUTES_XFER_INT, 8, 1);
+            const uint32_t intr_ns = usb_host_bw_ep_cost_ns(USB_SPEED_FULL, &intr);
+            const uint32_t fits = (fs_budget_ns - isoc_ns) / intr_ns;
+            usb_host_bw_hdl_t intr_hdl[16] = {};
+            REQUIRE(fits < 16);
+            for (uint32_t i = 0; i < fits; i++) {
+                intr_hdl[i] = reserve(USB_SPEED_FULL, intr, ESP_OK);
+            }
+            REQUIRE(get_info().fs.free_ns < intr_ns);
+
+            THEN("Endpoint that does not fit is rejected") {
+                reserve(USB_SPEED_FULL, intr, ESP_ERR_NOT_FINISHED);
+                CHECK(get_info().fs.num_endpoints == 1 + fits);
+                CHECK(get_info().fs.free_ns == fs_budget_ns - isoc_ns - fits * intr_ns);
+            }
+
+            THEN("Released bus time is available again") {
+                usb_host_bw_release(intr_hdl[0]);
+                intr_hdl[0] = reserve(USB_SPEED_FULL, intr, ESP_OK);
+                CHECK(intr_hdl[0] != nullptr);
+            }
+
+            for (uint32_t i = 0; i < fits; i++) {
+                usb_host_bw_release(intr_hdl[i]);
+            }
+        }
+
+        WHEN("The same endpoint is requested again") {
+            THEN("It is rejected until the first one is released") {
+                reserve(USB_SPEED_FULL, isoc, ESP_ERR_NOT_FINISHED);
+                usb_host_bw_release(first);
+                first = reserve(USB_SPEED_FULL, isoc, ESP_OK);
+                CHECK(first != nullptr);
+            }
+        }
+
+        usb_host_bw_release(first);
+    }
+
+    GIVEN("High Speed high-bandwidth Isochronous endpoints serviced every other microframe") {
+        // 3 x 1024 bytes per microframe, more than half of the budget
+        const usb_ep_desc_t isoc = make_ep(0x81, USB_BM_ATTRIBUTES_XFER_ISOC, (2 << 11) | 1024, 2);
+        const uint32_t isoc_ns = usb_host_bw_ep_cost_ns(USB_SPEED_HIGH, &isoc);
+        REQUIRE(2 * isoc_ns > hs_budget_ns);
+        REQUIRE(isoc_ns <= hs_budget_ns);
+
+        usb_host_bw_hdl_t first = reserve(USB_SPEED_HIGH, isoc, ESP_OK);
+        THEN("Half of the microframes are loaded") {
+            const usb_host_bw_port_info_t info = get_info();
+            CHECK(info.hs.free_ns == hs_budget_ns - isoc_ns);
+            CHECK(info.hs.free_max_ns == hs_budget_ns);
+            CHECK(info.fs.num_endpoints == 0);
+        }
+
+        usb_host_bw_hdl_t second = reserve(USB_SPEED_HIGH, isoc, ESP_OK);
+        THEN("The second endpoint is placed into the other microframes") {
+            const usb_host_bw_port_info_t info = get_info();
+            CHECK(info.hs.free_ns == hs_budget_ns - isoc_ns);
+            CHECK(info.hs.free_max_ns == hs_budget_ns - isoc_ns);
+            CHECK(info.hs.num_endpoints == 2);
+        }
+
+        THEN("The third endpoint is rejected") {
+            reserve(USB_SPEED_HIGH, isoc, ESP_ERR_NOT_FINISHED);
+        }
+
+        usb_host_bw_release(first);
+        usb_host_bw_release(second);
+    }
+
+    // Every scenario releases its reservations
+    const usb_host_bw_port_info_t info = get_info();
+    CHECK(info.fs.free_ns == fs_budget_ns);
+    CHECK(info.hs.free_ns == hs_budget_ns);
+    CHECK(info.fs.num_endpoints == 0);
+    CHECK(info.hs.num_endpoints == 0);
+}
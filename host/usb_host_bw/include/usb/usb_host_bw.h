@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "usb/usb_types_ch9.h"
+#include "usb/usb_types_stack.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USB_HOST_BW_ROOT_PORTS  1 /**< Root ports of the USB Host Library */
+#define USB_HOST_BW_SLOTS       8 /**< Scheduled (micro)frames, longer service intervals are accounted as 8 (micro)frames */
+
+/**
+ * @brief Periodic bandwidth reservation of one endpoint
+ */
+typedef struct usb_host_bw_s *usb_host_bw_hdl_t;
+
+/**
+ * @brief Endpoint that needs periodic bandwidth
+ */
+typedef struct {
+    uint8_t root_port;              /**< Root port of the device, 0 for the only root port of the USB Host Library */
+    usb_speed_t speed;              /**< Speed of the device */
+    const usb_ep_desc_t *ep_desc;   /**< Isochronous or Interrupt endpoint */
+} usb_host_bw_request_t;
+
+/**
+ * @brief Periodic bandwidth of one bus speed
+ *
+ * Low and Full Speed endpoints share 1 ms frames, High Speed endpoints 125 us microframes.
+ * Full and Low Speed devices behind a High Speed hub are accounted in frames, as if the hub had a single transaction translator.
+ */
+typedef struct {
+    uint32_t budget_ns;         /**< Periodic bus time of one (micro)frame */
+    uint32_t free_ns;           /**< Free bus time in the most loaded (micro)frame: available to endpoints serviced every (micro)frame */
+    uint32_t free_max_ns;       /**< Free bus time in the least loaded (micro)frame: available to endpoints with long service interval */
+    uint16_t num_endpoints;     /**< Endpoints with reservation */
+} usb_host_bw_speed_info_t;
+
+/**
+ * @brief Periodic bandwidth of a root port
+ */
+typedef struct {
+    usb_host_bw_speed_info_t fs;    /**< Low and Full Speed frames */
+    usb_host_bw_speed_info_t hs;    /**< High Speed microframes */
+} usb_host_bw_port_info_t;
+
+/**
+ * @brief Bus time of one service interval of an endpoint
+ *
+ * Worst case bus time of all transactions of the endpoint in one (micro)frame, with bit stuffing and protocol overhead.
+ * @see USB 2.0 specification, chapter 5.11.3
+ *
+ * @param[in] speed   Speed of the device
+ * @param[in] ep_desc Isochronous or Interrupt endpoint
+ * @return Bus time in nanoseconds, 0 for Control and Bulk endpoints
+ */
+uint32_t usb_host_bw_ep_cost_ns(usb_speed_t speed, const usb_ep_desc_t *ep_desc);
+
+#if CONFIG_USB_HOST_BW
+/**
+ * @brief Reserve periodic bandwidth of an endpoint
+ *
+ * Class drivers call this before SET_INTERFACE to an alternate setting with Isochronous endpoints,
+ * or before polling an Interrupt endpoint. The endpoint is placed into the (micro)frames of its service interval
+ * that are least loaded. It is admitted only if none of them exceeds the periodic budget.
+ *
+ * @param[in]  request Endpoint
+ * @param[out] bw_hdl_ret Reservation, NULL for Control and Bulk endpoints, which do not need any
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid request
+ *   - ESP_ERR_NOT_FINISHED: Not enough periodic bandwidth left, try an alternate setting with smaller packets
+ *   - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t usb_host_bw_reserve(const usb_host_bw_request_t *request, usb_host_bw_hdl_t *bw_hdl_ret);
+
+/**
+ * @brief Release a reservation
+ *
+ * Class drivers call this after SET_INTERFACE to alternate setting 0, or when the device is closed.
+ *
+ * @param[in] bw_hdl Reservation, can be NULL
+ */
+void usb_host_bw_release(usb_host_bw_hdl_t bw_hdl);
+
+/**
+ * @brief Get periodic bandwidth left on a root port
+ *
+ * @param[in]  root_port Root port
+ * @param[out] info      Bandwidth of the root port
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid root port or info is NULL
+ */
+esp_err_t usb_host_bw_get_info(uint8_t root_port, usb_host_bw_port_info_t *info);
+#else
+static inline esp_err_t usb_host_bw_reserve(const usb_host_bw_request_t *request, usb_host_bw_hdl_t *bw_hdl_ret)
+{
+    (void)request;
+    if (bw_hdl_ret) {
+        *bw_hdl_ret = NULL;
+    }
+    return ESP_OK; // Everything is admitted without accounting
+}
+
+static inline void usb_host_bw_release(usb_host_bw_hdl_t bw_hdl)
+{
+    (void)bw_hdl;
+}
+
+static inline esp_err_t usb_host_bw_get_info(uint8_t root_port, usb_host_bw_port_info_t *info)
+{
+    (void)root_port;
+    (void)info;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif // CONFIG_USB_HOST_BW
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "usb/usb_host_bw.h"
+
+static const char *TAG = "usb_host_bw";
+
+#define BW_FS_FRAME_NS      1000000
+#define BW_HS_UFRAME_NS     125000
+#define BW_FS_BUDGET_NS     (BW_FS_FRAME_NS / 100 * CONFIG_USB_HOST_BW_FS_PERIODIC_PERCENT)
+#define BW_HS_BUDGET_NS     (BW_HS_UFRAME_NS / 100 * CONFIG_USB_HOST_BW_HS_PERIODIC_PERCENT)
+
+/**
+ * @brief Periodic schedule of one bus speed
+ *
+ * Service intervals are powers of two (micro)frames. An endpoint with interval N occupies every N-th slot starting at its phase,
+ * so the load of USB_HOST_BW_SLOTS slots repeats over the whole periodic schedule.
+ */
+typedef struct {
+    uint32_t load_ns[USB_HOST_BW_SLOTS];
+    uint16_t num_endpoints;
+} bw_schedule_t;
+
+struct usb_host_bw_s {
+    uint8_t root_port;
+    bool high_speed;
+    uint8_t interval;           // Service interval in slots
+    uint8_t phase;              // First slot
+    uint32_t cost_ns;           // Bus time in every occupied slot
+};
+
+static bw_schedule_t s_schedule[USB_HOST_BW_ROOT_PORTS][2]; // [root_port][high_speed]
+static portMUX_TYPE s_bw_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Service interval of an endpoint in (micro)frames, rounded down to power of two and limited to USB_HOST_BW_SLOTS
+ *
+ * @see USB 2.0 specification, table 9-13
+ */
+static uint8_t bw_interval_slots(usb_speed_t speed, const usb_ep_desc_t *ep_desc)
+{
+    const bool isoc = (ep_desc->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_ISOC;
+    const uint8_t bInterval = ep_desc->bInterval ? ep_desc->bInterval : 1;
+    unsigned interval;
+    if (speed == USB_SPEED_HIGH || isoc) {
+        // Exponent of (micro)frames
+        interval = (bInterval > 4) ? USB_HOST_BW_SLOTS : (1U << (bInterval - 1));
+    } else {
+        // Low and Full speed Interrupt endpoints: frames
+        interval = 1;
+        while (interval * 2 <= bInterval && interval < USB_HOST_BW_SLOTS) {
+            interval *= 2;
+        }
+    }
+    return interval;
+}
+
+static inline uint32_t bw_budget_ns(bool high_speed)
+{
+    return high_speed ? BW_HS_BUDGET_NS : BW_FS_BUDGET_NS;
+}
+
+/**
+ * @brief Most loaded slot of a phase
+ */
+static uint32_t bw_phase_load(const bw_schedule_t *schedule, uint8_t interval, uint8_t phase)
+{
+    uint32_t max = 0;
+    for (unsigned slot = phase; slot < USB_HOST_BW_SLOTS; slot += interval) {
+        if (schedule->load_ns[slot] > max) {
+            max = schedule->load_ns[slot];
+        }
+    }
+    return max;
+}
+
+esp_err_t usb_host_bw_reserve(const usb_host_bw_request_t *request, usb_host_bw_hdl_t *bw_hdl_ret)
+{
+    ESP_RETURN_ON_FALSE(request && request->ep_desc && bw_hdl_ret, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    ESP_RETURN_ON_FALSE(request->root_port < USB_HOST_BW_ROOT_PORTS, ESP_ERR_INVALID_ARG, TAG, "Invalid root port");
+    *bw_hdl_ret = NULL;
+
+    const uint32_t cost_ns = usb_host_bw_ep_cost_ns(request->speed, request->ep_desc);
+    if (cost_ns == 0) {
+        return ESP_OK; // Control and Bulk endpoints use bandwidth left by periodic endpoints
+    }
+    usb_host_bw_hdl_t bw = calloc(1, sizeof(struct usb_host_bw_s));
+    ESP_RETURN_ON_FALSE(bw, ESP_ERR_NO_MEM, TAG, "Not enough memory");
+    bw->root_port = request->root_port;
+    bw->high_speed = (request->speed == USB_SPEED_HIGH);
+    bw->interval = bw_interval_slots(request->speed, request->ep_desc);
+    bw->cost_ns = cost_ns;
+    const uint32_t budget_ns = bw_budget_ns(bw->high_speed);
+
+    portENTER_CRITICAL(&s_bw_lock);
+    bw_schedule_t *schedule = &s_schedule[bw->root_port][bw->high_speed];
+    // Place the endpoint into the phase whose most loaded slot is least loaded
+    uint32_t best_load = UINT32_MAX;
+    for (uint8_t phase = 0; phase < bw->interval; phase++) {
+        const uint32_t load = bw_phase_load(schedule, bw->interval, phase);
+        if (load < best_load) {
+            best_load = load;
+            bw->phase = phase;
+        }
+    }
+    const bool admitted = (best_load + cost_ns <= budget_ns);
+    if (admitted) {
+        for (unsigned slot = bw->phase; slot < USB_HOST_BW_SLOTS; slot += bw->interval) {
+            schedule->load_ns[slot] += cost_ns;
+        }
+        schedule->num_endpoints++;
+    }
+    portEXIT_CRITICAL(&s_bw_lock);
+
+    if (!admitted) {
+        ESP_LOGD(TAG, "EP 0x%02X needs %"PRIu32" ns, %"PRIu32" ns left", request->ep_desc->bEndpointAddress, cost_ns,
+                 (best_load < budget_ns) ? budget_ns - best_load : 0);
+        free(bw);
+        return ESP_ERR_NOT_FINISHED;
+    }
+    ESP_LOGD(TAG, "EP 0x%02X reserved %"PRIu32" ns every %d %sframes", request->ep_desc->bEndpointAddress, cost_ns,
+             bw->interval, bw->high_speed ? "micro" : "");
+    *bw_hdl_ret = bw;
+    return ESP_OK;
+}
+
+void usb_host_bw_release(usb_host_bw_hdl_t bw_hdl)
+{
+    if (bw_hdl == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_bw_lock);
+    bw_schedule_t *schedule = &s_schedule[bw_hdl->root_port][bw_hdl->high_speed];
+    for (unsigned slot = bw_hdl->phase; slot < USB_HOST_BW_SLOTS; slot += bw_hdl->interval) {
+        schedule->load_ns[slot] -= bw_hdl->cost_ns;
+    }
+    schedule->num_endpoints--;
+    portEXIT_CRITICAL(&s_bw_lock);
+    free(bw_hdl);
+}
+
+static void bw_speed_info(const bw_schedule_t *schedule, bool high_speed, usb_host_bw_speed_info_t *info)
+{
+    uint32_t max = 0, min = UINT32_MAX;
+    for (unsigned slot = 0; slot < USB_HOST_BW_SLOTS; slot++) {
+        max = (schedule->load_ns[slot] > max) ? schedule->load_ns[slot] : max;
+        min = (schedule->load_ns[slot] < min) ? schedule->load_ns[slot] : min;
+    }
+    info->budget_ns = bw_budget_ns(high_speed);
+    info->free_ns = (max < info->budget_ns) ? info->budget_ns - max : 0;
+    info->free_max_ns = (min < info->budget_ns) ? info->budget_ns - min : 0;
+    info->num_endpoints = schedule->num_endpoints;
+}
+
+esp_err_t usb_host_bw_get_info(uint8_t root_port, usb_host_bw_port_info_t *info)
+{
+    ESP_RETURN_ON_FALSE(info && root_port < USB_HOST_BW_ROOT_PORTS, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    bw_schedule_t schedule[2];
+    portENTER_CRITICAL(&s_bw_lock);
+    memcpy(schedule, s_schedule[root_port], sizeof(schedule));
+    portEXIT_CRITICAL(&s_bw_lock);
+    bw_speed_info(&schedule[0], false, &info->fs);
+    bw_speed_info(&schedule[1], true, &info->hs);
+    return ESP_OK;
+}
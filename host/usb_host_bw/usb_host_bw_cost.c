@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "usb/usb_host_bw.h"
+
+// Bus time formulas of USB 2.0 specification, chapter 5.11.3. Host delay and hub setup time are not included
+
+// Protocol overhead in nanoseconds
+#define BW_LS_IN_NS         64060
+#define BW_LS_OUT_NS        64107
+#define BW_FS_ISOC_IN_NS    7268
+#define BW_FS_ISOC_OUT_NS   6265
+#define BW_FS_INTR_NS       9107
+#define BW_HS_ISOC_NS       633     // 38 bytes of overhead at 2.083 ns/bit
+#define BW_HS_INTR_NS       916     // 55 bytes of overhead at 2.083 ns/bit
+
+// Bit time in picoseconds
+#define BW_LS_BIT_PS        676670
+#define BW_FS_BIT_PS        83540
+#define BW_HS_BIT_PS        2083
+
+/**
+ * @brief Number of bit times of data payload: Floor(3.167 + BitStuffTime(bytes)), BitStuffTime is 7/6 * 8 * bytes
+ */
+static inline uint32_t bw_payload_bits(uint32_t bytes)
+{
+    return (9501 + 28000 * bytes) / 3000;
+}
+
+uint32_t usb_host_bw_ep_cost_ns(usb_speed_t speed, const usb_ep_desc_t *ep_desc)
+{
+    if (ep_desc == NULL) {
+        return 0;
+    }
+    const uint8_t type = ep_desc->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK;
+    if (type != USB_BM_ATTRIBUTES_XFER_ISOC && type != USB_BM_ATTRIBUTES_XFER_INT) {
+        return 0;
+    }
+    const bool isoc = (type == USB_BM_ATTRIBUTES_XFER_ISOC);
+    const bool in = (ep_desc->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK);
+    const uint32_t mps = ep_desc->wMaxPacketSize & 0x7FF;
+    const uint32_t bits = bw_payload_bits(mps);
+
+    switch (speed) {
+    case USB_SPEED_LOW:
+        return (in ? BW_LS_IN_NS : BW_LS_OUT_NS) + (uint32_t)((uint64_t)bits * BW_LS_BIT_PS / 1000);
+    case USB_SPEED_FULL:
+        return (isoc ? (in ? BW_FS_ISOC_IN_NS : BW_FS_ISOC_OUT_NS) : BW_FS_INTR_NS) + (uint32_t)((uint64_t)bits * BW_FS_BIT_PS / 1000);
+    default: {
+        // High speed endpoints can have up to 3 transactions per microframe
+        const uint32_t transactions = ((ep_desc->wMaxPacketSize >> 11) & 0x3) + 1;
+        return transactions * ((isoc ? BW_HS_ISOC_NS : BW_HS_INTR_NS) + bits * BW_HS_BIT_PS / 1000);
+    }
+    }
+}
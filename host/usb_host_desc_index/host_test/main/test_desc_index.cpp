@@ -0,0 +1,211 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_types_stack.h"
+#include "usb/usb_host_desc_index.h"
+
+/*
+ * Headset: UAC 1.0 function of interfaces 0 - 2 grouped by an IAD, HID interface 3 outside of the IAD.
+ * Alternate settings of the streaming interfaces 1 and 2 are interleaved.
+ */
+static const uint8_t headset_config_desc[] = {
+    0x09, 0x02, 0xB1, 0x00, 0x04, 0x01, 0x00, 0x80, 0x32,             // Configuration Descriptor, 4 interfaces
+    0x08, 0x0B, 0x00, 0x03, 0x01, 0x00, 0x00, 0x00,                   // IAD, interfaces 0 - 2
+    0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,             // Interface 0, alt 0: Audio Control
+    0x0A, 0x24, 0x01, 0x00, 0x01, 0x1E, 0x00, 0x02, 0x01, 0x02,       // AC Header
+    0x0C, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, // AC Input Terminal
+    0x09, 0x04, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,             // Interface 1, alt 0: zero bandwidth
+    0x09, 0x04, 0x02, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,             // Interface 2, alt 0: zero bandwidth
+    0x09, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,             // Interface 1, alt 1
+    0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,                         // AS General
+    0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00, // AS Format Type I, 48 kHz
+    0x09, 0x05, 0x01, 0x09, 0xC0, 0x00, 0x01, 0x00, 0x00,             // Isochronous OUT endpoint 0x01, MPS 192
+    0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,                         // AS Isochronous Audio Data Endpoint
+    0x09, 0x04, 0x01, 0x02, 0x01, 0x01, 0x02, 0x00, 0x00,             // Interface 1, alt 2
+    0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,                         // AS General
+    0x09, 0x05, 0x01, 0x09, 0x80, 0x01, 0x01, 0x00, 0x00,             // Isochronous OUT endpoint 0x01, MPS 384
+    0x09, 0x04, 0x02, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,             // Interface 2, alt 1
+    0x09, 0x05, 0x82, 0x05, 0x60, 0x00, 0x01, 0x00, 0x00,             // Isochronous IN endpoint 0x82, MPS 96
+    0x09, 0x04, 0x03, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00,             // Interface 3, alt 0: HID
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x20, 0x00,             // HID Descriptor
+    0x07, 0x05, 0x83, 0x03, 0x08, 0x00, 0x0A,                         // Interrupt IN endpoint 0x83
+};
+
+/*
+ * Interface 5 with alternate settings 0 and 2 only, no interfaces 0 - 4
+ */
+static const uint8_t sparse_config_desc[] = {
+    0x09, 0x02, 0x1B, 0x00, 0x01, 0x01, 0x00, 0x80, 0x32,
+    0x09, 0x04, 0x05, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00,
+    0x09, 0x04, 0x05, 0x02, 0x00, 0xFF, 0x00, 0x00, 0x00,
+};
+
+static usb_host_desc_index_t *index_build(const uint8_t *config_desc)
+{
+    usb_host_desc_index_t *index = nullptr;
+    REQUIRE(ESP_OK == usb_host_desc_index_build((const usb_config_desc_t *)config_desc, &index));
+    REQUIRE(index != nullptr);
+    return index;
+}
+
+SCENARIO("Index of Configuration Descriptor")
+{
+    GIVEN("Headset with IAD and interleaved alternate settings") {
+        usb_host_desc_index_t *index = index_build(headset_config_desc);
+
+        THEN("Interfaces are indexed in order of their first appearance") {
+            CHECK(index->config_desc == (const usb_config_desc_t *)headset_config_desc);
+            REQUIRE(index->num_intfs == 4);
+            for (uint8_t i = 0; i < index->num_intfs; i++) {
+                CHECK(index->intfs[i].bInterfaceNumber == i);
+                CHECK(usb_host_desc_index_get_intf(index, i) == &index->intfs[i]);
+            }
+            CHECK(usb_host_desc_index_get_intf(index, 4) == nullptr);
+            CHECK(usb_host_desc_index_get_intf(index, 255) == nullptr);
+        }
+
+        THEN("Alternate settings of an interface are kept together") {
+            const usb_host_desc_index_intf_t *intf1 = usb_host_desc_index_get_intf(index, 1);
+            const usb_host_desc_index_intf_t *intf2 = usb_host_desc_index_get_intf(index, 2);
+            REQUIRE(intf1->num_alts == 3);
+            REQUIRE(intf2->num_alts == 2);
+            for (uint8_t i = 0; i < intf1->num_alts; i++) {
+                CHECK(intf1->alts[i].intf_desc->bInterfaceNumber == 1);
+                CHECK(intf1->alts[i].intf_desc->bAlternateSetting == i);
+                CHECK(usb_host_desc_index_get_alt(index, 1, i) == &intf1->alts[i]);
+            }
+            for (uint8_t i = 0; i < intf2->num_alts; i++) {
+                CHECK(intf2->alts[i].intf_desc->bInterfaceNumber == 2);
+                CHECK(intf2->alts[i].intf_desc->bAlternateSetting == i);
+            }
+            CHECK(usb_host_desc_index_get_alt(index, 1, 3) == nullptr);
+            CHECK(usb_host_desc_index_get_alt(index, 4, 0) == nullptr);
+        }
+
+        THEN("Endpoints belong to their alternate setting") {
+            CHECK(usb_host_desc_index_get_alt(index, 1, 0)->num_eps == 0);
+
+            const usb_host_desc_index_alt_t *alt1 = usb_host_desc_index_get_alt(index, 1, 1);
+            REQUIRE(alt1->num_eps == 1);
+            const usb_ep_desc_t *ep = usb_host_desc_index_find_ep(alt1, USB_TRANSFER_TYPE_ISOCHRONOUS, false);
+            REQUIRE(ep != nullptr);
+            CHECK(ep->bEndpointAddress == 0x01);
+            CHECK(ep->wMaxPacketSize == 192);
+            CHECK(usb_host_desc_index_find_ep(alt1, USB_TRANSFER_TYPE_ISOCHRONOUS, true) == nullptr);
+            CHECK(usb_host_desc_index_find_ep(alt1, USB_TRANSFER_TYPE_BULK, false) == nullptr);
+
+            ep = usb_host_desc_index_find_ep(usb_host_desc_index_get_alt(index, 1, 2), USB_TRANSFER_TYPE_ISOCHRONOUS, false);
+            REQUIRE(ep != nullptr);
+            CHECK(ep->wMaxPacketSize == 384);
+
+            ep = usb_host_desc_index_find_ep(usb_host_desc_index_get_alt(index, 2, 1), USB_TRANSFER_TYPE_ISOCHRONOUS, true);
+            REQUIRE(ep != nullptr);
+            CHECK(ep->bEndpointAddress == 0x82);
+
+            ep = usb_host_desc_index_find_ep(usb_host_desc_index_get_alt(index, 3, 0), USB_TRANSFER_TYPE_INTR, true);
+            REQUIRE(ep != nullptr);
+            CHECK(ep->bEndpointAddress == 0x83);
+        }
+
+        THEN("Class specific descriptors belong to their alternate setting") {
+            const usb_host_desc_index_alt_t *ac = usb_host_desc_index_get_alt(index, 0, 0);
+            CHECK(ac->num_class_descs == 2);
+
+            const usb_host_desc_index_alt_t *alt1 = usb_host_desc_index_get_alt(index, 1, 1);
+            REQUIRE(alt1->num_class_descs == 3);
+            const usb_standard_desc_t *general = usb_host_desc_index_find_class_desc(alt1, 0x24, nullptr);
+            REQUIRE(general != nullptr);
+            CHECK(general->bLength == 0x07);
+            const usb_standard_desc_t *format = usb_host_desc_index_find_class_desc(alt1, 0x24, general);
+            REQUIRE(format != nullptr);
+            CHECK(format->bLength == 0x0B);
+            CHECK(usb_host_desc_index_find_class_desc(alt1, 0x24, format) == nullptr);
+            const usb_standard_desc_t *cs_ep = usb_host_desc_index_find_class_desc(alt1, 0x25, nullptr);
+            REQUIRE(cs_ep != nullptr);
+            CHECK(cs_ep == (const usb_standard_desc_t *)((const uint8_t *)alt1->ep_descs[0] + 9)); // Follows its endpoint
+
+            const usb_host_desc_index_alt_t *hid = usb_host_desc_index_get_alt(index, 3, 0);
+            CHECK(usb_host_desc_index_find_class_desc(hid, 0x21, nullptr) != nullptr);
+            CHECK(usb_host_desc_index_find_class_desc(hid, 0x24, nullptr) == nullptr);
+        }
+
+        THEN("Interfaces of the IAD are associated with it") {
+            REQUIRE(index->num_iads == 1);
+            for (uint8_t i = 0; i < 3; i++) {
+                CHECK(usb_host_desc_index_get_iad(index, i) == index->iads[0]);
+            }
+            CHECK(index->iads[0]->bFunctionClass == 0x01);
+            CHECK(usb_host_desc_index_get_iad(index, 3) == nullptr);
+        }
+        usb_host_desc_index_free(index);
+    }
+
+    GIVEN("Interface with missing alternate setting numbers") {
+        usb_host_desc_index_t *index = index_build(sparse_config_desc);
+
+        THEN("Alternate settings are found by their number") {
+            REQUIRE(index->num_intfs == 1);
+            CHECK(index->intf_lut_len == 6);
+            CHECK(usb_host_desc_index_get_intf(index, 0) == nullptr);
+            CHECK(usb_host_desc_index_get_intf(index, 5) == &index->intfs[0]);
+            CHECK(usb_host_desc_index_get_alt(index, 5, 0) == &index->intfs[0].alts[0]);
+            CHECK(usb_host_desc_index_get_alt(index, 5, 2) == &index->intfs[0].alts[1]);
+            CHECK(usb_host_desc_index_get_alt(index, 5, 1) == nullptr);
+            CHECK(index->num_iads == 0);
+            CHECK(usb_host_desc_index_get_iad(index, 5) == nullptr);
+        }
+        usb_host_desc_index_free(index);
+    }
+
+    GIVEN("Configuration without interfaces") {
+        const uint8_t config_desc[] = {0x09, 0x02, 0x09, 0x00, 0x00, 0x01, 0x00, 0x80, 0x32};
+        usb_host_desc_index_t *index = index_build(config_desc);
+
+        THEN("Index is empty") {
+            CHECK(index->num_intfs == 0);
+            CHECK(index->intf_lut_len == 0);
+            CHECK(usb_host_desc_index_get_intf(index, 0) == nullptr);
+        }
+        usb_host_desc_index_free(index);
+    }
+
+    GIVEN("Invalid Configuration Descriptors") {
+        std::vector<uint8_t> config_desc(sparse_config_desc, sparse_config_desc + sizeof(sparse_config_desc));
+        usb_host_desc_index_t *index = nullptr;
+
+        THEN("Descriptor with zero length is rejected") {
+            config_desc[9] = 0;
+            CHECK(ESP_ERR_INVALID_SIZE == usb_host_desc_index_build((const usb_config_desc_t *)config_desc.data(), &index));
+        }
+
+        THEN("Descriptor exceeding wTotalLength is rejected") {
+            config_desc[2] = sizeof(sparse_config_desc) - 1;
+            CHECK(ESP_ERR_INVALID_SIZE == usb_host_desc_index_build((const usb_config_desc_t *)config_desc.data(), &index));
+        }
+
+        THEN("Too short Interface Descriptor is rejected") {
+            config_desc[18] = 5;
+            config_desc[2] = 9 + 9 + 5;
+            CHECK(ESP_ERR_INVALID_SIZE == usb_host_desc_index_build((const usb_config_desc_t *)config_desc.data(), &index));
+        }
+
+        THEN("Too short Configuration Descriptor is rejected") {
+            config_desc[0] = 4;
+            CHECK(ESP_ERR_INVALID_SIZE == usb_host_desc_index_build((const usb_config_desc_t *)config_desc.data(), &index));
+        }
+
+        THEN("Invalid arguments are rejected") {
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_desc_index_build(nullptr, &index));
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_desc_index_build((const usb_config_desc_t *)config_desc.data(), nullptr));
+        }
+        CHECK(index == nullptr);
+        usb_host_desc_index_free(nullptr);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_types_ch9.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Alternate setting of an interface
+ */
+typedef struct {
+    const usb_intf_desc_t *intf_desc;           /**< Interface descriptor */
+    const usb_ep_desc_t *const *ep_descs;       /**< Endpoint descriptors, in order of the Configuration Descriptor */
+    uint8_t num_eps;                            /**< Number of endpoint descriptors */
+    uint16_t num_class_descs;                   /**< Number of other descriptors */
+    const usb_standard_desc_t *const *class_descs; /**< Other descriptors after the Interface descriptor: class-specific interface
+                                                     and endpoint descriptors, HID descriptor, etc. In order of the Configuration Descriptor */
+} usb_host_desc_index_alt_t;
+
+/**
+ * @brief Interface with all its alternate settings
+ */
+typedef struct {
+    uint8_t bInterfaceNumber;                   /**< Interface number */
+    uint8_t num_alts;                           /**< Number of alternate settings */
+    const usb_host_desc_index_alt_t *alts;      /**< Alternate settings, in order of the Configuration Descriptor */
+} usb_host_desc_index_intf_t;
+
+/**
+ * @brief Index of Configuration Descriptor
+ *
+ * Built in one pass over the Configuration Descriptor, stored in one allocation.
+ * Pointers point into the Configuration Descriptor, which must outlive the index.
+ */
+typedef struct {
+    const usb_config_desc_t *config_desc;       /**< Indexed Configuration Descriptor */
+    uint8_t num_intfs;                          /**< Number of interfaces */
+    const usb_host_desc_index_intf_t *intfs;    /**< Interfaces, in order of the Configuration Descriptor */
+    uint8_t num_iads;                           /**< Number of Interface Association Descriptors */
+    const usb_iad_desc_t *const *iads;          /**< Interface Association Descriptors */
+    uint16_t intf_lut_len;                      /**< Highest bInterfaceNumber + 1 */
+    const uint8_t *intf_lut;                    /**< Position in intfs + 1 by bInterfaceNumber, 0 if the interface does not exist */
+} usb_host_desc_index_t;
+
+/**
+ * @brief Build index of Configuration Descriptor
+ *
+ * @param[in]  config_desc Configuration Descriptor
+ * @param[out] index_ret   Index, free with usb_host_desc_index_free()
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: config_desc or index_ret is NULL
+ *   - ESP_ERR_INVALID_SIZE: A descriptor has invalid length
+ *   - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t usb_host_desc_index_build(const usb_config_desc_t *config_desc, usb_host_desc_index_t **index_ret);
+
+/**
+ * @brief Free index of Configuration Descriptor
+ *
+ * @param[in] index Index, can be NULL
+ */
+void usb_host_desc_index_free(usb_host_desc_index_t *index);
+
+/**
+ * @brief Get interface by its number
+ *
+ * @param[in] index            Index
+ * @param[in] bInterfaceNumber Interface number
+ * @return Interface, NULL if it does not exist
+ */
+static inline const usb_host_desc_index_intf_t *usb_host_desc_index_get_intf(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber)
+{
+    if (bInterfaceNumber >= index->intf_lut_len || index->intf_lut[bInterfaceNumber] == 0) {
+        return NULL;
+    }
+    return &index->intfs[index->intf_lut[bInterfaceNumber] - 1];
+}
+
+/**
+ * @brief Get alternate setting of an interface
+ *
+ * @param[in] index             Index
+ * @param[in] bInterfaceNumber  Interface number
+ * @param[in] bAlternateSetting Alternate setting
+ * @return Alternate setting, NULL if it does not exist
+ */
+const usb_host_desc_index_alt_t *usb_host_desc_index_get_alt(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber, uint8_t bAlternateSetting);
+
+/**
+ * @brief Find endpoint of an alternate setting
+ *
+ * @param[in] alt       Alternate setting
+ * @param[in] xfer_type Transfer type of the endpoint, usb_transfer_type_t
+ * @param[in] in        true for IN endpoint, false for OUT endpoint
+ * @return First endpoint of this type and direction, NULL if not found
+ */
+const usb_ep_desc_t *usb_host_desc_index_find_ep(const usb_host_desc_index_alt_t *alt, int xfer_type, bool in);
+
+/**
+ * @brief Find other descriptor of an alternate setting
+ *
+ * @param[in] alt             Alternate setting
+ * @param[in] bDescriptorType Descriptor type
+ * @param[in] start           Descriptor to continue the search after, NULL to search from the first one
+ * @return Next descriptor of this type, NULL if not found
+ */
+const usb_standard_desc_t *usb_host_desc_index_find_class_desc(const usb_host_desc_index_alt_t *alt, uint8_t bDescriptorType,
+                                                               const usb_standard_desc_t *start);
+
+/**
+ * @brief Get Interface Association Descriptor of an interface
+ *
+ * @param[in] index            Index
+ * @param[in] bInterfaceNumber Interface number
+ * @return Interface Association Descriptor whose function contains the interface, NULL if there is none
+ */
+const usb_iad_desc_t *usb_host_desc_index_get_iad(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber);
+
+#ifdef __cplusplus
+}
+#endif
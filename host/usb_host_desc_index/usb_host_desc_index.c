@@ -0,0 +1,245 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "usb/usb_host_desc_index.h"
+
+static const char *TAG = "usb_desc_index";
+
+#define INTF_NUM_MAX 256
+
+/**
+ * @brief Number of descriptors of each kind, counted in the first pass
+ */
+typedef struct {
+    uint16_t num_intfs;
+    uint16_t num_alts;
+    uint16_t num_eps;
+    uint16_t num_class_descs;
+    uint16_t num_iads;
+    uint16_t intf_lut_len;
+} desc_count_t;
+
+/**
+ * @brief Walk all descriptors after the Configuration Descriptor
+ *
+ * Descriptors shorter than usb_standard_desc_t or exceeding wTotalLength end the walk with an error.
+ *
+ * @param[in]    config_desc Configuration Descriptor
+ * @param[inout] offset      Offset of the current descriptor, 0 to start
+ * @param[out]   desc_ret    Next descriptor, NULL at the end of Configuration Descriptor
+ * @return ESP_OK or ESP_ERR_INVALID_SIZE
+ */
+static esp_err_t desc_next(const usb_config_desc_t *config_desc, size_t *offset, const usb_standard_desc_t **desc_ret)
+{
+    const uint8_t *p = (const uint8_t *)config_desc;
+    const size_t total_length = config_desc->wTotalLength;
+    const size_t next = *offset + p[*offset];
+    *desc_ret = NULL;
+    if (next + sizeof(usb_standard_desc_t) > total_length) {
+        return ESP_OK;
+    }
+    const usb_standard_desc_t *desc = (const usb_standard_desc_t *)(p + next);
+    if (desc->bLength < sizeof(usb_standard_desc_t) || next + desc->bLength > total_length) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *offset = next;
+    *desc_ret = desc;
+    return ESP_OK;
+}
+
+static esp_err_t desc_count(const usb_config_desc_t *config_desc, uint8_t alts_per_intf[INTF_NUM_MAX], desc_count_t *count)
+{
+    size_t offset = 0;
+    const usb_standard_desc_t *desc;
+    bool in_intf = false;
+    ESP_RETURN_ON_FALSE(config_desc->bLength >= sizeof(usb_config_desc_t), ESP_ERR_INVALID_SIZE, TAG, "Invalid Configuration Descriptor");
+
+    while (true) {
+        ESP_RETURN_ON_ERROR(desc_next(config_desc, &offset, &desc), TAG, "Invalid descriptor length after offset %d", (int)offset);
+        if (desc == NULL) {
+            break;
+        }
+        switch (desc->bDescriptorType) {
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE: {
+            ESP_RETURN_ON_FALSE(desc->bLength >= sizeof(usb_intf_desc_t), ESP_ERR_INVALID_SIZE, TAG, "Invalid Interface Descriptor");
+            const uint8_t num = ((const usb_intf_desc_t *)desc)->bInterfaceNumber;
+            ESP_RETURN_ON_FALSE(alts_per_intf[num] < UINT8_MAX, ESP_ERR_INVALID_SIZE, TAG, "Too many alternate settings");
+            if (alts_per_intf[num]++ == 0) {
+                ESP_RETURN_ON_FALSE(count->num_intfs < UINT8_MAX, ESP_ERR_INVALID_SIZE, TAG, "Too many interfaces");
+                count->num_intfs++;
+            }
+            if (num + 1 > count->intf_lut_len) {
+                count->intf_lut_len = num + 1;
+            }
+            count->num_alts++;
+            in_intf = true;
+            break;
+        }
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION:
+            ESP_RETURN_ON_FALSE(desc->bLength >= sizeof(usb_iad_desc_t), ESP_ERR_INVALID_SIZE, TAG, "Invalid Interface Association Descriptor");
+            ESP_RETURN_ON_FALSE(count->num_iads < UINT8_MAX, ESP_ERR_INVALID_SIZE, TAG, "Too many Interface Association Descriptors");
+            count->num_iads++;
+            break;
+        case USB_B_DESCRIPTOR_TYPE_ENDPOINT:
+            ESP_RETURN_ON_FALSE(desc->bLength >= sizeof(usb_ep_desc_t), ESP_ERR_INVALID_SIZE, TAG, "Invalid Endpoint Descriptor");
+            count->num_eps += in_intf;
+            break;
+        default:
+            count->num_class_descs += in_intf;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t usb_host_desc_index_build(const usb_config_desc_t *config_desc, usb_host_desc_index_t **index_ret)
+{
+    ESP_RETURN_ON_FALSE(config_desc && index_ret, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+
+    // First pass: count descriptors, so the index fits into one allocation
+    uint8_t alts_per_intf[INTF_NUM_MAX] = {0};
+    desc_count_t count = {0};
+    ESP_RETURN_ON_ERROR(desc_count(config_desc, alts_per_intf, &count), TAG, "Invalid Configuration Descriptor");
+
+    // Pointer arrays first, byte sized lookup table last, to keep all members aligned
+    const size_t size = sizeof(usb_host_desc_index_t) +
+                        count.num_intfs * sizeof(usb_host_desc_index_intf_t) +
+                        count.num_alts * sizeof(usb_host_desc_index_alt_t) +
+                        count.num_eps * sizeof(usb_ep_desc_t *) +
+                        count.num_class_descs * sizeof(usb_standard_desc_t *) +
+                        count.num_iads * sizeof(usb_iad_desc_t *) +
+                        count.intf_lut_len;
+    uint8_t *mem = calloc(1, size);
+    ESP_RETURN_ON_FALSE(mem, ESP_ERR_NO_MEM, TAG, "Unable to allocate index");
+
+    usb_host_desc_index_t *index = (usb_host_desc_index_t *)mem;
+    usb_host_desc_index_intf_t *intfs = (usb_host_desc_index_intf_t *)(index + 1);
+    usb_host_desc_index_alt_t *alts = (usb_host_desc_index_alt_t *)(intfs + count.num_intfs);
+    const usb_ep_desc_t **eps = (const usb_ep_desc_t **)(alts + count.num_alts);
+    const usb_standard_desc_t **class_descs = (const usb_standard_desc_t **)(eps + count.num_eps);
+    const usb_iad_desc_t **iads = (const usb_iad_desc_t **)(class_descs + count.num_class_descs);
+    uint8_t *intf_lut = (uint8_t *)(iads + count.num_iads);
+
+    index->config_desc = config_desc;
+    index->intfs = intfs;
+    index->iads = iads;
+    index->intf_lut_len = count.intf_lut_len;
+    index->intf_lut = intf_lut;
+
+    // Second pass: fill the index. Alternate settings of one interface are kept together,
+    // even if the device interleaves them with other interfaces
+    size_t offset = 0;
+    const usb_standard_desc_t *desc;
+    usb_host_desc_index_alt_t *alt = NULL;
+    size_t alts_used = 0;
+    size_t eps_used = 0;
+    size_t class_descs_used = 0;
+    while (desc_next(config_desc, &offset, &desc) == ESP_OK && desc) {
+        switch (desc->bDescriptorType) {
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE: {
+            const usb_intf_desc_t *intf_desc = (const usb_intf_desc_t *)desc;
+            const uint8_t num = intf_desc->bInterfaceNumber;
+            if (intf_lut[num] == 0) {
+                usb_host_desc_index_intf_t *intf = &intfs[index->num_intfs++];
+                intf_lut[num] = index->num_intfs;
+                intf->bInterfaceNumber = num;
+                intf->alts = &alts[alts_used];
+                alts_used += alts_per_intf[num];
+            }
+            usb_host_desc_index_intf_t *intf = &intfs[intf_lut[num] - 1];
+            alt = &alts[(intf->alts - alts) + intf->num_alts++];
+            alt->intf_desc = intf_desc;
+            alt->ep_descs = &eps[eps_used];
+            alt->class_descs = &class_descs[class_descs_used];
+            break;
+        }
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION:
+            iads[index->num_iads++] = (const usb_iad_desc_t *)desc;
+            break;
+        case USB_B_DESCRIPTOR_TYPE_ENDPOINT:
+            if (alt) {
+                eps[eps_used++] = (const usb_ep_desc_t *)desc;
+                alt->num_eps++;
+            }
+            break;
+        default:
+            if (alt) {
+                class_descs[class_descs_used++] = desc;
+                alt->num_class_descs++;
+            }
+            break;
+        }
+    }
+
+    *index_ret = index;
+    return ESP_OK;
+}
+
+void usb_host_desc_index_free(usb_host_desc_index_t *index)
+{
+    free(index);
+}
+
+const usb_host_desc_index_alt_t *usb_host_desc_index_get_alt(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber, uint8_t bAlternateSetting)
+{
+    const usb_host_desc_index_intf_t *intf = usb_host_desc_index_get_intf(index, bInterfaceNumber);
+    if (intf == NULL) {
+        return NULL;
+    }
+    // Alternate settings are usually numbered in order from 0
+    if (bAlternateSetting < intf->num_alts && intf->alts[bAlternateSetting].intf_desc->bAlternateSetting == bAlternateSetting) {
+        return &intf->alts[bAlternateSetting];
+    }
+    for (int i = 0; i < intf->num_alts; i++) {
+        if (intf->alts[i].intf_desc->bAlternateSetting == bAlternateSetting) {
+            return &intf->alts[i];
+        }
+    }
+    return NULL;
+}
+
+const usb_ep_desc_t *usb_host_desc_index_find_ep(const usb_host_desc_index_alt_t *alt, int xfer_type, bool in)
+{
+    for (int i = 0; i < alt->num_eps; i++) {
+        const usb_ep_desc_t *ep_desc = alt->ep_descs[i];
+        if (USB_EP_DESC_GET_XFERTYPE(ep_desc) == xfer_type && (bool)USB_EP_DESC_GET_EP_DIR(ep_desc) == in) {
+            return ep_desc;
+        }
+    }
+    return NULL;
+}
+
+const usb_standard_desc_t *usb_host_desc_index_find_class_desc(const usb_host_desc_index_alt_t *alt, uint8_t bDescriptorType,
+                                                               const usb_standard_desc_t *start)
+{
+    int i = 0;
+    if (start) {
+        while (i < alt->num_class_descs && alt->class_descs[i] != start) {
+            i++;
+        }
+        i++;
+    }
+    for (; i < alt->num_class_descs; i++) {
+        if (alt->class_descs[i]->bDescriptorType == bDescriptorType) {
+            return alt->class_descs[i];
+        }
+    }
+    return NULL;
+}
+
+const usb_iad_desc_t *usb_host_desc_index_get_iad(const usb_host_desc_index_t *index, uint8_t bInterfaceNumber)
+{
+    for (int i = 0; i < index->num_iads; i++) {
+        const usb_iad_desc_t *iad = index->iads[i];
+        if (bInterfaceNumber >= iad->bFirstInterface && bInterfaceNumber < iad->bFirstInterface + iad->bInterfaceCount) {
+            return iad;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include "usb/usb_host_shared_client.h"
+#include "shared_client_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+static int s_client;                    // Address of the client is its handle
+static usb_host_client_event_cb_t s_client_event_cb;
+static void *s_client_event_cb_arg;
+static bool s_uninstalling;
+static std::vector<TickType_t> s_timeouts;
+static std::vector<usb_host_client_event_msg_t> s_events;
+static int s_device_opens;
+static int s_device_closes;
+static const usb_device_desc_t *s_device_desc;
+static const usb_config_desc_t *s_config_desc;
+
+static esp_err_t client_register_stub(const usb_host_client_config_t *client_config, usb_host_client_handle_t *client_hdl_ret, int cmock_num_calls)
+{
+    s_client_event_cb = client_config->async.client_event_callback;
+    s_client_event_cb_arg = client_config->async.callback_arg;
+    *client_hdl_ret = (usb_host_client_handle_t)&s_client;
+    return ESP_OK;
+}
+
+static esp_err_t client_deregister_stub(usb_host_client_handle_t client_hdl, int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t client_handle_events_stub(usb_host_client_handle_t client_hdl, TickType_t timeout_ticks, int cmock_num_calls)
+{
+    s_timeouts.push_back(timeout_ticks);
+    if (s_events.empty()) {
+        return ESP_ERR_TIMEOUT;
+    }
+    // Events posted by the test are delivered like by the USB Host Library, from within this call
+    const std::vector<usb_host_client_event_msg_t> events = std::move(s_events);
+    s_events.clear();
+    for (const usb_host_client_event_msg_t &event_msg : events) {
+        s_client_event_cb(&event_msg, s_client_event_cb_arg);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t client_unblock_stub(usb_host_client_handle_t client_hdl, int cmock_num_calls)
+{
+    if (s_uninstalling) {
+        // Return of the blocked usb_host_client_handle_events() in the event handling task
+        usb_host_shared_client_handle_events(0);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t device_open_stub(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t *dev_hdl_ret, int cmock_num_calls)
+{
+    *dev_hdl_ret = (usb_device_handle_t)(uintptr_t)(0x100 + dev_addr);
+    s_device_opens++;
+    return ESP_OK;
+}
+
+static esp_err_t device_close_stub(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, int cmock_num_calls)
+{
+    s_device_closes++;
+    return ESP_OK;
+}
+
+static esp_err_t get_device_descriptor_stub(usb_device_handle_t dev_hdl, const usb_device_desc_t **device_desc, int cmock_num_calls)
+{
+    if (s_device_desc == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *device_desc = s_device_desc;
+    return ESP_OK;
+}
+
+static esp_err_t get_active_config_descriptor_stub(usb_device_handle_t dev_hdl, const usb_config_desc_t **config_desc, int cmock_num_calls)
+{
+    if (s_config_desc == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *config_desc = s_config_desc;
+    return ESP_OK;
+}
+
+void test_shared_client_mock_init(void)
+{
+    s_uninstalling = false;
+    s_timeouts.clear();
+    s_events.clear();
+    s_device_opens = 0;
+    s_device_closes = 0;
+    s_device_desc = nullptr;
+    s_config_desc = nullptr;
+    usb_host_client_register_Stub(client_register_stub);
+    usb_host_client_deregister_Stub(client_deregister_stub);
+    usb_host_client_handle_events_Stub(client_handle_events_stub);
+    usb_host_client_unblock_Stub(client_unblock_stub);
+    usb_host_device_open_Stub(device_open_stub);
+    usb_host_device_close_Stub(device_close_stub);
+    usb_host_get_device_descriptor_Stub(get_device_descriptor_stub);
+    usb_host_get_active_config_descriptor_Stub(get_active_config_descriptor_stub);
+}
+
+esp_err_t test_shared_client_uninstall(void)
+{
+    s_uninstalling = true;
+    const esp_err_t ret = usb_host_shared_client_uninstall();
+    s_uninstalling = false;
+    return ret;
+}
+
+void test_shared_client_event_post(const usb_host_client_event_msg_t &event_msg)
+{
+    s_events.push_back(event_msg);
+}
+
+void test_shared_client_device_descs_set(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc)
+{
+    s_device_desc = device_desc;
+    s_config_desc = config_desc;
+}
+
+std::vector<TickType_t> test_shared_client_handle_events_timeouts(void)
+{
+    return s_timeouts;
+}
+
+int test_shared_client_device_opens(void)
+{
+    return s_device_opens;
+}
+
+int test_shared_client_device_closes(void)
+{
+    return s_device_closes;
+}
@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <vector>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "usb/usb_host.h"
+
+/**
+ * @brief Stub USB Host Library functions used by the shared client
+ *
+ * - usb_host_client_handle_events() records its timeout and delivers posted events, returns ESP_ERR_TIMEOUT if there are none
+ * - usb_host_device_open() and usb_host_device_close() are counted
+ * - Descriptors of all devices are set by test_shared_client_device_descs_set()
+ * - usb_host_client_unblock() lets the shared client finish event handling when it is being uninstalled
+ */
+void test_shared_client_mock_init(void);
+
+/**
+ * @brief Uninstall the shared client, as if its event handling task was running
+ *
+ * @return See usb_host_shared_client_uninstall()
+ */
+esp_err_t test_shared_client_uninstall(void);
+
+/**
+ * @brief Post an event of the USB Host Library, delivered by the next usb_host_client_handle_events() call
+ *
+ * @param[in] event_msg Event message
+ */
+void test_shared_client_event_post(const usb_host_client_event_msg_t &event_msg);
+
+/**
+ * @brief Set descriptors returned for all devices
+ *
+ * @param[in] device_desc Device Descriptor, NULL: the descriptor cannot be read
+ * @param[in] config_desc Active Configuration Descriptor, NULL: the descriptor cannot be read
+ */
+void test_shared_client_device_descs_set(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc);
+
+/**
+ * @brief Timeouts of usb_host_client_handle_events() calls since test_shared_client_mock_init()
+ */
+std::vector<TickType_t> test_shared_client_handle_events_timeouts(void);
+
+/**
+ * @brief Number of usb_host_device_open() calls since test_shared_client_mock_init()
+ */
+int test_shared_client_device_opens(void);
+
+/**
+ * @brief Number of usb_host_device_close() calls since test_shared_client_mock_init()
+ */
+int test_shared_client_device_closes(void);
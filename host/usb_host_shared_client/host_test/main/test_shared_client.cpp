@@ -0,0 +1,240 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_host_shared_client.h"
+#include "shared_client_test_fixtures.hpp"
+
+/*
+ * The shared client is installed without background task, events are handled by the test itself.
+ */
+
+static int s_steps;
+static TickType_t s_step_ret;
+static usb_host_shared_client_driver_handle_t s_added_hdl; // Driver added from the step of another driver
+
+static void event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
+{
+}
+
+static TickType_t step_cb(void *arg)
+{
+    s_steps++;
+    return s_step_ret;
+}
+
+static TickType_t step_add_driver_cb(void *arg)
+{
+    const usb_host_shared_client_driver_config_t config = {
+        .event_cb = event_cb,
+    };
+    usb_host_client_handle_t client_hdl;
+    REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&config, &s_added_hdl, &client_hdl));
+    return portMAX_DELAY;
+}
+
+SCENARIO("Shared client install")
+{
+    test_shared_client_mock_init();
+    const usb_host_shared_client_config_t config = {
+        .create_background_task = false,
+    };
+    REQUIRE(ESP_OK == usb_host_shared_client_install(&config));
+
+    GIVEN("The shared client is installed") {
+        THEN("It cannot be installed again") {
+            CHECK(ESP_ERR_INVALID_STATE == usb_host_shared_client_install(&config));
+        }
+    }
+
+    GIVEN("A class driver is added") {
+        const usb_host_shared_client_driver_config_t driver_config = {
+            .event_cb = event_cb,
+        };
+        usb_host_shared_client_driver_handle_t driver_hdl;
+        usb_host_client_handle_t client_hdl;
+        REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&driver_config, &driver_hdl, &client_hdl));
+        CHECK(usb_host_shared_client_is_shared(client_hdl));
+
+        THEN("The shared client cannot be uninstalled") {
+            CHECK(ESP_ERR_INVALID_STATE == usb_host_shared_client_uninstall());
+        }
+        REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl));
+    }
+
+    GIVEN("Invalid class drivers") {
+        const usb_host_shared_client_driver_config_t no_event_cb = {};
+        const usb_host_shared_client_driver_config_t no_match_table = {
+            .event_cb = event_cb,
+            .probe_cb = [](const usb_host_shared_client_probe_t *probe, void *arg) {},
+        };
+        usb_host_shared_client_driver_handle_t driver_hdl;
+        usb_host_client_handle_t client_hdl;
+        THEN("They are not added") {
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_shared_client_add_driver(&no_event_cb, &driver_hdl, &client_hdl));
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_shared_client_add_driver(&no_match_table, &driver_hdl, &client_hdl));
+        }
+    }
+
+    GIVEN("Maximum number of class drivers is added") {
+        const usb_host_shared_client_driver_config_t driver_config = {
+            .event_cb = event_cb,
+        };
+        usb_host_shared_client_driver_handle_t driver_hdl[USB_HOST_SHARED_CLIENT_MAX_DRIVERS + 1];
+        usb_host_client_handle_t client_hdl;
+        for (int i = 0; i < USB_HOST_SHARED_CLIENT_MAX_DRIVERS; i++) {
+            REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&driver_config, &driver_hdl[i], &client_hdl));
+        }
+        THEN("Another one is rejected") {
+            CHECK(ESP_ERR_NO_MEM == usb_host_shared_client_add_driver(&driver_config, &driver_hdl[USB_HOST_SHARED_CLIENT_MAX_DRIVERS], &client_hdl));
+        }
+        for (int i = 0; i < USB_HOST_SHARED_CLIENT_MAX_DRIVERS; i++) {
+            REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl[i]));
+        }
+    }
+
+    REQUIRE(ESP_OK == test_shared_client_uninstall());
+    CHECK(ESP_ERR_INVALID_STATE == usb_host_shared_client_uninstall());
+}
+
+SCENARIO("Steps of class drivers")
+{
+    test_shared_client_mock_init();
+    const usb_host_shared_client_config_t config = {
+        .create_background_task = false,
+    };
+    REQUIRE(ESP_OK == usb_host_shared_client_install(&config));
+
+    s_steps = 0;
+    s_step_ret = 10;
+    const usb_host_shared_client_driver_config_t driver_config = {
+        .event_cb = event_cb,
+        .step_cb = step_cb,
+    };
+    usb_host_shared_client_driver_handle_t driver_hdl;
+    usb_host_client_handle_t client_hdl;
+    REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&driver_config, &driver_hdl, &client_hdl));
+
+    GIVEN("A driver with step was added") {
+        THEN("Its step runs without waiting for an event") {
+            CHECK(ESP_OK == usb_host_shared_client_handle_events(portMAX_DELAY));
+            CHECK(test_shared_client_handle_events_timeouts() == std::vector<TickType_t>({0}));
+            CHECK(s_steps == 1);
+        }
+    }
+
+    GIVEN("The step asks to run again later") {
+        REQUIRE(ESP_OK == usb_host_shared_client_handle_events(portMAX_DELAY));
+        THEN("Events are waited for until then only") {
+            CHECK(ESP_OK == usb_host_shared_client_handle_events(portMAX_DELAY));
+            CHECK(test_shared_client_handle_events_timeouts() == std::vector<TickType_t>({0, 10}));
+            CHECK(s_steps == 2);
+        }
+    }
+
+    GIVEN("The step has nothing to do until the next event") {
+        s_step_ret = portMAX_DELAY;
+        REQUIRE(ESP_OK == usb_host_shared_client_handle_events(portMAX_DELAY));
+        THEN("Timeout of the caller is used") {
+            CHECK(ESP_ERR_TIMEOUT == usb_host_shared_client_handle_events(50));
+            CHECK(test_shared_client_handle_events_timeouts() == std::vector<TickType_t>({0, 50}));
+        }
+    }
+
+    GIVEN("Another driver is added while the steps run") {
+        s_step_ret = portMAX_DELAY;
+        const usb_host_shared_client_driver_config_t adding_config = {
+            .event_cb = event_cb,
+            .step_cb = step_add_driver_cb,
+        };
+        usb_host_shared_client_driver_handle_t adding_hdl;
+        REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&adding_config, &adding_hdl, &client_hdl));
+        REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl)); // Only the adding driver has a step
+        driver_hdl = nullptr;
+        s_added_hdl = nullptr;
+        REQUIRE(ESP_OK == usb_host_shared_client_handle_events(portMAX_DELAY));
+        REQUIRE(s_added_hdl != nullptr);
+        REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(adding_hdl));
+
+        THEN("Its step request is not lost") {
+            CHECK(ESP_OK == usb_host_shared_client_handle_events(portMAX_DELAY));
+            CHECK(test_shared_client_handle_events_timeouts() == std::vector<TickType_t>({0, 0}));
+        }
+        REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(s_added_hdl));
+    }
+
+    if (driver_hdl) {
+        REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl));
+    }
+    REQUIRE(ESP_OK == test_shared_client_uninstall());
+}
+
+SCENARIO("Devices opened by several class drivers")
+{
+    test_shared_client_mock_init();
+    const usb_host_shared_client_config_t config = {
+        .create_background_task = false,
+    };
+    REQUIRE(ESP_OK == usb_host_shared_client_install(&config));
+    const usb_host_shared_client_driver_config_t driver_config = {
+        .event_cb = event_cb,
+    };
+    usb_host_shared_client_driver_handle_t driver_hdl;
+    usb_host_client_handle_t client_hdl;
+    REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&driver_config, &driver_hdl, &client_hdl));
+
+    GIVEN("Two drivers open the same device") {
+        usb_device_handle_t dev_hdl[2];
+        REQUIRE(ESP_OK == usb_host_shared_client_device_open(client_hdl, 1, &dev_hdl[0]));
+        REQUIRE(ESP_OK == usb_host_shared_client_device_open(client_hdl, 1, &dev_hdl[1]));
+
+        THEN("The device is opened once") {
+            CHECK(dev_hdl[0] == dev_hdl[1]);
+            CHECK(test_shared_client_device_opens() == 1);
+        }
+
+        THEN("The shared client cannot be uninstalled") {
+            REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl));
+            CHECK(ESP_ERR_INVALID_STATE == usb_host_shared_client_uninstall());
+            usb_host_shared_client_driver_handle_t again;
+            REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&driver_config, &again, &client_hdl));
+            driver_hdl = again;
+        }
+
+        THEN("The device is closed by the last driver") {
+            REQUIRE(ESP_OK == usb_host_shared_client_device_close(client_hdl, dev_hdl[0]));
+            CHECK(test_shared_client_device_closes() == 0);
+            REQUIRE(ESP_OK == usb_host_shared_client_device_close(client_hdl, dev_hdl[1]));
+            CHECK(test_shared_client_device_closes() == 1);
+            CHECK(ESP_ERR_NOT_FOUND == usb_host_shared_client_device_close(client_hdl, dev_hdl[1]));
+        }
+
+        if (test_shared_client_device_closes() == 0) {
+            REQUIRE(ESP_OK == usb_host_shared_client_device_close(client_hdl, dev_hdl[0]));
+            REQUIRE(ESP_OK == usb_host_shared_client_device_close(client_hdl, dev_hdl[1]));
+        }
+    }
+
+    GIVEN("A driver with its own client") {
+        usb_host_client_handle_t own_client = (usb_host_client_handle_t)0x1234;
+        usb_device_handle_t dev_hdl[2];
+        THEN("Its devices are opened and closed by the USB Host Library") {
+            CHECK_FALSE(usb_host_shared_client_is_shared(own_client));
+            REQUIRE(ESP_OK == usb_host_shared_client_device_open(own_client, 1, &dev_hdl[0]));
+            REQUIRE(ESP_OK == usb_host_shared_client_device_open(own_client, 1, &dev_hdl[1]));
+            CHECK(test_shared_client_device_opens() == 2);
+            REQUIRE(ESP_OK == usb_host_shared_client_device_close(own_client, dev_hdl[0]));
+            CHECK(test_shared_client_device_closes() == 1);
+            REQUIRE(ESP_OK == usb_host_shared_client_device_close(own_client, dev_hdl[1]));
+        }
+    }
+
+    REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl));
+    REQUIRE(ESP_OK == test_shared_client_uninstall());
+}
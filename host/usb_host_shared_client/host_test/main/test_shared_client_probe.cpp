@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_host_shared_client.h"
+#include "shared_client_test_fixtures.hpp"
+
+/*
+ * Probe of new devices
+ *
+ * NEW_DEV events are posted by the test and delivered by usb_host_shared_client_handle_events().
+ * The device has CDC interfaces 0 and 1 grouped by an IAD, and vendor specific interface 2 with two alternate settings.
+ */
+
+constexpr uint8_t device_address = 1;
+constexpr uint16_t vid = 0x303A, pid = 0x4002;
+
+static const uint8_t device_desc[] = {
+    0x12, 0x01, 0x00, 0x02, 0xEF, 0x02, 0x01, 0x40,         // bMaxPacketSize0 64
+    0x3A, 0x30, 0x02, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00,   // idVendor 0x303A, idProduct 0x4002
+    0x01,
+};
+
+static const uint8_t config_desc[] = {
+    0x09, 0x02, 0x51, 0x00, 0x03, 0x01, 0x00, 0x80, 0x32,     // Configuration Descriptor, 3 interfaces
+    0x08, 0x0B, 0x00, 0x02, 0x02, 0x02, 0x01, 0x00,           // IAD, interfaces 0 and 1
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x02, 0x02, 0x01, 0x00,     // Interface 0: CDC Communication
+    0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x10,
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x00,     // Interface 1: CDC Data
+    0x07, 0x05, 0x02, 0x02, 0x40, 0x00, 0x00,
+    0x07, 0x05, 0x82, 0x02, 0x40, 0x00, 0x00,
+    0x09, 0x04, 0x02, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00,     // Interface 2, alternate setting 0: vendor, no endpoints
+    0x09, 0x04, 0x02, 0x01, 0x01, 0xFF, 0x01, 0x02, 0x00,     // Interface 2, alternate setting 1: vendor subclass 1, protocol 2
+    0x07, 0x05, 0x83, 0x01, 0x00, 0x01, 0x01,
+};
+
+typedef struct {
+    usb_host_client_handle_t client_hdl;
+    bool keep_device;                           // Open the device from the probe
+    int probes;
+    std::vector<uint8_t> probed_intfs;          // bInterfaceNumber of interfaces of the last probe
+    std::vector<usb_host_client_event_t> events;
+    usb_device_handle_t dev_hdl;
+} test_driver_t;
+
+static void event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
+{
+    test_driver_t *driver = (test_driver_t *)arg;
+    driver->events.push_back(event_msg->event);
+}
+
+static void probe_cb(const usb_host_shared_client_probe_t *probe, void *arg)
+{
+    test_driver_t *driver = (test_driver_t *)arg;
+    CHECK(probe->dev_addr == device_address);
+    CHECK(probe->device_desc->idVendor == vid);
+    driver->probes++;
+    driver->probed_intfs.clear();
+    for (int i = 0; i < probe->num_intfs; i++) {
+        driver->probed_intfs.push_back(probe->intfs[i]->bInterfaceNumber);
+    }
+    if (driver->keep_device) {
+        REQUIRE(ESP_OK == usb_host_shared_client_device_open(driver->client_hdl, probe->dev_addr, &driver->dev_hdl));
+    }
+}
+
+static usb_host_shared_client_driver_handle_t driver_add(test_driver_t *driver, const usb_host_shared_client_match_t *match_table,
+        size_t match_count)
+{
+    const usb_host_shared_client_driver_config_t config = {
+        .event_cb = event_cb,
+        .probe_cb = match_table ? probe_cb : nullptr,
+        .match_table = match_table,
+        .match_count = match_count,
+        .arg = driver,
+    };
+    usb_host_shared_client_driver_handle_t driver_hdl;
+    REQUIRE(ESP_OK == usb_host_shared_client_add_driver(&config, &driver_hdl, &driver->client_hdl));
+    return driver_hdl;
+}
+
+static void new_dev_handle(void)
+{
+    usb_host_client_event_msg_t event_msg = {};
+    event_msg.event = USB_HOST_CLIENT_EVENT_NEW_DEV;
+    event_msg.new_dev.address = device_address;
+    test_shared_client_event_post(event_msg);
+    REQUIRE(ESP_OK == usb_host_shared_client_handle_events(0));
+}
+
+SCENARIO("Probe of new devices")
+{
+    test_shared_client_mock_init();
+    const usb_host_shared_client_config_t config = {
+        .create_background_task = false,
+    };
+    REQUIRE(ESP_OK == usb_host_shared_client_install(&config));
+    test_shared_client_device_descs_set((const usb_device_desc_t *)device_desc, (const usb_config_desc_t *)config_desc);
+
+    GIVEN("Drivers with match tables") {
+        const usb_host_shared_client_match_t cdc_match[] = {
+            {.match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS, .bInterfaceClass = 0x02},
+        };
+        const usb_host_shared_client_match_t cdc_data_match[] = {
+            {.match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS, .bInterfaceClass = 0x0A},
+            {.match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS, .bInterfaceClass = 0x02},
+        };
+        const usb_host_shared_client_match_t vendor_match[] = {
+            {
+                .match_flags = USB_HOST_SHARED_CLIENT_MATCH_VENDOR | USB_HOST_SHARED_CLIENT_MATCH_PRODUCT |
+                USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS | USB_HOST_SHARED_CLIENT_MATCH_INTF_SUBCLASS |
+                USB_HOST_SHARED_CLIENT_MATCH_INTF_PROTOCOL,
+                .idVendor = vid, .idProduct = pid,
+                .bInterfaceClass = 0xFF, .bInterfaceSubClass = 0x01, .bInterfaceProtocol = 0x02,
+            },
+        };
+        const usb_host_shared_client_match_t mismatch[] = {
+            // Subclass and protocol of the vendor interface are in different alternate settings
+            {
+                .match_flags = USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS | USB_HOST_SHARED_CLIENT_MATCH_INTF_SUBCLASS |
+                USB_HOST_SHARED_CLIENT_MATCH_INTF_PROTOCOL,
+                .bInterfaceClass = 0xFF, .bInterfaceSubClass = 0x01, .bInterfaceProtocol = 0x00,
+            },
+            {.match_flags = USB_HOST_SHARED_CLIENT_MATCH_VENDOR, .idVendor = vid + 1},
+            {.match_flags = USB_HOST_SHARED_CLIENT_MATCH_PRODUCT, .idProduct = pid + 1},
+        };
+        test_driver_t cdc = {}, cdc_data = {}, vendor = {}, none = {}, no_probe = {};
+        usb_host_shared_client_driver_handle_t driver_hdls[] = {
+            driver_add(&cdc, cdc_match, 1),
+            driver_add(&cdc_data, cdc_data_match, 2),
+            driver_add(&vendor, vendor_match, 1),
+            driver_add(&none, mismatch, 3),
+            driver_add(&no_probe, nullptr, 0),
+        };
+
+        WHEN("New device is connected") {
+            new_dev_handle();
+
+            THEN("Drivers are probed with the interfaces matched by their tables") {
+                CHECK(cdc.probes == 1);
+                CHECK(cdc.probed_intfs == std::vector<uint8_t>({0}));
+                CHECK(cdc_data.probes == 1);
+                CHECK(cdc_data.probed_intfs == std::vector<uint8_t>({0, 1})); // In order of the Configuration Descriptor
+                CHECK(vendor.probes == 1);
+                CHECK(vendor.probed_intfs == std::vector<uint8_t>({2}));
+            }
+
+            THEN("Drivers without a matched interface are not probed") {
+                CHECK(none.probes == 0);
+                CHECK(none.events.empty());
+            }
+
+            THEN("NEW_DEV is passed to event callback of drivers without probe") {
+                CHECK(no_probe.events == std::vector<usb_host_client_event_t>({USB_HOST_CLIENT_EVENT_NEW_DEV}));
+                CHECK(cdc.events.empty());
+            }
+
+            THEN("The device is opened once for all probes and closed after them") {
+                CHECK(test_shared_client_device_opens() == 1);
+                CHECK(test_shared_client_device_closes() == 1);
+            }
+        }
+
+        WHEN("A driver keeps the device") {
+            cdc.keep_device = true;
+            new_dev_handle();
+
+            THEN("The device stays open until the driver closes it") {
+                CHECK(test_shared_client_device_opens() == 1);
+                CHECK(test_shared_client_device_closes() == 0);
+                REQUIRE(ESP_OK == usb_host_shared_client_device_close(cdc.client_hdl, cdc.dev_hdl));
+                CHECK(test_shared_client_device_closes() == 1);
+            }
+
+            if (test_shared_client_device_closes() == 0) {
+                REQUIRE(ESP_OK == usb_host_shared_client_device_close(cdc.client_hdl, cdc.dev_hdl));
+            }
+        }
+
+        WHEN("Descriptors of the new device cannot be read") {
+            test_shared_client_device_descs_set((const usb_device_desc_t *)device_desc, nullptr);
+            new_dev_handle();
+
+            THEN("NEW_DEV is passed to event callback of all drivers") {
+                CHECK(cdc.probes == 0);
+                CHECK(vendor.probes == 0);
+                CHECK(none.probes == 0);
+                for (const test_driver_t *driver : {
+                            &cdc, &cdc_data, &vendor, &none, &no_probe
+                        }) {
+                    CHECK(driver->events == std::vector<usb_host_client_event_t>({USB_HOST_CLIENT_EVENT_NEW_DEV}));
+                }
+            }
+
+            THEN("The device is closed") {
+                CHECK(test_shared_client_device_opens() == 1);
+                CHECK(test_shared_client_device_closes() == 1);
+            }
+        }
+
+        WHEN("Device is gone") {
+            usb_host_client_event_msg_t event_msg = {};
+            event_msg.event = USB_HOST_CLIENT_EVENT_DEV_GONE;
+            event_msg.dev_gone.dev_hdl = (usb_device_handle_t)0x1234;
+            test_shared_client_event_post(event_msg);
+            REQUIRE(ESP_OK == usb_host_shared_client_handle_events(0));
+
+            THEN("DEV_GONE is passed to event callback of all drivers") {
+                for (const test_driver_t *driver : {
+                            &cdc, &cdc_data, &vendor, &none, &no_probe
+                        }) {
+                    CHECK(driver->events == std::vector<usb_host_client_event_t>({USB_HOST_CLIENT_EVENT_DEV_GONE}));
+                }
+                CHECK(test_shared_client_device_opens() == 0);
+            }
+        }
+
+        for (usb_host_shared_client_driver_handle_t driver_hdl : driver_hdls) {
+            REQUIRE(ESP_OK == usb_host_shared_client_remove_driver(driver_hdl));
+        }
+    }
+
+    REQUIRE(ESP_OK == test_shared_client_uninstall());
+}
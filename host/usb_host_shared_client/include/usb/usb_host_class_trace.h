@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "usb/usb_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Class driver of a trace point
+ */
+typedef enum {
+    USB_HOST_CLASS_TRACE_CDC_ACM,
+    USB_HOST_CLASS_TRACE_HID,
+    USB_HOST_CLASS_TRACE_MSC,
+    USB_HOST_CLASS_TRACE_UAC,
+    USB_HOST_CLASS_TRACE_UVC,
+} usb_host_class_trace_driver_t;
+
+/**
+ * @brief Trace point on the transfer path
+ */
+typedef enum {
+    USB_HOST_CLASS_TRACE_SUBMIT,    /**< Transfer submitted by the driver or the user */
+    USB_HOST_CLASS_TRACE_COMPLETE,  /**< Completion callback of the transfer entered */
+    USB_HOST_CLASS_TRACE_CB_ENTER,  /**< User callback with data of the transfer entered */
+    USB_HOST_CLASS_TRACE_CB_EXIT,   /**< User callback with data of the transfer returned */
+    USB_HOST_CLASS_TRACE_RESUBMIT,  /**< Transfer submitted again after completion */
+    USB_HOST_CLASS_TRACE_EVENT_MAX,
+} usb_host_class_trace_event_t;
+
+#if CONFIG_USB_HOST_CLASS_TRACE_SYSVIEW || CONFIG_USB_HOST_CLASS_TRACE_CUSTOM
+/**
+ * @brief Record a trace point
+ *
+ * Implemented by this component for SystemView, by the application for custom trace.
+ * Called from the transfer callbacks, so it must be short and must not block.
+ *
+ * @param[in] driver Class driver
+ * @param[in] event  Trace point
+ * @param[in] xfer   Transfer, NULL for user callbacks not tied to one transfer (e.g. UVC frame callback)
+ */
+void usb_host_class_trace(usb_host_class_trace_driver_t driver, usb_host_class_trace_event_t event, const usb_transfer_t *xfer);
+
+#define USB_HOST_CLASS_TRACE(driver, event, xfer) usb_host_class_trace((driver), (event), (xfer))
+#else
+#define USB_HOST_CLASS_TRACE(driver, event, xfer) do { (void)(driver); (void)(event); (void)(xfer); } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "usb/usb_host.h"
+#include "usb/usb_host_desc_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USB_HOST_SHARED_CLIENT_MAX_DRIVERS 8 /*!< Maximum number of class drivers using the shared client */
+
+typedef struct usb_host_shared_client_driver *usb_host_shared_client_driver_handle_t; /**< Handle of a class driver added to the shared client */
+
+/**
+ * @brief Step of a class driver
+ *
+ * Called after each round of USB Host client events, for work the class driver defers out of the transfer callbacks.
+ *
+ * @param[in] arg User argument of the class driver
+ * @return Ticks until the step needs to be called again, portMAX_DELAY if only on the next USB Host client event
+ */
+typedef TickType_t (*usb_host_shared_client_step_cb_t)(void *arg);
+
+/**
+ * @brief Fields of usb_host_shared_client_match_t compared with the device
+ */
+typedef enum {
+    USB_HOST_SHARED_CLIENT_MATCH_VENDOR         = (1 << 0), /**< idVendor of Device Descriptor */
+    USB_HOST_SHARED_CLIENT_MATCH_PRODUCT        = (1 << 1), /**< idProduct of Device Descriptor */
+    USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS     = (1 << 2), /**< bInterfaceClass of any alternate setting */
+    USB_HOST_SHARED_CLIENT_MATCH_INTF_SUBCLASS  = (1 << 3), /**< bInterfaceSubClass of the same alternate setting */
+    USB_HOST_SHARED_CLIENT_MATCH_INTF_PROTOCOL  = (1 << 4), /**< bInterfaceProtocol of the same alternate setting */
+} usb_host_shared_client_match_flags_t;
+
+/**
+ * @brief Entry of a match table of a class driver
+ *
+ * An interface matches the entry if all fields selected by match_flags are equal.
+ * Entry with match_flags 0 matches all interfaces of all devices.
+ */
+typedef struct {
+    uint16_t match_flags;           /**< Compared fields, usb_host_shared_client_match_flags_t */
+    uint16_t idVendor;              /**< Vendor ID */
+    uint16_t idProduct;             /**< Product ID */
+    uint8_t bInterfaceClass;        /**< Interface class */
+    uint8_t bInterfaceSubClass;     /**< Interface subclass */
+    uint8_t bInterfaceProtocol;     /**< Interface protocol */
+} usb_host_shared_client_match_t;
+
+/**
+ * @brief New device probed by the shared client
+ *
+ * The device is opened by the shared client for the duration of the probe callback.
+ * Descriptors and the index are valid only during the callback. A class driver that keeps the device
+ * opens it with usb_host_shared_client_device_open(), which then only takes another reference.
+ */
+typedef struct {
+    uint8_t dev_addr;                               /**< Device address */
+    usb_device_handle_t dev_hdl;                    /**< Device handle */
+    const usb_device_desc_t *device_desc;           /**< Device Descriptor */
+    const usb_host_desc_index_t *index;             /**< Index of the active Configuration Descriptor */
+    uint8_t num_intfs;                              /**< Number of interfaces matched by the match table of the class driver */
+    const usb_host_desc_index_intf_t *const *intfs; /**< Matched interfaces, in order of the Configuration Descriptor */
+} usb_host_shared_client_probe_t;
+
+/**
+ * @brief Probe of a class driver
+ *
+ * Called for NEW_DEV event instead of event_cb, only if at least one interface of the device matches the match table.
+ *
+ * @param[in] probe New device with interfaces matched by the class driver
+ * @param[in] arg   User argument of the class driver
+ */
+typedef void (*usb_host_shared_client_probe_cb_t)(const usb_host_shared_client_probe_t *probe, void *arg);
+
+/**
+ * @brief Shared client configuration
+ */
+typedef struct {
+    bool create_background_task;    /**< When set to true, background task handling USB events is created.
+                                         Otherwise user has to periodically call usb_host_shared_client_handle_events()
+                                         or *_host_handle_events() of any class driver using the shared client */
+    size_t task_priority;           /**< Task priority of created background task */
+    size_t stack_size;              /**< Stack size of created background task */
+    BaseType_t core_id;             /**< Select core on which background task will run or tskNO_AFFINITY */
+    int max_num_event_msg;          /**< Maximum number of USB Host client events queued, 0 for default */
+} usb_host_shared_client_config_t;
+
+/**
+ * @brief Class driver configuration
+ */
+typedef struct {
+    usb_host_client_event_cb_t event_cb;    /**< USB Host client event callback, called for NEW_DEV and DEV_GONE of all devices */
+    usb_host_shared_client_step_cb_t step_cb; /**< Step of the class driver, can be NULL */
+    usb_host_shared_client_probe_cb_t probe_cb; /**< Probe of the class driver. If set, NEW_DEV is not passed to event_cb,
+                                                     unless the device cannot be probed. NULL: NEW_DEV is passed to event_cb */
+    const usb_host_shared_client_match_t *match_table; /**< Probe only: interfaces the class driver is interested in */
+    size_t match_count;                     /**< Probe only: number of entries in match_table */
+    void *arg;                              /**< User argument of the callbacks */
+} usb_host_shared_client_driver_config_t;
+
+/**
+ * @brief Install the shared client
+ *
+ * Registers one USB Host client used by all class drivers installed with the shared client option.
+ * Events of all these drivers are handled by one task, instead of one task per class driver.
+ * Must be called after usb_host_install() and before the class drivers are installed.
+ *
+ * @param[in] config Configuration, NULL for default: background task of priority 5 with 4 kB stack
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The shared client is already installed
+ *   - ESP_ERR_INVALID_ARG: Invalid configuration
+ *   - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t usb_host_shared_client_install(const usb_host_shared_client_config_t *config);
+
+/**
+ * @brief Uninstall the shared client
+ *
+ * All class drivers must be uninstalled first.
+ *
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: Not installed or class drivers still use it
+ */
+esp_err_t usb_host_shared_client_uninstall(void);
+
+/**
+ * @brief Handle USB Host client events of all class drivers using the shared client
+ *
+ * @param[in] timeout Ticks to wait for an event
+ * @return
+ *   - ESP_OK: Events handled
+ *   - ESP_ERR_TIMEOUT: No event during timeout
+ *   - ESP_FAIL: The shared client is being uninstalled, stop handling events
+ *   - ESP_ERR_INVALID_STATE: Not installed
+ */
+esp_err_t usb_host_shared_client_handle_events(TickType_t timeout);
+
+/**
+ * @brief Add a class driver to the shared client
+ *
+ * The match table is not copied, it must stay valid until the class driver is removed.
+ *
+ * @param[in]  config     Class driver configuration
+ * @param[out] driver_hdl Handle of the class driver
+ * @param[out] client_hdl Shared USB Host client, used by the class driver for interface claims and transfers
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The shared client is not installed
+ *   - ESP_ERR_INVALID_ARG: Invalid argument
+ *   - ESP_ERR_NO_MEM: USB_HOST_SHARED_CLIENT_MAX_DRIVERS drivers already added
+ */
+esp_err_t usb_host_shared_client_add_driver(const usb_host_shared_client_driver_config_t *config,
+        usb_host_shared_client_driver_handle_t *driver_hdl,
+        usb_host_client_handle_t *client_hdl);
+
+/**
+ * @brief Remove a class driver from the shared client
+ *
+ * When the function returns, callbacks of the class driver are not running and will not be called again.
+ *
+ * @param[in] driver_hdl Handle of the class driver
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid handle
+ */
+esp_err_t usb_host_shared_client_remove_driver(usb_host_shared_client_driver_handle_t driver_hdl);
+
+/**
+ * @brief Open a USB device
+ *
+ * Same as usb_host_device_open(), but a device opened by several class drivers through the shared client
+ * is opened only once and closed by the last usb_host_shared_client_device_close().
+ * Other clients are passed to usb_host_device_open().
+ *
+ * @param[in]  client_hdl Client handle
+ * @param[in]  dev_addr   Device address
+ * @param[out] dev_hdl    Device handle
+ * @return See usb_host_device_open()
+ */
+esp_err_t usb_host_shared_client_device_open(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t *dev_hdl);
+
+/**
+ * @brief Close a USB device opened with usb_host_shared_client_device_open()
+ *
+ * @param[in] client_hdl Client handle
+ * @param[in] dev_hdl    Device handle
+ * @return See usb_host_device_close()
+ */
+esp_err_t usb_host_shared_client_device_close(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl);
+
+/**
+ * @brief Check whether the client is the shared client
+ *
+ * @param[in] client_hdl Client handle
+ * @return true if the client is the shared client
+ */
+bool usb_host_shared_client_is_shared(usb_host_client_handle_t client_hdl);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdatomic.h>
+#include "SEGGER_SYSVIEW.h"
+#include "usb/usb_host_class_trace.h"
+
+enum {
+    TRACE_MODULE_UNREGISTERED,
+    TRACE_MODULE_REGISTERING,
+    TRACE_MODULE_READY,
+};
+
+// Event IDs follow usb_host_class_trace_event_t, Driver follows usb_host_class_trace_driver_t
+static SEGGER_SYSVIEW_MODULE s_trace_module = {
+    .sModule = "M=USBHostClass,"
+    "0 Submit Driver=%u Xfer=%p Bytes=%u,"
+    "1 Complete Driver=%u Xfer=%p Bytes=%u,"
+    "2 CbEnter Driver=%u Xfer=%p Bytes=%u,"
+    "3 CbExit Driver=%u Xfer=%p Bytes=%u,"
+    "4 Resubmit Driver=%u Xfer=%p Bytes=%u",
+    .NumEvents = USB_HOST_CLASS_TRACE_EVENT_MAX,
+};
+
+static atomic_int s_trace_module_state = TRACE_MODULE_UNREGISTERED;
+
+/**
+ * @brief Register the SystemView module on first use
+ *
+ * @return true if events can be recorded, false while another task is registering the module
+ */
+static bool trace_module_ready(void)
+{
+    if (atomic_load(&s_trace_module_state) == TRACE_MODULE_READY) {
+        return true;
+    }
+    int expected = TRACE_MODULE_UNREGISTERED;
+    if (!atomic_compare_exchange_strong(&s_trace_module_state, &expected, TRACE_MODULE_REGISTERING)) {
+        return false;
+    }
+    SEGGER_SYSVIEW_RegisterModule(&s_trace_module);
+    atomic_store(&s_trace_module_state, TRACE_MODULE_READY);
+    return true;
+}
+
+void usb_host_class_trace(usb_host_class_trace_driver_t driver, usb_host_class_trace_event_t event, const usb_transfer_t *xfer)
+{
+    if (!trace_module_ready()) {
+        return;
+    }
+    // Requested length before the transfer is done, received length after it
+    int bytes = 0;
+    if (xfer) {
+        bytes = (event == USB_HOST_CLASS_TRACE_SUBMIT || event == USB_HOST_CLASS_TRACE_RESUBMIT) ?
+                xfer->num_bytes : xfer->actual_num_bytes;
+    }
+    SEGGER_SYSVIEW_RecordU32x3(s_trace_module.EventOffset + event, driver, (uint32_t)xfer, bytes);
+}
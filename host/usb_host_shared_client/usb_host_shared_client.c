@@ -0,0 +1,447 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <sys/queue.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "usb/usb_host.h"
+#include "usb/usb_host_desc_index.h"
+#include "usb/usb_host_shared_client.h"
+
+static const char *TAG = "usb_shared_client";
+
+#define SHARED_CLIENT_MAX_EVENT_MSG_DEFAULT 16
+
+// Device opened by one or more class drivers through the shared client
+typedef struct shared_dev {
+    usb_device_handle_t dev_hdl;
+    uint8_t dev_addr;
+    unsigned refs;
+    SLIST_ENTRY(shared_dev) list_entry;
+} shared_dev_t;
+
+struct usb_host_shared_client_driver {
+    usb_host_shared_client_driver_config_t config;
+    bool used;
+};
+
+typedef struct {
+    usb_host_client_handle_t client_hdl;
+    struct usb_host_shared_client_driver drivers[USB_HOST_SHARED_CLIENT_MAX_DRIVERS];
+    TaskHandle_t handling_task;         // Task that handles events, callbacks of drivers run in it
+    bool dispatching;                   // Callbacks of drivers are running
+    TickType_t step_wait;               // Ticks until the steps of drivers need to run again, protected by s_shared_lock
+    SemaphoreHandle_t dev_mutex;        // Protects devices list and device open/close
+    SLIST_HEAD(, shared_dev) devices;
+    bool end_event_handling;
+    bool event_handling_started;
+    SemaphoreHandle_t all_events_handled;
+} shared_client_t;
+
+// Probe of a new device, shared by all drivers with probe callback
+typedef struct {
+    usb_host_shared_client_probe_t probe;
+    usb_host_desc_index_t *index;
+    const usb_host_desc_index_intf_t **matched; // Matched interfaces of one driver, num_intfs entries
+} shared_probe_t;
+
+static shared_client_t *s_shared;
+static portMUX_TYPE s_shared_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Check whether an alternate setting matches an entry of a match table
+ */
+static bool shared_client_match_alt(const usb_host_shared_client_match_t *match, const usb_device_desc_t *device_desc,
+                                    const usb_intf_desc_t *intf_desc)
+{
+    const uint16_t flags = match->match_flags;
+    return !((flags & USB_HOST_SHARED_CLIENT_MATCH_VENDOR) && match->idVendor != device_desc->idVendor) &&
+           !((flags & USB_HOST_SHARED_CLIENT_MATCH_PRODUCT) && match->idProduct != device_desc->idProduct) &&
+           !((flags & USB_HOST_SHARED_CLIENT_MATCH_INTF_CLASS) && match->bInterfaceClass != intf_desc->bInterfaceClass) &&
+           !((flags & USB_HOST_SHARED_CLIENT_MATCH_INTF_SUBCLASS) && match->bInterfaceSubClass != intf_desc->bInterfaceSubClass) &&
+           !((flags & USB_HOST_SHARED_CLIENT_MATCH_INTF_PROTOCOL) && match->bInterfaceProtocol != intf_desc->bInterfaceProtocol);
+}
+
+/**
+ * @brief Open a new device and index its descriptors once for all drivers with probe callback
+ *
+ * @return ESP_OK if the device can be probed, release it with shared_client_probe_end()
+ */
+static esp_err_t shared_client_probe_start(shared_client_t *shared, uint8_t dev_addr, shared_probe_t *probe)
+{
+    const usb_config_desc_t *config_desc;
+    *probe = (shared_probe_t) {
+        .probe.dev_addr = dev_addr,
+    };
+    ESP_RETURN_ON_ERROR(usb_host_shared_client_device_open(shared->client_hdl, dev_addr, &probe->probe.dev_hdl),
+                        TAG, "Unable to open device %d", dev_addr);
+
+    esp_err_t ret;
+    ESP_GOTO_ON_ERROR(usb_host_get_device_descriptor(probe->probe.dev_hdl, &probe->probe.device_desc), fail, TAG,);
+    ESP_GOTO_ON_ERROR(usb_host_get_active_config_descriptor(probe->probe.dev_hdl, &config_desc), fail, TAG,);
+    ESP_GOTO_ON_ERROR(usb_host_desc_index_build(config_desc, &probe->index), fail, TAG, "Unable to index descriptors of device %d", dev_addr);
+    probe->probe.index = probe->index;
+    if (probe->index->num_intfs) {
+        probe->matched = malloc(probe->index->num_intfs * sizeof(usb_host_desc_index_intf_t *));
+        ESP_GOTO_ON_FALSE(probe->matched, ESP_ERR_NO_MEM, fail, TAG, "Unable to allocate memory");
+    }
+    probe->probe.intfs = probe->matched;
+    return ESP_OK;
+
+fail:
+    usb_host_desc_index_free(probe->index);
+    usb_host_shared_client_device_close(shared->client_hdl, probe->probe.dev_hdl);
+    return ret;
+}
+
+static void shared_client_probe_end(shared_client_t *shared, shared_probe_t *probe)
+{
+    free(probe->matched);
+    usb_host_desc_index_free(probe->index);
+    // Drivers that kept the device hold their own references
+    usb_host_shared_client_device_close(shared->client_hdl, probe->probe.dev_hdl);
+}
+
+/**
+ * @brief Call probe callback of a driver with interfaces matched by its match table
+ */
+static void shared_client_probe_driver(shared_probe_t *probe, const usb_host_shared_client_driver_config_t *config)
+{
+    const usb_host_desc_index_t *index = probe->index;
+    uint8_t num_matched = 0;
+    for (int i = 0; i < index->num_intfs; i++) {
+        const usb_host_desc_index_intf_t *intf = &index->intfs[i];
+        bool match = false;
+        for (int alt = 0; alt < intf->num_alts && !match; alt++) {
+            for (size_t m = 0; m < config->match_count && !match; m++) {
+                match = shared_client_match_alt(&config->match_table[m], probe->probe.device_desc, intf->alts[alt].intf_desc);
+            }
+        }
+        if (match) {
+            probe->matched[num_matched++] = intf;
+        }
+    }
+    if (num_matched) {
+        probe->probe.num_intfs = num_matched;
+        config->probe_cb(&probe->probe, config->arg);
+    }
+}
+
+/**
+ * @brief Call event callback of all drivers, or their step callbacks if event_msg is NULL
+ *
+ * @return Ticks until the steps need to run again
+ */
+static TickType_t shared_client_dispatch(shared_client_t *shared, const usb_host_client_event_msg_t *event_msg)
+{
+    TickType_t wait = portMAX_DELAY;
+    portENTER_CRITICAL(&s_shared_lock);
+    shared->dispatching = true;
+    bool probe_needed = false;
+    for (int i = 0; i < USB_HOST_SHARED_CLIENT_MAX_DRIVERS; i++) {
+        probe_needed |= shared->drivers[i].used && shared->drivers[i].config.probe_cb;
+    }
+    portEXIT_CRITICAL(&s_shared_lock);
+
+    // New device is opened and its descriptors are indexed once, drivers only compare their match tables
+    shared_probe_t probe = { 0 };
+    const bool new_dev = event_msg && event_msg->event == USB_HOST_CLIENT_EVENT_NEW_DEV;
+    const bool probing = new_dev && probe_needed && shared_client_probe_start(shared, event_msg->new_dev.address, &probe) == ESP_OK;
+
+    for (int i = 0; i < USB_HOST_SHARED_CLIENT_MAX_DRIVERS; i++) {
+        portENTER_CRITICAL(&s_shared_lock);
+        const bool used = shared->drivers[i].used;
+        const usb_host_shared_client_driver_config_t config = shared->drivers[i].config;
+        portEXIT_CRITICAL(&s_shared_lock);
+        if (!used) {
+            continue;
+        }
+        if (new_dev && config.probe_cb && probing) {
+            shared_client_probe_driver(&probe, &config);
+        } else if (event_msg) {
+            // Also NEW_DEV for drivers with probe_cb, if the device could not be probed
+            config.event_cb(event_msg, config.arg);
+        } else if (config.step_cb) {
+            const TickType_t step_wait = config.step_cb(config.arg); // MIN() evaluates its arguments twice
+            wait = MIN(wait, step_wait);
+        }
+    }
+
+    if (probing) {
+        shared_client_probe_end(shared, &probe);
+    }
+
+    portENTER_CRITICAL(&s_shared_lock);
+    shared->dispatching = false;
+    portEXIT_CRITICAL(&s_shared_lock);
+    return wait;
+}
+
+static void shared_client_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
+{
+    shared_client_dispatch((shared_client_t *)arg, event_msg);
+}
+
+static void shared_client_task(void *arg)
+{
+    ESP_LOGD(TAG, "USB shared client handling start");
+    while (usb_host_shared_client_handle_events(portMAX_DELAY) != ESP_FAIL) {
+    }
+    ESP_LOGD(TAG, "USB shared client handling stop");
+    vTaskDelete(NULL);
+}
+
+esp_err_t usb_host_shared_client_install(const usb_host_shared_client_config_t *config)
+{
+    const usb_host_shared_client_config_t default_config = {
+        .create_background_task = true,
+        .task_priority = 5,
+        .stack_size = 4096,
+        .core_id = tskNO_AFFINITY,
+    };
+    if (config == NULL) {
+        config = &default_config;
+    }
+    ESP_RETURN_ON_FALSE(!s_shared, ESP_ERR_INVALID_STATE, TAG, "Already installed");
+    if (config->create_background_task) {
+        ESP_RETURN_ON_FALSE(config->stack_size != 0 && config->task_priority != 0, ESP_ERR_INVALID_ARG, TAG, "Invalid task config");
+    }
+
+    esp_err_t ret;
+    shared_client_t *shared = calloc(1, sizeof(shared_client_t));
+    ESP_RETURN_ON_FALSE(shared, ESP_ERR_NO_MEM, TAG, "Unable to allocate memory");
+    SLIST_INIT(&shared->devices);
+    shared->step_wait = portMAX_DELAY;
+    shared->dev_mutex = xSemaphoreCreateMutex();
+    shared->all_events_handled = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(shared->dev_mutex && shared->all_events_handled, ESP_ERR_NO_MEM, fail, TAG, "Unable to create semaphores");
+
+    const usb_host_client_config_t client_config = {
+        .is_synchronous = false,
+        .max_num_event_msg = config->max_num_event_msg ? config->max_num_event_msg : SHARED_CLIENT_MAX_EVENT_MSG_DEFAULT,
+        .async.client_event_callback = shared_client_event_cb,
+        .async.callback_arg = shared,
+    };
+    ESP_GOTO_ON_ERROR(usb_host_client_register(&client_config, &shared->client_hdl), fail, TAG, "Unable to register USB Host client");
+
+    portENTER_CRITICAL(&s_shared_lock);
+    if (s_shared) {
+        portEXIT_CRITICAL(&s_shared_lock);
+        ret = ESP_ERR_INVALID_STATE;
+        goto fail;
+    }
+    s_shared = shared;
+    portEXIT_CRITICAL(&s_shared_lock);
+
+    if (config->create_background_task) {
+        BaseType_t task_created = xTaskCreatePinnedToCore(shared_client_task, "USB shared client", config->stack_size,
+                                  NULL, config->task_priority, NULL, config->core_id);
+        if (!task_created) {
+            s_shared = NULL;
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+    }
+    return ESP_OK;
+
+fail:
+    if (shared->client_hdl) {
+        usb_host_client_deregister(shared->client_hdl);
+    }
+    if (shared->dev_mutex) {
+        vSemaphoreDelete(shared->dev_mutex);
+    }
+    if (shared->all_events_handled) {
+        vSemaphoreDelete(shared->all_events_handled);
+    }
+    free(shared);
+    return ret;
+}
+
+esp_err_t usb_host_shared_client_uninstall(void)
+{
+    shared_client_t *shared = s_shared;
+    ESP_RETURN_ON_FALSE(shared, ESP_ERR_INVALID_STATE, TAG, "Not installed");
+
+    portENTER_CRITICAL(&s_shared_lock);
+    bool in_use = shared->end_event_handling || !SLIST_EMPTY(&shared->devices);
+    for (int i = 0; i < USB_HOST_SHARED_CLIENT_MAX_DRIVERS; i++) {
+        in_use |= shared->drivers[i].used;
+    }
+    if (!in_use) {
+        shared->end_event_handling = true;
+    }
+    portEXIT_CRITICAL(&s_shared_lock);
+    ESP_RETURN_ON_FALSE(!in_use, ESP_ERR_INVALID_STATE, TAG, "Class drivers still use the shared client");
+
+    if (shared->event_handling_started) {
+        ESP_ERROR_CHECK(usb_host_client_unblock(shared->client_hdl));
+        // In case the event handling started, we must wait until it finishes
+        xSemaphoreTake(shared->all_events_handled, portMAX_DELAY);
+    }
+    ESP_ERROR_CHECK(usb_host_client_deregister(shared->client_hdl));
+    s_shared = NULL;
+    vSemaphoreDelete(shared->dev_mutex);
+    vSemaphoreDelete(shared->all_events_handled);
+    free(shared);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_shared_client_handle_events(TickType_t timeout)
+{
+    shared_client_t *shared = s_shared;
+    ESP_RETURN_ON_FALSE(shared, ESP_ERR_INVALID_STATE, TAG, "Not installed");
+
+    shared->event_handling_started = true;
+    shared->handling_task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&s_shared_lock);
+    const TickType_t wait = MIN(timeout, shared->step_wait);
+    shared->step_wait = portMAX_DELAY; // Drivers added from now on request their step again
+    portEXIT_CRITICAL(&s_shared_lock);
+    esp_err_t ret = usb_host_client_handle_events(shared->client_hdl, wait);
+    if (ret == ESP_ERR_TIMEOUT && wait < timeout) {
+        ret = ESP_OK; // Woken up for the steps of drivers, not a timeout of the caller
+    }
+    const TickType_t step_wait = shared_client_dispatch(shared, NULL);
+    portENTER_CRITICAL(&s_shared_lock);
+    shared->step_wait = MIN(shared->step_wait, step_wait);
+    portEXIT_CRITICAL(&s_shared_lock);
+
+    if (shared->end_event_handling) {
+        xSemaphoreGive(shared->all_events_handled);
+        return ESP_FAIL;
+    }
+    return ret;
+}
+
+esp_err_t usb_host_shared_client_add_driver(const usb_host_shared_client_driver_config_t *config,
+        usb_host_shared_client_driver_handle_t *driver_hdl,
+        usb_host_client_handle_t *client_hdl)
+{
+    ESP_RETURN_ON_FALSE(config && config->event_cb && driver_hdl && client_hdl, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(!config->probe_cb || (config->match_table && config->match_count), ESP_ERR_INVALID_ARG, TAG, "Probe without match table");
+    shared_client_t *shared = s_shared;
+    ESP_RETURN_ON_FALSE(shared, ESP_ERR_INVALID_STATE, TAG, "Not installed");
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_shared_lock);
+    for (int i = 0; i < USB_HOST_SHARED_CLIENT_MAX_DRIVERS; i++) {
+        if (!shared->drivers[i].used) {
+            shared->drivers[i].config = *config;
+            shared->drivers[i].used = true;
+            *driver_hdl = &shared->drivers[i];
+            // The driver might need its step before the next event
+            shared->step_wait = 0;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_shared_lock);
+    ESP_RETURN_ON_ERROR(ret, TAG, "Too many class drivers");
+
+    *client_hdl = shared->client_hdl;
+    usb_host_client_unblock(shared->client_hdl);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_shared_client_remove_driver(usb_host_shared_client_driver_handle_t driver_hdl)
+{
+    shared_client_t *shared = s_shared;
+    ESP_RETURN_ON_FALSE(shared && driver_hdl, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&s_shared_lock);
+    driver_hdl->used = false;
+    // Callbacks of the driver might be running in the handling task, wait for them
+    bool wait = shared->dispatching && shared->handling_task != xTaskGetCurrentTaskHandle();
+    portEXIT_CRITICAL(&s_shared_lock);
+    while (wait) {
+        vTaskDelay(1);
+        portENTER_CRITICAL(&s_shared_lock);
+        wait = shared->dispatching;
+        portEXIT_CRITICAL(&s_shared_lock);
+    }
+    return ESP_OK;
+}
+
+esp_err_t usb_host_shared_client_device_open(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t *dev_hdl)
+{
+    shared_client_t *shared = s_shared;
+    if (shared == NULL || client_hdl != shared->client_hdl) {
+        return usb_host_device_open(client_hdl, dev_addr, dev_hdl);
+    }
+
+    esp_err_t ret = ESP_OK;
+    shared_dev_t *dev;
+    xSemaphoreTake(shared->dev_mutex, portMAX_DELAY);
+    SLIST_FOREACH(dev, &shared->devices, list_entry) {
+        if (dev->dev_addr == dev_addr) {
+            break;
+        }
+    }
+    if (dev == NULL) {
+        dev = calloc(1, sizeof(shared_dev_t));
+        ESP_GOTO_ON_FALSE(dev, ESP_ERR_NO_MEM, exit, TAG, "Unable to allocate memory");
+        ret = usb_host_device_open(client_hdl, dev_addr, &dev->dev_hdl);
+        if (ret != ESP_OK) {
+            free(dev);
+            goto exit;
+        }
+        dev->dev_addr = dev_addr;
+        portENTER_CRITICAL(&s_shared_lock);
+        SLIST_INSERT_HEAD(&shared->devices, dev, list_entry);
+        portEXIT_CRITICAL(&s_shared_lock);
+    }
+    dev->refs++;
+    *dev_hdl = dev->dev_hdl;
+
+exit:
+    xSemaphoreGive(shared->dev_mutex);
+    return ret;
+}
+
+esp_err_t usb_host_shared_client_device_close(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl)
+{
+    shared_client_t *shared = s_shared;
+    if (shared == NULL || client_hdl != shared->client_hdl) {
+        return usb_host_device_close(client_hdl, dev_hdl);
+    }
+
+    esp_err_t ret = ESP_OK;
+    shared_dev_t *dev;
+    xSemaphoreTake(shared->dev_mutex, portMAX_DELAY);
+    SLIST_FOREACH(dev, &shared->devices, list_entry) {
+        if (dev->dev_hdl == dev_hdl) {
+            break;
+        }
+    }
+    if (dev == NULL) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else if (--dev->refs == 0) {
+        // Last class driver using the device closes it
+        ret = usb_host_device_close(client_hdl, dev_hdl);
+        if (ret == ESP_OK) {
+            portENTER_CRITICAL(&s_shared_lock);
+            SLIST_REMOVE(&shared->devices, dev, shared_dev, list_entry);
+            portEXIT_CRITICAL(&s_shared_lock);
+            free(dev);
+        } else {
+            dev->refs++;
+        }
+    }
+    xSemaphoreGive(shared->dev_mutex);
+    return ret;
+}
+
+bool usb_host_shared_client_is_shared(usb_host_client_handle_t client_hdl)
+{
+    shared_client_t *shared = s_shared;
+    return shared && client_hdl == shared->client_hdl;
+}
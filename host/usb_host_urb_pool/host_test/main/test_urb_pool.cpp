@@ -0,0 +1,220 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_host_urb_pool.h"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/*
+ * Transfers of the USB Host Library are allocated from heap by stubs, which count them.
+ * A transfer borrowed from the pool does not call usb_host_transfer_alloc().
+ */
+
+static int s_heap_allocs;
+static int s_heap_frees;
+
+static esp_err_t transfer_alloc_stub(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer, int cmock_num_calls)
+{
+    usb_transfer_t *xfer = (usb_transfer_t *)calloc(1, sizeof(usb_transfer_t) + num_isoc_packets * sizeof(usb_isoc_packet_desc_t));
+    uint8_t *buffer = (uint8_t *)calloc(1, data_buffer_size);
+    if (xfer == nullptr || buffer == nullptr) {
+        free(xfer);
+        free(buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    *(uint8_t **)(&(xfer->data_buffer)) = buffer;
+    *(size_t *)(&(xfer->data_buffer_size)) = data_buffer_size;
+    *(int *)(&(xfer->num_isoc_packets)) = num_isoc_packets;
+    *transfer = xfer;
+    s_heap_allocs++;
+    return ESP_OK;
+}
+
+static esp_err_t transfer_free_stub(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    if (transfer) {
+        free(transfer->data_buffer);
+        free(transfer);
+        s_heap_frees++;
+    }
+    return ESP_OK;
+}
+
+static usb_host_urb_pool_class_stats_t class_stats(int class_idx)
+{
+    usb_host_urb_pool_class_stats_t stats;
+    REQUIRE(ESP_OK == usb_host_urb_pool_get_class_stats(class_idx, &stats));
+    return stats;
+}
+
+static usb_transfer_t *alloc(size_t data_buffer_size, int num_isoc_packets = 0)
+{
+    usb_transfer_t *transfer = nullptr;
+    REQUIRE(ESP_OK == usb_host_urb_pool_transfer_alloc(data_buffer_size, num_isoc_packets, &transfer));
+    REQUIRE(transfer != nullptr);
+    CHECK(transfer->data_buffer_size == data_buffer_size);
+    CHECK(transfer->num_isoc_packets == num_isoc_packets);
+    return transfer;
+}
+
+SCENARIO("URB pool")
+{
+    s_heap_allocs = 0;
+    s_heap_frees = 0;
+    usb_host_transfer_alloc_Stub(transfer_alloc_stub);
+    usb_host_transfer_free_Stub(transfer_free_stub);
+
+    GIVEN("Pool is not installed") {
+        THEN("Transfers are allocated from heap") {
+            usb_transfer_t *transfer = alloc(64);
+            CHECK(s_heap_allocs == 1);
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(transfer));
+            CHECK(s_heap_frees == 1);
+            CHECK(ESP_OK == usb_host_urb_pool_transfer_free(nullptr));
+        }
+
+        THEN("There are no statistics and nothing to uninstall") {
+            usb_host_urb_pool_class_stats_t stats;
+            CHECK(ESP_ERR_INVALID_STATE == usb_host_urb_pool_get_class_stats(0, &stats));
+            CHECK(ESP_ERR_INVALID_STATE == usb_host_urb_pool_uninstall());
+        }
+    }
+
+    GIVEN("Invalid configuration") {
+        usb_host_urb_pool_class_t classes[] = {
+            {.data_buffer_size = 64, .num_isoc_packets = 0, .num_transfers = 0},
+        };
+        usb_host_urb_pool_config_t config = {
+            .classes = classes,
+            .num_classes = 1,
+        };
+        THEN("The pool is not installed") {
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_urb_pool_install(nullptr));
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_urb_pool_install(&config)); // Empty class
+            classes[0].num_transfers = 1;
+            config.num_classes = 0;
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_urb_pool_install(&config));
+            config.num_classes = USB_HOST_URB_POOL_MAX_CLASSES + 1;
+            CHECK(ESP_ERR_INVALID_ARG == usb_host_urb_pool_install(&config));
+            CHECK(s_heap_allocs == 0);
+        }
+    }
+
+    GIVEN("Pool with two size classes is installed") {
+        const usb_host_urb_pool_class_t classes[] = {
+            {.data_buffer_size = 64, .num_isoc_packets = 0, .num_transfers = 2},
+            {.data_buffer_size = 512, .num_isoc_packets = 4, .num_transfers = 1},
+        };
+        const usb_host_urb_pool_config_t config = {
+            .classes = classes,
+            .num_classes = 2,
+        };
+        REQUIRE(ESP_OK == usb_host_urb_pool_install(&config));
+        REQUIRE(s_heap_allocs == 3); // All transfers are allocated at install
+        CHECK(ESP_ERR_INVALID_STATE == usb_host_urb_pool_install(&config));
+        s_heap_allocs = 0;
+
+        WHEN("A transfer that fits the smaller class is allocated") {
+            usb_transfer_t *transfer = alloc(32);
+
+            THEN("It is borrowed from the pool and zeroed") {
+                CHECK(s_heap_allocs == 0);
+                CHECK(class_stats(0).in_use == 1);
+                CHECK(class_stats(1).in_use == 0);
+                for (size_t i = 0; i < transfer->data_buffer_size; i++) {
+                    CHECK(transfer->data_buffer[i] == 0);
+                }
+            }
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(transfer));
+            CHECK(s_heap_frees == 0);
+            CHECK(class_stats(0).in_use == 0);
+        }
+
+        WHEN("A borrowed transfer is freed and allocated again") {
+            usb_transfer_t *transfer = alloc(32);
+            transfer->num_bytes = 32;
+            transfer->bEndpointAddress = 0x81;
+            transfer->callback = (usb_transfer_cb_t)0x1234;
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(transfer));
+            usb_transfer_t *again = alloc(16);
+
+            THEN("The same transfer is reused, cleaned by the pool") {
+                CHECK(again == transfer);
+                CHECK(again->num_bytes == 0);
+                CHECK(again->bEndpointAddress == 0);
+                CHECK(again->callback == nullptr);
+                CHECK(class_stats(0).peak == 1);
+                CHECK(s_heap_allocs == 0);
+            }
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(again));
+        }
+
+        WHEN("The pool is exhausted") {
+            usb_transfer_t *small[2] = {alloc(64), alloc(64)};
+            usb_transfer_t *large = alloc(64); // Smaller class is empty, the larger one is used
+            CHECK(s_heap_allocs == 0);
+            CHECK(class_stats(1).in_use == 1);
+            usb_transfer_t *heap = alloc(64);
+
+            THEN("The transfer is allocated from heap and counted as a miss") {
+                CHECK(s_heap_allocs == 1);
+                CHECK(class_stats(0).in_use == 2);
+                CHECK(class_stats(0).peak == 2);
+                CHECK(class_stats(0).misses == 1);
+                CHECK(class_stats(1).misses == 0);
+            }
+
+            THEN("The pool cannot be uninstalled while transfers are borrowed") {
+                CHECK(ESP_ERR_INVALID_STATE == usb_host_urb_pool_uninstall());
+            }
+
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(heap));
+            CHECK(s_heap_frees == 1); // Only the heap transfer is freed, the others return to the pool
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(large));
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(small[0]));
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(small[1]));
+            CHECK(s_heap_frees == 1);
+            CHECK(class_stats(0).in_use == 0);
+            CHECK(class_stats(1).in_use == 0);
+        }
+
+        WHEN("No class fits the transfer") {
+            usb_transfer_t *too_large = alloc(1024);
+            usb_transfer_t *too_many_packets = alloc(64, 8);
+
+            THEN("It is allocated from heap without a miss") {
+                CHECK(s_heap_allocs == 2);
+                CHECK(class_stats(0).misses == 0);
+                CHECK(class_stats(1).misses == 0);
+            }
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(too_large));
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(too_many_packets));
+            CHECK(s_heap_frees == 2);
+        }
+
+        WHEN("Isochronous transfer is allocated") {
+            usb_transfer_t *isoc = alloc(256, 2);
+            THEN("It is borrowed from the class with enough packet descriptors") {
+                CHECK(s_heap_allocs == 0);
+                CHECK(class_stats(1).in_use == 1);
+            }
+            REQUIRE(ESP_OK == usb_host_urb_pool_transfer_free(isoc));
+        }
+
+        s_heap_frees = 0;
+        REQUIRE(ESP_OK == usb_host_urb_pool_uninstall());
+        CHECK(s_heap_frees == 3); // All transfers of the pool are freed at uninstall
+    }
+
+    usb_host_transfer_alloc_Stub(nullptr);
+    usb_host_transfer_free_Stub(nullptr);
+}
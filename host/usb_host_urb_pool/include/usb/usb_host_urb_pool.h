@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/usb_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USB_HOST_URB_POOL_MAX_CLASSES 8 /*!< Maximum number of size classes */
+
+/**
+ * @brief Size class of the pool
+ */
+typedef struct {
+    size_t data_buffer_size;    /**< Data buffer size of transfers in this class */
+    int num_isoc_packets;       /**< Number of isochronous packet descriptors of transfers in this class */
+    int num_transfers;          /**< Number of transfers allocated at install */
+} usb_host_urb_pool_class_t;
+
+/**
+ * @brief Pool configuration
+ */
+typedef struct {
+    const usb_host_urb_pool_class_t *classes;   /**< Size classes */
+    int num_classes;                            /**< Number of size classes, at most USB_HOST_URB_POOL_MAX_CLASSES */
+} usb_host_urb_pool_config_t;
+
+/**
+ * @brief Statistics of a size class
+ */
+typedef struct {
+    int in_use;                 /**< Transfers currently borrowed */
+    int peak;                   /**< Maximum of in_use since install */
+    int misses;                 /**< Requests that fitted this class, but were allocated from heap because the class was empty */
+} usb_host_urb_pool_class_stats_t;
+
+/**
+ * @brief Install the pool
+ *
+ * All transfers are allocated here with usb_host_transfer_alloc(), so their memory meets the requirements
+ * of the USB Host Library (DMA capable, cache aligned) and the peak memory used for transfers is known in advance.
+ * Class drivers borrow transfers with usb_host_urb_pool_transfer_alloc() when a device is opened
+ * and return them when it is closed, so reconnections do not allocate from heap.
+ *
+ * @param[in] config Pool configuration
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The pool is already installed
+ *   - ESP_ERR_INVALID_ARG: Invalid configuration
+ *   - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t usb_host_urb_pool_install(const usb_host_urb_pool_config_t *config);
+
+/**
+ * @brief Uninstall the pool
+ *
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: Not installed or transfers are still borrowed
+ */
+esp_err_t usb_host_urb_pool_uninstall(void);
+
+/**
+ * @brief Allocate a transfer
+ *
+ * Same as usb_host_transfer_alloc(), but the transfer is taken from the smallest size class that fits
+ * data_buffer_size and num_isoc_packets. The transfer is allocated from heap if the pool is not installed,
+ * no class fits or the class is empty. The data buffer is zeroed.
+ *
+ * @param[in]  data_buffer_size Size of the data buffer in bytes
+ * @param[in]  num_isoc_packets Number of isochronous packet descriptors
+ * @param[out] transfer         Transfer
+ * @return See usb_host_transfer_alloc()
+ */
+esp_err_t usb_host_urb_pool_transfer_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer);
+
+/**
+ * @brief Free a transfer allocated with usb_host_urb_pool_transfer_alloc()
+ *
+ * Transfers of the pool are returned to it, others are freed with usb_host_transfer_free().
+ *
+ * @param[in] transfer Transfer, can be NULL
+ * @return See usb_host_transfer_free()
+ */
+esp_err_t usb_host_urb_pool_transfer_free(usb_transfer_t *transfer);
+
+/**
+ * @brief Get statistics of a size class
+ *
+ * @param[in]  class_idx Index of the class in usb_host_urb_pool_config_t::classes
+ * @param[out] stats     Statistics
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: Not installed
+ *   - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t usb_host_urb_pool_get_class_stats(int class_idx, usb_host_urb_pool_class_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
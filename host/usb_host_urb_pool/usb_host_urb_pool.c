@@ -0,0 +1,241 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "usb/usb_host.h"
+#include "usb/usb_host_urb_pool.h"
+
+static const char *TAG = "usb_urb_pool";
+
+// Transfer of the pool, with its original buffer restored when it is returned
+typedef struct {
+    usb_transfer_t *xfer;
+    uint8_t *data_buffer;
+    bool in_use;
+} pool_entry_t;
+
+typedef struct {
+    usb_host_urb_pool_class_t config;
+    pool_entry_t *entries;
+    usb_host_urb_pool_class_stats_t stats;
+} pool_class_t;
+
+typedef struct {
+    int num_classes;
+    int borrowed;                       // Transfers of all classes currently borrowed
+    pool_class_t classes[USB_HOST_URB_POOL_MAX_CLASSES];
+} urb_pool_t;
+
+static urb_pool_t *s_pool;
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Set constant members of a transfer
+ *
+ * Since data_buffer, data_buffer_size and num_isoc_packets in usb_transfer_t are constant, we must cast away the const qualifier.
+ * The borrower sees the transfer as if it was allocated with its own size, the original values are restored when it is returned.
+ */
+static inline void transfer_set_constants(usb_transfer_t *xfer, uint8_t *buffer, size_t size, int num_isoc_packets)
+{
+    *(uint8_t **)(&(xfer->data_buffer)) = buffer;
+    *(size_t *)(&(xfer->data_buffer_size)) = size;
+    *(int *)(&(xfer->num_isoc_packets)) = num_isoc_packets;
+}
+
+static void urb_pool_free(urb_pool_t *pool)
+{
+    for (int c = 0; c < pool->num_classes; c++) {
+        pool_class_t *cls = &pool->classes[c];
+        if (cls->entries == NULL) {
+            continue;
+        }
+        for (int i = 0; i < cls->config.num_transfers; i++) {
+            if (cls->entries[i].xfer) {
+                usb_host_transfer_free(cls->entries[i].xfer);
+            }
+        }
+        free(cls->entries);
+    }
+    free(pool);
+}
+
+esp_err_t usb_host_urb_pool_install(const usb_host_urb_pool_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->classes, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
+    ESP_RETURN_ON_FALSE(config->num_classes > 0 && config->num_classes <= USB_HOST_URB_POOL_MAX_CLASSES, ESP_ERR_INVALID_ARG, TAG,
+                        "Number of classes must be 1 to %d", USB_HOST_URB_POOL_MAX_CLASSES);
+    for (int c = 0; c < config->num_classes; c++) {
+        ESP_RETURN_ON_FALSE(config->classes[c].num_transfers > 0 && config->classes[c].num_isoc_packets >= 0, ESP_ERR_INVALID_ARG, TAG,
+                            "Invalid class %d", c);
+    }
+    ESP_RETURN_ON_FALSE(s_pool == NULL, ESP_ERR_INVALID_STATE, TAG, "Already installed");
+
+    esp_err_t ret = ESP_OK;
+    urb_pool_t *pool = calloc(1, sizeof(urb_pool_t));
+    ESP_RETURN_ON_FALSE(pool, ESP_ERR_NO_MEM, TAG, "Unable to allocate pool");
+    pool->num_classes = config->num_classes;
+    for (int c = 0; c < config->num_classes; c++) {
+        pool_class_t *cls = &pool->classes[c];
+        cls->config = config->classes[c];
+        cls->entries = calloc(cls->config.num_transfers, sizeof(pool_entry_t));
+        ESP_GOTO_ON_FALSE(cls->entries, ESP_ERR_NO_MEM, fail, TAG, "Unable to allocate class %d", c);
+        for (int i = 0; i < cls->config.num_transfers; i++) {
+            ESP_GOTO_ON_ERROR(usb_host_transfer_alloc(cls->config.data_buffer_size, cls->config.num_isoc_packets, &cls->entries[i].xfer),
+                              fail, TAG, "Unable to allocate transfer of class %d", c);
+            cls->entries[i].data_buffer = cls->entries[i].xfer->data_buffer;
+        }
+    }
+
+    portENTER_CRITICAL(&s_pool_lock);
+    if (s_pool) {
+        portEXIT_CRITICAL(&s_pool_lock);
+        ret = ESP_ERR_INVALID_STATE;
+        goto fail;
+    }
+    s_pool = pool;
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ESP_OK;
+
+fail:
+    urb_pool_free(pool);
+    return ret;
+}
+
+esp_err_t usb_host_urb_pool_uninstall(void)
+{
+    portENTER_CRITICAL(&s_pool_lock);
+    urb_pool_t *pool = s_pool;
+    const int borrowed = pool ? pool->borrowed : 0;
+    if (pool == NULL || borrowed) {
+        portEXIT_CRITICAL(&s_pool_lock);
+        ESP_LOGE(TAG, "Not installed or %d transfers are borrowed", borrowed);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_pool = NULL;
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    urb_pool_free(pool);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_urb_pool_transfer_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer)
+{
+    pool_entry_t *entry = NULL;
+    portENTER_CRITICAL(&s_pool_lock);
+    urb_pool_t *pool = s_pool;
+    if (pool) {
+        pool_class_t *best_fit = NULL;  // Smallest class that fits
+        pool_class_t *best_free = NULL; // Smallest class that fits and has a free transfer
+        pool_entry_t *best_free_entry = NULL;
+        for (int c = 0; c < pool->num_classes; c++) {
+            pool_class_t *cls = &pool->classes[c];
+            if (cls->config.data_buffer_size < data_buffer_size || cls->config.num_isoc_packets < num_isoc_packets) {
+                continue;
+            }
+            if (best_fit == NULL || cls->config.data_buffer_size < best_fit->config.data_buffer_size) {
+                best_fit = cls;
+            }
+            if (cls->stats.in_use == cls->config.num_transfers ||
+                    (best_free && cls->config.data_buffer_size >= best_free->config.data_buffer_size)) {
+                continue;
+            }
+            for (int i = 0; i < cls->config.num_transfers; i++) {
+                if (!cls->entries[i].in_use) {
+                    best_free = cls;
+                    best_free_entry = &cls->entries[i];
+                    break;
+                }
+            }
+        }
+        if (best_free) {
+            entry = best_free_entry;
+            entry->in_use = true;
+            best_free->stats.in_use++;
+            if (best_free->stats.in_use > best_free->stats.peak) {
+                best_free->stats.peak = best_free->stats.in_use;
+            }
+            pool->borrowed++;
+        } else if (best_fit) {
+            best_fit->stats.misses++;
+        }
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (entry == NULL) {
+        return usb_host_transfer_alloc(data_buffer_size, num_isoc_packets, transfer);
+    }
+
+    usb_transfer_t *xfer = entry->xfer;
+    transfer_set_constants(xfer, entry->data_buffer, data_buffer_size, num_isoc_packets);
+    memset(xfer->data_buffer, 0, data_buffer_size);
+    *transfer = xfer;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_urb_pool_transfer_free(usb_transfer_t *transfer)
+{
+    if (transfer == NULL) {
+        return ESP_OK;
+    }
+
+    pool_entry_t *entry = NULL;
+    pool_class_t *cls = NULL;
+    portENTER_CRITICAL(&s_pool_lock);
+    urb_pool_t *pool = s_pool;
+    for (int c = 0; pool && c < pool->num_classes && entry == NULL; c++) {
+        for (int i = 0; i < pool->classes[c].config.num_transfers; i++) {
+            if (pool->classes[c].entries[i].xfer == transfer) {
+                cls = &pool->classes[c];
+                entry = &cls->entries[i];
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (entry == NULL) {
+        return usb_host_transfer_free(transfer);
+    }
+
+    // Clean the transfer before it becomes available to other borrowers
+    transfer_set_constants(transfer, entry->data_buffer, cls->config.data_buffer_size, cls->config.num_isoc_packets);
+    transfer->num_bytes = 0;
+    transfer->actual_num_bytes = 0;
+    transfer->flags = 0;
+    transfer->device_handle = NULL;
+    transfer->bEndpointAddress = 0;
+    transfer->timeout_ms = 0;
+    transfer->callback = NULL;
+    transfer->context = NULL;
+    memset(transfer->isoc_packet_desc, 0, cls->config.num_isoc_packets * sizeof(usb_isoc_packet_desc_t));
+
+    portENTER_CRITICAL(&s_pool_lock);
+    entry->in_use = false;
+    cls->stats.in_use--;
+    pool->borrowed--;
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_urb_pool_get_class_stats(int class_idx, usb_host_urb_pool_class_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid stats");
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_pool_lock);
+    if (s_pool == NULL) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (class_idx < 0 || class_idx >= s_pool->num_classes) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else {
+        *stats = s_pool->classes[class_idx].stats;
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ret;
+}